@@ -0,0 +1,20 @@
+#pragma once
+
+#include <chrono>
+
+//Runs 'function' (which returns the amount of items it processed) until at least
+//'minDuration' seconds elapsed and returns the number of items processed per second
+template <typename FunctionType>
+double MeasureThroughput(const FunctionType& function, double minDuration = 0.5)
+{
+	typedef std::chrono::steady_clock Clock;
+	double itemCount = 0;
+	auto startTime = Clock::now();
+	double elapsed = 0;
+	do
+	{
+		itemCount += static_cast<double>(function());
+		elapsed = std::chrono::duration<double>(Clock::now() - startTime).count();
+	} while(elapsed < minDuration);
+	return itemCount / elapsed;
+}
@@ -0,0 +1,63 @@
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+#include "BenchmarkReport.h"
+#include "MemoryStats.h"
+
+struct REPORT_ENTRY
+{
+	std::string group;
+	std::string name;
+	double value = 0;
+	std::string unit;
+};
+
+static std::vector<REPORT_ENTRY> g_entries;
+
+static std::string EscapeJson(const std::string& input)
+{
+	std::string result;
+	result.reserve(input.size());
+	for(auto character : input)
+	{
+		if((character == '"') || (character == '\\'))
+		{
+			result += '\\';
+		}
+		result += character;
+	}
+	return result;
+}
+
+void BenchmarkReport_Add(const char* group, const std::string& name, double value, const char* unit)
+{
+	REPORT_ENTRY entry;
+	entry.group = group;
+	entry.name = name;
+	entry.value = value;
+	entry.unit = unit;
+	g_entries.push_back(std::move(entry));
+}
+
+bool BenchmarkReport_WriteJson(const char* path)
+{
+	FILE* output = fopen(path, "w");
+	if(!output)
+	{
+		printf("Failed to open '%s' for writing.\n", path);
+		return false;
+	}
+	fprintf(output, "{\n\t\"threadCount\": %u,\n\t\"peakResidentSize\": %llu,\n\t\"results\": [\n",
+	        std::thread::hardware_concurrency(), static_cast<unsigned long long>(GetPeakResidentSize()));
+	for(size_t i = 0; i < g_entries.size(); i++)
+	{
+		const auto& entry = g_entries[i];
+		fprintf(output, "\t\t{ \"group\": \"%s\", \"name\": \"%s\", \"value\": %.6g, \"unit\": \"%s\" }%s\n",
+		        EscapeJson(entry.group).c_str(), EscapeJson(entry.name).c_str(), entry.value, EscapeJson(entry.unit).c_str(),
+		        (i + 1 != g_entries.size()) ? "," : "");
+	}
+	fprintf(output, "\t]\n}\n");
+	fclose(output);
+	return true;
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <string>
+
+//Collects the results of every benchmark so that a run can be written to a single JSON file
+//and compared with another one (see compare_benchmarks.py)
+
+//'group' is the benchmark's section, 'unit' tells what 'value' counts (ie.: "MB/s", "ops/s")
+void BenchmarkReport_Add(const char* group, const std::string& name, double value, const char* unit);
+bool BenchmarkReport_WriteJson(const char* path);
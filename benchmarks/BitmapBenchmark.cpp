@@ -0,0 +1,252 @@
+#include <algorithm>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+#include "BitmapBenchmark.h"
+#include "BenchmarkDefs.h"
+#include "BenchmarkReport.h"
+#include "Corpus.h"
+#include "MemoryStats.h"
+#include "MemStream.h"
+#include "PtrStream.h"
+#include "ThreadPool.h"
+#include "bitmap/BitmapBlitter.h"
+#include "bitmap/BMP.h"
+#include "bitmap/JPEG.h"
+#include "bitmap/PNG.h"
+#include "bitmap/TGA.h"
+
+struct BENCHMARK_RESULT
+{
+	std::string name;
+	double megapixelsPerSecond = 0;
+	//Encoded bytes for decoders, destination bytes for everything else
+	double megabytesPerSecond = 0;
+	uint64_t allocationCount = 0;
+	size_t peakHeapSize = 0;
+};
+
+typedef std::function<Framework::CBitmap (Framework::CStream&)> DecodeFunction;
+
+static const unsigned int g_imageWidth = 1024;
+static const unsigned int g_imageHeight = 768;
+
+static std::vector<uint8> ToBuffer(Framework::CMemStream& stream)
+{
+	return std::vector<uint8>(stream.GetBuffer(), stream.GetBuffer() + stream.GetSize());
+}
+
+static std::vector<uint8> EncodeTga(const Framework::CBitmap& bitmap)
+{
+	//There's no TGA writer, build an uncompressed top-down BGRA image by hand
+	std::vector<uint8> result(0x12, 0);
+	result[2] = 2;
+	result[12] = static_cast<uint8>(bitmap.GetWidth());
+	result[13] = static_cast<uint8>(bitmap.GetWidth() >> 8);
+	result[14] = static_cast<uint8>(bitmap.GetHeight());
+	result[15] = static_cast<uint8>(bitmap.GetHeight() >> 8);
+	result[16] = 32;
+	result[17] = 0x20;
+	const uint8* pixels = bitmap.GetPixels();
+	for(unsigned int i = 0; i < bitmap.GetPixelsSize(); i += 4)
+	{
+		uint8 pixel[4] = { pixels[i + 2], pixels[i + 1], pixels[i + 0], pixels[i + 3] };
+		result.insert(result.end(), pixel, pixel + 4);
+	}
+	return result;
+}
+
+template <typename FunctionType>
+static BENCHMARK_RESULT Measure(const char* name, double pixelCount, double byteCount, const FunctionType& function)
+{
+	BENCHMARK_RESULT result;
+	result.name = name;
+
+	//Warm up pools and caches before counting allocations
+	function();
+	ResetAllocationStats();
+	function();
+	auto stats = GetAllocationStats();
+	result.allocationCount = stats.allocationCount;
+	result.peakHeapSize = stats.peakSize;
+
+	double rate = MeasureThroughput(
+	    [&]() {
+		    function();
+		    return 1;
+	    });
+	result.megapixelsPerSecond = rate * pixelCount / 1e6;
+	result.megabytesPerSecond = rate * byteCount / (1024.0 * 1024.0);
+
+	printf("  %s: %.1f Mpixels/s, %.1f MB/s, %llu allocations, %.2f MB peak heap\n", name,
+	       result.megapixelsPerSecond, result.megabytesPerSecond,
+	       static_cast<unsigned long long>(result.allocationCount), result.peakHeapSize / (1024.0 * 1024.0));
+	BenchmarkReport_Add("Bitmap", name, result.megapixelsPerSecond, "Mpixels/s");
+	return result;
+}
+
+static BENCHMARK_RESULT MeasureDecode(const char* name, const std::vector<uint8>& data, const DecodeFunction& decode)
+{
+	return Measure(name, g_imageWidth * g_imageHeight, static_cast<double>(data.size()),
+	    [&]() {
+		    Framework::CPtrStream stream(data.data(), data.size());
+		    auto bitmap = decode(stream);
+		    if((bitmap.GetWidth() != g_imageWidth) || (bitmap.GetHeight() != g_imageHeight))
+		    {
+			    printf("  %s: decoded image has unexpected dimensions\n", name);
+		    }
+	    });
+}
+
+static void WriteJson(const char* path, const std::vector<BENCHMARK_RESULT>& results)
+{
+	FILE* output = fopen(path, "w");
+	if(!output)
+	{
+		printf("Failed to open '%s' for writing.\n", path);
+		return;
+	}
+	//Names don't contain characters that need escaping
+	fprintf(output, "{\n\t\"peakResidentSize\": %llu,\n\t\"results\": [\n", static_cast<unsigned long long>(GetPeakResidentSize()));
+	for(size_t i = 0; i < results.size(); i++)
+	{
+		const auto& result = results[i];
+		fprintf(output, "\t\t{ \"name\": \"%s\", \"megapixelsPerSecond\": %.3f, \"megabytesPerSecond\": %.3f, \"allocationCount\": %llu, \"peakHeapSize\": %llu }%s\n",
+		        result.name.c_str(), result.megapixelsPerSecond, result.megabytesPerSecond,
+		        static_cast<unsigned long long>(result.allocationCount), static_cast<unsigned long long>(result.peakHeapSize),
+		        (i + 1 != results.size()) ? "," : "");
+	}
+	fprintf(output, "\t]\n}\n");
+	fclose(output);
+}
+
+void BitmapBenchmark_Execute(const char* jsonPath)
+{
+	Framework::CThreadPool threadPool(std::max(1U, std::thread::hardware_concurrency()));
+	std::vector<BENCHMARK_RESULT> results;
+
+	auto image8 = Corpus_MakeImage(g_imageWidth, g_imageHeight, 8);
+	auto image24 = Corpus_MakeImage(g_imageWidth, g_imageHeight, 24);
+	auto image32 = Corpus_MakeImage(g_imageWidth, g_imageHeight, 32);
+
+	printf("Bitmap decoding (%ux%u)\n", g_imageWidth, g_imageHeight);
+	{
+		Framework::CMemStream stream;
+		Framework::CBMP::WriteBitmap(image8, stream);
+		results.push_back(MeasureDecode("BMP 8bpp", ToBuffer(stream), &Framework::CBMP::ReadBitmap));
+	}
+	{
+		Framework::CMemStream stream;
+		Framework::CPNG::WriteBitmap(image24, stream);
+		results.push_back(MeasureDecode("PNG 24bpp", ToBuffer(stream), [](Framework::CStream& input) { return Framework::CPNG::ReadBitmap(input); }));
+	}
+	{
+		Framework::CMemStream stream;
+		Framework::CPNG::WriteBitmap(image32, stream);
+		results.push_back(MeasureDecode("PNG 32bpp", ToBuffer(stream), [](Framework::CStream& input) { return Framework::CPNG::ReadBitmap(input); }));
+	}
+	{
+		Framework::CMemStream stream;
+		Framework::CJPEG::WriteBitmap(image24, stream);
+		auto data = ToBuffer(stream);
+		results.push_back(MeasureDecode("JPEG", data, [](Framework::CStream& input) { return Framework::CJPEG::ReadBitmap(input); }));
+		results.push_back(MeasureDecode("JPEG (thread pool)", data, [&](Framework::CStream& input) { return Framework::CJPEG::ReadBitmap(input, threadPool); }));
+	}
+	results.push_back(MeasureDecode("TGA 32bpp", EncodeTga(image32), &Framework::CTGA::ReadBitmap));
+
+	printf("Bitmap encoding (%ux%u)\n", g_imageWidth, g_imageHeight);
+	{
+		double pixelCount = g_imageWidth * g_imageHeight;
+		results.push_back(Measure("PNG 32bpp encode", pixelCount, image32.GetPixelsSize(),
+		    [&]() {
+			    Framework::CMemStream stream;
+			    Framework::CPNG::WriteBitmap(image32, stream);
+		    }));
+		results.push_back(Measure("PNG 32bpp encode (thread pool)", pixelCount, image32.GetPixelsSize(),
+		    [&]() {
+			    Framework::CMemStream stream;
+			    Framework::CPNG::WriteBitmap(image32, stream, threadPool);
+		    }));
+		results.push_back(Measure("JPEG encode", pixelCount, image24.GetPixelsSize(),
+		    [&]() {
+			    Framework::CMemStream stream;
+			    Framework::CJPEG::WriteBitmap(image24, stream);
+		    }));
+	}
+
+	printf("Bitmap resizing (%ux%u to %ux%u, 32bpp)\n", g_imageWidth, g_imageHeight, g_imageWidth / 2, g_imageHeight / 2);
+	{
+		struct RESIZE_FILTER_ENTRY
+		{
+			const char* name;
+			Framework::CBitmap::RESIZE_FILTER filter;
+		};
+		static const RESIZE_FILTER_ENTRY filters[] =
+		{
+			{ "Resize nearest", Framework::CBitmap::RESIZE_FILTER_NEAREST },
+			{ "Resize bilinear", Framework::CBitmap::RESIZE_FILTER_BILINEAR },
+			{ "Resize bicubic", Framework::CBitmap::RESIZE_FILTER_BICUBIC },
+			{ "Resize lanczos", Framework::CBitmap::RESIZE_FILTER_LANCZOS },
+		};
+		unsigned int dstWidth = g_imageWidth / 2;
+		unsigned int dstHeight = g_imageHeight / 2;
+		for(const auto& entry : filters)
+		{
+			results.push_back(Measure(entry.name, dstWidth * dstHeight, dstWidth * dstHeight * 4,
+			    [&]() {
+				    image32.Resize(dstWidth, dstHeight, entry.filter);
+			    }));
+		}
+		results.push_back(Measure("Resize lanczos (thread pool)", dstWidth * dstHeight, dstWidth * dstHeight * 4,
+		    [&]() {
+			    image32.Resize(dstWidth, dstHeight, Framework::CBitmap::RESIZE_FILTER_LANCZOS, &threadPool);
+		    }));
+	}
+
+	printf("Bitmap blitting (64x64 sprites into %ux%u, 32bpp)\n", g_imageWidth, g_imageHeight);
+	{
+		static const unsigned int spriteSize = 64;
+		static const unsigned int spriteCount = 1024;
+		auto sprite = Corpus_MakeImage(spriteSize, spriteSize, 32);
+		Framework::CBitmap destination(g_imageWidth, g_imageHeight, 32);
+		double pixelCount = spriteSize * spriteSize * spriteCount;
+
+		results.push_back(Measure("Blit", pixelCount, pixelCount * 4,
+		    [&]() {
+			    for(unsigned int i = 0; i < spriteCount; i++)
+			    {
+				    destination.Blit(sprite, (i * 37) % (g_imageWidth - spriteSize), (i * 53) % (g_imageHeight - spriteSize));
+			    }
+		    }));
+
+		typedef Framework::CBitmapBlitter Blitter;
+		Blitter::OperationArray copyOperations;
+		for(unsigned int i = 0; i < spriteCount; i++)
+		{
+			Blitter::OPERATION operation;
+			operation.source = sprite;
+			operation.x = (i * 37) % (g_imageWidth - spriteSize);
+			operation.y = (i * 53) % (g_imageHeight - spriteSize);
+			copyOperations.push_back(operation);
+		}
+		auto alphaOperations = copyOperations;
+		for(auto& operation : alphaOperations)
+		{
+			operation.blendMode = Blitter::BLEND_MODE_ALPHA;
+		}
+
+		results.push_back(Measure("Batch blit copy", pixelCount, pixelCount * 4, [&]() { Blitter::Blit(destination, copyOperations); }));
+		results.push_back(Measure("Batch blit copy (thread pool)", pixelCount, pixelCount * 4, [&]() { Blitter::Blit(destination, copyOperations, &threadPool); }));
+		results.push_back(Measure("Batch blit alpha", pixelCount, pixelCount * 4, [&]() { Blitter::Blit(destination, alphaOperations); }));
+		results.push_back(Measure("Batch blit alpha (thread pool)", pixelCount, pixelCount * 4, [&]() { Blitter::Blit(destination, alphaOperations, &threadPool); }));
+	}
+
+	printf("  Peak resident size: %.2f MB\n", GetPeakResidentSize() / (1024.0 * 1024.0));
+
+	if(jsonPath)
+	{
+		WriteJson(jsonPath, results);
+	}
+}
@@ -0,0 +1,4 @@
+#pragma once
+
+//Results are also written as JSON to 'jsonPath' if it's not null
+void BitmapBenchmark_Execute(const char* jsonPath);
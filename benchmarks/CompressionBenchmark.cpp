@@ -0,0 +1,279 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "CompressionBenchmark.h"
+#include "BenchmarkDefs.h"
+#include "BenchmarkReport.h"
+#include "filesystem_def.h"
+#include "LzAri.h"
+#include "MemStream.h"
+#include "ParallelGZipStream.h"
+#include "PtrStream.h"
+#include "StdStreamUtils.h"
+#include "ThreadPool.h"
+#include "zip/ZipArchiveReader.h"
+#include "zip/ZipArchiveWriter.h"
+#include "zip/ZipDeflateStream.h"
+#include "zip/ZipInflateStream.h"
+#include "zip/ZipZstdCompressStream.h"
+#include "zip/ZipZstdDecompressStream.h"
+
+struct CORPUS_FILE
+{
+	std::string name;
+	std::vector<uint8> data;
+};
+typedef std::vector<CORPUS_FILE> Corpus;
+
+//Compresses the input and returns the compressed data
+typedef std::function<std::vector<uint8> (const std::vector<uint8>&, Framework::CThreadPool*)> CompressFunction;
+//Decompresses to a buffer of the original size
+typedef std::function<void (const std::vector<uint8>&, std::vector<uint8>&, Framework::CThreadPool*)> DecompressFunction;
+
+struct CODEC
+{
+	const char* name;
+	bool isParallel;
+	CompressFunction compress;
+	DecompressFunction decompress;
+};
+
+static std::vector<uint8> ToBuffer(Framework::CMemStream& stream)
+{
+	return std::vector<uint8>(stream.GetBuffer(), stream.GetBuffer() + stream.GetSize());
+}
+
+//Deterministic stand-ins for the usual text, structured binary and incompressible corpus files
+static Corpus MakeCorpus()
+{
+	static const char* words[] =
+	{
+		"the", "of", "and", "to", "in", "is", "that", "for", "it", "as", "was", "with", "be", "by", "on", "not",
+		"framework", "stream", "buffer", "compression", "archive", "thread", "block", "window", "entry", "index",
+	};
+	uint32_t seed = 1;
+	auto next = [&]() { seed = (seed * 1103515245) + 12345; return seed >> 16; };
+
+	Corpus corpus;
+	{
+		CORPUS_FILE file = { "text" };
+		while(file.data.size() < 0x200000)
+		{
+			std::string word = words[next() % (sizeof(words) / sizeof(words[0]))];
+			word += ((next() % 12) == 0) ? ".\n" : " ";
+			file.data.insert(file.data.end(), word.begin(), word.end());
+		}
+		corpus.push_back(std::move(file));
+	}
+	{
+		//Records with slowly changing fields
+		CORPUS_FILE file = { "binary" };
+		for(uint32_t i = 0; file.data.size() < 0x200000; i++)
+		{
+			uint32_t record[4] = { i, 0x1000 + (i / 16), next() & 0xFF, (i * 3) ^ 0x55AA };
+			auto bytes = reinterpret_cast<const uint8*>(record);
+			file.data.insert(file.data.end(), bytes, bytes + sizeof(record));
+		}
+		corpus.push_back(std::move(file));
+	}
+	{
+		CORPUS_FILE file = { "random" };
+		file.data.resize(0x100000);
+		for(auto& value : file.data)
+		{
+			value = static_cast<uint8>(next());
+		}
+		corpus.push_back(std::move(file));
+	}
+	return corpus;
+}
+
+static Corpus LoadCorpus(const char* path)
+{
+	Corpus corpus;
+	for(const auto& entry : fs::directory_iterator(path))
+	{
+		if(!fs::is_regular_file(entry.path())) continue;
+		CORPUS_FILE file;
+		file.name = entry.path().filename().string();
+		auto stream = Framework::CreateInputStdStream(entry.path().native());
+		file.data.resize(static_cast<size_t>(stream.GetLength()));
+		stream.Read(file.data.data(), file.data.size());
+		corpus.push_back(std::move(file));
+	}
+	std::sort(corpus.begin(), corpus.end(), [](const CORPUS_FILE& lhs, const CORPUS_FILE& rhs) { return lhs.name < rhs.name; });
+	return corpus;
+}
+
+static std::vector<CODEC> MakeCodecs()
+{
+	std::vector<CODEC> codecs;
+	codecs.push_back(
+	    { "LzAri", false,
+	      [](const std::vector<uint8>& input, Framework::CThreadPool*) {
+		      std::vector<uint8> result;
+		      Framework::CLzAri::Compress(input.data(), input.size(), result);
+		      return result;
+	      },
+	      [](const std::vector<uint8>& input, std::vector<uint8>& output, Framework::CThreadPool*) {
+		      Framework::CLzAri::Decompress(input.data(), input.size(), output);
+	      } });
+	codecs.push_back(
+	    { "Zip deflate", false,
+	      [](const std::vector<uint8>& input, Framework::CThreadPool*) {
+		      Framework::CMemStream stream;
+		      Framework::CZipDeflateStream deflateStream(stream);
+		      deflateStream.Write(input.data(), input.size());
+		      deflateStream.Flush();
+		      return ToBuffer(stream);
+	      },
+	      [](const std::vector<uint8>& input, std::vector<uint8>& output, Framework::CThreadPool*) {
+		      Framework::CZipInflateStream inflateStream(input.data(), static_cast<unsigned int>(input.size()));
+		      inflateStream.DecompressTo(output.data(), output.size());
+	      } });
+	codecs.push_back(
+	    { "Zip zstd", false,
+	      [](const std::vector<uint8>& input, Framework::CThreadPool*) {
+		      Framework::CMemStream stream;
+		      Framework::CZipZstdCompressStream zstdStream(stream);
+		      zstdStream.Write(input.data(), input.size());
+		      zstdStream.Flush();
+		      return ToBuffer(stream);
+	      },
+	      [](const std::vector<uint8>& input, std::vector<uint8>& output, Framework::CThreadPool*) {
+		      Framework::CPtrStream stream(input.data(), input.size());
+		      Framework::CZipZstdDecompressStream zstdStream(stream, static_cast<unsigned int>(input.size()));
+		      zstdStream.Read(output.data(), output.size());
+	      } });
+	codecs.push_back(
+	    { "Gzip (BGZF blocks)", true,
+	      [](const std::vector<uint8>& input, Framework::CThreadPool* threadPool) {
+		      Framework::CMemStream stream;
+		      {
+			      Framework::CParallelGZipWriteStream gzipStream(stream, threadPool);
+			      gzipStream.Write(input.data(), input.size());
+		      }
+		      return ToBuffer(stream);
+	      },
+	      [](const std::vector<uint8>& input, std::vector<uint8>& output, Framework::CThreadPool* threadPool) {
+		      Framework::CPtrStream stream(input.data(), input.size());
+		      Framework::CParallelGZipReadStream gzipStream(stream, threadPool);
+		      gzipStream.Read(output.data(), output.size());
+	      } });
+	codecs.push_back(
+	    { "Zip archive (256KB entries)", true,
+	      [](const std::vector<uint8>& input, Framework::CThreadPool* threadPool) {
+		      //Input is split in entries so that they can be compressed concurrently
+		      class CBufferZipFile : public Framework::CZipFile
+		      {
+		      public:
+			      CBufferZipFile(const char* name, const uint8* data, size_t size)
+			          : CZipFile(name)
+			          , m_data(data)
+			          , m_size(size)
+			      {
+			      }
+			      void Write(Framework::CStream& stream) override
+			      {
+				      stream.Write(m_data, m_size);
+			      }
+
+		      private:
+			      const uint8* m_data;
+			      size_t m_size;
+		      };
+		      static const size_t entrySize = 0x40000;
+		      Framework::CZipArchiveWriter writer;
+		      for(size_t offset = 0; offset < input.size(); offset += entrySize)
+		      {
+			      auto name = std::to_string(offset / entrySize);
+			      writer.InsertFile(std::make_unique<CBufferZipFile>(name.c_str(), input.data() + offset, std::min(entrySize, input.size() - offset)));
+		      }
+		      Framework::CMemStream stream;
+		      if(threadPool)
+		      {
+			      writer.Write(stream, *threadPool);
+		      }
+		      else
+		      {
+			      writer.Write(stream);
+		      }
+		      return ToBuffer(stream);
+	      },
+	      [](const std::vector<uint8>& input, std::vector<uint8>& output, Framework::CThreadPool* threadPool) {
+		      static const size_t entrySize = 0x40000;
+		      Framework::CPtrStream stream(input.data(), input.size());
+		      Framework::CZipArchiveReader reader(stream);
+		      reader.ExtractAll(
+		          [&](const std::string& name, const uint8* data, size_t size) {
+			          memcpy(output.data() + std::stoul(name) * entrySize, data, size);
+		          },
+		          true, threadPool);
+	      } });
+	return codecs;
+}
+
+void CompressionBenchmark_Execute(const char* corpusPath)
+{
+	auto corpus = corpusPath ? LoadCorpus(corpusPath) : MakeCorpus();
+	auto codecs = MakeCodecs();
+
+	std::vector<unsigned int> threadCounts = { 1, 2, 4 };
+	unsigned int hardwareThreadCount = std::max(1U, std::thread::hardware_concurrency());
+	if(hardwareThreadCount > threadCounts.back())
+	{
+		threadCounts.push_back(hardwareThreadCount);
+	}
+
+	printf("Compression (%s corpus)\n", corpusPath ? corpusPath : "generated");
+	for(const auto& file : corpus)
+	{
+		printf("  %s (%.2f MB)\n", file.name.c_str(), file.data.size() / (1024.0 * 1024.0));
+		double megabytes = file.data.size() / (1024.0 * 1024.0);
+		for(const auto& codec : codecs)
+		{
+			//Single threaded codecs are only run once, without a thread pool
+			std::vector<unsigned int> codecThreadCounts = codec.isParallel ? threadCounts : std::vector<unsigned int>{ 0 };
+			for(auto threadCount : codecThreadCounts)
+			{
+				std::unique_ptr<Framework::CThreadPool> threadPool;
+				if(threadCount != 0)
+				{
+					threadPool = std::make_unique<Framework::CThreadPool>(threadCount);
+				}
+
+				auto compressed = codec.compress(file.data, threadPool.get());
+				std::vector<uint8> decompressed(file.data.size());
+				codec.decompress(compressed, decompressed, threadPool.get());
+				if(decompressed != file.data)
+				{
+					printf("    %s: decompressed data doesn't match\n", codec.name);
+					continue;
+				}
+
+				double compressRate = MeasureThroughput(
+				    [&]() {
+					    codec.compress(file.data, threadPool.get());
+					    return 1;
+				    });
+				double decompressRate = MeasureThroughput(
+				    [&]() {
+					    codec.decompress(compressed, decompressed, threadPool.get());
+					    return 1;
+				    });
+
+				printf("    %-28s %2u thread(s): compress %8.1f MB/s, decompress %8.1f MB/s, ratio %.3f\n",
+				       codec.name, std::max(threadCount, 1U), compressRate * megabytes, decompressRate * megabytes,
+				       static_cast<double>(file.data.size()) / static_cast<double>(std::max<size_t>(compressed.size(), 1)));
+				auto reportName = file.name + ", " + codec.name + ", " + std::to_string(std::max(threadCount, 1U)) + " thread(s)";
+				BenchmarkReport_Add("Compression", reportName + ", compress", compressRate * megabytes, "MB/s");
+				BenchmarkReport_Add("Compression", reportName + ", decompress", decompressRate * megabytes, "MB/s");
+			}
+		}
+	}
+}
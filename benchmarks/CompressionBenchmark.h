@@ -0,0 +1,4 @@
+#pragma once
+
+//Files of 'corpusPath' are used as the corpus if it's not null, a generated one is used otherwise
+void CompressionBenchmark_Execute(const char* corpusPath);
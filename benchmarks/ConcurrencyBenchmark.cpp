@@ -0,0 +1,243 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+#include "ConcurrencyBenchmark.h"
+#include "BenchmarkDefs.h"
+#include "BenchmarkReport.h"
+#include "MemoryStats.h"
+#include "LockFreeQueue.h"
+#include "ThreadPool.h"
+#include "Types.h"
+#include "signal/Signal.h"
+
+struct BENCHMARK_RESULT
+{
+	std::string name;
+	double opsPerSecond = 0;
+	double allocationsPerOp = 0;
+};
+
+static const double g_minDuration = 0.25;
+
+//Runs a batch once more after measuring to count allocations made for each operation
+template <typename FunctionType>
+static BENCHMARK_RESULT Measure(const std::string& name, const FunctionType& function)
+{
+	BENCHMARK_RESULT result;
+	result.name = name;
+	result.opsPerSecond = MeasureThroughput(function, g_minDuration);
+	ResetAllocationStats();
+	auto opCount = function();
+	result.allocationsPerOp = static_cast<double>(GetAllocationStats().allocationCount) / static_cast<double>(opCount);
+	printf("  %s: %.0f ops/s, %.1f ns/op, %.3f allocations/op\n",
+	       name.c_str(), result.opsPerSecond, 1e9 / result.opsPerSecond, result.allocationsPerOp);
+	BenchmarkReport_Add("Concurrency", name, result.opsPerSecond, "ops/s");
+	return result;
+}
+
+static std::vector<unsigned int> GetThreadCounts()
+{
+	unsigned int maxThreadCount = std::max(1U, std::thread::hardware_concurrency());
+	std::vector<unsigned int> threadCounts;
+	for(unsigned int threadCount = 1; threadCount < maxThreadCount; threadCount *= 2)
+	{
+		threadCounts.push_back(threadCount);
+	}
+	threadCounts.push_back(maxThreadCount);
+	return threadCounts;
+}
+
+static void MeasureThreadPool(std::vector<BENCHMARK_RESULT>& results)
+{
+	static const unsigned int taskCount = 10000;
+	static const unsigned int smallTaskIterations = 256;
+
+	printf("Thread pool throughput\n");
+	for(auto threadCount : GetThreadCounts())
+	{
+		Framework::CThreadPool threadPool(threadCount);
+		std::atomic<unsigned int> doneCount(0);
+		std::atomic<uint32> sink(0);
+
+		//Tasks are enqueued from outside the pool, the calling thread helps while waiting
+		auto runTasks = [&](const auto& makeTask) {
+			doneCount = 0;
+			for(unsigned int i = 0; i < taskCount; i++)
+			{
+				threadPool.Enqueue(makeTask(i));
+			}
+			while(doneCount != taskCount)
+			{
+				if(!threadPool.RunPendingTask())
+				{
+					std::this_thread::yield();
+				}
+			}
+			return taskCount;
+		};
+
+		auto suffix = " (" + std::to_string(threadCount) + " threads)";
+		results.push_back(Measure("Thread pool empty tasks" + suffix,
+		    [&]() {
+			    return runTasks([&](unsigned int) { return [&]() { doneCount++; }; });
+		    }));
+		results.push_back(Measure("Thread pool small tasks" + suffix,
+		    [&]() {
+			    return runTasks([&](unsigned int index) {
+				    return [&, index]() {
+					    uint32 value = index;
+					    for(unsigned int i = 0; i < smallTaskIterations; i++)
+					    {
+						    value = (value * 1103515245) + 12345;
+					    }
+					    sink += value;
+					    doneCount++;
+				    };
+			    });
+		    }));
+	}
+}
+
+static void MeasureQueues(std::vector<BENCHMARK_RESULT>& results)
+{
+	static const unsigned int itemCount = 100000;
+	static const unsigned int queueSize = 1024;
+
+	printf("Lock-free queue throughput\n");
+	{
+		CLockFreeQueue<uint32> queue(queueSize);
+		results.push_back(Measure("SPSC queue",
+		    [&]() {
+			    std::thread producer(
+			        [&]() {
+				        for(uint32 i = 0; i < itemCount; i++)
+				        {
+					        while(!queue.TryPush(i))
+					        {
+						        std::this_thread::yield();
+					        }
+				        }
+			        });
+			    uint32 item = 0;
+			    for(uint32 i = 0; i < itemCount; i++)
+			    {
+				    while(!queue.TryPop(item))
+				    {
+					    std::this_thread::yield();
+				    }
+			    }
+			    producer.join();
+			    return itemCount;
+		    }));
+	}
+
+	for(auto threadCount : GetThreadCounts())
+	{
+		for(size_t batchSize : {1, 16})
+		{
+			CLockFreeMpmcQueue<uint32> queue(queueSize);
+			auto name = "MPMC queue (" + std::to_string(threadCount) + " producers/consumers, batch " + std::to_string(batchSize) + ")";
+			results.push_back(Measure(name,
+			    [&]() {
+				    unsigned int itemsPerProducer = itemCount / threadCount;
+				    std::atomic<unsigned int> poppedCount(0);
+				    std::vector<std::thread> threads;
+				    for(unsigned int t = 0; t < threadCount; t++)
+				    {
+					    threads.emplace_back(
+					        [&]() {
+						        std::vector<uint32> items(batchSize, 0);
+						        for(unsigned int i = 0; i < itemsPerProducer; i += static_cast<unsigned int>(batchSize))
+						        {
+							        size_t count = std::min<size_t>(batchSize, itemsPerProducer - i);
+							        size_t pushed = 0;
+							        while(pushed != count)
+							        {
+								        auto result = queue.TryPushBatch(items.data() + pushed, count - pushed);
+								        if(result == 0) std::this_thread::yield();
+								        pushed += result;
+							        }
+						        }
+					        });
+					    threads.emplace_back(
+					        [&]() {
+						        std::vector<uint32> items(batchSize);
+						        while(poppedCount < itemsPerProducer * threadCount)
+						        {
+							        auto result = queue.TryPopBatch(items.data(), batchSize);
+							        if(result == 0) std::this_thread::yield();
+							        poppedCount += static_cast<unsigned int>(result);
+						        }
+					        });
+				    }
+				    for(auto& thread : threads)
+				    {
+					    thread.join();
+				    }
+				    return itemsPerProducer * threadCount;
+			    }));
+		}
+	}
+}
+
+static void MeasureSignal(std::vector<BENCHMARK_RESULT>& results)
+{
+	static const unsigned int emitCount = 100000;
+
+	printf("Signal emission\n");
+	for(unsigned int slotCount : {0, 1, 4, 16, 64})
+	{
+		uint32 sum = 0;
+		Framework::CSignal<void (uint32)> signal;
+		std::vector<Framework::CSignal<void (uint32)>::Connection> connections;
+		for(unsigned int i = 0; i < slotCount; i++)
+		{
+			connections.push_back(signal.Connect([&sum](uint32 value) { sum += value; }));
+		}
+		results.push_back(Measure("Signal emit (" + std::to_string(slotCount) + " slots)",
+		    [&]() {
+			    for(uint32 i = 0; i < emitCount; i++)
+			    {
+				    signal(i);
+			    }
+			    return emitCount;
+		    }));
+	}
+}
+
+static void WriteJson(const char* path, const std::vector<BENCHMARK_RESULT>& results)
+{
+	FILE* output = fopen(path, "w");
+	if(!output)
+	{
+		printf("Failed to open '%s' for writing.\n", path);
+		return;
+	}
+	//Names don't contain characters that need escaping
+	fprintf(output, "{\n\t\"threadCount\": %u,\n\t\"results\": [\n", std::thread::hardware_concurrency());
+	for(size_t i = 0; i < results.size(); i++)
+	{
+		const auto& result = results[i];
+		fprintf(output, "\t\t{ \"name\": \"%s\", \"opsPerSecond\": %.1f, \"nanosecondsPerOp\": %.3f, \"allocationsPerOp\": %.4f }%s\n",
+		        result.name.c_str(), result.opsPerSecond, 1e9 / result.opsPerSecond, result.allocationsPerOp,
+		        (i + 1 != results.size()) ? "," : "");
+	}
+	fprintf(output, "\t]\n}\n");
+	fclose(output);
+}
+
+void ConcurrencyBenchmark_Execute(const char* jsonPath)
+{
+	std::vector<BENCHMARK_RESULT> results;
+	MeasureThreadPool(results);
+	MeasureQueues(results);
+	MeasureSignal(results);
+
+	if(jsonPath)
+	{
+		WriteJson(jsonPath, results);
+	}
+}
@@ -0,0 +1,3 @@
+#pragma once
+
+void ConcurrencyBenchmark_Execute(const char* jsonPath);
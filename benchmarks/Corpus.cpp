@@ -0,0 +1,202 @@
+#include <algorithm>
+#include <memory>
+#include "Corpus.h"
+#include "MemStream.h"
+#include "string_format.h"
+#include "zip/ZipArchiveWriter.h"
+
+namespace
+{
+	class CCorpusRandom
+	{
+	public:
+		uint32 Next()
+		{
+			m_seed = (m_seed * 1103515245) + 12345;
+			return m_seed >> 16;
+		}
+
+		template <typename ValueType, size_t count>
+		const ValueType& Pick(const ValueType (&values)[count])
+		{
+			return values[Next() % count];
+		}
+
+	private:
+		uint32 m_seed = 1;
+	};
+
+	class CBufferZipFile : public Framework::CZipFile
+	{
+	public:
+		CBufferZipFile(const char* name, std::vector<uint8> contents)
+		    : CZipFile(name)
+		    , m_contents(std::move(contents))
+		{
+		}
+
+		void Write(Framework::CStream& stream) override
+		{
+			stream.Write(m_contents.data(), m_contents.size());
+		}
+
+	private:
+		std::vector<uint8> m_contents;
+	};
+
+	const char* g_words[] =
+	{
+		"the", "of", "and", "to", "in", "is", "that", "for", "it", "as", "was", "with", "be", "by", "on", "not",
+		"framework", "stream", "buffer", "compression", "archive", "thread", "block", "window", "entry", "index",
+	};
+}
+
+Framework::CBitmap Corpus_MakeImage(unsigned int width, unsigned int height, unsigned int bpp)
+{
+	Framework::CBitmap bitmap(width, height, bpp);
+	uint32_t seed = 1;
+	for(unsigned int y = 0; y < height; y++)
+	{
+		for(unsigned int x = 0; x < width; x++)
+		{
+			seed = (seed * 1103515245) + 12345;
+			int noise = static_cast<int>((seed >> 16) & 0x0F) - 8;
+			auto sample = [&](unsigned int value) { return static_cast<uint8>(std::min(std::max(static_cast<int>(value) + noise, 0), 255)); };
+			bitmap.SetPixel(x, y, Framework::CColor(sample(x * 255 / width), sample(y * 255 / height), sample((x + y) * 127 / (width + height)), sample(255 - (x * 64 / width))));
+		}
+	}
+	return bitmap;
+}
+
+std::string Corpus_MakeText(size_t size)
+{
+	CCorpusRandom random;
+	std::string result;
+	result.reserve(size + 16);
+	while(result.size() < size)
+	{
+		result += random.Pick(g_words);
+		result += ((random.Next() % 12) == 0) ? ".\n" : " ";
+	}
+	result.resize(size);
+	return result;
+}
+
+std::string Corpus_MakeXml(unsigned int recordCount)
+{
+	static const char* categories[] = { "books", "music", "video", "games", "tools" };
+	CCorpusRandom random;
+	std::string result = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<!-- Generated catalog -->\n<Catalog version=\"2\">\n";
+	for(unsigned int i = 0; i < recordCount; i++)
+	{
+		result += string_format("\t<Item Id=\"%u\" Category=\"%s\" Price=\"%u.%02u\" InStock=\"%s\">\n",
+		                        i, random.Pick(categories), random.Next() % 500, random.Next() % 100, (random.Next() % 4) ? "true" : "false");
+		result += string_format("\t\t<Name>%s %s &amp; %s</Name>\n", random.Pick(g_words), random.Pick(g_words), random.Pick(g_words));
+		result += "\t\t<Description>";
+		for(unsigned int word = 0; word < 12; word++)
+		{
+			result += random.Pick(g_words);
+			result += ' ';
+		}
+		result += "&lt;end&gt;</Description>\n";
+		result += string_format("\t\t<Tags><Tag>%s</Tag><Tag>%s</Tag></Tags>\n", random.Pick(g_words), random.Pick(categories));
+		result += "\t</Item>\n";
+	}
+	result += "</Catalog>\n";
+	return result;
+}
+
+std::string Corpus_MakeCsv(unsigned int rowCount)
+{
+	CCorpusRandom random;
+	std::string result = "id,name,quantity,price,comment\n";
+	for(unsigned int i = 0; i < rowCount; i++)
+	{
+		result += string_format("%u,%s_%s,%u,%u.%02u,", i, random.Pick(g_words), random.Pick(g_words), random.Next() % 1000, random.Next() % 5000, random.Next() % 100);
+		if((random.Next() % 4) == 0)
+		{
+			//Needs quoting: separators and escaped quotes
+			result += string_format("\"%s, \"\"%s\"\" %s\"", random.Pick(g_words), random.Pick(g_words), random.Pick(g_words));
+		}
+		else
+		{
+			result += random.Pick(g_words);
+		}
+		result += '\n';
+	}
+	return result;
+}
+
+std::vector<std::string> Corpus_MakeHttpTrace(unsigned int requestCount)
+{
+	static const char* paths[] =
+	{
+		"/", "/index.html", "/static/app.js", "/static/style.css", "/images/logo.png", "/api/items", "/api/items/42", "/metrics",
+	};
+	static const char* userAgents[] =
+	{
+		"Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/120.0 Safari/537.36",
+		"Mozilla/5.0 (X11; Linux x86_64; rv:121.0) Gecko/20100101 Firefox/121.0",
+		"curl/8.4.0",
+	};
+	CCorpusRandom random;
+	std::vector<std::string> requests;
+	requests.reserve(requestCount);
+	for(unsigned int i = 0; i < requestCount; i++)
+	{
+		bool isPost = (random.Next() % 8) == 0;
+		std::string body;
+		if(isPost)
+		{
+			body = string_format("{\"name\": \"%s\", \"quantity\": %u}", random.Pick(g_words), random.Next() % 100);
+		}
+		std::string request = string_format("%s %s?page=%u&sort=%s HTTP/1.1\r\n", isPost ? "POST" : "GET", random.Pick(paths), random.Next() % 20, random.Pick(g_words));
+		request += "Host: localhost:8080\r\n";
+		request += string_format("User-Agent: %s\r\n", random.Pick(userAgents));
+		request += "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8\r\n";
+		request += "Accept-Encoding: gzip, deflate, br\r\n";
+		request += "Accept-Language: en-US,en;q=0.5\r\n";
+		request += string_format("Cookie: session=%08x%08x; theme=dark\r\n", random.Next(), random.Next());
+		request += "Connection: keep-alive\r\n";
+		if(isPost)
+		{
+			request += "Content-Type: application/json\r\n";
+			request += string_format("Content-Length: %u\r\n", static_cast<unsigned int>(body.size()));
+		}
+		request += "\r\n";
+		request += body;
+		requests.push_back(std::move(request));
+	}
+	return requests;
+}
+
+std::vector<uint8> Corpus_MakeZip(unsigned int entryCount, size_t entrySize)
+{
+	static const char* directories[] = { "data", "data/textures", "data/scripts", "config" };
+	CCorpusRandom random;
+	Framework::CZipArchiveWriter writer;
+	auto text = Corpus_MakeText(entrySize * 4);
+	for(unsigned int i = 0; i < entryCount; i++)
+	{
+		std::vector<uint8> contents(entrySize);
+		bool isText = (i % 2) == 0;
+		if(isText)
+		{
+			size_t offset = random.Next() % (text.size() - entrySize);
+			std::copy(text.begin() + offset, text.begin() + offset + entrySize, contents.begin());
+		}
+		else
+		{
+			//Records with slowly changing fields
+			for(size_t offset = 0; offset < entrySize; offset++)
+			{
+				contents[offset] = static_cast<uint8>(((offset / 64) & 0x0F) | ((random.Next() & 0x03) << 4));
+			}
+		}
+		auto name = string_format("%s/%04u.%s", directories[i % 4], i, isText ? "txt" : "bin");
+		writer.InsertFile(std::make_unique<CBufferZipFile>(name.c_str(), std::move(contents)));
+	}
+	Framework::CMemStream stream;
+	writer.Write(stream);
+	return std::vector<uint8>(stream.GetBuffer(), stream.GetBuffer() + stream.GetSize());
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "Types.h"
+#include "bitmap/Bitmap.h"
+
+//Deterministic inputs shared by the benchmarks. Everything is generated from fixed seeds,
+//so runs on different machines or revisions measure the same data.
+
+//Smooth gradients with some noise, which is closer to photos than flat colors
+Framework::CBitmap Corpus_MakeImage(unsigned int width, unsigned int height, unsigned int bpp);
+
+//English like words with punctuation and new lines
+std::string Corpus_MakeText(size_t size);
+
+//Catalog of records with attributes, escaped text and nested elements
+std::string Corpus_MakeXml(unsigned int recordCount);
+
+//Rows with integer, decimal and text fields, some of them quoted
+std::string Corpus_MakeCsv(unsigned int rowCount);
+
+//Request heads (and bodies for POSTs) as a server would receive them from browsers and API clients
+std::vector<std::string> Corpus_MakeHttpTrace(unsigned int requestCount);
+
+//Archive with text and binary entries spread in a few directories
+std::vector<uint8> Corpus_MakeZip(unsigned int entryCount, size_t entrySize);
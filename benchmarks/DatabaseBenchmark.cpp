@@ -0,0 +1,218 @@
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "DatabaseBenchmark.h"
+#include "BenchmarkDefs.h"
+#include "BenchmarkReport.h"
+#include "filesystem_def.h"
+#include "QueryStats.h"
+#include "sqlite/SqliteBulkWriter.h"
+#include "sqlite/SqliteConnectionPool.h"
+#include "sqlite/SqliteDb.h"
+
+//MySQL and ODBC need a server or a data source to run against and are not measured here
+
+static const double g_minDuration = 0.25;
+static const unsigned int g_tableRowCount = 100000;
+static const unsigned int g_readerThreadCount = 4;
+
+static const char* g_createTableQuery = "CREATE TABLE IF NOT EXISTS items (id INTEGER PRIMARY KEY, name TEXT, value REAL)";
+static const char* g_insertQuery = "INSERT INTO items (name, value) VALUES (?, ?)";
+static const char* g_selectQuery = "SELECT name, value FROM items WHERE id = ?";
+
+static void Report(const char* name, double itemsPerSecond)
+{
+	printf("  %s: %.0f rows/s, %.1f us/row\n", name, itemsPerSecond, 1e6 / itemsPerSecond);
+	BenchmarkReport_Add("Database", name, itemsPerSecond, "rows/s");
+}
+
+static void Execute(sqlite3* db, const char* query)
+{
+	Framework::CSqliteStatement statement(db, query);
+	statement.StepNoResult();
+}
+
+static void MeasureInserts(const fs::path& dbPath)
+{
+	static const unsigned int rowsPerBatch = 1000;
+
+	printf("Sqlite inserts\n");
+	Framework::CSqliteDb db(dbPath.string().c_str(), SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, nullptr,
+	                        Framework::CSqliteDb::OPTION_WAL | Framework::CSqliteDb::OPTION_SYNCHRONOUS_NORMAL);
+	Execute(db, g_createTableQuery);
+
+	//Worst case, each row prepares its statement and commits
+	Report("Autocommit, prepared per row", MeasureThroughput([&]() {
+		for(unsigned int i = 0; i < 100; i++)
+		{
+			Framework::CSqliteStatement statement(db, g_insertQuery);
+			statement.BindText(1, "item");
+			statement.BindDouble(2, i);
+			statement.StepNoResult();
+		}
+		return 100;
+	}, g_minDuration));
+
+	Report("Transaction, prepared per row", MeasureThroughput([&]() {
+		Execute(db, "BEGIN");
+		for(unsigned int i = 0; i < rowsPerBatch; i++)
+		{
+			Framework::CSqliteStatement statement(db, g_insertQuery);
+			statement.BindText(1, "item");
+			statement.BindDouble(2, i);
+			statement.StepNoResult();
+		}
+		Execute(db, "COMMIT");
+		return rowsPerBatch;
+	}, g_minDuration));
+
+	Report("Transaction, cached statement", MeasureThroughput([&]() {
+		Execute(db, "BEGIN");
+		for(unsigned int i = 0; i < rowsPerBatch; i++)
+		{
+			auto statement = db.GetCachedStatement(g_insertQuery);
+			statement->BindText(1, "item");
+			statement->BindDouble(2, i);
+			statement->StepNoResult();
+		}
+		Execute(db, "COMMIT");
+		return rowsPerBatch;
+	}, g_minDuration));
+
+	Report("Bulk writer", MeasureThroughput([&]() {
+		Framework::CSqliteBulkWriter writer(db, "items", {"name", "value"});
+		for(unsigned int i = 0; i < rowsPerBatch; i++)
+		{
+			writer.AddRow("item", static_cast<double>(i));
+		}
+		writer.Flush();
+		return rowsPerBatch;
+	}, g_minDuration));
+}
+
+static void FillTable(const fs::path& dbPath)
+{
+	Framework::CSqliteDb db(dbPath.string().c_str(), SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, nullptr,
+	                        Framework::CSqliteDb::OPTION_WAL | Framework::CSqliteDb::OPTION_SYNCHRONOUS_NORMAL);
+	Execute(db, "DROP TABLE IF EXISTS items");
+	Execute(db, g_createTableQuery);
+	Framework::CSqliteBulkWriter writer(db, "items", {"id", "name", "value"});
+	for(unsigned int i = 0; i < g_tableRowCount; i++)
+	{
+		writer.AddRow(i + 1, "item" + std::to_string(i), static_cast<double>(i));
+	}
+	writer.Flush();
+}
+
+template <typename StatementGetterType>
+static unsigned int SelectRows(std::mt19937& random, const StatementGetterType& getStatement)
+{
+	static const unsigned int lookupCount = 1000;
+	std::uniform_int_distribution<unsigned int> idDistribution(1, g_tableRowCount);
+	double sum = 0;
+	for(unsigned int i = 0; i < lookupCount; i++)
+	{
+		auto statement = getStatement();
+		(*statement).BindInteger(1, idDistribution(random));
+		(*statement).StepWithResult();
+		sum += (*statement).GetColumnDouble(1);
+	}
+	return (sum >= 0) ? lookupCount : 0;
+}
+
+static void MeasureSelects(const fs::path& dbPath)
+{
+	printf("Sqlite point selects\n");
+	Framework::CSqliteDb db(dbPath.string().c_str(), SQLITE_OPEN_READONLY);
+	std::mt19937 random(1234);
+
+	Report("Prepared per query", MeasureThroughput([&]() {
+		return SelectRows(random, [&]() { return std::make_unique<Framework::CSqliteStatement>(db, g_selectQuery); });
+	}, g_minDuration));
+
+	auto measureCached = [&]() {
+		return MeasureThroughput([&]() {
+			return SelectRows(random, [&]() { return db.GetCachedStatement(g_selectQuery); });
+		}, g_minDuration);
+	};
+
+	Report("Cached statement", measureCached());
+
+	auto& queryStats = Framework::CQueryStatsRegistry::GetInstance();
+	queryStats.SetEnabled(true);
+	Report("Cached statement, instrumented", measureCached());
+	queryStats.SetEnabled(false);
+	auto stats = queryStats.GetStats(g_selectQuery);
+	printf("  Instrumented steps: %llu, average %.2f us, max %llu us\n",
+	       static_cast<unsigned long long>(stats->calls.load()),
+	       static_cast<double>(stats->totalMicroseconds.load()) / static_cast<double>(std::max<uint64>(stats->calls.load(), 1)),
+	       static_cast<unsigned long long>(stats->maxMicroseconds.load()));
+	queryStats.Reset();
+}
+
+static void MeasureConcurrentSelects(const fs::path& dbPath)
+{
+	printf("Sqlite point selects (%u threads)\n", g_readerThreadCount);
+
+	auto runThreads = [](const auto& threadFunction) {
+		std::vector<std::thread> threads;
+		std::vector<unsigned int> rowCounts(g_readerThreadCount, 0);
+		for(unsigned int i = 0; i < g_readerThreadCount; i++)
+		{
+			threads.emplace_back([&, i]() { rowCounts[i] = threadFunction(i); });
+		}
+		unsigned int rowCount = 0;
+		for(unsigned int i = 0; i < g_readerThreadCount; i++)
+		{
+			threads[i].join();
+			rowCount += rowCounts[i];
+		}
+		return rowCount;
+	};
+
+	{
+		//All threads share one connection
+		Framework::CSqliteDb db(dbPath.string().c_str(), SQLITE_OPEN_READONLY | SQLITE_OPEN_FULLMUTEX);
+		std::mutex dbMutex;
+		Report("Shared connection", MeasureThroughput([&]() {
+			return runThreads([&](unsigned int threadIndex) {
+				std::mt19937 random(threadIndex);
+				std::lock_guard<std::mutex> lock(dbMutex);
+				return SelectRows(random, [&]() { return db.GetCachedStatement(g_selectQuery); });
+			});
+		}, g_minDuration));
+	}
+
+	{
+		Framework::CSqliteConnectionPool pool(dbPath.string().c_str(), g_readerThreadCount);
+		Report("Connection pool", MeasureThroughput([&]() {
+			return runThreads([&](unsigned int threadIndex) {
+				std::mt19937 random(threadIndex);
+				auto connection = pool.AcquireReader();
+				return SelectRows(random, [&]() { return connection->GetCachedStatement(g_selectQuery); });
+			});
+		}, g_minDuration));
+	}
+}
+
+void DatabaseBenchmark_Execute()
+{
+	auto dbPath = fs::temp_directory_path() / "FrameworkDatabaseBenchmark.db";
+	auto removeDb = [&]() {
+		std::error_code errorCode;
+		fs::remove(dbPath, errorCode);
+		fs::remove(dbPath.string() + "-wal", errorCode);
+		fs::remove(dbPath.string() + "-shm", errorCode);
+	};
+	removeDb();
+	MeasureInserts(dbPath);
+	FillTable(dbPath);
+	MeasureSelects(dbPath);
+	MeasureConcurrentSelects(dbPath);
+	removeDb();
+}
@@ -0,0 +1,96 @@
+#include <cstdio>
+#include <vector>
+#include "IdctBenchmark.h"
+#include "BenchmarkDefs.h"
+#include "BenchmarkReport.h"
+#include "idct/IEEE1180.h"
+#include "idct/TrivialC.h"
+#include "idct/FixedPoint.h"
+
+struct IDCT_IMPLEMENTATION
+{
+	const char* name;
+	IDCT::CInterface* idct;
+};
+
+struct INPUT_RANGE
+{
+	int lowerBound;
+	int upperBound;
+};
+
+static const INPUT_RANGE g_inputRanges[] =
+{
+	{ 256, 255 },
+	{ 5, 5 },
+	{ 300, 300 },
+};
+
+static std::vector<int16> GenerateBlocks(unsigned int blockCount)
+{
+	//Same kind of input as the IEEE-1180 procedure: random pixels in [-256, 255] through the forward DCT
+	auto reference = static_cast<IDCT::CIEEE1180*>(IDCT::CIEEE1180::GetInstance());
+	std::vector<int16> blocks(blockCount * 64);
+	uint32 seed = 1;
+	for(unsigned int n = 0; n < blockCount; n++)
+	{
+		int16 pixels[64];
+		for(unsigned int i = 0; i < 64; i++)
+		{
+			seed = (seed * 1103515245) + 12345;
+			pixels[i] = static_cast<int16>(((seed >> 16) % 512) - 256);
+		}
+		reference->ForwardTransform(pixels, blocks.data() + (n * 64));
+	}
+	return blocks;
+}
+
+void IdctBenchmark_Execute()
+{
+	const IDCT_IMPLEMENTATION implementations[] =
+	{
+		{ "IEEE1180", IDCT::CIEEE1180::GetInstance() },
+		{ "TrivialC", IDCT::CTrivialC::GetInstance() },
+		{ "FixedPoint", IDCT::CFixedPoint::GetInstance() },
+	};
+
+	static const unsigned int blockCount = 4096;
+	auto input = GenerateBlocks(blockCount);
+	std::vector<int16> output(input.size());
+
+	printf("IDCT accuracy (IEEE-1180) and throughput\n");
+	for(const auto& implementation : implementations)
+	{
+		printf("%s:\n", implementation.name);
+		bool compliant = true;
+		for(const auto& range : g_inputRanges)
+		{
+			for(unsigned int negate = 0; negate < 2; negate++)
+			{
+				auto stats = IDCT::CIEEE1180::MeasureAccuracy(implementation.idct, range.lowerBound, range.upperBound, negate != 0);
+				compliant &= stats.IsCompliant();
+				printf("  [%s%d, %d]: peak error: %d, peak mse: %.4f, overall mse: %.4f, peak mean error: %.4f, overall mean error: %.5f\n",
+				       negate ? "-" : "", range.lowerBound, range.upperBound,
+				       stats.peakError, stats.peakMse, stats.overallMse, stats.peakMeanError, stats.overallMeanError);
+			}
+		}
+		printf("  IEEE-1180 compliant: %s\n", compliant ? "yes" : "no");
+
+		double singleRate = MeasureThroughput(
+		    [&]() {
+			    for(unsigned int i = 0; i < blockCount; i++)
+			    {
+				    implementation.idct->Transform(input.data() + (i * 64), output.data() + (i * 64));
+			    }
+			    return blockCount;
+		    });
+		double batchRate = MeasureThroughput(
+		    [&]() {
+			    implementation.idct->TransformBlocks(input.data(), output.data(), blockCount);
+			    return blockCount;
+		    });
+		printf("  Transform: %.0f blocks/s, TransformBlocks: %.0f blocks/s\n", singleRate, batchRate);
+		BenchmarkReport_Add("IDCT", std::string(implementation.name) + " Transform", singleRate, "blocks/s");
+		BenchmarkReport_Add("IDCT", std::string(implementation.name) + " TransformBlocks", batchRate, "blocks/s");
+	}
+}
@@ -0,0 +1,44 @@
+#include "BenchmarkReport.h"
+#include "BitmapBenchmark.h"
+#include "CompressionBenchmark.h"
+#include "ConcurrencyBenchmark.h"
+#include "DatabaseBenchmark.h"
+#include "IdctBenchmark.h"
+#include "MathBenchmark.h"
+#include "StreamBenchmark.h"
+#include "StringCastBenchmark.h"
+#include "StringFormatBenchmark.h"
+#include "StringUtilsBenchmark.h"
+#include "TextFormatBenchmark.h"
+#include "VlcBenchmark.h"
+
+int main(int argc, char** argv)
+{
+	//First argument is an optional path for the bitmap benchmark's JSON results,
+	//second one is an optional directory with files to use as the compression corpus,
+	//third one is an optional path for the concurrency benchmark's JSON results,
+	//fourth one is an optional path for the results of every benchmark (see compare_benchmarks.py).
+	//Empty arguments are skipped like missing ones.
+	auto getArgument = [&](int index) -> const char* { return ((argc > index) && argv[index][0]) ? argv[index] : nullptr; };
+	const char* bitmapJsonPath = getArgument(1);
+	const char* compressionCorpusPath = getArgument(2);
+	const char* concurrencyJsonPath = getArgument(3);
+	const char* reportJsonPath = getArgument(4);
+	BitmapBenchmark_Execute(bitmapJsonPath);
+	CompressionBenchmark_Execute(compressionCorpusPath);
+	ConcurrencyBenchmark_Execute(concurrencyJsonPath);
+	DatabaseBenchmark_Execute();
+	IdctBenchmark_Execute();
+	MathBenchmark_Execute();
+	StreamBenchmark_Execute();
+	StringCastBenchmark_Execute();
+	StringFormatBenchmark_Execute();
+	StringUtilsBenchmark_Execute();
+	TextFormatBenchmark_Execute();
+	VlcBenchmark_Execute();
+	if(reportJsonPath && !BenchmarkReport_WriteJson(reportJsonPath))
+	{
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,211 @@
+#include <cstdio>
+#include <vector>
+#include "MathBenchmark.h"
+#include "BenchmarkDefs.h"
+#include "BenchmarkReport.h"
+#include "math/BatchMath.h"
+#include "math/MathOps.h"
+#include "ThreadPool.h"
+
+//Skinning like workload: a set of bone matrices, and vertices transformed by them
+static const unsigned int g_matrixCount = 256;
+static const unsigned int g_vectorCount = 65536;
+
+void MathBenchmark_Execute()
+{
+	std::vector<CMatrix4> matrices(g_matrixCount);
+	for(unsigned int i = 0; i < g_matrixCount; i++)
+	{
+		float angle = static_cast<float>(i) * 0.1f;
+		matrices[i] = CMatrix4::MakeAxisYRotation(angle) * CMatrix4::MakeScale(1.0f + angle, 2.0f, 0.5f) * CMatrix4::MakeTranslation(angle, -angle, 1.0f);
+	}
+	std::vector<CVector4> vectors(g_vectorCount);
+	for(unsigned int i = 0; i < g_vectorCount; i++)
+	{
+		vectors[i] = CVector4(static_cast<float>(i % 17), static_cast<float>(i % 31), static_cast<float>(i % 7), 1.0f);
+	}
+	std::vector<CMatrix4> matrixResults(g_matrixCount);
+	std::vector<CVector4> vectorResults(g_vectorCount);
+
+	printf("Math throughput\n");
+
+	double rate = MeasureThroughput(
+	    [&]() {
+		    for(unsigned int i = 0; i < g_matrixCount; i++)
+		    {
+			    matrixResults[i] = matrices[i] * matrices[(i + 1) % g_matrixCount];
+		    }
+		    return g_matrixCount;
+	    });
+	printf("  CMatrix4::operator*: %.1f M/s\n", rate / 1000000.0);
+	BenchmarkReport_Add("Math", "CMatrix4::operator*", rate, "ops/s");
+
+	rate = MeasureThroughput(
+	    [&]() {
+		    for(unsigned int i = 0; i < g_matrixCount; i++)
+		    {
+			    matrixResults[i] = matrices[i].Inverse();
+		    }
+		    return g_matrixCount;
+	    });
+	printf("  CMatrix4::Inverse: %.1f M/s\n", rate / 1000000.0);
+	BenchmarkReport_Add("Math", "CMatrix4::Inverse", rate, "ops/s");
+
+	rate = MeasureThroughput(
+	    [&]() {
+		    for(unsigned int i = 0; i < g_matrixCount; i++)
+		    {
+			    matrixResults[i] = matrices[i].Transpose();
+		    }
+		    return g_matrixCount;
+	    });
+	printf("  CMatrix4::Transpose: %.1f M/s\n", rate / 1000000.0);
+	BenchmarkReport_Add("Math", "CMatrix4::Transpose", rate, "ops/s");
+
+	rate = MeasureThroughput(
+	    [&]() {
+		    for(unsigned int i = 0; i < g_vectorCount; i++)
+		    {
+			    vectorResults[i] = matrices[i % g_matrixCount] * vectors[i];
+		    }
+		    return g_vectorCount;
+	    });
+	printf("  CMatrix4 * CVector4: %.1f M/s (%f)\n", rate / 1000000.0, vectorResults[g_vectorCount - 1].x + matrixResults[0](0, 0));
+	BenchmarkReport_Add("Math", "CMatrix4 * CVector4", rate, "ops/s");
+
+	CVector3Array points(g_vectorCount);
+	for(unsigned int i = 0; i < g_vectorCount; i++)
+	{
+		points.Set(i, vectors[i].xyz());
+	}
+	CVector3Array pointResults;
+	const auto& matrix = matrices[1];
+
+	rate = MeasureThroughput(
+	    [&]() {
+		    for(unsigned int i = 0; i < g_vectorCount; i++)
+		    {
+			    vectorResults[i] = matrix * vectors[i];
+		    }
+		    return g_vectorCount;
+	    });
+	printf("  Transform points, one at a time: %.1f M/s\n", rate / 1000000.0);
+	BenchmarkReport_Add("Math", "Transform points, one at a time", rate, "ops/s");
+
+	rate = MeasureThroughput(
+	    [&]() {
+		    BatchMath::TransformPoints(matrix, points, pointResults);
+		    return g_vectorCount;
+	    });
+	printf("  BatchMath::TransformPoints: %.1f M/s\n", rate / 1000000.0);
+	BenchmarkReport_Add("Math", "BatchMath::TransformPoints", rate, "ops/s");
+
+	CSphereArray spheres(g_vectorCount);
+	for(unsigned int i = 0; i < g_vectorCount; i++)
+	{
+		CSphere sphere;
+		sphere.position = points.Get(i);
+		sphere.radius = static_cast<float>(i % 5);
+		spheres.Set(i, sphere);
+	}
+	CPlane planes[6] =
+	{
+		CPlane(1, 0, 0, 2), CPlane(-1, 0, 0, -14),
+		CPlane(0, 1, 0, 4), CPlane(0, -1, 0, -20),
+		CPlane(0, 0, 1, 1), CPlane(0, 0, -1, -5),
+	};
+	std::vector<uint8> visibility;
+	size_t visibleCount = 0;
+	rate = MeasureThroughput(
+	    [&]() {
+		    visibleCount = BatchMath::CullSpheres(planes, 6, spheres, visibility);
+		    return g_vectorCount;
+	    });
+	printf("  BatchMath::CullSpheres: %.1f M/s (%zu visible)\n", rate / 1000000.0, visibleCount);
+	BenchmarkReport_Add("Math", "BatchMath::CullSpheres", rate, "ops/s");
+
+	{
+		CRay ray(CVector3(0, 0, 0), CVector3(0, 0, 1));
+		size_t hitCount = 0;
+		rate = MeasureThroughput(
+		    [&]() {
+			    hitCount = 0;
+			    for(unsigned int i = 0; i < g_vectorCount; i++)
+			    {
+				    hitCount += Intersects(spheres.Get(i), ray).first ? 1 : 0;
+			    }
+			    return g_vectorCount;
+		    });
+		printf("  Intersects(sphere, ray), one at a time: %.1f M/s (%zu hits)\n", rate / 1000000.0, hitCount);
+		BenchmarkReport_Add("Math", "Intersects(sphere, ray), one at a time", rate, "ops/s");
+
+		std::vector<float> distances;
+		rate = MeasureThroughput(
+		    [&]() {
+			    hitCount = BatchMath::IntersectSpheres(ray, spheres, distances);
+			    return g_vectorCount;
+		    });
+		printf("  BatchMath::IntersectSpheres: %.1f M/s (%zu hits)\n", rate / 1000000.0, hitCount);
+		BenchmarkReport_Add("Math", "BatchMath::IntersectSpheres", rate, "ops/s");
+	}
+
+	{
+		CQuaternionArray lhs(g_vectorCount);
+		CQuaternionArray rhs(g_vectorCount);
+		for(unsigned int i = 0; i < g_vectorCount; i++)
+		{
+			lhs.Set(i, CQuaternion(CVector3(0, 1, 0), static_cast<float>(i % 31) * 0.1f));
+			rhs.Set(i, CQuaternion(CVector3(1, 0, 0), static_cast<float>(i % 17) * 0.2f));
+		}
+		CQuaternionArray quaternionResults(g_vectorCount);
+		rate = MeasureThroughput(
+		    [&]() {
+			    for(unsigned int i = 0; i < g_vectorCount; i++)
+			    {
+				    quaternionResults.Set(i, Slerp(lhs.Get(i), rhs.Get(i), 0.3f));
+			    }
+			    return g_vectorCount;
+		    });
+		printf("  Slerp, one at a time: %.1f M/s\n", rate / 1000000.0);
+		BenchmarkReport_Add("Math", "Slerp, one at a time", rate, "ops/s");
+
+		rate = MeasureThroughput(
+		    [&]() {
+			    BatchMath::Slerp(lhs, rhs, 0.3f, quaternionResults);
+			    return g_vectorCount;
+		    });
+		printf("  BatchMath::Slerp: %.1f M/s\n", rate / 1000000.0);
+		BenchmarkReport_Add("Math", "BatchMath::Slerp", rate, "ops/s");
+
+		std::vector<CMatrix4> quaternionMatrices;
+		rate = MeasureThroughput(
+		    [&]() {
+			    BatchMath::ToMatrices(quaternionResults, quaternionMatrices);
+			    return g_vectorCount;
+		    });
+		printf("  BatchMath::ToMatrices: %.1f M/s\n", rate / 1000000.0);
+		BenchmarkReport_Add("Math", "BatchMath::ToMatrices", rate, "ops/s");
+	}
+
+	{
+		//Large batch split across threads
+		static const unsigned int largeCount = 4 * 1024 * 1024;
+		Framework::CThreadPool threadPool(std::thread::hardware_concurrency());
+		CVector3Array largePoints(largeCount);
+		CVector3Array largeResults;
+		rate = MeasureThroughput(
+		    [&]() {
+			    BatchMath::TransformPoints(matrix, largePoints, largeResults);
+			    return largeCount;
+		    });
+		printf("  BatchMath::TransformPoints (4M points): %.1f M/s\n", rate / 1000000.0);
+		BenchmarkReport_Add("Math", "BatchMath::TransformPoints (4M points)", rate, "ops/s");
+		rate = MeasureThroughput(
+		    [&]() {
+			    BatchMath::TransformPoints(matrix, largePoints, largeResults, &threadPool);
+			    return largeCount;
+		    });
+		printf("  BatchMath::TransformPoints (4M points, %u threads): %.1f M/s\n", threadPool.GetThreadCount(), rate / 1000000.0);
+		BenchmarkReport_Add("Math", "BatchMath::TransformPoints (4M points, thread pool)", rate, "ops/s");
+	}
+}
@@ -0,0 +1,105 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include "MemoryStats.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+//Allocations are prefixed with their size, the header keeps the default new alignment
+static const size_t g_headerSize = alignof(std::max_align_t);
+
+static std::atomic<uint64_t> g_allocationCount(0);
+static std::atomic<size_t> g_currentSize(0);
+static std::atomic<size_t> g_baseSize(0);
+static std::atomic<size_t> g_peakSize(0);
+
+static void* TrackedAllocate(size_t size)
+{
+	auto block = reinterpret_cast<uint8_t*>(malloc(size + g_headerSize));
+	if(!block) throw std::bad_alloc();
+	*reinterpret_cast<size_t*>(block) = size;
+	g_allocationCount++;
+	size_t currentSize = (g_currentSize += size);
+	size_t peakSize = g_peakSize;
+	while((currentSize > peakSize) && !g_peakSize.compare_exchange_weak(peakSize, currentSize))
+	{
+	}
+	return block + g_headerSize;
+}
+
+static void TrackedRelease(void* ptr)
+{
+	if(!ptr) return;
+	auto block = reinterpret_cast<uint8_t*>(ptr) - g_headerSize;
+	g_currentSize -= *reinterpret_cast<size_t*>(block);
+	free(block);
+}
+
+void* operator new(size_t size)
+{
+	return TrackedAllocate(size);
+}
+
+void* operator new[](size_t size)
+{
+	return TrackedAllocate(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+	TrackedRelease(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+	TrackedRelease(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+	TrackedRelease(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept
+{
+	TrackedRelease(ptr);
+}
+
+void ResetAllocationStats()
+{
+	g_allocationCount = 0;
+	g_baseSize = g_currentSize.load();
+	g_peakSize = g_currentSize.load();
+}
+
+ALLOCATION_STATS GetAllocationStats()
+{
+	ALLOCATION_STATS stats;
+	stats.allocationCount = g_allocationCount;
+	stats.peakSize = g_peakSize - std::min<size_t>(g_baseSize, g_peakSize);
+	return stats;
+}
+
+size_t GetPeakResidentSize()
+{
+#if defined(_WIN32)
+	PROCESS_MEMORY_COUNTERS counters = {};
+	if(!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return 0;
+	return counters.PeakWorkingSetSize;
+#else
+	struct rusage usage = {};
+	if(getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#if defined(__APPLE__)
+	return usage.ru_maxrss;
+#else
+	//Reported in kilobytes everywhere else
+	return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+//Global operator new/delete are replaced in the benchmark executable to count allocations.
+//Memory obtained with malloc or aligned operator new isn't tracked.
+struct ALLOCATION_STATS
+{
+	uint64_t allocationCount = 0;
+	size_t peakSize = 0;
+};
+
+//Counts from zero and measures the peak relative to the memory in use at that point
+void ResetAllocationStats();
+ALLOCATION_STATS GetAllocationStats();
+
+//Peak resident set size of the process in bytes, 0 if unavailable
+size_t GetPeakResidentSize();
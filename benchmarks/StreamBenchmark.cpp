@@ -0,0 +1,130 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <thread>
+#include <vector>
+#include "StreamBenchmark.h"
+#include "BenchmarkDefs.h"
+#include "BenchmarkReport.h"
+#include "Corpus.h"
+#include "BufferedStream.h"
+#include "MemStream.h"
+#include "PtrStream.h"
+#include "ThreadPool.h"
+#include "zip/ZipArchiveReader.h"
+
+static const size_t g_streamSize = 0x1000000;
+static const size_t g_chunkSize = 64;
+//Keeps the compiler from discarding reads that aren't used otherwise
+static volatile uint32 g_sink = 0;
+
+static void Report(const char* name, double bytesPerSecond)
+{
+	printf("  %s: %.1f MB/s\n", name, bytesPerSecond / (1024.0 * 1024.0));
+	BenchmarkReport_Add("Streams", name, bytesPerSecond / (1024.0 * 1024.0), "MB/s");
+}
+
+void StreamBenchmark_Execute()
+{
+	std::vector<uint8> data(g_streamSize);
+	for(size_t i = 0; i < data.size(); i++)
+	{
+		data[i] = static_cast<uint8>(i * 2654435761U >> 24);
+	}
+
+	printf("Stream throughput (%u byte accesses)\n", static_cast<unsigned int>(g_chunkSize));
+	{
+		double rate = MeasureThroughput(
+		    [&]() {
+			    Framework::CMemStream stream;
+			    for(size_t offset = 0; offset < data.size(); offset += g_chunkSize)
+			    {
+				    stream.Write(data.data() + offset, g_chunkSize);
+			    }
+			    return stream.GetSize();
+		    });
+		Report("CMemStream::Write", rate);
+	}
+	{
+		uint8 chunk[g_chunkSize];
+		double rate = MeasureThroughput(
+		    [&]() {
+			    Framework::CPtrStream stream(data.data(), data.size());
+			    uint64 readSize = 0;
+			    while(uint64 chunkReadSize = stream.Read(chunk, g_chunkSize))
+			    {
+				    readSize += chunkReadSize;
+			    }
+			    return readSize;
+		    });
+		Report("CPtrStream::Read", rate);
+	}
+	{
+		double rate = MeasureThroughput(
+		    [&]() {
+			    Framework::CPtrStream stream(data.data(), data.size());
+			    Framework::CBufferedStream bufferedStream(stream);
+			    uint32 checksum = 0;
+			    for(size_t i = 0; i < data.size() / sizeof(uint32); i++)
+			    {
+				    checksum ^= bufferedStream.Read32();
+			    }
+			    g_sink = checksum;
+			    return data.size();
+		    });
+		Report("CBufferedStream::Read32", rate);
+	}
+	{
+		auto text = Corpus_MakeText(g_streamSize);
+		double rate = MeasureThroughput(
+		    [&]() {
+			    Framework::CPtrStream stream(text.data(), text.size());
+			    Framework::CBufferedStream bufferedStream(stream);
+			    size_t lineCount = 0;
+			    while(!bufferedStream.IsEOF())
+			    {
+				    bufferedStream.ReadLine();
+				    lineCount++;
+			    }
+			    g_sink = static_cast<uint32>(lineCount);
+			    return text.size();
+		    });
+		Report("CBufferedStream::ReadLine", rate);
+	}
+
+	static const unsigned int entryCount = 256;
+	static const size_t entrySize = 0x10000;
+	auto archive = Corpus_MakeZip(entryCount, entrySize);
+	printf("Zip archive reading (%u entries, %.2f MB compressed)\n", entryCount, archive.size() / (1024.0 * 1024.0));
+	{
+		std::vector<uint8> entryData(entrySize);
+		double rate = MeasureThroughput(
+		    [&]() {
+			    Framework::CPtrStream stream(archive.data(), archive.size());
+			    Framework::CZipArchiveReader reader(stream);
+			    size_t readSize = 0;
+			    for(const auto& fileHeader : reader.GetFileHeaders())
+			    {
+				    auto fileStream = reader.BeginReadFile(fileHeader.first.c_str());
+				    readSize += static_cast<size_t>(fileStream->Read(entryData.data(), entryData.size()));
+			    }
+			    return readSize;
+		    });
+		Report("CZipArchiveReader::BeginReadFile", rate);
+	}
+	{
+		Framework::CThreadPool threadPool(std::max(1U, std::thread::hardware_concurrency()));
+		for(auto threadPoolPtr : { static_cast<Framework::CThreadPool*>(nullptr), &threadPool })
+		{
+			double rate = MeasureThroughput(
+			    [&]() {
+				    Framework::CPtrStream stream(archive.data(), archive.size());
+				    Framework::CZipArchiveReader reader(stream);
+				    std::atomic<size_t> readSize(0);
+				    reader.ExtractAll([&](const std::string&, const uint8*, size_t size) { readSize += size; }, true, threadPoolPtr);
+				    return readSize.load();
+			    });
+			Report(threadPoolPtr ? "CZipArchiveReader::ExtractAll (thread pool)" : "CZipArchiveReader::ExtractAll", rate);
+		}
+	}
+}
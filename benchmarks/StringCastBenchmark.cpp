@@ -0,0 +1,67 @@
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include "StringCastBenchmark.h"
+#include "BenchmarkDefs.h"
+#include "BenchmarkReport.h"
+#include "string_cast.h"
+#include "string_cast_sjis.h"
+#include "string_cast_win1252.h"
+#include "Utf8.h"
+
+struct STRING_CAST_CORPUS
+{
+	const char* name;
+	const char* line;
+	std::wstring (*convert)(const std::string&);
+};
+
+//Script like lines with markup, kanji, kana and half width katakana
+static const char* g_sjisLine = "<msg id=\"42\">\x82\xB1\x82\xEA\x82\xCD\x93\xFA\x96\x7B\x8C\xEA\x82\xCC\x83\x65\x83\x4C\x83\x58\x83\x67\x82\xC5\x82\xB7\x81\x42\xB1\xB2\xB3</msg>\n";
+static const char* g_win1252Line = "Cette phrase est \xE9" "crite en fran\xE7" "ais \x96 \x93" "d\xE9" "j\xE0 vu\x94 \x80 12.\n";
+static const char* g_utf8Line = "<msg id=\"42\">\xE3\x81\x93\xE3\x82\x8C\xE3\x81\xAF\xE6\x97\xA5\xE6\x9C\xAC\xE8\xAA\x9E</msg>\n";
+static const char* g_asciiLine = "The quick brown fox jumps over the lazy dog, 0123456789.\n";
+
+static std::wstring ConvertUtf8(const std::string& input)
+{
+	return Framework::Utf8::ConvertFrom(input);
+}
+
+static std::wstring ConvertNative(const std::string& input)
+{
+	return string_cast<std::wstring>(input);
+}
+
+void StringCastBenchmark_Execute()
+{
+	const STRING_CAST_CORPUS corpora[] =
+	{
+		{ "SJIS", g_sjisLine, &string_cast_sjis },
+		{ "SJIS (ASCII)", g_asciiLine, &string_cast_sjis },
+		{ "Win1252", g_win1252Line, &string_cast_win1252 },
+		{ "Win1252 (ASCII)", g_asciiLine, &string_cast_win1252 },
+		{ "UTF-8", g_utf8Line, &ConvertUtf8 },
+		{ "string_cast (ASCII)", g_asciiLine, &ConvertNative },
+	};
+
+	static const size_t corpusSize = 0x400000;
+
+	printf("String conversion throughput\n");
+	for(const auto& corpus : corpora)
+	{
+		std::string input;
+		input.reserve(corpusSize + strlen(corpus.line));
+		while(input.size() < corpusSize)
+		{
+			input += corpus.line;
+		}
+		size_t outputSize = 0;
+		double rate = MeasureThroughput(
+		    [&]() {
+			    outputSize = corpus.convert(input).size();
+			    return input.size();
+		    });
+		printf("  %s: %.1f MB/s, %zu bytes to %zu characters\n", corpus.name, rate / 1000000.0, input.size(), outputSize);
+		BenchmarkReport_Add("String conversion", corpus.name, rate / 1000000.0, "MB/s");
+	}
+}
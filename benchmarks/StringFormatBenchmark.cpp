@@ -0,0 +1,55 @@
+#include <cstdio>
+#include <string>
+#include "StringFormatBenchmark.h"
+#include "BenchmarkDefs.h"
+#include "BenchmarkReport.h"
+#include "string_format.h"
+
+//Log line like output: a timestamp, a level, a message with a few numbers and a hex address
+static const unsigned int g_lineCount = 10000;
+static const char* g_level = "INFO";
+static const char* g_module = "Http";
+
+void StringFormatBenchmark_Execute()
+{
+	printf("String formatting throughput\n");
+
+	double rate = MeasureThroughput(
+	    [&]() {
+		    size_t outputSize = 0;
+		    for(unsigned int i = 0; i < g_lineCount; i++)
+		    {
+			    auto line = string_format("[%08.3f] %-5s %s: request %u took %d us (0x%08X)\n", i * 0.001, g_level, g_module, i, i % 1000, i * 2654435761U);
+			    outputSize += line.size();
+		    }
+		    return outputSize ? g_lineCount : 0;
+	    });
+	printf("  string_format (printf): %.1f lines/s\n", rate);
+	BenchmarkReport_Add("String formatting", "string_format (printf)", rate, "lines/s");
+
+	rate = MeasureThroughput(
+	    [&]() {
+		    size_t outputSize = 0;
+		    for(unsigned int i = 0; i < g_lineCount; i++)
+		    {
+			    auto line = string_format(FORMAT_STRING("[{:08.3f}] {:<5} {}: request {} took {} us (0x{:08X})\n"), i * 0.001, g_level, g_module, i, i % 1000, i * 2654435761U);
+			    outputSize += line.size();
+		    }
+		    return outputSize ? g_lineCount : 0;
+	    });
+	printf("  string_format (compiled): %.1f lines/s\n", rate);
+	BenchmarkReport_Add("String formatting", "string_format (compiled)", rate, "lines/s");
+
+	rate = MeasureThroughput(
+	    [&]() {
+		    Framework::CFormatBuffer<> buffer;
+		    for(unsigned int i = 0; i < g_lineCount; i++)
+		    {
+			    buffer.Clear();
+			    string_format_to(buffer, FORMAT_STRING("[{:08.3f}] {:<5} {}: request {} took {} us (0x{:08X})\n"), i * 0.001, g_level, g_module, i, i % 1000, i * 2654435761U);
+		    }
+		    return buffer.GetSize() ? g_lineCount : 0;
+	    });
+	printf("  string_format_to (format buffer): %.1f lines/s\n", rate);
+	BenchmarkReport_Add("String formatting", "string_format_to (format buffer)", rate, "lines/s");
+}
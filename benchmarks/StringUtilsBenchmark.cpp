@@ -0,0 +1,134 @@
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "StringUtilsBenchmark.h"
+#include "BenchmarkDefs.h"
+#include "BenchmarkReport.h"
+#include "Corpus.h"
+#include "Base64.h"
+#include "StringUtils.h"
+#include "Url.h"
+#include "Utf8.h"
+
+static const unsigned int g_requestCount = 10000;
+
+static void Report(const char* name, double bytesPerSecond)
+{
+	printf("  %s: %.1f MB/s\n", name, bytesPerSecond / (1024.0 * 1024.0));
+	BenchmarkReport_Add("String utils", name, bytesPerSecond / (1024.0 * 1024.0), "MB/s");
+}
+
+void StringUtilsBenchmark_Execute()
+{
+	auto requests = Corpus_MakeHttpTrace(g_requestCount);
+	size_t traceSize = 0;
+	for(const auto& request : requests)
+	{
+		traceSize += request.size();
+	}
+
+	printf("String utilities on HTTP requests (%u requests, %.2f MB)\n", g_requestCount, traceSize / (1024.0 * 1024.0));
+	{
+		double rate = MeasureThroughput(
+		    [&]() {
+			    size_t headerCount = 0;
+			    for(const auto& request : requests)
+			    {
+				    for(const auto& line : StringUtils::Split(request, '\n', true))
+				    {
+					    headerCount += line.empty() ? 0 : 1;
+				    }
+			    }
+			    return headerCount ? traceSize : 0;
+		    });
+		Report("StringUtils::Split (trimmed)", rate);
+	}
+	{
+		double rate = MeasureThroughput(
+		    [&]() {
+			    size_t headerCount = 0;
+			    for(const auto& request : requests)
+			    {
+				    for(auto line : StringUtils::SplitView(request, '\n', true))
+				    {
+					    headerCount += line.empty() ? 0 : 1;
+				    }
+			    }
+			    return headerCount ? traceSize : 0;
+		    });
+		Report("StringUtils::SplitView (trimmed)", rate);
+	}
+	{
+		//Header names are case insensitive and usually normalized before lookups
+		double rate = MeasureThroughput(
+		    [&]() {
+			    size_t nameSize = 0;
+			    for(const auto& request : requests)
+			    {
+				    for(auto line : StringUtils::SplitView(request, '\n'))
+				    {
+					    auto separatorPos = line.find(':');
+					    if(separatorPos == std::string_view::npos) continue;
+					    std::string name(StringUtils::TrimView(line.substr(0, separatorPos)));
+					    StringUtils::ToLowerInPlace(name);
+					    nameSize += name.size();
+				    }
+			    }
+			    return nameSize ? traceSize : 0;
+		    });
+		Report("Header names (TrimView, ToLowerInPlace)", rate);
+	}
+	{
+		double rate = MeasureThroughput(
+		    [&]() {
+			    size_t encodedSize = 0;
+			    for(const auto& request : requests)
+			    {
+				    encodedSize += Framework::UrlEncode(request).size();
+			    }
+			    return encodedSize ? traceSize : 0;
+		    });
+		Report("UrlEncode", rate);
+	}
+	{
+		double rate = MeasureThroughput(
+		    [&]() {
+			    size_t encodedSize = 0;
+			    for(const auto& request : requests)
+			    {
+				    encodedSize += Framework::ToBase64(request).size();
+			    }
+			    return encodedSize ? traceSize : 0;
+		    });
+		Report("ToBase64", rate);
+	}
+	{
+		std::vector<std::string> encodedRequests;
+		for(const auto& request : requests)
+		{
+			encodedRequests.push_back(Framework::ToBase64(request));
+		}
+		double rate = MeasureThroughput(
+		    [&]() {
+			    size_t decodedSize = 0;
+			    for(const auto& encodedRequest : encodedRequests)
+			    {
+				    decodedSize += Framework::FromBase64(encodedRequest.c_str(), encodedRequest.size()).size();
+			    }
+			    return decodedSize;
+		    });
+		Report("FromBase64 (decoded bytes)", rate);
+	}
+	{
+		double rate = MeasureThroughput(
+		    [&]() {
+			    size_t validCount = 0;
+			    for(const auto& request : requests)
+			    {
+				    validCount += Framework::Utf8::IsValid(request.data(), request.size()) ? 1 : 0;
+			    }
+			    return validCount ? traceSize : 0;
+		    });
+		Report("Utf8::IsValid", rate);
+	}
+}
@@ -0,0 +1,128 @@
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "TextFormatBenchmark.h"
+#include "BenchmarkDefs.h"
+#include "BenchmarkReport.h"
+#include "Corpus.h"
+#include "Csv.h"
+#include "MemStream.h"
+#include "PtrStream.h"
+#include "xml/Document.h"
+#include "xml/Parser.h"
+#include "xml/StreamParser.h"
+
+static const unsigned int g_xmlRecordCount = 10000;
+static const unsigned int g_csvRowCount = 100000;
+
+static void Report(const char* group, const char* name, double bytesPerSecond)
+{
+	printf("  %s: %.1f MB/s\n", name, bytesPerSecond / (1024.0 * 1024.0));
+	BenchmarkReport_Add(group, name, bytesPerSecond / (1024.0 * 1024.0), "MB/s");
+}
+
+static void ExecuteXml()
+{
+	auto xml = Corpus_MakeXml(g_xmlRecordCount);
+	printf("XML parsing (%u records, %.2f MB)\n", g_xmlRecordCount, xml.size() / (1024.0 * 1024.0));
+	{
+		double rate = MeasureThroughput(
+		    [&]() {
+			    Framework::CPtrStream stream(xml.data(), xml.size());
+			    auto document = Framework::Xml::CParser::ParseDocument(stream);
+			    return document ? xml.size() : 0;
+		    });
+		Report("XML", "Xml::CParser::ParseDocument", rate);
+	}
+	{
+		double rate = MeasureThroughput(
+		    [&]() {
+			    auto document = Framework::Xml::CDocument::ParseDocument(std::vector<char>(xml.begin(), xml.end()));
+			    return document->GetNodeCount() ? xml.size() : 0;
+		    });
+		Report("XML", "Xml::CDocument::ParseDocument", rate);
+	}
+	{
+		double rate = MeasureThroughput(
+		    [&]() {
+			    Framework::CPtrStream stream(xml.data(), xml.size());
+			    Framework::Xml::CStreamParser parser(stream);
+			    size_t elementCount = 0;
+			    while(true)
+			    {
+				    auto event = parser.Next();
+				    if(event == Framework::Xml::CStreamParser::EVENT_END_DOCUMENT) break;
+				    if(event == Framework::Xml::CStreamParser::EVENT_START_ELEMENT) elementCount++;
+			    }
+			    return elementCount ? xml.size() : 0;
+		    });
+		Report("XML", "Xml::CStreamParser", rate);
+	}
+}
+
+static void ExecuteCsv()
+{
+	auto csv = Corpus_MakeCsv(g_csvRowCount);
+	printf("CSV parsing and writing (%u rows, %.2f MB)\n", g_csvRowCount, csv.size() / (1024.0 * 1024.0));
+	{
+		double rate = MeasureThroughput(
+		    [&]() {
+			    Framework::CPtrStream stream(csv.data(), csv.size());
+			    auto contents = Framework::Csv::Parse(stream);
+			    return contents.empty() ? 0 : csv.size();
+		    });
+		Report("CSV", "Csv::Parse", rate);
+	}
+	{
+		double rate = MeasureThroughput(
+		    [&]() {
+			    Framework::Csv::CReader reader(csv.data(), csv.size());
+			    //Skips the header row
+			    reader.Next();
+			    int64 total = 0;
+			    while(reader.Next())
+			    {
+				    total += reader.GetInt(0);
+			    }
+			    return total ? csv.size() : 0;
+		    });
+		Report("CSV", "Csv::CReader (in place)", rate);
+	}
+	{
+		double rate = MeasureThroughput(
+		    [&]() {
+			    Framework::CPtrStream stream(csv.data(), csv.size());
+			    Framework::Csv::CReader reader(stream);
+			    size_t rowCount = 0;
+			    while(reader.Next())
+			    {
+				    rowCount++;
+			    }
+			    return rowCount ? csv.size() : 0;
+		    });
+		Report("CSV", "Csv::CReader (stream)", rate);
+	}
+	{
+		Framework::CPtrStream stream(csv.data(), csv.size());
+		auto contents = Framework::Csv::Parse(stream);
+		double rate = MeasureThroughput(
+		    [&]() {
+			    Framework::CMemStream output;
+			    {
+				    Framework::Csv::CWriter writer(output);
+				    for(const auto& row : contents)
+				    {
+					    writer.WriteRow(row);
+				    }
+			    }
+			    return output.GetSize();
+		    });
+		Report("CSV", "Csv::CWriter", rate);
+	}
+}
+
+void TextFormatBenchmark_Execute()
+{
+	ExecuteXml();
+	ExecuteCsv();
+}
@@ -0,0 +1,112 @@
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "VlcBenchmark.h"
+#include "BenchmarkDefs.h"
+#include "BenchmarkReport.h"
+#include "PtrStream.h"
+#include "StreamBitStream.h"
+#include "mpeg2/CodedBlockPatternTable.h"
+#include "mpeg2/DcSizeChrominanceTable.h"
+#include "mpeg2/DcSizeLuminanceTable.h"
+#include "mpeg2/DctCoefficientTable0.h"
+#include "mpeg2/DctCoefficientTable1.h"
+#include "mpeg2/MacroblockAddressIncrementTable.h"
+#include "mpeg2/MacroblockTypeBTable.h"
+#include "mpeg2/MacroblockTypeITable.h"
+#include "mpeg2/MacroblockTypePTable.h"
+#include "mpeg2/MotionCodeTable.h"
+
+struct VLC_TABLE
+{
+	const char* name;
+	MPEG2::CVLCTable* table;
+};
+
+struct ENCODED_STREAM
+{
+	std::vector<uint8> data;
+	std::vector<unsigned int> symbols;
+};
+
+//Generates a stream of symbols with the probability distribution implied by the code lengths
+static ENCODED_STREAM GenerateStream(const MPEG2::CVLCTable& table, unsigned int symbolCount)
+{
+	std::vector<double> weights;
+	for(unsigned int i = 0; i < table.GetEntryCount(); i++)
+	{
+		weights.push_back(1.0 / static_cast<double>(1ULL << table.GetEntry(i).codeLength));
+	}
+	std::mt19937 generator(1);
+	std::discrete_distribution<unsigned int> distribution(weights.begin(), weights.end());
+
+	ENCODED_STREAM result;
+	uint64 bitBuffer = 0;
+	unsigned int bitCount = 0;
+	for(unsigned int i = 0; i < symbolCount; i++)
+	{
+		unsigned int symbol = distribution(generator);
+		const auto& entry = table.GetEntry(symbol);
+		result.symbols.push_back(symbol);
+		bitBuffer = (bitBuffer << entry.codeLength) | entry.code;
+		bitCount += entry.codeLength;
+		while(bitCount >= 8)
+		{
+			bitCount -= 8;
+			result.data.push_back(static_cast<uint8>(bitBuffer >> bitCount));
+		}
+	}
+	if(bitCount != 0)
+	{
+		result.data.push_back(static_cast<uint8>(bitBuffer << (8 - bitCount)));
+	}
+	return result;
+}
+
+void VlcBenchmark_Execute()
+{
+	const VLC_TABLE tables[] =
+	{
+		{ "CodedBlockPattern", MPEG2::CCodedBlockPatternTable::GetInstance() },
+		{ "DcSizeChrominance", MPEG2::CDcSizeChrominanceTable::GetInstance() },
+		{ "DcSizeLuminance", MPEG2::CDcSizeLuminanceTable::GetInstance() },
+		{ "DctCoefficient0", MPEG2::CDctCoefficientTable0::GetInstance().GetVlcTable() },
+		{ "DctCoefficient1", MPEG2::CDctCoefficientTable1::GetInstance().GetVlcTable() },
+		{ "MacroblockAddressIncrement", MPEG2::CMacroblockAddressIncrementTable::GetInstance() },
+		{ "MacroblockTypeB", MPEG2::CMacroblockTypeBTable::GetInstance() },
+		{ "MacroblockTypeI", MPEG2::CMacroblockTypeITable::GetInstance() },
+		{ "MacroblockTypeP", MPEG2::CMacroblockTypePTable::GetInstance() },
+		{ "MotionCode", MPEG2::CMotionCodeTable::GetInstance() },
+	};
+
+	static const unsigned int symbolCount = 0x10000;
+
+	printf("VLC decoding throughput\n");
+	for(const auto& table : tables)
+	{
+		auto stream = GenerateStream(*table.table, symbolCount);
+		unsigned int errorCount = 0;
+		double rate = MeasureThroughput(
+		    [&]() {
+			    Framework::CPtrStream source(stream.data.data(), stream.data.size());
+			    Framework::CStreamBitStream bitStream(source);
+			    for(unsigned int i = 0; i < symbolCount; i++)
+			    {
+				    const MPEG2::VLCTABLEENTRY* entry = nullptr;
+				    if(table.table->TryGetSymbol(&bitStream, entry) != MPEG2::CVLCTable::DECODE_STATUS_SUCCESS)
+				    {
+					    errorCount++;
+					    break;
+				    }
+				    if(entry != &table.table->GetEntry(stream.symbols[i]))
+				    {
+					    errorCount++;
+				    }
+			    }
+			    return symbolCount;
+		    });
+		printf("  %s: %.0f symbols/s, %.2f bits/symbol%s\n", table.name, rate,
+		       static_cast<double>(stream.data.size() * 8) / symbolCount, (errorCount != 0) ? " (DECODING ERRORS)" : "");
+		BenchmarkReport_Add("VLC", table.name, rate, "symbols/s");
+	}
+}
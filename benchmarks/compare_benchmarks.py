@@ -0,0 +1,70 @@
+#!/usr/bin/env python3
+"""Compares two result files written by FrameworkBenchmarks (its fourth argument).
+
+Every reported value is a rate, so higher is better. Results that got slower by more
+than the threshold are reported as regressions and make the script exit with 1.
+
+Usage: compare_benchmarks.py baseline.json current.json [--threshold percent] [--filter text]
+"""
+
+import argparse
+import json
+import sys
+
+
+def load_results(path):
+    with open(path, "r", encoding="utf-8") as result_file:
+        report = json.load(result_file)
+    results = {}
+    for entry in report["results"]:
+        results[(entry["group"], entry["name"])] = (entry["value"], entry["unit"])
+    return results
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compares two FrameworkBenchmarks result files.")
+    parser.add_argument("baseline")
+    parser.add_argument("current")
+    parser.add_argument("--threshold", type=float, default=5.0, help="change in percent under which results are considered equal")
+    parser.add_argument("--filter", default="", help="only compares results whose group or name contains this text")
+    args = parser.parse_args()
+
+    baseline = load_results(args.baseline)
+    current = load_results(args.current)
+
+    regression_count = 0
+    improvement_count = 0
+    group_width = max((len(key[0]) for key in current), default=0)
+    name_width = max((len(key[1]) for key in current), default=0)
+    def is_selected(key):
+        return (not args.filter) or (args.filter in key[0]) or (args.filter in key[1])
+
+    for key in current:
+        if not is_selected(key):
+            continue
+        group, name = key
+        value, unit = current[key]
+        if key not in baseline:
+            print(f"{group:<{group_width}}  {name:<{name_width}}  {'':>12}  {value:12.2f} {unit:<10}  (new)")
+            continue
+        baseline_value = baseline[key][0]
+        change = ((value - baseline_value) / baseline_value * 100.0) if baseline_value else 0.0
+        status = ""
+        if change <= -args.threshold:
+            status = "REGRESSION"
+            regression_count += 1
+        elif change >= args.threshold:
+            status = "improvement"
+            improvement_count += 1
+        print(f"{group:<{group_width}}  {name:<{name_width}}  {baseline_value:12.2f}  {value:12.2f} {unit:<10}  {change:+7.1f}%  {status}")
+
+    for key in baseline:
+        if is_selected(key) and (key not in current):
+            print(f"{key[0]:<{group_width}}  {key[1]:<{name_width}}  (missing from current results)")
+
+    print(f"\n{regression_count} regression(s), {improvement_count} improvement(s) beyond {args.threshold:.1f}%")
+    return 1 if regression_count else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
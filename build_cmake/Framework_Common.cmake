@@ -6,7 +6,12 @@ set(CMAKE_MODULE_PATH
 set(CMAKE_CXX_FLAGS_DEBUG "${CMAKE_CXX_FLAGS_DEBUG} -D_DEBUG")
 set(CMAKE_CXX_FLAGS_RELEASE "${CMAKE_CXX_FLAGS_RELEASE} -DNDEBUG")
 
-set(CMAKE_CXX_STANDARD 17)
+option(FRAMEWORK_ENABLE_COROUTINES "Build with C++20 to enable coroutine support (CAsyncTask)" OFF)
+if(FRAMEWORK_ENABLE_COROUTINES)
+	set(CMAKE_CXX_STANDARD 20)
+else()
+	set(CMAKE_CXX_STANDARD 17)
+endif()
 set(CMAKE_CXX_STANDARD_REQUIRED ON)
 
 set(FRAMEWORK_INCLUDE_DIR ${CMAKE_CURRENT_SOURCE_DIR}/../../include)
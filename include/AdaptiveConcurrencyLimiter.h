@@ -0,0 +1,58 @@
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include "Types.h"
+
+namespace Framework
+{
+	//Limits the number of operations running at once (ie.: requests to a server) to a limit found by
+	//AIMD, as TCP does for its congestion window. Every successful operation raises the limit by
+	//1 / limit, about one per round of operations, and an overload (ie.: HTTP 503) cuts it by the
+	//decrease ratio. Overloads of operations started before the last cut are ignored, they were part
+	//of the load that caused it. Thread-safe.
+	class CAdaptiveConcurrencyLimiter
+	{
+	public:
+		enum OUTCOME
+		{
+			OUTCOME_SUCCESS,
+			OUTCOME_OVERLOAD,
+			//Failures that say nothing about the load (ie.: 404), the limit doesn't change
+			OUTCOME_IGNORED,
+		};
+
+		//Given by Acquire, has to be released once the operation is done
+		struct TICKET
+		{
+			uint64 generation = 0;
+		};
+
+		CAdaptiveConcurrencyLimiter(unsigned int initialLimit, unsigned int minLimit = 1, unsigned int maxLimit = 256, double decreaseRatio = 0.5);
+		CAdaptiveConcurrencyLimiter(const CAdaptiveConcurrencyLimiter&) = delete;
+
+		CAdaptiveConcurrencyLimiter& operator=(const CAdaptiveConcurrencyLimiter&) = delete;
+
+		//Waits until fewer operations than the limit are running
+		TICKET Acquire();
+		//Returns false instead of waiting
+		bool TryAcquire(TICKET&);
+		void Release(const TICKET&, OUTCOME);
+
+		unsigned int GetLimit() const;
+		unsigned int GetActiveCount() const;
+
+	private:
+		bool CanAcquire() const;
+
+		mutable std::mutex m_mutex;
+		std::condition_variable m_condition;
+		double m_limit = 1;
+		double m_minLimit = 1;
+		double m_maxLimit = 1;
+		double m_decreaseRatio = 0.5;
+		unsigned int m_activeCount = 0;
+		//Incremented when the limit is cut
+		uint64 m_generation = 0;
+	};
+}
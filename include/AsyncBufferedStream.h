@@ -0,0 +1,81 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "Stream.h"
+#include "ThreadPool.h"
+
+namespace Framework
+{
+	//Decorator that prefetches blocks ahead of the reader and writes dirty blocks
+	//behind the writer on a thread pool worker. The source stream must not be used
+	//directly while the decorator is alive.
+	class CAsyncBufferedStream : public CStream
+	{
+	public:
+		enum
+		{
+			DEFAULT_BLOCK_SIZE = 0x40000,
+			DEFAULT_DEPTH = 3,
+		};
+
+						CAsyncBufferedStream(CStream&, CThreadPool&, size_t blockSize = DEFAULT_BLOCK_SIZE, unsigned int depth = DEFAULT_DEPTH);
+						CAsyncBufferedStream(const CAsyncBufferedStream&) = delete;
+		virtual			~CAsyncBufferedStream();
+
+		CAsyncBufferedStream& operator =(const CAsyncBufferedStream&) = delete;
+
+		void			Seek(int64, STREAM_SEEK_DIRECTION) override;
+		uint64			Tell() override;
+		uint64			Read(void*, uint64) override;
+		uint64			Write(const void*, uint64) override;
+		bool			IsEOF() override;
+		void			Flush() override;
+		uint64			GetLength() override;
+		uint64			GetRemainingLength() override;
+
+	private:
+		struct BLOCK
+		{
+			std::vector<uint8>	data;
+			size_t				size = 0;
+			size_t				offset = 0;
+		};
+		typedef std::unique_ptr<BLOCK> BlockPtr;
+		typedef std::deque<BlockPtr> BlockQueue;
+		typedef std::unique_lock<std::mutex> Lock;
+
+		BlockPtr		AllocateBlock();
+		void			RecycleBlock(BlockPtr);
+		void			QueueReads();
+		void			SubmitCurrentWrite(Lock&);
+		void			Synchronize(Lock&);
+		void			StartPump();
+		void			WaitIdle(Lock&);
+		void			CheckError();
+		void			PumpProc();
+
+		CStream&		m_source;
+		CThreadPool&	m_threadPool;
+		size_t			m_blockSize = 0;
+		unsigned int	m_depth = 0;
+
+		std::mutex		m_mutex;
+		std::condition_variable m_condition;
+		BlockQueue		m_readBlocks;
+		size_t			m_filledCount = 0;
+		BlockQueue		m_writeBlocks;
+		BlockPtr		m_currentWrite;
+		std::vector<BlockPtr> m_freeBlocks;
+		bool			m_pumpActive = false;
+		bool			m_sourceEof = false;
+		std::exception_ptr m_error;
+
+		uint64			m_position = 0;
+		bool			m_isEof = false;
+	};
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Stream.h"
+#include "ThreadPool.h"
+
+namespace Framework
+{
+	//Batched positional reads against file streams. Uses io_uring on Linux when
+	//available, otherwise requests are serviced with ReadAt on thread pool workers.
+	//Completion callbacks always run on the thread pool.
+	class CAsyncFileReader
+	{
+	public:
+		enum
+		{
+			DEFAULT_QUEUE_DEPTH = 128,
+		};
+
+		typedef std::function<void (uint64, std::exception_ptr)> CompletionCallback;
+
+		struct READ_REQUEST
+		{
+			CStream*			stream = nullptr;
+			uint64				offset = 0;
+			void*				buffer = nullptr;
+			uint64				size = 0;
+			CompletionCallback	callback;
+		};
+		typedef std::vector<READ_REQUEST> RequestArray;
+
+								CAsyncFileReader(CThreadPool&, unsigned int queueDepth = DEFAULT_QUEUE_DEPTH);
+								CAsyncFileReader(const CAsyncFileReader&) = delete;
+		virtual					~CAsyncFileReader();
+
+		CAsyncFileReader&		operator =(const CAsyncFileReader&) = delete;
+
+		void					Submit(RequestArray);
+		std::future<uint64>		Read(CStream&, uint64 offset, void* buffer, uint64 size);
+
+		bool					IsUsingNativeQueue() const;
+
+	private:
+		struct PENDING_READ;
+		struct RING;
+
+		void					SubmitFallback(READ_REQUEST);
+		static void				Complete(READ_REQUEST&, uint64, std::exception_ptr);
+
+		void					InitializeRing(unsigned int);
+		bool					CanUseRing(const READ_REQUEST&) const;
+		void					SubmitRing(RequestArray&);
+		void					QueueRingRead(PENDING_READ*);
+		void					EnterRing(unsigned int, unsigned int, unsigned int);
+		void					ReaperThreadProc();
+
+		CThreadPool&			m_threadPool;
+
+		std::unique_ptr<RING>	m_ring;
+		std::mutex				m_ringMutex;
+		std::condition_variable	m_ringCondition;
+		unsigned int			m_ringInFlight = 0;
+		unsigned int			m_ringMaxInFlight = 0;
+		std::atomic<bool>		m_ringStop;
+		//Cleared when the kernel has io_uring but not its read operation (before 5.6)
+		std::atomic<bool>		m_ringReadSupported;
+		std::thread				m_reaperThread;
+	};
+}
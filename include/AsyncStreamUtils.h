@@ -0,0 +1,114 @@
+#pragma once
+
+#include "AsyncTask.h"
+
+#if defined(FRAMEWORK_HAS_COROUTINES)
+
+#include "AsyncFileReader.h"
+#include "Stream.h"
+#include "ThreadPool.h"
+
+namespace Framework
+{
+	namespace AsyncStreamUtils
+	{
+		//Runs a blocking stream operation on a worker, the coroutine resumes on that worker
+		template <typename OperationType>
+		struct POOL_AWAITER
+		{
+			bool await_ready() const noexcept
+			{
+				return false;
+			}
+
+			void await_suspend(std::coroutine_handle<> handle)
+			{
+				threadPool.Enqueue(
+				    [this, handle] () {
+					    try
+					    {
+						    result = operation();
+					    }
+					    catch(...)
+					    {
+						    exception = std::current_exception();
+					    }
+					    handle.resume();
+				    });
+			}
+
+			uint64 await_resume()
+			{
+				if(exception) std::rethrow_exception(exception);
+				return result;
+			}
+
+			CThreadPool&		threadPool;
+			OperationType		operation;
+			uint64				result = 0;
+			std::exception_ptr	exception;
+		};
+
+		struct FILEREADER_AWAITER
+		{
+			bool await_ready() const noexcept
+			{
+				return false;
+			}
+
+			void await_suspend(std::coroutine_handle<> handle)
+			{
+				CAsyncFileReader::READ_REQUEST request;
+				request.stream = &stream;
+				request.offset = offset;
+				request.buffer = buffer;
+				request.size = size;
+				request.callback =
+				    [this, handle] (uint64 readSize, std::exception_ptr readException) {
+					    result = readSize;
+					    exception = readException;
+					    handle.resume();
+				    };
+				CAsyncFileReader::RequestArray requests;
+				requests.push_back(std::move(request));
+				//Might complete and resume before Submit returns, nothing is used after it
+				reader.Submit(std::move(requests));
+			}
+
+			uint64 await_resume()
+			{
+				if(exception) std::rethrow_exception(exception);
+				return result;
+			}
+
+			CAsyncFileReader&	reader;
+			CStream&			stream;
+			uint64				offset = 0;
+			void*				buffer = nullptr;
+			uint64				size = 0;
+			uint64				result = 0;
+			std::exception_ptr	exception;
+		};
+	}
+
+	//Reads at the stream's current position on a thread pool worker
+	inline auto AsyncRead(CThreadPool& threadPool, CStream& stream, void* buffer, uint64 size)
+	{
+		auto operation = [&stream, buffer, size] () { return stream.Read(buffer, size); };
+		return AsyncStreamUtils::POOL_AWAITER<decltype(operation)>{threadPool, operation};
+	}
+
+	inline auto AsyncWrite(CThreadPool& threadPool, CStream& stream, const void* buffer, uint64 size)
+	{
+		auto operation = [&stream, buffer, size] () { return stream.Write(buffer, size); };
+		return AsyncStreamUtils::POOL_AWAITER<decltype(operation)>{threadPool, operation};
+	}
+
+	//Positional read through the reader's queue (io_uring when available), no thread blocks while waiting
+	inline auto AsyncRead(CAsyncFileReader& reader, CStream& stream, uint64 offset, void* buffer, uint64 size)
+	{
+		return AsyncStreamUtils::FILEREADER_AWAITER{reader, stream, offset, buffer, size};
+	}
+}
+
+#endif
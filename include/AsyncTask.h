@@ -0,0 +1,309 @@
+#pragma once
+
+//Coroutine support needs C++20, see FRAMEWORK_ENABLE_COROUTINES in the CMake build
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+#define FRAMEWORK_HAS_COROUTINES
+#endif
+#endif
+
+#if defined(FRAMEWORK_HAS_COROUTINES)
+
+#include <condition_variable>
+#include <coroutine>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+namespace Framework
+{
+	template <typename> class CAsyncTask;
+
+	namespace AsyncTaskDetail
+	{
+		template <typename PromiseType>
+		struct FINAL_AWAITER
+		{
+			bool await_ready() const noexcept
+			{
+				return false;
+			}
+
+			//Symmetric transfer to whoever was awaiting the task
+			std::coroutine_handle<> await_suspend(std::coroutine_handle<PromiseType> handle) noexcept
+			{
+				auto continuation = handle.promise().continuation;
+				return continuation ? continuation : std::noop_coroutine();
+			}
+
+			void await_resume() noexcept
+			{
+			}
+		};
+
+		struct PROMISE_BASE
+		{
+			std::suspend_always initial_suspend() noexcept
+			{
+				return {};
+			}
+
+			void unhandled_exception()
+			{
+				exception = std::current_exception();
+			}
+
+			std::coroutine_handle<>	continuation;
+			std::exception_ptr		exception;
+		};
+
+		template <typename ResultType>
+		struct PROMISE : public PROMISE_BASE
+		{
+			CAsyncTask<ResultType> get_return_object();
+
+			FINAL_AWAITER<PROMISE> final_suspend() noexcept
+			{
+				return {};
+			}
+
+			template <typename ValueType>
+			void return_value(ValueType&& value)
+			{
+				result.emplace(std::forward<ValueType>(value));
+			}
+
+			ResultType GetResult()
+			{
+				if(exception) std::rethrow_exception(exception);
+				return std::move(*result);
+			}
+
+			std::optional<ResultType>	result;
+		};
+
+		template <>
+		struct PROMISE<void> : public PROMISE_BASE
+		{
+			CAsyncTask<void> get_return_object();
+
+			FINAL_AWAITER<PROMISE> final_suspend() noexcept
+			{
+				return {};
+			}
+
+			void return_void()
+			{
+			}
+
+			void GetResult()
+			{
+				if(exception) std::rethrow_exception(exception);
+			}
+		};
+	}
+
+	//Lazily started coroutine: it runs when awaited and resumes its awaiter when done.
+	//Exceptions are rethrown to the awaiter.
+	template <typename ResultType = void>
+	class CAsyncTask
+	{
+	public:
+		typedef AsyncTaskDetail::PROMISE<ResultType> promise_type;
+		typedef std::coroutine_handle<promise_type> Handle;
+
+		//Waits for the task to complete without getting its result
+		struct COMPLETION_AWAITER
+		{
+			bool await_ready() const noexcept
+			{
+				return !handle || handle.done();
+			}
+
+			std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiter) noexcept
+			{
+				handle.promise().continuation = awaiter;
+				return handle;
+			}
+
+			void await_resume() noexcept
+			{
+			}
+
+			Handle		handle;
+		};
+
+		struct AWAITER : public COMPLETION_AWAITER
+		{
+			ResultType await_resume()
+			{
+				return this->handle.promise().GetResult();
+			}
+		};
+
+							CAsyncTask() = default;
+
+		explicit			CAsyncTask(Handle handle)
+		: m_handle(handle)
+		{
+		}
+
+							CAsyncTask(const CAsyncTask&) = delete;
+
+							CAsyncTask(CAsyncTask&& src) noexcept
+		: m_handle(std::exchange(src.m_handle, nullptr))
+		{
+		}
+
+							~CAsyncTask()
+		{
+			if(m_handle) m_handle.destroy();
+		}
+
+		CAsyncTask&			operator =(const CAsyncTask&) = delete;
+
+		CAsyncTask&			operator =(CAsyncTask&& src) noexcept
+		{
+			if(this != &src)
+			{
+				if(m_handle) m_handle.destroy();
+				m_handle = std::exchange(src.m_handle, nullptr);
+			}
+			return *this;
+		}
+
+		AWAITER				operator co_await() const noexcept
+		{
+			return AWAITER{{m_handle}};
+		}
+
+		COMPLETION_AWAITER	WhenDone() const noexcept
+		{
+			return COMPLETION_AWAITER{m_handle};
+		}
+
+		bool				IsDone() const
+		{
+			return !m_handle || m_handle.done();
+		}
+
+		//Only valid once done, rethrows the task's exception
+		ResultType			GetResult()
+		{
+			return m_handle.promise().GetResult();
+		}
+
+	private:
+		Handle				m_handle;
+	};
+
+	template <typename ResultType>
+	CAsyncTask<ResultType> AsyncTaskDetail::PROMISE<ResultType>::get_return_object()
+	{
+		return CAsyncTask<ResultType>(std::coroutine_handle<PROMISE>::from_promise(*this));
+	}
+
+	inline CAsyncTask<void> AsyncTaskDetail::PROMISE<void>::get_return_object()
+	{
+		return CAsyncTask<void>(std::coroutine_handle<PROMISE>::from_promise(*this));
+	}
+
+	namespace AsyncTaskDetail
+	{
+		struct EVENT
+		{
+			void Set()
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				isSet = true;
+				condition.notify_all();
+			}
+
+			void Wait()
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				condition.wait(lock, [this]() { return isSet; });
+			}
+
+			std::mutex				mutex;
+			std::condition_variable	condition;
+			bool					isSet = false;
+		};
+
+		//Sets the event once suspended for the last time
+		struct SYNCWAIT_COROUTINE
+		{
+			struct promise_type
+			{
+				SYNCWAIT_COROUTINE get_return_object()
+				{
+					return SYNCWAIT_COROUTINE{std::coroutine_handle<promise_type>::from_promise(*this)};
+				}
+
+				std::suspend_always initial_suspend() noexcept
+				{
+					return {};
+				}
+
+				auto final_suspend() noexcept
+				{
+					struct SIGNAL_AWAITER
+					{
+						bool await_ready() const noexcept
+						{
+							return false;
+						}
+
+						void await_suspend(std::coroutine_handle<promise_type> handle) noexcept
+						{
+							handle.promise().event->Set();
+						}
+
+						void await_resume() noexcept
+						{
+						}
+					};
+					return SIGNAL_AWAITER{};
+				}
+
+				void return_void()
+				{
+				}
+
+				void unhandled_exception()
+				{
+					std::terminate();
+				}
+
+				EVENT*	event = nullptr;
+			};
+
+			std::coroutine_handle<promise_type>	handle;
+		};
+	}
+
+	//Blocks the calling thread until the task is done and returns its result
+	template <typename ResultType>
+	ResultType SyncWait(CAsyncTask<ResultType>& task)
+	{
+		auto waitTask = [](CAsyncTask<ResultType>& task) -> AsyncTaskDetail::SYNCWAIT_COROUTINE {
+			co_await task.WhenDone();
+		};
+		AsyncTaskDetail::EVENT event;
+		auto coroutine = waitTask(task);
+		coroutine.handle.promise().event = &event;
+		coroutine.handle.resume();
+		event.Wait();
+		coroutine.handle.destroy();
+		return task.GetResult();
+	}
+
+	template <typename ResultType>
+	ResultType SyncWait(CAsyncTask<ResultType>&& task)
+	{
+		return SyncWait(task);
+	}
+}
+
+#endif
@@ -9,4 +9,16 @@ namespace Framework
 	std::string ToBase64(const std::string&);
 	std::string ToBase64(const void* buffer, size_t size);
 	std::vector<uint8> FromBase64(const char* source);
+	std::vector<uint8> FromBase64(const char* source, size_t size);
+
+	//Size of the encoded data, padding included
+	size_t GetBase64EncodedSize(size_t);
+	//Writes exactly GetBase64EncodedSize(size) characters to the output, without a terminator
+	void ToBase64(const void* buffer, size_t size, char* output);
+
+	//Exact size of the decoded data, padding is optional. Throws if the encoded size isn't valid.
+	size_t GetBase64DecodedSize(const char* source, size_t size);
+	//Writes exactly GetBase64DecodedSize(source, size) bytes to the output and returns that size.
+	//Throws if the source contains characters outside of the base64 alphabet.
+	size_t FromBase64(const char* source, size_t size, uint8* output);
 }
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <vector>
+#include "Stream.h"
+
+namespace Framework
+{
+	//Writes the base64 encoding of the data to the base stream, the last group and its padding
+	//are only written by Flush, which ends the encoded data
+	class CBase64EncodeStream : public CStream
+	{
+	public:
+						CBase64EncodeStream(CStream&);
+		virtual			~CBase64EncodeStream() = default;
+
+		void			Seek(int64, STREAM_SEEK_DIRECTION) override;
+		uint64			Tell() override;
+		uint64			Read(void*, uint64) override;
+		uint64			Write(const void*, uint64) override;
+		bool			IsEOF() override;
+		void			Flush() override;
+
+	private:
+		enum
+		{
+			//Multiple of 3 so that every full chunk encodes without padding
+			CHUNK_SIZE = 0xC000,
+		};
+
+		CStream&		m_baseStream;
+		std::vector<char>	m_outputBuffer;
+		uint8			m_pending[3] = {};
+		size_t			m_pendingSize = 0;
+	};
+
+	//Reads base64 encoded data from the base stream until its end and gives back the decoded data
+	class CBase64DecodeStream : public CStream
+	{
+	public:
+						CBase64DecodeStream(CStream&);
+		virtual			~CBase64DecodeStream() = default;
+
+		void			Seek(int64, STREAM_SEEK_DIRECTION) override;
+		uint64			Tell() override;
+		uint64			Read(void*, uint64) override;
+		uint64			Write(const void*, uint64) override;
+		bool			IsEOF() override;
+
+	private:
+		enum
+		{
+			//Multiple of 4 so that every full chunk decodes on its own
+			CHUNK_SIZE = 0x10000,
+		};
+
+		bool			FillOutputBuffer();
+
+		CStream&		m_baseStream;
+		std::vector<char>	m_inputBuffer;
+		size_t			m_inputSize = 0;
+		std::vector<uint8>	m_outputBuffer;
+		size_t			m_outputPosition = 0;
+		size_t			m_outputSize = 0;
+		bool			m_isPaddingFound = false;
+		bool			m_isInputEnd = false;
+	};
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstring>
+#include <vector>
+#include "Stream.h"
+
+namespace Framework
+{
+	//Decorator that keeps a memory window over another stream to avoid
+	//going through virtual calls for every small read or write.
+	//Position of the source stream is undefined while reads are buffered.
+	class CBufferedStream : public CStream
+	{
+	public:
+		enum
+		{
+			DEFAULT_BUFFER_SIZE = 0x10000,
+		};
+
+						CBufferedStream(CStream&, size_t bufferSize = DEFAULT_BUFFER_SIZE);
+						CBufferedStream(const CBufferedStream&) = delete;
+		virtual			~CBufferedStream();
+
+		CBufferedStream& operator =(const CBufferedStream&) = delete;
+
+		void			Seek(int64, STREAM_SEEK_DIRECTION) override;
+		uint64			Tell() override;
+		uint64			Read(void*, uint64) override;
+		uint64			Write(const void*, uint64) override;
+		bool			IsEOF() override;
+		void			Flush() override;
+		uint64			GetLength() override;
+		uint64			GetRemainingLength() override;
+
+		std::string		ReadLine(bool ignoreCr = true) override;
+
+		//Makes at least 'size' bytes available in the window (if the source has them)
+		//and returns the number of bytes that can be accessed through the returned pointer.
+		size_t			Peek(const uint8*&, size_t size = 1);
+		void			Consume(size_t);
+
+		uint8			Read8()				{ return ReadValue<uint8>(); }
+		uint16			Read16()			{ return ReadValue<uint16>(); }
+		uint32			Read32()			{ return ReadValue<uint32>(); }
+		uint64			Read64()			{ return ReadValue<uint64>(); }
+		uint16			Read16_MSBF();
+		uint32			Read32_MSBF();
+		float			ReadFloat32()		{ return ReadValue<float>(); }
+
+	private:
+		template <typename ValueType>
+		ValueType ReadValue()
+		{
+			ValueType value = ValueType();
+			if((m_readEnd - m_readPos) >= sizeof(ValueType))
+			{
+				memcpy(&value, m_buffer.data() + m_readPos, sizeof(ValueType));
+				m_readPos += sizeof(ValueType);
+			}
+			else
+			{
+				Read(&value, sizeof(ValueType));
+			}
+			return value;
+		}
+
+		size_t			Fill(size_t);
+		void			FlushWrites();
+		void			DiscardReads();
+
+		CStream&		m_stream;
+		std::vector<uint8>	m_buffer;
+		size_t			m_readPos = 0;
+		size_t			m_readEnd = 0;
+		size_t			m_writeSize = 0;
+		bool			m_isEof = false;
+		bool			m_sourceEof = false;
+	};
+}
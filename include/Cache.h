@@ -0,0 +1,397 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Metrics.h"
+#include "Types.h"
+
+namespace Framework
+{
+	enum CACHE_POLICY
+	{
+		//Least recently used entries are evicted first
+		CACHE_POLICY_LRU,
+		//Adaptive replacement cache: splits entries between recently and frequently used ones and
+		//remembers recently evicted keys to tune the split, so that one-off scans don't flush
+		//entries that are used all the time
+		CACHE_POLICY_ARC,
+	};
+
+	struct CACHE_SETTINGS
+	{
+		CACHE_POLICY	policy = CACHE_POLICY_LRU;
+		//Total weight of the cached entries, split evenly between shards.
+		//Entries weigh 1 unless the cache has a weight function.
+		uint64			capacity = 1024;
+		//Rounded up to a power of two
+		unsigned int	shardCount = 16;
+		//Entries older than this are considered missing, zero keeps them until they're evicted
+		std::chrono::milliseconds	timeToLive = std::chrono::milliseconds::zero();
+		//Name of the "cache" label of the hit, miss, eviction and weight metrics, none are registered if empty
+		std::string		metricsName;
+	};
+
+	struct CACHE_STATS
+	{
+		uint64			hitCount = 0;
+		uint64			missCount = 0;
+		uint64			insertCount = 0;
+		//Entries pushed out to make room, expired entries aren't counted here
+		uint64			evictionCount = 0;
+		uint64			expirationCount = 0;
+		uint64			weight = 0;
+		size_t			entryCount = 0;
+	};
+
+	//Thread safe key/value cache bounded by entry count or weight. Keys are spread in shards by hash,
+	//each with its own lock and its own share of the capacity. Values are shared, so a value found
+	//in the cache stays valid after it's evicted. An entry heavier than a shard's share isn't cached.
+	template <typename KeyType, typename ValueType, typename HasherType = std::hash<KeyType>>
+	class CCache
+	{
+	public:
+		typedef std::shared_ptr<const ValueType> ValuePtr;
+		typedef std::function<uint64 (const KeyType&, const ValueType&)> WeightFunction;
+
+		explicit CCache(const CACHE_SETTINGS& settings = CACHE_SETTINGS(), WeightFunction weightFunction = WeightFunction())
+		    : m_policy(settings.policy)
+		    , m_timeToLive(settings.timeToLive)
+		    , m_weightFunction(std::move(weightFunction))
+		{
+			unsigned int shardCount = 1;
+			while(shardCount < settings.shardCount)
+			{
+				shardCount <<= 1;
+				m_shardBits++;
+			}
+			m_shardCapacity = std::max<uint64>(settings.capacity / shardCount, 1);
+			m_shards.reserve(shardCount);
+			for(unsigned int i = 0; i < shardCount; i++)
+			{
+				m_shards.push_back(std::make_unique<SHARD>());
+			}
+
+			if(!settings.metricsName.empty())
+			{
+				auto& registry = Metrics::CRegistry::GetInstance();
+				std::string labels = "cache=\"" + settings.metricsName + "\"";
+				m_hitMetric = &registry.GetCounter("framework_cache_hits_total", labels, "Lookups that found a cached entry.");
+				m_missMetric = &registry.GetCounter("framework_cache_misses_total", labels, "Lookups that didn't find a cached entry.");
+				m_evictionMetric = &registry.GetCounter("framework_cache_evictions_total", labels, "Entries evicted to make room for others.");
+				m_weightMetric = &registry.GetGauge("framework_cache_weight", labels, "Total weight of the cached entries.");
+			}
+		}
+
+		CCache(const CCache&) = delete;
+
+		~CCache()
+		{
+			Clear();
+		}
+
+		CCache& operator=(const CCache&) = delete;
+
+		//Null if the entry isn't cached or expired
+		ValuePtr Find(const KeyType& key)
+		{
+			auto& shard = GetShard(key);
+			std::lock_guard<std::mutex> lock(shard.mutex);
+			auto nodeIterator = shard.nodes.find(key);
+			if((nodeIterator == std::end(shard.nodes)) || !nodeIterator->second.value)
+			{
+				RecordMiss(shard);
+				return ValuePtr();
+			}
+			auto& node = nodeIterator->second;
+			if(IsExpired(node))
+			{
+				RemoveNode(shard, nodeIterator);
+				shard.stats.expirationCount++;
+				RecordMiss(shard);
+				return ValuePtr();
+			}
+			shard.stats.hitCount++;
+			if(m_hitMetric) m_hitMetric->Add();
+			Unlink(shard, node);
+			Link(shard, node, (m_policy == CACHE_POLICY_ARC) ? LIST_T2 : LIST_T1);
+			return node.value;
+		}
+
+		ValuePtr Insert(const KeyType& key, ValueType value)
+		{
+			return Insert(key, std::make_shared<const ValueType>(std::move(value)));
+		}
+
+		//Replaces the value if the key is already cached
+		ValuePtr Insert(const KeyType& key, ValuePtr value)
+		{
+			uint64 weight = m_weightFunction ? m_weightFunction(key, *value) : 1;
+			auto& shard = GetShard(key);
+			std::lock_guard<std::mutex> lock(shard.mutex);
+			auto nodeIterator = shard.nodes.find(key);
+			if(weight > m_shardCapacity)
+			{
+				//Too heavy, the previous value would be stale
+				if(nodeIterator != std::end(shard.nodes))
+				{
+					RemoveNode(shard, nodeIterator);
+				}
+				return value;
+			}
+
+			bool isSeenBefore = (nodeIterator != std::end(shard.nodes));
+			bool isInB2 = false;
+			if(isSeenBefore)
+			{
+				auto& node = nodeIterator->second;
+				if(node.list == LIST_B1)
+				{
+					//Key was evicted from the recent list too soon, give more room to recent entries
+					uint64 ratio = std::max<uint64>(shard.listWeights[LIST_B2] / std::max<uint64>(shard.listWeights[LIST_B1], 1), 1);
+					shard.targetT1Weight = std::min(shard.targetT1Weight + (ratio * weight), m_shardCapacity);
+				}
+				else if(node.list == LIST_B2)
+				{
+					//Key was evicted from the frequent list too soon, give more room to frequent entries
+					uint64 ratio = std::max<uint64>(shard.listWeights[LIST_B1] / std::max<uint64>(shard.listWeights[LIST_B2], 1), 1);
+					shard.targetT1Weight -= std::min(shard.targetT1Weight, ratio * weight);
+					isInB2 = true;
+				}
+				Unlink(shard, node);
+			}
+			else
+			{
+				nodeIterator = shard.nodes.emplace(key, NODE()).first;
+				nodeIterator->second.key = &nodeIterator->first;
+			}
+
+			auto& node = nodeIterator->second;
+			node.value = value;
+			node.weight = weight;
+			if(m_timeToLive != std::chrono::milliseconds::zero())
+			{
+				node.expiryTime = Clock::now() + m_timeToLive;
+			}
+			//Node isn't in a list while others are evicted, so it can't be picked
+			MakeRoom(shard, weight, isInB2);
+			Link(shard, node, ((m_policy == CACHE_POLICY_ARC) && isSeenBefore) ? LIST_T2 : LIST_T1);
+			TrimGhosts(shard);
+			shard.stats.insertCount++;
+			return value;
+		}
+
+		//Produces the value outside of the cache's locks, so it might be produced more than once
+		//if several threads miss the same key at the same time
+		template <typename ProduceFunctionType>
+		ValuePtr FindOrInsert(const KeyType& key, const ProduceFunctionType& produceFunction)
+		{
+			if(auto value = Find(key))
+			{
+				return value;
+			}
+			return Insert(key, produceFunction());
+		}
+
+		bool Remove(const KeyType& key)
+		{
+			auto& shard = GetShard(key);
+			std::lock_guard<std::mutex> lock(shard.mutex);
+			auto nodeIterator = shard.nodes.find(key);
+			if(nodeIterator == std::end(shard.nodes))
+			{
+				return false;
+			}
+			bool isResident = static_cast<bool>(nodeIterator->second.value);
+			RemoveNode(shard, nodeIterator);
+			return isResident;
+		}
+
+		void Clear()
+		{
+			for(auto& shard : m_shards)
+			{
+				std::lock_guard<std::mutex> lock(shard->mutex);
+				while(!shard->nodes.empty())
+				{
+					RemoveNode(*shard, std::begin(shard->nodes));
+				}
+				shard->targetT1Weight = 0;
+			}
+		}
+
+		CACHE_STATS GetStats() const
+		{
+			CACHE_STATS result;
+			for(const auto& shard : m_shards)
+			{
+				std::lock_guard<std::mutex> lock(shard->mutex);
+				result.hitCount += shard->stats.hitCount;
+				result.missCount += shard->stats.missCount;
+				result.insertCount += shard->stats.insertCount;
+				result.evictionCount += shard->stats.evictionCount;
+				result.expirationCount += shard->stats.expirationCount;
+				result.weight += shard->listWeights[LIST_T1] + shard->listWeights[LIST_T2];
+				result.entryCount += shard->lists[LIST_T1].size() + shard->lists[LIST_T2].size();
+			}
+			return result;
+		}
+
+	private:
+		typedef std::chrono::steady_clock Clock;
+		//Least recently used first, keys point in the node map
+		typedef std::list<const KeyType*> KeyList;
+
+		enum LIST
+		{
+			//Resident entries used once recently, the only list used by LRU
+			LIST_T1,
+			//Resident entries used more than once
+			LIST_T2,
+			//Keys (without values) recently evicted from T1 and T2
+			LIST_B1,
+			LIST_B2,
+			LIST_COUNT,
+			LIST_NONE = LIST_COUNT,
+		};
+
+		struct NODE
+		{
+			const KeyType*	key = nullptr;
+			//Null for keys of evicted entries
+			ValuePtr		value;
+			uint64			weight = 0;
+			Clock::time_point	expiryTime = Clock::time_point::max();
+			LIST			list = LIST_NONE;
+			typename KeyList::iterator	listIterator;
+		};
+
+		typedef std::unordered_map<KeyType, NODE, HasherType> NodeMap;
+
+		struct alignas(64) SHARD
+		{
+			std::mutex		mutex;
+			NodeMap			nodes;
+			KeyList			lists[LIST_COUNT];
+			uint64			listWeights[LIST_COUNT] = {};
+			//Weight ARC aims to keep in T1, moves with hits on the B1 and B2 lists
+			uint64			targetT1Weight = 0;
+			CACHE_STATS		stats;
+		};
+
+		typedef std::unique_ptr<SHARD> ShardPtr;
+
+		SHARD& GetShard(const KeyType& key)
+		{
+			if(m_shardBits == 0)
+			{
+				return *m_shards[0];
+			}
+			//Hashes of integers are often the value itself, mix before taking the top bits
+			uint64 hash = static_cast<uint64>(m_hasher(key)) * 0x9E3779B97F4A7C15ULL;
+			return *m_shards[static_cast<size_t>(hash >> (64 - m_shardBits))];
+		}
+
+		bool IsExpired(const NODE& node) const
+		{
+			return (m_timeToLive != std::chrono::milliseconds::zero()) && (Clock::now() >= node.expiryTime);
+		}
+
+		void RecordMiss(SHARD& shard)
+		{
+			shard.stats.missCount++;
+			if(m_missMetric) m_missMetric->Add();
+		}
+
+		static bool IsResidentList(LIST list)
+		{
+			return (list == LIST_T1) || (list == LIST_T2);
+		}
+
+		void Link(SHARD& shard, NODE& node, LIST list)
+		{
+			node.list = list;
+			node.listIterator = shard.lists[list].insert(std::end(shard.lists[list]), node.key);
+			shard.listWeights[list] += node.weight;
+			if(m_weightMetric && IsResidentList(list)) m_weightMetric->Add(static_cast<int64>(node.weight));
+		}
+
+		void Unlink(SHARD& shard, NODE& node)
+		{
+			if(node.list == LIST_NONE) return;
+			shard.lists[node.list].erase(node.listIterator);
+			shard.listWeights[node.list] -= node.weight;
+			if(m_weightMetric && IsResidentList(node.list)) m_weightMetric->Add(-static_cast<int64>(node.weight));
+			node.list = LIST_NONE;
+		}
+
+		void RemoveNode(SHARD& shard, typename NodeMap::iterator nodeIterator)
+		{
+			Unlink(shard, nodeIterator->second);
+			shard.nodes.erase(nodeIterator);
+		}
+
+		void EvictOldest(SHARD& shard, LIST list)
+		{
+			auto nodeIterator = shard.nodes.find(*shard.lists[list].front());
+			auto& node = nodeIterator->second;
+			shard.stats.evictionCount++;
+			if(m_evictionMetric) m_evictionMetric->Add();
+			if(m_policy == CACHE_POLICY_LRU)
+			{
+				RemoveNode(shard, nodeIterator);
+				return;
+			}
+			//Key is kept as a ghost to notice when it comes back
+			Unlink(shard, node);
+			node.value.reset();
+			Link(shard, node, (list == LIST_T1) ? LIST_B1 : LIST_B2);
+		}
+
+		void MakeRoom(SHARD& shard, uint64 weight, bool isInB2)
+		{
+			while((shard.listWeights[LIST_T1] + shard.listWeights[LIST_T2] + weight) > m_shardCapacity)
+			{
+				bool hasT1 = !shard.lists[LIST_T1].empty();
+				bool hasT2 = !shard.lists[LIST_T2].empty();
+				if(!hasT1 && !hasT2) break;
+				uint64 t1Weight = shard.listWeights[LIST_T1];
+				bool evictFromT1 = hasT1 && (!hasT2 || (t1Weight > shard.targetT1Weight) || (isInB2 && (t1Weight == shard.targetT1Weight)));
+				EvictOldest(shard, evictFromT1 ? LIST_T1 : LIST_T2);
+			}
+		}
+
+		//Ghosts are bounded like in ARC: recent keys (resident or not) within the capacity, all keys within twice the capacity
+		void TrimGhosts(SHARD& shard)
+		{
+			const auto& weights = shard.listWeights;
+			while(!shard.lists[LIST_B1].empty() && ((weights[LIST_T1] + weights[LIST_B1]) > m_shardCapacity))
+			{
+				RemoveNode(shard, shard.nodes.find(*shard.lists[LIST_B1].front()));
+			}
+			while(!shard.lists[LIST_B2].empty() && ((weights[LIST_T1] + weights[LIST_T2] + weights[LIST_B1] + weights[LIST_B2]) > (2 * m_shardCapacity)))
+			{
+				RemoveNode(shard, shard.nodes.find(*shard.lists[LIST_B2].front()));
+			}
+		}
+
+		CACHE_POLICY		m_policy = CACHE_POLICY_LRU;
+		std::chrono::milliseconds	m_timeToLive;
+		WeightFunction		m_weightFunction;
+		HasherType			m_hasher;
+		uint64				m_shardCapacity = 0;
+		unsigned int		m_shardBits = 0;
+		std::vector<ShardPtr>	m_shards;
+
+		Metrics::CCounter*	m_hitMetric = nullptr;
+		Metrics::CCounter*	m_missMetric = nullptr;
+		Metrics::CCounter*	m_evictionMetric = nullptr;
+		Metrics::CGauge*	m_weightMetric = nullptr;
+	};
+}
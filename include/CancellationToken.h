@@ -0,0 +1,42 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+
+namespace Framework
+{
+	//Shared flag used to ask work to stop. Copies refer to the same flag, so one token can be given
+	//to many tasks and cancel all of them. Work polls IsCancelled at convenient points.
+	//Default constructed tokens can't be cancelled and don't allocate.
+	class CCancellationToken
+	{
+	public:
+		static CCancellationToken Create()
+		{
+			CCancellationToken token;
+			token.m_cancelled = std::make_shared<std::atomic<bool>>(false);
+			return token;
+		}
+
+		bool IsCancellable() const
+		{
+			return static_cast<bool>(m_cancelled);
+		}
+
+		bool IsCancelled() const
+		{
+			return m_cancelled && m_cancelled->load(std::memory_order_relaxed);
+		}
+
+		void Cancel()
+		{
+			if(m_cancelled)
+			{
+				m_cancelled->store(true, std::memory_order_relaxed);
+			}
+		}
+
+	private:
+		std::shared_ptr<std::atomic<bool>> m_cancelled;
+	};
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "Stream.h"
+
+namespace Framework
+{
+	//Memory stream made of fixed size segments. Growing it never moves what was already written, so
+	//large bodies don't get copied over and over like with CMemStream and don't need one contiguous
+	//block, which can be hard to find in fragmented 32-bit address spaces. Segments come from a pool
+	//and go back to it when the stream is cleared or destroyed. Not thread safe, except for ReadAt.
+	class CChainedBufferStream : public CStream
+	{
+	public:
+		enum
+		{
+			DEFAULT_SEGMENT_SIZE = 0x10000,
+		};
+
+		//Keeps free segments of one size around to be reused by other streams, can be used from any thread
+		class CSegmentPool
+		{
+		public:
+							CSegmentPool(size_t segmentSize, size_t maxFreeCount);
+							CSegmentPool(const CSegmentPool&) = delete;
+							~CSegmentPool();
+
+			CSegmentPool&	operator =(const CSegmentPool&) = delete;
+
+			//Pool of DEFAULT_SEGMENT_SIZE segments used when streams aren't given one
+			static const std::shared_ptr<CSegmentPool>& GetDefault();
+
+			size_t			GetSegmentSize() const;
+
+			uint8*			Allocate();
+			void			Free(uint8*);
+
+		private:
+			size_t			m_segmentSize = 0;
+			size_t			m_maxFreeCount = 0;
+			std::mutex		m_mutex;
+			std::vector<uint8*>	m_freeSegments;
+		};
+
+		typedef std::shared_ptr<CSegmentPool> SegmentPoolPtr;
+
+		explicit			CChainedBufferStream(SegmentPoolPtr = CSegmentPool::GetDefault());
+							CChainedBufferStream(const CChainedBufferStream&) = delete;
+							CChainedBufferStream(CChainedBufferStream&&);
+		virtual				~CChainedBufferStream();
+
+		CChainedBufferStream&	operator =(const CChainedBufferStream&) = delete;
+		CChainedBufferStream&	operator =(CChainedBufferStream&&);
+
+		void				Seek(int64, STREAM_SEEK_DIRECTION) override;
+		uint64				Tell() override;
+		uint64				Read(void*, uint64) override;
+		uint64				Write(const void*, uint64) override;
+		bool				IsEOF() override;
+		uint64				GetLength() override;
+		uint64				GetRemainingLength() override;
+
+		bool				CanAccessAt() const override;
+		uint64				ReadAt(uint64, void*, uint64) override;
+
+		uint64				GetSize() const;
+		//Gives the segments back to the pool, position is reset
+		void				Clear();
+
+		//Fills vectors pointing at the data from an offset to the end (or until maxCount vectors were filled),
+		//to be given to writev, sendmsg or WSASend. Returns the amount of vectors filled. They stay valid
+		//until the stream is cleared or destroyed.
+		size_t				GetIoVecs(uint64 offset, STREAM_CONST_IOVEC*, size_t maxCount) const;
+
+		//Moves the data of another stream at the end of this one, leaving it empty. Segments are handed over
+		//without copying when both streams use the same pool, position isn't changed.
+		void				Splice(CChainedBufferStream&);
+
+		//Copies the data in a single buffer
+		std::vector<uint8>	ToBuffer() const;
+
+	private:
+		struct SEGMENT
+		{
+			uint8*			data = nullptr;
+			size_t			size = 0;
+			//Position of the first byte of the segment in the stream
+			uint64			offset = 0;
+		};
+
+		size_t				FindSegment(uint64) const;
+
+		SegmentPoolPtr		m_pool;
+		std::vector<SEGMENT>	m_segments;
+		uint64				m_size = 0;
+		uint64				m_position = 0;
+		//Segment holding the position, saves lookups when reading or writing sequentially
+		size_t				m_segmentIndex = 0;
+		bool				m_isEof = false;
+	};
+}
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Stream.h"
+
+namespace Framework
+{
+	class CSpanStream;
+
+	//Binary columnar form of a CSV file meant to be queried many times without parsing text again.
+	//Each column gets a type (integer, floating point or string) and strings with few distinct values
+	//are stored as indices in a dictionary. Rows are split in groups and every column of a group is a
+	//chunk of its own, optionally compressed with zstd, so that reading a column only touches its chunks.
+	namespace ColumnarTable
+	{
+		enum COLUMN_TYPE : uint32
+		{
+			COLUMN_TYPE_INT,
+			COLUMN_TYPE_DOUBLE,
+			COLUMN_TYPE_STRING,
+			COLUMN_TYPE_DICTIONARY,
+		};
+
+		enum
+		{
+			DEFAULT_ROW_GROUP_SIZE = 0x10000,
+			DEFAULT_MAX_DICTIONARY_SIZE = 0x10000,
+			DEFAULT_COMPRESSION_LEVEL = 3,
+		};
+
+		struct CONVERT_OPTIONS
+		{
+			char separator = ',';
+			//Columns are named by their index if there's no header
+			bool hasHeader = true;
+			//Uncompressed chunks are used in place by the reader
+			bool compress = false;
+			int compressionLevel = DEFAULT_COMPRESSION_LEVEL;
+			uint32 rowGroupSize = DEFAULT_ROW_GROUP_SIZE;
+			//String columns with more distinct values than this aren't dictionary encoded
+			uint32 maxDictionarySize = DEFAULT_MAX_DICTIONARY_SIZE;
+		};
+
+		//Goes over the input twice, once to find the type of the columns and once to write them, it has
+		//to be seekable. A column is numeric only if all of its fields are, missing fields are empty strings.
+		void ConvertCsv(CStream& input, CStream& output, const CONVERT_OPTIONS& = CONVERT_OPTIONS());
+
+		//Files start with the magic number, followed by the chunks (aligned on 8 bytes) and a footer
+		//(row count, row group size and column infos, as serialized by an archive). The last 12 bytes are
+		//the footer's offset and the magic number again.
+		struct CHUNK_INFO
+		{
+			template <typename ArchiveType>
+			void Serialize(ArchiveType& archive, uint32)
+			{
+				archive & offset & storedSize & rawSize;
+			}
+
+			uint64 offset = 0;
+			uint64 storedSize = 0;
+			//Same as the stored size if the chunk isn't compressed
+			uint64 rawSize = 0;
+		};
+
+		struct COLUMN_INFO
+		{
+			static const uint32 SERIALIZE_VERSION = 1;
+
+			template <typename ArchiveType>
+			void Serialize(ArchiveType& archive, uint32)
+			{
+				archive & name & type & indexSize & dictionary & chunks;
+			}
+
+			std::string name;
+			COLUMN_TYPE type = COLUMN_TYPE_STRING;
+			//Size of the dictionary indices (1, 2 or 4 bytes)
+			uint32 indexSize = 0;
+			std::vector<std::string> dictionary;
+			std::vector<CHUNK_INFO> chunks;
+		};
+
+		//Values of one column, holds decompressed chunks and points in the reader's stream for the others
+		class CColumn
+		{
+		public:
+			CColumn() = default;
+			CColumn(const CColumn&) = delete;
+			CColumn(CColumn&&) = default;
+
+			CColumn& operator=(const CColumn&) = delete;
+			CColumn& operator=(CColumn&&) = default;
+
+			COLUMN_TYPE GetType() const;
+			uint64 GetRowCount() const;
+
+			//Integer columns only
+			int64 GetInt(uint64) const;
+			//Integer or floating point columns
+			double GetDouble(uint64) const;
+			//String or dictionary columns
+			std::string_view GetString(uint64) const;
+
+			//Dictionary columns only
+			uint32 GetDictionaryIndex(uint64) const;
+			const std::vector<std::string>& GetDictionary() const;
+
+			//Values of numeric columns can be scanned a row group at a time
+			size_t GetChunkCount() const;
+			size_t GetChunkRowCount(size_t) const;
+			const int64* GetChunkInts(size_t) const;
+			const double* GetChunkDoubles(size_t) const;
+
+		private:
+			friend class CReader;
+
+			struct CHUNK
+			{
+				const uint8* data = nullptr;
+				size_t rowCount = 0;
+			};
+
+			const CHUNK& GetRowChunk(uint64, size_t&) const;
+
+			COLUMN_TYPE m_type = COLUMN_TYPE_STRING;
+			uint64 m_rowCount = 0;
+			uint32 m_rowGroupSize = 1;
+			unsigned int m_indexSize = 4;
+			const std::vector<std::string>* m_dictionary = nullptr;
+			std::vector<CHUNK> m_chunks;
+			std::vector<std::vector<uint8>> m_buffers;
+		};
+
+		//Reads a file made by ConvertCsv in place, it's meant to be used with a CMappedFileStream.
+		//Columns point in the stream and the reader, both have to outlive them.
+		class CReader
+		{
+		public:
+			CReader(CSpanStream&);
+			CReader(const CReader&) = delete;
+
+			CReader& operator=(const CReader&) = delete;
+
+			uint64 GetRowCount() const;
+			size_t GetColumnCount() const;
+			const std::string& GetColumnName(size_t) const;
+			COLUMN_TYPE GetColumnType(size_t) const;
+			//Throws if there's no column with that name
+			size_t GetColumnIndex(std::string_view) const;
+
+			//Only reads the chunks of that column
+			CColumn GetColumn(size_t) const;
+
+		private:
+			CSpanStream& m_stream;
+			uint64 m_rowCount = 0;
+			uint32 m_rowGroupSize = 1;
+			std::vector<COLUMN_INFO> m_columns;
+		};
+	}
+}
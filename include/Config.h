@@ -1,20 +1,75 @@
 #pragma once
 
+#include <atomic>
 #include <string>
 #include <map>
 #include <mutex>
 #include "filesystem_def.h"
+#include "signal/Signal.h"
 #include "xml/Node.h"
 
 namespace Framework
 {
 	class CConfig
 	{
+	private:
+		class CPreferenceInteger;
+		class CPreferenceBoolean;
+		class CPreferenceFloat;
+
 	public:
 		typedef fs::path PathType;
+
+		//Typed access to a registered preference that doesn't go through the preference map.
+		//Reads are single atomic loads, changes made through SetPreference* are reported by ValueChanged.
+		template <typename ValueType, typename PreferenceType>
+		class CPreferenceHandle
+		{
+		public:
+			typedef CSignal<void(ValueType)> ValueChangedEvent;
+
+			CPreferenceHandle() = default;
+
+			bool IsValid() const
+			{
+				return m_preference != nullptr;
+			}
+
+			explicit operator bool() const
+			{
+				return IsValid();
+			}
+
+			ValueType Get() const
+			{
+				return m_preference->GetValue();
+			}
+
+			ValueChangedEvent& ValueChanged() const
+			{
+				return m_preference->ValueChanged;
+			}
+
+		private:
+			friend class CConfig;
+
+			CPreferenceHandle(std::shared_ptr<PreferenceType> preference)
+			    : m_preference(std::move(preference))
+			{
+			}
+
+			std::shared_ptr<PreferenceType> m_preference;
+		};
+
+		typedef CPreferenceHandle<int, CPreferenceInteger> IntHandle;
+		typedef CPreferenceHandle<bool, CPreferenceBoolean> BoolHandle;
+		typedef CPreferenceHandle<float, CPreferenceFloat> FloatHandle;
+
 		PathType GetBasePath();
 
-		CConfig(const PathType&, bool readonly = false);
+		//When useCache is set, a binary snapshot of the preferences is kept next to the
+		//config file (same path with '.cache' appended) and used instead of parsing the XML.
+		CConfig(const PathType&, bool readonly = false, bool useCache = false);
 		CConfig(const CConfig&) = delete;
 		virtual ~CConfig();
 
@@ -22,9 +77,10 @@ namespace Framework
 
 		static std::string MakePreferenceName(const std::string&, const std::string& = "", const std::string& = "", const std::string& = "");
 
-		void RegisterPreferenceInteger(const char*, int);
-		void RegisterPreferenceBoolean(const char*, bool);
-		void RegisterPreferenceFloat(const char*, float);
+		//Returned handles are empty if a preference with the same name but another type exists
+		IntHandle RegisterPreferenceInteger(const char*, int);
+		BoolHandle RegisterPreferenceBoolean(const char*, bool);
+		FloatHandle RegisterPreferenceFloat(const char*, float);
 		void RegisterPreferenceString(const char*, const char*);
 		void RegisterPreferencePath(const char*, const PathType&);
 
@@ -42,8 +98,15 @@ namespace Framework
 
 		void Save();
 		PathType GetConfigPath() const;
+		PathType GetCachePath() const;
 
 	private:
+		enum
+		{
+			CACHE_SIGNATURE = 0x47464346, //'FCFG'
+			CACHE_VERSION = 1,
+		};
+
 		enum PREFERENCE_TYPE
 		{
 			TYPE_INTEGER,
@@ -82,8 +145,10 @@ namespace Framework
 			void SetValue(int);
 			void Serialize(Framework::Xml::CNode*) const override;
 
+			IntHandle::ValueChangedEvent ValueChanged;
+
 		private:
-			int m_value;
+			std::atomic<int> m_value;
 		};
 
 		class CPreferenceBoolean : public CPreference
@@ -100,8 +165,10 @@ namespace Framework
 			void SetValue(bool);
 			void Serialize(Framework::Xml::CNode*) const override;
 
+			BoolHandle::ValueChangedEvent ValueChanged;
+
 		private:
-			bool m_value;
+			std::atomic<bool> m_value;
 		};
 
 		class CPreferenceFloat : public CPreference
@@ -118,8 +185,10 @@ namespace Framework
 			void SetValue(float);
 			void Serialize(Framework::Xml::CNode*) const override;
 
+			FloatHandle::ValueChangedEvent ValueChanged;
+
 		private:
-			float m_value = 0;
+			std::atomic<float> m_value;
 		};
 
 		class CPreferenceString : public CPreference
@@ -162,6 +231,8 @@ namespace Framework
 		typedef std::map<std::string, PreferencePtr> PreferenceMapType;
 
 		void Load();
+		bool LoadCache();
+		void SaveCache();
 		void InsertPreference(const PreferencePtr&);
 
 		template <typename Type>
@@ -181,5 +252,6 @@ namespace Framework
 		std::mutex m_mutex;
 		PathType m_path;
 		bool m_readonly;
+		bool m_useCache;
 	};
 }
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "Types.h"
+
+namespace Framework
+{
+	class CCpuFeatures
+	{
+	public:
+		enum FEATURE : uint32
+		{
+			FEATURE_SSE2 = (1 << 0),
+			FEATURE_SSSE3 = (1 << 1),
+			FEATURE_SSE41 = (1 << 2),
+			FEATURE_AVX2 = (1 << 3),
+			FEATURE_AVX512 = (1 << 4), //AVX-512 F and BW
+			FEATURE_NEON = (1 << 5),
+			FEATURE_X86_SHA = (1 << 6),  //SHA-1 and SHA-256 instructions
+			FEATURE_ARM_SHA2 = (1 << 7), //ARMv8 SHA-256 instructions
+			FEATURE_SSE42 = (1 << 8),
+			FEATURE_PCLMUL = (1 << 9),
+			FEATURE_ARM_CRC32 = (1 << 10), //ARMv8 CRC32 and CRC32C instructions
+		};
+
+		//Features are detected once, including OS support for the extended register state
+		static uint32	GetFeatures();
+		static bool		HasFeatures(uint32);
+
+	private:
+		static uint32	DetectFeatures();
+	};
+
+	//Holds kernel variants for a function and selects the best one supported by
+	//the CPU. Variants are meant to be registered during static initialization.
+	template <typename FunctionType>
+	class CKernelDispatcher
+	{
+	public:
+		CKernelDispatcher(FunctionType fallback)
+		    : m_selected(fallback)
+		{
+		}
+
+		//Variants registered later take precedence over earlier ones when supported
+		void Register(uint32 requiredFeatures, FunctionType function)
+		{
+			if(CCpuFeatures::HasFeatures(requiredFeatures))
+			{
+				m_selected = function;
+			}
+		}
+
+		FunctionType Get() const
+		{
+			return m_selected;
+		}
+
+	private:
+		FunctionType m_selected;
+	};
+}
@@ -1,17 +1,114 @@
 #pragma once
 
+#include <functional>
 #include <vector>
 #include <string>
+#include <string_view>
 #include "Stream.h"
 
 namespace Framework
 {
+	class CSpanStream;
+	class CThreadPool;
+
 	namespace Csv
 	{
 		typedef std::vector<std::string> Line;
 		typedef std::vector<Line> Contents;
+		//Rows can be moved out of the batch
+		typedef std::function<void (Contents&)> RowBatchHandler;
+
+		enum
+		{
+			DEFAULT_PARALLEL_CHUNK_SIZE = 0x400000,
+		};
 
 		Contents Parse(CStream&, char separator = ',');
 		void Write(const Contents&, CStream&, char separator = ',');
+
+		//Splits the rest of the stream in chunks of about 'chunkSize' bytes that are parsed concurrently.
+		//Batches of rows (one per chunk) are given to the handler in file order, on the calling thread.
+		//Rows are read like CReader does.
+		void ParseParallel(CSpanStream&, const RowBatchHandler&, CThreadPool* = nullptr, char separator = ',', size_t chunkSize = DEFAULT_PARALLEL_CHUNK_SIZE);
+
+		//Goes over rows one at a time without keeping the whole file in memory.
+		//Fields are views in the reader's buffers and are only valid until the next call to Next.
+		//Unlike Parse, a new line at the end of the input doesn't produce an empty row.
+		class CReader
+		{
+		public:
+			enum
+			{
+				DEFAULT_BUFFER_SIZE = 0x10000,
+			};
+
+			CReader(CStream&, char separator = ',', size_t bufferSize = DEFAULT_BUFFER_SIZE);
+			//Reads rows from memory in place
+			CReader(const char*, size_t, char separator = ',');
+			CReader(const CReader&) = delete;
+
+			CReader& operator=(const CReader&) = delete;
+
+			bool Next();
+
+			size_t GetFieldCount() const;
+			std::string_view GetField(size_t) const;
+			int64 GetInt(size_t) const;
+			double GetDouble(size_t) const;
+
+		private:
+			struct FIELD
+			{
+				//Points in the input if the field didn't need to be unescaped
+				const char* data = nullptr;
+				size_t offset = 0;
+				size_t size = 0;
+			};
+
+			bool ParseRow();
+			void Refill();
+
+			CStream* m_stream = nullptr;
+			char m_separator;
+			std::vector<char> m_buffer;
+			const char* m_position = nullptr;
+			const char* m_end = nullptr;
+			bool m_isSourceEof = false;
+			std::vector<FIELD> m_rowFields;
+			std::vector<std::string_view> m_fields;
+			std::string m_unescaped;
+		};
+
+		//Writes rows through a buffer. Fields are quoted only when they contain
+		//a separator, a quote or a new line, so CReader gives back the same values.
+		class CWriter
+		{
+		public:
+			enum
+			{
+				DEFAULT_BUFFER_SIZE = 0x10000,
+			};
+
+			CWriter(CStream&, char separator = ',', size_t bufferSize = DEFAULT_BUFFER_SIZE);
+			CWriter(const CWriter&) = delete;
+			~CWriter();
+
+			CWriter& operator=(const CWriter&) = delete;
+
+			void WriteField(std::string_view);
+			void WriteRow(const Line&);
+			void EndRow();
+
+			void Flush();
+
+		private:
+			void WriteRaw(const char*, size_t);
+
+			CStream& m_stream;
+			char m_separator;
+			std::vector<char> m_buffer;
+			size_t m_bufferSize = 0;
+			bool m_isRowStart = true;
+		};
 	}
 }
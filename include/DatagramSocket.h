@@ -0,0 +1,96 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include "Types.h"
+#include "SocketDef.h"
+
+namespace Framework
+{
+	//Non-blocking IPv4 UDP socket moving packets in batches. Packet memory is allocated once, for
+	//GetBatchSize packets of up to GetMaxPacketSize bytes in each direction.
+	//On Linux, a batch is received with a single recvmmsg and sent with a single sendmmsg. Consecutive
+	//packets of the same size going to the same address are handed to the kernel as one message that
+	//gets segmented further down the stack (UDP GSO), if the kernel supports it. Other platforms go
+	//through recvfrom/sendto one packet at a time.
+	//Not thread-safe.
+	class CDatagramSocket
+	{
+	public:
+		enum
+		{
+			DEFAULT_BATCH_SIZE = 64,
+			DEFAULT_MAX_PACKET_SIZE = 1472,
+		};
+
+		struct PACKET
+		{
+			const uint8* data = nullptr;
+			size_t size = 0;
+			sockaddr_in address = {};
+		};
+
+		//Port 0 lets the system pick one
+		CDatagramSocket(const sockaddr_in& bindAddress, uint32 batchSize = DEFAULT_BATCH_SIZE, uint32 maxPacketSize = DEFAULT_MAX_PACKET_SIZE);
+		CDatagramSocket(const CDatagramSocket&) = delete;
+		virtual ~CDatagramSocket();
+
+		CDatagramSocket& operator=(const CDatagramSocket&) = delete;
+
+		SOCKET GetSocket() const;
+		sockaddr_in GetLocalAddress() const;
+		uint32 GetBatchSize() const;
+		uint32 GetMaxPacketSize() const;
+
+		//Lets the kernel merge packets of the same flow before they are received (UDP GRO, Linux only).
+		//Every receive slot grows to 64KB. Returns false if it's not supported.
+		bool EnableReceiveCoalescing();
+
+		//Returns true if packets can be received before the timeout
+		bool WaitForPackets(uint32 timeoutMs);
+		//Receives the packets already available, up to a batch, and returns how many there are.
+		//Packets stay valid until the next call. Coalesced packets count as many packets, packets larger
+		//than GetMaxPacketSize are dropped.
+		size_t Receive();
+		const PACKET& GetReceivedPacket(size_t) const;
+
+		//Returns room for a packet of up to GetMaxPacketSize bytes, to be followed by EndPacket.
+		//Sends the queued packets first if all send slots are used.
+		uint8* BeginPacket();
+		void EndPacket(size_t size, const sockaddr_in& address);
+		void Send(const void*, size_t, const sockaddr_in& address);
+		//Sends the queued packets and returns how many went out. Packets the socket's buffer can't
+		//take are dropped, as if they were lost on the way.
+		size_t Flush();
+
+	private:
+		struct SEND_PACKET
+		{
+			size_t size = 0;
+			sockaddr_in address = {};
+		};
+
+		//Per message state for recvmmsg/sendmmsg, platform specific
+		struct BATCH_STATE;
+
+		void AllocateReceiveSlots(size_t slotSize);
+		void AddReceivedPacket(const uint8*, size_t, const sockaddr_in&);
+
+		SOCKET m_fd = INVALID_SOCKET;
+		uint32 m_batchSize = DEFAULT_BATCH_SIZE;
+		uint32 m_maxPacketSize = DEFAULT_MAX_PACKET_SIZE;
+
+		std::vector<uint8> m_receiveBuffer;
+		size_t m_receiveSlotSize = 0;
+		std::vector<PACKET> m_receivedPackets;
+		size_t m_receivedPacketCount = 0;
+		bool m_receiveCoalescing = false;
+
+		std::vector<uint8> m_sendBuffer;
+		std::vector<SEND_PACKET> m_sendPackets;
+		size_t m_sendPacketCount = 0;
+		bool m_sendSegmentation = false;
+
+		std::unique_ptr<BATCH_STATE> m_batchState;
+	};
+}
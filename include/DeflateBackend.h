@@ -0,0 +1,66 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include "Types.h"
+
+namespace Framework
+{
+	//Raw deflate (RFC 1951) codecs with interchangeable implementations. Backends are tried in order of
+	//preference: QAT (hardware offload, FRAMEWORK_HAS_QATZIP), ISA-L (FRAMEWORK_HAS_ISAL) and zlib,
+	//which handles everything. Backends that aren't built in or whose hardware isn't present are skipped.
+	//All of them produce standard deflate data, containers (zip entries, gzip members) are up to the caller.
+	namespace Deflate
+	{
+		enum
+		{
+			DEFAULT_LEVEL = -1,
+		};
+
+		class CCompressor
+		{
+		public:
+			virtual			~CCompressor() = default;
+
+			//Consumes input and fills output, pointers and sizes are advanced. Once finish is set, has to be
+			//called again with the same input until it returns true, meaning the end of the stream was written.
+			virtual bool	Compress(const uint8*& input, size_t& inputSize, uint8*& output, size_t& outputSize, bool finish) = 0;
+		};
+
+		class CDecompressor
+		{
+		public:
+			virtual			~CDecompressor() = default;
+
+			//Same as Compress, returns true once the end of the stream was reached. Throws if the data is invalid.
+			//Not consuming input nor producing output means more input or output space is needed.
+			virtual bool	Decompress(const uint8*& input, size_t& inputSize, uint8*& output, size_t& outputSize) = 0;
+		};
+
+		class CBackend
+		{
+		public:
+			virtual			~CBackend() = default;
+
+			virtual const char*	GetName() const = 0;
+
+			//Null if the backend doesn't handle this level (0 to 9, or DEFAULT_LEVEL), the next one is used instead
+			virtual std::unique_ptr<CCompressor>	CreateCompressor(int level) = 0;
+			virtual std::unique_ptr<CDecompressor>	CreateDecompressor() = 0;
+		};
+
+		//Null if the backend isn't built in or can't be used on this machine
+		CBackend*				GetQatBackend();
+		CBackend*				GetIsalBackend();
+		CBackend&				GetZlibBackend();
+
+		//Available backends, in order of preference
+		std::vector<CBackend*>	GetBackends();
+
+		//Only uses the backend with this name and the ones after it, null to use all of them. Meant for benchmarks and tests.
+		void					SetPreferredBackend(const char*);
+
+		std::unique_ptr<CCompressor>	CreateCompressor(int level = DEFAULT_LEVEL);
+		std::unique_ptr<CDecompressor>	CreateDecompressor();
+	}
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstring>
+#include <functional>
+#include <type_traits>
+#include <utility>
+
+namespace Framework
+{
+	template <typename> class CDelegate;
+
+	//Trivially copyable callable: a call stub and a small inline buffer, never allocates.
+	//Bound to a member function and an object pointer, or a free function, the target is a template
+	//argument and gets called directly from the stub where the compiler can inline it.
+	//Other functions need to be trivially copyable and fit in INLINE_SIZE bytes (ie.: lambdas capturing
+	//a couple of pointers). The delegate doesn't own anything, bound objects need to outlive it.
+	template <typename ResultType, typename... Args>
+	class CDelegate<ResultType (Args...)>
+	{
+	public:
+		enum
+		{
+			INLINE_SIZE = 2 * sizeof(void*),
+		};
+
+		CDelegate() = default;
+
+		//Explicit to stay out of the way of std::function's conversions
+		template <typename FunctionType, typename = std::enable_if_t<!std::is_same_v<std::decay_t<FunctionType>, CDelegate>>>
+		explicit CDelegate(const FunctionType& function)
+		{
+			static_assert(std::is_trivially_copyable_v<FunctionType>, "Delegate functions must be trivially copyable.");
+			static_assert(sizeof(FunctionType) <= INLINE_SIZE, "Delegate function doesn't fit in the inline storage.");
+			static_assert(alignof(FunctionType) <= alignof(void*), "Delegate function alignment is too large.");
+			std::memcpy(m_storage, &function, sizeof(FunctionType));
+			m_stub =
+				[](const void* storage, Args... args) -> ResultType
+				{
+					return std::invoke(*reinterpret_cast<const FunctionType*>(storage), std::forward<Args>(args)...);
+				};
+		}
+
+		template <auto Method, typename ClassType>
+		static CDelegate FromMember(ClassType* object)
+		{
+			CDelegate delegate;
+			std::memcpy(delegate.m_storage, &object, sizeof(ClassType*));
+			delegate.m_stub =
+				[](const void* storage, Args... args) -> ResultType
+				{
+					return std::invoke(Method, *reinterpret_cast<ClassType* const*>(storage), std::forward<Args>(args)...);
+				};
+			return delegate;
+		}
+
+		template <auto Function>
+		static CDelegate FromFunction()
+		{
+			CDelegate delegate;
+			delegate.m_stub =
+				[](const void*, Args... args) -> ResultType
+				{
+					return std::invoke(Function, std::forward<Args>(args)...);
+				};
+			return delegate;
+		}
+
+		ResultType operator ()(Args... args) const
+		{
+			return m_stub(m_storage, std::forward<Args>(args)...);
+		}
+
+		explicit operator bool() const
+		{
+			return m_stub != nullptr;
+		}
+
+	private:
+		typedef ResultType (*StubType)(const void*, Args...);
+
+		alignas(void*) unsigned char m_storage[INLINE_SIZE] = {};
+		StubType m_stub = nullptr;
+	};
+}
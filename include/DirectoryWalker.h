@@ -0,0 +1,83 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include "Types.h"
+#include "filesystem_def.h"
+#include "memory/Arena.h"
+
+namespace Framework
+{
+	class CThreadPool;
+
+	//Lists a directory tree with the platform's bulk listing calls (getdents64 on Linux, FindFirstFileEx
+	//with large fetches on Windows) instead of going through fs::recursive_directory_iterator, which
+	//needs a separate stat for each entry. Directories are listed concurrently on the thread pool.
+	class CDirectoryWalker
+	{
+	public:
+		typedef fs::path::value_type PathChar;
+
+		enum ENTRY_TYPE : uint8
+		{
+			ENTRY_TYPE_FILE,
+			ENTRY_TYPE_DIRECTORY,
+			//Symbolic links (and junctions on Windows) are reported but not followed
+			ENTRY_TYPE_SYMLINK,
+			ENTRY_TYPE_OTHER,
+		};
+
+		enum WALK_FLAGS : uint32
+		{
+			WALK_FLAG_NONE = 0,
+			//Fills in size and modification time. They come with the listing on Windows, elsewhere
+			//they're fetched relative to the directory being listed, right after each batch of names.
+			WALK_FLAG_METADATA = 0x01,
+		};
+
+		struct ENTRY
+		{
+			//Relative to the root, with native separators and null terminated
+			const PathChar*	path = nullptr;
+			uint32			pathLength = 0;
+			ENTRY_TYPE		type = ENTRY_TYPE_OTHER;
+			bool			hasMetadata = false;
+			uint64			size = 0;
+			//Seconds since the Unix epoch
+			int64			modificationTime = 0;
+		};
+
+		//Entries and their paths live in arenas owned by the listing, in no particular order
+		class CListing
+		{
+		public:
+							CListing() = default;
+							CListing(CListing&&);
+							CListing(const CListing&) = delete;
+
+			CListing&		operator =(CListing&&);
+			CListing&		operator =(const CListing&) = delete;
+
+			const ENTRY*	begin() const;
+			const ENTRY*	end() const;
+			const ENTRY&	operator [](size_t) const;
+
+			size_t			GetEntryCount() const;
+			//Directories that couldn't be opened or read completely (ie.: missing permissions)
+			size_t			GetErrorCount() const;
+
+		private:
+			friend class CDirectoryWalker;
+
+			typedef std::unique_ptr<Memory::CArena> ArenaPtr;
+
+			std::vector<ArenaPtr>	m_arenas;
+			const ENTRY*	m_entries = nullptr;
+			size_t			m_entryCount = 0;
+			size_t			m_errorCount = 0;
+		};
+
+		//Throws if the root isn't a directory. Waits on the pool like CTaskGroup does, so it can be called from a task.
+		static CListing		Walk(const fs::path&, uint32 flags = WALK_FLAG_NONE, CThreadPool* = nullptr);
+	};
+}
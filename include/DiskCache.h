@@ -0,0 +1,122 @@
+#pragma once
+
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "HashUtils.h"
+#include "MappedFileStream.h"
+#include "Types.h"
+#include "filesystem_def.h"
+
+namespace Framework
+{
+	//Content-addressed cache of blobs kept as one file per entry in a directory (usually under
+	//PathUtils::GetCachePath), meant for results worth keeping across runs: decoded images,
+	//downloads, compiled shaders. Keys are XXH3-128 hashes of whatever identifies the content.
+	//Entries are written to a temporary file and renamed in place, so a crash never leaves a
+	//partial entry behind, and read through memory mappings. Least recently used entries are
+	//evicted when the total size goes over the limit. The LRU order and sizes are kept in a
+	//small index file, the directory is scanned again if the index is missing or invalid.
+	//Thread safe, but a directory should only be used by one process at a time.
+	class CDiskCache
+	{
+	public:
+		typedef HashUtils::HASH128 Key;
+		typedef std::unique_ptr<CMappedFileStream> EntryStreamPtr;
+		typedef std::function<std::vector<uint8> ()> ProduceFunction;
+
+		//Index is loaded from the directory, which is created if it doesn't exist
+						CDiskCache(fs::path, uint64 maxSize);
+						CDiskCache(const CDiskCache&) = delete;
+						~CDiskCache();
+
+		CDiskCache&		operator =(const CDiskCache&) = delete;
+
+		static fs::path	GetDefaultDirectory(const char* name);
+
+		static Key		MakeKey(const void*, size_t);
+		static Key		MakeKey(const std::string&);
+
+		//Null if the entry isn't cached. Marks the entry as most recently used.
+		//On Windows, an entry can't be replaced or evicted while a stream on it is alive.
+		EntryStreamPtr	Find(const Key&);
+		//Entries bigger than the cache's size limit aren't kept, false if the entry couldn't be written
+		bool			Insert(const Key&, const void*, size_t);
+		//Calls the function and caches its result if the entry isn't cached already, null if the result couldn't be cached
+		EntryStreamPtr	FindOrInsert(const Key&, const ProduceFunction&);
+		void			Remove(const Key&);
+		void			Clear();
+
+		//Writes the index if entries changed since it was loaded or last written, done on destruction as well
+		void			Flush();
+
+		uint64			GetTotalSize() const;
+		size_t			GetEntryCount() const;
+
+	private:
+		struct KeyHasher
+		{
+			size_t operator()(const Key& key) const
+			{
+				return static_cast<size_t>(key.low);
+			}
+		};
+
+		typedef std::list<Key> LruList;
+
+		struct ENTRY
+		{
+			uint64				size = 0;
+			LruList::iterator	lruIterator;
+		};
+
+		typedef std::unordered_map<Key, ENTRY, KeyHasher> EntryMap;
+
+		struct INDEX_HEADER
+		{
+			uint32		magic;
+			uint32		version;
+			uint64		entryCount;
+		};
+
+		struct INDEX_RECORD
+		{
+			uint64		keyLow;
+			uint64		keyHigh;
+			uint64		size;
+		};
+
+		enum : uint32
+		{
+			INDEX_MAGIC = 0x58444B44, //'DKDX'
+			INDEX_VERSION = 1,
+		};
+
+		fs::path		GetEntryPath(const Key&) const;
+		fs::path		GetIndexPath() const;
+		bool			LoadIndex();
+		void			RebuildIndex();
+		void			WriteIndex();
+		void			AddEntry(const Key&, uint64);
+		void			RemoveEntry(EntryMap::iterator);
+		void			EvictEntries(uint64 reservedSize);
+		void			InvalidateIndexFile();
+
+		fs::path		m_directory;
+		uint64			m_maxSize = 0;
+
+		mutable std::mutex	m_mutex;
+		EntryMap		m_entries;
+		//Least recently used first
+		LruList			m_lruList;
+		uint64			m_totalSize = 0;
+		bool			m_indexDirty = false;
+		//Index file is removed as soon as entries change, so that a crash before the next flush leads to a rescan
+		bool			m_indexOnDisk = false;
+		uint32			m_tempFileCounter = 0;
+	};
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include "Types.h"
 #ifdef _MSC_VER
 #include <stdlib.h>
@@ -16,6 +17,20 @@ namespace Framework
 		template <typename IntType>
 		static void FromMSBF(IntType&);
 
+		static constexpr bool IsHostBigEndian()
+		{
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+			return true;
+#else
+			return false;
+#endif
+		}
+
+		//Reverse the bytes of each value of an array with SIMD shuffles, output can be the same as input
+		static void SwapArray16(void*, const void*, size_t count);
+		static void SwapArray32(void*, const void*, size_t count);
+		static void SwapArray64(void*, const void*, size_t count);
+
 		static uint16 FromMSBF16(uint16 value)
 		{
 			return __builtin_bswap16(value);
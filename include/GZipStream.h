@@ -1,11 +1,16 @@
 #ifndef _GZIPSTREAM_H_
 #define _GZIPSTREAM_H_
 
+#include <memory>
 #include <zstd_zlibwrapper.h>
+#include "DeflateBackend.h"
+#include "StdStream.h"
 #include "Stream.h"
 
 namespace Framework
 {
+	//Files opened for writing ("w" mode, with an optional level digit) are compressed with the deflate
+	//backends and hold a single gzip member. Other modes go through zlib's gzFile.
 	class CGZipStream : public CStream
 	{
 	public:
@@ -18,7 +23,19 @@ namespace Framework
 		bool		IsEOF();
 
 	private:
-		gzFile		m_File;
+		enum
+		{
+			BUFFERSIZE = 0x2000,
+		};
+
+		void		Compress(const uint8*, size_t, bool);
+
+		gzFile		m_File = Z_NULL;
+
+		CStdStream	m_outputStream;
+		std::unique_ptr<Deflate::CCompressor>	m_compressor;
+		uint32		m_crc = 0;
+		uint64		m_uncompressedLength = 0;
 	};
 }
 
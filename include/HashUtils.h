@@ -3,12 +3,131 @@
 #include "Types.h"
 #include <array>
 #include <cstddef>
+#include <memory>
+#include "filesystem_def.h"
 
 namespace Framework
 {
+	class CThreadPool;
+
 	namespace HashUtils
 	{
+		//Only for protocols requiring it (ie.: WebSocket handshakes), SHA-1 isn't collision resistant
+		std::array<uint8, 0x14> ComputeSha1(const void*, size_t);
 		std::array<uint8, 0x20> ComputeSha256(const void*, size_t);
 		std::array<uint8, 0x20> ComputeHmacSha256(const void*, size_t, const void*, size_t);
+
+		//Computes a SHA-256 hash over data given in several parts. Uses the CPU's hashing
+		//instructions (SHA extensions on x86, ARMv8 crypto extensions) when available.
+		class CSha256Hasher
+		{
+		public:
+			CSha256Hasher();
+			CSha256Hasher(const CSha256Hasher&) = delete;
+			~CSha256Hasher();
+
+			CSha256Hasher& operator=(const CSha256Hasher&) = delete;
+
+			void Update(const void*, size_t);
+			//Can only be called once
+			std::array<uint8, 0x20> Finalize();
+
+		private:
+			struct CONTEXT;
+			std::unique_ptr<CONTEXT> m_context;
+		};
+
+		//CRC-32 as used by zlib, zip and png, and CRC-32C (Castagnoli) as used by iSCSI and ext4.
+		//Pass the previous result to continue a computation over several parts, 0 to start one.
+		uint32 ComputeCrc32(const void*, size_t, uint32 crc = 0);
+		uint32 ComputeCrc32c(const void*, size_t, uint32 crc = 0);
+
+		struct HASH128
+		{
+			uint64 low = 0;
+			uint64 high = 0;
+
+			bool operator==(const HASH128& rhs) const
+			{
+				return (low == rhs.low) && (high == rhs.high);
+			}
+
+			bool operator!=(const HASH128& rhs) const
+			{
+				return !(*this == rhs);
+			}
+		};
+
+		//Fast non-cryptographic hashes for hash tables, dedup and cache keys. Results are the same
+		//as XXH3 64 and 128 bits from xxHash 0.8, so they can be checked by other tools.
+		uint64 ComputeXxh3_64(const void*, size_t, uint64 seed = 0);
+		HASH128 ComputeXxh3_128(const void*, size_t, uint64 seed = 0);
+
+		class CXxh3Hasher
+		{
+		public:
+			CXxh3Hasher(uint64 seed = 0);
+
+			void Update(const void*, size_t);
+			//Can be called at any time, more data can be added afterwards
+			uint64 GetHash64() const;
+			HASH128 GetHash128() const;
+
+		private:
+			enum
+			{
+				STRIPE_SIZE = 64,
+				BUFFER_SIZE = 256,
+				SECRET_SIZE = 192,
+			};
+
+			void DigestLong(uint64*) const;
+
+			alignas(32) uint64 m_acc[8];
+			alignas(32) uint8 m_buffer[BUFFER_SIZE];
+			uint8 m_secret[SECRET_SIZE];
+			size_t m_bufferSize = 0;
+			size_t m_stripeCount = 0;
+			uint64 m_totalSize = 0;
+			uint64 m_seed = 0;
+		};
+
+		//BLAKE3 (https://github.com/BLAKE3-team/BLAKE3), 32 bytes output, for integrity checks of large
+		//files and downloads. Input is split in 1KB chunks hashed several at a time with SIMD, subtrees
+		//of the hash tree are spread on the thread pool's threads when there's one.
+		std::array<uint8, 0x20> ComputeBlake3(const void*, size_t, CThreadPool* = nullptr);
+		//Hashes a memory mapped file, doesn't go through a read buffer
+		std::array<uint8, 0x20> ComputeBlake3File(const fs::path&, CThreadPool* = nullptr);
+
+		//Single threaded, full chunks are still hashed with SIMD when parts are large enough
+		class CBlake3Hasher
+		{
+		public:
+			CBlake3Hasher();
+
+			void Update(const void*, size_t);
+			//Can be called at any time, more data can be added afterwards
+			std::array<uint8, 0x20> GetHash() const;
+
+		private:
+			enum
+			{
+				BLOCK_SIZE = 64,
+				CHUNK_SIZE = 1024,
+				//Enough for 2^64 bytes of input
+				MAX_DEPTH = 54,
+			};
+
+			void CompressBlock();
+			void PushChunkValue(const uint32*);
+
+			uint32 m_chunkValue[8];
+			uint8 m_block[BLOCK_SIZE];
+			size_t m_blockSize = 0;
+			unsigned int m_chunkBlockCount = 0;
+			uint64 m_chunkCounter = 0;
+			uint32 m_stack[MAX_DEPTH][8];
+			unsigned int m_stackSize = 0;
+		};
 	};
 }
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <vector>
+#include <zstd_zlibwrapper.h>
+#include "InflateIndex.h"
+
+namespace Framework
+{
+	//Seekable read-only view over compressed data that resumes inflation from the
+	//nearest checkpoint of an index built for the same data. Positions in the compressed
+	//stream are relative to where it was when this stream was constructed.
+	class CIndexedInflateStream : public CStream
+	{
+	public:
+							CIndexedInflateStream(CStream&, const CInflateIndex&);
+							CIndexedInflateStream(const CIndexedInflateStream&) = delete;
+		virtual				~CIndexedInflateStream();
+
+		CIndexedInflateStream& operator =(const CIndexedInflateStream&) = delete;
+
+		void				Seek(int64, STREAM_SEEK_DIRECTION) override;
+		uint64				Tell() override;
+		uint64				Read(void*, uint64) override;
+		uint64				Write(const void*, uint64) override;
+		bool				IsEOF() override;
+		uint64				GetLength() override;
+
+	private:
+		enum
+		{
+			BUFFER_SIZE = 0x4000,
+			MAX_CHUNK_SIZE = 0x40000000,
+		};
+
+		void				Reposition(const CInflateIndex::POINT&);
+		uint64				Inflate(void*, uint64);
+
+		CStream&			m_stream;
+		const CInflateIndex&	m_index;
+		uint64				m_origin = 0;
+		z_stream			m_zStream;
+		bool				m_isInflating = false;
+		bool				m_isStreamEnd = false;
+		std::vector<uint8>	m_inputBuffer;
+		uint64				m_position = 0;
+		uint64				m_inflatePosition = 0;
+	};
+}
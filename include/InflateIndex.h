@@ -0,0 +1,66 @@
+#pragma once
+
+#include <vector>
+#include "Stream.h"
+
+namespace Framework
+{
+	//Checkpoints taken at deflate block boundaries while inflating a stream once (as in zlib's zran example).
+	//Each checkpoint has the inflater's dictionary, allowing inflation to resume from there
+	//instead of from the beginning of the stream. Positions are relative to where the compressed
+	//stream was when the index was built.
+	class CInflateIndex
+	{
+	public:
+		enum FORMAT
+		{
+			//Bare deflate data, ie.: zip entries
+			FORMAT_RAW,
+			FORMAT_GZIP,
+		};
+
+		enum
+		{
+			DEFAULT_SPAN_SIZE = 0x100000,
+			WINDOW_SIZE = 0x8000,
+		};
+
+		struct POINT
+		{
+			uint64				compressedOffset = 0;
+			uint64				uncompressedOffset = 0;
+			//Bits of the byte before compressedOffset that belong to the block
+			uint8				bitCount = 0;
+			std::vector<uint8>	window;
+		};
+		typedef std::vector<POINT> PointArray;
+
+							CInflateIndex() = default;
+
+		//Inflates the whole stream, adding a checkpoint about every spanSize bytes of output
+		static CInflateIndex	Build(CStream&, FORMAT, uint64 spanSize = DEFAULT_SPAN_SIZE);
+
+		//Sidecar file persistence
+		static CInflateIndex	Load(CStream&);
+		void				Save(CStream&) const;
+
+		FORMAT				GetFormat() const;
+		uint64				GetUncompressedLength() const;
+		const PointArray&	GetPoints() const;
+
+		//Last checkpoint at or before the uncompressed offset
+		const POINT&		FindPoint(uint64) const;
+
+	private:
+		enum
+		{
+			FILE_SIGNATURE = 0x58444946,	//'FIDX'
+			FILE_VERSION = 1,
+			BUFFER_SIZE = 0x4000,
+		};
+
+		FORMAT				m_format = FORMAT_RAW;
+		uint64				m_uncompressedLength = 0;
+		PointArray			m_points;
+	};
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include "Singleton.h"
+#include "Stream.h"
+
+namespace Framework
+{
+	class CStreamStats
+	{
+	public:
+		enum OPERATION
+		{
+			OPERATION_READ,
+			OPERATION_WRITE,
+			OPERATION_SEEK,
+			OPERATION_TELL,
+			OPERATION_FLUSH,
+			OPERATION_COUNT,
+		};
+
+		enum
+		{
+			//Bucket 0 is < 1us, bucket N is [2^(N - 1), 2^N) us, last bucket takes everything above
+			HISTOGRAM_BUCKET_COUNT = 24,
+		};
+
+		struct OPERATION_STATS
+		{
+			std::atomic<uint64>	calls;
+			std::atomic<uint64>	bytes;
+			std::atomic<uint64>	microseconds;
+			std::array<std::atomic<uint64>, HISTOGRAM_BUCKET_COUNT> histogram;
+		};
+
+							CStreamStats();
+
+		void				Record(OPERATION, uint64 bytes, uint64 microseconds);
+		void				Reset();
+		const OPERATION_STATS& GetOperationStats(OPERATION) const;
+
+		static const char*	GetOperationName(OPERATION);
+
+	private:
+		std::array<OPERATION_STATS, OPERATION_COUNT> m_stats;
+	};
+
+	class CStreamStatsRegistry : public CSingleton<CStreamStatsRegistry>
+	{
+	public:
+		typedef std::shared_ptr<CStreamStats> StatsPtr;
+
+		//Streams registered with the same name share their stats
+		StatsPtr			GetStats(const std::string&);
+		void				Reset();
+
+		std::string			DumpJson();
+		std::string			DumpCsv();
+
+	private:
+		typedef std::map<std::string, StatsPtr> StatsMap;
+
+		std::mutex			m_mutex;
+		StatsMap			m_stats;
+	};
+
+	//Forwards everything to another stream while recording calls, bytes and latencies
+	class CInstrumentedStream : public CStream
+	{
+	public:
+						CInstrumentedStream(CStream&, const std::string& name);
+						CInstrumentedStream(CStream&, CStreamStatsRegistry::StatsPtr);
+		virtual			~CInstrumentedStream() = default;
+
+		void			Seek(int64, STREAM_SEEK_DIRECTION) override;
+		uint64			Tell() override;
+		uint64			Read(void*, uint64) override;
+		uint64			Write(const void*, uint64) override;
+		bool			IsEOF() override;
+		void			Flush() override;
+		uint64			GetLength() override;
+		uint64			GetRemainingLength() override;
+
+		bool			CanAccessAt() const override;
+		uint64			ReadAt(uint64, void*, uint64) override;
+		uint64			WriteAt(uint64, const void*, uint64) override;
+
+		const CStreamStats& GetStats() const;
+
+	private:
+		CStream&		m_stream;
+		CStreamStatsRegistry::StatsPtr m_stats;
+	};
+}
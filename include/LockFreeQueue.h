@@ -1,63 +1,237 @@
 #pragma once
 
 #include <atomic>
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <utility>
 
+namespace LockFreeQueue
+{
+	enum
+	{
+		CACHE_LINE_SIZE = 64,
+	};
+
+	template <typename IndexType>
+	IndexType GetCapacity(IndexType maxItemCount)
+	{
+		//Rounding up anything above the largest power of two would wrap around
+		if(maxItemCount > ((std::numeric_limits<IndexType>::max() >> 1) + 1))
+		{
+			throw std::runtime_error("Item count is too large.");
+		}
+		IndexType capacity = 1;
+		while(capacity < maxItemCount)
+		{
+			capacity <<= 1;
+		}
+		return capacity;
+	}
+}
+
+//Single producer, single consumer ring. Capacity is rounded up to a power of two.
+//Each side keeps a copy of the other side's index and only reloads it when the ring looks full (or empty).
 template <typename ValueType>
 class CLockFreeQueue
 {
 public:
 	CLockFreeQueue(unsigned int maxItemCount)
-		: m_prodIndex(0)
-		, m_consIndex(0)
-		, m_itemCount(0)
-		, m_maxItemCount(maxItemCount)
+		: m_mask(LockFreeQueue::GetCapacity(maxItemCount) - 1)
+		, m_items(new ValueType[m_mask + 1])
 	{
-		m_items = new ValueType[m_maxItemCount];
 	}
 
-	virtual ~CLockFreeQueue()
-	{
-		delete [] m_items;
-	}
+	CLockFreeQueue(const CLockFreeQueue&) = delete;
 
+	virtual ~CLockFreeQueue() = default;
+
+	CLockFreeQueue& operator =(const CLockFreeQueue&) = delete;
+
+	//Consumer thread only
 	bool TryPop(ValueType& item)
 	{
-		if(m_itemCount == 0)
+		auto consIndex = m_consIndex.load(std::memory_order_relaxed);
+		if(consIndex == m_cachedProdIndex)
 		{
-			return false;
+			m_cachedProdIndex = m_prodIndex.load(std::memory_order_acquire);
+			if(consIndex == m_cachedProdIndex)
+			{
+				return false;
+			}
 		}
 
-		item = m_items[m_consIndex];
+		item = std::move(m_items[consIndex & m_mask]);
+		m_consIndex.store(consIndex + 1, std::memory_order_release);
 
-		m_consIndex++;
-		m_consIndex %= m_maxItemCount;
+		return true;
+	}
 
-		m_itemCount--;
+	//Producer thread only
+	bool TryPush(const ValueType& item)
+	{
+		auto prodIndex = m_prodIndex.load(std::memory_order_relaxed);
+		if((prodIndex - m_cachedConsIndex) > m_mask)
+		{
+			m_cachedConsIndex = m_consIndex.load(std::memory_order_acquire);
+			if((prodIndex - m_cachedConsIndex) > m_mask)
+			{
+				return false;
+			}
+		}
+
+		m_items[prodIndex & m_mask] = item;
+		m_prodIndex.store(prodIndex + 1, std::memory_order_release);
 
 		return true;
 	}
 
-	bool TryPush(const ValueType& item)
+	unsigned int GetCapacity() const
+	{
+		return m_mask + 1;
+	}
+
+private:
+	const unsigned int			m_mask;
+	std::unique_ptr<ValueType[]>	m_items;
+
+	alignas(LockFreeQueue::CACHE_LINE_SIZE) std::atomic<unsigned int>	m_prodIndex = {0};
+	unsigned int				m_cachedConsIndex = 0;
+
+	alignas(LockFreeQueue::CACHE_LINE_SIZE) std::atomic<unsigned int>	m_consIndex = {0};
+	unsigned int				m_cachedProdIndex = 0;
+};
+
+//Bounded multiple producer, multiple consumer queue (Dmitry Vyukov's design). Each cell has a sequence
+//number telling whether it's ready to be written or read for a given position. Capacity is rounded up
+//to a power of two. Batch operations claim several consecutive cells at once and can transfer less
+//items than requested.
+template <typename ValueType>
+class CLockFreeMpmcQueue
+{
+public:
+	CLockFreeMpmcQueue(unsigned int maxItemCount)
+		: m_mask(LockFreeQueue::GetCapacity<size_t>(maxItemCount) - 1)
+		, m_cells(new CELL[m_mask + 1])
 	{
-		if(m_itemCount == m_maxItemCount)
+		for(size_t i = 0; i <= m_mask; i++)
 		{
-			return false;
+			m_cells[i].sequence.store(i, std::memory_order_relaxed);
 		}
+	}
 
-		m_items[m_prodIndex] = item;
+	CLockFreeMpmcQueue(const CLockFreeMpmcQueue&) = delete;
 
-		m_prodIndex++;
-		m_prodIndex %= m_maxItemCount;
+	virtual ~CLockFreeMpmcQueue() = default;
 
-		m_itemCount++;
+	CLockFreeMpmcQueue& operator =(const CLockFreeMpmcQueue&) = delete;
 
-		return true;
+	bool TryPop(ValueType& item)
+	{
+		return TryPopBatch(&item, 1) == 1;
+	}
+
+	bool TryPush(const ValueType& item)
+	{
+		return TryPushBatch(&item, 1) == 1;
+	}
+
+	//Returns the number of items popped, those are always the oldest ones in the queue
+	size_t TryPopBatch(ValueType* items, size_t count)
+	{
+		if(count == 0) return 0;
+		size_t pos = m_dequeuePos.load(std::memory_order_relaxed);
+		while(1)
+		{
+			ptrdiff_t firstDiff = 0;
+			size_t available = CountCells(pos, count, 1, firstDiff);
+			if(available == 0)
+			{
+				if(firstDiff < 0) return 0;
+				//Another consumer got that position
+				pos = m_dequeuePos.load(std::memory_order_relaxed);
+				continue;
+			}
+			if(m_dequeuePos.compare_exchange_weak(pos, pos + available, std::memory_order_relaxed))
+			{
+				for(size_t i = 0; i < available; i++)
+				{
+					auto& cell = m_cells[(pos + i) & m_mask];
+					items[i] = std::move(cell.value);
+					cell.sequence.store(pos + i + m_mask + 1, std::memory_order_release);
+				}
+				return available;
+			}
+		}
+	}
+
+	//Returns the number of items pushed, those are always the first ones of the array
+	size_t TryPushBatch(const ValueType* items, size_t count)
+	{
+		if(count == 0) return 0;
+		size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+		while(1)
+		{
+			ptrdiff_t firstDiff = 0;
+			size_t available = CountCells(pos, count, 0, firstDiff);
+			if(available == 0)
+			{
+				if(firstDiff < 0) return 0;
+				//Another producer got that position
+				pos = m_enqueuePos.load(std::memory_order_relaxed);
+				continue;
+			}
+			if(m_enqueuePos.compare_exchange_weak(pos, pos + available, std::memory_order_relaxed))
+			{
+				for(size_t i = 0; i < available; i++)
+				{
+					auto& cell = m_cells[(pos + i) & m_mask];
+					cell.value = items[i];
+					cell.sequence.store(pos + i + 1, std::memory_order_release);
+				}
+				return available;
+			}
+		}
+	}
+
+	size_t GetCapacity() const
+	{
+		return m_mask + 1;
 	}
 
 private:
-	ValueType*					m_items;
-	std::atomic<unsigned int>	m_itemCount;
-	unsigned int				m_maxItemCount;
-	unsigned int				m_prodIndex;
-	unsigned int				m_consIndex;
+	struct CELL
+	{
+		std::atomic<size_t>		sequence;
+		ValueType				value;
+	};
+
+	//Counts consecutive cells from pos that are ready (sequence is position + offset).
+	//firstDiff tells if the first cell is late (full/empty queue) or ahead (pos is stale).
+	size_t CountCells(size_t pos, size_t count, size_t offset, ptrdiff_t& firstDiff) const
+	{
+		size_t available = 0;
+		for(; available < count; available++)
+		{
+			size_t cellPos = pos + available;
+			size_t sequence = m_cells[cellPos & m_mask].sequence.load(std::memory_order_acquire);
+			auto diff = static_cast<ptrdiff_t>(sequence - (cellPos + offset));
+			if(diff != 0)
+			{
+				if(available == 0)
+				{
+					firstDiff = diff;
+				}
+				break;
+			}
+		}
+		return available;
+	}
+
+	const size_t				m_mask;
+	std::unique_ptr<CELL[]>		m_cells;
+
+	alignas(LockFreeQueue::CACHE_LINE_SIZE) std::atomic<size_t>	m_enqueuePos = {0};
+	alignas(LockFreeQueue::CACHE_LINE_SIZE) std::atomic<size_t>	m_dequeuePos = {0};
 };
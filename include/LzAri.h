@@ -1,5 +1,6 @@
 #pragma once
 
+#include <vector>
 #include "Types.h"
 #include "Stream.h"
 
@@ -11,6 +12,11 @@ namespace Framework
 		static void		Compress(Framework::CStream& dst, Framework::CStream& src);
 		static void		Decompress(Framework::CStream& dst, Framework::CStream& src);
 
+		//Work on memory directly, output is replaced
+		static void		Compress(const void*, size_t, std::vector<uint8>&);
+		//Returns the amount of compressed data that was used
+		static size_t	Decompress(const void*, size_t, std::vector<uint8>&);
+
 	private:
 		enum
 		{
@@ -18,7 +24,6 @@ namespace Framework
 			F			= 60,		/* upper limit for match_length */
 			THRESHOLD	= 2,		/* encode string into position and length
 									   if match_length is greater than this */
-			NIL			= N,		/* index for root of binary search trees */
 
 			M			= 15,
 
@@ -34,16 +39,21 @@ namespace Framework
 			N_CHAR		= (256 - THRESHOLD + F) /* character code = 0, 1, ..., N_CHAR - 1 */
 		};
 
+		enum
+		{
+			//Matches can't reach further back than what the original ring buffer kept
+			MAX_DISTANCE		= N - F,
+			HASH_BITS			= 15,
+			HASH_SIZE			= (1 << HASH_BITS),
+			MAX_CHAIN_LENGTH	= 256,
+		};
+
 		virtual					~CLzAri() = default;
 
-		void					PutBit(int);
+		void					PutBits(int, int);
 		void					FlushBitBuffer();
 		int						GetBit();
 
-		void					InitTree();
-		void					InsertNode(int);
-		void					DeleteNode(int);
-
 		void					StartModel();
 		void					UpdateModel(int);
 
@@ -60,12 +70,8 @@ namespace Framework
 		int						DecodeChar();
 		int						DecodePosition();
 
-		void					Encode();
-		void					Decode();
-
-		unsigned char			text_buf[N + F - 1];	/* ring buffer of size N, with extra F-1 bytes to facilitate string comparison */
-		int						match_position, match_length;  /* of longest match.  These are set by the InsertNode() procedure. */
-		int						lson[N + 1], rson[N + 257], dad[N + 1];  /* left & right children & parents -- These constitute binary search trees. */
+		void					Encode(const uint8*, size_t);
+		void					Decode(uint32);
 
 		uint32					low = 0, high = Q4, value = 0;
 		int						shifts = 0;				/* counts for magnifying low and high around Q2 */
@@ -74,12 +80,16 @@ namespace Framework
 		unsigned int			sym_cum[N_CHAR + 1];	/* cumulative freq for symbols */
 		unsigned int			position_cum[N + 1];	/* cumulative freq for positions */
 
-		Framework::CStream*		inputStream = nullptr;
-		Framework::CStream*		outputStream = nullptr;
-
-		unsigned int			putBuffer = 0;
-		unsigned int			putMask = 128;
-		unsigned int			getBuffer = 0;
-		unsigned int			getMask = 0;
+		//Bits are gathered in 32-bit words, most significant bit first
+		std::vector<uint8>*		output = nullptr;
+		uint32					putBuffer = 0;
+		int						putCount = 0;
+
+		const uint8*			input = nullptr;
+		size_t					inputSize = 0;
+		size_t					inputPosition = 0;
+		uint32					getBuffer = 0;
+		int						getCount = 0;
+		uint64					bitsRead = 0;
 	};
 }
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "SpanStream.h"
+#include "filesystem_def.h"
+
+namespace Framework
+{
+	//Read-only stream over a memory mapped file. Data can be accessed
+	//directly through GetSpan without being copied in a caller buffer.
+	class CMappedFileStream : public CSpanStream
+	{
+	public:
+						CMappedFileStream(const fs::path&);
+						CMappedFileStream(const CMappedFileStream&) = delete;
+		virtual			~CMappedFileStream();
+
+		CMappedFileStream& operator =(const CMappedFileStream&) = delete;
+
+		void			Seek(int64, STREAM_SEEK_DIRECTION) override;
+		uint64			Tell() override;
+		uint64			Read(void*, uint64) override;
+		uint64			Write(const void*, uint64) override;
+		bool			IsEOF() override;
+		uint64			GetLength() override;
+		uint64			GetRemainingLength() override;
+
+		bool			CanAccessAt() const override;
+		uint64			ReadAt(uint64, void*, uint64) override;
+
+		const uint8*	GetData() const override;
+		const uint8*	GetSpan(uint64 offset, uint64 length) const override;
+
+	private:
+		const uint8*	m_data = nullptr;
+		uint64			m_size = 0;
+		uint64			m_position = 0;
+		bool			m_isEof = false;
+#ifdef _WIN32
+		void*			m_file = nullptr;
+		void*			m_mapping = nullptr;
+#endif
+	};
+}
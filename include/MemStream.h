@@ -1,5 +1,6 @@
 #pragma once
 
+#include <vector>
 #include "Stream.h"
 
 namespace Framework
@@ -8,11 +9,16 @@ namespace Framework
 	class CMemStream : public CStream
 	{
 	public:
+		typedef std::vector<uint8> Buffer;
+
 							CMemStream() = default;
-							CMemStream(const CMemStream&);
-		virtual				~CMemStream();
+							CMemStream(const CMemStream&) = default;
+							CMemStream(CMemStream&&) = default;
+		explicit			CMemStream(Buffer&&);
+		virtual				~CMemStream() = default;
 
 		CMemStream&			operator =(const CMemStream&) = delete;
+		CMemStream&			operator =(CMemStream&&) = default;
 
 		uint64				Read(void*, uint64);
 		uint64				Write(const void*, uint64);
@@ -20,18 +26,21 @@ namespace Framework
 		void				Seek(int64, STREAM_SEEK_DIRECTION);
 		bool				IsEOF();
 		void				ResetBuffer();
-		void				Allocate(unsigned int);
+		void				Allocate(uint64);
+		void				Reserve(uint64);
 		void				Truncate();
-		uint8*				GetBuffer() const;
-		unsigned int		GetSize() const;
+		uint8*				GetBuffer();
+		const uint8*		GetBuffer() const;
+		uint64				GetSize() const;
 
-	private:
-		void				CopyFrom(const CMemStream&);
+		//Takes ownership of a buffer without copying it, position is reset
+		void				AdoptBuffer(Buffer&&);
+		//Gives away the buffer without copying it, stream is left empty
+		Buffer				ReleaseBuffer();
 
-		unsigned int		m_size = 0;
-		unsigned int		m_grow = 0;
-		unsigned int		m_position = 0;
-		uint8*				m_data = nullptr;
+	private:
+		Buffer				m_data;
+		uint64				m_position = 0;
 		bool				m_isEof = false;
 	};
 
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include "Singleton.h"
+#include "Types.h"
+
+namespace Framework
+{
+	namespace Metrics
+	{
+		//Monotonic count, split in shards on separate cache lines so that threads incrementing
+		//it at the same time don't contend. Reading sums the shards.
+		class CCounter
+		{
+		public:
+			enum
+			{
+				SHARD_COUNT = 16,
+			};
+
+			CCounter();
+
+			void		Add(uint64 = 1);
+			uint64		GetValue() const;
+
+		private:
+			struct alignas(64) SHARD
+			{
+				std::atomic<uint64>	value;
+			};
+
+			std::array<SHARD, SHARD_COUNT>	m_shards;
+		};
+
+		class CGauge
+		{
+		public:
+			CGauge();
+
+			void		Set(int64);
+			void		Add(int64);
+			int64		GetValue() const;
+
+		private:
+			std::atomic<int64>	m_value;
+		};
+
+		//Log-linear buckets in the manner of HdrHistogram: each power of two is split in SUB_BUCKET_COUNT
+		//linear buckets, values are kept with a relative error of at most 1 / SUB_BUCKET_COUNT over the
+		//whole uint64 range. Values are unitless, the metric's name gives their unit (ie.: _microseconds).
+		class CHistogram
+		{
+		public:
+			enum
+			{
+				SUB_BUCKET_BITS = 3,
+				SUB_BUCKET_COUNT = (1 << SUB_BUCKET_BITS),
+				BUCKET_COUNT = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT,
+			};
+
+			CHistogram();
+
+			void		Record(uint64);
+
+			uint64		GetCount() const;
+			uint64		GetSum() const;
+			//Upper bound of the bucket holding the value at that quantile (0 to 1)
+			uint64		GetQuantile(double) const;
+			//Number of values less or equal to the given one, exact when it's a bucket's upper bound
+			uint64		GetCountBelow(uint64) const;
+
+			static unsigned int	GetBucketIndex(uint64);
+			static uint64		GetBucketUpperBound(unsigned int);
+
+		private:
+			std::array<std::atomic<uint64>, BUCKET_COUNT>	m_buckets;
+			std::atomic<uint64>	m_count;
+			std::atomic<uint64>	m_sum;
+		};
+
+		//Process wide set of named metrics. Metrics are created on first use and live until the process
+		//exits, the references returned can be kept and used from any thread. Labels are given in
+		//Prometheus syntax (ie.: method="GET"), metrics with the same name need the same type.
+		class CRegistry : public CSingleton<CRegistry>
+		{
+		public:
+			typedef std::function<double ()> ValueFunction;
+
+			CCounter&		GetCounter(const std::string& name, const std::string& labels = std::string(), const std::string& help = std::string());
+			CGauge&			GetGauge(const std::string& name, const std::string& labels = std::string(), const std::string& help = std::string());
+			CHistogram&		GetHistogram(const std::string& name, const std::string& labels = std::string(), const std::string& help = std::string());
+			//Value read at export time, for stats kept elsewhere. Replaces a previous function with the same name and labels.
+			//Called with the registry locked, it can't use the registry.
+			void			SetGaugeFunction(const std::string& name, const std::string& labels, const std::string& help, ValueFunction);
+
+			//Prometheus text exposition format (version 0.0.4)
+			std::string		ExportPrometheus();
+			std::string		ExportJson();
+
+		private:
+			enum class METRIC_TYPE
+			{
+				COUNTER,
+				GAUGE,
+				HISTOGRAM,
+				GAUGE_FUNCTION,
+			};
+
+			struct METRIC
+			{
+				METRIC_TYPE		type = METRIC_TYPE::COUNTER;
+				std::string		help;
+				std::unique_ptr<CCounter>	counter;
+				std::unique_ptr<CGauge>		gauge;
+				std::unique_ptr<CHistogram>	histogram;
+				ValueFunction	valueFunction;
+			};
+
+			//Name and labels, sorted so that series of a metric are next to each other
+			typedef std::pair<std::string, std::string> MetricKey;
+			typedef std::map<MetricKey, METRIC> MetricMap;
+
+			METRIC&			GetMetric(const std::string&, const std::string&, const std::string&, METRIC_TYPE);
+
+			std::mutex		m_mutex;
+			MetricMap		m_metrics;
+		};
+	}
+}
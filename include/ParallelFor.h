@@ -0,0 +1,51 @@
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <vector>
+#include "TaskGroup.h"
+
+namespace Framework
+{
+	class CThreadPool;
+
+	typedef std::function<void (size_t, size_t)> ParallelForFunction;
+
+	//Picks a chunk size that gives a few chunks per thread to balance the load
+	size_t GetParallelGrainSize(CThreadPool*, size_t count);
+
+	//Calls the function with consecutive [begin, end) chunks of the range, concurrently if there's a pool.
+	//A grain size of 0 picks one automatically.
+	void ParallelFor(CThreadPool*, size_t begin, size_t end, const ParallelForFunction&, size_t grainSize = 0);
+
+	//Maps every chunk to a value and combines the results in range order, so that the
+	//result doesn't depend on the scheduling even if the reduction isn't commutative.
+	template <typename ValueType, typename MapFunctionType, typename ReduceFunctionType>
+	ValueType ParallelReduce(CThreadPool* threadPool, size_t begin, size_t end, ValueType identity,
+	                         const MapFunctionType& mapFunction, const ReduceFunctionType& reduceFunction, size_t grainSize = 0)
+	{
+		if(begin >= end) return identity;
+		if(grainSize == 0)
+		{
+			grainSize = GetParallelGrainSize(threadPool, end - begin);
+		}
+		size_t chunkCount = ((end - begin) + grainSize - 1) / grainSize;
+		std::vector<ValueType> results(chunkCount, identity);
+		ParallelFor(threadPool, 0, chunkCount,
+		            [&](size_t chunkBegin, size_t chunkEnd) {
+			            for(size_t chunk = chunkBegin; chunk < chunkEnd; chunk++)
+			            {
+				            size_t rangeBegin = begin + (chunk * grainSize);
+				            size_t rangeEnd = std::min(rangeBegin + grainSize, end);
+				            results[chunk] = mapFunction(rangeBegin, rangeEnd);
+			            }
+		            },
+		            1);
+		ValueType result = identity;
+		for(auto& value : results)
+		{
+			result = reduceFunction(result, value);
+		}
+		return result;
+	}
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <vector>
+#include <zstd_zlibwrapper.h>
+#include "Stream.h"
+
+namespace Framework
+{
+	class CThreadPool;
+
+	//Writes gzip data as a series of independent BGZF blocks (gzip members of at most 64KB with
+	//their size in a "BC" extra field) compressed in parallel on the thread pool. Output is readable
+	//by any gzip decoder. An empty end-of-file block is written when the stream is destroyed.
+	class CParallelGZipWriteStream : public CStream
+	{
+	public:
+							CParallelGZipWriteStream(CStream&, CThreadPool* = nullptr, int level = Z_DEFAULT_COMPRESSION);
+							CParallelGZipWriteStream(const CParallelGZipWriteStream&) = delete;
+		virtual				~CParallelGZipWriteStream();
+
+		CParallelGZipWriteStream& operator =(const CParallelGZipWriteStream&) = delete;
+
+		void				Seek(int64, STREAM_SEEK_DIRECTION) override;
+		uint64				Tell() override;
+		uint64				Read(void*, uint64) override;
+		uint64				Write(const void*, uint64) override;
+		bool				IsEOF() override;
+		//Compresses and writes everything that is buffered
+		void				Flush() override;
+
+	private:
+		struct BLOCK
+		{
+			std::vector<uint8>	input;
+			std::vector<uint8>	output;
+		};
+		typedef std::vector<BLOCK> BlockArray;
+
+		static void			CompressBlock(BLOCK&, int);
+
+		void				WriteBlocks();
+
+		CStream&			m_stream;
+		CThreadPool*		m_threadPool = nullptr;
+		int					m_level = Z_DEFAULT_COMPRESSION;
+		BlockArray			m_blocks;
+		size_t				m_blockCount = 0;
+		uint64				m_position = 0;
+	};
+
+	//Reads gzip data. BGZF blocks are detected from the first member's header and are inflated
+	//in parallel on the thread pool, other gzip data (including multiple members) is inflated sequentially.
+	class CParallelGZipReadStream : public CStream
+	{
+	public:
+							CParallelGZipReadStream(CStream&, CThreadPool* = nullptr);
+							CParallelGZipReadStream(const CParallelGZipReadStream&) = delete;
+		virtual				~CParallelGZipReadStream();
+
+		CParallelGZipReadStream& operator =(const CParallelGZipReadStream&) = delete;
+
+		void				Seek(int64, STREAM_SEEK_DIRECTION) override;
+		uint64				Tell() override;
+		uint64				Read(void*, uint64) override;
+		uint64				Write(const void*, uint64) override;
+		bool				IsEOF() override;
+
+		bool				IsBlockParallel() const;
+
+	private:
+		struct BLOCK
+		{
+			std::vector<uint8>	input;
+			std::vector<uint8>	output;
+		};
+		typedef std::vector<BLOCK> BlockArray;
+
+		static void			DecompressBlock(BLOCK&);
+
+		bool				ReadRawBlock(BLOCK&);
+		bool				FillBlocks();
+		uint64				InflateSequential(void*, uint64);
+
+		CStream&			m_stream;
+		CThreadPool*		m_threadPool = nullptr;
+		bool				m_isBlockParallel = false;
+		BlockArray			m_blocks;
+		size_t				m_blockCount = 0;
+		size_t				m_blockIndex = 0;
+		size_t				m_blockPosition = 0;
+		z_stream			m_zStream;
+		bool				m_isInflating = false;
+		bool				m_isMemberEnd = true;
+		std::vector<uint8>	m_inputBuffer;
+		uint64				m_position = 0;
+		bool				m_isEof = false;
+	};
+}
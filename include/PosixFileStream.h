@@ -23,6 +23,10 @@ namespace Framework
 		bool		IsEOF() override;
 		void		Flush() override;
 
+		bool		CanAccessAt() const override;
+		uint64		ReadAt(uint64, void*, uint64) override;
+		uint64		WriteAt(uint64, const void*, uint64) override;
+
 	protected:
 					CPosixFileStream() = default;
 
@@ -14,6 +14,13 @@ namespace Framework
 		uint64		Read(void*, uint64);
 		uint64		Write(const void*, uint64);
 		bool		IsEOF();
+
+		bool		CanAccessAt() const;
+		uint64		ReadAt(uint64, void*, uint64);
+
+		const void*	GetData() const;
+		uint64		GetSize() const;
+
 	private:
 		const char*	m_data = nullptr;
 		uint64		m_size = 0;
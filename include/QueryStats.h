@@ -0,0 +1,244 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include "Singleton.h"
+#include "Types.h"
+
+//Header only so that the header only database wrappers can use it without linking with Framework
+
+namespace Framework
+{
+	//Latencies of all executions of a query
+	class CQueryStats
+	{
+	public:
+		enum
+		{
+			//Bucket 0 is < 1us, bucket N is [2^(N - 1), 2^N) us, last bucket takes everything above
+			HISTOGRAM_BUCKET_COUNT = 24,
+		};
+
+		CQueryStats()
+		{
+			Reset();
+		}
+
+		void Record(uint64 microseconds)
+		{
+			calls.fetch_add(1, std::memory_order_relaxed);
+			totalMicroseconds.fetch_add(microseconds, std::memory_order_relaxed);
+			uint64 currentMax = maxMicroseconds.load(std::memory_order_relaxed);
+			while((microseconds > currentMax) && !maxMicroseconds.compare_exchange_weak(currentMax, microseconds, std::memory_order_relaxed))
+			{
+			}
+			unsigned int bucket = 0;
+			while((microseconds != 0) && (bucket < (HISTOGRAM_BUCKET_COUNT - 1)))
+			{
+				microseconds >>= 1;
+				bucket++;
+			}
+			histogram[bucket].fetch_add(1, std::memory_order_relaxed);
+		}
+
+		void Reset()
+		{
+			calls = 0;
+			totalMicroseconds = 0;
+			maxMicroseconds = 0;
+			for(auto& bucket : histogram)
+			{
+				bucket = 0;
+			}
+		}
+
+		std::atomic<uint64> calls;
+		std::atomic<uint64> totalMicroseconds;
+		std::atomic<uint64> maxMicroseconds;
+		std::array<std::atomic<uint64>, HISTOGRAM_BUCKET_COUNT> histogram;
+	};
+
+	//Collects stats of database calls, keyed by query text. Disabled by default, instrumented
+	//calls only check a flag while disabled. Calls slower than the slow query threshold are
+	//reported to the slow query handler, which logs them to stderr by default.
+	class CQueryStatsRegistry : public CSingleton<CQueryStatsRegistry>
+	{
+	public:
+		typedef std::shared_ptr<CQueryStats> StatsPtr;
+		typedef std::function<void (const std::string& query, uint64 microseconds)> SlowQueryHandler;
+
+		CQueryStatsRegistry()
+		    : m_slowQueryHandler(&LogSlowQuery)
+		{
+		}
+
+		bool IsEnabled() const
+		{
+			return m_enabled.load(std::memory_order_relaxed);
+		}
+
+		void SetEnabled(bool enabled)
+		{
+			m_enabled = enabled;
+		}
+
+		//0 disables slow query reports
+		void SetSlowQueryThreshold(std::chrono::microseconds threshold)
+		{
+			m_slowQueryThreshold = threshold.count();
+		}
+
+		void SetSlowQueryHandler(SlowQueryHandler handler)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_slowQueryHandler = std::move(handler);
+		}
+
+		StatsPtr GetStats(std::string_view query)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			return GetStatsLocked(query);
+		}
+
+		void Record(std::string_view query, uint64 microseconds)
+		{
+			SlowQueryHandler slowQueryHandler;
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				GetStatsLocked(query)->Record(microseconds);
+				uint64 slowQueryThreshold = m_slowQueryThreshold.load(std::memory_order_relaxed);
+				if((slowQueryThreshold != 0) && (microseconds >= slowQueryThreshold))
+				{
+					slowQueryHandler = m_slowQueryHandler;
+				}
+			}
+			//Handler is called outside of the lock, it might run queries itself
+			if(slowQueryHandler)
+			{
+				slowQueryHandler(std::string(query), microseconds);
+			}
+		}
+
+		void Reset()
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			for(auto& statsPair : m_stats)
+			{
+				statsPair.second->Reset();
+			}
+		}
+
+		std::string DumpJson()
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			std::string result = "{";
+			bool firstQuery = true;
+			for(const auto& statsPair : m_stats)
+			{
+				if(!firstQuery) result += ",";
+				firstQuery = false;
+				result += "\"";
+				for(auto queryChar : statsPair.first)
+				{
+					switch(queryChar)
+					{
+					case '\"':
+					case '\\':
+						result += '\\';
+						result += queryChar;
+						break;
+					case '\n':
+						result += "\\n";
+						break;
+					case '\r':
+						result += "\\r";
+						break;
+					case '\t':
+						result += "\\t";
+						break;
+					default:
+						result += queryChar;
+						break;
+					}
+				}
+				const auto& stats = *statsPair.second;
+				result += "\":{\"calls\":" + std::to_string(stats.calls.load());
+				result += ",\"microseconds\":" + std::to_string(stats.totalMicroseconds.load());
+				result += ",\"maxMicroseconds\":" + std::to_string(stats.maxMicroseconds.load());
+				result += ",\"histogram\":[";
+				for(unsigned int bucket = 0; bucket < CQueryStats::HISTOGRAM_BUCKET_COUNT; bucket++)
+				{
+					if(bucket != 0) result += ",";
+					result += std::to_string(stats.histogram[bucket].load());
+				}
+				result += "]}";
+			}
+			result += "}";
+			return result;
+		}
+
+	private:
+		typedef std::map<std::string, StatsPtr, std::less<>> StatsMap;
+
+		StatsPtr& GetStatsLocked(std::string_view query)
+		{
+			//Transparent comparator avoids building a string when the query is already known
+			auto statsIterator = m_stats.find(query);
+			if(statsIterator == std::end(m_stats))
+			{
+				statsIterator = m_stats.emplace(std::string(query), std::make_shared<CQueryStats>()).first;
+			}
+			return statsIterator->second;
+		}
+
+		static void LogSlowQuery(const std::string& query, uint64 microseconds)
+		{
+			fprintf(stderr, "Slow query (%llu us): %s\n", static_cast<unsigned long long>(microseconds), query.c_str());
+		}
+
+		std::atomic<bool> m_enabled = false;
+		std::atomic<uint64> m_slowQueryThreshold = 0;
+		std::mutex m_mutex;
+		StatsMap m_stats;
+		SlowQueryHandler m_slowQueryHandler;
+	};
+
+	//Measures the lifetime of the timer and records it for the query if instrumentation is enabled
+	class CQueryTimer
+	{
+	public:
+		CQueryTimer(const char* query)
+		    : m_query(CQueryStatsRegistry::GetInstance().IsEnabled() ? query : nullptr)
+		{
+			if(m_query)
+			{
+				m_start = std::chrono::steady_clock::now();
+			}
+		}
+
+		CQueryTimer(const CQueryTimer&) = delete;
+		CQueryTimer& operator =(const CQueryTimer&) = delete;
+
+		~CQueryTimer()
+		{
+			if(m_query)
+			{
+				auto elapsed = std::chrono::steady_clock::now() - m_start;
+				auto microseconds = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+				CQueryStatsRegistry::GetInstance().Record(m_query, microseconds);
+			}
+		}
+
+	private:
+		const char* m_query = nullptr;
+		std::chrono::steady_clock::time_point m_start;
+	};
+}
@@ -0,0 +1,362 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "Stream.h"
+#include "Types.h"
+
+//Binary serialization of whole object graphs over a CStream. Types describe their fields once with
+//a member template used for both saving and loading:
+//
+//	struct STATE
+//	{
+//		static const uint32 SERIALIZE_VERSION = 2;
+//
+//		template <typename ArchiveType>
+//		void Serialize(ArchiveType& archive, uint32 version)
+//		{
+//			archive & position & registers;
+//			if(version >= 2) archive & name;
+//		}
+//	};
+//
+//Arithmetic values, enums and arrays of them (C arrays, std::array, std::vector) are copied in bulk,
+//with SIMD byte swapping when the archive's byte order isn't the host's. Data goes through a buffer
+//owned by the archive, so the stream is only called once per 64KB. A type's version is stored once
+//per object (or once per array of objects) and loading data from a newer version throws.
+
+namespace Framework
+{
+	namespace Serialization
+	{
+		enum ENDIANNESS
+		{
+			ENDIANNESS_LITTLE,
+			ENDIANNESS_BIG,
+		};
+
+		//Specialize to std::true_type for trivially copyable types whose memory is their serialized form
+		//(ie.: structs of bytes or of MSBF wrappers), these are copied as is without swapping
+		template <typename Type>
+		struct IsRawBytes : std::false_type
+		{
+		};
+
+		//Types without a SERIALIZE_VERSION member are at version 0
+		template <typename Type, typename = void>
+		struct Version : std::integral_constant<uint32, 0>
+		{
+		};
+
+		template <typename Type>
+		struct Version<Type, std::void_t<decltype(Type::SERIALIZE_VERSION)>> : std::integral_constant<uint32, Type::SERIALIZE_VERSION>
+		{
+		};
+
+		class CArchive
+		{
+		public:
+			CArchive(const CArchive&) = delete;
+			virtual ~CArchive() = default;
+
+			CArchive& operator=(const CArchive&) = delete;
+
+			//True if multibyte values are byte swapped on their way to or from the stream
+			bool IsSwapping() const;
+
+		protected:
+			enum
+			{
+				BUFFER_SIZE = 0x10000,
+			};
+
+			CArchive(CStream&, ENDIANNESS);
+
+			void SwapValues(void*, const void*, size_t count, size_t valueSize);
+
+			CStream& m_stream;
+			bool m_swap = false;
+			std::vector<uint8> m_buffer;
+			size_t m_bufferPosition = 0;
+		};
+
+		class COutputArchive : public CArchive
+		{
+		public:
+			static constexpr bool IS_LOADING = false;
+
+			explicit COutputArchive(CStream&, ENDIANNESS = ENDIANNESS_LITTLE);
+			//Writes what's left in the buffer, call Flush before to get errors
+			virtual ~COutputArchive();
+
+			template <typename Type>
+			COutputArchive& operator&(const Type&);
+
+			//Pointers aren't written through, they're only non-const to share code with loading
+			void ProcessBytes(void*, size_t);
+			//Values of 1, 2, 4 or 8 bytes
+			void ProcessValues(void*, size_t count, size_t valueSize);
+
+			void Flush();
+
+		private:
+			void FlushBuffer();
+		};
+
+		class CInputArchive : public CArchive
+		{
+		public:
+			static constexpr bool IS_LOADING = true;
+
+			explicit CInputArchive(CStream&, ENDIANNESS = ENDIANNESS_LITTLE);
+			//Data is read ahead in chunks, what wasn't used is given back by seeking the stream
+			//backwards, so that the stream ends up right after the archive's data
+			virtual ~CInputArchive();
+
+			template <typename Type>
+			CInputArchive& operator&(Type&);
+
+			//Throw if the stream ends before the data
+			void ProcessBytes(void*, size_t);
+			void ProcessValues(void*, size_t count, size_t valueSize);
+
+		private:
+			size_t m_bufferEnd = 0;
+		};
+
+		namespace Detail
+		{
+			template <typename Type>
+			constexpr bool IsSwappable = (std::is_arithmetic_v<Type> || std::is_enum_v<Type>) && !std::is_same_v<Type, bool>;
+
+			template <typename Type>
+			struct IsStdVector : std::false_type
+			{
+			};
+
+			template <typename ElementType, typename AllocatorType>
+			struct IsStdVector<std::vector<ElementType, AllocatorType>> : std::true_type
+			{
+			};
+
+			template <typename Type>
+			struct IsStdBoolVector : std::false_type
+			{
+			};
+
+			template <typename AllocatorType>
+			struct IsStdBoolVector<std::vector<bool, AllocatorType>> : std::true_type
+			{
+			};
+
+			template <typename Type>
+			struct IsStdArray : std::false_type
+			{
+			};
+
+			template <typename ElementType, size_t Size>
+			struct IsStdArray<std::array<ElementType, Size>> : std::true_type
+			{
+			};
+
+			template <typename Type>
+			struct IsStdString : std::false_type
+			{
+			};
+
+			template <typename CharType, typename TraitsType, typename AllocatorType>
+			struct IsStdString<std::basic_string<CharType, TraitsType, AllocatorType>> : std::true_type
+			{
+			};
+
+			template <typename Type>
+			struct IsStdPair : std::false_type
+			{
+			};
+
+			template <typename FirstType, typename SecondType>
+			struct IsStdPair<std::pair<FirstType, SecondType>> : std::true_type
+			{
+			};
+
+			template <typename ArchiveType, typename Type, typename = void>
+			struct HasSerialize : std::false_type
+			{
+			};
+
+			template <typename ArchiveType, typename Type>
+			struct HasSerialize<ArchiveType, Type, std::void_t<decltype(std::declval<Type&>().Serialize(std::declval<ArchiveType&>(), uint32()))>> : std::true_type
+			{
+			};
+
+			template <typename ArchiveType, typename Type>
+			void SerializeValue(ArchiveType&, Type&);
+
+			//Version is stored before objects with a Serialize member, nothing is stored for other types
+			template <typename ArchiveType, typename Type>
+			uint32 SerializeVersion(ArchiveType& archive)
+			{
+				if constexpr(HasSerialize<ArchiveType, Type>::value)
+				{
+					uint32 version = Version<Type>::value;
+					archive.ProcessValues(&version, 1, sizeof(uint32));
+					if(ArchiveType::IS_LOADING && (version > Version<Type>::value))
+					{
+						throw std::runtime_error("Serialized data comes from a newer version.");
+					}
+					return version;
+				}
+				else
+				{
+					return 0;
+				}
+			}
+
+			template <typename ArchiveType, typename Type>
+			void SerializeElements(ArchiveType& archive, Type* values, size_t count, uint32 version)
+			{
+				if constexpr(IsSwappable<Type>)
+				{
+					archive.ProcessValues(values, count, sizeof(Type));
+				}
+				else if constexpr(IsRawBytes<Type>::value)
+				{
+					static_assert(std::is_trivially_copyable_v<Type>, "Raw bytes types must be trivially copyable.");
+					archive.ProcessBytes(values, count * sizeof(Type));
+				}
+				else if constexpr(HasSerialize<ArchiveType, Type>::value)
+				{
+					for(size_t i = 0; i < count; i++)
+					{
+						values[i].Serialize(archive, version);
+					}
+				}
+				else
+				{
+					for(size_t i = 0; i < count; i++)
+					{
+						SerializeValue(archive, values[i]);
+					}
+				}
+			}
+
+			template <typename ArchiveType, typename Type>
+			void SerializeArray(ArchiveType& archive, Type* values, size_t count)
+			{
+				uint32 version = SerializeVersion<ArchiveType, Type>(archive);
+				SerializeElements(archive, values, count, version);
+			}
+
+			template <typename ArchiveType>
+			uint64 SerializeSize(ArchiveType& archive, size_t size)
+			{
+				uint64 result = size;
+				archive.ProcessValues(&result, 1, sizeof(uint64));
+				return result;
+			}
+
+			//Containers grow as their elements are loaded, so that a corrupted size runs into the end
+			//of the stream instead of exhausting memory first
+			template <typename ArchiveType, typename ContainerType>
+			void SerializeContiguous(ArchiveType& archive, ContainerType& container)
+			{
+				typedef typename ContainerType::value_type ElementType;
+				uint64 size = SerializeSize(archive, container.size());
+				uint32 version = SerializeVersion<ArchiveType, ElementType>(archive);
+				if constexpr(ArchiveType::IS_LOADING)
+				{
+					container.clear();
+					size_t loadedCount = 0;
+					while(loadedCount < size)
+					{
+						size_t count = static_cast<size_t>(std::min<uint64>(size - loadedCount, std::max<size_t>(loadedCount, 0x1000)));
+						container.resize(loadedCount + count);
+						SerializeElements(archive, &container[loadedCount], count, version);
+						loadedCount += count;
+					}
+				}
+				else
+				{
+					SerializeElements(archive, container.data(), container.size(), version);
+				}
+			}
+
+			template <typename ArchiveType, typename Type>
+			void SerializeValue(ArchiveType& archive, Type& value)
+			{
+				if constexpr(std::is_same_v<Type, bool>)
+				{
+					uint8 byte = value ? 1 : 0;
+					archive.ProcessBytes(&byte, 1);
+					if constexpr(ArchiveType::IS_LOADING)
+					{
+						value = (byte != 0);
+					}
+				}
+				else if constexpr(std::is_array_v<Type>)
+				{
+					SerializeArray(archive, value, std::extent_v<Type>);
+				}
+				else if constexpr(IsStdArray<Type>::value)
+				{
+					SerializeArray(archive, value.data(), value.size());
+				}
+				else if constexpr(IsStdBoolVector<Type>::value)
+				{
+					uint64 size = SerializeSize(archive, value.size());
+					if constexpr(ArchiveType::IS_LOADING)
+					{
+						value.clear();
+						for(uint64 i = 0; i < size; i++)
+						{
+							bool element = false;
+							SerializeValue(archive, element);
+							value.push_back(element);
+						}
+					}
+					else
+					{
+						for(bool element : value)
+						{
+							SerializeValue(archive, element);
+						}
+					}
+				}
+				else if constexpr(IsStdVector<Type>::value || IsStdString<Type>::value)
+				{
+					SerializeContiguous(archive, value);
+				}
+				else if constexpr(IsStdPair<Type>::value)
+				{
+					SerializeValue(archive, value.first);
+					SerializeValue(archive, value.second);
+				}
+				else
+				{
+					static_assert(IsSwappable<Type> || IsRawBytes<Type>::value || HasSerialize<ArchiveType, Type>::value,
+					              "Type needs a Serialize member or an IsRawBytes specialization.");
+					SerializeArray(archive, &value, 1);
+				}
+			}
+		}
+
+		template <typename Type>
+		COutputArchive& COutputArchive::operator&(const Type& value)
+		{
+			Detail::SerializeValue(*this, const_cast<Type&>(value));
+			return (*this);
+		}
+
+		template <typename Type>
+		CInputArchive& CInputArchive::operator&(Type& value)
+		{
+			Detail::SerializeValue(*this, value);
+			return (*this);
+		}
+	}
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <string>
+#include "Stream.h"
+
+namespace Framework
+{
+	//Single producer, single consumer ring buffer in shared memory, moves data between processes without
+	//going through the kernel for every transfer like pipes and sockets do. One process creates the ring
+	//and the other one opens it, by name on Windows and Linux, or from its file descriptor on Android
+	//(ashmem regions can't be opened by name, the descriptor needs to be sent over a socket or Binder).
+	//The ring is mapped twice back to back, so reserved and acquired spans are always contiguous, even
+	//when they wrap around. A side waiting for data or room sleeps on a futex (Linux, Android) or an event
+	//(Windows), the other side only goes through the kernel to wake it up when it's actually waiting.
+	//Each side is meant to be used by a single thread.
+	class CSharedMemoryStream : public CStream
+	{
+	public:
+		enum ROLE
+		{
+			ROLE_PRODUCER,
+			ROLE_CONSUMER,
+		};
+
+		//Creates a ring holding at least 'capacity' bytes, rounded up to the allocation granularity
+						CSharedMemoryStream(const std::string& name, uint32 capacity, ROLE);
+		//Opens a ring created by another process
+						CSharedMemoryStream(const std::string& name, ROLE);
+#ifndef _WIN32
+		//Opens a ring from a descriptor obtained from the creator with GetFileDescriptor, it's duplicated
+						CSharedMemoryStream(int fd, ROLE);
+#endif
+						CSharedMemoryStream(const CSharedMemoryStream&) = delete;
+		virtual			~CSharedMemoryStream();
+
+		CSharedMemoryStream& operator =(const CSharedMemoryStream&) = delete;
+
+		uint32			GetCapacity() const;
+#ifndef _WIN32
+		int				GetFileDescriptor() const;
+#endif
+
+		//Producer: waits until 'size' bytes can be written and returns where to write them. Data isn't
+		//visible to the consumer until it's committed. Returns nullptr if the consumer closed the ring.
+		uint8*			Reserve(uint32 size);
+		void			Commit(uint32 size);
+
+		//Consumer: waits until 'size' bytes were committed and returns where to read them. Returns nullptr
+		//if the producer closed the ring before that, what's left can be acquired with a smaller size.
+		const uint8*	Acquire(uint32 size);
+		void			Release(uint32 size);
+
+		//Data that can be acquired (consumer) or room that can be reserved (producer) without waiting
+		uint32			GetAvailableSize() const;
+
+		//Tells the other side that nothing more will be written or read, done when the stream is destroyed.
+		//Consumers can still read what was committed before the producer closed the ring.
+		void			Close();
+
+		void			Seek(int64, STREAM_SEEK_DIRECTION) override;
+		//Amount of data written or read so far
+		uint64			Tell() override;
+		//Waits until 'size' bytes are read, reads less only if the producer closed the ring
+		uint64			Read(void*, uint64) override;
+		//Waits until 'size' bytes are written, writes less only if the consumer closed the ring
+		uint64			Write(const void*, uint64) override;
+		bool			IsEOF() override;
+
+	private:
+		struct HEADER;
+
+		void			CreateMapping(const std::string&, uint32);
+		void			OpenMapping(const std::string&);
+		void			MapExisting();
+		void			MapRing(uint32 capacity);
+		void			Unmap();
+
+		uint32			WaitForData(uint32);
+		uint32			WaitForRoom(uint32);
+		void			WakePeer(bool isDataSignal);
+		void			CheckRole(ROLE) const;
+
+		ROLE			m_role;
+		HEADER*			m_header = nullptr;
+		uint8*			m_ring = nullptr;
+		uint32			m_capacity = 0;
+		size_t			m_headerSize = 0;
+		//Position owned by this side, the other side only reads it
+		uint64			m_position = 0;
+		uint32			m_reservedSize = 0;
+		bool			m_isCreator = false;
+		bool			m_isClosed = false;
+		bool			m_isEof = false;
+		std::string		m_name;
+#ifdef _WIN32
+		void*			m_mapping = nullptr;
+		void*			m_dataEvent = nullptr;
+		void*			m_roomEvent = nullptr;
+#else
+		int				m_fd = -1;
+#endif
+	};
+}
@@ -20,5 +20,47 @@
 #endif
 
 #if !defined(FRAMEWORK_SIMD_USE_SSE) && !defined(FRAMEWORK_SIMD_USE_NEON)
-#error No SIMD instrinsics available for this platform.
+	//No SIMD instrinsics available for this platform, code must provide scalar versions
+	#define FRAMEWORK_SIMD_USE_SCALAR
+#endif
+
+//Functions using instruction sets above the compile time baseline need to be marked
+//with these and must only be called after checking CCpuFeatures (see CpuFeatures.h)
+#if defined(FRAMEWORK_SIMD_USE_SSE) && !defined(__EMSCRIPTEN__)
+	#define FRAMEWORK_SIMD_HAS_X86_DISPATCH
+	#if defined(_MSC_VER) && !defined(__clang__)
+		#define FRAMEWORK_SIMD_TARGET_SSSE3
+		#define FRAMEWORK_SIMD_TARGET_AVX2
+		#define FRAMEWORK_SIMD_TARGET_AVX512
+		#define FRAMEWORK_SIMD_TARGET_SHA
+		#define FRAMEWORK_SIMD_TARGET_SSE42
+		#define FRAMEWORK_SIMD_TARGET_PCLMUL
+	#else
+		#define FRAMEWORK_SIMD_TARGET_SSSE3 __attribute__((target("ssse3")))
+		#define FRAMEWORK_SIMD_TARGET_AVX2 __attribute__((target("avx2")))
+		#define FRAMEWORK_SIMD_TARGET_AVX512 __attribute__((target("avx512f,avx512bw")))
+		#define FRAMEWORK_SIMD_TARGET_SHA __attribute__((target("sha,sse4.1")))
+		#define FRAMEWORK_SIMD_TARGET_SSE42 __attribute__((target("sse4.2")))
+		#define FRAMEWORK_SIMD_TARGET_PCLMUL __attribute__((target("pclmul,sse4.1")))
+	#endif
+#endif
+
+//ARMv8 crypto and CRC extensions, only used on AArch64 (Linux, Android and Apple platforms)
+#if defined(FRAMEWORK_SIMD_USE_NEON) && defined(__aarch64__) && (defined(__linux__) || defined(__APPLE__))
+	#define FRAMEWORK_SIMD_HAS_ARM_SHA2
+	#define FRAMEWORK_SIMD_HAS_ARM_CRC32
+	#if defined(__ARM_FEATURE_SHA2)
+		#define FRAMEWORK_SIMD_TARGET_ARM_SHA2
+	#elif defined(__clang__)
+		#define FRAMEWORK_SIMD_TARGET_ARM_SHA2 __attribute__((target("crypto")))
+	#else
+		#define FRAMEWORK_SIMD_TARGET_ARM_SHA2 __attribute__((target("+crypto")))
+	#endif
+	#if defined(__ARM_FEATURE_CRC32)
+		#define FRAMEWORK_SIMD_TARGET_ARM_CRC32
+	#elif defined(__clang__)
+		#define FRAMEWORK_SIMD_TARGET_ARM_CRC32 __attribute__((target("crc")))
+	#else
+		#define FRAMEWORK_SIMD_TARGET_ARM_CRC32 __attribute__((target("+crc")))
+	#endif
 #endif
@@ -2,6 +2,7 @@
 
 #include "SocketDef.h"
 #include "Stream.h"
+#include "BufferedStream.h"
 
 namespace Framework
 {
@@ -19,6 +20,11 @@ namespace Framework
 		void Seek(int64, Framework::STREAM_SEEK_DIRECTION) override;
 		bool IsEOF() override;
 
+		void SetNoDelay(bool);
+
+		//Sends a part of a file stream, without going through user space when the platform allows it
+		uint64 SendFile(CStream& file, uint64 offset, uint64 length);
+
 	protected:
 		SOCKET m_fd = INVALID_SOCKET;
 
@@ -32,4 +38,21 @@ namespace Framework
 		CSocketStream(SOCKET fd);
 		virtual ~CSocketStream();
 	};
+
+	//Owns the socket, buffers reads and coalesces small writes. Nagle's algorithm
+	//is turned off since writes are already grouped.
+	class CBufferedSocketStream : public CBufferedStream
+	{
+	public:
+		CBufferedSocketStream(SOCKET fd, size_t bufferSize = DEFAULT_BUFFER_SIZE);
+		CBufferedSocketStream(const CBufferedSocketStream&) = delete;
+		virtual ~CBufferedSocketStream();
+
+		CBufferedSocketStream& operator=(const CBufferedSocketStream&) = delete;
+
+		uint64 SendFile(CStream& file, uint64 offset, uint64 length);
+
+	private:
+		CSocketStream m_socketStream;
+	};
 }
@@ -0,0 +1,16 @@
+#pragma once
+
+#include "Stream.h"
+
+namespace Framework
+{
+	//Stream whose whole content can be reached in memory. Readers can use the data in place
+	//through GetSpan instead of copying it in their own buffers.
+	class CSpanStream : public CStream
+	{
+	public:
+		virtual const uint8*	GetData() const = 0;
+		//Throws if the span goes past the end of the stream
+		virtual const uint8*	GetSpan(uint64 offset, uint64 length) const = 0;
+	};
+}
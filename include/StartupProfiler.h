@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "Singleton.h"
+#include "Trace.h"
+#include "Types.h"
+
+namespace Framework
+{
+	//Timeline of the initialization phases (library loading, device creation, config parsing, shader
+	//linking, etc.) recorded until the application calls Finish. Unlike trace markers, phases are always
+	//recorded since there are few of them. Phases are also forwarded to trace markers when those are enabled.
+	class CStartupProfiler : public CSingleton<CStartupProfiler>
+	{
+	public:
+		struct PHASE
+		{
+			std::string		name;
+			//Threads are numbered in the order they recorded their first phase
+			uint32			threadIndex = 0;
+			//Phases started while another one was running on the same thread are nested in it
+			uint32			depth = 0;
+			uint64			beginTime = 0;
+			uint64			endTime = 0;
+		};
+		typedef std::vector<PHASE> PhaseArray;
+
+							CStartupProfiler();
+
+		//Nanoseconds since the profiler was created
+		uint64				GetTime() const;
+
+		bool				IsRecording() const;
+		void				Record(std::string, uint32 depth, uint64 beginTime, uint64 endTime);
+
+		//Stops recording, phases recorded so far are kept
+		void				Finish();
+		//Time at which Finish was called, 0 if still recording
+		uint64				GetFinishTime() const;
+
+		//Sorted by begin time
+		PhaseArray			GetPhases() const;
+		//One line per phase with its start time and duration in milliseconds, indented by depth
+		std::string			FormatTimeline() const;
+
+	private:
+		uint64				m_baseTime = 0;
+		std::atomic<bool>	m_recording;
+		std::atomic<uint64>	m_finishTime;
+
+		mutable std::mutex	m_phasesMutex;
+		PhaseArray			m_phases;
+		uint32				m_threadCount = 0;
+	};
+
+	class CStartupPhase
+	{
+	public:
+		explicit			CStartupPhase(const char*);
+							CStartupPhase(const CStartupPhase&) = delete;
+							~CStartupPhase();
+
+		CStartupPhase&		operator =(const CStartupPhase&) = delete;
+
+	private:
+		const char*			m_name = nullptr;
+		uint32				m_depth = 0;
+		uint64				m_beginTime = 0;
+	};
+}
+
+//Names need to be string literals
+#define FRAMEWORK_STARTUP_PHASE(name) \
+	Framework::CStartupPhase FRAMEWORK_STARTUP_PHASE_CONCAT(startupPhase_, __LINE__)(name); \
+	FRAMEWORK_TRACE_SCOPE(name)
+
+#define FRAMEWORK_STARTUP_PHASE_CONCAT2(a, b) a##b
+#define FRAMEWORK_STARTUP_PHASE_CONCAT(a, b) FRAMEWORK_STARTUP_PHASE_CONCAT2(a, b)
@@ -29,6 +29,11 @@ namespace Framework
 		bool			IsEOF() override;
 		void			Flush() override;
 		void			Close();
+
+		//Only available on seekable files. On POSIX systems, these flush the stdio buffer and then go to the descriptor
+		bool			CanAccessAt() const override;
+		uint64			ReadAt(uint64, void*, uint64) override;
+		uint64			WriteAt(uint64, const void*, uint64) override;
 		
 	private:
 						CStdStream(const CStdStream&) {}
@@ -13,6 +13,18 @@ namespace Framework
 		STREAM_SEEK_CUR = 2,
 	};
 
+	struct STREAM_IOVEC
+	{
+		void*	buffer;
+		uint64	size;
+	};
+
+	struct STREAM_CONST_IOVEC
+	{
+		const void*	buffer;
+		uint64		size;
+	};
+
 	class CStream
 	{
 	public:
@@ -26,6 +38,16 @@ namespace Framework
 		virtual uint64	GetLength();
 		virtual uint64	GetRemainingLength();
 
+		//Scatter-gather variants, stop at the first short transfer
+		virtual uint64	ReadV(const STREAM_IOVEC*, size_t);
+		virtual uint64	WriteV(const STREAM_CONST_IOVEC*, size_t);
+
+		//Positional variants, don't use or modify the stream position and can be
+		//called concurrently on streams that support them
+		virtual bool	CanAccessAt() const;
+		virtual uint64	ReadAt(uint64, void*, uint64);
+		virtual uint64	WriteAt(uint64, const void*, uint64);
+
 		uint8			Read8();
 		uint16			Read16();
 		uint32			Read32();
@@ -38,7 +60,7 @@ namespace Framework
 
 		std::string		ReadString();
 		std::string		ReadString(size_t);
-		std::string		ReadLine(bool ignoreCr = true);
+		virtual std::string	ReadLine(bool ignoreCr = true);
 
 		void			Write8(uint8);
 		void			Write16(uint16);
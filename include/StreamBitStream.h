@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cassert>
 #include <stdexcept>
 #include "Types.h"
 #include "Stream.h"
@@ -7,7 +8,9 @@
 
 namespace Framework
 {
-	class CStreamBitStream : public CBitStream
+	//Reads ahead of the bit position in big chunks: the source stream's position
+	//is past what was consumed from the bit stream.
+	class CStreamBitStream final : public CBitStream
 	{
 	public:
 
@@ -20,15 +23,92 @@ namespace Framework
 		virtual bool			TryPeekBits_LSBF(uint8, uint32&) override;
 		virtual bool			TryPeekBits_MSBF(uint8, uint32&) override;
 
+		//Non-virtual versions for hot loops. Switching between LSBF and MSBF
+		//is only possible when the stream is on a byte boundary.
+		bool TryPeekBitsInline_MSBF(uint8 size, uint32& result)
+		{
+			assert(size <= 32);
+			if((m_isLsbf || (size > m_availableBits)) && !Refill_MSBF(size))
+			{
+				result = 0;
+				return false;
+			}
+			result = (size == 0) ? 0 : static_cast<uint32>(m_bitBuffer >> (64 - size));
+			return true;
+		}
+
+		bool TryPeekBitsInline_LSBF(uint8 size, uint32& result)
+		{
+			assert(size <= 32);
+			if((!m_isLsbf || (size > m_availableBits)) && !Refill_LSBF(size))
+			{
+				result = 0;
+				return false;
+			}
+			result = static_cast<uint32>(m_bitBuffer & ((1ULL << size) - 1));
+			return true;
+		}
+
+		void AdvanceInline(uint8 size)
+		{
+			assert(size <= 32);
+			assert(m_availableBits >= size);
+			if(m_isLsbf)
+			{
+				m_bitBuffer >>= size;
+			}
+			else
+			{
+				m_bitBuffer <<= size;
+			}
+			m_availableBits -= size;
+			m_bitIndex = (m_bitIndex + size) & 7;
+		}
+
+		uint32 GetBitsInline_MSBF(uint8 size)
+		{
+			uint32 result = 0;
+			if(!TryPeekBitsInline_MSBF(size, result))
+			{
+				throw CBitStreamException();
+			}
+			AdvanceInline(size);
+			return result;
+		}
+
+		uint32 GetBitsInline_LSBF(uint8 size)
+		{
+			uint32 result = 0;
+			if(!TryPeekBitsInline_LSBF(size, result))
+			{
+				throw CBitStreamException();
+			}
+			AdvanceInline(size);
+			return result;
+		}
+
 	private:
 		enum
 		{
-			BUFFER_SIZE = 16,
+			BUFFER_SIZE = 0x1000,
 		};
 
+		bool					Refill_MSBF(uint8);
+		bool					Refill_LSBF(uint8);
+		bool					SwitchBitOrder(bool);
+		bool					FillBuffer();
+
+		//Next bits to be consumed are in the most significant part in MSBF mode
+		//and in the least significant part in LSBF mode
+		uint64					m_bitBuffer = 0;
+		bool					m_isLsbf = false;
+		unsigned int			m_availableBits = 0;
+		uint8					m_bitIndex = 0;
+
 		uint8					m_buffer[BUFFER_SIZE];
-		unsigned int			m_cursor;
-		unsigned int			m_availableBits;
+		unsigned int			m_bufferPos = 0;
+		unsigned int			m_bufferEnd = 0;
+		bool					m_sourceEof = false;
 
 		Framework::CStream&		m_stream;
 	};
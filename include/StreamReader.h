@@ -0,0 +1,206 @@
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+#include "EndianUtils.h"
+#include "MemStream.h"
+#include "PtrStream.h"
+#include "SpanStream.h"
+#include "Stream.h"
+
+namespace Framework
+{
+	//Reads values from a stream whose type is known at compile time. Memory backed streams (CPtrStream,
+	//CMemStream and span streams) are read in place with inlined copies instead of going through a virtual
+	//call for every value, other streams are read through their own Read. Parsers can be written against
+	//it as a template and instantiated for the streams they get. The stream shouldn't be used directly while
+	//the reader is alive, its position is only updated when the reader is destroyed or synced.
+	template <typename StreamType>
+	class CStreamReader
+	{
+	public:
+		static constexpr bool IS_MEMORY_BACKED =
+		    std::is_base_of_v<CPtrStream, StreamType> ||
+		    std::is_base_of_v<CMemStream, StreamType> ||
+		    std::is_base_of_v<CSpanStream, StreamType>;
+
+		explicit CStreamReader(StreamType& stream)
+		    : m_stream(stream)
+		{
+			if constexpr(IS_MEMORY_BACKED)
+			{
+				if constexpr(std::is_base_of_v<CPtrStream, StreamType>)
+				{
+					m_data = reinterpret_cast<const uint8*>(stream.GetData());
+					m_size = stream.GetSize();
+				}
+				else if constexpr(std::is_base_of_v<CMemStream, StreamType>)
+				{
+					m_data = stream.GetBuffer();
+					m_size = stream.GetSize();
+				}
+				else
+				{
+					m_data = stream.GetData();
+					m_size = stream.GetLength();
+				}
+				m_position = stream.Tell();
+			}
+		}
+
+		CStreamReader(const CStreamReader&) = delete;
+
+		~CStreamReader()
+		{
+			Sync();
+		}
+
+		CStreamReader& operator =(const CStreamReader&) = delete;
+
+		uint64 Read(void* buffer, uint64 size)
+		{
+			if constexpr(IS_MEMORY_BACKED)
+			{
+				//Same end of stream behavior as the memory streams themselves
+				if(m_position >= m_size)
+				{
+					m_isEof = true;
+					return 0;
+				}
+				size = std::min<uint64>(size, m_size - m_position);
+				memcpy(buffer, m_data + m_position, static_cast<size_t>(size));
+				m_position += size;
+				return size;
+			}
+			else
+			{
+				return m_stream.Read(buffer, size);
+			}
+		}
+
+		template <typename ValueType>
+		ValueType ReadValue()
+		{
+			static_assert(std::is_trivially_copyable_v<ValueType>, "Values need to be trivially copyable.");
+			ValueType value = ValueType();
+			if constexpr(IS_MEMORY_BACKED)
+			{
+				if((m_position < m_size) && ((m_size - m_position) >= sizeof(ValueType)))
+				{
+					memcpy(&value, m_data + m_position, sizeof(ValueType));
+					m_position += sizeof(ValueType);
+					return value;
+				}
+			}
+			Read(&value, sizeof(ValueType));
+			return value;
+		}
+
+		uint8 Read8()
+		{
+			return ReadValue<uint8>();
+		}
+
+		uint16 Read16()
+		{
+			return ReadValue<uint16>();
+		}
+
+		uint32 Read32()
+		{
+			return ReadValue<uint32>();
+		}
+
+		uint64 Read64()
+		{
+			return ReadValue<uint64>();
+		}
+
+		uint16 Read16_MSBF()
+		{
+			return CEndian::FromMSBF16(ReadValue<uint16>());
+		}
+
+		uint32 Read32_MSBF()
+		{
+			return CEndian::FromMSBF32(ReadValue<uint32>());
+		}
+
+		float ReadFloat32()
+		{
+			return ReadValue<float>();
+		}
+
+		bool IsEOF()
+		{
+			if constexpr(IS_MEMORY_BACKED)
+			{
+				return m_isEof;
+			}
+			else
+			{
+				return m_stream.IsEOF();
+			}
+		}
+
+		uint64 Tell()
+		{
+			if constexpr(IS_MEMORY_BACKED)
+			{
+				return m_position;
+			}
+			else
+			{
+				return m_stream.Tell();
+			}
+		}
+
+		void Seek(int64 position, STREAM_SEEK_DIRECTION direction)
+		{
+			if constexpr(IS_MEMORY_BACKED)
+			{
+				int64 base = 0;
+				switch(direction)
+				{
+				case STREAM_SEEK_SET:
+					base = 0;
+					break;
+				case STREAM_SEEK_CUR:
+					base = static_cast<int64>(m_position);
+					break;
+				case STREAM_SEEK_END:
+					base = static_cast<int64>(m_size);
+					break;
+				}
+				if(((base + position) < 0) || ((base + position) > static_cast<int64>(m_size)))
+				{
+					throw std::runtime_error("Invalid position.");
+				}
+				m_position = base + position;
+				m_isEof = false;
+			}
+			else
+			{
+				m_stream.Seek(position, direction);
+			}
+		}
+
+		//Brings the stream's position up to date, the reader can still be used afterwards
+		void Sync()
+		{
+			if constexpr(IS_MEMORY_BACKED)
+			{
+				m_stream.Seek(m_position, STREAM_SEEK_SET);
+			}
+		}
+
+	private:
+		StreamType&		m_stream;
+		const uint8*	m_data = nullptr;
+		uint64			m_size = 0;
+		uint64			m_position = 0;
+		bool			m_isEof = false;
+	};
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cstring>
+#include <type_traits>
+#include "EndianUtils.h"
+#include "Stream.h"
+
+namespace Framework
+{
+	//Writes values to a stream whose type is known at compile time. Values are gathered in a buffer
+	//held by the writer with inlined copies and handed to the stream with a single Write once it's full,
+	//instead of going through a virtual call for every value. The stream shouldn't be used directly
+	//while the writer is alive, buffered data is only written when the writer is flushed or destroyed.
+	template <typename StreamType, size_t BufferSize = 0x1000>
+	class CStreamWriter
+	{
+	public:
+		static_assert(BufferSize != 0, "Buffer size can't be zero.");
+
+		explicit CStreamWriter(StreamType& stream)
+		    : m_stream(stream)
+		{
+		}
+
+		CStreamWriter(const CStreamWriter&) = delete;
+
+		~CStreamWriter()
+		{
+			Flush();
+		}
+
+		CStreamWriter& operator =(const CStreamWriter&) = delete;
+
+		uint64 Write(const void* data, uint64 size)
+		{
+			if(size <= (BufferSize - m_bufferSize))
+			{
+				memcpy(m_buffer + m_bufferSize, data, static_cast<size_t>(size));
+				m_bufferSize += static_cast<size_t>(size);
+				return size;
+			}
+			Flush();
+			if(size >= BufferSize)
+			{
+				//Wouldn't save anything by going through the buffer
+				return m_stream.Write(data, size);
+			}
+			memcpy(m_buffer, data, static_cast<size_t>(size));
+			m_bufferSize = static_cast<size_t>(size);
+			return size;
+		}
+
+		template <typename ValueType>
+		void WriteValue(const ValueType& value)
+		{
+			static_assert(std::is_trivially_copyable_v<ValueType>, "Values need to be trivially copyable.");
+			if(sizeof(ValueType) <= (BufferSize - m_bufferSize))
+			{
+				memcpy(m_buffer + m_bufferSize, &value, sizeof(ValueType));
+				m_bufferSize += sizeof(ValueType);
+			}
+			else
+			{
+				Write(&value, sizeof(ValueType));
+			}
+		}
+
+		void Write8(uint8 value)
+		{
+			WriteValue(value);
+		}
+
+		void Write16(uint16 value)
+		{
+			WriteValue(value);
+		}
+
+		void Write32(uint32 value)
+		{
+			WriteValue(value);
+		}
+
+		void Write64(uint64 value)
+		{
+			WriteValue(value);
+		}
+
+		void Write16_MSBF(uint16 value)
+		{
+			WriteValue(CEndian::ToMSBF16(value));
+		}
+
+		void Write32_MSBF(uint32 value)
+		{
+			WriteValue(CEndian::ToMSBF32(value));
+		}
+
+		void WriteFloat32(float value)
+		{
+			WriteValue(value);
+		}
+
+		uint64 Tell()
+		{
+			return m_stream.Tell() + m_bufferSize;
+		}
+
+		//Hands buffered data to the stream, doesn't flush the stream itself
+		void Flush()
+		{
+			if(m_bufferSize != 0)
+			{
+				size_t bufferSize = m_bufferSize;
+				m_bufferSize = 0;
+				m_stream.Write(m_buffer, bufferSize);
+			}
+		}
+
+	private:
+		StreamType&		m_stream;
+		uint8			m_buffer[BufferSize];
+		size_t			m_bufferSize = 0;
+	};
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+#include "Singleton.h"
+
+namespace Framework
+{
+	//Handle to a string stored once for the whole process by CStringInterner. Two handles are equal
+	//if and only if their strings are, so comparing and hashing only look at a pointer. Ordering
+	//follows the pointers, not the strings. Default constructed handles hold the empty string.
+	class CInternedString
+	{
+	public:
+		CInternedString() = default;
+
+		//Shortcuts for CStringInterner::GetInstance().Intern
+		explicit CInternedString(std::string_view);
+		explicit CInternedString(const char*);
+
+		std::string_view GetView() const
+		{
+			return m_entry ? *m_entry : std::string_view();
+		}
+
+		//Null terminated, stays valid until the process exits
+		const char* c_str() const
+		{
+			return m_entry ? m_entry->data() : "";
+		}
+
+		bool empty() const
+		{
+			return m_entry == nullptr;
+		}
+
+		bool operator ==(const CInternedString& rhs) const
+		{
+			return m_entry == rhs.m_entry;
+		}
+
+		bool operator !=(const CInternedString& rhs) const
+		{
+			return m_entry != rhs.m_entry;
+		}
+
+		bool operator <(const CInternedString& rhs) const
+		{
+			return std::less<const std::string_view*>()(m_entry, rhs.m_entry);
+		}
+
+		size_t GetHash() const
+		{
+			return std::hash<const std::string_view*>()(m_entry);
+		}
+
+	private:
+		friend class CStringInterner;
+
+		const std::string_view* m_entry = nullptr;
+	};
+
+	//Process wide string table. Strings are copied in large blocks on first use and never freed,
+	//it's meant for names coming back over and over (tags, keys, headers), not arbitrary text.
+	//Thread-safe, looking up a string already there only takes a shared lock.
+	class CStringInterner : public CSingleton<CStringInterner>
+	{
+	public:
+		CInternedString Intern(std::string_view);
+
+		size_t GetStringCount();
+		//Bytes used by the stored strings, including the ones in blocks not filled yet
+		size_t GetStorageSize();
+
+	private:
+		enum
+		{
+			BLOCK_SIZE = 0x10000,
+		};
+
+		const char* Store(std::string_view);
+
+		std::shared_mutex m_mutex;
+		//Set nodes don't move, handles point to the views stored in them
+		std::unordered_set<std::string_view> m_strings;
+		std::vector<std::unique_ptr<char[]>> m_blocks;
+		char* m_block = nullptr;
+		size_t m_blockUsed = BLOCK_SIZE;
+		size_t m_storageSize = 0;
+	};
+}
+
+namespace std
+{
+	template <>
+	struct hash<Framework::CInternedString>
+	{
+		size_t operator()(const Framework::CInternedString& value) const
+		{
+			return value.GetHash();
+		}
+	};
+}
@@ -1,12 +1,14 @@
 #pragma once
 
+#include <iterator>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace StringUtils
 {
-	std::string ReplaceAll(const std::string&, const std::string, const std::string);
-	std::string EraseAll(const std::string&, const std::string);
+	std::string ReplaceAll(std::string_view, std::string_view replace, std::string_view replaceWith);
+	std::string EraseAll(std::string_view, std::string_view remove);
 	std::vector<std::string> Split(const std::string&,  char = ' ', bool = false);
 	std::string Join(const std::vector<std::string>&, const std::string& delimiter);
 
@@ -14,5 +16,61 @@ namespace StringUtils
 	std::string TrimEnd(const std::string&);
 	std::string Trim(const std::string&);
 
+	//Same as the above, but the results are views into the source string
+	std::string_view TrimStartView(std::string_view);
+	std::string_view TrimEndView(std::string_view);
+	std::string_view TrimView(std::string_view);
+
 	std::string ToLower(const std::string&);
+	void ToLowerInPlace(std::string&);
+
+	//Lazy version of Split, produces the same tokens as views into the source string,
+	//which needs to outlive the split view and its iterators
+	class CSplitView
+	{
+	public:
+		class CIterator
+		{
+		public:
+			typedef std::input_iterator_tag iterator_category;
+			typedef std::string_view value_type;
+			typedef std::ptrdiff_t difference_type;
+			typedef const std::string_view* pointer;
+			typedef const std::string_view& reference;
+
+			CIterator() = default;
+			CIterator(std::string_view, char, bool);
+
+			const std::string_view& operator*() const;
+			const std::string_view* operator->() const;
+
+			CIterator& operator++();
+			CIterator operator++(int);
+
+			bool operator==(const CIterator&) const;
+			bool operator!=(const CIterator&) const;
+
+		private:
+			void FetchToken();
+
+			std::string_view m_remaining;
+			std::string_view m_token;
+			char m_delimiter = ' ';
+			bool m_trim = false;
+			bool m_isLastToken = false;
+			bool m_isEnd = true;
+		};
+
+		CSplitView(std::string_view, char = ' ', bool = false);
+
+		CIterator begin() const;
+		CIterator end() const;
+
+	private:
+		std::string_view m_source;
+		char m_delimiter = ' ';
+		bool m_trim = false;
+	};
+
+	CSplitView SplitView(std::string_view, char = ' ', bool = false);
 }
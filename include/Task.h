@@ -0,0 +1,139 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace Framework
+{
+	//Move-only replacement for std::function<void ()>. Functions that fit in INLINE_SIZE bytes
+	//(and can be moved without throwing) are stored inline, larger ones are allocated on the heap.
+	class CTask
+	{
+	public:
+		enum
+		{
+			INLINE_SIZE = 64,
+		};
+
+				CTask() = default;
+
+		template <typename FunctionType, typename = std::enable_if_t<!std::is_same_v<std::decay_t<FunctionType>, CTask>>>
+				CTask(FunctionType&& function)
+		{
+			typedef std::decay_t<FunctionType> StoredType;
+			if constexpr(IsInline<StoredType>())
+			{
+				new(m_storage) StoredType(std::forward<FunctionType>(function));
+				m_operations = &g_inlineOperations<StoredType>;
+			}
+			else
+			{
+				*reinterpret_cast<StoredType**>(m_storage) = new StoredType(std::forward<FunctionType>(function));
+				m_operations = &g_heapOperations<StoredType>;
+			}
+		}
+
+				CTask(const CTask&) = delete;
+
+				CTask(CTask&& src) noexcept
+		{
+			MoveFrom(src);
+		}
+
+				~CTask()
+		{
+			Reset();
+		}
+
+		CTask&	operator =(const CTask&) = delete;
+
+		CTask&	operator =(CTask&& src) noexcept
+		{
+			if(this != &src)
+			{
+				Reset();
+				MoveFrom(src);
+			}
+			return *this;
+		}
+
+		void	operator ()()
+		{
+			m_operations->invoke(m_storage);
+		}
+
+		explicit operator bool() const
+		{
+			return m_operations != nullptr;
+		}
+
+		bool	IsStoredInline() const
+		{
+			return m_operations && m_operations->isInline;
+		}
+
+		void	Reset()
+		{
+			if(!m_operations) return;
+			m_operations->destroy(m_storage);
+			m_operations = nullptr;
+		}
+
+	private:
+		struct OPERATIONS
+		{
+			void	(*invoke)(void*);
+			void	(*move)(void*, void*);
+			void	(*destroy)(void*);
+			bool	isInline;
+		};
+
+		template <typename StoredType>
+		static constexpr bool IsInline()
+		{
+			return (sizeof(StoredType) <= INLINE_SIZE) &&
+			       (alignof(StoredType) <= alignof(std::max_align_t)) &&
+			       std::is_nothrow_move_constructible_v<StoredType>;
+		}
+
+		template <typename StoredType>
+		static constexpr OPERATIONS g_inlineOperations =
+		{
+			[](void* storage) { (*reinterpret_cast<StoredType*>(storage))(); },
+			[](void* dst, void* src)
+			{
+				auto srcFunction = reinterpret_cast<StoredType*>(src);
+				new(dst) StoredType(std::move(*srcFunction));
+				srcFunction->~StoredType();
+			},
+			[](void* storage) { reinterpret_cast<StoredType*>(storage)->~StoredType(); },
+			true,
+		};
+
+		template <typename StoredType>
+		static constexpr OPERATIONS g_heapOperations =
+		{
+			[](void* storage) { (**reinterpret_cast<StoredType**>(storage))(); },
+			[](void* dst, void* src) { *reinterpret_cast<StoredType**>(dst) = *reinterpret_cast<StoredType**>(src); },
+			[](void* storage) { delete *reinterpret_cast<StoredType**>(storage); },
+			false,
+		};
+
+		void	MoveFrom(CTask& src)
+		{
+			if(!src.m_operations) return;
+			src.m_operations->move(m_storage, src.m_storage);
+			m_operations = src.m_operations;
+			src.m_operations = nullptr;
+		}
+
+		alignas(std::max_align_t) unsigned char m_storage[INLINE_SIZE];
+		const OPERATIONS*	m_operations = nullptr;
+	};
+
+	//Something that runs tasks somewhere else, such as a thread pool or an event loop's queue
+	typedef std::function<void (CTask)> TaskExecutor;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include "ThreadPool.h"
+
+namespace Framework
+{
+	//Runs tasks on a thread pool (or inline if there's none) and waits for their completion.
+	//The first exception thrown by a task is rethrown by Wait. Wait runs pending tasks of the
+	//pool while waiting, so groups can be nested in tasks running on the same pool.
+	class CTaskGroup
+	{
+	public:
+							CTaskGroup(CThreadPool*);
+							CTaskGroup(const CTaskGroup&) = delete;
+							~CTaskGroup();
+
+		CTaskGroup&			operator =(const CTaskGroup&) = delete;
+
+		template <typename FunctionType>
+		void				Run(FunctionType&& function)
+		{
+			if(!m_threadPool)
+			{
+				function();
+				return;
+			}
+			BeginTask();
+			//Function is kept as is in the pool's task to avoid wrapping it twice
+			m_threadPool->Enqueue(
+			    [this, function = std::forward<FunctionType>(function)]() mutable {
+				    std::exception_ptr exception;
+				    try
+				    {
+					    function();
+				    }
+				    catch(...)
+				    {
+					    exception = std::current_exception();
+				    }
+				    EndTask(exception);
+			    });
+		}
+
+		void				Wait();
+
+	private:
+		void				BeginTask();
+		void				EndTask(const std::exception_ptr&);
+
+		CThreadPool*		m_threadPool = nullptr;
+		std::mutex			m_mutex;
+		std::condition_variable	m_condition;
+		unsigned int		m_pendingCount = 0;
+		std::exception_ptr	m_exception;
+	};
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <mutex>
+#include <vector>
+#include "Task.h"
+
+namespace Framework
+{
+	//Tasks posted from any thread and run by the thread owning the queue (ie.: an UI thread)
+	//when it calls RunPending.
+	class CTaskQueue
+	{
+	public:
+		void				Post(CTask);
+
+		//Runs tasks posted before the call, returns how many were run
+		unsigned int		RunPending();
+		bool				IsEmpty();
+
+		TaskExecutor		GetExecutor();
+
+	private:
+		typedef std::vector<CTask> TaskArray;
+
+		std::mutex			m_mutex;
+		TaskArray			m_tasks;
+	};
+}
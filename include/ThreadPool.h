@@ -1,35 +1,198 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <functional>
+#include <future>
+#include <memory>
 #include <thread>
 #include <vector>
 #include <deque>
 #include <mutex>
 #include <condition_variable>
+#include <unordered_map>
+#include "AsyncTask.h"
+#include "CancellationToken.h"
+#include "Task.h"
 
 namespace Framework
 {
+	//Work stealing pool: tasks enqueued from a worker go in that worker's own deque, other tasks
+	//go in a shared injection queue. Idle workers steal from each other and spin a little
+	//before going to sleep. Tasks enqueued before destruction are all run, those that no worker is left
+	//to take are run by the destroying thread.
+	//Tasks are kept in nodes recycled through per thread caches, so enqueuing a function that fits
+	//inline in a CTask doesn't allocate.
+	//Tasks have a priority, workers look for higher priority tasks first (in their deque, the injection
+	//queue, then other workers). To keep a steady flow of higher priority tasks from starving the others,
+	//every FAIRNESS_INTERVAL tasks a worker starts looking at a lower priority instead.
+	//Tasks given a cancellation token are dropped without running if it's cancelled before they start,
+	//running tasks can poll IsCurrentTaskCancelled. Dropping a task from Submit breaks its future.
+	//The worker count can vary between a minimum and a maximum. A worker is added when tasks keep being
+	//enqueued while none of the workers went idle for BACKLOG_SPAWN_DELAY_MS, or right away when a task
+	//enters a CBlockingScope. Workers above the minimum exit after being idle for the idle timeout.
 	class CThreadPool
 	{
 	public:
-		typedef std::function<void ()> TaskFunction;
+		typedef CTask TaskFunction;
 
-									CThreadPool(unsigned int);
+		//Pinning workers to a core (with its SMT siblings) or a NUMA node. Workers are spread
+		//over cores/nodes in order and wrap around when there are more workers than those.
+		enum PLACEMENT
+		{
+			PLACEMENT_NONE,
+			PLACEMENT_CORE,
+			PLACEMENT_NODE,
+		};
+
+		enum PRIORITY
+		{
+			PRIORITY_HIGH,
+			PRIORITY_NORMAL,
+			PRIORITY_LOW,
+			PRIORITY_COUNT,
+		};
+
+		typedef unsigned int GroupId;
+
+		enum
+		{
+			DEFAULT_IDLE_TIMEOUT_MS = 10000,
+		};
+
+		//Declared by tasks around blocking calls (I/O, waiting on something outside the pool), lets the
+		//pool start another worker to keep the others going. Does nothing outside of the pool's workers.
+		class CBlockingScope
+		{
+		public:
+									CBlockingScope();
+									CBlockingScope(const CBlockingScope&) = delete;
+									~CBlockingScope();
+
+			CBlockingScope&			operator =(const CBlockingScope&) = delete;
+
+		private:
+			CThreadPool*			m_pool = nullptr;
+		};
+
+		//Fixed worker count
+									CThreadPool(unsigned int, PLACEMENT = PLACEMENT_NONE);
+									CThreadPool(unsigned int minThreadCount, unsigned int maxThreadCount, PLACEMENT = PLACEMENT_NONE, unsigned int idleTimeoutMs = DEFAULT_IDLE_TIMEOUT_MS);
 		virtual						~CThreadPool();
 
-		void						Enqueue(const TaskFunction&);
+		void						Enqueue(TaskFunction, PRIORITY = PRIORITY_NORMAL, CCancellationToken = CCancellationToken());
+		//Workers running at the moment
+		unsigned int				GetThreadCount() const;
+		unsigned int				GetMaxThreadCount() const;
+		TaskExecutor				GetExecutor(PRIORITY = PRIORITY_NORMAL);
+
+		//Tasks enqueued with the token of a group are cancelled together by CancelGroup.
+		//The group starts over with a new token after being cancelled.
+		CCancellationToken			GetGroupToken(GroupId);
+		void						CancelGroup(GroupId);
+
+		//True if the task running on the calling thread has been cancelled
+		static bool					IsCurrentTaskCancelled();
+
+		//Result (or exception) of the function is given through the future
+		template <typename FunctionType>
+		std::future<std::invoke_result_t<FunctionType>> Submit(FunctionType&& function, PRIORITY priority = PRIORITY_NORMAL, CCancellationToken cancellationToken = CCancellationToken())
+		{
+			typedef std::invoke_result_t<FunctionType> ResultType;
+			std::packaged_task<ResultType ()> task(std::forward<FunctionType>(function));
+			auto future = task.get_future();
+			Enqueue([task = std::move(task)] () mutable { task(); }, priority, std::move(cancellationToken));
+			return future;
+		}
+
+#if defined(FRAMEWORK_HAS_COROUTINES)
+		//'co_await threadPool.Schedule()' resumes the coroutine on one of the workers
+		auto						Schedule(PRIORITY priority = PRIORITY_NORMAL)
+		{
+			struct SCHEDULE_AWAITER
+			{
+				bool await_ready() const noexcept
+				{
+					return false;
+				}
+
+				void await_suspend(std::coroutine_handle<> handle)
+				{
+					threadPool.Enqueue([handle] () { handle.resume(); }, priority);
+				}
+
+				void await_resume() noexcept
+				{
+				}
+
+				CThreadPool& threadPool;
+				PRIORITY priority;
+			};
+			return SCHEDULE_AWAITER{*this, priority};
+		}
+#endif
+
+		//Runs one of the pending tasks on the calling thread, returns false if there wasn't any.
+		//Used to make progress instead of blocking while waiting on other tasks.
+		bool						RunPendingTask();
 
 	private:
-		typedef std::vector<std::thread> ThreadArray;
-		typedef std::deque<TaskFunction> TaskArray;
+		enum
+		{
+			SPIN_COUNT = 64,
+			INJECTION_BATCH_SIZE = 16,
+			FAIRNESS_INTERVAL = 16,
+			BACKLOG_SPAWN_DELAY_MS = 20,
+		};
+
+		struct WORKER;
+		struct TASKNODE;
 
-		void						WorkerThreadProc();
+		typedef std::vector<std::unique_ptr<WORKER>> WorkerArray;
+		typedef std::deque<TASKNODE*> TaskArray;
 
-		TaskArray					m_tasks;
+		static std::vector<unsigned int>	GetWorkerProcessors(unsigned int, PLACEMENT);
+
+		void						WorkerThreadProc(unsigned int, const std::vector<unsigned int>&, bool allocateWorker);
+		TASKNODE*					FindTask(WORKER&);
+		TASKNODE*					TakeInjectedTask(WORKER*, PRIORITY);
+		TASKNODE*					StealTask(size_t, PRIORITY);
+		bool						HasPendingTasks() const;
+		static TASKNODE*			AllocateNode();
+		static void					ReleaseNode(TASKNODE*);
+
+		void						RunTask(TASKNODE*);
+		void						WakeWorker();
+		bool						Park(WORKER&);
+		bool						SpawnWorker();
+		void						BeginBlocking();
+		void						EndBlocking();
+
+		//One slot per possible worker, slots of workers that exited are reused
+		WorkerArray					m_workers;
+		std::vector<std::thread>	m_threads;
+		size_t						m_readyCount = 0;
+		unsigned int				m_minThreadCount = 0;
+		PLACEMENT					m_placement = PLACEMENT_NONE;
+		std::chrono::milliseconds	m_idleTimeout;
+		std::atomic<unsigned int>	m_activeCount;
+		//Workers in a CBlockingScope, guarded by m_parkMutex
+		unsigned int				m_blockedCount = 0;
+		//Steady clock time since tasks are enqueued with no idle worker, 0 if there's one
+		std::atomic<int64_t>		m_backlogStart;
+
+		//Injection queues, one per priority
+		TaskArray					m_tasks[PRIORITY_COUNT];
 		std::mutex					m_tasksMutex;
+		std::atomic<size_t>			m_taskCounts[PRIORITY_COUNT] = {};
+
+		std::mutex					m_groupsMutex;
+		std::unordered_map<GroupId, CCancellationToken>	m_groups;
 
+		std::mutex					m_parkMutex;
 		std::condition_variable		m_condition;
-		ThreadArray					m_workers;
-		bool						m_stop;
+		std::atomic<unsigned int>	m_parkedCount;
+		std::atomic<bool>			m_stop;
 	};
 }
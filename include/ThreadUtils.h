@@ -1,11 +1,49 @@
 #pragma once
 
 #include <thread>
+#include <vector>
 
 namespace Framework
 {
 	namespace ThreadUtils
 	{
+		enum class THREAD_PRIORITY
+		{
+			LOW,
+			NORMAL,
+			HIGH,
+		};
+
+		struct LOGICAL_PROCESSOR
+		{
+			unsigned int	index = 0;
+			unsigned int	coreIndex = 0;
+			unsigned int	nodeIndex = 0;
+			//0 for the most efficient cores, higher values for faster ones. All 0 when cores are identical.
+			unsigned int	efficiencyClass = 0;
+		};
+
+		//Logical processors sharing a core index are SMT siblings
+		struct CPU_TOPOLOGY
+		{
+			std::vector<LOGICAL_PROCESSOR>	processors;
+			unsigned int					coreCount = 0;
+			unsigned int					nodeCount = 0;
+
+			std::vector<unsigned int>		GetCoreProcessors(unsigned int) const;
+			std::vector<unsigned int>		GetNodeProcessors(unsigned int) const;
+		};
+
 		void SetThreadName(std::thread&, const char*);
+
+		//Processors are given by their LOGICAL_PROCESSOR index. Return false if the platform doesn't allow it.
+		bool SetThreadAffinity(std::thread&, const std::vector<unsigned int>&);
+		bool SetCurrentThreadAffinity(const std::vector<unsigned int>&);
+
+		bool SetThreadPriority(std::thread&, THREAD_PRIORITY);
+		bool SetCurrentThreadPriority(THREAD_PRIORITY);
+
+		//Queried once, falls back to one core per hardware thread on a single node when unavailable
+		const CPU_TOPOLOGY& GetCpuTopology();
 	};
 }
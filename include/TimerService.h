@@ -0,0 +1,53 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Task.h"
+#include "TimerWheel.h"
+
+namespace Framework
+{
+	//Runs tasks after a delay or periodically, from a single thread driving a CTimerWheel. The thread
+	//sleeps until the wheel has something to do and is only woken up by timers due before that.
+	//Tasks are handed to the executor (a thread pool for instance) or run on the timer thread if there's
+	//none, in which case they need to be quick. A task already handed out can still run after Cancel.
+	//Timers pending on destruction are dropped. Thread-safe.
+	class CTimerService
+	{
+	public:
+		typedef CTimerWheel::TimerId TimerId;
+
+		CTimerService(TaskExecutor = TaskExecutor(), std::chrono::milliseconds tickDuration = std::chrono::milliseconds(1));
+		CTimerService(const CTimerService&) = delete;
+		virtual ~CTimerService();
+
+		CTimerService& operator=(const CTimerService&) = delete;
+
+		//Delays are rounded up to the tick duration, tasks never run early
+		TimerId Schedule(std::chrono::milliseconds delay, CTask);
+		//First run is one period from now
+		TimerId SchedulePeriodic(std::chrono::milliseconds period, CTask);
+		bool Cancel(TimerId);
+
+	private:
+		uint64 GetCurrentTick() const;
+		uint64 GetTickCount(std::chrono::milliseconds) const;
+		TimerId ScheduleTimer(std::chrono::milliseconds delay, CTask, uint64 periodTicks);
+		void ThreadProc();
+
+		TaskExecutor m_executor;
+		std::chrono::steady_clock::time_point m_startTime;
+		std::chrono::steady_clock::duration m_tickDuration;
+
+		std::mutex m_mutex;
+		std::condition_variable m_condition;
+		CTimerWheel m_wheel;
+		//Tick the thread sleeps until, 0 while it's awake
+		uint64 m_wakeTick = 0;
+		bool m_stop = false;
+		std::thread m_thread;
+	};
+}
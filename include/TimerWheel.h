@@ -0,0 +1,83 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include "Types.h"
+#include "Task.h"
+
+namespace Framework
+{
+	//Hierarchical timing wheel: LEVEL_COUNT levels of SLOT_COUNT slots, each level covering SLOT_COUNT
+	//times the span of the previous one. Timers are put in the slot matching their expiry on the
+	//lowest level that can hold it and move down the levels as time gets closer. Scheduling and
+	//cancelling are O(1), advancing skips over ticks with nothing to do and costs the timers it moves or expires.
+	//Time is counted in ticks, their duration is up to the user. Timers are kept in a pool of nodes
+	//linked by index, the pool grows to the largest number of timers alive at once.
+	//Not thread-safe, see CTimerService for that.
+	class CTimerWheel
+	{
+	public:
+		typedef uint64 TimerId;
+
+		enum
+		{
+			LEVEL_BITS = 6,
+			SLOT_COUNT = 1 << LEVEL_BITS,
+			LEVEL_COUNT = 6,
+		};
+
+		static constexpr TimerId INVALID_TIMER = ~0ULL;
+
+		//Ticks up to the given one are considered done already
+		CTimerWheel(uint64 currentTick = 0);
+
+		uint64 GetCurrentTick() const;
+		size_t GetTimerCount() const;
+
+		//Timer expires on the first Advance reaching expiryTick, or the next one if it has passed.
+		//Periodic timers are rescheduled period ticks after each expiry until cancelled.
+		TimerId Schedule(uint64 expiryTick, CTask, uint64 periodTicks = 0);
+		//Returns false if the timer already expired (and wasn't periodic) or was cancelled
+		bool Cancel(TimerId);
+
+		//Moves time up to the given tick, tasks of expired timers are appended to the array in expiry order
+		void Advance(uint64 tick, std::vector<CTask>& expiredTasks);
+		//Earliest tick Advance might have something to do at, never later than the next expiry.
+		//Returns ~0 if there are no timers.
+		uint64 GetNextEventTick() const;
+
+	private:
+		enum : uint32
+		{
+			INVALID_NODE = ~0U,
+		};
+
+		struct NODE
+		{
+			uint64 expiryTick = 0;
+			uint64 periodTicks = 0;
+			CTask task;
+			//Shared by the tasks handed out for each expiry
+			std::shared_ptr<CTask> periodicTask;
+			uint32 prev = INVALID_NODE;
+			uint32 next = INVALID_NODE;
+			//Incremented when the node is released, tells stale ids apart
+			uint32 generation = 0;
+			//Level * SLOT_COUNT + slot, INVALID_NODE when not in a slot
+			uint32 slot = INVALID_NODE;
+		};
+
+		uint32 AllocateNode();
+		void ReleaseNode(uint32);
+		void InsertNode(uint32);
+		void UnlinkNode(uint32);
+		void Cascade(uint32 level);
+
+		std::vector<NODE> m_nodes;
+		uint32 m_freeNodes = INVALID_NODE;
+		uint32 m_slots[LEVEL_COUNT * SLOT_COUNT];
+		//Next tick to be processed
+		uint64 m_nextTick = 0;
+		size_t m_timerCount = 0;
+	};
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+//Scoped markers placed in the framework's hot paths. Markers are compiled out entirely unless
+//FRAMEWORK_TRACE_ENABLED (recorded by CTraceRecorder) or FRAMEWORK_TRACE_TRACY (forwarded to Tracy)
+//is defined, see FRAMEWORK_ENABLE_TRACE and FRAMEWORK_ENABLE_TRACE_TRACY in the CMake build.
+//Names need to be string literals.
+
+#if defined(FRAMEWORK_TRACE_TRACY)
+#include <tracy/Tracy.hpp>
+#define FRAMEWORK_TRACE_TRACY_SCOPE(name) ZoneScopedN(name)
+#else
+#define FRAMEWORK_TRACE_TRACY_SCOPE(name)
+#endif
+
+#if defined(FRAMEWORK_TRACE_ENABLED)
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "Singleton.h"
+#include "Types.h"
+
+namespace Framework
+{
+	//Keeps the last events of each thread in a buffer only written by that thread, recording is lock free
+	//once a thread has recorded its first event. Export can be done while other threads are recording,
+	//events overwritten during the export are left out.
+	class CTraceRecorder : public CSingleton<CTraceRecorder>
+	{
+	public:
+		enum
+		{
+			//Per thread, older events are overwritten
+			THREAD_EVENT_COUNT = 0x4000,
+		};
+
+							CTraceRecorder();
+
+		void				SetEnabled(bool);
+		bool				IsEnabled() const;
+
+		//Name shown for the calling thread in exported traces
+		void				SetThreadName(std::string);
+
+		//Nanoseconds since the recorder was created
+		uint64				GetTime() const;
+		void				Record(const char*, uint64 beginTime, uint64 endTime);
+		void				Clear();
+
+		//Chrome trace event format, loads in chrome://tracing and Perfetto
+		std::string			ExportChromeJson();
+
+	private:
+		//Atomics since exports can read events while they are being overwritten
+		struct EVENT
+		{
+			std::atomic<const char*>	name;
+			std::atomic<uint64>	beginTime;
+			std::atomic<uint64>	endTime;
+		};
+
+		struct EVENT_COPY
+		{
+			const char*		name;
+			uint64			beginTime;
+			uint64			endTime;
+		};
+
+		struct THREAD_BUFFER
+		{
+			uint32			threadIndex = 0;
+			std::string		threadName;
+			std::atomic<uint64>	writeCount;
+			//Events before this one were cleared
+			uint64			clearedCount = 0;
+			std::unique_ptr<EVENT[]>	events;
+		};
+
+		typedef std::vector<std::unique_ptr<THREAD_BUFFER>> ThreadBufferArray;
+
+		THREAD_BUFFER&		GetThreadBuffer();
+
+		std::atomic<bool>	m_enabled;
+		uint64				m_baseTime = 0;
+
+		std::mutex			m_threadBuffersMutex;
+		ThreadBufferArray	m_threadBuffers;
+	};
+
+	class CTraceScope
+	{
+	public:
+		explicit CTraceScope(const char* name)
+		{
+			auto& recorder = CTraceRecorder::GetInstance();
+			if(recorder.IsEnabled())
+			{
+				m_name = name;
+				m_beginTime = recorder.GetTime();
+			}
+		}
+
+		CTraceScope(const CTraceScope&) = delete;
+
+		~CTraceScope()
+		{
+			if(m_name)
+			{
+				auto& recorder = CTraceRecorder::GetInstance();
+				recorder.Record(m_name, m_beginTime, recorder.GetTime());
+			}
+		}
+
+		CTraceScope& operator =(const CTraceScope&) = delete;
+
+	private:
+		const char*	m_name = nullptr;
+		uint64		m_beginTime = 0;
+	};
+}
+
+#define FRAMEWORK_TRACE_CONCAT2(a, b) a##b
+#define FRAMEWORK_TRACE_CONCAT(a, b) FRAMEWORK_TRACE_CONCAT2(a, b)
+#define FRAMEWORK_TRACE_RECORDER_SCOPE(name) Framework::CTraceScope FRAMEWORK_TRACE_CONCAT(traceScope_, __LINE__)(name)
+
+#else
+
+#define FRAMEWORK_TRACE_RECORDER_SCOPE(name)
+
+#endif
+
+#define FRAMEWORK_TRACE_SCOPE(name) \
+	FRAMEWORK_TRACE_RECORDER_SCOPE(name); \
+	FRAMEWORK_TRACE_TRACY_SCOPE(name)
@@ -1,8 +1,49 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 
 namespace Framework
 {
-	std::string UrlEncode(const std::string&);
+	//Percent encodes everything but unreserved characters (RFC 3986), and slashes when they're kept.
+	//Slashes are kept for paths, query names and values need them encoded.
+	std::string UrlEncode(std::string_view, bool keepSlashes = true);
+	void UrlEncodeTo(std::string& output, std::string_view, bool keepSlashes = true);
+	//Size of the encoded string, to size the output given to the next one
+	size_t GetUrlEncodedSize(std::string_view, bool keepSlashes = true);
+	//Writes the encoded string without a terminator and returns its size
+	size_t UrlEncode(std::string_view, char* output, bool keepSlashes = true);
+
+	//Malformed escapes are kept as they are. Plus signs are decoded to spaces when asked, as in form data.
+	std::string UrlDecode(std::string_view, bool plusAsSpace = false);
+
+	//Parts of a URL as views into it. Empty when missing, except the path which is "/" when there's
+	//an authority without path. Brackets around IPv6 hosts are removed, user info is skipped.
+	struct URL_COMPONENTS
+	{
+		std::string_view scheme;
+		std::string_view host;
+		std::string_view port;
+		std::string_view path;
+		std::string_view query;
+		std::string_view fragment;
+	};
+
+	//Doesn't decode anything. URLs without "scheme://" are taken as a path (with query and fragment).
+	URL_COMPONENTS ParseUrl(std::string_view);
+
+	//Builds a query string from names and values, encoding them. Parameters are written in the order
+	//they're added (ie.: AWS signatures need them sorted by name).
+	class CUrlQueryBuilder
+	{
+	public:
+		CUrlQueryBuilder& Add(std::string_view name, std::string_view value);
+		CUrlQueryBuilder& Add(std::string_view name, unsigned int value);
+
+		bool IsEmpty() const;
+		const std::string& GetString() const;
+
+	private:
+		std::string m_query;
+	};
 }
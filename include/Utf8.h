@@ -1,143 +1,57 @@
 #ifndef _UTF8_H_
 #define _UTF8_H_
 
-#include <stdexcept>
 #include <string>
+#include <vector>
 
 namespace Framework
 {
 	namespace Utf8
 	{
+		//Sequences that aren't valid UTF-8 (truncated, overlong, surrogates or above U+10FFFF) and
+		//code units that aren't valid UTF-16/UTF-32 (unpaired surrogates or above U+10FFFF) are
+		//replaced by '?', one for each byte or code unit that doesn't start a valid sequence.
+		//Wide strings are UTF-16 where wchar_t is 16 bits wide (Windows) and UTF-32 elsewhere.
+
+		bool			IsValid(const char*, size_t);
+
+		//Exact number of code units written by the matching conversion
+		size_t			GetUtf16Length(const char*, size_t);
+		size_t			GetUtf32Length(const char*, size_t);
+		size_t			GetUtf8Length(const char16_t*, size_t);
+		size_t			GetUtf8Length(const char32_t*, size_t);
+
+		//Return the number of code units written to the output, which needs to be large enough:
+		//UTF-8 to UTF-16/UTF-32 never needs more code units than there are input bytes, and
+		//UTF-16/UTF-32 to UTF-8 never needs more than 3 bytes per UTF-16 unit or 4 per UTF-32 unit.
+		size_t			ConvertToUtf16(const char*, size_t, char16_t*);
+		size_t			ConvertToUtf32(const char*, size_t, char32_t*);
+		size_t			ConvertFromUtf16(const char16_t*, size_t, char*);
+		size_t			ConvertFromUtf32(const char32_t*, size_t, char*);
+
+		//Copies the run of ASCII characters at the start of the input and returns its length,
+		//used as the fast path of converters for encodings that are supersets of ASCII
+		size_t			WidenAsciiPrefix(const char*, size_t, wchar_t*);
+
+		std::wstring	ConvertFrom(const char*, size_t);
+		std::string		ConvertTo(const wchar_t*, size_t);
+
+		std::wstring	ConvertFrom(const std::string&);
+		std::string		ConvertTo(const std::wstring&);
+
 		template <typename IteratorType>
 		std::wstring ConvertFrom(const IteratorType& itBegin, const IteratorType& itEnd)
 		{
-			std::wstring sTemp;
-
-			for(IteratorType itChar(itBegin); itChar != itEnd; itChar++)
-			{
-				char nChar(*itChar);
-				if((nChar & 0x80) == 0)
-				{
-					sTemp += nChar;
-				}
-				else
-				{
-					if((nChar & 0xE0) == 0xC0)
-					{
-						bool valid = false;
-
-						char byte1 = 0;
-						++itChar;
-						if(itChar != itEnd)
-						{
-							byte1 = (*itChar);
-							valid = true;
-						}
-
-						if((byte1 & 0xC0) != 0x80) valid = false;
-
-						if(valid)
-						{
-							wchar_t nWChar = ((nChar & 0x1F) << 6) | (byte1 & 0x3F);
-							sTemp += nWChar;
-						}
-						else
-						{
-							sTemp += '?';
-						}
-					}
-					else if((nChar & 0xF0) == 0xE0)
-					{
-						bool valid = false;
-
-						char byte1 = 0;
-						char byte2 = 0;
-						++itChar;
-						if(itChar != itEnd)
-						{
-							byte1 = (*itChar);
-							++itChar;
-							if(itChar != itEnd)
-							{
-								byte2 = (*itChar);
-								valid = true;
-							}
-						}
-
-						if((byte1 & 0xC0) != 0x80) valid = false;
-						if((byte2 & 0xC0) != 0x80) valid = false;
-
-						if(valid)
-						{
-							wchar_t nWChar = ((nChar & 0x0F) << 12) | ((byte1 & 0x3F) << 6) | (byte2 & 0x3F);
-							sTemp += nWChar;
-						}
-						else
-						{
-							sTemp += '?';
-						}
-					}
-					else
-					{
-						sTemp += '?';
-					}
-				}
-
-				if(itChar == itEnd)
-				{
-					//Can get in here if we failed to fetch a character
-					break;
-				}
-			}
-
-			return sTemp;
+			std::vector<char> input(itBegin, itEnd);
+			return ConvertFrom(input.data(), input.size());
 		}
 
 		template <typename IteratorType>
 		std::string ConvertTo(const IteratorType& itBegin, const IteratorType& itEnd)
 		{
-			std::string result;
-
-			for(IteratorType itChar(itBegin); itChar != itEnd; itChar++)
-			{
-				wchar_t ch = (*itChar);
-				if(ch <= 0x7F)
-				{
-					result += static_cast<char>(ch);
-				}
-				else
-				{
-					if(ch <= 0x7FF)
-					{
-						wchar_t byte1 = 0xC0 | ((ch & 0x700) >> 6) | ((ch & 0xC0) >> 6);
-						wchar_t byte2 = 0x80 | (ch & 0x3F);
-						result += static_cast<char>(byte1);
-						result += static_cast<char>(byte2);
-					}
-					else
-					{
-						if(ch <= 0xFFFF)
-						{
-							wchar_t byte1 = 0xE0 | ((ch & 0xF000) >> 12);
-							wchar_t byte2 = 0x80 | ((ch & 0x0F00) >> 6) | ((ch & 0xC0) >> 6);
-							wchar_t byte3 = 0x80 | (ch & 0x3F);
-							result += static_cast<char>(byte1);
-							result += static_cast<char>(byte2);
-							result += static_cast<char>(byte3);
-						}
-						else
-						{
-							throw std::exception();
-						}
-					}
-				}
-			}
-
-			return result;
+			std::vector<wchar_t> input(itBegin, itEnd);
+			return ConvertTo(input.data(), input.size());
 		}
-
-		std::wstring	ConvertFrom(const std::string&);
-		std::string		ConvertTo(const std::wstring&);
 	};
 }
 
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "Types.h"
+
+namespace Framework
+{
+	//Chase-Lev deque of pointers. Only the owner thread can push and take (LIFO end),
+	//any other thread can steal (FIFO end). Storage grows as needed, replaced arrays
+	//are kept until the deque is destroyed since thieves might still be reading them.
+	template <typename ItemType>
+	class CWorkStealingDeque
+	{
+	public:
+				CWorkStealingDeque(int64 initialSize = DEFAULT_SIZE)
+		{
+			auto array = std::make_unique<CIRCULARARRAY>(initialSize);
+			m_array.store(array.get(), std::memory_order_relaxed);
+			m_arrays.push_back(std::move(array));
+		}
+
+				CWorkStealingDeque(const CWorkStealingDeque&) = delete;
+
+		CWorkStealingDeque& operator =(const CWorkStealingDeque&) = delete;
+
+		void	Push(ItemType* item)
+		{
+			int64 bottom = m_bottom.load(std::memory_order_relaxed);
+			int64 top = m_top.load(std::memory_order_acquire);
+			auto array = m_array.load(std::memory_order_relaxed);
+			if((bottom - top) > (array->size - 1))
+			{
+				array = Grow(array, bottom, top);
+			}
+			array->Put(bottom, item);
+			m_bottom.store(bottom + 1, std::memory_order_release);
+		}
+
+		ItemType*	Take()
+		{
+			int64 bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+			auto array = m_array.load(std::memory_order_relaxed);
+			m_bottom.store(bottom, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			int64 top = m_top.load(std::memory_order_relaxed);
+			if(top > bottom)
+			{
+				//Empty
+				m_bottom.store(bottom + 1, std::memory_order_relaxed);
+				return nullptr;
+			}
+			ItemType* item = array->Get(bottom);
+			if(top == bottom)
+			{
+				//Last item, race against thieves
+				if(!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+				{
+					item = nullptr;
+				}
+				m_bottom.store(bottom + 1, std::memory_order_relaxed);
+			}
+			return item;
+		}
+
+		ItemType*	Steal()
+		{
+			int64 top = m_top.load(std::memory_order_acquire);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			int64 bottom = m_bottom.load(std::memory_order_acquire);
+			if(top >= bottom) return nullptr;
+			auto array = m_array.load(std::memory_order_acquire);
+			ItemType* item = array->Get(top);
+			if(!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			{
+				//Lost the race against another thief or the owner
+				return nullptr;
+			}
+			return item;
+		}
+
+		bool	IsEmpty() const
+		{
+			int64 top = m_top.load(std::memory_order_acquire);
+			int64 bottom = m_bottom.load(std::memory_order_acquire);
+			return top >= bottom;
+		}
+
+	private:
+		enum
+		{
+			DEFAULT_SIZE = 0x100,
+		};
+
+		struct CIRCULARARRAY
+		{
+			CIRCULARARRAY(int64 size)
+			    : size(size)
+			    , items(new std::atomic<ItemType*>[size])
+			{
+			}
+
+			ItemType* Get(int64 index) const
+			{
+				return items[index & (size - 1)].load(std::memory_order_relaxed);
+			}
+
+			void Put(int64 index, ItemType* item)
+			{
+				items[index & (size - 1)].store(item, std::memory_order_relaxed);
+			}
+
+			//Always a power of 2
+			int64 size;
+			std::unique_ptr<std::atomic<ItemType*>[]> items;
+		};
+
+		CIRCULARARRAY*	Grow(CIRCULARARRAY* array, int64 bottom, int64 top)
+		{
+			auto newArray = std::make_unique<CIRCULARARRAY>(array->size * 2);
+			for(int64 i = top; i < bottom; i++)
+			{
+				newArray->Put(i, array->Get(i));
+			}
+			auto result = newArray.get();
+			m_arrays.push_back(std::move(newArray));
+			m_array.store(result, std::memory_order_release);
+			return result;
+		}
+
+		alignas(64) std::atomic<int64>	m_top = {0};
+		alignas(64) std::atomic<int64>	m_bottom = {0};
+		std::atomic<CIRCULARARRAY*>			m_array = {nullptr};
+		std::vector<std::unique_ptr<CIRCULARARRAY>>	m_arrays;
+	};
+}
@@ -1,8 +1,17 @@
 #pragma once
 
+#include <array>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <string_view>
 #include <vector>
 #include "http/HttpClient.h"
+#include "AdaptiveConcurrencyLimiter.h"
+#include "Metrics.h"
+#include "Stream.h"
 
 struct CAmazonCredentials
 {
@@ -19,6 +28,16 @@ struct CAmazonCredentials
 class CAmazonClient
 {
 public:
+	enum
+	{
+		//Requests in flight to an endpoint start with this limit and adapt to throttling from there
+		INITIAL_CONCURRENCY_LIMIT = 8,
+		MAX_CONCURRENCY_LIMIT = 256,
+		MAX_REQUEST_ATTEMPTS = 4,
+		RETRY_BASE_DELAY_MS = 100,
+		RETRY_MAX_DELAY_MS = 20000,
+	};
+
 	CAmazonClient(std::string, CAmazonCredentials, std::string);
 
 protected:
@@ -30,12 +49,43 @@ protected:
 		std::string uri;
 		std::string query;
 		Framework::Http::ByteArray content;
+		//Sent instead of content when set, from the stream's current position
+		Framework::CStream* contentStream = nullptr;
+		uint64 contentStreamSize = 0;
 		Framework::Http::HeaderMap headers;
 	};
 
+	//Requests to an endpoint (url host) go through a concurrency limiter that backs off when the
+	//server throttles (503 SlowDown, 429). Idempotent requests (all but POST) are retried on
+	//connection errors, 408, 429 and 5xx responses after a jittered exponential delay, streamed
+	//content is read again from its starting position. The last response is returned.
 	Framework::Http::RequestResult ExecuteRequest(const Request&);
+	//Full jitter: random between 0 and the exponential delay, or what Retry-After asks if longer
+	static std::chrono::milliseconds GetRetryDelay(unsigned int attempt, std::string_view retryAfter = std::string_view());
 
 	std::string m_service;
 	CAmazonCredentials m_credentials;
 	std::string m_region;
+
+private:
+	Framework::Http::RequestResult SendSignedRequest(const Request&, const std::string& contentHash);
+	std::array<uint8, 0x20> GetSigningKey(const std::string& date);
+	Framework::CAdaptiveConcurrencyLimiter& GetConcurrencyLimiter(const std::string& host);
+
+	//Signing key only depends on the date for a given client, keep the last one
+	std::mutex m_signingKeyMutex;
+	std::string m_signingKeyDate;
+	std::array<uint8, 0x20> m_signingKey = {};
+
+	std::mutex m_concurrencyLimitersMutex;
+	std::map<std::string, std::unique_ptr<Framework::CAdaptiveConcurrencyLimiter>> m_concurrencyLimiters;
+
+	//Shared by all clients of the same service
+	Framework::Metrics::CCounter& m_requestCountMetric;
+	Framework::Metrics::CCounter& m_retryCountMetric;
+	Framework::Metrics::CCounter& m_throttleCountMetric;
+	Framework::Metrics::CCounter& m_sentSizeMetric;
+	Framework::Metrics::CCounter& m_receivedSizeMetric;
+	Framework::Metrics::CHistogram& m_requestDurationMetric;
+	Framework::Metrics::CGauge& m_activeRequestCountMetric;
 };
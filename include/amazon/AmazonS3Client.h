@@ -1,8 +1,10 @@
 #pragma once
 
+#include <future>
 #include <string>
 #include <vector>
 #include "amazon/AmazonClient.h"
+#include "Stream.h"
 
 struct GetBucketLocationRequest
 {
@@ -41,6 +43,9 @@ struct HeadObjectResult
 struct Object
 {
 	std::string key;
+	uint64 size = 0;
+	std::string etag;
+	std::string lastModified;
 };
 
 struct ListObjectsResult
@@ -48,6 +53,24 @@ struct ListObjectsResult
 	std::vector<Object> objects;
 };
 
+struct ListObjectsV2Request
+{
+	std::string bucket;
+	std::string prefix;
+	std::string delimiter;
+	//0 lets S3 use its default (and maximum) of 1000 keys per page
+	unsigned int maxKeys = 0;
+	std::string continuationToken;
+};
+
+struct ListObjectsV2Result
+{
+	std::vector<Object> objects;
+	std::vector<std::string> commonPrefixes;
+	bool isTruncated = false;
+	std::string nextContinuationToken;
+};
+
 struct PutObjectRequest
 {
 	std::string key;
@@ -55,14 +78,125 @@ struct PutObjectRequest
 	std::vector<uint8> data;
 };
 
+struct CreateMultipartUploadRequest
+{
+	std::string bucket;
+	std::string key;
+};
+
+struct CreateMultipartUploadResult
+{
+	std::string uploadId;
+};
+
+struct UploadPartRequest
+{
+	std::string bucket;
+	std::string key;
+	std::string uploadId;
+	unsigned int partNumber = 0;
+	std::vector<uint8> data;
+};
+
+struct UploadPartResult
+{
+	std::string etag;
+};
+
+struct CompletedPart
+{
+	unsigned int partNumber = 0;
+	std::string etag;
+};
+
+struct CompleteMultipartUploadRequest
+{
+	std::string bucket;
+	std::string key;
+	std::string uploadId;
+	std::vector<CompletedPart> parts;
+};
+
+struct AbortMultipartUploadRequest
+{
+	std::string bucket;
+	std::string key;
+	std::string uploadId;
+};
+
 class CAmazonS3Client : public CAmazonClient
 {
 public:
+	enum
+	{
+		DEFAULT_DOWNLOAD_PART_SIZE = 0x800000,
+		DEFAULT_DOWNLOAD_CONCURRENCY = 8,
+		DEFAULT_UPLOAD_PART_SIZE = 0x800000,
+		DEFAULT_UPLOAD_CONCURRENCY = 8,
+		//Limits set by S3, the last part can be smaller
+		MIN_UPLOAD_PART_SIZE = 0x500000,
+		MAX_UPLOAD_PART_COUNT = 10000,
+	};
+
 	CAmazonS3Client(CAmazonCredentials, std::string = "us-east-1");
 
 	GetBucketLocationResult GetBucketLocation(const GetBucketLocationRequest&);
 	GetObjectResult GetObject(const GetObjectRequest&);
 	HeadObjectResult HeadObject(const HeadObjectRequest&);
+	//Lists every object in the bucket, going through all pages
 	ListObjectsResult ListObjects(std::string);
+	ListObjectsV2Result ListObjectsV2(const ListObjectsV2Request&);
 	void PutObject(const PutObjectRequest&);
+	//Sends the next size bytes of the stream as the object's content without loading them in memory,
+	//the stream is read twice: once to hash the content for the signature and once to send it
+	void PutObject(const std::string& bucket, const std::string& key, Framework::CStream&, uint64 size);
+
+	CreateMultipartUploadResult CreateMultipartUpload(const CreateMultipartUploadRequest&);
+	UploadPartResult UploadPart(const UploadPartRequest&);
+	void CompleteMultipartUpload(const CompleteMultipartUploadRequest&);
+	void AbortMultipartUpload(const AbortMultipartUploadRequest&);
+
+	//Downloads the object in parts with concurrent ranged requests and writes it to the stream, at its
+	//current position. Streams that support positional writes get the parts as they arrive, others get
+	//them in order. Failed parts are retried and every part has to come from the same object version.
+	void DownloadObject(const std::string& bucket, const std::string& key, Framework::CStream&,
+	                    uint64 partSize = DEFAULT_DOWNLOAD_PART_SIZE, unsigned int concurrency = DEFAULT_DOWNLOAD_CONCURRENCY);
+
+	//Uploads the rest of the stream as a multipart upload, parts are read in order and sent (and signed)
+	//concurrently, with at most one part per request in memory. Failed parts are retried and the upload
+	//is aborted if it can't be completed.
+	void UploadObject(const std::string& bucket, const std::string& key, Framework::CStream&,
+	                  uint64 partSize = DEFAULT_UPLOAD_PART_SIZE, unsigned int concurrency = DEFAULT_UPLOAD_CONCURRENCY);
+
+private:
+	enum
+	{
+		MAX_PART_ATTEMPTS = 4,
+	};
+
+	std::vector<uint8> GetObjectPart(const std::string& bucket, const std::string& key, const std::string& etag, uint64 offset, uint64 size);
+};
+
+//Goes through the pages of a ListObjectsV2 listing, one request per page. When prefetching is enabled,
+//the next page is requested in the background while the caller works on the current one.
+class CAmazonS3ObjectLister
+{
+public:
+	CAmazonS3ObjectLister(CAmazonS3Client&, ListObjectsV2Request, bool prefetchEnabled = true);
+	CAmazonS3ObjectLister(const CAmazonS3ObjectLister&) = delete;
+	~CAmazonS3ObjectLister();
+
+	CAmazonS3ObjectLister& operator=(const CAmazonS3ObjectLister&) = delete;
+
+	//Returns false once every page was returned
+	bool NextPage(ListObjectsV2Result&);
+
+private:
+	void StartPrefetch();
+
+	CAmazonS3Client& m_client;
+	ListObjectsV2Request m_request;
+	bool m_prefetchEnabled = true;
+	bool m_isDone = false;
+	std::future<ListObjectsV2Result> m_prefetchedPage;
 };
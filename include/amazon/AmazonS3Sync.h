@@ -0,0 +1,85 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <string>
+#include "amazon/AmazonS3Client.h"
+#include "filesystem_def.h"
+
+//Mirrors the objects found under a prefix of a bucket to a local directory. A manifest file remembers
+//the ETag and size of every object downloaded along with the size and modification time of the local
+//file it went to, so that later runs only download objects that changed on either side. Listing pages
+//are diffed as they arrive and changed objects are downloaded concurrently, each one to a temporary
+//file renamed in place, so an interrupted run never leaves partial files behind.
+class CAmazonS3Sync
+{
+public:
+	enum
+	{
+		DEFAULT_CONCURRENCY = 8,
+	};
+
+	struct STATS
+	{
+		uint64 listedCount = 0;
+		uint64 unchangedCount = 0;
+		uint64 downloadedCount = 0;
+		uint64 downloadedSize = 0;
+		uint64 deletedCount = 0;
+		//Keys that can't be mapped to a local path (ie.: containing "..") or directory markers
+		uint64 skippedCount = 0;
+		//Failed downloads are tried again by the next run
+		uint64 failedCount = 0;
+	};
+
+	//The manifest is better kept outside of the directory, it is created by the first run
+	CAmazonS3Sync(CAmazonS3Client&, std::string bucket, std::string prefix, fs::path directory, fs::path manifestPath);
+	CAmazonS3Sync(const CAmazonS3Sync&) = delete;
+
+	CAmazonS3Sync& operator=(const CAmazonS3Sync&) = delete;
+
+	//Throws if the listing fails, the manifest is saved with what was downloaded until then. Deletion
+	//only removes files that were downloaded by an earlier run and only once the whole listing was read.
+	STATS Sync(bool deleteRemoved = false, unsigned int concurrency = DEFAULT_CONCURRENCY);
+
+private:
+	struct MANIFEST_ENTRY
+	{
+		static const uint32 SERIALIZE_VERSION = 1;
+
+		template <typename ArchiveType>
+		void Serialize(ArchiveType& archive, uint32)
+		{
+			archive & etag & size & localSize & localTime;
+		}
+
+		std::string etag;
+		uint64 size = 0;
+		//Local file as it was right after the download
+		uint64 localSize = 0;
+		int64 localTime = 0;
+	};
+
+	typedef std::map<std::string, MANIFEST_ENTRY> Manifest;
+
+	enum : uint32
+	{
+		MANIFEST_MAGIC = 0x4D335353, //'SS3M'
+	};
+
+	void LoadManifest();
+	void SaveManifest();
+
+	bool GetLocalPath(const std::string& key, fs::path&) const;
+	bool IsUnchanged(const Object&, const fs::path&) const;
+	void DownloadObject(const Object&, const fs::path&, unsigned int concurrency, STATS&);
+
+	CAmazonS3Client& m_client;
+	std::string m_bucket;
+	std::string m_prefix;
+	fs::path m_directory;
+	fs::path m_manifestPath;
+
+	mutable std::mutex m_mutex;
+	Manifest m_manifest;
+};
@@ -1,13 +1,15 @@
 #pragma once
 
-#include "Stream.h"
+#include "SpanStream.h"
 #include <android/asset_manager_jni.h>
 
 namespace Framework
 {
 	namespace Android
 	{
-		class CAssetStream : public CStream
+		//Assets can be accessed in place through GetSpan. Uncompressed assets are mapped from the APK,
+		//compressed ones are inflated in memory the first time their data is needed.
+		class CAssetStream : public CSpanStream
 		{
 		public:
 			           CAssetStream(const char*);
@@ -22,9 +24,18 @@ namespace Framework
 			uint64    Write(const void*, uint64) override;
 			bool      IsEOF() override;
 			void      Flush() override;
+			uint64    GetLength() override;
+
+			const uint8*    GetData() const override;
+			const uint8*    GetSpan(uint64, uint64) const override;
+
+			//Returns a descriptor of the file holding the asset (to be closed by the caller) and the asset's
+			//position in it, or -1 if the asset is compressed
+			int       OpenFileDescriptor(int64& start, int64& length);
 			
 		private:
 			AAsset*    m_asset = nullptr;
+			mutable const uint8*    m_buffer = nullptr;
 		};
 	}
 }
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <vector>
+#include "Types.h"
+#include "android_database_Cursor.h"
+
+namespace Framework
+{
+	namespace Android
+	{
+		//Copies the rows of a cursor to native memory a window of rows at a time. Columns are read
+		//with method IDs resolved once and local references are released row by row, values are then
+		//accessed without going through JNI.
+		class CCursorReader
+		{
+		public:
+			//Same values as Cursor.FIELD_TYPE_*
+			enum CELL_TYPE
+			{
+				CELL_TYPE_NULL = 0,
+				CELL_TYPE_INTEGER = 1,
+				CELL_TYPE_FLOAT = 2,
+				CELL_TYPE_STRING = 3,
+				CELL_TYPE_BLOB = 4,
+			};
+
+			enum
+			{
+				DEFAULT_WINDOW_ROWS = 256,
+			};
+
+			CCursorReader(android::database::Cursor&, std::vector<jint>, uint32 = DEFAULT_WINDOW_ROWS);
+
+			//Moves to the next window of rows, returns false once every row has been read
+			bool			FetchWindow();
+
+			uint32			GetRowCount() const;
+
+			CELL_TYPE		GetType(uint32, uint32) const;
+			int64			GetInteger(uint32, uint32) const;
+			double			GetFloat(uint32, uint32) const;
+			//Strings are null terminated modified UTF-8, pointers are valid until the next fetch
+			const char*		GetString(uint32, uint32) const;
+			const uint8*	GetBlob(uint32, uint32) const;
+			uint32			GetSize(uint32, uint32) const;
+
+		private:
+			struct CELL
+			{
+				CELL_TYPE		type = CELL_TYPE_NULL;
+				union
+				{
+					int64		integer;
+					double		real;
+				};
+				//String and blob contents, in m_data
+				uint32			dataOffset = 0;
+				uint32			dataSize = 0;
+			};
+
+			const CELL&		GetCell(uint32, uint32) const;
+			void			ReadCell(JNIEnv*, jint, CELL&);
+
+			android::database::Cursor&	m_cursor;
+			std::vector<jint>	m_columns;
+			uint32				m_windowRows = 0;
+			uint32				m_rowCount = 0;
+			bool				m_done = false;
+			std::vector<CELL>	m_cells;
+			std::vector<uint8>	m_data;
+		};
+	}
+}
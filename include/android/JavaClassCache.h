@@ -0,0 +1,16 @@
+#pragma once
+
+#include <jni.h>
+
+namespace Framework
+{
+	//Resolves the classes and method IDs of every wrapper of this library in one place. Meant to be
+	//called from JNI_OnLoad, where the application class loader is available to FindClass, so that
+	//wrappers never have to look anything up later, whatever thread they're used from.
+	//Wrappers of the Http library are prepared by CAndroidHttpClient::PrepareClassCache.
+	class CJavaClassCache
+	{
+	public:
+		static void Prepare(JavaVM*);
+	};
+}
@@ -36,6 +36,7 @@ namespace Framework
 		static void AttachCurrentThread(JNIEnv**, const char* = nullptr);
 		static void DetachCurrentThread();
 		
+		//Env is cached per thread, threads attached elsewhere need to stay attached while they use it
 		static JNIEnv* GetEnv();
 		
 		static void CheckException(JNIEnv*);
@@ -43,4 +44,23 @@ namespace Framework
 	private:
 		static JavaVM* m_vm;
 	};
+
+	//Local references created while the frame is alive are deleted with it.
+	//Keeps loops creating local references from overflowing the local reference table.
+	class CJavaLocalFrame
+	{
+	public:
+		explicit CJavaLocalFrame(jint = 16);
+		~CJavaLocalFrame();
+
+		CJavaLocalFrame(const CJavaLocalFrame&) = delete;
+		CJavaLocalFrame& operator =(const CJavaLocalFrame&) = delete;
+
+		//Ends the frame early, the object is kept alive and returned as a reference of the enclosing frame
+		jobject Pop(jobject = NULL);
+
+	private:
+		JNIEnv* m_env = nullptr;
+		bool m_popped = false;
+	};
 }
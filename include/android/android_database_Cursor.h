@@ -17,6 +17,16 @@ namespace android
 			jclass clazz = NULL;
 			jmethodID close = NULL;
 			jmethodID getCount = NULL;
+			jmethodID moveToFirst = NULL;
+			jmethodID moveToNext = NULL;
+			jmethodID getColumnIndex = NULL;
+			jmethodID getInt = NULL;
+			jmethodID getLong = NULL;
+			jmethodID getString = NULL;
+			jmethodID isNull = NULL;
+			jmethodID getType = NULL;
+			jmethodID getDouble = NULL;
+			jmethodID getBlob = NULL;
 		};
 		
 		class Cursor : public Framework::CJavaObject
@@ -26,6 +36,18 @@ namespace android
 
 			void close();
 			jint getCount();
+			jboolean moveToFirst();
+			jboolean moveToNext();
+			jint getColumnIndex(jstring);
+			jint getInt(jint);
+			jlong getLong(jint);
+			//Local reference, loops over rows should wrap each row in a Framework::CJavaLocalFrame
+			jstring getString(jint);
+			jboolean isNull(jint);
+			jint getType(jint);
+			jdouble getDouble(jint);
+			//Local reference
+			jbyteArray getBlob(jint);
 		};
 	}
 }
@@ -17,6 +17,8 @@ namespace java
 			jclass clazz = NULL;
 			jmethodID getInstance = NULL;
 			jmethodID digest = NULL;
+			jmethodID digestFinal = NULL;
+			jmethodID update = NULL;
 		};
 		
 		class MessageDigest : public Framework::CJavaObject
@@ -33,6 +35,8 @@ namespace java
 			static MessageDigest getInstance(jstring);
 			
 			jbyteArray digest(jbyteArray);
+			jbyteArray digest();
+			void update(jbyteArray);
 			
 		private:
 		
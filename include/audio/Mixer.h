@@ -0,0 +1,53 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include "Types.h"
+#include "PolyphaseResampler.h"
+
+namespace Framework
+{
+	namespace Audio
+	{
+		//Mixes voices into a stereo float block at the mix rate, converts it to the output rate and hands out
+		//fixed size chunks of interleaved stereo 16-bit frames, the format taken by OpenAl::CStreamingSource
+		//(AL_FORMAT_STEREO16). Chunk size is meant to be the streaming source's frames per buffer, so that
+		//every write fills exactly one buffer.
+		//Mono voices are panned with a constant power law, pan goes from -1 (left) to 1 (right).
+		//Stereo voices are balanced, the opposite channel is attenuated linearly.
+		class CMixer
+		{
+		public:
+			CMixer(unsigned int mixRate, unsigned int outputRate, unsigned int chunkFrameCount);
+
+			//Starts a silent block, all voices mixed until EndBlock need to have the given frame count
+			void BeginBlock(unsigned int frameCount);
+			void MixMono(const int16*, float volume, float pan);
+			void MixMono(const float*, float volume, float pan);
+			//Interleaved left/right frames
+			void MixStereo(const int16*, float volume, float pan);
+			void MixStereo(const float*, float volume, float pan);
+			//Resamples the block and queues it for ReadChunk
+			void EndBlock();
+
+			unsigned int GetChunkFrameCount() const;
+			unsigned int GetAvailableChunkCount() const;
+			//Output needs room for GetChunkFrameCount stereo frames. Returns false if a whole chunk isn't available.
+			bool ReadChunk(int16* output);
+
+		private:
+			typedef std::unique_ptr<CPolyphaseResampler> ResamplerPtr;
+
+			unsigned int m_chunkFrameCount = 0;
+			unsigned int m_blockFrameCount = 0;
+			//Interleaved stereo
+			std::vector<float> m_block;
+			//Null when the mix rate is the output rate
+			ResamplerPtr m_resampler;
+			std::vector<float> m_resampled;
+			//Output rate frames not read yet, starting at m_pendingStart
+			std::vector<float> m_pending;
+			size_t m_pendingStart = 0;
+		};
+	}
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "Types.h"
+
+namespace Framework
+{
+	namespace Audio
+	{
+		//Converts the sample rate of interleaved float frames with a bank of windowed sinc filters, one per
+		//output phase. The rate ratio is reduced to up/down factors, every output frame falls exactly on one
+		//of the up factor's phases as long as it's below MAX_PHASE_COUNT (44100 <-> 48000 needs 160 or 147).
+		//Above that, phases are quantized to MAX_PHASE_COUNT steps. When downsampling, the cutoff moves down
+		//to the output's Nyquist frequency. Output is aligned with input, the delay is only in buffering:
+		//an output frame is produced once tapCount / 2 input frames past its position have been given.
+		class CPolyphaseResampler
+		{
+		public:
+			enum
+			{
+				DEFAULT_TAP_COUNT = 32,
+				MAX_PHASE_COUNT = 1024,
+			};
+
+			//Tap count needs to be a multiple of 4
+			CPolyphaseResampler(unsigned int inputRate, unsigned int outputRate, unsigned int channelCount, unsigned int tapCount = DEFAULT_TAP_COUNT);
+
+			//Output needs room for GetMaxOutputFrameCount(inputFrameCount) frames, returns the number of frames written
+			size_t Process(const float* input, size_t inputFrameCount, float* output);
+			size_t GetMaxOutputFrameCount(size_t inputFrameCount) const;
+
+			//Clears buffered input
+			void Reset();
+
+		private:
+			void BuildFilters();
+
+			unsigned int m_upFactor = 1;
+			unsigned int m_downFactor = 1;
+			unsigned int m_phaseCount = 1;
+			unsigned int m_channelCount = 1;
+			unsigned int m_tapCount = DEFAULT_TAP_COUNT;
+
+			//m_phaseCount filters of m_tapCount coefficients
+			std::vector<float> m_filters;
+			//Planar input history, one buffer per channel
+			std::vector<std::vector<float>> m_history;
+			//Start of the next output frame's window in the history and its phase in up factor units
+			size_t m_windowStart = 0;
+			uint32 m_phase = 0;
+		};
+	}
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstddef>
+#include "Types.h"
+
+namespace Framework
+{
+	namespace Audio
+	{
+		//Full scale is [-1, 1) for float samples, 32768 maps to 1.0
+		void ConvertS16ToF32(float*, const int16*, size_t);
+		//Rounds to nearest (ties depend on the platform) and saturates out of range samples
+		void ConvertF32ToS16(int16*, const float*, size_t);
+	}
+}
@@ -1,8 +1,8 @@
 #pragma once
 
-#include <functional>
 #include "Stream.h"
 #include "Bitmap.h"
+#include "ImageProbe.h"
 
 namespace Framework
 {
@@ -10,11 +10,28 @@ namespace Framework
 	class CBMP
 	{
 	public:
+		//Reads uncompressed 4, 8, 24 and 32 bits images and RLE4/RLE8 images. 4 and 8 bits
+		//images give 8 bits bitmaps of palette indices.
 		static CBitmap		ReadBitmap(CStream&);
+		static CImageProbe::INFO	ReadInfo(CStream&);
 		static void			WriteBitmap(const CBitmap&, CStream&);
 
 	private:
-		typedef std::function<void (CStream&, const CColor&)> PixelWriterFunction;
+		enum COMPRESSION
+		{
+			COMPRESSION_RGB = 0,
+			COMPRESSION_RLE8 = 1,
+			COMPRESSION_RLE4 = 2,
+		};
+
+		enum
+		{
+			//Uncompressed rows are read in blocks of about this size
+			READ_BLOCK_SIZE = 0x100000,
+		};
+
+		static void			ReadPixels(CStream&, CBitmap&, unsigned int, bool);
+		static void			DecodeRle(const uint8*, size_t, CBitmap&, bool);
 
 #pragma pack(push, 1)
 		struct BMHEADER
@@ -42,10 +59,6 @@ namespace Framework
 		};
 		static_assert(sizeof(BMINFOHEADER) == 0x28, "sizeof(HEADER) must be 40 bytes.");
 #pragma pack(pop)
-
-		static void PixelWriter8(CStream&, const CColor&);
-		static void PixelWriter24(CStream&, const CColor&);
-		static void PixelWriter32(CStream&, const CColor&);
 	};
 
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Types.h"
+#include <cstddef>
 #include <functional>
 
 namespace Framework
@@ -26,21 +27,46 @@ namespace Framework
 		uint8	a;
 	};
 
+	class CThreadPool;
+
+	//Provides pixel buffers to bitmaps, must outlive all bitmaps using it.
+	//Buffers are released with the same size they were allocated with.
+	class CBitmapAllocator
+	{
+	public:
+		virtual			~CBitmapAllocator() = default;
+
+		virtual uint8*	Allocate(size_t) = 0;
+		virtual void	Release(uint8*, size_t) = 0;
+	};
+
 	class CBitmap
 	{
 	public:
+		enum RESIZE_FILTER
+		{
+			RESIZE_FILTER_NEAREST,
+			RESIZE_FILTER_BILINEAR,
+			RESIZE_FILTER_BICUBIC,
+			RESIZE_FILTER_LANCZOS,
+			//Kaiser windowed sinc, sharper than Lanczos with less ringing, used for mipmaps
+			RESIZE_FILTER_KAISER,
+		};
+
 						CBitmap() = default;
 						CBitmap(const CBitmap&);
 						CBitmap(CBitmap&&);
-						CBitmap(unsigned int, unsigned int, unsigned int);
+						CBitmap(unsigned int, unsigned int, unsigned int, CBitmapAllocator* = nullptr);
 						~CBitmap();
 
 		CBitmap&		operator =(const CBitmap&);
 		CBitmap&		operator =(CBitmap&&);
 
-		void			Allocate(unsigned int, unsigned int, unsigned int);
+		void			Allocate(unsigned int, unsigned int, unsigned int, CBitmapAllocator* = nullptr);
 		void			Reset();
 
+		CBitmapAllocator*	GetAllocator() const;
+
 		bool			IsEmpty() const;
 
 		unsigned int	GetPixelSize() const;
@@ -58,19 +84,30 @@ namespace Framework
 
 		CBitmap			AddAlphaChannel(uint8 alphaValue) const;
 		CBitmap			Resize(unsigned int, unsigned int) const;
+		//Rows are spread over the thread pool if one is provided
+		CBitmap			Resize(unsigned int, unsigned int, RESIZE_FILTER, CThreadPool* = nullptr) const;
 		CBitmap			ResizeCanvas(unsigned int, unsigned int) const;
 		CBitmap			FlipVertical() const;
 
+		//In-place variants only allocate when the current buffer is too small
+		void			AddAlphaChannelInPlace(uint8 alphaValue);
+		void			ResizeCanvasInPlace(unsigned int, unsigned int);
+		void			FlipVerticalInPlace();
+
 		void			DrawLine(int x1, int y1, int x2, int y2, const CColor&);
 
 	private:
 		void			CopyFrom(const CBitmap&);
 		void			MoveFrom(CBitmap&&);
+		void			AllocateBuffer(size_t);
+		void			ReleaseBuffer();
 
 		unsigned int	m_width = 0;
 		unsigned int	m_height = 0;
 		unsigned int	m_bpp = 0;
 		uint8*			m_pixels = nullptr;
+		size_t			m_capacity = 0;
+		CBitmapAllocator*	m_allocator = nullptr;
 	};
 
 }
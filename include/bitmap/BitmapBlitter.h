@@ -0,0 +1,58 @@
+#pragma once
+
+#include <vector>
+#include "BitmapView.h"
+
+namespace Framework
+{
+	class CThreadPool;
+
+	//Composites many bitmaps into a destination in one pass.
+	//The destination is split in bands of rows that are processed in parallel, operations
+	//are applied in order within every band so later operations are drawn over earlier ones.
+	//Sources must not overlap the destination.
+	class CBitmapBlitter
+	{
+	public:
+		enum BLEND_MODE
+		{
+			BLEND_MODE_COPY,
+			//Straight (non-premultiplied) alpha over
+			BLEND_MODE_ALPHA,
+			//Source colors are already multiplied by alpha
+			BLEND_MODE_PREMULTIPLIED_ALPHA,
+		};
+
+		struct OPERATION
+		{
+			CBitmapView		source;
+			//Position of the source in the destination, can be partly or completely outside
+			int				x = 0;
+			int				y = 0;
+			BLEND_MODE		blendMode = BLEND_MODE_COPY;
+		};
+		typedef std::vector<OPERATION> OperationArray;
+
+		static void		Blit(const CBitmapView&, const OperationArray&, CThreadPool* = nullptr);
+
+	private:
+		enum
+		{
+			ROWS_PER_TASK = 64,
+		};
+
+		struct CLIPPEDOPERATION
+		{
+			const OPERATION*	operation;
+			unsigned int	srcX;
+			unsigned int	srcY;
+			unsigned int	dstX;
+			unsigned int	dstY;
+			unsigned int	width;
+			unsigned int	height;
+		};
+
+		static void		BlendRowAlpha(uint8*, const uint8*, unsigned int);
+		static void		BlendRowPremultipliedAlpha(uint8*, const uint8*, unsigned int);
+	};
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include "Bitmap.h"
+
+namespace Framework
+{
+	//Keeps released pixel buffers around to be reused by bitmaps of the same size.
+	//Can be shared between threads.
+	class CBitmapPool : public CBitmapAllocator
+	{
+	public:
+		enum
+		{
+			DEFAULT_MAX_CACHED_SIZE = 256 * 1024 * 1024,
+		};
+
+						CBitmapPool(size_t maxCachedSize = DEFAULT_MAX_CACHED_SIZE);
+						CBitmapPool(const CBitmapPool&) = delete;
+		virtual			~CBitmapPool();
+
+		CBitmapPool&	operator =(const CBitmapPool&) = delete;
+
+		uint8*			Allocate(size_t) override;
+		void			Release(uint8*, size_t) override;
+
+		size_t			GetCachedSize() const;
+		void			Clear();
+
+	private:
+		typedef std::multimap<size_t, uint8*> BufferMap;
+
+		mutable std::mutex	m_mutex;
+		BufferMap		m_buffers;
+		size_t			m_cachedSize = 0;
+		size_t			m_maxCachedSize = 0;
+	};
+}
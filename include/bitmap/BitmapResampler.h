@@ -0,0 +1,37 @@
+#pragma once
+
+#include <vector>
+#include "Bitmap.h"
+
+namespace Framework
+{
+	class CThreadPool;
+
+	//Separable resampler, the image is first filtered horizontally then vertically.
+	//Filter weights are computed once per output column/row in 2.14 fixed point.
+	class CBitmapResampler
+	{
+	public:
+		static void			Resample(const CBitmap&, CBitmap&, CBitmap::RESIZE_FILTER, CThreadPool* = nullptr);
+
+	private:
+		enum
+		{
+			COEF_BITS = 14,
+			ROWS_PER_TASK = 64,
+		};
+
+		struct FILTERCOEFS
+		{
+			//First source sample and number of samples used by each output sample
+			std::vector<unsigned int>	bounds;
+			std::vector<int16>			coefs;
+			unsigned int				coefCount = 0;
+		};
+
+		static FILTERCOEFS	ComputeCoefs(unsigned int, unsigned int, CBitmap::RESIZE_FILTER);
+
+		static void			ResampleRowHorizontal(uint8*, const uint8*, unsigned int, unsigned int, const FILTERCOEFS&);
+		static void			ResampleRowVertical(uint8*, const uint8* const*, unsigned int, unsigned int, const int16*);
+	};
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "BitmapView.h"
+
+namespace Framework
+{
+	//Destination decoders can write their rows straight into (locked texture, pixel buffer, staging
+	//buffer, etc.), which avoids decoding into a CBitmap first and copying it afterwards.
+	class CBitmapSink
+	{
+	public:
+		virtual			~CBitmapSink() = default;
+
+		//Called once the size of the image is known. Returned view needs to have the same size and bits per
+		//pixel and stay valid until EndImage is called. Rows can be written in any order.
+		virtual CBitmapView	BeginImage(unsigned int width, unsigned int height, unsigned int bpp) = 0;
+		//Called once all rows were written, not called if decoding fails
+		virtual void	EndImage() = 0;
+	};
+}
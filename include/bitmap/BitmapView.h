@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include "Bitmap.h"
+
+namespace Framework
+{
+	//Non-owning window over pixels stored elsewhere (usually a CBitmap).
+	//Pitch can be larger than a row or negative, which allows cropping and flipping without copies.
+	class CBitmapView
+	{
+	public:
+						CBitmapView() = default;
+						CBitmapView(uint8*, unsigned int, unsigned int, unsigned int, ptrdiff_t);
+						CBitmapView(const CBitmap&);
+
+		bool			IsEmpty() const;
+
+		unsigned int	GetWidth() const;
+		unsigned int	GetHeight() const;
+		unsigned int	GetBitsPerPixel() const;
+		unsigned int	GetPixelSize() const;
+		ptrdiff_t		GetPitch() const;
+
+		uint8*			GetPixels() const;
+		uint8*			GetRow(unsigned int) const;
+
+		CColor			GetPixel(unsigned int, unsigned int) const;
+		void			SetPixel(unsigned int, unsigned int, const CColor&) const;
+
+		CBitmapView		Crop(unsigned int, unsigned int, unsigned int, unsigned int) const;
+		CBitmapView		FlipVertical() const;
+
+		CBitmap			ToBitmap(CBitmapAllocator* = nullptr) const;
+
+	private:
+		uint8*			m_pixels = nullptr;
+		unsigned int	m_width = 0;
+		unsigned int	m_height = 0;
+		unsigned int	m_bpp = 0;
+		ptrdiff_t		m_pitch = 0;
+	};
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "Stream.h"
+
+namespace Framework
+{
+	//Reads only the headers of an image to find out its format and dimensions, no pixel memory is allocated.
+	class CImageProbe
+	{
+	public:
+		enum FORMAT
+		{
+			FORMAT_UNKNOWN,
+			FORMAT_BMP,
+			FORMAT_JPEG,
+			FORMAT_PNG,
+			FORMAT_TGA,
+		};
+
+		struct INFO
+		{
+			FORMAT			format = FORMAT_UNKNOWN;
+			unsigned int	width = 0;
+			unsigned int	height = 0;
+			//As stored in the file (palette indices for paletted images)
+			unsigned int	bitsPerPixel = 0;
+		};
+
+		//Format is detected from the data at the current position of the stream, which is then left
+		//somewhere inside the headers. Throws if the format isn't recognized or headers are invalid.
+		static INFO		ProbeImage(CStream&);
+	};
+}
@@ -1,17 +1,51 @@
 #pragma once
 
+#include <functional>
+#include <vector>
 #include "Stream.h"
-#include "BitStream.h"
+#include "StreamBitStream.h"
 #include "Bitmap.h"
+#include "BitmapSink.h"
+#include "BitmapView.h"
+#include "ImageProbe.h"
 #include "idct/Interface.h"
 
 namespace Framework
 {
+	class CThreadPool;
+
 	class CJPEG
 	{
 	public:
 		static CBitmap		ReadBitmap(CStream&);
 
+		//Restart intervals are decoded in parallel and IDCT/colour conversion runs as
+		//soon as MCU rows are entropy decoded. Must not be called from one of the pool's threads.
+		static CBitmap		ReadBitmap(CStream&, CThreadPool&);
+
+		//Decodes at 1/2, 1/4 or 1/8 of the original size (rounded up) with reduced IDCTs.
+		//Much cheaper than decoding the full image and resizing it, meant for thumbnails.
+		static CBitmap		ReadBitmap(CStream&, unsigned int scaleDenominator);
+
+		//Pixels are converted straight into the memory provided by the sink (32 bits per pixel).
+		static void			ReadBitmap(CStream&, CBitmapSink&);
+		static void			ReadBitmap(CStream&, CBitmapSink&, CThreadPool&);
+
+		//Skips markers up to the frame header, doesn't go through any of the entropy coded data
+		static CImageProbe::INFO	ReadInfo(CStream&);
+
+		//Decodes the thumbnail embedded in the EXIF data (APP1) without going further in the stream.
+		//Returns an empty bitmap if the image doesn't have one.
+		static CBitmap		ExtractThumbnail(CStream&);
+
+		//Writes a baseline 4:2:0 JFIF image, quality goes from 1 to 100 (same scale as libjpeg).
+		static void			WriteBitmap(const CBitmap&, CStream&, unsigned int quality = DEFAULT_WRITE_QUALITY);
+
+		enum
+		{
+			DEFAULT_WRITE_QUALITY = 90,
+		};
+
 		enum JERROR
 		{
 			JERROR_SUCCESS				= 0,
@@ -25,6 +59,12 @@ namespace Framework
 		};
 
 	private:
+		enum
+		{
+			HUFF_LOOKAHEAD_BITS = 9,
+			SEGMENT_PADDING = 8,
+			LUMA_PLANE_STRIDE = 16,
+		};
 
 		struct QUANTIZATIONTABLE
 		{
@@ -70,31 +110,44 @@ namespace Framework
 			uint8					nL[16];
 			uint8*					pV[16];
 			uint16*					nCodeTable;
-			int16					nMin[16];
-			int16					nMax[16];
+			int32					nMin[16];
+			int32					nMax[16];
+			//(length << 8) | value for codes that fit in the lookahead, 0 otherwise
+			uint16					nLookup[1 << HUFF_LOOKAHEAD_BITS];
+		};
+
+		struct BLOCKDECODER
+		{
+			const HUFFMANTABLE*		pDCHt;
+			const HUFFMANTABLE*		pACHt;
+			const uint8*			pQ;
 		};
-									CJPEG(Framework::CStream&);
+		typedef std::vector<uint8> Segment;
+		typedef std::vector<Segment> SegmentArray;
+
+									CJPEG(Framework::CStream&, CThreadPool*, unsigned int scaleDenominator = 1);
 									~CJPEG();
 	
-		uint8						HuffGetBit();
-		uint8						HuffDecode(HUFFMANTABLE*);
-		uint32						HuffReceive(unsigned int);
-		uint32						HuffExtend(uint32, unsigned int);
+		static uint8				HuffDecodeValue(CStreamBitStream&, const HUFFMANTABLE*, int32&);
+		static uint32				HuffExtend(uint32, unsigned int);
 		void						HuffGenerateSubTables(HUFFMANTABLE*);
 		uint8*						HuffGenerateSizeTable(HUFFMANTABLE*);
 		uint16*						HuffGenerateCodeTable(uint8*);
 		void						HuffGenerateMinMaxTables(HUFFMANTABLE*);
+		void						HuffGenerateLookupTable(HUFFMANTABLE*, const uint8*);
 
 		unsigned int				Decode();
-		unsigned int				DecodeMCU(int, uint8*, int*);
-		void						Draw8x8Block(unsigned int, unsigned int, uint8*, uint8*, uint8*, uint8*);
-		uint8						FixRange(double);
+		SegmentArray				ReadScanSegments();
+		void						DecodeSegment(const Segment&, unsigned int, unsigned int, const std::function<void (unsigned int)>&);
+		void						DecodeMCU(CStreamBitStream&, const BLOCKDECODER&, int16*, int*);
+		void						ReconstructMCUs(unsigned int, unsigned int);
 
 		Framework::CBitmap			Process();
 		unsigned int				ProcessSOF0();
 		unsigned int				ProcessDHT();
 		unsigned int				ProcessSOS();
 		unsigned int				ProcessDQT();
+		void						ProcessDRI();
 		void						ProcessAPPx();
 		void						ProcessCOM();
 
@@ -108,9 +161,26 @@ namespace Framework
 		static IDCT::CInterface*	m_pIDCT;
 		static unsigned char		m_nZigZag[64];
 
-		bool						m_nHuffSkipNext;
-
-		Framework::CBitStream*		m_stream;
+		uint8						m_nSampX = 0;
+		uint8						m_nSampY = 0;
+		unsigned int				m_nMCUsPerLine = 0;
+		unsigned int				m_nMCUCount = 0;
+		unsigned int				m_nBlocksPerMCU = 0;
+		unsigned int				m_nMCUCoefs = 0;
+		unsigned int				m_nScaleDenominator = 1;
+		unsigned int				m_nBlockSize = 8;
+		unsigned int				m_nChromaWidth = 8;
+		unsigned int				m_nChromaHeight = 8;
+		std::vector<int16>			m_coefficients;
+
+		uint16						m_restartInterval = 0;
+		uint16						m_pendingMarker = 0;
+		CThreadPool*				m_threadPool = nullptr;
+
+		Framework::CStreamBitStream*	m_stream;
 		Framework::CBitmap			m_bitmap;
+		CBitmapSink*				m_sink = nullptr;
+		//Either the bitmap or the memory provided by the sink
+		CBitmapView					m_output;
 	};
 }
@@ -1,18 +1,42 @@
 #pragma once
 
+#include <vector>
+#include <zstd_zlibwrapper.h>
 #include "Types.h"
 #include "Stream.h"
 #include "Bitmap.h"
+#include "BitmapSink.h"
+#include "BitmapView.h"
+#include "ImageProbe.h"
 
 namespace Framework
 {
 
+	class CThreadPool;
+
 	class CPNG
 	{
 	public:
+		//Image data is inflated and unfiltered one scanline at a time straight into the bitmap.
 		static CBitmap		ReadBitmap(CStream&);
+		//Scanlines are written straight into the memory provided by the sink.
+		static void			ReadBitmap(CStream&, CBitmapSink&);
+		static CImageProbe::INFO	ReadInfo(CStream&);
+
+		//Accepts 8 (grayscale), 24 (RGB) and 32 (RGBA) bits per pixel bitmaps.
+		//Filter selection and compression of the image's chunks are spread over the thread pool.
+		static void			WriteBitmap(const CBitmap&, CStream&);
+		static void			WriteBitmap(const CBitmap&, CStream&, CThreadPool&);
 
 	private:
+		enum
+		{
+			INPUT_BUFFER_SIZE = 0x10000,
+			DEFLATE_CHUNK_SIZE = 0x20000,
+			DEFLATE_WINDOW_SIZE = 0x8000,
+		};
+
+							CPNG();
 							~CPNG();
 
 		class CIHDR
@@ -20,7 +44,8 @@ namespace Framework
 		public:
 			void			Unserialize(CStream&);
 			unsigned int	GetSamplesPerPixel();
-			unsigned int	CalculateNeededBufferSize();
+			unsigned int	GetBitsPerPixel();
+			unsigned int	GetScanlineSize();
 
 			uint32			m_nWidth = 0;
 			uint32			m_nHeight = 0;
@@ -31,21 +56,38 @@ namespace Framework
 			uint8			m_nInterlace = 0;
 		};
 
-		CBitmap				DoRead(CStream&);
-		void				UncompressIDAT();
-		void				SubFilter(uint8*, int, unsigned int, unsigned int);
-		void				UpFilter(uint8*, int, unsigned int, unsigned int);
-		void				AverageFilter(uint8*, int, unsigned int, unsigned int);
-		void				PaethFilter(uint8*, int, unsigned int, unsigned int);
-		uint8				PaethPredictor(uint8, uint8, uint8);
-		CBitmap				CreateBitmap();
-		CBitmap				ConvertTo32(const CBitmap&) const;
+		CBitmap				DoRead(CStream&, CBitmapSink*);
+		static void			DoWrite(const CBitmap&, CStream&, CThreadPool*);
+		void				BeginImage();
+		void				ProcessIDAT(CStream&, uint32);
+		void				InflateIDAT(const uint8*, uint32);
+		void				ProcessScanline();
+		void				ExpandPalette(const uint8*, uint8*) const;
+
+		static void			SubFilter(uint8*, unsigned int, unsigned int);
+		static void			UpFilter(uint8*, const uint8*, unsigned int);
+		static void			AverageFilter(uint8*, const uint8*, unsigned int, unsigned int);
+		static void			PaethFilter(uint8*, const uint8*, unsigned int, unsigned int);
+		static uint8		PaethPredictor(uint8, uint8, uint8);
 
 		CIHDR				m_IHDR;
 		uint8				m_nPalette[0x300];
-		uint8*				m_pBuffer = nullptr;
-		uint8*				m_pIDAT = nullptr;
-		unsigned int		m_nIDATSize = 0;
+		//Palette entries as RGBA32 pixels (alpha is 0)
+		uint32				m_nPalette32[0x100];
+		CBitmap				m_bitmap;
+		CBitmapSink*		m_sink = nullptr;
+		//Either the bitmap or the memory provided by the sink
+		CBitmapView			m_output;
+
+		z_stream			m_zStream;
+		bool				m_zStreamInitialized = false;
+		std::vector<uint8>	m_inputBuffer;
+
+		//Filter type byte followed by the scanline's data
+		std::vector<uint8>	m_currentScanline;
+		std::vector<uint8>	m_previousScanline;
+		unsigned int		m_nScanlinePosition = 0;
+		unsigned int		m_nScanlineIndex = 0;
 	};
 
 }
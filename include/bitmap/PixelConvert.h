@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include "Types.h"
+
+namespace Framework
+{
+	//Pixel format conversion kernels working on runs of pixels.
+	//Pixels are stored as bytes in memory order (ie.: RGBA32 is R, G, B, A).
+	//Unless noted otherwise, source and destination can be the same buffer.
+	namespace PixelConvert
+	{
+		//Destination can't overlap with source
+		void			RGB24ToRGBA32(uint8*, const uint8*, size_t, uint8 alpha = 0xFF);
+		void			RGBA32ToRGB24(uint8*, const uint8*, size_t);
+
+		//Swaps the first and third channels (RGB <-> BGR, RGBA <-> BGRA)
+		void			SwapRedBlue24(uint8*, const uint8*, size_t);
+		void			SwapRedBlue32(uint8*, const uint8*, size_t);
+
+		void			PremultiplyAlpha(uint8*, const uint8*, size_t);
+		void			UnpremultiplyAlpha(uint8*, const uint8*, size_t);
+
+		//Expands 8-bit indices to 32-bit palette entries, destination can't overlap with source
+		void			ExpandPalette8(uint8*, const uint8*, size_t, const uint32* palette);
+	}
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Bitmap.h"
+#include "ImageProbe.h"
 #include "Stream.h"
 
 namespace Framework
@@ -8,12 +9,30 @@ namespace Framework
 	class CTGA
 	{
 	public:
+		//Reads true color (24 and 32 bits), grayscale and color mapped (8 bits with a 24 or 32 bits map,
+		//expanded to 32 bits) images, uncompressed or RLE
 		static CBitmap		ReadBitmap(CStream&);
+		//TGA has no signature, throws if the header doesn't look like a TGA header
+		static CImageProbe::INFO	ReadInfo(CStream&);
 
 	private:
 		enum TGA_IMAGE_TYPE
 		{
+			TGA_IMAGE_COLORMAPPED = 1,
 			TGA_IMAGE_RGB = 2,
+			TGA_IMAGE_GRAYSCALE = 3,
+			TGA_IMAGE_RLE = 8,
+		};
+
+		enum TGA_DESCRIPTOR
+		{
+			TGA_DESCRIPTOR_RIGHT_ORIGIN = 0x10,
+			TGA_DESCRIPTOR_TOP_ORIGIN = 0x20,
+		};
+
+		enum
+		{
+			RLE_READ_SIZE = 0x10000,
 		};
 
 #pragma pack(push, 1)
@@ -38,5 +57,7 @@ namespace Framework
 #pragma pack(pop)
 
 		static_assert(sizeof(TGA_HEADER) == 0x12, "TGA Header must be 0x12 bytes.");
+
+		static void			DecodeRle(CStream&, uint8*, size_t, unsigned int);
 	};
 }
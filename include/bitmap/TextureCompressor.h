@@ -0,0 +1,70 @@
+#pragma once
+
+#include <vector>
+#include "Bitmap.h"
+
+namespace Framework
+{
+	class CThreadPool;
+
+	//Encodes bitmaps to GPU block compressed formats. Rows of 4x4 blocks are spread over the thread pool.
+	//Levels are laid out like the GPU expects them and can be given as is to Vulkan::CImage::Fill
+	//or to CopyCompressedLevelToTexture (D3D9, BC1 and BC3 only). Matching texture formats:
+	//BC1        : VK_FORMAT_BC1_RGB_UNORM_BLOCK, D3DFMT_DXT1
+	//BC3        : VK_FORMAT_BC3_UNORM_BLOCK, D3DFMT_DXT5
+	//BC7        : VK_FORMAT_BC7_UNORM_BLOCK
+	//ETC2_RGB8  : VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK
+	//ETC2_RGBA8 : VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK
+	class CTextureCompressor
+	{
+	public:
+		enum FORMAT
+		{
+			FORMAT_BC1,
+			FORMAT_BC3,
+			//Only uses mode 6 (single subset RGBA, 4 bit indices)
+			FORMAT_BC7,
+			//Only uses the ETC1 compatible individual and differential modes
+			FORMAT_ETC2_RGB8,
+			FORMAT_ETC2_RGBA8,
+		};
+
+		enum MIP_FILTER
+		{
+			//Average of 2x2 pixels, last row/column is dropped on odd sizes
+			MIP_FILTER_BOX,
+			MIP_FILTER_KAISER,
+		};
+
+		struct LEVEL
+		{
+			unsigned int		width = 0;
+			unsigned int		height = 0;
+			std::vector<uint8>	data;
+		};
+		typedef std::vector<LEVEL> LevelArray;
+
+		//Size of a 4x4 block in bytes
+		static unsigned int		GetBlockSize(FORMAT);
+		//Partial blocks on the edges take a whole block
+		static size_t			GetLevelSize(FORMAT, unsigned int, unsigned int);
+
+		//Takes 24 or 32 bpp bitmaps in RGB(A) order, alpha is dropped by BC1 and ETC2_RGB8
+		static LEVEL			Compress(const CBitmap&, FORMAT, CThreadPool* = nullptr);
+		//Goes down to 1x1, every level is filtered from the previous one
+		static LevelArray		CompressMipChain(const CBitmap&, FORMAT, MIP_FILTER, CThreadPool* = nullptr);
+
+		//Next level of a mip chain, half the size rounded down
+		static CBitmap			GenerateMip(const CBitmap&, MIP_FILTER, CThreadPool* = nullptr);
+
+	private:
+		enum
+		{
+			BLOCK_ROWS_PER_TASK = 4,
+			ROWS_PER_TASK = 64,
+		};
+
+		static void				CompressBlockRow(const CBitmap&, FORMAT, unsigned int, uint8*);
+		static void				BoxFilterRow(uint8*, const uint8*, const uint8*, unsigned int, unsigned int);
+	};
+}
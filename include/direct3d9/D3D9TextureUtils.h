@@ -1,7 +1,10 @@
 #pragma once
 
 #include <d3d9.h>
+#include <stdexcept>
 #include "bitmap\Bitmap.h"
+#include "bitmap\BitmapSink.h"
+#include "bitmap\TextureCompressor.h"
 
 template <typename PixelType>
 static void CopyTextureToBitmap(Framework::CBitmap& bitmap, IDirect3DTexture9* texture, uint32 mipLevel)
@@ -46,3 +49,111 @@ static void CopyBitmapToTexture(IDirect3DTexture9* texture, uint32 mipLevel, con
 	result = texture->UnlockRect(mipLevel);
 	assert(SUCCEEDED(result));
 }
+
+//Copies a level made by CTextureCompressor, texture needs to be D3DFMT_DXT1 for BC1 or D3DFMT_DXT5 for BC3
+static void CopyCompressedLevelToTexture(IDirect3DTexture9* texture, uint32 mipLevel, const Framework::CTextureCompressor::LEVEL& level, Framework::CTextureCompressor::FORMAT format)
+{
+	HRESULT result = S_OK;
+
+	D3DFORMAT textureFormat = D3DFMT_UNKNOWN;
+	switch(format)
+	{
+	case Framework::CTextureCompressor::FORMAT_BC1:
+		textureFormat = D3DFMT_DXT1;
+		break;
+	case Framework::CTextureCompressor::FORMAT_BC3:
+		textureFormat = D3DFMT_DXT5;
+		break;
+	default:
+		throw std::runtime_error("Compressed format not supported by Direct3D 9.");
+		break;
+	}
+
+	D3DSURFACE_DESC levelDesc = {};
+	result = texture->GetLevelDesc(mipLevel, &levelDesc);
+	assert(SUCCEEDED(result));
+	if((levelDesc.Format != textureFormat) || (levelDesc.Width != level.width) || (levelDesc.Height != level.height))
+	{
+		throw std::runtime_error("Texture level doesn't match compressed level.");
+	}
+
+	D3DLOCKED_RECT lockedRect = {};
+	result = texture->LockRect(mipLevel, &lockedRect, nullptr, 0);
+	assert(SUCCEEDED(result));
+
+	//Pitch is the size of a row of blocks
+	unsigned int rowSize = ((level.width + 3) / 4) * Framework::CTextureCompressor::GetBlockSize(format);
+	auto srcPtr = level.data.data();
+	auto dstPtr = reinterpret_cast<uint8*>(lockedRect.pBits);
+	for(unsigned int y = 0; y < level.height; y += 4)
+	{
+		memcpy(dstPtr, srcPtr, rowSize);
+		dstPtr += lockedRect.Pitch;
+		srcPtr += rowSize;
+	}
+
+	result = texture->UnlockRect(mipLevel);
+	assert(SUCCEEDED(result));
+}
+
+//Lets a decoder write straight into a texture level instead of going through a bitmap and CopyBitmapToTexture.
+//Level stays locked while the image is decoded, its size and format need to match the decoder's output.
+class CD3D9TextureSink : public Framework::CBitmapSink
+{
+public:
+	CD3D9TextureSink(IDirect3DTexture9* texture, uint32 mipLevel)
+		: m_texture(texture)
+		, m_mipLevel(mipLevel)
+	{
+
+	}
+
+	CD3D9TextureSink(const CD3D9TextureSink&) = delete;
+
+	virtual ~CD3D9TextureSink()
+	{
+		if(m_locked)
+		{
+			//Decoder failed
+			m_texture->UnlockRect(m_mipLevel);
+		}
+	}
+
+	CD3D9TextureSink& operator =(const CD3D9TextureSink&) = delete;
+
+	Framework::CBitmapView BeginImage(unsigned int width, unsigned int height, unsigned int bpp) override
+	{
+		HRESULT result = S_OK;
+
+		D3DSURFACE_DESC levelDesc = {};
+		result = m_texture->GetLevelDesc(m_mipLevel, &levelDesc);
+		assert(SUCCEEDED(result));
+		if((levelDesc.Width != width) || (levelDesc.Height != height))
+		{
+			throw std::runtime_error("Texture level doesn't match decoded image.");
+		}
+
+		D3DLOCKED_RECT lockedRect = {};
+		result = m_texture->LockRect(m_mipLevel, &lockedRect, nullptr, 0);
+		if(FAILED(result))
+		{
+			throw std::runtime_error("Couldn't lock texture level.");
+		}
+		m_locked = true;
+
+		return Framework::CBitmapView(reinterpret_cast<uint8*>(lockedRect.pBits), width, height, bpp, lockedRect.Pitch);
+	}
+
+	void EndImage() override
+	{
+		assert(m_locked);
+		HRESULT result = m_texture->UnlockRect(m_mipLevel);
+		assert(SUCCEEDED(result));
+		m_locked = false;
+	}
+
+private:
+	IDirect3DTexture9* m_texture = nullptr;
+	uint32 m_mipLevel = 0;
+	bool m_locked = false;
+};
@@ -18,13 +18,24 @@ namespace Framework
 										CDevice(const DirectInputDevicePtr&);
 			virtual						~CDevice();
 
-			virtual void				ProcessEvents(const InputEventHandler&) = 0;
+			//Reads everything buffered by the device, false if it couldn't be read (ie.: not acquired, it will be retried later)
+			virtual bool				ProcessEvents(const InputEventHandler&) = 0;
+			//Signaled when the device has new data, null if notifications aren't supported and the device needs polling
+			HANDLE						GetEventHandle() const;
 			bool						GetInfo(DIDEVICEINSTANCE*);
 			bool						GetObjectInfo(uint32, DIDEVICEOBJECTINSTANCE*);
 			void						SetFocusWindow(HWND);
 
 		protected:
+			enum
+			{
+				DEVICE_BUFFER_SIZE = 0x80,
+			};
+
+			bool						ReadDeviceData(const GUID&, const InputEventHandler&);
+
 			DirectInputDevicePtr		m_device;
+			HANDLE						m_event = NULL;
 		};
 	}
 }
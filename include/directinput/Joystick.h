@@ -14,7 +14,7 @@ namespace Framework
 			virtual					~CJoystick() = default;
 
 			int						GetButtonCount() const;
-			void					ProcessEvents(const InputEventHandler&) override;
+			bool					ProcessEvents(const InputEventHandler&) override;
 			void					SetVibration(uint8_t largeMotor, uint8_t smallMotor);
 
 		private:
@@ -12,7 +12,7 @@ namespace Framework
 									CKeyboard(const DirectInputDevicePtr&);
 			virtual					~CKeyboard();
 
-			void					ProcessEvents(const InputEventHandler&) override;
+			bool					ProcessEvents(const InputEventHandler&) override;
 		};
 	}
 }
@@ -1,13 +1,16 @@
 #pragma once
 
 #include "DirectInput.h"
+#include <atomic>
 #include <memory>
 #include <list>
 #include <map>
 #include <unordered_map>
+#include <vector>
 #include "win32/GuidUtils.h"
 #include "win32/ComPtr.h"
 #include "Device.h"
+#include "LockFreeQueue.h"
 
 namespace Framework
 {
@@ -18,14 +21,28 @@ namespace Framework
 		public:
 			typedef std::function<void (const GUID&, uint32, uint32)> InputEventHandler;
 
+			struct INPUT_EVENT
+			{
+				GUID		deviceId;
+				uint32		id;
+				uint32		value;
+				//QueryPerformanceCounter value taken when the update thread was woken up by the device
+				int64		timestamp;
+			};
+
 									CManager(bool filterXInput = false);
 			virtual					~CManager();
 
 			void					SetFocusWindow(HWND);
 
+			//Handlers are called on the update thread, but not while devices are locked
 			uint32					RegisterInputEventHandler(const InputEventHandler&);
 			void					UnregisterInputEventHandler(uint32);
 
+			//Events are also queued for a single consumer thread that prefers to drain them at its own
+			//pace (ie.: once per emulated frame). New events are dropped while the queue is full.
+			bool					TryPopInputEvent(INPUT_EVENT&);
+
 			void					CreateKeyboard();
 			void					CreateJoysticks();
 			std::list<GUID>			GetJoystickIds();
@@ -40,7 +57,17 @@ namespace Framework
 			typedef std::list<GUID> JoystickInstanceList;
 			typedef std::unordered_map<uint32, InputEventHandler> InputEventHandlerMap;
 			typedef Framework::Win32::CComPtr<IDirectInput8> DirectInputPtr;
+			typedef std::vector<INPUT_EVENT> InputEventArray;
+
+			enum
+			{
+				//Devices without notifications or that couldn't be acquired are polled at this interval (in ms)
+				DEVICE_POLL_INTERVAL = 16,
+				INPUT_EVENT_QUEUE_SIZE = 0x400,
+			};
 
+			void					SignalUpdateThread();
+			void					DispatchInputEvents(const InputEventArray&);
 			DWORD					UpdateThreadProc();
 			static DWORD CALLBACK	UpdateThreadProcStub(void*);
 
@@ -56,8 +83,13 @@ namespace Framework
 			uint32					m_nextInputEventHandlerId;
 
 			HANDLE					m_updateThreadHandle;
-			bool					m_updateThreadOver;
+			std::atomic<bool>		m_updateThreadOver;
+			//Wakes the update thread up when devices change
+			HANDLE					m_updateWakeEvent = NULL;
+			//Protects devices
 			CRITICAL_SECTION		m_updateMutex;
+			CRITICAL_SECTION		m_inputEventHandlersMutex;
+			CLockFreeQueue<INPUT_EVENT>	m_inputEventQueue;
 
 			bool					m_filterXInput = false;
 		};
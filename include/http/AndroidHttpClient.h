@@ -10,7 +10,14 @@ namespace Framework
 		class CAndroidHttpClient : public CHttpClient
 		{
 		public:
+			//Resolves the Java classes used by the client, call from JNI_OnLoad after CJavaClassCache::Prepare
+			static void PrepareClassCache();
+
 			RequestResult SendRequest() override;
+
+		protected:
+			void OnRequestThreadStart() override;
+			void OnRequestThreadEnd() override;
 		};
 	}
 }
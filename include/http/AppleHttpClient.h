@@ -11,6 +11,13 @@ namespace Framework
 		{
 		public:
 			RequestResult SendRequest() override;
+			void SendRequests(const RequestArray&, const RequestCallback&, unsigned int = DEFAULT_MAX_REQUESTS_PER_HOST) override;
+
+		protected:
+			bool HasNativeContentDecoding() const override;
+
+		private:
+			RequestResult SendStreamingRequest();
 		};
 	}
 }
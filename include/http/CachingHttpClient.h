@@ -0,0 +1,36 @@
+#pragma once
+
+#include <memory>
+#include "http/HttpClient.h"
+#include "http/HttpResponseCache.h"
+
+namespace Framework
+{
+	namespace Http
+	{
+		//Puts a CHttpResponseCache in front of another client. GET requests without a body are answered
+		//from the cache while the response is fresh, and stale responses are revalidated with
+		//If-None-Match/If-Modified-Since: a 304 answer gives back the cached body. Requests with Range or
+		//Cache-Control: no-store skip the cache, Cache-Control: no-cache forces a revalidation.
+		//Responses served from the cache go through the response sink as well if there's one.
+		class CCachingHttpClient : public CHttpClient
+		{
+		public:
+			CCachingHttpClient(std::unique_ptr<CHttpClient>, std::shared_ptr<CHttpResponseCache>);
+
+			RequestResult SendRequest() override;
+
+		protected:
+			std::unique_ptr<CHttpClient> CreateRequestClient() const override;
+
+		private:
+			bool IsCacheable() const;
+			//Hands the client's settings to the inner client
+			void SetupInnerClient(HeaderMap);
+			RequestResult MakeCachedResult(const CHttpResponseCache::ENTRY&) const;
+
+			std::unique_ptr<CHttpClient> m_client;
+			std::shared_ptr<CHttpResponseCache> m_cache;
+		};
+	}
+}
@@ -11,6 +11,13 @@ namespace Framework
 		{
 		public:
 			RequestResult SendRequest() override;
+			void SendRequests(const RequestArray&, const RequestCallback&, unsigned int = DEFAULT_MAX_REQUESTS_PER_HOST) override;
+
+		private:
+			struct TRANSFER;
+
+			void SetupTransfer(TRANSFER&, const std::string&, HTTP_VERB, const HeaderMap&);
+			static void CompleteTransfer(TRANSFER&, int);
 		};
 	}
 }
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <array>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Types.h"
+
+namespace Framework
+{
+	namespace Http
+	{
+		//Header fields kept in the order they were added. Names are case insensitive and matched through
+		//a hash stored with each field. Names and values are stored one after the other in a single
+		//buffer and are null terminated, their views can be given to C APIs through data(). Views are
+		//valid until the map is modified.
+		//Up to INLINE_COUNT fields don't need any allocation besides that buffer.
+		class CHeaderMap
+		{
+		public:
+			enum
+			{
+				INLINE_COUNT = 16,
+			};
+
+			struct HEADER
+			{
+				std::string_view name;
+				std::string_view value;
+			};
+
+			class CIterator
+			{
+			public:
+				CIterator(const CHeaderMap& map, size_t index)
+				    : m_map(&map)
+				    , m_index(index)
+				{
+				}
+
+				HEADER operator*() const
+				{
+					return m_map->GetHeader(m_index);
+				}
+
+				CIterator& operator++()
+				{
+					m_index++;
+					return *this;
+				}
+
+				bool operator==(const CIterator& rhs) const
+				{
+					return m_index == rhs.m_index;
+				}
+
+				bool operator!=(const CIterator& rhs) const
+				{
+					return m_index != rhs.m_index;
+				}
+
+			private:
+				const CHeaderMap* m_map = nullptr;
+				size_t m_index = 0;
+			};
+
+			size_t GetCount() const;
+			bool IsEmpty() const;
+			HEADER GetHeader(size_t) const;
+
+			CIterator begin() const;
+			CIterator end() const;
+
+			//Views of the first field with that name, empty if there's none
+			std::string_view Get(std::string_view name) const;
+			bool Has(std::string_view name) const;
+
+			//Replaces the value of the first field with that name and removes the others, adds it if there's none
+			void Set(std::string_view name, std::string_view value);
+			//Adds a field even if there's one with the same name already (ie.: Set-Cookie)
+			void Add(std::string_view name, std::string_view value);
+			//Returns the number of fields removed
+			size_t Remove(std::string_view name);
+			void Clear();
+
+		private:
+			struct ENTRY
+			{
+				uint32 hash = 0;
+				uint32 nameOffset = 0;
+				uint32 nameSize = 0;
+				uint32 valueOffset = 0;
+				uint32 valueSize = 0;
+			};
+
+			static uint32 ComputeHash(std::string_view);
+
+			const ENTRY* GetEntries() const;
+			ENTRY* GetEntries();
+			size_t FindEntry(std::string_view, uint32 hash, size_t startIndex = 0) const;
+			void RemoveEntry(size_t);
+			uint32 StoreText(std::string_view);
+			std::string_view GetText(uint32 offset, uint32 size) const;
+			//Drops text of removed fields once it takes more room than what is used.
+			//Text offsets change, it can't be called while text of a field is being stored.
+			void CompactText();
+
+			std::array<ENTRY, INLINE_COUNT> m_inlineEntries;
+			size_t m_inlineCount = 0;
+			//Used instead of the inline entries once there are too many, never empty in that case
+			std::vector<ENTRY> m_heapEntries;
+			std::string m_text;
+			size_t m_unusedTextSize = 0;
+		};
+	}
+}
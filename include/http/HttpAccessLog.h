@@ -0,0 +1,82 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdarg>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include "Types.h"
+#include "filesystem_def.h"
+#include "LockFreeQueue.h"
+#include "StdStream.h"
+
+namespace Framework
+{
+	//Log written by a background thread. Records go through a lock-free queue and are written in
+	//batches, writers never wait: records are dropped (and counted) when the queue is full.
+	class CHttpAccessLog
+	{
+	public:
+		enum
+		{
+			DEFAULT_CAPACITY = 0x1000,
+		};
+
+		CHttpAccessLog(const fs::path&, unsigned int capacity = DEFAULT_CAPACITY);
+		CHttpAccessLog(const CHttpAccessLog&) = delete;
+		~CHttpAccessLog();
+
+		CHttpAccessLog& operator=(const CHttpAccessLog&) = delete;
+
+		void WriteRequest(const std::string_view& method, const std::string_view& url, unsigned int statusCode, uint64 size, uint64 latencyUs);
+		void WriteMessage(const char*, ...);
+		void WriteMessageV(const char*, va_list);
+
+		uint64 GetDroppedCount() const;
+
+	private:
+		enum
+		{
+			MAX_METHOD_SIZE = 16,
+			MAX_TEXT_SIZE = 256,
+			BATCH_SIZE = 64,
+			IDLE_WAIT_MS = 100,
+		};
+
+		enum RECORD_TYPE
+		{
+			RECORD_TYPE_REQUEST,
+			RECORD_TYPE_MESSAGE,
+		};
+
+		//Fixed size to avoid allocations, long URLs and messages are truncated
+		struct RECORD
+		{
+			RECORD_TYPE type = RECORD_TYPE_MESSAGE;
+			int64 timeUs = 0;
+			unsigned int statusCode = 0;
+			uint64 size = 0;
+			uint64 latencyUs = 0;
+			uint8 methodLength = 0;
+			uint16 textLength = 0;
+			char method[MAX_METHOD_SIZE];
+			char text[MAX_TEXT_SIZE];
+		};
+
+		void Push(const RECORD&);
+		void WriterThreadProc();
+		static void FormatRecord(std::string&, const RECORD&);
+
+		CStdStream m_stream;
+		CLockFreeMpmcQueue<RECORD> m_records;
+		std::atomic<uint64> m_droppedCount = {0};
+
+		std::thread m_writerThread;
+		std::atomic<bool> m_stop = {false};
+		std::atomic<bool> m_isWriterWaiting = {false};
+		std::mutex m_writerMutex;
+		std::condition_variable m_writerCondition;
+	};
+}
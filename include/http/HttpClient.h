@@ -1,9 +1,21 @@
 #pragma once
 
 #include <string>
+#include <deque>
+#include <exception>
+#include <functional>
 #include <map>
+#include <memory>
 #include <vector>
 #include "MemStream.h"
+#include "PtrStream.h"
+#include "AsyncTask.h"
+#include "http/HeaderMap.h"
+#include "memory/AllocationTracker.h"
+
+#if defined(FRAMEWORK_HAS_COROUTINES)
+#include "ThreadPool.h"
+#endif
 
 //Win32 defines DELETE
 #ifdef DELETE
@@ -18,6 +30,7 @@ namespace Framework
 		{
 			OK = 200,
 			PARTIAL_CONTENT = 206,
+			NOT_MODIFIED = 304,
 			TEMPORARY_REDIRECT = 307,
 			BAD_REQUEST = 400,
 			UNAUTHORIZED = 401,
@@ -42,7 +55,7 @@ namespace Framework
 		};
 
 		typedef std::vector<uint8> ByteArray;
-		typedef std::map<std::string, std::string> HeaderMap;
+		typedef CHeaderMap HeaderMap;
 		typedef std::map<GLOBAL_SETTING, std::string> GlobalSettingMap;
 
 		struct RequestResult
@@ -52,9 +65,31 @@ namespace Framework
 			Framework::CMemStream data;
 		};
 
+		struct REQUEST
+		{
+			std::string url;
+			HTTP_VERB   verb = HTTP_VERB::GET;
+			HeaderMap   headers;
+			ByteArray   body;
+		};
+		typedef std::vector<REQUEST> RequestArray;
+
+		class CHttpContentDecoder;
+
+		//Gets parts of the response body as they're received
+		typedef std::function<void (const void*, size_t)> ResponseSink;
+
+		//Gets the index of the request, the result is only valid if there's no exception
+		typedef std::function<void (size_t, RequestResult&, const std::exception_ptr&)> RequestCallback;
+
 		class CHttpClient
 		{
 		public:
+			enum
+			{
+				DEFAULT_MAX_REQUESTS_PER_HOST = 6,
+			};
+
 			virtual ~CHttpClient() = default;
 
 			static void SetGlobalSetting(GLOBAL_SETTING, std::string);
@@ -64,10 +99,109 @@ namespace Framework
 			void SetHeaders(HeaderMap);
 			void SetRequestBody(ByteArray);
 			void SetRequestBody(std::string);
+			//Body is read from the stream while the request is sent, the stream has to stay alive until then
+			void SetRequestBodyStream(Framework::CStream&, uint64 length);
+			//Response body is given to the sink (or written to the stream) as it's received
+			//instead of being kept in RequestResult::data. Pass an empty sink to keep it again. Large bodies can be
+			//kept in memory with a CChainedBufferStream, which doesn't copy them over as they grow.
+			void SetResponseSink(ResponseSink);
+			void SetResponseStream(Framework::CStream&);
+			//Sends Accept-Encoding and decodes gzip, deflate and zstd response bodies as they're received.
+			//Bodies in other encodings are kept as they are, the Content-Encoding header tells which it is.
+			void SetContentDecodingEnabled(bool);
+			//Sends in-memory request bodies with gzip, bodies given as streams are sent as they are
+			void SetRequestBodyCompressionEnabled(bool);
 			virtual RequestResult SendRequest() = 0;
 
+			//Sends the requests concurrently and calls the callback on the calling thread as they complete,
+			//returns once they're all done. The client's own url, verb, headers and body aren't used.
+			virtual void SendRequests(const RequestArray&, const RequestCallback&, unsigned int maxRequestsPerHost = DEFAULT_MAX_REQUESTS_PER_HOST);
+
+#if defined(FRAMEWORK_HAS_COROUTINES)
+			//Request is sent from a worker of the pool, the client has to stay alive until it completes
+			CAsyncTask<RequestResult> SendRequestAsync(CThreadPool& threadPool)
+			{
+				co_await threadPool.Schedule();
+				co_return SendRequest();
+			}
+#endif
+
 		protected:
+			//Hands out requests to start while keeping the number in flight for each host under a limit
+			class CRequestScheduler
+			{
+			public:
+				CRequestScheduler(const RequestArray&, unsigned int maxRequestsPerHost);
+
+				//Returns false if no request can be started until another one completes
+				bool StartNext(size_t&);
+				void Complete(size_t);
+				bool IsDone() const;
+
+			private:
+				struct HOST
+				{
+					std::deque<size_t> waitingRequests;
+					unsigned int activeCount = 0;
+				};
+
+				std::vector<std::string> m_requestHosts;
+				std::map<std::string, HOST> m_hosts;
+				std::deque<size_t> m_readyRequests;
+				size_t m_remainingCount = 0;
+				unsigned int m_maxRequestsPerHost = 0;
+			};
+
+			//Gives response data to the response sink (or RequestResult::data), decoding it if needed
+			class CResponseBodyWriter
+			{
+			public:
+				CResponseBodyWriter(RequestResult&, const ResponseSink&, bool isDecodingEnabled);
+				CResponseBodyWriter(const CResponseBodyWriter&) = delete;
+				~CResponseBodyWriter();
+
+				CResponseBodyWriter& operator=(const CResponseBodyWriter&) = delete;
+
+				//Needs to be called before writing data
+				void SetContentEncoding(const std::string&);
+				void Write(const void*, size_t);
+				void Finish();
+
+			private:
+				void WriteDecoded(const void*, size_t);
+
+				RequestResult& m_result;
+				const ResponseSink& m_responseSink;
+				bool m_isDecodingEnabled = false;
+				std::unique_ptr<CHttpContentDecoder> m_decoder;
+				//Bodies kept in memory are counted as http memory while they are received
+				Memory::CAllocationRecord m_allocationRecord;
+			};
+
 			static HeaderMap ReadHeaderMap(Framework::CStream&);
+			static std::string GetUrlHost(const std::string&);
+			static std::string GetHeaderValue(const HeaderMap&, const std::string&);
+
+			//Adds the headers needed by content encoding options
+			HeaderMap GetRequestHeaders(const HeaderMap&, bool isBodyCompressed) const;
+			ByteArray EncodeRequestBody(const ByteArray&) const;
+			bool IsRequestBodyCompressed() const;
+
+			uint64 GetRequestBodySize();
+			//Returns the stream given to SetRequestBodyStream or the memory stream set up over the body
+			Framework::CStream& GetRequestBodyStream(std::unique_ptr<Framework::CPtrStream>& memoryStream);
+			const ByteArray& GetEncodedRequestBody();
+			bool IsContentDecodingEnabled() const;
+
+			//Backends that decode responses on their own still get Accept-Encoding from the platform
+			virtual bool HasNativeContentDecoding() const;
+
+			//Creates the clients used by the default SendRequests implementation
+			virtual std::unique_ptr<CHttpClient> CreateRequestClient() const;
+
+			//Called on the threads used by the default SendRequests implementation
+			virtual void OnRequestThreadStart();
+			virtual void OnRequestThreadEnd();
 
 			static GlobalSettingMap m_globalSettings;
 			
@@ -75,6 +209,13 @@ namespace Framework
 			HTTP_VERB m_verb = HTTP_VERB::GET;
 			HeaderMap m_headers;
 			ByteArray m_requestBody;
+			Framework::CStream* m_requestBodyStream = nullptr;
+			uint64 m_requestBodyStreamLength = 0;
+			ResponseSink m_responseSink;
+			bool m_contentDecodingEnabled = false;
+			bool m_requestBodyCompressionEnabled = false;
+			ByteArray m_encodedRequestBody;
+			bool m_isEncodedRequestBodyValid = false;
 		};
 	}
 }
@@ -2,11 +2,14 @@
 
 #include <memory>
 #include "http/HttpClient.h"
+#include "http/HttpResponseCache.h"
 
 namespace Framework
 {
 	namespace Http
 	{
 		std::unique_ptr<CHttpClient> CreateHttpClient();
+		//Client answering GET requests from the cache when it can, see CCachingHttpClient
+		std::unique_ptr<CHttpClient> CreateHttpClient(std::shared_ptr<CHttpResponseCache>);
 	}
 }
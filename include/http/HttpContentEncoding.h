@@ -0,0 +1,59 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <zstd_zlibwrapper.h>
+#include "http/HttpClient.h"
+
+typedef struct ZSTD_DCtx_s ZSTD_DCtx;
+
+namespace Framework
+{
+	namespace Http
+	{
+		//Decodes a response body as it's received and gives the result to a sink, for the content
+		//encodings we advertise with Accept-Encoding: gzip, deflate (zlib or raw) and zstd
+		class CHttpContentDecoder
+		{
+		public:
+			CHttpContentDecoder(const std::string& encoding, ResponseSink);
+			CHttpContentDecoder(const CHttpContentDecoder&) = delete;
+			~CHttpContentDecoder();
+
+			CHttpContentDecoder& operator=(const CHttpContentDecoder&) = delete;
+
+			static bool IsEncodingSupported(const std::string&);
+
+			void Write(const void*, size_t);
+			//Throws if the body ended in the middle of the compressed data
+			void Finish();
+
+		private:
+			enum
+			{
+				BUFFER_SIZE = 0x10000,
+			};
+
+			enum ENCODING
+			{
+				ENCODING_ZLIB,
+				ENCODING_ZSTD,
+			};
+
+			void WriteZlib(const uint8*, size_t);
+			void WriteZstd(const uint8*, size_t);
+
+			ENCODING m_encoding = ENCODING_ZLIB;
+			ResponseSink m_sink;
+			std::vector<uint8> m_outputBuffer;
+			z_stream m_zStream = {};
+			ZSTD_DCtx* m_zstdContext = nullptr;
+			bool m_isRawDeflateAllowed = false;
+			bool m_hasInput = false;
+			bool m_isStreamEnd = false;
+		};
+
+		//Compresses a request body for Content-Encoding: gzip
+		ByteArray GzipCompress(const void*, size_t, int level = Z_DEFAULT_COMPRESSION);
+	}
+}
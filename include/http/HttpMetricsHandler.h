@@ -0,0 +1,21 @@
+#pragma once
+
+#include <string>
+#include "http/HttpServer.h"
+
+namespace Framework
+{
+	//Serves the metrics of Metrics::CRegistry for CHttpServer, in the Prometheus text format or
+	//as JSON when asked for with "?format=json" or an Accept header preferring application/json.
+	class CHttpMetricsHandler
+	{
+	public:
+		CHttpMetricsHandler(std::string path = "/metrics");
+
+		//Returns false if the request isn't for this handler (other URL or not a GET/HEAD)
+		bool Serve(const CHttpServer::Request&, CHttpServer::Response&);
+
+	private:
+		std::string m_path;
+	};
+}
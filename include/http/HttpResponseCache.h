@@ -0,0 +1,78 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include "Cache.h"
+#include "DiskCache.h"
+#include "http/HttpClient.h"
+
+namespace Framework
+{
+	namespace Http
+	{
+		//Private cache of GET responses following RFC 9111. Responses are kept in memory, and in a disk
+		//cache as well if one is given, so they outlive the process. Freshness comes from Cache-Control
+		//max-age, Expires or, failing that, 10% of the time since Last-Modified. Stale responses with an
+		//ETag or Last-Modified can be revalidated with a conditional request.
+		//Only complete 200 responses are kept, and not the ones with no-store or a Vary header on
+		//anything else than Accept-Encoding. Thread safe, can be shared by several clients.
+		class CHttpResponseCache
+		{
+		public:
+			enum : uint64
+			{
+				DEFAULT_MEMORY_CAPACITY = 0x4000000,
+			};
+
+			struct ENTRY
+			{
+				HeaderMap headers;
+				ByteArray body;
+				//When the response was received, in seconds since the Unix epoch
+				int64 responseTime = 0;
+				//Value of the Age header when it was received
+				int64 initialAge = 0;
+			};
+			typedef std::shared_ptr<const ENTRY> EntryPtr;
+
+			//Memory capacity is the total size of the bodies kept in memory
+			CHttpResponseCache(uint64 memoryCapacity = DEFAULT_MEMORY_CAPACITY, std::shared_ptr<CDiskCache> diskCache = std::shared_ptr<CDiskCache>());
+			CHttpResponseCache(const CHttpResponseCache&) = delete;
+
+			CHttpResponseCache& operator=(const CHttpResponseCache&) = delete;
+
+			static int64 GetCurrentTime();
+
+			//Null if the url isn't cached, fresh or not
+			EntryPtr Find(const std::string& url);
+			//Returns false if the response can't be kept
+			bool Store(const std::string& url, const RequestResult&, int64 responseTime);
+			//Takes the headers of a 304 response to a conditional request made for the entry
+			EntryPtr Refresh(const std::string& url, const EntryPtr&, const HeaderMap& notModifiedHeaders, int64 responseTime);
+			void Remove(const std::string& url);
+
+			static bool IsFresh(const ENTRY&, int64 currentTime);
+			//Adds If-None-Match and If-Modified-Since from the entry's validators, false if it has none
+			static bool AddValidators(const ENTRY&, HeaderMap&);
+
+			//Looks for a directive in the Cache-Control header, its value (ie.: max-age=60) is optional
+			static bool HasCacheDirective(const HeaderMap&, std::string_view name, std::string_view* value = nullptr);
+			//IMF-fixdate (ie.: Sun, 06 Nov 1994 08:49:37 GMT), in seconds since the Unix epoch
+			static bool ParseHttpDate(std::string_view, int64&);
+
+		private:
+			typedef CCache<std::string, ENTRY> MemoryCache;
+
+			static bool IsStorable(const RequestResult&);
+			static int64 GetFreshnessLifetime(const ENTRY&);
+			static std::vector<uint8> SerializeEntry(const ENTRY&);
+			static bool DeserializeEntry(const uint8*, size_t, ENTRY&);
+
+			void StoreEntry(const std::string& url, const EntryPtr&);
+
+			MemoryCache m_memoryCache;
+			std::shared_ptr<CDiskCache> m_diskCache;
+		};
+	}
+}
@@ -1,45 +1,193 @@
 #pragma once
 
+#include <atomic>
 #include <thread>
 #include <functional>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <vector>
 #include <string>
+#include <string_view>
 #include "Types.h"
+#include "ChainedBufferStream.h"
 #include "SocketDef.h"
 #include "filesystem_def.h"
 #include "StdStream.h"
+#include "http/HttpAccessLog.h"
+#include "http/WebSocket.h"
+#include "Metrics.h"
 
 namespace Framework
 {
+	class CThreadPool;
+
+	//Connections are handled by a single thread with non-blocking sockets (epoll, kqueue or select).
+	//Keep-alive and pipelined requests are supported, requests of a connection are handled in order.
+	//Connections can be upgraded to WebSockets (see Response::webSocket).
 	class CHttpServer
 	{
 	public:
+		struct HEADER
+		{
+			std::string_view name;
+			std::string_view value;
+		};
+		typedef std::vector<HEADER> HeaderArray;
+
+		//Writes a response body as it's sent
+		using BodyWriter = std::function<void(CStream&)>;
+
+		//Views refer to the connection's receive buffer and are only valid while the handler runs
 		struct Request
 		{
-			std::string url;
-			std::map<std::string, std::string> headers;
-			std::vector<uint8> body;
+			std::string_view method;
+			std::string_view url;
+			HeaderArray headers;
+			uint64 contentLength = 0;
+
+			//Whole body when it was received along with the headers, empty otherwise
+			std::string_view body;
+
+			//Reads the body in every case. Large bodies are received from the client as they are read,
+			//only MAX_BUFFERED_BODY_SIZE bytes are buffered per connection.
+			CStream* bodyStream = nullptr;
+
+			//Case insensitive, empty if the header isn't present
+			std::string_view GetHeader(const std::string_view&) const;
+			//GET with the headers asking for a WebSocket (version 13)
+			bool IsWebSocketUpgrade() const;
+		};
+
+		struct Response
+		{
+			unsigned int statusCode = 200;
+			//Content-Length and Connection are added by the server
+			std::vector<std::pair<std::string, std::string>> headers;
+
+			//Body, only one of these is used. Files are sent with sendfile when the platform allows it.
+			std::string body;
+			std::shared_ptr<const std::vector<uint8>> sharedBody;
+			//Sent from its segments with scatter-gather writes, the stream isn't modified
+			std::shared_ptr<const CChainedBufferStream> chainedBody;
+			std::shared_ptr<CStdStream> file;
+			uint64 fileOffset = 0;
+			uint64 fileSize = 0;
+			//Made as it's sent (ie.: an archive of many files), runs on the thread pool once the headers are
+			//queued. Sent chunked, or until the connection closes to HTTP/1.0 clients. Writes block while the
+			//client is slow, only a few chunks are buffered. Without a thread pool, the body is written to
+			//memory first. The request isn't valid anymore when it runs, throwing cuts the connection.
+			BodyWriter bodyWriter;
+
+			//Accepts a WebSocket upgrade request when set, the server answers with 101 Switching Protocols
+			//and the headers above (ie.: Sec-WebSocket-Protocol). Status code and body are ignored.
+			WebSocketPtr webSocket;
 		};
 
-		using RequestHandler = std::function<void(const Request&)>;
+		//Responses to HEAD requests are sent without their body
+		using RequestHandler = std::function<void(const Request&, Response&)>;
 
-		CHttpServer(uint16, const RequestHandler&, const fs::path&);
+		//Handlers run on the thread pool when there's one, otherwise one at a time on the server's thread
+		CHttpServer(uint16, const RequestHandler&, const fs::path&, CThreadPool* = nullptr);
 		CHttpServer(CHttpServer&) = delete;
 		~CHttpServer();
 
 		CHttpServer& operator=(const CHttpServer&) = delete;
 
 	private:
+		friend class CWebSocket;
+
+		enum
+		{
+			MAX_HEADER_SIZE = 0x10000,
+			MAX_BUFFERED_BODY_SIZE = 0x10000,
+			READ_SIZE = 0x4000,
+			BODY_READ_TIMEOUT_MS = 30000,
+			MAX_WEBSOCKET_MESSAGE_SIZE = 0x100000,
+			//Clients with more frames waiting to be sent are too slow and get dropped
+			MAX_WEBSOCKET_QUEUED_FRAMES = 0x400,
+			STREAMED_BODY_CHUNK_SIZE = 0x10000,
+			MAX_STREAMED_BODY_CHUNKS = 4,
+		};
+
+		enum PARSE_RESULT
+		{
+			PARSE_RESULT_INCOMPLETE,
+			PARSE_RESULT_COMPLETE,
+			PARSE_RESULT_INVALID,
+		};
+
+		struct OUTPUT_SEGMENT;
+		struct CONNECTION;
+		struct COMPLETION;
+		struct STREAMED_BODY;
+		class CPoller;
+		class CBodyStream;
+		class CStreamedBodyStream;
+
+		typedef std::map<SOCKET, std::unique_ptr<CONNECTION>> ConnectionMap;
+
 		void Start(uint16);
 		void ServerThreadProc();
-		void ProcessRequest(int);
-		
+
+		void AcceptConnections();
+		void ReadConnection(CONNECTION&);
+		void WriteConnection(CONNECTION&);
+		void UpdateConnection(CONNECTION&);
+		void CloseConnection(CONNECTION&);
+
+		void SkipUnreadBody(CONNECTION&);
+		void ProcessRequests(CONNECTION&);
+		PARSE_RESULT ParseRequest(CONNECTION&, Request&);
+		void CompleteRequest(CONNECTION&, bool, Response&);
+		void AppendResponse(CONNECTION&, Response&);
+		void AppendUpgradeResponse(CONNECTION&, Response&);
+		static uint64 GetBodySize(const Response&);
+		static void AppendOutput(CONNECTION&, std::string);
+		void ProcessCompletions();
+
+		void FlushStreamedBody(CONNECTION&);
+		void ProcessStreamedBodyOutput();
+		void AbortStreamedBodies();
+
+		void ProcessWebSocketFrames(CONNECTION&);
+		void CloseWebSocket(CONNECTION&, uint16);
+		void FlushWebSocket(CONNECTION&);
+		//Called by sockets with messages to send, from any thread
+		void QueueWebSocketOutput(WebSocketPtr);
+		void ProcessWebSocketOutput();
+
+		void Wake();
+		void DrainWakeSocket();
+
 		void Log(const char*, ...);
 
 		RequestHandler m_requestHandler;
+		CThreadPool* m_threadPool = nullptr;
 		SOCKET m_serverSock = INVALID_SOCKET;
+		SOCKET m_wakeSock = INVALID_SOCKET;
 		std::thread m_serverThread;
-		std::unique_ptr<CStdStream> m_logStream;
+		std::atomic<bool> m_stop;
+
+		std::unique_ptr<CPoller> m_poller;
+		ConnectionMap m_connections;
+		unsigned int m_pendingHandlerCount = 0;
+
+		//Connections whose handler completed on the thread pool
+		std::mutex m_completionsMutex;
+		std::vector<COMPLETION> m_completions;
+		//WebSockets with messages to send, also guarded by the completions mutex
+		std::vector<WebSocketPtr> m_webSocketOutputs;
+		//Connections with streamed body chunks to send, also guarded by the completions mutex
+		std::vector<SOCKET> m_streamedBodyOutputs;
+
+		std::unique_ptr<CHttpAccessLog> m_accessLog;
+
+		//Shared by all servers of the process
+		Metrics::CCounter& m_requestCountMetric;
+		Metrics::CCounter& m_errorCountMetric;
+		Metrics::CCounter& m_responseSizeMetric;
+		Metrics::CHistogram& m_requestDurationMetric;
+		Metrics::CGauge& m_connectionCountMetric;
 	};
 }
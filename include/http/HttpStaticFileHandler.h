@@ -0,0 +1,67 @@
+#pragma once
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "http/HttpServer.h"
+
+namespace Framework
+{
+	//Serves files from a directory for CHttpServer. Handles HEAD, conditional requests (ETag and
+	//Last-Modified), single byte ranges and precompressed variants (file.zst, file.gz) when the client
+	//accepts them. Small files are kept in memory, others are sent from disk with sendfile.
+	//Can be used from many threads at once.
+	class CHttpStaticFileHandler
+	{
+	public:
+		enum
+		{
+			DEFAULT_CACHE_SIZE = 0x2000000,
+			DEFAULT_MAX_CACHED_FILE_SIZE = 0x100000,
+		};
+
+		CHttpStaticFileHandler(const fs::path&, std::string urlPrefix = "/", size_t cacheSize = DEFAULT_CACHE_SIZE, size_t maxCachedFileSize = DEFAULT_MAX_CACHED_FILE_SIZE);
+		CHttpStaticFileHandler(const CHttpStaticFileHandler&) = delete;
+
+		CHttpStaticFileHandler& operator=(const CHttpStaticFileHandler&) = delete;
+
+		//Returns false if the request isn't for this handler (URL outside of the prefix or not a GET/HEAD)
+		bool Serve(const CHttpServer::Request&, CHttpServer::Response&);
+
+	private:
+		struct FILE_INFO
+		{
+			uint64 size = 0;
+			int64 modifiedTime = 0;
+		};
+
+		typedef fs::path::string_type CacheKey;
+		typedef std::list<CacheKey> LruList;
+
+		struct CACHE_ENTRY
+		{
+			FILE_INFO info;
+			std::shared_ptr<const std::vector<uint8>> content;
+			LruList::iterator lruIterator;
+		};
+
+		typedef std::unordered_map<CacheKey, CACHE_ENTRY> CacheMap;
+
+		static bool GetFileInfo(const fs::path&, FILE_INFO&);
+		static bool IsEncodingAccepted(const std::string_view&, const std::string_view&);
+
+		std::shared_ptr<const std::vector<uint8>> GetCachedContent(const fs::path&, const FILE_INFO&);
+
+		fs::path m_root;
+		std::string m_urlPrefix;
+		size_t m_cacheSize = 0;
+		size_t m_maxCachedFileSize = 0;
+
+		std::mutex m_cacheMutex;
+		CacheMap m_cache;
+		LruList m_lru;
+		size_t m_cachedSize = 0;
+	};
+}
@@ -0,0 +1,196 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Types.h"
+#include "SocketDef.h"
+
+typedef struct z_stream_s z_stream;
+
+namespace Framework
+{
+	class CHttpServer;
+
+	//WebSocket protocol (RFC 6455) as used by CHttpServer, along with permessage-deflate (RFC 7692)
+	namespace WebSocket
+	{
+		enum OPCODE : uint8
+		{
+			OPCODE_CONTINUATION = 0x0,
+			OPCODE_TEXT = 0x1,
+			OPCODE_BINARY = 0x2,
+			OPCODE_CLOSE = 0x8,
+			OPCODE_PING = 0x9,
+			OPCODE_PONG = 0xA,
+		};
+
+		enum CLOSE_CODE : uint16
+		{
+			CLOSE_NORMAL = 1000,
+			CLOSE_GOING_AWAY = 1001,
+			CLOSE_PROTOCOL_ERROR = 1002,
+			CLOSE_INVALID_DATA = 1007,
+			CLOSE_MESSAGE_TOO_BIG = 1009,
+			CLOSE_INTERNAL_ERROR = 1011,
+		};
+
+		//Value of Sec-WebSocket-Accept for the client's Sec-WebSocket-Key
+		std::string ComputeAcceptKey(std::string_view key);
+
+		//Looks for a permessage-deflate offer we can take in Sec-WebSocket-Extensions and returns the
+		//Sec-WebSocket-Extensions value to answer with, empty if there's none. Our messages are compressed
+		//without context takeover so they're the same for every client.
+		std::string_view NegotiateDeflate(std::string_view extensions);
+
+		//Reassembles messages from frames sent by a client, unmasking and decompressing them in place
+		class CFrameReader
+		{
+		public:
+			enum RESULT
+			{
+				RESULT_INCOMPLETE,
+				RESULT_MESSAGE,
+				RESULT_ERROR,
+			};
+
+			//Complete message or control frame. Data refers to the input or to the reader's buffers,
+			//valid until the next call.
+			struct MESSAGE
+			{
+				OPCODE opcode = OPCODE_TEXT;
+				std::string_view data;
+			};
+
+			CFrameReader(bool isDeflateEnabled, size_t maxMessageSize);
+			CFrameReader(const CFrameReader&) = delete;
+			~CFrameReader();
+
+			CFrameReader& operator=(const CFrameReader&) = delete;
+
+			//Reads frames until a message is complete. Consumed size includes frames read on the way,
+			//even when the result is incomplete. Input used by the message can't go before it's handled.
+			RESULT Read(uint8* input, size_t inputSize, size_t& consumedSize, MESSAGE&);
+			//Close code to send once Read returned an error
+			CLOSE_CODE GetErrorCode() const;
+
+		private:
+			RESULT Fail(CLOSE_CODE);
+			bool Inflate(const uint8*, size_t);
+
+			size_t m_maxMessageSize = 0;
+			bool m_isDeflateEnabled = false;
+			std::unique_ptr<z_stream> m_inflateStream;
+			//Fragmented message being received
+			bool m_isMessageStarted = false;
+			bool m_isMessageCompressed = false;
+			OPCODE m_messageOpcode = OPCODE_TEXT;
+			std::vector<uint8> m_messageBuffer;
+			std::vector<uint8> m_inflateBuffer;
+			CLOSE_CODE m_errorCode = CLOSE_NORMAL;
+		};
+	}
+
+	//Message encoded as a server frame, can be sent to any number of sockets. The deflated frame is
+	//made once, the first time it's asked for by a socket that negotiated permessage-deflate.
+	class CWebSocketMessage
+	{
+	public:
+		typedef std::shared_ptr<const std::vector<uint8>> FramePtr;
+
+		CWebSocketMessage(WebSocket::OPCODE, const void*, size_t);
+		CWebSocketMessage(const CWebSocketMessage&) = delete;
+
+		CWebSocketMessage& operator=(const CWebSocketMessage&) = delete;
+
+		WebSocket::OPCODE GetOpcode() const;
+		//Small messages and control frames are never compressed
+		const FramePtr& GetFrame(bool deflate) const;
+
+	private:
+		enum
+		{
+			MIN_DEFLATE_SIZE = 0x100,
+		};
+
+		WebSocket::OPCODE m_opcode = WebSocket::OPCODE_TEXT;
+		size_t m_headerSize = 0;
+		FramePtr m_frame;
+		mutable std::once_flag m_deflateOnce;
+		mutable FramePtr m_deflatedFrame;
+	};
+	typedef std::shared_ptr<const CWebSocketMessage> WebSocketMessagePtr;
+
+	//Server side of a WebSocket connection. Request handlers accept an upgrade by setting one in the
+	//response, it can then be kept to send messages from any thread. Messages sent before the upgrade
+	//completes are held until then.
+	class CWebSocket : public std::enable_shared_from_this<CWebSocket>
+	{
+	public:
+		//Called on the server's thread and shouldn't block. Data is only valid during the call.
+		using MessageHandler = std::function<void(CWebSocket&, std::string_view data, bool isBinary)>;
+		//Called once, when the connection goes away or the server is destroyed
+		using CloseHandler = std::function<void(CWebSocket&)>;
+
+		CWebSocket(MessageHandler = MessageHandler(), CloseHandler = CloseHandler());
+		CWebSocket(const CWebSocket&) = delete;
+
+		CWebSocket& operator=(const CWebSocket&) = delete;
+
+		//Return false once the socket is closed or closing
+		bool SendText(std::string_view);
+		bool SendBinary(const void*, size_t);
+		bool Send(const WebSocketMessagePtr&);
+
+		//Queued messages are sent before the close frame, the connection closes afterwards
+		void Close(uint16 code = WebSocket::CLOSE_NORMAL);
+		bool IsClosed() const;
+		bool IsDeflateEnabled() const;
+
+	private:
+		friend class CHttpServer;
+		typedef std::vector<WebSocketMessagePtr> MessageArray;
+
+		void Attach(CHttpServer*, SOCKET, bool isDeflateEnabled);
+		//Returns false if it was already detached, the close handler is called otherwise
+		bool Detach();
+		//Called by the server to get the messages to send
+		void TakeMessages(MessageArray&);
+		void HandleMessage(std::string_view, bool isBinary);
+
+		mutable std::mutex m_mutex;
+		CHttpServer* m_server = nullptr;
+		SOCKET m_socket = INVALID_SOCKET;
+		MessageArray m_messages;
+		bool m_isOutputQueued = false;
+		bool m_isClosing = false;
+		bool m_isClosed = false;
+		bool m_isDeflateEnabled = false;
+		MessageHandler m_messageHandler;
+		CloseHandler m_closeHandler;
+	};
+	typedef std::shared_ptr<CWebSocket> WebSocketPtr;
+
+	//Subscribers receiving the same messages (ie.: telemetry). Each message is encoded and compressed
+	//once, every socket sends the same buffers. Closed sockets are dropped as messages are sent.
+	//Thread safe.
+	class CWebSocketGroup
+	{
+	public:
+		void Add(const WebSocketPtr&);
+		void Remove(const WebSocketPtr&);
+		size_t GetCount() const;
+
+		//Return the number of sockets the message was sent to
+		size_t Broadcast(const WebSocketMessagePtr&);
+		size_t BroadcastText(std::string_view);
+		size_t BroadcastBinary(const void*, size_t);
+
+	private:
+		mutable std::mutex m_mutex;
+		std::vector<WebSocketPtr> m_sockets;
+	};
+}
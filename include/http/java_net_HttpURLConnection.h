@@ -22,6 +22,7 @@ namespace java
 			jmethodID getInputStream = NULL;
 			jmethodID getOutputStream = NULL;
 			jmethodID getResponseCode = NULL;
+			jmethodID setFixedLengthStreamingMode = NULL;
 			jmethodID setRequestMethod = NULL;
 			jmethodID setRequestProperty = NULL;
 		};
@@ -44,6 +45,7 @@ namespace java
 			jobject getInputStream();
 			jobject getOutputStream();
 			jint getResponseCode();
+			void setFixedLengthStreamingMode(jlong);
 			void setRequestMethod(jstring);
 			void setRequestProperty(jstring, jstring);
 		};
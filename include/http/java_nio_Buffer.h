@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdlib>
+#include <jni.h>
+#include "Singleton.h"
+#include "android/JavaObject.h"
+
+namespace java
+{
+	namespace nio
+	{
+		class Buffer_ClassInfo : public CSingleton<Buffer_ClassInfo>
+		{
+		public:
+			void PrepareClassInfo();
+			
+			jclass clazz = NULL;
+			jmethodID clear = NULL;
+		};
+		
+		class Buffer : public Framework::CJavaObject
+		{
+		public:
+			typedef Buffer_ClassInfo ClassInfo;
+			
+			void clear();
+		};
+	}
+}
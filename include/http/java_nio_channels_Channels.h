@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdlib>
+#include <jni.h>
+#include "Singleton.h"
+#include "android/JavaObject.h"
+
+namespace java
+{
+	namespace nio
+	{
+		namespace channels
+		{
+			class Channels_ClassInfo : public CSingleton<Channels_ClassInfo>
+			{
+			public:
+				void PrepareClassInfo();
+				
+				jclass clazz = NULL;
+				jmethodID newChannel = NULL;
+			};
+			
+			class Channels
+			{
+			public:
+				typedef Channels_ClassInfo ClassInfo;
+				
+				//Returns a ReadableByteChannel reading from an InputStream
+				static jobject newChannel(jobject);
+			};
+		}
+	}
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdlib>
+#include <jni.h>
+#include "Singleton.h"
+#include "android/JavaObject.h"
+
+namespace java
+{
+	namespace nio
+	{
+		namespace channels
+		{
+			class ReadableByteChannel_ClassInfo : public CSingleton<ReadableByteChannel_ClassInfo>
+			{
+			public:
+				void PrepareClassInfo();
+				
+				jclass clazz = NULL;
+				jmethodID read = NULL;
+				jmethodID close = NULL;
+			};
+			
+			class ReadableByteChannel : public Framework::CJavaObject
+			{
+			public:
+				typedef ReadableByteChannel_ClassInfo ClassInfo;
+				
+				jint read(jobject);
+				void close();
+			};
+		}
+	}
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "idct/Interface.h"
+
+namespace IDCT
+{
+	//Separable fixed-point IDCT (14-bit coefficients, 4 extra bits of intermediate precision)
+	//meeting IEEE-1180 accuracy requirements. Uses SSE2 or NEON when available.
+	//Blocks with only a DC coefficient or only low frequencies (top-left 4x4) take faster paths.
+	class CFixedPoint : public CInterface
+	{
+	public:
+		enum
+		{
+			COEF_BITS = 14,
+			PASS1_BITS = 4,
+		};
+
+								CFixedPoint();
+		virtual					~CFixedPoint() = default;
+		static CInterface*		GetInstance();
+		void					Transform(const int16*, int16*) override;
+		void					TransformBlocks(const int16*, int16*, size_t) override;
+
+		//Forward DCT with the same coefficients and precision, takes level shifted samples
+		static void				ForwardTransform(const int16*, int16*);
+
+		static const int16		g_coefs[8][8];
+
+	private:
+		typedef void (*TransformBlocksFunction)(const int16*, int16*, size_t);
+
+		TransformBlocksFunction	m_transformBlocks = nullptr;
+	};
+}
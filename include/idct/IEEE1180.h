@@ -8,11 +8,29 @@ namespace IDCT
 	class CIEEE1180 : public CInterface
 	{
 	public:
+		struct ACCURACY_STATS
+		{
+			int					peakError = 0;
+			double				peakMse = 0;
+			double				overallMse = 0;
+			double				peakMeanError = 0;
+			double				overallMeanError = 0;
+
+			bool				IsCompliant() const;
+		};
+
 								CIEEE1180();
 		virtual					~CIEEE1180();
 		static CInterface*		GetInstance();
 		void					Transform(const int16*, int16*) override;
 
+		//Runs the IEEE-1180 accuracy test procedure on an implementation for
+		//random input in [-lowerBound, upperBound] (negated if requested).
+		static ACCURACY_STATS	MeasureAccuracy(CInterface*, int lowerBound, int upperBound, bool negate, unsigned int blockCount = 10000);
+
+		//Reference forward DCT, results are clamped to [-2048, 2047]
+		void					ForwardTransform(const int16*, int16*);
+
 	private:
 		void					PrepareTable();
 
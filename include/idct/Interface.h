@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include "Types.h"
 
 namespace IDCT
@@ -10,6 +11,15 @@ namespace IDCT
 	public:
 		virtual			~CInterface() {} ;
 		virtual void	Transform(const int16*, int16*) = 0;
+
+		//Transforms 'count' contiguous 8x8 blocks
+		virtual void	TransformBlocks(const int16* input, int16* output, size_t count)
+		{
+			for(size_t i = 0; i < count; i++)
+			{
+				Transform(input + (i * 64), output + (i * 64));
+			}
+		}
 	};
 
 }
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "Types.h"
+
+namespace IDCT
+{
+	//Reduced size IDCTs used for downscaled decoding. Only the top-left height x width
+	//coefficients of an 8x8 block are used (given packed, with a stride of 'width')
+	//and a height x width block of samples is produced at the same level as a full IDCT.
+	class CReduced
+	{
+	public:
+		enum
+		{
+			COEF_BITS = 14,
+			PASS1_BITS = 4,
+		};
+
+		//Width and height must be 1, 2, 4 or 8
+		static void				Transform(const int16*, int16*, unsigned int width, unsigned int height);
+
+		static const int16		g_coefs1[1][1];
+		static const int16		g_coefs2[2][2];
+		static const int16		g_coefs4[4][4];
+	};
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <vector>
+#include "LayoutObject.h"
+#include "LayoutBase.h"
+
+namespace Framework
+{
+	//Flattened copy of a layout tree built out of CHorizontalLayout, CVerticalLayout and CGridLayout
+	//containers. Nodes are stored contiguously in depth-first order, so preferred sizes are measured by
+	//walking the array backwards and rects are arranged by walking it forwards, without going through
+	//the shared pointers of the tree. Other objects are leaves, their geometry is updated after arranging.
+	//Structure of the tree can't change once compiled, preferred sizes can (Measure needs to be called again).
+	class CCompiledLayout
+	{
+	public:
+		explicit			CCompiledLayout(const LayoutObjectPtr&);
+
+		//Reads the preferred sizes and stretches of the objects again and recomputes the containers'
+		void				Measure();
+		//Computes the rects of every node and updates the geometry of the objects whose rect changed
+		void				Arrange(unsigned int, unsigned int, unsigned int, unsigned int);
+
+		unsigned int		GetPreferredWidth() const;
+		unsigned int		GetPreferredHeight() const;
+
+	private:
+		enum NODE_TYPE
+		{
+			NODE_TYPE_LEAF,
+			NODE_TYPE_HORIZONTAL,
+			NODE_TYPE_VERTICAL,
+			NODE_TYPE_GRID,
+		};
+
+		enum
+		{
+			EMPTY_CELL = ~0U,
+		};
+
+		struct NODE
+		{
+			NODE_TYPE		type = NODE_TYPE_LEAF;
+			CLayoutObject*	object = nullptr;
+
+			unsigned int	horizontalStretch = 0;
+			unsigned int	verticalStretch = 0;
+			unsigned int	preferredWidth = 0;
+			unsigned int	preferredHeight = 0;
+
+			unsigned int	left = 0;
+			unsigned int	top = 0;
+			unsigned int	right = 0;
+			unsigned int	bottom = 0;
+
+			//Node indices in m_children. Grids have one per cell (column after column), EMPTY_CELL when empty.
+			unsigned int	firstChild = 0;
+			unsigned int	childCount = 0;
+			unsigned int	cols = 0;
+			unsigned int	rows = 0;
+			unsigned int	spacing = 0;
+		};
+
+		typedef CLayoutBase::RANGE RANGE;
+
+		unsigned int		CompileNode(const LayoutObjectPtr&);
+		void				MeasureFlat(NODE&);
+		void				MeasureGrid(NODE&);
+		void				ArrangeFlat(const NODE&);
+		void				ArrangeGrid(const NODE&);
+		void				ClearItems();
+		void				AddItem(unsigned int, unsigned int);
+		void				ComputeItemRanges(unsigned int);
+
+		//Keeps the objects alive, nodes only point to them
+		LayoutObjectPtr		m_root;
+		std::vector<NODE>	m_nodes;
+		std::vector<unsigned int>	m_children;
+
+		//Scratch space of the arrange pass
+		std::vector<unsigned int>	m_itemSizes;
+		std::vector<unsigned int>	m_itemStretches;
+		std::vector<RANGE>			m_itemRanges;
+		std::vector<RANGE>			m_colRanges;
+		std::vector<RANGE>			m_rowRanges;
+	};
+}
@@ -20,6 +20,8 @@ namespace Framework
 		CFlatLayout&				operator =(const CFlatLayout&) = delete;
 
 		void						InsertObject(const LayoutObjectPtr&);
+		const ObjectList&			GetObjects() const;
+		unsigned int				GetSpacing() const;
 		virtual	void				RefreshGeometry() override;
 
 	protected:
@@ -27,10 +29,13 @@ namespace Framework
 		virtual void				SetObjectRange(const LayoutObjectPtr&, unsigned int, unsigned int)	= 0;
 		virtual unsigned int		GetObjectPreferredSize(const LayoutObjectPtr&)						= 0;
 		virtual unsigned int		GetLayoutSize()														= 0;
-		unsigned int				GetPreferredSize() const;
+		//Along the layout's direction, from the children's cached preferred sizes
+		unsigned int				GetPreferredSize();
 		ObjectList					m_objects;
 
 	private:
+		void						RebuildLayoutBase();
+
 		CLayoutBase					m_layoutBase;
 		unsigned int				m_spacing;
 	};
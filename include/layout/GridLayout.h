@@ -22,6 +22,12 @@ namespace Framework
 		void					RefreshGeometry() override;
 
 		void					SetObject(unsigned int, unsigned int, const LayoutObjectPtr&);
+		//Column, row
+		LayoutObjectPtr			GetCellObject(unsigned int, unsigned int) const;
+
+		unsigned int			GetColumnCount() const;
+		unsigned int			GetRowCount() const;
+		unsigned int			GetSpacing() const;
 
 	private:
 		typedef std::vector<std::vector<LayoutObjectPtr>> GridArray;
@@ -12,6 +12,12 @@ namespace Framework
 		typedef std::vector<CLayoutBaseItem> ItemList;
 		typedef ItemList::const_iterator ItemIterator;
 
+		struct RANGE
+		{
+			unsigned int	start = 0;
+			unsigned int	end = 0;
+		};
+
 									~CLayoutBase();
 
 		void						Clear();
@@ -22,10 +28,11 @@ namespace Framework
 
 		const ItemList&				GetItems() const;
 
-	private:
-		bool						HasOnlyNonStretchable() const;
-		unsigned int				GetTotalStretchUnits() const;
+		//Distributes the size the same way ComputeRanges does, over plain arrays of preferred sizes and stretches.
+		//Ranges of items with no preferred size are left untouched when the size is smaller than the total.
+		static void					ComputeRanges(const unsigned int*, const unsigned int*, RANGE*, size_t, unsigned int);
 
+	private:
 		ItemList					m_items;
 	};
 
@@ -8,6 +8,8 @@ namespace Framework
 {
 	class CLayoutBaseItem;
 	
+	//Preferred sizes are cached and geometry is only refreshed for objects whose rect changed or that
+	//were invalidated, which keeps relayouts of large trees proportional to what actually changed.
 	class CLayoutObject : public std::enable_shared_from_this<CLayoutObject>
 	{
 	public:
@@ -18,6 +20,19 @@ namespace Framework
 		virtual unsigned int	GetPreferredHeight()	= 0;
 		virtual void			RefreshGeometry()		= 0;
 
+		//Containers go through these instead of calling GetPreferredWidth/Height on their children
+		unsigned int			GetCachedPreferredWidth();
+		unsigned int			GetCachedPreferredHeight();
+		//Needs to be called when the preferred size of the object changes, containers holding it are
+		//invalidated as well and will be laid out again on their next refresh
+		void					Invalidate();
+		//Calls RefreshGeometry if the rect changed or the object was invalidated since the last update
+		void					UpdateGeometry();
+
+		//Set by containers when the object is inserted in them
+		void					SetParent(CLayoutObject*);
+		CLayoutObject*			GetParent() const;
+
 		void					SetHorizontalStretch(unsigned int);
 		void					SetVerticalStretch(unsigned int);
 
@@ -39,6 +54,13 @@ namespace Framework
 		CLayoutBaseItem			CreateVerticalBaseLayoutItem();
 
 	private:
+		CLayoutObject*			m_parent = nullptr;
+
+		unsigned int			m_cachedPreferredWidth = 0;
+		unsigned int			m_cachedPreferredHeight = 0;
+		bool					m_preferredWidthValid = false;
+		bool					m_preferredHeightValid = false;
+		bool					m_geometryDirty = true;
 
 		unsigned int			m_left = 0;
 		unsigned int			m_right = 0;
@@ -3,6 +3,7 @@
 
 #include <string>
 #include <sstream>
+#include <charconv>
 #include <assert.h>
 #include "alloca_def.h"
 #include <algorithm>
@@ -57,20 +58,34 @@ unsigned int lexical_cast_hex(const Format& sValue)
     return nNumber;
 }
 
+template <typename Format, typename ValueType>
+Format lexical_cast_padded(ValueType number, unsigned int width, typename Format::value_type fillChar)
+{
+    //to_chars doesn't depend on the locale (streams could add digit grouping) and doesn't allocate
+    char buffer[16];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), number);
+    size_t length = result.ptr - buffer;
+    Format output;
+    output.reserve(std::max<size_t>(width, length));
+    if(width > length)
+    {
+        output.assign(width - length, fillChar);
+    }
+    output.append(buffer, result.ptr);
+    return output;
+}
+
 template <typename Format>
 Format lexical_cast_uint(unsigned int number, unsigned int width = 1)
 {
-    std::basic_ostringstream<typename Format::value_type> stream;
-    stream << std::setw(width) << std::setfill(static_cast<typename Format::value_type>('0')) << number;
-    return stream.str();
+    return lexical_cast_padded<Format>(number, width, static_cast<typename Format::value_type>('0'));
 }
 
 template <typename Format>
 Format lexical_cast_int(int number, unsigned int width = 1, typename Format::value_type fillChar = '0')
 {
-    std::basic_ostringstream<typename Format::value_type> stream;
-    stream << std::setw(width) << std::setfill(fillChar) << number;
-    return stream.str();
+    //Fill goes before the sign, like a stream with the default adjustment
+    return lexical_cast_padded<Format>(number, width, fillChar);
 }
 
 #endif
@@ -0,0 +1,215 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "Types.h"
+#include "Matrix4.h"
+#include "Plane.h"
+#include "Quaternion.h"
+#include "Ray.h"
+#include "Sphere.h"
+#include "Vector3.h"
+#include "Vector4.h"
+
+namespace Framework
+{
+	class CThreadPool;
+}
+
+//Structure of arrays containers, each component is stored contiguously so that
+//batch kernels can process as many elements as the SIMD width at once
+class CVector3Array
+{
+public:
+	CVector3Array() = default;
+	explicit CVector3Array(size_t);
+
+	size_t GetSize() const;
+	void Resize(size_t);
+
+	CVector3 Get(size_t) const;
+	void Set(size_t, const CVector3&);
+
+	float* GetX();
+	float* GetY();
+	float* GetZ();
+	const float* GetX() const;
+	const float* GetY() const;
+	const float* GetZ() const;
+
+private:
+	std::vector<float> m_x;
+	std::vector<float> m_y;
+	std::vector<float> m_z;
+};
+
+class CVector4Array
+{
+public:
+	CVector4Array() = default;
+	explicit CVector4Array(size_t);
+
+	size_t GetSize() const;
+	void Resize(size_t);
+
+	CVector4 Get(size_t) const;
+	void Set(size_t, const CVector4&);
+
+	float* GetX();
+	float* GetY();
+	float* GetZ();
+	float* GetW();
+	const float* GetX() const;
+	const float* GetY() const;
+	const float* GetZ() const;
+	const float* GetW() const;
+
+private:
+	std::vector<float> m_x;
+	std::vector<float> m_y;
+	std::vector<float> m_z;
+	std::vector<float> m_w;
+};
+
+class CSphereArray
+{
+public:
+	CSphereArray() = default;
+	explicit CSphereArray(size_t);
+
+	size_t GetSize() const;
+	void Resize(size_t);
+
+	CSphere Get(size_t) const;
+	void Set(size_t, const CSphere&);
+
+	CVector3Array& GetPositions();
+	const CVector3Array& GetPositions() const;
+	float* GetRadii();
+	const float* GetRadii() const;
+
+private:
+	CVector3Array m_positions;
+	std::vector<float> m_radii;
+};
+
+class CPlaneArray
+{
+public:
+	CPlaneArray() = default;
+	explicit CPlaneArray(size_t);
+
+	size_t GetSize() const;
+	void Resize(size_t);
+
+	CPlane Get(size_t) const;
+	void Set(size_t, const CPlane&);
+
+	float* GetA();
+	float* GetB();
+	float* GetC();
+	float* GetD();
+	const float* GetA() const;
+	const float* GetB() const;
+	const float* GetC() const;
+	const float* GetD() const;
+
+private:
+	std::vector<float> m_a;
+	std::vector<float> m_b;
+	std::vector<float> m_c;
+	std::vector<float> m_d;
+};
+
+class CRayArray
+{
+public:
+	CRayArray() = default;
+	explicit CRayArray(size_t);
+
+	size_t GetSize() const;
+	void Resize(size_t);
+
+	CRay Get(size_t) const;
+	void Set(size_t, const CRay&);
+
+	CVector3Array& GetPositions();
+	const CVector3Array& GetPositions() const;
+	CVector3Array& GetDirections();
+	const CVector3Array& GetDirections() const;
+
+private:
+	CVector3Array m_positions;
+	CVector3Array m_directions;
+};
+
+class CQuaternionArray
+{
+public:
+	CQuaternionArray() = default;
+	explicit CQuaternionArray(size_t);
+
+	size_t GetSize() const;
+	void Resize(size_t);
+
+	CQuaternion Get(size_t) const;
+	void Set(size_t, const CQuaternion&);
+
+	float* GetX();
+	float* GetY();
+	float* GetZ();
+	float* GetW();
+	const float* GetX() const;
+	const float* GetY() const;
+	const float* GetZ() const;
+	const float* GetW() const;
+
+private:
+	std::vector<float> m_x;
+	std::vector<float> m_y;
+	std::vector<float> m_z;
+	std::vector<float> m_w;
+};
+
+//Batch versions of the math operations, giving the same results as the per element operations.
+//Outputs are resized to match the inputs and can be the same containers as the inputs.
+//Batches larger than a few thousand elements are split across the thread pool if one is given.
+namespace BatchMath
+{
+	//matrix * CVector4(point, 1), without perspective division
+	void TransformPoints(const CMatrix4&, const CVector3Array&, CVector3Array&, Framework::CThreadPool* = nullptr);
+
+	//matrix * CVector4(vector, 0)
+	void TransformVectors(const CMatrix4&, const CVector3Array&, CVector3Array&, Framework::CThreadPool* = nullptr);
+
+	//matrix * vector
+	void Transform(const CMatrix4&, const CVector4Array&, CVector4Array&, Framework::CThreadPool* = nullptr);
+
+	void Normalize(const CVector3Array&, CVector3Array&, Framework::CThreadPool* = nullptr);
+	void Dot(const CVector3Array&, const CVector3Array&, std::vector<float>&, Framework::CThreadPool* = nullptr);
+
+	//Sets visibility[i] to 1 when sphere i is on the positive side of (or intersects) all planes
+	//and to 0 otherwise, returns the number of visible spheres. Planes follow the same convention
+	//as Intersects: points p with normal.Dot(p) - d > 0 are inside, normals need to be unit length.
+	size_t CullSpheres(const CPlane*, size_t planeCount, const CSphereArray&, std::vector<uint8>& visibility, Framework::CThreadPool* = nullptr);
+
+	//Signed distances of the points to the plane (normal.Dot(point) - d)
+	void PlaneDistances(const CPlane&, const CVector3Array&, std::vector<float>&, Framework::CThreadPool* = nullptr);
+
+	//Ray intersection tests, matching Intersects for rays with unit length directions. distances[i] is
+	//set to the distance along the ray of the intersection point (position + direction * distance)
+	//or to infinity when there is no intersection. They return the number of intersections.
+	//One ray against many spheres or planes (picking)
+	size_t IntersectSpheres(const CRay&, const CSphereArray&, std::vector<float>& distances, Framework::CThreadPool* = nullptr);
+	size_t IntersectPlanes(const CRay&, const CPlaneArray&, std::vector<float>& distances, Framework::CThreadPool* = nullptr);
+	//Packets of rays against one sphere or plane
+	size_t IntersectSphere(const CRayArray&, const CSphere&, std::vector<float>& distances, Framework::CThreadPool* = nullptr);
+	size_t IntersectPlane(const CRayArray&, const CPlane&, std::vector<float>& distances, Framework::CThreadPool* = nullptr);
+
+	//Slerp(lhs[i], rhs[i], alpha) for alpha in [0, 1], the SIMD versions use polynomial approximations
+	//of acos and sin, results for unit quaternions are within 1e-6 of Slerp's
+	void Slerp(const CQuaternionArray&, const CQuaternionArray&, float alpha, CQuaternionArray&, Framework::CThreadPool* = nullptr);
+
+	//quaternions[i].ToMatrix()
+	void ToMatrices(const CQuaternionArray&, std::vector<CMatrix4>&, Framework::CThreadPool* = nullptr);
+}
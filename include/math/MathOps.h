@@ -16,15 +16,36 @@ static CVector3 operator *(float lhs, const CVector3& rhs)
 		lhs * rhs.z);
 }
 
-static CVector3 operator *(const CVector3& lhs, const CMatrix4& rhs)
+//Dot products of the matrix's rows with a vector
+static MathSimd::Float4 TransformByRows(const CMatrix4& matrix, MathSimd::Float4 vector)
+{
+	using namespace MathSimd;
+	auto product0 = Mul(Load(matrix.coeff + 0), vector);
+	auto product1 = Mul(Load(matrix.coeff + 4), vector);
+	auto product2 = Mul(Load(matrix.coeff + 8), vector);
+	auto product3 = Mul(Load(matrix.coeff + 12), vector);
+	MathSimd::Transpose(product0, product1, product2, product3);
+	return Add(Add(product0, product1), Add(product2, product3));
+}
+
+//Sum of the matrix's rows weighted by a vector's components
+static MathSimd::Float4 TransformByColumns(const CMatrix4& matrix, MathSimd::Float4 vector)
 {
-	CVector3 result;
-	result.x = rhs(0, 0) * lhs.x + rhs(0, 1) * lhs.y + rhs(0, 2) * lhs.z;
-	result.y = rhs(1, 0) * lhs.x + rhs(1, 1) * lhs.y + rhs(1, 2) * lhs.z;
-	result.z = rhs(2, 0) * lhs.x + rhs(2, 1) * lhs.y + rhs(2, 2) * lhs.z;
+	using namespace MathSimd;
+	auto result = Mul(Splat<0>(vector), Load(matrix.coeff + 0));
+	result = MulAdd(Splat<1>(vector), Load(matrix.coeff + 4), result);
+	result = MulAdd(Splat<2>(vector), Load(matrix.coeff + 8), result);
+	result = MulAdd(Splat<3>(vector), Load(matrix.coeff + 12), result);
 	return result;
 }
 
+static CVector3 operator *(const CVector3& lhs, const CMatrix4& rhs)
+{
+	alignas(16) float result[4];
+	MathSimd::Store(result, TransformByRows(rhs, MathSimd::Set(lhs.x, lhs.y, lhs.z, 0)));
+	return CVector3(result);
+}
+
 static CVector4 operator *(float lhs, const CVector4& rhs)
 {
 	return CVector4(
@@ -37,20 +58,14 @@ static CVector4 operator *(float lhs, const CVector4& rhs)
 static CVector4 operator *(const CVector4& lhs, const CMatrix4& rhs)
 {
 	CVector4 result;
-	result.x = rhs(0, 0) * lhs.x + rhs(0, 1) * lhs.y + rhs(0, 2) * lhs.z + rhs(0, 3) * lhs.w;
-	result.y = rhs(1, 0) * lhs.x + rhs(1, 1) * lhs.y + rhs(1, 2) * lhs.z + rhs(1, 3) * lhs.w;
-	result.z = rhs(2, 0) * lhs.x + rhs(2, 1) * lhs.y + rhs(2, 2) * lhs.z + rhs(2, 3) * lhs.w;
-	result.w = rhs(3, 0) * lhs.x + rhs(3, 1) * lhs.y + rhs(3, 2) * lhs.z + rhs(3, 3) * lhs.w;
+	MathSimd::Store(&result.x, TransformByRows(rhs, MathSimd::Load(&lhs.x)));
 	return result;
 }
 
 static CVector4 operator *(const CMatrix4& lhs, const CVector4& rhs)
 {
 	CVector4 result;
-	result.x = lhs(0, 0) * rhs.x + lhs(1, 0) * rhs.y + lhs(2, 0) * rhs.z + lhs(3, 0) * rhs.w;
-	result.y = lhs(0, 1) * rhs.x + lhs(1, 1) * rhs.y + lhs(2, 1) * rhs.z + lhs(3, 1) * rhs.w;
-	result.z = lhs(0, 2) * rhs.x + lhs(1, 2) * rhs.y + lhs(2, 2) * rhs.z + lhs(3, 2) * rhs.w;
-	result.w = lhs(0, 3) * rhs.x + lhs(1, 3) * rhs.y + lhs(2, 3) * rhs.z + lhs(3, 3) * rhs.w;
+	MathSimd::Store(&result.x, TransformByColumns(lhs, MathSimd::Load(&rhs.x)));
 	return result;
 }
 
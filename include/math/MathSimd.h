@@ -0,0 +1,388 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include "SimdDefs.h"
+
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+#include <xmmintrin.h>
+#elif defined(FRAMEWORK_SIMD_USE_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define FRAMEWORK_MATHSIMD_USE_NEON
+#endif
+
+//Minimal 4 float vector abstraction used by the math classes, with a scalar version
+//for platforms without SIMD (and 32-bit ARM, which lacks some of the needed instructions)
+namespace MathSimd
+{
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+
+	typedef __m128 Float4;
+
+	//Load and Store need 16 bytes aligned pointers
+	inline Float4 Load(const float* values)
+	{
+		return _mm_load_ps(values);
+	}
+
+	inline void Store(float* values, Float4 value)
+	{
+		_mm_store_ps(values, value);
+	}
+
+	inline Float4 LoadUnaligned(const float* values)
+	{
+		return _mm_loadu_ps(values);
+	}
+
+	inline void StoreUnaligned(float* values, Float4 value)
+	{
+		_mm_storeu_ps(values, value);
+	}
+
+	inline Float4 Set(float x, float y, float z, float w)
+	{
+		return _mm_setr_ps(x, y, z, w);
+	}
+
+	inline Float4 Replicate(float value)
+	{
+		return _mm_set1_ps(value);
+	}
+
+	inline float GetX(Float4 value)
+	{
+		return _mm_cvtss_f32(value);
+	}
+
+	inline Float4 Add(Float4 lhs, Float4 rhs)
+	{
+		return _mm_add_ps(lhs, rhs);
+	}
+
+	inline Float4 Sub(Float4 lhs, Float4 rhs)
+	{
+		return _mm_sub_ps(lhs, rhs);
+	}
+
+	inline Float4 Mul(Float4 lhs, Float4 rhs)
+	{
+		return _mm_mul_ps(lhs, rhs);
+	}
+
+	inline Float4 Div(Float4 lhs, Float4 rhs)
+	{
+		return _mm_div_ps(lhs, rhs);
+	}
+
+	inline Float4 Min(Float4 lhs, Float4 rhs)
+	{
+		return _mm_min_ps(lhs, rhs);
+	}
+
+	inline Float4 Sqrt(Float4 value)
+	{
+		return _mm_sqrt_ps(value);
+	}
+
+	//Comparisons return masks (all bits set in the lanes where the comparison is true) meant for Select
+	inline Float4 CompareLess(Float4 lhs, Float4 rhs)
+	{
+		return _mm_cmplt_ps(lhs, rhs);
+	}
+
+	inline Float4 CompareEqual(Float4 lhs, Float4 rhs)
+	{
+		return _mm_cmpeq_ps(lhs, rhs);
+	}
+
+	//Returns ifTrue in the lanes where mask is set, ifFalse elsewhere
+	inline Float4 Select(Float4 mask, Float4 ifTrue, Float4 ifFalse)
+	{
+		return _mm_or_ps(_mm_and_ps(mask, ifTrue), _mm_andnot_ps(mask, ifFalse));
+	}
+
+	//Returns (lhs[X], lhs[Y], rhs[Z], rhs[W])
+	template <int X, int Y, int Z, int W>
+	Float4 Shuffle(Float4 lhs, Float4 rhs)
+	{
+		return _mm_shuffle_ps(lhs, rhs, _MM_SHUFFLE(W, Z, Y, X));
+	}
+
+	template <int Lane>
+	Float4 Splat(Float4 value)
+	{
+		return _mm_shuffle_ps(value, value, _MM_SHUFFLE(Lane, Lane, Lane, Lane));
+	}
+
+	inline void Transpose(Float4& row0, Float4& row1, Float4& row2, Float4& row3)
+	{
+		_MM_TRANSPOSE4_PS(row0, row1, row2, row3);
+	}
+
+#elif defined(FRAMEWORK_MATHSIMD_USE_NEON)
+
+	typedef float32x4_t Float4;
+
+	inline Float4 Load(const float* values)
+	{
+		return vld1q_f32(values);
+	}
+
+	inline void Store(float* values, Float4 value)
+	{
+		vst1q_f32(values, value);
+	}
+
+	inline Float4 LoadUnaligned(const float* values)
+	{
+		return vld1q_f32(values);
+	}
+
+	inline void StoreUnaligned(float* values, Float4 value)
+	{
+		vst1q_f32(values, value);
+	}
+
+	inline Float4 Set(float x, float y, float z, float w)
+	{
+		float values[4] = {x, y, z, w};
+		return vld1q_f32(values);
+	}
+
+	inline Float4 Replicate(float value)
+	{
+		return vdupq_n_f32(value);
+	}
+
+	inline float GetX(Float4 value)
+	{
+		return vgetq_lane_f32(value, 0);
+	}
+
+	inline Float4 Add(Float4 lhs, Float4 rhs)
+	{
+		return vaddq_f32(lhs, rhs);
+	}
+
+	inline Float4 Sub(Float4 lhs, Float4 rhs)
+	{
+		return vsubq_f32(lhs, rhs);
+	}
+
+	inline Float4 Mul(Float4 lhs, Float4 rhs)
+	{
+		return vmulq_f32(lhs, rhs);
+	}
+
+	inline Float4 Div(Float4 lhs, Float4 rhs)
+	{
+		return vdivq_f32(lhs, rhs);
+	}
+
+	inline Float4 Min(Float4 lhs, Float4 rhs)
+	{
+		return vminq_f32(lhs, rhs);
+	}
+
+	inline Float4 Sqrt(Float4 value)
+	{
+		return vsqrtq_f32(value);
+	}
+
+	//Comparisons return masks (all bits set in the lanes where the comparison is true) meant for Select
+	inline Float4 CompareLess(Float4 lhs, Float4 rhs)
+	{
+		return vreinterpretq_f32_u32(vcltq_f32(lhs, rhs));
+	}
+
+	inline Float4 CompareEqual(Float4 lhs, Float4 rhs)
+	{
+		return vreinterpretq_f32_u32(vceqq_f32(lhs, rhs));
+	}
+
+	//Returns ifTrue in the lanes where mask is set, ifFalse elsewhere
+	inline Float4 Select(Float4 mask, Float4 ifTrue, Float4 ifFalse)
+	{
+		return vbslq_f32(vreinterpretq_u32_f32(mask), ifTrue, ifFalse);
+	}
+
+	//Returns (lhs[X], lhs[Y], rhs[Z], rhs[W])
+	template <int X, int Y, int Z, int W>
+	Float4 Shuffle(Float4 lhs, Float4 rhs)
+	{
+		//Byte indices into the lhs:rhs table, the compiler folds these to a constant
+		static const uint8_t indices[16] =
+		{
+			X * 4 + 0, X * 4 + 1, X * 4 + 2, X * 4 + 3,
+			Y * 4 + 0, Y * 4 + 1, Y * 4 + 2, Y * 4 + 3,
+			16 + Z * 4 + 0, 16 + Z * 4 + 1, 16 + Z * 4 + 2, 16 + Z * 4 + 3,
+			16 + W * 4 + 0, 16 + W * 4 + 1, 16 + W * 4 + 2, 16 + W * 4 + 3,
+		};
+		uint8x16x2_t table = {{vreinterpretq_u8_f32(lhs), vreinterpretq_u8_f32(rhs)}};
+		return vreinterpretq_f32_u8(vqtbl2q_u8(table, vld1q_u8(indices)));
+	}
+
+	template <int Lane>
+	Float4 Splat(Float4 value)
+	{
+		return vdupq_laneq_f32(value, Lane);
+	}
+
+	inline void Transpose(Float4& row0, Float4& row1, Float4& row2, Float4& row3)
+	{
+		auto t0 = vtrn1q_f32(row0, row1);
+		auto t1 = vtrn2q_f32(row0, row1);
+		auto t2 = vtrn1q_f32(row2, row3);
+		auto t3 = vtrn2q_f32(row2, row3);
+		row0 = vreinterpretq_f32_f64(vtrn1q_f64(vreinterpretq_f64_f32(t0), vreinterpretq_f64_f32(t2)));
+		row1 = vreinterpretq_f32_f64(vtrn1q_f64(vreinterpretq_f64_f32(t1), vreinterpretq_f64_f32(t3)));
+		row2 = vreinterpretq_f32_f64(vtrn2q_f64(vreinterpretq_f64_f32(t0), vreinterpretq_f64_f32(t2)));
+		row3 = vreinterpretq_f32_f64(vtrn2q_f64(vreinterpretq_f64_f32(t1), vreinterpretq_f64_f32(t3)));
+	}
+
+#else
+
+	//Load and Store don't need aligned pointers in this version
+	struct Float4
+	{
+		float v[4];
+	};
+
+	inline Float4 Load(const float* values)
+	{
+		return Float4{{values[0], values[1], values[2], values[3]}};
+	}
+
+	inline void Store(float* values, Float4 value)
+	{
+		for(unsigned int i = 0; i < 4; i++)
+		{
+			values[i] = value.v[i];
+		}
+	}
+
+	inline Float4 LoadUnaligned(const float* values)
+	{
+		return Load(values);
+	}
+
+	inline void StoreUnaligned(float* values, Float4 value)
+	{
+		Store(values, value);
+	}
+
+	inline Float4 Set(float x, float y, float z, float w)
+	{
+		return Float4{{x, y, z, w}};
+	}
+
+	inline Float4 Replicate(float value)
+	{
+		return Float4{{value, value, value, value}};
+	}
+
+	inline float GetX(Float4 value)
+	{
+		return value.v[0];
+	}
+
+	inline Float4 Add(Float4 lhs, Float4 rhs)
+	{
+		return Float4{{lhs.v[0] + rhs.v[0], lhs.v[1] + rhs.v[1], lhs.v[2] + rhs.v[2], lhs.v[3] + rhs.v[3]}};
+	}
+
+	inline Float4 Sub(Float4 lhs, Float4 rhs)
+	{
+		return Float4{{lhs.v[0] - rhs.v[0], lhs.v[1] - rhs.v[1], lhs.v[2] - rhs.v[2], lhs.v[3] - rhs.v[3]}};
+	}
+
+	inline Float4 Mul(Float4 lhs, Float4 rhs)
+	{
+		return Float4{{lhs.v[0] * rhs.v[0], lhs.v[1] * rhs.v[1], lhs.v[2] * rhs.v[2], lhs.v[3] * rhs.v[3]}};
+	}
+
+	inline Float4 Div(Float4 lhs, Float4 rhs)
+	{
+		return Float4{{lhs.v[0] / rhs.v[0], lhs.v[1] / rhs.v[1], lhs.v[2] / rhs.v[2], lhs.v[3] / rhs.v[3]}};
+	}
+
+	inline Float4 Min(Float4 lhs, Float4 rhs)
+	{
+		return Float4{{std::min(lhs.v[0], rhs.v[0]), std::min(lhs.v[1], rhs.v[1]), std::min(lhs.v[2], rhs.v[2]), std::min(lhs.v[3], rhs.v[3])}};
+	}
+
+	inline Float4 Sqrt(Float4 value)
+	{
+		return Float4{{std::sqrt(value.v[0]), std::sqrt(value.v[1]), std::sqrt(value.v[2]), std::sqrt(value.v[3])}};
+	}
+
+	//Comparisons return masks (1 in the lanes where the comparison is true, 0 elsewhere) meant for Select
+	inline Float4 CompareLess(Float4 lhs, Float4 rhs)
+	{
+		Float4 result;
+		for(unsigned int i = 0; i < 4; i++)
+		{
+			result.v[i] = (lhs.v[i] < rhs.v[i]) ? 1.0f : 0.0f;
+		}
+		return result;
+	}
+
+	inline Float4 CompareEqual(Float4 lhs, Float4 rhs)
+	{
+		Float4 result;
+		for(unsigned int i = 0; i < 4; i++)
+		{
+			result.v[i] = (lhs.v[i] == rhs.v[i]) ? 1.0f : 0.0f;
+		}
+		return result;
+	}
+
+	//Returns ifTrue in the lanes where mask is set, ifFalse elsewhere
+	inline Float4 Select(Float4 mask, Float4 ifTrue, Float4 ifFalse)
+	{
+		Float4 result;
+		for(unsigned int i = 0; i < 4; i++)
+		{
+			result.v[i] = (mask.v[i] != 0) ? ifTrue.v[i] : ifFalse.v[i];
+		}
+		return result;
+	}
+
+	//Returns (lhs[X], lhs[Y], rhs[Z], rhs[W])
+	template <int X, int Y, int Z, int W>
+	Float4 Shuffle(Float4 lhs, Float4 rhs)
+	{
+		return Float4{{lhs.v[X], lhs.v[Y], rhs.v[Z], rhs.v[W]}};
+	}
+
+	template <int Lane>
+	Float4 Splat(Float4 value)
+	{
+		return Float4{{value.v[Lane], value.v[Lane], value.v[Lane], value.v[Lane]}};
+	}
+
+	inline void Transpose(Float4& row0, Float4& row1, Float4& row2, Float4& row3)
+	{
+		Float4 rows[4] = {row0, row1, row2, row3};
+		row0 = Float4{{rows[0].v[0], rows[1].v[0], rows[2].v[0], rows[3].v[0]}};
+		row1 = Float4{{rows[0].v[1], rows[1].v[1], rows[2].v[1], rows[3].v[1]}};
+		row2 = Float4{{rows[0].v[2], rows[1].v[2], rows[2].v[2], rows[3].v[2]}};
+		row3 = Float4{{rows[0].v[3], rows[1].v[3], rows[2].v[3], rows[3].v[3]}};
+	}
+
+#endif
+
+	//Returns (value[X], value[Y], value[Z], value[W])
+	template <int X, int Y, int Z, int W>
+	Float4 Swizzle(Float4 value)
+	{
+		return Shuffle<X, Y, Z, W>(value, value);
+	}
+
+	//Returns (lhs * rhs) + acc
+	inline Float4 MulAdd(Float4 lhs, Float4 rhs, Float4 acc)
+	{
+		return Add(Mul(lhs, rhs), acc);
+	}
+}
@@ -1,14 +1,20 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include "Vector2.h"
 #include "Vector3.h"
 
 namespace MathStringUtils
 {
-	float		ParseFloat(const std::string&);
-	CVector2	ParseVector2(const std::string&);
-	CVector3	ParseVector3(const std::string&);
+	//Conversions don't depend on the current locale. Parsing skips leading whitespace and stops at the
+	//first character that isn't part of the number, ToString gives the shortest text that parses back
+	//to the same value.
+	bool		TryParseFloat(std::string_view, float&);
+	float		ParseFloat(std::string_view);
+	CVector2	ParseVector2(std::string_view);
+	CVector3	ParseVector3(std::string_view);
 
+	std::string	ToString(float);
 	std::string	ToString(const CVector3&);
 };
@@ -3,8 +3,10 @@
 #include <memory.h>
 #include <cmath>
 #include <cassert>
+#include "MathSimd.h"
 
-class CMatrix4
+//Rows are 16 bytes aligned to be loaded directly in SIMD registers
+class alignas(16) CMatrix4
 {
 public:
 	CMatrix4()
@@ -31,86 +33,94 @@ public:
 	
 	CMatrix4 operator *(const CMatrix4& rhs) const
 	{
-		CMatrix4 result;
+		using namespace MathSimd;
+		auto rhsRow0 = Load(rhs.coeff + 0);
+		auto rhsRow1 = Load(rhs.coeff + 4);
+		auto rhsRow2 = Load(rhs.coeff + 8);
+		auto rhsRow3 = Load(rhs.coeff + 12);
+		CMatrix4 result(UNINITIALIZED);
 		for(unsigned int i = 0; i < 4; i++)
 		{
-			result(i, 0) = (*this)(i, 0) * rhs(0, 0) + (*this)(i, 1) * rhs(1, 0) + (*this)(i, 2) * rhs(2, 0) + (*this)(i, 3) * rhs(3, 0);
-			result(i, 1) = (*this)(i, 0) * rhs(0, 1) + (*this)(i, 1) * rhs(1, 1) + (*this)(i, 2) * rhs(2, 1) + (*this)(i, 3) * rhs(3, 1);
-			result(i, 2) = (*this)(i, 0) * rhs(0, 2) + (*this)(i, 1) * rhs(1, 2) + (*this)(i, 2) * rhs(2, 2) + (*this)(i, 3) * rhs(3, 2);
-			result(i, 3) = (*this)(i, 0) * rhs(0, 3) + (*this)(i, 1) * rhs(1, 3) + (*this)(i, 2) * rhs(2, 3) + (*this)(i, 3) * rhs(3, 3);
+			//Each result row is the sum of rhs' rows weighted by this row's coefficients
+			auto row = Load(coeff + (i * 4));
+			auto resultRow = Mul(Splat<0>(row), rhsRow0);
+			resultRow = MulAdd(Splat<1>(row), rhsRow1, resultRow);
+			resultRow = MulAdd(Splat<2>(row), rhsRow2, resultRow);
+			resultRow = MulAdd(Splat<3>(row), rhsRow3, resultRow);
+			Store(result.coeff + (i * 4), resultRow);
 		}
 		return result;
 	}
 
 	CMatrix4 Transpose() const
 	{
-		CMatrix4 result;
-		for(unsigned int i = 0; i < 4; i++)
-		{
-			for(unsigned int j = 0; j < 4; j++)
-			{
-				result(i, j) = (*this)(j, i);
-			}
-		}
+		using namespace MathSimd;
+		auto row0 = Load(coeff + 0);
+		auto row1 = Load(coeff + 4);
+		auto row2 = Load(coeff + 8);
+		auto row3 = Load(coeff + 12);
+		MathSimd::Transpose(row0, row1, row2, row3);
+		CMatrix4 result(UNINITIALIZED);
+		Store(result.coeff + 0, row0);
+		Store(result.coeff + 4, row1);
+		Store(result.coeff + 8, row2);
+		Store(result.coeff + 12, row3);
 		return result;
 	}
 
 	CMatrix4 Inverse() const
 	{
-		float a0 = coeff[ 0]*coeff[ 5] - coeff[ 1]*coeff[ 4];
-		float a1 = coeff[ 0]*coeff[ 6] - coeff[ 2]*coeff[ 4];
-		float a2 = coeff[ 0]*coeff[ 7] - coeff[ 3]*coeff[ 4];
-		float a3 = coeff[ 1]*coeff[ 6] - coeff[ 2]*coeff[ 5];
-		float a4 = coeff[ 1]*coeff[ 7] - coeff[ 3]*coeff[ 5];
-		float a5 = coeff[ 2]*coeff[ 7] - coeff[ 3]*coeff[ 6];
-		float b0 = coeff[ 8]*coeff[13] - coeff[ 9]*coeff[12];
-		float b1 = coeff[ 8]*coeff[14] - coeff[10]*coeff[12];
-		float b2 = coeff[ 8]*coeff[15] - coeff[11]*coeff[12];
-		float b3 = coeff[ 9]*coeff[14] - coeff[10]*coeff[13];
-		float b4 = coeff[ 9]*coeff[15] - coeff[11]*coeff[13];
-		float b5 = coeff[10]*coeff[15] - coeff[11]*coeff[14];
-		
-		float det = a0*b5 - a1*b4 + a2*b3 + a3*b2 - a4*b1 + a5*b0;
-
-		if(fabs(det) > 0.0001f)
+		//Block matrix inversion, with the matrix split in 4 2x2 matrices (each held by a vector, row major):
+		//| A B |
+		//| C D |
+		//X#, Y#, Z# and W# are the adjugates of the inverse's blocks before the division by the determinant
+		using namespace MathSimd;
+		auto row0 = Load(coeff + 0);
+		auto row1 = Load(coeff + 4);
+		auto row2 = Load(coeff + 8);
+		auto row3 = Load(coeff + 12);
+
+		auto a = Shuffle<0, 1, 0, 1>(row0, row1);
+		auto b = Shuffle<2, 3, 2, 3>(row0, row1);
+		auto c = Shuffle<0, 1, 0, 1>(row2, row3);
+		auto d = Shuffle<2, 3, 2, 3>(row2, row3);
+
+		//(|A|, |B|, |C|, |D|)
+		auto blockDets = Sub(
+			Mul(Shuffle<0, 2, 0, 2>(row0, row2), Shuffle<1, 3, 1, 3>(row1, row3)),
+			Mul(Shuffle<1, 3, 1, 3>(row0, row2), Shuffle<0, 2, 0, 2>(row1, row3)));
+		auto detA = Splat<0>(blockDets);
+		auto detB = Splat<1>(blockDets);
+		auto detC = Splat<2>(blockDets);
+		auto detD = Splat<3>(blockDets);
+
+		auto dAdjC = Mat2AdjMul(d, c);
+		auto aAdjB = Mat2AdjMul(a, b);
+		auto xAdj = Sub(Mul(detD, a), Mat2Mul(b, dAdjC));
+		auto wAdj = Sub(Mul(detA, d), Mat2Mul(c, aAdjB));
+		auto yAdj = Sub(Mul(detB, c), Mat2MulAdj(d, aAdjB));
+		auto zAdj = Sub(Mul(detC, b), Mat2MulAdj(a, dAdjC));
+
+		//|M| = |A| * |D| + |B| * |C| - tr((A# * B) * (D# * C))
+		auto trace = Mul(aAdjB, Swizzle<0, 2, 1, 3>(dAdjC));
+		trace = Add(trace, Swizzle<2, 3, 0, 1>(trace));
+		trace = Add(trace, Swizzle<1, 0, 3, 2>(trace));
+		auto det = Sub(Add(Mul(detA, detD), Mul(detB, detC)), trace);
+
+		if(fabs(GetX(det)) > 0.0001f)
 		{
-			CMatrix4 inverse;
-
-			inverse.coeff[ 0] = + coeff[ 5]*b5 - coeff[ 6]*b4 + coeff[ 7]*b3;
-			inverse.coeff[ 4] = - coeff[ 4]*b5 + coeff[ 6]*b2 - coeff[ 7]*b1;
-			inverse.coeff[ 8] = + coeff[ 4]*b4 - coeff[ 5]*b2 + coeff[ 7]*b0;
-			inverse.coeff[12] = - coeff[ 4]*b3 + coeff[ 5]*b1 - coeff[ 6]*b0;
-			inverse.coeff[ 1] = - coeff[ 1]*b5 + coeff[ 2]*b4 - coeff[ 3]*b3;
-			inverse.coeff[ 5] = + coeff[ 0]*b5 - coeff[ 2]*b2 + coeff[ 3]*b1;
-			inverse.coeff[ 9] = - coeff[ 0]*b4 + coeff[ 1]*b2 - coeff[ 3]*b0;
-			inverse.coeff[13] = + coeff[ 0]*b3 - coeff[ 1]*b1 + coeff[ 2]*b0;
-			inverse.coeff[ 2] = + coeff[13]*a5 - coeff[14]*a4 + coeff[15]*a3;
-			inverse.coeff[ 6] = - coeff[12]*a5 + coeff[14]*a2 - coeff[15]*a1;
-			inverse.coeff[10] = + coeff[12]*a4 - coeff[13]*a2 + coeff[15]*a0;
-			inverse.coeff[14] = - coeff[12]*a3 + coeff[13]*a1 - coeff[14]*a0;
-			inverse.coeff[ 3] = - coeff[ 9]*a5 + coeff[10]*a4 - coeff[11]*a3;
-			inverse.coeff[ 7] = + coeff[ 8]*a5 - coeff[10]*a2 + coeff[11]*a1;
-			inverse.coeff[11] = - coeff[ 8]*a4 + coeff[ 9]*a2 - coeff[11]*a0;
-			inverse.coeff[15] = + coeff[ 8]*a3 - coeff[ 9]*a1 + coeff[10]*a0;
-
-			float invDet = 1.0f / det;
-			inverse.coeff[ 0] *= invDet;
-			inverse.coeff[ 1] *= invDet;
-			inverse.coeff[ 2] *= invDet;
-			inverse.coeff[ 3] *= invDet;
-			inverse.coeff[ 4] *= invDet;
-			inverse.coeff[ 5] *= invDet;
-			inverse.coeff[ 6] *= invDet;
-			inverse.coeff[ 7] *= invDet;
-			inverse.coeff[ 8] *= invDet;
-			inverse.coeff[ 9] *= invDet;
-			inverse.coeff[10] *= invDet;
-			inverse.coeff[11] *= invDet;
-			inverse.coeff[12] *= invDet;
-			inverse.coeff[13] *= invDet;
-			inverse.coeff[14] *= invDet;
-			inverse.coeff[15] *= invDet;
+			auto invDet = Div(Set(1, -1, -1, 1), det);
+			xAdj = Mul(xAdj, invDet);
+			yAdj = Mul(yAdj, invDet);
+			zAdj = Mul(zAdj, invDet);
+			wAdj = Mul(wAdj, invDet);
 
+			//Undo the adjugates and put the blocks back in rows
+			CMatrix4 inverse(UNINITIALIZED);
+			Store(inverse.coeff + 0, Shuffle<3, 1, 3, 1>(xAdj, yAdj));
+			Store(inverse.coeff + 4, Shuffle<2, 0, 2, 0>(xAdj, yAdj));
+			Store(inverse.coeff + 8, Shuffle<3, 1, 3, 1>(zAdj, wAdj));
+			Store(inverse.coeff + 12, Shuffle<2, 0, 2, 0>(zAdj, wAdj));
 			return inverse;
 		}
 		else
@@ -221,4 +231,38 @@ public:
 	}
 
 	float coeff[16];
+
+private:
+	enum UNINITIALIZED_TAG
+	{
+		UNINITIALIZED
+	};
+
+	//Used for results that are completely overwritten
+	explicit CMatrix4(UNINITIALIZED_TAG)
+	{
+	}
+
+	//Operations on 2x2 row major matrices held in vectors, used by Inverse
+
+	//A * B
+	static MathSimd::Float4 Mat2Mul(MathSimd::Float4 a, MathSimd::Float4 b)
+	{
+		using namespace MathSimd;
+		return MulAdd(a, Swizzle<0, 3, 0, 3>(b), Mul(Swizzle<1, 0, 3, 2>(a), Swizzle<2, 1, 2, 1>(b)));
+	}
+
+	//A# * B
+	static MathSimd::Float4 Mat2AdjMul(MathSimd::Float4 a, MathSimd::Float4 b)
+	{
+		using namespace MathSimd;
+		return Sub(Mul(Swizzle<3, 3, 0, 0>(a), b), Mul(Swizzle<1, 1, 2, 2>(a), Swizzle<2, 3, 0, 1>(b)));
+	}
+
+	//A * B#
+	static MathSimd::Float4 Mat2MulAdj(MathSimd::Float4 a, MathSimd::Float4 b)
+	{
+		using namespace MathSimd;
+		return Sub(Mul(a, Swizzle<3, 0, 3, 0>(b)), Mul(Swizzle<1, 0, 3, 2>(a), Swizzle<2, 1, 2, 1>(b)));
+	}
 };
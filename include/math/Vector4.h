@@ -3,7 +3,8 @@
 #include <cmath>
 #include "Vector3.h"
 
-class CVector4
+//16 bytes aligned to be loaded directly in SIMD registers
+class alignas(16) CVector4
 {
 public:
 	CVector4()
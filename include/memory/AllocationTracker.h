@@ -0,0 +1,210 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Singleton.h"
+#include "Types.h"
+
+#define FRAMEWORK_ALLOCATION_SITE_STRINGIFY2(a) #a
+#define FRAMEWORK_ALLOCATION_SITE_STRINGIFY(a) FRAMEWORK_ALLOCATION_SITE_STRINGIFY2(a)
+//Identifies the source line doing the allocation, sites are compared by address
+#define FRAMEWORK_ALLOCATION_SITE (__FILE__ ":" FRAMEWORK_ALLOCATION_SITE_STRINGIFY(__LINE__))
+
+namespace Framework
+{
+	namespace Memory
+	{
+		//Attributes memory use to framework subsystems and allocation sites. Tracking is off by default,
+		//nothing but a flag check is done until it's enabled. Allocations done while it was disabled
+		//are never counted, even when they are freed after it's enabled.
+		class CAllocationTracker : public CSingleton<CAllocationTracker>
+		{
+		public:
+			enum SUBSYSTEM
+			{
+				SUBSYSTEM_OTHER,
+				SUBSYSTEM_XML,
+				SUBSYSTEM_BITMAP,
+				SUBSYSTEM_ZIP,
+				SUBSYSTEM_HTTP,
+				SUBSYSTEM_VULKAN,
+				SUBSYSTEM_COUNT,
+			};
+
+			struct SUBSYSTEM_STATS
+			{
+				uint64		liveBytes = 0;
+				uint64		peakBytes = 0;
+				uint64		allocatedBytes = 0;
+				uint64		allocationCount = 0;
+				uint64		freeCount = 0;
+				//Bytes allocated per second since the previous snapshot
+				double		allocationRate = 0;
+			};
+
+			struct SITE_STATS
+			{
+				const char*	site = nullptr;
+				SUBSYSTEM	subsystem = SUBSYSTEM_OTHER;
+				uint64		liveBytes = 0;
+				uint64		allocatedBytes = 0;
+				uint64		allocationCount = 0;
+			};
+
+			struct SNAPSHOT
+			{
+				std::array<SUBSYSTEM_STATS, SUBSYSTEM_COUNT>	subsystems;
+				//Sorted by live bytes, largest first
+				std::vector<SITE_STATS>		topSites;
+			};
+
+			enum
+			{
+				DEFAULT_TOP_SITE_COUNT = 16,
+			};
+
+								CAllocationTracker();
+
+			void				SetEnabled(bool);
+			bool				IsEnabled() const;
+
+			//For memory obtained elsewhere, frees need to be recorded with the same subsystem and site
+			void				RecordAllocation(SUBSYSTEM, const char* site, size_t);
+			void				RecordFree(SUBSYSTEM, const char* site, size_t);
+
+			//Allocations that remember their subsystem, site and size, recorded if tracking is enabled
+			void*				Allocate(SUBSYSTEM, const char* site, size_t, size_t = alignof(std::max_align_t));
+			void*				Reallocate(void*, size_t, size_t = alignof(std::max_align_t));
+			void				Free(void*);
+
+			SNAPSHOT			GetSnapshot(size_t topSiteCount = DEFAULT_TOP_SITE_COUNT);
+			//Clears counters and sites, allocations made before aren't counted anymore when they are freed
+			void				Reset();
+			//Changes with each reset
+			uint32				GetGeneration() const;
+
+			std::string			DumpJson(size_t topSiteCount = DEFAULT_TOP_SITE_COUNT);
+
+			static const char*	GetSubsystemName(SUBSYSTEM);
+
+		private:
+			struct COUNTERS
+			{
+				std::atomic<uint64>	liveBytes;
+				std::atomic<uint64>	peakBytes;
+				std::atomic<uint64>	allocatedBytes;
+				std::atomic<uint64>	allocationCount;
+				std::atomic<uint64>	freeCount;
+			};
+
+			struct SITE
+			{
+				SUBSYSTEM	subsystem = SUBSYSTEM_OTHER;
+				uint64		liveBytes = 0;
+				uint64		allocatedBytes = 0;
+				uint64		allocationCount = 0;
+			};
+
+			typedef std::unordered_map<const char*, SITE> SiteMap;
+			typedef std::chrono::steady_clock::time_point TimePoint;
+
+			std::atomic<bool>	m_enabled;
+			//Incremented by Reset, allocations made before are ignored when freed
+			std::atomic<uint32>	m_generation;
+			std::array<COUNTERS, SUBSYSTEM_COUNT>	m_counters;
+
+			std::mutex			m_sitesMutex;
+			SiteMap				m_sites;
+
+			std::mutex			m_snapshotMutex;
+			TimePoint			m_lastSnapshotTime;
+			std::array<uint64, SUBSYSTEM_COUNT>	m_lastAllocatedBytes;
+		};
+
+		//Records an allocation owned by something else (ie.: a container's storage) for as long as it lives
+		class CAllocationRecord
+		{
+		public:
+							CAllocationRecord() = default;
+							CAllocationRecord(CAllocationTracker::SUBSYSTEM, const char* site, size_t = 0);
+							CAllocationRecord(const CAllocationRecord&) = delete;
+							CAllocationRecord(CAllocationRecord&&);
+							~CAllocationRecord();
+
+			CAllocationRecord&	operator =(const CAllocationRecord&) = delete;
+			CAllocationRecord&	operator =(CAllocationRecord&&);
+
+			void			SetSize(size_t);
+
+		private:
+			void			Release();
+
+			CAllocationTracker::SUBSYSTEM	m_subsystem = CAllocationTracker::SUBSYSTEM_OTHER;
+			const char*		m_site = nullptr;
+			size_t			m_size = 0;
+			uint32			m_generation = 0;
+			bool			m_tracked = false;
+		};
+
+		//Standard allocator for containers whose storage should be attributed to a subsystem
+		template <typename Type, CAllocationTracker::SUBSYSTEM Subsystem>
+		class CTrackingAllocator
+		{
+		public:
+			typedef Type value_type;
+
+			template <typename OtherType>
+			struct rebind
+			{
+				typedef CTrackingAllocator<OtherType, Subsystem> other;
+			};
+
+			CTrackingAllocator(const char* site = nullptr)
+			: m_site(site)
+			{
+			}
+
+			template <typename OtherType>
+			CTrackingAllocator(const CTrackingAllocator<OtherType, Subsystem>& src)
+			: m_site(src.GetSite())
+			{
+			}
+
+			Type* allocate(size_t count)
+			{
+				return reinterpret_cast<Type*>(CAllocationTracker::GetInstance().Allocate(Subsystem, m_site, count * sizeof(Type), alignof(Type)));
+			}
+
+			void deallocate(Type* ptr, size_t)
+			{
+				CAllocationTracker::GetInstance().Free(ptr);
+			}
+
+			const char* GetSite() const
+			{
+				return m_site;
+			}
+
+			template <typename OtherType>
+			bool operator ==(const CTrackingAllocator<OtherType, Subsystem>&) const
+			{
+				return true;
+			}
+
+			template <typename OtherType>
+			bool operator !=(const CTrackingAllocator<OtherType, Subsystem>&) const
+			{
+				return false;
+			}
+
+		private:
+			const char*		m_site = nullptr;
+		};
+	}
+}
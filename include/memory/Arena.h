@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include "Types.h"
+
+namespace Framework
+{
+	namespace Memory
+	{
+		//Bump allocator: allocations are carved out of large chunks and are only freed all at once,
+		//by Reset or when the arena is destroyed. Destructors of objects created in it aren't called.
+		class CArena
+		{
+		public:
+			enum
+			{
+				DEFAULT_CHUNK_SIZE = 0x10000,
+			};
+
+			explicit		CArena(size_t = DEFAULT_CHUNK_SIZE);
+			//Allocates from a region owned by the caller (ie.: a CHugePageRegion) before using chunks of its own
+							CArena(void*, size_t, size_t = DEFAULT_CHUNK_SIZE);
+							CArena(const CArena&) = delete;
+							~CArena();
+
+			CArena&			operator =(const CArena&) = delete;
+
+			void*			Allocate(size_t, size_t = alignof(std::max_align_t));
+
+			template <typename Type, typename... Args>
+			Type* New(Args&&... args)
+			{
+				static_assert(std::is_trivially_destructible<Type>::value, "Arena never calls destructors.");
+				return new(Allocate(sizeof(Type), alignof(Type))) Type(std::forward<Args>(args)...);
+			}
+
+			template <typename Type>
+			Type* NewArray(size_t count)
+			{
+				static_assert(std::is_trivially_destructible<Type>::value, "Arena never calls destructors.");
+				auto result = reinterpret_cast<Type*>(Allocate(sizeof(Type) * count, alignof(Type)));
+				for(size_t i = 0; i < count; i++)
+				{
+					new(result + i) Type();
+				}
+				return result;
+			}
+
+			//Makes all the memory available again, one chunk is kept to avoid going back to the heap
+			void			Reset();
+
+			//Bytes handed out since the last reset
+			size_t			GetUsedSize() const;
+
+		private:
+			struct CHUNK
+			{
+				CHUNK*		next = nullptr;
+				size_t		size = 0;
+			};
+
+			void			UseChunk(CHUNK*);
+			void			AllocateChunk(size_t, size_t);
+			static void		FreeChunks(CHUNK*);
+
+			size_t			m_chunkSize = 0;
+			uint8*			m_region = nullptr;
+			size_t			m_regionSize = 0;
+
+			uint8*			m_current = nullptr;
+			uint8*			m_end = nullptr;
+			CHUNK*			m_chunks = nullptr;
+			CHUNK*			m_spareChunk = nullptr;
+			size_t			m_usedSize = 0;
+		};
+	}
+}
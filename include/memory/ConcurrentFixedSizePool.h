@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "Types.h"
+
+namespace Framework
+{
+	namespace Memory
+	{
+		//Thread safe version of CFixedSizePool. Each thread keeps a small cache of free blocks and only
+		//goes through the shared free list (under a lock) in batches, when its cache is empty or full.
+		//Blocks can be freed by another thread than the one that allocated them.
+		//Blocks cached by a thread that exits stay parked in its cache until the pool is destroyed.
+		class CConcurrentFixedSizePool
+		{
+		public:
+			enum
+			{
+				DEFAULT_BLOCKS_PER_SLAB = 256,
+				DEFAULT_THREAD_CACHE_SIZE = 64,
+			};
+
+							CConcurrentFixedSizePool(size_t, size_t = alignof(std::max_align_t),
+								size_t = DEFAULT_BLOCKS_PER_SLAB, size_t = DEFAULT_THREAD_CACHE_SIZE);
+							CConcurrentFixedSizePool(const CConcurrentFixedSizePool&) = delete;
+							~CConcurrentFixedSizePool();
+
+			CConcurrentFixedSizePool&	operator =(const CConcurrentFixedSizePool&) = delete;
+
+			void*			Allocate();
+			void			Free(void*);
+
+			size_t			GetBlockSize() const;
+			size_t			GetBlockAlignment() const;
+
+		private:
+			struct FREE_BLOCK
+			{
+				FREE_BLOCK*	next;
+			};
+
+			struct THREAD_CACHE
+			{
+				FREE_BLOCK*	blocks = nullptr;
+				size_t		count = 0;
+			};
+
+			THREAD_CACHE&	GetThreadCache();
+			void			Refill(THREAD_CACHE&);
+			void			Drain(THREAD_CACHE&);
+			void			AllocateSlab();
+
+			uint64			m_id = 0;
+			size_t			m_blockSize = 0;
+			size_t			m_blockAlignment = 0;
+			size_t			m_blocksPerSlab = 0;
+			size_t			m_threadCacheSize = 0;
+
+			std::mutex		m_mutex;
+			FREE_BLOCK*		m_freeBlocks = nullptr;
+			std::vector<void*>	m_slabs;
+			std::vector<std::unique_ptr<THREAD_CACHE>>	m_threadCaches;
+		};
+	}
+}
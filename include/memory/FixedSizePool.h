@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+#include "Types.h"
+
+namespace Framework
+{
+	namespace Memory
+	{
+		//Hands out blocks of a single size from slabs, freed blocks are kept in a free list and reused
+		//first. Slabs are only returned to the heap when the pool is destroyed. Not thread safe.
+		class CFixedSizePool
+		{
+		public:
+			enum
+			{
+				DEFAULT_BLOCKS_PER_SLAB = 256,
+			};
+
+							CFixedSizePool(size_t, size_t = alignof(std::max_align_t), size_t = DEFAULT_BLOCKS_PER_SLAB);
+							CFixedSizePool(const CFixedSizePool&) = delete;
+							~CFixedSizePool();
+
+			CFixedSizePool&	operator =(const CFixedSizePool&) = delete;
+
+			void*			Allocate();
+			void			Free(void*);
+
+			size_t			GetBlockSize() const;
+			size_t			GetBlockAlignment() const;
+
+		private:
+			struct FREE_BLOCK
+			{
+				FREE_BLOCK*	next;
+			};
+
+			void			AllocateSlab();
+
+			size_t			m_blockSize = 0;
+			size_t			m_blockAlignment = 0;
+			size_t			m_blocksPerSlab = 0;
+			FREE_BLOCK*		m_freeBlocks = nullptr;
+			std::vector<void*>	m_slabs;
+		};
+
+		//Typed wrapper calling constructors and destructors
+		template <typename Type>
+		class CObjectPool
+		{
+		public:
+			explicit CObjectPool(size_t blocksPerSlab = CFixedSizePool::DEFAULT_BLOCKS_PER_SLAB)
+			: m_pool(sizeof(Type), alignof(Type), blocksPerSlab)
+			{
+			}
+
+			template <typename... Args>
+			Type* New(Args&&... args)
+			{
+				void* block = m_pool.Allocate();
+				try
+				{
+					return new(block) Type(std::forward<Args>(args)...);
+				}
+				catch(...)
+				{
+					m_pool.Free(block);
+					throw;
+				}
+			}
+
+			void Delete(Type* object)
+			{
+				if(!object) return;
+				object->~Type();
+				m_pool.Free(object);
+			}
+
+		private:
+			CFixedSizePool	m_pool;
+		};
+	}
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+
+namespace Framework
+{
+	namespace Memory
+	{
+		//Block of committed virtual memory, backed by huge (large) pages when the system allows it.
+		//Falls back on regular pages otherwise (no privilege on Windows, no reserved huge pages on Linux),
+		//asking for transparent huge pages where available. Meant to back an arena that is used a lot.
+		class CHugePageRegion
+		{
+		public:
+			explicit		CHugePageRegion(size_t);
+							CHugePageRegion(const CHugePageRegion&) = delete;
+							~CHugePageRegion();
+
+			CHugePageRegion&	operator =(const CHugePageRegion&) = delete;
+
+			void*			GetData() const;
+			//Can be larger than the requested size, rounded to the page size
+			size_t			GetSize() const;
+			bool			UsesHugePages() const;
+
+		private:
+			void*			m_data = nullptr;
+			size_t			m_size = 0;
+			bool			m_usesHugePages = false;
+		};
+	}
+}
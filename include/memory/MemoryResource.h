@@ -0,0 +1,98 @@
+#pragma once
+
+#if defined(__has_include)
+#if __has_include(<memory_resource>)
+#include <memory_resource>
+#endif
+#endif
+
+//Some standard libraries ship the header without the runtime support
+#if defined(__cpp_lib_memory_resource)
+#define FRAMEWORK_HAS_MEMORY_RESOURCE
+#endif
+
+#if defined(FRAMEWORK_HAS_MEMORY_RESOURCE)
+
+#include "Arena.h"
+#include "ConcurrentFixedSizePool.h"
+
+namespace Framework
+{
+	namespace Memory
+	{
+		//Lets pmr containers allocate from an arena, deallocation does nothing
+		class CArenaResource : public std::pmr::memory_resource
+		{
+		public:
+			explicit CArenaResource(CArena& arena)
+			: m_arena(arena)
+			{
+			}
+
+		protected:
+			void* do_allocate(size_t size, size_t alignment) override
+			{
+				return m_arena.Allocate(size, alignment);
+			}
+
+			void do_deallocate(void*, size_t, size_t) override
+			{
+			}
+
+			bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+			{
+				return this == &other;
+			}
+
+		private:
+			CArena&	m_arena;
+		};
+
+		//Serves allocations that fit in the pool's blocks from it, others go to the upstream resource
+		class CPoolResource : public std::pmr::memory_resource
+		{
+		public:
+			explicit CPoolResource(CConcurrentFixedSizePool& pool, std::pmr::memory_resource* upstream = std::pmr::new_delete_resource())
+			: m_pool(pool)
+			, m_upstream(upstream)
+			{
+			}
+
+		protected:
+			void* do_allocate(size_t size, size_t alignment) override
+			{
+				if(Fits(size, alignment))
+				{
+					return m_pool.Allocate();
+				}
+				return m_upstream->allocate(size, alignment);
+			}
+
+			void do_deallocate(void* ptr, size_t size, size_t alignment) override
+			{
+				if(Fits(size, alignment))
+				{
+					m_pool.Free(ptr);
+					return;
+				}
+				m_upstream->deallocate(ptr, size, alignment);
+			}
+
+			bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+			{
+				return this == &other;
+			}
+
+		private:
+			bool Fits(size_t size, size_t alignment) const
+			{
+				return (size <= m_pool.GetBlockSize()) && (alignment <= m_pool.GetBlockAlignment());
+			}
+
+			CConcurrentFixedSizePool&	m_pool;
+			std::pmr::memory_resource*	m_upstream = nullptr;
+		};
+	}
+}
+
+#endif
@@ -33,6 +33,9 @@ namespace MPEG2
 		bool					IsEndOfBlock(Framework::CBitStream*);
 		void					SkipEndOfBlock(Framework::CBitStream*);
 
+		//Gives access to the raw VLC codes
+		CVLCTable*				GetVlcTable() { return this; }
+
 	protected:
 								CDctCoefficientTable(unsigned int, VLCTABLEENTRY*, unsigned int, unsigned int*);
 
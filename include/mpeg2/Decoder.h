@@ -0,0 +1,170 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "Types.h"
+
+namespace Framework
+{
+	class CBitStream;
+	class CThreadPool;
+}
+
+namespace IDCT
+{
+	class CInterface;
+}
+
+namespace MPEG2
+{
+	class CVLCTable;
+	class CDctCoefficientTable;
+
+	//Decodes MPEG-2 video elementary streams (main profile: 4:2:0 frame pictures with frame motion
+	//compensation) with the VLC tables of this directory. Slices of a picture are decoded in parallel
+	//on the thread pool. Each slice goes through three stages: entropy decoding of all its macroblocks,
+	//IDCT of all their coded blocks in a single batch, then motion compensation and reconstruction.
+	//MPEG-1 streams, field pictures, field or dual prime motion and scalable extensions aren't supported.
+	class CDecoder
+	{
+	public:
+		enum PICTURE_TYPE
+		{
+			PICTURE_TYPE_I = 1,
+			PICTURE_TYPE_P = 2,
+			PICTURE_TYPE_B = 3,
+		};
+
+		struct FRAME
+		{
+			unsigned int	width = 0;
+			unsigned int	height = 0;
+			PICTURE_TYPE	pictureType = PICTURE_TYPE_I;
+			unsigned int	temporalReference = 0;
+			//Y, Cb and Cr, chroma planes are half the luma size in both dimensions
+			const uint8*	planes[3] = {};
+			unsigned int	strides[3] = {};
+		};
+
+		//Frames are given in display order and their planes are only valid during the call
+		typedef std::function<void (const FRAME&)> FrameHandler;
+
+		//Uses IDCT::CFixedPoint if no IDCT is given. Slices are decoded on the calling thread if there's no pool.
+								CDecoder(FrameHandler, Framework::CThreadPool* = nullptr, IDCT::CInterface* = nullptr);
+								CDecoder(const CDecoder&) = delete;
+		virtual					~CDecoder() = default;
+
+		CDecoder&				operator =(const CDecoder&) = delete;
+
+		//Takes chunks of any size. A picture is decoded once the start code following it comes in.
+		//Throws on unsupported streams.
+		void					Decode(const void*, size_t);
+		//Decodes the last picture and outputs the last reference picture, like a sequence end code
+		void					Flush();
+
+		//Slices that had errors, macroblocks following an error are left as they were
+		uint32					GetCorruptSliceCount() const;
+
+	private:
+		struct SEQUENCE
+		{
+			bool			isValid = false;
+			unsigned int	width = 0;
+			unsigned int	height = 0;
+			unsigned int	mbWidth = 0;
+			unsigned int	mbHeight = 0;
+			bool			isProgressive = true;
+			//Raster order
+			uint8			intraMatrix[64];
+			uint8			nonIntraMatrix[64];
+		};
+
+		struct PICTURE
+		{
+			PICTURE_TYPE	type = PICTURE_TYPE_I;
+			unsigned int	temporalReference = 0;
+			bool			hasCodingExtension = false;
+			//[forward/backward][horizontal/vertical]
+			unsigned int	fCodes[2][2] = {};
+			unsigned int	intraDcPrecision = 0;
+			unsigned int	pictureStructure = 0;
+			bool			framePredFrameDct = false;
+			bool			concealmentMotionVectors = false;
+			bool			qScaleType = false;
+			bool			intraVlcFormat = false;
+			bool			alternateScan = false;
+		};
+
+		struct PICTURE_BUFFER
+		{
+			std::vector<uint8>	planes[3];
+			unsigned int	strides[3] = {};
+			PICTURE_TYPE	type = PICTURE_TYPE_I;
+			unsigned int	temporalReference = 0;
+		};
+
+		struct SLICE
+		{
+			//Data following the start code, up to and including the next start code prefix
+			size_t			offset = 0;
+			size_t			size = 0;
+			unsigned int	verticalPosition = 0;
+		};
+
+		struct MACROBLOCK;
+
+		typedef std::shared_ptr<PICTURE_BUFFER> PictureBufferPtr;
+		typedef std::vector<SLICE> SliceArray;
+		typedef std::vector<MACROBLOCK> MacroblockArray;
+		typedef std::vector<int16> CoefficientArray;
+
+		void					ProcessBuffer();
+		void					ProcessUnit(size_t, size_t);
+		void					ParseSequenceHeader(Framework::CBitStream&);
+		void					ParseExtension(Framework::CBitStream&);
+		void					ParsePictureHeader(Framework::CBitStream&);
+		void					FinishPicture();
+		void					EndSequence();
+
+		PictureBufferPtr		AllocatePicture();
+		void					OutputPicture(const PICTURE_BUFFER&);
+
+		void					DecodeSlice(const SLICE&, PICTURE_BUFFER&);
+		void					ParseSlice(const SLICE&, MacroblockArray&, CoefficientArray&);
+		void					ParseMotionVector(Framework::CBitStream&, unsigned int, int32 (&)[2][2][2], int32*);
+		void					ParseBlock(Framework::CBitStream&, unsigned int, bool, unsigned int, int32*, int16*);
+		void					ReconstructMacroblock(const MACROBLOCK&, const int16*, PICTURE_BUFFER&);
+
+		FrameHandler			m_frameHandler;
+		Framework::CThreadPool*	m_threadPool = nullptr;
+		IDCT::CInterface*		m_idct = nullptr;
+
+		CVLCTable*				m_macroblockAddressIncrementTable = nullptr;
+		CVLCTable*				m_macroblockTypeTables[3] = {};
+		CVLCTable*				m_codedBlockPatternTable = nullptr;
+		CVLCTable*				m_motionCodeTable = nullptr;
+		CVLCTable*				m_dcSizeTables[2] = {};
+		CDctCoefficientTable*	m_dctCoefficientTables[2] = {};
+		//Raster position of each coefficient, for zigzag and alternate scans
+		uint8					m_scanOrders[2][64];
+
+		std::vector<uint8>		m_buffer;
+		size_t					m_unitStart = ~size_t(0);
+		size_t					m_searchPosition = 0;
+
+		SEQUENCE				m_sequence;
+		PICTURE					m_picture;
+		bool					m_hasPendingPicture = false;
+		SliceArray				m_slices;
+
+		std::vector<PictureBufferPtr>	m_picturePool;
+		PictureBufferPtr		m_forwardReference;
+		PictureBufferPtr		m_backwardReference;
+		//References used by the picture being decoded, [forward/backward]
+		const PICTURE_BUFFER*	m_predictionReferences[2] = {};
+
+		std::atomic<uint32>		m_corruptSliceCount = {0};
+	};
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "Types.h"
+
+namespace MPEG2
+{
+	//Block operations of MPEG-2 prediction and reconstruction, using SSE2 or NEON when available.
+	//Blocks are 16 or 8 samples wide and any number of lines high (16x16, 16x8 and 8x8 in practice).
+	namespace MotionCompensation
+	{
+		enum HALF_SAMPLE
+		{
+			HALF_SAMPLE_NONE = 0,
+			HALF_SAMPLE_X = 1,
+			HALF_SAMPLE_Y = 2,
+			HALF_SAMPLE_XY = HALF_SAMPLE_X | HALF_SAMPLE_Y,
+		};
+
+		//Copies or interpolates a block, the source needs an extra column or line for half sample positions
+		void Predict(uint8* output, unsigned int outputStride, const uint8* source, unsigned int sourceStride,
+		             unsigned int width, unsigned int height, unsigned int halfSample);
+		//output = (output + input + 1) >> 1, for bidirectional prediction
+		void Average(uint8* output, unsigned int outputStride, const uint8* input, unsigned int inputStride,
+		             unsigned int width, unsigned int height);
+
+		//8x8 blocks of IDCT output: added to a prediction, or stored as is for intra blocks, with saturation
+		void AddResidual(uint8* output, unsigned int outputStride, const uint8* prediction, unsigned int predictionStride, const int16* residual);
+		void StoreSamples(uint8* output, unsigned int outputStride, const int16* samples);
+	}
+}
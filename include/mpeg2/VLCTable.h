@@ -1,5 +1,6 @@
 #pragma once
 
+#include <vector>
 #include "BitStream.h"
 
 namespace MPEG2
@@ -33,6 +34,9 @@ namespace MPEG2
 		DECODE_STATUS	TryGetSymbol(Framework::CBitStream*, uint32&);
 
 		uint32			GetSymbol(Framework::CBitStream*);
+
+		unsigned int	GetEntryCount() const;
+		const VLCTABLEENTRY& GetEntry(unsigned int) const;
 		
 	protected:
 						CVLCTable(unsigned int, VLCTABLEENTRY*, unsigned int, unsigned int*);
@@ -40,10 +44,38 @@ namespace MPEG2
 		void			ThrowError(DECODE_STATUS);
 
 	private:
+		enum
+		{
+			PRIMARY_BITS = 9,
+		};
+
+		enum LOOKUP_TYPE
+		{
+			LOOKUP_TYPE_EMPTY,
+			LOOKUP_TYPE_SYMBOL,
+			LOOKUP_TYPE_SUBTABLE,
+		};
+
+		//For symbols, 'index' is the table entry index. For subtables, 'index' is
+		//the offset of the subtable in the lookup table and 'bits' its index size.
+		struct LOOKUPENTRY
+		{
+			uint16			type;
+			uint16			bits;
+			uint32			index;
+		};
+
+		typedef std::vector<LOOKUPENTRY> LookupTable;
+
+		void			BuildLookupTable();
+		DECODE_STATUS	TryPeekSymbolSlow(Framework::CBitStream*, const VLCTABLEENTRY*&);
+
 		unsigned int	m_maxBits;
 		VLCTABLEENTRY*	m_tableEntry;
 		unsigned int	m_entryCount;
 		unsigned int*	m_indexTable;
+		unsigned int	m_primaryBits = 0;
+		LookupTable		m_lookupTable;
 	};
 
 };
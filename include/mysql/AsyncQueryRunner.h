@@ -0,0 +1,90 @@
+#pragma once
+
+#include "MySqlDefs.h"
+
+#ifdef FRAMEWORK_MYSQL_HAS_NONBLOCKING_API
+
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+#include "AccessInfo.h"
+#include "Client.h"
+
+namespace Framework
+{
+	namespace MySql
+	{
+		//Runs queries on many connections from a single thread with the non-blocking client API.
+		//Queries are queued and started as soon as a connection is free, each connection has one
+		//query in flight at a time. Callbacks are called from Update, where new queries can be
+		//queued. Not thread-safe, all calls need to come from the same thread.
+		class CAsyncQueryRunner
+		{
+		public:
+			//Result is empty for queries that don't return rows
+			typedef std::function<void (CResult&)> CompletionCallback;
+			typedef std::function<void (const std::string&)> ErrorCallback;
+
+							CAsyncQueryRunner(const CAccessInfo&, unsigned int connectionCount);
+			virtual			~CAsyncQueryRunner() = default;
+
+			//Errors are thrown from Update if there is no error callback
+			void			Enqueue(std::string query, CompletionCallback, ErrorCallback = ErrorCallback());
+
+			//Makes progress on queries in flight, waiting up to timeoutMs for the server.
+			//Returns false once all queries are done.
+			bool			Update(int timeoutMs);
+			//Runs until all queries are done
+			void			Run();
+
+			//Queued and in flight queries
+			size_t			GetPendingQueryCount() const;
+
+		private:
+			typedef std::chrono::steady_clock Clock;
+
+			enum class STATE
+			{
+				IDLE,
+				QUERYING,
+				STORING,
+			};
+
+			struct QUERY
+			{
+				std::string				text;
+				CompletionCallback		completionCallback;
+				ErrorCallback			errorCallback;
+			};
+
+			struct CONNECTION
+			{
+				CClient					client;
+				STATE					state = STATE::IDLE;
+				//MYSQL_WAIT_* flags the client library is waiting on
+				int						waitStatus = 0;
+				Clock::time_point		timeoutTime;
+				QUERY					query;
+			};
+
+							CAsyncQueryRunner(const CAsyncQueryRunner&) = delete;
+			CAsyncQueryRunner&	operator =(const CAsyncQueryRunner&) = delete;
+
+			void			StartQueries();
+			void			Continue(CONNECTION&, int readyStatus);
+			void			OnQueryStatus(CONNECTION&, int status, int error);
+			void			OnStoreStatus(CONNECTION&, int status, MYSQL_RES*);
+			void			Wait(CONNECTION&, int status);
+			void			Complete(CONNECTION&, CResult);
+			void			Fail(CONNECTION&);
+
+			std::vector<CONNECTION>		m_connections;
+			std::deque<QUERY>			m_queuedQueries;
+			size_t						m_inFlightCount = 0;
+		};
+	}
+}
+
+#endif
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "MySqlDefs.h"
+#include <exception>
+#include <functional>
+#include <string>
+#include <vector>
+#include "Csv.h"
+#include "Stream.h"
+#include "Types.h"
+
+namespace Framework
+{
+	namespace MySql
+	{
+		class CClient;
+
+		//Loads rows in a table with LOAD DATA LOCAL INFILE. Data is handed to the client library through
+		//a local infile handler as it asks for more, without going through a temporary file. Sources are
+		//only read when the library is ready to send, so reading can't get ahead of the server. Whatever
+		//file name the server asks for, only the given source is sent. The client needs to be connected
+		//with OPTION_LOCAL_INFILE and the server needs local_infile to be enabled.
+		class CBulkLoader
+		{
+		public:
+			//Gets the amount of bytes sent so far, returning false cancels the load
+			typedef std::function<bool (uint64)> ProgressCallback;
+
+			struct OPTIONS
+			{
+				std::string					tableName;
+				//Columns the fields go in, all columns of the table in order if empty
+				std::vector<std::string>	columnNames;
+				//Rows with the same unique key as existing ones replace them, otherwise they are skipped
+				bool						replaceDuplicates = false;
+
+				//Format of stream sources, CSV sources are always sent in the default format (tab separated,
+				//escaped with backslashes). Enclosure of 0 means fields aren't enclosed.
+				char						fieldSeparator = '\t';
+				char						enclosure = 0;
+				char						escape = '\\';
+				char						lineSeparator = '\n';
+				unsigned int				ignoredLineCount = 0;
+			};
+
+			enum
+			{
+				//Amount of data given to the client library at once, whatever the size of its buffer
+				DEFAULT_READ_SIZE = 0x10000,
+			};
+
+							CBulkLoader(CClient&);
+							CBulkLoader(const CBulkLoader&) = delete;
+
+			CBulkLoader&	operator =(const CBulkLoader&) = delete;
+
+			void			SetProgressCallback(ProgressCallback);
+
+			//Sends the rest of the stream as it is, returns the amount of rows inserted or replaced
+			uint64			Load(const OPTIONS&, CStream&);
+			//Sends the remaining rows of the reader, fields are escaped as needed
+			uint64			Load(const OPTIONS&, Csv::CReader&);
+
+		private:
+			//Fills a buffer, returns 0 once there's nothing left
+			typedef std::function<size_t (char*, size_t)> DataSource;
+
+			uint64			Load(const std::string& query, const DataSource&);
+
+			static int		InfileInit(void**, const char*, void*);
+			static int		InfileRead(void*, char*, unsigned int);
+			static void		InfileEnd(void*);
+			static int		InfileError(void*, char*, unsigned int);
+
+			static std::string	MakeQuery(const OPTIONS&, bool isDefaultFormat);
+
+			CClient&			m_client;
+			ProgressCallback	m_progressCallback;
+
+			//State of the load in progress
+			const DataSource*	m_source = nullptr;
+			uint64				m_sentSize = 0;
+			bool				m_isCancelled = false;
+			std::exception_ptr	m_exception;
+		};
+	}
+}
@@ -1,7 +1,10 @@
 #pragma once
 
 #include "MySqlDefs.h"
+#include "AccessInfo.h"
 #include "Result.h"
+#include "Statement.h"
+#include "Types.h"
 
 namespace Framework
 {
@@ -10,9 +13,18 @@ namespace Framework
 		class CClient
 		{
 		public:
+			enum OPTIONS
+			{
+				//Allows the connection to be used with the non-blocking API (MariaDB client library only)
+				OPTION_NONBLOCKING = 0x01,
+				//Allows LOAD DATA LOCAL INFILE to be used, needed by CBulkLoader
+				OPTION_LOCAL_INFILE = 0x02,
+			};
+
 							CClient();
 							CClient(CClient&&);
 							CClient(const char* hostName, const char* userName, const char* password, const char* database);
+							CClient(const CAccessInfo&, uint32 options = 0);
 			virtual			~CClient();
 
 			void			Reset();
@@ -20,12 +32,24 @@ namespace Framework
 			CClient&		operator =(CClient&&);
 
 			CResult			Query(const char*);
+			//Rows are read from the server as they are fetched instead of being buffered on the
+			//client. No other query can run on this client until the result is destroyed.
+			CResult			QueryStreamed(const char*);
+			CStatement		Prepare(const char*);
+
+			//Checks that the server can still be reached
+			bool			Ping();
+			//True if the last call failed because the connection to the server was lost
+			bool			IsConnectionLost() const;
+
+							operator MYSQL*() const;
 
 		private:
 							CClient(const CClient&);
 			CClient&		operator =(const CClient&);
 
 			void			MoveFrom(CClient&&);
+			void			Connect(const char*, const char*, const char*, const char*, uint32);
 
 			MYSQL*			m_connection;
 		};
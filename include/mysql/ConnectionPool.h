@@ -0,0 +1,98 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "AccessInfo.h"
+#include "Client.h"
+
+namespace Framework
+{
+	namespace MySql
+	{
+		class CConnectionPool;
+
+		//Connection borrowed from a CConnectionPool, it goes back to the pool when this is
+		//destroyed or released. Statements prepared on the connection need to be destroyed before.
+		class CConnectionLease
+		{
+		public:
+							CConnectionLease() = default;
+							CConnectionLease(CConnectionPool*, std::unique_ptr<CClient>);
+							CConnectionLease(CConnectionLease&&);
+			virtual			~CConnectionLease();
+
+			CConnectionLease&	operator =(CConnectionLease&&);
+
+			void			Release();
+			bool			IsEmpty() const;
+
+			CClient&		operator *() const;
+			CClient*		operator ->() const;
+
+		private:
+							CConnectionLease(const CConnectionLease&) = delete;
+			CConnectionLease&	operator =(const CConnectionLease&) = delete;
+
+			CConnectionPool*			m_pool = nullptr;
+			std::unique_ptr<CClient>	m_client;
+		};
+
+		//Thread-safe pool of connections to the same database. Connections are opened on demand,
+		//up to a maximum, and reused in most recently used order so that the least used ones
+		//become idle and get closed. Connections that have been idle for a while are pinged
+		//before being handed out, and connections that lost the server are dropped when released.
+		class CConnectionPool
+		{
+		public:
+			enum
+			{
+				DEFAULT_MAX_CONNECTIONS = 8,
+				DEFAULT_IDLE_TIMEOUT_SEC = 300,
+				HEALTH_CHECK_INTERVAL_SEC = 30,
+			};
+
+							CConnectionPool(CAccessInfo, unsigned int maxConnections = DEFAULT_MAX_CONNECTIONS,
+							                std::chrono::seconds idleTimeout = std::chrono::seconds(DEFAULT_IDLE_TIMEOUT_SEC));
+			virtual			~CConnectionPool();
+
+			//Waits for a connection to be available, throws if a new connection can't be opened
+			CConnectionLease	Acquire();
+			void			ReleaseConnection(std::unique_ptr<CClient>);
+
+			//Closes connections that have been idle for longer than the idle timeout. Also done
+			//when connections are released, calling this periodically closes them sooner.
+			void			ReapIdleConnections();
+
+			unsigned int	GetMaxConnections() const;
+			unsigned int	GetConnectionCount();
+			unsigned int	GetIdleConnectionCount();
+
+		private:
+			typedef std::chrono::steady_clock Clock;
+
+			struct IDLE_CONNECTION
+			{
+				std::unique_ptr<CClient>	client;
+				Clock::time_point			releaseTime;
+			};
+
+							CConnectionPool(const CConnectionPool&) = delete;
+			CConnectionPool&	operator =(const CConnectionPool&) = delete;
+
+			void			ReapIdleConnectionsLocked(Clock::time_point);
+
+			CAccessInfo						m_accessInfo;
+			unsigned int					m_maxConnections = DEFAULT_MAX_CONNECTIONS;
+			std::chrono::seconds			m_idleTimeout;
+			std::mutex						m_mutex;
+			std::condition_variable			m_connectionReleasedCondition;
+			//Most recently released connections are at the back
+			std::vector<IDLE_CONNECTION>	m_idleConnections;
+			//Idle, leased and currently opening connections
+			unsigned int					m_connectionCount = 0;
+		};
+	}
+}
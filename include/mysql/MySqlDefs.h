@@ -4,3 +4,8 @@
 #include <Windows.h>
 #endif
 #include <mysql.h>
+
+//Non-blocking API is only provided by the MariaDB client library
+#ifdef MYSQL_WAIT_READ
+#define FRAMEWORK_MYSQL_HAS_NONBLOCKING_API
+#endif
@@ -1,8 +1,10 @@
 #pragma once
 
 #include "MySqlDefs.h"
+#include "Types.h"
 #include <unordered_map>
 #include <string>
+#include <string_view>
 
 namespace Framework
 {
@@ -13,7 +15,8 @@ namespace Framework
 		public:
 			typedef std::unordered_map<std::string, int> FieldIndexMap;
 
-							CResult(MYSQL_RES*);
+							CResult();
+						CResult(MYSQL_RES*);
 							CResult(CResult&&);
 			virtual			~CResult();
 
@@ -22,9 +25,24 @@ namespace Framework
 			CResult&		operator =(CResult&&);
 
 			MYSQL_ROW		FetchRow();
+			//Fetches the next row and makes it the current row for the typed getters,
+			//returns false when there are no rows left
+			bool			NextRow();
+			//For streamed results, only valid once all rows have been fetched
 			unsigned int	GetRowCount();
 			unsigned int	GetFieldCount();
-			FieldIndexMap	GetFieldIndices();
+			//Built on the first call and kept for the lifetime of the result
+			const FieldIndexMap&	GetFieldIndices();
+			//Returns -1 if there is no field with that name
+			int				GetFieldIndex(const char*);
+
+			//Typed getters, only valid after FetchRow or NextRow returned a row.
+			//Null values are returned as 0 or an empty string.
+			bool				IsNull(unsigned int) const;
+			std::string_view	GetString(unsigned int) const;
+			int64				GetInt64(unsigned int) const;
+			uint64				GetUInt64(unsigned int) const;
+			double				GetDouble(unsigned int) const;
 
 		private:
 							CResult(const CResult&);
@@ -33,6 +51,9 @@ namespace Framework
 			void			MoveFrom(CResult&&);
 
 			MYSQL_RES*		m_result;
+			MYSQL_ROW		m_row;
+			unsigned long*	m_rowLengths;
+			FieldIndexMap	m_fieldIndices;
 		};
 	};
 }
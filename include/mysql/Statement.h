@@ -0,0 +1,105 @@
+#pragma once
+
+#include "MySqlDefs.h"
+#include "Types.h"
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+namespace Framework
+{
+	namespace MySql
+	{
+		//Server-side prepared statement using the binary protocol. Parameters and columns are
+		//indexed from 0. Bound values are copied and kept until they are bound again, so the
+		//statement can be executed many times with only some parameters changing.
+		//Rows are streamed from the server unless StoreResult is called after Execute.
+		//Needs to be destroyed before the client it was prepared on.
+		class CStatement
+		{
+		public:
+			typedef std::unordered_map<std::string, int> FieldIndexMap;
+
+							CStatement();
+							CStatement(MYSQL*, const char*);
+							CStatement(CStatement&&);
+			virtual			~CStatement();
+
+			void			Reset();
+			bool			IsEmpty() const;
+			CStatement&		operator =(CStatement&&);
+
+			unsigned int	GetParamCount() const;
+
+			void			BindNull(unsigned int);
+			void			BindInt64(unsigned int, int64);
+			void			BindUInt64(unsigned int, uint64);
+			void			BindDouble(unsigned int, double);
+			void			BindString(unsigned int, std::string_view);
+			void			BindBlob(unsigned int, const void*, size_t);
+
+			void			Execute();
+			//Buffers all rows of the result on the client
+			void			StoreResult();
+			//Returns false when there are no rows left
+			bool			Fetch();
+
+			uint64			GetAffectedRowCount() const;
+			uint64			GetInsertId() const;
+
+			unsigned int			GetFieldCount() const;
+			const FieldIndexMap&	GetFieldIndices() const;
+			//Returns -1 if there is no field with that name
+			int						GetFieldIndex(const char*) const;
+
+			//Typed getters, only valid after Fetch returned true. Numeric getters convert values
+			//of other column types, GetString returns an empty string for numeric columns.
+			//Null values are returned as 0 or an empty string. Strings point to a buffer owned
+			//by the statement, valid until the next fetch.
+			bool				IsNull(unsigned int) const;
+			int64				GetInt64(unsigned int) const;
+			uint64				GetUInt64(unsigned int) const;
+			double				GetDouble(unsigned int) const;
+			std::string_view	GetString(unsigned int) const;
+
+		private:
+			//my_bool in older client libraries, bool in newer ones
+			typedef std::remove_pointer_t<decltype(MYSQL_BIND::is_null)> BindFlag;
+
+			enum
+			{
+				//Longer strings are fetched again once their size is known
+				INITIAL_STRING_BUFFER_SIZE = 256,
+			};
+
+			struct VALUE
+			{
+				int64			integer = 0;
+				double			real = 0;
+				std::string		data;
+				unsigned long	length = 0;
+				BindFlag		isNull = 0;
+				BindFlag		error = 0;
+			};
+
+							CStatement(const CStatement&);
+			CStatement&		operator =(const CStatement&);
+
+			void			MoveFrom(CStatement&&);
+			void			ThrowError() const;
+
+			MYSQL_BIND&		PrepareParam(unsigned int, enum_field_types);
+			void			FetchTruncatedColumns();
+
+			MYSQL_STMT*					m_statement;
+			std::vector<MYSQL_BIND>		m_params;
+			std::vector<VALUE>			m_paramValues;
+			std::vector<MYSQL_BIND>		m_columns;
+			std::vector<VALUE>			m_columnValues;
+			FieldIndexMap				m_fieldIndices;
+			std::string					m_query;
+		};
+	}
+}
@@ -2,6 +2,9 @@
 #define _ODBC_STATEMENT_H_
 
 #include "Connection.h"
+#include <map>
+#include <vector>
+#include "Types.h"
 
 namespace Framework
 {
@@ -10,9 +13,16 @@ namespace Framework
 		class CStatement
 		{
 		public:
+			enum
+			{
+				DEFAULT_ROW_ARRAY_SIZE = 1024,
+				DEFAULT_MAX_STRING_LENGTH = 255,
+			};
+
 										CStatement(CConnection*);
 										~CStatement();
 			void						Execute(const TCHAR*);
+			//Returns 0 if there is no column with that name, names are cached until the next Execute
 			unsigned int				GetColumnIndex(const TCHAR*);
 			void						BindColumn(int, unsigned int*);
 			template <typename T> T		GetData(const TCHAR*);
@@ -23,9 +33,42 @@ namespace Framework
 
 			bool						FetchRow();
 
+			//Block fetch: binds all result columns to buffers holding nRowArraySize rows and
+			//fetches that many rows per driver call. Integers are bound as 64 bits integers,
+			//floating point numbers as doubles and everything else as wide strings truncated to
+			//nMaxStringLength characters. Needs to be called after Execute, FetchRow and the
+			//GetData functions can't be used on the result afterwards.
+			void						BeginBlockFetch(unsigned int nRowArraySize = DEFAULT_ROW_ARRAY_SIZE, unsigned int nMaxStringLength = DEFAULT_MAX_STRING_LENGTH);
+			//Returns the number of rows in the block, 0 when there are no rows left
+			unsigned int				FetchBlock();
+
+			//Block getters, indexed by column (starting at 1, like other getters) and row in block.
+			//Null values are returned as 0 or an empty string, GetBlockWStr returns an empty string for
+			//numeric columns. Strings stay valid until the next FetchBlock.
+			bool						IsBlockNull(unsigned int, unsigned int);
+			int64						GetBlockInt64(unsigned int, unsigned int);
+			double						GetBlockDouble(unsigned int, unsigned int);
+			const wchar_t*				GetBlockWStr(unsigned int, unsigned int);
+
 		private:
+			struct BLOCKCOLUMN
+			{
+				SQLSMALLINT				nCType;
+				SQLLEN					nElementSize;
+				std::vector<uint8>		Buffer;
+				std::vector<SQLLEN>		Indicators;
+			};
+
+			typedef std::map<std::tstring, unsigned int> ColumnIndexMap;
+
 			void						ThrowErrorException();
+			void						EndBlockFetch();
+			const BLOCKCOLUMN&			GetBlockColumn(unsigned int, unsigned int);
+
 			SQLHANDLE					m_StmtHandle;
+			ColumnIndexMap				m_ColumnIndices;
+			std::vector<BLOCKCOLUMN>	m_BlockColumns;
+			SQLULEN						m_nBlockRowCount;
 		};
 	}
 }
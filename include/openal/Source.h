@@ -19,7 +19,10 @@ namespace OpenAl
 		void			Stop();
 		
 		void			QueueBuffer(ALuint);
+		//Only valid when at least one buffer was processed
+		ALuint			UnqueueBuffer();
 		int				GetBuffersProcessed() const;
+		int				GetBuffersQueued() const;
 
 	private:
 		ALuint			m_name;
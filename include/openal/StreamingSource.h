@@ -0,0 +1,66 @@
+#ifndef _OPENAL_STREAMINGSOURCE_H_
+#define _OPENAL_STREAMINGSOURCE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "OpenAlDef.h"
+#include "Buffer.h"
+#include "Source.h"
+#include "LockFreeQueue.h"
+
+namespace OpenAl
+{
+	//Streams 16-bit PCM frames written by a producer thread through a fixed set of buffers queued on a
+	//source. Update needs to be called regularly on the thread owning the context, it unqueues processed
+	//buffers, refills them with the frames available and queues them back. Latency is the total size of
+	//the buffers: playback only starts (or restarts after an underrun) once they're all queued.
+	class CStreamingSource
+	{
+	public:
+						//Format needs to be AL_FORMAT_MONO16 or AL_FORMAT_STEREO16
+						CStreamingSource(ALenum format, ALsizei sampleRate, unsigned int bufferCount, unsigned int framesPerBuffer, unsigned int queueFrameCount);
+						CStreamingSource(const CStreamingSource&) = delete;
+		virtual			~CStreamingSource();
+
+		CStreamingSource&	operator =(const CStreamingSource&) = delete;
+
+		CSource&		GetSource();
+
+		//Producer thread only. Returns the number of frames written, frames that don't fit in the queue are dropped.
+		unsigned int	Write(const int16_t*, unsigned int frameCount);
+
+		//Thread owning the context only
+		void			Update();
+
+		//Latency in seconds
+		float			GetLatency() const;
+		unsigned int	GetUnderrunCount() const;
+		unsigned int	GetDroppedFrameCount() const;
+
+	private:
+		typedef std::unique_ptr<CBuffer> BufferPtr;
+
+		unsigned int	ReadFrames();
+
+		ALenum			m_format = AL_FORMAT_STEREO16;
+		ALsizei			m_sampleRate = 0;
+		unsigned int	m_channelCount = 0;
+		unsigned int	m_framesPerBuffer = 0;
+
+		std::vector<BufferPtr>	m_buffers;
+		std::vector<ALuint>		m_freeBuffers;
+		std::vector<int16_t>	m_bufferData;
+		CSource			m_source;
+		bool			m_playing = false;
+
+		//One frame per item, samples of all channels packed together
+		CLockFreeQueue<uint32_t>	m_frames;
+
+		std::atomic<unsigned int>	m_underrunCount = {0};
+		std::atomic<unsigned int>	m_droppedFrameCount = {0};
+	};
+};
+
+#endif
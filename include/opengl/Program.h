@@ -1,7 +1,11 @@
 #pragma once
 
 #include "OpenGlDef.h"
+#include <map>
 #include <memory>
+#include <string>
+#include <vector>
+#include "Types.h"
 
 namespace Framework
 {
@@ -19,14 +23,35 @@ namespace Framework
 			
 			void			AttachShader(GLuint);
 			void			DetachShader(GLuint);
+			//Also resolves the locations of all active uniforms
 			bool			Link();
 			bool			Validate();
+
+			//Binaries can only be loaded by the same driver, loading fails if it changed since
+			bool			LoadBinary(GLenum, const void*, GLsizei);
+			//Program needs to be linked, returns an empty binary if the driver can't provide one
+			std::vector<uint8>	GetBinary(GLenum&) const;
+
+			//Locations are cached, the GL is only queried for names that weren't known at link time
+			GLint			GetUniformLocation(const char*);
+			void			SetUniformBlockBinding(const char*, GLuint);
+
 			void			SetUniformf(const char*, float, float);
 			void			SetUniformi(const char*, int);
 			void			SetUniformi(const char*, int, int);
 
+			//Faster versions for uniforms set often, locations come from GetUniformLocation
+			void			SetUniformf(GLint, float, float);
+			void			SetUniformi(GLint, int);
+			void			SetUniformi(GLint, int, int);
+
 		private:
+			typedef std::map<std::string, GLint, std::less<>> UniformLocationMap;
+
+			void			CacheUniformLocations();
+
 			GLuint			m_nHandle;
+			UniformLocationMap	m_uniformLocations;
 		};
 
 		typedef std::shared_ptr<CProgram> ProgramPtr;
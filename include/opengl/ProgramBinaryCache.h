@@ -0,0 +1,95 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "OpenGlDef.h"
+#include "Program.h"
+#include "Types.h"
+#include "filesystem_def.h"
+
+namespace Framework
+{
+	namespace OpenGl
+	{
+		//Keeps linked programs as driver binaries in a directory, so that programs are only compiled
+		//the first time they're used with a given driver. Binaries are keyed by a hash of the shader
+		//sources and of the vendor, renderer and version strings of the driver, a binary the driver
+		//refuses is compiled again and replaced.
+		//Programs can also be compiled ahead of time on a background thread with its own context
+		//sharing objects with the main one. The background thread only produces binaries, programs
+		//are always created on the thread calling GetProgram.
+		class CProgramBinaryCache
+		{
+		public:
+			typedef std::vector<std::pair<GLenum, std::string>> ShaderSourceArray;
+			typedef std::function<void ()> ContextFunction;
+
+			//Needs a current context, driver strings are read from it
+			explicit		CProgramBinaryCache(fs::path);
+							CProgramBinaryCache(const CProgramBinaryCache&) = delete;
+							~CProgramBinaryCache();
+
+			CProgramBinaryCache&	operator =(const CProgramBinaryCache&) = delete;
+
+			//Compiles on the calling thread if the binary isn't cached or was refused by the driver
+			ProgramPtr		GetProgram(const ShaderSourceArray&);
+
+			//makeCurrent is called on the background thread before anything is compiled, it needs to
+			//make a context sharing objects with the main one current. releaseContext is called
+			//before the thread ends.
+			void			StartBackgroundCompiler(ContextFunction makeCurrent, ContextFunction releaseContext);
+			void			PrecompileAsync(ShaderSourceArray);
+			//True once the binary of the program is available, GetProgram won't compile it anymore
+			bool			IsReady(const ShaderSourceArray&);
+
+		private:
+			struct PROGRAM_BINARY
+			{
+				GLenum				format = GL_NONE;
+				std::vector<uint8>	data;
+			};
+
+			struct FILE_HEADER
+			{
+				uint32		magic;
+				uint32		format;
+				uint64		dataSize;
+			};
+
+			enum : uint32
+			{
+				FILE_HEADER_MAGIC = 0x42504C47, //'GLPB'
+			};
+
+			typedef std::map<std::string, PROGRAM_BINARY> BinaryMap;
+
+			std::string		MakeKey(const ShaderSourceArray&) const;
+			fs::path		GetBinaryPath(const std::string&) const;
+			bool			LoadBinaryFile(const std::string&, PROGRAM_BINARY&) const;
+			void			SaveBinaryFile(const std::string&, const PROGRAM_BINARY&) const;
+			ProgramPtr		CompileProgram(const ShaderSourceArray&) const;
+			void			CacheBinary(const std::string&, PROGRAM_BINARY);
+			void			BackgroundCompilerProc(ContextFunction, ContextFunction);
+
+			fs::path		m_directory;
+			std::string		m_driverString;
+			bool			m_binariesSupported = false;
+
+			std::mutex		m_binariesMutex;
+			BinaryMap		m_binaries;
+
+			std::thread		m_backgroundThread;
+			std::mutex		m_queueMutex;
+			std::condition_variable	m_queueCondition;
+			std::deque<ShaderSourceArray>	m_queue;
+			bool			m_stopBackgroundThread = false;
+		};
+	}
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "Types.h"
+#include "OpenGlDef.h"
+#include "Resource.h"
+
+namespace Framework
+{
+	namespace OpenGl
+	{
+		//Buffer for vertex, index or uniform data rewritten every frame. When glBufferStorage is available,
+		//the buffer is split in FRAME_COUNT regions that stay mapped (persistent and coherent), each frame
+		//writes in its own region and a fence makes sure the GPU is done with a region before it's reused.
+		//Otherwise (GLES, macOS), data is written with unsynchronized mappings and the buffer is orphaned
+		//when full, letting the driver hand out fresh storage. Writes never wait on the GPU in the usual case.
+		class CStreamingBuffer
+		{
+		public:
+			enum
+			{
+				FRAME_COUNT = 3,
+			};
+
+							CStreamingBuffer(GLenum target, GLsizeiptr frameSize, GLintptr alignment = 4);
+							CStreamingBuffer(const CStreamingBuffer&) = delete;
+							~CStreamingBuffer();
+
+			CStreamingBuffer&	operator =(const CStreamingBuffer&) = delete;
+							operator GLuint() const;
+
+			bool			IsPersistent() const;
+
+			//Returns memory to write the data to and its offset in the buffer, needs to be followed by Unmap
+			//before anything else is done with the buffer. Can leave the buffer bound to its target.
+			void*			Map(GLsizeiptr, GLintptr&);
+			void			Unmap();
+			//Copies the data in the buffer and returns its offset
+			GLintptr		Push(const void*, GLsizeiptr);
+
+			//Moves to the next region, waiting for the GPU to be done with it if needed
+			void			EndFrame();
+
+		private:
+			void			WaitFence(GLsync);
+
+			CBuffer			m_buffer;
+			GLenum			m_target = GL_ARRAY_BUFFER;
+			GLsizeiptr		m_frameSize = 0;
+			GLintptr		m_alignment = 4;
+			GLintptr		m_head = 0;
+			bool			m_mapped = false;
+
+			//Persistent mapping state
+			bool			m_persistent = false;
+			uint8*			m_persistentData = nullptr;
+			unsigned int	m_frameIndex = 0;
+			GLsync			m_fences[FRAME_COUNT] = {};
+		};
+	}
+}
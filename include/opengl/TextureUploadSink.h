@@ -0,0 +1,40 @@
+#pragma once
+
+#include "bitmap/BitmapSink.h"
+#include "OpenGlDef.h"
+#include "Resource.h"
+
+namespace Framework
+{
+	namespace OpenGl
+	{
+		//Lets a decoder write an image straight into a mapped pixel unpack buffer, level 0 of the texture is
+		//then defined from it once decoding is done. Buffer is kept and reused for the next images.
+		//8, 24 and 32 bits per pixel images become R8, RGB8 and RGBA8 textures.
+		class CTextureUploadSink : public CBitmapSink
+		{
+		public:
+							CTextureUploadSink();
+							CTextureUploadSink(const CTextureUploadSink&) = delete;
+			virtual			~CTextureUploadSink();
+
+			CTextureUploadSink&	operator =(const CTextureUploadSink&) = delete;
+
+			//Texture the next decoded image goes to, needs to be GL_TEXTURE_2D
+			void			SetTexture(GLuint);
+
+			CBitmapView		BeginImage(unsigned int, unsigned int, unsigned int) override;
+			void			EndImage() override;
+
+		private:
+			CBuffer			m_buffer;
+			GLsizeiptr		m_bufferSize = 0;
+			bool			m_mapped = false;
+
+			GLuint			m_texture = 0;
+			unsigned int	m_width = 0;
+			unsigned int	m_height = 0;
+			unsigned int	m_bpp = 0;
+		};
+	}
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <deque>
+#include "OpenGlDef.h"
+#include "Resource.h"
+
+namespace Framework
+{
+	namespace OpenGl
+	{
+		//Streams uniform block data through a single buffer used as a ring. Each push is written with
+		//an unsynchronized mapping, regions used by the GPU are protected by a fence inserted at the end
+		//of each frame and only waited on when the ring wraps around onto them. Lets many small uniform
+		//updates share one buffer instead of calling glBufferSubData on a buffer per draw.
+		class CUniformBufferRing
+		{
+		public:
+			explicit		CUniformBufferRing(GLsizeiptr);
+							CUniformBufferRing(const CUniformBufferRing&) = delete;
+							~CUniformBufferRing();
+
+			CUniformBufferRing&	operator =(const CUniformBufferRing&) = delete;
+							operator GLuint() const;
+
+			//Copies the data in the ring and returns its offset, leaves the ring bound to GL_UNIFORM_BUFFER
+			GLintptr		Push(const void*, GLsizeiptr);
+			//Binds a region returned by Push to a uniform block binding point
+			void			BindRange(GLuint, GLintptr, GLsizeiptr);
+
+			//Protects everything pushed so far until the GPU is done with the commands issued before this
+			void			EndFrame();
+
+		private:
+			struct FENCE
+			{
+				GLsync		sync = nullptr;
+				GLintptr	ringEnd = 0;
+				GLsizeiptr	ringUsed = 0;
+			};
+
+			bool			TryAllocate(GLsizeiptr, GLintptr&);
+			void			WaitOldestFence();
+
+			CBuffer			m_buffer;
+			GLsizeiptr		m_size = 0;
+			GLintptr		m_alignment = 256;
+
+			GLintptr		m_head = 0;
+			GLintptr		m_tail = 0;
+			GLsizeiptr		m_used = 0;
+			//Bytes pushed since the last fence
+			GLsizeiptr		m_frameUsed = 0;
+			std::deque<FENCE>	m_fences;
+		};
+	}
+}
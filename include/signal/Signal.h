@@ -1,11 +1,17 @@
 #pragma once
 
 #include "nodiscard.h"
+#include "Delegate.h"
+#include "Task.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <mutex>
 #include <memory>
+#include <optional>
+#include <tuple>
+#include <type_traits>
 #include <vector>
 #include <functional>
 
@@ -15,24 +21,84 @@ namespace Framework
 	template<typename T, typename... Args>
 	class CSignal<T (Args...)>
 	{
+	private:
+		struct SLOT;
+
 	public:
 		class CConnection;
 
 		typedef std::shared_ptr<CConnection> Connection;
 		typedef std::weak_ptr<CConnection> WeakConnection;
 		typedef std::function<T (Args...)> SlotFunction;
+		//Cheaper to call than SlotFunction, meant for slots of signals emitted often
+		typedef CDelegate<T (Args...)> SlotDelegate;
+
+		CSignal()
+		: m_slots(new SLOTLIST())
+		{
+		}
 
-		CSignal() = default;
+		CSignal(const CSignal&) = delete;
+
+		~CSignal()
+		{
+			delete m_slots.load();
+			for(const auto& retired : m_retiredSlots)
+			{
+				delete retired.slots;
+			}
+		}
+
+		CSignal& operator =(const CSignal&) = delete;
 
 		FRAMEWORK_NODISCARD
 		Connection Connect(const SlotFunction& func, bool oneShot = false)
 		{
 			assert(func);
 
-			std::unique_lock<std::mutex> lock(m_lock);
+			auto slot = std::make_shared<SLOT>(func, oneShot);
+			Update([&slot](SLOTLIST& slots) { slots.connections.push_back(slot); });
+
+			return std::make_shared<CConnection>(slot);
+		}
+
+		FRAMEWORK_NODISCARD
+		Connection Connect(const SlotDelegate& delegate, bool oneShot = false)
+		{
+			assert(delegate);
+
+			auto slot = std::make_shared<SLOT>(delegate, oneShot);
+			Update([&slot](SLOTLIST& slots) { slots.connections.push_back(slot); });
+
+			return std::make_shared<CConnection>(slot);
+		}
+
+		//The slot is run by the executor (ie.: a thread pool or an UI thread's queue) with copies of the arguments
+		//instead of being called by the emitting thread. With coalescing, emissions happening before the slot
+		//could run are merged and it is called once with the latest arguments.
+		FRAMEWORK_NODISCARD
+		Connection ConnectQueued(const SlotFunction& func, const TaskExecutor& executor, bool coalesce = false)
+		{
+			static_assert(std::is_void<T>::value, "Queued slots can't return a value.");
+			assert(func && executor);
 
-			auto connection = std::make_shared<CConnection>(func, oneShot);
-			m_connections.push_back(connection);
+			auto queuedSlot = std::make_shared<QUEUEDSLOT>(func, executor);
+			auto slot = std::make_shared<SLOT>(
+				[queuedSlot, coalesce](Args... args)
+				{
+					if(coalesce)
+					{
+						QUEUEDSLOT::PostCoalesced(queuedSlot, args...);
+					}
+					else
+					{
+						QUEUEDSLOT::Post(queuedSlot, args...);
+					}
+				},
+				false);
+			auto connection = std::make_shared<CConnection>(slot);
+			queuedSlot->connection = connection;
+			Update([&slot](SLOTLIST& slots) { slots.connections.push_back(slot); });
 
 			return connection;
 		}
@@ -43,84 +109,286 @@ namespace Framework
 			return Connect(func, true);
 		}
 
+		FRAMEWORK_NODISCARD
+		Connection ConnectOnce(const SlotDelegate& delegate)
+		{
+			return Connect(delegate, true);
+		}
+
 		FRAMEWORK_NODISCARD
 		Connection ConnectOverride(const SlotFunction& func, bool oneShot = false)
 		{
 			assert(func);
-			std::unique_lock<std::mutex> lock(m_lock);
 
-			auto connection = std::make_shared<CConnection>(func, oneShot);
-			m_overrideConnection = connection;
+			auto slot = std::make_shared<SLOT>(func, oneShot);
+			Update([&slot](SLOTLIST& slots) { slots.overrideSlot = slot; });
 
-			return connection;
+			return std::make_shared<CConnection>(slot);
 		}
 
 		void Reset()
 		{
-			std::unique_lock<std::mutex> lock(m_lock);
-
-			m_connections.clear();
+			Update([](SLOTLIST& slots) { slots.connections.clear(); });
 		}
 
+		//Doesn't take any lock: slots are called from an immutable snapshot of the slot list.
+		//Slots disconnected meanwhile might still be called once by emissions already in progress.
 		void operator()(Args... args)
 		{
-			std::unique_lock<std::mutex> lock(m_lock);
-
-			auto processConnection = [&](const WeakConnection& connection)
+			bool hasExpiredSlots = false;
 			{
-				auto connectionPtr = connection.lock();
-				if(connectionPtr)
+				CReadSection readSection(*this);
+				auto slots = m_slots.load(std::memory_order_seq_cst);
+				const auto& overrideSlot = slots->overrideSlot;
+				if(overrideSlot && overrideSlot->active.load(std::memory_order_acquire))
 				{
-					(*connectionPtr)(args...);
+					hasExpiredSlots = !CallSlot(*overrideSlot, args...);
 				}
-				return !connectionPtr || (*connectionPtr).IsOneShot();
-			};
-
-			if(!m_overrideConnection.expired())
-			{
-				if(processConnection(m_overrideConnection))
+				else
 				{
-					m_overrideConnection.reset();
+					hasExpiredSlots = (overrideSlot != nullptr);
+					for(const auto& slot : slots->connections)
+					{
+						hasExpiredSlots |= !CallSlot(*slot, args...);
+					}
 				}
-				return;
 			}
 
-			m_connections.erase(
-				std::remove_if(
-					m_connections.begin(),
-					m_connections.end(),
-					processConnection
-				),
-				m_connections.end()
-			);
+			if(hasExpiredSlots)
+			{
+				//Leave it to the next emission if someone else is updating the list
+				Update([](SLOTLIST& slots) { RemoveExpiredSlots(slots); }, std::try_to_lock);
+			}
 		}
 
 		class CConnection
 		{
 			public:
-				CConnection(const SlotFunction slot, bool oneShot)
-				: m_slot(slot)
-				, m_oneShot(oneShot)
+				CConnection(std::shared_ptr<SLOT> slot)
+				: m_slot(std::move(slot))
+				{
+				}
+
+				~CConnection()
 				{
+					m_slot->active.store(false, std::memory_order_release);
 				}
 
 				void operator()(Args... args)
 				{
-					(m_slot)(args...);
+					(m_slot->delegate)(args...);
 				}
-			
+
 				bool IsOneShot() const
 				{
-					return m_oneShot;
+					return m_slot->oneShot;
 				}
 
 			private:
-				SlotFunction m_slot;
-				bool m_oneShot;
+				std::shared_ptr<SLOT> m_slot;
 		};
 	private:
-		std::vector<WeakConnection> m_connections;
-		WeakConnection m_overrideConnection;
-		std::mutex m_lock;
+		struct SLOT
+		{
+			SLOT(const SlotFunction& function, bool oneShot)
+			: function(function)
+			, delegate([function = &this->function](Args... args) -> T { return (*function)(args...); })
+			, oneShot(oneShot)
+			{
+			}
+
+			SLOT(const SlotDelegate& delegate, bool oneShot)
+			: delegate(delegate)
+			, oneShot(oneShot)
+			{
+			}
+
+			//Empty if the slot was connected with a delegate
+			SlotFunction		function;
+			//Called on emission, goes through the function if there's one
+			SlotDelegate		delegate;
+			bool				oneShot = false;
+			std::atomic<bool>	active = {true};
+		};
+
+		//Posted calls are dropped if the connection is gone by the time they run
+		struct QUEUEDSLOT
+		{
+			typedef std::tuple<std::decay_t<Args>...> ArgumentTuple;
+
+			QUEUEDSLOT(const SlotFunction& function, const TaskExecutor& executor)
+			: function(function)
+			, executor(executor)
+			{
+			}
+
+			static void Post(const std::shared_ptr<QUEUEDSLOT>& queuedSlot, Args... args)
+			{
+				queuedSlot->executor(
+					[queuedSlot, arguments = ArgumentTuple(args...)]() mutable
+					{
+						queuedSlot->Run(std::move(arguments));
+					});
+			}
+
+			static void PostCoalesced(const std::shared_ptr<QUEUEDSLOT>& queuedSlot, Args... args)
+			{
+				{
+					std::unique_lock<std::mutex> lock(queuedSlot->pendingArgumentsLock);
+					bool isPosted = queuedSlot->pendingArguments.has_value();
+					queuedSlot->pendingArguments.emplace(args...);
+					if(isPosted) return;
+				}
+				queuedSlot->executor(
+					[queuedSlot]()
+					{
+						std::unique_lock<std::mutex> lock(queuedSlot->pendingArgumentsLock);
+						auto arguments = std::move(*queuedSlot->pendingArguments);
+						queuedSlot->pendingArguments.reset();
+						lock.unlock();
+						queuedSlot->Run(std::move(arguments));
+					});
+			}
+
+			void Run(ArgumentTuple&& arguments)
+			{
+				if(connection.expired()) return;
+				std::apply(function, std::move(arguments));
+			}
+
+			SlotFunction					function;
+			TaskExecutor					executor;
+			WeakConnection					connection;
+			std::mutex						pendingArgumentsLock;
+			std::optional<ArgumentTuple>	pendingArguments;
+		};
+
+		struct SLOTLIST
+		{
+			std::vector<std::shared_ptr<SLOT>>	connections;
+			std::shared_ptr<SLOT>				overrideSlot;
+		};
+
+		struct RETIRED_SLOTLIST
+		{
+			const SLOTLIST*		slots = nullptr;
+			unsigned int		epoch = 0;
+		};
+
+		//Registers an emission in the current epoch. A replaced slot list is deleted once the
+		//epoch has moved twice, at that point every emission that could have seen it is over.
+		class CReadSection
+		{
+		public:
+			CReadSection(CSignal& signal)
+			: m_readerCounts(signal.m_readerCounts)
+			{
+				auto& epoch = signal.m_epoch;
+				while(1)
+				{
+					m_epoch = epoch.load(std::memory_order_seq_cst);
+					m_readerCounts[m_epoch & 1].fetch_add(1, std::memory_order_seq_cst);
+					if(epoch.load(std::memory_order_seq_cst) == m_epoch) break;
+					m_readerCounts[m_epoch & 1].fetch_sub(1, std::memory_order_release);
+				}
+			}
+
+			CReadSection(const CReadSection&) = delete;
+
+			~CReadSection()
+			{
+				m_readerCounts[m_epoch & 1].fetch_sub(1, std::memory_order_release);
+			}
+
+			CReadSection& operator =(const CReadSection&) = delete;
+
+		private:
+			std::atomic<unsigned int>*	m_readerCounts = nullptr;
+			unsigned int				m_epoch = 0;
+		};
+
+		//Returns false if the slot can't be called anymore
+		static bool CallSlot(SLOT& slot, Args... args)
+		{
+			if(slot.oneShot)
+			{
+				if(slot.active.exchange(false, std::memory_order_acq_rel))
+				{
+					slot.delegate(args...);
+				}
+				return false;
+			}
+			if(!slot.active.load(std::memory_order_acquire))
+			{
+				return false;
+			}
+			slot.delegate(args...);
+			return true;
+		}
+
+		static void RemoveExpiredSlots(SLOTLIST& slots)
+		{
+			auto isExpired = [](const std::shared_ptr<SLOT>& slot) { return !slot->active.load(std::memory_order_acquire); };
+			slots.connections.erase(
+				std::remove_if(slots.connections.begin(), slots.connections.end(), isExpired),
+				slots.connections.end()
+			);
+			if(slots.overrideSlot && isExpired(slots.overrideSlot))
+			{
+				slots.overrideSlot.reset();
+			}
+		}
+
+		//Replaces the slot list by an updated copy. Lists that aren't used anymore are deleted
+		//outside of the lock since slot functions might emit or connect when destroyed.
+		template <typename UpdateFunction, typename... LockArgs>
+		void Update(const UpdateFunction& updateFunction, LockArgs... lockArgs)
+		{
+			std::vector<std::unique_ptr<const SLOTLIST>> reclaimedSlots;
+			{
+				std::unique_lock<std::mutex> lock(m_lock, lockArgs...);
+				if(!lock.owns_lock()) return;
+
+				auto slots = m_slots.load(std::memory_order_relaxed);
+				auto newSlots = new SLOTLIST(*slots);
+				updateFunction(*newSlots);
+				m_slots.store(newSlots, std::memory_order_seq_cst);
+
+				RETIRED_SLOTLIST retired;
+				retired.slots = slots;
+				retired.epoch = m_epoch.load(std::memory_order_relaxed);
+				m_retiredSlots.push_back(retired);
+
+				ReclaimSlots(reclaimedSlots);
+			}
+		}
+
+		void ReclaimSlots(std::vector<std::unique_ptr<const SLOTLIST>>& reclaimedSlots)
+		{
+			//Moving to the next epoch requires all emissions from the previous one to be done
+			for(unsigned int i = 0; i < 2; i++)
+			{
+				auto epoch = m_epoch.load(std::memory_order_relaxed);
+				if(m_readerCounts[(epoch + 1) & 1].load(std::memory_order_seq_cst) != 0) break;
+				m_epoch.store(epoch + 1, std::memory_order_seq_cst);
+			}
+
+			auto epoch = m_epoch.load(std::memory_order_relaxed);
+			auto retiredEnd = std::remove_if(m_retiredSlots.begin(), m_retiredSlots.end(),
+				[&](const RETIRED_SLOTLIST& retired)
+				{
+					if((epoch - retired.epoch) < 2) return false;
+					reclaimedSlots.emplace_back(retired.slots);
+					return true;
+				}
+			);
+			m_retiredSlots.erase(retiredEnd, m_retiredSlots.end());
+		}
+
+		std::atomic<const SLOTLIST*>	m_slots;
+		std::atomic<unsigned int>		m_epoch = {0};
+		std::atomic<unsigned int>		m_readerCounts[2] = {};
+		std::vector<RETIRED_SLOTLIST>	m_retiredSlots;
+		std::mutex						m_lock;
 	};
 }
@@ -6,6 +6,8 @@ namespace Framework
 {
 	namespace Sqlite
 	{
+		//Databases stored uncompressed in the APK are memory mapped, running "PRAGMA mmap_size"
+		//with a size covering the database lets SQLite read pages directly from the mapping
 		void registerAndroidAssetsVfs();
 	}
 };
@@ -0,0 +1,305 @@
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+#include "SqliteStatement.h"
+
+namespace Framework
+{
+	//Inserts rows in batches, packing many rows in each INSERT statement. A batch is committed once
+	//it holds at least batchSize rows, unless the writer runs in a transaction opened by the caller.
+	//Flush needs to be called to write the last rows, rows that weren't committed are rolled back
+	//when the writer is destroyed.
+	class CSqliteBulkWriter
+	{
+	public:
+		enum
+		{
+			DEFAULT_BATCH_SIZE = 4096,
+			DEFAULT_ROWS_PER_STATEMENT = 64,
+		};
+
+		CSqliteBulkWriter(sqlite3* db, const char* tableName, std::vector<std::string> columnNames,
+		                  size_t batchSize = DEFAULT_BATCH_SIZE, size_t rowsPerStatement = DEFAULT_ROWS_PER_STATEMENT)
+		    : m_db(db)
+		    , m_tableName(tableName)
+		    , m_columnNames(std::move(columnNames))
+		    , m_batchSize(std::max<size_t>(batchSize, 1))
+		{
+			if(m_columnNames.empty())
+			{
+				throw std::runtime_error("Bulk writer needs at least one column.");
+			}
+			//Keep within the number of parameters a statement can have
+			size_t maxParamCount = sqlite3_limit(m_db, SQLITE_LIMIT_VARIABLE_NUMBER, -1);
+			m_rowsPerStatement = std::max<size_t>(std::min(rowsPerStatement, maxParamCount / m_columnNames.size()), 1);
+			m_statement = CSqliteStatement(m_db, MakeQuery(m_rowsPerStatement).c_str());
+			m_beginStatement = CSqliteStatement(m_db, "BEGIN IMMEDIATE");
+			m_commitStatement = CSqliteStatement(m_db, "COMMIT");
+			m_values.reserve(m_rowsPerStatement * m_columnNames.size());
+		}
+
+		//Non-copyable
+		CSqliteBulkWriter(const CSqliteBulkWriter&) = delete;
+		CSqliteBulkWriter& operator =(const CSqliteBulkWriter&) = delete;
+
+		virtual ~CSqliteBulkWriter()
+		{
+			if(m_inTransaction)
+			{
+				sqlite3_exec(m_db, "ROLLBACK", nullptr, nullptr, nullptr);
+			}
+		}
+
+		void AddNull()
+		{
+			AddValue(VALUE_TYPE::NULLVALUE);
+		}
+
+		void AddInteger(int64 value)
+		{
+			AddValue(VALUE_TYPE::INTEGER).integer = value;
+		}
+
+		void AddDouble(double value)
+		{
+			AddValue(VALUE_TYPE::DOUBLE).real = value;
+		}
+
+		//Text and blobs are copied, the source doesn't need to outlive the call
+		void AddText(std::string_view value)
+		{
+			AddValue(VALUE_TYPE::TEXT).data.assign(value.begin(), value.end());
+		}
+
+		void AddBlob(const void* data, size_t size)
+		{
+			auto bytes = reinterpret_cast<const char*>(data);
+			AddValue(VALUE_TYPE::BLOB).data.assign(bytes, bytes + size);
+		}
+
+		void EndRow()
+		{
+			if(m_rowValueCount != m_columnNames.size())
+			{
+				throw std::runtime_error("Row value count doesn't match the column count.");
+			}
+			m_rowValueCount = 0;
+			m_pendingRowCount++;
+			if(m_pendingRowCount == m_rowsPerStatement)
+			{
+				WritePendingRows(m_statement);
+			}
+		}
+
+		//Adds all values of a row and ends it, values can be integers, floating point numbers,
+		//strings or nullptr
+		template <typename... Types>
+		void AddRow(const Types&... values)
+		{
+			(AddValue(values), ...);
+			EndRow();
+		}
+
+		//Writes the remaining rows and commits
+		void Flush()
+		{
+			if(m_rowValueCount != 0)
+			{
+				throw std::runtime_error("Flushing in the middle of a row.");
+			}
+			if(m_pendingRowCount != 0)
+			{
+				CSqliteStatement statement(m_db, MakeQuery(m_pendingRowCount).c_str());
+				WritePendingRows(statement);
+			}
+			Commit();
+		}
+
+		//Number of rows written to the database so far
+		size_t GetWrittenRowCount() const
+		{
+			return m_writtenRowCount;
+		}
+
+		size_t GetRowsPerStatement() const
+		{
+			return m_rowsPerStatement;
+		}
+
+	private:
+		enum class VALUE_TYPE
+		{
+			NULLVALUE,
+			INTEGER,
+			DOUBLE,
+			TEXT,
+			BLOB,
+		};
+
+		struct VALUE
+		{
+			VALUE_TYPE type = VALUE_TYPE::NULLVALUE;
+			int64 integer = 0;
+			double real = 0;
+			std::string data;
+		};
+
+		std::string MakeQuery(size_t rowCount) const
+		{
+			std::string row = "(";
+			for(size_t i = 0; i < m_columnNames.size(); i++)
+			{
+				row += (i == 0) ? "?" : ", ?";
+			}
+			row += ")";
+
+			std::string query = "INSERT INTO " + m_tableName + " (";
+			for(size_t i = 0; i < m_columnNames.size(); i++)
+			{
+				if(i != 0) query += ", ";
+				query += m_columnNames[i];
+			}
+			query += ") VALUES ";
+			query.reserve(query.size() + rowCount * (row.size() + 2));
+			for(size_t i = 0; i < rowCount; i++)
+			{
+				if(i != 0) query += ", ";
+				query += row;
+			}
+			return query;
+		}
+
+		VALUE& AddValue(VALUE_TYPE type)
+		{
+			if(m_rowValueCount == m_columnNames.size())
+			{
+				throw std::runtime_error("Too many values in row.");
+			}
+			//Values are reused from one statement to the next to keep the text buffers
+			size_t index = (m_pendingRowCount * m_columnNames.size()) + m_rowValueCount;
+			if(index == m_values.size())
+			{
+				m_values.emplace_back();
+			}
+			m_rowValueCount++;
+			auto& value = m_values[index];
+			value.type = type;
+			return value;
+		}
+
+		void AddValue(std::nullptr_t)
+		{
+			AddNull();
+		}
+
+		void AddValue(const char* value)
+		{
+			AddText(value);
+		}
+
+		void AddValue(std::string_view value)
+		{
+			AddText(value);
+		}
+
+		void AddValue(const std::string& value)
+		{
+			AddText(value);
+		}
+
+		template <typename ValueType>
+		std::enable_if_t<std::is_arithmetic_v<ValueType>> AddValue(ValueType value)
+		{
+			if constexpr(std::is_floating_point_v<ValueType>)
+			{
+				AddDouble(value);
+			}
+			else
+			{
+				AddInteger(static_cast<int64>(value));
+			}
+		}
+
+		void WritePendingRows(CSqliteStatement& statement)
+		{
+			Begin();
+			size_t valueCount = m_pendingRowCount * m_columnNames.size();
+			for(size_t i = 0; i < valueCount; i++)
+			{
+				//Values stay untouched until the statement is stepped, no need to copy them
+				const auto& value = m_values[i];
+				int param = static_cast<int>(i + 1);
+				switch(value.type)
+				{
+				case VALUE_TYPE::NULLVALUE:
+					statement.BindNull(param);
+					break;
+				case VALUE_TYPE::INTEGER:
+					statement.BindInteger64(param, value.integer);
+					break;
+				case VALUE_TYPE::DOUBLE:
+					statement.BindDouble(param, value.real);
+					break;
+				case VALUE_TYPE::TEXT:
+					statement.BindText(param, std::string_view(value.data), true);
+					break;
+				case VALUE_TYPE::BLOB:
+					statement.BindBlob(param, value.data.data(), value.data.size(), true);
+					break;
+				}
+			}
+			statement.StepNoResult();
+			statement.Rewind();
+			m_writtenRowCount += m_pendingRowCount;
+			m_transactionRowCount += m_pendingRowCount;
+			m_pendingRowCount = 0;
+			if(m_transactionRowCount >= m_batchSize)
+			{
+				Commit();
+			}
+		}
+
+		void Begin()
+		{
+			if(m_inTransaction) return;
+			if(!sqlite3_get_autocommit(m_db))
+			{
+				//Already in the caller's transaction
+				return;
+			}
+			m_beginStatement.StepNoResult();
+			m_beginStatement.Rewind();
+			m_inTransaction = true;
+			m_transactionRowCount = 0;
+		}
+
+		void Commit()
+		{
+			m_transactionRowCount = 0;
+			if(!m_inTransaction) return;
+			m_commitStatement.StepNoResult();
+			m_commitStatement.Rewind();
+			m_inTransaction = false;
+		}
+
+		sqlite3* m_db = nullptr;
+		std::string m_tableName;
+		std::vector<std::string> m_columnNames;
+		size_t m_batchSize = DEFAULT_BATCH_SIZE;
+		size_t m_rowsPerStatement = DEFAULT_ROWS_PER_STATEMENT;
+		CSqliteStatement m_statement;
+		CSqliteStatement m_beginStatement;
+		CSqliteStatement m_commitStatement;
+		std::vector<VALUE> m_values;
+		size_t m_rowValueCount = 0;
+		size_t m_pendingRowCount = 0;
+		size_t m_transactionRowCount = 0;
+		size_t m_writtenRowCount = 0;
+		bool m_inTransaction = false;
+	};
+}
@@ -0,0 +1,188 @@
+#pragma once
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "SqliteDb.h"
+
+namespace Framework
+{
+	class CSqliteConnectionPool;
+
+	//Connection borrowed from a CSqliteConnectionPool, it goes back to the pool when this is destroyed
+	//or released. Statements prepared on the connection (including the cached ones) need to be
+	//released before.
+	class CSqliteConnectionLease
+	{
+	public:
+		CSqliteConnectionLease() = default;
+		CSqliteConnectionLease(CSqliteConnectionPool*, CSqliteDb*);
+
+		//Non-copyable
+		CSqliteConnectionLease(const CSqliteConnectionLease&) = delete;
+		CSqliteConnectionLease& operator =(const CSqliteConnectionLease&) = delete;
+
+		CSqliteConnectionLease(CSqliteConnectionLease&&);
+		CSqliteConnectionLease& operator =(CSqliteConnectionLease&&);
+
+		virtual ~CSqliteConnectionLease();
+
+		void Release();
+
+		bool IsEmpty() const;
+
+		CSqliteDb& operator *() const;
+		CSqliteDb* operator ->() const;
+
+	private:
+		CSqliteConnectionPool* m_pool = nullptr;
+		CSqliteDb* m_db = nullptr;
+	};
+
+	//Opens a database in WAL mode with one read-write connection and many read-only connections.
+	//Readers don't block each other nor the writer, so each thread or task can run its queries on
+	//its own connection. Each connection has its own statement cache.
+	//The database needs to be a file, in-memory databases can't be shared between connections.
+	class CSqliteConnectionPool
+	{
+	public:
+		enum
+		{
+			BUSY_TIMEOUT_MS = 5000,
+		};
+
+		CSqliteConnectionPool(const char* path, unsigned int readerCount, const char* vfsName = nullptr)
+		{
+			//The writer creates the database and switches it to WAL before readers are opened
+			m_writer = CSqliteDb(path, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_NOMUTEX, vfsName,
+			                     CSqliteDb::OPTION_WAL | CSqliteDb::OPTION_SYNCHRONOUS_NORMAL);
+			sqlite3_busy_timeout(m_writer, BUSY_TIMEOUT_MS);
+			m_readers.reserve(readerCount);
+			m_availableReaders.reserve(readerCount);
+			for(unsigned int i = 0; i < readerCount; i++)
+			{
+				auto reader = std::make_unique<CSqliteDb>(path, SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX, vfsName);
+				sqlite3_busy_timeout(*reader, BUSY_TIMEOUT_MS);
+				m_availableReaders.push_back(reader.get());
+				m_readers.push_back(std::move(reader));
+			}
+		}
+
+		//Non-copyable
+		CSqliteConnectionPool(const CSqliteConnectionPool&) = delete;
+		CSqliteConnectionPool& operator =(const CSqliteConnectionPool&) = delete;
+
+		virtual ~CSqliteConnectionPool()
+		{
+			assert(m_writerAvailable);
+			assert(m_availableReaders.size() == m_readers.size());
+		}
+
+		unsigned int GetReaderCount() const
+		{
+			return static_cast<unsigned int>(m_readers.size());
+		}
+
+		//Waits for a read-only connection to be available. Uses the writer if there are no readers.
+		CSqliteConnectionLease AcquireReader()
+		{
+			if(m_readers.empty())
+			{
+				return AcquireWriter();
+			}
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_connectionReleasedCondition.wait(lock, [this]() { return !m_availableReaders.empty(); });
+			auto reader = m_availableReaders.back();
+			m_availableReaders.pop_back();
+			return CSqliteConnectionLease(this, reader);
+		}
+
+		//Waits for the read-write connection to be available
+		CSqliteConnectionLease AcquireWriter()
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_connectionReleasedCondition.wait(lock, [this]() { return m_writerAvailable; });
+			m_writerAvailable = false;
+			return CSqliteConnectionLease(this, &m_writer);
+		}
+
+		void ReleaseConnection(CSqliteDb* db)
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				if(db == &m_writer)
+				{
+					assert(!m_writerAvailable);
+					m_writerAvailable = true;
+				}
+				else
+				{
+					m_availableReaders.push_back(db);
+				}
+			}
+			//Readers and writer wait on the same condition
+			m_connectionReleasedCondition.notify_all();
+		}
+
+	private:
+		std::mutex m_mutex;
+		std::condition_variable m_connectionReleasedCondition;
+		CSqliteDb m_writer;
+		bool m_writerAvailable = true;
+		std::vector<std::unique_ptr<CSqliteDb>> m_readers;
+		std::vector<CSqliteDb*> m_availableReaders;
+	};
+
+	inline CSqliteConnectionLease::CSqliteConnectionLease(CSqliteConnectionPool* pool, CSqliteDb* db)
+	    : m_pool(pool)
+	    , m_db(db)
+	{
+	}
+
+	inline CSqliteConnectionLease::CSqliteConnectionLease(CSqliteConnectionLease&& rhs)
+	{
+		std::swap(m_pool, rhs.m_pool);
+		std::swap(m_db, rhs.m_db);
+	}
+
+	inline CSqliteConnectionLease& CSqliteConnectionLease::operator =(CSqliteConnectionLease&& rhs)
+	{
+		Release();
+		std::swap(m_pool, rhs.m_pool);
+		std::swap(m_db, rhs.m_db);
+		return (*this);
+	}
+
+	inline CSqliteConnectionLease::~CSqliteConnectionLease()
+	{
+		Release();
+	}
+
+	inline void CSqliteConnectionLease::Release()
+	{
+		if(m_pool)
+		{
+			m_pool->ReleaseConnection(m_db);
+			m_pool = nullptr;
+			m_db = nullptr;
+		}
+	}
+
+	inline bool CSqliteConnectionLease::IsEmpty() const
+	{
+		return !m_pool;
+	}
+
+	inline CSqliteDb& CSqliteConnectionLease::operator *() const
+	{
+		assert(m_db);
+		return *m_db;
+	}
+
+	inline CSqliteDb* CSqliteConnectionLease::operator ->() const
+	{
+		assert(m_db);
+		return m_db;
+	}
+}
@@ -3,23 +3,54 @@
 #include <sqlite3.h>
 #include <stdexcept>
 #include <cassert>
+#include <memory>
 #include "Types.h"
 #include "maybe_unused.h"
+#include "SqliteStatementCache.h"
 
 namespace Framework
 {
 	class CSqliteDb
 	{
 	public:
+		enum OPTIONS
+		{
+			OPTION_NONE = 0,
+			//Write-ahead log journal: readers don't block the writer and commits only append to the log
+			OPTION_WAL = 0x01,
+			//Sync less often (synchronous=NORMAL), combined with WAL the last commits can be lost
+			//on power failure, but the database can't be corrupted
+			OPTION_SYNCHRONOUS_NORMAL = 0x02,
+		};
+
 		CSqliteDb() = default;
 
-		CSqliteDb(const char* path, uint32 modeFlags, const char* vfsName = nullptr)
+		CSqliteDb(const char* path, uint32 modeFlags, const char* vfsName = nullptr, uint32 options = OPTION_NONE)
 		{
 			int result = sqlite3_open_v2(path, &m_handle, modeFlags, vfsName);
 			if(result != SQLITE_OK)
 			{
+				//A handle is returned even on failure
+				Reset();
 				throw std::runtime_error("Failed to open database.");
 			}
+			try
+			{
+				if(options & OPTION_WAL)
+				{
+					//Returns the new journal mode, in-memory databases stay in "memory" mode
+					CSqliteStatement(m_handle, "PRAGMA journal_mode=WAL").Step();
+				}
+				if(options & OPTION_SYNCHRONOUS_NORMAL)
+				{
+					CSqliteStatement(m_handle, "PRAGMA synchronous=NORMAL").StepNoResult();
+				}
+			}
+			catch(...)
+			{
+				Reset();
+				throw;
+			}
 		}
 
 		//Non-copyable
@@ -38,6 +69,7 @@ namespace Framework
 
 		void Reset()
 		{
+			m_statementCache.reset();
 			if(m_handle)
 			{
 				FRAMEWORK_MAYBE_UNUSED int result = sqlite3_close_v2(m_handle);
@@ -54,6 +86,7 @@ namespace Framework
 		void MoveFrom(CSqliteDb&& rhs)
 		{
 			std::swap(m_handle, rhs.m_handle);
+			std::swap(m_statementCache, rhs.m_statementCache);
 		}
 
 		CSqliteDb& operator =(CSqliteDb&& rhs)
@@ -63,6 +96,23 @@ namespace Framework
 			return (*this);
 		}
 
+		//Gets a prepared statement for the query, reusing one prepared earlier if possible.
+		//Cached statements need to be released before the database is reset or destroyed.
+		CSqliteCachedStatement GetCachedStatement(const char* query)
+		{
+			return GetStatementCache().Get(query);
+		}
+
+		CSqliteStatementCache& GetStatementCache()
+		{
+			assert(m_handle);
+			if(!m_statementCache)
+			{
+				m_statementCache = std::make_unique<CSqliteStatementCache>(m_handle);
+			}
+			return *m_statementCache;
+		}
+
 		operator sqlite3*() const
 		{
 			return m_handle;
@@ -70,5 +120,7 @@ namespace Framework
 
 	private:
 		sqlite3* m_handle = nullptr;
+		//Held by pointer so that borrowed statements can find it after a move
+		std::unique_ptr<CSqliteStatementCache> m_statementCache;
 	};
 }
@@ -2,7 +2,11 @@
 
 #include <sqlite3.h>
 #include <stdexcept>
+#include <cassert>
+#include <string_view>
+#include "QueryStats.h"
 #include "Types.h"
+#include "maybe_unused.h"
 
 namespace Framework
 {
@@ -24,6 +28,11 @@ namespace Framework
 		CSqliteStatement(const CSqliteStatement&) = delete;
 		CSqliteStatement& operator =(const CSqliteStatement&) = delete;
 
+		CSqliteStatement(CSqliteStatement&& rhs)
+		{
+			MoveFrom(std::move(rhs));
+		}
+
 		virtual ~CSqliteStatement()
 		{
 			Reset();
@@ -39,20 +48,83 @@ namespace Framework
 			}
 		}
 
+		bool IsEmpty() const
+		{
+			return !m_handle;
+		}
+
+		void MoveFrom(CSqliteStatement&& rhs)
+		{
+			std::swap(m_handle, rhs.m_handle);
+		}
+
+		CSqliteStatement& operator =(CSqliteStatement&& rhs)
+		{
+			Reset();
+			MoveFrom(std::move(rhs));
+			return (*this);
+		}
+
+		//Rewinds the statement so that it can be executed again, bindings are kept
+		void Rewind()
+		{
+			//Returns the error of the last step, which has already been reported by Step
+			sqlite3_reset(m_handle);
+		}
+
+		void ClearBindings()
+		{
+			sqlite3_clear_bindings(m_handle);
+		}
+
+		//Static values are not copied and need to stay valid until they are rebound,
+		//the bindings are cleared or the statement is destroyed
+
+		void BindNull(int param)
+		{
+			FRAMEWORK_MAYBE_UNUSED int result = sqlite3_bind_null(m_handle, param);
+			assert(result == SQLITE_OK);
+		}
+
 		void BindText(int param, const char* value, bool isStatic = false)
 		{
 			FRAMEWORK_MAYBE_UNUSED int result = sqlite3_bind_text(m_handle, param, value, -1, isStatic ? SQLITE_STATIC : SQLITE_TRANSIENT);
 			assert(result == SQLITE_OK);
 		}
 
+		void BindText(int param, std::string_view value, bool isStatic = false)
+		{
+			FRAMEWORK_MAYBE_UNUSED int result = sqlite3_bind_text64(m_handle, param, value.data(), value.size(), isStatic ? SQLITE_STATIC : SQLITE_TRANSIENT, SQLITE_UTF8);
+			assert(result == SQLITE_OK);
+		}
+
+		void BindBlob(int param, const void* data, size_t size, bool isStatic = false)
+		{
+			FRAMEWORK_MAYBE_UNUSED int result = sqlite3_bind_blob64(m_handle, param, data, size, isStatic ? SQLITE_STATIC : SQLITE_TRANSIENT);
+			assert(result == SQLITE_OK);
+		}
+
 		void BindInteger(int param, uint32 value)
 		{
 			FRAMEWORK_MAYBE_UNUSED int result = sqlite3_bind_int(m_handle, param, value);
 			assert(result == SQLITE_OK);
 		}
 
+		void BindInteger64(int param, int64 value)
+		{
+			FRAMEWORK_MAYBE_UNUSED int result = sqlite3_bind_int64(m_handle, param, value);
+			assert(result == SQLITE_OK);
+		}
+
+		void BindDouble(int param, double value)
+		{
+			FRAMEWORK_MAYBE_UNUSED int result = sqlite3_bind_double(m_handle, param, value);
+			assert(result == SQLITE_OK);
+		}
+
 		bool Step()
 		{
+			CQueryTimer timer(sqlite3_sql(m_handle));
 			int result = sqlite3_step(m_handle);
 			switch(result)
 			{
@@ -82,6 +154,53 @@ namespace Framework
 			assert(!hasRow);
 		}
 
+		//Column getters are only valid after Step returned true. Text and blob values point
+		//to memory owned by the statement and are valid until the next step or rewind
+
+		int GetColumnCount() const
+		{
+			return sqlite3_column_count(m_handle);
+		}
+
+		bool IsColumnNull(int column) const
+		{
+			return sqlite3_column_type(m_handle, column) == SQLITE_NULL;
+		}
+
+		std::string_view GetColumnText(int column) const
+		{
+			//Text needs to be fetched before its size
+			auto text = reinterpret_cast<const char*>(sqlite3_column_text(m_handle, column));
+			size_t size = sqlite3_column_bytes(m_handle, column);
+			return text ? std::string_view(text, size) : std::string_view();
+		}
+
+		const void* GetColumnBlob(int column) const
+		{
+			return sqlite3_column_blob(m_handle, column);
+		}
+
+		//Size of the blob returned by the last GetColumnBlob call on this column
+		size_t GetColumnBlobSize(int column) const
+		{
+			return sqlite3_column_bytes(m_handle, column);
+		}
+
+		uint32 GetColumnInteger(int column) const
+		{
+			return static_cast<uint32>(sqlite3_column_int(m_handle, column));
+		}
+
+		int64 GetColumnInteger64(int column) const
+		{
+			return sqlite3_column_int64(m_handle, column);
+		}
+
+		double GetColumnDouble(int column) const
+		{
+			return sqlite3_column_double(m_handle, column);
+		}
+
 		operator sqlite3_stmt*() const
 		{
 			return m_handle;
@@ -0,0 +1,198 @@
+#pragma once
+
+#include <list>
+#include <string>
+#include <unordered_map>
+#include "SqliteStatement.h"
+
+namespace Framework
+{
+	class CSqliteStatementCache;
+
+	//Statement borrowed from a CSqliteStatementCache, it goes back to the cache
+	//(rewound and with its bindings cleared) when this is destroyed or released
+	class CSqliteCachedStatement
+	{
+	public:
+		CSqliteCachedStatement() = default;
+		CSqliteCachedStatement(CSqliteStatementCache*, std::string, CSqliteStatement);
+
+		//Non-copyable
+		CSqliteCachedStatement(const CSqliteCachedStatement&) = delete;
+		CSqliteCachedStatement& operator =(const CSqliteCachedStatement&) = delete;
+
+		CSqliteCachedStatement(CSqliteCachedStatement&&);
+		CSqliteCachedStatement& operator =(CSqliteCachedStatement&&);
+
+		virtual ~CSqliteCachedStatement();
+
+		void Release();
+
+		CSqliteStatement& operator *();
+		CSqliteStatement* operator ->();
+
+	private:
+		CSqliteStatementCache* m_cache = nullptr;
+		std::string m_query;
+		CSqliteStatement m_statement;
+	};
+
+	//LRU cache of prepared statements keyed by their SQL text. Statements are handed out
+	//to one user at a time, the same query used again while borrowed is prepared again.
+	//All statements need to be given back before the cache is destroyed.
+	class CSqliteStatementCache
+	{
+	public:
+		enum
+		{
+			DEFAULT_CAPACITY = 32,
+		};
+
+		CSqliteStatementCache(sqlite3* db, size_t capacity = DEFAULT_CAPACITY)
+		    : m_db(db)
+		    , m_capacity(capacity)
+		{
+		}
+
+		//Non-copyable
+		CSqliteStatementCache(const CSqliteStatementCache&) = delete;
+		CSqliteStatementCache& operator =(const CSqliteStatementCache&) = delete;
+
+		virtual ~CSqliteStatementCache()
+		{
+			assert(m_borrowedCount == 0);
+		}
+
+		CSqliteCachedStatement Get(const char* query)
+		{
+			std::string key(query);
+			CSqliteStatement statement;
+			auto entryIterator = m_entryIterators.find(key);
+			if(entryIterator != std::end(m_entryIterators))
+			{
+				statement = std::move(entryIterator->second->statement);
+				m_entries.erase(entryIterator->second);
+				m_entryIterators.erase(entryIterator);
+			}
+			else
+			{
+				statement = CSqliteStatement(m_db, query);
+			}
+			m_borrowedCount++;
+			return CSqliteCachedStatement(this, std::move(key), std::move(statement));
+		}
+
+		//Number of statements waiting to be reused
+		size_t GetSize() const
+		{
+			return m_entries.size();
+		}
+
+		size_t GetCapacity() const
+		{
+			return m_capacity;
+		}
+
+		void SetCapacity(size_t capacity)
+		{
+			m_capacity = capacity;
+			Trim();
+		}
+
+		void Clear()
+		{
+			m_entryIterators.clear();
+			m_entries.clear();
+		}
+
+		void GiveBack(std::string query, CSqliteStatement statement)
+		{
+			assert(m_borrowedCount != 0);
+			m_borrowedCount--;
+			statement.Rewind();
+			statement.ClearBindings();
+			if(m_entryIterators.find(query) != std::end(m_entryIterators))
+			{
+				//Borrowed more than once, keep the statement that is already there
+				return;
+			}
+			m_entries.push_front(ENTRY{query, std::move(statement)});
+			m_entryIterators.emplace(std::move(query), std::begin(m_entries));
+			Trim();
+		}
+
+	private:
+		struct ENTRY
+		{
+			std::string query;
+			CSqliteStatement statement;
+		};
+
+		typedef std::list<ENTRY> EntryList;
+
+		void Trim()
+		{
+			while(m_entries.size() > m_capacity)
+			{
+				//Least recently used statements are at the back
+				m_entryIterators.erase(m_entries.back().query);
+				m_entries.pop_back();
+			}
+		}
+
+		sqlite3* m_db = nullptr;
+		size_t m_capacity = DEFAULT_CAPACITY;
+		size_t m_borrowedCount = 0;
+		EntryList m_entries;
+		std::unordered_map<std::string, EntryList::iterator> m_entryIterators;
+	};
+
+	inline CSqliteCachedStatement::CSqliteCachedStatement(CSqliteStatementCache* cache, std::string query, CSqliteStatement statement)
+	    : m_cache(cache)
+	    , m_query(std::move(query))
+	    , m_statement(std::move(statement))
+	{
+	}
+
+	inline CSqliteCachedStatement::CSqliteCachedStatement(CSqliteCachedStatement&& rhs)
+	{
+		std::swap(m_cache, rhs.m_cache);
+		std::swap(m_query, rhs.m_query);
+		m_statement.MoveFrom(std::move(rhs.m_statement));
+	}
+
+	inline CSqliteCachedStatement& CSqliteCachedStatement::operator =(CSqliteCachedStatement&& rhs)
+	{
+		Release();
+		std::swap(m_cache, rhs.m_cache);
+		std::swap(m_query, rhs.m_query);
+		m_statement.MoveFrom(std::move(rhs.m_statement));
+		return (*this);
+	}
+
+	inline CSqliteCachedStatement::~CSqliteCachedStatement()
+	{
+		Release();
+	}
+
+	inline void CSqliteCachedStatement::Release()
+	{
+		if(m_cache)
+		{
+			m_cache->GiveBack(std::move(m_query), std::move(m_statement));
+			m_cache = nullptr;
+		}
+	}
+
+	inline CSqliteStatement& CSqliteCachedStatement::operator *()
+	{
+		assert(m_cache);
+		return m_statement;
+	}
+
+	inline CSqliteStatement* CSqliteCachedStatement::operator ->()
+	{
+		assert(m_cache);
+		return &m_statement;
+	}
+}
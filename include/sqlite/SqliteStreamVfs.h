@@ -0,0 +1,37 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include "Stream.h"
+#include "Types.h"
+
+#define STREAM_VFS_NAME "stream_vfs"
+
+namespace Framework
+{
+	namespace Sqlite
+	{
+		enum
+		{
+			//Page cache size of files, shared by every connection to a file
+			STREAM_VFS_DEFAULT_CACHE_SIZE = 0x400000,
+			//Amount read from the stream on a cache miss
+			STREAM_VFS_CACHE_BLOCK_SIZE = 0x10000,
+		};
+
+		//Read only databases queried in place from streams, without extracting them first. Files are added
+		//under a name, which is then opened with SQLITE_OPEN_READONLY and STREAM_VFS_NAME. Streams supporting
+		//positional reads can be used by several connections at once, others are read under a lock. Span
+		//streams (ie.: mapped files) are read directly without caching and can be memory mapped by SQLite
+		//when running "PRAGMA mmap_size" with a size covering the database.
+		void registerStreamVfs();
+
+		//The file is the range of the stream starting at offset, stored zip entries can be used this way
+		//(see CZipArchiveReader::GetStoredFileDataOffset). Replaces a file with the same name, connections
+		//already opened on it keep using the previous stream until they're closed.
+		void addStreamVfsFile(const std::string& name, std::shared_ptr<CStream>, uint64 offset, uint64 size, uint64 cacheSize = STREAM_VFS_DEFAULT_CACHE_SIZE);
+		//The file is the whole stream
+		void addStreamVfsFile(const std::string& name, std::shared_ptr<CStream>, uint64 cacheSize = STREAM_VFS_DEFAULT_CACHE_SIZE);
+		void removeStreamVfsFile(const std::string& name);
+	}
+};
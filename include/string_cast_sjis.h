@@ -4,5 +4,7 @@
 #include <string>
 
 std::wstring string_cast_sjis(const std::string&);
+//Writes at most one character per input byte, returns the number of characters written
+size_t string_cast_sjis(const char*, size_t, wchar_t*);
 
 #endif
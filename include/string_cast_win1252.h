@@ -4,5 +4,7 @@
 #include <string>
 
 std::wstring string_cast_win1252(const std::string&);
+//Writes one character per input byte, returns the number of characters written
+size_t string_cast_win1252(const char*, size_t, wchar_t*);
 
 #endif
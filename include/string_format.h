@@ -3,6 +3,7 @@
 #include <string>
 #include <stdarg.h>
 #include "maybe_unused.h"
+#include "string_format_compiled.h"
 
 FRAMEWORK_MAYBE_UNUSED
 static std::string string_format_internal(const char* format, va_list ap)
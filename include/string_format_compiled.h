@@ -0,0 +1,587 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+//Format strings that are parsed and checked at compile time, using a subset of the {fmt} syntax:
+//	{} or {:[[fill]align][0][width][.precision][type]}, with {{ and }} for literal braces
+//	align: '<' (left), '>' (right) or '^' (center), numbers are right aligned by default, everything else left aligned
+//	type: 'd', 'x', 'X', 'o', 'b' for integers, 'f', 'e', 'g' for floating point numbers, 's' for strings and bools,
+//	      'c' for chars and 'p' for pointers. Floating point numbers without type and precision use the shortest
+//	      representation that round trips.
+//Format strings need to be wrapped with FORMAT_STRING, invalid format strings and format strings
+//that don't match the arguments are compile errors:
+//	auto text = string_format(FORMAT_STRING("{}: {:08X}"), name, value);
+//	string_format_to(output, FORMAT_STRING("{:.3f}s\n"), seconds);
+
+#define FORMAT_STRING(text)                                                         \
+	[] {                                                                            \
+		struct FORMAT_STRING_TYPE : StringFormatCompiled::FORMAT_STRING_BASE        \
+		{                                                                           \
+			static constexpr std::string_view Get()                                 \
+			{                                                                       \
+				return text;                                                        \
+			}                                                                       \
+		};                                                                          \
+		return FORMAT_STRING_TYPE();                                                \
+	}()
+
+namespace Framework
+{
+	//Output for string_format_to, keeps the text in place up to Size characters and only moves it to the heap past that
+	template <size_t Size = 256>
+	class CFormatBuffer
+	{
+	public:
+		CFormatBuffer() = default;
+		CFormatBuffer(const CFormatBuffer&) = delete;
+
+		CFormatBuffer& operator=(const CFormatBuffer&) = delete;
+
+		void Append(const char* text, size_t size)
+		{
+			Reserve(m_size + size);
+			memcpy(m_data + m_size, text, size);
+			m_size += size;
+		}
+
+		void AppendFill(size_t count, char value)
+		{
+			Reserve(m_size + count);
+			memset(m_data + m_size, value, count);
+			m_size += count;
+		}
+
+		void Clear()
+		{
+			m_size = 0;
+		}
+
+		const char* GetData() const
+		{
+			return m_data;
+		}
+
+		const char* GetCString()
+		{
+			m_data[m_size] = 0;
+			return m_data;
+		}
+
+		size_t GetSize() const
+		{
+			return m_size;
+		}
+
+		bool IsOnHeap() const
+		{
+			return m_data != m_stackBuffer;
+		}
+
+		std::string_view GetView() const
+		{
+			return std::string_view(m_data, m_size);
+		}
+
+		std::string ToString() const
+		{
+			return std::string(m_data, m_size);
+		}
+
+	private:
+		void Reserve(size_t size)
+		{
+			if(size <= m_capacity) return;
+			size_t capacity = std::max(size, m_capacity * 2);
+			//One extra character for GetCString's terminator
+			std::unique_ptr<char[]> buffer(new char[capacity + 1]);
+			memcpy(buffer.get(), m_data, m_size);
+			m_heapBuffer = std::move(buffer);
+			m_data = m_heapBuffer.get();
+			m_capacity = capacity;
+		}
+
+		char m_stackBuffer[Size + 1];
+		char* m_data = m_stackBuffer;
+		size_t m_size = 0;
+		size_t m_capacity = Size;
+		std::unique_ptr<char[]> m_heapBuffer;
+	};
+}
+
+namespace StringFormatCompiled
+{
+	struct FORMAT_STRING_BASE
+	{
+	};
+
+	enum FORMAT_ALIGN
+	{
+		FORMAT_ALIGN_DEFAULT,
+		FORMAT_ALIGN_LEFT,
+		FORMAT_ALIGN_RIGHT,
+		FORMAT_ALIGN_CENTER,
+	};
+
+	enum
+	{
+		MAX_WIDTH = 1024,
+		MAX_PRECISION = 64,
+		//Large enough for the longest fixed notation double (309 digits) with the maximum precision
+		FLOAT_BUFFER_SIZE = 400,
+	};
+
+	struct FORMAT_SPEC
+	{
+		char fill = ' ';
+		FORMAT_ALIGN align = FORMAT_ALIGN_DEFAULT;
+		bool zeroPad = false;
+		unsigned int width = 0;
+		int precision = -1;
+		char type = 0;
+	};
+
+	struct FORMAT_SEGMENT
+	{
+		bool isArgument = false;
+		size_t textBegin = 0;
+		size_t textSize = 0;
+		size_t argumentIndex = 0;
+		FORMAT_SPEC spec;
+	};
+
+	struct PARSE_RESULT
+	{
+		bool valid = true;
+		size_t segmentCount = 0;
+		size_t argumentCount = 0;
+	};
+
+	constexpr FORMAT_ALIGN GetAlign(char value)
+	{
+		switch(value)
+		{
+		case '<':
+			return FORMAT_ALIGN_LEFT;
+		case '>':
+			return FORMAT_ALIGN_RIGHT;
+		case '^':
+			return FORMAT_ALIGN_CENTER;
+		default:
+			return FORMAT_ALIGN_DEFAULT;
+		}
+	}
+
+	constexpr bool IsDigit(char value)
+	{
+		return (value >= '0') && (value <= '9');
+	}
+
+	//Parses what's between the braces of a replacement field
+	constexpr bool ParseSpec(std::string_view field, FORMAT_SPEC& spec)
+	{
+		if(field.empty()) return true;
+		//Explicit argument indices aren't supported
+		if(field[0] != ':') return false;
+		size_t pos = 1;
+		if(((pos + 1) < field.size()) && (GetAlign(field[pos + 1]) != FORMAT_ALIGN_DEFAULT))
+		{
+			spec.fill = field[pos];
+			spec.align = GetAlign(field[pos + 1]);
+			pos += 2;
+		}
+		else if((pos < field.size()) && (GetAlign(field[pos]) != FORMAT_ALIGN_DEFAULT))
+		{
+			spec.align = GetAlign(field[pos]);
+			pos++;
+		}
+		if((pos < field.size()) && (field[pos] == '0'))
+		{
+			spec.zeroPad = true;
+			pos++;
+		}
+		while((pos < field.size()) && IsDigit(field[pos]))
+		{
+			spec.width = (spec.width * 10) + (field[pos] - '0');
+			if(spec.width > MAX_WIDTH) return false;
+			pos++;
+		}
+		if((pos < field.size()) && (field[pos] == '.'))
+		{
+			pos++;
+			if((pos == field.size()) || !IsDigit(field[pos])) return false;
+			spec.precision = 0;
+			while((pos < field.size()) && IsDigit(field[pos]))
+			{
+				spec.precision = (spec.precision * 10) + (field[pos] - '0');
+				if(spec.precision > MAX_PRECISION) return false;
+				pos++;
+			}
+		}
+		if(pos < field.size())
+		{
+			spec.type = field[pos];
+			if(std::string_view("dxXobfegscp").find(spec.type) == std::string_view::npos) return false;
+			pos++;
+		}
+		return pos == field.size();
+	}
+
+	constexpr void AddLiteral(PARSE_RESULT& result, FORMAT_SEGMENT* segments, size_t begin, size_t size)
+	{
+		if(size == 0) return;
+		if(segments)
+		{
+			auto& segment = segments[result.segmentCount];
+			segment.textBegin = begin;
+			segment.textSize = size;
+		}
+		result.segmentCount++;
+	}
+
+	//Splits the format string in literal and argument segments, only counts them if segments is null
+	constexpr PARSE_RESULT ParseFormat(std::string_view format, FORMAT_SEGMENT* segments)
+	{
+		PARSE_RESULT result;
+		size_t literalBegin = 0;
+		size_t pos = 0;
+		while(pos < format.size())
+		{
+			char value = format[pos];
+			if((value != '{') && (value != '}'))
+			{
+				pos++;
+				continue;
+			}
+			if(((pos + 1) < format.size()) && (format[pos + 1] == value))
+			{
+				//Escaped brace, keep the first one as part of the literal
+				AddLiteral(result, segments, literalBegin, pos + 1 - literalBegin);
+				pos += 2;
+				literalBegin = pos;
+				continue;
+			}
+			size_t fieldEnd = format.find('}', pos);
+			if((value == '}') || (fieldEnd == std::string_view::npos))
+			{
+				result.valid = false;
+				return result;
+			}
+			FORMAT_SPEC spec;
+			auto field = format.substr(pos + 1, fieldEnd - pos - 1);
+			if((field.find('{') != std::string_view::npos) || !ParseSpec(field, spec))
+			{
+				result.valid = false;
+				return result;
+			}
+			AddLiteral(result, segments, literalBegin, pos - literalBegin);
+			if(segments)
+			{
+				auto& segment = segments[result.segmentCount];
+				segment.isArgument = true;
+				segment.argumentIndex = result.argumentCount;
+				segment.spec = spec;
+			}
+			result.segmentCount++;
+			result.argumentCount++;
+			pos = fieldEnd + 1;
+			literalBegin = pos;
+		}
+		AddLiteral(result, segments, literalBegin, format.size() - literalBegin);
+		return result;
+	}
+
+	template <size_t SegmentCount>
+	constexpr std::array<FORMAT_SEGMENT, SegmentCount> MakeSegments(std::string_view format)
+	{
+		std::array<FORMAT_SEGMENT, SegmentCount> segments = {};
+		ParseFormat(format, segments.data());
+		return segments;
+	}
+
+	template <typename FormatStringType>
+	struct COMPILED_FORMAT
+	{
+		static constexpr std::string_view text = FormatStringType::Get();
+		static constexpr PARSE_RESULT parseResult = ParseFormat(text, nullptr);
+		static constexpr auto segments = MakeSegments<parseResult.segmentCount>(text);
+	};
+
+	enum ARGUMENT_KIND
+	{
+		ARGUMENT_KIND_UNSUPPORTED,
+		ARGUMENT_KIND_INTEGER,
+		ARGUMENT_KIND_CHAR,
+		ARGUMENT_KIND_BOOL,
+		ARGUMENT_KIND_FLOAT,
+		ARGUMENT_KIND_STRING,
+		ARGUMENT_KIND_POINTER,
+	};
+
+	template <typename ArgumentType>
+	constexpr ARGUMENT_KIND GetArgumentKind()
+	{
+		typedef std::decay_t<ArgumentType> Type;
+		if constexpr(std::is_same_v<Type, bool>)
+			return ARGUMENT_KIND_BOOL;
+		else if constexpr(std::is_same_v<Type, char>)
+			return ARGUMENT_KIND_CHAR;
+		else if constexpr(std::is_integral_v<Type> || std::is_enum_v<Type>)
+			return ARGUMENT_KIND_INTEGER;
+		else if constexpr(std::is_floating_point_v<Type>)
+			return ARGUMENT_KIND_FLOAT;
+		else if constexpr(std::is_same_v<Type, char*> || std::is_same_v<Type, const char*> || std::is_convertible_v<const Type&, std::string_view>)
+			return ARGUMENT_KIND_STRING;
+		else if constexpr(std::is_pointer_v<Type>)
+			return ARGUMENT_KIND_POINTER;
+		else
+			return ARGUMENT_KIND_UNSUPPORTED;
+	}
+
+	constexpr bool IsSpecCompatible(ARGUMENT_KIND kind, const FORMAT_SPEC& spec)
+	{
+		auto isTypeOneOf = [&spec](std::string_view types) { return (spec.type == 0) || (types.find(spec.type) != std::string_view::npos); };
+		switch(kind)
+		{
+		case ARGUMENT_KIND_INTEGER:
+			return isTypeOneOf("dxXob") && (spec.precision < 0);
+		case ARGUMENT_KIND_CHAR:
+			return isTypeOneOf("cdxXob") && (spec.precision < 0);
+		case ARGUMENT_KIND_BOOL:
+			return isTypeOneOf("s") && (spec.precision < 0) && !spec.zeroPad;
+		case ARGUMENT_KIND_FLOAT:
+			return isTypeOneOf("feg");
+		case ARGUMENT_KIND_STRING:
+			return isTypeOneOf("s") && !spec.zeroPad;
+		case ARGUMENT_KIND_POINTER:
+			return isTypeOneOf("p") && (spec.precision < 0);
+		default:
+			return false;
+		}
+	}
+
+	template <typename... Args, size_t SegmentCount>
+	constexpr bool AreArgumentsCompatible(const std::array<FORMAT_SEGMENT, SegmentCount>& segments)
+	{
+		//Extra element to avoid a zero sized array when there are no arguments
+		constexpr ARGUMENT_KIND kinds[] = {GetArgumentKind<Args>()..., ARGUMENT_KIND_UNSUPPORTED};
+		for(const auto& segment : segments)
+		{
+			if(segment.isArgument && !IsSpecCompatible(kinds[segment.argumentIndex], segment.spec)) return false;
+		}
+		return true;
+	}
+
+	//Return the number of characters written to the buffer, which needs to be at least FLOAT_BUFFER_SIZE long
+	size_t FormatFloat(char*, float, char type, int precision);
+	size_t FormatFloat(char*, double, char type, int precision);
+
+	inline void Append(std::string& output, const char* text, size_t size)
+	{
+		output.append(text, size);
+	}
+
+	inline void AppendFill(std::string& output, size_t count, char value)
+	{
+		output.append(count, value);
+	}
+
+	template <size_t Size>
+	void Append(Framework::CFormatBuffer<Size>& output, const char* text, size_t size)
+	{
+		output.Append(text, size);
+	}
+
+	template <size_t Size>
+	void AppendFill(Framework::CFormatBuffer<Size>& output, size_t count, char value)
+	{
+		output.AppendFill(count, value);
+	}
+
+	template <typename OutputType>
+	void WritePadded(OutputType& output, const FORMAT_SPEC& spec, const char* text, size_t size, FORMAT_ALIGN defaultAlign)
+	{
+		size_t padding = (spec.width > size) ? (spec.width - size) : 0;
+		if(padding == 0)
+		{
+			Append(output, text, size);
+			return;
+		}
+		auto align = (spec.align == FORMAT_ALIGN_DEFAULT) ? defaultAlign : spec.align;
+		size_t paddingBefore = (align == FORMAT_ALIGN_LEFT) ? 0 : (align == FORMAT_ALIGN_CENTER) ? (padding / 2) : padding;
+		AppendFill(output, paddingBefore, spec.fill);
+		Append(output, text, size);
+		AppendFill(output, padding - paddingBefore, spec.fill);
+	}
+
+	template <typename OutputType>
+	void WriteNumber(OutputType& output, const FORMAT_SPEC& spec, const char* text, size_t size)
+	{
+		if(spec.zeroPad && (spec.align == FORMAT_ALIGN_DEFAULT) && (spec.width > size))
+		{
+			//Zeros go between the sign and the digits
+			size_t signSize = ((size != 0) && (text[0] == '-')) ? 1 : 0;
+			Append(output, text, signSize);
+			AppendFill(output, spec.width - size, '0');
+			Append(output, text + signSize, size - signSize);
+			return;
+		}
+		WritePadded(output, spec, text, size, FORMAT_ALIGN_RIGHT);
+	}
+
+	template <typename OutputType, typename IntegerType>
+	void WriteInteger(OutputType& output, const FORMAT_SPEC& spec, IntegerType value)
+	{
+		int base = 10;
+		switch(spec.type)
+		{
+		case 'x':
+		case 'X':
+			base = 16;
+			break;
+		case 'o':
+			base = 8;
+			break;
+		case 'b':
+			base = 2;
+			break;
+		}
+		//Large enough for 64 bits in binary with a sign
+		char buffer[72];
+		auto result = std::to_chars(buffer, buffer + sizeof(buffer), value, base);
+		if(spec.type == 'X')
+		{
+			for(auto digit = buffer; digit != result.ptr; digit++)
+			{
+				if(*digit >= 'a') *digit -= 'a' - 'A';
+			}
+		}
+		WriteNumber(output, spec, buffer, result.ptr - buffer);
+	}
+
+	template <typename OutputType>
+	void WriteString(OutputType& output, const FORMAT_SPEC& spec, std::string_view value)
+	{
+		if((spec.precision >= 0) && (static_cast<size_t>(spec.precision) < value.size()))
+		{
+			value = value.substr(0, spec.precision);
+		}
+		WritePadded(output, spec, value.data(), value.size(), FORMAT_ALIGN_LEFT);
+	}
+
+	template <typename OutputType, typename ArgumentType>
+	void WriteArgument(OutputType& output, const FORMAT_SPEC& spec, const ArgumentType& value)
+	{
+		typedef std::decay_t<ArgumentType> Type;
+		constexpr auto kind = GetArgumentKind<ArgumentType>();
+		if constexpr(kind == ARGUMENT_KIND_INTEGER)
+		{
+			if constexpr(std::is_enum_v<Type>)
+			{
+				WriteArgument(output, spec, static_cast<std::underlying_type_t<Type>>(value));
+			}
+			else
+			{
+				//Character types other than char don't have a to_chars overload
+				typedef std::conditional_t<std::is_signed_v<Type>, long long, unsigned long long> IntegerType;
+				WriteInteger(output, spec, static_cast<IntegerType>(value));
+			}
+		}
+		else if constexpr(kind == ARGUMENT_KIND_CHAR)
+		{
+			if((spec.type == 0) || (spec.type == 'c'))
+			{
+				WritePadded(output, spec, &value, 1, FORMAT_ALIGN_LEFT);
+			}
+			else
+			{
+				WriteInteger(output, spec, static_cast<int>(static_cast<unsigned char>(value)));
+			}
+		}
+		else if constexpr(kind == ARGUMENT_KIND_BOOL)
+		{
+			WriteString(output, spec, value ? std::string_view("true") : std::string_view("false"));
+		}
+		else if constexpr(kind == ARGUMENT_KIND_FLOAT)
+		{
+			typedef std::conditional_t<std::is_same_v<Type, float>, float, double> FloatType;
+			char buffer[FLOAT_BUFFER_SIZE];
+			size_t size = FormatFloat(buffer, static_cast<FloatType>(value), spec.type, spec.precision);
+			WriteNumber(output, spec, buffer, size);
+		}
+		else if constexpr(kind == ARGUMENT_KIND_STRING)
+		{
+			WriteString(output, spec, std::string_view(value));
+		}
+		else if constexpr(kind == ARGUMENT_KIND_POINTER)
+		{
+			char buffer[2 + (sizeof(uintptr_t) * 2)] = {'0', 'x'};
+			auto result = std::to_chars(buffer + 2, buffer + sizeof(buffer), reinterpret_cast<uintptr_t>(value), 16);
+			WritePadded(output, spec, buffer, result.ptr - buffer, FORMAT_ALIGN_RIGHT);
+		}
+	}
+
+	template <typename CompiledFormatType, size_t SegmentIndex, typename OutputType, typename ArgumentTupleType>
+	void WriteSegment(OutputType& output, const ArgumentTupleType& arguments)
+	{
+		constexpr const FORMAT_SEGMENT& segment = CompiledFormatType::segments[SegmentIndex];
+		if constexpr(segment.isArgument)
+		{
+			WriteArgument(output, segment.spec, std::get<segment.argumentIndex>(arguments));
+		}
+		else
+		{
+			Append(output, CompiledFormatType::text.data() + segment.textBegin, segment.textSize);
+		}
+	}
+
+	template <typename CompiledFormatType, typename OutputType, typename ArgumentTupleType, size_t... SegmentIndices>
+	void WriteSegments(OutputType& output, const ArgumentTupleType& arguments, std::index_sequence<SegmentIndices...>)
+	{
+		(WriteSegment<CompiledFormatType, SegmentIndices>(output, arguments), ...);
+	}
+
+	template <typename FormatStringType, typename OutputType, typename... Args>
+	void FormatTo(OutputType& output, const Args&... args)
+	{
+		typedef COMPILED_FORMAT<FormatStringType> CompiledFormatType;
+		constexpr bool isValid = CompiledFormatType::parseResult.valid;
+		constexpr bool isArgumentCountValid = isValid && (CompiledFormatType::parseResult.argumentCount == sizeof...(Args));
+		constexpr bool areArgumentsValid = isArgumentCountValid && AreArgumentsCompatible<Args...>(CompiledFormatType::segments);
+		static_assert(isValid, "Invalid format string.");
+		static_assert(!isValid || isArgumentCountValid, "Argument count doesn't match the format string.");
+		static_assert(!isArgumentCountValid || areArgumentsValid, "Argument type doesn't match its format specification.");
+		if constexpr(areArgumentsValid)
+		{
+			WriteSegments<CompiledFormatType>(output, std::forward_as_tuple(args...), std::make_index_sequence<CompiledFormatType::segments.size()>());
+		}
+	}
+
+	template <typename FormatStringType>
+	using EnableIfFormatString = std::enable_if_t<std::is_base_of_v<FORMAT_STRING_BASE, FormatStringType>>;
+}
+
+template <typename FormatStringType, typename... Args, typename = StringFormatCompiled::EnableIfFormatString<FormatStringType>>
+std::string string_format(FormatStringType, const Args&... args)
+{
+	//Format on the stack first to allocate the result only once
+	Framework::CFormatBuffer<> buffer;
+	StringFormatCompiled::FormatTo<FormatStringType>(buffer, args...);
+	return buffer.ToString();
+}
+
+//Appends to output, either a std::string or a Framework::CFormatBuffer
+template <typename OutputType, typename FormatStringType, typename... Args, typename = StringFormatCompiled::EnableIfFormatString<FormatStringType>>
+void string_format_to(OutputType& output, FormatStringType, const Args&... args)
+{
+	StringFormatCompiled::FormatTo<FormatStringType>(output, args...);
+}
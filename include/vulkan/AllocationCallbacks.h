@@ -0,0 +1,14 @@
+#pragma once
+
+#include "VulkanDef.h"
+
+namespace Framework
+{
+	namespace Vulkan
+	{
+		//Host allocations made by the driver, counted as vulkan memory by CAllocationTracker.
+		//Returns null (driver's own allocator) when tracking isn't enabled. The same pointer needs to be
+		//given when the object is destroyed, whether tracking was disabled in between or not.
+		const VkAllocationCallbacks*	GetTrackedAllocationCallbacks();
+	}
+}
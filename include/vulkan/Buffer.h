@@ -2,6 +2,7 @@
 
 #include "Types.h"
 #include "Device.h"
+#include "MemoryAllocator.h"
 
 namespace Framework
 {
@@ -14,6 +15,8 @@ namespace Framework
 		public:
 			        CBuffer() = default;
 			        CBuffer(CDevice&, const VkPhysicalDeviceMemoryProperties&, VkBufferUsageFlags, VkMemoryPropertyFlags, uint32);
+			        //Memory is taken from the allocator instead of having a VkDeviceMemory of its own
+			        CBuffer(CMemoryAllocator&, VkBufferUsageFlags, VkMemoryPropertyFlags, uint32);
 			        CBuffer(const CBuffer&) = delete;
 			        CBuffer(CBuffer&&);
 			virtual ~CBuffer();
@@ -26,17 +29,26 @@ namespace Framework
 			         operator VkBuffer() const;
 
 			VkDeviceMemory GetMemory() const;
+			VkDeviceSize GetMemoryOffset() const;
+
+			//Memory needs to be host visible. Memory from an allocator is already mapped,
+			//mapping it again is free.
+			void* Map();
+			void Unmap();
 
 			void Read(VkQueue, CCommandBufferPool&, const VkPhysicalDeviceMemoryProperties&, void*);
 			void Write(VkQueue, CCommandBufferPool&, const VkPhysicalDeviceMemoryProperties&, const void*);
 			
 		private:
 			void Create(const VkPhysicalDeviceMemoryProperties&, VkBufferUsageFlags, VkMemoryPropertyFlags, uint32);
+			void CreateHandle(VkBufferUsageFlags, uint32);
 			void MoveFrom(CBuffer&&);
 			
 			CDevice* m_device = nullptr;
 			VkBuffer m_handle = VK_NULL_HANDLE;
 			VkDeviceMemory m_memory = VK_NULL_HANDLE;
+			CMemoryAllocator* m_allocator = nullptr;
+			MEMORY_ALLOCATION m_allocation;
 
 			uint32 m_size = 0;
 		};
@@ -11,7 +11,7 @@ namespace Framework
 		{
 		public:
 			CCommandBufferPool() = default;
-			CCommandBufferPool(CDevice&, uint32_t);
+			CCommandBufferPool(CDevice&, uint32_t, VkCommandPoolCreateFlags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
 			CCommandBufferPool(const CCommandBufferPool&) = delete;
 			CCommandBufferPool(CCommandBufferPool&&);
 
@@ -26,12 +26,14 @@ namespace Framework
 			VkCommandBuffer AllocateBuffer();
 			void            FreeBuffer(VkCommandBuffer);
 
+			//Returns all command buffers allocated from the pool to the initial state, none of them
+			//can be pending execution
 			void            ResetBuffers();
 
 		private:
 			typedef std::vector<VkCommandBuffer> CommandBufferArray;
 
-			void Create(uint32_t);
+			void Create(uint32_t, VkCommandPoolCreateFlags);
 
 			const CDevice* m_device = nullptr;
 			VkCommandPool m_handle = VK_NULL_HANDLE;
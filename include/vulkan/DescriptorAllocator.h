@@ -0,0 +1,78 @@
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+#include "Types.h"
+#include "Device.h"
+
+namespace Framework
+{
+	namespace Vulkan
+	{
+		//Allocates descriptor sets from pools created on demand, all sets are freed at once by Reset.
+		//Pools are kept after a reset, so once enough of them exist no more get created.
+		//Sets allocated with AllocateAndWrite are cached until the next reset, asking again for the
+		//same layout and writes returns the same set without allocating or updating anything.
+		//Typically one per frame in flight (and per recording thread), reset when the frame's fence
+		//has signaled. Not thread-safe.
+		class CDescriptorAllocator
+		{
+		public:
+			enum
+			{
+				DEFAULT_MAX_SETS_PER_POOL = 256,
+			};
+
+			struct DESCRIPTOR_WRITE
+			{
+				uint32 binding = 0;
+				VkDescriptorType type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+				//Only the one matching the type is used
+				VkDescriptorBufferInfo bufferInfo = {};
+				VkDescriptorImageInfo imageInfo = {};
+			};
+
+			//Pool sizes are for a whole pool, default ones cover the common descriptor types
+			        CDescriptorAllocator(CDevice&, uint32 maxSetsPerPool = DEFAULT_MAX_SETS_PER_POOL, std::vector<VkDescriptorPoolSize> = {});
+			        CDescriptorAllocator(const CDescriptorAllocator&) = delete;
+			virtual ~CDescriptorAllocator();
+
+			CDescriptorAllocator& operator =(const CDescriptorAllocator&) = delete;
+
+			VkDescriptorSet Allocate(VkDescriptorSetLayout);
+			VkDescriptorSet AllocateAndWrite(VkDescriptorSetLayout, const DESCRIPTOR_WRITE*, uint32 writeCount);
+
+			//Returns all sets to the pools, sets can't be in use by the GPU anymore
+			void Reset();
+
+			uint32 GetPoolCount() const;
+
+		private:
+			typedef std::vector<uint64> CacheKey;
+
+			struct CACHED_SET
+			{
+				CacheKey key;
+				VkDescriptorSet set = VK_NULL_HANDLE;
+			};
+			typedef std::unordered_map<uint64, std::vector<CACHED_SET>> CachedSetMap;
+
+			VkDescriptorPool CreatePool();
+			VkDescriptorPool GetNextPool();
+			void MakeCacheKey(VkDescriptorSetLayout, const DESCRIPTOR_WRITE*, uint32);
+			static bool IsImageDescriptor(VkDescriptorType);
+
+			CDevice& m_device;
+			uint32 m_maxSetsPerPool = DEFAULT_MAX_SETS_PER_POOL;
+			std::vector<VkDescriptorPoolSize> m_poolSizes;
+
+			VkDescriptorPool m_currentPool = VK_NULL_HANDLE;
+			std::vector<VkDescriptorPool> m_usedPools;
+			std::vector<VkDescriptorPool> m_freePools;
+
+			CachedSetMap m_cachedSets;
+			CacheKey m_keyScratch;
+			std::vector<VkWriteDescriptorSet> m_writeScratch;
+		};
+	}
+}
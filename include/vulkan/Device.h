@@ -1,10 +1,12 @@
 #pragma once
 
 #include <functional>
+#include <memory>
 #include "VulkanDef.h"
 #include "Instance.h"
+#include "ProcAddr.h"
 
-#define DECLARE_FUNCTION(functionName) PFN_##functionName functionName = nullptr;
+#define DECLARE_FUNCTION(functionName) CProcAddr<PFN_##functionName> functionName{#functionName};
 
 namespace Framework
 {
@@ -14,7 +16,7 @@ namespace Framework
 		{
 		public:
 			        CDevice() = default;
-			        CDevice(const CInstance&, VkPhysicalDevice, const VkDeviceCreateInfo&);
+			        CDevice(const CInstance&, VkPhysicalDevice, const VkDeviceCreateInfo&, PROC_LOADING = PROC_LOADING_EAGER);
 			        CDevice(const CDevice&) = delete;
 			        CDevice(CDevice&&);
 			
@@ -27,6 +29,10 @@ namespace Framework
 			CDevice& operator =(CDevice&&);
 			         operator VkDevice() const;
 			
+			//Resolves the functions that weren't used yet. Meant for lazily loaded devices, can run on a
+			//worker thread while the device is being used.
+			void    ResolveProcAddrs();
+			
 			DECLARE_FUNCTION(vkResetCommandPool)
 			DECLARE_FUNCTION(vkBeginCommandBuffer)
 			DECLARE_FUNCTION(vkEndCommandBuffer)
@@ -46,10 +52,12 @@ namespace Framework
 			DECLARE_FUNCTION(vkCmdNextSubpass)
 			DECLARE_FUNCTION(vkCmdPipelineBarrier)
 			DECLARE_FUNCTION(vkCmdPushConstants)
+			DECLARE_FUNCTION(vkCmdResetQueryPool)
 			DECLARE_FUNCTION(vkCmdSetBlendConstants)
 			DECLARE_FUNCTION(vkCmdSetScissor)
 			DECLARE_FUNCTION(vkCmdSetViewport)
 			DECLARE_FUNCTION(vkCmdUpdateBuffer)
+			DECLARE_FUNCTION(vkCmdWriteTimestamp)
 			
 			DECLARE_FUNCTION(vkGetDeviceQueue)
 			
@@ -122,6 +130,13 @@ namespace Framework
 			//Pipeline Cache
 			DECLARE_FUNCTION(vkCreatePipelineCache)
 			DECLARE_FUNCTION(vkDestroyPipelineCache)
+			DECLARE_FUNCTION(vkGetPipelineCacheData)
+			DECLARE_FUNCTION(vkMergePipelineCaches)
+			
+			//Query Pool
+			DECLARE_FUNCTION(vkCreateQueryPool)
+			DECLARE_FUNCTION(vkDestroyQueryPool)
+			DECLARE_FUNCTION(vkGetQueryPoolResults)
 			
 			//Pipeline Layout
 			DECLARE_FUNCTION(vkCreatePipelineLayout)
@@ -138,6 +153,9 @@ namespace Framework
 			//Semaphore
 			DECLARE_FUNCTION(vkCreateSemaphore)
 			DECLARE_FUNCTION(vkDestroySemaphore)
+			//Timeline semaphores, Vulkan 1.2 or VK_KHR_timeline_semaphore
+			DECLARE_FUNCTION(vkGetSemaphoreCounterValue)
+			DECLARE_FUNCTION(vkWaitSemaphores)
 			
 			//Shader Module
 			DECLARE_FUNCTION(vkCreateShaderModule)
@@ -151,10 +169,14 @@ namespace Framework
 			DECLARE_FUNCTION(vkQueuePresentKHR)
 		
 		private:
-			void    Create(VkPhysicalDevice, const VkDeviceCreateInfo&);
+			void    Create(VkPhysicalDevice, const VkDeviceCreateInfo&, PROC_LOADING);
+			void    BindProcAddrs(PROC_LOADING);
 			
 			const CInstance* m_instance = nullptr;
 			VkDevice         m_handle = VK_NULL_HANDLE;
+			const VkAllocationCallbacks* m_allocationCallbacks = nullptr;
+			//Kept on the heap, function pointers refer to it
+			std::unique_ptr<ProcResolver> m_procResolver;
 		};
 	}
 }
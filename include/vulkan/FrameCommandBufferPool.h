@@ -0,0 +1,66 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "Types.h"
+#include "Device.h"
+#include "CommandBufferPool.h"
+
+namespace Framework
+{
+	namespace Vulkan
+	{
+		//Hands out command buffers from one transient pool per recording thread and per frame in flight.
+		//Pools of a frame are reset as a whole with vkResetCommandPool when the frame comes back around,
+		//once its fence has signaled, and their command buffers are reused without being reallocated.
+		//AllocateBuffer can be called from many threads, BeginFrame can't be called concurrently with it.
+		//Pools are kept per thread id, recording threads are expected to be long lived workers.
+		//The GPU needs to be done with all frames before this is destroyed.
+		class CFrameCommandBufferPool
+		{
+		public:
+			        CFrameCommandBufferPool(CDevice&, uint32 queueFamilyIndex, uint32 frameCount);
+			        CFrameCommandBufferPool(const CFrameCommandBufferPool&) = delete;
+			virtual ~CFrameCommandBufferPool() = default;
+
+			CFrameCommandBufferPool& operator =(const CFrameCommandBufferPool&) = delete;
+
+			//Moves to the next frame, waiting for the fence given when that frame was last begun before
+			//resetting its pools. The fence needs to be signaled by the last submission of the frame.
+			//Reset it after this returns, not before.
+			void BeginFrame(VkFence);
+
+			//Command buffer stays valid until the same frame is begun again
+			VkCommandBuffer AllocateBuffer();
+
+			uint32 GetFrameIndex() const;
+			uint32 GetFrameCount() const;
+
+		private:
+			struct THREAD_POOL
+			{
+				CCommandBufferPool pool;
+				std::vector<VkCommandBuffer> commandBuffers;
+				size_t usedCount = 0;
+			};
+			typedef std::unique_ptr<THREAD_POOL> ThreadPoolPtr;
+
+			struct FRAME
+			{
+				VkFence fence = VK_NULL_HANDLE;
+				std::unordered_map<std::thread::id, ThreadPoolPtr> threadPools;
+			};
+
+			THREAD_POOL& GetThreadPool();
+
+			CDevice& m_device;
+			uint32 m_queueFamilyIndex = 0;
+			std::vector<FRAME> m_frames;
+			uint32 m_frameIndex = 0;
+			std::mutex m_mutex;
+		};
+	}
+}
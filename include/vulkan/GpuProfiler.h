@@ -0,0 +1,124 @@
+#pragma once
+
+#include <chrono>
+#include <vector>
+#include "Types.h"
+#include "Device.h"
+
+namespace Framework
+{
+	namespace Vulkan
+	{
+		//Measures GPU time of scopes recorded in command buffers with timestamp queries. Each frame
+		//in flight has its own range of queries, results of a frame are read back when its range is
+		//about to be reused, without waiting for the GPU. Frames whose results aren't available by
+		//then are dropped. CPU time spent recording each scope is measured alongside.
+		//Scope names need to outlive the results (string literals). Not thread-safe.
+		class CGpuProfiler
+		{
+		public:
+			enum
+			{
+				DEFAULT_FRAME_COUNT = 3,
+				DEFAULT_MAX_SCOPES_PER_FRAME = 256,
+			};
+
+			struct SCOPE_TIMING
+			{
+				const char* name = nullptr;
+				//Nesting level, 0 for scopes that are not inside another one
+				uint32 depth = 0;
+				double gpuMilliseconds = 0;
+				double cpuMilliseconds = 0;
+			};
+			typedef std::vector<SCOPE_TIMING> ScopeTimingArray;
+
+			//Begins a scope when constructed and ends it when destroyed
+			class CScope
+			{
+			public:
+				CScope(CGpuProfiler& profiler, VkCommandBuffer commandBuffer, const char* name)
+				    : m_profiler(profiler)
+				    , m_commandBuffer(commandBuffer)
+				    , m_scopeIndex(profiler.BeginScope(commandBuffer, name))
+				{
+				}
+
+				CScope(const CScope&) = delete;
+				CScope& operator =(const CScope&) = delete;
+
+				~CScope()
+				{
+					m_profiler.EndScope(m_commandBuffer, m_scopeIndex);
+				}
+
+			private:
+				CGpuProfiler& m_profiler;
+				VkCommandBuffer m_commandBuffer = VK_NULL_HANDLE;
+				uint32 m_scopeIndex = 0;
+			};
+
+			//timestampPeriod comes from VkPhysicalDeviceLimits, timestampValidBits from the properties
+			//of the queue family the command buffers are submitted to
+			        CGpuProfiler(CDevice&, float timestampPeriod, uint32 timestampValidBits = 64,
+			                     uint32 frameCount = DEFAULT_FRAME_COUNT, uint32 maxScopesPerFrame = DEFAULT_MAX_SCOPES_PER_FRAME);
+			        CGpuProfiler(const CGpuProfiler&) = delete;
+			virtual ~CGpuProfiler();
+
+			CGpuProfiler& operator =(const CGpuProfiler&) = delete;
+
+			//Reads back the results of the frame that used the same queries and resets them. Needs to be
+			//recorded outside of a render pass, in a command buffer submitted before the frame's scopes.
+			void BeginFrame(VkCommandBuffer);
+
+			//Scopes past the per frame limit are ignored
+			uint32 BeginScope(VkCommandBuffer, const char*);
+			void EndScope(VkCommandBuffer, uint32);
+
+			//Timings of the most recent frame that was read back, in the order scopes were begun
+			const ScopeTimingArray& GetLastFrameTimings() const;
+			//Frames that couldn't be read back because the GPU wasn't done with them
+			uint32 GetDroppedFrameCount() const;
+
+		private:
+			typedef std::chrono::steady_clock::time_point TimePoint;
+
+			enum : uint32
+			{
+				INVALID_SCOPE = ~0U,
+			};
+
+			struct SCOPE
+			{
+				const char* name = nullptr;
+				uint32 depth = 0;
+				TimePoint cpuBeginTime;
+				TimePoint cpuEndTime;
+				bool ended = false;
+			};
+
+			struct FRAME
+			{
+				std::vector<SCOPE> scopes;
+				bool pending = false;
+			};
+
+			void ReadBackFrame(uint32);
+
+			CDevice& m_device;
+			VkQueryPool m_queryPool = VK_NULL_HANDLE;
+			double m_timestampPeriod = 1;
+			uint64 m_timestampMask = ~0ULL;
+			uint32 m_maxScopesPerFrame = DEFAULT_MAX_SCOPES_PER_FRAME;
+
+			std::vector<FRAME> m_frames;
+			uint32 m_frameIndex = 0;
+			bool m_frameBegun = false;
+			uint32 m_depth = 0;
+
+			std::vector<uint64> m_queryResults;
+			ScopeTimingArray m_lastFrameTimings;
+			uint32 m_droppedFrameCount = 0;
+		};
+	}
+}
@@ -14,7 +14,11 @@ namespace Framework
 		{
 		public:
 			        CImage() = default;
-			        CImage(CDevice&, const VkPhysicalDeviceMemoryProperties&, VkImageUsageFlags, VkFormat, uint32, uint32, VkMemoryPropertyFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+			        CImage(CDevice&, const VkPhysicalDeviceMemoryProperties&, VkImageUsageFlags, VkFormat, uint32, uint32,
+			               VkMemoryPropertyFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, uint32 mipLevelCount = 1);
+			        //Memory is taken from the allocator instead of having a VkDeviceMemory of its own
+			        CImage(CMemoryAllocator&, VkImageUsageFlags, VkFormat, uint32, uint32,
+			               VkMemoryPropertyFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, uint32 mipLevelCount = 1);
 			        CImage(const CImage&) = delete;
 			        CImage(CImage&&);
 			virtual ~CImage();
@@ -22,12 +26,29 @@ namespace Framework
 			bool IsEmpty() const;
 			void Reset();
 			
+			uint32 GetWidth() const;
+			uint32 GetHeight() const;
+			uint32 GetMipLevelCount() const;
+			//Size of the first level
 			uint32 GetLinearSize() const;
 
+			//Number of levels of a full mip chain, down to 1x1
+			static uint32 GetFullMipLevelCount(uint32, uint32);
+
 			VkImageView CreateImageView();
 
 			CBuffer CreateFillStagingBuffer(const VkPhysicalDeviceMemoryProperties&, const void*) const;
 			void RecordFill(VkCommandBuffer, const CBuffer&);
+			//Copies to the first level and leaves all levels in TRANSFER_DST_OPTIMAL layout
+			void RecordCopyFromBuffer(VkCommandBuffer, VkBuffer, VkDeviceSize);
+			//Fills the other levels by blitting each level into the next one. All levels need to be in
+			//TRANSFER_DST_OPTIMAL layout (as RecordCopyFromBuffer leaves them) with the first one written.
+			//Levels end up in the given layout, available to the given access and stages.
+			//Needs TRANSFER_SRC usage, a format that can be linearly filtered and a graphics queue.
+			void RecordGenerateMipmaps(VkCommandBuffer, VkImageLayout, VkAccessFlags, VkPipelineStageFlags);
+			//Scaled copy of the first level into the first level of another image, this image needs to be
+			//in TRANSFER_SRC_OPTIMAL layout and the other one in TRANSFER_DST_OPTIMAL
+			void RecordBlit(VkCommandBuffer, CImage&, VkFilter) const;
 
 			void SetLayout(VkQueue, CCommandBufferPool&, VkImageLayout, VkAccessFlags);
 			void Clear(VkQueue, CCommandBufferPool&, const VkClearColorValue&);
@@ -39,16 +60,20 @@ namespace Framework
 
 		private:
 			void Create(const VkPhysicalDeviceMemoryProperties&, VkImageUsageFlags, VkFormat, uint32, uint32);
+			void CreateHandle(VkImageUsageFlags, VkFormat, uint32, uint32);
 			void MoveFrom(CImage&&);
 			
 			CDevice* m_device = nullptr;
 			VkImage m_handle = VK_NULL_HANDLE;
 			VkDeviceMemory m_memory = VK_NULL_HANDLE;
 			VkMemoryPropertyFlags m_properties = 0;
+			CMemoryAllocator* m_allocator = nullptr;
+			MEMORY_ALLOCATION m_allocation;
 
 			VkFormat m_format = VK_FORMAT_UNDEFINED;
 			uint32 m_width = 0;
 			uint32 m_height = 0;
+			uint32 m_mipLevelCount = 1;
 		};
 	}
 }
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "bitmap/BitmapSink.h"
+#include "Image.h"
+#include "StagingUploader.h"
+
+namespace Framework
+{
+	namespace Vulkan
+	{
+		//Lets a decoder write an image straight into the staging memory of an upload. Image needs to have
+		//the size of the decoded image and a format matching the decoder's output (ie.: R8G8B8A8 for 32 bits
+		//per pixel bitmaps). Upload is recorded once the decoder is done, staging is cancelled if it fails.
+		class CImageUploadSink : public CBitmapSink
+		{
+		public:
+			        CImageUploadSink(CStagingUploader&, CImage&, VkImageLayout, VkAccessFlags);
+			        CImageUploadSink(const CImageUploadSink&) = delete;
+			virtual ~CImageUploadSink();
+
+			CImageUploadSink& operator =(const CImageUploadSink&) = delete;
+
+			CBitmapView BeginImage(unsigned int, unsigned int, unsigned int) override;
+			void EndImage() override;
+
+			//Invalid until the decoder is done
+			CStagingUploader::UploadTicket GetTicket() const;
+
+		private:
+			CStagingUploader& m_uploader;
+			CImage& m_image;
+			VkImageLayout m_layout = VK_IMAGE_LAYOUT_UNDEFINED;
+			VkAccessFlags m_accessFlags = 0;
+			bool m_staged = false;
+			CStagingUploader::UploadTicket m_ticket = CStagingUploader::INVALID_TICKET;
+		};
+	}
+}
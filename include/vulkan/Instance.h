@@ -1,8 +1,10 @@
 #pragma once
 
+#include <memory>
 #include "VulkanDef.h"
+#include "ProcAddr.h"
 
-#define DECLARE_FUNCTION(functionName) PFN_##functionName functionName = nullptr;
+#define DECLARE_FUNCTION(functionName) CProcAddr<PFN_##functionName> functionName{#functionName};
 
 namespace Framework
 {
@@ -12,8 +14,8 @@ namespace Framework
 		{
 		public:
 			         CInstance() = default;
-			explicit CInstance(VkInstance);
-			         CInstance(const VkInstanceCreateInfo&);
+			explicit CInstance(VkInstance, PROC_LOADING = PROC_LOADING_EAGER);
+			         CInstance(const VkInstanceCreateInfo&, PROC_LOADING = PROC_LOADING_EAGER);
 			         CInstance(const CInstance&) = delete;
 			         CInstance(CInstance&&);
 			
@@ -26,6 +28,9 @@ namespace Framework
 			CInstance& operator =(CInstance&&);
 			           operator VkInstance() const;
 			
+			//Resolves the functions that weren't used yet, can run on a worker thread
+			void    ResolveProcAddrs();
+			
 			DECLARE_FUNCTION(vkDestroyInstance)
 			
 			DECLARE_FUNCTION(vkCreateDevice)
@@ -74,10 +79,13 @@ namespace Framework
 #endif
 		private:
 			void    Create(const VkInstanceCreateInfo&);
-			void    GetProcAddrs();
+			void    GetProcAddrs(PROC_LOADING);
 			
 			bool m_ownsHandle = false;
 			VkInstance m_handle = VK_NULL_HANDLE;
+			const VkAllocationCallbacks* m_allocationCallbacks = nullptr;
+			//Kept on the heap, function pointers refer to it
+			std::unique_ptr<ProcResolver> m_procResolver;
 		};
 	}
 }
@@ -3,6 +3,7 @@
 #ifdef _WIN32
 #include <Windows.h>
 #endif
+#include <future>
 #include "Singleton.h"
 #include "VulkanDef.h"
 
@@ -17,6 +18,10 @@ namespace Framework
 		public:
 			CLoader();
 			
+			//Loads the library on a worker thread, while a splash screen is shown for instance. GetInstance waits
+			//for it to be loaded. Failures are reported through the future, which blocks when destroyed.
+			static std::future<void> LoadInBackground();
+			
 			void* GetLibraryProcAddr(const char*);
 			bool IsInstanceLayerPresent(const char*);
 			bool IsInstanceExtensionPresent(const char*);
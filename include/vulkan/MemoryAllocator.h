@@ -0,0 +1,97 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "Types.h"
+#include "Device.h"
+
+namespace Framework
+{
+	namespace Vulkan
+	{
+		struct MEMORY_ALLOCATION
+		{
+			VkDeviceMemory memory = VK_NULL_HANDLE;
+			VkDeviceSize offset = 0;
+			VkDeviceSize size = 0;
+			//Points to the start of the allocation if the memory is host visible
+			void* mappedData = nullptr;
+			//Owned by the allocator, null for dedicated allocations
+			void* block = nullptr;
+		};
+
+		//Sub-allocates buffer and image memory from large blocks, so that many resources share a
+		//few VkDeviceMemory objects. Each memory type has its own blocks, buffers and images use
+		//separate blocks so that bufferImageGranularity never needs to be accounted for.
+		//Allocations bigger than half a block get their own VkDeviceMemory.
+		//Host visible blocks stay mapped for their whole lifetime since memory can't be mapped twice.
+		//Thread-safe, needs to outlive every resource allocated from it.
+		class CMemoryAllocator
+		{
+		public:
+			enum class STRATEGY
+			{
+				//Power of two sized ranges merged back with their buddy when freed,
+				//fits general purpose resources
+				BUDDY,
+				//Ranges are taken one after the other and only reclaimed once the
+				//whole block is free, fits resources that are freed together
+				LINEAR,
+			};
+
+			enum : VkDeviceSize
+			{
+				DEFAULT_BLOCK_SIZE = 64 * 1024 * 1024,
+			};
+
+			struct STATS
+			{
+				uint32 blockCount = 0;
+				uint32 dedicatedAllocationCount = 0;
+				uint32 allocationCount = 0;
+				//Sum of the sizes of VkDeviceMemory objects
+				VkDeviceSize reservedSize = 0;
+				//Sum of the sizes of allocations, including alignment padding
+				VkDeviceSize allocatedSize = 0;
+			};
+
+			        CMemoryAllocator(CDevice&, const VkPhysicalDeviceMemoryProperties&, STRATEGY = STRATEGY::BUDDY, VkDeviceSize blockSize = DEFAULT_BLOCK_SIZE);
+			        CMemoryAllocator(const CMemoryAllocator&) = delete;
+			virtual ~CMemoryAllocator();
+
+			CMemoryAllocator& operator =(const CMemoryAllocator&) = delete;
+
+			//linearResource is true for buffers and images with linear tiling
+			MEMORY_ALLOCATION Allocate(const VkMemoryRequirements&, VkMemoryPropertyFlags, bool linearResource);
+			void Free(const MEMORY_ALLOCATION&);
+
+			//Releases blocks that don't hold any allocation
+			void Trim();
+
+			STATS GetStats();
+			CDevice& GetDevice() const;
+			const VkPhysicalDeviceMemoryProperties& GetMemoryProperties() const;
+
+		private:
+			struct BLOCK;
+			typedef std::unique_ptr<BLOCK> BlockPtr;
+			typedef std::vector<BlockPtr> BlockArray;
+
+			BlockArray& GetBlocks(uint32 memoryTypeIndex, bool linearResource);
+			VkDeviceMemory AllocateDeviceMemory(uint32 memoryTypeIndex, VkDeviceSize, void** mappedData);
+			void FreeDeviceMemory(VkDeviceMemory);
+
+			CDevice& m_device;
+			VkPhysicalDeviceMemoryProperties m_memoryProperties;
+			STRATEGY m_strategy = STRATEGY::BUDDY;
+			VkDeviceSize m_blockSize = DEFAULT_BLOCK_SIZE;
+
+			std::mutex m_mutex;
+			//Indexed by memory type index * 2 + (linearResource ? 1 : 0)
+			std::vector<BlockArray> m_blocks;
+			uint32 m_dedicatedAllocationCount = 0;
+			VkDeviceSize m_dedicatedAllocationSize = 0;
+		};
+	}
+}
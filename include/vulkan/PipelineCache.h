@@ -0,0 +1,87 @@
+#pragma once
+
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "Types.h"
+#include "Device.h"
+#include "filesystem_def.h"
+
+namespace Framework
+{
+	class CThreadPool;
+
+	namespace Vulkan
+	{
+		//VkPipelineCache saved to and loaded from disk. Files are tagged with the vendor, device,
+		//driver version and pipeline cache UUID of the device and a checksum of the data, files that
+		//don't match are ignored instead of being given to the driver.
+		//Each thread compiling pipelines gets its own cache to avoid contention, those are merged
+		//in the main cache before it's saved.
+		class CPipelineCache
+		{
+		public:
+			typedef std::function<VkPipeline (VkPipelineCache)> PipelineBuilder;
+			typedef std::shared_future<VkPipeline> PipelineFuture;
+
+			        CPipelineCache(CDevice&, const VkPhysicalDeviceProperties&);
+			        CPipelineCache(const CPipelineCache&) = delete;
+			virtual ~CPipelineCache();
+
+			CPipelineCache& operator =(const CPipelineCache&) = delete;
+
+			//Replaces the content of the cache, returns false and keeps the cache empty if the file
+			//is missing or was made for another device or driver. Can't be used while pipelines
+			//are being compiled.
+			bool Load(const fs::path&);
+			//Writes to a temporary file renamed over the destination, an interrupted save doesn't
+			//leave a broken cache behind. Can't be used while pipelines are being compiled.
+			void Save(const fs::path&);
+
+			//Cache to use for pipelines compiled on the calling thread
+			VkPipelineCache GetThreadCache();
+			//Merges the caches of all threads in the main cache
+			void MergeThreadCaches();
+
+			//Runs the builder on the thread pool with the worker's cache. The builder owns
+			//whatever the create info points to. Pipeline (or exception) is given through the future.
+			PipelineFuture CompileAsync(CThreadPool&, PipelineBuilder);
+			static bool IsReady(const PipelineFuture&);
+
+			operator VkPipelineCache() const;
+
+		private:
+			struct HEADER
+			{
+				uint32 magic;
+				uint32 version;
+				uint32 vendorId;
+				uint32 deviceId;
+				uint32 driverVersion;
+				uint8 pipelineCacheUuid[VK_UUID_SIZE];
+				uint64 dataSize;
+				uint64 dataHash;
+			};
+
+			enum : uint32
+			{
+				HEADER_MAGIC = 0x43504B56, //'VKPC'
+				HEADER_VERSION = 1,
+			};
+
+			VkPipelineCache CreateCache(const void*, size_t);
+			HEADER MakeHeader() const;
+			void DestroyThreadCaches();
+
+			CDevice& m_device;
+			VkPhysicalDeviceProperties m_physicalDeviceProperties;
+			VkPipelineCache m_handle = VK_NULL_HANDLE;
+
+			std::mutex m_threadCachesMutex;
+			std::unordered_map<std::thread::id, VkPipelineCache> m_threadCaches;
+		};
+	}
+}
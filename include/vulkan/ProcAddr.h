@@ -0,0 +1,133 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <utility>
+#include "VulkanDef.h"
+
+namespace Framework
+{
+	namespace Vulkan
+	{
+		//Source of function pointers for a CProcAddr, wraps vkGetInstanceProcAddr or vkGetDeviceProcAddr
+		//with the handle they're resolved for. Needs to outlive the CProcAddrs bound to it.
+		typedef std::function<PFN_vkVoidFunction (const char*)> ProcResolver;
+
+		enum PROC_LOADING
+		{
+			//All functions are resolved when the owner is created
+			PROC_LOADING_EAGER,
+			//Functions are resolved the first time they are used or checked
+			PROC_LOADING_LAZY,
+		};
+
+		//Function pointer of an instance or device function table. Behaves like the plain pointer once resolved,
+		//calls go through a relaxed atomic load. Lazy pointers can be used and resolved from any thread.
+		template <typename FunctionType>
+		class CProcAddr
+		{
+		public:
+			explicit CProcAddr(const char* name)
+			    : m_name(name)
+			    , m_function(nullptr)
+			    , m_resolved(false)
+			{
+			}
+
+			CProcAddr(const CProcAddr&) = delete;
+
+			//Only used when swapping tables, not thread safe
+			CProcAddr(CProcAddr&& rhs)
+			    : m_name(rhs.m_name)
+			    , m_resolver(rhs.m_resolver)
+			    , m_function(rhs.m_function.load(std::memory_order_relaxed))
+			    , m_resolved(rhs.m_resolved.load(std::memory_order_relaxed))
+			{
+			}
+
+			CProcAddr& operator=(const CProcAddr&) = delete;
+
+			CProcAddr& operator=(CProcAddr&& rhs)
+			{
+				m_name = rhs.m_name;
+				m_resolver = rhs.m_resolver;
+				m_function.store(rhs.m_function.load(std::memory_order_relaxed), std::memory_order_relaxed);
+				m_resolved.store(rhs.m_resolved.load(std::memory_order_relaxed), std::memory_order_relaxed);
+				return (*this);
+			}
+
+			CProcAddr& operator=(FunctionType function)
+			{
+				m_function.store(function, std::memory_order_relaxed);
+				m_resolved.store(true, std::memory_order_release);
+				return (*this);
+			}
+
+			//Unbinds from the resolver
+			CProcAddr& operator=(std::nullptr_t)
+			{
+				m_resolver = nullptr;
+				m_function.store(nullptr, std::memory_order_relaxed);
+				m_resolved.store(false, std::memory_order_relaxed);
+				return (*this);
+			}
+
+			//Binding again to the same resolver keeps what was already resolved
+			void Bind(const ProcResolver& resolver, PROC_LOADING loading)
+			{
+				if(m_resolver != &resolver)
+				{
+					m_resolver = &resolver;
+					m_function.store(nullptr, std::memory_order_relaxed);
+					m_resolved.store(false, std::memory_order_relaxed);
+				}
+				if(loading == PROC_LOADING_EAGER)
+				{
+					Get();
+				}
+			}
+
+			//Resolves the function if needed, null if the implementation doesn't provide it
+			FunctionType Get() const
+			{
+				auto function = m_function.load(std::memory_order_relaxed);
+				if(function || !m_resolver)
+				{
+					return function;
+				}
+				if(m_resolved.load(std::memory_order_acquire))
+				{
+					//Might have been resolved by another thread since the first load
+					return m_function.load(std::memory_order_relaxed);
+				}
+				//Resolving twice from different threads gives the same pointer
+				function = reinterpret_cast<FunctionType>((*m_resolver)(m_name));
+				m_function.store(function, std::memory_order_relaxed);
+				m_resolved.store(true, std::memory_order_release);
+				return function;
+			}
+
+			explicit operator bool() const
+			{
+				return Get() != nullptr;
+			}
+
+			template <typename... ArgTypes>
+			auto operator()(ArgTypes&&... args) const
+			{
+				auto function = m_function.load(std::memory_order_relaxed);
+				if(!function)
+				{
+					function = Get();
+				}
+				return function(std::forward<ArgTypes>(args)...);
+			}
+
+		private:
+			const char* m_name = nullptr;
+			const ProcResolver* m_resolver = nullptr;
+			mutable std::atomic<FunctionType> m_function;
+			mutable std::atomic<bool> m_resolved;
+		};
+	}
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <mutex>
+#include <vector>
+#include "Types.h"
+#include "Device.h"
+
+namespace Framework
+{
+	namespace Vulkan
+	{
+		//Submits work to the graphics, async compute and transfer queues of a device. Every queue has a
+		//timeline semaphore signaled by each of its submissions, the value of a submission identifies it
+		//and other queues can wait on it. Submissions are batched per queue and sent with a single
+		//vkQueueSubmit per queue when flushed, once per frame usually.
+		//Families are picked by FindQueueFamilies and the device needs to be created with the queues from
+		//GetQueueCreateInfos, with the timelineSemaphore feature enabled. On devices without dedicated
+		//compute or transfer families, those types share the graphics queue.
+		//Resources created with VK_SHARING_MODE_EXCLUSIVE still need their ownership transferred
+		//between families by the caller.
+		//Thread-safe, queues can't be submitted to by anything else while this is alive.
+		class CQueueManager
+		{
+		public:
+			enum QUEUE_TYPE
+			{
+				QUEUE_TYPE_GRAPHICS,
+				QUEUE_TYPE_COMPUTE,
+				QUEUE_TYPE_TRANSFER,
+				QUEUE_TYPE_COUNT,
+			};
+
+			struct QUEUE_FAMILIES
+			{
+				uint32 familyIndices[QUEUE_TYPE_COUNT] = {};
+			};
+
+			//Identifies a submission, it's complete once the queue's timeline reaches the value
+			struct SUBMIT_POINT
+			{
+				QUEUE_TYPE queueType = QUEUE_TYPE_GRAPHICS;
+				uint64 value = 0;
+			};
+
+			struct WAIT
+			{
+				SUBMIT_POINT point;
+				VkPipelineStageFlags stageMask = 0;
+			};
+
+			struct SUBMISSION
+			{
+				std::vector<VkCommandBuffer> commandBuffers;
+				std::vector<WAIT> waits;
+				//Binary semaphores, for swapchain acquisition and presentation
+				std::vector<VkSemaphore> waitSemaphores;
+				std::vector<VkPipelineStageFlags> waitSemaphoreStageMasks;
+				std::vector<VkSemaphore> signalSemaphores;
+			};
+
+			//Compute and transfer prefer families without graphics (transfer also without compute),
+			//they fall back to the graphics family
+			static QUEUE_FAMILIES FindQueueFamilies(const CInstance&, VkPhysicalDevice);
+			//One queue per distinct family, to be given to VkDeviceCreateInfo
+			static std::vector<VkDeviceQueueCreateInfo> GetQueueCreateInfos(const QUEUE_FAMILIES&);
+
+			        CQueueManager(CDevice&, const QUEUE_FAMILIES&);
+			        CQueueManager(const CQueueManager&) = delete;
+			virtual ~CQueueManager();
+
+			CQueueManager& operator =(const CQueueManager&) = delete;
+
+			//Queued until the next Flush, returns the point the submission will signal
+			SUBMIT_POINT Enqueue(QUEUE_TYPE, SUBMISSION);
+			//Fence is signaled with the graphics queue's batch
+			void Flush(VkFence = VK_NULL_HANDLE);
+
+			bool IsComplete(const SUBMIT_POINT&) const;
+			//Flushes first if the point is still queued
+			void Wait(const SUBMIT_POINT&);
+			//Waits on the last point enqueued on every queue, flushes first
+			void WaitIdle();
+
+			VkQueue GetQueue(QUEUE_TYPE) const;
+			uint32 GetQueueFamilyIndex(QUEUE_TYPE) const;
+			//True if the type has its own queue and can overlap with graphics
+			bool IsDedicated(QUEUE_TYPE) const;
+
+		private:
+			struct QUEUE
+			{
+				VkQueue queue = VK_NULL_HANDLE;
+				uint32 familyIndex = 0;
+				VkSemaphore timeline = VK_NULL_HANDLE;
+				uint64 lastValue = 0;
+				uint64 flushedValue = 0;
+				std::vector<SUBMISSION> pendingSubmissions;
+			};
+
+			//Types sharing a family share the same queue and timeline
+			QUEUE& GetTypeQueue(QUEUE_TYPE);
+			const QUEUE& GetTypeQueue(QUEUE_TYPE) const;
+			void FlushQueue(QUEUE&, VkFence);
+
+			CDevice& m_device;
+			std::vector<QUEUE> m_queues;
+			uint32 m_typeQueueIndices[QUEUE_TYPE_COUNT] = {};
+			std::mutex m_mutex;
+		};
+	}
+}
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+#include "Types.h"
+#include "Device.h"
+#include "MemoryAllocator.h"
+#include "FrameCommandBufferPool.h"
+
+namespace Framework
+{
+	class CThreadPool;
+
+	namespace Vulkan
+	{
+		//Orders the work of a frame as passes that declare which images and buffers they read and write.
+		//Barriers are derived from those declarations and all the ones needed before a pass are merged in
+		//a single vkCmdPipelineBarrier. Reads following reads in the same layout don't get any barrier.
+		//Transient images only live during the frame, images whose passes don't overlap share memory.
+		//Passes are recorded on the thread pool in as many command buffers as there are threads, which
+		//are submitted in pass order. Pass callbacks of different command buffers run concurrently.
+		//Barriers are tracked for whole resources, not per subresource or range.
+		//Building the graph and compiling it isn't thread-safe.
+		class CRenderGraph
+		{
+		public:
+			typedef uint32 ResourceHandle;
+			typedef uint32 PassHandle;
+			typedef std::function<void(VkCommandBuffer)> PassCallback;
+
+			struct RESOURCE_STATE
+			{
+				VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+				VkAccessFlags accessMask = 0;
+				VkPipelineStageFlags stageMask = 0;
+			};
+
+			struct TRANSIENT_IMAGE_DESC
+			{
+				VkFormat format = VK_FORMAT_UNDEFINED;
+				uint32 width = 0;
+				uint32 height = 0;
+				uint32 mipLevelCount = 1;
+				VkImageUsageFlags usage = 0;
+				VkImageAspectFlags aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			};
+
+			        CRenderGraph(CMemoryAllocator&);
+			        CRenderGraph(const CRenderGraph&) = delete;
+			virtual ~CRenderGraph();
+
+			CRenderGraph& operator =(const CRenderGraph&) = delete;
+
+			//State is what the image was last used for before the graph executes
+			ResourceHandle ImportImage(VkImage, VkImageAspectFlags, uint32 mipLevelCount, const RESOURCE_STATE&);
+			ResourceHandle ImportBuffer(VkBuffer);
+			//Image is created by Compile
+			ResourceHandle CreateTransientImage(const TRANSIENT_IMAGE_DESC&);
+
+			//Passes execute in the order they are added
+			PassHandle AddPass(const char* name, PassCallback);
+			void ReadImage(PassHandle, ResourceHandle, VkImageLayout, VkAccessFlags, VkPipelineStageFlags);
+			void WriteImage(PassHandle, ResourceHandle, VkImageLayout, VkAccessFlags, VkPipelineStageFlags);
+			void ReadBuffer(PassHandle, ResourceHandle, VkAccessFlags, VkPipelineStageFlags);
+			void WriteBuffer(PassHandle, ResourceHandle, VkAccessFlags, VkPipelineStageFlags);
+
+			//Creates transient images and their memory. Needs to be called again after adding resources or passes,
+			//the GPU needs to be done with previous executions in that case.
+			void Compile();
+
+			//Changes an imported image between executions (swapchain image for instance)
+			void SetImportedImage(ResourceHandle, VkImage, const RESOURCE_STATE&);
+
+			VkImage GetImage(ResourceHandle) const;
+			//Only available for transient images, covers all mip levels
+			VkImageView GetImageView(ResourceHandle) const;
+			//State the resource is left in after the last pass using it, only valid after Compile
+			RESOURCE_STATE GetFinalState(ResourceHandle) const;
+
+			//Command buffers are allocated from the pool's current frame and are returned in submission order
+			std::vector<VkCommandBuffer> Record(CFrameCommandBufferPool&, CThreadPool* = nullptr);
+			//Submission info is used for the semaphores, its command buffers are ignored
+			void Execute(VkQueue, CFrameCommandBufferPool&, VkFence, CThreadPool* = nullptr, const VkSubmitInfo* = nullptr);
+
+		private:
+			enum RESOURCE_TYPE
+			{
+				RESOURCE_TYPE_IMAGE,
+				RESOURCE_TYPE_BUFFER,
+			};
+
+			struct RESOURCE
+			{
+				RESOURCE_TYPE type = RESOURCE_TYPE_IMAGE;
+				bool transient = false;
+				VkImage image = VK_NULL_HANDLE;
+				VkImageView imageView = VK_NULL_HANDLE;
+				VkBuffer buffer = VK_NULL_HANDLE;
+				VkImageAspectFlags aspectMask = 0;
+				uint32 mipLevelCount = 1;
+				TRANSIENT_IMAGE_DESC desc;
+				RESOURCE_STATE initialState;
+				//Pass indices, only valid after Compile
+				uint32 firstPass = ~0U;
+				uint32 lastPass = 0;
+				//Resources that used the same memory before this one, only valid after Compile
+				std::vector<ResourceHandle> aliasedResources;
+			};
+
+			struct ACCESS
+			{
+				ResourceHandle resource = 0;
+				bool write = false;
+				VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+				VkAccessFlags accessMask = 0;
+				VkPipelineStageFlags stageMask = 0;
+			};
+
+			struct PASS
+			{
+				const char* name = nullptr;
+				PassCallback callback;
+				std::vector<ACCESS> accesses;
+			};
+
+			//Tracked while computing barriers
+			struct TRACKED_STATE
+			{
+				VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+				VkAccessFlags writeAccess = 0;
+				VkPipelineStageFlags writeStages = 0;
+				VkPipelineStageFlags readStages = 0;
+				//Access and stages the last write has been made visible to
+				VkAccessFlags visibleAccess = 0;
+				VkPipelineStageFlags visibleStages = 0;
+			};
+
+			struct BARRIER_BATCH
+			{
+				VkPipelineStageFlags srcStages = 0;
+				VkPipelineStageFlags dstStages = 0;
+				//Covers all buffers
+				VkMemoryBarrier memoryBarrier;
+				std::vector<VkImageMemoryBarrier> imageBarriers;
+			};
+
+			void AddAccess(PassHandle, ResourceHandle, RESOURCE_TYPE, bool write, VkImageLayout, VkAccessFlags, VkPipelineStageFlags);
+			void DestroyTransients();
+			void AllocateTransients();
+			void ComputeBarriers();
+			void RecordPasses(VkCommandBuffer, uint32 firstPass, uint32 passCount);
+
+			CMemoryAllocator& m_allocator;
+			CDevice& m_device;
+			std::vector<RESOURCE> m_resources;
+			std::vector<PASS> m_passes;
+			//One batch per pass, computed by Compile and SetImportedImage
+			std::vector<BARRIER_BATCH> m_barriers;
+			std::vector<RESOURCE_STATE> m_finalStates;
+			std::vector<MEMORY_ALLOCATION> m_allocations;
+			bool m_compiled = false;
+		};
+	}
+}
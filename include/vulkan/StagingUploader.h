@@ -0,0 +1,138 @@
+#pragma once
+
+#include <deque>
+#include <vector>
+#include "Types.h"
+#include "Device.h"
+#include "Buffer.h"
+#include "CommandBufferPool.h"
+#include "MemoryAllocator.h"
+
+namespace Framework
+{
+	namespace Vulkan
+	{
+		class CImage;
+
+		//Batches buffer and image uploads in a single command buffer, staging the data in a persistently
+		//mapped ring buffer. Batches are submitted with a fence and never wait for the queue to be idle,
+		//each upload returns a ticket that can be polled or waited on before using the resource.
+		//When uploads run on a dedicated transfer queue, resources are released to the destination queue
+		//family and RecordAcquireBarriers needs to be called on a command buffer of that family before
+		//using them. Resources need to be created with VK_SHARING_MODE_EXCLUSIVE in that case.
+		//Not thread-safe.
+		class CStagingUploader
+		{
+		public:
+			typedef uint64 UploadTicket;
+
+			enum : VkDeviceSize
+			{
+				DEFAULT_RING_SIZE = 16 * 1024 * 1024,
+			};
+
+			enum : UploadTicket
+			{
+				INVALID_TICKET = 0,
+			};
+
+			        CStagingUploader(CMemoryAllocator&, VkQueue, uint32 queueFamilyIndex,
+			                         uint32 dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED, VkDeviceSize ringSize = DEFAULT_RING_SIZE);
+			        CStagingUploader(const CStagingUploader&) = delete;
+			virtual ~CStagingUploader();
+
+			CStagingUploader& operator =(const CStagingUploader&) = delete;
+
+			//Data is copied before the call returns
+			UploadTicket UploadBuffer(CBuffer&, VkDeviceSize dstOffset, const void*, VkDeviceSize size);
+			//Image ends up in the given layout and is made available to the given access.
+			//Data is the first level, the other levels are generated with CImage::RecordGenerateMipmaps
+			//which can't be done when uploading on a dedicated transfer queue.
+			UploadTicket UploadImage(CImage&, const void*, VkImageLayout, VkAccessFlags);
+
+			//Two step version of UploadImage letting the image's data be written straight into staging memory
+			//(by a decoder for instance). Returned memory holds the image's linear size and stays valid until
+			//UploadStagedImage is called. Nothing else can be uploaded or flushed in between.
+			uint8* StageImage(CImage&);
+			UploadTicket UploadStagedImage(CImage&, VkImageLayout, VkAccessFlags);
+			//Staging memory is given back along with the rest of the current batch
+			void CancelStagedImage();
+
+			//Submits the uploads recorded so far, returns the ticket of the last one
+			UploadTicket Flush();
+
+			bool IsComplete(UploadTicket);
+			//Flushes if the upload wasn't submitted yet
+			void Wait(UploadTicket);
+			void WaitIdle();
+
+			//Records the queue family ownership acquire barriers of completed uploads, does nothing
+			//if the uploader doesn't run on a dedicated transfer queue
+			void RecordAcquireBarriers(VkCommandBuffer);
+
+		private:
+			enum : VkDeviceSize
+			{
+				//Covers texel block sizes and the 4 bytes buffer to image copies need
+				STAGING_ALIGNMENT = 16,
+			};
+
+			struct BATCH
+			{
+				UploadTicket ticket = INVALID_TICKET;
+				VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+				VkFence fence = VK_NULL_HANDLE;
+				//Ring position right after the last byte staged by this batch
+				VkDeviceSize ringEnd = 0;
+				//Bytes taken from the ring, including alignment and wrap around padding
+				VkDeviceSize ringUsed = 0;
+				//Uploads that didn't fit in the ring
+				std::vector<CBuffer> oversizedStagingBuffers;
+				std::vector<VkBufferMemoryBarrier> bufferAcquireBarriers;
+				std::vector<VkImageMemoryBarrier> imageAcquireBarriers;
+			};
+
+			bool IsOwnershipTransferNeeded() const;
+
+			BATCH& GetCurrentBatch();
+			void Stage(const void*, VkDeviceSize, VkBuffer&, VkDeviceSize&);
+			uint8* AllocateStaging(VkDeviceSize, VkBuffer&, VkDeviceSize&);
+			bool TryAllocateRing(VkDeviceSize, VkDeviceSize&);
+			void WaitOldestBatch();
+			void RetireCompletedBatches();
+			void RetireBatch(BATCH&);
+
+			CDevice& m_device;
+			CMemoryAllocator& m_allocator;
+			VkQueue m_queue = VK_NULL_HANDLE;
+			uint32 m_queueFamilyIndex = 0;
+			uint32 m_dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			CCommandBufferPool m_commandBufferPool;
+
+			CBuffer m_ringBuffer;
+			uint8* m_ringData = nullptr;
+			VkDeviceSize m_ringSize = 0;
+			//Next byte to allocate and oldest byte still in use by the GPU
+			VkDeviceSize m_ringHead = 0;
+			VkDeviceSize m_ringTail = 0;
+			//Distinguishes a full ring from an empty one when head and tail meet
+			VkDeviceSize m_ringUsed = 0;
+
+			//Batches are submitted and complete in order
+			std::deque<BATCH> m_submittedBatches;
+			std::vector<BATCH> m_freeBatches;
+			BATCH m_currentBatch;
+			bool m_currentBatchOpen = false;
+			UploadTicket m_nextTicket = INVALID_TICKET + 1;
+			UploadTicket m_completedTicket = INVALID_TICKET;
+
+			//Image waiting for UploadStagedImage
+			CImage* m_stagedImage = nullptr;
+			VkBuffer m_stagedImageBuffer = VK_NULL_HANDLE;
+			VkDeviceSize m_stagedImageOffset = 0;
+
+			std::vector<VkBufferMemoryBarrier> m_pendingBufferAcquireBarriers;
+			std::vector<VkImageMemoryBarrier> m_pendingImageAcquireBarriers;
+		};
+	}
+}
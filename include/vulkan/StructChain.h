@@ -2,6 +2,9 @@
 
 #include <vector>
 #include <list>
+#include <cstddef>
+#include <tuple>
+#include <utility>
 #include "Types.h"
 
 namespace Framework
@@ -35,5 +38,82 @@ namespace Framework
 			std::list<Struct> m_structs;
 			void* m_next = nullptr;
 		};
+
+		//Chain whose struct types are known at compile time, structs are stored inline and building one
+		//doesn't allocate. The first struct is the head of the chain, each one points to the next and
+		//the last one ends it. Pointers are fixed up when the chain is copied.
+		//Usage: TStructChain<VkPhysicalDeviceFeatures2KHR, VkPhysicalDeviceVulkan12Features> chain(
+		//           PhysicalDeviceFeatures2KHR(), PhysicalDeviceVulkan12Features());
+		template <typename... StructTypes>
+		class TStructChain
+		{
+		public:
+			static_assert(sizeof...(StructTypes) != 0, "Chain needs at least one struct");
+
+			TStructChain()
+			: m_structs()
+			{
+				Link(std::index_sequence_for<StructTypes...>());
+			}
+
+			explicit TStructChain(const StructTypes&... structs)
+			: m_structs(structs...)
+			{
+				Link(std::index_sequence_for<StructTypes...>());
+			}
+
+			TStructChain(const TStructChain& rhs)
+			: m_structs(rhs.m_structs)
+			{
+				Link(std::index_sequence_for<StructTypes...>());
+			}
+
+			TStructChain& operator=(const TStructChain& rhs)
+			{
+				m_structs = rhs.m_structs;
+				Link(std::index_sequence_for<StructTypes...>());
+				return (*this);
+			}
+
+			template <typename StructType>
+			StructType& Get()
+			{
+				return std::get<StructType>(m_structs);
+			}
+
+			template <typename StructType>
+			const StructType& Get() const
+			{
+				return std::get<StructType>(m_structs);
+			}
+
+			//Head of the chain, to be put in the pNext of the struct using it
+			void* GetNext()
+			{
+				return &std::get<0>(m_structs);
+			}
+
+		private:
+			template <std::size_t... Indices>
+			void Link(std::index_sequence<Indices...>)
+			{
+				(SetNext<Indices>(), ...);
+			}
+
+			template <std::size_t Index>
+			void SetNext()
+			{
+				if constexpr(Index + 1 < sizeof...(StructTypes))
+				{
+					std::get<Index>(m_structs).pNext = &std::get<Index + 1>(m_structs);
+				}
+				else
+				{
+					std::get<Index>(m_structs).pNext = nullptr;
+				}
+			}
+
+			std::tuple<StructTypes...> m_structs;
+		};
 	}
 }
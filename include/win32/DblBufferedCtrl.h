@@ -1,17 +1,22 @@
 #pragma once
 
+#include <memory>
 #include "win32/Window.h"
+#include "win32/MemoryDeviceContext.h"
 
 namespace Framework
 {
 	namespace Win32
 	{
+		//Paints the control in a back buffer kept between paints. Only the update region is painted
+		//again and copied to the window, the rest of the back buffer is still valid.
 		template <typename Control>
 		class CDblBufferedCtrl : public CWindow
 		{
 		public:
-			CDblBufferedCtrl(Control* control)
+			CDblBufferedCtrl(Control* control, bool useDibSection = false)
 			: m_control(control)
+			, m_useDibSection(useDibSection)
 			{
 				m_hWnd = m_control->m_hWnd;
 				SubClass();
@@ -27,6 +32,12 @@ namespace Framework
 				return m_control;
 			}
 
+			//Null until the first paint. Pixels are available through GetBits with a DIB section.
+			CMemoryDeviceContext* GetBackBuffer() const
+			{
+				return m_backBuffer.get();
+			}
+
 		protected:
 			LRESULT OnWndProc(unsigned int nMsg, WPARAM wParam, LPARAM lParam) override
 			{
@@ -38,28 +49,44 @@ namespace Framework
 
 				case WM_PAINT:
 					{
-						PAINTSTRUCT ps;
-						HDC hWDC, hDC;
-						RECT rwin;
-						HBITMAP hBM;
+						//Needs to be fetched before BeginPaint validates the window
+						HRGN updateRegion = CreateRectRgn(0, 0, 0, 0);
+						GetUpdateRgn(m_hWnd, updateRegion, FALSE);
 
+						PAINTSTRUCT ps;
 						BeginPaint(m_hWnd, &ps);
-						hWDC = ps.hdc;
-
-						rwin = m_control->GetClientRect();
-
-						hDC = CreateCompatibleDC(hWDC);
-						hBM = CreateCompatibleBitmap(hWDC, rwin.right, rwin.bottom);
-						SelectObject(hDC, hBM);
-
+						HDC hWDC = ps.hdc;
+
+						RECT rwin = m_control->GetClientRect();
+
+						if(!m_backBuffer)
+						{
+							m_backBuffer = std::make_unique<CMemoryDeviceContext>(hWDC);
+						}
+						bool recreated = m_useDibSection ?
+							m_backBuffer->EnsureDibSection(rwin.right, rwin.bottom) :
+							m_backBuffer->EnsureBitmap(hWDC, rwin.right, rwin.bottom);
+						if(recreated)
+						{
+							//Nothing was kept, whole back buffer needs to be painted
+							SetRectRgn(updateRegion, 0, 0, rwin.right, rwin.bottom);
+						}
+
+						//Meta region keeps the control from painting outside of the update region
+						HDC hDC = *m_backBuffer;
+						int savedDc = SaveDC(hDC);
+						SelectClipRgn(hDC, updateRegion);
+						SetMetaRgn(hDC);
 						CallWindowProc(m_baseWndProc, m_hWnd, WM_PRINT, (WPARAM)hDC, PRF_CLIENT | PRF_ERASEBKGND);
+						RestoreDC(hDC, savedDc);
 
-						BitBlt(hWDC, 0, 0, rwin.right, rwin.bottom, hDC, 0, 0, SRCCOPY);
-
-						DeleteObject(hBM);
-						DeleteDC(hDC);
+						//Window DC is already clipped to the update region
+						BitBlt(hWDC, ps.rcPaint.left, ps.rcPaint.top,
+							ps.rcPaint.right - ps.rcPaint.left, ps.rcPaint.bottom - ps.rcPaint.top,
+							hDC, ps.rcPaint.left, ps.rcPaint.top, SRCCOPY);
 
 						EndPaint(m_hWnd, &ps);
+						DeleteObject(updateRegion);
 
 						return TRUE;
 					}
@@ -72,6 +99,8 @@ namespace Framework
 
 		private:
 			Control* m_control = nullptr;
+			bool m_useDibSection = false;
+			std::unique_ptr<CMemoryDeviceContext> m_backBuffer;
 		};
 	}
 }
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <functional>
+#include <vector>
 #include "Window.h"
 #ifndef _WIN32_WINNT
 #define _WIN32_WINNT 0x501
@@ -13,6 +15,9 @@ namespace Framework
 		class CListView : public CWindow
 		{
 		public:
+			//Fills the string with the text of an item (item, sub item, text), the string is reused between calls
+			typedef std::function<void (unsigned int, unsigned int, std::tstring&)> ItemTextProvider;
+
 							CListView(HWND = 0);
 							CListView(HWND, const RECT&, unsigned long = 0, unsigned long = WS_EX_CLIENTEDGE);
 			virtual			~CListView();
@@ -51,6 +56,32 @@ namespace Framework
 			void			EnsureItemVisible(unsigned int, bool);
 			
 			HWND			GetHeader();
+
+			//Owner data mode, needs a list view created with LVS_OWNERDATA. Text is requested from the provider
+			//for the rows hinted by LVN_ODCACHEHINT and kept until the list view hints at other rows. Parent
+			//needs to forward WM_NOTIFY to ProcessNotify.
+			void			SetItemTextProvider(ItemTextProvider);
+			void			SetVirtualItemCount(unsigned int);
+			//Needs to be called when the text of items already shown changes
+			void			InvalidateItemTextCache();
+			void			ProcessNotify(WPARAM, NMHDR*);
+
+		private:
+			enum
+			{
+				MAX_CACHE_ROWS = 1024,
+			};
+
+			void			FillItemTextCache(unsigned int, unsigned int);
+			void			GetOwnerDataItemText(NMLVDISPINFO*);
+
+			ItemTextProvider			m_itemTextProvider;
+			//Row after row, one string per column, strings keep their storage when refilled
+			std::vector<std::tstring>	m_itemTextCache;
+			unsigned int				m_cacheFirstRow = 0;
+			unsigned int				m_cacheRowCount = 0;
+			unsigned int				m_cacheColumnCount = 0;
+			std::tstring				m_itemText;
 		};
 	}
 }
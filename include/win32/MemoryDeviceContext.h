@@ -2,6 +2,7 @@
 #define _MEMORYDEVICECONTEXT_H_
 
 #include "DeviceContext.h"
+#include "GdiObj.h"
 
 namespace Framework
 {
@@ -12,6 +13,28 @@ namespace Framework
 		public:
 						CMemoryDeviceContext(HDC);
 			virtual		~CMemoryDeviceContext();
+
+			//Selects a bitmap owned by the context, compatible with the DC passed in. Bitmap is kept
+			//if it already has the right size. Returns true if it was (re)created, content is undefined then.
+			bool		EnsureBitmap(HDC, unsigned int, unsigned int);
+			//Same, with a 32 bits top-down DIB section whose pixels can be written directly
+			bool		EnsureDibSection(unsigned int, unsigned int);
+
+			unsigned int	GetWidth() const;
+			unsigned int	GetHeight() const;
+			//Only available with a DIB section, null otherwise. Rows are GetPitch() bytes apart.
+			void*		GetBits() const;
+			unsigned int	GetPitch() const;
+
+		private:
+			void		SelectBitmap(CBitmap, void*, unsigned int, unsigned int);
+
+			CBitmap		m_bitmap;
+			HGDIOBJ		m_oldBitmap = NULL;
+			void*		m_bits = nullptr;
+			bool		m_isDibSection = false;
+			unsigned int	m_width = 0;
+			unsigned int	m_height = 0;
 		};
 	}
 }
@@ -1,6 +1,8 @@
 #ifndef _TREEVIEW_H_
 #define _TREEVIEW_H_
 
+#include <functional>
+#include <vector>
 #include "Window.h"
 #include <commctrl.h>
 
@@ -11,6 +13,11 @@ namespace Framework
 		class CTreeView : public virtual CWindow
 		{
 		public:
+			//Virtual mode callbacks, items are identified by their param (0 for the root)
+			typedef std::function<void (LPARAM, std::vector<LPARAM>&)> ChildrenProvider;
+			typedef std::function<bool (LPARAM)> HasChildrenProvider;
+			typedef std::function<void (LPARAM, std::tstring&)> ItemTextProvider;
+
 							CTreeView(HWND, const RECT&, unsigned long = 0, unsigned long = WS_EX_CLIENTEDGE);
 			HTREEITEM		InsertItem(TVINSERTSTRUCT*);
 			HTREEITEM		InsertItem(HTREEITEM, const TCHAR*);
@@ -35,6 +42,20 @@ namespace Framework
 			bool			DeleteAllItems();
 			void			SortChildren(HTREEITEM, bool);
 
+			//Suspends redraw until the matching EndUpdate, calls can be nested
+			void			BeginUpdate();
+			void			EndUpdate();
+			//Inserts all items with redraw suspended, handles are written in the last parameter if not null
+			void			InsertItems(const TVINSERTSTRUCT*, size_t, HTREEITEM* = nullptr);
+
+			//Virtual mode: text and child state of items are requested with LPSTR_TEXTCALLBACK and
+			//I_CHILDRENCALLBACK, children are only inserted when their parent is expanded and are deleted
+			//when it is collapsed. Parent needs to forward WM_NOTIFY to ProcessNotify.
+			void			EnableVirtualMode(ChildrenProvider, HasChildrenProvider, ItemTextProvider);
+			//Deletes all items and inserts the root items again
+			void			ResetVirtualItems();
+			void			ProcessNotify(WPARAM, NMHDR*);
+
 			//Some templates
 			template <typename Type>
 			Type GetItemParam(HTREEITEM hItem)
@@ -54,6 +75,16 @@ namespace Framework
 			{
 				return reinterpret_cast<Type*>(GetItemParam(hItem));
 			}
+
+		private:
+			void			InsertVirtualChildren(HTREEITEM, LPARAM);
+
+			ChildrenProvider		m_childrenProvider;
+			HasChildrenProvider		m_hasChildrenProvider;
+			ItemTextProvider		m_itemTextProvider;
+			std::vector<LPARAM>		m_childParams;
+			std::tstring			m_itemText;
+			unsigned int			m_updateCount = 0;
 		};
 	}
 }
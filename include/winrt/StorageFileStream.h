@@ -1,27 +1,68 @@
 #pragma once
 
+#include <deque>
+#include <ppltasks.h>
 #include "Stream.h"
 
 namespace Framework
 {
 	namespace WinRt
 	{
+		//Reads go through the asynchronous storage APIs. In read-ahead mode, blocks following the
+		//current position are requested ahead of time so that several reads are in flight while
+		//the data already there is consumed.
 		class CStorageFileStream : public CStream
 		{
 		public:
+			enum
+			{
+				DEFAULT_READ_AHEAD_BLOCK_SIZE = 0x40000,
+				DEFAULT_READ_AHEAD_BLOCK_COUNT = 4,
+			};
+
 								CStorageFileStream();
 								CStorageFileStream(Windows::Storage::StorageFile^);
+								//Read-ahead mode, block size and number of blocks kept in flight
+								CStorageFileStream(Windows::Storage::StorageFile^, uint32, uint32);
+								CStorageFileStream(const CStorageFileStream&) = delete;
 			virtual				~CStorageFileStream();
 
-			virtual void		Seek(int64, STREAM_SEEK_DIRECTION);
-			virtual uint64		Tell();
-			virtual uint64		Read(void*, uint64);
-			virtual uint64		Write(const void*, uint64);
-			virtual bool		IsEOF();
+			CStorageFileStream&	operator =(const CStorageFileStream&) = delete;
+
+			void				Seek(int64, STREAM_SEEK_DIRECTION) override;
+			uint64				Tell() override;
+			uint64				Read(void*, uint64) override;
+			uint64				Write(const void*, uint64) override;
+			bool				IsEOF() override;
+			uint64				GetLength() override;
+
+			bool				CanAccessAt() const override;
+			uint64				ReadAt(uint64, void*, uint64) override;
+
+			//Reads at an offset without moving the stream position, any number of reads can be in flight.
+			//Buffer needs to stay valid until the task completes.
+			Concurrency::task<uint64>	ReadAtAsync(uint64, void*, uint64);
 
 		private:
+			struct BLOCK
+			{
+				uint64		offset = 0;
+				Concurrency::task<Windows::Storage::Streams::IBuffer^>	task;
+			};
+
+			void				Open(Windows::Storage::StorageFile^);
+			Concurrency::task<Windows::Storage::Streams::IBuffer^>	ReadBlockAsync(uint64, uint32);
+			uint64				ReadAhead(void*, uint64);
+			void				FillReadAhead();
+
 			Windows::Storage::Streams::IRandomAccessStream^	m_stream;
+			uint64				m_size = 0;
+			uint64				m_position = 0;
+			bool				m_isEof = false;
 
+			uint32				m_blockSize = 0;
+			uint32				m_blockCount = 0;
+			std::deque<BLOCK>	m_blocks;
 		};
 	}
 }
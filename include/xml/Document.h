@@ -0,0 +1,144 @@
+#pragma once
+
+#include <memory>
+#include <string_view>
+#include <vector>
+#include "Stream.h"
+#include "Types.h"
+#include "memory/AllocationTracker.h"
+
+namespace Framework
+{
+	class CThreadPool;
+
+	namespace Xml
+	{
+		class CDocument;
+
+		//Lightweight handle to a node of a CDocument, only valid while the document is alive
+		class CDocumentNode
+		{
+		public:
+			typedef std::vector<CDocumentNode> NodeList;
+
+										CDocumentNode() = default;
+										CDocumentNode(const CDocument*, uint32);
+
+			bool						IsValid() const;
+			explicit					operator bool() const;
+			bool						operator ==(const CDocumentNode&) const;
+			bool						operator !=(const CDocumentNode&) const;
+
+			const char*					GetText() const;
+			std::string_view			GetTextView() const;
+			const char*					GetInnerText() const;
+			bool						IsTag() const;
+
+			CDocumentNode				GetParent() const;
+			CDocumentNode				GetFirstChild() const;
+			CDocumentNode				GetNextSibling() const;
+			unsigned int				GetChildCount() const;
+
+			const char*					GetAttribute(const char*) const;
+			unsigned int				GetAttributeCount() const;
+			const char*					GetAttributeName(unsigned int) const;
+			const char*					GetAttributeValue(unsigned int) const;
+
+			CDocumentNode				Search(const char*) const;
+			CDocumentNode				Select(const char*) const;
+			NodeList					SelectNodes(const char*) const;
+
+		private:
+			template <bool> NodeList	SelectNodesImpl(const char*) const;
+			CDocumentNode				SearchImpl(std::string_view) const;
+			bool						HasName(std::string_view) const;
+
+			const CDocument*			m_document = nullptr;
+			uint32						m_index = 0;
+		};
+
+		//Read-only document that keeps all of its nodes in a single array and references
+		//names, text and attribute values in place in a copy of the source.
+		//Source text is unescaped and null terminated during parsing so strings can be returned as is.
+		class CDocument final
+		{
+		public:
+			typedef std::unique_ptr<CDocument> DocumentPtr;
+
+			static DocumentPtr			ParseDocument(CStream&);
+			static DocumentPtr			ParseDocument(std::vector<char>);
+			//Large documents are split between children of their top element, at places found by a scan
+			//of the markup, and the chunks are parsed on the pool into arrays joined afterwards. Gives the
+			//same document as the sequential parse, errors might be reported differently.
+			static DocumentPtr			ParseDocument(CStream&, CThreadPool&);
+			static DocumentPtr			ParseDocument(std::vector<char>, CThreadPool&);
+
+										CDocument(const CDocument&) = delete;
+
+			CDocument&					operator =(const CDocument&) = delete;
+
+			CDocumentNode				GetRoot() const;
+			size_t						GetNodeCount() const;
+
+		private:
+			friend class CDocumentNode;
+
+			enum : uint32
+			{
+				INVALID_INDEX = ~0U,
+			};
+
+			enum
+			{
+				//Smaller documents are parsed sequentially
+				MIN_PARALLEL_CHUNK_SIZE = 0x100000,
+			};
+
+			struct NODE
+			{
+				std::string_view		text;
+				uint32					parent = INVALID_INDEX;
+				uint32					firstChild = INVALID_INDEX;
+				uint32					lastChild = INVALID_INDEX;
+				uint32					nextSibling = INVALID_INDEX;
+				uint32					firstAttribute = 0;
+				uint32					attributeCount = 0;
+				uint32					childCount = 0;
+				bool					isTag = false;
+			};
+
+			struct ATTRIBUTE
+			{
+				std::string_view		name;
+				std::string_view		value;
+			};
+
+			//Part of a document parsed on its own, the first node stands for the top element
+			struct CHUNK
+			{
+				std::vector<NODE>		nodes;
+				std::vector<ATTRIBUTE>	attributes;
+			};
+
+										CDocument(std::vector<char>);
+
+			static std::vector<char>	ReadStream(CStream&);
+			static DocumentPtr			CreateDocument(std::vector<char>, CThreadPool*);
+
+			void						Parse();
+			void						ParseParallel(CThreadPool&);
+			void						AppendChunk(uint32, const CHUNK&, uint32, uint32);
+			static uint32				ParseRange(char*, char*, uint32, std::vector<NODE>&, std::vector<ATTRIBUTE>&);
+			static uint32				AddNode(std::vector<NODE>&, uint32, std::string_view, bool);
+			static std::string_view		UnescapeInPlace(char*, char*);
+			void						TerminateStrings();
+
+			std::vector<char>			m_buffer;
+			std::vector<NODE>			m_nodes;
+			std::vector<ATTRIBUTE>		m_attributes;
+			Memory::CAllocationRecord	m_allocationRecord;
+		};
+
+	}
+
+}
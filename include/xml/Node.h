@@ -4,6 +4,7 @@
 #include <list>
 #include <map>
 #include <memory>
+#include "StringInterner.h"
 
 namespace Framework
 {
@@ -33,6 +34,8 @@ namespace Framework
 			CNode*						InsertTagNode(const char*);
 			void						InsertNodeAt(OwningNodePtr, OwningNodeIterator);
 			const char*					GetText() const;
+			//Tag names are interned, nodes with the same tag share it and can be compared by name cheaply
+			CInternedString				GetName() const;
 			const char*					GetInnerText() const;
 			bool						IsTag() const;
 
@@ -56,7 +59,9 @@ namespace Framework
 		private:
 			template <bool> NodeList	SelectNodesImpl(const char*);
 
+			//Only used by text nodes
 			std::string					m_text;
+			CInternedString				m_name;
 			CNode*						m_parent = nullptr;
 			bool						m_isTag = false;
 			OwningNodeList				m_children;
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Node.h"
+
+namespace Framework
+{
+
+	namespace Xml
+	{
+
+		//Lookup tables of the tag nodes of a tree by name, names are case insensitive like in CNode::Select.
+		//The index is a snapshot, it needs to be rebuilt if the tree is modified.
+		class CNodeIndex
+		{
+		public:
+			typedef std::vector<CNode*> NodeArray;
+
+										CNodeIndex(CNode*);
+
+			//Tag children of a node with the given name, in document order
+			const NodeArray&			GetChildren(const CNode*, const char*) const;
+			const NodeArray&			GetChildren(const CNode*, const std::string&) const;
+
+			//Every tag node of the tree with the given name, in document order
+			const NodeArray&			GetNodes(const char*) const;
+
+			static std::string			MakeKey(const char*);
+
+		private:
+			struct CHILDKEY
+			{
+				bool operator ==(const CHILDKEY& rhs) const
+				{
+					return (parent == rhs.parent) && (name == rhs.name);
+				}
+
+				const CNode*			parent = nullptr;
+				std::string				name;
+			};
+
+			struct CHILDKEYHASH
+			{
+				size_t operator ()(const CHILDKEY& key) const
+				{
+					return std::hash<const CNode*>()(key.parent) ^ (std::hash<std::string>()(key.name) * 31);
+				}
+			};
+
+			void						IndexNode(CNode*);
+
+			std::unordered_map<CHILDKEY, NodeArray, CHILDKEYHASH>	m_children;
+			std::unordered_map<std::string, NodeArray>				m_nodes;
+			NodeArray												m_empty;
+		};
+
+	}
+
+}
@@ -17,7 +17,14 @@ namespace Framework
 		private:
 										CParser(CStream&, CNode*);
 
+			enum
+			{
+				BUFFER_SIZE = 0x10000,
+			};
+
 			bool						Parse();
+			bool						ParseBlock(const char*, const char*);
+			static const char*			FindChar(const char*, const char*, char, std::string&);
 			bool						ProcessChar_Text(char);
 			bool						ProcessChar_Tag(char);
 			bool						ProcessChar_AttributeName(char);
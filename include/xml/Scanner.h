@@ -0,0 +1,19 @@
+#pragma once
+
+namespace Framework
+{
+	namespace Xml
+	{
+		//Search kernels used by the parsers to skip over runs of characters that need no special handling.
+		//They return the position of the first matching character or the end of the range if there is none.
+		namespace Scanner
+		{
+			//Finds the next '<' or '&'
+			const char*		FindTextEnd(const char*, const char*);
+			//Finds the next whitespace, '/', '>' or '='
+			const char*		FindNameEnd(const char*, const char*);
+			//Finds the next '>' or quote, used to skip over tags without parsing their attributes
+			const char*		FindTagEnd(const char*, const char*);
+		}
+	}
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "Node.h"
+
+namespace Framework
+{
+
+	namespace Xml
+	{
+		class CNodeIndex;
+
+		//Path used with CNode::Select/SelectNodes, split once so that it can be reused on many nodes.
+		//Queries can go through an index of the tree instead of scanning children.
+		class CSelector
+		{
+		public:
+										CSelector(const char*);
+
+			CNode*						Select(CNode*, const CNodeIndex* = nullptr) const;
+			CNode::NodeList				SelectNodes(CNode*, const CNodeIndex* = nullptr) const;
+
+		private:
+			template <bool> CNode::NodeList	SelectNodesImpl(CNode*, const CNodeIndex*) const;
+
+			std::vector<std::string>	m_segments;
+			std::vector<std::string>	m_keys;
+		};
+
+	}
+
+}
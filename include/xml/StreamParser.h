@@ -0,0 +1,70 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "Node.h"
+#include "BufferedStream.h"
+
+namespace Framework
+{
+
+	namespace Xml
+	{
+
+		//Pull parser that reports elements and text as they are found in the stream instead of building a node tree.
+		//Names, text and attributes of the current event are only valid until the next call to Next.
+		class CStreamParser final
+		{
+		public:
+			typedef std::vector<AttributeType> AttributeList;
+
+			enum EVENT
+			{
+				EVENT_START_ELEMENT,
+				EVENT_END_ELEMENT,
+				EVENT_TEXT,
+				EVENT_END_DOCUMENT,
+			};
+
+										CStreamParser(CStream&);
+										CStreamParser(const CStreamParser&) = delete;
+
+			CStreamParser&				operator =(const CStreamParser&) = delete;
+
+			EVENT						Next();
+
+			//Skips everything up to the end of the element that was just started, its end event won't be reported
+			void						SkipSubtree();
+
+			const std::string&			GetName() const;
+			const std::string&			GetText() const;
+			const AttributeList&		GetAttributes() const;
+			const char*					GetAttribute(const char*) const;
+			unsigned int				GetDepth() const;
+
+		private:
+			bool						PeekChar(char&);
+			char						ReadChar();
+			void						SkipWhitespace();
+			bool						StartsWith(const char*, size_t);
+			void						ReadUntil(const char*, size_t, std::string*);
+			void						ReadName(std::string&);
+			bool						ReadText();
+			bool						SkipMarkup();
+
+			void						ParseStartTag();
+			void						ParseEndTag();
+
+			CBufferedStream				m_stream;
+			std::vector<std::string>	m_elements;
+			std::string					m_name;
+			std::string					m_text;
+			std::string					m_rawText;
+			AttributeList				m_attributes;
+			EVENT						m_event = EVENT_END_DOCUMENT;
+			bool						m_isEmptyElement = false;
+		};
+
+	}
+
+}
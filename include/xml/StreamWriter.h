@@ -0,0 +1,61 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "Stream.h"
+
+namespace Framework
+{
+	namespace Xml
+	{
+		class CWriter;
+
+		//Writes a document element by element without building a node tree first.
+		//Output is accumulated in a buffer and values are escaped straight into it.
+		class CStreamWriter final
+		{
+		public:
+			enum
+			{
+				DEFAULT_BUFFER_SIZE = 0x10000,
+			};
+
+								CStreamWriter(CStream&, size_t bufferSize = DEFAULT_BUFFER_SIZE);
+								CStreamWriter(const CStreamWriter&) = delete;
+								~CStreamWriter();
+
+			CStreamWriter&		operator =(const CStreamWriter&) = delete;
+
+			void				BeginElement(const char*);
+			//Only allowed before any content is added to the current element
+			void				Attribute(const char*, const char*);
+			void				Text(const char*);
+			void				Text(const char*, size_t);
+			void				EndElement();
+
+			void				Flush();
+
+		private:
+			friend class CWriter;
+
+			struct ELEMENT
+			{
+				std::string		name;
+				bool			hasChildren = false;
+			};
+
+			void				CloseStartTag();
+			void				WriteRaw(const char*);
+			void				WriteRaw(const char*, size_t);
+			void				WriteEscaped(const char*, size_t);
+			void				WriteTabs(unsigned int);
+
+			CStream&			m_stream;
+			std::vector<char>	m_buffer;
+			size_t				m_bufferSize = 0;
+			std::vector<ELEMENT>	m_elements;
+			bool				m_isStartTagOpen = false;
+			bool				m_isLineOpen = false;
+		};
+	}
+}
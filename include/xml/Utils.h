@@ -38,6 +38,10 @@ namespace Framework
 		AttributeType	CreateAttributeBoolValue(const char*, bool);
 
 		std::string		EscapeText(const std::string&);
+		//Returns the escape sequence to use for a character or nullptr if it can be written as is
+		const char*		GetEscapeSequence(char);
 		std::string		UnescapeText(const std::string&);
+		//Appends the unescaped text to the output, returns false if an escape sequence is invalid
+		bool			UnescapeText(const char*, size_t, std::string&);
 	}
 }
@@ -2,6 +2,7 @@
 
 #include "Stream.h"
 #include "Node.h"
+#include "StreamWriter.h"
 
 namespace Framework
 {
@@ -19,7 +20,7 @@ namespace Framework
 			void				DumpString(const char*);
 			void				DumpTabs(unsigned int);
 			void				DumpAttributes(CNode*);
-			CStream&			m_stream;
+			CStreamWriter		m_writer;
 		};
 
 	}
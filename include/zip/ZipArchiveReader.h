@@ -3,18 +3,37 @@
 #include <map>
 #include <list>
 #include <string>
+#include <string_view>
 #include <memory>
+#include <mutex>
+#include <functional>
+#include <vector>
 #include "ZipDefs.h"
 #include "Stream.h"
+#include "memory/AllocationTracker.h"
 
 namespace Framework
 {
+	class CThreadPool;
+	class CSpanStream;
+	class CZipInflateStream;
+
 	class CZipArchiveReader
 	{
 	public:
 		typedef std::map<std::string, Zip::ZIPDIRFILEHEADER> FileHeaderList;
 		typedef std::shared_ptr<Framework::CStream> StreamPtr;
 		typedef std::list<std::string> FileNameList;
+		typedef std::vector<std::string_view> FileNameViewList;
+		typedef std::function<void (const std::string&, const uint8*, size_t)> ExtractSink;
+
+		//Sizes and offset of an entry, taken from its ZIP64 field when they don't fit in its directory header
+		struct FILEINFO
+		{
+			uint64						compressedSize = 0;
+			uint64						uncompressedSize = 0;
+			uint64						fileStartOffset = 0;
+		};
 
 										CZipArchiveReader(Framework::CStream&);
 		virtual							~CZipArchiveReader() = default;
@@ -23,18 +42,55 @@ namespace Framework
 										CZipArchiveReader(const CZipArchiveReader&) = delete;
 		CZipArchiveReader&				operator =(const CZipArchiveReader&) = delete;
 
+		//Built from the directory index on first use, prefer the other accessors for large archives
 		const FileHeaderList&			GetFileHeaders() const;
 
 		StreamPtr						BeginReadFile(const char*);
 		const Zip::ZIPDIRFILEHEADER*	GetFileHeader(const char*) const;
+		const Zip::ZIPDIRFILEHEADER*	GetFileHeader(std::string_view) const;
+		const FILEINFO*					GetFileInfo(std::string_view) const;
 		FileNameList					GetFileNameList(const char*);
 
+		//Position of a stored entry's data in the archive's stream, lets it be read in place
+		//(ie.: with positional reads) instead of going through BeginReadFile. Throws if the entry is compressed.
+		uint64							GetStoredFileDataOffset(std::string_view) const;
+
+		//Sorted names starting with the prefix (ie.: "dir/"), views stay valid as long as the reader
+		FileNameViewList				GetFileNamesWithPrefix(std::string_view) const;
+
+		//Entries are inflated concurrently on the thread pool if one is provided, each task reading the archive
+		//with positional reads (entries are extracted one after the other if the stream doesn't support them).
+		//The sink receives complete entries and can be called from several threads at once.
+		void							ExtractMany(const FileNameList&, const ExtractSink&, bool verifyCrc = true, CThreadPool* = nullptr);
+		void							ExtractAll(const ExtractSink&, bool verifyCrc = true, CThreadPool* = nullptr);
+
 	private:
+		//Names point inside the central directory, which is either mapped or copied in m_directoryData
+		struct DIRECTORYENTRY
+		{
+			std::string_view			name;
+			Zip::ZIPDIRFILEHEADER		header;
+			FILEINFO					info;
+		};
+		typedef std::vector<DIRECTORYENTRY> DirectoryEntryArray;
+
+		const DIRECTORYENTRY*			FindEntry(std::string_view) const;
+		static FILEINFO					GetEntryInfo(const Zip::ZIPDIRFILEHEADER&, const uint8* extraFields);
+		static Zip::ZIPFILEHEADER		ReadFileHeader(Framework::CStream&);
+		std::vector<uint8>				ReadFileData(Framework::CStream&, const DIRECTORYENTRY&, bool) const;
+		std::unique_ptr<CZipInflateStream>	CreateInflateStream(Framework::CStream&, uint64) const;
+
 		void							Read(Framework::CStream&);
 		void							EndReadFile(Framework::CStream*);
 
 		Framework::CStream&				m_stream;
-		FileHeaderList					m_files;
+		//Compressed data is inflated in place when the archive is in memory
+		const CSpanStream*				m_spanStream = nullptr;
+		std::vector<uint8>				m_directoryData;
+		DirectoryEntryArray				m_entries;
+		mutable FileHeaderList			m_files;
+		mutable std::once_flag			m_filesInitFlag;
 		bool							m_readingLock;
+		Memory::CAllocationRecord		m_allocationRecord;
 	};
 }
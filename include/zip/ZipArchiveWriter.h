@@ -1,26 +1,101 @@
 #pragma once
 
+#include <functional>
 #include <list>
 #include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "ZipArchiveReader.h"
 #include "ZipFile.h"
+#include "ZipDefs.h"
 #include "Stream.h"
 
 namespace Framework
 {
+	class CThreadPool;
+
 	class CZipArchiveWriter
 	{
 	public:
 		typedef std::unique_ptr<CZipFile> ZipFilePtr;
+
+		enum : uint64
+		{
+			DEFAULT_MEMORY_CAP = 0x10000000,
+		};
 		
 		CZipArchiveWriter() = default;
 		virtual ~CZipArchiveWriter() = default;
 
 		void Write(Framework::CStream&);
+
+		//Entries are compressed concurrently in memory and written in insertion order as soon as they're ready.
+		//No new entry is started while the compressed entries waiting to be written use more than 'memoryCap' bytes.
+		void Write(Framework::CStream&, CThreadPool&, uint64 memoryCap = DEFAULT_MEMORY_CAP);
+
+		//Writes the archive front to back, for outputs that can't seek or tell their position (ie.: sockets
+		//or HTTP responses). Sizes and CRCs of entries are in data descriptors that follow their data.
+		//Entries are compressed as they're written, memory use doesn't depend on their size unless they
+		//need to be buffered to detect incompressible data.
+		void WriteStreamed(Framework::CStream&);
+
+		//Adds the inserted files to the archive in the stream, which has to be readable and writable, without
+		//rewriting it. Entries are written after the end of the archive, followed by a new directory listing
+		//them along with the existing entries, which stay where they are. Existing entries with the name of
+		//an inserted file are replaced, their data and the old directory stay in the archive until it's
+		//compacted. The archive is still valid if this fails halfway.
+		void Append(Framework::CStream&);
+		void Append(Framework::CStream&, CThreadPool&, uint64 memoryCap = DEFAULT_MEMORY_CAP);
+
+		//Copies the entries of an archive to another stream without recompressing them, leaving out the
+		//replaced entries and old directories left behind by appends
+		static void Compact(Framework::CStream& input, Framework::CStream& output);
+
 		void InsertFile(ZipFilePtr);
 
 	private:
 		typedef std::list<ZipFilePtr> FileList;
 
+		enum
+		{
+			//Amount of data looked at to decide if an entry is worth compressing
+			INCOMPRESSIBLE_PROBE_SIZE = 0x10000,
+			COPY_BUFFER_SIZE = 0x100000,
+		};
+
+		struct COMPRESSEDFILE
+		{
+			uint16 method = 0;
+			uint16 flags = 0;
+			uint32 crc = 0;
+			uint64 compressedSize = 0;
+			uint64 uncompressedSize = 0;
+		};
+
+		struct DIRECTORYENTRY
+		{
+			std::string fileName;
+			COMPRESSEDFILE compressedFile;
+			uint64 fileStartOffset = 0;
+		};
+		typedef std::vector<DIRECTORYENTRY> DirectoryEntryList;
+
+		DirectoryEntryList ReadKeptEntries(Framework::CStream&) const;
+		static DIRECTORYENTRY MakeExistingEntry(std::string_view, const Zip::ZIPDIRFILEHEADER&, const CZipArchiveReader::FILEINFO&);
+		void WriteEntries(Framework::CStream&, DirectoryEntryList&);
+		void WriteEntries(Framework::CStream&, CThreadPool&, uint64 memoryCap, DirectoryEntryList&);
+
+		typedef std::function<void (uint16 method)> BeginDataFunction;
+
+		static COMPRESSEDFILE CompressFile(CZipFile&, Framework::CStream&, const BeginDataFunction& = BeginDataFunction());
+		static bool IsIncompressible(const uint8*, size_t);
+		static uint16 GetVersionNeeded(const COMPRESSEDFILE&, bool isZip64);
+		//Local headers always have room for a ZIP64 field, the sizes aren't known when they're first written
+		static void WriteFileHeader(Framework::CStream&, const std::string&, const COMPRESSEDFILE&);
+		static void WriteDataDescriptor(Framework::CStream&, const COMPRESSEDFILE&);
+		static void WriteDirectory(Framework::CStream&, const DirectoryEntryList&);
+
 		FileList m_files;
 	};
 }
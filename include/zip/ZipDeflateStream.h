@@ -1,6 +1,7 @@
 #pragma once
 
-#include <zstd_zlibwrapper.h>
+#include <memory>
+#include "DeflateBackend.h"
 #include "Stream.h"
 
 namespace Framework
@@ -8,7 +9,7 @@ namespace Framework
     class CZipDeflateStream : public Framework::CStream
     {
     public:
-                        CZipDeflateStream(Framework::CStream&);
+                        CZipDeflateStream(Framework::CStream&, int level = Deflate::DEFAULT_LEVEL);
         virtual         ~CZipDeflateStream();
 
         uint32          GetCrc() const;
@@ -28,10 +29,12 @@ namespace Framework
             BUFFERSIZE = 0x2000,
         };
 
+        void                    Compress(const uint8*, size_t, bool);
+
         Framework::CStream&     m_baseStream;
         uint32                  m_crc = 0;
         uint64                  m_compressedLength = 0;
         uint64                  m_uncompressedLength = 0;
-        z_stream                m_zStream;
+        std::unique_ptr<Deflate::CCompressor> m_compressor;
     };
 }
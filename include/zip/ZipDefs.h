@@ -26,6 +26,44 @@ namespace Framework
 			DIRENDHEADER64_SIG = 0x06064B50,
 		};
 
+		enum DIRENDLOCATOR64_SIG
+		{
+			DIRENDLOCATOR64_SIG = 0x07064B50,
+		};
+
+		enum DATADESCRIPTOR_SIG
+		{
+			DATADESCRIPTOR_SIG = 0x08074B50,
+		};
+
+		enum EXTRAFIELD_ID
+		{
+			EXTRAFIELD_ID_ZIP64 = 0x0001,
+			//Keeps room for a ZIP64 field in local headers written before the sizes are known,
+			//readers skip fields they don't know about
+			EXTRAFIELD_ID_PLACEHOLDER = 0x5A46,
+		};
+
+		//Values of 16 and 32-bit fields whose actual value is in a ZIP64 record
+		enum ZIP64_MARKER : uint32
+		{
+			ZIP64_MARKER16 = 0xFFFF,
+			ZIP64_MARKER32 = 0xFFFFFFFF,
+		};
+
+		enum FLAG : uint16
+		{
+			//Sizes and CRC follow the data instead of being in the local header
+			FLAG_DATA_DESCRIPTOR = 0x08,
+		};
+
+		enum VERSION
+		{
+			VERSION_DEFAULT = 0x14,
+			VERSION_ZIP64 = 0x2D,
+			VERSION_ZSTD = 0x3F,
+		};
+
 		enum COMPRESSION_METHOD
 		{
 			STORE = 0,
@@ -99,6 +137,50 @@ namespace Framework
 			uint64 dirStartOffset;
 		};
 		static_assert(sizeof(ZIPDIRENDHEADER64) == 56);
+
+		struct ZIPDIRENDLOCATOR64
+		{
+			uint32 signature;
+			uint32 dirEndDiskNumber;
+			uint64 dirEndOffset;
+			uint32 diskCount;
+		};
+		static_assert(sizeof(ZIPDIRENDLOCATOR64) == 20);
+
+		struct ZIPEXTRAFIELDHEADER
+		{
+			uint16 id;
+			uint16 size;
+		};
+		static_assert(sizeof(ZIPEXTRAFIELDHEADER) == 4);
+
+		//ZIP64 field of local headers, both sizes are always there
+		struct ZIPLOCALZIP64FIELD
+		{
+			ZIPEXTRAFIELDHEADER header;
+			uint64 uncompressedSize;
+			uint64 compressedSize;
+		};
+		static_assert(sizeof(ZIPLOCALZIP64FIELD) == 20);
+
+		struct ZIPDATADESCRIPTOR
+		{
+			uint32 signature;
+			uint32 crc;
+			uint32 compressedSize;
+			uint32 uncompressedSize;
+		};
+		static_assert(sizeof(ZIPDATADESCRIPTOR) == 16);
+
+		//Used when the entry needs ZIP64
+		struct ZIPDATADESCRIPTOR64
+		{
+			uint32 signature;
+			uint32 crc;
+			uint64 compressedSize;
+			uint64 uncompressedSize;
+		};
+		static_assert(sizeof(ZIPDATADESCRIPTOR64) == 24);
 #pragma pack(pop)
 	}
 }
@@ -9,15 +9,43 @@ namespace Framework
 	class CZipFile
 	{
 	public:
+		enum
+		{
+			//Levels use the scale of the method's library (0 to 9 for deflate, 1 to 22 for zstd)
+			COMPRESSION_LEVEL_DEFAULT = -1,
+		};
+
+		enum COMPRESSION_METHOD
+		{
+			//Deflate through the zlib wrapper (which produces zstd data if it's set to do so)
+			COMPRESSION_METHOD_DEFAULT,
+			COMPRESSION_METHOD_STORE,
+			COMPRESSION_METHOD_ZSTD,
+		};
+
 						CZipFile(const char*);
 		virtual         ~CZipFile();
 
 		const char*     GetName() const;
 
+		int             GetCompressionLevel() const;
+		void            SetCompressionLevel(int);
+
+		COMPRESSION_METHOD	GetCompressionMethod() const;
+		void            SetCompressionMethod(COMPRESSION_METHOD);
+
+		//Data that looks already compressed (known signatures or high entropy) is stored instead.
+		//Requires buffering the whole entry before compressing.
+		bool            GetStoreIncompressible() const;
+		void            SetStoreIncompressible(bool);
+
 		virtual void    Write(Framework::CStream&) = 0;
 
 	private:
 		std::string     m_name;
+		int             m_compressionLevel = COMPRESSION_LEVEL_DEFAULT;
+		COMPRESSION_METHOD	m_compressionMethod = COMPRESSION_METHOD_DEFAULT;
+		bool            m_storeIncompressible = false;
 	};
 }
 
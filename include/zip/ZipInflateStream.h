@@ -1,7 +1,9 @@
 #ifndef _ZIPINFLATESTREAM_H_
 #define _ZIPINFLATESTREAM_H_
 
-#include <zstd_zlibwrapper.h>
+#include <memory>
+#include <vector>
+#include "DeflateBackend.h"
 #include "Stream.h"
 
 namespace Framework
@@ -9,7 +11,9 @@ namespace Framework
     class CZipInflateStream : public Framework::CStream
     {
     public:
-                                CZipInflateStream(Framework::CStream&, unsigned int);
+                                CZipInflateStream(Framework::CStream&, uint64);
+                                //Inflates compressed data that is already in memory, without copying it
+                                CZipInflateStream(const void*, uint64);
         virtual                 ~CZipInflateStream();
 
         virtual void	        Seek(int64, Framework::STREAM_SEEK_DIRECTION);
@@ -18,6 +22,9 @@ namespace Framework
 	    virtual uint64	        Write(const void*, uint64);
 	    virtual bool	        IsEOF();
 
+        //Inflates a whole entry of known size in one go, throws if the data doesn't match the size
+        void                    DecompressTo(void*, size_t);
+
     private:
         enum BUFFERSIZE
         {
@@ -25,10 +32,16 @@ namespace Framework
         };
 
         void                    FeedBuffer();
-        Framework::CStream&     m_baseStream;
-        int                     m_compressedLength;
-        z_stream                m_zStream;
-        Bytef                   m_inputBuffer[BUFFERSIZE];
+        Framework::CStream*     m_baseStream = nullptr;
+        const uint8*            m_inputData = nullptr;
+        //Compressed data not given to the decompressor yet
+        uint64                  m_compressedLength = 0;
+        std::unique_ptr<Deflate::CDecompressor> m_decompressor;
+        //Input given to the decompressor and not consumed yet
+        const uint8*            m_input = nullptr;
+        size_t                  m_inputSize = 0;
+        std::vector<uint8>      m_inputBuffer;
+        bool                    m_isEof = false;
     };
 }
 
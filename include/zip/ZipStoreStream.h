@@ -7,9 +7,14 @@ namespace Framework
 	class CZipStoreStream : public Framework::CStream
 	{
 	public:
-								CZipStoreStream(Framework::CStream&, unsigned int);
+		//Length is only used when reading, data written goes straight to the base stream
+								CZipStoreStream(Framework::CStream&, uint64 = 0);
 		virtual					~CZipStoreStream() = default;
 
+		uint32					GetCrc() const;
+		uint64					GetCompressedLength() const;
+		uint64					GetUncompressedLength() const;
+
 		void					Seek(int64, Framework::STREAM_SEEK_DIRECTION) override;
 		uint64					Tell() override;
 		uint64					Read(void*, uint64) override;
@@ -18,6 +23,8 @@ namespace Framework
 
 	private:
 		Framework::CStream&		m_baseStream;
-		unsigned int			m_length = 0;
+		uint64					m_length = 0;
+		uint32					m_crc = 0;
+		uint64					m_writtenLength = 0;
 	};
 }
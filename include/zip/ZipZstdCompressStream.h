@@ -0,0 +1,41 @@
+#pragma once
+
+#include <vector>
+#include "Stream.h"
+
+typedef struct ZSTD_CCtx_s ZSTD_CCtx;
+
+namespace Framework
+{
+	//Writes a zstd frame (zip method 93) to the base stream, data is only complete after Flush
+	class CZipZstdCompressStream : public Framework::CStream
+	{
+	public:
+		enum
+		{
+			DEFAULT_LEVEL = 3,
+		};
+
+								CZipZstdCompressStream(Framework::CStream&, int level = DEFAULT_LEVEL);
+		virtual					~CZipZstdCompressStream();
+
+		uint32					GetCrc() const;
+		uint64					GetCompressedLength() const;
+		uint64					GetUncompressedLength() const;
+
+		void					Seek(int64, Framework::STREAM_SEEK_DIRECTION) override;
+		uint64					Tell() override;
+		uint64					Read(void*, uint64) override;
+		uint64					Write(const void*, uint64) override;
+		bool					IsEOF() override;
+		void					Flush() override;
+
+	private:
+		Framework::CStream&		m_baseStream;
+		ZSTD_CCtx*				m_context = nullptr;
+		std::vector<uint8>		m_outputBuffer;
+		uint32					m_crc = 0;
+		uint64					m_compressedLength = 0;
+		uint64					m_uncompressedLength = 0;
+	};
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <vector>
+#include "Stream.h"
+
+typedef struct ZSTD_DCtx_s ZSTD_DCtx;
+
+namespace Framework
+{
+	//Reads a zstd compressed entry (zip method 93) of the given compressed length from the base stream
+	class CZipZstdDecompressStream : public Framework::CStream
+	{
+	public:
+								CZipZstdDecompressStream(Framework::CStream&, uint64);
+		virtual					~CZipZstdDecompressStream();
+
+		void					Seek(int64, Framework::STREAM_SEEK_DIRECTION) override;
+		uint64					Tell() override;
+		uint64					Read(void*, uint64) override;
+		uint64					Write(const void*, uint64) override;
+		bool					IsEOF() override;
+
+	private:
+		void					FeedBuffer();
+
+		Framework::CStream&		m_baseStream;
+		uint64					m_compressedLength = 0;
+		ZSTD_DCtx*				m_context = nullptr;
+		std::vector<uint8>		m_inputBuffer;
+		size_t					m_inputPosition = 0;
+		size_t					m_inputSize = 0;
+		bool					m_isFrameEnd = false;
+	};
+}
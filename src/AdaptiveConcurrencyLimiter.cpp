@@ -0,0 +1,86 @@
+#include "AdaptiveConcurrencyLimiter.h"
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+using namespace Framework;
+
+CAdaptiveConcurrencyLimiter::CAdaptiveConcurrencyLimiter(unsigned int initialLimit, unsigned int minLimit, unsigned int maxLimit, double decreaseRatio)
+    : m_minLimit(minLimit)
+    , m_maxLimit(maxLimit)
+    , m_decreaseRatio(decreaseRatio)
+{
+	if((minLimit == 0) || (minLimit > maxLimit) || (decreaseRatio <= 0) || (decreaseRatio >= 1))
+	{
+		throw std::runtime_error("Invalid concurrency limiter parameters.");
+	}
+	m_limit = std::clamp<double>(initialLimit, m_minLimit, m_maxLimit);
+}
+
+CAdaptiveConcurrencyLimiter::TICKET CAdaptiveConcurrencyLimiter::Acquire()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_condition.wait(lock, [this]() { return CanAcquire(); });
+	m_activeCount++;
+	TICKET ticket;
+	ticket.generation = m_generation;
+	return ticket;
+}
+
+bool CAdaptiveConcurrencyLimiter::TryAcquire(TICKET& ticket)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	if(!CanAcquire()) return false;
+	m_activeCount++;
+	ticket.generation = m_generation;
+	return true;
+}
+
+void CAdaptiveConcurrencyLimiter::Release(const TICKET& ticket, OUTCOME outcome)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	assert(m_activeCount != 0);
+	m_activeCount--;
+	auto previousLimit = static_cast<unsigned int>(m_limit);
+	switch(outcome)
+	{
+	case OUTCOME_SUCCESS:
+		m_limit = std::min(m_limit + (1.0 / m_limit), m_maxLimit);
+		break;
+	case OUTCOME_OVERLOAD:
+		if(ticket.generation == m_generation)
+		{
+			m_limit = std::max(m_limit * m_decreaseRatio, m_minLimit);
+			m_generation++;
+		}
+		break;
+	default:
+		break;
+	}
+	//One more can run, two if the limit went up
+	if(static_cast<unsigned int>(m_limit) > previousLimit)
+	{
+		m_condition.notify_all();
+	}
+	else
+	{
+		m_condition.notify_one();
+	}
+}
+
+unsigned int CAdaptiveConcurrencyLimiter::GetLimit() const
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	return static_cast<unsigned int>(m_limit);
+}
+
+unsigned int CAdaptiveConcurrencyLimiter::GetActiveCount() const
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	return m_activeCount;
+}
+
+bool CAdaptiveConcurrencyLimiter::CanAcquire() const
+{
+	return m_activeCount < static_cast<unsigned int>(m_limit);
+}
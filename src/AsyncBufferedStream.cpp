@@ -0,0 +1,322 @@
+#include <cassert>
+#include <cstring>
+#include <algorithm>
+#include "AsyncBufferedStream.h"
+
+using namespace Framework;
+
+CAsyncBufferedStream::CAsyncBufferedStream(CStream& source, CThreadPool& threadPool, size_t blockSize, unsigned int depth)
+: m_source(source)
+, m_threadPool(threadPool)
+, m_blockSize(std::max<size_t>(blockSize, 1))
+, m_depth(std::max<unsigned int>(depth, 1))
+{
+	m_position = m_source.Tell();
+}
+
+CAsyncBufferedStream::~CAsyncBufferedStream()
+{
+	Lock lock(m_mutex);
+	if(m_currentWrite && (m_currentWrite->size != 0))
+	{
+		m_writeBlocks.push_back(std::move(m_currentWrite));
+		StartPump();
+	}
+	WaitIdle(lock);
+}
+
+void CAsyncBufferedStream::Seek(int64 position, STREAM_SEEK_DIRECTION direction)
+{
+	Lock lock(m_mutex);
+	Synchronize(lock);
+	m_isEof = false;
+	switch(direction)
+	{
+	case STREAM_SEEK_SET:
+		m_source.Seek(position, STREAM_SEEK_SET);
+		m_position = position;
+		break;
+	case STREAM_SEEK_CUR:
+		m_source.Seek(m_position + position, STREAM_SEEK_SET);
+		m_position += position;
+		break;
+	case STREAM_SEEK_END:
+		m_source.Seek(position, STREAM_SEEK_END);
+		m_position = m_source.Tell();
+		break;
+	}
+}
+
+uint64 CAsyncBufferedStream::Tell()
+{
+	return m_position;
+}
+
+uint64 CAsyncBufferedStream::Read(void* data, uint64 size)
+{
+	Lock lock(m_mutex);
+	if(m_currentWrite || !m_writeBlocks.empty())
+	{
+		Synchronize(lock);
+	}
+	auto output = reinterpret_cast<uint8*>(data);
+	uint64 total = 0;
+	while(total != size)
+	{
+		if(m_readBlocks.empty())
+		{
+			if(m_sourceEof) break;
+			QueueReads();
+		}
+		m_condition.wait(lock, [&] () { return m_error || (m_filledCount != 0) || m_sourceEof; });
+		CheckError();
+		if(m_filledCount == 0) break;
+		auto& block = m_readBlocks.front();
+		size_t copySize = static_cast<size_t>(std::min<uint64>(block->size - block->offset, size - total));
+		memcpy(output + total, block->data.data() + block->offset, copySize);
+		block->offset += copySize;
+		total += copySize;
+		if(block->offset == block->size)
+		{
+			RecycleBlock(std::move(block));
+			m_readBlocks.pop_front();
+			m_filledCount--;
+			QueueReads();
+		}
+	}
+	m_position += total;
+	if(total != size)
+	{
+		m_isEof = true;
+	}
+	return total;
+}
+
+uint64 CAsyncBufferedStream::Write(const void* data, uint64 size)
+{
+	Lock lock(m_mutex);
+	CheckError();
+	if(!m_readBlocks.empty())
+	{
+		Synchronize(lock);
+	}
+	auto input = reinterpret_cast<const uint8*>(data);
+	uint64 total = 0;
+	while(total != size)
+	{
+		if(!m_currentWrite)
+		{
+			m_currentWrite = AllocateBlock();
+		}
+		size_t copySize = static_cast<size_t>(std::min<uint64>(m_blockSize - m_currentWrite->size, size - total));
+		memcpy(m_currentWrite->data.data() + m_currentWrite->size, input + total, copySize);
+		m_currentWrite->size += copySize;
+		total += copySize;
+		if(m_currentWrite->size == m_blockSize)
+		{
+			SubmitCurrentWrite(lock);
+		}
+	}
+	m_position += total;
+	return total;
+}
+
+bool CAsyncBufferedStream::IsEOF()
+{
+	return m_isEof;
+}
+
+void CAsyncBufferedStream::Flush()
+{
+	Lock lock(m_mutex);
+	if(m_currentWrite)
+	{
+		SubmitCurrentWrite(lock);
+	}
+	WaitIdle(lock);
+	CheckError();
+	m_source.Flush();
+}
+
+uint64 CAsyncBufferedStream::GetLength()
+{
+	Lock lock(m_mutex);
+	if(m_currentWrite)
+	{
+		SubmitCurrentWrite(lock);
+	}
+	//Source is left where the worker stopped, GetLength restores it
+	WaitIdle(lock);
+	CheckError();
+	return m_source.GetLength();
+}
+
+uint64 CAsyncBufferedStream::GetRemainingLength()
+{
+	return GetLength() - m_position;
+}
+
+CAsyncBufferedStream::BlockPtr CAsyncBufferedStream::AllocateBlock()
+{
+	BlockPtr block;
+	if(m_freeBlocks.empty())
+	{
+		block = std::make_unique<BLOCK>();
+		block->data.resize(m_blockSize);
+	}
+	else
+	{
+		block = std::move(m_freeBlocks.back());
+		m_freeBlocks.pop_back();
+	}
+	block->size = 0;
+	block->offset = 0;
+	return block;
+}
+
+void CAsyncBufferedStream::RecycleBlock(BlockPtr block)
+{
+	m_freeBlocks.push_back(std::move(block));
+}
+
+void CAsyncBufferedStream::QueueReads()
+{
+	if(m_sourceEof) return;
+	bool queued = false;
+	while(m_readBlocks.size() < m_depth)
+	{
+		m_readBlocks.push_back(AllocateBlock());
+		queued = true;
+	}
+	if(queued)
+	{
+		StartPump();
+	}
+}
+
+void CAsyncBufferedStream::SubmitCurrentWrite(Lock& lock)
+{
+	assert(m_currentWrite);
+	m_writeBlocks.push_back(std::move(m_currentWrite));
+	StartPump();
+	//Don't let the writer get too far ahead of the worker
+	m_condition.wait(lock, [&] () { return m_error || (m_writeBlocks.size() < m_depth); });
+	CheckError();
+}
+
+void CAsyncBufferedStream::Synchronize(Lock& lock)
+{
+	//Drains pending writes, drops prefetched data and brings the source back to our position
+	if(m_currentWrite)
+	{
+		SubmitCurrentWrite(lock);
+	}
+	WaitIdle(lock);
+	CheckError();
+	bool hadReads = !m_readBlocks.empty();
+	while(!m_readBlocks.empty())
+	{
+		RecycleBlock(std::move(m_readBlocks.front()));
+		m_readBlocks.pop_front();
+	}
+	m_filledCount = 0;
+	m_sourceEof = false;
+	if(hadReads)
+	{
+		m_source.Seek(m_position, STREAM_SEEK_SET);
+	}
+}
+
+void CAsyncBufferedStream::StartPump()
+{
+	if(m_pumpActive) return;
+	m_pumpActive = true;
+	m_threadPool.Enqueue([this] () { PumpProc(); });
+}
+
+void CAsyncBufferedStream::WaitIdle(Lock& lock)
+{
+	m_condition.wait(lock, [&] () { return !m_pumpActive; });
+}
+
+void CAsyncBufferedStream::CheckError()
+{
+	if(m_error)
+	{
+		std::rethrow_exception(m_error);
+	}
+}
+
+void CAsyncBufferedStream::PumpProc()
+{
+	while(1)
+	{
+		BLOCK* block = nullptr;
+		bool isWrite = false;
+		{
+			Lock lock(m_mutex);
+			if(!m_error && !m_writeBlocks.empty())
+			{
+				block = m_writeBlocks.front().get();
+				isWrite = true;
+			}
+			else if(!m_error && !m_sourceEof && (m_filledCount < m_readBlocks.size()))
+			{
+				block = m_readBlocks[m_filledCount].get();
+			}
+			else
+			{
+				//Notify while holding the lock, the stream might go away as soon as it's released
+				m_pumpActive = false;
+				m_condition.notify_all();
+				return;
+			}
+		}
+
+		std::exception_ptr error;
+		bool sourceEof = false;
+		try
+		{
+			if(isWrite)
+			{
+				m_source.Write(block->data.data(), block->size);
+			}
+			else
+			{
+				while(block->size != m_blockSize)
+				{
+					uint64 amountRead = m_source.Read(block->data.data() + block->size, m_blockSize - block->size);
+					block->size += static_cast<size_t>(amountRead);
+					if((amountRead == 0) || m_source.IsEOF())
+					{
+						sourceEof = true;
+						break;
+					}
+				}
+			}
+		}
+		catch(...)
+		{
+			error = std::current_exception();
+		}
+
+		{
+			Lock lock(m_mutex);
+			if(error)
+			{
+				m_error = error;
+			}
+			if(isWrite)
+			{
+				RecycleBlock(std::move(m_writeBlocks.front()));
+				m_writeBlocks.pop_front();
+			}
+			else
+			{
+				m_filledCount++;
+				m_sourceEof |= sourceEof;
+			}
+			m_condition.notify_all();
+		}
+	}
+}
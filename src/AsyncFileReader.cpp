@@ -0,0 +1,407 @@
+#include "AsyncFileReader.h"
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <stdexcept>
+#include "StdStream.h"
+#include "ThreadUtils.h"
+
+#if defined(__linux__) && !defined(__ANDROID__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define HAS_IO_URING
+#endif
+#endif
+
+#ifdef HAS_IO_URING
+#include <cstring>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace Framework;
+
+struct CAsyncFileReader::PENDING_READ
+{
+	READ_REQUEST	request;
+	int				fd = -1;
+	uint64			done = 0;
+};
+
+#ifdef HAS_IO_URING
+
+struct CAsyncFileReader::RING
+{
+	~RING()
+	{
+		if(sqes) munmap(sqes, sqesSize);
+		if(cqRing && (cqRing != sqRing)) munmap(cqRing, cqRingSize);
+		if(sqRing) munmap(sqRing, sqRingSize);
+		if(fd >= 0) close(fd);
+	}
+
+	int					fd = -1;
+	void*				sqRing = nullptr;
+	size_t				sqRingSize = 0;
+	void*				cqRing = nullptr;
+	size_t				cqRingSize = 0;
+	io_uring_sqe*		sqes = nullptr;
+	size_t				sqesSize = 0;
+
+	unsigned int*		sqHead = nullptr;
+	unsigned int*		sqTail = nullptr;
+	unsigned int*		sqMask = nullptr;
+	unsigned int*		sqArray = nullptr;
+	unsigned int		sqEntries = 0;
+
+	unsigned int*		cqHead = nullptr;
+	unsigned int*		cqTail = nullptr;
+	unsigned int*		cqMask = nullptr;
+	io_uring_cqe*		cqes = nullptr;
+};
+
+#else
+
+struct CAsyncFileReader::RING
+{
+};
+
+#endif
+
+CAsyncFileReader::CAsyncFileReader(CThreadPool& threadPool, unsigned int queueDepth)
+: m_threadPool(threadPool)
+, m_ringStop(false)
+, m_ringReadSupported(true)
+{
+	InitializeRing(queueDepth);
+}
+
+CAsyncFileReader::~CAsyncFileReader()
+{
+	if(m_reaperThread.joinable())
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_ringMutex);
+			m_ringCondition.wait(lock, [&] () { return m_ringInFlight == 0; });
+			m_ringStop = true;
+		}
+#ifdef HAS_IO_URING
+		{
+			//Wake up the reaper with a dummy request
+			std::unique_lock<std::mutex> lock(m_ringMutex);
+			unsigned int tail = *m_ring->sqTail;
+			unsigned int index = tail & *m_ring->sqMask;
+			auto sqe = m_ring->sqes + index;
+			memset(sqe, 0, sizeof(io_uring_sqe));
+			sqe->opcode = IORING_OP_NOP;
+			sqe->user_data = 0;
+			m_ring->sqArray[index] = index;
+			__atomic_store_n(m_ring->sqTail, tail + 1, __ATOMIC_RELEASE);
+			EnterRing(1, 0, 0);
+		}
+#endif
+		m_reaperThread.join();
+	}
+}
+
+bool CAsyncFileReader::IsUsingNativeQueue() const
+{
+	return m_reaperThread.joinable();
+}
+
+void CAsyncFileReader::Submit(RequestArray requests)
+{
+	RequestArray ringRequests;
+	for(auto& request : requests)
+	{
+		assert(request.stream);
+		if(CanUseRing(request))
+		{
+			ringRequests.push_back(std::move(request));
+		}
+		else
+		{
+			SubmitFallback(std::move(request));
+		}
+	}
+	if(!ringRequests.empty())
+	{
+		SubmitRing(ringRequests);
+	}
+}
+
+std::future<uint64> CAsyncFileReader::Read(CStream& stream, uint64 offset, void* buffer, uint64 size)
+{
+	auto promise = std::make_shared<std::promise<uint64>>();
+	auto future = promise->get_future();
+	READ_REQUEST request;
+	request.stream = &stream;
+	request.offset = offset;
+	request.buffer = buffer;
+	request.size = size;
+	request.callback =
+		[promise] (uint64 result, std::exception_ptr error)
+		{
+			if(error)
+			{
+				promise->set_exception(error);
+			}
+			else
+			{
+				promise->set_value(result);
+			}
+		};
+	RequestArray requests;
+	requests.push_back(std::move(request));
+	Submit(std::move(requests));
+	return future;
+}
+
+void CAsyncFileReader::SubmitFallback(READ_REQUEST request)
+{
+	m_threadPool.Enqueue(
+		[request] () mutable
+		{
+			uint64 result = 0;
+			std::exception_ptr error;
+			try
+			{
+				result = request.stream->ReadAt(request.offset, request.buffer, request.size);
+			}
+			catch(...)
+			{
+				error = std::current_exception();
+			}
+			Complete(request, result, error);
+		});
+}
+
+void CAsyncFileReader::Complete(READ_REQUEST& request, uint64 result, std::exception_ptr error)
+{
+	if(request.callback)
+	{
+		request.callback(result, error);
+	}
+}
+
+#ifdef HAS_IO_URING
+
+static int GetStreamFd(CStream* stream)
+{
+	auto stdStream = dynamic_cast<CStdStream*>(stream);
+	if(!stdStream || stdStream->IsEmpty()) return -1;
+	return fileno(static_cast<FILE*>(*stdStream));
+}
+
+void CAsyncFileReader::InitializeRing(unsigned int queueDepth)
+{
+	io_uring_params params = {};
+	int fd = syscall(__NR_io_uring_setup, std::max<unsigned int>(queueDepth, 1), &params);
+	if(fd < 0)
+	{
+		//Not supported or not allowed, stay on the fallback path
+		return;
+	}
+
+	auto ring = std::make_unique<RING>();
+	ring->fd = fd;
+	ring->sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+	ring->cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+	bool singleMmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+	if(singleMmap)
+	{
+		ring->sqRingSize = ring->cqRingSize = std::max(ring->sqRingSize, ring->cqRingSize);
+	}
+	void* sqRing = mmap(nullptr, ring->sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+	if(sqRing == MAP_FAILED) return;
+	ring->sqRing = sqRing;
+	if(singleMmap)
+	{
+		ring->cqRing = sqRing;
+	}
+	else
+	{
+		void* cqRing = mmap(nullptr, ring->cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+		if(cqRing == MAP_FAILED) return;
+		ring->cqRing = cqRing;
+	}
+	ring->sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+	void* sqes = mmap(nullptr, ring->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+	if(sqes == MAP_FAILED) return;
+	ring->sqes = reinterpret_cast<io_uring_sqe*>(sqes);
+
+	auto sqBase = reinterpret_cast<uint8*>(ring->sqRing);
+	ring->sqHead = reinterpret_cast<unsigned int*>(sqBase + params.sq_off.head);
+	ring->sqTail = reinterpret_cast<unsigned int*>(sqBase + params.sq_off.tail);
+	ring->sqMask = reinterpret_cast<unsigned int*>(sqBase + params.sq_off.ring_mask);
+	ring->sqArray = reinterpret_cast<unsigned int*>(sqBase + params.sq_off.array);
+	ring->sqEntries = params.sq_entries;
+
+	auto cqBase = reinterpret_cast<uint8*>(ring->cqRing);
+	ring->cqHead = reinterpret_cast<unsigned int*>(cqBase + params.cq_off.head);
+	ring->cqTail = reinterpret_cast<unsigned int*>(cqBase + params.cq_off.tail);
+	ring->cqMask = reinterpret_cast<unsigned int*>(cqBase + params.cq_off.ring_mask);
+	ring->cqes = reinterpret_cast<io_uring_cqe*>(cqBase + params.cq_off.cqes);
+
+	//Keep a slot for the wake up request, and never overflow the completion queue
+	m_ringMaxInFlight = std::min(params.sq_entries, params.cq_entries) - 1;
+	if(m_ringMaxInFlight == 0) return;
+	m_ring = std::move(ring);
+	m_reaperThread = std::thread([this] () { ReaperThreadProc(); });
+	ThreadUtils::SetThreadName(m_reaperThread, "AsyncFileReader Reaper");
+}
+
+bool CAsyncFileReader::CanUseRing(const READ_REQUEST& request) const
+{
+	//Only streams we can get a descriptor from can go through the ring
+	return m_reaperThread.joinable() && m_ringReadSupported && (GetStreamFd(request.stream) >= 0);
+}
+
+void CAsyncFileReader::SubmitRing(RequestArray& requests)
+{
+	std::unique_lock<std::mutex> lock(m_ringMutex);
+	unsigned int queuedCount = 0;
+	for(auto& request : requests)
+	{
+		if(m_ringInFlight == m_ringMaxInFlight)
+		{
+			EnterRing(queuedCount, 0, 0);
+			queuedCount = 0;
+			m_ringCondition.wait(lock, [&] () { return m_ringInFlight < m_ringMaxInFlight; });
+		}
+		//The ring reads from the descriptor, data still in the stdio buffer needs to reach it first
+		request.stream->Flush();
+		auto pendingRead = new PENDING_READ();
+		pendingRead->fd = GetStreamFd(request.stream);
+		pendingRead->request = std::move(request);
+		m_ringInFlight++;
+		QueueRingRead(pendingRead);
+		queuedCount++;
+	}
+	//Whole batch goes in with a single system call
+	EnterRing(queuedCount, 0, 0);
+}
+
+void CAsyncFileReader::QueueRingRead(PENDING_READ* pendingRead)
+{
+	//Ring mutex must be held
+	static const uint64 maxReadSize = 0x40000000;
+	const auto& request = pendingRead->request;
+	unsigned int tail = *m_ring->sqTail;
+	unsigned int index = tail & *m_ring->sqMask;
+	auto sqe = m_ring->sqes + index;
+	memset(sqe, 0, sizeof(io_uring_sqe));
+	sqe->opcode = IORING_OP_READ;
+	sqe->fd = pendingRead->fd;
+	sqe->off = request.offset + pendingRead->done;
+	sqe->addr = reinterpret_cast<uintptr_t>(request.buffer) + pendingRead->done;
+	sqe->len = static_cast<uint32>(std::min(request.size - pendingRead->done, maxReadSize));
+	sqe->user_data = reinterpret_cast<uintptr_t>(pendingRead);
+	m_ring->sqArray[index] = index;
+	__atomic_store_n(m_ring->sqTail, tail + 1, __ATOMIC_RELEASE);
+}
+
+void CAsyncFileReader::EnterRing(unsigned int toSubmit, unsigned int minComplete, unsigned int flags)
+{
+	while(1)
+	{
+		int result = syscall(__NR_io_uring_enter, m_ring->fd, toSubmit, minComplete, flags, nullptr, 0);
+		if((result >= 0) || (errno != EINTR)) break;
+	}
+}
+
+void CAsyncFileReader::ReaperThreadProc()
+{
+	while(1)
+	{
+		EnterRing(0, 1, IORING_ENTER_GETEVENTS);
+		unsigned int head = *m_ring->cqHead;
+		unsigned int tail = __atomic_load_n(m_ring->cqTail, __ATOMIC_ACQUIRE);
+		for(; head != tail; head++)
+		{
+			const auto& cqe = m_ring->cqes[head & *m_ring->cqMask];
+			auto pendingRead = reinterpret_cast<PENDING_READ*>(static_cast<uintptr_t>(cqe.user_data));
+			if(!pendingRead) continue;
+			const auto& request = pendingRead->request;
+			if(cqe.res > 0)
+			{
+				pendingRead->done += cqe.res;
+				if(pendingRead->done < request.size)
+				{
+					//Short read, ask for the rest
+					std::unique_lock<std::mutex> lock(m_ringMutex);
+					QueueRingRead(pendingRead);
+					EnterRing(1, 0, 0);
+					continue;
+				}
+			}
+			if((cqe.res == -EINVAL) && (pendingRead->done == 0))
+			{
+				//Read operation isn't supported by this kernel, go through ReadAt from now on
+				m_ringReadSupported = false;
+				std::unique_ptr<PENDING_READ> pendingReadPtr(pendingRead);
+				SubmitFallback(std::move(pendingReadPtr->request));
+				{
+					std::unique_lock<std::mutex> lock(m_ringMutex);
+					m_ringInFlight--;
+				}
+				m_ringCondition.notify_all();
+				continue;
+			}
+			std::exception_ptr error;
+			if(cqe.res < 0)
+			{
+				error = std::make_exception_ptr(std::runtime_error("Read failed."));
+			}
+			uint64 result = pendingRead->done;
+			m_threadPool.Enqueue(
+				[pendingRead, result, error] ()
+				{
+					std::unique_ptr<PENDING_READ> pendingReadPtr(pendingRead);
+					Complete(pendingReadPtr->request, result, error);
+				});
+			{
+				std::unique_lock<std::mutex> lock(m_ringMutex);
+				m_ringInFlight--;
+			}
+			m_ringCondition.notify_all();
+		}
+		__atomic_store_n(m_ring->cqHead, head, __ATOMIC_RELEASE);
+		if(m_ringStop) break;
+	}
+}
+
+#else
+
+void CAsyncFileReader::InitializeRing(unsigned int)
+{
+
+}
+
+bool CAsyncFileReader::CanUseRing(const READ_REQUEST&) const
+{
+	return false;
+}
+
+void CAsyncFileReader::SubmitRing(RequestArray&)
+{
+
+}
+
+void CAsyncFileReader::QueueRingRead(PENDING_READ*)
+{
+
+}
+
+void CAsyncFileReader::EnterRing(unsigned int, unsigned int, unsigned int)
+{
+
+}
+
+void CAsyncFileReader::ReaperThreadProc()
+{
+
+}
+
+#endif
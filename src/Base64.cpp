@@ -1,6 +1,15 @@
 #include <string.h>
 #include <stdexcept>
 #include "Base64.h"
+#include "CpuFeatures.h"
+#include "SimdDefs.h"
+
+#if defined(FRAMEWORK_SIMD_HAS_X86_DISPATCH)
+#include <immintrin.h>
+#elif defined(FRAMEWORK_SIMD_USE_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define BASE64_USE_NEON
+#endif
 
 using namespace Framework;
 
@@ -12,93 +21,361 @@ static const uint8 g_encodeLookupTable[64] =
 	0x77, 0x78, 0x79, 0x7A, 0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x2B, 0x2F
 };
 
-static const int g_decodeLookupTable[128] = 
+//0xFF marks characters outside of the alphabet
+static const uint8 g_decodeLookupTable[128] =
 {
-	-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
-	-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
-	-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,62,-1,-1,-1,63,
-	52,53,54,55,56,57,58,59,60,61,-1,-1,-1,-1,-1,-1,
-	-1, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9,10,11,12,13,14,
-	15,16,17,18,19,20,21,22,23,24,25,-1,-1,-1,-1,-1,
-	-1,26,27,28,29,30,31,32,33,34,35,36,37,38,39,40,
-	41,42,43,44,45,46,47,48,49,50,51,-1,-1,-1,-1,-1
+	0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,
+	0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,
+	0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,  62,0xFF,0xFF,0xFF,  63,
+	  52,  53,  54,  55,  56,  57,  58,  59,  60,  61,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,
+	0xFF,   0,   1,   2,   3,   4,   5,   6,   7,   8,   9,  10,  11,  12,  13,  14,
+	  15,  16,  17,  18,  19,  20,  21,  22,  23,  24,  25,0xFF,0xFF,0xFF,0xFF,0xFF,
+	0xFF,  26,  27,  28,  29,  30,  31,  32,  33,  34,  35,  36,  37,  38,  39,  40,
+	  41,  42,  43,  44,  45,  46,  47,  48,  49,  50,  51,0xFF,0xFF,0xFF,0xFF,0xFF
 };
 
-std::string Framework::ToBase64(const std::string& source)
+//Kernels process as much as they can of the input and return how much they consumed, a multiple of
+//3 bytes when encoding and 4 characters when decoding. Decoders stop before invalid characters, and
+//can write scratch bytes past their output as long as they stay within the total decoded size.
+typedef size_t (*EncodeFunction)(const uint8*, size_t, char*);
+typedef size_t (*DecodeFunction)(const char*, size_t, uint8*);
+
+static uint8 DecodeChar(char value)
 {
-	return ToBase64(source.c_str(), source.size());
+	uint8 index = static_cast<uint8>(value);
+	return (index < 128) ? g_decodeLookupTable[index] : 0xFF;
 }
 
-std::string Framework::ToBase64(const void* source, size_t sourceLength)
+static size_t EncodeScalar(const uint8* input, size_t inputSize, char* output)
+{
+	size_t consumed = 0;
+	for(; (inputSize - consumed) >= 3; consumed += 3, input += 3, output += 4)
+	{
+		uint32 value = (static_cast<uint32>(input[0]) << 16) | (static_cast<uint32>(input[1]) << 8) | input[2];
+		output[0] = g_encodeLookupTable[(value >> 18) & 0x3F];
+		output[1] = g_encodeLookupTable[(value >> 12) & 0x3F];
+		output[2] = g_encodeLookupTable[(value >> 6) & 0x3F];
+		output[3] = g_encodeLookupTable[value & 0x3F];
+	}
+	return consumed;
+}
+
+static size_t DecodeScalar(const char* input, size_t inputSize, uint8* output)
+{
+	size_t consumed = 0;
+	for(; (inputSize - consumed) >= 4; consumed += 4, input += 4, output += 3)
+	{
+		uint8 values[4] = {DecodeChar(input[0]), DecodeChar(input[1]), DecodeChar(input[2]), DecodeChar(input[3])};
+		if((values[0] | values[1] | values[2] | values[3]) & 0xC0) break;
+		uint32 value = (values[0] << 18) | (values[1] << 12) | (values[2] << 6) | values[3];
+		output[0] = static_cast<uint8>(value >> 16);
+		output[1] = static_cast<uint8>(value >> 8);
+		output[2] = static_cast<uint8>(value);
+	}
+	return consumed;
+}
+
+#if defined(FRAMEWORK_SIMD_HAS_X86_DISPATCH)
+
+//Vectorized encoding and decoding as described in "Faster Base64 Encoding and Decoding using AVX2
+//Instructions" (Muła & Lemire, 2018)
+
+//Spreads 12 bytes to 16 bytes, each holding 6 bits
+FRAMEWORK_SIMD_TARGET_SSSE3 static __m128i EncodeReshuffle(__m128i input)
 {
-	std::string result;
+	__m128i values = _mm_shuffle_epi8(input, _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10));
+	__m128i t0 = _mm_mulhi_epu16(_mm_and_si128(values, _mm_set1_epi32(0x0FC0FC00)), _mm_set1_epi32(0x04000040));
+	__m128i t1 = _mm_mullo_epi16(_mm_and_si128(values, _mm_set1_epi32(0x003F03F0)), _mm_set1_epi32(0x01000010));
+	return _mm_or_si128(t0, t1);
+}
 
-	size_t paddedSourceLength = ((sourceLength + 2) / 3) * 3;
-	for(unsigned int i = 0; i < paddedSourceLength; i += 3)
+//Adds the offset of the range each 6 bit value falls into: A-Z, a-z, 0-9, + and /
+FRAMEWORK_SIMD_TARGET_SSSE3 static __m128i EncodeTranslate(__m128i values)
+{
+	const __m128i offsets = _mm_setr_epi8(65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0);
+	__m128i indices = _mm_subs_epu8(values, _mm_set1_epi8(51));
+	indices = _mm_sub_epi8(indices, _mm_cmpgt_epi8(values, _mm_set1_epi8(25)));
+	return _mm_add_epi8(values, _mm_shuffle_epi8(offsets, indices));
+}
+
+FRAMEWORK_SIMD_TARGET_SSSE3 static size_t EncodeSsse3(const uint8* input, size_t inputSize, char* output)
+{
+	size_t consumed = 0;
+	//Loads 16 bytes but only uses 12
+	for(; (inputSize - consumed) >= 16; consumed += 12, input += 12, output += 16)
 	{
-		uint8 srcValues[3] = { 0, 0, 0 };
-		for(unsigned int j = 0; j < 3; j++)
+		__m128i values = EncodeReshuffle(_mm_loadu_si128(reinterpret_cast<const __m128i*>(input)));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(output), EncodeTranslate(values));
+	}
+	return consumed;
+}
+
+FRAMEWORK_SIMD_TARGET_AVX2 static size_t EncodeAvx2(const uint8* input, size_t inputSize, char* output)
+{
+	const __m256i shuffle = _mm256_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+	                                         1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+	const __m256i offsets = _mm256_setr_epi8(65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0,
+	                                         65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0);
+	size_t consumed = 0;
+	//Each lane gets 12 bytes, the load for the upper one goes 4 bytes further
+	for(; (inputSize - consumed) >= 28; consumed += 24, input += 24, output += 32)
+	{
+		__m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input));
+		__m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + 12));
+		__m256i values = _mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1);
+		values = _mm256_shuffle_epi8(values, shuffle);
+		__m256i t0 = _mm256_mulhi_epu16(_mm256_and_si256(values, _mm256_set1_epi32(0x0FC0FC00)), _mm256_set1_epi32(0x04000040));
+		__m256i t1 = _mm256_mullo_epi16(_mm256_and_si256(values, _mm256_set1_epi32(0x003F03F0)), _mm256_set1_epi32(0x01000010));
+		values = _mm256_or_si256(t0, t1);
+		__m256i indices = _mm256_subs_epu8(values, _mm256_set1_epi8(51));
+		indices = _mm256_sub_epi8(indices, _mm256_cmpgt_epi8(values, _mm256_set1_epi8(25)));
+		values = _mm256_add_epi8(values, _mm256_shuffle_epi8(offsets, indices));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(output), values);
+	}
+	return consumed + EncodeSsse3(input, inputSize - consumed, output);
+}
+
+//Characters are classified by their nibbles, a valid character has no bit in common between its
+//low and high nibble classes. The high nibble then gives the offset to apply, except for '/'.
+FRAMEWORK_SIMD_TARGET_SSSE3 static size_t DecodeSsse3(const char* input, size_t inputSize, uint8* output)
+{
+	const __m128i lowClasses = _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+	const __m128i highClasses = _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+	const __m128i offsets = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+	const __m128i mask2F = _mm_set1_epi8(0x2F);
+	size_t consumed = 0;
+	//Stores 16 bytes but only produces 12, the rest of the input covers the extra bytes
+	for(; (inputSize - consumed) >= 24; consumed += 16, input += 16, output += 12)
+	{
+		__m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input));
+		__m128i highNibbles = _mm_and_si128(_mm_srli_epi32(chars, 4), mask2F);
+		__m128i lowNibbles = _mm_and_si128(chars, mask2F);
+		__m128i classes = _mm_and_si128(_mm_shuffle_epi8(lowClasses, lowNibbles), _mm_shuffle_epi8(highClasses, highNibbles));
+		if(_mm_movemask_epi8(_mm_cmpgt_epi8(classes, _mm_setzero_si128())) != 0) break;
+		__m128i isSlash = _mm_cmpeq_epi8(chars, mask2F);
+		__m128i values = _mm_add_epi8(chars, _mm_shuffle_epi8(offsets, _mm_add_epi8(isSlash, highNibbles)));
+		//Merge 4 x 6 bits to 24 bits and pack them
+		values = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+		values = _mm_madd_epi16(values, _mm_set1_epi32(0x00011000));
+		values = _mm_shuffle_epi8(values, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(output), values);
+	}
+	return consumed;
+}
+
+FRAMEWORK_SIMD_TARGET_AVX2 static size_t DecodeAvx2(const char* input, size_t inputSize, uint8* output)
+{
+	const __m256i lowClasses = _mm256_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A,
+	                                            0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+	const __m256i highClasses = _mm256_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+	                                             0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+	const __m256i offsets = _mm256_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+	                                         0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+	const __m256i pack = _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+	                                      2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+	const __m256i mask2F = _mm256_set1_epi8(0x2F);
+	size_t consumed = 0;
+	//Stores 32 bytes but only produces 24, the rest of the input covers the extra bytes
+	for(; (inputSize - consumed) >= 44; consumed += 32, input += 32, output += 24)
+	{
+		__m256i chars = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input));
+		__m256i highNibbles = _mm256_and_si256(_mm256_srli_epi32(chars, 4), mask2F);
+		__m256i lowNibbles = _mm256_and_si256(chars, mask2F);
+		if(!_mm256_testz_si256(_mm256_shuffle_epi8(lowClasses, lowNibbles), _mm256_shuffle_epi8(highClasses, highNibbles))) break;
+		__m256i isSlash = _mm256_cmpeq_epi8(chars, mask2F);
+		__m256i values = _mm256_add_epi8(chars, _mm256_shuffle_epi8(offsets, _mm256_add_epi8(isSlash, highNibbles)));
+		values = _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140));
+		values = _mm256_madd_epi16(values, _mm256_set1_epi32(0x00011000));
+		values = _mm256_shuffle_epi8(values, pack);
+		//Move the 12 bytes of the upper lane next to the ones of the lower lane
+		values = _mm256_permutevar8x32_epi32(values, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(output), values);
+	}
+	return consumed + DecodeSsse3(input, inputSize - consumed, output);
+}
+
+#elif defined(BASE64_USE_NEON)
+
+//De-interleaving loads and interleaving stores do the byte shuffling
+static size_t EncodeNeon(const uint8* input, size_t inputSize, char* output)
+{
+	uint8x16x4_t table;
+	for(unsigned int i = 0; i < 4; i++)
+	{
+		table.val[i] = vld1q_u8(g_encodeLookupTable + (i * 16));
+	}
+	const uint8x16_t mask3F = vdupq_n_u8(0x3F);
+	size_t consumed = 0;
+	for(; (inputSize - consumed) >= 48; consumed += 48, input += 48, output += 64)
+	{
+		uint8x16x3_t values = vld3q_u8(input);
+		uint8x16x4_t indices;
+		indices.val[0] = vshrq_n_u8(values.val[0], 2);
+		indices.val[1] = vandq_u8(vorrq_u8(vshrq_n_u8(values.val[1], 4), vshlq_n_u8(values.val[0], 4)), mask3F);
+		indices.val[2] = vandq_u8(vorrq_u8(vshrq_n_u8(values.val[2], 6), vshlq_n_u8(values.val[1], 2)), mask3F);
+		indices.val[3] = vandq_u8(values.val[2], mask3F);
+		uint8x16x4_t chars;
+		for(unsigned int i = 0; i < 4; i++)
 		{
-			if(i + j >= sourceLength) continue;
-			srcValues[j] = *(reinterpret_cast<const uint8*>(source) + i + j);
+			chars.val[i] = vqtbl4q_u8(table, indices.val[i]);
 		}
-		uint8 dstValues[4];
-		dstValues[0] = (srcValues[0] & 0xFC) >> 2;
-		dstValues[1] = ((srcValues[0] & 0x03) << 4) | ((srcValues[1] & 0xF0) >> 4);
-		dstValues[2] = ((srcValues[1] & 0x0F) << 2) | ((srcValues[2] & 0xC0) >> 6);
-		dstValues[3] = (srcValues[2] & 0x3F);
-
-		dstValues[0] = g_encodeLookupTable[dstValues[0] & 0x3F];
-		dstValues[1] = g_encodeLookupTable[dstValues[1] & 0x3F];
-		dstValues[2] = ((i + 1) >= sourceLength) ? '=' : g_encodeLookupTable[dstValues[2] & 0x3F];
-		dstValues[3] = ((i + 2) >= sourceLength) ? '=' : g_encodeLookupTable[dstValues[3] & 0x3F];
-
-		result += dstValues[0];
-		result += dstValues[1];
-		result += dstValues[2];
-		result += dstValues[3];
+		vst4q_u8(reinterpret_cast<uint8*>(output), chars);
 	}
+	return consumed;
+}
+
+static size_t DecodeNeon(const char* input, size_t inputSize, uint8* output)
+{
+	uint8x16x4_t lowTable;
+	uint8x16x4_t highTable;
+	for(unsigned int i = 0; i < 4; i++)
+	{
+		lowTable.val[i] = vld1q_u8(g_decodeLookupTable + (i * 16));
+		highTable.val[i] = vld1q_u8(g_decodeLookupTable + 64 + (i * 16));
+	}
+	const uint8x16_t offset64 = vdupq_n_u8(64);
+	size_t consumed = 0;
+	for(; (inputSize - consumed) >= 64; consumed += 64, input += 64, output += 48)
+	{
+		uint8x16x4_t chars = vld4q_u8(reinterpret_cast<const uint8*>(input));
+		uint8x16x4_t values;
+		uint8x16_t errors = vdupq_n_u8(0);
+		for(unsigned int i = 0; i < 4; i++)
+		{
+			//Out of range indices give 0, characters above 127 are caught by their top bit
+			values.val[i] = vorrq_u8(vqtbl4q_u8(lowTable, chars.val[i]), vqtbl4q_u8(highTable, vsubq_u8(chars.val[i], offset64)));
+			errors = vorrq_u8(errors, vorrq_u8(values.val[i], chars.val[i]));
+		}
+		if(vmaxvq_u8(errors) & 0x80) break;
+		uint8x16x3_t bytes;
+		bytes.val[0] = vorrq_u8(vshlq_n_u8(values.val[0], 2), vshrq_n_u8(values.val[1], 4));
+		bytes.val[1] = vorrq_u8(vshlq_n_u8(values.val[1], 4), vshrq_n_u8(values.val[2], 2));
+		bytes.val[2] = vorrq_u8(vshlq_n_u8(values.val[2], 6), values.val[3]);
+		vst3q_u8(output, bytes);
+	}
+	return consumed;
+}
+
+#endif
+
+static EncodeFunction SelectEncodeFunction()
+{
+	CKernelDispatcher<EncodeFunction> dispatcher(&EncodeScalar);
+#if defined(FRAMEWORK_SIMD_HAS_X86_DISPATCH)
+	dispatcher.Register(CCpuFeatures::FEATURE_SSSE3, &EncodeSsse3);
+	dispatcher.Register(CCpuFeatures::FEATURE_AVX2, &EncodeAvx2);
+#elif defined(BASE64_USE_NEON)
+	dispatcher.Register(CCpuFeatures::FEATURE_NEON, &EncodeNeon);
+#endif
+	return dispatcher.Get();
+}
+
+static DecodeFunction SelectDecodeFunction()
+{
+	CKernelDispatcher<DecodeFunction> dispatcher(&DecodeScalar);
+#if defined(FRAMEWORK_SIMD_HAS_X86_DISPATCH)
+	dispatcher.Register(CCpuFeatures::FEATURE_SSSE3, &DecodeSsse3);
+	dispatcher.Register(CCpuFeatures::FEATURE_AVX2, &DecodeAvx2);
+#elif defined(BASE64_USE_NEON)
+	dispatcher.Register(CCpuFeatures::FEATURE_NEON, &DecodeNeon);
+#endif
+	return dispatcher.Get();
+}
+
+static size_t GetBase64DataSize(const char* source, size_t size)
+{
+	//Padding is only allowed to complete the last group
+	size_t dataSize = size;
+	if(((size % 4) == 0) && (dataSize != 0) && (source[dataSize - 1] == '=')) dataSize--;
+	if(((size % 4) == 0) && (dataSize != 0) && (source[dataSize - 1] == '=')) dataSize--;
+	if((dataSize % 4) == 1)
+	{
+		throw std::runtime_error("Invalid base64 data size.");
+	}
+	return dataSize;
+}
+
+std::string Framework::ToBase64(const std::string& source)
+{
+	return ToBase64(source.c_str(), source.size());
+}
+
+std::string Framework::ToBase64(const void* source, size_t sourceLength)
+{
+	std::string result(GetBase64EncodedSize(sourceLength), '\0');
+	ToBase64(source, sourceLength, &result[0]);
 	return result;
 }
 
 std::vector<uint8> Framework::FromBase64(const char* source)
 {
-	std::vector<uint8> result;
+	return FromBase64(source, strlen(source));
+}
+
+std::vector<uint8> Framework::FromBase64(const char* source, size_t size)
+{
+	std::vector<uint8> result(GetBase64DecodedSize(source, size));
+	FromBase64(source, size, result.data());
+	return result;
+}
+
+size_t Framework::GetBase64EncodedSize(size_t size)
+{
+	return ((size + 2) / 3) * 4;
+}
 
-	size_t sourceLength = strlen(source);
-	result.reserve(((sourceLength + 3) / 4) * 3);
-	for(unsigned int i = 0; i < sourceLength; i += 4)
+void Framework::ToBase64(const void* buffer, size_t size, char* output)
+{
+	static const EncodeFunction encodeFunction = SelectEncodeFunction();
+	auto input = reinterpret_cast<const uint8*>(buffer);
+	size_t consumed = encodeFunction(input, size, output);
+	consumed += EncodeScalar(input + consumed, size - consumed, output + ((consumed / 3) * 4));
+	size_t remaining = size - consumed;
+	if(remaining != 0)
 	{
-		uint8 sourceValues[4] = { 0, 0, 0, 0 };
-		unsigned int paddingCount = 0;
-		for(unsigned int j = 0; j < 4; j++)
+		output += (consumed / 3) * 4;
+		input += consumed;
+		uint32 value = (static_cast<uint32>(input[0]) << 16) | ((remaining == 2) ? (static_cast<uint32>(input[1]) << 8) : 0);
+		output[0] = g_encodeLookupTable[(value >> 18) & 0x3F];
+		output[1] = g_encodeLookupTable[(value >> 12) & 0x3F];
+		output[2] = (remaining == 2) ? g_encodeLookupTable[(value >> 6) & 0x3F] : '=';
+		output[3] = '=';
+	}
+}
+
+size_t Framework::GetBase64DecodedSize(const char* source, size_t size)
+{
+	size_t dataSize = GetBase64DataSize(source, size);
+	size_t remaining = dataSize % 4;
+	return ((dataSize / 4) * 3) + ((remaining != 0) ? (remaining - 1) : 0);
+}
+
+size_t Framework::FromBase64(const char* source, size_t size, uint8* output)
+{
+	static const DecodeFunction decodeFunction = SelectDecodeFunction();
+	size_t dataSize = GetBase64DataSize(source, size);
+	size_t consumed = decodeFunction(source, dataSize, output);
+	consumed += DecodeScalar(source + consumed, dataSize - consumed, output + ((consumed / 4) * 3));
+	size_t remaining = dataSize - consumed;
+	size_t outputSize = (consumed / 4) * 3;
+	if(remaining >= 4)
+	{
+		throw std::runtime_error("Invalid base64 character.");
+	}
+	if(remaining != 0)
+	{
+		uint32 value = 0;
+		for(size_t i = 0; i < remaining; i++)
 		{
-			if(i + j >= sourceLength) continue;
-			uint8 sourceChar = source[i + j];
-			if(sourceChar >= 128)
-			{
-				throw std::runtime_error("Invalid base64 character.");
-			}
-			if(sourceChar == '=')
-			{
-				paddingCount++;
-				continue;
-			}
-			int8 sourceValue = g_decodeLookupTable[sourceChar];
-			if(sourceValue == static_cast<int8>(-1))
+			uint8 charValue = DecodeChar(source[consumed + i]);
+			if(charValue == 0xFF)
 			{
 				throw std::runtime_error("Invalid base64 character.");
 			}
-			sourceValues[j] = sourceValue;
+			value |= charValue << (18 - (i * 6));
 		}
-		uint8 dstValues[3];
-		dstValues[0] = ((sourceValues[0] & 0x3F) << 2) | ((sourceValues[1] & 0x30) >> 4);
-		dstValues[1] = ((sourceValues[1] & 0x0F) << 4) | ((sourceValues[2] & 0x3C) >> 2);
-		dstValues[2] = ((sourceValues[2] & 0x03) << 6) | ((sourceValues[3] & 0x3F) >> 0);
-		if(paddingCount <= 2) result.push_back(dstValues[0]);
-		if(paddingCount <= 1) result.push_back(dstValues[1]);
-		if(paddingCount <= 0) result.push_back(dstValues[2]);
+		output[outputSize++] = static_cast<uint8>(value >> 16);
+		if(remaining == 3) output[outputSize++] = static_cast<uint8>(value >> 8);
 	}
-
-	return result;
+	return outputSize;
 }
@@ -0,0 +1,159 @@
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include "Base64.h"
+#include "Base64Stream.h"
+
+using namespace Framework;
+
+CBase64EncodeStream::CBase64EncodeStream(CStream& baseStream)
+: m_baseStream(baseStream)
+, m_outputBuffer((CHUNK_SIZE / 3) * 4)
+{
+}
+
+void CBase64EncodeStream::Seek(int64, STREAM_SEEK_DIRECTION)
+{
+	throw std::runtime_error("Unsupported operation.");
+}
+
+uint64 CBase64EncodeStream::Tell()
+{
+	throw std::runtime_error("Unsupported operation.");
+}
+
+uint64 CBase64EncodeStream::Read(void*, uint64)
+{
+	throw std::runtime_error("Unsupported operation.");
+}
+
+uint64 CBase64EncodeStream::Write(const void* buffer, uint64 size)
+{
+	auto input = reinterpret_cast<const uint8*>(buffer);
+	uint64 remaining = size;
+	//Complete the group left over by the previous write first
+	if(m_pendingSize != 0)
+	{
+		size_t copySize = std::min<size_t>(3 - m_pendingSize, static_cast<size_t>(remaining));
+		memcpy(m_pending + m_pendingSize, input, copySize);
+		m_pendingSize += copySize;
+		input += copySize;
+		remaining -= copySize;
+		if(m_pendingSize != 3) return size;
+		ToBase64(m_pending, 3, m_outputBuffer.data());
+		m_baseStream.Write(m_outputBuffer.data(), 4);
+		m_pendingSize = 0;
+	}
+	while(remaining >= 3)
+	{
+		size_t chunkSize = static_cast<size_t>(std::min<uint64>(remaining - (remaining % 3), CHUNK_SIZE));
+		size_t encodedSize = GetBase64EncodedSize(chunkSize);
+		ToBase64(input, chunkSize, m_outputBuffer.data());
+		m_baseStream.Write(m_outputBuffer.data(), encodedSize);
+		input += chunkSize;
+		remaining -= chunkSize;
+	}
+	memcpy(m_pending, input, static_cast<size_t>(remaining));
+	m_pendingSize = static_cast<size_t>(remaining);
+	return size;
+}
+
+bool CBase64EncodeStream::IsEOF()
+{
+	return false;
+}
+
+void CBase64EncodeStream::Flush()
+{
+	if(m_pendingSize != 0)
+	{
+		ToBase64(m_pending, m_pendingSize, m_outputBuffer.data());
+		m_baseStream.Write(m_outputBuffer.data(), 4);
+		m_pendingSize = 0;
+	}
+	m_baseStream.Flush();
+}
+
+CBase64DecodeStream::CBase64DecodeStream(CStream& baseStream)
+: m_baseStream(baseStream)
+, m_inputBuffer(CHUNK_SIZE)
+, m_outputBuffer((CHUNK_SIZE / 4) * 3)
+{
+}
+
+void CBase64DecodeStream::Seek(int64, STREAM_SEEK_DIRECTION)
+{
+	throw std::runtime_error("Unsupported operation.");
+}
+
+uint64 CBase64DecodeStream::Tell()
+{
+	throw std::runtime_error("Unsupported operation.");
+}
+
+uint64 CBase64DecodeStream::Read(void* buffer, uint64 size)
+{
+	auto output = reinterpret_cast<uint8*>(buffer);
+	uint64 total = 0;
+	while(total != size)
+	{
+		if((m_outputPosition == m_outputSize) && !FillOutputBuffer())
+		{
+			break;
+		}
+		size_t copySize = static_cast<size_t>(std::min<uint64>(size - total, m_outputSize - m_outputPosition));
+		memcpy(output + total, m_outputBuffer.data() + m_outputPosition, copySize);
+		m_outputPosition += copySize;
+		total += copySize;
+	}
+	return total;
+}
+
+uint64 CBase64DecodeStream::Write(const void*, uint64)
+{
+	throw std::runtime_error("Unsupported operation.");
+}
+
+bool CBase64DecodeStream::IsEOF()
+{
+	return (m_outputPosition == m_outputSize) && !FillOutputBuffer();
+}
+
+bool CBase64DecodeStream::FillOutputBuffer()
+{
+	m_outputPosition = 0;
+	m_outputSize = 0;
+	while(m_outputSize == 0)
+	{
+		if(m_isInputEnd)
+		{
+			//Whatever is left is an unpadded last group
+			if(m_inputSize == 0) return false;
+			if(m_isPaddingFound)
+			{
+				throw std::runtime_error("Unexpected data after base64 padding.");
+			}
+			m_outputSize = FromBase64(m_inputBuffer.data(), m_inputSize, m_outputBuffer.data());
+			m_inputSize = 0;
+			continue;
+		}
+		size_t readSize = static_cast<size_t>(m_baseStream.Read(m_inputBuffer.data() + m_inputSize, CHUNK_SIZE - m_inputSize));
+		if(readSize == 0)
+		{
+			m_isInputEnd = true;
+			continue;
+		}
+		m_inputSize += readSize;
+		size_t decodeSize = m_inputSize - (m_inputSize % 4);
+		if(decodeSize == 0) continue;
+		if(m_isPaddingFound)
+		{
+			throw std::runtime_error("Unexpected data after base64 padding.");
+		}
+		m_outputSize = FromBase64(m_inputBuffer.data(), decodeSize, m_outputBuffer.data());
+		m_isPaddingFound = (m_inputBuffer[decodeSize - 1] == '=');
+		m_inputSize -= decodeSize;
+		memmove(m_inputBuffer.data(), m_inputBuffer.data() + decodeSize, m_inputSize);
+	}
+	return true;
+}
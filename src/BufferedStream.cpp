@@ -0,0 +1,231 @@
+#include <cassert>
+#include <algorithm>
+#include "BufferedStream.h"
+
+using namespace Framework;
+
+CBufferedStream::CBufferedStream(CStream& stream, size_t bufferSize)
+: m_stream(stream)
+, m_buffer(std::max<size_t>(bufferSize, 1))
+{
+
+}
+
+CBufferedStream::~CBufferedStream()
+{
+	FlushWrites();
+}
+
+void CBufferedStream::Seek(int64 position, STREAM_SEEK_DIRECTION direction)
+{
+	m_isEof = false;
+	if((direction == STREAM_SEEK_CUR) && (m_writeSize == 0))
+	{
+		//Stay inside the window if possible
+		int64 newPos = static_cast<int64>(m_readPos) + position;
+		if((newPos >= 0) && (newPos <= static_cast<int64>(m_readEnd)))
+		{
+			m_readPos = static_cast<size_t>(newPos);
+			return;
+		}
+		position -= static_cast<int64>(m_readEnd - m_readPos);
+	}
+	FlushWrites();
+	m_readPos = 0;
+	m_readEnd = 0;
+	m_sourceEof = false;
+	m_stream.Seek(position, direction);
+}
+
+uint64 CBufferedStream::Tell()
+{
+	if(m_writeSize != 0)
+	{
+		return m_stream.Tell() + m_writeSize;
+	}
+	else
+	{
+		return m_stream.Tell() - (m_readEnd - m_readPos);
+	}
+}
+
+uint64 CBufferedStream::Read(void* data, uint64 size)
+{
+	auto output = reinterpret_cast<uint8*>(data);
+	uint64 total = 0;
+	while(total != size)
+	{
+		uint64 remaining = size - total;
+		if((m_readPos == m_readEnd) && (remaining >= m_buffer.size()))
+		{
+			//Big reads go straight to the source
+			FlushWrites();
+			if(m_sourceEof) break;
+			uint64 amountRead = m_stream.Read(output + total, remaining);
+			if((amountRead == 0) || m_stream.IsEOF())
+			{
+				m_sourceEof = true;
+			}
+			total += amountRead;
+			continue;
+		}
+		size_t available = Fill(static_cast<size_t>(std::min<uint64>(remaining, m_buffer.size())));
+		if(available == 0) break;
+		size_t copySize = static_cast<size_t>(std::min<uint64>(available, remaining));
+		memcpy(output + total, m_buffer.data() + m_readPos, copySize);
+		m_readPos += copySize;
+		total += copySize;
+	}
+	if(total != size)
+	{
+		m_isEof = true;
+	}
+	return total;
+}
+
+uint64 CBufferedStream::Write(const void* data, uint64 size)
+{
+	DiscardReads();
+	if((m_writeSize + size) > m_buffer.size())
+	{
+		FlushWrites();
+	}
+	if(size >= m_buffer.size())
+	{
+		return m_stream.Write(data, size);
+	}
+	memcpy(m_buffer.data() + m_writeSize, data, static_cast<size_t>(size));
+	m_writeSize += static_cast<size_t>(size);
+	return size;
+}
+
+bool CBufferedStream::IsEOF()
+{
+	return m_isEof;
+}
+
+void CBufferedStream::Flush()
+{
+	FlushWrites();
+	m_stream.Flush();
+}
+
+uint64 CBufferedStream::GetLength()
+{
+	FlushWrites();
+	return m_stream.GetLength();
+}
+
+uint64 CBufferedStream::GetRemainingLength()
+{
+	return GetLength() - Tell();
+}
+
+std::string CBufferedStream::ReadLine(bool ignoreCr)
+{
+	std::string result;
+	while(1)
+	{
+		const uint8* data = nullptr;
+		size_t available = Peek(data);
+		if(available == 0)
+		{
+			m_isEof = true;
+			break;
+		}
+		auto lineEnd = reinterpret_cast<const uint8*>(memchr(data, '\n', available));
+		size_t lineSize = lineEnd ? (lineEnd - data) : available;
+		size_t prevSize = result.size();
+		result.append(data, data + lineSize);
+		if(ignoreCr)
+		{
+			result.erase(std::remove(result.begin() + prevSize, result.end(), '\r'), result.end());
+		}
+		if(lineEnd)
+		{
+			Consume(lineSize + 1);
+			break;
+		}
+		Consume(lineSize);
+	}
+	return result;
+}
+
+size_t CBufferedStream::Peek(const uint8*& data, size_t size)
+{
+	size_t available = Fill(size);
+	data = m_buffer.data() + m_readPos;
+	return available;
+}
+
+void CBufferedStream::Consume(size_t size)
+{
+	assert(size <= (m_readEnd - m_readPos));
+	m_readPos += size;
+}
+
+uint16 CBufferedStream::Read16_MSBF()
+{
+	uint16 value = Read16();
+	value =
+		(((value & 0xFF00) >>  8) <<  0) |
+		(((value & 0x00FF) >>  0) <<  8);
+	return value;
+}
+
+uint32 CBufferedStream::Read32_MSBF()
+{
+	uint32 value = Read32();
+	value =
+		(((value & 0xFF000000) >> 24) <<  0) |
+		(((value & 0x00FF0000) >> 16) <<  8) |
+		(((value & 0x0000FF00) >>  8) << 16) |
+		(((value & 0x000000FF) >>  0) << 24);
+	return value;
+}
+
+size_t CBufferedStream::Fill(size_t size)
+{
+	FlushWrites();
+	size = std::min(size, m_buffer.size());
+	size_t available = m_readEnd - m_readPos;
+	if(available >= size) return available;
+	if(m_readPos != 0)
+	{
+		memmove(m_buffer.data(), m_buffer.data() + m_readPos, available);
+		m_readPos = 0;
+		m_readEnd = available;
+	}
+	while(!m_sourceEof && (m_readEnd < size))
+	{
+		uint64 amountRead = m_stream.Read(m_buffer.data() + m_readEnd, m_buffer.size() - m_readEnd);
+		m_readEnd += static_cast<size_t>(amountRead);
+		if((amountRead == 0) || m_stream.IsEOF())
+		{
+			m_sourceEof = true;
+		}
+	}
+	return m_readEnd - m_readPos;
+}
+
+void CBufferedStream::FlushWrites()
+{
+	if(m_writeSize == 0) return;
+	assert(m_readPos == m_readEnd);
+	size_t writeSize = m_writeSize;
+	m_writeSize = 0;
+	m_stream.Write(m_buffer.data(), writeSize);
+}
+
+void CBufferedStream::DiscardReads()
+{
+	size_t available = m_readEnd - m_readPos;
+	m_readPos = 0;
+	m_readEnd = 0;
+	if(available != 0)
+	{
+		//Bring the source back to our logical position
+		m_stream.Seek(-static_cast<int64>(available), STREAM_SEEK_CUR);
+		m_sourceEof = false;
+	}
+}
@@ -0,0 +1,344 @@
+#include "ChainedBufferStream.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+
+using namespace Framework;
+
+CChainedBufferStream::CSegmentPool::CSegmentPool(size_t segmentSize, size_t maxFreeCount)
+    : m_segmentSize(segmentSize)
+    , m_maxFreeCount(maxFreeCount)
+{
+	if(segmentSize == 0)
+	{
+		throw std::runtime_error("Invalid segment size.");
+	}
+}
+
+CChainedBufferStream::CSegmentPool::~CSegmentPool()
+{
+	for(auto segment : m_freeSegments)
+	{
+		delete[] segment;
+	}
+}
+
+const std::shared_ptr<CChainedBufferStream::CSegmentPool>& CChainedBufferStream::CSegmentPool::GetDefault()
+{
+	//Keeps up to 16MB around
+	static const auto pool = std::make_shared<CSegmentPool>(DEFAULT_SEGMENT_SIZE, 0x100);
+	return pool;
+}
+
+size_t CChainedBufferStream::CSegmentPool::GetSegmentSize() const
+{
+	return m_segmentSize;
+}
+
+uint8* CChainedBufferStream::CSegmentPool::Allocate()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if(!m_freeSegments.empty())
+		{
+			auto segment = m_freeSegments.back();
+			m_freeSegments.pop_back();
+			return segment;
+		}
+	}
+	return new uint8[m_segmentSize];
+}
+
+void CChainedBufferStream::CSegmentPool::Free(uint8* segment)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if(m_freeSegments.size() < m_maxFreeCount)
+		{
+			m_freeSegments.push_back(segment);
+			return;
+		}
+	}
+	delete[] segment;
+}
+
+CChainedBufferStream::CChainedBufferStream(SegmentPoolPtr pool)
+    : m_pool(std::move(pool))
+{
+	if(!m_pool)
+	{
+		throw std::runtime_error("Invalid segment pool.");
+	}
+}
+
+CChainedBufferStream::CChainedBufferStream(CChainedBufferStream&& rhs)
+    : m_pool(rhs.m_pool)
+    , m_segments(std::move(rhs.m_segments))
+    , m_size(rhs.m_size)
+    , m_position(rhs.m_position)
+    , m_segmentIndex(rhs.m_segmentIndex)
+    , m_isEof(rhs.m_isEof)
+{
+	rhs.m_segments.clear();
+	rhs.Clear();
+}
+
+CChainedBufferStream::~CChainedBufferStream()
+{
+	Clear();
+}
+
+CChainedBufferStream& CChainedBufferStream::operator =(CChainedBufferStream&& rhs)
+{
+	if(this != &rhs)
+	{
+		Clear();
+		m_pool = rhs.m_pool;
+		m_segments = std::move(rhs.m_segments);
+		m_size = rhs.m_size;
+		m_position = rhs.m_position;
+		m_segmentIndex = rhs.m_segmentIndex;
+		m_isEof = rhs.m_isEof;
+		rhs.m_segments.clear();
+		rhs.Clear();
+	}
+	return (*this);
+}
+
+void CChainedBufferStream::Seek(int64 position, STREAM_SEEK_DIRECTION direction)
+{
+	int64 base = 0;
+	switch(direction)
+	{
+	case STREAM_SEEK_SET:
+		base = 0;
+		break;
+	case STREAM_SEEK_CUR:
+		base = static_cast<int64>(m_position);
+		break;
+	case STREAM_SEEK_END:
+		base = static_cast<int64>(m_size);
+		break;
+	}
+	int64 newPosition = base + position;
+	if((newPosition < 0) || (static_cast<uint64>(newPosition) > m_size))
+	{
+		throw std::runtime_error("Invalid position.");
+	}
+	m_position = newPosition;
+	m_isEof = false;
+}
+
+uint64 CChainedBufferStream::Tell()
+{
+	return m_position;
+}
+
+uint64 CChainedBufferStream::Read(void* data, uint64 size)
+{
+	if(m_position >= m_size)
+	{
+		m_isEof = true;
+		return 0;
+	}
+	auto output = reinterpret_cast<uint8*>(data);
+	size_t index = FindSegment(m_position);
+	uint64 readSize = 0;
+	while((size != 0) && (m_position < m_size))
+	{
+		const auto& segment = m_segments[index];
+		size_t segmentPosition = static_cast<size_t>(m_position - segment.offset);
+		size_t copySize = static_cast<size_t>(std::min<uint64>(segment.size - segmentPosition, size));
+		memcpy(output, segment.data + segmentPosition, copySize);
+		output += copySize;
+		size -= copySize;
+		readSize += copySize;
+		m_position += copySize;
+		if((segmentPosition + copySize) == segment.size)
+		{
+			index++;
+		}
+	}
+	m_segmentIndex = index;
+	return readSize;
+}
+
+uint64 CChainedBufferStream::Write(const void* data, uint64 size)
+{
+	auto input = reinterpret_cast<const uint8*>(data);
+	uint64 writeSize = size;
+	//Overwrite what's already there
+	size_t index = FindSegment(m_position);
+	while((size != 0) && (m_position < m_size))
+	{
+		auto& segment = m_segments[index];
+		size_t segmentPosition = static_cast<size_t>(m_position - segment.offset);
+		size_t copySize = static_cast<size_t>(std::min<uint64>(segment.size - segmentPosition, size));
+		memcpy(segment.data + segmentPosition, input, copySize);
+		input += copySize;
+		size -= copySize;
+		m_position += copySize;
+		if((segmentPosition + copySize) == segment.size)
+		{
+			index++;
+		}
+	}
+	//Fill the last segment and add new ones for the rest
+	size_t segmentSize = m_pool->GetSegmentSize();
+	while(size != 0)
+	{
+		if(m_segments.empty() || (m_segments.back().size == segmentSize))
+		{
+			SEGMENT segment;
+			segment.data = m_pool->Allocate();
+			segment.offset = m_size;
+			m_segments.push_back(segment);
+		}
+		auto& segment = m_segments.back();
+		size_t copySize = static_cast<size_t>(std::min<uint64>(segmentSize - segment.size, size));
+		memcpy(segment.data + segment.size, input, copySize);
+		segment.size += copySize;
+		input += copySize;
+		size -= copySize;
+		m_size += copySize;
+		m_position += copySize;
+		index = m_segments.size();
+	}
+	m_segmentIndex = index;
+	return writeSize;
+}
+
+bool CChainedBufferStream::IsEOF()
+{
+	return m_isEof;
+}
+
+uint64 CChainedBufferStream::GetLength()
+{
+	return m_size;
+}
+
+uint64 CChainedBufferStream::GetRemainingLength()
+{
+	return m_size - m_position;
+}
+
+bool CChainedBufferStream::CanAccessAt() const
+{
+	return true;
+}
+
+uint64 CChainedBufferStream::ReadAt(uint64 position, void* data, uint64 size)
+{
+	auto output = reinterpret_cast<uint8*>(data);
+	uint64 readSize = 0;
+	if(position >= m_size) return 0;
+	//Doesn't use the segment index kept for the position, might be called concurrently
+	auto segmentIterator = std::upper_bound(std::begin(m_segments), std::end(m_segments), position,
+	                                        [](uint64 position, const SEGMENT& segment) { return position < segment.offset; });
+	for(--segmentIterator; (size != 0) && (segmentIterator != std::end(m_segments)); ++segmentIterator)
+	{
+		size_t segmentPosition = static_cast<size_t>(position - segmentIterator->offset);
+		size_t copySize = static_cast<size_t>(std::min<uint64>(segmentIterator->size - segmentPosition, size));
+		memcpy(output, segmentIterator->data + segmentPosition, copySize);
+		output += copySize;
+		size -= copySize;
+		readSize += copySize;
+		position += copySize;
+	}
+	return readSize;
+}
+
+uint64 CChainedBufferStream::GetSize() const
+{
+	return m_size;
+}
+
+void CChainedBufferStream::Clear()
+{
+	for(const auto& segment : m_segments)
+	{
+		m_pool->Free(segment.data);
+	}
+	m_segments.clear();
+	m_size = 0;
+	m_position = 0;
+	m_segmentIndex = 0;
+	m_isEof = false;
+}
+
+size_t CChainedBufferStream::GetIoVecs(uint64 offset, STREAM_CONST_IOVEC* vecs, size_t maxCount) const
+{
+	if(offset >= m_size) return 0;
+	size_t count = 0;
+	for(size_t index = FindSegment(offset); (index < m_segments.size()) && (count < maxCount); index++, count++)
+	{
+		const auto& segment = m_segments[index];
+		size_t segmentPosition = static_cast<size_t>(std::max(offset, segment.offset) - segment.offset);
+		vecs[count].buffer = segment.data + segmentPosition;
+		vecs[count].size = segment.size - segmentPosition;
+	}
+	return count;
+}
+
+void CChainedBufferStream::Splice(CChainedBufferStream& source)
+{
+	if(&source == this)
+	{
+		throw std::runtime_error("Can't splice a stream into itself.");
+	}
+	if(source.m_pool != m_pool)
+	{
+		//Segments need to go back to the pool they came from, copy them instead
+		uint64 position = m_position;
+		m_position = m_size;
+		for(const auto& segment : source.m_segments)
+		{
+			Write(segment.data, segment.size);
+		}
+		m_position = position;
+		source.Clear();
+		return;
+	}
+	m_segments.reserve(m_segments.size() + source.m_segments.size());
+	for(auto segment : source.m_segments)
+	{
+		segment.offset = m_size;
+		m_size += segment.size;
+		m_segments.push_back(segment);
+	}
+	source.m_segments.clear();
+	source.Clear();
+}
+
+std::vector<uint8> CChainedBufferStream::ToBuffer() const
+{
+	std::vector<uint8> result;
+	result.reserve(static_cast<size_t>(m_size));
+	for(const auto& segment : m_segments)
+	{
+		result.insert(std::end(result), segment.data, segment.data + segment.size);
+	}
+	return result;
+}
+
+size_t CChainedBufferStream::FindSegment(uint64 position) const
+{
+	if(position >= m_size)
+	{
+		return m_segments.size();
+	}
+	if(m_segmentIndex < m_segments.size())
+	{
+		const auto& segment = m_segments[m_segmentIndex];
+		if((position >= segment.offset) && (position < (segment.offset + segment.size)))
+		{
+			return m_segmentIndex;
+		}
+	}
+	auto segmentIterator = std::upper_bound(std::begin(m_segments), std::end(m_segments), position,
+	                                        [](uint64 position, const SEGMENT& segment) { return position < segment.offset; });
+	assert(segmentIterator != std::begin(m_segments));
+	return (segmentIterator - std::begin(m_segments)) - 1;
+}
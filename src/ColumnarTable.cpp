@@ -0,0 +1,686 @@
+#include "ColumnarTable.h"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+#include <zstd.h>
+#include "Csv.h"
+#include "PtrStream.h"
+#include "Serialization.h"
+#include "SpanStream.h"
+
+using namespace Framework;
+using namespace Framework::ColumnarTable;
+
+enum : uint32
+{
+	FILE_MAGIC = 0x4C425443, //'CTBL'
+	FILE_VERSION = 1,
+	FILE_HEADER_SIZE = 8,
+	FILE_TRAILER_SIZE = 12,
+	CHUNK_ALIGNMENT = 8,
+};
+
+namespace
+{
+	//What the first pass learned about a column
+	struct COLUMN_STATS
+	{
+		bool isInt = true;
+		bool isDouble = true;
+		bool isDictionary = true;
+		std::vector<std::string> dictionary;
+		std::unordered_map<std::string, uint32> dictionaryIndices;
+	};
+
+	//Values of a column for the current row group
+	struct GROUP_COLUMN
+	{
+		std::vector<uint8> values;
+		//String columns only, values hold the characters
+		std::vector<uint64> offsets;
+	};
+
+	class CChunkWriter
+	{
+	public:
+		CChunkWriter(CStream& stream, const CONVERT_OPTIONS& options)
+		    : m_stream(stream)
+		    , m_options(options)
+		{
+		}
+
+		void Write(const void* data, size_t size)
+		{
+			m_stream.Write(data, size);
+			m_position += size;
+		}
+
+		CHUNK_INFO WriteChunk(const std::vector<uint8>& data)
+		{
+			static const uint8 padding[CHUNK_ALIGNMENT] = {};
+			Write(padding, (CHUNK_ALIGNMENT - (m_position % CHUNK_ALIGNMENT)) % CHUNK_ALIGNMENT);
+
+			CHUNK_INFO chunk;
+			chunk.offset = m_position;
+			chunk.rawSize = data.size();
+			chunk.storedSize = data.size();
+			if(m_options.compress && !data.empty())
+			{
+				m_compressed.resize(ZSTD_compressBound(data.size()));
+				size_t result = ZSTD_compress(m_compressed.data(), m_compressed.size(), data.data(), data.size(), m_options.compressionLevel);
+				if(ZSTD_isError(result))
+				{
+					throw std::runtime_error("Failed to compress column chunk.");
+				}
+				//Chunks that don't get smaller are kept as is and can be used in place
+				if(result < data.size())
+				{
+					chunk.storedSize = result;
+					Write(m_compressed.data(), result);
+					return chunk;
+				}
+			}
+			Write(data.data(), data.size());
+			return chunk;
+		}
+
+		uint64 GetPosition() const
+		{
+			return m_position;
+		}
+
+	private:
+		CStream& m_stream;
+		const CONVERT_OPTIONS& m_options;
+		uint64 m_position = 0;
+		std::vector<uint8> m_compressed;
+	};
+}
+
+template <typename ValueType>
+static bool ParseValue(std::string_view field, ValueType& value)
+{
+	auto result = std::from_chars(field.data(), field.data() + field.size(), value);
+	return (result.ec == std::errc()) && (result.ptr == (field.data() + field.size()));
+}
+
+template <typename ValueType>
+static void AppendValue(std::vector<uint8>& values, ValueType value)
+{
+	size_t size = values.size();
+	values.resize(size + sizeof(ValueType));
+	memcpy(values.data() + size, &value, sizeof(ValueType));
+}
+
+static void ObserveField(COLUMN_STATS& stats, std::string_view field, uint32 maxDictionarySize, std::string& key)
+{
+	if(stats.isInt)
+	{
+		int64 value = 0;
+		stats.isInt = ParseValue(field, value);
+	}
+	if(!stats.isInt && stats.isDouble)
+	{
+		double value = 0;
+		stats.isDouble = ParseValue(field, value);
+	}
+	if(stats.isDictionary)
+	{
+		key.assign(field);
+		if(stats.dictionaryIndices.count(key) != 0) return;
+		if(stats.dictionary.size() == maxDictionarySize)
+		{
+			stats.isDictionary = false;
+			stats.dictionary = std::vector<std::string>();
+			stats.dictionaryIndices = std::unordered_map<std::string, uint32>();
+			return;
+		}
+		stats.dictionaryIndices.emplace(key, static_cast<uint32>(stats.dictionary.size()));
+		stats.dictionary.push_back(key);
+	}
+}
+
+static void AppendField(GROUP_COLUMN& column, const COLUMN_INFO& info, const COLUMN_STATS& stats, std::string_view field, std::string& key)
+{
+	switch(info.type)
+	{
+	case COLUMN_TYPE_INT:
+	{
+		int64 value = 0;
+		ParseValue(field, value);
+		AppendValue(column.values, value);
+	}
+	break;
+	case COLUMN_TYPE_DOUBLE:
+	{
+		double value = 0;
+		ParseValue(field, value);
+		AppendValue(column.values, value);
+	}
+	break;
+	case COLUMN_TYPE_DICTIONARY:
+	{
+		//Input might have changed since the first pass
+		key.assign(field);
+		auto indexIterator = stats.dictionaryIndices.find(key);
+		if(indexIterator == std::end(stats.dictionaryIndices))
+		{
+			throw std::runtime_error("CSV input changed during conversion.");
+		}
+		uint32 index = indexIterator->second;
+		switch(info.indexSize)
+		{
+		case 1:
+			AppendValue(column.values, static_cast<uint8>(index));
+			break;
+		case 2:
+			AppendValue(column.values, static_cast<uint16>(index));
+			break;
+		default:
+			AppendValue(column.values, index);
+			break;
+		}
+	}
+	break;
+	default:
+		column.values.insert(std::end(column.values), std::begin(field), std::end(field));
+		column.offsets.push_back(column.values.size());
+		break;
+	}
+}
+
+static std::vector<uint8> MakeChunkData(GROUP_COLUMN& column, COLUMN_TYPE type)
+{
+	if(type != COLUMN_TYPE_STRING)
+	{
+		return std::move(column.values);
+	}
+	//Offsets of the start and end of each string come before the characters
+	size_t offsetsSize = column.offsets.size() * sizeof(uint64);
+	std::vector<uint8> data(offsetsSize + column.values.size());
+	memcpy(data.data(), column.offsets.data(), offsetsSize);
+	if(!column.values.empty())
+	{
+		memcpy(data.data() + offsetsSize, column.values.data(), column.values.size());
+	}
+	return data;
+}
+
+void ColumnarTable::ConvertCsv(CStream& input, CStream& output, const CONVERT_OPTIONS& options)
+{
+	if((options.rowGroupSize == 0) || (options.maxDictionarySize == 0))
+	{
+		throw std::runtime_error("Invalid conversion options.");
+	}
+
+	uint64 inputStart = input.Tell();
+
+	std::vector<COLUMN_INFO> columns;
+	std::vector<COLUMN_STATS> stats;
+	std::string key;
+	uint64 rowCount = 0;
+	{
+		Csv::CReader reader(input, options.separator);
+		if(options.hasHeader && reader.Next())
+		{
+			columns.resize(reader.GetFieldCount());
+			for(size_t i = 0; i < reader.GetFieldCount(); i++)
+			{
+				columns[i].name = reader.GetField(i);
+			}
+		}
+		while(reader.Next())
+		{
+			size_t fieldCount = reader.GetFieldCount();
+			if(fieldCount > stats.size())
+			{
+				size_t previousCount = stats.size();
+				stats.resize(fieldCount);
+				//Previous rows didn't have these
+				for(size_t i = previousCount; (i < fieldCount) && (rowCount != 0); i++)
+				{
+					ObserveField(stats[i], std::string_view(), options.maxDictionarySize, key);
+				}
+			}
+			for(size_t i = 0; i < stats.size(); i++)
+			{
+				ObserveField(stats[i], (i < fieldCount) ? reader.GetField(i) : std::string_view(), options.maxDictionarySize, key);
+			}
+			rowCount++;
+		}
+	}
+
+	//Header columns that no row reached are empty
+	for(size_t i = stats.size(); i < columns.size(); i++)
+	{
+		stats.emplace_back();
+		if(rowCount != 0)
+		{
+			ObserveField(stats.back(), std::string_view(), options.maxDictionarySize, key);
+		}
+	}
+	size_t previousCount = columns.size();
+	columns.resize(stats.size());
+	for(size_t i = 0; i < columns.size(); i++)
+	{
+		auto& column = columns[i];
+		auto& columnStats = stats[i];
+		if(i >= previousCount)
+		{
+			column.name = std::to_string(i);
+		}
+		if(rowCount == 0)
+		{
+			column.type = COLUMN_TYPE_STRING;
+		}
+		else if(columnStats.isInt)
+		{
+			column.type = COLUMN_TYPE_INT;
+		}
+		else if(columnStats.isDouble)
+		{
+			column.type = COLUMN_TYPE_DOUBLE;
+		}
+		else if(columnStats.isDictionary)
+		{
+			column.type = COLUMN_TYPE_DICTIONARY;
+			size_t dictionarySize = columnStats.dictionary.size();
+			column.indexSize = (dictionarySize <= 0x100) ? 1 : (dictionarySize <= 0x10000) ? 2 : 4;
+			column.dictionary = columnStats.dictionary;
+		}
+		else
+		{
+			column.type = COLUMN_TYPE_STRING;
+		}
+	}
+
+	CChunkWriter writer(output, options);
+	{
+		uint32 header[2] = {FILE_MAGIC, FILE_VERSION};
+		writer.Write(header, sizeof(header));
+	}
+
+	input.Seek(inputStart, STREAM_SEEK_SET);
+	{
+		Csv::CReader reader(input, options.separator);
+		if(options.hasHeader)
+		{
+			reader.Next();
+		}
+
+		std::vector<GROUP_COLUMN> groupColumns(columns.size());
+		uint64 writtenRowCount = 0;
+		auto startGroup =
+		    [&]() {
+			    for(size_t i = 0; i < columns.size(); i++)
+			    {
+				    groupColumns[i].values.clear();
+				    groupColumns[i].offsets.assign(1, 0);
+			    }
+		    };
+		auto flushGroup =
+		    [&]() {
+			    for(size_t i = 0; i < columns.size(); i++)
+			    {
+				    auto data = MakeChunkData(groupColumns[i], columns[i].type);
+				    columns[i].chunks.push_back(writer.WriteChunk(data));
+			    }
+			    startGroup();
+		    };
+
+		startGroup();
+		uint32 groupRowCount = 0;
+		while((writtenRowCount < rowCount) && reader.Next())
+		{
+			size_t fieldCount = reader.GetFieldCount();
+			if(fieldCount > columns.size())
+			{
+				throw std::runtime_error("CSV input changed during conversion.");
+			}
+			for(size_t i = 0; i < columns.size(); i++)
+			{
+				AppendField(groupColumns[i], columns[i], stats[i], (i < fieldCount) ? reader.GetField(i) : std::string_view(), key);
+			}
+			writtenRowCount++;
+			if(++groupRowCount == options.rowGroupSize)
+			{
+				flushGroup();
+				groupRowCount = 0;
+			}
+		}
+		if(writtenRowCount != rowCount)
+		{
+			throw std::runtime_error("CSV input changed during conversion.");
+		}
+		if(groupRowCount != 0)
+		{
+			flushGroup();
+		}
+	}
+
+	uint64 footerOffset = writer.GetPosition();
+	{
+		uint32 rowGroupSize = options.rowGroupSize;
+		Serialization::COutputArchive archive(output);
+		archive & rowCount & rowGroupSize & columns;
+		archive.Flush();
+	}
+	{
+		uint32 magic = FILE_MAGIC;
+		output.Write(&footerOffset, sizeof(footerOffset));
+		output.Write(&magic, sizeof(magic));
+	}
+}
+
+//CColumn
+//--------------------------------------------------
+
+COLUMN_TYPE CColumn::GetType() const
+{
+	return m_type;
+}
+
+uint64 CColumn::GetRowCount() const
+{
+	return m_rowCount;
+}
+
+int64 CColumn::GetInt(uint64 row) const
+{
+	if(m_type != COLUMN_TYPE_INT)
+	{
+		throw std::runtime_error("Column doesn't hold integers.");
+	}
+	size_t index = 0;
+	const auto& chunk = GetRowChunk(row, index);
+	return reinterpret_cast<const int64*>(chunk.data)[index];
+}
+
+double CColumn::GetDouble(uint64 row) const
+{
+	if(m_type == COLUMN_TYPE_INT)
+	{
+		return static_cast<double>(GetInt(row));
+	}
+	if(m_type != COLUMN_TYPE_DOUBLE)
+	{
+		throw std::runtime_error("Column doesn't hold numbers.");
+	}
+	size_t index = 0;
+	const auto& chunk = GetRowChunk(row, index);
+	return reinterpret_cast<const double*>(chunk.data)[index];
+}
+
+std::string_view CColumn::GetString(uint64 row) const
+{
+	if(m_type == COLUMN_TYPE_DICTIONARY)
+	{
+		return (*m_dictionary)[GetDictionaryIndex(row)];
+	}
+	if(m_type != COLUMN_TYPE_STRING)
+	{
+		throw std::runtime_error("Column doesn't hold strings.");
+	}
+	size_t index = 0;
+	const auto& chunk = GetRowChunk(row, index);
+	auto offsets = reinterpret_cast<const uint64*>(chunk.data);
+	auto characters = reinterpret_cast<const char*>(offsets + chunk.rowCount + 1);
+	return std::string_view(characters + offsets[index], static_cast<size_t>(offsets[index + 1] - offsets[index]));
+}
+
+uint32 CColumn::GetDictionaryIndex(uint64 row) const
+{
+	if(m_type != COLUMN_TYPE_DICTIONARY)
+	{
+		throw std::runtime_error("Column isn't dictionary encoded.");
+	}
+	size_t index = 0;
+	const auto& chunk = GetRowChunk(row, index);
+	uint32 dictionaryIndex = 0;
+	switch(m_indexSize)
+	{
+	case 1:
+		dictionaryIndex = chunk.data[index];
+		break;
+	case 2:
+		dictionaryIndex = reinterpret_cast<const uint16*>(chunk.data)[index];
+		break;
+	default:
+		dictionaryIndex = reinterpret_cast<const uint32*>(chunk.data)[index];
+		break;
+	}
+	if(dictionaryIndex >= m_dictionary->size())
+	{
+		throw std::runtime_error("Invalid dictionary index.");
+	}
+	return dictionaryIndex;
+}
+
+const std::vector<std::string>& CColumn::GetDictionary() const
+{
+	if(m_type != COLUMN_TYPE_DICTIONARY)
+	{
+		throw std::runtime_error("Column isn't dictionary encoded.");
+	}
+	return *m_dictionary;
+}
+
+size_t CColumn::GetChunkCount() const
+{
+	return m_chunks.size();
+}
+
+size_t CColumn::GetChunkRowCount(size_t chunkIndex) const
+{
+	return m_chunks.at(chunkIndex).rowCount;
+}
+
+const int64* CColumn::GetChunkInts(size_t chunkIndex) const
+{
+	if(m_type != COLUMN_TYPE_INT)
+	{
+		throw std::runtime_error("Column doesn't hold integers.");
+	}
+	return reinterpret_cast<const int64*>(m_chunks.at(chunkIndex).data);
+}
+
+const double* CColumn::GetChunkDoubles(size_t chunkIndex) const
+{
+	if(m_type != COLUMN_TYPE_DOUBLE)
+	{
+		throw std::runtime_error("Column doesn't hold floating point numbers.");
+	}
+	return reinterpret_cast<const double*>(m_chunks.at(chunkIndex).data);
+}
+
+const CColumn::CHUNK& CColumn::GetRowChunk(uint64 row, size_t& index) const
+{
+	if(row >= m_rowCount)
+	{
+		throw std::runtime_error("Row index out of range.");
+	}
+	index = static_cast<size_t>(row % m_rowGroupSize);
+	return m_chunks[static_cast<size_t>(row / m_rowGroupSize)];
+}
+
+//CReader
+//--------------------------------------------------
+
+CReader::CReader(CSpanStream& stream)
+    : m_stream(stream)
+{
+	uint64 size = m_stream.GetLength();
+	if(size < (FILE_HEADER_SIZE + FILE_TRAILER_SIZE))
+	{
+		throw std::runtime_error("Invalid columnar table.");
+	}
+	uint32 header[2] = {};
+	uint64 footerOffset = 0;
+	uint32 trailerMagic = 0;
+	memcpy(header, m_stream.GetSpan(0, FILE_HEADER_SIZE), FILE_HEADER_SIZE);
+	auto trailer = m_stream.GetSpan(size - FILE_TRAILER_SIZE, FILE_TRAILER_SIZE);
+	memcpy(&footerOffset, trailer, sizeof(footerOffset));
+	memcpy(&trailerMagic, trailer + sizeof(footerOffset), sizeof(trailerMagic));
+	if((header[0] != FILE_MAGIC) || (trailerMagic != FILE_MAGIC))
+	{
+		throw std::runtime_error("Invalid columnar table.");
+	}
+	if(header[1] != FILE_VERSION)
+	{
+		throw std::runtime_error("Unsupported columnar table version.");
+	}
+	if((footerOffset < FILE_HEADER_SIZE) || (footerOffset > (size - FILE_TRAILER_SIZE)))
+	{
+		throw std::runtime_error("Invalid columnar table.");
+	}
+
+	uint64 footerSize = size - FILE_TRAILER_SIZE - footerOffset;
+	CPtrStream footerStream(m_stream.GetSpan(footerOffset, footerSize), footerSize);
+	Serialization::CInputArchive archive(footerStream);
+	archive & m_rowCount & m_rowGroupSize & m_columns;
+	if(m_rowGroupSize == 0)
+	{
+		throw std::runtime_error("Invalid columnar table.");
+	}
+
+	uint64 chunkCount = (m_rowCount + m_rowGroupSize - 1) / m_rowGroupSize;
+	for(const auto& column : m_columns)
+	{
+		if(column.chunks.size() != chunkCount)
+		{
+			throw std::runtime_error("Invalid columnar table.");
+		}
+		for(const auto& chunk : column.chunks)
+		{
+			if((chunk.offset > footerOffset) || (chunk.storedSize > (footerOffset - chunk.offset)))
+			{
+				throw std::runtime_error("Invalid columnar table.");
+			}
+		}
+	}
+}
+
+uint64 CReader::GetRowCount() const
+{
+	return m_rowCount;
+}
+
+size_t CReader::GetColumnCount() const
+{
+	return m_columns.size();
+}
+
+const std::string& CReader::GetColumnName(size_t index) const
+{
+	return m_columns.at(index).name;
+}
+
+COLUMN_TYPE CReader::GetColumnType(size_t index) const
+{
+	return m_columns.at(index).type;
+}
+
+size_t CReader::GetColumnIndex(std::string_view name) const
+{
+	auto columnIterator = std::find_if(std::begin(m_columns), std::end(m_columns),
+	                                   [&](const COLUMN_INFO& column) { return column.name == name; });
+	if(columnIterator == std::end(m_columns))
+	{
+		throw std::runtime_error("Column not found.");
+	}
+	return columnIterator - std::begin(m_columns);
+}
+
+CColumn CReader::GetColumn(size_t index) const
+{
+	const auto& info = m_columns.at(index);
+
+	size_t valueSize = 0;
+	switch(info.type)
+	{
+	case COLUMN_TYPE_INT:
+	case COLUMN_TYPE_DOUBLE:
+		valueSize = 8;
+		break;
+	case COLUMN_TYPE_DICTIONARY:
+		if((info.indexSize != 1) && (info.indexSize != 2) && (info.indexSize != 4))
+		{
+			throw std::runtime_error("Invalid columnar table.");
+		}
+		valueSize = info.indexSize;
+		break;
+	case COLUMN_TYPE_STRING:
+		break;
+	default:
+		throw std::runtime_error("Invalid columnar table.");
+	}
+
+	CColumn column;
+	column.m_type = info.type;
+	column.m_rowCount = m_rowCount;
+	column.m_rowGroupSize = m_rowGroupSize;
+	column.m_indexSize = info.indexSize;
+	column.m_dictionary = &info.dictionary;
+	column.m_chunks.reserve(info.chunks.size());
+	for(size_t chunkIndex = 0; chunkIndex < info.chunks.size(); chunkIndex++)
+	{
+		const auto& chunkInfo = info.chunks[chunkIndex];
+		CColumn::CHUNK chunk;
+		chunk.rowCount = static_cast<size_t>(std::min<uint64>(m_rowGroupSize, m_rowCount - (chunkIndex * m_rowGroupSize)));
+
+		uint64 expectedSize = (valueSize != 0) ? (chunk.rowCount * valueSize) : ((chunk.rowCount + 1) * sizeof(uint64));
+		bool isSizeValid = (valueSize != 0) ? (chunkInfo.rawSize == expectedSize) : (chunkInfo.rawSize >= expectedSize);
+		if(!isSizeValid)
+		{
+			throw std::runtime_error("Invalid columnar table.");
+		}
+
+		auto stored = m_stream.GetSpan(chunkInfo.offset, chunkInfo.storedSize);
+		if(chunkInfo.storedSize != chunkInfo.rawSize)
+		{
+			if(ZSTD_getFrameContentSize(stored, static_cast<size_t>(chunkInfo.storedSize)) != chunkInfo.rawSize)
+			{
+				throw std::runtime_error("Invalid columnar table.");
+			}
+			std::vector<uint8> buffer(static_cast<size_t>(chunkInfo.rawSize));
+			size_t result = ZSTD_decompress(buffer.data(), buffer.size(), stored, static_cast<size_t>(chunkInfo.storedSize));
+			if(ZSTD_isError(result) || (result != buffer.size()))
+			{
+				throw std::runtime_error("Failed to decompress column chunk.");
+			}
+			column.m_buffers.push_back(std::move(buffer));
+			chunk.data = column.m_buffers.back().data();
+		}
+		else if((reinterpret_cast<uintptr_t>(stored) % CHUNK_ALIGNMENT) != 0)
+		{
+			//Values are read in place, they need to be aligned
+			column.m_buffers.emplace_back(stored, stored + chunkInfo.rawSize);
+			chunk.data = column.m_buffers.back().data();
+		}
+		else
+		{
+			chunk.data = stored;
+		}
+
+		if(info.type == COLUMN_TYPE_STRING)
+		{
+			//Every string has to be within the chunk
+			auto offsets = reinterpret_cast<const uint64*>(chunk.data);
+			uint64 charactersSize = chunkInfo.rawSize - expectedSize;
+			bool isValid = (offsets[0] == 0);
+			for(size_t i = 0; isValid && (i < chunk.rowCount); i++)
+			{
+				isValid = (offsets[i] <= offsets[i + 1]);
+			}
+			if(!isValid || (offsets[chunk.rowCount] > charactersSize))
+			{
+				throw std::runtime_error("Invalid columnar table.");
+			}
+		}
+
+		column.m_chunks.push_back(chunk);
+	}
+	return column;
+}
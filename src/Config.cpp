@@ -2,6 +2,9 @@
 #include <stdlib.h>
 #include <cassert>
 #include "Config.h"
+#include "HashUtils.h"
+#include "MappedFileStream.h"
+#include "MemStream.h"
 #include "StdStream.h"
 #include "xml/Writer.h"
 #include "xml/Parser.h"
@@ -9,6 +12,7 @@
 #include "xml/FilteringNodeIterator.h"
 #include "PathUtils.h"
 #include "StdStreamUtils.h"
+#include "StartupProfiler.h"
 
 #define PREFERENCE_ATTRIBUTE_NAME_NAME "Name"
 #define PREFERENCE_ATTRIBUTE_NAME_TYPE "Type"
@@ -22,9 +26,72 @@
 
 using namespace Framework;
 
-CConfig::CConfig(const PathType& path, bool readonly)
+namespace
+{
+	typedef std::array<uint8, 0x20> CacheHash;
+
+	int64 GetModificationTime(const fs::path& path)
+	{
+		return static_cast<int64>(fs::last_write_time(path).time_since_epoch().count());
+	}
+
+	//Reads values out of a mapped cache, fails if the data is truncated
+	class CCacheReader
+	{
+	public:
+		CCacheReader(const uint8* data, size_t size)
+		    : m_data(data)
+		    , m_end(data + size)
+		{
+		}
+
+		template <typename ValueType>
+		ValueType Read()
+		{
+			ValueType value;
+			memcpy(&value, ReadBytes(sizeof(ValueType)), sizeof(ValueType));
+			return value;
+		}
+
+		const uint8* ReadBytes(size_t size)
+		{
+			if(static_cast<size_t>(m_end - m_data) < size)
+			{
+				throw std::runtime_error("Truncated config cache.");
+			}
+			auto result = m_data;
+			m_data += size;
+			return result;
+		}
+
+		std::string ReadString()
+		{
+			uint32 size = Read<uint32>();
+			auto data = reinterpret_cast<const char*>(ReadBytes(size));
+			return std::string(data, data + size);
+		}
+
+		bool IsEnd() const
+		{
+			return m_data == m_end;
+		}
+
+	private:
+		const uint8* m_data;
+		const uint8* m_end;
+	};
+
+	void WriteCacheString(CStream& stream, const std::string& value)
+	{
+		stream.Write32(static_cast<uint32>(value.size()));
+		stream.Write(value.data(), value.size());
+	}
+}
+
+CConfig::CConfig(const PathType& path, bool readonly, bool useCache)
     : m_path(path)
     , m_readonly(readonly)
+    , m_useCache(useCache)
 {
 	Load();
 }
@@ -86,37 +153,40 @@ std::shared_ptr<Type> CConfig::FindPreference(const char* name)
 	return pref;
 }
 
-void CConfig::RegisterPreferenceInteger(const char* name, int value)
+CConfig::IntHandle CConfig::RegisterPreferenceInteger(const char* name, int value)
 {
-	if(FindPreference<CPreference>(name))
+	if(auto existingPreference = FindPreference<CPreference>(name))
 	{
-		return;
+		return IntHandle(CastPreference<CPreferenceInteger>(existingPreference));
 	}
 
 	auto preference = std::make_shared<CPreferenceInteger>(name, value);
 	InsertPreference(preference);
+	return IntHandle(preference);
 }
 
-void CConfig::RegisterPreferenceBoolean(const char* name, bool value)
+CConfig::BoolHandle CConfig::RegisterPreferenceBoolean(const char* name, bool value)
 {
-	if(FindPreference<CPreference>(name))
+	if(auto existingPreference = FindPreference<CPreference>(name))
 	{
-		return;
+		return BoolHandle(CastPreference<CPreferenceBoolean>(existingPreference));
 	}
 
 	auto preference = std::make_shared<CPreferenceBoolean>(name, value);
 	InsertPreference(preference);
+	return BoolHandle(preference);
 }
 
-void CConfig::RegisterPreferenceFloat(const char* name, float value)
+CConfig::FloatHandle CConfig::RegisterPreferenceFloat(const char* name, float value)
 {
-	if(FindPreference<CPreference>(name))
+	if(auto existingPreference = FindPreference<CPreference>(name))
 	{
-		return;
+		return FloatHandle(CastPreference<CPreferenceFloat>(existingPreference));
 	}
 
 	auto preference = std::make_shared<CPreferenceFloat>(name, value);
 	InsertPreference(preference);
+	return FloatHandle(preference);
 }
 
 void CConfig::RegisterPreferenceString(const char* name, const char* value)
@@ -255,8 +325,21 @@ CConfig::PathType CConfig::GetConfigPath() const
 	return m_path;
 }
 
+CConfig::PathType CConfig::GetCachePath() const
+{
+	auto cachePath = m_path;
+	cachePath += ".cache";
+	return cachePath;
+}
+
 void CConfig::Load()
 {
+	FRAMEWORK_STARTUP_PHASE("Config::Load");
+	if(m_useCache && LoadCache())
+	{
+		return;
+	}
+
 	std::unique_ptr<Xml::CNode> document;
 
 	try
@@ -338,6 +421,131 @@ void CConfig::Load()
 			assert(false);
 		}
 	}
+
+	if(m_useCache && !m_readonly)
+	{
+		SaveCache();
+	}
+}
+
+bool CConfig::LoadCache()
+{
+	try
+	{
+		CMappedFileStream cacheStream(GetCachePath());
+		CCacheReader reader(cacheStream.GetData(), static_cast<size_t>(cacheStream.GetLength()));
+		if(reader.Read<uint32>() != CACHE_SIGNATURE) return false;
+		if(reader.Read<uint32>() != CACHE_VERSION) return false;
+
+		//Cache is only valid for the exact XML it was made from
+		if(reader.Read<int64>() != GetModificationTime(m_path)) return false;
+		uint64 xmlSize = reader.Read<uint64>();
+		auto xmlHash = reader.Read<CacheHash>();
+		CMappedFileStream xmlStream(m_path);
+		if(xmlStream.GetLength() != xmlSize) return false;
+		if(HashUtils::ComputeSha256(xmlStream.GetData(), static_cast<size_t>(xmlSize)) != xmlHash) return false;
+
+		//Decode everything before registering so that a bad cache doesn't leave partial state behind
+		PreferenceMapType preferences;
+		uint32 preferenceCount = reader.Read<uint32>();
+		for(uint32 i = 0; i < preferenceCount; i++)
+		{
+			auto type = static_cast<PREFERENCE_TYPE>(reader.Read<uint8>());
+			auto name = reader.ReadString();
+			PreferencePtr preference;
+			switch(type)
+			{
+			case TYPE_INTEGER:
+				preference = std::make_shared<CPreferenceInteger>(name.c_str(), reader.Read<int32>());
+				break;
+			case TYPE_BOOLEAN:
+				preference = std::make_shared<CPreferenceBoolean>(name.c_str(), reader.Read<uint8>() != 0);
+				break;
+			case TYPE_FLOAT:
+				preference = std::make_shared<CPreferenceFloat>(name.c_str(), reader.Read<float>());
+				break;
+			case TYPE_STRING:
+				preference = std::make_shared<CPreferenceString>(name.c_str(), reader.ReadString().c_str());
+				break;
+			case TYPE_PATH:
+				preference = std::make_shared<CPreferencePath>(name.c_str(), PathUtils::GetPathFromNativeString(reader.ReadString()));
+				break;
+			default:
+				return false;
+			}
+			preferences[name] = std::move(preference);
+		}
+		if(!reader.IsEnd()) return false;
+
+		for(const auto& preferencePair : preferences)
+		{
+			if(FindPreference<CPreference>(preferencePair.first.c_str())) continue;
+			InsertPreference(preferencePair.second);
+		}
+		return true;
+	}
+	catch(...)
+	{
+		return false;
+	}
+}
+
+void CConfig::SaveCache()
+{
+	try
+	{
+		CMemStream cache;
+		{
+			CMappedFileStream xmlStream(m_path);
+			uint64 xmlSize = xmlStream.GetLength();
+			auto xmlHash = HashUtils::ComputeSha256(xmlStream.GetData(), static_cast<size_t>(xmlSize));
+			int64 modificationTime = GetModificationTime(m_path);
+			cache.Write32(CACHE_SIGNATURE);
+			cache.Write32(CACHE_VERSION);
+			cache.Write(&modificationTime, sizeof(modificationTime));
+			cache.Write64(xmlSize);
+			cache.Write(xmlHash.data(), xmlHash.size());
+		}
+
+		{
+			std::unique_lock<std::mutex> mutexLock(m_mutex);
+			cache.Write32(static_cast<uint32>(m_preferences.size()));
+			for(const auto& preferencePair : m_preferences)
+			{
+				const auto& preference = preferencePair.second;
+				cache.Write8(static_cast<uint8>(preference->GetType()));
+				WriteCacheString(cache, preference->GetName());
+				switch(preference->GetType())
+				{
+				case TYPE_INTEGER:
+					cache.Write32(static_cast<uint32>(std::static_pointer_cast<CPreferenceInteger>(preference)->GetValue()));
+					break;
+				case TYPE_BOOLEAN:
+					cache.Write8(std::static_pointer_cast<CPreferenceBoolean>(preference)->GetValue() ? 1 : 0);
+					break;
+				case TYPE_FLOAT:
+					{
+						float value = std::static_pointer_cast<CPreferenceFloat>(preference)->GetValue();
+						cache.Write(&value, sizeof(value));
+					}
+					break;
+				case TYPE_STRING:
+					WriteCacheString(cache, std::static_pointer_cast<CPreferenceString>(preference)->GetValue());
+					break;
+				case TYPE_PATH:
+					WriteCacheString(cache, PathUtils::GetNativeStringFromPath(std::static_pointer_cast<CPreferencePath>(preference)->GetValue()));
+					break;
+				}
+			}
+		}
+
+		Framework::CStdStream stream(CreateOutputStdStream(GetCachePath().native()));
+		stream.Write(cache.GetBuffer(), cache.GetSize());
+	}
+	catch(...)
+	{
+		//Cache is optional, a missing one only makes the next load slower
+	}
 }
 
 void CConfig::Save()
@@ -372,6 +580,11 @@ void CConfig::Save()
 	{
 		return;
 	}
+
+	if(m_useCache)
+	{
+		SaveCache();
+	}
 }
 
 void CConfig::InsertPreference(const PreferencePtr& preference)
@@ -438,19 +651,22 @@ CConfig::CPreferenceInteger::CPreferenceInteger(const char* name, int value)
 
 int CConfig::CPreferenceInteger::GetValue() const
 {
-	return m_value;
+	return m_value.load();
 }
 
 void CConfig::CPreferenceInteger::SetValue(int value)
 {
-	m_value = value;
+	if(m_value.exchange(value) != value)
+	{
+		ValueChanged(value);
+	}
 }
 
 void CConfig::CPreferenceInteger::Serialize(Xml::CNode* pNode) const
 {
 	CPreference::Serialize(pNode);
 
-	pNode->InsertAttribute(Xml::CreateAttributeIntValue(PREFERENCE_ATTRIBUTE_NAME_VALUE, m_value));
+	pNode->InsertAttribute(Xml::CreateAttributeIntValue(PREFERENCE_ATTRIBUTE_NAME_VALUE, m_value.load()));
 }
 
 /////////////////////////////////////////////////////////
@@ -465,19 +681,22 @@ CConfig::CPreferenceBoolean::CPreferenceBoolean(const char* name, bool value)
 
 bool CConfig::CPreferenceBoolean::GetValue() const
 {
-	return m_value;
+	return m_value.load();
 }
 
 void CConfig::CPreferenceBoolean::SetValue(bool value)
 {
-	m_value = value;
+	if(m_value.exchange(value) != value)
+	{
+		ValueChanged(value);
+	}
 }
 
 void CConfig::CPreferenceBoolean::Serialize(Xml::CNode* pNode) const
 {
 	CPreference::Serialize(pNode);
 
-	pNode->InsertAttribute(Xml::CreateAttributeBoolValue(PREFERENCE_ATTRIBUTE_NAME_VALUE, m_value));
+	pNode->InsertAttribute(Xml::CreateAttributeBoolValue(PREFERENCE_ATTRIBUTE_NAME_VALUE, m_value.load()));
 }
 
 /////////////////////////////////////////////////////////
@@ -492,19 +711,22 @@ CConfig::CPreferenceFloat::CPreferenceFloat(const char* name, float value)
 
 float CConfig::CPreferenceFloat::GetValue() const
 {
-	return m_value;
+	return m_value.load();
 }
 
 void CConfig::CPreferenceFloat::SetValue(float value)
 {
-	m_value = value;
+	if(m_value.exchange(value) != value)
+	{
+		ValueChanged(value);
+	}
 }
 
 void CConfig::CPreferenceFloat::Serialize(Xml::CNode* pNode) const
 {
 	CPreference::Serialize(pNode);
 
-	pNode->InsertAttribute(Xml::CreateAttributeFloatValue(PREFERENCE_ATTRIBUTE_NAME_VALUE, m_value));
+	pNode->InsertAttribute(Xml::CreateAttributeFloatValue(PREFERENCE_ATTRIBUTE_NAME_VALUE, m_value.load()));
 }
 
 /////////////////////////////////////////////////////////
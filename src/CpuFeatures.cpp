@@ -0,0 +1,113 @@
+#include "CpuFeatures.h"
+#include "SimdDefs.h"
+
+#if defined(FRAMEWORK_SIMD_HAS_X86_DISPATCH)
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+#if defined(__linux__) && (defined(__arm__) || defined(__aarch64__))
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
+using namespace Framework;
+
+#if defined(FRAMEWORK_SIMD_HAS_X86_DISPATCH)
+
+static void GetCpuId(uint32 leaf, uint32 subLeaf, uint32* regs)
+{
+#if defined(_MSC_VER)
+	int info[4] = {};
+	__cpuidex(info, leaf, subLeaf);
+	for(unsigned int i = 0; i < 4; i++)
+	{
+		regs[i] = info[i];
+	}
+#else
+	__cpuid_count(leaf, subLeaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+static uint64 GetXcr0()
+{
+#if defined(_MSC_VER)
+	return _xgetbv(0);
+#else
+	uint32 eax = 0, edx = 0;
+	__asm__ __volatile__("xgetbv"
+	                     : "=a"(eax), "=d"(edx)
+	                     : "c"(0));
+	return (static_cast<uint64>(edx) << 32) | eax;
+#endif
+}
+
+#endif
+
+uint32 CCpuFeatures::GetFeatures()
+{
+	static const uint32 features = DetectFeatures();
+	return features;
+}
+
+bool CCpuFeatures::HasFeatures(uint32 requiredFeatures)
+{
+	return (GetFeatures() & requiredFeatures) == requiredFeatures;
+}
+
+uint32 CCpuFeatures::DetectFeatures()
+{
+	uint32 features = 0;
+#if defined(FRAMEWORK_SIMD_HAS_X86_DISPATCH)
+	uint32 regs[4] = {};
+	GetCpuId(0, 0, regs);
+	uint32 maxLeaf = regs[0];
+	if(maxLeaf < 1) return features;
+
+	GetCpuId(1, 0, regs);
+	if(regs[3] & (1 << 26)) features |= FEATURE_SSE2;
+	if(regs[2] & (1 << 9)) features |= FEATURE_SSSE3;
+	if(regs[2] & (1 << 19)) features |= FEATURE_SSE41;
+	if(regs[2] & (1 << 20)) features |= FEATURE_SSE42;
+	if(regs[2] & (1 << 1)) features |= FEATURE_PCLMUL;
+
+	//AVX state needs to be enabled by the OS
+	bool hasOsXsave = (regs[2] & (1 << 27)) != 0;
+	bool hasAvx = (regs[2] & (1 << 28)) != 0;
+
+	if(maxLeaf >= 7)
+	{
+		GetCpuId(7, 0, regs);
+		if(regs[1] & (1 << 29)) features |= FEATURE_X86_SHA;
+	}
+	if(!hasOsXsave || !hasAvx || (maxLeaf < 7)) return features;
+
+	uint64 xcr0 = GetXcr0();
+	bool hasYmmState = (xcr0 & 0x06) == 0x06;
+	bool hasZmmState = (xcr0 & 0xE6) == 0xE6;
+
+	GetCpuId(7, 0, regs);
+	if(hasYmmState && (regs[1] & (1 << 5))) features |= FEATURE_AVX2;
+	if(hasZmmState && (regs[1] & (1 << 16)) && (regs[1] & (1 << 30))) features |= FEATURE_AVX512;
+#elif defined(FRAMEWORK_SIMD_USE_NEON)
+#if defined(__linux__) && defined(__arm__)
+	if(getauxval(AT_HWCAP) & HWCAP_NEON) features |= FEATURE_NEON;
+#else
+	//NEON is always available on AArch64 and on other platforms we build NEON code for
+	features |= FEATURE_NEON;
+#endif
+#if defined(FRAMEWORK_SIMD_HAS_ARM_SHA2)
+#if defined(__linux__)
+	if(getauxval(AT_HWCAP) & HWCAP_SHA2) features |= FEATURE_ARM_SHA2;
+	if(getauxval(AT_HWCAP) & HWCAP_CRC32) features |= FEATURE_ARM_CRC32;
+#else
+	//Every Apple ARM64 CPU has them
+	features |= FEATURE_ARM_SHA2 | FEATURE_ARM_CRC32;
+#endif
+#endif
+#endif
+	return features;
+}
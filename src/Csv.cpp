@@ -1,5 +1,27 @@
 #include "Csv.h"
+#include "BitManip.h"
+#include "BufferedStream.h"
+#include "MemStream.h"
+#include "PtrStream.h"
+#include "SpanStream.h"
+#include "StreamReader.h"
+#include "ParallelFor.h"
+#include "SimdDefs.h"
+#include "ThreadPool.h"
+#include <algorithm>
 #include <cassert>
+#include <charconv>
+#include <condition_variable>
+#include <cstring>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+#include <emmintrin.h>
+#elif defined(FRAMEWORK_SIMD_USE_NEON)
+#include <arm_neon.h>
+#endif
 
 using namespace Framework;
 using namespace Framework::Csv;
@@ -13,6 +35,61 @@ enum class PARSER_STATE
 	DONE
 };
 
+//Finds the next separator or new line
+static const char* FindFieldEnd(const char* begin, const char* end, char separator)
+{
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+	const __m128i separators = _mm_set1_epi8(separator);
+	const __m128i newLines = _mm_set1_epi8('\n');
+	while((end - begin) >= 16)
+	{
+		__m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+		int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(values, separators), _mm_cmpeq_epi8(values, newLines)));
+		if(mask != 0)
+		{
+			return begin + __builtin_ctz(mask);
+		}
+		begin += 16;
+	}
+#elif defined(FRAMEWORK_SIMD_USE_NEON)
+	const uint8x16_t separators = vdupq_n_u8(separator);
+	const uint8x16_t newLines = vdupq_n_u8('\n');
+	while((end - begin) >= 16)
+	{
+		uint8x16_t values = vld1q_u8(reinterpret_cast<const uint8*>(begin));
+		uint8x16_t matches = vorrq_u8(vceqq_u8(values, separators), vceqq_u8(values, newLines));
+		uint64 mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(matches), 4)), 0);
+		if(mask != 0)
+		{
+			return begin + (__builtin_ctzll(mask) / 4);
+		}
+		begin += 16;
+	}
+#endif
+	while((begin != end) && (*begin != separator) && (*begin != '\n'))
+	{
+		begin++;
+	}
+	return begin;
+}
+
+//Finds where the next record starts, 'isQuoted' tells if 'begin' is inside a quoted field
+static const char* FindRecordStart(const char* begin, const char* end, bool isQuoted)
+{
+	for(; begin != end; begin++)
+	{
+		if(*begin == '\"')
+		{
+			isQuoted = !isQuoted;
+		}
+		else if((*begin == '\n') && !isQuoted)
+		{
+			return begin + 1;
+		}
+	}
+	return end;
+}
+
 static std::string CsvEscape(const std::string& input)
 {
 	std::string result;
@@ -31,7 +108,9 @@ static std::string CsvEscape(const std::string& input)
 	return result;
 }
 
-Contents Csv::Parse(CStream& stream, char separator)
+//Reads one character at a time, instantiated for streams that can do so without a virtual call
+template <typename StreamType>
+static Contents ParseStream(StreamType& stream, char separator)
 {
 	char textDelimiter = '\"';
 	bool useTextDelimiter = true;
@@ -142,6 +221,28 @@ Contents Csv::Parse(CStream& stream, char separator)
 	return contents;
 }
 
+Contents Csv::Parse(CStream& inputStream, char separator)
+{
+	//Memory streams are read in place, others through a buffer
+	if(auto ptrStream = dynamic_cast<CPtrStream*>(&inputStream))
+	{
+		CStreamReader<CPtrStream> reader(*ptrStream);
+		return ParseStream(reader, separator);
+	}
+	else if(auto memStream = dynamic_cast<CMemStream*>(&inputStream))
+	{
+		CStreamReader<CMemStream> reader(*memStream);
+		return ParseStream(reader, separator);
+	}
+	else if(auto spanStream = dynamic_cast<CSpanStream*>(&inputStream))
+	{
+		CStreamReader<CSpanStream> reader(*spanStream);
+		return ParseStream(reader, separator);
+	}
+	CBufferedStream stream(inputStream);
+	return ParseStream(stream, separator);
+}
+
 void Csv::Write(const Contents& contents, CStream& outputStream, char separator)
 {
 	for(const auto& line : contents)
@@ -165,3 +266,402 @@ void Csv::Write(const Contents& contents, CStream& outputStream, char separator)
 		outputStream.Write(lineString.c_str(), lineString.size());
 	}
 }
+
+CReader::CReader(CStream& stream, char separator, size_t bufferSize)
+    : m_stream(&stream)
+    , m_separator(separator)
+{
+	//Mapped files and other in memory streams can be read in place
+	if(auto spanStream = dynamic_cast<CSpanStream*>(&stream))
+	{
+		uint64 remaining = spanStream->GetRemainingLength();
+		if(remaining != 0)
+		{
+			m_position = reinterpret_cast<const char*>(spanStream->GetSpan(spanStream->Tell(), remaining));
+			m_end = m_position + remaining;
+		}
+		m_isSourceEof = true;
+		return;
+	}
+	m_buffer.resize(std::max<size_t>(bufferSize, 1));
+}
+
+CReader::CReader(const char* data, size_t size, char separator)
+    : m_separator(separator)
+    , m_position(data)
+    , m_end(data + size)
+    , m_isSourceEof(true)
+{
+}
+
+bool CReader::Next()
+{
+	m_fields.clear();
+	while(1)
+	{
+		if(m_position == m_end)
+		{
+			if(m_isSourceEof) return false;
+			Refill();
+			continue;
+		}
+		if(ParseRow()) return true;
+		Refill();
+	}
+}
+
+size_t CReader::GetFieldCount() const
+{
+	return m_fields.size();
+}
+
+std::string_view CReader::GetField(size_t index) const
+{
+	if(index >= m_fields.size())
+	{
+		throw std::runtime_error("Field index out of range.");
+	}
+	return m_fields[index];
+}
+
+int64 CReader::GetInt(size_t index) const
+{
+	auto field = GetField(index);
+	int64 value = 0;
+	auto result = std::from_chars(field.data(), field.data() + field.size(), value);
+	if((result.ec != std::errc()) || (result.ptr != (field.data() + field.size())))
+	{
+		throw std::runtime_error("Field is not an integer.");
+	}
+	return value;
+}
+
+double CReader::GetDouble(size_t index) const
+{
+	auto field = GetField(index);
+	double value = 0;
+	auto result = std::from_chars(field.data(), field.data() + field.size(), value);
+	if((result.ec != std::errc()) || (result.ptr != (field.data() + field.size())))
+	{
+		throw std::runtime_error("Field is not a number.");
+	}
+	return value;
+}
+
+//Returns false if the row isn't complete in the buffer
+bool CReader::ParseRow()
+{
+	const char* position = m_position;
+	m_rowFields.clear();
+	m_unescaped.clear();
+	while(1)
+	{
+		FIELD field;
+		bool isQuoted = (position != m_end) && (*position == '\"');
+		if(isQuoted)
+		{
+			field.offset = m_unescaped.size();
+			position++;
+			while(1)
+			{
+				auto quote = reinterpret_cast<const char*>(memchr(position, '\"', m_end - position));
+				if(quote == nullptr)
+				{
+					if(m_isSourceEof)
+					{
+						throw std::runtime_error("Unexpected end of file in quoted field.");
+					}
+					return false;
+				}
+				m_unescaped.append(position, quote);
+				position = quote + 1;
+				//Need the next character to know if the quote is escaped
+				if((position == m_end) && !m_isSourceEof) return false;
+				if((position == m_end) || (*position != '\"')) break;
+				m_unescaped += '\"';
+				position++;
+			}
+		}
+
+		auto fieldEnd = FindFieldEnd(position, m_end, m_separator);
+		if((fieldEnd == m_end) && !m_isSourceEof) return false;
+		bool isRowEnd = (fieldEnd == m_end) || (*fieldEnd == '\n');
+
+		//Drop CR of CRLF line endings
+		auto valueEnd = fieldEnd;
+		if(isRowEnd && (valueEnd != position) && (valueEnd[-1] == '\r'))
+		{
+			valueEnd--;
+		}
+
+		if(isQuoted)
+		{
+			//Characters after the closing quote are kept, like Parse does
+			m_unescaped.append(position, valueEnd);
+			field.size = m_unescaped.size() - field.offset;
+		}
+		else
+		{
+			field.data = position;
+			field.size = valueEnd - position;
+		}
+		m_rowFields.push_back(field);
+
+		position = (fieldEnd == m_end) ? fieldEnd : (fieldEnd + 1);
+		if(isRowEnd) break;
+	}
+	m_position = position;
+
+	//Unescaped values are all in place now, views can be made
+	for(const auto& field : m_rowFields)
+	{
+		const char* data = field.data ? field.data : (m_unescaped.data() + field.offset);
+		m_fields.emplace_back(data, field.size);
+	}
+	return true;
+}
+
+void CReader::Refill()
+{
+	assert(!m_isSourceEof);
+	//Keep what's left of the current row at the start of the buffer
+	size_t pending = m_end - m_position;
+	if(pending != 0)
+	{
+		memmove(m_buffer.data(), m_position, pending);
+	}
+	if(pending == m_buffer.size())
+	{
+		//Row doesn't fit in the buffer
+		m_buffer.resize(m_buffer.size() * 2);
+	}
+	size_t amountRead = static_cast<size_t>(m_stream->Read(m_buffer.data() + pending, m_buffer.size() - pending));
+	if((amountRead == 0) || m_stream->IsEOF())
+	{
+		m_isSourceEof = true;
+	}
+	m_position = m_buffer.data();
+	m_end = m_position + pending + amountRead;
+}
+
+void Csv::ParseParallel(CSpanStream& stream, const RowBatchHandler& handler, CThreadPool* threadPool, char separator, size_t chunkSize)
+{
+	uint64 remaining = stream.GetRemainingLength();
+	if(remaining == 0) return;
+
+	auto data = reinterpret_cast<const char*>(stream.GetSpan(stream.Tell(), remaining));
+	auto dataEnd = data + remaining;
+	size_t size = static_cast<size_t>(remaining);
+	chunkSize = std::max<size_t>(chunkSize, 1);
+	size_t chunkCount = (size + chunkSize - 1) / chunkSize;
+
+	//Quotes always come in pairs outside of quoted fields (escaped quotes included), so the parity of
+	//the number of quotes before a position tells if it's inside a quoted field
+	std::vector<uint8> chunkParities(chunkCount);
+	ParallelFor(threadPool, 0, chunkCount,
+	            [&](size_t chunkBegin, size_t chunkEnd) {
+		            for(size_t i = chunkBegin; i < chunkEnd; i++)
+		            {
+			            auto begin = data + (i * chunkSize);
+			            auto end = begin + std::min(chunkSize, size - (i * chunkSize));
+			            chunkParities[i] = static_cast<uint8>(std::count(begin, end, '\"') & 1);
+		            }
+	            });
+
+	std::vector<const char*> boundaries;
+	boundaries.push_back(data);
+	bool isQuoted = false;
+	for(size_t i = 1; i < chunkCount; i++)
+	{
+		isQuoted ^= (chunkParities[i - 1] != 0);
+		auto chunkStart = data + (i * chunkSize);
+		//Previous chunk's record might span over this one
+		if(chunkStart < boundaries.back()) continue;
+		auto recordStart = FindRecordStart(chunkStart, dataEnd, isQuoted);
+		if(recordStart == dataEnd) break;
+		if(recordStart != boundaries.back())
+		{
+			boundaries.push_back(recordStart);
+		}
+	}
+	boundaries.push_back(dataEnd);
+	size_t batchCount = boundaries.size() - 1;
+
+	auto parseBatch =
+	    [&](size_t index, Contents& rows) {
+		    CReader reader(boundaries[index], boundaries[index + 1] - boundaries[index], separator);
+		    while(reader.Next())
+		    {
+			    Line line;
+			    line.reserve(reader.GetFieldCount());
+			    for(size_t field = 0; field < reader.GetFieldCount(); field++)
+			    {
+				    line.emplace_back(reader.GetField(field));
+			    }
+			    rows.push_back(std::move(line));
+		    }
+	    };
+
+	if(!threadPool)
+	{
+		for(size_t i = 0; i < batchCount; i++)
+		{
+			Contents rows;
+			parseBatch(i, rows);
+			handler(rows);
+		}
+		return;
+	}
+
+	struct BATCH
+	{
+		Contents rows;
+		bool done = false;
+		std::exception_ptr exception;
+	};
+
+	std::vector<BATCH> batches(batchCount);
+	std::mutex mutex;
+	std::condition_variable condition;
+	unsigned int runningCount = 0;
+	size_t nextBatch = 0;
+
+	//Only keep a few batches ahead of the handler to bound memory usage
+	size_t maxPendingCount = std::max<size_t>(threadPool->GetThreadCount(), 1) * 2;
+
+	auto runBatch =
+	    [&](size_t index) {
+		    auto& batch = batches[index];
+		    try
+		    {
+			    parseBatch(index, batch.rows);
+		    }
+		    catch(...)
+		    {
+			    batch.exception = std::current_exception();
+		    }
+		    std::unique_lock<std::mutex> lock(mutex);
+		    batch.done = true;
+		    runningCount--;
+		    condition.notify_all();
+	    };
+
+	std::exception_ptr exception;
+
+	std::unique_lock<std::mutex> lock(mutex);
+	for(size_t handledBatch = 0; handledBatch < batchCount; handledBatch++)
+	{
+		while((nextBatch < batchCount) && ((nextBatch - handledBatch) < maxPendingCount))
+		{
+			size_t index = nextBatch++;
+			runningCount++;
+			threadPool->Enqueue([&runBatch, index]() { runBatch(index); });
+		}
+
+		auto& batch = batches[handledBatch];
+		condition.wait(lock, [&batch]() { return batch.done; });
+		if(batch.exception)
+		{
+			exception = batch.exception;
+			break;
+		}
+
+		lock.unlock();
+		try
+		{
+			handler(batch.rows);
+		}
+		catch(...)
+		{
+			exception = std::current_exception();
+		}
+		batch.rows = Contents();
+		lock.lock();
+		if(exception) break;
+	}
+
+	if(exception)
+	{
+		//Tasks still reference the batches
+		condition.wait(lock, [&]() { return runningCount == 0; });
+		std::rethrow_exception(exception);
+	}
+}
+
+CWriter::CWriter(CStream& stream, char separator, size_t bufferSize)
+    : m_stream(stream)
+    , m_separator(separator)
+{
+	m_buffer.resize(std::max<size_t>(bufferSize, 1));
+}
+
+CWriter::~CWriter()
+{
+	Flush();
+}
+
+void CWriter::WriteField(std::string_view field)
+{
+	if(!m_isRowStart)
+	{
+		WriteRaw(&m_separator, 1);
+	}
+	m_isRowStart = false;
+
+	bool needsQuotes = std::any_of(field.begin(), field.end(),
+	                               [this](char value) { return (value == m_separator) || (value == '\"') || (value == '\n') || (value == '\r'); });
+	if(!needsQuotes)
+	{
+		WriteRaw(field.data(), field.size());
+		return;
+	}
+
+	WriteRaw("\"", 1);
+	while(1)
+	{
+		size_t quotePos = field.find('\"');
+		if(quotePos == std::string_view::npos) break;
+		WriteRaw(field.data(), quotePos + 1);
+		WriteRaw("\"", 1);
+		field.remove_prefix(quotePos + 1);
+	}
+	WriteRaw(field.data(), field.size());
+	WriteRaw("\"", 1);
+}
+
+void CWriter::WriteRow(const Line& line)
+{
+	for(const auto& field : line)
+	{
+		WriteField(field);
+	}
+	EndRow();
+}
+
+void CWriter::EndRow()
+{
+	WriteRaw("\n", 1);
+	m_isRowStart = true;
+}
+
+void CWriter::Flush()
+{
+	if(m_bufferSize == 0) return;
+	m_stream.Write(m_buffer.data(), m_bufferSize);
+	m_bufferSize = 0;
+}
+
+void CWriter::WriteRaw(const char* data, size_t size)
+{
+	if((m_bufferSize + size) > m_buffer.size())
+	{
+		Flush();
+		if(size >= m_buffer.size())
+		{
+			m_stream.Write(data, size);
+			return;
+		}
+	}
+	memcpy(m_buffer.data() + m_bufferSize, data, size);
+	m_bufferSize += size;
+}
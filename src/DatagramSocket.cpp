@@ -0,0 +1,489 @@
+#include "DatagramSocket.h"
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include "SocketStream.h"
+
+#if defined(__linux__)
+#define DATAGRAM_USE_MMSG
+#include <netinet/udp.h>
+#include <sys/uio.h>
+//Missing from older headers, kernels without support reject them at runtime
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
+#endif
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/select.h>
+#endif
+
+using namespace Framework;
+
+namespace
+{
+	//Leaves room for the IP and UDP headers
+	constexpr size_t g_maxCoalescedSize = 65000;
+	constexpr size_t g_maxSegmentCount = 64;
+	constexpr size_t g_coalescedSlotSize = 0x10000;
+
+	bool IsWouldBlockError()
+	{
+#ifdef _WIN32
+		return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+		return (errno == EAGAIN) || (errno == EWOULDBLOCK);
+#endif
+	}
+
+	//Errors that only affect one packet and don't stop the batch
+	bool IsPacketError()
+	{
+#ifdef _WIN32
+		//Reported when an earlier packet reached a closed port, or when a packet was too large
+		int error = WSAGetLastError();
+		return (error == WSAECONNRESET) || (error == WSAEMSGSIZE);
+#else
+		return (errno == EINTR) || (errno == ECONNREFUSED);
+#endif
+	}
+
+#ifdef DATAGRAM_USE_MMSG
+	bool IsSameAddress(const sockaddr_in& address1, const sockaddr_in& address2)
+	{
+		return (address1.sin_addr.s_addr == address2.sin_addr.s_addr) && (address1.sin_port == address2.sin_port);
+	}
+#endif
+}
+
+struct CDatagramSocket::BATCH_STATE
+{
+#ifdef DATAGRAM_USE_MMSG
+	//Room for the largest control message used (UDP_GRO's int)
+	static constexpr size_t CONTROL_SIZE = CMSG_SPACE(sizeof(int));
+
+	std::vector<mmsghdr> messages;
+	std::vector<iovec> iovecs;
+	std::vector<sockaddr_in> addresses;
+	std::vector<uint8> controls;
+	//Number of packets sent by each message
+	std::vector<size_t> messagePacketCounts;
+
+	uint8* GetControl(size_t index)
+	{
+		return controls.data() + (index * CONTROL_SIZE);
+	}
+#endif
+};
+
+CDatagramSocket::CDatagramSocket(const sockaddr_in& bindAddress, uint32 batchSize, uint32 maxPacketSize)
+    : m_batchSize(batchSize)
+    , m_maxPacketSize(maxPacketSize)
+    , m_batchState(std::make_unique<BATCH_STATE>())
+{
+	assert(batchSize != 0);
+	assert(maxPacketSize != 0);
+
+	InitializeSocketSupport();
+
+	m_fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if(m_fd == INVALID_SOCKET)
+	{
+		throw std::runtime_error("Failed to create datagram socket.");
+	}
+
+	try
+	{
+		if(bind(m_fd, reinterpret_cast<const sockaddr*>(&bindAddress), sizeof(bindAddress)) != 0)
+		{
+			throw std::runtime_error("Failed to bind datagram socket.");
+		}
+
+#ifdef _WIN32
+		u_long nonBlocking = 1;
+		int result = ioctlsocket(m_fd, FIONBIO, &nonBlocking);
+#else
+		int result = fcntl(m_fd, F_SETFL, fcntl(m_fd, F_GETFL, 0) | O_NONBLOCK);
+#endif
+		if(result != 0)
+		{
+			throw std::runtime_error("Failed to make datagram socket non-blocking.");
+		}
+	}
+	catch(...)
+	{
+#ifdef _WIN32
+		closesocket(m_fd);
+#else
+		close(m_fd);
+#endif
+		throw;
+	}
+
+#ifdef DATAGRAM_USE_MMSG
+	//Setting a zero segment size only checks that the kernel knows about it
+	int segmentSize = 0;
+	m_sendSegmentation = (setsockopt(m_fd, SOL_UDP, UDP_SEGMENT, &segmentSize, sizeof(segmentSize)) == 0);
+
+	m_batchState->messages.resize(m_batchSize);
+	m_batchState->iovecs.resize(m_batchSize);
+	m_batchState->addresses.resize(m_batchSize);
+	m_batchState->controls.resize(m_batchSize * BATCH_STATE::CONTROL_SIZE);
+	m_batchState->messagePacketCounts.resize(m_batchSize);
+#endif
+
+	//One extra byte tells packets that were too large apart
+	AllocateReceiveSlots(m_maxPacketSize + 1);
+	m_sendBuffer.resize(m_batchSize * m_maxPacketSize);
+	m_sendPackets.resize(m_batchSize);
+}
+
+CDatagramSocket::~CDatagramSocket()
+{
+#ifdef _WIN32
+	closesocket(m_fd);
+#else
+	close(m_fd);
+#endif
+}
+
+SOCKET CDatagramSocket::GetSocket() const
+{
+	return m_fd;
+}
+
+sockaddr_in CDatagramSocket::GetLocalAddress() const
+{
+	sockaddr_in address = {};
+	socklen_t addressSize = sizeof(address);
+	if(getsockname(m_fd, reinterpret_cast<sockaddr*>(&address), &addressSize) != 0)
+	{
+		throw std::runtime_error("Failed to get datagram socket address.");
+	}
+	return address;
+}
+
+uint32 CDatagramSocket::GetBatchSize() const
+{
+	return m_batchSize;
+}
+
+uint32 CDatagramSocket::GetMaxPacketSize() const
+{
+	return m_maxPacketSize;
+}
+
+bool CDatagramSocket::EnableReceiveCoalescing()
+{
+#ifdef DATAGRAM_USE_MMSG
+	if(m_receiveCoalescing)
+	{
+		return true;
+	}
+	int enable = 1;
+	if(setsockopt(m_fd, SOL_UDP, UDP_GRO, &enable, sizeof(enable)) != 0)
+	{
+		return false;
+	}
+	m_receiveCoalescing = true;
+	AllocateReceiveSlots(g_coalescedSlotSize);
+	return true;
+#else
+	return false;
+#endif
+}
+
+bool CDatagramSocket::WaitForPackets(uint32 timeoutMs)
+{
+	fd_set readSet;
+	FD_ZERO(&readSet);
+	FD_SET(m_fd, &readSet);
+	timeval timeout = {};
+	timeout.tv_sec = timeoutMs / 1000;
+	timeout.tv_usec = (timeoutMs % 1000) * 1000;
+	int result = select(static_cast<int>(m_fd + 1), &readSet, nullptr, nullptr, &timeout);
+	if(result < 0)
+	{
+#ifndef _WIN32
+		if(errno == EINTR) return false;
+#endif
+		throw std::runtime_error("Failed to wait on datagram socket.");
+	}
+	return result != 0;
+}
+
+size_t CDatagramSocket::Receive()
+{
+	m_receivedPacketCount = 0;
+#ifdef DATAGRAM_USE_MMSG
+	auto& state = *m_batchState;
+	for(uint32 i = 0; i < m_batchSize; i++)
+	{
+		auto& iov = state.iovecs[i];
+		iov.iov_base = m_receiveBuffer.data() + (i * m_receiveSlotSize);
+		iov.iov_len = m_receiveSlotSize;
+
+		auto& message = state.messages[i];
+		message = mmsghdr();
+		message.msg_hdr.msg_name = &state.addresses[i];
+		message.msg_hdr.msg_namelen = sizeof(sockaddr_in);
+		message.msg_hdr.msg_iov = &iov;
+		message.msg_hdr.msg_iovlen = 1;
+		if(m_receiveCoalescing)
+		{
+			message.msg_hdr.msg_control = state.GetControl(i);
+			message.msg_hdr.msg_controllen = BATCH_STATE::CONTROL_SIZE;
+		}
+	}
+
+	int messageCount = 0;
+	while(true)
+	{
+		messageCount = recvmmsg(m_fd, state.messages.data(), m_batchSize, MSG_DONTWAIT, nullptr);
+		if(messageCount >= 0) break;
+		if(IsWouldBlockError()) return 0;
+		if(!IsPacketError())
+		{
+			throw std::runtime_error("Datagram socket receive failed.");
+		}
+	}
+
+	for(int i = 0; i < messageCount; i++)
+	{
+		const auto& message = state.messages[i];
+		const auto* data = reinterpret_cast<const uint8*>(state.iovecs[i].iov_base);
+		size_t size = message.msg_len;
+		if((message.msg_hdr.msg_flags & MSG_TRUNC) || (size > m_receiveSlotSize))
+		{
+			continue;
+		}
+		const auto& address = state.addresses[i];
+
+		size_t segmentSize = 0;
+		if(m_receiveCoalescing)
+		{
+			auto header = const_cast<msghdr*>(&message.msg_hdr);
+			for(auto control = CMSG_FIRSTHDR(header); control; control = CMSG_NXTHDR(header, control))
+			{
+				if((control->cmsg_level == SOL_UDP) && (control->cmsg_type == UDP_GRO))
+				{
+					int value = 0;
+					memcpy(&value, CMSG_DATA(control), sizeof(value));
+					segmentSize = value;
+				}
+			}
+		}
+
+		if(segmentSize == 0)
+		{
+			if(size <= m_maxPacketSize)
+			{
+				AddReceivedPacket(data, size, address);
+			}
+			continue;
+		}
+
+		//Coalesced packets all have the segment size, except for the last one that can be shorter
+		for(size_t offset = 0; offset < size; offset += segmentSize)
+		{
+			size_t packetSize = std::min(segmentSize, size - offset);
+			if(packetSize <= m_maxPacketSize)
+			{
+				AddReceivedPacket(data + offset, packetSize, address);
+			}
+		}
+	}
+#else
+	for(uint32 i = 0; i < m_batchSize; i++)
+	{
+		auto data = m_receiveBuffer.data() + (i * m_receiveSlotSize);
+		sockaddr_in address = {};
+		socklen_t addressSize = sizeof(address);
+		auto result = recvfrom(m_fd, reinterpret_cast<char*>(data), static_cast<int>(m_receiveSlotSize), 0,
+		                       reinterpret_cast<sockaddr*>(&address), &addressSize);
+		if(result < 0)
+		{
+			if(IsWouldBlockError()) break;
+			if(IsPacketError()) continue;
+			throw std::runtime_error("Datagram socket receive failed.");
+		}
+		if(static_cast<size_t>(result) <= m_maxPacketSize)
+		{
+			AddReceivedPacket(data, result, address);
+		}
+	}
+#endif
+	return m_receivedPacketCount;
+}
+
+const CDatagramSocket::PACKET& CDatagramSocket::GetReceivedPacket(size_t index) const
+{
+	assert(index < m_receivedPacketCount);
+	return m_receivedPackets[index];
+}
+
+uint8* CDatagramSocket::BeginPacket()
+{
+	if(m_sendPacketCount == m_batchSize)
+	{
+		Flush();
+	}
+	return m_sendBuffer.data() + (m_sendPacketCount * m_maxPacketSize);
+}
+
+void CDatagramSocket::EndPacket(size_t size, const sockaddr_in& address)
+{
+	assert(m_sendPacketCount < m_batchSize);
+	assert(size <= m_maxPacketSize);
+	auto& packet = m_sendPackets[m_sendPacketCount++];
+	packet.size = size;
+	packet.address = address;
+}
+
+void CDatagramSocket::Send(const void* data, size_t size, const sockaddr_in& address)
+{
+	if(size > m_maxPacketSize)
+	{
+		throw std::runtime_error("Datagram packet is too large.");
+	}
+	memcpy(BeginPacket(), data, size);
+	EndPacket(size, address);
+}
+
+size_t CDatagramSocket::Flush()
+{
+	size_t packetCount = m_sendPacketCount;
+	size_t sentCount = 0;
+	m_sendPacketCount = 0;
+#ifdef DATAGRAM_USE_MMSG
+	auto& state = *m_batchState;
+	size_t packetIndex = 0;
+	while(packetIndex < packetCount)
+	{
+		//Messages are rebuilt after a partial send, or when segmentation turns out to be unavailable
+		size_t messageCount = 0;
+		for(size_t i = packetIndex; i < packetCount;)
+		{
+			const auto& packet = m_sendPackets[i];
+			size_t groupCount = 1;
+			size_t groupSize = packet.size;
+			if(m_sendSegmentation && (packet.size != 0))
+			{
+				//Every packet but the last one needs to have the segment size
+				while(((i + groupCount) < packetCount) && (groupCount < g_maxSegmentCount))
+				{
+					const auto& nextPacket = m_sendPackets[i + groupCount];
+					if(!IsSameAddress(nextPacket.address, packet.address)) break;
+					if((nextPacket.size == 0) || (nextPacket.size > packet.size)) break;
+					if((groupSize + nextPacket.size) > g_maxCoalescedSize) break;
+					groupSize += nextPacket.size;
+					groupCount++;
+					if(nextPacket.size != packet.size) break;
+				}
+			}
+
+			for(size_t j = 0; j < groupCount; j++)
+			{
+				auto& iov = state.iovecs[i + j - packetIndex];
+				iov.iov_base = m_sendBuffer.data() + ((i + j) * m_maxPacketSize);
+				iov.iov_len = m_sendPackets[i + j].size;
+			}
+
+			state.addresses[messageCount] = packet.address;
+			auto& message = state.messages[messageCount];
+			message = mmsghdr();
+			message.msg_hdr.msg_name = &state.addresses[messageCount];
+			message.msg_hdr.msg_namelen = sizeof(sockaddr_in);
+			message.msg_hdr.msg_iov = &state.iovecs[i - packetIndex];
+			message.msg_hdr.msg_iovlen = groupCount;
+			if(groupCount > 1)
+			{
+				message.msg_hdr.msg_control = state.GetControl(messageCount);
+				message.msg_hdr.msg_controllen = CMSG_SPACE(sizeof(uint16_t));
+				auto control = CMSG_FIRSTHDR(&message.msg_hdr);
+				control->cmsg_level = SOL_UDP;
+				control->cmsg_type = UDP_SEGMENT;
+				control->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+				uint16_t segmentSize = static_cast<uint16_t>(packet.size);
+				memcpy(CMSG_DATA(control), &segmentSize, sizeof(segmentSize));
+			}
+			state.messagePacketCounts[messageCount] = groupCount;
+			messageCount++;
+			i += groupCount;
+		}
+
+		int result = sendmmsg(m_fd, state.messages.data(), messageCount, 0);
+		if(result < 0)
+		{
+			if(errno == EINTR) continue;
+			if(m_sendSegmentation && ((errno == EIO) || (errno == EINVAL) || (errno == ENOPROTOOPT)))
+			{
+				//Device can't offload checksums or segmentation, send packets one by one from now on
+				m_sendSegmentation = false;
+				continue;
+			}
+			if(IsWouldBlockError() || (errno == ENOBUFS)) break;
+			if(errno == ECONNREFUSED)
+			{
+				//Previous packet reached a closed port, only the first message is lost
+				packetIndex += state.messagePacketCounts[0];
+				continue;
+			}
+			throw std::runtime_error("Datagram socket send failed.");
+		}
+		for(int i = 0; i < result; i++)
+		{
+			packetIndex += state.messagePacketCounts[i];
+			sentCount += state.messagePacketCounts[i];
+		}
+	}
+#else
+	for(size_t i = 0; i < packetCount; i++)
+	{
+		const auto& packet = m_sendPackets[i];
+		auto data = m_sendBuffer.data() + (i * m_maxPacketSize);
+		auto result = sendto(m_fd, reinterpret_cast<const char*>(data), static_cast<int>(packet.size), 0,
+		                     reinterpret_cast<const sockaddr*>(&packet.address), sizeof(packet.address));
+		if(result < 0)
+		{
+			if(IsWouldBlockError()) break;
+			if(IsPacketError()) continue;
+#ifndef _WIN32
+			if(errno == ENOBUFS) break;
+#endif
+			throw std::runtime_error("Datagram socket send failed.");
+		}
+		sentCount++;
+	}
+#endif
+	return sentCount;
+}
+
+void CDatagramSocket::AllocateReceiveSlots(size_t slotSize)
+{
+	m_receiveSlotSize = slotSize;
+	m_receiveBuffer.resize(m_batchSize * slotSize);
+	//A coalesced slot can hold many packets
+	size_t packetsPerSlot = std::max<size_t>(1, slotSize / (m_maxPacketSize + 1));
+	if(m_receiveCoalescing)
+	{
+		packetsPerSlot = std::max(packetsPerSlot, g_maxSegmentCount);
+	}
+	m_receivedPackets.resize(m_batchSize * packetsPerSlot);
+	m_receivedPacketCount = 0;
+}
+
+void CDatagramSocket::AddReceivedPacket(const uint8* data, size_t size, const sockaddr_in& address)
+{
+	assert(m_receivedPacketCount < m_receivedPackets.size());
+	auto& packet = m_receivedPackets[m_receivedPacketCount++];
+	packet.data = data;
+	packet.size = size;
+	packet.address = address;
+}
@@ -0,0 +1,224 @@
+#include "DeflateBackend.h"
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+#include <zstd_zlibwrapper.h>
+#include "memory/AllocationTracker.h"
+
+using namespace Framework;
+using namespace Framework::Deflate;
+
+namespace
+{
+	enum
+	{
+		//Largest amount zlib can process in one call
+		MAX_CHUNK_SIZE = 0x40000000,
+	};
+
+	//zlib's internal state (window and tables) is counted as zip memory
+	voidpf TrackedZAlloc(voidpf, uInt items, uInt size)
+	{
+		return Memory::CAllocationTracker::GetInstance().Allocate(Memory::CAllocationTracker::SUBSYSTEM_ZIP,
+		                                                          FRAMEWORK_ALLOCATION_SITE, static_cast<size_t>(items) * size);
+	}
+
+	void TrackedZFree(voidpf, voidpf address)
+	{
+		Memory::CAllocationTracker::GetInstance().Free(address);
+	}
+
+	class CZlibCompressor : public CCompressor
+	{
+	public:
+		CZlibCompressor(int level)
+		{
+			m_zStream.zalloc = &TrackedZAlloc;
+			m_zStream.zfree = &TrackedZFree;
+			m_zStream.opaque = Z_NULL;
+			if(deflateInit2(&m_zStream, level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+			{
+				throw std::runtime_error("Error initializing deflate stream.");
+			}
+		}
+
+		~CZlibCompressor()
+		{
+			deflateEnd(&m_zStream);
+		}
+
+		bool Compress(const uint8*& input, size_t& inputSize, uint8*& output, size_t& outputSize, bool finish) override
+		{
+			uInt inputChunkSize = static_cast<uInt>(std::min<size_t>(MAX_CHUNK_SIZE, inputSize));
+			uInt outputChunkSize = static_cast<uInt>(std::min<size_t>(MAX_CHUNK_SIZE, outputSize));
+			bool isLastInput = (inputChunkSize == inputSize);
+			m_zStream.next_in = const_cast<Bytef*>(input);
+			m_zStream.avail_in = inputChunkSize;
+			m_zStream.next_out = output;
+			m_zStream.avail_out = outputChunkSize;
+			int ret = deflate(&m_zStream, (finish && isLastInput) ? Z_FINISH : Z_NO_FLUSH);
+			if((ret != Z_OK) && (ret != Z_STREAM_END) && (ret != Z_BUF_ERROR))
+			{
+				throw std::runtime_error("Error occured while deflating.");
+			}
+			size_t consumed = inputChunkSize - m_zStream.avail_in;
+			size_t produced = outputChunkSize - m_zStream.avail_out;
+			input += consumed;
+			inputSize -= consumed;
+			output += produced;
+			outputSize -= produced;
+			return (ret == Z_STREAM_END);
+		}
+
+	private:
+		z_stream m_zStream;
+	};
+
+	class CZlibDecompressor : public CDecompressor
+	{
+	public:
+		CZlibDecompressor()
+		{
+			m_zStream.zalloc = &TrackedZAlloc;
+			m_zStream.zfree = &TrackedZFree;
+			m_zStream.opaque = Z_NULL;
+			m_zStream.avail_in = 0;
+			m_zStream.next_in = Z_NULL;
+			if(inflateInit2(&m_zStream, -MAX_WBITS) != Z_OK)
+			{
+				throw std::runtime_error("zlib stream initialization error.");
+			}
+		}
+
+		~CZlibDecompressor()
+		{
+			inflateEnd(&m_zStream);
+		}
+
+		bool Decompress(const uint8*& input, size_t& inputSize, uint8*& output, size_t& outputSize) override
+		{
+			//The end of the stream can still be reached without output space
+			Bytef dummy = 0;
+			uInt inputChunkSize = static_cast<uInt>(std::min<size_t>(MAX_CHUNK_SIZE, inputSize));
+			uInt outputChunkSize = static_cast<uInt>(std::min<size_t>(MAX_CHUNK_SIZE, outputSize));
+			m_zStream.next_in = const_cast<Bytef*>(input);
+			m_zStream.avail_in = inputChunkSize;
+			m_zStream.next_out = (outputChunkSize != 0) ? output : &dummy;
+			m_zStream.avail_out = outputChunkSize;
+			int ret = inflate(&m_zStream, Z_NO_FLUSH);
+			if((ret != Z_OK) && (ret != Z_STREAM_END) && (ret != Z_BUF_ERROR))
+			{
+				throw std::runtime_error("Error occured while inflating.");
+			}
+			size_t consumed = inputChunkSize - m_zStream.avail_in;
+			size_t produced = outputChunkSize - m_zStream.avail_out;
+			input += consumed;
+			inputSize -= consumed;
+			output += produced;
+			outputSize -= produced;
+			return (ret == Z_STREAM_END);
+		}
+
+	private:
+		z_stream m_zStream;
+	};
+
+	class CZlibBackend : public CBackend
+	{
+	public:
+		const char* GetName() const override
+		{
+			return "zlib";
+		}
+
+		std::unique_ptr<CCompressor> CreateCompressor(int level) override
+		{
+			return std::make_unique<CZlibCompressor>(level);
+		}
+
+		std::unique_ptr<CDecompressor> CreateDecompressor() override
+		{
+			return std::make_unique<CZlibDecompressor>();
+		}
+	};
+}
+
+//Index of the first backend to use in the full list
+static std::atomic<size_t> g_preferredBackendIndex(0);
+
+static const std::vector<CBackend*>& GetAllBackends()
+{
+	//Hardware and library availability is only checked once
+	static const std::vector<CBackend*> backends =
+	    []() {
+		    std::vector<CBackend*> result;
+		    if(auto backend = GetQatBackend()) result.push_back(backend);
+		    if(auto backend = GetIsalBackend()) result.push_back(backend);
+		    result.push_back(&GetZlibBackend());
+		    return result;
+	    }();
+	return backends;
+}
+
+CBackend& Deflate::GetZlibBackend()
+{
+	static CZlibBackend backend;
+	return backend;
+}
+
+std::vector<CBackend*> Deflate::GetBackends()
+{
+	const auto& backends = GetAllBackends();
+	size_t firstIndex = std::min(g_preferredBackendIndex.load(), backends.size() - 1);
+	return std::vector<CBackend*>(std::begin(backends) + firstIndex, std::end(backends));
+}
+
+void Deflate::SetPreferredBackend(const char* name)
+{
+	const auto& backends = GetAllBackends();
+	if(!name)
+	{
+		g_preferredBackendIndex = 0;
+		return;
+	}
+	auto backendIterator = std::find_if(std::begin(backends), std::end(backends),
+	                                    [&](const CBackend* backend) { return !strcmp(backend->GetName(), name); });
+	if(backendIterator == std::end(backends))
+	{
+		throw std::runtime_error("Deflate backend isn't available.");
+	}
+	g_preferredBackendIndex = backendIterator - std::begin(backends);
+}
+
+std::unique_ptr<CCompressor> Deflate::CreateCompressor(int level)
+{
+	if((level < DEFAULT_LEVEL) || (level > 9))
+	{
+		throw std::runtime_error("Invalid compression level.");
+	}
+	for(auto backend : GetBackends())
+	{
+		if(auto compressor = backend->CreateCompressor(level))
+		{
+			return compressor;
+		}
+	}
+	//zlib handles every level
+	assert(false);
+	return std::unique_ptr<CCompressor>();
+}
+
+std::unique_ptr<CDecompressor> Deflate::CreateDecompressor()
+{
+	for(auto backend : GetBackends())
+	{
+		if(auto decompressor = backend->CreateDecompressor())
+		{
+			return decompressor;
+		}
+	}
+	assert(false);
+	return std::unique_ptr<CDecompressor>();
+}
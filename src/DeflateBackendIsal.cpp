@@ -0,0 +1,142 @@
+#include "DeflateBackend.h"
+
+#if defined(FRAMEWORK_HAS_ISAL)
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+#include <isa-l/igzip_lib.h>
+
+using namespace Framework;
+using namespace Framework::Deflate;
+
+namespace
+{
+	//ISA-L takes 32 bits sizes
+	const size_t g_maxChunkSize = std::numeric_limits<uint32_t>::max();
+
+	class CIsalCompressor : public CCompressor
+	{
+	public:
+		CIsalCompressor(uint32 level, uint32 levelBufferSize)
+		    : m_levelBuffer(levelBufferSize)
+		{
+			isal_deflate_init(&m_stream);
+			m_stream.level = level;
+			m_stream.level_buf = m_levelBuffer.data();
+			m_stream.level_buf_size = static_cast<uint32_t>(m_levelBuffer.size());
+			m_stream.gzip_flag = IGZIP_DEFLATE;
+			m_stream.flush = NO_FLUSH;
+		}
+
+		bool Compress(const uint8*& input, size_t& inputSize, uint8*& output, size_t& outputSize, bool finish) override
+		{
+			uint32_t inputChunkSize = static_cast<uint32_t>(std::min(g_maxChunkSize, inputSize));
+			uint32_t outputChunkSize = static_cast<uint32_t>(std::min(g_maxChunkSize, outputSize));
+			m_stream.next_in = const_cast<uint8_t*>(input);
+			m_stream.avail_in = inputChunkSize;
+			m_stream.next_out = output;
+			m_stream.avail_out = outputChunkSize;
+			m_stream.end_of_stream = (finish && (inputChunkSize == inputSize)) ? 1 : 0;
+			if(isal_deflate(&m_stream) != COMP_OK)
+			{
+				throw std::runtime_error("Error occured while deflating.");
+			}
+			size_t consumed = inputChunkSize - m_stream.avail_in;
+			size_t produced = outputChunkSize - m_stream.avail_out;
+			input += consumed;
+			inputSize -= consumed;
+			output += produced;
+			outputSize -= produced;
+			return (m_stream.internal_state.state == ZSTATE_END);
+		}
+
+	private:
+		std::vector<uint8_t> m_levelBuffer;
+		isal_zstream m_stream;
+	};
+
+	class CIsalDecompressor : public CDecompressor
+	{
+	public:
+		CIsalDecompressor()
+		{
+			isal_inflate_init(&m_state);
+			m_state.crc_flag = ISAL_DEFLATE;
+		}
+
+		bool Decompress(const uint8*& input, size_t& inputSize, uint8*& output, size_t& outputSize) override
+		{
+			uint32_t inputChunkSize = static_cast<uint32_t>(std::min(g_maxChunkSize, inputSize));
+			uint32_t outputChunkSize = static_cast<uint32_t>(std::min(g_maxChunkSize, outputSize));
+			m_state.next_in = const_cast<uint8_t*>(input);
+			m_state.avail_in = inputChunkSize;
+			m_state.next_out = output;
+			m_state.avail_out = outputChunkSize;
+			//Negative results are errors, others tell what is missing
+			if(isal_inflate(&m_state) < 0)
+			{
+				throw std::runtime_error("Error occured while inflating.");
+			}
+			size_t consumed = inputChunkSize - m_state.avail_in;
+			size_t produced = outputChunkSize - m_state.avail_out;
+			input += consumed;
+			inputSize -= consumed;
+			output += produced;
+			outputSize -= produced;
+			return (m_state.block_state == ISAL_BLOCK_FINISH);
+		}
+
+	private:
+		inflate_state m_state;
+	};
+
+	class CIsalBackend : public CBackend
+	{
+	public:
+		const char* GetName() const override
+		{
+			return "isal";
+		}
+
+		std::unique_ptr<CCompressor> CreateCompressor(int level) override
+		{
+			//Stored blocks are left to zlib, zlib levels are grouped on ISA-L's 3 levels
+			if(level == 0)
+			{
+				return std::unique_ptr<CCompressor>();
+			}
+			if((level != DEFAULT_LEVEL) && (level <= 3))
+			{
+				return std::make_unique<CIsalCompressor>(1, ISAL_DEF_LVL1_DEFAULT);
+			}
+			if((level == DEFAULT_LEVEL) || (level <= 6))
+			{
+				return std::make_unique<CIsalCompressor>(2, ISAL_DEF_LVL2_DEFAULT);
+			}
+			return std::make_unique<CIsalCompressor>(3, ISAL_DEF_LVL3_DEFAULT);
+		}
+
+		std::unique_ptr<CDecompressor> CreateDecompressor() override
+		{
+			return std::make_unique<CIsalDecompressor>();
+		}
+	};
+}
+
+CBackend* Deflate::GetIsalBackend()
+{
+	//ISA-L picks its SIMD implementation when first used, it always works
+	static CIsalBackend backend;
+	return &backend;
+}
+
+#else
+
+Framework::Deflate::CBackend* Framework::Deflate::GetIsalBackend()
+{
+	return nullptr;
+}
+
+#endif
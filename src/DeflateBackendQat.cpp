@@ -0,0 +1,204 @@
+#include "DeflateBackend.h"
+
+#if defined(FRAMEWORK_HAS_QATZIP)
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+#include <qatzip.h>
+
+using namespace Framework;
+using namespace Framework::Deflate;
+
+namespace
+{
+	enum
+	{
+		//Input is gathered in chunks this big before being sent to the device, smaller requests
+		//cost more in round trips than they gain from the offload
+		CHUNK_SIZE = 0x40000,
+	};
+
+	class CQatSession
+	{
+	public:
+		CQatSession(int level)
+		{
+			//No software fallback, the other backends take care of it
+			int result = qzInit(&m_session, 0);
+			if((result != QZ_OK) && (result != QZ_DUPLICATE))
+			{
+				throw std::runtime_error("Failed to initialize QAT session.");
+			}
+			QzSessionParams_T params;
+			qzGetDefaults(&params);
+			params.direction = QZ_DIR_COMPRESS;
+			params.data_fmt = QZ_DEFLATE_RAW;
+			params.comp_lvl = (level == DEFAULT_LEVEL) ? 6 : level;
+			params.sw_backup = 0;
+			if(qzSetupSession(&m_session, &params) != QZ_OK)
+			{
+				qzClose(&m_session);
+				throw std::runtime_error("Failed to setup QAT session.");
+			}
+		}
+
+		CQatSession(const CQatSession&) = delete;
+
+		~CQatSession()
+		{
+			qzTeardownSession(&m_session);
+			qzClose(&m_session);
+		}
+
+		CQatSession& operator=(const CQatSession&) = delete;
+
+		QzSession_T* Get()
+		{
+			return &m_session;
+		}
+
+	private:
+		QzSession_T m_session = {};
+	};
+
+	//Input is compressed a chunk at a time, each chunk is a series of non final deflate blocks
+	//except for the last one, the output is a single deflate stream
+	class CQatCompressor : public CCompressor
+	{
+	public:
+		CQatCompressor(int level)
+		    : m_session(level)
+		{
+			m_input.reserve(CHUNK_SIZE);
+			m_output.resize(qzMaxCompressedLength(CHUNK_SIZE, m_session.Get()));
+		}
+
+		bool Compress(const uint8*& input, size_t& inputSize, uint8*& output, size_t& outputSize, bool finish) override
+		{
+			while(true)
+			{
+				//Pending output goes first
+				size_t pendingSize = m_outputSize - m_outputPosition;
+				if(pendingSize != 0)
+				{
+					size_t copySize = std::min(pendingSize, outputSize);
+					memcpy(output, m_output.data() + m_outputPosition, copySize);
+					m_outputPosition += copySize;
+					output += copySize;
+					outputSize -= copySize;
+					if(copySize != pendingSize)
+					{
+						return false;
+					}
+				}
+				if(m_isFinished)
+				{
+					return true;
+				}
+
+				size_t copySize = std::min<size_t>(CHUNK_SIZE - m_input.size(), inputSize);
+				m_input.insert(std::end(m_input), input, input + copySize);
+				input += copySize;
+				inputSize -= copySize;
+
+				bool isLast = finish && (inputSize == 0);
+				if((m_input.size() != CHUNK_SIZE) && !isLast)
+				{
+					return false;
+				}
+				CompressChunk(isLast);
+			}
+		}
+
+	private:
+		void CompressChunk(bool isLast)
+		{
+			if(m_input.empty())
+			{
+				//Ends the stream with an empty final block with fixed codes
+				assert(isLast);
+				m_output[0] = 0x03;
+				m_output[1] = 0x00;
+				m_outputSize = 2;
+				m_outputPosition = 0;
+				m_isFinished = true;
+				return;
+			}
+			unsigned int inputSize = static_cast<unsigned int>(m_input.size());
+			unsigned int outputSize = static_cast<unsigned int>(m_output.size());
+			int result = qzCompress(m_session.Get(), m_input.data(), &inputSize, m_output.data(), &outputSize, isLast ? 1 : 0);
+			if((result != QZ_OK) || (inputSize != m_input.size()))
+			{
+				throw std::runtime_error("Error occured while deflating.");
+			}
+			m_input.clear();
+			m_outputSize = outputSize;
+			m_outputPosition = 0;
+			m_isFinished = isLast;
+		}
+
+		CQatSession m_session;
+		std::vector<uint8> m_input;
+		std::vector<uint8> m_output;
+		size_t m_outputSize = 0;
+		size_t m_outputPosition = 0;
+		bool m_isFinished = false;
+	};
+
+	class CQatBackend : public CBackend
+	{
+	public:
+		const char* GetName() const override
+		{
+			return "qat";
+		}
+
+		std::unique_ptr<CCompressor> CreateCompressor(int level) override
+		{
+			//Stored blocks are left to zlib
+			if(level == 0)
+			{
+				return std::unique_ptr<CCompressor>();
+			}
+			return std::make_unique<CQatCompressor>(level);
+		}
+
+		std::unique_ptr<CDecompressor> CreateDecompressor() override
+		{
+			//Inflating is fast enough on the CPU, not worth the round trips
+			return std::unique_ptr<CDecompressor>();
+		}
+	};
+
+	bool IsQatPresent()
+	{
+		try
+		{
+			CQatSession session(DEFAULT_LEVEL);
+			return true;
+		}
+		catch(...)
+		{
+			return false;
+		}
+	}
+}
+
+CBackend* Deflate::GetQatBackend()
+{
+	static CQatBackend backend;
+	static const bool isPresent = IsQatPresent();
+	return isPresent ? &backend : nullptr;
+}
+
+#else
+
+Framework::Deflate::CBackend* Framework::Deflate::GetQatBackend()
+{
+	return nullptr;
+}
+
+#endif
@@ -0,0 +1,383 @@
+#include "DirectoryWalker.h"
+#include <condition_variable>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include "TaskGroup.h"
+#include "ThreadPool.h"
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+using namespace Framework;
+
+typedef CDirectoryWalker::PathChar PathChar;
+typedef CDirectoryWalker::ENTRY ENTRY;
+
+namespace
+{
+	enum
+	{
+		//Paths of a few thousand entries per chunk
+		PATH_ARENA_CHUNK_SIZE = 0x100000,
+		//Lets getdents64 return a few hundred entries per call
+		DIRENT_BUFFER_SIZE = 0x8000,
+	};
+
+	struct PENDING_DIRECTORY
+	{
+		const PathChar*		path = nullptr;
+		size_t				length = 0;
+	};
+
+	struct WALK_STATE
+	{
+		uint32				flags = 0;
+		//Where relative paths start in full paths
+		size_t				relativeOffset = 0;
+
+		std::mutex			mutex;
+		std::condition_variable	condition;
+		std::vector<PENDING_DIRECTORY>	pendingDirectories;
+		//Directories being listed, more can be found while this isn't 0
+		unsigned int		activeCount = 0;
+	};
+
+	struct WORKER
+	{
+		std::unique_ptr<Memory::CArena>	arena = std::make_unique<Memory::CArena>(PATH_ARENA_CHUNK_SIZE);
+		std::vector<ENTRY>	entries;
+		std::vector<PENDING_DIRECTORY>	foundDirectories;
+		size_t				errorCount = 0;
+#ifdef __linux__
+		std::vector<uint8>	direntBuffer;
+#endif
+	};
+
+#ifdef __linux__
+	//Not declared by every libc, layout is fixed by the kernel
+	struct LINUX_DIRENT64
+	{
+		uint64			d_ino;
+		int64			d_off;
+		unsigned short	d_reclen;
+		unsigned char	d_type;
+		char			d_name[1];
+	};
+#endif
+
+	bool IsSeparator(PathChar character)
+	{
+		return (character == '/') || (character == fs::path::preferred_separator);
+	}
+
+	template <typename CharType>
+	bool IsDotEntry(const CharType* name)
+	{
+		return (name[0] == '.') && ((name[1] == 0) || ((name[1] == '.') && (name[2] == 0)));
+	}
+
+	void AddEntry(WORKER& worker, const WALK_STATE& state, const PENDING_DIRECTORY& directory, const PathChar* name, size_t nameLength, ENTRY entry)
+	{
+		bool needsSeparator = !IsSeparator(directory.path[directory.length - 1]);
+		size_t pathLength = directory.length + (needsSeparator ? 1 : 0) + nameLength;
+		auto path = reinterpret_cast<PathChar*>(worker.arena->Allocate((pathLength + 1) * sizeof(PathChar), alignof(PathChar)));
+		memcpy(path, directory.path, directory.length * sizeof(PathChar));
+		if(needsSeparator)
+		{
+			path[directory.length] = fs::path::preferred_separator;
+		}
+		memcpy(path + pathLength - nameLength, name, nameLength * sizeof(PathChar));
+		path[pathLength] = 0;
+
+		entry.path = path + state.relativeOffset;
+		entry.pathLength = static_cast<uint32>(pathLength - state.relativeOffset);
+		worker.entries.push_back(entry);
+		if(entry.type == CDirectoryWalker::ENTRY_TYPE_DIRECTORY)
+		{
+			PENDING_DIRECTORY foundDirectory;
+			foundDirectory.path = path;
+			foundDirectory.length = pathLength;
+			worker.foundDirectories.push_back(foundDirectory);
+		}
+	}
+
+#if defined(_WIN32)
+	void ListDirectory(WORKER& worker, const WALK_STATE& state, const PENDING_DIRECTORY& directory)
+	{
+		std::wstring pattern(directory.path, directory.length);
+		if(!IsSeparator(pattern.back()))
+		{
+			pattern += L'\\';
+		}
+		pattern += L'*';
+
+		//Basic info skips the short names, large fetch asks for bigger batches from the file system
+		WIN32_FIND_DATAW findData = {};
+		HANDLE findHandle = FindFirstFileExW(pattern.c_str(), FindExInfoBasic, &findData, FindExSearchNameMatch, nullptr, FIND_FIRST_EX_LARGE_FETCH);
+		if(findHandle == INVALID_HANDLE_VALUE)
+		{
+			if(GetLastError() != ERROR_FILE_NOT_FOUND)
+			{
+				worker.errorCount++;
+			}
+			return;
+		}
+		do
+		{
+			if(IsDotEntry(findData.cFileName)) continue;
+			ENTRY entry;
+			if(findData.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT)
+			{
+				entry.type = CDirectoryWalker::ENTRY_TYPE_SYMLINK;
+			}
+			else if(findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+			{
+				entry.type = CDirectoryWalker::ENTRY_TYPE_DIRECTORY;
+			}
+			else
+			{
+				entry.type = CDirectoryWalker::ENTRY_TYPE_FILE;
+			}
+			entry.hasMetadata = true;
+			entry.size = (static_cast<uint64>(findData.nFileSizeHigh) << 32) | findData.nFileSizeLow;
+			//File times are in 100ns units since 1601
+			uint64 writeTime = (static_cast<uint64>(findData.ftLastWriteTime.dwHighDateTime) << 32) | findData.ftLastWriteTime.dwLowDateTime;
+			entry.modificationTime = (static_cast<int64>(writeTime) - 116444736000000000LL) / 10000000LL;
+			AddEntry(worker, state, directory, findData.cFileName, wcslen(findData.cFileName), entry);
+		} while(FindNextFileW(findHandle, &findData));
+		if(GetLastError() != ERROR_NO_MORE_FILES)
+		{
+			worker.errorCount++;
+		}
+		FindClose(findHandle);
+	}
+#else
+	CDirectoryWalker::ENTRY_TYPE GetEntryType(unsigned char direntType)
+	{
+		switch(direntType)
+		{
+		case DT_REG:
+			return CDirectoryWalker::ENTRY_TYPE_FILE;
+		case DT_DIR:
+			return CDirectoryWalker::ENTRY_TYPE_DIRECTORY;
+		case DT_LNK:
+			return CDirectoryWalker::ENTRY_TYPE_SYMLINK;
+		default:
+			return CDirectoryWalker::ENTRY_TYPE_OTHER;
+		}
+	}
+
+	CDirectoryWalker::ENTRY_TYPE GetEntryType(const struct stat& status)
+	{
+		if(S_ISREG(status.st_mode)) return CDirectoryWalker::ENTRY_TYPE_FILE;
+		if(S_ISDIR(status.st_mode)) return CDirectoryWalker::ENTRY_TYPE_DIRECTORY;
+		if(S_ISLNK(status.st_mode)) return CDirectoryWalker::ENTRY_TYPE_SYMLINK;
+		return CDirectoryWalker::ENTRY_TYPE_OTHER;
+	}
+
+	//Looks up the entry relative to the directory being listed, which spares resolving the whole path again
+	void ProcessEntry(WORKER& worker, const WALK_STATE& state, const PENDING_DIRECTORY& directory, int directoryFd, const char* name, unsigned char direntType)
+	{
+		if(IsDotEntry(name)) return;
+		ENTRY entry;
+		entry.type = GetEntryType(direntType);
+		//Some file systems don't report types in listings
+		if((state.flags & CDirectoryWalker::WALK_FLAG_METADATA) || (direntType == DT_UNKNOWN))
+		{
+			struct stat status = {};
+			if(fstatat(directoryFd, name, &status, AT_SYMLINK_NOFOLLOW) == 0)
+			{
+				entry.type = GetEntryType(status);
+				entry.hasMetadata = true;
+				entry.size = static_cast<uint64>(status.st_size);
+				entry.modificationTime = static_cast<int64>(status.st_mtime);
+			}
+		}
+		AddEntry(worker, state, directory, name, strlen(name), entry);
+	}
+
+#if defined(__linux__)
+	void ListDirectory(WORKER& worker, const WALK_STATE& state, const PENDING_DIRECTORY& directory)
+	{
+		int directoryFd = open(directory.path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+		if(directoryFd == -1)
+		{
+			worker.errorCount++;
+			return;
+		}
+		worker.direntBuffer.resize(DIRENT_BUFFER_SIZE);
+		while(true)
+		{
+			auto readSize = syscall(SYS_getdents64, directoryFd, worker.direntBuffer.data(), worker.direntBuffer.size());
+			if(readSize <= 0)
+			{
+				if(readSize < 0)
+				{
+					worker.errorCount++;
+				}
+				break;
+			}
+			for(long offset = 0; offset < readSize;)
+			{
+				auto dirent = reinterpret_cast<const LINUX_DIRENT64*>(worker.direntBuffer.data() + offset);
+				offset += dirent->d_reclen;
+				ProcessEntry(worker, state, directory, directoryFd, dirent->d_name, dirent->d_type);
+			}
+		}
+		close(directoryFd);
+	}
+#else
+	void ListDirectory(WORKER& worker, const WALK_STATE& state, const PENDING_DIRECTORY& directory)
+	{
+		DIR* directoryHandle = opendir(directory.path);
+		if(!directoryHandle)
+		{
+			worker.errorCount++;
+			return;
+		}
+		int directoryFd = dirfd(directoryHandle);
+		while(auto dirent = readdir(directoryHandle))
+		{
+			ProcessEntry(worker, state, directory, directoryFd, dirent->d_name, dirent->d_type);
+		}
+		closedir(directoryHandle);
+	}
+#endif
+#endif
+
+	void RunWorker(WALK_STATE& state, WORKER& worker)
+	{
+		std::unique_lock<std::mutex> lock(state.mutex);
+		while(true)
+		{
+			state.condition.wait(lock, [&]() { return !state.pendingDirectories.empty() || (state.activeCount == 0); });
+			if(state.pendingDirectories.empty())
+			{
+				//Nothing left to list and nothing being listed
+				break;
+			}
+			auto directory = state.pendingDirectories.back();
+			state.pendingDirectories.pop_back();
+			state.activeCount++;
+			lock.unlock();
+
+			ListDirectory(worker, state, directory);
+
+			lock.lock();
+			state.activeCount--;
+			state.pendingDirectories.insert(state.pendingDirectories.end(), worker.foundDirectories.begin(), worker.foundDirectories.end());
+			if(!worker.foundDirectories.empty() || (state.activeCount == 0))
+			{
+				state.condition.notify_all();
+			}
+			worker.foundDirectories.clear();
+		}
+	}
+}
+
+CDirectoryWalker::CListing CDirectoryWalker::Walk(const fs::path& root, uint32 flags, CThreadPool* threadPool)
+{
+	if(!fs::is_directory(root))
+	{
+		throw std::runtime_error("Directory walk root is not a directory.");
+	}
+
+	const auto& rootPath = root.native();
+	WALK_STATE state;
+	state.flags = flags;
+	state.relativeOffset = rootPath.size() + (IsSeparator(rootPath.back()) ? 0 : 1);
+	{
+		PENDING_DIRECTORY rootDirectory;
+		rootDirectory.path = rootPath.c_str();
+		rootDirectory.length = rootPath.size();
+		state.pendingDirectories.push_back(rootDirectory);
+	}
+
+	//Calling thread lists directories as well
+	unsigned int workerCount = threadPool ? (threadPool->GetThreadCount() + 1) : 1;
+	std::vector<WORKER> workers(workerCount);
+	{
+		CTaskGroup taskGroup(threadPool);
+		for(unsigned int i = 1; i < workerCount; i++)
+		{
+			taskGroup.Run([&state, &worker = workers[i]]() { RunWorker(state, worker); });
+		}
+		RunWorker(state, workers[0]);
+		taskGroup.Wait();
+	}
+
+	CListing listing;
+	for(const auto& worker : workers)
+	{
+		listing.m_entryCount += worker.entries.size();
+		listing.m_errorCount += worker.errorCount;
+	}
+	if(listing.m_entryCount != 0)
+	{
+		auto entries = reinterpret_cast<ENTRY*>(workers[0].arena->Allocate(listing.m_entryCount * sizeof(ENTRY), alignof(ENTRY)));
+		listing.m_entries = entries;
+		for(const auto& worker : workers)
+		{
+			entries = std::uninitialized_copy(worker.entries.begin(), worker.entries.end(), entries);
+		}
+	}
+	for(auto& worker : workers)
+	{
+		listing.m_arenas.push_back(std::move(worker.arena));
+	}
+	return listing;
+}
+
+CDirectoryWalker::CListing::CListing(CListing&& rhs)
+{
+	*this = std::move(rhs);
+}
+
+CDirectoryWalker::CListing& CDirectoryWalker::CListing::operator =(CListing&& rhs)
+{
+	m_arenas = std::move(rhs.m_arenas);
+	m_entries = rhs.m_entries;
+	m_entryCount = rhs.m_entryCount;
+	m_errorCount = rhs.m_errorCount;
+	rhs.m_arenas.clear();
+	rhs.m_entries = nullptr;
+	rhs.m_entryCount = 0;
+	rhs.m_errorCount = 0;
+	return *this;
+}
+
+const ENTRY* CDirectoryWalker::CListing::begin() const
+{
+	return m_entries;
+}
+
+const ENTRY* CDirectoryWalker::CListing::end() const
+{
+	return m_entries + m_entryCount;
+}
+
+const ENTRY& CDirectoryWalker::CListing::operator [](size_t index) const
+{
+	return m_entries[index];
+}
+
+size_t CDirectoryWalker::CListing::GetEntryCount() const
+{
+	return m_entryCount;
+}
+
+size_t CDirectoryWalker::CListing::GetErrorCount() const
+{
+	return m_errorCount;
+}
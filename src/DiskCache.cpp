@@ -0,0 +1,366 @@
+#include "DiskCache.h"
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <tuple>
+#include "PathUtils.h"
+#include "StdStreamUtils.h"
+
+using namespace Framework;
+
+static const char* g_indexFileName = "index";
+static const char* g_tempFileExtension = ".tmp";
+static const size_t g_keyStringLength = 32;
+
+static std::string KeyToString(const CDiskCache::Key& key)
+{
+	char result[g_keyStringLength + 1];
+	snprintf(result, sizeof(result), "%016llx%016llx", static_cast<unsigned long long>(key.high), static_cast<unsigned long long>(key.low));
+	return result;
+}
+
+static bool StringToKey(const std::string& keyString, CDiskCache::Key& key)
+{
+	if(keyString.size() != g_keyStringLength) return false;
+	uint64 values[2] = {};
+	for(size_t i = 0; i < g_keyStringLength; i++)
+	{
+		char character = keyString[i];
+		uint64 digit = 0;
+		if((character >= '0') && (character <= '9')) digit = character - '0';
+		else if((character >= 'a') && (character <= 'f')) digit = character - 'a' + 10;
+		else return false;
+		auto& value = values[i / 16];
+		value = (value << 4) | digit;
+	}
+	key.high = values[0];
+	key.low = values[1];
+	return true;
+}
+
+CDiskCache::CDiskCache(fs::path directory, uint64 maxSize)
+: m_directory(std::move(directory))
+, m_maxSize(maxSize)
+{
+	fs::create_directories(m_directory);
+	if(!LoadIndex())
+	{
+		RebuildIndex();
+	}
+	//Limit might be lower than the one used last time
+	EvictEntries(0);
+}
+
+CDiskCache::~CDiskCache()
+{
+	Flush();
+}
+
+fs::path CDiskCache::GetDefaultDirectory(const char* name)
+{
+	return PathUtils::GetCachePath() / name;
+}
+
+CDiskCache::Key CDiskCache::MakeKey(const void* data, size_t size)
+{
+	return HashUtils::ComputeXxh3_128(data, size);
+}
+
+CDiskCache::Key CDiskCache::MakeKey(const std::string& value)
+{
+	return MakeKey(value.data(), value.size());
+}
+
+CDiskCache::EntryStreamPtr CDiskCache::Find(const Key& key)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto entryIterator = m_entries.find(key);
+		if(entryIterator == std::end(m_entries))
+		{
+			return EntryStreamPtr();
+		}
+		auto& entry = entryIterator->second;
+		m_lruList.splice(std::end(m_lruList), m_lruList, entry.lruIterator);
+		//Order isn't worth removing the index file for, a rescan can't restore it anyway
+		m_indexDirty = true;
+	}
+
+	try
+	{
+		return std::make_unique<CMappedFileStream>(GetEntryPath(key));
+	}
+	catch(...)
+	{
+		//File was removed behind our back
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto entryIterator = m_entries.find(key);
+		if(entryIterator != std::end(m_entries))
+		{
+			RemoveEntry(entryIterator);
+		}
+		return EntryStreamPtr();
+	}
+}
+
+bool CDiskCache::Insert(const Key& key, const void* data, size_t size)
+{
+	if(size > m_maxSize)
+	{
+		return false;
+	}
+
+	auto entryPath = GetEntryPath(key);
+	auto tempPath = entryPath;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		tempPath += g_tempFileExtension + std::to_string(m_tempFileCounter++);
+	}
+
+	try
+	{
+		fs::create_directories(entryPath.parent_path());
+		auto stream = CreateOutputStdStream(tempPath.native());
+		stream.Write(data, size);
+	}
+	catch(...)
+	{
+		std::error_code errorCode;
+		fs::remove(tempPath, errorCode);
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto entryIterator = m_entries.find(key);
+	if(entryIterator != std::end(m_entries))
+	{
+		RemoveEntry(entryIterator);
+	}
+	EvictEntries(size);
+	std::error_code errorCode;
+	fs::rename(tempPath, entryPath, errorCode);
+	if(errorCode)
+	{
+		fs::remove(tempPath, errorCode);
+		return false;
+	}
+	AddEntry(key, size);
+	return true;
+}
+
+CDiskCache::EntryStreamPtr CDiskCache::FindOrInsert(const Key& key, const ProduceFunction& produceFunction)
+{
+	if(auto stream = Find(key))
+	{
+		return stream;
+	}
+	auto data = produceFunction();
+	if(!Insert(key, data.data(), data.size()))
+	{
+		return EntryStreamPtr();
+	}
+	return Find(key);
+}
+
+void CDiskCache::Remove(const Key& key)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto entryIterator = m_entries.find(key);
+	if(entryIterator != std::end(m_entries))
+	{
+		RemoveEntry(entryIterator);
+	}
+}
+
+void CDiskCache::Clear()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	while(!m_entries.empty())
+	{
+		RemoveEntry(std::begin(m_entries));
+	}
+}
+
+void CDiskCache::Flush()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if(m_indexDirty)
+	{
+		WriteIndex();
+	}
+}
+
+uint64 CDiskCache::GetTotalSize() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_totalSize;
+}
+
+size_t CDiskCache::GetEntryCount() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_entries.size();
+}
+
+fs::path CDiskCache::GetEntryPath(const Key& key) const
+{
+	//Spread entries in subdirectories to keep directories small
+	auto keyString = KeyToString(key);
+	return m_directory / keyString.substr(0, 2) / keyString;
+}
+
+fs::path CDiskCache::GetIndexPath() const
+{
+	return m_directory / g_indexFileName;
+}
+
+bool CDiskCache::LoadIndex()
+{
+	try
+	{
+		CMappedFileStream stream(GetIndexPath());
+		INDEX_HEADER header = {};
+		if(stream.Read(&header, sizeof(INDEX_HEADER)) != sizeof(INDEX_HEADER)) return false;
+		if((header.magic != INDEX_MAGIC) || (header.version != INDEX_VERSION)) return false;
+		if(stream.GetRemainingLength() != (header.entryCount * sizeof(INDEX_RECORD))) return false;
+		auto records = reinterpret_cast<const INDEX_RECORD*>(stream.GetSpan(sizeof(INDEX_HEADER), header.entryCount * sizeof(INDEX_RECORD)));
+		for(uint64 i = 0; i < header.entryCount; i++)
+		{
+			INDEX_RECORD record = {};
+			memcpy(&record, records + i, sizeof(INDEX_RECORD));
+			Key key;
+			key.low = record.keyLow;
+			key.high = record.keyHigh;
+			if(m_entries.find(key) != std::end(m_entries))
+			{
+				throw std::runtime_error("Duplicate key in disk cache index.");
+			}
+			AddEntry(key, record.size);
+		}
+	}
+	catch(...)
+	{
+		m_entries.clear();
+		m_lruList.clear();
+		m_totalSize = 0;
+		return false;
+	}
+	//Loading doesn't change anything
+	m_indexDirty = false;
+	m_indexOnDisk = true;
+	return true;
+}
+
+void CDiskCache::RebuildIndex()
+{
+	typedef std::tuple<fs::file_time_type, Key, uint64> FoundEntry;
+	std::vector<FoundEntry> foundEntries;
+	std::error_code errorCode;
+	for(fs::recursive_directory_iterator iterator(m_directory, errorCode), end; !errorCode && (iterator != end); iterator.increment(errorCode))
+	{
+		std::error_code entryErrorCode;
+		if(!iterator->is_regular_file(entryErrorCode)) continue;
+		const auto& path = iterator->path();
+		Key key;
+		if(!StringToKey(path.filename().string(), key))
+		{
+			//Leftovers of writes that didn't complete
+			if(path.filename().string().find(g_tempFileExtension) != std::string::npos)
+			{
+				fs::remove(path, entryErrorCode);
+			}
+			continue;
+		}
+		auto size = iterator->file_size(entryErrorCode);
+		if(entryErrorCode) continue;
+		auto writeTime = iterator->last_write_time(entryErrorCode);
+		if(entryErrorCode) continue;
+		foundEntries.emplace_back(writeTime, key, size);
+	}
+	//Oldest entries are evicted first
+	std::sort(foundEntries.begin(), foundEntries.end(),
+	          [](const FoundEntry& lhs, const FoundEntry& rhs) { return std::get<0>(lhs) < std::get<0>(rhs); });
+	for(const auto& foundEntry : foundEntries)
+	{
+		AddEntry(std::get<1>(foundEntry), std::get<2>(foundEntry));
+	}
+	m_indexDirty = true;
+}
+
+void CDiskCache::WriteIndex()
+{
+	//Failing to write only means the directory will be scanned next time
+	try
+	{
+		auto indexPath = GetIndexPath();
+		auto tempPath = indexPath;
+		tempPath += g_tempFileExtension;
+		{
+			auto stream = CreateOutputStdStream(tempPath.native());
+			INDEX_HEADER header = {};
+			header.magic = INDEX_MAGIC;
+			header.version = INDEX_VERSION;
+			header.entryCount = m_lruList.size();
+			stream.Write(&header, sizeof(INDEX_HEADER));
+			std::vector<INDEX_RECORD> records;
+			records.reserve(m_lruList.size());
+			for(const auto& key : m_lruList)
+			{
+				INDEX_RECORD record = {};
+				record.keyLow = key.low;
+				record.keyHigh = key.high;
+				record.size = m_entries[key].size;
+				records.push_back(record);
+			}
+			stream.Write(records.data(), records.size() * sizeof(INDEX_RECORD));
+		}
+		fs::rename(tempPath, indexPath);
+		m_indexDirty = false;
+		m_indexOnDisk = true;
+	}
+	catch(...)
+	{
+	}
+}
+
+void CDiskCache::AddEntry(const Key& key, uint64 size)
+{
+	assert(m_entries.find(key) == std::end(m_entries));
+	ENTRY entry;
+	entry.size = size;
+	entry.lruIterator = m_lruList.insert(std::end(m_lruList), key);
+	m_entries.emplace(key, entry);
+	m_totalSize += size;
+	InvalidateIndexFile();
+}
+
+void CDiskCache::RemoveEntry(EntryMap::iterator entryIterator)
+{
+	std::error_code errorCode;
+	fs::remove(GetEntryPath(entryIterator->first), errorCode);
+	m_totalSize -= entryIterator->second.size;
+	m_lruList.erase(entryIterator->second.lruIterator);
+	m_entries.erase(entryIterator);
+	InvalidateIndexFile();
+}
+
+void CDiskCache::EvictEntries(uint64 reservedSize)
+{
+	while(!m_lruList.empty() && ((m_totalSize + reservedSize) > m_maxSize))
+	{
+		RemoveEntry(m_entries.find(m_lruList.front()));
+	}
+}
+
+void CDiskCache::InvalidateIndexFile()
+{
+	m_indexDirty = true;
+	if(m_indexOnDisk)
+	{
+		std::error_code errorCode;
+		fs::remove(GetIndexPath(), errorCode);
+		m_indexOnDisk = false;
+	}
+}
@@ -0,0 +1,150 @@
+#include <string.h>
+#include "EndianUtils.h"
+#include "CpuFeatures.h"
+#include "SimdDefs.h"
+
+#if defined(FRAMEWORK_SIMD_HAS_X86_DISPATCH)
+#include <immintrin.h>
+#elif defined(FRAMEWORK_SIMD_USE_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define ENDIANUTILS_USE_NEON
+#endif
+
+using namespace Framework;
+
+//Kernels swap as many whole vectors as they can and return how many bytes they processed
+typedef size_t (*SwapFunction)(uint8*, const uint8*, size_t);
+
+template <unsigned int ElementSize>
+static void SwapScalar(uint8* output, const uint8* input, size_t size)
+{
+	for(size_t i = 0; i < size; i += ElementSize)
+	{
+		uint8 element[ElementSize];
+		memcpy(element, input + i, ElementSize);
+		for(unsigned int j = 0; j < ElementSize; j++)
+		{
+			output[i + j] = element[ElementSize - 1 - j];
+		}
+	}
+}
+
+#if defined(FRAMEWORK_SIMD_HAS_X86_DISPATCH)
+
+template <unsigned int ElementSize>
+FRAMEWORK_SIMD_TARGET_SSSE3 static __m128i GetSwapMask()
+{
+	alignas(16) uint8 mask[16];
+	for(unsigned int i = 0; i < 16; i++)
+	{
+		mask[i] = static_cast<uint8>((i & ~(ElementSize - 1)) + (ElementSize - 1 - (i & (ElementSize - 1))));
+	}
+	return _mm_load_si128(reinterpret_cast<const __m128i*>(mask));
+}
+
+template <unsigned int ElementSize>
+FRAMEWORK_SIMD_TARGET_SSSE3 static size_t SwapSsse3(uint8* output, const uint8* input, size_t size)
+{
+	__m128i mask = GetSwapMask<ElementSize>();
+	size_t processed = 0;
+	for(; (size - processed) >= 16; processed += 16)
+	{
+		__m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + processed));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(output + processed), _mm_shuffle_epi8(values, mask));
+	}
+	return processed;
+}
+
+template <unsigned int ElementSize>
+FRAMEWORK_SIMD_TARGET_AVX2 static size_t SwapAvx2(uint8* output, const uint8* input, size_t size)
+{
+	__m128i halfMask = GetSwapMask<ElementSize>();
+	__m256i mask = _mm256_broadcastsi128_si256(halfMask);
+	size_t processed = 0;
+	for(; (size - processed) >= 64; processed += 64)
+	{
+		__m256i values0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input + processed));
+		__m256i values1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input + processed + 32));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(output + processed), _mm256_shuffle_epi8(values0, mask));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(output + processed + 32), _mm256_shuffle_epi8(values1, mask));
+	}
+	for(; (size - processed) >= 16; processed += 16)
+	{
+		__m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + processed));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(output + processed), _mm_shuffle_epi8(values, halfMask));
+	}
+	return processed;
+}
+
+#elif defined(ENDIANUTILS_USE_NEON)
+
+static uint8x16_t SwapNeon(uint8x16_t values, unsigned int elementSize)
+{
+	switch(elementSize)
+	{
+	case 2:
+		return vrev16q_u8(values);
+	case 4:
+		return vrev32q_u8(values);
+	default:
+		return vrev64q_u8(values);
+	}
+}
+
+template <unsigned int ElementSize>
+static size_t SwapNeon(uint8* output, const uint8* input, size_t size)
+{
+	size_t processed = 0;
+	for(; (size - processed) >= 16; processed += 16)
+	{
+		vst1q_u8(output + processed, SwapNeon(vld1q_u8(input + processed), ElementSize));
+	}
+	return processed;
+}
+
+#endif
+
+template <unsigned int ElementSize>
+static size_t SwapNone(uint8*, const uint8*, size_t)
+{
+	return 0;
+}
+
+template <unsigned int ElementSize>
+static SwapFunction SelectSwapFunction()
+{
+	CKernelDispatcher<SwapFunction> dispatcher(&SwapNone<ElementSize>);
+#if defined(FRAMEWORK_SIMD_HAS_X86_DISPATCH)
+	dispatcher.Register(CCpuFeatures::FEATURE_SSSE3, &SwapSsse3<ElementSize>);
+	dispatcher.Register(CCpuFeatures::FEATURE_AVX2, &SwapAvx2<ElementSize>);
+#elif defined(ENDIANUTILS_USE_NEON)
+	dispatcher.Register(CCpuFeatures::FEATURE_NEON, &SwapNeon<ElementSize>);
+#endif
+	return dispatcher.Get();
+}
+
+template <unsigned int ElementSize>
+static void SwapArray(void* output, const void* input, size_t count)
+{
+	static const SwapFunction swapFunction = SelectSwapFunction<ElementSize>();
+	auto outputBytes = reinterpret_cast<uint8*>(output);
+	auto inputBytes = reinterpret_cast<const uint8*>(input);
+	size_t size = count * ElementSize;
+	size_t processed = swapFunction(outputBytes, inputBytes, size);
+	SwapScalar<ElementSize>(outputBytes + processed, inputBytes + processed, size - processed);
+}
+
+void CEndian::SwapArray16(void* output, const void* input, size_t count)
+{
+	SwapArray<2>(output, input, count);
+}
+
+void CEndian::SwapArray32(void* output, const void* input, size_t count)
+{
+	SwapArray<4>(output, input, count);
+}
+
+void CEndian::SwapArray64(void* output, const void* input, size_t count)
+{
+	SwapArray<8>(output, input, count);
+}
@@ -1,11 +1,31 @@
 #include <stdexcept>
+#include <string.h>
 #include "GZipStream.h"
+#include "HashUtils.h"
 
 using namespace Framework;
 using namespace std;
 
+//No file name nor modification time, unknown OS
+static const uint8 g_memberHeader[10] = {0x1F, 0x8B, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF};
+
 CGZipStream::CGZipStream(const char* sPath, const char* sMode)
 {
+	if(strchr(sMode, 'w'))
+	{
+		int level = Deflate::DEFAULT_LEVEL;
+		for(const char* modeChar = sMode; *modeChar; modeChar++)
+		{
+			if((*modeChar >= '0') && (*modeChar <= '9'))
+			{
+				level = *modeChar - '0';
+			}
+		}
+		m_outputStream = CStdStream(sPath, "wb");
+		m_compressor = Deflate::CreateCompressor(level);
+		m_outputStream.Write(g_memberHeader, sizeof(g_memberHeader));
+		return;
+	}
 	m_File = gzopen(sPath, sMode);
 	if(m_File == Z_NULL)
 	{
@@ -15,11 +35,34 @@ CGZipStream::CGZipStream(const char* sPath, const char* sMode)
 
 CGZipStream::~CGZipStream()
 {
+	if(m_compressor)
+	{
+		try
+		{
+			Compress(nullptr, 0, true);
+			uint8 trailer[8];
+			for(unsigned int i = 0; i < 4; i++)
+			{
+				trailer[i + 0] = static_cast<uint8>(m_crc >> (i * 8));
+				trailer[i + 4] = static_cast<uint8>(m_uncompressedLength >> (i * 8));
+			}
+			m_outputStream.Write(trailer, sizeof(trailer));
+		}
+		catch(...)
+		{
+
+		}
+		return;
+	}
 	gzclose(m_File);
 }
 
 uint64 CGZipStream::Read(void* pData, uint64 nSize)
 {
+	if(m_compressor)
+	{
+		throw runtime_error("Unsupported operation.");
+	}
 	if(gzeof(m_File))
 	{
 		throw runtime_error("Can't read after end of file.");
@@ -29,11 +72,38 @@ uint64 CGZipStream::Read(void* pData, uint64 nSize)
 
 uint64 CGZipStream::Write(const void* pData, uint64 nSize)
 {
+	if(m_compressor)
+	{
+		m_uncompressedLength += nSize;
+		m_crc = HashUtils::ComputeCrc32(pData, static_cast<size_t>(nSize), m_crc);
+		Compress(reinterpret_cast<const uint8*>(pData), static_cast<size_t>(nSize), false);
+		return nSize;
+	}
 	return gzwrite(m_File, (const voidp)pData, (unsigned int)nSize);
 }
 
+void CGZipStream::Compress(const uint8* input, size_t inputSize, bool finish)
+{
+	while(true)
+	{
+		uint8 outBuffer[BUFFERSIZE];
+		uint8* output = outBuffer;
+		size_t outputSize = BUFFERSIZE;
+		bool isEnd = m_compressor->Compress(input, inputSize, output, outputSize, finish);
+		m_outputStream.Write(outBuffer, BUFFERSIZE - outputSize);
+		if(finish ? isEnd : ((inputSize == 0) && (outputSize != 0)))
+		{
+			break;
+		}
+	}
+}
+
 void CGZipStream::Seek(int64 nAmount, STREAM_SEEK_DIRECTION nPosition)
 {
+	if(m_compressor)
+	{
+		throw runtime_error("Unsupported operation.");
+	}
 	int nWhence;
 	switch(nPosition)
 	{
@@ -47,15 +117,23 @@ void CGZipStream::Seek(int64 nAmount, STREAM_SEEK_DIRECTION nPosition)
 		nWhence = SEEK_END;
 		break;
 	}
-	gzseek(m_File, (long)nAmount, nPosition);
+	gzseek(m_File, (long)nAmount, nWhence);
 }
 
 uint64 CGZipStream::Tell()
 {
+	if(m_compressor)
+	{
+		return m_uncompressedLength;
+	}
 	return gztell(m_File);
 }
 
 bool CGZipStream::IsEOF()
 {
+	if(m_compressor)
+	{
+		return false;
+	}
 	return (gzeof(m_File) != 0);
 }
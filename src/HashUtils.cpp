@@ -1,8 +1,11 @@
 #include "HashUtils.h"
+#include <algorithm>
 #include <cassert>
 #include <vector>
 #include <cstring>
 #include <stdexcept>
+#include "CpuFeatures.h"
+#include "SimdDefs.h"
 #ifdef _WIN32
 #include <Windows.h>
 #include <Wincrypt.h>
@@ -15,70 +18,329 @@
 #include <CommonCrypto/CommonDigest.h>
 #include <CommonCrypto/CommonHMAC.h>
 #elif defined(HAS_OPENSSL)
-#include <openssl/sha.h>
+#include <openssl/evp.h>
 #include <openssl/hmac.h>
 #endif
 
-std::array<uint8, 0x20> Framework::HashUtils::ComputeSha256(const void* data, size_t dataSize)
+#if defined(FRAMEWORK_SIMD_HAS_X86_DISPATCH)
+#include <immintrin.h>
+#elif defined(FRAMEWORK_SIMD_HAS_ARM_SHA2)
+#include <arm_neon.h>
+#endif
+
+using namespace Framework;
+
+namespace
 {
-	std::array<uint8, 0x20> result;
-#if defined(_WIN32)
-	BOOL succeeded = FALSE;
+	typedef void (*Sha256BlockFunction)(uint32*, const uint8*, size_t);
 
-	HCRYPTPROV context = NULL;
-	succeeded = CryptAcquireContext(&context, NULL, NULL, PROV_RSA_AES, CRYPT_VERIFYCONTEXT);
-	assert(succeeded);
+	const uint32 g_sha256InitialState[8] =
+	{
+		0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A, 0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19
+	};
 
+	alignas(16) const uint32 g_sha256RoundConstants[64] =
 	{
-		HCRYPTHASH hash = NULL;
-		succeeded = CryptCreateHash(context, CALG_SHA_256, 0, 0, &hash);
-		assert(succeeded);
+		0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5, 0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+		0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3, 0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174,
+		0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC, 0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
+		0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7, 0xC6E00BF3, 0xD5A79147, 0x06CA6351, 0x14292967,
+		0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13, 0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85,
+		0xA2BFE8A1, 0xA81A664B, 0xC24B8B70, 0xC76C51A3, 0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070,
+		0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5, 0x391C0CB3, 0x4ED8AA4A, 0x5B9CCA4F, 0x682E6FF3,
+		0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208, 0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2,
+	};
 
-		succeeded = CryptHashData(hash, reinterpret_cast<const BYTE*>(data), dataSize, 0);
-		assert(succeeded);
+	inline uint32 RotateRight(uint32 value, unsigned int amount)
+	{
+		return (value >> amount) | (value << (32 - amount));
+	}
 
-		DWORD hashSize = 0;
-		DWORD hashSizeLength = sizeof(hashSize);
-		succeeded = CryptGetHashParam(hash, HP_HASHSIZE, reinterpret_cast<BYTE*>(&hashSize), &hashSizeLength, 0);
-		assert(succeeded);
-		
-		assert(hashSize == 0x20);
+	void Sha256BlocksScalar(uint32* state, const uint8* data, size_t blockCount)
+	{
+		for(size_t block = 0; block < blockCount; block++, data += 64)
+		{
+			uint32 w[64];
+			for(unsigned int i = 0; i < 16; i++)
+			{
+				w[i] = (static_cast<uint32>(data[i * 4 + 0]) << 24) | (static_cast<uint32>(data[i * 4 + 1]) << 16) |
+				       (static_cast<uint32>(data[i * 4 + 2]) << 8) | static_cast<uint32>(data[i * 4 + 3]);
+			}
+			for(unsigned int i = 16; i < 64; i++)
+			{
+				uint32 s0 = RotateRight(w[i - 15], 7) ^ RotateRight(w[i - 15], 18) ^ (w[i - 15] >> 3);
+				uint32 s1 = RotateRight(w[i - 2], 17) ^ RotateRight(w[i - 2], 19) ^ (w[i - 2] >> 10);
+				w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+			}
+			uint32 a = state[0], b = state[1], c = state[2], d = state[3];
+			uint32 e = state[4], f = state[5], g = state[6], h = state[7];
+			for(unsigned int i = 0; i < 64; i++)
+			{
+				uint32 s1 = RotateRight(e, 6) ^ RotateRight(e, 11) ^ RotateRight(e, 25);
+				uint32 ch = (e & f) ^ (~e & g);
+				uint32 t1 = h + s1 + ch + g_sha256RoundConstants[i] + w[i];
+				uint32 s0 = RotateRight(a, 2) ^ RotateRight(a, 13) ^ RotateRight(a, 22);
+				uint32 maj = (a & b) ^ (a & c) ^ (b & c);
+				uint32 t2 = s0 + maj;
+				h = g;
+				g = f;
+				f = e;
+				e = d + t1;
+				d = c;
+				c = b;
+				b = a;
+				a = t1 + t2;
+			}
+			state[0] += a;
+			state[1] += b;
+			state[2] += c;
+			state[3] += d;
+			state[4] += e;
+			state[5] += f;
+			state[6] += g;
+			state[7] += h;
+		}
+	}
 
-		succeeded = CryptGetHashParam(hash, HP_HASHVAL, reinterpret_cast<BYTE*>(result.data()), &hashSize, 0);
-		assert(succeeded);
+#if defined(FRAMEWORK_SIMD_HAS_X86_DISPATCH)
+	FRAMEWORK_SIMD_TARGET_SHA void Sha256BlocksShaNi(uint32* state, const uint8* data, size_t blockCount)
+	{
+		const __m128i byteSwapMask = _mm_set_epi64x(0x0C0D0E0F08090A0BULL, 0x0405060700010203ULL);
 
-		succeeded = CryptDestroyHash(hash);
-		assert(succeeded);
+		//Instructions work on the state as ABEF and CDGH
+		__m128i temp = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(state + 0)), 0xB1);
+		__m128i state1 = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(state + 4)), 0x1B);
+		__m128i state0 = _mm_alignr_epi8(temp, state1, 8);
+		state1 = _mm_blend_epi16(state1, temp, 0xF0);
+
+		for(size_t block = 0; block < blockCount; block++, data += 64)
+		{
+			__m128i savedState0 = state0;
+			__m128i savedState1 = state1;
+			__m128i messages[4];
+			for(unsigned int group = 0; group < 16; group++)
+			{
+				__m128i message;
+				if(group < 4)
+				{
+					message = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + group * 16)), byteSwapMask);
+				}
+				else
+				{
+					//W[i..i+3] from W[i-16..i-13], W[i-12..i-9], W[i-8..i-5] and W[i-4..i-1]
+					message = _mm_sha256msg1_epu32(messages[group & 3], messages[(group + 1) & 3]);
+					message = _mm_add_epi32(message, _mm_alignr_epi8(messages[(group + 3) & 3], messages[(group + 2) & 3], 4));
+					message = _mm_sha256msg2_epu32(message, messages[(group + 3) & 3]);
+				}
+				messages[group & 3] = message;
+				__m128i roundInput = _mm_add_epi32(message, _mm_load_si128(reinterpret_cast<const __m128i*>(g_sha256RoundConstants + group * 4)));
+				state1 = _mm_sha256rnds2_epu32(state1, state0, roundInput);
+				state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(roundInput, 0x0E));
+			}
+			state0 = _mm_add_epi32(state0, savedState0);
+			state1 = _mm_add_epi32(state1, savedState1);
+		}
+
+		temp = _mm_shuffle_epi32(state0, 0x1B);
+		state1 = _mm_shuffle_epi32(state1, 0xB1);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(state + 0), _mm_blend_epi16(temp, state1, 0xF0));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(state + 4), _mm_alignr_epi8(state1, temp, 8));
 	}
+#elif defined(FRAMEWORK_SIMD_HAS_ARM_SHA2)
+	FRAMEWORK_SIMD_TARGET_ARM_SHA2 void Sha256BlocksArm(uint32* state, const uint8* data, size_t blockCount)
+	{
+		uint32x4_t state0 = vld1q_u32(state + 0);
+		uint32x4_t state1 = vld1q_u32(state + 4);
 
-	succeeded = CryptReleaseContext(context, 0);
-	assert(succeeded);
-#elif defined(__ANDROID__)
-	auto env = CJavaVM::GetEnv();
+		for(size_t block = 0; block < blockCount; block++, data += 64)
+		{
+			uint32x4_t savedState0 = state0;
+			uint32x4_t savedState1 = state1;
+			uint32x4_t messages[4];
+			for(unsigned int group = 0; group < 16; group++)
+			{
+				uint32x4_t message;
+				if(group < 4)
+				{
+					message = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + group * 16)));
+				}
+				else
+				{
+					message = vsha256su0q_u32(messages[group & 3], messages[(group + 1) & 3]);
+					message = vsha256su1q_u32(message, messages[(group + 2) & 3], messages[(group + 3) & 3]);
+				}
+				messages[group & 3] = message;
+				uint32x4_t roundInput = vaddq_u32(message, vld1q_u32(g_sha256RoundConstants + group * 4));
+				uint32x4_t previousState0 = state0;
+				state0 = vsha256hq_u32(state0, state1, roundInput);
+				state1 = vsha256h2q_u32(state1, previousState0, roundInput);
+			}
+			state0 = vaddq_u32(state0, savedState0);
+			state1 = vaddq_u32(state1, savedState1);
+		}
 
-	jstring algoString = env->NewStringUTF("SHA-256");
-	auto messageDigest = java::security::MessageDigest::getInstance(algoString);
-	env->DeleteLocalRef(algoString);
+		vst1q_u32(state + 0, state0);
+		vst1q_u32(state + 4, state1);
+	}
+#endif
 
-	jbyteArray dataArray = env->NewByteArray(dataSize);
-	env->SetByteArrayRegion(dataArray, 0, dataSize, reinterpret_cast<const jbyte*>(data));
-	jbyteArray hash = messageDigest.digest(dataArray);
-	env->DeleteLocalRef(dataArray);
+	CKernelDispatcher<Sha256BlockFunction> CreateSha256Dispatcher()
+	{
+		CKernelDispatcher<Sha256BlockFunction> dispatcher(&Sha256BlocksScalar);
+#if defined(FRAMEWORK_SIMD_HAS_X86_DISPATCH)
+		dispatcher.Register(CCpuFeatures::FEATURE_SSE41 | CCpuFeatures::FEATURE_X86_SHA, &Sha256BlocksShaNi);
+#elif defined(FRAMEWORK_SIMD_HAS_ARM_SHA2)
+		dispatcher.Register(CCpuFeatures::FEATURE_ARM_SHA2, &Sha256BlocksArm);
+#endif
+		return dispatcher;
+	}
 
-	assert(env->GetArrayLength(hash) == 0x20);
-	jbyte* hashBytes = env->GetByteArrayElements(hash, NULL);
-	memcpy(result.data(), hashBytes, 0x20);
-	env->ReleaseByteArrayElements(hash, hashBytes, JNI_ABORT);
-	env->DeleteLocalRef(hash);
-#elif defined(HAS_OPENSSL) || defined(__APPLE__)
+	const CKernelDispatcher<Sha256BlockFunction> g_sha256Dispatcher = CreateSha256Dispatcher();
+
+	//CryptoAPI and JNI calls are costly, it's better to use the CPU's hashing instructions directly.
+	//Other system libraries already use them. Without any library, the scalar version is used.
+	bool IsBuiltInSha256Preferred()
+	{
+#if defined(_WIN32) || defined(__ANDROID__)
+		return g_sha256Dispatcher.Get() != &Sha256BlocksScalar;
+#elif defined(__APPLE__) || defined(HAS_OPENSSL)
+		return false;
+#else
+		return true;
+#endif
+	}
+
+	class CBuiltInSha256
+	{
+	public:
+		CBuiltInSha256()
+		{
+			memcpy(m_state, g_sha256InitialState, sizeof(g_sha256InitialState));
+		}
+
+		void Update(const void* data, size_t dataSize)
+		{
+			auto input = reinterpret_cast<const uint8*>(data);
+			auto blockFunction = g_sha256Dispatcher.Get();
+			m_totalSize += dataSize;
+			if(m_pendingSize != 0)
+			{
+				size_t copySize = std::min<size_t>(dataSize, BLOCK_SIZE - m_pendingSize);
+				memcpy(m_pending + m_pendingSize, input, copySize);
+				m_pendingSize += copySize;
+				input += copySize;
+				dataSize -= copySize;
+				if(m_pendingSize != BLOCK_SIZE) return;
+				blockFunction(m_state, m_pending, 1);
+				m_pendingSize = 0;
+			}
+			size_t blockCount = dataSize / BLOCK_SIZE;
+			if(blockCount != 0)
+			{
+				blockFunction(m_state, input, blockCount);
+			}
+			m_pendingSize = dataSize % BLOCK_SIZE;
+			memcpy(m_pending, input + (blockCount * BLOCK_SIZE), m_pendingSize);
+		}
+
+		std::array<uint8, 0x20> Finalize()
+		{
+			//Padding: 0x80, zeros up to 56 bytes in the last block and the size in bits (big endian)
+			uint8 padding[BLOCK_SIZE + 8] = {0x80};
+			size_t paddingSize = ((m_pendingSize < 56) ? 56 : (BLOCK_SIZE + 56)) - m_pendingSize;
+			uint64 bitCount = m_totalSize * 8;
+			for(unsigned int i = 0; i < 8; i++)
+			{
+				padding[paddingSize + i] = static_cast<uint8>(bitCount >> (56 - i * 8));
+			}
+			Update(padding, paddingSize + 8);
+			assert(m_pendingSize == 0);
+			std::array<uint8, 0x20> result;
+			for(unsigned int i = 0; i < 8; i++)
+			{
+				result[i * 4 + 0] = static_cast<uint8>(m_state[i] >> 24);
+				result[i * 4 + 1] = static_cast<uint8>(m_state[i] >> 16);
+				result[i * 4 + 2] = static_cast<uint8>(m_state[i] >> 8);
+				result[i * 4 + 3] = static_cast<uint8>(m_state[i]);
+			}
+			return result;
+		}
+
+	private:
+		enum
+		{
+			BLOCK_SIZE = 64,
+		};
+
+		uint32 m_state[8];
+		uint8 m_pending[BLOCK_SIZE];
+		size_t m_pendingSize = 0;
+		uint64 m_totalSize = 0;
+	};
+
+#if defined(_WIN32)
+	//Provider handles can be shared by threads, keep one for the lifetime of the process
+	HCRYPTPROV GetCryptProvider()
+	{
+		static const HCRYPTPROV provider =
+		    []() {
+			    HCRYPTPROV result = NULL;
+			    BOOL succeeded = CryptAcquireContext(&result, NULL, NULL, PROV_RSA_AES, CRYPT_VERIFYCONTEXT);
+			    if(!succeeded)
+			    {
+				    throw std::runtime_error("Failed to acquire crypto provider.");
+			    }
+			    return result;
+		    }();
+		return provider;
+	}
+#endif
+}
+
+struct Framework::HashUtils::CSha256Hasher::CONTEXT
+{
+	bool isBuiltIn = false;
+	CBuiltInSha256 builtIn;
+#if defined(_WIN32)
+	HCRYPTHASH hash = NULL;
+#elif defined(__ANDROID__)
+	java::security::MessageDigest messageDigest;
+#elif defined(__APPLE__)
+	SHA256_CTX c;
+#elif defined(HAS_OPENSSL)
+	//Low level SHA256 functions are deprecated since OpenSSL 3
+	EVP_MD_CTX* digestContext = nullptr;
+#endif
+};
+
+std::array<uint8, 0x20> Framework::HashUtils::ComputeSha256(const void* data, size_t dataSize)
+{
+	if(IsBuiltInSha256Preferred())
+	{
+		CBuiltInSha256 hasher;
+		hasher.Update(data, dataSize);
+		return hasher.Finalize();
+	}
+#if defined(__APPLE__)
+	std::array<uint8, 0x20> result;
 	SHA256_CTX c;
 	SHA256_Init(&c);
 	SHA256_Update(&c, data, dataSize);
 	SHA256_Final(result.data(), &c);
+	return result;
+#elif defined(HAS_OPENSSL)
+	std::array<uint8, 0x20> result;
+	int succeeded = EVP_Digest(data, dataSize, result.data(), nullptr, EVP_sha256(), nullptr);
+	if(!succeeded)
+	{
+		throw std::runtime_error("Failed to compute hash.");
+	}
+	return result;
 #else
-	throw std::runtime_error("Not supported");
+	CSha256Hasher hasher;
+	hasher.Update(data, dataSize);
+	return hasher.Finalize();
 #endif
-	return result;
 }
 
 std::array<uint8, 0x20> Framework::HashUtils::ComputeHmacSha256(const void* key, size_t keySize, const void* data, size_t dataSize)
@@ -87,10 +349,7 @@ std::array<uint8, 0x20> Framework::HashUtils::ComputeHmacSha256(const void* key,
 #if defined(_WIN32)
 	BOOL succeeded = FALSE;
 
-	HCRYPTPROV context = NULL;
-	succeeded = CryptAcquireContext(&context, NULL, NULL, PROV_RSA_AES, CRYPT_VERIFYCONTEXT);
-	assert(succeeded);
-
+	HCRYPTPROV context = GetCryptProvider();
 	HCRYPTKEY cryptKey = NULL;
 
 	{
@@ -143,9 +402,6 @@ std::array<uint8, 0x20> Framework::HashUtils::ComputeHmacSha256(const void* key,
 
 	succeeded = CryptDestroyKey(cryptKey);
 	assert(succeeded);
-
-	succeeded = CryptReleaseContext(context, 0);
-	assert(succeeded);
 #elif defined(__ANDROID__)
 	auto env = CJavaVM::GetEnv();
 
@@ -188,3 +444,105 @@ std::array<uint8, 0x20> Framework::HashUtils::ComputeHmacSha256(const void* key,
 #endif
 	return result;
 }
+
+Framework::HashUtils::CSha256Hasher::CSha256Hasher()
+    : m_context(std::make_unique<CONTEXT>())
+{
+	if(IsBuiltInSha256Preferred())
+	{
+		m_context->isBuiltIn = true;
+		return;
+	}
+#if defined(_WIN32)
+	BOOL succeeded = CryptCreateHash(GetCryptProvider(), CALG_SHA_256, 0, 0, &m_context->hash);
+	assert(succeeded);
+#elif defined(__ANDROID__)
+	auto env = CJavaVM::GetEnv();
+
+	jstring algoString = env->NewStringUTF("SHA-256");
+	m_context->messageDigest = java::security::MessageDigest::getInstance(algoString);
+	env->DeleteLocalRef(algoString);
+#elif defined(__APPLE__)
+	SHA256_Init(&m_context->c);
+#elif defined(HAS_OPENSSL)
+	m_context->digestContext = EVP_MD_CTX_new();
+	if(!m_context->digestContext || !EVP_DigestInit_ex(m_context->digestContext, EVP_sha256(), nullptr))
+	{
+		EVP_MD_CTX_free(m_context->digestContext);
+		throw std::runtime_error("Failed to create hash.");
+	}
+#endif
+}
+
+Framework::HashUtils::CSha256Hasher::~CSha256Hasher()
+{
+#if defined(_WIN32)
+	if(m_context->hash != NULL)
+	{
+		CryptDestroyHash(m_context->hash);
+	}
+#elif defined(HAS_OPENSSL) && !defined(__APPLE__) && !defined(__ANDROID__)
+	EVP_MD_CTX_free(m_context->digestContext);
+#endif
+}
+
+void Framework::HashUtils::CSha256Hasher::Update(const void* data, size_t dataSize)
+{
+	if(m_context->isBuiltIn)
+	{
+		m_context->builtIn.Update(data, dataSize);
+		return;
+	}
+#if defined(_WIN32)
+	assert(m_context->hash != NULL);
+	BOOL succeeded = CryptHashData(m_context->hash, reinterpret_cast<const BYTE*>(data), dataSize, 0);
+	assert(succeeded);
+#elif defined(__ANDROID__)
+	auto env = CJavaVM::GetEnv();
+
+	jbyteArray dataArray = env->NewByteArray(dataSize);
+	env->SetByteArrayRegion(dataArray, 0, dataSize, reinterpret_cast<const jbyte*>(data));
+	m_context->messageDigest.update(dataArray);
+	env->DeleteLocalRef(dataArray);
+#elif defined(__APPLE__)
+	SHA256_Update(&m_context->c, data, dataSize);
+#elif defined(HAS_OPENSSL)
+	EVP_DigestUpdate(m_context->digestContext, data, dataSize);
+#endif
+}
+
+std::array<uint8, 0x20> Framework::HashUtils::CSha256Hasher::Finalize()
+{
+	if(m_context->isBuiltIn)
+	{
+		return m_context->builtIn.Finalize();
+	}
+	std::array<uint8, 0x20> result;
+#if defined(_WIN32)
+	assert(m_context->hash != NULL);
+	DWORD hashSize = 0x20;
+	BOOL succeeded = CryptGetHashParam(m_context->hash, HP_HASHVAL, reinterpret_cast<BYTE*>(result.data()), &hashSize, 0);
+	assert(succeeded);
+	assert(hashSize == 0x20);
+
+	succeeded = CryptDestroyHash(m_context->hash);
+	assert(succeeded);
+	m_context->hash = NULL;
+#elif defined(__ANDROID__)
+	auto env = CJavaVM::GetEnv();
+
+	jbyteArray hash = m_context->messageDigest.digest();
+	assert(env->GetArrayLength(hash) == 0x20);
+	jbyte* hashBytes = env->GetByteArrayElements(hash, NULL);
+	memcpy(result.data(), hashBytes, 0x20);
+	env->ReleaseByteArrayElements(hash, hashBytes, JNI_ABORT);
+	env->DeleteLocalRef(hash);
+#elif defined(__APPLE__)
+	SHA256_Final(result.data(), &m_context->c);
+#elif defined(HAS_OPENSSL)
+	EVP_DigestFinal_ex(m_context->digestContext, result.data(), nullptr);
+#else
+	throw std::runtime_error("Not supported");
+#endif
+	return result;
+}
@@ -0,0 +1,702 @@
+#include "HashUtils.h"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+#include "CpuFeatures.h"
+#include "MappedFileStream.h"
+#include "ParallelFor.h"
+#include "SimdDefs.h"
+
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+#include <emmintrin.h>
+#if defined(FRAMEWORK_SIMD_HAS_X86_DISPATCH)
+#include <immintrin.h>
+#endif
+#elif defined(FRAMEWORK_SIMD_USE_NEON) && !defined(__EMSCRIPTEN__)
+#include <arm_neon.h>
+#endif
+
+//Port of the default hash mode of BLAKE3, without keyed hashing, key derivation and extended output.
+//Results are for little endian platforms, the only ones we support.
+
+using namespace Framework;
+using namespace Framework::HashUtils;
+
+namespace
+{
+	//Hashes full chunks that are next to each other in memory, writes the 8 words chaining value of each one
+	typedef void (*Blake3ChunksFunction)(const uint8*, size_t, uint64, uint32*);
+
+	enum
+	{
+		BLOCK_SIZE = 64,
+		CHUNK_SIZE = 1024,
+		BLOCK_PER_CHUNK = CHUNK_SIZE / BLOCK_SIZE,
+		//Full chunks are hashed in batches of this many before their chaining values are merged
+		LEAF_CHUNK_COUNT = 64,
+		//Subtrees given to threads, needs to be a power of two number of chunks
+		SEGMENT_SIZE = 0x100000,
+	};
+
+	//Not an enum, flags are picked with conditional expressions mixing them with 0
+	constexpr uint32 FLAG_CHUNK_START = (1 << 0);
+	constexpr uint32 FLAG_CHUNK_END = (1 << 1);
+	constexpr uint32 FLAG_PARENT = (1 << 2);
+	constexpr uint32 FLAG_ROOT = (1 << 3);
+
+	const uint32 g_iv[8] =
+	{
+		0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A, 0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19
+	};
+
+	//Message words used by each round, the permutation applied as many times as the round's index
+	const uint8 g_messageSchedule[7][16] =
+	{
+		{0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15},
+		{2, 6, 3, 10, 7, 0, 4, 13, 1, 11, 12, 5, 9, 14, 15, 8},
+		{3, 4, 10, 12, 13, 2, 7, 14, 6, 5, 9, 0, 11, 15, 8, 1},
+		{10, 7, 12, 9, 14, 3, 13, 15, 4, 0, 11, 2, 5, 8, 1, 6},
+		{12, 13, 9, 11, 15, 10, 14, 8, 7, 2, 5, 3, 0, 1, 6, 4},
+		{9, 14, 11, 5, 8, 12, 15, 1, 13, 3, 0, 10, 2, 6, 4, 7},
+		{11, 15, 5, 0, 1, 9, 8, 6, 14, 10, 2, 12, 3, 4, 7, 13},
+	};
+
+	inline uint32 Read32(const uint8* data)
+	{
+		uint32 value;
+		memcpy(&value, data, sizeof(value));
+		return value;
+	}
+
+	inline uint32 RotateRight(uint32 value, unsigned int amount)
+	{
+		return (value >> amount) | (value << (32 - amount));
+	}
+
+	inline void Mix(uint32* v, unsigned int a, unsigned int b, unsigned int c, unsigned int d, uint32 x, uint32 y)
+	{
+		v[a] = v[a] + v[b] + x;
+		v[d] = RotateRight(v[d] ^ v[a], 16);
+		v[c] = v[c] + v[d];
+		v[b] = RotateRight(v[b] ^ v[c], 12);
+		v[a] = v[a] + v[b] + y;
+		v[d] = RotateRight(v[d] ^ v[a], 8);
+		v[c] = v[c] + v[d];
+		v[b] = RotateRight(v[b] ^ v[c], 7);
+	}
+
+	//Returns the full 16 words state, the first 8 are the chaining value
+	void Compress(uint32* state, const uint32* chainingValue, const uint8* block, uint32 blockSize, uint64 counter, uint32 flags)
+	{
+		uint32 m[16];
+		for(unsigned int i = 0; i < 16; i++)
+		{
+			m[i] = Read32(block + (i * 4));
+		}
+		uint32 v[16] =
+		{
+			chainingValue[0], chainingValue[1], chainingValue[2], chainingValue[3],
+			chainingValue[4], chainingValue[5], chainingValue[6], chainingValue[7],
+			g_iv[0], g_iv[1], g_iv[2], g_iv[3],
+			static_cast<uint32>(counter), static_cast<uint32>(counter >> 32), blockSize, flags
+		};
+		for(const auto& s : g_messageSchedule)
+		{
+			Mix(v, 0, 4, 8, 12, m[s[0]], m[s[1]]);
+			Mix(v, 1, 5, 9, 13, m[s[2]], m[s[3]]);
+			Mix(v, 2, 6, 10, 14, m[s[4]], m[s[5]]);
+			Mix(v, 3, 7, 11, 15, m[s[6]], m[s[7]]);
+			Mix(v, 0, 5, 10, 15, m[s[8]], m[s[9]]);
+			Mix(v, 1, 6, 11, 12, m[s[10]], m[s[11]]);
+			Mix(v, 2, 7, 8, 13, m[s[12]], m[s[13]]);
+			Mix(v, 3, 4, 9, 14, m[s[14]], m[s[15]]);
+		}
+		for(unsigned int i = 0; i < 8; i++)
+		{
+			state[i] = v[i] ^ v[i + 8];
+			state[i + 8] = v[i + 8] ^ chainingValue[i];
+		}
+	}
+
+	//Last compression of a node, kept aside since it's done differently whether the node is the root or not
+	struct OUTPUT
+	{
+		uint32 chainingValue[8];
+		uint8 block[BLOCK_SIZE];
+		uint32 blockSize = 0;
+		uint64 counter = 0;
+		uint32 flags = 0;
+
+		void GetChainingValue(uint32* result) const
+		{
+			uint32 state[16];
+			Compress(state, chainingValue, block, blockSize, counter, flags);
+			memcpy(result, state, sizeof(uint32) * 8);
+		}
+
+		std::array<uint8, 0x20> GetRootHash() const
+		{
+			uint32 state[16];
+			Compress(state, chainingValue, block, blockSize, 0, flags | FLAG_ROOT);
+			std::array<uint8, 0x20> result;
+			memcpy(result.data(), state, result.size());
+			return result;
+		}
+	};
+
+	OUTPUT MakeChunkOutput(const uint8* input, size_t size, uint64 chunkCounter)
+	{
+		OUTPUT output;
+		memcpy(output.chainingValue, g_iv, sizeof(g_iv));
+		output.counter = chunkCounter;
+		output.flags = FLAG_CHUNK_START;
+		//Last block is compressed by the output, even if it's full
+		while(size > BLOCK_SIZE)
+		{
+			uint32 state[16];
+			Compress(state, output.chainingValue, input, BLOCK_SIZE, chunkCounter, output.flags);
+			memcpy(output.chainingValue, state, sizeof(output.chainingValue));
+			output.flags = 0;
+			input += BLOCK_SIZE;
+			size -= BLOCK_SIZE;
+		}
+		memset(output.block, 0, sizeof(output.block));
+		if(size != 0)
+		{
+			memcpy(output.block, input, size);
+		}
+		output.blockSize = static_cast<uint32>(size);
+		output.flags |= FLAG_CHUNK_END;
+		return output;
+	}
+
+	OUTPUT MakeParentOutput(const uint32* left, const uint32* right)
+	{
+		OUTPUT output;
+		memcpy(output.chainingValue, g_iv, sizeof(g_iv));
+		memcpy(output.block, left, sizeof(uint32) * 8);
+		memcpy(output.block + sizeof(uint32) * 8, right, sizeof(uint32) * 8);
+		output.blockSize = BLOCK_SIZE;
+		output.flags = FLAG_PARENT;
+		return output;
+	}
+
+	void HashChunksScalar(const uint8* input, size_t chunkCount, uint64 chunkCounter, uint32* chainingValues)
+	{
+		for(size_t chunk = 0; chunk < chunkCount; chunk++)
+		{
+			MakeChunkOutput(input + (chunk * CHUNK_SIZE), CHUNK_SIZE, chunkCounter + chunk).GetChainingValue(chainingValues + (chunk * 8));
+		}
+	}
+
+	//Wide versions run one compression per lane, on blocks at the same position in consecutive chunks.
+	//Message words are transposed so that each vector holds the same word of every lane's block.
+
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+	template <int Amount>
+	inline __m128i RotateRightSse2(__m128i value)
+	{
+		return _mm_or_si128(_mm_srli_epi32(value, Amount), _mm_slli_epi32(value, 32 - Amount));
+	}
+
+	inline void MixSse2(__m128i* v, unsigned int a, unsigned int b, unsigned int c, unsigned int d, __m128i x, __m128i y)
+	{
+		v[a] = _mm_add_epi32(_mm_add_epi32(v[a], v[b]), x);
+		v[d] = _mm_xor_si128(v[d], v[a]);
+		v[d] = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v[d], 0xB1), 0xB1);
+		v[c] = _mm_add_epi32(v[c], v[d]);
+		v[b] = RotateRightSse2<12>(_mm_xor_si128(v[b], v[c]));
+		v[a] = _mm_add_epi32(_mm_add_epi32(v[a], v[b]), y);
+		v[d] = RotateRightSse2<8>(_mm_xor_si128(v[d], v[a]));
+		v[c] = _mm_add_epi32(v[c], v[d]);
+		v[b] = RotateRightSse2<7>(_mm_xor_si128(v[b], v[c]));
+	}
+
+	//Loads 4 words from 4 lanes, returns a vector per word
+	inline void LoadTransposedSse2(__m128i* result, const uint8* input0, const uint8* input1, const uint8* input2, const uint8* input3)
+	{
+		__m128i rows[4] =
+		{
+			_mm_loadu_si128(reinterpret_cast<const __m128i*>(input0)),
+			_mm_loadu_si128(reinterpret_cast<const __m128i*>(input1)),
+			_mm_loadu_si128(reinterpret_cast<const __m128i*>(input2)),
+			_mm_loadu_si128(reinterpret_cast<const __m128i*>(input3)),
+		};
+		__m128i low01 = _mm_unpacklo_epi32(rows[0], rows[1]);
+		__m128i high01 = _mm_unpackhi_epi32(rows[0], rows[1]);
+		__m128i low23 = _mm_unpacklo_epi32(rows[2], rows[3]);
+		__m128i high23 = _mm_unpackhi_epi32(rows[2], rows[3]);
+		result[0] = _mm_unpacklo_epi64(low01, low23);
+		result[1] = _mm_unpackhi_epi64(low01, low23);
+		result[2] = _mm_unpacklo_epi64(high01, high23);
+		result[3] = _mm_unpackhi_epi64(high01, high23);
+	}
+
+	void HashChunks4Sse2(const uint8* input, uint64 chunkCounter, uint32* chainingValues)
+	{
+		alignas(16) uint32 counterLow[4];
+		alignas(16) uint32 counterHigh[4];
+		for(unsigned int lane = 0; lane < 4; lane++)
+		{
+			counterLow[lane] = static_cast<uint32>(chunkCounter + lane);
+			counterHigh[lane] = static_cast<uint32>((chunkCounter + lane) >> 32);
+		}
+		__m128i h[8];
+		for(unsigned int i = 0; i < 8; i++)
+		{
+			h[i] = _mm_set1_epi32(static_cast<int>(g_iv[i]));
+		}
+		for(unsigned int block = 0; block < BLOCK_PER_CHUNK; block++)
+		{
+			__m128i m[16];
+			const uint8* blockInput = input + (block * BLOCK_SIZE);
+			for(unsigned int group = 0; group < 4; group++)
+			{
+				const uint8* groupInput = blockInput + (group * 16);
+				LoadTransposedSse2(m + (group * 4), groupInput, groupInput + CHUNK_SIZE, groupInput + (CHUNK_SIZE * 2), groupInput + (CHUNK_SIZE * 3));
+			}
+			uint32 flags = ((block == 0) ? FLAG_CHUNK_START : 0) | ((block == (BLOCK_PER_CHUNK - 1)) ? FLAG_CHUNK_END : 0);
+			__m128i v[16] =
+			{
+				h[0], h[1], h[2], h[3], h[4], h[5], h[6], h[7],
+				_mm_set1_epi32(static_cast<int>(g_iv[0])), _mm_set1_epi32(static_cast<int>(g_iv[1])),
+				_mm_set1_epi32(static_cast<int>(g_iv[2])), _mm_set1_epi32(static_cast<int>(g_iv[3])),
+				_mm_load_si128(reinterpret_cast<const __m128i*>(counterLow)), _mm_load_si128(reinterpret_cast<const __m128i*>(counterHigh)),
+				_mm_set1_epi32(BLOCK_SIZE), _mm_set1_epi32(static_cast<int>(flags))
+			};
+			for(const auto& s : g_messageSchedule)
+			{
+				MixSse2(v, 0, 4, 8, 12, m[s[0]], m[s[1]]);
+				MixSse2(v, 1, 5, 9, 13, m[s[2]], m[s[3]]);
+				MixSse2(v, 2, 6, 10, 14, m[s[4]], m[s[5]]);
+				MixSse2(v, 3, 7, 11, 15, m[s[6]], m[s[7]]);
+				MixSse2(v, 0, 5, 10, 15, m[s[8]], m[s[9]]);
+				MixSse2(v, 1, 6, 11, 12, m[s[10]], m[s[11]]);
+				MixSse2(v, 2, 7, 8, 13, m[s[12]], m[s[13]]);
+				MixSse2(v, 3, 4, 9, 14, m[s[14]], m[s[15]]);
+			}
+			for(unsigned int i = 0; i < 8; i++)
+			{
+				h[i] = _mm_xor_si128(v[i], v[i + 8]);
+			}
+		}
+		alignas(16) uint32 words[8][4];
+		for(unsigned int i = 0; i < 8; i++)
+		{
+			_mm_store_si128(reinterpret_cast<__m128i*>(words[i]), h[i]);
+		}
+		for(unsigned int lane = 0; lane < 4; lane++)
+		{
+			for(unsigned int i = 0; i < 8; i++)
+			{
+				chainingValues[(lane * 8) + i] = words[i][lane];
+			}
+		}
+	}
+
+	void HashChunksSse2(const uint8* input, size_t chunkCount, uint64 chunkCounter, uint32* chainingValues)
+	{
+		for(; chunkCount >= 4; chunkCount -= 4, input += CHUNK_SIZE * 4, chunkCounter += 4, chainingValues += 8 * 4)
+		{
+			HashChunks4Sse2(input, chunkCounter, chainingValues);
+		}
+		HashChunksScalar(input, chunkCount, chunkCounter, chainingValues);
+	}
+
+#if defined(FRAMEWORK_SIMD_HAS_X86_DISPATCH)
+	template <int Amount>
+	FRAMEWORK_SIMD_TARGET_AVX2 inline __m256i RotateRightAvx2(__m256i value)
+	{
+		return _mm256_or_si256(_mm256_srli_epi32(value, Amount), _mm256_slli_epi32(value, 32 - Amount));
+	}
+
+	FRAMEWORK_SIMD_TARGET_AVX2 inline void MixAvx2(__m256i* v, unsigned int a, unsigned int b, unsigned int c, unsigned int d, __m256i x, __m256i y)
+	{
+		//Rotations by multiples of 8 are byte shuffles
+		const __m256i rotate16 = _mm256_setr_epi8(2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13,
+		                                          2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13);
+		const __m256i rotate8 = _mm256_setr_epi8(1, 2, 3, 0, 5, 6, 7, 4, 9, 10, 11, 8, 13, 14, 15, 12,
+		                                         1, 2, 3, 0, 5, 6, 7, 4, 9, 10, 11, 8, 13, 14, 15, 12);
+		v[a] = _mm256_add_epi32(_mm256_add_epi32(v[a], v[b]), x);
+		v[d] = _mm256_shuffle_epi8(_mm256_xor_si256(v[d], v[a]), rotate16);
+		v[c] = _mm256_add_epi32(v[c], v[d]);
+		v[b] = RotateRightAvx2<12>(_mm256_xor_si256(v[b], v[c]));
+		v[a] = _mm256_add_epi32(_mm256_add_epi32(v[a], v[b]), y);
+		v[d] = _mm256_shuffle_epi8(_mm256_xor_si256(v[d], v[a]), rotate8);
+		v[c] = _mm256_add_epi32(v[c], v[d]);
+		v[b] = RotateRightAvx2<7>(_mm256_xor_si256(v[b], v[c]));
+	}
+
+	FRAMEWORK_SIMD_TARGET_AVX2 void HashChunks8Avx2(const uint8* input, uint64 chunkCounter, uint32* chainingValues)
+	{
+		alignas(32) uint32 counterLow[8];
+		alignas(32) uint32 counterHigh[8];
+		for(unsigned int lane = 0; lane < 8; lane++)
+		{
+			counterLow[lane] = static_cast<uint32>(chunkCounter + lane);
+			counterHigh[lane] = static_cast<uint32>((chunkCounter + lane) >> 32);
+		}
+		__m256i h[8];
+		for(unsigned int i = 0; i < 8; i++)
+		{
+			h[i] = _mm256_set1_epi32(static_cast<int>(g_iv[i]));
+		}
+		for(unsigned int block = 0; block < BLOCK_PER_CHUNK; block++)
+		{
+			__m256i m[16];
+			const uint8* blockInput = input + (block * BLOCK_SIZE);
+			for(unsigned int group = 0; group < 4; group++)
+			{
+				//Lanes 0 to 3 go in the low halves, 4 to 7 in the high ones
+				const uint8* groupInput = blockInput + (group * 16);
+				__m128i low[4];
+				__m128i high[4];
+				LoadTransposedSse2(low, groupInput, groupInput + CHUNK_SIZE, groupInput + (CHUNK_SIZE * 2), groupInput + (CHUNK_SIZE * 3));
+				groupInput += CHUNK_SIZE * 4;
+				LoadTransposedSse2(high, groupInput, groupInput + CHUNK_SIZE, groupInput + (CHUNK_SIZE * 2), groupInput + (CHUNK_SIZE * 3));
+				for(unsigned int i = 0; i < 4; i++)
+				{
+					m[(group * 4) + i] = _mm256_inserti128_si256(_mm256_castsi128_si256(low[i]), high[i], 1);
+				}
+			}
+			uint32 flags = ((block == 0) ? FLAG_CHUNK_START : 0) | ((block == (BLOCK_PER_CHUNK - 1)) ? FLAG_CHUNK_END : 0);
+			__m256i v[16] =
+			{
+				h[0], h[1], h[2], h[3], h[4], h[5], h[6], h[7],
+				_mm256_set1_epi32(static_cast<int>(g_iv[0])), _mm256_set1_epi32(static_cast<int>(g_iv[1])),
+				_mm256_set1_epi32(static_cast<int>(g_iv[2])), _mm256_set1_epi32(static_cast<int>(g_iv[3])),
+				_mm256_load_si256(reinterpret_cast<const __m256i*>(counterLow)), _mm256_load_si256(reinterpret_cast<const __m256i*>(counterHigh)),
+				_mm256_set1_epi32(BLOCK_SIZE), _mm256_set1_epi32(static_cast<int>(flags))
+			};
+			for(const auto& s : g_messageSchedule)
+			{
+				MixAvx2(v, 0, 4, 8, 12, m[s[0]], m[s[1]]);
+				MixAvx2(v, 1, 5, 9, 13, m[s[2]], m[s[3]]);
+				MixAvx2(v, 2, 6, 10, 14, m[s[4]], m[s[5]]);
+				MixAvx2(v, 3, 7, 11, 15, m[s[6]], m[s[7]]);
+				MixAvx2(v, 0, 5, 10, 15, m[s[8]], m[s[9]]);
+				MixAvx2(v, 1, 6, 11, 12, m[s[10]], m[s[11]]);
+				MixAvx2(v, 2, 7, 8, 13, m[s[12]], m[s[13]]);
+				MixAvx2(v, 3, 4, 9, 14, m[s[14]], m[s[15]]);
+			}
+			for(unsigned int i = 0; i < 8; i++)
+			{
+				h[i] = _mm256_xor_si256(v[i], v[i + 8]);
+			}
+		}
+		alignas(32) uint32 words[8][8];
+		for(unsigned int i = 0; i < 8; i++)
+		{
+			_mm256_store_si256(reinterpret_cast<__m256i*>(words[i]), h[i]);
+		}
+		for(unsigned int lane = 0; lane < 8; lane++)
+		{
+			for(unsigned int i = 0; i < 8; i++)
+			{
+				chainingValues[(lane * 8) + i] = words[i][lane];
+			}
+		}
+	}
+
+	FRAMEWORK_SIMD_TARGET_AVX2 void HashChunksAvx2(const uint8* input, size_t chunkCount, uint64 chunkCounter, uint32* chainingValues)
+	{
+		for(; chunkCount >= 8; chunkCount -= 8, input += CHUNK_SIZE * 8, chunkCounter += 8, chainingValues += 8 * 8)
+		{
+			HashChunks8Avx2(input, chunkCounter, chainingValues);
+		}
+		HashChunksSse2(input, chunkCount, chunkCounter, chainingValues);
+	}
+#endif
+#elif defined(FRAMEWORK_SIMD_USE_NEON) && !defined(__EMSCRIPTEN__)
+	template <int Amount>
+	inline uint32x4_t RotateRightNeon(uint32x4_t value)
+	{
+		return vorrq_u32(vshrq_n_u32(value, Amount), vshlq_n_u32(value, 32 - Amount));
+	}
+
+	inline void MixNeon(uint32x4_t* v, unsigned int a, unsigned int b, unsigned int c, unsigned int d, uint32x4_t x, uint32x4_t y)
+	{
+		v[a] = vaddq_u32(vaddq_u32(v[a], v[b]), x);
+		v[d] = vreinterpretq_u32_u16(vrev32q_u16(vreinterpretq_u16_u32(veorq_u32(v[d], v[a]))));
+		v[c] = vaddq_u32(v[c], v[d]);
+		v[b] = RotateRightNeon<12>(veorq_u32(v[b], v[c]));
+		v[a] = vaddq_u32(vaddq_u32(v[a], v[b]), y);
+		v[d] = RotateRightNeon<8>(veorq_u32(v[d], v[a]));
+		v[c] = vaddq_u32(v[c], v[d]);
+		v[b] = RotateRightNeon<7>(veorq_u32(v[b], v[c]));
+	}
+
+	void HashChunks4Neon(const uint8* input, uint64 chunkCounter, uint32* chainingValues)
+	{
+		uint32 counterLow[4];
+		uint32 counterHigh[4];
+		for(unsigned int lane = 0; lane < 4; lane++)
+		{
+			counterLow[lane] = static_cast<uint32>(chunkCounter + lane);
+			counterHigh[lane] = static_cast<uint32>((chunkCounter + lane) >> 32);
+		}
+		uint32x4_t h[8];
+		for(unsigned int i = 0; i < 8; i++)
+		{
+			h[i] = vdupq_n_u32(g_iv[i]);
+		}
+		for(unsigned int block = 0; block < BLOCK_PER_CHUNK; block++)
+		{
+			uint32x4_t m[16];
+			const uint8* blockInput = input + (block * BLOCK_SIZE);
+			for(unsigned int group = 0; group < 4; group++)
+			{
+				const uint8* groupInput = blockInput + (group * 16);
+				uint32x4x2_t rows01 = vtrnq_u32(vreinterpretq_u32_u8(vld1q_u8(groupInput)), vreinterpretq_u32_u8(vld1q_u8(groupInput + CHUNK_SIZE)));
+				uint32x4x2_t rows23 = vtrnq_u32(vreinterpretq_u32_u8(vld1q_u8(groupInput + (CHUNK_SIZE * 2))), vreinterpretq_u32_u8(vld1q_u8(groupInput + (CHUNK_SIZE * 3))));
+				m[(group * 4) + 0] = vcombine_u32(vget_low_u32(rows01.val[0]), vget_low_u32(rows23.val[0]));
+				m[(group * 4) + 1] = vcombine_u32(vget_low_u32(rows01.val[1]), vget_low_u32(rows23.val[1]));
+				m[(group * 4) + 2] = vcombine_u32(vget_high_u32(rows01.val[0]), vget_high_u32(rows23.val[0]));
+				m[(group * 4) + 3] = vcombine_u32(vget_high_u32(rows01.val[1]), vget_high_u32(rows23.val[1]));
+			}
+			uint32 flags = ((block == 0) ? FLAG_CHUNK_START : 0) | ((block == (BLOCK_PER_CHUNK - 1)) ? FLAG_CHUNK_END : 0);
+			uint32x4_t v[16] =
+			{
+				h[0], h[1], h[2], h[3], h[4], h[5], h[6], h[7],
+				vdupq_n_u32(g_iv[0]), vdupq_n_u32(g_iv[1]), vdupq_n_u32(g_iv[2]), vdupq_n_u32(g_iv[3]),
+				vld1q_u32(counterLow), vld1q_u32(counterHigh), vdupq_n_u32(BLOCK_SIZE), vdupq_n_u32(flags)
+			};
+			for(const auto& s : g_messageSchedule)
+			{
+				MixNeon(v, 0, 4, 8, 12, m[s[0]], m[s[1]]);
+				MixNeon(v, 1, 5, 9, 13, m[s[2]], m[s[3]]);
+				MixNeon(v, 2, 6, 10, 14, m[s[4]], m[s[5]]);
+				MixNeon(v, 3, 7, 11, 15, m[s[6]], m[s[7]]);
+				MixNeon(v, 0, 5, 10, 15, m[s[8]], m[s[9]]);
+				MixNeon(v, 1, 6, 11, 12, m[s[10]], m[s[11]]);
+				MixNeon(v, 2, 7, 8, 13, m[s[12]], m[s[13]]);
+				MixNeon(v, 3, 4, 9, 14, m[s[14]], m[s[15]]);
+			}
+			for(unsigned int i = 0; i < 8; i++)
+			{
+				h[i] = veorq_u32(v[i], v[i + 8]);
+			}
+		}
+		uint32 words[8][4];
+		for(unsigned int i = 0; i < 8; i++)
+		{
+			vst1q_u32(words[i], h[i]);
+		}
+		for(unsigned int lane = 0; lane < 4; lane++)
+		{
+			for(unsigned int i = 0; i < 8; i++)
+			{
+				chainingValues[(lane * 8) + i] = words[i][lane];
+			}
+		}
+	}
+
+	void HashChunksNeon(const uint8* input, size_t chunkCount, uint64 chunkCounter, uint32* chainingValues)
+	{
+		for(; chunkCount >= 4; chunkCount -= 4, input += CHUNK_SIZE * 4, chunkCounter += 4, chainingValues += 8 * 4)
+		{
+			HashChunks4Neon(input, chunkCounter, chainingValues);
+		}
+		HashChunksScalar(input, chunkCount, chunkCounter, chainingValues);
+	}
+#endif
+
+	CKernelDispatcher<Blake3ChunksFunction> CreateBlake3Dispatcher()
+	{
+		CKernelDispatcher<Blake3ChunksFunction> dispatcher(&HashChunksScalar);
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+		dispatcher.Register(CCpuFeatures::FEATURE_SSE2, &HashChunksSse2);
+#if defined(FRAMEWORK_SIMD_HAS_X86_DISPATCH)
+		dispatcher.Register(CCpuFeatures::FEATURE_AVX2, &HashChunksAvx2);
+#endif
+#elif defined(FRAMEWORK_SIMD_USE_NEON) && !defined(__EMSCRIPTEN__)
+		dispatcher.Register(CCpuFeatures::FEATURE_NEON, &HashChunksNeon);
+#endif
+		return dispatcher;
+	}
+
+	const CKernelDispatcher<Blake3ChunksFunction> g_blake3Dispatcher = CreateBlake3Dispatcher();
+
+	//Left subtree of a node holds the largest power of two number of chunks that leaves something for the right one
+	size_t GetLeftSubtreeChunkCount(size_t chunkCount)
+	{
+		size_t result = 1;
+		while((result * 2) < chunkCount)
+		{
+			result *= 2;
+		}
+		return result;
+	}
+
+	//Chaining values of consecutive subtrees of the same size (except the last one, which can be smaller)
+	//are merged the same way chunks are, as long as that size is a power of two number of chunks.
+	OUTPUT MergeChainingValues(const uint32* chainingValues, size_t count)
+	{
+		size_t leftCount = GetLeftSubtreeChunkCount(count);
+		uint32 left[8];
+		uint32 right[8];
+		if(leftCount == 1)
+		{
+			memcpy(left, chainingValues, sizeof(left));
+		}
+		else
+		{
+			MergeChainingValues(chainingValues, leftCount).GetChainingValue(left);
+		}
+		if((count - leftCount) == 1)
+		{
+			memcpy(right, chainingValues + (leftCount * 8), sizeof(right));
+		}
+		else
+		{
+			MergeChainingValues(chainingValues + (leftCount * 8), count - leftCount).GetChainingValue(right);
+		}
+		return MakeParentOutput(left, right);
+	}
+
+	OUTPUT HashSubtree(const uint8* input, size_t size, uint64 chunkCounter)
+	{
+		if(size <= CHUNK_SIZE)
+		{
+			return MakeChunkOutput(input, size, chunkCounter);
+		}
+		size_t chunkCount = (size + CHUNK_SIZE - 1) / CHUNK_SIZE;
+		if(chunkCount > LEAF_CHUNK_COUNT)
+		{
+			size_t leftSize = GetLeftSubtreeChunkCount(chunkCount) * CHUNK_SIZE;
+			uint32 left[8];
+			uint32 right[8];
+			HashSubtree(input, leftSize, chunkCounter).GetChainingValue(left);
+			HashSubtree(input + leftSize, size - leftSize, chunkCounter + (leftSize / CHUNK_SIZE)).GetChainingValue(right);
+			return MakeParentOutput(left, right);
+		}
+		uint32 chainingValues[LEAF_CHUNK_COUNT * 8];
+		size_t fullChunkCount = size / CHUNK_SIZE;
+		g_blake3Dispatcher.Get()(input, fullChunkCount, chunkCounter, chainingValues);
+		if(fullChunkCount != chunkCount)
+		{
+			size_t lastOffset = fullChunkCount * CHUNK_SIZE;
+			MakeChunkOutput(input + lastOffset, size - lastOffset, chunkCounter + fullChunkCount).GetChainingValue(chainingValues + (fullChunkCount * 8));
+		}
+		return MergeChainingValues(chainingValues, chunkCount);
+	}
+}
+
+std::array<uint8, 0x20> Framework::HashUtils::ComputeBlake3(const void* data, size_t size, CThreadPool* threadPool)
+{
+	auto input = reinterpret_cast<const uint8*>(data);
+	if(!threadPool || (size <= SEGMENT_SIZE))
+	{
+		return HashSubtree(input, size, 0).GetRootHash();
+	}
+	//Segments are complete subtrees, only the tree above them is left to hash once they're done
+	size_t segmentCount = (size + SEGMENT_SIZE - 1) / SEGMENT_SIZE;
+	std::vector<uint32> chainingValues(segmentCount * 8);
+	ParallelFor(threadPool, 0, segmentCount,
+	            [&](size_t begin, size_t end) {
+		            for(size_t segment = begin; segment < end; segment++)
+		            {
+			            size_t offset = segment * SEGMENT_SIZE;
+			            size_t segmentSize = std::min<size_t>(SEGMENT_SIZE, size - offset);
+			            HashSubtree(input + offset, segmentSize, offset / CHUNK_SIZE).GetChainingValue(chainingValues.data() + (segment * 8));
+		            }
+	            });
+	return MergeChainingValues(chainingValues.data(), segmentCount).GetRootHash();
+}
+
+std::array<uint8, 0x20> Framework::HashUtils::ComputeBlake3File(const fs::path& path, CThreadPool* threadPool)
+{
+	CMappedFileStream stream(path);
+	return ComputeBlake3(stream.GetData(), static_cast<size_t>(stream.GetLength()), threadPool);
+}
+
+CBlake3Hasher::CBlake3Hasher()
+{
+	memcpy(m_chunkValue, g_iv, sizeof(g_iv));
+}
+
+void CBlake3Hasher::Update(const void* data, size_t size)
+{
+	auto input = reinterpret_cast<const uint8*>(data);
+	while(size != 0)
+	{
+		//Chunks are only finished once more data is known to follow, the last one could be the root
+		if((m_chunkBlockCount == (BLOCK_PER_CHUNK - 1)) && (m_blockSize == BLOCK_SIZE))
+		{
+			uint32 chainingValue[8];
+			uint32 state[16];
+			Compress(state, m_chunkValue, m_block, BLOCK_SIZE, m_chunkCounter, FLAG_CHUNK_END);
+			memcpy(chainingValue, state, sizeof(chainingValue));
+			PushChunkValue(chainingValue);
+		}
+		if((m_chunkBlockCount == 0) && (m_blockSize == 0) && (size > CHUNK_SIZE))
+		{
+			//Full chunks that aren't the last one can go through the wide path
+			size_t chunkCount = std::min<size_t>((size - 1) / CHUNK_SIZE, LEAF_CHUNK_COUNT);
+			uint32 chainingValues[LEAF_CHUNK_COUNT * 8];
+			g_blake3Dispatcher.Get()(input, chunkCount, m_chunkCounter, chainingValues);
+			for(size_t chunk = 0; chunk < chunkCount; chunk++)
+			{
+				PushChunkValue(chainingValues + (chunk * 8));
+			}
+			input += chunkCount * CHUNK_SIZE;
+			size -= chunkCount * CHUNK_SIZE;
+			continue;
+		}
+		if(m_blockSize == BLOCK_SIZE)
+		{
+			CompressBlock();
+		}
+		size_t copySize = std::min<size_t>(BLOCK_SIZE - m_blockSize, size);
+		memcpy(m_block + m_blockSize, input, copySize);
+		m_blockSize += copySize;
+		input += copySize;
+		size -= copySize;
+	}
+}
+
+std::array<uint8, 0x20> CBlake3Hasher::GetHash() const
+{
+	OUTPUT output;
+	memcpy(output.chainingValue, m_chunkValue, sizeof(m_chunkValue));
+	memset(output.block, 0, sizeof(output.block));
+	memcpy(output.block, m_block, m_blockSize);
+	output.blockSize = static_cast<uint32>(m_blockSize);
+	output.counter = m_chunkCounter;
+	output.flags = ((m_chunkBlockCount == 0) ? FLAG_CHUNK_START : 0) | FLAG_CHUNK_END;
+	//Subtrees on the stack are merged with what follows them, from the smallest to the largest
+	for(unsigned int i = m_stackSize; i != 0; i--)
+	{
+		uint32 right[8];
+		output.GetChainingValue(right);
+		output = MakeParentOutput(m_stack[i - 1], right);
+	}
+	return output.GetRootHash();
+}
+
+void CBlake3Hasher::CompressBlock()
+{
+	uint32 state[16];
+	Compress(state, m_chunkValue, m_block, BLOCK_SIZE, m_chunkCounter, (m_chunkBlockCount == 0) ? FLAG_CHUNK_START : 0);
+	memcpy(m_chunkValue, state, sizeof(m_chunkValue));
+	m_chunkBlockCount++;
+	m_blockSize = 0;
+}
+
+void CBlake3Hasher::PushChunkValue(const uint32* chainingValue)
+{
+	//Each trailing zero bit of the chunk count is a complete subtree that can be merged
+	uint32 value[8];
+	memcpy(value, chainingValue, sizeof(value));
+	m_chunkCounter++;
+	for(uint64 count = m_chunkCounter; (count & 1) == 0; count >>= 1)
+	{
+		m_stackSize--;
+		MakeParentOutput(m_stack[m_stackSize], value).GetChainingValue(value);
+	}
+	memcpy(m_stack[m_stackSize], value, sizeof(value));
+	m_stackSize++;
+	memcpy(m_chunkValue, g_iv, sizeof(g_iv));
+	m_chunkBlockCount = 0;
+	m_blockSize = 0;
+}
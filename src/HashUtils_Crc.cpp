@@ -0,0 +1,337 @@
+#include "HashUtils.h"
+#include "CpuFeatures.h"
+#include "SimdDefs.h"
+#include <cstring>
+
+#if defined(FRAMEWORK_SIMD_HAS_X86_DISPATCH)
+#include <immintrin.h>
+#elif defined(FRAMEWORK_SIMD_HAS_ARM_CRC32)
+#include <arm_acle.h>
+#endif
+
+using namespace Framework;
+
+namespace
+{
+	//Kernels work on the CRC register, without the initial and final inversions
+	typedef uint32 (*CrcFunction)(uint32, const uint8*, size_t);
+
+	enum : uint32
+	{
+		CRC32_POLYNOMIAL = 0xEDB88320,
+		CRC32C_POLYNOMIAL = 0x82F63B78,
+	};
+
+	//Size of each part of the buffer when computing 3 CRCs at once
+	enum
+	{
+		INTERLEAVE_SIZE = 0x800,
+	};
+
+	//Polynomials are reflected, the highest power is in the lowest bit
+	uint32 MultiplyModP(uint32 a, uint32 b, uint32 polynomial)
+	{
+		uint32 result = 0;
+		for(uint32 mask = 0x80000000; mask != 0; mask >>= 1)
+		{
+			if(a & mask)
+			{
+				result ^= b;
+			}
+			b = (b & 1) ? ((b >> 1) ^ polynomial) : (b >> 1);
+		}
+		return result;
+	}
+
+	class CCrcTables
+	{
+	public:
+		CCrcTables(uint32 polynomial)
+		{
+			for(uint32 i = 0; i < 256; i++)
+			{
+				uint32 crc = i;
+				for(unsigned int bit = 0; bit < 8; bit++)
+				{
+					crc = (crc & 1) ? ((crc >> 1) ^ polynomial) : (crc >> 1);
+				}
+				m_slices[0][i] = crc;
+			}
+			for(uint32 i = 0; i < 256; i++)
+			{
+				for(unsigned int slice = 1; slice < 8; slice++)
+				{
+					uint32 crc = m_slices[slice - 1][i];
+					m_slices[slice][i] = (crc >> 8) ^ m_slices[0][crc & 0xFF];
+				}
+			}
+
+			//x^(8 * INTERLEAVE_SIZE), starting from x^0 and squaring x^8
+			uint32 shift = 0x80000000;
+			uint32 power = 0x00800000;
+			for(size_t size = INTERLEAVE_SIZE; size != 0; size >>= 1)
+			{
+				if(size & 1)
+				{
+					shift = MultiplyModP(shift, power, polynomial);
+				}
+				power = MultiplyModP(power, power, polynomial);
+			}
+			for(unsigned int part = 0; part < 4; part++)
+			{
+				for(uint32 i = 0; i < 256; i++)
+				{
+					m_interleaveShift[part][i] = MultiplyModP(i << (part * 8), shift, polynomial);
+				}
+			}
+		}
+
+		uint32 Update(uint32 crc, const uint8* data, size_t size) const
+		{
+			for(; size >= 8; size -= 8, data += 8)
+			{
+				uint32 low = crc ^ (static_cast<uint32>(data[0]) | (static_cast<uint32>(data[1]) << 8) |
+				                    (static_cast<uint32>(data[2]) << 16) | (static_cast<uint32>(data[3]) << 24));
+				crc = m_slices[7][low & 0xFF] ^ m_slices[6][(low >> 8) & 0xFF] ^
+				      m_slices[5][(low >> 16) & 0xFF] ^ m_slices[4][low >> 24] ^
+				      m_slices[3][data[4]] ^ m_slices[2][data[5]] ^
+				      m_slices[1][data[6]] ^ m_slices[0][data[7]];
+			}
+			for(; size != 0; size--, data++)
+			{
+				crc = (crc >> 8) ^ m_slices[0][(crc ^ *data) & 0xFF];
+			}
+			return crc;
+		}
+
+		//Gives the register after INTERLEAVE_SIZE zero bytes
+		uint32 ShiftInterleave(uint32 crc) const
+		{
+			return m_interleaveShift[0][crc & 0xFF] ^ m_interleaveShift[1][(crc >> 8) & 0xFF] ^
+			       m_interleaveShift[2][(crc >> 16) & 0xFF] ^ m_interleaveShift[3][crc >> 24];
+		}
+
+	private:
+		uint32 m_slices[8][256];
+		uint32 m_interleaveShift[4][256];
+	};
+
+	const CCrcTables g_crc32Tables(CRC32_POLYNOMIAL);
+	const CCrcTables g_crc32cTables(CRC32C_POLYNOMIAL);
+
+	uint32 Crc32Scalar(uint32 crc, const uint8* data, size_t size)
+	{
+		return g_crc32Tables.Update(crc, data, size);
+	}
+
+	uint32 Crc32cScalar(uint32 crc, const uint8* data, size_t size)
+	{
+		return g_crc32cTables.Update(crc, data, size);
+	}
+
+	inline uint64 Read64(const uint8* data)
+	{
+		uint64 value;
+		memcpy(&value, data, sizeof(value));
+		return value;
+	}
+
+#if defined(FRAMEWORK_SIMD_HAS_X86_DISPATCH)
+	//CRC instructions have a latency of 3 cycles but can start every cycle, three parts of the
+	//buffer are done at the same time and their results combined
+	FRAMEWORK_SIMD_TARGET_SSE42 uint32 Crc32cSse42(uint32 crc, const uint8* data, size_t size)
+	{
+#if defined(__x86_64__) || defined(_M_X64)
+		for(; size >= (INTERLEAVE_SIZE * 3); size -= (INTERLEAVE_SIZE * 3), data += (INTERLEAVE_SIZE * 3))
+		{
+			uint64 crc0 = crc;
+			uint64 crc1 = 0;
+			uint64 crc2 = 0;
+			for(size_t i = 0; i < INTERLEAVE_SIZE; i += 8)
+			{
+				crc0 = _mm_crc32_u64(crc0, Read64(data + i));
+				crc1 = _mm_crc32_u64(crc1, Read64(data + i + INTERLEAVE_SIZE));
+				crc2 = _mm_crc32_u64(crc2, Read64(data + i + (INTERLEAVE_SIZE * 2)));
+			}
+			crc = g_crc32cTables.ShiftInterleave(g_crc32cTables.ShiftInterleave(static_cast<uint32>(crc0)) ^ static_cast<uint32>(crc1)) ^ static_cast<uint32>(crc2);
+		}
+		for(; size >= 8; size -= 8, data += 8)
+		{
+			crc = static_cast<uint32>(_mm_crc32_u64(crc, Read64(data)));
+		}
+#endif
+		for(; size >= 4; size -= 4, data += 4)
+		{
+			uint32 value;
+			memcpy(&value, data, 4);
+			crc = _mm_crc32_u32(crc, value);
+		}
+		for(; size != 0; size--, data++)
+		{
+			crc = _mm_crc32_u8(crc, *data);
+		}
+		return crc;
+	}
+
+	//Folds 64 bytes at a time with carry-less multiplications, see Intel's "Fast CRC Computation for
+	//Generic Polynomials Using PCLMULQDQ Instruction". Constants are for the CRC-32 polynomial.
+	FRAMEWORK_SIMD_TARGET_PCLMUL uint32 Crc32Pclmul(uint32 crc, const uint8* data, size_t size)
+	{
+		if(size < 64)
+		{
+			return Crc32Scalar(crc, data, size);
+		}
+
+		const __m128i k1k2 = _mm_set_epi64x(0x01C6E41596, 0x0154442BD4);
+		const __m128i k3k4 = _mm_set_epi64x(0x00CCAA009E, 0x01751997D0);
+		const __m128i k5k0 = _mm_set_epi64x(0x0000000000, 0x0163CD6124);
+		const __m128i polynomial = _mm_set_epi64x(0x01F7011641, 0x01DB710641);
+		const __m128i mask32 = _mm_setr_epi32(~0, 0, ~0, 0);
+
+		__m128i x1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 0x00));
+		__m128i x2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 0x10));
+		__m128i x3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 0x20));
+		__m128i x4 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 0x30));
+		x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(static_cast<int>(crc)));
+		data += 64;
+		size -= 64;
+
+		for(; size >= 64; size -= 64, data += 64)
+		{
+			__m128i x5 = _mm_clmulepi64_si128(x1, k1k2, 0x00);
+			__m128i x6 = _mm_clmulepi64_si128(x2, k1k2, 0x00);
+			__m128i x7 = _mm_clmulepi64_si128(x3, k1k2, 0x00);
+			__m128i x8 = _mm_clmulepi64_si128(x4, k1k2, 0x00);
+			x1 = _mm_clmulepi64_si128(x1, k1k2, 0x11);
+			x2 = _mm_clmulepi64_si128(x2, k1k2, 0x11);
+			x3 = _mm_clmulepi64_si128(x3, k1k2, 0x11);
+			x4 = _mm_clmulepi64_si128(x4, k1k2, 0x11);
+			x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 0x00)));
+			x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 0x10)));
+			x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 0x20)));
+			x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 0x30)));
+		}
+
+		//Fold the 4 values into one, then the remaining 16 byte blocks
+		x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x11), _mm_clmulepi64_si128(x1, k3k4, 0x00)), x2);
+		x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x11), _mm_clmulepi64_si128(x1, k3k4, 0x00)), x3);
+		x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x11), _mm_clmulepi64_si128(x1, k3k4, 0x00)), x4);
+		for(; size >= 16; size -= 16, data += 16)
+		{
+			__m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+			x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x11), _mm_clmulepi64_si128(x1, k3k4, 0x00)), value);
+		}
+
+		//Fold 128 bits to 64 bits
+		x2 = _mm_clmulepi64_si128(x1, k3k4, 0x10);
+		x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+		x2 = _mm_srli_si128(x1, 4);
+		x1 = _mm_and_si128(x1, mask32);
+		x1 = _mm_xor_si128(_mm_clmulepi64_si128(x1, k5k0, 0x00), x2);
+
+		//Barrett reduction to 32 bits
+		x2 = _mm_and_si128(x1, mask32);
+		x2 = _mm_clmulepi64_si128(x2, polynomial, 0x10);
+		x2 = _mm_and_si128(x2, mask32);
+		x2 = _mm_clmulepi64_si128(x2, polynomial, 0x00);
+		x1 = _mm_xor_si128(x1, x2);
+		crc = static_cast<uint32>(_mm_extract_epi32(x1, 1));
+
+		return Crc32Scalar(crc, data, size);
+	}
+#elif defined(FRAMEWORK_SIMD_HAS_ARM_CRC32)
+	FRAMEWORK_SIMD_TARGET_ARM_CRC32 inline uint32 Crc32Step64(uint32 crc, uint64 value)
+	{
+		return __crc32d(crc, value);
+	}
+
+	FRAMEWORK_SIMD_TARGET_ARM_CRC32 inline uint32 Crc32Step8(uint32 crc, uint8 value)
+	{
+		return __crc32b(crc, value);
+	}
+
+	FRAMEWORK_SIMD_TARGET_ARM_CRC32 inline uint32 Crc32cStep64(uint32 crc, uint64 value)
+	{
+		return __crc32cd(crc, value);
+	}
+
+	FRAMEWORK_SIMD_TARGET_ARM_CRC32 inline uint32 Crc32cStep8(uint32 crc, uint8 value)
+	{
+		return __crc32cb(crc, value);
+	}
+
+	//CRC instructions have a latency of 2 or 3 cycles but can start every cycle, three parts of the
+	//buffer are done at the same time and their results combined
+	template <uint32 (*Step64)(uint32, uint64), uint32 (*Step8)(uint32, uint8)>
+	FRAMEWORK_SIMD_TARGET_ARM_CRC32 uint32 UpdateArm(const CCrcTables& tables, uint32 crc, const uint8* data, size_t size)
+	{
+		for(; size >= (INTERLEAVE_SIZE * 3); size -= (INTERLEAVE_SIZE * 3), data += (INTERLEAVE_SIZE * 3))
+		{
+			uint32 crc0 = crc;
+			uint32 crc1 = 0;
+			uint32 crc2 = 0;
+			for(size_t i = 0; i < INTERLEAVE_SIZE; i += 8)
+			{
+				crc0 = Step64(crc0, Read64(data + i));
+				crc1 = Step64(crc1, Read64(data + i + INTERLEAVE_SIZE));
+				crc2 = Step64(crc2, Read64(data + i + (INTERLEAVE_SIZE * 2)));
+			}
+			crc = tables.ShiftInterleave(tables.ShiftInterleave(crc0) ^ crc1) ^ crc2;
+		}
+		for(; size >= 8; size -= 8, data += 8)
+		{
+			crc = Step64(crc, Read64(data));
+		}
+		for(; size != 0; size--, data++)
+		{
+			crc = Step8(crc, *data);
+		}
+		return crc;
+	}
+
+	uint32 Crc32Arm(uint32 crc, const uint8* data, size_t size)
+	{
+		return UpdateArm<&Crc32Step64, &Crc32Step8>(g_crc32Tables, crc, data, size);
+	}
+
+	uint32 Crc32cArm(uint32 crc, const uint8* data, size_t size)
+	{
+		return UpdateArm<&Crc32cStep64, &Crc32cStep8>(g_crc32cTables, crc, data, size);
+	}
+#endif
+
+	CKernelDispatcher<CrcFunction> CreateCrc32Dispatcher()
+	{
+		CKernelDispatcher<CrcFunction> dispatcher(&Crc32Scalar);
+#if defined(FRAMEWORK_SIMD_HAS_X86_DISPATCH)
+		dispatcher.Register(CCpuFeatures::FEATURE_SSE41 | CCpuFeatures::FEATURE_PCLMUL, &Crc32Pclmul);
+#elif defined(FRAMEWORK_SIMD_HAS_ARM_CRC32)
+		dispatcher.Register(CCpuFeatures::FEATURE_ARM_CRC32, &Crc32Arm);
+#endif
+		return dispatcher;
+	}
+
+	CKernelDispatcher<CrcFunction> CreateCrc32cDispatcher()
+	{
+		CKernelDispatcher<CrcFunction> dispatcher(&Crc32cScalar);
+#if defined(FRAMEWORK_SIMD_HAS_X86_DISPATCH)
+		dispatcher.Register(CCpuFeatures::FEATURE_SSE42, &Crc32cSse42);
+#elif defined(FRAMEWORK_SIMD_HAS_ARM_CRC32)
+		dispatcher.Register(CCpuFeatures::FEATURE_ARM_CRC32, &Crc32cArm);
+#endif
+		return dispatcher;
+	}
+
+	const CKernelDispatcher<CrcFunction> g_crc32Dispatcher = CreateCrc32Dispatcher();
+	const CKernelDispatcher<CrcFunction> g_crc32cDispatcher = CreateCrc32cDispatcher();
+}
+
+uint32 Framework::HashUtils::ComputeCrc32(const void* data, size_t size, uint32 crc)
+{
+	return ~g_crc32Dispatcher.Get()(~crc, reinterpret_cast<const uint8*>(data), size);
+}
+
+uint32 Framework::HashUtils::ComputeCrc32c(const void* data, size_t size, uint32 crc)
+{
+	return ~g_crc32cDispatcher.Get()(~crc, reinterpret_cast<const uint8*>(data), size);
+}
@@ -0,0 +1,106 @@
+#include "HashUtils.h"
+#include <cstring>
+
+using namespace Framework;
+
+namespace
+{
+	inline uint32 RotateLeft(uint32 value, unsigned int amount)
+	{
+		return (value << amount) | (value >> (32 - amount));
+	}
+
+	inline uint32 LoadBigEndian32(const uint8* data)
+	{
+		return (static_cast<uint32>(data[0]) << 24) | (static_cast<uint32>(data[1]) << 16) |
+		       (static_cast<uint32>(data[2]) << 8) | static_cast<uint32>(data[3]);
+	}
+
+	void Sha1Block(uint32* state, const uint8* data)
+	{
+		uint32 w[80];
+		for(unsigned int i = 0; i < 16; i++)
+		{
+			w[i] = LoadBigEndian32(data + (i * 4));
+		}
+		for(unsigned int i = 16; i < 80; i++)
+		{
+			w[i] = RotateLeft(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+		}
+
+		uint32 a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+		for(unsigned int i = 0; i < 80; i++)
+		{
+			uint32 f = 0, k = 0;
+			if(i < 20)
+			{
+				f = (b & c) | (~b & d);
+				k = 0x5A827999;
+			}
+			else if(i < 40)
+			{
+				f = b ^ c ^ d;
+				k = 0x6ED9EBA1;
+			}
+			else if(i < 60)
+			{
+				f = (b & c) | (b & d) | (c & d);
+				k = 0x8F1BBCDC;
+			}
+			else
+			{
+				f = b ^ c ^ d;
+				k = 0xCA62C1D6;
+			}
+			uint32 temp = RotateLeft(a, 5) + f + e + k + w[i];
+			e = d;
+			d = c;
+			c = RotateLeft(b, 30);
+			b = a;
+			a = temp;
+		}
+		state[0] += a;
+		state[1] += b;
+		state[2] += c;
+		state[3] += d;
+		state[4] += e;
+	}
+}
+
+//Only short inputs are expected (ie.: WebSocket handshakes), a plain implementation is enough
+std::array<uint8, 0x14> Framework::HashUtils::ComputeSha1(const void* data, size_t dataSize)
+{
+	uint32 state[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+	auto input = reinterpret_cast<const uint8*>(data);
+	size_t remainingSize = dataSize;
+	while(remainingSize >= 64)
+	{
+		Sha1Block(state, input);
+		input += 64;
+		remainingSize -= 64;
+	}
+
+	uint8 lastBlocks[128] = {};
+	memcpy(lastBlocks, input, remainingSize);
+	lastBlocks[remainingSize] = 0x80;
+	size_t lastSize = (remainingSize < 56) ? 64 : 128;
+	uint64 bitSize = static_cast<uint64>(dataSize) * 8;
+	for(unsigned int i = 0; i < 8; i++)
+	{
+		lastBlocks[lastSize - 1 - i] = static_cast<uint8>(bitSize >> (i * 8));
+	}
+	for(size_t offset = 0; offset < lastSize; offset += 64)
+	{
+		Sha1Block(state, lastBlocks + offset);
+	}
+
+	std::array<uint8, 0x14> result;
+	for(unsigned int i = 0; i < 5; i++)
+	{
+		result[(i * 4) + 0] = static_cast<uint8>(state[i] >> 24);
+		result[(i * 4) + 1] = static_cast<uint8>(state[i] >> 16);
+		result[(i * 4) + 2] = static_cast<uint8>(state[i] >> 8);
+		result[(i * 4) + 3] = static_cast<uint8>(state[i]);
+	}
+	return result;
+}
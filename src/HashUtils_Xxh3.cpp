@@ -0,0 +1,642 @@
+#include "HashUtils.h"
+#include <algorithm>
+#include <cstring>
+#include "CpuFeatures.h"
+#include "SimdDefs.h"
+
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+#include <emmintrin.h>
+#if defined(FRAMEWORK_SIMD_HAS_X86_DISPATCH)
+#include <immintrin.h>
+#endif
+#elif defined(FRAMEWORK_SIMD_USE_NEON) && !defined(__EMSCRIPTEN__)
+#include <arm_neon.h>
+#endif
+
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#endif
+
+//Port of XXH3 from xxHash 0.8 (https://github.com/Cyan4973/xxHash), only with the default secret.
+//Results are for little endian platforms, the only ones we support.
+
+using namespace Framework;
+using namespace Framework::HashUtils;
+
+namespace
+{
+	//Accumulates stripes of 64 bytes, moving 8 bytes forward in the secret for each stripe
+	typedef void (*Xxh3AccumulateFunction)(uint64*, const uint8*, const uint8*, size_t);
+
+	enum
+	{
+		STRIPE_SIZE = 64,
+		SECRET_SIZE = 192,
+		SECRET_CONSUME_RATE = 8,
+		BLOCK_STRIPE_COUNT = (SECRET_SIZE - STRIPE_SIZE) / SECRET_CONSUME_RATE,
+		SECRET_LASTACC_START = 7,
+		SECRET_MERGEACCS_START = 11,
+		SECRET_SIZE_MIN = 136,
+		MIDSIZE_MAX = 240,
+		MIDSIZE_STARTOFFSET = 3,
+		MIDSIZE_LASTOFFSET = 17,
+	};
+
+	const uint32 PRIME32_1 = 0x9E3779B1U;
+	const uint32 PRIME32_2 = 0x85EBCA77U;
+	const uint32 PRIME32_3 = 0xC2B2AE3DU;
+	const uint64 PRIME64_1 = 0x9E3779B185EBCA87ULL;
+	const uint64 PRIME64_2 = 0xC2B2AE3D27D4EB4FULL;
+	const uint64 PRIME64_3 = 0x165667B19E3779F9ULL;
+	const uint64 PRIME64_4 = 0x85EBCA77C2B2AE63ULL;
+	const uint64 PRIME64_5 = 0x27D4EB2F165667C5ULL;
+	const uint64 PRIME_MX1 = 0x165667919E3779F9ULL;
+	const uint64 PRIME_MX2 = 0x9FB21C651E98DF25ULL;
+
+	const uint64 g_initialAcc[8] =
+	{
+		PRIME32_3, PRIME64_1, PRIME64_2, PRIME64_3, PRIME64_4, PRIME32_2, PRIME64_5, PRIME32_1
+	};
+
+	alignas(64) const uint8 g_defaultSecret[SECRET_SIZE] =
+	{
+		0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c, 0xf7, 0x21, 0xad, 0x1c,
+		0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb, 0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f,
+		0xcb, 0x79, 0xe6, 0x4e, 0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+		0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0, 0x35, 0x90, 0xe6, 0x81, 0x3a, 0x26, 0x4c,
+		0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb, 0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3,
+		0x71, 0x64, 0x48, 0x97, 0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+		0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7, 0xc7, 0x0b, 0x4f, 0x1d,
+		0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31, 0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64,
+		0xea, 0xc5, 0xac, 0x83, 0x34, 0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+		0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49, 0xd3, 0x16, 0x55, 0x26, 0x29, 0xd4, 0x68, 0x9e,
+		0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc, 0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce,
+		0x45, 0xcb, 0x3a, 0x8f, 0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e,
+	};
+
+	inline uint32 Read32(const uint8* data)
+	{
+		uint32 value;
+		memcpy(&value, data, sizeof(value));
+		return value;
+	}
+
+	inline uint64 Read64(const uint8* data)
+	{
+		uint64 value;
+		memcpy(&value, data, sizeof(value));
+		return value;
+	}
+
+	inline void Write64(uint8* data, uint64 value)
+	{
+		memcpy(data, &value, sizeof(value));
+	}
+
+	inline uint32 Swap32(uint32 value)
+	{
+		return ((value << 24) & 0xFF000000) | ((value << 8) & 0x00FF0000) |
+		       ((value >> 8) & 0x0000FF00) | ((value >> 24) & 0x000000FF);
+	}
+
+	inline uint64 Swap64(uint64 value)
+	{
+		return (static_cast<uint64>(Swap32(static_cast<uint32>(value))) << 32) | Swap32(static_cast<uint32>(value >> 32));
+	}
+
+	inline uint32 RotateLeft32(uint32 value, unsigned int amount)
+	{
+		return (value << amount) | (value >> (32 - amount));
+	}
+
+	inline uint64 RotateLeft64(uint64 value, unsigned int amount)
+	{
+		return (value << amount) | (value >> (64 - amount));
+	}
+
+	inline HASH128 Multiply64To128(uint64 lhs, uint64 rhs)
+	{
+		HASH128 result;
+#if defined(__SIZEOF_INT128__)
+		unsigned __int128 product = static_cast<unsigned __int128>(lhs) * rhs;
+		result.low = static_cast<uint64>(product);
+		result.high = static_cast<uint64>(product >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+		result.low = _umul128(lhs, rhs, &result.high);
+#else
+		uint64 loLo = (lhs & 0xFFFFFFFF) * (rhs & 0xFFFFFFFF);
+		uint64 hiLo = (lhs >> 32) * (rhs & 0xFFFFFFFF);
+		uint64 loHi = (lhs & 0xFFFFFFFF) * (rhs >> 32);
+		uint64 hiHi = (lhs >> 32) * (rhs >> 32);
+		uint64 cross = (loLo >> 32) + (hiLo & 0xFFFFFFFF) + loHi;
+		result.low = (cross << 32) | (loLo & 0xFFFFFFFF);
+		result.high = (hiLo >> 32) + (cross >> 32) + hiHi;
+#endif
+		return result;
+	}
+
+	inline uint64 Multiply128Fold64(uint64 lhs, uint64 rhs)
+	{
+		HASH128 product = Multiply64To128(lhs, rhs);
+		return product.low ^ product.high;
+	}
+
+	inline uint64 Xxh64Avalanche(uint64 hash)
+	{
+		hash ^= hash >> 33;
+		hash *= PRIME64_2;
+		hash ^= hash >> 29;
+		hash *= PRIME64_3;
+		hash ^= hash >> 32;
+		return hash;
+	}
+
+	inline uint64 Avalanche(uint64 hash)
+	{
+		hash ^= hash >> 37;
+		hash *= PRIME_MX1;
+		hash ^= hash >> 32;
+		return hash;
+	}
+
+	inline uint64 Rrmxmx(uint64 hash, uint64 size)
+	{
+		hash ^= RotateLeft64(hash, 49) ^ RotateLeft64(hash, 24);
+		hash *= PRIME_MX2;
+		hash ^= (hash >> 35) + size;
+		hash *= PRIME_MX2;
+		return hash ^ (hash >> 28);
+	}
+
+	inline uint64 Mix16(const uint8* input, const uint8* secret, uint64 seed)
+	{
+		return Multiply128Fold64(Read64(input) ^ (Read64(secret) + seed), Read64(input + 8) ^ (Read64(secret + 8) - seed));
+	}
+
+	inline HASH128 Mix32(HASH128 acc, const uint8* input1, const uint8* input2, const uint8* secret, uint64 seed)
+	{
+		acc.low += Mix16(input1, secret, seed);
+		acc.low ^= Read64(input2) + Read64(input2 + 8);
+		acc.high += Mix16(input2, secret + 16, seed);
+		acc.high ^= Read64(input1) + Read64(input1 + 8);
+		return acc;
+	}
+
+	void InitSecret(uint8* secret, uint64 seed)
+	{
+		for(unsigned int i = 0; i < SECRET_SIZE; i += 16)
+		{
+			Write64(secret + i, Read64(g_defaultSecret + i) + seed);
+			Write64(secret + i + 8, Read64(g_defaultSecret + i + 8) - seed);
+		}
+	}
+
+	void AccumulateScalar(uint64* acc, const uint8* input, const uint8* secret, size_t stripeCount)
+	{
+		for(size_t stripe = 0; stripe < stripeCount; stripe++, input += STRIPE_SIZE, secret += SECRET_CONSUME_RATE)
+		{
+			for(unsigned int lane = 0; lane < 8; lane++)
+			{
+				uint64 value = Read64(input + lane * 8);
+				uint64 key = value ^ Read64(secret + lane * 8);
+				acc[lane ^ 1] += value;
+				acc[lane] += (key & 0xFFFFFFFF) * (key >> 32);
+			}
+		}
+	}
+
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+	void AccumulateSse2(uint64* acc, const uint8* input, const uint8* secret, size_t stripeCount)
+	{
+		__m128i accs[4];
+		for(unsigned int i = 0; i < 4; i++)
+		{
+			accs[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(acc) + i);
+		}
+		for(size_t stripe = 0; stripe < stripeCount; stripe++, input += STRIPE_SIZE, secret += SECRET_CONSUME_RATE)
+		{
+			for(unsigned int i = 0; i < 4; i++)
+			{
+				__m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input) + i);
+				__m128i key = _mm_xor_si128(value, _mm_loadu_si128(reinterpret_cast<const __m128i*>(secret) + i));
+				__m128i product = _mm_mul_epu32(key, _mm_shuffle_epi32(key, _MM_SHUFFLE(0, 3, 0, 1)));
+				__m128i swapped = _mm_shuffle_epi32(value, _MM_SHUFFLE(1, 0, 3, 2));
+				accs[i] = _mm_add_epi64(accs[i], _mm_add_epi64(product, swapped));
+			}
+		}
+		for(unsigned int i = 0; i < 4; i++)
+		{
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(acc) + i, accs[i]);
+		}
+	}
+
+#if defined(FRAMEWORK_SIMD_HAS_X86_DISPATCH)
+	FRAMEWORK_SIMD_TARGET_AVX2 void AccumulateAvx2(uint64* acc, const uint8* input, const uint8* secret, size_t stripeCount)
+	{
+		__m256i accs[2];
+		for(unsigned int i = 0; i < 2; i++)
+		{
+			accs[i] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(acc) + i);
+		}
+		for(size_t stripe = 0; stripe < stripeCount; stripe++, input += STRIPE_SIZE, secret += SECRET_CONSUME_RATE)
+		{
+			for(unsigned int i = 0; i < 2; i++)
+			{
+				__m256i value = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input) + i);
+				__m256i key = _mm256_xor_si256(value, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(secret) + i));
+				__m256i product = _mm256_mul_epu32(key, _mm256_shuffle_epi32(key, _MM_SHUFFLE(0, 3, 0, 1)));
+				__m256i swapped = _mm256_shuffle_epi32(value, _MM_SHUFFLE(1, 0, 3, 2));
+				accs[i] = _mm256_add_epi64(accs[i], _mm256_add_epi64(product, swapped));
+			}
+		}
+		for(unsigned int i = 0; i < 2; i++)
+		{
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(acc) + i, accs[i]);
+		}
+	}
+#endif
+#elif defined(FRAMEWORK_SIMD_USE_NEON) && !defined(__EMSCRIPTEN__)
+	void AccumulateNeon(uint64* acc, const uint8* input, const uint8* secret, size_t stripeCount)
+	{
+		uint64x2_t accs[4];
+		for(unsigned int i = 0; i < 4; i++)
+		{
+			accs[i] = vld1q_u64(acc + (i * 2));
+		}
+		for(size_t stripe = 0; stripe < stripeCount; stripe++, input += STRIPE_SIZE, secret += SECRET_CONSUME_RATE)
+		{
+			for(unsigned int i = 0; i < 4; i++)
+			{
+				uint64x2_t value = vreinterpretq_u64_u8(vld1q_u8(input + (i * 16)));
+				uint64x2_t key = veorq_u64(value, vreinterpretq_u64_u8(vld1q_u8(secret + (i * 16))));
+				accs[i] = vaddq_u64(accs[i], vextq_u64(value, value, 1));
+				accs[i] = vmlal_u32(accs[i], vmovn_u64(key), vshrn_n_u64(key, 32));
+			}
+		}
+		for(unsigned int i = 0; i < 4; i++)
+		{
+			vst1q_u64(acc + (i * 2), accs[i]);
+		}
+	}
+#endif
+
+	//Only done once every 1KB of input, not worth vectorizing
+	void Scramble(uint64* acc, const uint8* secret)
+	{
+		for(unsigned int lane = 0; lane < 8; lane++)
+		{
+			uint64 value = acc[lane];
+			value ^= value >> 47;
+			value ^= Read64(secret + lane * 8);
+			acc[lane] = value * PRIME32_1;
+		}
+	}
+
+	CKernelDispatcher<Xxh3AccumulateFunction> CreateXxh3Dispatcher()
+	{
+		CKernelDispatcher<Xxh3AccumulateFunction> dispatcher(&AccumulateScalar);
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+		dispatcher.Register(CCpuFeatures::FEATURE_SSE2, &AccumulateSse2);
+#if defined(FRAMEWORK_SIMD_HAS_X86_DISPATCH)
+		dispatcher.Register(CCpuFeatures::FEATURE_AVX2, &AccumulateAvx2);
+#endif
+#elif defined(FRAMEWORK_SIMD_USE_NEON) && !defined(__EMSCRIPTEN__)
+		dispatcher.Register(CCpuFeatures::FEATURE_NEON, &AccumulateNeon);
+#endif
+		return dispatcher;
+	}
+
+	const CKernelDispatcher<Xxh3AccumulateFunction> g_xxh3Dispatcher = CreateXxh3Dispatcher();
+
+	void ConsumeStripes(uint64* acc, size_t& stripesSoFar, const uint8* input, size_t stripeCount, const uint8* secret)
+	{
+		auto accumulate = g_xxh3Dispatcher.Get();
+		while(stripeCount != 0)
+		{
+			size_t blockStripeCount = std::min<size_t>(BLOCK_STRIPE_COUNT - stripesSoFar, stripeCount);
+			accumulate(acc, input, secret + (stripesSoFar * SECRET_CONSUME_RATE), blockStripeCount);
+			input += blockStripeCount * STRIPE_SIZE;
+			stripeCount -= blockStripeCount;
+			stripesSoFar += blockStripeCount;
+			if(stripesSoFar == BLOCK_STRIPE_COUNT)
+			{
+				Scramble(acc, secret + SECRET_SIZE - STRIPE_SIZE);
+				stripesSoFar = 0;
+			}
+		}
+	}
+
+	//Input is over MIDSIZE_MAX bytes, so there's always a full last stripe
+	void HashLong(uint64* acc, const uint8* input, size_t size, const uint8* secret)
+	{
+		memcpy(acc, g_initialAcc, sizeof(g_initialAcc));
+		size_t stripesSoFar = 0;
+		ConsumeStripes(acc, stripesSoFar, input, (size - 1) / STRIPE_SIZE, secret);
+		g_xxh3Dispatcher.Get()(acc, input + size - STRIPE_SIZE, secret + SECRET_SIZE - STRIPE_SIZE - SECRET_LASTACC_START, 1);
+	}
+
+	uint64 MergeAccs(const uint64* acc, const uint8* secret, uint64 start)
+	{
+		uint64 result = start;
+		for(unsigned int i = 0; i < 4; i++)
+		{
+			result += Multiply128Fold64(acc[i * 2] ^ Read64(secret + (i * 16)), acc[(i * 2) + 1] ^ Read64(secret + (i * 16) + 8));
+		}
+		return Avalanche(result);
+	}
+
+	uint64 Merge64(const uint64* acc, const uint8* secret, uint64 size)
+	{
+		return MergeAccs(acc, secret + SECRET_MERGEACCS_START, size * PRIME64_1);
+	}
+
+	HASH128 Merge128(const uint64* acc, const uint8* secret, uint64 size)
+	{
+		HASH128 result;
+		result.low = MergeAccs(acc, secret + SECRET_MERGEACCS_START, size * PRIME64_1);
+		result.high = MergeAccs(acc, secret + SECRET_SIZE - STRIPE_SIZE - SECRET_MERGEACCS_START, ~(size * PRIME64_2));
+		return result;
+	}
+
+	uint64 HashShort64(const uint8* input, size_t size, const uint8* secret, uint64 seed)
+	{
+		if(size > 16)
+		{
+			uint64 acc = size * PRIME64_1;
+			if(size <= 128)
+			{
+				if(size > 32)
+				{
+					if(size > 64)
+					{
+						if(size > 96)
+						{
+							acc += Mix16(input + 48, secret + 96, seed);
+							acc += Mix16(input + size - 64, secret + 112, seed);
+						}
+						acc += Mix16(input + 32, secret + 64, seed);
+						acc += Mix16(input + size - 48, secret + 80, seed);
+					}
+					acc += Mix16(input + 16, secret + 32, seed);
+					acc += Mix16(input + size - 32, secret + 48, seed);
+				}
+				acc += Mix16(input, secret, seed);
+				acc += Mix16(input + size - 16, secret + 16, seed);
+				return Avalanche(acc);
+			}
+			unsigned int roundCount = static_cast<unsigned int>(size / 16);
+			for(unsigned int i = 0; i < 8; i++)
+			{
+				acc += Mix16(input + (16 * i), secret + (16 * i), seed);
+			}
+			uint64 accEnd = Mix16(input + size - 16, secret + SECRET_SIZE_MIN - MIDSIZE_LASTOFFSET, seed);
+			acc = Avalanche(acc);
+			for(unsigned int i = 8; i < roundCount; i++)
+			{
+				accEnd += Mix16(input + (16 * i), secret + (16 * (i - 8)) + MIDSIZE_STARTOFFSET, seed);
+			}
+			return Avalanche(acc + accEnd);
+		}
+		if(size > 8)
+		{
+			uint64 bitflip1 = (Read64(secret + 24) ^ Read64(secret + 32)) + seed;
+			uint64 bitflip2 = (Read64(secret + 40) ^ Read64(secret + 48)) - seed;
+			uint64 inputLow = Read64(input) ^ bitflip1;
+			uint64 inputHigh = Read64(input + size - 8) ^ bitflip2;
+			uint64 acc = size + Swap64(inputLow) + inputHigh + Multiply128Fold64(inputLow, inputHigh);
+			return Avalanche(acc);
+		}
+		if(size >= 4)
+		{
+			seed ^= static_cast<uint64>(Swap32(static_cast<uint32>(seed))) << 32;
+			uint32 input1 = Read32(input);
+			uint32 input2 = Read32(input + size - 4);
+			uint64 bitflip = (Read64(secret + 8) ^ Read64(secret + 16)) - seed;
+			uint64 input64 = input2 + (static_cast<uint64>(input1) << 32);
+			return Rrmxmx(input64 ^ bitflip, size);
+		}
+		if(size != 0)
+		{
+			uint32 combined = (static_cast<uint32>(input[0]) << 16) | (static_cast<uint32>(input[size >> 1]) << 24) |
+			                  static_cast<uint32>(input[size - 1]) | (static_cast<uint32>(size) << 8);
+			uint64 bitflip = (Read32(secret) ^ Read32(secret + 4)) + seed;
+			return Xxh64Avalanche(combined ^ bitflip);
+		}
+		return Xxh64Avalanche(seed ^ (Read64(secret + 56) ^ Read64(secret + 64)));
+	}
+
+	HASH128 FinalizeShort128(HASH128 acc, size_t size, uint64 seed)
+	{
+		HASH128 result;
+		result.low = Avalanche(acc.low + acc.high);
+		result.high = 0 - Avalanche((acc.low * PRIME64_1) + (acc.high * PRIME64_4) + ((size - seed) * PRIME64_2));
+		return result;
+	}
+
+	HASH128 HashShort128(const uint8* input, size_t size, const uint8* secret, uint64 seed)
+	{
+		if(size > 16)
+		{
+			HASH128 acc;
+			acc.low = size * PRIME64_1;
+			if(size <= 128)
+			{
+				if(size > 32)
+				{
+					if(size > 64)
+					{
+						if(size > 96)
+						{
+							acc = Mix32(acc, input + 48, input + size - 64, secret + 96, seed);
+						}
+						acc = Mix32(acc, input + 32, input + size - 48, secret + 64, seed);
+					}
+					acc = Mix32(acc, input + 16, input + size - 32, secret + 32, seed);
+				}
+				acc = Mix32(acc, input, input + size - 16, secret, seed);
+				return FinalizeShort128(acc, size, seed);
+			}
+			for(size_t i = 32; i < 160; i += 32)
+			{
+				acc = Mix32(acc, input + i - 32, input + i - 16, secret + i - 32, seed);
+			}
+			acc.low = Avalanche(acc.low);
+			acc.high = Avalanche(acc.high);
+			for(size_t i = 160; i <= size; i += 32)
+			{
+				acc = Mix32(acc, input + i - 32, input + i - 16, secret + MIDSIZE_STARTOFFSET + i - 160, seed);
+			}
+			acc = Mix32(acc, input + size - 16, input + size - 32, secret + SECRET_SIZE_MIN - MIDSIZE_LASTOFFSET - 16, 0 - seed);
+			return FinalizeShort128(acc, size, seed);
+		}
+		if(size > 8)
+		{
+			uint64 bitflipLow = (Read64(secret + 32) ^ Read64(secret + 40)) - seed;
+			uint64 bitflipHigh = (Read64(secret + 48) ^ Read64(secret + 56)) + seed;
+			uint64 inputLow = Read64(input);
+			uint64 inputHigh = Read64(input + size - 8);
+			HASH128 mix = Multiply64To128(inputLow ^ inputHigh ^ bitflipLow, PRIME64_1);
+			mix.low += static_cast<uint64>(size - 1) << 54;
+			inputHigh ^= bitflipHigh;
+			mix.high += inputHigh + ((inputHigh & 0xFFFFFFFF) * (PRIME32_2 - 1));
+			mix.low ^= Swap64(mix.high);
+			HASH128 result = Multiply64To128(mix.low, PRIME64_2);
+			result.high += mix.high * PRIME64_2;
+			result.low = Avalanche(result.low);
+			result.high = Avalanche(result.high);
+			return result;
+		}
+		if(size >= 4)
+		{
+			seed ^= static_cast<uint64>(Swap32(static_cast<uint32>(seed))) << 32;
+			uint32 inputLow = Read32(input);
+			uint32 inputHigh = Read32(input + size - 4);
+			uint64 input64 = inputLow + (static_cast<uint64>(inputHigh) << 32);
+			uint64 bitflip = (Read64(secret + 16) ^ Read64(secret + 24)) + seed;
+			HASH128 result = Multiply64To128(input64 ^ bitflip, PRIME64_1 + (size << 2));
+			result.high += result.low << 1;
+			result.low ^= result.high >> 3;
+			result.low ^= result.low >> 35;
+			result.low *= PRIME_MX2;
+			result.low ^= result.low >> 28;
+			result.high = Avalanche(result.high);
+			return result;
+		}
+		HASH128 result;
+		if(size != 0)
+		{
+			uint32 combinedLow = (static_cast<uint32>(input[0]) << 16) | (static_cast<uint32>(input[size >> 1]) << 24) |
+			                     static_cast<uint32>(input[size - 1]) | (static_cast<uint32>(size) << 8);
+			uint32 combinedHigh = RotateLeft32(Swap32(combinedLow), 13);
+			uint64 bitflipLow = (Read32(secret) ^ Read32(secret + 4)) + seed;
+			uint64 bitflipHigh = (Read32(secret + 8) ^ Read32(secret + 12)) - seed;
+			result.low = Xxh64Avalanche(combinedLow ^ bitflipLow);
+			result.high = Xxh64Avalanche(combinedHigh ^ bitflipHigh);
+			return result;
+		}
+		result.low = Xxh64Avalanche(seed ^ (Read64(secret + 64) ^ Read64(secret + 72)));
+		result.high = Xxh64Avalanche(seed ^ (Read64(secret + 80) ^ Read64(secret + 88)));
+		return result;
+	}
+
+	const uint8* GetLongSecret(uint8* customSecret, uint64 seed)
+	{
+		if(seed == 0)
+		{
+			return g_defaultSecret;
+		}
+		InitSecret(customSecret, seed);
+		return customSecret;
+	}
+}
+
+uint64 Framework::HashUtils::ComputeXxh3_64(const void* data, size_t size, uint64 seed)
+{
+	auto input = reinterpret_cast<const uint8*>(data);
+	if(size <= MIDSIZE_MAX)
+	{
+		return HashShort64(input, size, g_defaultSecret, seed);
+	}
+	uint8 customSecret[SECRET_SIZE];
+	auto secret = GetLongSecret(customSecret, seed);
+	uint64 acc[8];
+	HashLong(acc, input, size, secret);
+	return Merge64(acc, secret, size);
+}
+
+HASH128 Framework::HashUtils::ComputeXxh3_128(const void* data, size_t size, uint64 seed)
+{
+	auto input = reinterpret_cast<const uint8*>(data);
+	if(size <= MIDSIZE_MAX)
+	{
+		return HashShort128(input, size, g_defaultSecret, seed);
+	}
+	uint8 customSecret[SECRET_SIZE];
+	auto secret = GetLongSecret(customSecret, seed);
+	uint64 acc[8];
+	HashLong(acc, input, size, secret);
+	return Merge128(acc, secret, size);
+}
+
+CXxh3Hasher::CXxh3Hasher(uint64 seed)
+    : m_seed(seed)
+{
+	memcpy(m_acc, g_initialAcc, sizeof(m_acc));
+	memcpy(m_secret, GetLongSecret(m_secret, seed), SECRET_SIZE);
+}
+
+void CXxh3Hasher::Update(const void* data, size_t size)
+{
+	if(size == 0) return;
+	auto input = reinterpret_cast<const uint8*>(data);
+	m_totalSize += size;
+	if(size <= (BUFFER_SIZE - m_bufferSize))
+	{
+		memcpy(m_buffer + m_bufferSize, input, size);
+		m_bufferSize += size;
+		return;
+	}
+	//Stripes are only consumed once more data is known to follow, the last one is done when digesting
+	if(m_bufferSize != 0)
+	{
+		size_t loadSize = BUFFER_SIZE - m_bufferSize;
+		memcpy(m_buffer + m_bufferSize, input, loadSize);
+		input += loadSize;
+		size -= loadSize;
+		ConsumeStripes(m_acc, m_stripeCount, m_buffer, BUFFER_SIZE / STRIPE_SIZE, m_secret);
+		m_bufferSize = 0;
+	}
+	if(size > BUFFER_SIZE)
+	{
+		size_t stripeCount = (size - 1) / STRIPE_SIZE;
+		ConsumeStripes(m_acc, m_stripeCount, input, stripeCount, m_secret);
+		input += stripeCount * STRIPE_SIZE;
+		size -= stripeCount * STRIPE_SIZE;
+		//Keep the previous stripe, the last stripe can overlap with it when digesting
+		memcpy(m_buffer + BUFFER_SIZE - STRIPE_SIZE, input - STRIPE_SIZE, STRIPE_SIZE);
+	}
+	memcpy(m_buffer, input, size);
+	m_bufferSize = size;
+}
+
+uint64 CXxh3Hasher::GetHash64() const
+{
+	if(m_totalSize <= MIDSIZE_MAX)
+	{
+		return HashShort64(m_buffer, static_cast<size_t>(m_totalSize), g_defaultSecret, m_seed);
+	}
+	uint64 acc[8];
+	DigestLong(acc);
+	return Merge64(acc, m_secret, m_totalSize);
+}
+
+HASH128 CXxh3Hasher::GetHash128() const
+{
+	if(m_totalSize <= MIDSIZE_MAX)
+	{
+		return HashShort128(m_buffer, static_cast<size_t>(m_totalSize), g_defaultSecret, m_seed);
+	}
+	uint64 acc[8];
+	DigestLong(acc);
+	return Merge128(acc, m_secret, m_totalSize);
+}
+
+void CXxh3Hasher::DigestLong(uint64* acc) const
+{
+	memcpy(acc, m_acc, sizeof(m_acc));
+	uint8 lastStripe[STRIPE_SIZE];
+	const uint8* lastStripePtr = lastStripe;
+	if(m_bufferSize >= STRIPE_SIZE)
+	{
+		size_t stripeCount = m_stripeCount;
+		ConsumeStripes(acc, stripeCount, m_buffer, (m_bufferSize - 1) / STRIPE_SIZE, m_secret);
+		lastStripePtr = m_buffer + m_bufferSize - STRIPE_SIZE;
+	}
+	else
+	{
+		size_t catchupSize = STRIPE_SIZE - m_bufferSize;
+		memcpy(lastStripe, m_buffer + BUFFER_SIZE - catchupSize, catchupSize);
+		memcpy(lastStripe + catchupSize, m_buffer, m_bufferSize);
+	}
+	g_xxh3Dispatcher.Get()(acc, lastStripePtr, m_secret + SECRET_SIZE - STRIPE_SIZE - SECRET_LASTACC_START, 1);
+}
@@ -0,0 +1,161 @@
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include "IndexedInflateStream.h"
+
+using namespace Framework;
+
+CIndexedInflateStream::CIndexedInflateStream(CStream& stream, const CInflateIndex& index)
+: m_stream(stream)
+, m_index(index)
+, m_inputBuffer(BUFFER_SIZE)
+{
+	m_origin = m_stream.Tell();
+	memset(&m_zStream, 0, sizeof(z_stream));
+}
+
+CIndexedInflateStream::~CIndexedInflateStream()
+{
+	if(m_isInflating)
+	{
+		inflateEnd(&m_zStream);
+	}
+}
+
+void CIndexedInflateStream::Seek(int64 position, STREAM_SEEK_DIRECTION direction)
+{
+	//Inflater is only moved on the next read
+	switch(direction)
+	{
+	case STREAM_SEEK_SET:
+		m_position = position;
+		break;
+	case STREAM_SEEK_CUR:
+		m_position += position;
+		break;
+	case STREAM_SEEK_END:
+		m_position = m_index.GetUncompressedLength() + position;
+		break;
+	}
+}
+
+uint64 CIndexedInflateStream::Tell()
+{
+	return m_position;
+}
+
+uint64 CIndexedInflateStream::Read(void* buffer, uint64 size)
+{
+	uint64 length = m_index.GetUncompressedLength();
+	if(m_position >= length) return 0;
+	size = std::min<uint64>(size, length - m_position);
+
+	//Going back or past the next checkpoint is faster from a checkpoint
+	const auto& point = m_index.FindPoint(m_position);
+	if(!m_isInflating || (m_position < m_inflatePosition) || (point.uncompressedOffset > m_inflatePosition))
+	{
+		Reposition(point);
+	}
+
+	//Skip to the position within the span
+	while(m_inflatePosition != m_position)
+	{
+		uint8 discard[BUFFER_SIZE];
+		uint64 amount = Inflate(discard, std::min<uint64>(sizeof(discard), m_position - m_inflatePosition));
+		if(amount == 0)
+		{
+			throw std::runtime_error("Compressed stream doesn't match its index.");
+		}
+	}
+
+	uint64 amountRead = Inflate(buffer, size);
+	m_position += amountRead;
+	return amountRead;
+}
+
+uint64 CIndexedInflateStream::Write(const void*, uint64)
+{
+	throw std::runtime_error("Unsupported operation.");
+}
+
+bool CIndexedInflateStream::IsEOF()
+{
+	return m_position >= m_index.GetUncompressedLength();
+}
+
+uint64 CIndexedInflateStream::GetLength()
+{
+	return m_index.GetUncompressedLength();
+}
+
+void CIndexedInflateStream::Reposition(const CInflateIndex::POINT& point)
+{
+	if(m_isInflating)
+	{
+		inflateEnd(&m_zStream);
+		m_isInflating = false;
+	}
+	memset(&m_zStream, 0, sizeof(z_stream));
+
+	//Checkpoints are past any gzip header, data is always inflated raw from them
+	if(inflateInit2(&m_zStream, -MAX_WBITS) != Z_OK)
+	{
+		throw std::runtime_error("zlib stream initialization error.");
+	}
+	m_isInflating = true;
+	m_isStreamEnd = false;
+
+	if(point.bitCount != 0)
+	{
+		//Checkpoint is in the middle of a byte, feed its remaining bits first
+		m_stream.Seek(m_origin + point.compressedOffset - 1, STREAM_SEEK_SET);
+		uint8 value = m_stream.Read8();
+		if(inflatePrime(&m_zStream, point.bitCount, value >> (8 - point.bitCount)) != Z_OK)
+		{
+			throw std::runtime_error("Error occured while inflating.");
+		}
+	}
+	else
+	{
+		m_stream.Seek(m_origin + point.compressedOffset, STREAM_SEEK_SET);
+	}
+	if(!point.window.empty() && (inflateSetDictionary(&m_zStream, point.window.data(), static_cast<uInt>(point.window.size())) != Z_OK))
+	{
+		throw std::runtime_error("Error occured while inflating.");
+	}
+	m_inflatePosition = point.uncompressedOffset;
+}
+
+uint64 CIndexedInflateStream::Inflate(void* buffer, uint64 size)
+{
+	m_zStream.next_out = reinterpret_cast<Bytef*>(buffer);
+	m_zStream.avail_out = 0;
+	uint64 remaining = size;
+	while(((m_zStream.avail_out != 0) || (remaining != 0)) && !m_isStreamEnd)
+	{
+		if(m_zStream.avail_out == 0)
+		{
+			uInt chunkSize = static_cast<uInt>(std::min<uint64>(remaining, MAX_CHUNK_SIZE));
+			m_zStream.avail_out = chunkSize;
+			remaining -= chunkSize;
+		}
+		if(m_zStream.avail_in == 0)
+		{
+			m_zStream.avail_in = static_cast<uInt>(m_stream.Read(m_inputBuffer.data(), m_inputBuffer.size()));
+			m_zStream.next_in = m_inputBuffer.data();
+			if(m_zStream.avail_in == 0)
+			{
+				throw std::runtime_error("Unexpected end of compressed stream.");
+			}
+		}
+		int ret = inflate(&m_zStream, Z_NO_FLUSH);
+		if((ret == Z_NEED_DICT) || (ret == Z_DATA_ERROR) || (ret == Z_MEM_ERROR))
+		{
+			throw std::runtime_error("Error occured while inflating.");
+		}
+		m_isStreamEnd = (ret == Z_STREAM_END);
+	}
+	uint64 amount = size - remaining - m_zStream.avail_out;
+	m_inflatePosition += amount;
+	return amount;
+}
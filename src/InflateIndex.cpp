@@ -0,0 +1,193 @@
+#include <algorithm>
+#include <stdexcept>
+#include <zstd_zlibwrapper.h>
+#include "InflateIndex.h"
+
+using namespace Framework;
+
+CInflateIndex CInflateIndex::Build(CStream& stream, FORMAT format, uint64 spanSize)
+{
+	CInflateIndex index;
+	index.m_format = format;
+
+	z_stream zStream = {};
+	int windowBits = (format == FORMAT_GZIP) ? (MAX_WBITS + 16) : -MAX_WBITS;
+	if(inflateInit2(&zStream, windowBits) != Z_OK)
+	{
+		throw std::runtime_error("zlib stream initialization error.");
+	}
+
+	std::vector<uint8> input(BUFFER_SIZE);
+	//Output wraps around in the window, the last WINDOW_SIZE bytes are always available
+	std::vector<uint8> window(WINDOW_SIZE);
+	uint64 totalIn = 0;
+	uint64 totalOut = 0;
+	uint64 lastPointOut = 0;
+
+	//Inflater only stops after the header before the first block in gzip streams
+	if(format == FORMAT_RAW)
+	{
+		index.m_points.push_back(POINT());
+	}
+
+	try
+	{
+		int ret = Z_OK;
+		while(ret != Z_STREAM_END)
+		{
+			zStream.avail_in = static_cast<uInt>(stream.Read(input.data(), input.size()));
+			zStream.next_in = input.data();
+			if(zStream.avail_in == 0)
+			{
+				throw std::runtime_error("Unexpected end of compressed stream.");
+			}
+			//Inflater can also be waiting for output space after consuming all of its input
+			while((zStream.avail_in != 0) || (zStream.avail_out == 0))
+			{
+				if(zStream.avail_out == 0)
+				{
+					zStream.avail_out = WINDOW_SIZE;
+					zStream.next_out = window.data();
+				}
+
+				totalIn += zStream.avail_in;
+				totalOut += zStream.avail_out;
+				//Stop at the end of every block to see if a checkpoint is needed
+				ret = inflate(&zStream, Z_BLOCK);
+				totalIn -= zStream.avail_in;
+				totalOut -= zStream.avail_out;
+				if(ret == Z_BUF_ERROR)
+				{
+					break;
+				}
+				if((ret == Z_NEED_DICT) || (ret == Z_DATA_ERROR) || (ret == Z_MEM_ERROR))
+				{
+					throw std::runtime_error("Error occured while inflating.");
+				}
+				if(ret == Z_STREAM_END)
+				{
+					break;
+				}
+
+				//Bit 7 is set at the end of a block, bit 6 when that block was the last one
+				bool isBlockBoundary = (zStream.data_type & 0x80) && !(zStream.data_type & 0x40);
+				if(isBlockBoundary && ((totalOut == 0) || ((totalOut - lastPointOut) > spanSize)))
+				{
+					POINT point;
+					point.compressedOffset = totalIn;
+					point.uncompressedOffset = totalOut;
+					point.bitCount = static_cast<uint8>(zStream.data_type & 0x07);
+					size_t windowPosition = WINDOW_SIZE - zStream.avail_out;
+					if(totalOut >= WINDOW_SIZE)
+					{
+						point.window.assign(window.begin() + windowPosition, window.end());
+					}
+					point.window.insert(point.window.end(), window.begin(), window.begin() + windowPosition);
+					index.m_points.push_back(std::move(point));
+					lastPointOut = totalOut;
+				}
+			}
+		}
+	}
+	catch(...)
+	{
+		inflateEnd(&zStream);
+		throw;
+	}
+	inflateEnd(&zStream);
+
+	index.m_uncompressedLength = totalOut;
+	return index;
+}
+
+CInflateIndex CInflateIndex::Load(CStream& stream)
+{
+	if(stream.Read32() != FILE_SIGNATURE)
+	{
+		throw std::runtime_error("Invalid inflate index.");
+	}
+	if(stream.Read32() != FILE_VERSION)
+	{
+		throw std::runtime_error("Unsupported inflate index version.");
+	}
+
+	CInflateIndex index;
+	uint32 format = stream.Read32();
+	if(format > FORMAT_GZIP)
+	{
+		throw std::runtime_error("Invalid inflate index.");
+	}
+	index.m_format = static_cast<FORMAT>(format);
+	index.m_uncompressedLength = stream.Read64();
+	uint32 pointCount = stream.Read32();
+	for(uint32 i = 0; i < pointCount; i++)
+	{
+		POINT point;
+		point.compressedOffset = stream.Read64();
+		point.uncompressedOffset = stream.Read64();
+		point.bitCount = stream.Read8();
+		uint32 windowSize = stream.Read32();
+		if((point.bitCount > 7) || (windowSize > WINDOW_SIZE))
+		{
+			throw std::runtime_error("Invalid inflate index.");
+		}
+		point.window.resize(windowSize);
+		//Points at the start of the stream have no window
+		if((windowSize != 0) && (stream.Read(point.window.data(), windowSize) != windowSize))
+		{
+			throw std::runtime_error("Invalid inflate index.");
+		}
+		index.m_points.push_back(std::move(point));
+	}
+	if(index.m_points.empty() || (index.m_points[0].uncompressedOffset != 0))
+	{
+		throw std::runtime_error("Invalid inflate index.");
+	}
+	return index;
+}
+
+void CInflateIndex::Save(CStream& stream) const
+{
+	stream.Write32(FILE_SIGNATURE);
+	stream.Write32(FILE_VERSION);
+	stream.Write32(m_format);
+	stream.Write64(m_uncompressedLength);
+	stream.Write32(static_cast<uint32>(m_points.size()));
+	for(const auto& point : m_points)
+	{
+		stream.Write64(point.compressedOffset);
+		stream.Write64(point.uncompressedOffset);
+		stream.Write8(point.bitCount);
+		stream.Write32(static_cast<uint32>(point.window.size()));
+		if(!point.window.empty())
+		{
+			stream.Write(point.window.data(), point.window.size());
+		}
+	}
+}
+
+CInflateIndex::FORMAT CInflateIndex::GetFormat() const
+{
+	return m_format;
+}
+
+uint64 CInflateIndex::GetUncompressedLength() const
+{
+	return m_uncompressedLength;
+}
+
+const CInflateIndex::PointArray& CInflateIndex::GetPoints() const
+{
+	return m_points;
+}
+
+const CInflateIndex::POINT& CInflateIndex::FindPoint(uint64 offset) const
+{
+	if(m_points.empty())
+	{
+		throw std::runtime_error("Inflate index is empty.");
+	}
+	auto pointIterator = std::upper_bound(std::begin(m_points), std::end(m_points), offset,
+		[] (uint64 offset, const POINT& point) { return offset < point.uncompressedOffset; });
+	return *std::prev(pointIterator);
+}
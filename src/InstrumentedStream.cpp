@@ -0,0 +1,267 @@
+#include "InstrumentedStream.h"
+#include <cassert>
+#include <chrono>
+#include "string_format.h"
+
+using namespace Framework;
+
+namespace
+{
+	class CScopedTimer
+	{
+	public:
+		CScopedTimer(CStreamStats& stats, CStreamStats::OPERATION operation)
+		    : m_stats(stats)
+		    , m_operation(operation)
+		    , m_start(std::chrono::steady_clock::now())
+		{
+		}
+
+		~CScopedTimer()
+		{
+			auto elapsed = std::chrono::steady_clock::now() - m_start;
+			auto microseconds = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+			m_stats.Record(m_operation, m_bytes, microseconds);
+		}
+
+		void SetBytes(uint64 bytes)
+		{
+			m_bytes = bytes;
+		}
+
+	private:
+		CStreamStats& m_stats;
+		CStreamStats::OPERATION m_operation;
+		std::chrono::steady_clock::time_point m_start;
+		uint64 m_bytes = 0;
+	};
+}
+
+CStreamStats::CStreamStats()
+{
+	Reset();
+}
+
+void CStreamStats::Record(OPERATION operation, uint64 bytes, uint64 microseconds)
+{
+	assert(operation < OPERATION_COUNT);
+	auto& stats = m_stats[operation];
+	stats.calls.fetch_add(1, std::memory_order_relaxed);
+	stats.bytes.fetch_add(bytes, std::memory_order_relaxed);
+	stats.microseconds.fetch_add(microseconds, std::memory_order_relaxed);
+	unsigned int bucket = 0;
+	while((microseconds != 0) && (bucket < (HISTOGRAM_BUCKET_COUNT - 1)))
+	{
+		microseconds >>= 1;
+		bucket++;
+	}
+	stats.histogram[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+void CStreamStats::Reset()
+{
+	for(auto& stats : m_stats)
+	{
+		stats.calls = 0;
+		stats.bytes = 0;
+		stats.microseconds = 0;
+		for(auto& bucket : stats.histogram)
+		{
+			bucket = 0;
+		}
+	}
+}
+
+const CStreamStats::OPERATION_STATS& CStreamStats::GetOperationStats(OPERATION operation) const
+{
+	assert(operation < OPERATION_COUNT);
+	return m_stats[operation];
+}
+
+const char* CStreamStats::GetOperationName(OPERATION operation)
+{
+	static const char* names[OPERATION_COUNT] =
+	{
+		"read",
+		"write",
+		"seek",
+		"tell",
+		"flush",
+	};
+	assert(operation < OPERATION_COUNT);
+	return names[operation];
+}
+
+CStreamStatsRegistry::StatsPtr CStreamStatsRegistry::GetStats(const std::string& name)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto& stats = m_stats[name];
+	if(!stats)
+	{
+		stats = std::make_shared<CStreamStats>();
+	}
+	return stats;
+}
+
+void CStreamStatsRegistry::Reset()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for(auto& statsPair : m_stats)
+	{
+		statsPair.second->Reset();
+	}
+}
+
+std::string CStreamStatsRegistry::DumpJson()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	std::string result = "{";
+	bool firstStream = true;
+	for(const auto& statsPair : m_stats)
+	{
+		if(!firstStream) result += ",";
+		firstStream = false;
+		//Names are expected to be plain identifiers or paths, only escape what would break the output
+		std::string name;
+		for(auto nameChar : statsPair.first)
+		{
+			if((nameChar == '\"') || (nameChar == '\\')) name += '\\';
+			name += nameChar;
+		}
+		string_format_to(result, FORMAT_STRING("\"{}\":{{"), name);
+		for(unsigned int i = 0; i < CStreamStats::OPERATION_COUNT; i++)
+		{
+			auto operation = static_cast<CStreamStats::OPERATION>(i);
+			const auto& stats = statsPair.second->GetOperationStats(operation);
+			if(i != 0) result += ",";
+			string_format_to(result, FORMAT_STRING("\"{}\":{{\"calls\":{},\"bytes\":{},\"microseconds\":{},\"histogram\":["),
+			                 CStreamStats::GetOperationName(operation), stats.calls.load(), stats.bytes.load(), stats.microseconds.load());
+			for(unsigned int bucket = 0; bucket < CStreamStats::HISTOGRAM_BUCKET_COUNT; bucket++)
+			{
+				if(bucket != 0) result += ",";
+				string_format_to(result, FORMAT_STRING("{}"), stats.histogram[bucket].load());
+			}
+			result += "]}";
+		}
+		result += "}";
+	}
+	result += "}";
+	return result;
+}
+
+std::string CStreamStatsRegistry::DumpCsv()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	std::string result = "stream,operation,calls,bytes,microseconds";
+	for(unsigned int bucket = 0; bucket < CStreamStats::HISTOGRAM_BUCKET_COUNT; bucket++)
+	{
+		string_format_to(result, FORMAT_STRING(",bucket{}"), bucket);
+	}
+	result += "\n";
+	for(const auto& statsPair : m_stats)
+	{
+		for(unsigned int i = 0; i < CStreamStats::OPERATION_COUNT; i++)
+		{
+			auto operation = static_cast<CStreamStats::OPERATION>(i);
+			const auto& stats = statsPair.second->GetOperationStats(operation);
+			string_format_to(result, FORMAT_STRING("{},{},{},{},{}"),
+			                 statsPair.first, CStreamStats::GetOperationName(operation),
+			                 stats.calls.load(), stats.bytes.load(), stats.microseconds.load());
+			for(unsigned int bucket = 0; bucket < CStreamStats::HISTOGRAM_BUCKET_COUNT; bucket++)
+			{
+				string_format_to(result, FORMAT_STRING(",{}"), stats.histogram[bucket].load());
+			}
+			result += "\n";
+		}
+	}
+	return result;
+}
+
+CInstrumentedStream::CInstrumentedStream(CStream& stream, const std::string& name)
+    : CInstrumentedStream(stream, CStreamStatsRegistry::GetInstance().GetStats(name))
+{
+}
+
+CInstrumentedStream::CInstrumentedStream(CStream& stream, CStreamStatsRegistry::StatsPtr stats)
+    : m_stream(stream)
+    , m_stats(std::move(stats))
+{
+	assert(m_stats);
+}
+
+void CInstrumentedStream::Seek(int64 position, STREAM_SEEK_DIRECTION direction)
+{
+	CScopedTimer timer(*m_stats, CStreamStats::OPERATION_SEEK);
+	m_stream.Seek(position, direction);
+}
+
+uint64 CInstrumentedStream::Tell()
+{
+	CScopedTimer timer(*m_stats, CStreamStats::OPERATION_TELL);
+	return m_stream.Tell();
+}
+
+uint64 CInstrumentedStream::Read(void* buffer, uint64 size)
+{
+	CScopedTimer timer(*m_stats, CStreamStats::OPERATION_READ);
+	uint64 result = m_stream.Read(buffer, size);
+	timer.SetBytes(result);
+	return result;
+}
+
+uint64 CInstrumentedStream::Write(const void* buffer, uint64 size)
+{
+	CScopedTimer timer(*m_stats, CStreamStats::OPERATION_WRITE);
+	uint64 result = m_stream.Write(buffer, size);
+	timer.SetBytes(result);
+	return result;
+}
+
+bool CInstrumentedStream::IsEOF()
+{
+	return m_stream.IsEOF();
+}
+
+void CInstrumentedStream::Flush()
+{
+	CScopedTimer timer(*m_stats, CStreamStats::OPERATION_FLUSH);
+	m_stream.Flush();
+}
+
+uint64 CInstrumentedStream::GetLength()
+{
+	CScopedTimer timer(*m_stats, CStreamStats::OPERATION_SEEK);
+	return m_stream.GetLength();
+}
+
+uint64 CInstrumentedStream::GetRemainingLength()
+{
+	CScopedTimer timer(*m_stats, CStreamStats::OPERATION_SEEK);
+	return m_stream.GetRemainingLength();
+}
+
+bool CInstrumentedStream::CanAccessAt() const
+{
+	return m_stream.CanAccessAt();
+}
+
+uint64 CInstrumentedStream::ReadAt(uint64 offset, void* buffer, uint64 size)
+{
+	CScopedTimer timer(*m_stats, CStreamStats::OPERATION_READ);
+	uint64 result = m_stream.ReadAt(offset, buffer, size);
+	timer.SetBytes(result);
+	return result;
+}
+
+uint64 CInstrumentedStream::WriteAt(uint64 offset, const void* buffer, uint64 size)
+{
+	CScopedTimer timer(*m_stats, CStreamStats::OPERATION_WRITE);
+	uint64 result = m_stream.WriteAt(offset, buffer, size);
+	timer.SetBytes(result);
+	return result;
+}
+
+const CStreamStats& CInstrumentedStream::GetStats() const
+{
+	return *m_stats;
+}
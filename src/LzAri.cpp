@@ -10,133 +10,105 @@
 		CompuServe	74050,1022
 **************************************************************/
 #include "LzAri.h"
-#include <stdlib.h>
+#include <algorithm>
 #include <string.h>
-#include <ctype.h>
 
 using namespace Framework;
 
-void CLzAri::Decompress(Framework::CStream& dst, Framework::CStream& src)
+void CLzAri::Compress(Framework::CStream& dst, Framework::CStream& src)
 {
-	CLzAri ari;
-	ari.inputStream = &src;
-	ari.outputStream = &dst;
-	ari.Decode();
+	uint64 size = src.GetLength();
+	std::vector<uint8> data(static_cast<size_t>(size));
+	src.Seek(0, Framework::STREAM_SEEK_SET);
+	src.Read(data.data(), size);
+	std::vector<uint8> result;
+	Compress(data.data(), data.size(), result);
+	dst.Write(result.data(), result.size());
 }
 
-/********** Bit I/O **********/
+void CLzAri::Decompress(Framework::CStream& dst, Framework::CStream& src)
+{
+	std::vector<uint8> data(static_cast<size_t>(src.GetRemainingLength()));
+	src.Read(data.data(), data.size());
+	std::vector<uint8> result;
+	size_t used = Decompress(data.data(), data.size(), result);
+	//Leave the source right after the compressed data, as if it was read bit by bit
+	src.Seek(-static_cast<int64>(data.size() - used), Framework::STREAM_SEEK_CUR);
+	dst.Write(result.data(), result.size());
+}
 
-void CLzAri::PutBit(int bit)  /* Output one bit (bit = 0,1) */
+void CLzAri::Compress(const void* data, size_t size, std::vector<uint8>& result)
 {
-	if (bit) putBuffer |= putMask;
-	if ((putMask >>= 1) == 0) 
-	{
-		outputStream->Write8(static_cast<uint8>(putBuffer));
-		putBuffer = 0;
-		putMask = 128;
-	}
+	CLzAri ari;
+	ari.output = &result;
+	result.clear();
+	ari.Encode(reinterpret_cast<const uint8*>(data), size);
 }
 
-void CLzAri::FlushBitBuffer(void)  /* Send remaining bits */
+size_t CLzAri::Decompress(const void* data, size_t size, std::vector<uint8>& result)
 {
-	for (int i = 0; i < 7; i++) PutBit(0);
+	result.clear();
+	uint32 textsize = 0;
+	if(size < sizeof(uint32)) return size;
+	memcpy(&textsize, data, sizeof(uint32));
+
+	CLzAri ari;
+	ari.output = &result;
+	ari.input = reinterpret_cast<const uint8*>(data) + sizeof(uint32);
+	ari.inputSize = size - sizeof(uint32);
+	ari.Decode(textsize);
+	return sizeof(uint32) + static_cast<size_t>(std::min<uint64>((ari.bitsRead + 7) / 8, ari.inputSize));
 }
 
-int CLzAri::GetBit(void)  /* Get one bit (0 or 1) */
+/********** Bit I/O **********/
+
+void CLzAri::PutBits(int bit, int count)  /* Output count copies of bit (bit = 0,1) */
 {
-	if ((getMask >>= 1) == 0)
+	uint32 bits = bit ? ~0U : 0;
+	while (count > 0)
 	{
-		if(inputStream->IsEOF())
+		int amount = std::min(count, 32 - putCount);
+		putBuffer = (amount == 32) ? bits : ((putBuffer << amount) | (bits & ((1U << amount) - 1)));
+		putCount += amount;
+		count -= amount;
+		if (putCount == 32)
 		{
-			getBuffer = 0;
+			uint8 word[4] = { static_cast<uint8>(putBuffer >> 24), static_cast<uint8>(putBuffer >> 16), static_cast<uint8>(putBuffer >> 8), static_cast<uint8>(putBuffer) };
+			output->insert(output->end(), word, word + 4);
+			putBuffer = 0;
+			putCount = 0;
 		}
-		else
-		{
-			getBuffer = inputStream->Read8();
-		}
-		getMask = 128;
 	}
-	return ((getBuffer & getMask) != 0);
 }
 
-/********** LZSS with multiple binary trees **********/
-
-void CLzAri::InitTree(void)  /* Initialize trees */
-{
-	int  i;
-
-	/* For i = 0 to N - 1, rson[i] and lson[i] will be the right and
-	   left children of node i.  These nodes need not be initialized.
-	   Also, dad[i] is the parent of node i.  These are initialized to
-	   NIL (= N), which stands for 'not used.'
-	   For i = 0 to 255, rson[N + i + 1] is the root of the tree
-	   for strings that begin with character i.  These are initialized
-	   to NIL.  Note there are 256 trees. */
-
-	for (i = N + 1; i <= N + 256; i++) rson[i] = NIL;	/* root */
-	for (i = 0; i < N; i++) dad[i] = NIL;	/* node */
-}
-
-void CLzAri::InsertNode(int r)
-	/* Inserts string of length F, text_buf[r..r+F-1], into one of the
-	   trees (text_buf[r]'th tree) and returns the longest-match position
-	   and length via the global variables match_position and match_length.
-	   If match_length = F, then removes the old node in favor of the new
-	   one, because the old one will be deleted sooner.
-	   Note r plays double role, as tree node and position in buffer. */
+void CLzAri::FlushBitBuffer(void)  /* Send remaining bits */
 {
-	int  i, p, cmp, temp;
-	unsigned char  *key;
-
-	cmp = 1;  key = &text_buf[r];  p = N + 1 + key[0];
-	rson[r] = lson[r] = NIL;  match_length = 0;
-	for ( ; ; ) {
-		if (cmp >= 0) {
-			if (rson[p] != NIL) p = rson[p];
-			else {	rson[p] = r;  dad[r] = p;  return;  }
-		} else {
-			if (lson[p] != NIL) p = lson[p];
-			else {	lson[p] = r;  dad[r] = p;  return;  }
-		}
-		for (i = 1; i < F; i++)
-			if ((cmp = key[i] - text_buf[p + i]) != 0)  break;
-		if (i > THRESHOLD) {
-			if (i > match_length) {
-				match_position = (r - p) & (N - 1);
-				if ((match_length = i) >= F) break;
-			} else if (i == match_length) {
-				if ((temp = (r - p) & (N - 1)) < match_position)
-					match_position = temp;
-			}
-		}
+	/* Padding completes the last byte, incomplete bytes are dropped */
+	PutBits(0, 7);
+	for (; putCount >= 8; putCount -= 8)
+	{
+		output->push_back(static_cast<uint8>(putBuffer >> (putCount - 8)));
 	}
-	dad[r] = dad[p];  lson[r] = lson[p];  rson[r] = rson[p];
-	dad[lson[p]] = r;  dad[rson[p]] = r;
-	if (rson[dad[p]] == p) rson[dad[p]] = r;
-	else		       lson[dad[p]] = r;
-	dad[p] = NIL;  /* remove p */
+	putBuffer = 0;
+	putCount = 0;
 }
 
-void CLzAri::DeleteNode(int p)	/* Delete node p from tree */
+int CLzAri::GetBit(void)  /* Get one bit (0 or 1) */
 {
-	int  q;
-
-	if (dad[p] == NIL) return;  /* not in tree */
-	if (rson[p] == NIL) q = lson[p];
-	else if (lson[p] == NIL) q = rson[p];
-	else {
-		q = lson[p];
-		if (rson[q] != NIL) {
-			do {  q = rson[q];  } while (rson[q] != NIL);
-			rson[dad[q]] = lson[q];  dad[lson[q]] = dad[q];
-			lson[q] = lson[p];  dad[lson[p]] = q;
+	if (getCount == 0)
+	{
+		/* Past the end of input, bits are 0 */
+		getBuffer = 0;
+		for (int i = 0; i < 4; i++, inputPosition++)
+		{
+			getBuffer <<= 8;
+			if (inputPosition < inputSize) getBuffer |= input[inputPosition];
 		}
-		rson[q] = rson[p];  dad[rson[p]] = q;
+		getCount = 32;
 	}
-	dad[q] = dad[p];
-	if (rson[dad[p]] == p) rson[dad[p]] = q;
-	else		       lson[dad[p]] = q;
-	dad[p] = NIL;
+	getCount--;
+	bitsRead++;
+	return (getBuffer >> getCount) & 1;
 }
 
 /********** Arithmetic Compression **********/
@@ -184,8 +156,9 @@ void CLzAri::UpdateModel(int sym)
 
 void CLzAri::Output(int bit)  /* Output 1 bit, followed by its complements */
 {
-	PutBit(bit);
-	for ( ; shifts > 0; shifts--) PutBit(! bit);
+	PutBits(bit, 1);
+	PutBits(!bit, shifts);
+	shifts = 0;
 }
 
 void CLzAri::EncodeChar(int ch)
@@ -320,92 +293,106 @@ int CLzAri::DecodePosition(void)
 
 /********** Encode and Decode **********/
 
-void CLzAri::Encode(void)
+/* Input is preceded by the ring buffer's initial spaces, matches are
+   found with hash chains over 3-byte prefixes instead of binary trees. */
+void CLzAri::Encode(const uint8* data, size_t size)
 {
-	int  i, len, r, s, last_match_length;
-	uint32 textsize = static_cast<uint32>(inputStream->GetLength());
-	outputStream->Write32(textsize);
+	uint32 textsize = static_cast<uint32>(size);
+	output->resize(sizeof(uint32));
+	memcpy(output->data(), &textsize, sizeof(uint32));
 	if (textsize == 0) return;
-	inputStream->Seek(0, Framework::STREAM_SEEK_SET);
-	textsize = 0;
+	output->reserve(sizeof(uint32) + size / 2);
 	StartModel();
-	InitTree();
-	s = 0;	r = N - F;
-	for (i = s; i < r; i++) 
-	{
-		text_buf[i] = ' ';
-	}
-	for (len = 0; len < F && !inputStream->IsEOF(); len++)
-	{
-		text_buf[r + len] = inputStream->Read8();
-	}
-	textsize = len;
-	for (i = 1; i <= F; i++) InsertNode(r - i);
-	InsertNode(r);
-	do
-	{
-		if (match_length > len) match_length = len;
-		if (match_length <= THRESHOLD) 
+
+	const size_t prefixSize = N - F;
+	std::vector<uint8> buffer(prefixSize + size, ' ');
+	memcpy(buffer.data() + prefixSize, data, size);
+	const uint8* text = buffer.data();
+	size_t end = buffer.size();
+
+	std::vector<int32> head(HASH_SIZE, -1);
+	std::vector<int32> prev(N, -1);
+	auto hash = [text] (size_t position) { return ((text[position] << 10) ^ (text[position + 1] << 5) ^ text[position + 2]) & (HASH_SIZE - 1); };
+	auto insert =
+		[&] (size_t position)
 		{
-			match_length = 1;  EncodeChar(text_buf[r]);
-		}
-		else 
+			if ((position + THRESHOLD + 1) > end) return;
+			auto& chainHead = head[hash(position)];
+			prev[position & (N - 1)] = chainHead;
+			chainHead = static_cast<int32>(position);
+		};
+
+	for (size_t i = 0; i < prefixSize; i++) insert(i);
+
+	size_t position = prefixSize;
+	while (position < end)
+	{
+		size_t maxLength = std::min<size_t>(F, end - position);
+		size_t matchLength = 0;
+		size_t matchDistance = 0;
+		if (maxLength > THRESHOLD)
 		{
-			EncodeChar(255 - THRESHOLD + match_length);
-			EncodePosition(match_position - 1);
+			int chainLength = MAX_CHAIN_LENGTH;
+			for (int32 candidate = head[hash(position)]; (candidate >= 0) && (chainLength-- > 0); candidate = prev[candidate & (N - 1)])
+			{
+				size_t distance = position - candidate;
+				if (distance > MAX_DISTANCE) break;
+				/* Can't be longer if it differs at the current match's end */
+				if ((matchLength != 0) && (text[candidate + matchLength] != text[position + matchLength])) continue;
+				size_t length = 0;
+				while ((length < maxLength) && (text[candidate + length] == text[position + length])) length++;
+				/* Closest match wins ties, as with the trees */
+				if (length > matchLength)
+				{
+					matchLength = length;
+					matchDistance = distance;
+					if (length == maxLength) break;
+				}
+			}
 		}
-		last_match_length = match_length;
-		for (i = 0; i < last_match_length && !inputStream->IsEOF(); i++) 
+		if (matchLength <= THRESHOLD)
 		{
-			uint8 c = inputStream->Read8();
-			DeleteNode(s);	text_buf[s] = c;
-			if (s < F - 1) text_buf[s + N] = c;
-			s = (s + 1) & (N - 1);
-			r = (r + 1) & (N - 1);
-			InsertNode(r);
+			matchLength = 1;  EncodeChar(text[position]);
 		}
-		while (i++ < last_match_length) 
+		else
 		{
-			DeleteNode(s);
-			s = (s + 1) & (N - 1);
-			r = (r + 1) & (N - 1);
-			if (--len) InsertNode(r);
+			EncodeChar(static_cast<int>(255 - THRESHOLD + matchLength));
+			EncodePosition(static_cast<int>(matchDistance - 1));
 		}
-	} 
-	while (len > 0);
+		for (size_t i = 0; i < matchLength; i++) insert(position + i);
+		position += matchLength;
+	}
 	EncodeEnd();
 }
 
-void CLzAri::Decode(void)
+/* Output is preceded by what the ring buffer holds before decoding starts:
+   F bytes that are never written followed by spaces. */
+void CLzAri::Decode(uint32 textsize)
 {
-	int  i, j, k, r, c;
-	uint32 count;
-	uint32 textsize = inputStream->Read32();
 	if (textsize == 0) return;
 	StartDecode();
 	StartModel();
-	for (i = 0; i < N - F; i++) text_buf[i] = ' ';
-	r = N - F;
-	for (count = 0; count < textsize; ) 
+
+	std::vector<uint8>& buffer = *output;
+	buffer.resize(N + static_cast<size_t>(textsize));
+	memset(buffer.data(), 0, F);
+	memset(buffer.data() + F, ' ', N - F);
+	size_t position = N;
+	size_t end = buffer.size();
+	while (position < end)
 	{
-		c = DecodeChar();
-		if (c < 256) 
+		int c = DecodeChar();
+		if (c < 256)
 		{
-			outputStream->Write8(c);
-			text_buf[r++] = c;
-			r &= (N - 1);  count++;
-		} 
-		else 
+			buffer[position++] = static_cast<uint8>(c);
+		}
+		else
 		{
-			i = (r - DecodePosition() - 1) & (N - 1);
-			j = c - 255 + THRESHOLD;
-			for (k = 0; k < j; k++) 
-			{
-				c = text_buf[(i + k) & (N - 1)];
-				outputStream->Write8(c);
-				text_buf[r++] = c;
-				r &= (N - 1);  count++;
-			}
+			size_t source = position - DecodePosition() - 1;
+			size_t length = std::min<size_t>(c - 255 + THRESHOLD, end - position);
+			/* Copies can overlap with what's being written */
+			for (size_t k = 0; k < length; k++) buffer[position++] = buffer[source++];
 		}
 	}
+	buffer.erase(buffer.begin(), buffer.begin() + N);
 }
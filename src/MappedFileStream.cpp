@@ -0,0 +1,174 @@
+#include "MappedFileStream.h"
+#include <cassert>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace Framework;
+
+CMappedFileStream::CMappedFileStream(const fs::path& path)
+{
+#ifdef _WIN32
+	HANDLE file = CreateFileW(path.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if(file == INVALID_HANDLE_VALUE)
+	{
+		throw std::runtime_error("Invalid file handle.");
+	}
+	LARGE_INTEGER fileSize = {};
+	GetFileSizeEx(file, &fileSize);
+	m_file = file;
+	m_size = fileSize.QuadPart;
+	if(m_size != 0)
+	{
+		m_mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if(m_mapping == NULL)
+		{
+			CloseHandle(file);
+			throw std::runtime_error("Failed to create file mapping.");
+		}
+		m_data = reinterpret_cast<const uint8*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+		if(m_data == nullptr)
+		{
+			CloseHandle(m_mapping);
+			CloseHandle(file);
+			throw std::runtime_error("Failed to map file.");
+		}
+	}
+#else
+	int fd = open(path.string().c_str(), O_RDONLY);
+	if(fd < 0)
+	{
+		throw std::runtime_error("Invalid file handle.");
+	}
+	struct stat fileStat = {};
+	if(fstat(fd, &fileStat) < 0)
+	{
+		close(fd);
+		throw std::runtime_error("Failed to obtain file size.");
+	}
+	m_size = fileStat.st_size;
+	if(m_size != 0)
+	{
+		void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if(data == MAP_FAILED)
+		{
+			close(fd);
+			throw std::runtime_error("Failed to map file.");
+		}
+		m_data = reinterpret_cast<const uint8*>(data);
+	}
+	//Mapping stays valid after the descriptor is closed
+	close(fd);
+#endif
+}
+
+CMappedFileStream::~CMappedFileStream()
+{
+#ifdef _WIN32
+	if(m_data) UnmapViewOfFile(m_data);
+	if(m_mapping) CloseHandle(m_mapping);
+	if(m_file) CloseHandle(m_file);
+#else
+	if(m_data) munmap(const_cast<uint8*>(m_data), m_size);
+#endif
+}
+
+void CMappedFileStream::Seek(int64 position, STREAM_SEEK_DIRECTION direction)
+{
+	int64 newPosition = 0;
+	switch(direction)
+	{
+	case STREAM_SEEK_SET:
+		newPosition = position;
+		break;
+	case STREAM_SEEK_CUR:
+		newPosition = static_cast<int64>(m_position) + position;
+		break;
+	case STREAM_SEEK_END:
+		newPosition = static_cast<int64>(m_size) + position;
+		break;
+	}
+	if((newPosition < 0) || (static_cast<uint64>(newPosition) > m_size))
+	{
+		throw std::runtime_error("Invalid position.");
+	}
+	m_position = newPosition;
+	m_isEof = false;
+}
+
+uint64 CMappedFileStream::Tell()
+{
+	return m_position;
+}
+
+uint64 CMappedFileStream::Read(void* buffer, uint64 size)
+{
+	if(m_position >= m_size)
+	{
+		m_isEof = true;
+		return 0;
+	}
+	if((m_position + size) > m_size)
+	{
+		size = m_size - m_position;
+	}
+	memcpy(buffer, m_data + m_position, static_cast<size_t>(size));
+	m_position += size;
+	return size;
+}
+
+uint64 CMappedFileStream::Write(const void*, uint64)
+{
+	throw std::runtime_error("Not supported.");
+}
+
+bool CMappedFileStream::IsEOF()
+{
+	return m_isEof;
+}
+
+uint64 CMappedFileStream::GetLength()
+{
+	return m_size;
+}
+
+uint64 CMappedFileStream::GetRemainingLength()
+{
+	return m_size - m_position;
+}
+
+bool CMappedFileStream::CanAccessAt() const
+{
+	return true;
+}
+
+uint64 CMappedFileStream::ReadAt(uint64 offset, void* buffer, uint64 size)
+{
+	if(offset >= m_size) return 0;
+	size = std::min(size, m_size - offset);
+	memcpy(buffer, m_data + offset, static_cast<size_t>(size));
+	return size;
+}
+
+const uint8* CMappedFileStream::GetData() const
+{
+	return m_data;
+}
+
+const uint8* CMappedFileStream::GetSpan(uint64 offset, uint64 length) const
+{
+	if((offset > m_size) || (length > (m_size - offset)))
+	{
+		throw std::runtime_error("Span is out of range.");
+	}
+	return m_data + offset;
+}
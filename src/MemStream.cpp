@@ -1,36 +1,15 @@
 #include <assert.h>
-#include <stdlib.h>
 #include <string.h>
 #include <algorithm>
 #include <stdexcept>
 #include "MemStream.h"
-#include "PtrMacro.h"
-
-#define GROWSIZE		(0x1000)
 
 using namespace Framework;
 
-CMemStream::CMemStream(const CMemStream& src)
-{
-	CopyFrom(src);
-}
-
-CMemStream::~CMemStream()
+CMemStream::CMemStream(Buffer&& buffer)
+: m_data(std::move(buffer))
 {
-	FREEPTR(m_data);
-}
 
-void CMemStream::CopyFrom(const CMemStream& src)
-{
-	assert(m_data == nullptr);
-	m_size = src.m_size;
-	m_grow = src.m_grow;
-	m_position = src.m_position;
-	assert(m_grow >= m_size);
-	assert(m_position <= m_size);
-	m_data = reinterpret_cast<uint8*>(malloc(m_grow));
-	memcpy(m_data, src.m_data, m_size);
-	m_isEof = src.m_isEof;
 }
 
 bool CMemStream::IsEOF()
@@ -48,16 +27,16 @@ void CMemStream::Seek(int64 position, STREAM_SEEK_DIRECTION dir)
 	switch(dir)
 	{
 	case STREAM_SEEK_SET:
-		if(position > m_size) throw std::runtime_error("Invalid position.");
-		m_position = static_cast<unsigned int>(position);
+		if(position > static_cast<int64>(m_data.size())) throw std::runtime_error("Invalid position.");
+		m_position = position;
 		m_isEof = false;
 		break;
 	case STREAM_SEEK_CUR:
-		m_position += static_cast<int>(position);
+		m_position += position;
 		m_isEof = false;
 		break;
 	case STREAM_SEEK_END:
-		m_position = m_size;
+		m_position = m_data.size();
 		m_isEof = true;
 		break;
 	}
@@ -65,60 +44,90 @@ void CMemStream::Seek(int64 position, STREAM_SEEK_DIRECTION dir)
 
 uint64 CMemStream::Read(void* data, uint64 size)
 {
-	if(m_position >= m_size)
+	if(m_position >= m_data.size())
 	{
 		m_isEof = true;
 		return 0;
 	}
-	unsigned int readSize = std::min(static_cast<unsigned int>(size), m_size - m_position);
-	memcpy(data, m_data + m_position, readSize);
+	//Pointers can be null when nothing is copied, memcpy doesn't allow it
+	if(size == 0) return 0;
+	uint64 readSize = std::min<uint64>(size, m_data.size() - m_position);
+	memcpy(data, m_data.data() + m_position, static_cast<size_t>(readSize));
 	m_position += readSize;
 	return readSize;
 }
 
 uint64 CMemStream::Write(const void* data, uint64 size)
 {
-	if((m_position + size) > m_grow)
+	auto input = reinterpret_cast<const uint8*>(data);
+	if(m_position > m_data.size())
 	{
-		assert(m_grow >= m_size);
-		m_grow += ((static_cast<unsigned int>(size) + GROWSIZE - 1) / GROWSIZE) * GROWSIZE;
-		m_data = reinterpret_cast<uint8*>(realloc(m_data, m_grow));
+		m_data.resize(static_cast<size_t>(m_position));
 	}
-	memcpy(m_data + m_position, data, static_cast<uint32>(size));
-	m_position += static_cast<unsigned int>(size);
-	m_size = std::max<unsigned int>(m_size, m_position);
+	if(size == 0) return 0;
+	//Overwrite what's already there and append the rest, letting the vector grow geometrically
+	size_t overwriteSize = static_cast<size_t>(std::min<uint64>(size, m_data.size() - m_position));
+	if(overwriteSize != 0)
+	{
+		memcpy(m_data.data() + m_position, input, overwriteSize);
+	}
+	m_data.insert(m_data.end(), input + overwriteSize, input + size);
+	m_position += size;
 	return size;
 }
 
-void CMemStream::Allocate(unsigned int size)
+void CMemStream::Allocate(uint64 size)
+{
+	assert(size >= m_data.size());
+	m_data.resize(static_cast<size_t>(size));
+}
+
+void CMemStream::Reserve(uint64 size)
 {
-	assert(size >= m_size);
-	m_data = reinterpret_cast<uint8*>(realloc(m_data, size));
-	m_grow = size;
-	m_size = size;
+	m_data.reserve(static_cast<size_t>(size));
 }
 
 void CMemStream::ResetBuffer()
 {
-	m_size = 0;
+	m_data.clear();
 	m_position = 0;
 	m_isEof = false;
 }
 
 void CMemStream::Truncate()
 {
-	m_size = static_cast<uint32>(GetRemainingLength());
-	assert(m_size <= m_grow);
-	memmove(m_data, m_data + m_position, m_size);
+	assert(m_position <= m_data.size());
+	m_data.erase(m_data.begin(), m_data.begin() + static_cast<size_t>(m_position));
 	m_position = 0;
 }
 
-uint8* CMemStream::GetBuffer() const
+uint8* CMemStream::GetBuffer()
+{
+	return m_data.data();
+}
+
+const uint8* CMemStream::GetBuffer() const
+{
+	return m_data.data();
+}
+
+uint64 CMemStream::GetSize() const
+{
+	return m_data.size();
+}
+
+void CMemStream::AdoptBuffer(Buffer&& buffer)
 {
-	return m_data;
+	m_data = std::move(buffer);
+	m_position = 0;
+	m_isEof = false;
 }
 
-unsigned int CMemStream::GetSize() const
+CMemStream::Buffer CMemStream::ReleaseBuffer()
 {
-	return m_size;
+	Buffer result = std::move(m_data);
+	m_data.clear();
+	m_position = 0;
+	m_isEof = false;
+	return result;
 }
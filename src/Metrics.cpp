@@ -0,0 +1,309 @@
+#include "Metrics.h"
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+#include "BitManip.h"
+#include "string_format.h"
+
+using namespace Framework;
+using namespace Framework::Metrics;
+
+static unsigned int GetShardIndex()
+{
+	static std::atomic<unsigned int> nextThreadIndex(0);
+	static thread_local unsigned int threadIndex = nextThreadIndex.fetch_add(1, std::memory_order_relaxed);
+	return threadIndex % CCounter::SHARD_COUNT;
+}
+
+CCounter::CCounter()
+{
+	for(auto& shard : m_shards)
+	{
+		shard.value = 0;
+	}
+}
+
+void CCounter::Add(uint64 value)
+{
+	m_shards[GetShardIndex()].value.fetch_add(value, std::memory_order_relaxed);
+}
+
+uint64 CCounter::GetValue() const
+{
+	uint64 result = 0;
+	for(const auto& shard : m_shards)
+	{
+		result += shard.value.load(std::memory_order_relaxed);
+	}
+	return result;
+}
+
+CGauge::CGauge()
+: m_value(0)
+{
+}
+
+void CGauge::Set(int64 value)
+{
+	m_value.store(value, std::memory_order_relaxed);
+}
+
+void CGauge::Add(int64 value)
+{
+	m_value.fetch_add(value, std::memory_order_relaxed);
+}
+
+int64 CGauge::GetValue() const
+{
+	return m_value.load(std::memory_order_relaxed);
+}
+
+CHistogram::CHistogram()
+: m_count(0)
+, m_sum(0)
+{
+	for(auto& bucket : m_buckets)
+	{
+		bucket = 0;
+	}
+}
+
+void CHistogram::Record(uint64 value)
+{
+	m_buckets[GetBucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+	m_count.fetch_add(1, std::memory_order_relaxed);
+	m_sum.fetch_add(value, std::memory_order_relaxed);
+}
+
+uint64 CHistogram::GetCount() const
+{
+	return m_count.load(std::memory_order_relaxed);
+}
+
+uint64 CHistogram::GetSum() const
+{
+	return m_sum.load(std::memory_order_relaxed);
+}
+
+uint64 CHistogram::GetQuantile(double quantile) const
+{
+	//Buckets are read one by one while values are being recorded, their sum is used instead of m_count
+	std::array<uint64, BUCKET_COUNT> buckets;
+	uint64 count = 0;
+	for(unsigned int i = 0; i < BUCKET_COUNT; i++)
+	{
+		buckets[i] = m_buckets[i].load(std::memory_order_relaxed);
+		count += buckets[i];
+	}
+	if(count == 0) return 0;
+	uint64 rank = static_cast<uint64>(quantile * static_cast<double>(count));
+	rank = std::max<uint64>(rank, 1);
+	uint64 cumulativeCount = 0;
+	for(unsigned int i = 0; i < BUCKET_COUNT; i++)
+	{
+		cumulativeCount += buckets[i];
+		if(cumulativeCount >= rank)
+		{
+			return GetBucketUpperBound(i);
+		}
+	}
+	return GetBucketUpperBound(BUCKET_COUNT - 1);
+}
+
+uint64 CHistogram::GetCountBelow(uint64 value) const
+{
+	unsigned int lastBucket = GetBucketIndex(value);
+	//Bucket holding the value only counts if it doesn't go past it
+	if(GetBucketUpperBound(lastBucket) != value)
+	{
+		if(lastBucket == 0) return 0;
+		lastBucket--;
+	}
+	uint64 result = 0;
+	for(unsigned int i = 0; i <= lastBucket; i++)
+	{
+		result += m_buckets[i].load(std::memory_order_relaxed);
+	}
+	return result;
+}
+
+unsigned int CHistogram::GetBucketIndex(uint64 value)
+{
+	if(value < SUB_BUCKET_COUNT)
+	{
+		return static_cast<unsigned int>(value);
+	}
+	unsigned int topBit = 63 - __builtin_clzll(value);
+	unsigned int shift = topBit - SUB_BUCKET_BITS;
+	return ((topBit - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT) + static_cast<unsigned int>((value >> shift) & (SUB_BUCKET_COUNT - 1));
+}
+
+uint64 CHistogram::GetBucketUpperBound(unsigned int index)
+{
+	assert(index < BUCKET_COUNT);
+	unsigned int group = index / SUB_BUCKET_COUNT;
+	uint64 subBucket = index % SUB_BUCKET_COUNT;
+	if(group == 0)
+	{
+		return subBucket;
+	}
+	unsigned int shift = group - 1;
+	uint64 lowerBound = (SUB_BUCKET_COUNT + subBucket) << shift;
+	return lowerBound + ((1ULL << shift) - 1);
+}
+
+CCounter& CRegistry::GetCounter(const std::string& name, const std::string& labels, const std::string& help)
+{
+	return *GetMetric(name, labels, help, METRIC_TYPE::COUNTER).counter;
+}
+
+CGauge& CRegistry::GetGauge(const std::string& name, const std::string& labels, const std::string& help)
+{
+	return *GetMetric(name, labels, help, METRIC_TYPE::GAUGE).gauge;
+}
+
+CHistogram& CRegistry::GetHistogram(const std::string& name, const std::string& labels, const std::string& help)
+{
+	return *GetMetric(name, labels, help, METRIC_TYPE::HISTOGRAM).histogram;
+}
+
+void CRegistry::SetGaugeFunction(const std::string& name, const std::string& labels, const std::string& help, ValueFunction valueFunction)
+{
+	auto& metric = GetMetric(name, labels, help, METRIC_TYPE::GAUGE_FUNCTION);
+	std::lock_guard<std::mutex> lock(m_mutex);
+	metric.valueFunction = std::move(valueFunction);
+}
+
+CRegistry::METRIC& CRegistry::GetMetric(const std::string& name, const std::string& labels, const std::string& help, METRIC_TYPE type)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	//Other series of the same metric, if any, are right after the unlabeled one
+	auto sameNameIterator = m_metrics.lower_bound(MetricKey(name, std::string()));
+	if((sameNameIterator != std::end(m_metrics)) && (sameNameIterator->first.first == name) && (sameNameIterator->second.type != type))
+	{
+		throw std::runtime_error("Metric already exists with another type.");
+	}
+	auto metricIterator = m_metrics.find(MetricKey(name, labels));
+	if(metricIterator != std::end(m_metrics))
+	{
+		return metricIterator->second;
+	}
+	METRIC metric;
+	metric.type = type;
+	metric.help = help;
+	switch(type)
+	{
+	case METRIC_TYPE::COUNTER:
+		metric.counter = std::make_unique<CCounter>();
+		break;
+	case METRIC_TYPE::GAUGE:
+		metric.gauge = std::make_unique<CGauge>();
+		break;
+	case METRIC_TYPE::HISTOGRAM:
+		metric.histogram = std::make_unique<CHistogram>();
+		break;
+	case METRIC_TYPE::GAUGE_FUNCTION:
+		break;
+	}
+	return m_metrics.emplace(MetricKey(name, labels), std::move(metric)).first->second;
+}
+
+std::string CRegistry::ExportPrometheus()
+{
+	//Histogram buckets given to Prometheus, one every power of 4. Each is the upper bound of one of the
+	//histogram's buckets, so that the counts are exact.
+	static const unsigned int exportBucketCount = 15;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	std::string result;
+	const std::string* previousName = nullptr;
+	for(const auto& metricPair : m_metrics)
+	{
+		const auto& name = metricPair.first.first;
+		const auto& labels = metricPair.first.second;
+		const auto& metric = metricPair.second;
+		if(!previousName || (*previousName != name))
+		{
+			if(!metric.help.empty())
+			{
+				string_format_to(result, FORMAT_STRING("# HELP {} {}\n"), name, metric.help);
+			}
+			const char* typeName = "gauge";
+			if(metric.type == METRIC_TYPE::COUNTER) typeName = "counter";
+			if(metric.type == METRIC_TYPE::HISTOGRAM) typeName = "histogram";
+			string_format_to(result, FORMAT_STRING("# TYPE {} {}\n"), name, typeName);
+			previousName = &name;
+		}
+		std::string labelSet = labels.empty() ? std::string() : ("{" + labels + "}");
+		switch(metric.type)
+		{
+		case METRIC_TYPE::COUNTER:
+			string_format_to(result, FORMAT_STRING("{}{} {}\n"), name, labelSet, metric.counter->GetValue());
+			break;
+		case METRIC_TYPE::GAUGE:
+			string_format_to(result, FORMAT_STRING("{}{} {}\n"), name, labelSet, metric.gauge->GetValue());
+			break;
+		case METRIC_TYPE::GAUGE_FUNCTION:
+			string_format_to(result, FORMAT_STRING("{}{} {}\n"), name, labelSet, metric.valueFunction ? metric.valueFunction() : 0.0);
+			break;
+		case METRIC_TYPE::HISTOGRAM:
+			{
+				std::string bucketLabelPrefix = labels.empty() ? std::string() : (labels + ",");
+				for(unsigned int i = 1; i <= exportBucketCount; i++)
+				{
+					uint64 bound = (1ULL << (i * 2)) - 1;
+					string_format_to(result, FORMAT_STRING("{}_bucket{{{}le=\"{}\"}} {}\n"), name, bucketLabelPrefix, bound, metric.histogram->GetCountBelow(bound));
+				}
+				uint64 count = metric.histogram->GetCount();
+				string_format_to(result, FORMAT_STRING("{}_bucket{{{}le=\"+Inf\"}} {}\n"), name, bucketLabelPrefix, count);
+				string_format_to(result, FORMAT_STRING("{}_sum{} {}\n"), name, labelSet, metric.histogram->GetSum());
+				string_format_to(result, FORMAT_STRING("{}_count{} {}\n"), name, labelSet, count);
+			}
+			break;
+		}
+	}
+	return result;
+}
+
+std::string CRegistry::ExportJson()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	std::string result = "[";
+	bool firstMetric = true;
+	for(const auto& metricPair : m_metrics)
+	{
+		const auto& metric = metricPair.second;
+		if(!firstMetric) result += ",";
+		firstMetric = false;
+		//Labels are in Prometheus syntax, their quotes need to be escaped
+		std::string labels;
+		for(auto labelChar : metricPair.first.second)
+		{
+			if((labelChar == '\"') || (labelChar == '\\')) labels += '\\';
+			labels += labelChar;
+		}
+		string_format_to(result, FORMAT_STRING("{{\"name\":\"{}\",\"labels\":\"{}\","), metricPair.first.first, labels);
+		switch(metric.type)
+		{
+		case METRIC_TYPE::COUNTER:
+			string_format_to(result, FORMAT_STRING("\"type\":\"counter\",\"value\":{}}}"), metric.counter->GetValue());
+			break;
+		case METRIC_TYPE::GAUGE:
+			string_format_to(result, FORMAT_STRING("\"type\":\"gauge\",\"value\":{}}}"), metric.gauge->GetValue());
+			break;
+		case METRIC_TYPE::GAUGE_FUNCTION:
+			string_format_to(result, FORMAT_STRING("\"type\":\"gauge\",\"value\":{}}}"), metric.valueFunction ? metric.valueFunction() : 0.0);
+			break;
+		case METRIC_TYPE::HISTOGRAM:
+			{
+				const auto& histogram = *metric.histogram;
+				string_format_to(result, FORMAT_STRING("\"type\":\"histogram\",\"count\":{},\"sum\":{},\"p50\":{},\"p90\":{},\"p99\":{},\"p999\":{}}}"),
+				                 histogram.GetCount(), histogram.GetSum(), histogram.GetQuantile(0.5), histogram.GetQuantile(0.9),
+				                 histogram.GetQuantile(0.99), histogram.GetQuantile(0.999));
+			}
+			break;
+		}
+	}
+	result += "]";
+	return result;
+}
@@ -0,0 +1,29 @@
+#include <algorithm>
+#include "ParallelFor.h"
+#include "ThreadPool.h"
+
+using namespace Framework;
+
+size_t Framework::GetParallelGrainSize(CThreadPool* threadPool, size_t count)
+{
+	if(!threadPool) return std::max<size_t>(count, 1);
+	size_t chunkCount = std::max<size_t>(threadPool->GetThreadCount(), 1) * 4;
+	return std::max<size_t>((count + chunkCount - 1) / chunkCount, 1);
+}
+
+void Framework::ParallelFor(CThreadPool* threadPool, size_t begin, size_t end, const ParallelForFunction& function, size_t grainSize)
+{
+	if(begin >= end) return;
+	if(grainSize == 0)
+	{
+		grainSize = GetParallelGrainSize(threadPool, end - begin);
+	}
+	CTaskGroup taskGroup(threadPool);
+	for(size_t chunkBegin = begin; chunkBegin < end;)
+	{
+		size_t chunkEnd = chunkBegin + std::min(grainSize, end - chunkBegin);
+		taskGroup.Run([&function, chunkBegin, chunkEnd]() { function(chunkBegin, chunkEnd); });
+		chunkBegin = chunkEnd;
+	}
+	taskGroup.Wait();
+}
@@ -0,0 +1,474 @@
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include "ParallelGZipStream.h"
+#include "DeflateBackend.h"
+#include "HashUtils.h"
+#include "TaskGroup.h"
+#include "ThreadPool.h"
+
+using namespace Framework;
+
+namespace
+{
+	enum
+	{
+		//Same as htslib, guarantees that a block compressed at level 0 still fits
+		BLOCK_DATA_SIZE = 0xFF00,
+		MAX_BLOCK_SIZE = 0x10000,
+		BLOCK_HEADER_SIZE = 18,
+		MEMBER_HEADER_SIZE = 12,
+		BLOCK_FOOTER_SIZE = 8,
+		SEQUENTIAL_BUFFER_SIZE = 0x10000,
+		MAX_CHUNK_SIZE = 0x40000000,
+	};
+
+	//Gzip member header with an extra field holding the "BC" subfield, the block size is filled when writing
+	const uint8 g_blockHeader[BLOCK_HEADER_SIZE] =
+	{
+		0x1F, 0x8B, 0x08, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF, 0x06, 0x00, 'B', 'C', 0x02, 0x00, 0x00, 0x00
+	};
+
+	//Empty block marking the end of the data
+	const uint8 g_eofBlock[] =
+	{
+		0x1F, 0x8B, 0x08, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF, 0x06, 0x00, 'B', 'C', 0x02, 0x00, 0x1B, 0x00,
+		0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+	};
+
+	//Keeps all threads busy while blocks are gathered
+	size_t GetBatchSize(CThreadPool* threadPool)
+	{
+		return threadPool ? std::max<size_t>(threadPool->GetThreadCount(), 1) * 2 : 1;
+	}
+
+	uint16 GetUint16(const uint8* data)
+	{
+		return static_cast<uint16>(data[0] | (data[1] << 8));
+	}
+
+	uint32 GetUint32(const uint8* data)
+	{
+		return data[0] | (data[1] << 8) | (data[2] << 16) | (static_cast<uint32>(data[3]) << 24);
+	}
+
+	void SetUint32(uint8* data, uint32 value)
+	{
+		data[0] = static_cast<uint8>(value);
+		data[1] = static_cast<uint8>(value >> 8);
+		data[2] = static_cast<uint8>(value >> 16);
+		data[3] = static_cast<uint8>(value >> 24);
+	}
+}
+
+CParallelGZipWriteStream::CParallelGZipWriteStream(CStream& stream, CThreadPool* threadPool, int level)
+: m_stream(stream)
+, m_threadPool(threadPool)
+, m_level(level)
+{
+	m_blocks.resize(GetBatchSize(m_threadPool));
+}
+
+CParallelGZipWriteStream::~CParallelGZipWriteStream()
+{
+	try
+	{
+		WriteBlocks();
+		m_stream.Write(g_eofBlock, sizeof(g_eofBlock));
+	}
+	catch(...)
+	{
+
+	}
+}
+
+void CParallelGZipWriteStream::Seek(int64, STREAM_SEEK_DIRECTION)
+{
+	throw std::runtime_error("Unsupported operation.");
+}
+
+uint64 CParallelGZipWriteStream::Tell()
+{
+	return m_position;
+}
+
+uint64 CParallelGZipWriteStream::Read(void*, uint64)
+{
+	throw std::runtime_error("Unsupported operation.");
+}
+
+uint64 CParallelGZipWriteStream::Write(const void* buffer, uint64 size)
+{
+	auto data = reinterpret_cast<const uint8*>(buffer);
+	uint64 remaining = size;
+	while(remaining != 0)
+	{
+		auto& input = m_blocks[m_blockCount].input;
+		size_t amount = static_cast<size_t>(std::min<uint64>(remaining, BLOCK_DATA_SIZE - input.size()));
+		input.insert(input.end(), data, data + amount);
+		data += amount;
+		remaining -= amount;
+		if(input.size() == BLOCK_DATA_SIZE)
+		{
+			m_blockCount++;
+			if(m_blockCount == m_blocks.size())
+			{
+				WriteBlocks();
+			}
+		}
+	}
+	m_position += size;
+	return size;
+}
+
+bool CParallelGZipWriteStream::IsEOF()
+{
+	return false;
+}
+
+void CParallelGZipWriteStream::Flush()
+{
+	WriteBlocks();
+	m_stream.Flush();
+}
+
+void CParallelGZipWriteStream::WriteBlocks()
+{
+	//Block being filled is included if it has data
+	size_t blockCount = m_blockCount;
+	if((blockCount < m_blocks.size()) && !m_blocks[blockCount].input.empty())
+	{
+		blockCount++;
+	}
+	if(blockCount == 0) return;
+
+	CTaskGroup taskGroup(m_threadPool);
+	for(size_t i = 0; i < blockCount; i++)
+	{
+		auto& block = m_blocks[i];
+		int level = m_level;
+		taskGroup.Run([&block, level] () { CompressBlock(block, level); });
+	}
+	taskGroup.Wait();
+
+	for(size_t i = 0; i < blockCount; i++)
+	{
+		auto& block = m_blocks[i];
+		m_stream.Write(block.output.data(), block.output.size());
+		block.input.clear();
+	}
+	m_blockCount = 0;
+}
+
+void CParallelGZipWriteStream::CompressBlock(BLOCK& block, int level)
+{
+	block.output.resize(MAX_BLOCK_SIZE);
+
+	auto compressor = Deflate::CreateCompressor(level);
+	const uint8* input = block.input.data();
+	size_t inputSize = block.input.size();
+	uint8* compressedOutput = block.output.data() + BLOCK_HEADER_SIZE;
+	size_t outputCapacity = MAX_BLOCK_SIZE - BLOCK_HEADER_SIZE - BLOCK_FOOTER_SIZE;
+	size_t outputSize = outputCapacity;
+	//Stops once the output is full
+	bool isEnd = false;
+	while(!isEnd && (outputSize != 0))
+	{
+		isEnd = compressor->Compress(input, inputSize, compressedOutput, outputSize, true);
+	}
+	size_t compressedSize = outputCapacity - outputSize;
+	if(!isEnd)
+	{
+		//Data expanded too much, storing it always fits
+		if(level == 0)
+		{
+			throw std::runtime_error("Error occured while deflating.");
+		}
+		CompressBlock(block, 0);
+		return;
+	}
+
+	size_t blockSize = BLOCK_HEADER_SIZE + compressedSize + BLOCK_FOOTER_SIZE;
+	uint8* output = block.output.data();
+	memcpy(output, g_blockHeader, BLOCK_HEADER_SIZE);
+	output[16] = static_cast<uint8>(blockSize - 1);
+	output[17] = static_cast<uint8>((blockSize - 1) >> 8);
+
+	uint8* footer = output + BLOCK_HEADER_SIZE + compressedSize;
+	SetUint32(footer + 0, HashUtils::ComputeCrc32(block.input.data(), block.input.size()));
+	SetUint32(footer + 4, static_cast<uint32>(block.input.size()));
+	block.output.resize(blockSize);
+}
+
+CParallelGZipReadStream::CParallelGZipReadStream(CStream& stream, CThreadPool* threadPool)
+: m_stream(stream)
+, m_threadPool(threadPool)
+{
+	memset(&m_zStream, 0, sizeof(z_stream));
+
+	//Look for the BGZF extra field in the first member
+	uint64 start = m_stream.Tell();
+	BLOCK block;
+	try
+	{
+		m_isBlockParallel = ReadRawBlock(block);
+	}
+	catch(const std::exception&)
+	{
+		m_isBlockParallel = false;
+	}
+	m_stream.Seek(start, STREAM_SEEK_SET);
+
+	if(m_isBlockParallel)
+	{
+		m_blocks.resize(GetBatchSize(m_threadPool));
+	}
+}
+
+CParallelGZipReadStream::~CParallelGZipReadStream()
+{
+	if(m_isInflating)
+	{
+		inflateEnd(&m_zStream);
+	}
+}
+
+void CParallelGZipReadStream::Seek(int64, STREAM_SEEK_DIRECTION)
+{
+	throw std::runtime_error("Unsupported operation.");
+}
+
+uint64 CParallelGZipReadStream::Tell()
+{
+	return m_position;
+}
+
+uint64 CParallelGZipReadStream::Read(void* buffer, uint64 size)
+{
+	if(!m_isBlockParallel)
+	{
+		uint64 amountRead = InflateSequential(buffer, size);
+		m_position += amountRead;
+		return amountRead;
+	}
+
+	auto data = reinterpret_cast<uint8*>(buffer);
+	uint64 remaining = size;
+	while((remaining != 0) && !m_isEof)
+	{
+		if(m_blockIndex == m_blockCount)
+		{
+			if(!FillBlocks())
+			{
+				m_isEof = true;
+				break;
+			}
+		}
+		const auto& output = m_blocks[m_blockIndex].output;
+		size_t amount = static_cast<size_t>(std::min<uint64>(remaining, output.size() - m_blockPosition));
+		memcpy(data, output.data() + m_blockPosition, amount);
+		data += amount;
+		remaining -= amount;
+		m_blockPosition += amount;
+		if(m_blockPosition == output.size())
+		{
+			m_blockIndex++;
+			m_blockPosition = 0;
+		}
+	}
+	uint64 amountRead = size - remaining;
+	m_position += amountRead;
+	return amountRead;
+}
+
+uint64 CParallelGZipReadStream::Write(const void*, uint64)
+{
+	throw std::runtime_error("Unsupported operation.");
+}
+
+bool CParallelGZipReadStream::IsEOF()
+{
+	return m_isEof;
+}
+
+bool CParallelGZipReadStream::IsBlockParallel() const
+{
+	return m_isBlockParallel;
+}
+
+//Reads a complete block, returns false at the end of the stream
+bool CParallelGZipReadStream::ReadRawBlock(BLOCK& block)
+{
+	uint8 header[MEMBER_HEADER_SIZE];
+	uint64 amountRead = m_stream.Read(header, MEMBER_HEADER_SIZE);
+	if(amountRead == 0)
+	{
+		return false;
+	}
+	if((amountRead != MEMBER_HEADER_SIZE) || (header[0] != 0x1F) || (header[1] != 0x8B) || (header[2] != 0x08) || !(header[3] & 0x04))
+	{
+		throw std::runtime_error("Invalid BGZF block.");
+	}
+
+	uint16 extraSize = GetUint16(header + 10);
+	block.input.resize(MEMBER_HEADER_SIZE + extraSize);
+	memcpy(block.input.data(), header, MEMBER_HEADER_SIZE);
+	uint8* extra = block.input.data() + MEMBER_HEADER_SIZE;
+	if(m_stream.Read(extra, extraSize) != extraSize)
+	{
+		throw std::runtime_error("Invalid BGZF block.");
+	}
+
+	size_t blockSize = 0;
+	for(size_t offset = 0; (offset + 4) <= extraSize;)
+	{
+		uint16 subfieldSize = GetUint16(extra + offset + 2);
+		if((extra[offset] == 'B') && (extra[offset + 1] == 'C') && (subfieldSize == 2) && ((offset + 6) <= extraSize))
+		{
+			blockSize = GetUint16(extra + offset + 4) + 1;
+			break;
+		}
+		offset += 4 + subfieldSize;
+	}
+	size_t dataOffset = MEMBER_HEADER_SIZE + extraSize;
+	if(blockSize < (dataOffset + BLOCK_FOOTER_SIZE))
+	{
+		throw std::runtime_error("Invalid BGZF block.");
+	}
+
+	block.input.resize(blockSize);
+	size_t remaining = blockSize - dataOffset;
+	if(m_stream.Read(block.input.data() + dataOffset, remaining) != remaining)
+	{
+		throw std::runtime_error("Invalid BGZF block.");
+	}
+	return true;
+}
+
+bool CParallelGZipReadStream::FillBlocks()
+{
+	m_blockCount = 0;
+	m_blockIndex = 0;
+	m_blockPosition = 0;
+	while((m_blockCount < m_blocks.size()) && ReadRawBlock(m_blocks[m_blockCount]))
+	{
+		m_blockCount++;
+	}
+	if(m_blockCount == 0)
+	{
+		return false;
+	}
+
+	CTaskGroup taskGroup(m_threadPool);
+	for(size_t i = 0; i < m_blockCount; i++)
+	{
+		auto& block = m_blocks[i];
+		taskGroup.Run([&block] () { DecompressBlock(block); });
+	}
+	taskGroup.Wait();
+	return true;
+}
+
+void CParallelGZipReadStream::DecompressBlock(BLOCK& block)
+{
+	const uint8* input = block.input.data();
+	size_t dataOffset = MEMBER_HEADER_SIZE + GetUint16(input + 10);
+	const uint8* footer = input + block.input.size() - BLOCK_FOOTER_SIZE;
+	uint32 crc = GetUint32(footer + 0);
+	uint32 uncompressedSize = GetUint32(footer + 4);
+	if(uncompressedSize > MAX_BLOCK_SIZE)
+	{
+		throw std::runtime_error("Invalid BGZF block.");
+	}
+	block.output.resize(uncompressedSize);
+
+	auto decompressor = Deflate::CreateDecompressor();
+	const uint8* data = input + dataOffset;
+	size_t dataSize = block.input.size() - dataOffset - BLOCK_FOOTER_SIZE;
+	uint8* output = block.output.data();
+	size_t outputSize = uncompressedSize;
+	bool isEnd = false;
+	while(!isEnd)
+	{
+		size_t previousDataSize = dataSize;
+		size_t previousOutputSize = outputSize;
+		isEnd = decompressor->Decompress(data, dataSize, output, outputSize);
+		if((dataSize == previousDataSize) && (outputSize == previousOutputSize))
+		{
+			break;
+		}
+	}
+	if(!isEnd || (outputSize != 0))
+	{
+		throw std::runtime_error("Error occured while inflating.");
+	}
+	if(HashUtils::ComputeCrc32(block.output.data(), uncompressedSize) != crc)
+	{
+		throw std::runtime_error("CRC mismatch in gzip block.");
+	}
+}
+
+uint64 CParallelGZipReadStream::InflateSequential(void* buffer, uint64 size)
+{
+	if(!m_isInflating)
+	{
+		if(inflateInit2(&m_zStream, MAX_WBITS + 16) != Z_OK)
+		{
+			throw std::runtime_error("zlib stream initialization error.");
+		}
+		m_isInflating = true;
+		m_inputBuffer.resize(SEQUENTIAL_BUFFER_SIZE);
+	}
+
+	m_zStream.next_out = reinterpret_cast<Bytef*>(buffer);
+	m_zStream.avail_out = 0;
+	uint64 remaining = size;
+	while(((m_zStream.avail_out != 0) || (remaining != 0)) && !m_isEof)
+	{
+		if(m_zStream.avail_out == 0)
+		{
+			uInt chunkSize = static_cast<uInt>(std::min<uint64>(remaining, MAX_CHUNK_SIZE));
+			m_zStream.avail_out = chunkSize;
+			remaining -= chunkSize;
+		}
+		if(m_zStream.avail_in == 0)
+		{
+			m_zStream.avail_in = static_cast<uInt>(m_stream.Read(m_inputBuffer.data(), m_inputBuffer.size()));
+			m_zStream.next_in = m_inputBuffer.data();
+			if(m_zStream.avail_in == 0)
+			{
+				if(!m_isMemberEnd)
+				{
+					throw std::runtime_error("Unexpected end of gzip stream.");
+				}
+				m_isEof = true;
+				break;
+			}
+		}
+
+		uInt availableIn = m_zStream.avail_in;
+		int ret = inflate(&m_zStream, Z_NO_FLUSH);
+		bool hasOutput = (m_position + size - remaining - m_zStream.avail_out) != 0;
+		if((ret == Z_DATA_ERROR) && m_isMemberEnd && hasOutput)
+		{
+			//Not a gzip member, ignore trailing data as gzip does
+			m_isEof = true;
+			break;
+		}
+		if((ret == Z_NEED_DICT) || (ret == Z_DATA_ERROR) || (ret == Z_MEM_ERROR))
+		{
+			throw std::runtime_error("Error occured while inflating.");
+		}
+		if(ret == Z_STREAM_END)
+		{
+			//Members are concatenated, start over with the next one
+			inflateReset(&m_zStream);
+			m_isMemberEnd = true;
+		}
+		else if(m_zStream.avail_in != availableIn)
+		{
+			m_isMemberEnd = false;
+		}
+	}
+	return size - remaining - m_zStream.avail_out;
+}
@@ -1,4 +1,5 @@
 #include <cassert>
+#include <cerrno>
 #include <stdexcept>
 #include <sys/types.h>
 #include <unistd.h>
@@ -6,6 +7,15 @@
 
 using namespace Framework;
 
+//64-bit variants are only needed where off_t can be 32-bit, other systems don't have them
+#if defined(__linux__)
+#define POSIX_PREAD pread64
+#define POSIX_PWRITE pwrite64
+#else
+#define POSIX_PREAD pread
+#define POSIX_PWRITE pwrite
+#endif
+
 CPosixFileStream::CPosixFileStream(const char* path, int flags)
 {
 	m_fd = open(path, flags);
@@ -85,3 +95,43 @@ void CPosixFileStream::Flush()
 {
 	throw std::runtime_error("Not implemented.");
 }
+
+bool CPosixFileStream::CanAccessAt() const
+{
+	return true;
+}
+
+uint64 CPosixFileStream::ReadAt(uint64 offset, void* buffer, uint64 length)
+{
+	auto output = reinterpret_cast<uint8*>(buffer);
+	uint64 total = 0;
+	while(total != length)
+	{
+		ssize_t result = POSIX_PREAD(m_fd, output + total, length - total, offset + total);
+		if(result < 0)
+		{
+			if(errno == EINTR) continue;
+			throw std::runtime_error("Read failed.");
+		}
+		if(result == 0) break;
+		total += result;
+	}
+	return total;
+}
+
+uint64 CPosixFileStream::WriteAt(uint64 offset, const void* buffer, uint64 length)
+{
+	auto input = reinterpret_cast<const uint8*>(buffer);
+	uint64 total = 0;
+	while(total != length)
+	{
+		ssize_t result = POSIX_PWRITE(m_fd, input + total, length - total, offset + total);
+		if(result < 0)
+		{
+			if(errno == EINTR) continue;
+			throw std::runtime_error("Write failed.");
+		}
+		total += result;
+	}
+	return total;
+}
@@ -56,6 +56,32 @@ uint64 CPtrStream::Read(void* buffer, uint64 size)
 	return size;
 }
 
+bool CPtrStream::CanAccessAt() const
+{
+	return true;
+}
+
+uint64 CPtrStream::ReadAt(uint64 offset, void* buffer, uint64 size)
+{
+	if(offset >= m_size) return 0;
+	if((offset + size) > m_size)
+	{
+		size = (m_size - offset);
+	}
+	memcpy(buffer, m_data + offset, (size_t)size);
+	return size;
+}
+
+const void* CPtrStream::GetData() const
+{
+	return m_data;
+}
+
+uint64 CPtrStream::GetSize() const
+{
+	return m_size;
+}
+
 uint64 CPtrStream::Write(const void*, uint64)
 {
 	//Operation not supported
@@ -0,0 +1,180 @@
+#include "Serialization.h"
+#include <cassert>
+#include <cstring>
+#include "EndianUtils.h"
+
+using namespace Framework;
+using namespace Framework::Serialization;
+
+CArchive::CArchive(CStream& stream, ENDIANNESS endianness)
+    : m_stream(stream)
+    , m_swap((endianness == ENDIANNESS_BIG) != CEndian::IsHostBigEndian())
+    , m_buffer(BUFFER_SIZE)
+{
+}
+
+bool CArchive::IsSwapping() const
+{
+	return m_swap;
+}
+
+void CArchive::SwapValues(void* output, const void* input, size_t count, size_t valueSize)
+{
+	switch(valueSize)
+	{
+	case 1:
+		if(output != input) memcpy(output, input, count);
+		break;
+	case 2:
+		CEndian::SwapArray16(output, input, count);
+		break;
+	case 4:
+		CEndian::SwapArray32(output, input, count);
+		break;
+	case 8:
+		CEndian::SwapArray64(output, input, count);
+		break;
+	default:
+		assert(false);
+		break;
+	}
+}
+
+//COutputArchive
+//---------------------------------------------------
+
+COutputArchive::COutputArchive(CStream& stream, ENDIANNESS endianness)
+    : CArchive(stream, endianness)
+{
+}
+
+COutputArchive::~COutputArchive()
+{
+	try
+	{
+		FlushBuffer();
+	}
+	catch(...)
+	{
+	}
+}
+
+void COutputArchive::ProcessBytes(void* data, size_t size)
+{
+	if(size > (BUFFER_SIZE - m_bufferPosition))
+	{
+		FlushBuffer();
+		if(size >= BUFFER_SIZE)
+		{
+			if(m_stream.Write(data, size) != size)
+			{
+				throw std::runtime_error("Failed to write archive data.");
+			}
+			return;
+		}
+	}
+	memcpy(m_buffer.data() + m_bufferPosition, data, size);
+	m_bufferPosition += size;
+}
+
+void COutputArchive::ProcessValues(void* values, size_t count, size_t valueSize)
+{
+	if(!m_swap || (valueSize == 1))
+	{
+		ProcessBytes(values, count * valueSize);
+		return;
+	}
+	//Swapped in the buffer, the source stays untouched
+	auto input = reinterpret_cast<const uint8*>(values);
+	while(count != 0)
+	{
+		size_t availableCount = (BUFFER_SIZE - m_bufferPosition) / valueSize;
+		if(availableCount == 0)
+		{
+			FlushBuffer();
+			continue;
+		}
+		size_t chunkCount = std::min(count, availableCount);
+		SwapValues(m_buffer.data() + m_bufferPosition, input, chunkCount, valueSize);
+		m_bufferPosition += chunkCount * valueSize;
+		input += chunkCount * valueSize;
+		count -= chunkCount;
+	}
+}
+
+void COutputArchive::Flush()
+{
+	FlushBuffer();
+	m_stream.Flush();
+}
+
+void COutputArchive::FlushBuffer()
+{
+	if(m_bufferPosition == 0) return;
+	size_t size = m_bufferPosition;
+	m_bufferPosition = 0;
+	if(m_stream.Write(m_buffer.data(), size) != size)
+	{
+		throw std::runtime_error("Failed to write archive data.");
+	}
+}
+
+//CInputArchive
+//---------------------------------------------------
+
+CInputArchive::CInputArchive(CStream& stream, ENDIANNESS endianness)
+    : CArchive(stream, endianness)
+{
+}
+
+CInputArchive::~CInputArchive()
+{
+	size_t unusedSize = m_bufferEnd - m_bufferPosition;
+	if(unusedSize == 0) return;
+	try
+	{
+		m_stream.Seek(-static_cast<int64>(unusedSize), STREAM_SEEK_CUR);
+	}
+	catch(...)
+	{
+	}
+}
+
+void CInputArchive::ProcessBytes(void* data, size_t size)
+{
+	auto output = reinterpret_cast<uint8*>(data);
+	size_t bufferedSize = std::min(size, m_bufferEnd - m_bufferPosition);
+	memcpy(output, m_buffer.data() + m_bufferPosition, bufferedSize);
+	m_bufferPosition += bufferedSize;
+	output += bufferedSize;
+	size -= bufferedSize;
+	if(size == 0) return;
+
+	//Buffer is empty at this point
+	m_bufferPosition = 0;
+	m_bufferEnd = 0;
+	if(size >= BUFFER_SIZE)
+	{
+		if(m_stream.Read(output, size) != size)
+		{
+			throw std::runtime_error("Unexpected end of archive data.");
+		}
+		return;
+	}
+	m_bufferEnd = m_stream.Read(m_buffer.data(), BUFFER_SIZE);
+	if(m_bufferEnd < size)
+	{
+		throw std::runtime_error("Unexpected end of archive data.");
+	}
+	memcpy(output, m_buffer.data(), size);
+	m_bufferPosition = size;
+}
+
+void CInputArchive::ProcessValues(void* values, size_t count, size_t valueSize)
+{
+	ProcessBytes(values, count * valueSize);
+	if(m_swap && (valueSize != 1))
+	{
+		SwapValues(values, values, count, valueSize);
+	}
+}
@@ -0,0 +1,617 @@
+#include "SharedMemoryStream.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <windows.h>
+#include "string_cast.h"
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__ANDROID__)
+#include <sys/ioctl.h>
+#include <linux/ashmem.h>
+#if __ANDROID_API__ >= 26
+#include <android/sharedmem.h>
+#endif
+#endif
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#elif !defined(_WIN32)
+#include <chrono>
+#include <thread>
+#endif
+
+using namespace Framework;
+
+//Lives in the first page of the shared memory, followed by the ring
+struct CSharedMemoryStream::HEADER
+{
+	std::atomic<uint32>	magic;
+	uint32				capacity;
+	std::atomic<uint32>	isProducerClosed;
+	std::atomic<uint32>	isConsumerClosed;
+
+	//Written by the producer, signal is bumped whenever data is committed
+	alignas(64) std::atomic<uint64>	writePosition;
+	std::atomic<uint32>	dataSignal;
+	std::atomic<uint32>	isConsumerWaiting;
+
+	//Written by the consumer, signal is bumped whenever data is released
+	alignas(64) std::atomic<uint64>	readPosition;
+	std::atomic<uint32>	roomSignal;
+	std::atomic<uint32>	isProducerWaiting;
+};
+
+//Both processes need to agree on the layout without any locking
+static_assert(std::atomic<uint32>::is_always_lock_free);
+static_assert(std::atomic<uint64>::is_always_lock_free);
+
+static const uint32 g_headerMagic = 0x52494E47;
+
+#if defined(__linux__)
+//Not using the private futex operations, waiters and wakers are in different processes
+static void FutexWait(std::atomic<uint32>& word, uint32 value)
+{
+	syscall(SYS_futex, reinterpret_cast<uint32*>(&word), FUTEX_WAIT, value, nullptr, nullptr, 0);
+}
+
+static void FutexWake(std::atomic<uint32>& word)
+{
+	syscall(SYS_futex, reinterpret_cast<uint32*>(&word), FUTEX_WAKE, 1, nullptr, nullptr, 0);
+}
+#endif
+
+static size_t GetAllocationGranularity()
+{
+#ifdef _WIN32
+	//Views of a mapping need to start on this boundary
+	SYSTEM_INFO systemInfo = {};
+	GetSystemInfo(&systemInfo);
+	return systemInfo.dwAllocationGranularity;
+#else
+	return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+CSharedMemoryStream::CSharedMemoryStream(const std::string& name, uint32 capacity, ROLE role)
+    : m_role(role)
+    , m_headerSize(GetAllocationGranularity())
+    , m_isCreator(true)
+{
+	static_assert(sizeof(HEADER) <= 0x1000);
+	if(capacity == 0)
+	{
+		throw std::runtime_error("Invalid capacity.");
+	}
+	uint64 alignedCapacity = ((static_cast<uint64>(capacity) + m_headerSize - 1) / m_headerSize) * m_headerSize;
+	if(alignedCapacity > UINT32_MAX)
+	{
+		throw std::runtime_error("Invalid capacity.");
+	}
+	CreateMapping(name, static_cast<uint32>(alignedCapacity));
+}
+
+CSharedMemoryStream::CSharedMemoryStream(const std::string& name, ROLE role)
+    : m_role(role)
+    , m_headerSize(GetAllocationGranularity())
+{
+	OpenMapping(name);
+}
+
+#ifndef _WIN32
+CSharedMemoryStream::CSharedMemoryStream(int fd, ROLE role)
+    : m_role(role)
+    , m_headerSize(GetAllocationGranularity())
+{
+	m_fd = dup(fd);
+	if(m_fd < 0)
+	{
+		throw std::runtime_error("Invalid file descriptor.");
+	}
+	try
+	{
+		MapExisting();
+	}
+	catch(...)
+	{
+		close(m_fd);
+		throw;
+	}
+}
+#endif
+
+CSharedMemoryStream::~CSharedMemoryStream()
+{
+	Close();
+	Unmap();
+#ifdef _WIN32
+	if(m_dataEvent) CloseHandle(m_dataEvent);
+	if(m_roomEvent) CloseHandle(m_roomEvent);
+	if(m_mapping) CloseHandle(m_mapping);
+#else
+	close(m_fd);
+#if !defined(__ANDROID__)
+	//Processes that already opened the ring keep it until they close it
+	if(m_isCreator)
+	{
+		shm_unlink(m_name.c_str());
+	}
+#endif
+#endif
+}
+
+uint32 CSharedMemoryStream::GetCapacity() const
+{
+	return m_capacity;
+}
+
+#ifndef _WIN32
+int CSharedMemoryStream::GetFileDescriptor() const
+{
+	return m_fd;
+}
+#endif
+
+uint8* CSharedMemoryStream::Reserve(uint32 size)
+{
+	CheckRole(ROLE_PRODUCER);
+	if(size > m_capacity)
+	{
+		throw std::runtime_error("Reserved size is larger than the ring.");
+	}
+	if(WaitForRoom(size) < size)
+	{
+		return nullptr;
+	}
+	m_reservedSize = size;
+	//Spans going past the end of the ring continue in its mirror
+	return m_ring + (m_position % m_capacity);
+}
+
+void CSharedMemoryStream::Commit(uint32 size)
+{
+	CheckRole(ROLE_PRODUCER);
+	if(size > m_reservedSize)
+	{
+		throw std::runtime_error("Committed size is larger than what was reserved.");
+	}
+	m_reservedSize = 0;
+	m_position += size;
+	m_header->writePosition.store(m_position);
+	WakePeer(true);
+}
+
+const uint8* CSharedMemoryStream::Acquire(uint32 size)
+{
+	CheckRole(ROLE_CONSUMER);
+	if(size > m_capacity)
+	{
+		throw std::runtime_error("Acquired size is larger than the ring.");
+	}
+	if(WaitForData(size) < size)
+	{
+		return nullptr;
+	}
+	return m_ring + (m_position % m_capacity);
+}
+
+void CSharedMemoryStream::Release(uint32 size)
+{
+	CheckRole(ROLE_CONSUMER);
+	if(size > (m_header->writePosition.load() - m_position))
+	{
+		throw std::runtime_error("Released size is larger than what was committed.");
+	}
+	m_position += size;
+	m_header->readPosition.store(m_position);
+	WakePeer(false);
+}
+
+uint32 CSharedMemoryStream::GetAvailableSize() const
+{
+	if(m_role == ROLE_PRODUCER)
+	{
+		return m_capacity - static_cast<uint32>(m_position - m_header->readPosition.load());
+	}
+	else
+	{
+		return static_cast<uint32>(m_header->writePosition.load() - m_position);
+	}
+}
+
+void CSharedMemoryStream::Close()
+{
+	if(m_isClosed || !m_header) return;
+	m_isClosed = true;
+	if(m_role == ROLE_PRODUCER)
+	{
+		m_header->isProducerClosed.store(1);
+		WakePeer(true);
+	}
+	else
+	{
+		m_header->isConsumerClosed.store(1);
+		WakePeer(false);
+	}
+}
+
+void CSharedMemoryStream::Seek(int64, STREAM_SEEK_DIRECTION)
+{
+	throw std::runtime_error("Operation not supported.");
+}
+
+uint64 CSharedMemoryStream::Tell()
+{
+	return m_position;
+}
+
+uint64 CSharedMemoryStream::Read(void* buffer, uint64 size)
+{
+	CheckRole(ROLE_CONSUMER);
+	auto output = reinterpret_cast<uint8*>(buffer);
+	uint64 readSize = 0;
+	while(readSize != size)
+	{
+		uint32 availableSize = WaitForData(1);
+		if(availableSize == 0)
+		{
+			m_isEof = true;
+			break;
+		}
+		uint32 copySize = static_cast<uint32>(std::min<uint64>(availableSize, size - readSize));
+		memcpy(output + readSize, m_ring + (m_position % m_capacity), copySize);
+		readSize += copySize;
+		Release(copySize);
+	}
+	return readSize;
+}
+
+uint64 CSharedMemoryStream::Write(const void* buffer, uint64 size)
+{
+	CheckRole(ROLE_PRODUCER);
+	auto input = reinterpret_cast<const uint8*>(buffer);
+	uint64 writeSize = 0;
+	while(writeSize != size)
+	{
+		uint32 roomSize = WaitForRoom(1);
+		if(roomSize == 0)
+		{
+			break;
+		}
+		uint32 copySize = static_cast<uint32>(std::min<uint64>(roomSize, size - writeSize));
+		memcpy(m_ring + (m_position % m_capacity), input + writeSize, copySize);
+		writeSize += copySize;
+		m_reservedSize = copySize;
+		Commit(copySize);
+	}
+	return writeSize;
+}
+
+bool CSharedMemoryStream::IsEOF()
+{
+	return m_isEof;
+}
+
+void CSharedMemoryStream::CreateMapping(const std::string& name, uint32 capacity)
+{
+	uint64 totalSize = m_headerSize + static_cast<uint64>(capacity);
+#ifdef _WIN32
+	auto wideName = string_cast<std::wstring>(name);
+	m_mapping = CreateFileMappingW(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+	                               static_cast<DWORD>(totalSize >> 32), static_cast<DWORD>(totalSize), wideName.c_str());
+	if(m_mapping == NULL)
+	{
+		throw std::runtime_error("Failed to create shared memory.");
+	}
+	if(GetLastError() == ERROR_ALREADY_EXISTS)
+	{
+		CloseHandle(m_mapping);
+		throw std::runtime_error("Shared memory already exists.");
+	}
+	m_dataEvent = CreateEventW(NULL, FALSE, FALSE, (wideName + L"_data").c_str());
+	m_roomEvent = CreateEventW(NULL, FALSE, FALSE, (wideName + L"_room").c_str());
+	if((m_dataEvent == NULL) || (m_roomEvent == NULL))
+	{
+		if(m_dataEvent) CloseHandle(m_dataEvent);
+		if(m_roomEvent) CloseHandle(m_roomEvent);
+		CloseHandle(m_mapping);
+		throw std::runtime_error("Failed to create shared memory events.");
+	}
+#elif defined(__ANDROID__)
+	//Name is only used to identify the region in the memory maps
+#if __ANDROID_API__ >= 26
+	m_fd = ASharedMemory_create(name.c_str(), static_cast<size_t>(totalSize));
+#else
+	m_fd = open("/dev/ashmem", O_RDWR);
+	if(m_fd >= 0)
+	{
+		if((ioctl(m_fd, ASHMEM_SET_NAME, name.c_str()) < 0) || (ioctl(m_fd, ASHMEM_SET_SIZE, static_cast<size_t>(totalSize)) < 0))
+		{
+			close(m_fd);
+			m_fd = -1;
+		}
+	}
+#endif
+	if(m_fd < 0)
+	{
+		throw std::runtime_error("Failed to create shared memory.");
+	}
+#else
+	m_name = (!name.empty() && (name[0] == '/')) ? name : ("/" + name);
+	m_fd = shm_open(m_name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+	if(m_fd < 0)
+	{
+		throw std::runtime_error("Failed to create shared memory.");
+	}
+	if(ftruncate(m_fd, static_cast<off_t>(totalSize)) < 0)
+	{
+		close(m_fd);
+		shm_unlink(m_name.c_str());
+		throw std::runtime_error("Failed to set shared memory size.");
+	}
+#endif
+	try
+	{
+		MapRing(capacity);
+	}
+	catch(...)
+	{
+#ifdef _WIN32
+		CloseHandle(m_dataEvent);
+		CloseHandle(m_roomEvent);
+		CloseHandle(m_mapping);
+#else
+		close(m_fd);
+#if !defined(__ANDROID__)
+		shm_unlink(m_name.c_str());
+#endif
+#endif
+		throw;
+	}
+	//New shared memory is zeroed, magic goes last to tell openers the header is ready
+	new(m_header) HEADER();
+	m_header->capacity = capacity;
+	m_header->magic.store(g_headerMagic);
+}
+
+void CSharedMemoryStream::OpenMapping(const std::string& name)
+{
+#ifdef _WIN32
+	auto wideName = string_cast<std::wstring>(name);
+	m_mapping = OpenFileMappingW(FILE_MAP_ALL_ACCESS, FALSE, wideName.c_str());
+	if(m_mapping == NULL)
+	{
+		throw std::runtime_error("Failed to open shared memory.");
+	}
+	m_dataEvent = CreateEventW(NULL, FALSE, FALSE, (wideName + L"_data").c_str());
+	m_roomEvent = CreateEventW(NULL, FALSE, FALSE, (wideName + L"_room").c_str());
+	try
+	{
+		if((m_dataEvent == NULL) || (m_roomEvent == NULL))
+		{
+			throw std::runtime_error("Failed to open shared memory events.");
+		}
+		MapExisting();
+	}
+	catch(...)
+	{
+		if(m_dataEvent) CloseHandle(m_dataEvent);
+		if(m_roomEvent) CloseHandle(m_roomEvent);
+		CloseHandle(m_mapping);
+		throw;
+	}
+#elif defined(__ANDROID__)
+	throw std::runtime_error("Shared memory can't be opened by name on this platform, use its file descriptor.");
+#else
+	m_name = (!name.empty() && (name[0] == '/')) ? name : ("/" + name);
+	m_fd = shm_open(m_name.c_str(), O_RDWR, 0);
+	if(m_fd < 0)
+	{
+		throw std::runtime_error("Failed to open shared memory.");
+	}
+	try
+	{
+		MapExisting();
+	}
+	catch(...)
+	{
+		close(m_fd);
+		throw;
+	}
+#endif
+}
+
+void CSharedMemoryStream::MapExisting()
+{
+	//Capacity is read from the header before mapping the whole ring
+	uint32 capacity = 0;
+#ifdef _WIN32
+	auto header = reinterpret_cast<const HEADER*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, m_headerSize));
+	if(header == nullptr)
+	{
+		throw std::runtime_error("Failed to map shared memory.");
+	}
+	bool isValid = (header->magic.load() == g_headerMagic);
+	capacity = header->capacity;
+	UnmapViewOfFile(header);
+#else
+	void* headerData = mmap(nullptr, m_headerSize, PROT_READ, MAP_SHARED, m_fd, 0);
+	if(headerData == MAP_FAILED)
+	{
+		throw std::runtime_error("Failed to map shared memory.");
+	}
+	auto header = reinterpret_cast<const HEADER*>(headerData);
+	bool isValid = (header->magic.load() == g_headerMagic);
+	capacity = header->capacity;
+	munmap(headerData, m_headerSize);
+#endif
+	if(!isValid || (capacity == 0) || ((capacity % m_headerSize) != 0))
+	{
+		throw std::runtime_error("Shared memory doesn't hold a ring.");
+	}
+	MapRing(capacity);
+}
+
+void CSharedMemoryStream::MapRing(uint32 capacity)
+{
+	//Header, ring and a second view of the ring right after it
+	size_t mirrorSize = m_headerSize + (2 * static_cast<size_t>(capacity));
+#ifdef _WIN32
+	for(unsigned int attempt = 0; attempt < 16; attempt++)
+	{
+		auto address = reinterpret_cast<uint8*>(VirtualAlloc(NULL, mirrorSize, MEM_RESERVE, PAGE_NOACCESS));
+		if(address == nullptr)
+		{
+			break;
+		}
+		VirtualFree(address, 0, MEM_RELEASE);
+		//Another thread could take the range before it's mapped, another one is picked if it happens
+		auto view = reinterpret_cast<uint8*>(MapViewOfFileEx(m_mapping, FILE_MAP_ALL_ACCESS, 0, 0, m_headerSize + capacity, address));
+		if(view == nullptr)
+		{
+			continue;
+		}
+		auto mirrorView = MapViewOfFileEx(m_mapping, FILE_MAP_ALL_ACCESS, 0, static_cast<DWORD>(m_headerSize), capacity, view + m_headerSize + capacity);
+		if(mirrorView == nullptr)
+		{
+			UnmapViewOfFile(view);
+			continue;
+		}
+		m_header = reinterpret_cast<HEADER*>(view);
+		m_ring = view + m_headerSize;
+		m_capacity = capacity;
+		return;
+	}
+	throw std::runtime_error("Failed to map shared memory.");
+#else
+	//Reserves the whole range first, the views replace parts of it
+	void* reservation = mmap(nullptr, mirrorSize, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if(reservation == MAP_FAILED)
+	{
+		throw std::runtime_error("Failed to map shared memory.");
+	}
+	auto base = reinterpret_cast<uint8*>(reservation);
+	if((mmap(base, m_headerSize + capacity, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, m_fd, 0) == MAP_FAILED) ||
+	   (mmap(base + m_headerSize + capacity, capacity, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, m_fd, m_headerSize) == MAP_FAILED))
+	{
+		munmap(reservation, mirrorSize);
+		throw std::runtime_error("Failed to map shared memory.");
+	}
+	m_header = reinterpret_cast<HEADER*>(base);
+	m_ring = base + m_headerSize;
+	m_capacity = capacity;
+#endif
+}
+
+void CSharedMemoryStream::Unmap()
+{
+	if(!m_header) return;
+#ifdef _WIN32
+	UnmapViewOfFile(m_ring + m_capacity);
+	UnmapViewOfFile(m_header);
+#else
+	munmap(m_header, m_headerSize + (2 * static_cast<size_t>(m_capacity)));
+#endif
+	m_header = nullptr;
+	m_ring = nullptr;
+}
+
+//Returns the amount of data that can be read, less than 'size' only if the producer closed the ring
+uint32 CSharedMemoryStream::WaitForData(uint32 size)
+{
+	while(true)
+	{
+		bool isProducerClosed = (m_header->isProducerClosed.load() != 0);
+		uint32 availableSize = static_cast<uint32>(m_header->writePosition.load() - m_position);
+		//Producer commits everything before closing, nothing more can come once it's closed
+		if((availableSize >= size) || isProducerClosed)
+		{
+			return availableSize;
+		}
+		uint32 signal = m_header->dataSignal.load();
+		m_header->isConsumerWaiting.store(1);
+		//Checked again now that the producer knows it needs to wake us up
+		if(((m_header->writePosition.load() - m_position) >= size) || m_header->isProducerClosed.load())
+		{
+			m_header->isConsumerWaiting.store(0);
+			continue;
+		}
+#if defined(__linux__)
+		FutexWait(m_header->dataSignal, signal);
+#elif defined(_WIN32)
+		(void)signal;
+		WaitForSingleObject(m_dataEvent, INFINITE);
+#else
+		(void)signal;
+		std::this_thread::sleep_for(std::chrono::microseconds(100));
+#endif
+	}
+}
+
+//Returns the amount of room available for writing, 0 if the consumer closed the ring
+uint32 CSharedMemoryStream::WaitForRoom(uint32 size)
+{
+	while(true)
+	{
+		if(m_header->isConsumerClosed.load())
+		{
+			return 0;
+		}
+		uint32 roomSize = m_capacity - static_cast<uint32>(m_position - m_header->readPosition.load());
+		if(roomSize >= size)
+		{
+			return roomSize;
+		}
+		uint32 signal = m_header->roomSignal.load();
+		m_header->isProducerWaiting.store(1);
+		if(((m_capacity - (m_position - m_header->readPosition.load())) >= size) || m_header->isConsumerClosed.load())
+		{
+			m_header->isProducerWaiting.store(0);
+			continue;
+		}
+#if defined(__linux__)
+		FutexWait(m_header->roomSignal, signal);
+#elif defined(_WIN32)
+		(void)signal;
+		WaitForSingleObject(m_roomEvent, INFINITE);
+#else
+		(void)signal;
+		std::this_thread::sleep_for(std::chrono::microseconds(100));
+#endif
+	}
+}
+
+void CSharedMemoryStream::WakePeer(bool isDataSignal)
+{
+	auto& signal = isDataSignal ? m_header->dataSignal : m_header->roomSignal;
+	auto& isWaiting = isDataSignal ? m_header->isConsumerWaiting : m_header->isProducerWaiting;
+	signal.fetch_add(1);
+	//Only goes through the kernel if the other side is asleep (or about to be)
+	if(isWaiting.exchange(0) == 0)
+	{
+		return;
+	}
+#if defined(__linux__)
+	FutexWake(signal);
+#elif defined(_WIN32)
+	SetEvent(isDataSignal ? m_dataEvent : m_roomEvent);
+#endif
+}
+
+void CSharedMemoryStream::CheckRole(ROLE role) const
+{
+	if(m_role != role)
+	{
+		throw std::runtime_error("Operation not available on this side of the stream.");
+	}
+}
@@ -2,6 +2,21 @@
 #include <stdexcept>
 #include <mutex>
 #include <cassert>
+#include <cerrno>
+#include <vector>
+#include <algorithm>
+#include "StdStream.h"
+
+#ifndef _WIN32
+#include <netinet/tcp.h>
+#endif
+
+#if defined(__linux__)
+#include <sys/sendfile.h>
+#elif defined(__APPLE__)
+#include <sys/types.h>
+#include <sys/uio.h>
+#endif
 
 using namespace Framework;
 
@@ -62,6 +77,65 @@ bool CSocketRefStream::IsEOF()
 	return m_isEof;
 }
 
+void CSocketRefStream::SetNoDelay(bool noDelay)
+{
+	int value = noDelay ? 1 : 0;
+	setsockopt(m_fd, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+uint64 CSocketRefStream::SendFile(CStream& file, uint64 offset, uint64 length)
+{
+	uint64 total = 0;
+#if defined(__linux__) || defined(__APPLE__)
+	if(auto stdStream = dynamic_cast<CStdStream*>(&file))
+	{
+		int fileFd = fileno(static_cast<FILE*>(*stdStream));
+		while(total != length)
+		{
+#if defined(__linux__)
+			off_t fileOffset = offset + total;
+			auto result = sendfile(m_fd, fileFd, &fileOffset, length - total);
+			if(result < 0)
+			{
+				throw std::runtime_error("Socket sendfile failed.");
+			}
+			if(result == 0) break;
+			total += result;
+#else
+			off_t sent = length - total;
+			auto result = sendfile(fileFd, m_fd, offset + total, &sent, nullptr, 0);
+			if((result < 0) && (errno != EAGAIN) && (errno != EINTR))
+			{
+				throw std::runtime_error("Socket sendfile failed.");
+			}
+			if(sent == 0) break;
+			total += sent;
+#endif
+		}
+		return total;
+	}
+#endif
+	//Generic path, copy through a temporary buffer
+	std::vector<uint8> buffer(static_cast<size_t>(std::min<uint64>(length, 0x10000)));
+	if(!file.CanAccessAt())
+	{
+		file.Seek(offset, STREAM_SEEK_SET);
+	}
+	while(total != length)
+	{
+		uint64 chunkSize = std::min<uint64>(buffer.size(), length - total);
+		uint64 amountRead = file.CanAccessAt() ? file.ReadAt(offset + total, buffer.data(), chunkSize) : file.Read(buffer.data(), chunkSize);
+		if(amountRead == 0) break;
+		uint64 amountWritten = 0;
+		while(amountWritten != amountRead)
+		{
+			amountWritten += Write(buffer.data() + amountWritten, amountRead - amountWritten);
+		}
+		total += amountRead;
+	}
+	return total;
+}
+
 CSocketStream::CSocketStream(SOCKET fd)
     : CSocketRefStream(fd)
 {
@@ -75,3 +149,28 @@ CSocketStream::~CSocketStream()
 	close(m_fd);
 #endif
 }
+
+CBufferedSocketStream::CBufferedSocketStream(SOCKET fd, size_t bufferSize)
+    : CBufferedStream(m_socketStream, bufferSize)
+    , m_socketStream(fd)
+{
+	m_socketStream.SetNoDelay(true);
+}
+
+CBufferedSocketStream::~CBufferedSocketStream()
+{
+	//Socket goes away before our base, make sure it isn't used anymore
+	try
+	{
+		Flush();
+	}
+	catch(...)
+	{
+	}
+}
+
+uint64 CBufferedSocketStream::SendFile(CStream& file, uint64 offset, uint64 length)
+{
+	Flush();
+	return m_socketStream.SendFile(file, offset, length);
+}
@@ -0,0 +1,127 @@
+#include "StartupProfiler.h"
+#include <algorithm>
+#include <chrono>
+#include "string_format.h"
+
+using namespace Framework;
+
+static const uint32 g_noThreadIndex = ~0U;
+static thread_local uint32 g_threadIndex = g_noThreadIndex;
+static thread_local uint32 g_threadDepth = 0;
+
+static uint64 GetSteadyTime()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+CStartupProfiler::CStartupProfiler()
+: m_baseTime(GetSteadyTime())
+, m_recording(true)
+, m_finishTime(0)
+{
+}
+
+uint64 CStartupProfiler::GetTime() const
+{
+	return GetSteadyTime() - m_baseTime;
+}
+
+bool CStartupProfiler::IsRecording() const
+{
+	return m_recording.load(std::memory_order_relaxed);
+}
+
+void CStartupProfiler::Record(std::string name, uint32 depth, uint64 beginTime, uint64 endTime)
+{
+	std::lock_guard<std::mutex> lock(m_phasesMutex);
+	//Phases that end after Finish are dropped, the timeline stops there
+	if(!IsRecording())
+	{
+		return;
+	}
+	if(g_threadIndex == g_noThreadIndex)
+	{
+		g_threadIndex = m_threadCount++;
+	}
+	PHASE phase;
+	phase.name = std::move(name);
+	phase.threadIndex = g_threadIndex;
+	phase.depth = depth;
+	phase.beginTime = beginTime;
+	phase.endTime = endTime;
+	m_phases.push_back(std::move(phase));
+}
+
+void CStartupProfiler::Finish()
+{
+	std::lock_guard<std::mutex> lock(m_phasesMutex);
+	if(!IsRecording())
+	{
+		return;
+	}
+	m_finishTime.store(GetTime(), std::memory_order_relaxed);
+	m_recording.store(false, std::memory_order_relaxed);
+}
+
+uint64 CStartupProfiler::GetFinishTime() const
+{
+	return m_finishTime.load(std::memory_order_relaxed);
+}
+
+CStartupProfiler::PhaseArray CStartupProfiler::GetPhases() const
+{
+	PhaseArray phases;
+	{
+		std::lock_guard<std::mutex> lock(m_phasesMutex);
+		phases = m_phases;
+	}
+	//Nested phases are recorded before their parent, parents come first when they begin at the same time
+	std::stable_sort(std::begin(phases), std::end(phases),
+	                 [](const PHASE& lhs, const PHASE& rhs) {
+		                 if(lhs.beginTime != rhs.beginTime) return lhs.beginTime < rhs.beginTime;
+		                 return lhs.depth < rhs.depth;
+	                 });
+	return phases;
+}
+
+std::string CStartupProfiler::FormatTimeline() const
+{
+	std::string result;
+	for(const auto& phase : GetPhases())
+	{
+		uint64 duration = phase.endTime - phase.beginTime;
+		string_format_to(result, FORMAT_STRING("{:>6}.{:03} ms +{:>6}.{:03} ms [thread {}] "),
+		                 phase.beginTime / 1000000, (phase.beginTime / 1000) % 1000,
+		                 duration / 1000000, (duration / 1000) % 1000, phase.threadIndex);
+		result.append(phase.depth * 2, ' ');
+		result += phase.name;
+		result += '\n';
+	}
+	uint64 finishTime = GetFinishTime();
+	if(finishTime != 0)
+	{
+		string_format_to(result, FORMAT_STRING("{:>6}.{:03} ms finished\n"), finishTime / 1000000, (finishTime / 1000) % 1000);
+	}
+	return result;
+}
+
+CStartupPhase::CStartupPhase(const char* name)
+{
+	auto& profiler = CStartupProfiler::GetInstance();
+	if(profiler.IsRecording())
+	{
+		m_name = name;
+		m_depth = g_threadDepth++;
+		m_beginTime = profiler.GetTime();
+	}
+}
+
+CStartupPhase::~CStartupPhase()
+{
+	if(m_name)
+	{
+		g_threadDepth--;
+		auto& profiler = CStartupProfiler::GetInstance();
+		profiler.Record(m_name, m_depth, m_beginTime, profiler.GetTime());
+	}
+}
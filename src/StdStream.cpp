@@ -2,6 +2,13 @@
 #include <assert.h>
 #include <stdexcept>
 #include "maybe_unused.h"
+#ifdef _WIN32
+#include <windows.h>
+#include <io.h>
+#else
+#include <errno.h>
+#include <unistd.h>
+#endif
 
 using namespace Framework;
 
@@ -125,6 +132,8 @@ uint64 CStdStream::Read(void* pBuffer, uint64 nLength)
 uint64 CStdStream::Write(const void* pBuffer, uint64 nLength)
 {
 	assert(m_file != nullptr);
+	//Empty buffers can have a null pointer, fwrite doesn't allow it
+	if(nLength == 0) return 0;
 	return fwrite(pBuffer, 1, (size_t)nLength, m_file);
 }
 
@@ -134,6 +143,83 @@ void CStdStream::Flush()
 	fflush(m_file);
 }
 
+bool CStdStream::CanAccessAt() const
+{
+	assert(m_file != nullptr);
+	//Pipes and terminals can't be accessed at arbitrary positions
+#ifdef _WIN32
+	auto handle = reinterpret_cast<HANDLE>(_get_osfhandle(_fileno(m_file)));
+	return (GetFileType(handle) == FILE_TYPE_DISK);
+#else
+	return (lseek(fileno(m_file), 0, SEEK_CUR) != -1);
+#endif
+}
+
+uint64 CStdStream::ReadAt(uint64 offset, void* buffer, uint64 length)
+{
+	assert(m_file != nullptr);
+#ifdef _WIN32
+	//Seek and restore while holding the stream lock
+	_lock_file(m_file);
+	auto position = _ftelli64(m_file);
+	_fseeki64(m_file, offset, SEEK_SET);
+	auto result = fread(buffer, 1, (size_t)length, m_file);
+	clearerr(m_file);
+	_fseeki64(m_file, position, SEEK_SET);
+	_unlock_file(m_file);
+	return result;
+#else
+	//pread goes straight to the descriptor, pending writes need to reach it first
+	fflush(m_file);
+	int fd = fileno(m_file);
+	auto output = reinterpret_cast<uint8*>(buffer);
+	uint64 total = 0;
+	while(total != length)
+	{
+		ssize_t result = pread(fd, output + total, length - total, offset + total);
+		if(result < 0)
+		{
+			if(errno == EINTR) continue;
+			throw std::runtime_error("Read failed.");
+		}
+		if(result == 0) break;
+		total += result;
+	}
+	return total;
+#endif
+}
+
+uint64 CStdStream::WriteAt(uint64 offset, const void* buffer, uint64 length)
+{
+	assert(m_file != nullptr);
+#ifdef _WIN32
+	_lock_file(m_file);
+	auto position = _ftelli64(m_file);
+	_fseeki64(m_file, offset, SEEK_SET);
+	auto result = fwrite(buffer, 1, (size_t)length, m_file);
+	_fseeki64(m_file, position, SEEK_SET);
+	_unlock_file(m_file);
+	return result;
+#else
+	//Keeps data written through the stdio buffer from landing after this
+	fflush(m_file);
+	int fd = fileno(m_file);
+	auto input = reinterpret_cast<const uint8*>(buffer);
+	uint64 total = 0;
+	while(total != length)
+	{
+		ssize_t result = pwrite(fd, input + total, length - total, offset + total);
+		if(result < 0)
+		{
+			if(errno == EINTR) continue;
+			throw std::runtime_error("Write failed.");
+		}
+		total += result;
+	}
+	return total;
+#endif
+}
+
 void CStdStream::Close()
 {
 	assert(m_file != nullptr);
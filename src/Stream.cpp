@@ -1,5 +1,6 @@
 #include "Stream.h"
 #include "alloca_def.h"
+#include <stdexcept>
 
 using namespace Framework;
 
@@ -139,3 +140,44 @@ uint64 CStream::GetRemainingLength()
 	Seek(position, STREAM_SEEK_SET);
 	return size - position;
 }
+
+bool CStream::CanAccessAt() const
+{
+	return false;
+}
+
+uint64 CStream::ReadAt(uint64, void*, uint64)
+{
+	throw std::runtime_error("Positional access not supported.");
+}
+
+uint64 CStream::WriteAt(uint64, const void*, uint64)
+{
+	throw std::runtime_error("Positional access not supported.");
+}
+
+uint64 CStream::ReadV(const STREAM_IOVEC* vectors, size_t count)
+{
+	uint64 total = 0;
+	for(size_t i = 0; i < count; i++)
+	{
+		const auto& vector = vectors[i];
+		uint64 amountRead = Read(vector.buffer, vector.size);
+		total += amountRead;
+		if(amountRead != vector.size) break;
+	}
+	return total;
+}
+
+uint64 CStream::WriteV(const STREAM_CONST_IOVEC* vectors, size_t count)
+{
+	uint64 total = 0;
+	for(size_t i = 0; i < count; i++)
+	{
+		const auto& vector = vectors[i];
+		uint64 amountWritten = Write(vector.buffer, vector.size);
+		total += amountWritten;
+		if(amountWritten != vector.size) break;
+	}
+	return total;
+}
@@ -1,14 +1,14 @@
 #include <assert.h>
+#include <string.h>
 #include "StreamBitStream.h"
+#include "EndianUtils.h"
 
 using namespace Framework;
 
 CStreamBitStream::CStreamBitStream(CStream& stream) :
-m_cursor(0),
-m_availableBits(0),
 m_stream(stream)
 {
-	m_buffer[0] = m_buffer[1] = 0;
+
 }
 
 CStreamBitStream::~CStreamBitStream()
@@ -18,59 +18,135 @@ CStreamBitStream::~CStreamBitStream()
 
 void CStreamBitStream::Advance(uint8 size)
 {
-	assert(size <= 32);
-	m_cursor += size;
-	m_cursor %= (BUFFER_SIZE * 8);
-	assert(m_availableBits >= size);
-	m_availableBits -= size;
+	AdvanceInline(size);
 }
 
 uint8 CStreamBitStream::GetBitIndex() const
 {
-	return m_cursor & 7;
+	return m_bitIndex;
 }
 
 bool CStreamBitStream::TryPeekBits_LSBF(uint8 size, uint32& result)
 {
-	assert(0);
-	return false;
+	assert(size <= 32);
+	if(size > 32)
+	{
+		result = 0;
+		return false;
+	}
+	return TryPeekBitsInline_LSBF(size, result);
 }
 
 bool CStreamBitStream::TryPeekBits_MSBF(uint8 size, uint32& result)
 {
-	result = 0;
-
 	assert(size <= 32);
 	if(size > 32)
 	{
+		result = 0;
 		return false;
 	}
+	return TryPeekBitsInline_MSBF(size, result);
+}
 
-	while(size > m_availableBits)
+bool CStreamBitStream::Refill_MSBF(uint8 size)
+{
+	if(m_isLsbf && !SwitchBitOrder(false)) return false;
+	while(1)
 	{
-		//Fill thar buffer
-		uint8 inputValue = 0;
-		if(m_stream.Read(&inputValue, 1) != 1)
+		if((m_bufferEnd - m_bufferPos) >= 8)
+		{
+			//Load 8 bytes at once and keep as many whole bytes as possible. Bits that
+			//don't fit are the beginning of the next byte and will be loaded again later,
+			//so leaving them in the lower part of the accumulator is harmless.
+			uint64 value = 0;
+			memcpy(&value, m_buffer + m_bufferPos, sizeof(uint64));
+			value = CEndian::FromMSBF64(value);
+			m_bitBuffer |= (value >> m_availableBits);
+			unsigned int byteCount = (64 - m_availableBits) / 8;
+			m_bufferPos += byteCount;
+			m_availableBits += byteCount * 8;
+		}
+		else
+		{
+			while((m_availableBits <= 56) && (m_bufferPos != m_bufferEnd))
+			{
+				m_bitBuffer |= static_cast<uint64>(m_buffer[m_bufferPos++]) << (56 - m_availableBits);
+				m_availableBits += 8;
+			}
+		}
+		if(m_availableBits >= size) return true;
+		if(!FillBuffer())
 		{
 			//Not enough bytes to proceed
 			return false;
 		}
-		unsigned int nextByte = ((m_cursor + m_availableBits + 7) / 8) % BUFFER_SIZE;
-		m_buffer[nextByte] = inputValue;
-		m_availableBits += 8;
 	}
+}
 
-	unsigned int tmpCursor = m_cursor;
-	for(unsigned int i = 0; i < size; i++)
+bool CStreamBitStream::Refill_LSBF(uint8 size)
+{
+	if(!m_isLsbf && !SwitchBitOrder(true)) return false;
+	while(1)
 	{
-		unsigned int bytePtr = (tmpCursor / 8) % BUFFER_SIZE;
-		unsigned int bitIndex = 7 - (tmpCursor % 8);
-		unsigned int bitValue = (m_buffer[bytePtr] >> bitIndex) & 1;
-		result <<= 1;
-		result |= bitValue;
-
-		tmpCursor++;
+		if((m_bufferEnd - m_bufferPos) >= 8)
+		{
+			//Same strategy as MSBF, bits that don't fit end up in the upper part
+			uint64 value = 0;
+			memcpy(&value, m_buffer + m_bufferPos, sizeof(uint64));
+			m_bitBuffer |= (m_availableBits == 64) ? 0 : (value << m_availableBits);
+			unsigned int byteCount = (64 - m_availableBits) / 8;
+			m_bufferPos += byteCount;
+			m_availableBits += byteCount * 8;
+		}
+		else
+		{
+			while((m_availableBits <= 56) && (m_bufferPos != m_bufferEnd))
+			{
+				m_bitBuffer |= static_cast<uint64>(m_buffer[m_bufferPos++]) << m_availableBits;
+				m_availableBits += 8;
+			}
+		}
+		if(m_availableBits >= size) return true;
+		if(!FillBuffer())
+		{
+			return false;
+		}
 	}
+}
 
+bool CStreamBitStream::SwitchBitOrder(bool isLsbf)
+{
+	assert(m_isLsbf != isLsbf);
+	if((m_availableBits % 8) != 0)
+	{
+		//Can't change bit order in the middle of a byte
+		assert(false);
+		return false;
+	}
+	//Rebuild the accumulator with the whole bytes it holds, in the other order
+	uint64 bitBuffer = 0;
+	for(unsigned int i = 0; i < (m_availableBits / 8); i++)
+	{
+		uint64 byteValue = m_isLsbf ? ((m_bitBuffer >> (i * 8)) & 0xFF) : ((m_bitBuffer >> (56 - (i * 8))) & 0xFF);
+		bitBuffer |= isLsbf ? (byteValue << (i * 8)) : (byteValue << (56 - (i * 8)));
+	}
+	m_bitBuffer = bitBuffer;
+	m_isLsbf = isLsbf;
 	return true;
-}
\ No newline at end of file
+}
+
+bool CStreamBitStream::FillBuffer()
+{
+	if(m_sourceEof) return false;
+	unsigned int remaining = m_bufferEnd - m_bufferPos;
+	memmove(m_buffer, m_buffer + m_bufferPos, remaining);
+	m_bufferPos = 0;
+	m_bufferEnd = remaining;
+	uint64 amountRead = m_stream.Read(m_buffer + m_bufferEnd, BUFFER_SIZE - m_bufferEnd);
+	m_bufferEnd += static_cast<unsigned int>(amountRead);
+	if((amountRead == 0) || m_stream.IsEOF())
+	{
+		m_sourceEof = true;
+	}
+	return amountRead != 0;
+}
@@ -0,0 +1,79 @@
+#include "StringInterner.h"
+#include <cstring>
+#include <mutex>
+
+using namespace Framework;
+
+CInternedString::CInternedString(std::string_view value)
+    : CInternedString(CStringInterner::GetInstance().Intern(value))
+{
+}
+
+CInternedString::CInternedString(const char* value)
+    : CInternedString(std::string_view(value))
+{
+}
+
+CInternedString CStringInterner::Intern(std::string_view value)
+{
+	CInternedString result;
+	if(value.empty()) return result;
+	{
+		std::shared_lock<std::shared_mutex> lock(m_mutex);
+		auto stringIterator = m_strings.find(value);
+		if(stringIterator != m_strings.end())
+		{
+			result.m_entry = &(*stringIterator);
+			return result;
+		}
+	}
+	std::unique_lock<std::shared_mutex> lock(m_mutex);
+	//Someone else might have added it while the lock was released
+	auto stringIterator = m_strings.find(value);
+	if(stringIterator == m_strings.end())
+	{
+		stringIterator = m_strings.emplace(Store(value), value.size()).first;
+	}
+	result.m_entry = &(*stringIterator);
+	return result;
+}
+
+size_t CStringInterner::GetStringCount()
+{
+	std::shared_lock<std::shared_mutex> lock(m_mutex);
+	return m_strings.size();
+}
+
+size_t CStringInterner::GetStorageSize()
+{
+	std::shared_lock<std::shared_mutex> lock(m_mutex);
+	return m_storageSize;
+}
+
+const char* CStringInterner::Store(std::string_view value)
+{
+	size_t size = value.size() + 1;
+	char* storage = nullptr;
+	if(size > (BLOCK_SIZE / 4))
+	{
+		//Large strings get their own block, the current one keeps being filled
+		m_blocks.emplace_back(new char[size]);
+		m_storageSize += size;
+		storage = m_blocks.back().get();
+	}
+	else
+	{
+		if((m_blockUsed + size) > BLOCK_SIZE)
+		{
+			m_blocks.emplace_back(new char[BLOCK_SIZE]);
+			m_storageSize += BLOCK_SIZE;
+			m_block = m_blocks.back().get();
+			m_blockUsed = 0;
+		}
+		storage = m_block + m_blockUsed;
+		m_blockUsed += size;
+	}
+	memcpy(storage, value.data(), value.size());
+	storage[value.size()] = 0;
+	return storage;
+}
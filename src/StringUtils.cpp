@@ -1,76 +1,87 @@
 #include "StringUtils.h"
 #include <algorithm>
 #include <cctype>
-#include <sstream>
-#include <iostream>
 
-std::string StringUtils::ReplaceAll(const std::string& str, const std::string replace, const std::string replaceWith)
+static bool IsSpace(char value)
 {
-	std::string ret = str;
-	std::string::size_type pos = 0;
-	while((pos = ret.find(replace, pos)) != std::string::npos)
+	return std::isspace(static_cast<unsigned char>(value)) != 0;
+}
+
+std::string StringUtils::ReplaceAll(std::string_view str, std::string_view replace, std::string_view replaceWith)
+{
+	if(replace.empty()) return std::string(str);
+
+	//Count the matches first to allocate the result only once
+	size_t matchCount = 0;
+	for(size_t pos = str.find(replace); pos != std::string_view::npos; pos = str.find(replace, pos + replace.size()))
 	{
-		ret = ret.substr(0, pos)
-		+ replaceWith
-		+ ret.substr(pos + replace.size());
-		pos += replaceWith.size();
+		matchCount++;
 	}
+
+	std::string ret;
+	ret.reserve(str.size() - (matchCount * replace.size()) + (matchCount * replaceWith.size()));
+	size_t start = 0;
+	for(size_t pos = str.find(replace); pos != std::string_view::npos; pos = str.find(replace, start))
+	{
+		ret.append(str.data() + start, pos - start);
+		ret.append(replaceWith.data(), replaceWith.size());
+		start = pos + replace.size();
+	}
+	ret.append(str.data() + start, str.size() - start);
 	return ret;
 }
 
-std::string StringUtils::EraseAll(const std::string& str, const std::string remove)
+std::string StringUtils::EraseAll(std::string_view str, std::string_view remove)
 {
-	return StringUtils::ReplaceAll(str, remove, "");
+	return StringUtils::ReplaceAll(str, remove, std::string_view());
 }
 
 std::string StringUtils::TrimStart(const std::string& str)
 {
-	std::string ret = str;
-	auto itr = ret.begin();
-	while(itr != ret.end() && std::isspace((*itr)))
+	return std::string(TrimStartView(str));
+}
+
+std::string StringUtils::TrimEnd(const std::string& str)
+{
+	return std::string(TrimEndView(str));
+}
+
+std::string StringUtils::Trim(const std::string& str)
+{
+	return std::string(TrimView(str));
+}
+
+std::string_view StringUtils::TrimStartView(std::string_view str)
+{
+	size_t start = 0;
+	while((start != str.size()) && IsSpace(str[start]))
 	{
-		++itr;
+		start++;
 	}
-	ret.erase(ret.begin(), itr);
-	return ret;
+	return str.substr(start);
 }
 
-std::string StringUtils::TrimEnd(const std::string& str)
+std::string_view StringUtils::TrimEndView(std::string_view str)
 {
-	std::string ret = str;
-	auto itr = ret.rbegin();
-	while(itr != ret.rend() && std::isspace((*itr)))
+	size_t end = str.size();
+	while((end != 0) && IsSpace(str[end - 1]))
 	{
-		++itr;
+		end--;
 	}
-	ret.erase(itr.base(), ret.end());
-	return ret;
+	return str.substr(0, end);
 }
 
-std::string StringUtils::Trim(const std::string& str)
+std::string_view StringUtils::TrimView(std::string_view str)
 {
-	std::string ret = str;
-	ret = TrimStart(ret);
-	ret = TrimEnd(ret);
-	return ret;
+	return TrimEndView(TrimStartView(str));
 }
 
-// split function based on https://www.fluentcpp.com/2017/04/21/how-to-split-a-string-in-c/
 std::vector<std::string> StringUtils::Split(const std::string& s, char delimiter, bool trim)
 {
 	std::vector<std::string> tokens;
-	std::string token;
-	std::istringstream tokenStream(s);
-	while (std::getline(tokenStream, token, delimiter))
+	for(const auto& token : SplitView(s, delimiter, trim))
 	{
-		tokens.push_back(token);
-	}
-	if(trim)
-	{
-		for(int i = 0; i < tokens.size(); i++)
-		{
-			tokens[i] = StringUtils::Trim(tokens[i]);
-		}
+		tokens.emplace_back(token);
 	}
 	return tokens;
 }
@@ -78,13 +89,20 @@ std::vector<std::string> StringUtils::Split(const std::string& s, char delimiter
 std::string StringUtils::Join(const std::vector<std::string>& strings, const std::string& delimiter)
 {
 	std::string result;
-	for(int i = 0; i < strings.size(); i++)
+	if(strings.empty()) return result;
+	size_t resultSize = delimiter.size() * (strings.size() - 1);
+	for(const auto& string : strings)
 	{
-		result += strings[i];
-		if(i != strings.size() - 1)
+		resultSize += string.size();
+	}
+	result.reserve(resultSize);
+	for(size_t i = 0; i < strings.size(); i++)
+	{
+		if(i != 0)
 		{
 			result += delimiter;
 		}
+		result += strings[i];
 	}
 	return result;
 }
@@ -92,6 +110,109 @@ std::string StringUtils::Join(const std::vector<std::string>& strings, const std
 std::string StringUtils::ToLower(const std::string& str)
 {
 	std::string ret = str;
-	std::transform(ret.begin(), ret.end(), ret.begin(), [](auto c) { return std::tolower(c); });
+	ToLowerInPlace(ret);
 	return ret;
 }
+
+void StringUtils::ToLowerInPlace(std::string& str)
+{
+	std::transform(str.begin(), str.end(), str.begin(), [](char c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); });
+}
+
+/////////////////////////////////////////////////////////
+// CSplitView
+/////////////////////////////////////////////////////////
+
+StringUtils::CSplitView::CSplitView(std::string_view source, char delimiter, bool trim)
+: m_source(source)
+, m_delimiter(delimiter)
+, m_trim(trim)
+{
+}
+
+StringUtils::CSplitView::CIterator StringUtils::CSplitView::begin() const
+{
+	return CIterator(m_source, m_delimiter, m_trim);
+}
+
+StringUtils::CSplitView::CIterator StringUtils::CSplitView::end() const
+{
+	return CIterator();
+}
+
+StringUtils::CSplitView StringUtils::SplitView(std::string_view source, char delimiter, bool trim)
+{
+	return CSplitView(source, delimiter, trim);
+}
+
+StringUtils::CSplitView::CIterator::CIterator(std::string_view source, char delimiter, bool trim)
+: m_remaining(source)
+, m_delimiter(delimiter)
+, m_trim(trim)
+, m_isLastToken(source.empty())
+, m_isEnd(false)
+{
+	FetchToken();
+}
+
+const std::string_view& StringUtils::CSplitView::CIterator::operator*() const
+{
+	return m_token;
+}
+
+const std::string_view* StringUtils::CSplitView::CIterator::operator->() const
+{
+	return &m_token;
+}
+
+StringUtils::CSplitView::CIterator& StringUtils::CSplitView::CIterator::operator++()
+{
+	FetchToken();
+	return *this;
+}
+
+StringUtils::CSplitView::CIterator StringUtils::CSplitView::CIterator::operator++(int)
+{
+	auto result = *this;
+	FetchToken();
+	return result;
+}
+
+bool StringUtils::CSplitView::CIterator::operator==(const CIterator& rhs) const
+{
+	if(m_isEnd || rhs.m_isEnd) return m_isEnd == rhs.m_isEnd;
+	return (m_remaining.data() == rhs.m_remaining.data()) && (m_isLastToken == rhs.m_isLastToken);
+}
+
+bool StringUtils::CSplitView::CIterator::operator!=(const CIterator& rhs) const
+{
+	return !(*this == rhs);
+}
+
+void StringUtils::CSplitView::CIterator::FetchToken()
+{
+	if(m_isLastToken)
+	{
+		m_isEnd = true;
+		m_token = std::string_view();
+		return;
+	}
+	size_t pos = m_remaining.find(m_delimiter);
+	if(pos == std::string_view::npos)
+	{
+		m_token = m_remaining;
+		m_remaining = m_remaining.substr(m_remaining.size());
+		m_isLastToken = true;
+	}
+	else
+	{
+		m_token = m_remaining.substr(0, pos);
+		m_remaining = m_remaining.substr(pos + 1);
+		//Like std::getline, a delimiter at the very end doesn't start another token
+		m_isLastToken = m_remaining.empty();
+	}
+	if(m_trim)
+	{
+		m_token = TrimView(m_token);
+	}
+}
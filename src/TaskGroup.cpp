@@ -0,0 +1,54 @@
+#include "TaskGroup.h"
+
+using namespace Framework;
+
+CTaskGroup::CTaskGroup(CThreadPool* threadPool)
+: m_threadPool(threadPool)
+{
+}
+
+CTaskGroup::~CTaskGroup()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_condition.wait(lock, [this]() { return m_pendingCount == 0; });
+}
+
+void CTaskGroup::BeginTask()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_pendingCount++;
+}
+
+void CTaskGroup::EndTask(const std::exception_ptr& exception)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	if(exception && !m_exception)
+	{
+		m_exception = exception;
+	}
+	m_pendingCount--;
+	m_condition.notify_all();
+}
+
+void CTaskGroup::Wait()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while(m_pendingCount != 0)
+	{
+		//Help with pending tasks (ours or not), this also allows waiting from a worker thread
+		lock.unlock();
+		bool hasRunTask = m_threadPool->RunPendingTask();
+		lock.lock();
+		if(!hasRunTask && (m_pendingCount != 0))
+		{
+			//Remaining tasks are running on other threads
+			m_condition.wait(lock);
+		}
+	}
+	if(m_exception)
+	{
+		auto exception = m_exception;
+		m_exception = std::exception_ptr();
+		std::rethrow_exception(exception);
+	}
+}
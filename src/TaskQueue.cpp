@@ -0,0 +1,35 @@
+#include "TaskQueue.h"
+
+using namespace Framework;
+
+void CTaskQueue::Post(CTask task)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_tasks.push_back(std::move(task));
+}
+
+unsigned int CTaskQueue::RunPending()
+{
+	TaskArray tasks;
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		std::swap(m_tasks, tasks);
+	}
+	//Tasks posted while running these wait for the next call
+	for(auto& task : tasks)
+	{
+		task();
+	}
+	return static_cast<unsigned int>(tasks.size());
+}
+
+bool CTaskQueue::IsEmpty()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	return m_tasks.empty();
+}
+
+TaskExecutor CTaskQueue::GetExecutor()
+{
+	return [this] (CTask task) { Post(std::move(task)); };
+}
@@ -1,60 +1,635 @@
+#include <algorithm>
+#include <cassert>
 #include "ThreadPool.h"
+#include "ThreadUtils.h"
+#include "Trace.h"
+#include "WorkStealingDeque.h"
 
 using namespace Framework;
 
-CThreadPool::CThreadPool(unsigned int threadCount)
-: m_stop(false)
+struct CThreadPool::TASKNODE
 {
-	for(unsigned int i = 0; i < threadCount; i++)
+	TaskFunction		task;
+	CCancellationToken	cancellationToken;
+	TASKNODE*			next = nullptr;
+};
+
+struct CThreadPool::WORKER
+{
+	CThreadPool*					pool = nullptr;
+	unsigned int					index = 0;
+	CWorkStealingDeque<TASKNODE>	tasks[PRIORITY_COUNT];
+	//Tasks found so far, drives the fairness turns
+	unsigned int					pickCount = 0;
+	//Has a thread, guarded by the pool's park mutex
+	bool							active = false;
+};
+
+namespace
+{
+	thread_local void* g_currentWorker = nullptr;
+	thread_local const CCancellationToken* g_currentCancellationToken = nullptr;
+
+	//Tasks can run other tasks while they wait (RunPendingTask), the outer task's token is restored after
+	class CCurrentTokenScope
+	{
+	public:
+		CCurrentTokenScope(const CCancellationToken* token)
+		: m_previousToken(g_currentCancellationToken)
+		{
+			g_currentCancellationToken = token;
+		}
+
+		~CCurrentTokenScope()
+		{
+			g_currentCancellationToken = m_previousToken;
+		}
+
+	private:
+		const CCancellationToken* m_previousToken;
+	};
+
+	enum
+	{
+		NODE_BATCH_SIZE = 64,
+		NODE_CACHE_SIZE = NODE_BATCH_SIZE * 2,
+	};
+
+	//Nodes are often released on another thread than the one that allocated them (ie.: tasks
+	//enqueued from outside the pool). Threads exchange full batches through the shared pool to
+	//keep that balanced while only taking the lock once per batch.
+	template <typename NodeType>
+	class CNodeSharedPool
+	{
+	public:
+		~CNodeSharedPool()
+		{
+			for(auto batch : m_batches)
+			{
+				DeleteList(batch);
+			}
+		}
+
+		void PutBatch(NodeType* batch)
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_batches.push_back(batch);
+		}
+
+		NodeType* TakeBatch()
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			if(m_batches.empty()) return nullptr;
+			auto batch = m_batches.back();
+			m_batches.pop_back();
+			return batch;
+		}
+
+		static void DeleteList(NodeType* node)
+		{
+			while(node)
+			{
+				auto next = node->next;
+				delete node;
+				node = next;
+			}
+		}
+
+	private:
+		std::mutex				m_mutex;
+		std::vector<NodeType*>	m_batches;
+	};
+
+	template <typename NodeType>
+	class CNodeCache
+	{
+	public:
+		~CNodeCache()
+		{
+			CNodeSharedPool<NodeType>::DeleteList(m_nodes);
+		}
+
+		NodeType* Allocate()
+		{
+			if(!m_nodes)
+			{
+				m_nodes = GetSharedPool().TakeBatch();
+				m_nodeCount = m_nodes ? NODE_BATCH_SIZE : 0;
+			}
+			if(!m_nodes)
+			{
+				return new NodeType();
+			}
+			auto node = m_nodes;
+			m_nodes = node->next;
+			node->next = nullptr;
+			m_nodeCount--;
+			return node;
+		}
+
+		void Release(NodeType* node)
+		{
+			node->next = m_nodes;
+			m_nodes = node;
+			m_nodeCount++;
+			if(m_nodeCount == NODE_CACHE_SIZE)
+			{
+				//Give away the oldest half of the cache
+				auto last = m_nodes;
+				for(unsigned int i = 1; i < NODE_CACHE_SIZE - NODE_BATCH_SIZE; i++)
+				{
+					last = last->next;
+				}
+				GetSharedPool().PutBatch(last->next);
+				last->next = nullptr;
+				m_nodeCount -= NODE_BATCH_SIZE;
+			}
+		}
+
+	private:
+		static CNodeSharedPool<NodeType>& GetSharedPool()
+		{
+			static CNodeSharedPool<NodeType> sharedPool;
+			return sharedPool;
+		}
+
+		NodeType*		m_nodes = nullptr;
+		unsigned int	m_nodeCount = 0;
+	};
+
+	template <typename NodeType>
+	CNodeCache<NodeType>& GetNodeCache()
+	{
+		thread_local CNodeCache<NodeType> nodeCache;
+		return nodeCache;
+	}
+}
+
+
+CThreadPool::CThreadPool(unsigned int threadCount, PLACEMENT placement)
+: CThreadPool(threadCount, threadCount, placement)
+{
+}
+
+CThreadPool::CThreadPool(unsigned int minThreadCount, unsigned int maxThreadCount, PLACEMENT placement, unsigned int idleTimeoutMs)
+: m_minThreadCount(minThreadCount)
+, m_placement(placement)
+, m_idleTimeout(idleTimeoutMs)
+, m_activeCount(minThreadCount)
+, m_backlogStart(0)
+, m_parkedCount(0)
+, m_stop(false)
+{
+	assert(maxThreadCount >= minThreadCount);
+	m_workers.resize(std::max(minThreadCount, maxThreadCount));
+	m_threads.resize(m_workers.size());
+
+	//Workers started later can't be allocated on their thread, others might be stealing from their slot already
+	for(unsigned int i = minThreadCount; i < m_workers.size(); i++)
 	{
-		m_workers.push_back(std::thread([&] () { WorkerThreadProc(); }));
+		auto worker = std::make_unique<WORKER>();
+		worker->pool = this;
+		worker->index = i;
+		m_workers[i] = std::move(worker);
 	}
+
+	for(unsigned int i = 0; i < minThreadCount; i++)
+	{
+		auto processors = GetWorkerProcessors(i, placement);
+		m_threads[i] = std::thread([this, i, processors] () { WorkerThreadProc(i, processors, true); });
+	}
+
+	//All workers need to exist before any of them starts stealing
+	std::unique_lock<std::mutex> lock(m_parkMutex);
+	m_condition.wait(lock, [this] () { return m_readyCount == m_minThreadCount; });
 }
 
 CThreadPool::~CThreadPool()
 {
-	m_stop = true;
-	m_condition.notify_all();
+	{
+		std::unique_lock<std::mutex> lock(m_parkMutex);
+		m_stop = true;
+		m_condition.notify_all();
+	}
 
-	for(auto& worker : m_workers)
+	//Workers can't be started anymore, the threads can be used safely
+	for(auto& thread : m_threads)
+	{
+		if(thread.joinable())
+		{
+			thread.join();
+		}
+	}
+
+	//Only left if no worker was there to take them (none started or all of them retired), they can
+	//enqueue more tasks while they run
+	while(RunPendingTask())
 	{
-		worker.join();
 	}
 }
 
-void CThreadPool::Enqueue(const TaskFunction& task)
+void CThreadPool::Enqueue(TaskFunction task, PRIORITY priority, CCancellationToken cancellationToken)
 {
+	assert(priority < PRIORITY_COUNT);
+	auto newTask = AllocateNode();
+	newTask->task = std::move(task);
+	newTask->cancellationToken = std::move(cancellationToken);
+	auto worker = static_cast<WORKER*>(g_currentWorker);
+	if(worker && (worker->pool == this))
+	{
+		worker->tasks[priority].Push(newTask);
+	}
+	else
 	{
 		std::unique_lock<std::mutex> lock(m_tasksMutex);
-		m_tasks.push_back(task);
+		m_tasks[priority].push_back(newTask);
+		m_taskCounts[priority]++;
 	}
 
-	m_condition.notify_one();
+	WakeWorker();
 }
 
-void CThreadPool::WorkerThreadProc()
+unsigned int CThreadPool::GetThreadCount() const
 {
-	while(1)
+	return m_activeCount;
+}
+
+unsigned int CThreadPool::GetMaxThreadCount() const
+{
+	return static_cast<unsigned int>(m_workers.size());
+}
+
+std::vector<unsigned int> CThreadPool::GetWorkerProcessors(unsigned int workerIndex, PLACEMENT placement)
+{
+	const auto& topology = ThreadUtils::GetCpuTopology();
+	switch(placement)
 	{
-		TaskFunction task;
+	case PLACEMENT_CORE:
+		return topology.GetCoreProcessors(workerIndex % topology.coreCount);
+	case PLACEMENT_NODE:
+		return topology.GetNodeProcessors(workerIndex % topology.nodeCount);
+	default:
+		return std::vector<unsigned int>();
+	}
+}
 
+TaskExecutor CThreadPool::GetExecutor(PRIORITY priority)
+{
+	return [this, priority] (CTask task) { Enqueue(std::move(task), priority); };
+}
+
+CCancellationToken CThreadPool::GetGroupToken(GroupId groupId)
+{
+	std::unique_lock<std::mutex> lock(m_groupsMutex);
+	auto& token = m_groups[groupId];
+	if(!token.IsCancellable())
+	{
+		token = CCancellationToken::Create();
+	}
+	return token;
+}
+
+void CThreadPool::CancelGroup(GroupId groupId)
+{
+	std::unique_lock<std::mutex> lock(m_groupsMutex);
+	auto groupIterator = m_groups.find(groupId);
+	if(groupIterator == m_groups.end()) return;
+	groupIterator->second.Cancel();
+	m_groups.erase(groupIterator);
+}
+
+bool CThreadPool::IsCurrentTaskCancelled()
+{
+	return g_currentCancellationToken && g_currentCancellationToken->IsCancelled();
+}
+
+void CThreadPool::WorkerThreadProc(unsigned int workerIndex, const std::vector<unsigned int>& processors, bool allocateWorker)
+{
+	if(!processors.empty())
+	{
+		ThreadUtils::SetCurrentThreadAffinity(processors);
+	}
+	if(allocateWorker)
+	{
+		//Worker is allocated once pinned, on memory local to its node
+		auto newWorker = std::make_unique<WORKER>();
+		newWorker->pool = this;
+		newWorker->index = workerIndex;
+		newWorker->active = true;
+		std::unique_lock<std::mutex> lock(m_parkMutex);
+		m_workers[workerIndex] = std::move(newWorker);
+		m_readyCount++;
+		m_condition.notify_all();
+		m_condition.wait(lock, [this] () { return m_readyCount == m_minThreadCount; });
+	}
+	auto& worker = *m_workers[workerIndex];
+
+	g_currentWorker = &worker;
+	while(1)
+	{
+		TASKNODE* task = nullptr;
+		for(unsigned int i = 0; (i < SPIN_COUNT) && !task; i++)
 		{
-			std::unique_lock<std::mutex> lock(m_tasksMutex);
+			task = FindTask(worker);
+			if(!task && (i != 0))
+			{
+				std::this_thread::yield();
+			}
+		}
 
-			while(!m_stop && m_tasks.empty())
+		if(!task)
+		{
+			if(!Park(worker))
 			{
-				m_condition.wait(lock);
+				break;
 			}
+			continue;
+		}
+
+		RunTask(task);
+	}
+	g_currentWorker = nullptr;
+}
 
-			if(m_stop && m_tasks.empty())
+bool CThreadPool::RunPendingTask()
+{
+	TASKNODE* task = nullptr;
+	auto worker = static_cast<WORKER*>(g_currentWorker);
+	if(worker && (worker->pool == this))
+	{
+		task = FindTask(*worker);
+	}
+	else
+	{
+		for(unsigned int priority = 0; (priority < PRIORITY_COUNT) && !task; priority++)
+		{
+			task = TakeInjectedTask(nullptr, static_cast<PRIORITY>(priority));
+			if(!task)
 			{
-				return;
+				task = StealTask(0, static_cast<PRIORITY>(priority));
 			}
+		}
+	}
+	if(!task) return false;
+
+	RunTask(task);
+	return true;
+}
+
+CThreadPool::TASKNODE* CThreadPool::AllocateNode()
+{
+	return GetNodeCache<TASKNODE>().Allocate();
+}
+
+void CThreadPool::ReleaseNode(TASKNODE* node)
+{
+	GetNodeCache<TASKNODE>().Release(node);
+}
+
+void CThreadPool::RunTask(TASKNODE* node)
+{
+	//Move the function out so that the node can be recycled even if it throws
+	auto task = std::move(node->task);
+	auto cancellationToken = std::move(node->cancellationToken);
+	ReleaseNode(node);
+	if(cancellationToken.IsCancelled())
+	{
+		return;
+	}
+
+	CCurrentTokenScope tokenScope(&cancellationToken);
+
+	FRAMEWORK_TRACE_SCOPE("ThreadPool::RunTask");
+	task();
+}
+
+CThreadPool::TASKNODE* CThreadPool::FindTask(WORKER& worker)
+{
+	//Fairness turns start with each of the lower priorities in turn, then wrap around
+	unsigned int firstPriority = 0;
+	if(((worker.pickCount + 1) % FAIRNESS_INTERVAL) == 0)
+	{
+		firstPriority = 1 + ((worker.pickCount / FAIRNESS_INTERVAL) % (PRIORITY_COUNT - 1));
+	}
+	for(unsigned int i = 0; i < PRIORITY_COUNT; i++)
+	{
+		auto priority = static_cast<PRIORITY>((firstPriority + i) % PRIORITY_COUNT);
+		auto task = worker.tasks[priority].Take();
+		if(!task)
+		{
+			task = TakeInjectedTask(&worker, priority);
+		}
+		if(!task)
+		{
+			//Start with the next worker so that thieves don't all go for the same victim
+			task = StealTask(worker.index + 1, priority);
+		}
+		if(task)
+		{
+			worker.pickCount++;
+			return task;
+		}
+	}
+	return nullptr;
+}
+
+//Takes a task from the injection queue. Workers also get a few more that are moved to their deque
+//where other workers can steal them, to go through the lock less often
+CThreadPool::TASKNODE* CThreadPool::TakeInjectedTask(WORKER* worker, PRIORITY priority)
+{
+	if(m_taskCounts[priority] == 0) return nullptr;
+
+	std::unique_lock<std::mutex> lock(m_tasksMutex);
+	auto& tasks = m_tasks[priority];
+	if(tasks.empty()) return nullptr;
+
+	auto task = tasks.front();
+	tasks.pop_front();
+
+	size_t workerCount = std::max<size_t>(m_activeCount, 1);
+	size_t batchSize = worker ? std::min<size_t>(tasks.size() / workerCount, INJECTION_BATCH_SIZE) : 0;
+	for(size_t i = 0; i < batchSize; i++)
+	{
+		worker->tasks[priority].Push(tasks.front());
+		tasks.pop_front();
+	}
+	m_taskCounts[priority] -= batchSize + 1;
+	lock.unlock();
+
+	if(batchSize != 0)
+	{
+		WakeWorker();
+	}
+	return task;
+}
+
+CThreadPool::TASKNODE* CThreadPool::StealTask(size_t startIndex, PRIORITY priority)
+{
+	size_t workerCount = m_workers.size();
+	for(size_t i = 0; i < workerCount; i++)
+	{
+		auto& victim = *m_workers[(startIndex + i) % workerCount];
+		if(auto task = victim.tasks[priority].Steal())
+		{
+			return task;
+		}
+	}
+	return nullptr;
+}
+
+bool CThreadPool::HasPendingTasks() const
+{
+	for(unsigned int priority = 0; priority < PRIORITY_COUNT; priority++)
+	{
+		if(m_taskCounts[priority] != 0) return true;
+		for(const auto& worker : m_workers)
+		{
+			if(!worker->tasks[priority].IsEmpty()) return true;
+		}
+	}
+	return false;
+}
 
-			task = m_tasks.front();
-			m_tasks.pop_front();
+void CThreadPool::WakeWorker()
+{
+	//Pairs with the fence in Park: either the parking worker sees the new task or we see it parked
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if(m_parkedCount != 0)
+	{
+		std::unique_lock<std::mutex> lock(m_parkMutex);
+		if(m_activeCount == m_blockedCount)
+		{
+			//Parked worker exited in the meantime
+			SpawnWorker();
 		}
+		else
+		{
+			m_condition.notify_one();
+		}
+		return;
+	}
 
-		task();
+	if(m_activeCount >= m_workers.size()) return;
+
+	//Workers are all busy, only add one if none of them went idle for a while. Happens right away if
+	//there are no workers left.
+	auto now = std::chrono::steady_clock::now().time_since_epoch().count();
+	if(m_activeCount != 0)
+	{
+		static const auto spawnDelay = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+		                                   std::chrono::milliseconds(BACKLOG_SPAWN_DELAY_MS)).count();
+		int64_t backlogStart = m_backlogStart;
+		if(backlogStart == 0)
+		{
+			m_backlogStart.compare_exchange_strong(backlogStart, now);
+			return;
+		}
+		if((now - backlogStart) < spawnDelay) return;
+	}
+
+	std::unique_lock<std::mutex> lock(m_parkMutex);
+	if(m_parkedCount != 0)
+	{
+		m_condition.notify_one();
+		return;
+	}
+	if(SpawnWorker())
+	{
+		m_backlogStart = now;
+	}
+}
+
+//Returns false when the worker has to exit
+bool CThreadPool::Park(WORKER& worker)
+{
+	std::unique_lock<std::mutex> lock(m_parkMutex);
+	m_parkedCount++;
+	m_backlogStart = 0;
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	auto retireTime = std::chrono::steady_clock::now() + m_idleTimeout;
+	while(!HasPendingTasks())
+	{
+		if(m_stop)
+		{
+			m_parkedCount--;
+			return false;
+		}
+		if((m_activeCount - m_blockedCount) <= m_minThreadCount)
+		{
+			m_condition.wait(lock);
+			continue;
+		}
+		if(m_condition.wait_until(lock, retireTime) == std::cv_status::no_timeout)
+		{
+			continue;
+		}
+		if(!HasPendingTasks() && !m_stop && ((m_activeCount - m_blockedCount) > m_minThreadCount))
+		{
+			//Active count goes down first, WakeWorker checks it after seeing the parked count go down
+			worker.active = false;
+			m_activeCount--;
+			m_parkedCount--;
+			return false;
+		}
+	}
+	m_parkedCount--;
+	return true;
+}
+
+//Needs the park mutex to be held
+bool CThreadPool::SpawnWorker()
+{
+	if(m_stop) return false;
+	for(unsigned int i = 0; i < m_workers.size(); i++)
+	{
+		auto& worker = *m_workers[i];
+		if(worker.active) continue;
+		//Thread of a worker that went away, it's done with the mutex
+		if(m_threads[i].joinable())
+		{
+			m_threads[i].join();
+		}
+		worker.active = true;
+		m_activeCount++;
+		auto processors = GetWorkerProcessors(i, m_placement);
+		m_threads[i] = std::thread([this, i, processors] () { WorkerThreadProc(i, processors, false); });
+		return true;
+	}
+	return false;
+}
+
+void CThreadPool::BeginBlocking()
+{
+	std::unique_lock<std::mutex> lock(m_parkMutex);
+	m_blockedCount++;
+	//A parked worker can take over, otherwise another one is needed
+	if(m_parkedCount == 0)
+	{
+		SpawnWorker();
+	}
+}
+
+void CThreadPool::EndBlocking()
+{
+	std::unique_lock<std::mutex> lock(m_parkMutex);
+	assert(m_blockedCount != 0);
+	m_blockedCount--;
+}
+
+CThreadPool::CBlockingScope::CBlockingScope()
+{
+	auto worker = static_cast<WORKER*>(g_currentWorker);
+	if(worker)
+	{
+		m_pool = worker->pool;
+		m_pool->BeginBlocking();
+	}
+}
+
+CThreadPool::CBlockingScope::~CBlockingScope()
+{
+	if(m_pool)
+	{
+		m_pool->EndBlocking();
 	}
 }
@@ -1,6 +1,9 @@
 #include "ThreadUtils.h"
 
+#include <algorithm>
 #include <cassert>
+#include <fstream>
+#include <map>
 #include <string>
 #include <mutex>
 
@@ -11,6 +14,9 @@
 
 typedef HRESULT (WINAPI *SetThreadDescriptionFuncType)(HANDLE, PCWSTR);
 static SetThreadDescriptionFuncType SetThreadDescriptionFunc = nullptr;
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
 #endif
 
 using namespace Framework;
@@ -36,3 +42,332 @@ void ThreadUtils::SetThreadName(std::thread& thread, const char* name)
 	pthread_setname_np(thread.native_handle(), name);
 #endif
 }
+
+std::vector<unsigned int> ThreadUtils::CPU_TOPOLOGY::GetCoreProcessors(unsigned int coreIndex) const
+{
+	std::vector<unsigned int> result;
+	for(const auto& processor : processors)
+	{
+		if(processor.coreIndex == coreIndex)
+		{
+			result.push_back(processor.index);
+		}
+	}
+	return result;
+}
+
+std::vector<unsigned int> ThreadUtils::CPU_TOPOLOGY::GetNodeProcessors(unsigned int nodeIndex) const
+{
+	std::vector<unsigned int> result;
+	for(const auto& processor : processors)
+	{
+		if(processor.nodeIndex == nodeIndex)
+		{
+			result.push_back(processor.index);
+		}
+	}
+	return result;
+}
+
+#if defined(WIN32)
+
+static bool SetNativeThreadAffinity(HANDLE thread, const std::vector<unsigned int>& processors)
+{
+	//Windows only allows affinity within a single processor group
+	if(processors.empty()) return false;
+	GROUP_AFFINITY affinity = {};
+	affinity.Group = static_cast<WORD>(processors[0] / 64);
+	for(auto processor : processors)
+	{
+		if((processor / 64) != affinity.Group) return false;
+		affinity.Mask |= static_cast<KAFFINITY>(1) << (processor % 64);
+	}
+	return SetThreadGroupAffinity(thread, &affinity, nullptr) != FALSE;
+}
+
+static bool SetNativeThreadPriority(HANDLE thread, ThreadUtils::THREAD_PRIORITY priority)
+{
+	int nativePriority = THREAD_PRIORITY_NORMAL;
+	switch(priority)
+	{
+	case ThreadUtils::THREAD_PRIORITY::LOW:
+		nativePriority = THREAD_PRIORITY_BELOW_NORMAL;
+		break;
+	case ThreadUtils::THREAD_PRIORITY::HIGH:
+		nativePriority = THREAD_PRIORITY_ABOVE_NORMAL;
+		break;
+	default:
+		break;
+	}
+	return ::SetThreadPriority(thread, nativePriority) != FALSE;
+}
+
+#elif defined(__linux__)
+
+static bool MakeCpuSet(const std::vector<unsigned int>& processors, cpu_set_t& cpuSet)
+{
+	if(processors.empty()) return false;
+	CPU_ZERO(&cpuSet);
+	for(auto processor : processors)
+	{
+		if(processor >= CPU_SETSIZE) return false;
+		CPU_SET(processor, &cpuSet);
+	}
+	return true;
+}
+
+//Low priority is only a scheduling hint. High priority uses the lowest real-time priority
+//and requires the appropriate privileges.
+static bool SetNativeThreadPriority(pthread_t thread, ThreadUtils::THREAD_PRIORITY priority)
+{
+	int policy = SCHED_OTHER;
+	sched_param param = {};
+	switch(priority)
+	{
+	case ThreadUtils::THREAD_PRIORITY::LOW:
+		policy = SCHED_BATCH;
+		break;
+	case ThreadUtils::THREAD_PRIORITY::HIGH:
+		policy = SCHED_RR;
+		param.sched_priority = sched_get_priority_min(SCHED_RR);
+		break;
+	default:
+		break;
+	}
+	return pthread_setschedparam(thread, policy, &param) == 0;
+}
+
+//Parses lists such as "0-3,8,10-11"
+static std::vector<unsigned int> ParseCpuList(const std::string& list)
+{
+	std::vector<unsigned int> result;
+	size_t position = 0;
+	while(position < list.size())
+	{
+		size_t end = list.find(',', position);
+		if(end == std::string::npos) end = list.size();
+		auto range = list.substr(position, end - position);
+		position = end + 1;
+		if(range.empty()) continue;
+		auto dashPosition = range.find('-');
+		unsigned int first = std::stoul(range.substr(0, dashPosition));
+		unsigned int last = (dashPosition == std::string::npos) ? first : std::stoul(range.substr(dashPosition + 1));
+		for(unsigned int i = first; i <= last; i++)
+		{
+			result.push_back(i);
+		}
+	}
+	return result;
+}
+
+static bool ReadSysFile(const std::string& path, std::string& value)
+{
+	std::ifstream stream(path);
+	return static_cast<bool>(std::getline(stream, value));
+}
+
+#endif
+
+bool ThreadUtils::SetThreadAffinity(std::thread& thread, const std::vector<unsigned int>& processors)
+{
+#if defined(WIN32)
+	return SetNativeThreadAffinity(thread.native_handle(), processors);
+#elif defined(__linux__) && !defined(__ANDROID__)
+	cpu_set_t cpuSet;
+	if(!MakeCpuSet(processors, cpuSet)) return false;
+	return pthread_setaffinity_np(thread.native_handle(), sizeof(cpuSet), &cpuSet) == 0;
+#else
+	return false;
+#endif
+}
+
+bool ThreadUtils::SetCurrentThreadAffinity(const std::vector<unsigned int>& processors)
+{
+#if defined(WIN32)
+	return SetNativeThreadAffinity(GetCurrentThread(), processors);
+#elif defined(__linux__)
+	cpu_set_t cpuSet;
+	if(!MakeCpuSet(processors, cpuSet)) return false;
+	return sched_setaffinity(0, sizeof(cpuSet), &cpuSet) == 0;
+#else
+	return false;
+#endif
+}
+
+bool ThreadUtils::SetThreadPriority(std::thread& thread, THREAD_PRIORITY priority)
+{
+#if defined(WIN32) || defined(__linux__)
+	return SetNativeThreadPriority(thread.native_handle(), priority);
+#else
+	return false;
+#endif
+}
+
+bool ThreadUtils::SetCurrentThreadPriority(THREAD_PRIORITY priority)
+{
+#if defined(WIN32)
+	return SetNativeThreadPriority(GetCurrentThread(), priority);
+#elif defined(__linux__)
+	return SetNativeThreadPriority(pthread_self(), priority);
+#else
+	return false;
+#endif
+}
+
+static ThreadUtils::CPU_TOPOLOGY QueryCpuTopology()
+{
+	ThreadUtils::CPU_TOPOLOGY topology;
+#if defined(WIN32)
+	DWORD bufferSize = 0;
+	GetLogicalProcessorInformationEx(RelationAll, nullptr, &bufferSize);
+	std::vector<BYTE> buffer(bufferSize);
+	auto infos = reinterpret_cast<SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*>(buffer.data());
+	if(!buffer.empty() && GetLogicalProcessorInformationEx(RelationAll, infos, &bufferSize))
+	{
+		std::map<unsigned int, ThreadUtils::LOGICAL_PROCESSOR> processors;
+		std::map<unsigned int, unsigned int> nodeIndices;
+		for(DWORD offset = 0; offset < bufferSize;)
+		{
+			auto info = reinterpret_cast<SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*>(buffer.data() + offset);
+			offset += info->Size;
+			if(info->Relationship == RelationProcessorCore)
+			{
+				unsigned int coreIndex = topology.coreCount++;
+				for(WORD group = 0; group < info->Processor.GroupCount; group++)
+				{
+					const auto& groupMask = info->Processor.GroupMask[group];
+					for(unsigned int bit = 0; bit < 64; bit++)
+					{
+						if(!(groupMask.Mask & (static_cast<KAFFINITY>(1) << bit))) continue;
+						auto& processor = processors[(groupMask.Group * 64) + bit];
+						processor.coreIndex = coreIndex;
+						processor.efficiencyClass = info->Processor.EfficiencyClass;
+					}
+				}
+			}
+		}
+		for(DWORD offset = 0; offset < bufferSize;)
+		{
+			auto info = reinterpret_cast<SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*>(buffer.data() + offset);
+			offset += info->Size;
+			if(info->Relationship == RelationNumaNode)
+			{
+				unsigned int nodeIndex = static_cast<unsigned int>(nodeIndices.size());
+				nodeIndices[info->NumaNode.NodeNumber] = nodeIndex;
+				const auto& groupMask = info->NumaNode.GroupMask;
+				for(unsigned int bit = 0; bit < 64; bit++)
+				{
+					if(!(groupMask.Mask & (static_cast<KAFFINITY>(1) << bit))) continue;
+					auto processorIterator = processors.find((groupMask.Group * 64) + bit);
+					if(processorIterator == std::end(processors)) continue;
+					processorIterator->second.nodeIndex = nodeIndex;
+				}
+			}
+		}
+		for(auto& processorPair : processors)
+		{
+			processorPair.second.index = processorPair.first;
+			topology.processors.push_back(processorPair.second);
+		}
+		topology.nodeCount = std::max<unsigned int>(static_cast<unsigned int>(nodeIndices.size()), 1);
+	}
+#elif defined(__linux__)
+	std::string onlineList;
+	if(ReadSysFile("/sys/devices/system/cpu/online", onlineList))
+	{
+		static const std::string cpuPath = "/sys/devices/system/cpu/cpu";
+		std::map<std::pair<std::string, std::string>, unsigned int> coreIndices;
+		std::map<unsigned int, unsigned int> capacities;
+		for(auto cpu : ParseCpuList(onlineList))
+		{
+			auto cpuName = std::to_string(cpu);
+			std::string packageId, coreId, capacity;
+			ReadSysFile(cpuPath + cpuName + "/topology/physical_package_id", packageId);
+			if(!ReadSysFile(cpuPath + cpuName + "/topology/core_id", coreId))
+			{
+				coreId = "cpu" + cpuName;
+			}
+			auto coreKey = std::make_pair(packageId, coreId);
+			auto coreIterator = coreIndices.find(coreKey);
+			if(coreIterator == std::end(coreIndices))
+			{
+				coreIterator = coreIndices.insert(std::make_pair(coreKey, topology.coreCount++)).first;
+			}
+			ThreadUtils::LOGICAL_PROCESSOR processor;
+			processor.index = cpu;
+			processor.coreIndex = coreIterator->second;
+			//ARM big.LITTLE reports relative core performance
+			if(ReadSysFile(cpuPath + cpuName + "/cpu_capacity", capacity))
+			{
+				processor.efficiencyClass = std::stoul(capacity);
+				capacities[processor.efficiencyClass] = 0;
+			}
+			topology.processors.push_back(processor);
+		}
+
+		//Turn capacities into classes
+		unsigned int efficiencyClass = 0;
+		for(auto& capacityPair : capacities)
+		{
+			capacityPair.second = efficiencyClass++;
+		}
+		for(auto& processor : topology.processors)
+		{
+			processor.efficiencyClass = capacities.empty() ? 0 : capacities[processor.efficiencyClass];
+		}
+
+		//Intel hybrid processors list their cores separately
+		std::string atomList;
+		if(capacities.empty() && ReadSysFile("/sys/devices/cpu_atom/cpus", atomList))
+		{
+			auto atomCpus = ParseCpuList(atomList);
+			for(auto& processor : topology.processors)
+			{
+				bool isAtom = std::find(std::begin(atomCpus), std::end(atomCpus), processor.index) != std::end(atomCpus);
+				processor.efficiencyClass = isAtom ? 0 : 1;
+			}
+		}
+
+		std::string nodeList;
+		if(ReadSysFile("/sys/devices/system/node/online", nodeList))
+		{
+			for(auto node : ParseCpuList(nodeList))
+			{
+				std::string nodeCpuList;
+				if(!ReadSysFile("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist", nodeCpuList)) continue;
+				auto nodeCpus = ParseCpuList(nodeCpuList);
+				if(nodeCpus.empty()) continue;
+				for(auto& processor : topology.processors)
+				{
+					if(std::find(std::begin(nodeCpus), std::end(nodeCpus), processor.index) != std::end(nodeCpus))
+					{
+						processor.nodeIndex = topology.nodeCount;
+					}
+				}
+				topology.nodeCount++;
+			}
+		}
+		topology.nodeCount = std::max<unsigned int>(topology.nodeCount, 1);
+	}
+#endif
+	if(topology.processors.empty())
+	{
+		unsigned int processorCount = std::max<unsigned int>(std::thread::hardware_concurrency(), 1);
+		for(unsigned int i = 0; i < processorCount; i++)
+		{
+			ThreadUtils::LOGICAL_PROCESSOR processor;
+			processor.index = i;
+			processor.coreIndex = i;
+			topology.processors.push_back(processor);
+		}
+		topology.coreCount = processorCount;
+		topology.nodeCount = 1;
+	}
+	return topology;
+}
+
+const ThreadUtils::CPU_TOPOLOGY& ThreadUtils::GetCpuTopology()
+{
+	static const CPU_TOPOLOGY topology = QueryCpuTopology();
+	return topology;
+}
@@ -0,0 +1,105 @@
+#include "TimerService.h"
+#include <algorithm>
+#include <cassert>
+#include "ThreadUtils.h"
+
+using namespace Framework;
+
+CTimerService::CTimerService(TaskExecutor executor, std::chrono::milliseconds tickDuration)
+    : m_executor(std::move(executor))
+    , m_startTime(std::chrono::steady_clock::now())
+    , m_tickDuration(tickDuration)
+{
+	assert(tickDuration.count() > 0);
+	m_thread = std::thread([this]() { ThreadProc(); });
+	ThreadUtils::SetThreadName(m_thread, "Timer Service");
+}
+
+CTimerService::~CTimerService()
+{
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_stop = true;
+		m_condition.notify_one();
+	}
+	m_thread.join();
+}
+
+CTimerService::TimerId CTimerService::Schedule(std::chrono::milliseconds delay, CTask task)
+{
+	return ScheduleTimer(delay, std::move(task), 0);
+}
+
+CTimerService::TimerId CTimerService::SchedulePeriodic(std::chrono::milliseconds period, CTask task)
+{
+	return ScheduleTimer(period, std::move(task), std::max<uint64>(GetTickCount(period), 1));
+}
+
+bool CTimerService::Cancel(TimerId timerId)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	return m_wheel.Cancel(timerId);
+}
+
+uint64 CTimerService::GetCurrentTick() const
+{
+	return (std::chrono::steady_clock::now() - m_startTime) / m_tickDuration;
+}
+
+uint64 CTimerService::GetTickCount(std::chrono::milliseconds duration) const
+{
+	auto ticks = std::chrono::duration_cast<std::chrono::steady_clock::duration>(duration);
+	return (ticks + m_tickDuration - std::chrono::steady_clock::duration(1)) / m_tickDuration;
+}
+
+CTimerService::TimerId CTimerService::ScheduleTimer(std::chrono::milliseconds delay, CTask task, uint64 periodTicks)
+{
+	//Current tick is partly over already, one more keeps the delay from being cut short
+	uint64 expiryTick = GetCurrentTick() + GetTickCount(delay) + 1;
+	std::unique_lock<std::mutex> lock(m_mutex);
+	auto timerId = m_wheel.Schedule(expiryTick, std::move(task), periodTicks);
+	if(expiryTick < m_wakeTick)
+	{
+		m_condition.notify_one();
+	}
+	return timerId;
+}
+
+void CTimerService::ThreadProc()
+{
+	std::vector<CTask> expiredTasks;
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while(!m_stop)
+	{
+		m_wheel.Advance(GetCurrentTick(), expiredTasks);
+		if(!expiredTasks.empty())
+		{
+			lock.unlock();
+			for(auto& task : expiredTasks)
+			{
+				if(m_executor)
+				{
+					m_executor(std::move(task));
+				}
+				else
+				{
+					task();
+				}
+			}
+			expiredTasks.clear();
+			lock.lock();
+			continue;
+		}
+
+		m_wakeTick = m_wheel.GetNextEventTick();
+		if(m_wakeTick == ~0ULL)
+		{
+			m_condition.wait(lock);
+		}
+		else
+		{
+			m_condition.wait_until(lock, m_startTime + (m_tickDuration * m_wakeTick));
+		}
+		m_wakeTick = 0;
+	}
+}
@@ -0,0 +1,235 @@
+#include "TimerWheel.h"
+#include <algorithm>
+#include <cassert>
+
+using namespace Framework;
+
+namespace
+{
+	constexpr uint64 g_slotMask = Framework::CTimerWheel::SLOT_COUNT - 1;
+	//Farthest a timer can be put in the wheel, later ones go in the last level and get moved around again
+	constexpr uint64 g_maxDelta = (1ULL << (Framework::CTimerWheel::LEVEL_BITS * Framework::CTimerWheel::LEVEL_COUNT)) - 1;
+}
+
+CTimerWheel::CTimerWheel(uint64 currentTick)
+    : m_nextTick(currentTick + 1)
+{
+	std::fill(std::begin(m_slots), std::end(m_slots), INVALID_NODE);
+}
+
+uint64 CTimerWheel::GetCurrentTick() const
+{
+	return m_nextTick - 1;
+}
+
+size_t CTimerWheel::GetTimerCount() const
+{
+	return m_timerCount;
+}
+
+CTimerWheel::TimerId CTimerWheel::Schedule(uint64 expiryTick, CTask task, uint64 periodTicks)
+{
+	uint32 index = AllocateNode();
+	auto& node = m_nodes[index];
+	node.expiryTick = expiryTick;
+	node.periodTicks = periodTicks;
+	if(periodTicks != 0)
+	{
+		node.periodicTask = std::make_shared<CTask>(std::move(task));
+	}
+	else
+	{
+		node.task = std::move(task);
+	}
+	InsertNode(index);
+	m_timerCount++;
+	return (static_cast<uint64>(node.generation) << 32) | index;
+}
+
+bool CTimerWheel::Cancel(TimerId timerId)
+{
+	uint32 index = static_cast<uint32>(timerId);
+	uint32 generation = static_cast<uint32>(timerId >> 32);
+	if(index >= m_nodes.size()) return false;
+	const auto& node = m_nodes[index];
+	if((node.generation != generation) || (node.slot == INVALID_NODE)) return false;
+	UnlinkNode(index);
+	ReleaseNode(index);
+	m_timerCount--;
+	return true;
+}
+
+void CTimerWheel::Advance(uint64 tick, std::vector<CTask>& expiredTasks)
+{
+	while(m_nextTick <= tick)
+	{
+		if(m_timerCount == 0)
+		{
+			m_nextTick = tick + 1;
+			break;
+		}
+
+		//Ticks in between have nothing in their slot and nothing to move down
+		uint64 eventTick = GetNextEventTick();
+		if(eventTick > tick)
+		{
+			m_nextTick = tick + 1;
+			break;
+		}
+		m_nextTick = eventTick;
+
+		//Upper levels move down when the lower one wraps around
+		if((m_nextTick & g_slotMask) == 0)
+		{
+			for(uint32 level = 1; level < LEVEL_COUNT; level++)
+			{
+				Cascade(level);
+				if(((m_nextTick >> (LEVEL_BITS * level)) & g_slotMask) != 0) break;
+			}
+		}
+
+		auto& slot = m_slots[m_nextTick & g_slotMask];
+		uint32 index = slot;
+		slot = INVALID_NODE;
+		while(index != INVALID_NODE)
+		{
+			auto& node = m_nodes[index];
+			uint32 nextIndex = node.next;
+			node.slot = INVALID_NODE;
+			assert(node.expiryTick <= m_nextTick);
+			if(node.periodTicks != 0)
+			{
+				expiredTasks.emplace_back([task = node.periodicTask]() { (*task)(); });
+				node.expiryTick = m_nextTick + node.periodTicks;
+				InsertNode(index);
+			}
+			else
+			{
+				expiredTasks.emplace_back(std::move(node.task));
+				ReleaseNode(index);
+				m_timerCount--;
+			}
+			index = nextIndex;
+		}
+
+		m_nextTick++;
+	}
+}
+
+uint64 CTimerWheel::GetNextEventTick() const
+{
+	if(m_timerCount == 0) return ~0ULL;
+
+	uint64 eventTick = ~0ULL;
+	//Lowest level holds the timers expiring in the next SLOT_COUNT ticks
+	for(uint64 tick = m_nextTick; tick < (m_nextTick + SLOT_COUNT); tick++)
+	{
+		if(m_slots[tick & g_slotMask] != INVALID_NODE)
+		{
+			eventTick = tick;
+			break;
+		}
+	}
+	//Upper levels have something to do when one of their non-empty slots gets moved down,
+	//which happens on multiples of the level's slot span
+	for(uint32 level = 1; level < LEVEL_COUNT; level++)
+	{
+		uint32 shift = LEVEL_BITS * level;
+		uint64 span = 1ULL << shift;
+		uint64 cascadeTick = (m_nextTick + span - 1) & ~(span - 1);
+		for(uint32 i = 0; (i < SLOT_COUNT) && (cascadeTick < eventTick); i++, cascadeTick += span)
+		{
+			if(m_slots[(level * SLOT_COUNT) + ((cascadeTick >> shift) & g_slotMask)] != INVALID_NODE)
+			{
+				eventTick = cascadeTick;
+				break;
+			}
+		}
+	}
+	assert(eventTick != ~0ULL);
+	return eventTick;
+}
+
+uint32 CTimerWheel::AllocateNode()
+{
+	if(m_freeNodes != INVALID_NODE)
+	{
+		uint32 index = m_freeNodes;
+		m_freeNodes = m_nodes[index].next;
+		return index;
+	}
+	assert(m_nodes.size() < INVALID_NODE);
+	m_nodes.emplace_back();
+	return static_cast<uint32>(m_nodes.size() - 1);
+}
+
+void CTimerWheel::ReleaseNode(uint32 index)
+{
+	auto& node = m_nodes[index];
+	node.task.Reset();
+	node.periodicTask.reset();
+	node.generation++;
+	node.slot = INVALID_NODE;
+	node.prev = INVALID_NODE;
+	node.next = m_freeNodes;
+	m_freeNodes = index;
+}
+
+void CTimerWheel::InsertNode(uint32 index)
+{
+	auto& node = m_nodes[index];
+	//Timers that already expired go in the next tick's slot
+	uint64 expiryTick = std::max(node.expiryTick, m_nextTick);
+	uint64 delta = expiryTick - m_nextTick;
+	if(delta > g_maxDelta)
+	{
+		delta = g_maxDelta;
+		expiryTick = m_nextTick + g_maxDelta;
+	}
+	uint32 level = 0;
+	while((level < (LEVEL_COUNT - 1)) && (delta >> (LEVEL_BITS * (level + 1))) != 0)
+	{
+		level++;
+	}
+	uint32 slot = (level * SLOT_COUNT) + static_cast<uint32>((expiryTick >> (LEVEL_BITS * level)) & g_slotMask);
+
+	node.slot = slot;
+	node.prev = INVALID_NODE;
+	node.next = m_slots[slot];
+	if(node.next != INVALID_NODE)
+	{
+		m_nodes[node.next].prev = index;
+	}
+	m_slots[slot] = index;
+}
+
+void CTimerWheel::UnlinkNode(uint32 index)
+{
+	auto& node = m_nodes[index];
+	if(node.prev != INVALID_NODE)
+	{
+		m_nodes[node.prev].next = node.next;
+	}
+	else
+	{
+		m_slots[node.slot] = node.next;
+	}
+	if(node.next != INVALID_NODE)
+	{
+		m_nodes[node.next].prev = node.prev;
+	}
+	node.slot = INVALID_NODE;
+}
+
+void CTimerWheel::Cascade(uint32 level)
+{
+	auto& slot = m_slots[(level * SLOT_COUNT) + ((m_nextTick >> (LEVEL_BITS * level)) & g_slotMask)];
+	uint32 index = slot;
+	slot = INVALID_NODE;
+	while(index != INVALID_NODE)
+	{
+		uint32 nextIndex = m_nodes[index].next;
+		InsertNode(index);
+		index = nextIndex;
+	}
+}
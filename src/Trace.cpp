@@ -0,0 +1,162 @@
+#include "Trace.h"
+
+#if defined(FRAMEWORK_TRACE_ENABLED)
+
+#include <algorithm>
+#include <chrono>
+#include "string_format.h"
+
+#if defined(_WIN32) && defined(FRAMEWORK_TRACE_ETW)
+#include <Windows.h>
+#include <TraceLoggingProvider.h>
+
+//{8C2B8C4A-3F0E-4F43-9E4B-5D3C1A7F2E61}
+TRACELOGGING_DEFINE_PROVIDER(g_etwProvider, "Framework.Trace",
+	(0x8c2b8c4a, 0x3f0e, 0x4f43, 0x9e, 0x4b, 0x5d, 0x3c, 0x1a, 0x7f, 0x2e, 0x61));
+#endif
+
+using namespace Framework;
+
+static thread_local void* g_threadBuffer = nullptr;
+
+static uint64 GetSteadyTime()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+CTraceRecorder::CTraceRecorder()
+: m_enabled(false)
+, m_baseTime(GetSteadyTime())
+{
+#if defined(_WIN32) && defined(FRAMEWORK_TRACE_ETW)
+	TraceLoggingRegister(g_etwProvider);
+#endif
+}
+
+void CTraceRecorder::SetEnabled(bool enabled)
+{
+	m_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool CTraceRecorder::IsEnabled() const
+{
+	return m_enabled.load(std::memory_order_relaxed);
+}
+
+void CTraceRecorder::SetThreadName(std::string threadName)
+{
+	auto& threadBuffer = GetThreadBuffer();
+	std::lock_guard<std::mutex> lock(m_threadBuffersMutex);
+	threadBuffer.threadName = std::move(threadName);
+}
+
+uint64 CTraceRecorder::GetTime() const
+{
+	return GetSteadyTime() - m_baseTime;
+}
+
+void CTraceRecorder::Record(const char* name, uint64 beginTime, uint64 endTime)
+{
+	auto& threadBuffer = GetThreadBuffer();
+	//Only this thread writes in the buffer
+	uint64 writeCount = threadBuffer.writeCount.load(std::memory_order_relaxed);
+	auto& event = threadBuffer.events[writeCount % THREAD_EVENT_COUNT];
+	event.name.store(name, std::memory_order_relaxed);
+	event.beginTime.store(beginTime, std::memory_order_relaxed);
+	event.endTime.store(endTime, std::memory_order_relaxed);
+	threadBuffer.writeCount.store(writeCount + 1, std::memory_order_release);
+
+#if defined(_WIN32) && defined(FRAMEWORK_TRACE_ETW)
+	TraceLoggingWrite(g_etwProvider, "Scope",
+		TraceLoggingString(name, "Name"),
+		TraceLoggingUInt64(beginTime, "BeginTime"),
+		TraceLoggingUInt64(endTime - beginTime, "Duration"));
+#endif
+}
+
+void CTraceRecorder::Clear()
+{
+	//Buffers are only written by their thread, events recorded so far are skipped by exports instead
+	std::lock_guard<std::mutex> lock(m_threadBuffersMutex);
+	for(auto& threadBuffer : m_threadBuffers)
+	{
+		threadBuffer->clearedCount = threadBuffer->writeCount.load(std::memory_order_acquire);
+	}
+}
+
+std::string CTraceRecorder::ExportChromeJson()
+{
+	std::string result = "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+	bool firstEvent = true;
+	std::vector<EVENT_COPY> events;
+
+	std::lock_guard<std::mutex> lock(m_threadBuffersMutex);
+	for(const auto& threadBuffer : m_threadBuffers)
+	{
+		if(!threadBuffer->threadName.empty())
+		{
+			//Names are expected to be plain identifiers, only escape what would break the output
+			std::string threadName;
+			for(auto nameChar : threadBuffer->threadName)
+			{
+				if((nameChar == '\"') || (nameChar == '\\')) threadName += '\\';
+				threadName += nameChar;
+			}
+			if(!firstEvent) result += ",";
+			firstEvent = false;
+			string_format_to(result, FORMAT_STRING("{{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":{},\"args\":{{\"name\":\"{}\"}}}}"),
+			                 threadBuffer->threadIndex, threadName);
+		}
+
+		uint64 writeCount = threadBuffer->writeCount.load(std::memory_order_acquire);
+		uint64 firstIndex = (writeCount > THREAD_EVENT_COUNT) ? (writeCount - THREAD_EVENT_COUNT) : 0;
+		firstIndex = std::max(firstIndex, threadBuffer->clearedCount);
+		events.clear();
+		for(uint64 i = firstIndex; i < writeCount; i++)
+		{
+			const auto& event = threadBuffer->events[i % THREAD_EVENT_COUNT];
+			EVENT_COPY eventCopy;
+			eventCopy.name = event.name.load(std::memory_order_relaxed);
+			eventCopy.beginTime = event.beginTime.load(std::memory_order_relaxed);
+			eventCopy.endTime = event.endTime.load(std::memory_order_relaxed);
+			events.push_back(eventCopy);
+		}
+		//Events that were overwritten while being copied are dropped
+		uint64 newWriteCount = threadBuffer->writeCount.load(std::memory_order_acquire);
+		uint64 validIndex = (newWriteCount > THREAD_EVENT_COUNT) ? (newWriteCount - THREAD_EVENT_COUNT) : 0;
+		size_t skipCount = static_cast<size_t>(std::min<uint64>(std::max(validIndex, firstIndex) - firstIndex, events.size()));
+
+		for(size_t i = skipCount; i < events.size(); i++)
+		{
+			const auto& event = events[i];
+			if(!firstEvent) result += ",";
+			firstEvent = false;
+			//Timestamps are in microseconds
+			string_format_to(result, FORMAT_STRING("{{\"ph\":\"X\",\"name\":\"{}\",\"pid\":1,\"tid\":{},\"ts\":{}.{:03},\"dur\":{}.{:03}}}"),
+			                 event.name, threadBuffer->threadIndex,
+			                 event.beginTime / 1000, event.beginTime % 1000,
+			                 (event.endTime - event.beginTime) / 1000, (event.endTime - event.beginTime) % 1000);
+		}
+	}
+	result += "]}";
+	return result;
+}
+
+CTraceRecorder::THREAD_BUFFER& CTraceRecorder::GetThreadBuffer()
+{
+	if(g_threadBuffer)
+	{
+		return *reinterpret_cast<THREAD_BUFFER*>(g_threadBuffer);
+	}
+	//Buffers are kept after their thread exits so that its events can still be exported
+	auto threadBuffer = std::make_unique<THREAD_BUFFER>();
+	threadBuffer->writeCount = 0;
+	threadBuffer->events = std::make_unique<EVENT[]>(THREAD_EVENT_COUNT);
+	std::lock_guard<std::mutex> lock(m_threadBuffersMutex);
+	threadBuffer->threadIndex = static_cast<uint32>(m_threadBuffers.size());
+	g_threadBuffer = threadBuffer.get();
+	m_threadBuffers.push_back(std::move(threadBuffer));
+	return *reinterpret_cast<THREAD_BUFFER*>(g_threadBuffer);
+}
+
+#endif
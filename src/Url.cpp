@@ -1,22 +1,210 @@
 #include "Url.h"
-#include "string_format.h"
-#include <set>
+#include <algorithm>
+#include <array>
 
-std::string Framework::UrlEncode(const std::string& input)
+namespace
 {
-	static const std::set<char> allowedSymbols = {'-', '_', '.', '~', '/'};
+	enum CHAR_CLASS : unsigned char
+	{
+		CHAR_CLASS_ESCAPED,
+		CHAR_CLASS_UNRESERVED,
+		CHAR_CLASS_SLASH,
+	};
+
+	constexpr std::array<unsigned char, 0x100> MakeCharClasses()
+	{
+		std::array<unsigned char, 0x100> result = {};
+		for(unsigned int i = '0'; i <= '9'; i++) result[i] = CHAR_CLASS_UNRESERVED;
+		for(unsigned int i = 'A'; i <= 'Z'; i++) result[i] = CHAR_CLASS_UNRESERVED;
+		for(unsigned int i = 'a'; i <= 'z'; i++) result[i] = CHAR_CLASS_UNRESERVED;
+		result['-'] = CHAR_CLASS_UNRESERVED;
+		result['_'] = CHAR_CLASS_UNRESERVED;
+		result['.'] = CHAR_CLASS_UNRESERVED;
+		result['~'] = CHAR_CLASS_UNRESERVED;
+		result['/'] = CHAR_CLASS_SLASH;
+		return result;
+	}
+
+	constexpr auto g_charClasses = MakeCharClasses();
+	constexpr char g_hexDigits[] = "0123456789ABCDEF";
 
+	bool IsKept(unsigned char value, bool keepSlashes)
+	{
+		auto charClass = g_charClasses[value];
+		return (charClass == CHAR_CLASS_UNRESERVED) || (keepSlashes && (charClass == CHAR_CLASS_SLASH));
+	}
+
+	int GetHexDigitValue(char value)
+	{
+		if((value >= '0') && (value <= '9')) return value - '0';
+		if((value >= 'A') && (value <= 'F')) return value - 'A' + 10;
+		if((value >= 'a') && (value <= 'f')) return value - 'a' + 10;
+		return -1;
+	}
+}
+
+std::string Framework::UrlEncode(std::string_view input, bool keepSlashes)
+{
 	std::string result;
+	UrlEncodeTo(result, input, keepSlashes);
+	return result;
+}
+
+void Framework::UrlEncodeTo(std::string& output, std::string_view input, bool keepSlashes)
+{
+	size_t outputStart = output.size();
+	output.resize(outputStart + GetUrlEncodedSize(input, keepSlashes));
+	UrlEncode(input, output.data() + outputStart, keepSlashes);
+}
+
+size_t Framework::GetUrlEncodedSize(std::string_view input, bool keepSlashes)
+{
+	size_t result = input.size();
+	for(auto inputChar : input)
+	{
+		if(!IsKept(static_cast<unsigned char>(inputChar), keepSlashes)) result += 2;
+	}
+	return result;
+}
+
+size_t Framework::UrlEncode(std::string_view input, char* output, bool keepSlashes)
+{
+	char* outputPtr = output;
 	for(auto inputChar : input)
 	{
-		if(isalnum(inputChar) || allowedSymbols.find(inputChar) != allowedSymbols.end())
+		auto value = static_cast<unsigned char>(inputChar);
+		if(IsKept(value, keepSlashes))
 		{
-			result += inputChar;
+			*outputPtr++ = inputChar;
 		}
 		else
 		{
-			result += string_format("%%%02X", inputChar);
+			outputPtr[0] = '%';
+			outputPtr[1] = g_hexDigits[value >> 4];
+			outputPtr[2] = g_hexDigits[value & 0x0F];
+			outputPtr += 3;
+		}
+	}
+	return outputPtr - output;
+}
+
+std::string Framework::UrlDecode(std::string_view input, bool plusAsSpace)
+{
+	std::string result;
+	result.resize(input.size());
+	size_t outputSize = 0;
+	for(size_t i = 0; i < input.size(); i++)
+	{
+		char inputChar = input[i];
+		if((inputChar == '%') && ((i + 2) < input.size()))
+		{
+			int highDigit = GetHexDigitValue(input[i + 1]);
+			int lowDigit = GetHexDigitValue(input[i + 2]);
+			if((highDigit >= 0) && (lowDigit >= 0))
+			{
+				inputChar = static_cast<char>((highDigit << 4) | lowDigit);
+				i += 2;
+			}
+		}
+		else if(plusAsSpace && (inputChar == '+'))
+		{
+			inputChar = ' ';
+		}
+		result[outputSize++] = inputChar;
+	}
+	result.resize(outputSize);
+	return result;
+}
+
+Framework::URL_COMPONENTS Framework::ParseUrl(std::string_view url)
+{
+	URL_COMPONENTS result;
+
+	auto fragmentStart = url.find('#');
+	if(fragmentStart != std::string_view::npos)
+	{
+		result.fragment = url.substr(fragmentStart + 1);
+		url = url.substr(0, fragmentStart);
+	}
+
+	auto queryStart = url.find('?');
+	if(queryStart != std::string_view::npos)
+	{
+		result.query = url.substr(queryStart + 1);
+		url = url.substr(0, queryStart);
+	}
+
+	auto schemeEnd = url.find("://");
+	if(schemeEnd == std::string_view::npos)
+	{
+		result.path = url;
+		return result;
+	}
+	result.scheme = url.substr(0, schemeEnd);
+	url = url.substr(schemeEnd + 3);
+
+	auto authorityEnd = url.find('/');
+	auto authority = url.substr(0, authorityEnd);
+	result.path = (authorityEnd == std::string_view::npos) ? std::string_view("/") : url.substr(authorityEnd);
+
+	auto userInfoEnd = authority.rfind('@');
+	if(userInfoEnd != std::string_view::npos)
+	{
+		authority = authority.substr(userInfoEnd + 1);
+	}
+
+	//IPv6 addresses have colons of their own
+	size_t hostEnd = 0;
+	if(!authority.empty() && (authority[0] == '['))
+	{
+		hostEnd = authority.find(']');
+		if(hostEnd == std::string_view::npos)
+		{
+			result.host = authority;
+			return result;
 		}
+		result.host = authority.substr(1, hostEnd - 1);
+		hostEnd++;
+	}
+	else
+	{
+		hostEnd = std::min(authority.find(':'), authority.size());
+		result.host = authority.substr(0, hostEnd);
+	}
+	if((hostEnd < authority.size()) && (authority[hostEnd] == ':'))
+	{
+		result.port = authority.substr(hostEnd + 1);
 	}
+
 	return result;
 }
+
+Framework::CUrlQueryBuilder& Framework::CUrlQueryBuilder::Add(std::string_view name, std::string_view value)
+{
+	size_t nameSize = GetUrlEncodedSize(name, false);
+	size_t valueSize = GetUrlEncodedSize(value, false);
+	size_t start = m_query.size();
+	bool needsSeparator = (start != 0);
+	m_query.resize(start + (needsSeparator ? 1 : 0) + nameSize + 1 + valueSize);
+	char* output = m_query.data() + start;
+	if(needsSeparator) *output++ = '&';
+	output += UrlEncode(name, output, false);
+	*output++ = '=';
+	UrlEncode(value, output, false);
+	return *this;
+}
+
+Framework::CUrlQueryBuilder& Framework::CUrlQueryBuilder::Add(std::string_view name, unsigned int value)
+{
+	return Add(name, std::to_string(value));
+}
+
+bool Framework::CUrlQueryBuilder::IsEmpty() const
+{
+	return m_query.empty();
+}
+
+const std::string& Framework::CUrlQueryBuilder::GetString() const
+{
+	return m_query;
+}
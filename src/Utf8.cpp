@@ -1,13 +1,465 @@
+#include <cstring>
 #include "Utf8.h"
+#include "Types.h"
+#include "SimdDefs.h"
+
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+#include <emmintrin.h>
+#elif defined(FRAMEWORK_SIMD_USE_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define UTF8_USE_NEON
+#endif
 
 using namespace Framework;
 
-std::wstring Utf8::ConvertFrom(const std::string& sString)
+static const uint32 INVALID_CODE_POINT = ~0U;
+static const size_t BLOCK_SIZE = 16;
+
+//ASCII fast paths, they go through the input in blocks of 16 code units and stop at the first
+//block that contains anything else, returning how much was processed (a multiple of 16)
+
+static size_t GetAsciiPrefixSize(const uint8* input, size_t size)
+{
+	size_t position = 0;
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+	for(; (size - position) >= BLOCK_SIZE; position += BLOCK_SIZE)
+	{
+		__m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + position));
+		if(_mm_movemask_epi8(bytes) != 0) break;
+	}
+#elif defined(UTF8_USE_NEON)
+	for(; (size - position) >= BLOCK_SIZE; position += BLOCK_SIZE)
+	{
+		uint8x16_t bytes = vld1q_u8(input + position);
+		if(vmaxvq_u8(bytes) >= 0x80) break;
+	}
+#endif
+	return position;
+}
+
+template <typename CharType>
+static size_t WidenAscii(const uint8* input, size_t size, CharType* output)
+{
+	static_assert((sizeof(CharType) == 2) || (sizeof(CharType) == 4), "Unsupported code unit size.");
+	size_t position = 0;
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+	for(; (size - position) >= BLOCK_SIZE; position += BLOCK_SIZE)
+	{
+		__m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + position));
+		if(_mm_movemask_epi8(bytes) != 0) break;
+		__m128i zero = _mm_setzero_si128();
+		__m128i units0 = _mm_unpacklo_epi8(bytes, zero);
+		__m128i units1 = _mm_unpackhi_epi8(bytes, zero);
+		auto blockOutput = reinterpret_cast<__m128i*>(output + position);
+		if constexpr(sizeof(CharType) == 2)
+		{
+			_mm_storeu_si128(blockOutput + 0, units0);
+			_mm_storeu_si128(blockOutput + 1, units1);
+		}
+		else
+		{
+			_mm_storeu_si128(blockOutput + 0, _mm_unpacklo_epi16(units0, zero));
+			_mm_storeu_si128(blockOutput + 1, _mm_unpackhi_epi16(units0, zero));
+			_mm_storeu_si128(blockOutput + 2, _mm_unpacklo_epi16(units1, zero));
+			_mm_storeu_si128(blockOutput + 3, _mm_unpackhi_epi16(units1, zero));
+		}
+	}
+#elif defined(UTF8_USE_NEON)
+	for(; (size - position) >= BLOCK_SIZE; position += BLOCK_SIZE)
+	{
+		uint8x16_t bytes = vld1q_u8(input + position);
+		if(vmaxvq_u8(bytes) >= 0x80) break;
+		uint16x8_t units0 = vmovl_u8(vget_low_u8(bytes));
+		uint16x8_t units1 = vmovl_high_u8(bytes);
+		if constexpr(sizeof(CharType) == 2)
+		{
+			auto blockOutput = reinterpret_cast<uint16*>(output + position);
+			vst1q_u16(blockOutput + 0, units0);
+			vst1q_u16(blockOutput + 8, units1);
+		}
+		else
+		{
+			auto blockOutput = reinterpret_cast<uint32*>(output + position);
+			vst1q_u32(blockOutput + 0, vmovl_u16(vget_low_u16(units0)));
+			vst1q_u32(blockOutput + 4, vmovl_high_u16(units0));
+			vst1q_u32(blockOutput + 8, vmovl_u16(vget_low_u16(units1)));
+			vst1q_u32(blockOutput + 12, vmovl_high_u16(units1));
+		}
+	}
+#endif
+	return position;
+}
+
+template <typename CharType>
+static size_t NarrowAscii(const CharType* input, size_t size, uint8* output)
+{
+	static_assert((sizeof(CharType) == 2) || (sizeof(CharType) == 4), "Unsupported code unit size.");
+	size_t position = 0;
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+	for(; (size - position) >= BLOCK_SIZE; position += BLOCK_SIZE)
+	{
+		auto blockInput = reinterpret_cast<const __m128i*>(input + position);
+		__m128i bytes;
+		if constexpr(sizeof(CharType) == 2)
+		{
+			__m128i units0 = _mm_loadu_si128(blockInput + 0);
+			__m128i units1 = _mm_loadu_si128(blockInput + 1);
+			__m128i nonAscii = _mm_and_si128(_mm_or_si128(units0, units1), _mm_set1_epi16(static_cast<int16>(0xFF80)));
+			if(_mm_movemask_epi8(_mm_cmpeq_epi16(nonAscii, _mm_setzero_si128())) != 0xFFFF) break;
+			bytes = _mm_packus_epi16(units0, units1);
+		}
+		else
+		{
+			__m128i units0 = _mm_loadu_si128(blockInput + 0);
+			__m128i units1 = _mm_loadu_si128(blockInput + 1);
+			__m128i units2 = _mm_loadu_si128(blockInput + 2);
+			__m128i units3 = _mm_loadu_si128(blockInput + 3);
+			__m128i allUnits = _mm_or_si128(_mm_or_si128(units0, units1), _mm_or_si128(units2, units3));
+			__m128i nonAscii = _mm_and_si128(allUnits, _mm_set1_epi32(static_cast<int32>(0xFFFFFF80)));
+			if(_mm_movemask_epi8(_mm_cmpeq_epi32(nonAscii, _mm_setzero_si128())) != 0xFFFF) break;
+			//Everything is below 0x80, signed saturation doesn't change anything
+			bytes = _mm_packus_epi16(_mm_packs_epi32(units0, units1), _mm_packs_epi32(units2, units3));
+		}
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(output + position), bytes);
+	}
+#elif defined(UTF8_USE_NEON)
+	for(; (size - position) >= BLOCK_SIZE; position += BLOCK_SIZE)
+	{
+		uint8x16_t bytes;
+		if constexpr(sizeof(CharType) == 2)
+		{
+			auto blockInput = reinterpret_cast<const uint16*>(input + position);
+			uint16x8_t units0 = vld1q_u16(blockInput + 0);
+			uint16x8_t units1 = vld1q_u16(blockInput + 8);
+			if(vmaxvq_u16(vorrq_u16(units0, units1)) >= 0x80) break;
+			bytes = vcombine_u8(vmovn_u16(units0), vmovn_u16(units1));
+		}
+		else
+		{
+			auto blockInput = reinterpret_cast<const uint32*>(input + position);
+			uint32x4_t units0 = vld1q_u32(blockInput + 0);
+			uint32x4_t units1 = vld1q_u32(blockInput + 4);
+			uint32x4_t units2 = vld1q_u32(blockInput + 8);
+			uint32x4_t units3 = vld1q_u32(blockInput + 12);
+			if(vmaxvq_u32(vorrq_u32(vorrq_u32(units0, units1), vorrq_u32(units2, units3))) >= 0x80) break;
+			uint16x8_t units01 = vcombine_u16(vmovn_u32(units0), vmovn_u32(units1));
+			uint16x8_t units23 = vcombine_u16(vmovn_u32(units2), vmovn_u32(units3));
+			bytes = vcombine_u8(vmovn_u16(units01), vmovn_u16(units23));
+		}
+		vst1q_u8(output + position, bytes);
+	}
+#endif
+	return position;
+}
+
+template <typename CharType>
+static size_t GetAsciiPrefixSize(const CharType* input, size_t size)
+{
+	//Only used for counting, the narrowed bytes are thrown away
+	uint8 scratch[BLOCK_SIZE];
+	size_t position = 0;
+	while((size - position) >= BLOCK_SIZE)
+	{
+		if(NarrowAscii(input + position, BLOCK_SIZE, scratch) == 0) break;
+		position += BLOCK_SIZE;
+	}
+	return position;
+}
+
+//Scalar decoding and encoding of a single code point
+
+static uint32 DecodeCodePoint(const uint8*& input, const uint8* inputEnd)
+{
+	uint32 lead = *(input++);
+	if(lead < 0x80) return lead;
+	size_t remaining = inputEnd - input;
+	if(lead < 0xC2)
+	{
+		//Continuation byte or overlong 2 byte sequence
+		return INVALID_CODE_POINT;
+	}
+	else if(lead < 0xE0)
+	{
+		if((remaining < 1) || ((input[0] & 0xC0) != 0x80)) return INVALID_CODE_POINT;
+		uint32 codePoint = ((lead & 0x1F) << 6) | (input[0] & 0x3F);
+		input += 1;
+		return codePoint;
+	}
+	else if(lead < 0xF0)
+	{
+		if((remaining < 2) || ((input[0] & 0xC0) != 0x80) || ((input[1] & 0xC0) != 0x80)) return INVALID_CODE_POINT;
+		uint32 codePoint = ((lead & 0x0F) << 12) | ((input[0] & 0x3F) << 6) | (input[1] & 0x3F);
+		if((codePoint < 0x800) || ((codePoint >= 0xD800) && (codePoint < 0xE000))) return INVALID_CODE_POINT;
+		input += 2;
+		return codePoint;
+	}
+	else if(lead < 0xF5)
+	{
+		if((remaining < 3) || ((input[0] & 0xC0) != 0x80) || ((input[1] & 0xC0) != 0x80) || ((input[2] & 0xC0) != 0x80)) return INVALID_CODE_POINT;
+		uint32 codePoint = ((lead & 0x07) << 18) | ((input[0] & 0x3F) << 12) | ((input[1] & 0x3F) << 6) | (input[2] & 0x3F);
+		if((codePoint < 0x10000) || (codePoint > 0x10FFFF)) return INVALID_CODE_POINT;
+		input += 3;
+		return codePoint;
+	}
+	return INVALID_CODE_POINT;
+}
+
+template <typename CharType>
+static uint32 DecodeCodePoint(const CharType*& input, const CharType* inputEnd)
+{
+	if constexpr(sizeof(CharType) == 2)
+	{
+		uint32 unit = static_cast<uint16>(*(input++));
+		if((unit < 0xD800) || (unit >= 0xE000)) return unit;
+		if((unit >= 0xDC00) || (input == inputEnd)) return INVALID_CODE_POINT;
+		uint32 lowUnit = static_cast<uint16>(*input);
+		if((lowUnit < 0xDC00) || (lowUnit >= 0xE000)) return INVALID_CODE_POINT;
+		input++;
+		return 0x10000 + ((unit - 0xD800) << 10) + (lowUnit - 0xDC00);
+	}
+	else
+	{
+		uint32 unit = static_cast<uint32>(*(input++));
+		if((unit > 0x10FFFF) || ((unit >= 0xD800) && (unit < 0xE000))) return INVALID_CODE_POINT;
+		return unit;
+	}
+}
+
+template <typename CharType>
+static size_t GetCodeUnitCount(uint32 codePoint)
+{
+	if constexpr(sizeof(CharType) == 2)
+	{
+		return ((codePoint != INVALID_CODE_POINT) && (codePoint >= 0x10000)) ? 2 : 1;
+	}
+	else
+	{
+		return 1;
+	}
+}
+
+template <typename CharType>
+static size_t EncodeCodePoint(uint32 codePoint, CharType* output)
+{
+	if(codePoint == INVALID_CODE_POINT)
+	{
+		output[0] = '?';
+		return 1;
+	}
+	if constexpr(sizeof(CharType) == 2)
+	{
+		if(codePoint >= 0x10000)
+		{
+			codePoint -= 0x10000;
+			output[0] = static_cast<CharType>(0xD800 | (codePoint >> 10));
+			output[1] = static_cast<CharType>(0xDC00 | (codePoint & 0x3FF));
+			return 2;
+		}
+	}
+	output[0] = static_cast<CharType>(codePoint);
+	return 1;
+}
+
+static size_t GetUtf8CodeUnitCount(uint32 codePoint)
+{
+	if(codePoint < 0x80) return 1;
+	if(codePoint < 0x800) return 2;
+	if(codePoint < 0x10000) return 3;
+	if(codePoint == INVALID_CODE_POINT) return 1;
+	return 4;
+}
+
+static size_t EncodeCodePoint(uint32 codePoint, uint8* output)
+{
+	if(codePoint < 0x80)
+	{
+		output[0] = static_cast<uint8>(codePoint);
+		return 1;
+	}
+	else if(codePoint < 0x800)
+	{
+		output[0] = static_cast<uint8>(0xC0 | (codePoint >> 6));
+		output[1] = static_cast<uint8>(0x80 | (codePoint & 0x3F));
+		return 2;
+	}
+	else if(codePoint < 0x10000)
+	{
+		output[0] = static_cast<uint8>(0xE0 | (codePoint >> 12));
+		output[1] = static_cast<uint8>(0x80 | ((codePoint >> 6) & 0x3F));
+		output[2] = static_cast<uint8>(0x80 | (codePoint & 0x3F));
+		return 3;
+	}
+	else if(codePoint == INVALID_CODE_POINT)
+	{
+		output[0] = '?';
+		return 1;
+	}
+	else
+	{
+		output[0] = static_cast<uint8>(0xF0 | (codePoint >> 18));
+		output[1] = static_cast<uint8>(0x80 | ((codePoint >> 12) & 0x3F));
+		output[2] = static_cast<uint8>(0x80 | ((codePoint >> 6) & 0x3F));
+		output[3] = static_cast<uint8>(0x80 | (codePoint & 0x3F));
+		return 4;
+	}
+}
+
+//Conversions, the ASCII fast path is tried again after every code point that needed the scalar path
+
+template <typename CharType>
+static size_t GetDecodedLength(const char* source, size_t size)
+{
+	auto input = reinterpret_cast<const uint8*>(source);
+	auto inputEnd = input + size;
+	size_t length = 0;
+	while(true)
+	{
+		size_t asciiSize = GetAsciiPrefixSize(input, inputEnd - input);
+		input += asciiSize;
+		length += asciiSize;
+		if(input == inputEnd) break;
+		length += GetCodeUnitCount<CharType>(DecodeCodePoint(input, inputEnd));
+	}
+	return length;
+}
+
+template <typename CharType>
+static size_t Decode(const char* source, size_t size, CharType* output)
+{
+	auto input = reinterpret_cast<const uint8*>(source);
+	auto inputEnd = input + size;
+	auto outputStart = output;
+	while(true)
+	{
+		size_t asciiSize = WidenAscii(input, inputEnd - input, output);
+		input += asciiSize;
+		output += asciiSize;
+		if(input == inputEnd) break;
+		output += EncodeCodePoint(DecodeCodePoint(input, inputEnd), output);
+	}
+	return output - outputStart;
+}
+
+template <typename CharType>
+static size_t GetEncodedLength(const CharType* input, size_t size)
+{
+	auto inputEnd = input + size;
+	size_t length = 0;
+	while(true)
+	{
+		size_t asciiSize = GetAsciiPrefixSize(input, inputEnd - input);
+		input += asciiSize;
+		length += asciiSize;
+		if(input == inputEnd) break;
+		length += GetUtf8CodeUnitCount(DecodeCodePoint(input, inputEnd));
+	}
+	return length;
+}
+
+template <typename CharType>
+static size_t Encode(const CharType* input, size_t size, char* destination)
+{
+	auto inputEnd = input + size;
+	auto output = reinterpret_cast<uint8*>(destination);
+	auto outputStart = output;
+	while(true)
+	{
+		size_t asciiSize = NarrowAscii(input, inputEnd - input, output);
+		input += asciiSize;
+		output += asciiSize;
+		if(input == inputEnd) break;
+		output += EncodeCodePoint(DecodeCodePoint(input, inputEnd), output);
+	}
+	return output - outputStart;
+}
+
+bool Utf8::IsValid(const char* source, size_t size)
+{
+	auto input = reinterpret_cast<const uint8*>(source);
+	auto inputEnd = input + size;
+	while(true)
+	{
+		input += GetAsciiPrefixSize(input, inputEnd - input);
+		if(input == inputEnd) return true;
+		if(DecodeCodePoint(input, inputEnd) == INVALID_CODE_POINT) return false;
+	}
+}
+
+size_t Utf8::GetUtf16Length(const char* input, size_t size)
+{
+	return GetDecodedLength<char16_t>(input, size);
+}
+
+size_t Utf8::GetUtf32Length(const char* input, size_t size)
+{
+	return GetDecodedLength<char32_t>(input, size);
+}
+
+size_t Utf8::GetUtf8Length(const char16_t* input, size_t size)
+{
+	return GetEncodedLength(input, size);
+}
+
+size_t Utf8::GetUtf8Length(const char32_t* input, size_t size)
+{
+	return GetEncodedLength(input, size);
+}
+
+size_t Utf8::ConvertToUtf16(const char* input, size_t size, char16_t* output)
+{
+	return Decode(input, size, output);
+}
+
+size_t Utf8::ConvertToUtf32(const char* input, size_t size, char32_t* output)
+{
+	return Decode(input, size, output);
+}
+
+size_t Utf8::ConvertFromUtf16(const char16_t* input, size_t size, char* output)
+{
+	return Encode(input, size, output);
+}
+
+size_t Utf8::ConvertFromUtf32(const char32_t* input, size_t size, char* output)
+{
+	return Encode(input, size, output);
+}
+
+size_t Utf8::WidenAsciiPrefix(const char* source, size_t size, wchar_t* output)
+{
+	auto input = reinterpret_cast<const uint8*>(source);
+	size_t position = WidenAscii(input, size, output);
+	for(; (position != size) && (input[position] < 0x80); position++)
+	{
+		output[position] = input[position];
+	}
+	return position;
+}
+
+std::wstring Utf8::ConvertFrom(const char* input, size_t size)
+{
+	//Never more code units than input bytes, allocating for the worst case is cheaper than counting first
+	std::wstring result;
+	result.resize(size);
+	result.resize(Decode(input, size, &result[0]));
+	return result;
+}
+
+std::string Utf8::ConvertTo(const wchar_t* input, size_t size)
+{
+	//The worst case is 3 or 4 times the input size, count first to allocate the exact size
+	std::string result;
+	result.resize(GetEncodedLength(input, size));
+	Encode(input, size, &result[0]);
+	return result;
+}
+
+std::wstring Utf8::ConvertFrom(const std::string& input)
 {
-	return ConvertFrom(sString.begin(), sString.end());
+	return ConvertFrom(input.data(), input.size());
 }
 
 std::string Utf8::ConvertTo(const std::wstring& input)
 {
-	return ConvertTo(input.begin(), input.end());
+	return ConvertTo(input.data(), input.size());
 }
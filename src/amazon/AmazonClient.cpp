@@ -3,7 +3,10 @@
 #include <algorithm>
 #include <cassert>
 #include <ctime>
+#include <optional>
+#include <random>
 #include <stdexcept>
+#include <thread>
 #include "HashUtils.h"
 #include "string_format.h"
 
@@ -19,30 +22,37 @@ static std::string hashToString(const std::array<uint8, 0x20> hash)
 	return result;
 }
 
-static std::string buildSignedHeadersParam(const Framework::Http::HeaderMap& headers)
+typedef std::vector<std::pair<std::string, std::string>> CanonicalHeaderArray;
+
+//Lower case names, sorted
+static CanonicalHeaderArray buildCanonicalHeaders(const Framework::Http::HeaderMap& headers)
 {
-	std::string result;
-	for(auto headerPairIterator = headers.begin();
-		headerPairIterator != headers.end(); headerPairIterator++)
-	{
-		bool isEnd =
-			[&]() {
-			auto headerPairIteratorCopy = headerPairIterator;
-			headerPairIteratorCopy++;
-			return headerPairIteratorCopy == std::end(headers);
-		}();
-		auto headerKey = headerPairIterator->first;
+	CanonicalHeaderArray result;
+	for(const auto& header : headers)
+	{
+		auto headerKey = std::string(header.name);
 		std::transform(headerKey.begin(), headerKey.end(), headerKey.begin(), &::tolower);
-		result += headerKey;
-		if(!isEnd)
+		result.emplace_back(std::move(headerKey), std::string(header.value));
+	}
+	std::sort(result.begin(), result.end());
+	return result;
+}
+
+static std::string buildSignedHeadersParam(const CanonicalHeaderArray& headers)
+{
+	std::string result;
+	for(const auto& headerPair : headers)
+	{
+		if(!result.empty())
 		{
 			result += ";";
 		}
+		result += headerPair.first;
 	}
 	return result;
 }
 
-static std::string buildCanonicalRequest(Framework::Http::HTTP_VERB method, const std::string& uri, const std::string& query, const std::string& hashedPayload, const Framework::Http::HeaderMap& headers)
+static std::string buildCanonicalRequest(Framework::Http::HTTP_VERB method, const std::string& uri, const std::string& query, const std::string& hashedPayload, const CanonicalHeaderArray& headers)
 {
 	std::string result;
 	switch (method)
@@ -79,12 +89,9 @@ static std::string buildCanonicalRequest(Framework::Http::HTTP_VERB method, cons
 	//CanonicalHeaders
 	for (const auto& headerPair : headers)
 	{
-		auto headerKey = headerPair.first;
-		auto headerValue = headerPair.second;
-		std::transform(headerKey.begin(), headerKey.end(), headerKey.begin(), &::tolower);
-		result += headerKey;
+		result += headerPair.first;
 		result += ":";
-		result += headerValue;
+		result += headerPair.second;
 		result += "\n";
 	}
 	result += "\n";
@@ -125,6 +132,27 @@ static std::array<uint8, 0x20> buildSigningKey(const std::string& secretAccessKe
 	return result;
 }
 
+static std::string hashStream(Framework::CStream& stream, uint64 size)
+{
+	static const size_t bufferSize = 0x10000;
+	std::vector<uint8> buffer(bufferSize);
+	Framework::HashUtils::CSha256Hasher hash;
+	auto position = stream.Tell();
+	uint64 remaining = size;
+	while(remaining != 0)
+	{
+		auto readSize = static_cast<size_t>(std::min<uint64>(remaining, bufferSize));
+		if(stream.Read(buffer.data(), readSize) != readSize)
+		{
+			throw std::runtime_error("Failed to read request content.");
+		}
+		hash.Update(buffer.data(), readSize);
+		remaining -= readSize;
+	}
+	stream.Seek(static_cast<int64>(position), Framework::STREAM_SEEK_SET);
+	return hashToString(hash.Finalize());
+}
+
 static std::string timeToString(const tm* timeInfo)
 {
 	static const size_t bufferSize = 0x100;
@@ -137,10 +165,22 @@ static std::string timeToString(const tm* timeInfo)
 	return std::string(output);
 }
 
+static std::string getServiceLabel(const std::string& service)
+{
+	return string_format("service=\"%s\"", service.c_str());
+}
+
 CAmazonClient::CAmazonClient(std::string service, CAmazonCredentials credentials, std::string region)
     : m_service(std::move(service))
     , m_credentials(std::move(credentials))
     , m_region(std::move(region))
+    , m_requestCountMetric(Framework::Metrics::CRegistry::GetInstance().GetCounter("framework_amazon_requests_total", getServiceLabel(m_service), "Requests sent to Amazon services, retries included."))
+    , m_retryCountMetric(Framework::Metrics::CRegistry::GetInstance().GetCounter("framework_amazon_retries_total", getServiceLabel(m_service), "Requests sent again after a failure."))
+    , m_throttleCountMetric(Framework::Metrics::CRegistry::GetInstance().GetCounter("framework_amazon_throttles_total", getServiceLabel(m_service), "Responses asking to slow down (503 or 429)."))
+    , m_sentSizeMetric(Framework::Metrics::CRegistry::GetInstance().GetCounter("framework_amazon_sent_bytes_total", getServiceLabel(m_service), "Request content bytes sent."))
+    , m_receivedSizeMetric(Framework::Metrics::CRegistry::GetInstance().GetCounter("framework_amazon_received_bytes_total", getServiceLabel(m_service), "Response body bytes received."))
+    , m_requestDurationMetric(Framework::Metrics::CRegistry::GetInstance().GetHistogram("framework_amazon_request_duration_microseconds", getServiceLabel(m_service), "Time to send a request and receive its response."))
+    , m_activeRequestCountMetric(Framework::Metrics::CRegistry::GetInstance().GetGauge("framework_amazon_active_requests", getServiceLabel(m_service), "Requests in flight."))
 {
 }
 
@@ -151,6 +191,88 @@ Framework::Http::RequestResult CAmazonClient::ExecuteRequest(const Request& requ
 	assert(!request.host.empty());
 	assert(!request.urlHost.empty());
 
+	//Hashed once, requests are signed again for every attempt since the signature has a timestamp
+	auto contentHashString = request.contentStream ? hashStream(*request.contentStream, request.contentStreamSize)
+	                                               : hashToString(Framework::HashUtils::ComputeSha256(request.content.data(), request.content.size()));
+	uint64 contentSize = request.contentStream ? request.contentStreamSize : request.content.size();
+	uint64 contentPosition = request.contentStream ? request.contentStream->Tell() : 0;
+	bool isIdempotent = (request.method != Framework::Http::HTTP_VERB::POST);
+	auto& concurrencyLimiter = GetConcurrencyLimiter(request.urlHost);
+
+	for(unsigned int attempt = 1;; attempt++)
+	{
+		if(request.contentStream && (attempt != 1))
+		{
+			request.contentStream->Seek(static_cast<int64>(contentPosition), Framework::STREAM_SEEK_SET);
+		}
+
+		auto ticket = concurrencyLimiter.Acquire();
+		m_activeRequestCountMetric.Add(1);
+		auto startTime = std::chrono::steady_clock::now();
+		std::optional<Framework::Http::RequestResult> response;
+		std::exception_ptr exception;
+		try
+		{
+			response.emplace(SendSignedRequest(request, contentHashString));
+		}
+		catch(...)
+		{
+			exception = std::current_exception();
+		}
+		auto latency = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime).count();
+		m_activeRequestCountMetric.Add(-1);
+		m_requestCountMetric.Add();
+		m_requestDurationMetric.Record(latency);
+		m_sentSizeMetric.Add(contentSize);
+
+		unsigned int statusCode = response ? static_cast<unsigned int>(response->statusCode) : 0;
+		bool isThrottled = (statusCode == 503) || (statusCode == 429);
+		bool isServerError = (statusCode >= 500) || (statusCode == 408);
+		auto outcome = Framework::CAdaptiveConcurrencyLimiter::OUTCOME_SUCCESS;
+		if(isThrottled)
+		{
+			outcome = Framework::CAdaptiveConcurrencyLimiter::OUTCOME_OVERLOAD;
+			m_throttleCountMetric.Add();
+		}
+		else if(exception || isServerError)
+		{
+			outcome = Framework::CAdaptiveConcurrencyLimiter::OUTCOME_IGNORED;
+		}
+		concurrencyLimiter.Release(ticket, outcome);
+
+		bool canRetry = isIdempotent && (exception || isThrottled || isServerError) && (attempt != MAX_REQUEST_ATTEMPTS);
+		if(!canRetry)
+		{
+			if(exception)
+			{
+				std::rethrow_exception(exception);
+			}
+			m_receivedSizeMetric.Add(response->data.GetSize());
+			return std::move(*response);
+		}
+		m_retryCountMetric.Add();
+		std::this_thread::sleep_for(GetRetryDelay(attempt, response ? response->headers.Get("Retry-After") : std::string_view()));
+	}
+}
+
+std::chrono::milliseconds CAmazonClient::GetRetryDelay(unsigned int attempt, std::string_view retryAfter)
+{
+	static thread_local std::mt19937 generator(std::random_device{}());
+	assert(attempt != 0);
+	uint32 maxDelay = RETRY_BASE_DELAY_MS << std::min<unsigned int>(attempt - 1, 16);
+	maxDelay = std::min<uint32>(maxDelay, RETRY_MAX_DELAY_MS);
+	uint32 delay = std::uniform_int_distribution<uint32>(0, maxDelay)(generator);
+	//Only the number of seconds is supported, not the date form
+	if(!retryAfter.empty() && (retryAfter.size() <= 5) && (retryAfter.find_first_not_of("0123456789") == std::string_view::npos))
+	{
+		uint32 retryAfterDelay = std::stoul(std::string(retryAfter)) * 1000;
+		delay = std::max(delay, std::min<uint32>(retryAfterDelay, RETRY_MAX_DELAY_MS));
+	}
+	return std::chrono::milliseconds(delay);
+}
+
+Framework::Http::RequestResult CAmazonClient::SendSignedRequest(const Request& request, const std::string& contentHashString)
+{
 	time_t rawTime;
 	time(&rawTime);
 	auto timeInfo = gmtime(&rawTime);
@@ -158,21 +280,20 @@ Framework::Http::RequestResult CAmazonClient::ExecuteRequest(const Request& requ
 	auto date = string_format("%04d%02d%02d", timeInfo->tm_year + 1900, timeInfo->tm_mon + 1, timeInfo->tm_mday);
 	auto requestType = std::string("aws4_request");
 
-	auto contentHashString = hashToString(Framework::HashUtils::ComputeSha256(request.content.data(), request.content.size()));
-
 	auto scope = string_format("%s/%s/%s/%s", date.c_str(), m_region.c_str(), m_service.c_str(), requestType.c_str());
 	auto timestamp = timeToString(timeInfo);
 
 	Framework::Http::HeaderMap headers;
-	headers.insert(std::make_pair("Host", request.host));
-	headers.insert(std::make_pair("x-amz-content-sha256", contentHashString));
-	headers.insert(std::make_pair("x-amz-date", timestamp));
+	headers.Add("Host", request.host);
+	headers.Add("x-amz-content-sha256", contentHashString);
+	headers.Add("x-amz-date", timestamp);
 	if(!m_credentials.sessionToken.empty())
 	{
-		headers.insert(std::make_pair("x-amz-security-token", m_credentials.sessionToken));
+		headers.Add("x-amz-security-token", m_credentials.sessionToken);
 	}
+	auto canonicalHeaders = buildCanonicalHeaders(headers);
 	
-	auto canonicalRequest = buildCanonicalRequest(request.method, request.uri, request.query, contentHashString, headers);
+	auto canonicalRequest = buildCanonicalRequest(request.method, request.uri, request.query, contentHashString, canonicalHeaders);
 #ifdef DEBUG_REQUEST
 	printf("canonicalRequest:\n%s\n\n", canonicalRequest.c_str());
 #endif
@@ -182,14 +303,20 @@ Framework::Http::RequestResult CAmazonClient::ExecuteRequest(const Request& requ
 	printf("stringToSign:\n%s\n\n", stringToSign.c_str());
 #endif
 
-	auto signedHeaders = buildSignedHeadersParam(headers);
-	auto signingKey = buildSigningKey(m_credentials.secretAccessKey, date, m_region, m_service, requestType);
+	auto signedHeaders = buildSignedHeadersParam(canonicalHeaders);
+	auto signingKey = GetSigningKey(date);
 	auto signature = hashToString(Framework::HashUtils::ComputeHmacSha256(signingKey.data(), signingKey.size(), stringToSign.c_str(), stringToSign.length()));
 
 	auto authorizationString = string_format("AWS4-HMAC-SHA256 Credential=%s/%s, SignedHeaders=%s, Signature=%s",
 		m_credentials.accessKeyId.c_str(), scope.c_str(), signedHeaders.c_str(), signature.c_str());
-	headers.insert(std::make_pair("Authorization", authorizationString));
-	headers.insert(request.headers.begin(), request.headers.end());
+	headers.Add("Authorization", authorizationString);
+	for(const auto& header : request.headers)
+	{
+		if(!headers.Has(header.name))
+		{
+			headers.Add(header.name, header.value);
+		}
+	}
 
 	auto url = string_format("https://%s%s", request.urlHost.c_str(), request.uri.c_str());
 	if (!request.query.empty())
@@ -202,7 +329,14 @@ Framework::Http::RequestResult CAmazonClient::ExecuteRequest(const Request& requ
 	httpClient->SetVerb(request.method);
 	httpClient->SetUrl(url);
 	httpClient->SetHeaders(headers);
-	httpClient->SetRequestBody(request.content);
+	if(request.contentStream)
+	{
+		httpClient->SetRequestBodyStream(*request.contentStream, request.contentStreamSize);
+	}
+	else
+	{
+		httpClient->SetRequestBody(request.content);
+	}
 	auto response = httpClient->SendRequest();
 #ifdef DEBUG_REQUEST
 	auto responseString = std::string(response.data.GetBuffer(), response.data.GetBuffer() + response.data.GetLength());
@@ -210,3 +344,25 @@ Framework::Http::RequestResult CAmazonClient::ExecuteRequest(const Request& requ
 #endif
 	return response;
 }
+
+std::array<uint8, 0x20> CAmazonClient::GetSigningKey(const std::string& date)
+{
+	std::lock_guard<std::mutex> signingKeyLock(m_signingKeyMutex);
+	if(m_signingKeyDate != date)
+	{
+		m_signingKey = buildSigningKey(m_credentials.secretAccessKey, date, m_region, m_service, "aws4_request");
+		m_signingKeyDate = date;
+	}
+	return m_signingKey;
+}
+
+Framework::CAdaptiveConcurrencyLimiter& CAmazonClient::GetConcurrencyLimiter(const std::string& host)
+{
+	std::lock_guard<std::mutex> concurrencyLimitersLock(m_concurrencyLimitersMutex);
+	auto& concurrencyLimiter = m_concurrencyLimiters[host];
+	if(!concurrencyLimiter)
+	{
+		concurrencyLimiter = std::make_unique<Framework::CAdaptiveConcurrencyLimiter>(INITIAL_CONCURRENCY_LIMIT, 1, MAX_CONCURRENCY_LIMIT);
+	}
+	return *concurrencyLimiter;
+}
@@ -1,12 +1,28 @@
 #include "amazon/AmazonS3Client.h"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <iterator>
+#include <map>
 #include <stdexcept>
 #include <memory>
+#include <mutex>
+#include <thread>
 #include "string_format.h"
+#include "TaskGroup.h"
+#include "ThreadPool.h"
 #include "xml/Parser.h"
+#include "xml/StreamParser.h"
 #include "Url.h"
 
 #define S3_HOSTNAME "s3.amazonaws.com"
 
+static std::string getEtag(const Framework::Http::HeaderMap& headers)
+{
+	return std::string(headers.Get("ETag"));
+}
+
 CAmazonS3Client::CAmazonS3Client(CAmazonCredentials credentials, std::string region)
     : CAmazonClient("s3", std::move(credentials), std::move(region))
 {
@@ -57,7 +73,7 @@ GetObjectResult CAmazonS3Client::GetObject(const GetObjectRequest& request)
 	if(request.range.first != request.range.second)
 	{
 		auto rangeHeader = string_format("bytes=%llu-%llu", request.range.first, request.range.second);
-		rq.headers.insert(std::make_pair("Range", rangeHeader));
+		rq.headers.Set("Range", rangeHeader);
 	}
 
 	auto response = ExecuteRequest(rq);
@@ -69,9 +85,7 @@ GetObjectResult CAmazonS3Client::GetObject(const GetObjectRequest& request)
 	}
 
 	GetObjectResult result;
-	uint32 dataLength = response.data.GetLength();
-	result.data.resize(dataLength);
-	response.data.Read(result.data.data(), dataLength);
+	result.data = response.data.ReleaseBuffer();
 	return result;
 }
 
@@ -91,29 +105,61 @@ HeadObjectResult CAmazonS3Client::HeadObject(const HeadObjectRequest& request)
 
 	HeadObjectResult result;
 
-	auto contentLengthIterator = response.headers.find("Content-Length");
-	if(contentLengthIterator != std::end(response.headers))
+	auto contentLength = response.headers.Get("Content-Length");
+	if(!contentLength.empty())
 	{
-		result.contentLength = atoll(contentLengthIterator->second.c_str());
+		result.contentLength = atoll(contentLength.data());
 	}
 
-	auto etagIterator = response.headers.find("ETag");
-	if(etagIterator == std::end(response.headers)) etagIterator = response.headers.find("Etag");
-	if(etagIterator != std::end(response.headers))
+	result.etag = getEtag(response.headers);
+
+	return result;
+}
+
+ListObjectsResult CAmazonS3Client::ListObjects(std::string bucket)
+{
+	ListObjectsResult result;
+
+	ListObjectsV2Request request;
+	request.bucket = std::move(bucket);
+	CAmazonS3ObjectLister lister(*this, std::move(request));
+	ListObjectsV2Result page;
+	while(lister.NextPage(page))
 	{
-		result.etag = etagIterator->second;
+		std::move(page.objects.begin(), page.objects.end(), std::back_inserter(result.objects));
 	}
 
 	return result;
 }
 
-ListObjectsResult CAmazonS3Client::ListObjects(std::string bucket)
+ListObjectsV2Result CAmazonS3Client::ListObjectsV2(const ListObjectsV2Request& request)
 {
+	//Parameters need to be sorted by name for the signature
+	Framework::CUrlQueryBuilder query;
+	if(!request.continuationToken.empty())
+	{
+		query.Add("continuation-token", request.continuationToken);
+	}
+	if(!request.delimiter.empty())
+	{
+		query.Add("delimiter", request.delimiter);
+	}
+	query.Add("list-type", 2);
+	if(request.maxKeys != 0)
+	{
+		query.Add("max-keys", request.maxKeys);
+	}
+	if(!request.prefix.empty())
+	{
+		query.Add("prefix", request.prefix);
+	}
+
 	Request rq;
 	rq.method = Framework::Http::HTTP_VERB::GET;
 	rq.uri = "/";
-	rq.host = string_format("%s.s3-%s.amazonaws.com", bucket.c_str(), m_region.c_str());
+	rq.host = string_format("%s.s3-%s.amazonaws.com", request.bucket.c_str(), m_region.c_str());
 	rq.urlHost = rq.host;
+	rq.query = query.GetString();
 
 	auto response = ExecuteRequest(rq);
 	if(response.statusCode != Framework::Http::HTTP_STATUS_CODE::OK)
@@ -121,18 +167,88 @@ ListObjectsResult CAmazonS3Client::ListObjects(std::string bucket)
 		throw std::runtime_error("Failed to list objects");
 	}
 
-	ListObjectsResult result;
+	ListObjectsV2Result result;
 
-	auto documentNode = Framework::Xml::CParser::ParseDocument(response.data);
-	auto contentsNodes = documentNode->SelectNodes("ListBucketResult/Contents");
-	for(const auto& contentsNode : contentsNodes)
+	//Pages can hold a thousand keys, go through the events instead of building a tree
+	response.data.Seek(0, Framework::STREAM_SEEK_SET);
+	Framework::Xml::CStreamParser parser(response.data);
+	Object object;
+	std::string text;
+	bool inContents = false;
+	bool inCommonPrefixes = false;
+	while(1)
 	{
-		Object object;
-		if(auto keyNode = contentsNode->Select("Key"))
+		auto event = parser.Next();
+		if(event == Framework::Xml::CStreamParser::EVENT_END_DOCUMENT) break;
+		switch(event)
 		{
-			object.key = keyNode->GetInnerText();
+		case Framework::Xml::CStreamParser::EVENT_START_ELEMENT:
+			text.clear();
+			if(parser.GetDepth() == 2)
+			{
+				inContents = (parser.GetName() == "Contents");
+				inCommonPrefixes = (parser.GetName() == "CommonPrefixes");
+				object = Object();
+			}
+			break;
+		case Framework::Xml::CStreamParser::EVENT_TEXT:
+			text += parser.GetText();
+			break;
+		case Framework::Xml::CStreamParser::EVENT_END_ELEMENT:
+		{
+			const auto& name = parser.GetName();
+			auto depth = parser.GetDepth();
+			if(depth == 1)
+			{
+				if(inContents)
+				{
+					result.objects.push_back(std::move(object));
+				}
+				else if(name == "IsTruncated")
+				{
+					result.isTruncated = (text == "true");
+				}
+				else if(name == "NextContinuationToken")
+				{
+					result.nextContinuationToken = text;
+				}
+				inContents = false;
+				inCommonPrefixes = false;
+			}
+			else if((depth == 2) && inContents)
+			{
+				if(name == "Key")
+				{
+					object.key = text;
+				}
+				else if(name == "Size")
+				{
+					object.size = std::stoull(text);
+				}
+				else if(name == "ETag")
+				{
+					object.etag = text;
+				}
+				else if(name == "LastModified")
+				{
+					object.lastModified = text;
+				}
+			}
+			else if((depth == 2) && inCommonPrefixes && (name == "Prefix"))
+			{
+				result.commonPrefixes.push_back(text);
+			}
+			text.clear();
+		}
+		break;
+		default:
+			break;
 		}
-		result.objects.push_back(object);
+	}
+
+	if(result.isTruncated && result.nextContinuationToken.empty())
+	{
+		throw std::runtime_error("Truncated object listing without continuation token.");
 	}
 
 	return result;
@@ -153,3 +269,445 @@ void CAmazonS3Client::PutObject(const PutObjectRequest& request)
 		throw std::runtime_error("Failed to put object.");
 	}
 }
+
+void CAmazonS3Client::PutObject(const std::string& bucket, const std::string& key, Framework::CStream& stream, uint64 size)
+{
+	Request rq;
+	rq.method = Framework::Http::HTTP_VERB::PUT;
+	rq.uri = "/" + Framework::UrlEncode(key);
+	rq.host = string_format("%s.s3-%s.amazonaws.com", bucket.c_str(), m_region.c_str());
+	rq.urlHost = rq.host;
+	rq.contentStream = &stream;
+	rq.contentStreamSize = size;
+
+	auto response = ExecuteRequest(rq);
+	if(response.statusCode != Framework::Http::HTTP_STATUS_CODE::OK)
+	{
+		throw std::runtime_error("Failed to put object.");
+	}
+}
+
+CreateMultipartUploadResult CAmazonS3Client::CreateMultipartUpload(const CreateMultipartUploadRequest& request)
+{
+	Request rq;
+	rq.method = Framework::Http::HTTP_VERB::POST;
+	rq.uri = "/" + Framework::UrlEncode(request.key);
+	rq.host = string_format("%s.s3-%s.amazonaws.com", request.bucket.c_str(), m_region.c_str());
+	rq.urlHost = rq.host;
+	rq.query = "uploads=";
+
+	auto response = ExecuteRequest(rq);
+	if(response.statusCode != Framework::Http::HTTP_STATUS_CODE::OK)
+	{
+		throw std::runtime_error("Failed to create multipart upload.");
+	}
+
+	CreateMultipartUploadResult result;
+
+	auto documentNode = Framework::Xml::CParser::ParseDocument(response.data);
+	if(auto uploadIdNode = documentNode->Select("InitiateMultipartUploadResult/UploadId"))
+	{
+		auto uploadId = uploadIdNode->GetInnerText();
+		result.uploadId = uploadId ? uploadId : "";
+	}
+	if(result.uploadId.empty())
+	{
+		throw std::runtime_error("Failed to create multipart upload.");
+	}
+
+	return result;
+}
+
+UploadPartResult CAmazonS3Client::UploadPart(const UploadPartRequest& request)
+{
+	Request rq;
+	rq.method = Framework::Http::HTTP_VERB::PUT;
+	rq.uri = "/" + Framework::UrlEncode(request.key);
+	rq.host = string_format("%s.s3-%s.amazonaws.com", request.bucket.c_str(), m_region.c_str());
+	rq.urlHost = rq.host;
+	rq.query = Framework::CUrlQueryBuilder().Add("partNumber", request.partNumber).Add("uploadId", request.uploadId).GetString();
+	rq.content = request.data;
+
+	auto response = ExecuteRequest(rq);
+	if(response.statusCode != Framework::Http::HTTP_STATUS_CODE::OK)
+	{
+		throw std::runtime_error(string_format("Failed to upload part (status %u).", static_cast<unsigned int>(response.statusCode)));
+	}
+
+	UploadPartResult result;
+	result.etag = getEtag(response.headers);
+	if(result.etag.empty())
+	{
+		throw std::runtime_error("Failed to upload part.");
+	}
+	return result;
+}
+
+void CAmazonS3Client::CompleteMultipartUpload(const CompleteMultipartUploadRequest& request)
+{
+	std::string content = "<CompleteMultipartUpload>";
+	for(const auto& part : request.parts)
+	{
+		content += string_format("<Part><PartNumber>%u</PartNumber><ETag>%s</ETag></Part>", part.partNumber, part.etag.c_str());
+	}
+	content += "</CompleteMultipartUpload>";
+
+	Request rq;
+	rq.method = Framework::Http::HTTP_VERB::POST;
+	rq.uri = "/" + Framework::UrlEncode(request.key);
+	rq.host = string_format("%s.s3-%s.amazonaws.com", request.bucket.c_str(), m_region.c_str());
+	rq.urlHost = rq.host;
+	rq.query = Framework::CUrlQueryBuilder().Add("uploadId", request.uploadId).GetString();
+	rq.content = Framework::Http::ByteArray(content.begin(), content.end());
+
+	auto response = ExecuteRequest(rq);
+	if(response.statusCode != Framework::Http::HTTP_STATUS_CODE::OK)
+	{
+		throw std::runtime_error("Failed to complete multipart upload.");
+	}
+
+	//Errors that happen once the response has started are reported in its body
+	auto documentNode = Framework::Xml::CParser::ParseDocument(response.data);
+	if(documentNode->Select("Error"))
+	{
+		throw std::runtime_error("Failed to complete multipart upload.");
+	}
+}
+
+void CAmazonS3Client::AbortMultipartUpload(const AbortMultipartUploadRequest& request)
+{
+	Request rq;
+	rq.method = Framework::Http::HTTP_VERB::DELETE;
+	rq.uri = "/" + Framework::UrlEncode(request.key);
+	rq.host = string_format("%s.s3-%s.amazonaws.com", request.bucket.c_str(), m_region.c_str());
+	rq.urlHost = rq.host;
+	rq.query = Framework::CUrlQueryBuilder().Add("uploadId", request.uploadId).GetString();
+
+	auto response = ExecuteRequest(rq);
+	auto statusCode = static_cast<unsigned int>(response.statusCode);
+	if((statusCode != 200) && (statusCode != 204))
+	{
+		throw std::runtime_error("Failed to abort multipart upload.");
+	}
+}
+
+void CAmazonS3Client::DownloadObject(const std::string& bucket, const std::string& key, Framework::CStream& stream, uint64 partSize, unsigned int concurrency)
+{
+	if((partSize == 0) || (concurrency == 0))
+	{
+		throw std::runtime_error("Invalid download parameters.");
+	}
+
+	HeadObjectRequest headRequest;
+	headRequest.bucket = bucket;
+	headRequest.key = key;
+	auto objectInfo = HeadObject(headRequest);
+	uint64 objectSize = objectInfo.contentLength;
+	if(objectSize == 0) return;
+
+	uint64 partCount = (objectSize + partSize - 1) / partSize;
+	bool isPositional = stream.CanAccessAt();
+	uint64 baseOffset = isPositional ? stream.Tell() : 0;
+
+	//Parts are downloaded ahead of the one being written up to a limit, to bound memory use
+	uint64 windowSize = static_cast<uint64>(concurrency) * 2;
+	std::mutex mutex;
+	std::condition_variable condition;
+	std::map<uint64, std::vector<uint8>> downloadedParts;
+	uint64 nextPartIndex = 0;
+	uint64 nextWriteIndex = 0;
+	bool failed = false;
+
+	auto threadCount = static_cast<unsigned int>(std::min<uint64>(concurrency, partCount));
+	Framework::CThreadPool threadPool(threadCount);
+	Framework::CTaskGroup taskGroup(&threadPool);
+	for(unsigned int i = 0; i < threadCount; i++)
+	{
+		taskGroup.Run(
+		    [&]() {
+			    while(1)
+			    {
+				    uint64 partIndex = 0;
+				    {
+					    std::unique_lock<std::mutex> lock(mutex);
+					    condition.wait(lock, [&]() { return failed || (nextPartIndex == partCount) || (nextPartIndex < nextWriteIndex + windowSize); });
+					    if(failed || (nextPartIndex == partCount)) return;
+					    partIndex = nextPartIndex++;
+				    }
+				    try
+				    {
+					    uint64 partOffset = partIndex * partSize;
+					    uint64 partLength = std::min<uint64>(partSize, objectSize - partOffset);
+					    auto partData = GetObjectPart(bucket, key, objectInfo.etag, partOffset, partLength);
+					    if(isPositional)
+					    {
+						    if(stream.WriteAt(baseOffset + partOffset, partData.data(), partData.size()) != partData.size())
+						    {
+							    throw std::runtime_error("Failed to write object part.");
+						    }
+						    partData.clear();
+					    }
+					    std::unique_lock<std::mutex> lock(mutex);
+					    downloadedParts[partIndex] = std::move(partData);
+					    condition.notify_all();
+				    }
+				    catch(...)
+				    {
+					    std::unique_lock<std::mutex> lock(mutex);
+					    failed = true;
+					    condition.notify_all();
+					    throw;
+				    }
+			    }
+		    });
+	}
+
+	std::exception_ptr writeException;
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		while(nextWriteIndex != partCount)
+		{
+			condition.wait(lock, [&]() { return failed || (downloadedParts.count(nextWriteIndex) != 0); });
+			if(failed) break;
+			auto partIterator = downloadedParts.find(nextWriteIndex);
+			auto partData = std::move(partIterator->second);
+			downloadedParts.erase(partIterator);
+			lock.unlock();
+			try
+			{
+				if(!isPositional && (stream.Write(partData.data(), partData.size()) != partData.size()))
+				{
+					throw std::runtime_error("Failed to write object part.");
+				}
+			}
+			catch(...)
+			{
+				writeException = std::current_exception();
+			}
+			lock.lock();
+			if(writeException)
+			{
+				failed = true;
+				condition.notify_all();
+				break;
+			}
+			nextWriteIndex++;
+			condition.notify_all();
+		}
+	}
+	taskGroup.Wait();
+	if(writeException)
+	{
+		std::rethrow_exception(writeException);
+	}
+	if(isPositional)
+	{
+		stream.Seek(baseOffset + objectSize, Framework::STREAM_SEEK_SET);
+	}
+}
+
+std::vector<uint8> CAmazonS3Client::GetObjectPart(const std::string& bucket, const std::string& key, const std::string& etag, uint64 offset, uint64 size)
+{
+	assert(size != 0);
+
+	Request rq;
+	rq.method = Framework::Http::HTTP_VERB::GET;
+	rq.uri = "/" + Framework::UrlEncode(key);
+	rq.host = string_format("%s.s3-%s.amazonaws.com", bucket.c_str(), m_region.c_str());
+	rq.urlHost = rq.host;
+	rq.headers.Set("Range", string_format("bytes=%llu-%llu", offset, offset + size - 1));
+	//Fails with 412 if the object was replaced since we got its size
+	if(!etag.empty())
+	{
+		rq.headers.Set("If-Match", etag);
+	}
+
+	//Connection errors and server failures are retried by ExecuteRequest, incomplete parts here
+	for(unsigned int attempt = 1;; attempt++)
+	{
+		auto response = ExecuteRequest(rq);
+		auto statusCode = static_cast<unsigned int>(response.statusCode);
+		if(statusCode == 412)
+		{
+			throw std::runtime_error("Object changed during download.");
+		}
+		if(response.statusCode != Framework::Http::HTTP_STATUS_CODE::PARTIAL_CONTENT)
+		{
+			throw std::runtime_error(string_format("Failed to get object part (status %u).", statusCode));
+		}
+		auto responseEtag = getEtag(response.headers);
+		if(!etag.empty() && !responseEtag.empty() && (responseEtag != etag))
+		{
+			throw std::runtime_error("Object changed during download.");
+		}
+		if(response.data.GetSize() == size)
+		{
+			return response.data.ReleaseBuffer();
+		}
+		if(attempt == MAX_PART_ATTEMPTS)
+		{
+			throw std::runtime_error("Received incomplete object part.");
+		}
+		std::this_thread::sleep_for(GetRetryDelay(attempt));
+	}
+}
+
+void CAmazonS3Client::UploadObject(const std::string& bucket, const std::string& key, Framework::CStream& stream, uint64 partSize, unsigned int concurrency)
+{
+	if(concurrency == 0)
+	{
+		throw std::runtime_error("Invalid upload parameters.");
+	}
+	partSize = std::max<uint64>(partSize, MIN_UPLOAD_PART_SIZE);
+
+	CreateMultipartUploadRequest createRequest;
+	createRequest.bucket = bucket;
+	createRequest.key = key;
+	auto uploadId = CreateMultipartUpload(createRequest).uploadId;
+
+	try
+	{
+		std::mutex mutex;
+		std::condition_variable condition;
+		std::vector<CompletedPart> completedParts;
+		unsigned int activeCount = 0;
+		bool failed = false;
+
+		{
+			Framework::CThreadPool threadPool(concurrency);
+			Framework::CTaskGroup taskGroup(&threadPool);
+			for(unsigned int partNumber = 1;; partNumber++)
+			{
+				//Parts are only read when they can be sent, this bounds memory use
+				{
+					std::unique_lock<std::mutex> lock(mutex);
+					condition.wait(lock, [&]() { return failed || (activeCount < concurrency); });
+					if(failed) break;
+				}
+
+				UploadPartRequest partRequest;
+				partRequest.bucket = bucket;
+				partRequest.key = key;
+				partRequest.uploadId = uploadId;
+				partRequest.partNumber = partNumber;
+				partRequest.data.resize(partSize);
+				uint64 partLength = 0;
+				while(partLength != partSize)
+				{
+					auto readSize = stream.Read(partRequest.data.data() + partLength, partSize - partLength);
+					if(readSize == 0) break;
+					partLength += readSize;
+				}
+				partRequest.data.resize(partLength);
+				//An empty object still needs one part
+				if((partLength == 0) && (partNumber != 1)) break;
+				if(partNumber > MAX_UPLOAD_PART_COUNT)
+				{
+					throw std::runtime_error("Too many parts for multipart upload, part size needs to be larger.");
+				}
+
+				{
+					std::unique_lock<std::mutex> lock(mutex);
+					activeCount++;
+					CompletedPart completedPart;
+					completedPart.partNumber = partNumber;
+					completedParts.push_back(completedPart);
+				}
+				taskGroup.Run(
+				    [&, partRequest = std::move(partRequest)]() {
+					    try
+					    {
+						    //Failed requests are retried by ExecuteRequest
+						    auto partResult = UploadPart(partRequest);
+						    std::unique_lock<std::mutex> lock(mutex);
+						    completedParts[partRequest.partNumber - 1].etag = partResult.etag;
+						    activeCount--;
+						    condition.notify_all();
+					    }
+					    catch(...)
+					    {
+						    std::unique_lock<std::mutex> lock(mutex);
+						    failed = true;
+						    activeCount--;
+						    condition.notify_all();
+						    throw;
+					    }
+				    });
+				if(partLength != partSize) break;
+			}
+			taskGroup.Wait();
+		}
+
+		CompleteMultipartUploadRequest completeRequest;
+		completeRequest.bucket = bucket;
+		completeRequest.key = key;
+		completeRequest.uploadId = uploadId;
+		completeRequest.parts = std::move(completedParts);
+		CompleteMultipartUpload(completeRequest);
+	}
+	catch(...)
+	{
+		//Parts of aborted uploads aren't kept (or billed) by S3
+		try
+		{
+			AbortMultipartUploadRequest abortRequest;
+			abortRequest.bucket = bucket;
+			abortRequest.key = key;
+			abortRequest.uploadId = uploadId;
+			AbortMultipartUpload(abortRequest);
+		}
+		catch(...)
+		{
+		}
+		throw;
+	}
+}
+
+CAmazonS3ObjectLister::CAmazonS3ObjectLister(CAmazonS3Client& client, ListObjectsV2Request request, bool prefetchEnabled)
+    : m_client(client)
+    , m_request(std::move(request))
+    , m_prefetchEnabled(prefetchEnabled)
+{
+	if(m_prefetchEnabled)
+	{
+		StartPrefetch();
+	}
+}
+
+CAmazonS3ObjectLister::~CAmazonS3ObjectLister()
+{
+	//Request might still be running and uses the client
+	if(m_prefetchedPage.valid())
+	{
+		m_prefetchedPage.wait();
+	}
+}
+
+bool CAmazonS3ObjectLister::NextPage(ListObjectsV2Result& page)
+{
+	if(m_isDone) return false;
+	if(m_prefetchedPage.valid())
+	{
+		page = m_prefetchedPage.get();
+	}
+	else
+	{
+		page = m_client.ListObjectsV2(m_request);
+	}
+	m_isDone = !page.isTruncated;
+	if(!m_isDone)
+	{
+		m_request.continuationToken = page.nextContinuationToken;
+		if(m_prefetchEnabled)
+		{
+			StartPrefetch();
+		}
+	}
+	return true;
+}
+
+void CAmazonS3ObjectLister::StartPrefetch()
+{
+	auto request = m_request;
+	m_prefetchedPage = std::async(std::launch::async, [this, request]() { return m_client.ListObjectsV2(request); });
+}
@@ -0,0 +1,264 @@
+#include "amazon/AmazonS3Sync.h"
+#include <exception>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include "Serialization.h"
+#include "StdStreamUtils.h"
+#include "TaskGroup.h"
+#include "ThreadPool.h"
+
+static const char* g_tempFileExtension = ".s3sync.tmp";
+
+static int64 GetFileTime(const fs::path& path)
+{
+	return static_cast<int64>(fs::last_write_time(path).time_since_epoch().count());
+}
+
+CAmazonS3Sync::CAmazonS3Sync(CAmazonS3Client& client, std::string bucket, std::string prefix, fs::path directory, fs::path manifestPath)
+    : m_client(client)
+    , m_bucket(std::move(bucket))
+    , m_prefix(std::move(prefix))
+    , m_directory(std::move(directory))
+    , m_manifestPath(std::move(manifestPath))
+{
+	LoadManifest();
+}
+
+CAmazonS3Sync::STATS CAmazonS3Sync::Sync(bool deleteRemoved, unsigned int concurrency)
+{
+	if(concurrency == 0)
+	{
+		throw std::runtime_error("Invalid sync parameters.");
+	}
+
+	//Counters updated by the downloads are only touched with the mutex held
+	STATS stats;
+	std::unordered_set<std::string> listedKeys;
+	//Objects downloaded in parts once the listing is done, with all threads working on one at a time
+	std::vector<std::pair<Object, fs::path>> largeObjects;
+	std::exception_ptr listException;
+	{
+		Framework::CThreadPool threadPool(concurrency);
+		Framework::CTaskGroup taskGroup(&threadPool);
+		try
+		{
+			ListObjectsV2Request listRequest;
+			listRequest.bucket = m_bucket;
+			listRequest.prefix = m_prefix;
+			CAmazonS3ObjectLister lister(m_client, std::move(listRequest));
+			ListObjectsV2Result page;
+			while(lister.NextPage(page))
+			{
+				for(auto& object : page.objects)
+				{
+					stats.listedCount++;
+					fs::path localPath;
+					if(!GetLocalPath(object.key, localPath))
+					{
+						stats.skippedCount++;
+						continue;
+					}
+					if(deleteRemoved)
+					{
+						listedKeys.insert(object.key);
+					}
+					if(IsUnchanged(object, localPath))
+					{
+						stats.unchangedCount++;
+						continue;
+					}
+					if(object.size > CAmazonS3Client::DEFAULT_DOWNLOAD_PART_SIZE)
+					{
+						largeObjects.emplace_back(std::move(object), std::move(localPath));
+						continue;
+					}
+					taskGroup.Run(
+					    [this, object = std::move(object), localPath = std::move(localPath), &stats]() {
+						    DownloadObject(object, localPath, 1, stats);
+					    });
+				}
+			}
+		}
+		catch(...)
+		{
+			listException = std::current_exception();
+		}
+		taskGroup.Wait();
+	}
+
+	if(!listException)
+	{
+		for(const auto& largeObject : largeObjects)
+		{
+			DownloadObject(largeObject.first, largeObject.second, concurrency, stats);
+		}
+
+		if(deleteRemoved)
+		{
+			for(auto entryIterator = std::begin(m_manifest); entryIterator != std::end(m_manifest);)
+			{
+				const auto& key = entryIterator->first;
+				fs::path localPath;
+				//Entries from another prefix sharing the manifest are left alone
+				if((listedKeys.count(key) != 0) || !GetLocalPath(key, localPath))
+				{
+					entryIterator++;
+					continue;
+				}
+				std::error_code errorCode;
+				fs::remove(localPath, errorCode);
+				if(errorCode)
+				{
+					stats.failedCount++;
+					entryIterator++;
+					continue;
+				}
+				stats.deletedCount++;
+				entryIterator = m_manifest.erase(entryIterator);
+			}
+		}
+	}
+
+	SaveManifest();
+	if(listException)
+	{
+		std::rethrow_exception(listException);
+	}
+	return stats;
+}
+
+void CAmazonS3Sync::LoadManifest()
+{
+	//A missing or invalid manifest only means that every object is downloaded again
+	try
+	{
+		if(!fs::exists(m_manifestPath)) return;
+		auto stream = Framework::CreateInputStdStream(m_manifestPath.native());
+		Framework::Serialization::CInputArchive archive(stream);
+		uint32 magic = 0;
+		std::vector<std::pair<std::string, MANIFEST_ENTRY>> entries;
+		archive & magic;
+		if(magic != MANIFEST_MAGIC) return;
+		archive & entries;
+		for(auto& entry : entries)
+		{
+			m_manifest.insert(std::move(entry));
+		}
+	}
+	catch(...)
+	{
+		m_manifest.clear();
+	}
+}
+
+void CAmazonS3Sync::SaveManifest()
+{
+	auto tempPath = m_manifestPath;
+	tempPath += g_tempFileExtension;
+	{
+		std::vector<std::pair<std::string, MANIFEST_ENTRY>> entries(std::begin(m_manifest), std::end(m_manifest));
+		uint32 magic = MANIFEST_MAGIC;
+		auto stream = Framework::CreateOutputStdStream(tempPath.native());
+		Framework::Serialization::COutputArchive archive(stream);
+		archive & magic & entries;
+		archive.Flush();
+	}
+	fs::rename(tempPath, m_manifestPath);
+}
+
+//Keys are made of '/' separated segments under the prefix, segments that could go out of the directory
+//or that mean something else on Windows aren't synced
+bool CAmazonS3Sync::GetLocalPath(const std::string& key, fs::path& localPath) const
+{
+	if(key.compare(0, m_prefix.size(), m_prefix) != 0) return false;
+	auto relativeKey = std::string_view(key).substr(m_prefix.size());
+	if(relativeKey.empty() || (relativeKey.back() == '/')) return false;
+
+	size_t position = 0;
+	while(position <= relativeKey.size())
+	{
+		auto separatorPosition = relativeKey.find('/', position);
+		if(separatorPosition == std::string_view::npos) separatorPosition = relativeKey.size();
+		auto segment = relativeKey.substr(position, separatorPosition - position);
+		if(segment.empty() || (segment == ".") || (segment == "..") || (segment.find_first_of("\\:") != std::string_view::npos))
+		{
+			return false;
+		}
+		position = separatorPosition + 1;
+	}
+
+	localPath = m_directory / fs::u8path(std::begin(relativeKey), std::end(relativeKey));
+	return true;
+}
+
+bool CAmazonS3Sync::IsUnchanged(const Object& object, const fs::path& localPath) const
+{
+	MANIFEST_ENTRY entry;
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		auto entryIterator = m_manifest.find(object.key);
+		if(entryIterator == std::end(m_manifest)) return false;
+		entry = entryIterator->second;
+	}
+	if((entry.etag != object.etag) || (entry.size != object.size)) return false;
+
+	//Local file has to be the one that was downloaded
+	std::error_code errorCode;
+	auto localSize = fs::file_size(localPath, errorCode);
+	if(errorCode || (localSize != entry.localSize)) return false;
+	auto localTime = fs::last_write_time(localPath, errorCode);
+	if(errorCode || (static_cast<int64>(localTime.time_since_epoch().count()) != entry.localTime)) return false;
+	return true;
+}
+
+void CAmazonS3Sync::DownloadObject(const Object& object, const fs::path& localPath, unsigned int concurrency, STATS& stats)
+{
+	auto tempPath = localPath;
+	tempPath += g_tempFileExtension;
+	try
+	{
+		fs::create_directories(localPath.parent_path());
+		{
+			auto stream = Framework::CreateOutputStdStream(tempPath.native());
+			if(object.size > CAmazonS3Client::DEFAULT_DOWNLOAD_PART_SIZE)
+			{
+				m_client.DownloadObject(m_bucket, object.key, stream, CAmazonS3Client::DEFAULT_DOWNLOAD_PART_SIZE, concurrency);
+			}
+			else if(object.size != 0)
+			{
+				GetObjectRequest request;
+				request.bucket = m_bucket;
+				request.key = object.key;
+				auto result = m_client.GetObject(request);
+				stream.Write(result.data.data(), result.data.size());
+			}
+		}
+		//Object might have been replaced since it was listed
+		if(fs::file_size(tempPath) != object.size)
+		{
+			throw std::runtime_error("Downloaded object doesn't match its listing.");
+		}
+		fs::rename(tempPath, localPath);
+
+		MANIFEST_ENTRY entry;
+		entry.etag = object.etag;
+		entry.size = object.size;
+		entry.localSize = object.size;
+		entry.localTime = GetFileTime(localPath);
+
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_manifest[object.key] = std::move(entry);
+		stats.downloadedCount++;
+		stats.downloadedSize += object.size;
+	}
+	catch(const std::exception&)
+	{
+		std::error_code errorCode;
+		fs::remove(tempPath, errorCode);
+		std::unique_lock<std::mutex> lock(m_mutex);
+		stats.failedCount++;
+	}
+}
@@ -1,4 +1,5 @@
 #include <cassert>
+#include <stdexcept>
 #include "android/AssetStream.h"
 #include "android/AssetManager.h"
 
@@ -72,3 +73,42 @@ void CAssetStream::Flush()
 {
 	assert(0);
 }
+
+uint64 CAssetStream::GetLength()
+{
+	return AAsset_getLength64(m_asset);
+}
+
+const uint8* CAssetStream::GetData() const
+{
+	if(m_buffer == nullptr)
+	{
+		//Maps uncompressed assets, inflates the others in a buffer owned by the asset
+		m_buffer = reinterpret_cast<const uint8*>(AAsset_getBuffer(m_asset));
+		if(m_buffer == nullptr)
+		{
+			throw std::runtime_error("Failed to get asset buffer.");
+		}
+	}
+	return m_buffer;
+}
+
+const uint8* CAssetStream::GetSpan(uint64 offset, uint64 length) const
+{
+	uint64 size = AAsset_getLength64(m_asset);
+	if((offset > size) || (length > (size - offset)))
+	{
+		throw std::runtime_error("Span is out of range.");
+	}
+	return GetData() + offset;
+}
+
+int CAssetStream::OpenFileDescriptor(int64& start, int64& length)
+{
+	off64_t assetStart = 0;
+	off64_t assetLength = 0;
+	int fd = AAsset_openFileDescriptor64(m_asset, &assetStart, &assetLength);
+	start = assetStart;
+	length = assetLength;
+	return fd;
+}
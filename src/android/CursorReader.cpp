@@ -0,0 +1,148 @@
+#include "android/CursorReader.h"
+#include <cassert>
+#include <cstring>
+#include "android/JavaVM.h"
+
+using namespace Framework;
+using namespace Framework::Android;
+
+CCursorReader::CCursorReader(android::database::Cursor& cursor, std::vector<jint> columns, uint32 windowRows)
+: m_cursor(cursor)
+, m_columns(std::move(columns))
+, m_windowRows(windowRows)
+{
+	assert(m_windowRows != 0);
+	m_cells.resize(m_windowRows * m_columns.size());
+}
+
+bool CCursorReader::FetchWindow()
+{
+	m_rowCount = 0;
+	m_data.clear();
+	if(m_done)
+	{
+		return false;
+	}
+
+	auto env = CJavaVM::GetEnv();
+	const auto& classInfo = android::database::Cursor_ClassInfo::GetInstance();
+	while(m_rowCount < m_windowRows)
+	{
+		jboolean hasRow = env->CallBooleanMethod(m_cursor, classInfo.moveToNext);
+		CJavaVM::CheckException(env);
+		if(!hasRow)
+		{
+			m_done = true;
+			break;
+		}
+
+		//Strings and blobs of the row are released with the frame
+		CJavaLocalFrame rowFrame(static_cast<jint>(m_columns.size()));
+		for(uint32 columnIndex = 0; columnIndex < m_columns.size(); columnIndex++)
+		{
+			auto& cell = m_cells[(m_rowCount * m_columns.size()) + columnIndex];
+			ReadCell(env, m_columns[columnIndex], cell);
+		}
+		m_rowCount++;
+	}
+	return (m_rowCount != 0);
+}
+
+uint32 CCursorReader::GetRowCount() const
+{
+	return m_rowCount;
+}
+
+CCursorReader::CELL_TYPE CCursorReader::GetType(uint32 row, uint32 column) const
+{
+	return GetCell(row, column).type;
+}
+
+int64 CCursorReader::GetInteger(uint32 row, uint32 column) const
+{
+	const auto& cell = GetCell(row, column);
+	assert(cell.type == CELL_TYPE_INTEGER);
+	return cell.integer;
+}
+
+double CCursorReader::GetFloat(uint32 row, uint32 column) const
+{
+	const auto& cell = GetCell(row, column);
+	assert(cell.type == CELL_TYPE_FLOAT);
+	return cell.real;
+}
+
+const char* CCursorReader::GetString(uint32 row, uint32 column) const
+{
+	const auto& cell = GetCell(row, column);
+	assert(cell.type == CELL_TYPE_STRING);
+	return reinterpret_cast<const char*>(m_data.data() + cell.dataOffset);
+}
+
+const uint8* CCursorReader::GetBlob(uint32 row, uint32 column) const
+{
+	const auto& cell = GetCell(row, column);
+	assert(cell.type == CELL_TYPE_BLOB);
+	return m_data.data() + cell.dataOffset;
+}
+
+uint32 CCursorReader::GetSize(uint32 row, uint32 column) const
+{
+	return GetCell(row, column).dataSize;
+}
+
+const CCursorReader::CELL& CCursorReader::GetCell(uint32 row, uint32 column) const
+{
+	assert(row < m_rowCount);
+	assert(column < m_columns.size());
+	return m_cells[(row * m_columns.size()) + column];
+}
+
+void CCursorReader::ReadCell(JNIEnv* env, jint column, CELL& cell)
+{
+	const auto& classInfo = android::database::Cursor_ClassInfo::GetInstance();
+	jobject cursor = m_cursor;
+
+	cell.type = static_cast<CELL_TYPE>(env->CallIntMethod(cursor, classInfo.getType, column));
+	CJavaVM::CheckException(env);
+	cell.dataOffset = static_cast<uint32>(m_data.size());
+	cell.dataSize = 0;
+
+	switch(cell.type)
+	{
+	case CELL_TYPE_INTEGER:
+		cell.integer = env->CallLongMethod(cursor, classInfo.getLong, column);
+		CJavaVM::CheckException(env);
+		break;
+	case CELL_TYPE_FLOAT:
+		cell.real = env->CallDoubleMethod(cursor, classInfo.getDouble, column);
+		CJavaVM::CheckException(env);
+		break;
+	case CELL_TYPE_STRING:
+		{
+			auto string = static_cast<jstring>(env->CallObjectMethod(cursor, classInfo.getString, column));
+			CJavaVM::CheckException(env);
+			jsize length = env->GetStringLength(string);
+			jsize utfSize = env->GetStringUTFLength(string);
+			//Converted straight into the window's storage
+			m_data.resize(cell.dataOffset + utfSize + 1);
+			env->GetStringUTFRegion(string, 0, length, reinterpret_cast<char*>(m_data.data() + cell.dataOffset));
+			m_data[cell.dataOffset + utfSize] = 0;
+			cell.dataSize = utfSize;
+		}
+		break;
+	case CELL_TYPE_BLOB:
+		{
+			auto blob = static_cast<jbyteArray>(env->CallObjectMethod(cursor, classInfo.getBlob, column));
+			CJavaVM::CheckException(env);
+			jsize size = env->GetArrayLength(blob);
+			m_data.resize(cell.dataOffset + size);
+			env->GetByteArrayRegion(blob, 0, size, reinterpret_cast<jbyte*>(m_data.data() + cell.dataOffset));
+			cell.dataSize = size;
+		}
+		break;
+	default:
+		cell.type = CELL_TYPE_NULL;
+		break;
+	}
+}
@@ -0,0 +1,24 @@
+#include "android/JavaClassCache.h"
+#include "android/JavaVM.h"
+#include "android/android_content_ContentResolver.h"
+#include "android/android_database_Cursor.h"
+#include "android/android_net_Uri.h"
+#include "android/android_os_ParcelFileDescriptor.h"
+#include "android/java_security_MessageDigest.h"
+#include "android/javax_crypto_Mac.h"
+#include "android/javax_crypto_spec_SecretKeySpec.h"
+
+using namespace Framework;
+
+void CJavaClassCache::Prepare(JavaVM* vm)
+{
+	CJavaVM::SetJavaVM(vm);
+
+	android::content::ContentResolver_ClassInfo::GetInstance().PrepareClassInfo();
+	android::database::Cursor_ClassInfo::GetInstance().PrepareClassInfo();
+	android::net::Uri_ClassInfo::GetInstance().PrepareClassInfo();
+	android::os::ParcelFileDescriptor_ClassInfo::GetInstance().PrepareClassInfo();
+	java::security::MessageDigest_ClassInfo::GetInstance().PrepareClassInfo();
+	javax::crypto::Mac_ClassInfo::GetInstance().PrepareClassInfo();
+	javax::crypto::spec::SecretKeySpec_ClassInfo::GetInstance().PrepareClassInfo();
+}
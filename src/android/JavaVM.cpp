@@ -5,6 +5,7 @@
 using namespace Framework;
 
 JavaVM* CJavaVM::m_vm = nullptr;
+static thread_local JNIEnv* g_threadEnv = nullptr;
 
 void CJavaVM::SetJavaVM(JavaVM* vm)
 {
@@ -21,22 +22,29 @@ void CJavaVM::AttachCurrentThread(JNIEnv** env, const char* threadName)
 
 	[[maybe_unused]] jint result = m_vm->AttachCurrentThread(env, &args);
 	assert(result == JNI_OK);
+	g_threadEnv = *env;
 }
 
 void CJavaVM::DetachCurrentThread()
 {
 	assert(m_vm != nullptr);
+	g_threadEnv = nullptr;
 	m_vm->DetachCurrentThread();
 }
 
 JNIEnv* CJavaVM::GetEnv()
 {
+	if(g_threadEnv != nullptr)
+	{
+		return g_threadEnv;
+	}
 	assert(m_vm != nullptr);
 	JNIEnv* env = nullptr;
 	if(m_vm->GetEnv(reinterpret_cast<void**>(&env), JNI_VERSION_1_6) != JNI_OK)
 	{
 		throw std::runtime_error("Failed to obtain JNIEnv");
 	}
+	g_threadEnv = env;
 	return env;
 }
 
@@ -51,6 +59,30 @@ void CJavaVM::CheckException(JNIEnv* env)
 	}
 }
 
+CJavaLocalFrame::CJavaLocalFrame(jint capacity)
+: m_env(CJavaVM::GetEnv())
+{
+	if(m_env->PushLocalFrame(capacity) != 0)
+	{
+		CJavaVM::CheckException(m_env);
+	}
+}
+
+CJavaLocalFrame::~CJavaLocalFrame()
+{
+	if(!m_popped)
+	{
+		m_env->PopLocalFrame(NULL);
+	}
+}
+
+jobject CJavaLocalFrame::Pop(jobject result)
+{
+	assert(!m_popped);
+	m_popped = true;
+	return m_env->PopLocalFrame(result);
+}
+
 void JavaException::GetExceptionMessage()
 {
 	auto env = CJavaVM::GetEnv();
@@ -22,6 +22,46 @@ void Cursor_ClassInfo::PrepareClassInfo()
 	getCount = env->GetMethodID(clazz, "getCount", "()I");
 	Framework::CJavaVM::CheckException(env);
 	assert(getCount != NULL);
+
+	moveToFirst = env->GetMethodID(clazz, "moveToFirst", "()Z");
+	Framework::CJavaVM::CheckException(env);
+	assert(moveToFirst != NULL);
+
+	moveToNext = env->GetMethodID(clazz, "moveToNext", "()Z");
+	Framework::CJavaVM::CheckException(env);
+	assert(moveToNext != NULL);
+
+	getColumnIndex = env->GetMethodID(clazz, "getColumnIndex", "(Ljava/lang/String;)I");
+	Framework::CJavaVM::CheckException(env);
+	assert(getColumnIndex != NULL);
+
+	getInt = env->GetMethodID(clazz, "getInt", "(I)I");
+	Framework::CJavaVM::CheckException(env);
+	assert(getInt != NULL);
+
+	getLong = env->GetMethodID(clazz, "getLong", "(I)J");
+	Framework::CJavaVM::CheckException(env);
+	assert(getLong != NULL);
+
+	getString = env->GetMethodID(clazz, "getString", "(I)Ljava/lang/String;");
+	Framework::CJavaVM::CheckException(env);
+	assert(getString != NULL);
+
+	isNull = env->GetMethodID(clazz, "isNull", "(I)Z");
+	Framework::CJavaVM::CheckException(env);
+	assert(isNull != NULL);
+
+	getType = env->GetMethodID(clazz, "getType", "(I)I");
+	Framework::CJavaVM::CheckException(env);
+	assert(getType != NULL);
+
+	getDouble = env->GetMethodID(clazz, "getDouble", "(I)D");
+	Framework::CJavaVM::CheckException(env);
+	assert(getDouble != NULL);
+
+	getBlob = env->GetMethodID(clazz, "getBlob", "(I)[B");
+	Framework::CJavaVM::CheckException(env);
+	assert(getBlob != NULL);
 }
 
 void Cursor::close()
@@ -40,3 +80,93 @@ jint Cursor::getCount()
 	Framework::CJavaVM::CheckException(env);
 	return result;
 }
+
+jboolean Cursor::moveToFirst()
+{
+	auto env = Framework::CJavaVM::GetEnv();
+	const auto& classInfo = ClassInfo::GetInstance();
+	jboolean result = env->CallBooleanMethod(m_this, classInfo.moveToFirst);
+	Framework::CJavaVM::CheckException(env);
+	return result;
+}
+
+jboolean Cursor::moveToNext()
+{
+	auto env = Framework::CJavaVM::GetEnv();
+	const auto& classInfo = ClassInfo::GetInstance();
+	jboolean result = env->CallBooleanMethod(m_this, classInfo.moveToNext);
+	Framework::CJavaVM::CheckException(env);
+	return result;
+}
+
+jint Cursor::getColumnIndex(jstring columnName)
+{
+	auto env = Framework::CJavaVM::GetEnv();
+	const auto& classInfo = ClassInfo::GetInstance();
+	jint result = env->CallIntMethod(m_this, classInfo.getColumnIndex, columnName);
+	Framework::CJavaVM::CheckException(env);
+	return result;
+}
+
+jint Cursor::getInt(jint columnIndex)
+{
+	auto env = Framework::CJavaVM::GetEnv();
+	const auto& classInfo = ClassInfo::GetInstance();
+	jint result = env->CallIntMethod(m_this, classInfo.getInt, columnIndex);
+	Framework::CJavaVM::CheckException(env);
+	return result;
+}
+
+jlong Cursor::getLong(jint columnIndex)
+{
+	auto env = Framework::CJavaVM::GetEnv();
+	const auto& classInfo = ClassInfo::GetInstance();
+	jlong result = env->CallLongMethod(m_this, classInfo.getLong, columnIndex);
+	Framework::CJavaVM::CheckException(env);
+	return result;
+}
+
+jstring Cursor::getString(jint columnIndex)
+{
+	auto env = Framework::CJavaVM::GetEnv();
+	const auto& classInfo = ClassInfo::GetInstance();
+	jstring result = static_cast<jstring>(env->CallObjectMethod(m_this, classInfo.getString, columnIndex));
+	Framework::CJavaVM::CheckException(env);
+	return result;
+}
+
+jboolean Cursor::isNull(jint columnIndex)
+{
+	auto env = Framework::CJavaVM::GetEnv();
+	const auto& classInfo = ClassInfo::GetInstance();
+	jboolean result = env->CallBooleanMethod(m_this, classInfo.isNull, columnIndex);
+	Framework::CJavaVM::CheckException(env);
+	return result;
+}
+
+jint Cursor::getType(jint columnIndex)
+{
+	auto env = Framework::CJavaVM::GetEnv();
+	const auto& classInfo = ClassInfo::GetInstance();
+	jint result = env->CallIntMethod(m_this, classInfo.getType, columnIndex);
+	Framework::CJavaVM::CheckException(env);
+	return result;
+}
+
+jdouble Cursor::getDouble(jint columnIndex)
+{
+	auto env = Framework::CJavaVM::GetEnv();
+	const auto& classInfo = ClassInfo::GetInstance();
+	jdouble result = env->CallDoubleMethod(m_this, classInfo.getDouble, columnIndex);
+	Framework::CJavaVM::CheckException(env);
+	return result;
+}
+
+jbyteArray Cursor::getBlob(jint columnIndex)
+{
+	auto env = Framework::CJavaVM::GetEnv();
+	const auto& classInfo = ClassInfo::GetInstance();
+	jbyteArray result = static_cast<jbyteArray>(env->CallObjectMethod(m_this, classInfo.getBlob, columnIndex));
+	Framework::CJavaVM::CheckException(env);
+	return result;
+}
@@ -4,6 +4,18 @@
 
 using namespace java::security;
 
+MessageDigest::MessageDigest(MessageDigest&& src)
+{
+	MoveFrom(std::move(src));
+}
+
+MessageDigest& MessageDigest::operator =(MessageDigest&& rhs)
+{
+	Reset();
+	MoveFrom(std::move(rhs));
+	return (*this);
+}
+
 MessageDigest MessageDigest::getInstance(jstring algorithm)
 {
 	auto env = Framework::CJavaVM::GetEnv();
@@ -25,6 +37,23 @@ jbyteArray MessageDigest::digest(jbyteArray input)
 	return result;
 }
 
+jbyteArray MessageDigest::digest()
+{
+	auto env = Framework::CJavaVM::GetEnv();
+	const auto& classInfo = ClassInfo::GetInstance();
+	jbyteArray result = static_cast<jbyteArray>(env->CallObjectMethod(m_this, classInfo.digestFinal));
+	Framework::CJavaVM::CheckException(env);
+	return result;
+}
+
+void MessageDigest::update(jbyteArray input)
+{
+	auto env = Framework::CJavaVM::GetEnv();
+	const auto& classInfo = ClassInfo::GetInstance();
+	env->CallVoidMethod(m_this, classInfo.update, input);
+	Framework::CJavaVM::CheckException(env);
+}
+
 void MessageDigest_ClassInfo::PrepareClassInfo()
 {
 	auto env = Framework::CJavaVM::GetEnv();
@@ -42,4 +71,12 @@ void MessageDigest_ClassInfo::PrepareClassInfo()
 	digest = env->GetMethodID(clazz, "digest", "([B)[B");
 	Framework::CJavaVM::CheckException(env);
 	assert(digest != NULL);
+
+	digestFinal = env->GetMethodID(clazz, "digest", "()[B");
+	Framework::CJavaVM::CheckException(env);
+	assert(digestFinal != NULL);
+
+	update = env->GetMethodID(clazz, "update", "([B)V");
+	Framework::CJavaVM::CheckException(env);
+	assert(update != NULL);
 }
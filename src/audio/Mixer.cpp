@@ -0,0 +1,200 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include "audio/Mixer.h"
+#include "audio/SampleConvert.h"
+#include "SimdDefs.h"
+
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+#include <emmintrin.h>
+#elif defined(FRAMEWORK_SIMD_USE_NEON)
+#include <arm_neon.h>
+#endif
+
+using namespace Framework::Audio;
+
+namespace
+{
+	struct GAINS
+	{
+		float left = 0;
+		float right = 0;
+	};
+
+	GAINS GetMonoGains(float volume, float pan)
+	{
+		//Constant power, both sides get 1/sqrt(2) at the center
+		const float quarterPi = 0.785398163f;
+		float angle = (std::min(std::max(pan, -1.0f), 1.0f) + 1.0f) * quarterPi;
+		GAINS gains;
+		gains.left = volume * std::cos(angle);
+		gains.right = volume * std::sin(angle);
+		return gains;
+	}
+
+	GAINS GetStereoGains(float volume, float pan)
+	{
+		pan = std::min(std::max(pan, -1.0f), 1.0f);
+		GAINS gains;
+		gains.left = volume * std::min(1.0f, 1.0f - pan);
+		gains.right = volume * std::min(1.0f, 1.0f + pan);
+		return gains;
+	}
+
+	//Block holds interleaved stereo frames
+	void MixMonoBlock(float* block, const float* input, size_t frameCount, GAINS gains)
+	{
+		size_t i = 0;
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+		const __m128 gain = _mm_setr_ps(gains.left, gains.right, gains.left, gains.right);
+		for(; (i + 4) <= frameCount; i += 4)
+		{
+			__m128 samples = _mm_loadu_ps(input + i);
+			float* output = block + (i * 2);
+			_mm_storeu_ps(output + 0, _mm_add_ps(_mm_loadu_ps(output + 0), _mm_mul_ps(_mm_unpacklo_ps(samples, samples), gain)));
+			_mm_storeu_ps(output + 4, _mm_add_ps(_mm_loadu_ps(output + 4), _mm_mul_ps(_mm_unpackhi_ps(samples, samples), gain)));
+		}
+#elif defined(FRAMEWORK_SIMD_USE_NEON)
+		const float gainValues[4] = {gains.left, gains.right, gains.left, gains.right};
+		const float32x4_t gain = vld1q_f32(gainValues);
+		for(; (i + 4) <= frameCount; i += 4)
+		{
+			float32x4_t samples = vld1q_f32(input + i);
+			float32x4x2_t pairs = vzipq_f32(samples, samples);
+			float* output = block + (i * 2);
+			vst1q_f32(output + 0, vmlaq_f32(vld1q_f32(output + 0), pairs.val[0], gain));
+			vst1q_f32(output + 4, vmlaq_f32(vld1q_f32(output + 4), pairs.val[1], gain));
+		}
+#endif
+		for(; i < frameCount; i++)
+		{
+			block[(i * 2) + 0] += input[i] * gains.left;
+			block[(i * 2) + 1] += input[i] * gains.right;
+		}
+	}
+
+	void MixStereoBlock(float* block, const float* input, size_t frameCount, GAINS gains)
+	{
+		size_t sampleCount = frameCount * 2;
+		size_t i = 0;
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+		const __m128 gain = _mm_setr_ps(gains.left, gains.right, gains.left, gains.right);
+		for(; (i + 4) <= sampleCount; i += 4)
+		{
+			_mm_storeu_ps(block + i, _mm_add_ps(_mm_loadu_ps(block + i), _mm_mul_ps(_mm_loadu_ps(input + i), gain)));
+		}
+#elif defined(FRAMEWORK_SIMD_USE_NEON)
+		const float gainValues[4] = {gains.left, gains.right, gains.left, gains.right};
+		const float32x4_t gain = vld1q_f32(gainValues);
+		for(; (i + 4) <= sampleCount; i += 4)
+		{
+			vst1q_f32(block + i, vmlaq_f32(vld1q_f32(block + i), vld1q_f32(input + i), gain));
+		}
+#endif
+		for(; i < sampleCount; i += 2)
+		{
+			block[i + 0] += input[i + 0] * gains.left;
+			block[i + 1] += input[i + 1] * gains.right;
+		}
+	}
+
+	//16-bit voices are converted in small batches on the stack
+	template <typename MixFunction>
+	void MixS16Block(float* block, const int16* input, size_t frameCount, unsigned int channelCount, GAINS gains, MixFunction mixFunction)
+	{
+		enum
+		{
+			BATCH_SAMPLE_COUNT = 256,
+		};
+		float samples[BATCH_SAMPLE_COUNT];
+		size_t batchFrameCount = BATCH_SAMPLE_COUNT / channelCount;
+		for(size_t frame = 0; frame < frameCount; frame += batchFrameCount)
+		{
+			size_t count = std::min(batchFrameCount, frameCount - frame);
+			ConvertS16ToF32(samples, input + (frame * channelCount), count * channelCount);
+			mixFunction(block + (frame * 2), samples, count, gains);
+		}
+	}
+}
+
+CMixer::CMixer(unsigned int mixRate, unsigned int outputRate, unsigned int chunkFrameCount)
+: m_chunkFrameCount(chunkFrameCount)
+{
+	assert(chunkFrameCount != 0);
+	if(mixRate != outputRate)
+	{
+		m_resampler = std::make_unique<CPolyphaseResampler>(mixRate, outputRate, 2);
+	}
+}
+
+void CMixer::BeginBlock(unsigned int frameCount)
+{
+	m_blockFrameCount = frameCount;
+	m_block.assign(frameCount * 2, 0.0f);
+}
+
+void CMixer::MixMono(const int16* input, float volume, float pan)
+{
+	MixS16Block(m_block.data(), input, m_blockFrameCount, 1, GetMonoGains(volume, pan), &MixMonoBlock);
+}
+
+void CMixer::MixMono(const float* input, float volume, float pan)
+{
+	MixMonoBlock(m_block.data(), input, m_blockFrameCount, GetMonoGains(volume, pan));
+}
+
+void CMixer::MixStereo(const int16* input, float volume, float pan)
+{
+	MixS16Block(m_block.data(), input, m_blockFrameCount, 2, GetStereoGains(volume, pan), &MixStereoBlock);
+}
+
+void CMixer::MixStereo(const float* input, float volume, float pan)
+{
+	MixStereoBlock(m_block.data(), input, m_blockFrameCount, GetStereoGains(volume, pan));
+}
+
+void CMixer::EndBlock()
+{
+	//Drops frames already read before growing the queue
+	if(m_pendingStart != 0)
+	{
+		m_pending.erase(m_pending.begin(), m_pending.begin() + m_pendingStart);
+		m_pendingStart = 0;
+	}
+
+	if(m_resampler)
+	{
+		m_resampled.resize(m_resampler->GetMaxOutputFrameCount(m_blockFrameCount) * 2);
+		size_t frameCount = m_resampler->Process(m_block.data(), m_blockFrameCount, m_resampled.data());
+		m_pending.insert(m_pending.end(), m_resampled.begin(), m_resampled.begin() + (frameCount * 2));
+	}
+	else
+	{
+		m_pending.insert(m_pending.end(), m_block.begin(), m_block.end());
+	}
+	m_blockFrameCount = 0;
+}
+
+unsigned int CMixer::GetChunkFrameCount() const
+{
+	return m_chunkFrameCount;
+}
+
+unsigned int CMixer::GetAvailableChunkCount() const
+{
+	size_t frameCount = (m_pending.size() - m_pendingStart) / 2;
+	return static_cast<unsigned int>(frameCount / m_chunkFrameCount);
+}
+
+bool CMixer::ReadChunk(int16* output)
+{
+	if(GetAvailableChunkCount() == 0)
+	{
+		return false;
+	}
+	size_t sampleCount = m_chunkFrameCount * 2;
+	ConvertF32ToS16(output, m_pending.data() + m_pendingStart, sampleCount);
+	m_pendingStart += sampleCount;
+	return true;
+}
@@ -0,0 +1,179 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <numeric>
+#include "audio/PolyphaseResampler.h"
+#include "SimdDefs.h"
+
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+#include <emmintrin.h>
+#elif defined(FRAMEWORK_SIMD_USE_NEON)
+#include <arm_neon.h>
+#endif
+
+using namespace Framework::Audio;
+
+namespace
+{
+	const double g_pi = 3.14159265358979323846;
+	//Gives about 80dB of stop band attenuation
+	const double g_kaiserBeta = 8.0;
+	//Leaves room for the transition band below Nyquist
+	const double g_cutoffScale = 0.92;
+
+	double BesselI0(double x)
+	{
+		double sum = 1;
+		double term = 1;
+		for(int k = 1; k < 32; k++)
+		{
+			double factor = x / (2 * k);
+			term *= factor * factor;
+			sum += term;
+			if(term < (sum * 1e-12)) break;
+		}
+		return sum;
+	}
+
+	//Tap count is a multiple of 4
+	float DotProduct(const float* samples, const float* filter, unsigned int tapCount)
+	{
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+		__m128 sum = _mm_setzero_ps();
+		for(unsigned int i = 0; i < tapCount; i += 4)
+		{
+			sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(samples + i), _mm_loadu_ps(filter + i)));
+		}
+		sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+		sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+		return _mm_cvtss_f32(sum);
+#elif defined(FRAMEWORK_SIMD_USE_NEON)
+		float32x4_t sum = vdupq_n_f32(0);
+		for(unsigned int i = 0; i < tapCount; i += 4)
+		{
+			sum = vmlaq_f32(sum, vld1q_f32(samples + i), vld1q_f32(filter + i));
+		}
+		float32x2_t pair = vadd_f32(vget_low_f32(sum), vget_high_f32(sum));
+		return vget_lane_f32(vpadd_f32(pair, pair), 0);
+#else
+		float sum[4] = {};
+		for(unsigned int i = 0; i < tapCount; i += 4)
+		{
+			for(unsigned int j = 0; j < 4; j++)
+			{
+				sum[j] += samples[i + j] * filter[i + j];
+			}
+		}
+		return (sum[0] + sum[2]) + (sum[1] + sum[3]);
+#endif
+	}
+}
+
+CPolyphaseResampler::CPolyphaseResampler(unsigned int inputRate, unsigned int outputRate, unsigned int channelCount, unsigned int tapCount)
+: m_channelCount(channelCount)
+, m_tapCount(tapCount)
+{
+	assert(inputRate != 0 && outputRate != 0);
+	assert(channelCount != 0);
+	assert(tapCount != 0 && (tapCount % 4) == 0);
+
+	unsigned int divisor = std::gcd(inputRate, outputRate);
+	m_upFactor = outputRate / divisor;
+	m_downFactor = inputRate / divisor;
+	m_phaseCount = std::min<unsigned int>(m_upFactor, MAX_PHASE_COUNT);
+
+	m_history.resize(m_channelCount);
+	BuildFilters();
+	Reset();
+}
+
+size_t CPolyphaseResampler::Process(const float* input, size_t inputFrameCount, float* output)
+{
+	for(unsigned int channel = 0; channel < m_channelCount; channel++)
+	{
+		auto& history = m_history[channel];
+		size_t historySize = history.size();
+		history.resize(historySize + inputFrameCount);
+		for(size_t i = 0; i < inputFrameCount; i++)
+		{
+			history[historySize + i] = input[(i * m_channelCount) + channel];
+		}
+	}
+
+	size_t availableFrameCount = m_history[0].size();
+	size_t outputFrameCount = 0;
+	while((m_windowStart + m_tapCount) <= availableFrameCount)
+	{
+		unsigned int phaseIndex = static_cast<unsigned int>((static_cast<uint64>(m_phase) * m_phaseCount) / m_upFactor);
+		const float* filter = m_filters.data() + (phaseIndex * m_tapCount);
+		for(unsigned int channel = 0; channel < m_channelCount; channel++)
+		{
+			output[(outputFrameCount * m_channelCount) + channel] = DotProduct(m_history[channel].data() + m_windowStart, filter, m_tapCount);
+		}
+		outputFrameCount++;
+
+		m_phase += m_downFactor;
+		m_windowStart += m_phase / m_upFactor;
+		m_phase %= m_upFactor;
+	}
+
+	//Drops input that no window will cover anymore
+	size_t consumedFrameCount = std::min(m_windowStart, availableFrameCount);
+	for(auto& history : m_history)
+	{
+		history.erase(history.begin(), history.begin() + consumedFrameCount);
+	}
+	m_windowStart -= consumedFrameCount;
+
+	return outputFrameCount;
+}
+
+size_t CPolyphaseResampler::GetMaxOutputFrameCount(size_t inputFrameCount) const
+{
+	size_t bufferedFrameCount = m_history[0].size() - std::min(m_windowStart, m_history[0].size());
+	uint64 frameCount = bufferedFrameCount + inputFrameCount;
+	return static_cast<size_t>(((frameCount * m_upFactor) + m_downFactor - 1) / m_downFactor) + 1;
+}
+
+void CPolyphaseResampler::Reset()
+{
+	//Windows are centered on their output frame, the first one starts before the first input frame
+	for(auto& history : m_history)
+	{
+		history.assign((m_tapCount / 2) - 1, 0.0f);
+	}
+	m_windowStart = 0;
+	m_phase = 0;
+}
+
+void CPolyphaseResampler::BuildFilters()
+{
+	double cutoff = g_cutoffScale * std::min(1.0, static_cast<double>(m_upFactor) / static_cast<double>(m_downFactor));
+	double halfLength = static_cast<double>(m_tapCount) / 2;
+	double windowScale = 1.0 / BesselI0(g_kaiserBeta);
+
+	m_filters.resize(m_phaseCount * m_tapCount);
+	for(unsigned int phaseIndex = 0; phaseIndex < m_phaseCount; phaseIndex++)
+	{
+		double fraction = static_cast<double>(phaseIndex) / static_cast<double>(m_phaseCount);
+		float* filter = m_filters.data() + (phaseIndex * m_tapCount);
+		double sum = 0;
+		for(unsigned int tap = 0; tap < m_tapCount; tap++)
+		{
+			//Distance between the input frame and the output frame's position, in input frames
+			double distance = static_cast<double>(tap) - (halfLength - 1) - fraction;
+			double x = cutoff * distance;
+			double sinc = (x == 0) ? 1.0 : std::sin(g_pi * x) / (g_pi * x);
+			double ratio = distance / halfLength;
+			double window = (std::abs(ratio) < 1) ? BesselI0(g_kaiserBeta * std::sqrt(1 - (ratio * ratio))) * windowScale : 0;
+			double coefficient = cutoff * sinc * window;
+			filter[tap] = static_cast<float>(coefficient);
+			sum += coefficient;
+		}
+		//Unity gain for DC on every phase, avoids a ripple at the phase rate
+		for(unsigned int tap = 0; tap < m_tapCount; tap++)
+		{
+			filter[tap] = static_cast<float>(filter[tap] / sum);
+		}
+	}
+}
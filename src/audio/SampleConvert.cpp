@@ -0,0 +1,94 @@
+#include <algorithm>
+#include <cmath>
+#include "audio/SampleConvert.h"
+#include "SimdDefs.h"
+
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+#include <emmintrin.h>
+#elif defined(FRAMEWORK_SIMD_USE_NEON)
+#include <arm_neon.h>
+#endif
+
+using namespace Framework::Audio;
+
+namespace
+{
+	const float g_s16ToF32Scale = 1.0f / 32768.0f;
+	const float g_f32ToS16Scale = 32768.0f;
+
+	int16 ConvertSampleF32ToS16(float sample)
+	{
+		float scaled = std::min(std::max(sample * g_f32ToS16Scale, -32768.0f), 32767.0f);
+		return static_cast<int16>(std::lrint(scaled));
+	}
+}
+
+void Framework::Audio::ConvertS16ToF32(float* output, const int16* input, size_t count)
+{
+	size_t i = 0;
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+	const __m128 scale = _mm_set1_ps(g_s16ToF32Scale);
+	for(; (i + 8) <= count; i += 8)
+	{
+		__m128i samples = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i));
+		//Sign extend by putting the samples in the upper halves and shifting them back down
+		__m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(samples, samples), 16);
+		__m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(samples, samples), 16);
+		_mm_storeu_ps(output + i + 0, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+		_mm_storeu_ps(output + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+	}
+#elif defined(FRAMEWORK_SIMD_USE_NEON)
+	const float32x4_t scale = vdupq_n_f32(g_s16ToF32Scale);
+	for(; (i + 8) <= count; i += 8)
+	{
+		int16x8_t samples = vld1q_s16(input + i);
+		int32x4_t lo = vmovl_s16(vget_low_s16(samples));
+		int32x4_t hi = vmovl_s16(vget_high_s16(samples));
+		vst1q_f32(output + i + 0, vmulq_f32(vcvtq_f32_s32(lo), scale));
+		vst1q_f32(output + i + 4, vmulq_f32(vcvtq_f32_s32(hi), scale));
+	}
+#endif
+	for(; i < count; i++)
+	{
+		output[i] = static_cast<float>(input[i]) * g_s16ToF32Scale;
+	}
+}
+
+void Framework::Audio::ConvertF32ToS16(int16* output, const float* input, size_t count)
+{
+	size_t i = 0;
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+	const __m128 scale = _mm_set1_ps(g_f32ToS16Scale);
+	const __m128 minValue = _mm_set1_ps(-32768.0f);
+	const __m128 maxValue = _mm_set1_ps(32767.0f);
+	for(; (i + 8) <= count; i += 8)
+	{
+		//Clamping first keeps out of range values from converting to 0x80000000
+		__m128 lo = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(input + i + 0), scale), minValue), maxValue);
+		__m128 hi = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(input + i + 4), scale), minValue), maxValue);
+		__m128i samples = _mm_packs_epi32(_mm_cvtps_epi32(lo), _mm_cvtps_epi32(hi));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(output + i), samples);
+	}
+#elif defined(FRAMEWORK_SIMD_USE_NEON)
+	const float32x4_t scale = vdupq_n_f32(g_f32ToS16Scale);
+	const float32x4_t minValue = vdupq_n_f32(-32768.0f);
+	const float32x4_t maxValue = vdupq_n_f32(32767.0f);
+	const float32x4_t half = vdupq_n_f32(0.5f);
+	const uint32x4_t signMask = vdupq_n_u32(0x80000000);
+	for(; (i + 8) <= count; i += 8)
+	{
+		float32x4_t lo = vminq_f32(vmaxq_f32(vmulq_f32(vld1q_f32(input + i + 0), scale), minValue), maxValue);
+		float32x4_t hi = vminq_f32(vmaxq_f32(vmulq_f32(vld1q_f32(input + i + 4), scale), minValue), maxValue);
+		//Conversion truncates, rounds half away from zero by adding 0.5 with the sign of the value
+		float32x4_t loHalf = vreinterpretq_f32_u32(vorrq_u32(vandq_u32(vreinterpretq_u32_f32(lo), signMask), vreinterpretq_u32_f32(half)));
+		float32x4_t hiHalf = vreinterpretq_f32_u32(vorrq_u32(vandq_u32(vreinterpretq_u32_f32(hi), signMask), vreinterpretq_u32_f32(half)));
+		int32x4_t loInt = vcvtq_s32_f32(vaddq_f32(lo, loHalf));
+		int32x4_t hiInt = vcvtq_s32_f32(vaddq_f32(hi, hiHalf));
+		vst1q_s16(output + i, vcombine_s16(vqmovn_s32(loInt), vqmovn_s32(hiInt)));
+	}
+#endif
+	for(; i < count; i++)
+	{
+		output[i] = ConvertSampleF32ToS16(input[i]);
+	}
+}
@@ -1,5 +1,9 @@
+#include <algorithm>
+#include <cstring>
 #include <stdexcept>
+#include <vector>
 #include "bitmap/BMP.h"
+#include "bitmap/PixelConvert.h"
 
 using namespace Framework;
 
@@ -17,7 +21,6 @@ void CBMP::WriteBitmap(const CBitmap& bitmap, CStream& stream)
 	uint32 colorTableEntryCount = (bitDepth == 8) ? 256 : 0;
 	uint32 dataOffset = sizeof(BMHEADER) + sizeof(BMINFOHEADER) + (colorTableEntryCount * 4);
 	uint32 rowSize = (bitmap.GetPitch() + 3) & ~0x03;
-	uint32 paddingSize = rowSize - bitmap.GetPitch();
 	uint32 imageDataSize = rowSize * bitmap.GetHeight();
 
 	{
@@ -57,32 +60,24 @@ void CBMP::WriteBitmap(const CBitmap& bitmap, CStream& stream)
 	unsigned int width = bitmap.GetWidth();
 	unsigned int height = bitmap.GetHeight();
 
-	PixelWriterFunction pixelWriter;
-	switch(bitDepth)
-	{
-	case 8:
-		pixelWriter = PixelWriter8;
-		break;
-	case 24:
-		pixelWriter = PixelWriter24;
-		break;
-	case 32:
-		pixelWriter = PixelWriter32;
-		break;
-	}
-
-	uint32 paddingValue = 0;
+	//Rows are stored bottom-up in BGR(A) order, padding is left as zeroes
+	std::vector<uint8> row(rowSize, 0);
 	for(int y = (height - 1); y >= 0; y--)
 	{
-		for(int x = 0; x < static_cast<int>(width); x++)
-		{
-			CColor pixel = bitmap.GetPixel(x, y);
-			pixelWriter(stream, pixel);
-		}
-		if(paddingSize != 0)
+		const uint8* srcRow = bitmap.GetPixels() + (y * bitmap.GetPitch());
+		switch(bitDepth)
 		{
-			stream.Write(&paddingValue, paddingSize);
+		case 8:
+			memcpy(row.data(), srcRow, width);
+			break;
+		case 24:
+			PixelConvert::SwapRedBlue24(row.data(), srcRow, width);
+			break;
+		case 32:
+			PixelConvert::SwapRedBlue32(row.data(), srcRow, width);
+			break;
 		}
+		stream.Write(row.data(), rowSize);
 	}
 }
 
@@ -99,48 +94,238 @@ CBitmap CBMP::ReadBitmap(CStream& stream)
 	BMINFOHEADER bmInfoHeader;
 	stream.Read(&bmInfoHeader, sizeof(BMINFOHEADER));
 
-	if(bmInfoHeader.nHeaderSize != sizeof(BMINFOHEADER))
+	//Later versions of the header only add fields at the end
+	if(bmInfoHeader.nHeaderSize < sizeof(BMINFOHEADER))
 	{
 		throw std::runtime_error("Invalid header size.");
 	}
 
-	if(bmInfoHeader.nBPP != 8)
+	//Height is negative for top-down images, which can't be compressed
+	unsigned int bpp = bmInfoHeader.nBPP;
+	int32 height = static_cast<int32>(bmInfoHeader.nHeight);
+	bool isTopDown = (height < 0);
+	bool supported = false;
+	switch(bmInfoHeader.nCompression)
 	{
-		throw std::runtime_error("Bit depths other than 8-bits aren't supported.");
+	case COMPRESSION_RGB:
+		supported = (bpp == 4) || (bpp == 8) || (bpp == 24) || (bpp == 32);
+		break;
+	case COMPRESSION_RLE8:
+		supported = (bpp == 8) && !isTopDown;
+		break;
+	case COMPRESSION_RLE4:
+		supported = (bpp == 4) && !isTopDown;
+		break;
+	}
+	if(!supported)
+	{
+		throw std::runtime_error("Unsupported bit depth or compression.");
 	}
 
 	unsigned int nWidth  = bmInfoHeader.nWidth;
-	unsigned int nHeight = bmInfoHeader.nHeight;
+	unsigned int nHeight = isTopDown ? (0U - static_cast<uint32>(height)) : height;
 
 	stream.Seek(bmHeader.nDataOffset, STREAM_SEEK_SET);
 
-	CBitmap result(nWidth, nHeight, bmInfoHeader.nBPP);
-	uint8* pPixels = result.GetPixels();
-	for(int i = (nHeight - 1); i >= 0; i--)
+	CBitmap result(nWidth, nHeight, (bpp == 4) ? 8 : bpp);
+	if(bmInfoHeader.nCompression == COMPRESSION_RGB)
+	{
+		ReadPixels(stream, result, bpp, isTopDown);
+	}
+	else
 	{
-		stream.Read(pPixels + (i * nWidth), nWidth);
-		stream.Seek(((4 - (nWidth & 3)) & 3), STREAM_SEEK_CUR);
+		uint64 dataSize = (bmInfoHeader.nDataSize != 0) ? bmInfoHeader.nDataSize : stream.GetRemainingLength();
+		std::vector<uint8> data(static_cast<size_t>(dataSize));
+		data.resize(static_cast<size_t>(stream.Read(data.data(), data.size())));
+		DecodeRle(data.data(), data.size(), result, bmInfoHeader.nCompression == COMPRESSION_RLE4);
 	}
 
 	return result;
 }
 
-void CBMP::PixelWriter8(CStream& stream, const CColor& pixel)
+CImageProbe::INFO CBMP::ReadInfo(CStream& stream)
 {
-	stream.Write(&pixel.r, 1);
+	BMHEADER bmHeader;
+	if(stream.Read(&bmHeader, sizeof(BMHEADER)) != sizeof(BMHEADER) || (bmHeader.nID != BMP_MAGIC))
+	{
+		throw std::runtime_error("Invalid header signature.");
+	}
+
+	CImageProbe::INFO info;
+	info.format = CImageProbe::FORMAT_BMP;
+
+	uint32 headerSize = stream.Read32();
+	if(headerSize == 12)
+	{
+		//BITMAPCOREHEADER
+		info.width = stream.Read16();
+		info.height = stream.Read16();
+		stream.Read16();
+		info.bitsPerPixel = stream.Read16();
+	}
+	else if(headerSize >= sizeof(BMINFOHEADER))
+	{
+		//Height is negative for top-down images
+		info.width = stream.Read32();
+		int32 height = static_cast<int32>(stream.Read32());
+		info.height = (height < 0) ? (0U - static_cast<uint32>(height)) : height;
+		stream.Read16();
+		info.bitsPerPixel = stream.Read16();
+	}
+	else
+	{
+		throw std::runtime_error("Invalid header size.");
+	}
+
+	return info;
 }
 
-void CBMP::PixelWriter24(CStream& stream, const CColor& pixel)
+//Rows are read in blocks and copied to their place in the bitmap, converted along the way. Rows without
+//padding are read straight into the bitmap and converted in place.
+void CBMP::ReadPixels(CStream& stream, CBitmap& bitmap, unsigned int bpp, bool isTopDown)
 {
-	stream.Write(&pixel.b, 1);
-	stream.Write(&pixel.g, 1);
-	stream.Write(&pixel.r, 1);
+	unsigned int width = bitmap.GetWidth();
+	unsigned int height = bitmap.GetHeight();
+	unsigned int pitch = bitmap.GetPitch();
+	uint8* pixels = bitmap.GetPixels();
+	uint32 rowSize = (((width * bpp) + 31) / 32) * 4;
+
+	if((rowSize == pitch) && (bpp != 4))
+	{
+		if(stream.Read(pixels, bitmap.GetPixelsSize()) != bitmap.GetPixelsSize())
+		{
+			throw std::runtime_error("Unexpected end of file.");
+		}
+		if(!isTopDown)
+		{
+			bitmap.FlipVerticalInPlace();
+		}
+		if(bpp == 24)
+		{
+			PixelConvert::SwapRedBlue24(pixels, pixels, width * height);
+		}
+		else if(bpp == 32)
+		{
+			PixelConvert::SwapRedBlue32(pixels, pixels, width * height);
+		}
+		return;
+	}
+
+	unsigned int blockRowCount = std::max<unsigned int>(1, READ_BLOCK_SIZE / rowSize);
+	std::vector<uint8> block(std::min(blockRowCount, height) * rowSize);
+	for(unsigned int y = 0; y < height; y += blockRowCount)
+	{
+		unsigned int rowCount = std::min(blockRowCount, height - y);
+		size_t readSize = rowCount * rowSize;
+		if(stream.Read(block.data(), readSize) != readSize)
+		{
+			throw std::runtime_error("Unexpected end of file.");
+		}
+		for(unsigned int i = 0; i < rowCount; i++)
+		{
+			const uint8* srcRow = block.data() + (i * rowSize);
+			unsigned int dstY = isTopDown ? (y + i) : (height - 1 - (y + i));
+			uint8* dstRow = pixels + (dstY * pitch);
+			switch(bpp)
+			{
+			case 4:
+				for(unsigned int x = 0; x < width; x++)
+				{
+					dstRow[x] = (srcRow[x / 2] >> ((x & 1) ? 0 : 4)) & 0x0F;
+				}
+				break;
+			case 8:
+				memcpy(dstRow, srcRow, width);
+				break;
+			case 24:
+				PixelConvert::SwapRedBlue24(dstRow, srcRow, width);
+				break;
+			case 32:
+				PixelConvert::SwapRedBlue32(dstRow, srcRow, width);
+				break;
+			}
+		}
+	}
 }
 
-void CBMP::PixelWriter32(CStream& stream, const CColor& pixel)
+//Runs and absolute runs of indices with escapes for line ends and jumps. Rows are stored bottom-up and
+//pixels that are jumped over stay at 0. Decoding stops at the end of the data if there's no end marker.
+void CBMP::DecodeRle(const uint8* data, size_t size, CBitmap& bitmap, bool isRle4)
 {
-	stream.Write(&pixel.b, 1);
-	stream.Write(&pixel.g, 1);
-	stream.Write(&pixel.r, 1);
-	stream.Write(&pixel.a, 1);
+	unsigned int width = bitmap.GetWidth();
+	unsigned int height = bitmap.GetHeight();
+	unsigned int pitch = bitmap.GetPitch();
+	uint8* pixels = bitmap.GetPixels();
+	memset(pixels, 0, bitmap.GetPixelsSize());
+
+	unsigned int x = 0;
+	unsigned int y = 0;
+	size_t position = 0;
+	while(((size - position) >= 2) && (y < height))
+	{
+		unsigned int count = data[position++];
+		uint8 value = data[position++];
+		uint8* row = pixels + ((height - 1 - y) * pitch);
+		if(count != 0)
+		{
+			unsigned int runEnd = std::min(x + count, width);
+			if(isRle4)
+			{
+				uint8 colors[2] = { static_cast<uint8>(value >> 4), static_cast<uint8>(value & 0x0F) };
+				for(unsigned int i = x; i < runEnd; i++)
+				{
+					row[i] = colors[(i - x) & 1];
+				}
+			}
+			else if(runEnd > x)
+			{
+				memset(row + x, value, runEnd - x);
+			}
+			x += count;
+			continue;
+		}
+		switch(value)
+		{
+		case 0:
+			//End of line
+			x = 0;
+			y++;
+			break;
+		case 1:
+			//End of bitmap
+			return;
+		case 2:
+			//Jump
+			if((size - position) < 2) return;
+			x += data[position + 0];
+			y += data[position + 1];
+			position += 2;
+			break;
+		default:
+			{
+				//Absolute run, padded to 16 bits
+				count = value;
+				size_t byteCount = isRle4 ? ((count + 1) / 2) : count;
+				if((size - position) < byteCount) return;
+				const uint8* src = data + position;
+				unsigned int runEnd = std::min(x + count, width);
+				if(isRle4)
+				{
+					for(unsigned int i = x; i < runEnd; i++)
+					{
+						unsigned int index = i - x;
+						row[i] = (src[index / 2] >> ((index & 1) ? 0 : 4)) & 0x0F;
+					}
+				}
+				else if(runEnd > x)
+				{
+					memcpy(row + x, src, runEnd - x);
+				}
+				x += count;
+				position += (byteCount + 1) & ~1;
+				position = std::min(position, size);
+			}
+			break;
+		}
+	}
 }
@@ -5,6 +5,10 @@
 #include <algorithm>
 #include <cmath>
 #include "bitmap/Bitmap.h"
+#include "bitmap/BitmapResampler.h"
+#include "bitmap/BitmapView.h"
+#include "bitmap/PixelConvert.h"
+#include "memory/AllocationTracker.h"
 
 using namespace Framework;
 
@@ -18,9 +22,9 @@ CBitmap::CBitmap(CBitmap&& src)
 	MoveFrom(std::move(src));
 }
 
-CBitmap::CBitmap(unsigned int nWidth, unsigned int nHeight, unsigned int nBPP)
+CBitmap::CBitmap(unsigned int nWidth, unsigned int nHeight, unsigned int nBPP, CBitmapAllocator* allocator)
 {
-	Allocate(nWidth, nHeight, nBPP);
+	Allocate(nWidth, nHeight, nBPP, allocator);
 }
 
 CBitmap::~CBitmap()
@@ -47,26 +51,31 @@ CBitmap& CBitmap::operator =(CBitmap&& src)
 	return (*this);
 }
 
-void CBitmap::Allocate(unsigned int width, unsigned int height, unsigned int bpp)
+void CBitmap::Allocate(unsigned int width, unsigned int height, unsigned int bpp, CBitmapAllocator* allocator)
 {
 	assert(m_pixels == nullptr);
 
 	m_width		= width;
 	m_height	= height;
 	m_bpp		= bpp;
-	m_pixels	= new uint8[GetPixelsSize()];
+	m_allocator	= allocator;
+	AllocateBuffer(GetPixelsSize());
 }
 
 void CBitmap::Reset()
 {
-	delete [] m_pixels;
-	m_pixels = nullptr;
+	ReleaseBuffer();
 
 	m_width = 0;
 	m_height = 0;
 	m_bpp = 0;
 }
 
+CBitmapAllocator* CBitmap::GetAllocator() const
+{
+	return m_allocator;
+}
+
 bool CBitmap::IsEmpty() const
 {
 	return m_pixels == nullptr;
@@ -85,25 +94,7 @@ CColor CBitmap::GetPixel(unsigned int x, unsigned int y) const
 		return CColor(0, 0, 0, 0);
 	}
 
-	if(x > m_width) return CColor(0, 0, 0, 0);
-	if(y > m_height) return CColor(0, 0, 0, 0);
-
-	uint8* pixelPtr = (m_pixels + (GetPitch() * y) + (GetPixelSize() * x));
-	switch(m_bpp)
-	{
-	case 8:
-		return CColor(pixelPtr[0], 0, 0, 0);
-		break;
-	case 24:
-		return CColor(pixelPtr[0], pixelPtr[1], pixelPtr[2], 0);
-		break;
-	case 32:
-		return CColor(pixelPtr[0], pixelPtr[1], pixelPtr[2], pixelPtr[3]);
-		break;
-	default:
-		throw std::runtime_error("Unknown bit depth.");
-		break;
-	}
+	return CBitmapView(*this).GetPixel(x, y);
 }
 
 void CBitmap::SetPixel(unsigned int x, unsigned int y, const CColor& color)
@@ -113,30 +104,7 @@ void CBitmap::SetPixel(unsigned int x, unsigned int y, const CColor& color)
 		return;
 	}
 
-	if(x > m_width) return;
-	if(y > m_height) return;
-
-	uint8* pixelPtr = (m_pixels + (GetPitch() * y) + (GetPixelSize() * x));
-	switch(m_bpp)
-	{
-	case 8:
-		pixelPtr[0] = color.r;
-		break;
-	case 24:
-		pixelPtr[0] = color.r;
-		pixelPtr[1] = color.g;
-		pixelPtr[2] = color.b;
-		break;
-	case 32:
-		pixelPtr[0] = color.r;
-		pixelPtr[1] = color.g;
-		pixelPtr[2] = color.b;
-		pixelPtr[3] = color.a;
-		break;
-	default:
-		throw std::runtime_error("Unknown bit depth.");
-		break;
-	}
+	CBitmapView(*this).SetPixel(x, y, color);
 }
 
 unsigned int CBitmap::GetWidth() const
@@ -213,17 +181,8 @@ void CBitmap::Blit(const CBitmap& Src, unsigned int nLeft, unsigned int nTop)
 CBitmap CBitmap::AddAlphaChannel(uint8 alphaValue) const
 {
 	assert(m_bpp == 24);
-	CBitmap result(m_width, m_height, 32);
-
-	uint32 pixelCount = m_width * m_height;
-	for(uint32 i = 0; i < pixelCount; i++)
-	{
-		result.m_pixels[(i * 4) + 0] = m_pixels[(i * 3) + 0];
-		result.m_pixels[(i * 4) + 1] = m_pixels[(i * 3) + 1];
-		result.m_pixels[(i * 4) + 2] = m_pixels[(i * 3) + 2];
-		result.m_pixels[(i * 4) + 3] = alphaValue;
-	}
-
+	CBitmap result(m_width, m_height, 32, m_allocator);
+	PixelConvert::RGB24ToRGBA32(result.m_pixels, m_pixels, static_cast<size_t>(m_width) * m_height, alphaValue);
 	return result;
 }
 
@@ -231,37 +190,73 @@ CBitmap CBitmap::Resize(unsigned int newWidth, unsigned int newHeight) const
 {
 	if(IsEmpty()) return CBitmap();
 
-	CBitmap result(newWidth, newHeight, m_bpp);
+	CBitmap result(newWidth, newHeight, m_bpp, m_allocator);
 
 	unsigned int srcPitch = GetPitch();
 	unsigned int dstPitch = result.GetPitch();
 	unsigned int pixelSize = GetPixelSize();
 
+	//Source offsets are the same for every row
+	std::vector<unsigned int> sampleOffsets(newWidth);
+	for(unsigned int x = 0; x < newWidth; x++)
+	{
+		sampleOffsets[x] = static_cast<unsigned int>((static_cast<uint64>(x) * m_width) / newWidth) * pixelSize;
+	}
+
 	auto dstPtr = result.m_pixels;
+	unsigned int prevSampleY = ~0U;
 	for(unsigned int y = 0; y < newHeight; y++)
 	{
-		unsigned int sampleY = (y * m_height) / newHeight;
-		for(unsigned int x = 0; x < newWidth; x++)
+		unsigned int sampleY = static_cast<unsigned int>((static_cast<uint64>(y) * m_height) / newHeight);
+		if(sampleY == prevSampleY)
 		{
-			unsigned int sampleX = (x * m_width) / newWidth;
-
-			for(unsigned int i = 0; i < pixelSize; i++)
+			memcpy(dstPtr, dstPtr - dstPitch, dstPitch);
+		}
+		else
+		{
+			const uint8* srcPtr = m_pixels + (sampleY * srcPitch);
+			switch(pixelSize)
 			{
-				uint8 pixelSrc = m_pixels[(sampleX * pixelSize) + (sampleY * srcPitch) + i];
-				dstPtr[(x * pixelSize) + i] = pixelSrc;
+			case 4:
+				for(unsigned int x = 0; x < newWidth; x++)
+				{
+					memcpy(dstPtr + (x * 4), srcPtr + sampleOffsets[x], 4);
+				}
+				break;
+			default:
+				for(unsigned int x = 0; x < newWidth; x++)
+				{
+					memcpy(dstPtr + (x * pixelSize), srcPtr + sampleOffsets[x], pixelSize);
+				}
+				break;
 			}
 		}
+		prevSampleY = sampleY;
 		dstPtr += dstPitch;
 	}
 
 	return result;
 }
 
+CBitmap CBitmap::Resize(unsigned int newWidth, unsigned int newHeight, RESIZE_FILTER filter, CThreadPool* threadPool) const
+{
+	if(filter == RESIZE_FILTER_NEAREST)
+	{
+		return Resize(newWidth, newHeight);
+	}
+
+	if(IsEmpty()) return CBitmap();
+
+	CBitmap result(newWidth, newHeight, m_bpp, m_allocator);
+	CBitmapResampler::Resample(*this, result, filter, threadPool);
+	return result;
+}
+
 CBitmap CBitmap::ResizeCanvas(unsigned int newWidth, unsigned int newHeight) const
 {
 	if(IsEmpty()) return CBitmap();
 
-	CBitmap result(newWidth, newHeight, m_bpp);
+	CBitmap result(newWidth, newHeight, m_bpp, m_allocator);
 
 	unsigned int srcPitch = GetPitch();
 	unsigned int dstPitch = result.GetPitch();
@@ -284,21 +279,88 @@ CBitmap CBitmap::FlipVertical() const
 {
 	if(IsEmpty()) return CBitmap();
 
-	CBitmap result(m_width, m_height, m_bpp);
+	return CBitmapView(*this).FlipVertical().ToBitmap(m_allocator);
+}
+
+void CBitmap::AddAlphaChannelInPlace(uint8 alphaValue)
+{
+	assert(m_bpp == 24);
+	if(IsEmpty()) return;
+
+	size_t pixelCount = static_cast<size_t>(m_width) * m_height;
+	if(m_capacity < (pixelCount * 4))
+	{
+		(*this) = AddAlphaChannel(alphaValue);
+		return;
+	}
+
+	//Expand from the end so that source pixels aren't overwritten before being read
+	for(size_t i = pixelCount; i != 0; i--)
+	{
+		size_t index = i - 1;
+		m_pixels[(index * 4) + 3] = alphaValue;
+		m_pixels[(index * 4) + 2] = m_pixels[(index * 3) + 2];
+		m_pixels[(index * 4) + 1] = m_pixels[(index * 3) + 1];
+		m_pixels[(index * 4) + 0] = m_pixels[(index * 3) + 0];
+	}
+	m_bpp = 32;
+}
+
+void CBitmap::ResizeCanvasInPlace(unsigned int newWidth, unsigned int newHeight)
+{
+	if(IsEmpty()) return;
 
 	unsigned int srcPitch = GetPitch();
-	unsigned int dstPitch = result.GetPitch();
+	unsigned int dstPitch = (((newWidth * m_bpp) + 7) / 8);
+	size_t newSize = static_cast<size_t>(dstPitch) * newHeight;
+	if(m_capacity < newSize)
+	{
+		(*this) = ResizeCanvas(newWidth, newHeight);
+		return;
+	}
 
-	auto srcPtr = m_pixels + srcPitch * (m_height - 1);
-	auto dstPtr = result.m_pixels;
-	for(unsigned int y = 0; y < m_height; y++)
+	unsigned int copyPitch = std::min<unsigned int>(srcPitch, dstPitch);
+	unsigned int copyHeight = std::min<unsigned int>(newHeight, m_height);
+	if(dstPitch <= srcPitch)
 	{
-		memcpy(dstPtr, srcPtr, dstPitch);
-		srcPtr -= srcPitch;
-		dstPtr += dstPitch;
+		for(unsigned int y = 0; y < copyHeight; y++)
+		{
+			memmove(m_pixels + (y * dstPitch), m_pixels + (y * srcPitch), copyPitch);
+		}
+	}
+	else
+	{
+		//Rows move forward, start from the last one
+		for(unsigned int y = copyHeight; y != 0; y--)
+		{
+			uint8* dstPtr = m_pixels + ((y - 1) * dstPitch);
+			memmove(dstPtr, m_pixels + ((y - 1) * srcPitch), copyPitch);
+			memset(dstPtr + copyPitch, 0, dstPitch - copyPitch);
+		}
+	}
+	if(newHeight > copyHeight)
+	{
+		memset(m_pixels + (copyHeight * dstPitch), 0, (newHeight - copyHeight) * dstPitch);
 	}
 
-	return result;
+	m_width = newWidth;
+	m_height = newHeight;
+}
+
+void CBitmap::FlipVerticalInPlace()
+{
+	if(IsEmpty()) return;
+
+	unsigned int pitch = GetPitch();
+	std::vector<uint8> row(pitch);
+	for(unsigned int y = 0; y < (m_height / 2); y++)
+	{
+		uint8* topPtr = m_pixels + (y * pitch);
+		uint8* bottomPtr = m_pixels + ((m_height - 1 - y) * pitch);
+		memcpy(row.data(), topPtr, pitch);
+		memcpy(topPtr, bottomPtr, pitch);
+		memcpy(bottomPtr, row.data(), pitch);
+	}
 }
 
 void CBitmap::DrawLine(int x1, int y1, int x2, int y2, const CColor& color)
@@ -320,6 +382,29 @@ void CBitmap::DrawLine(int x1, int y1, int x2, int y2, const CColor& color)
 
 	if((dx == 0) && (dy == 0)) return;
 
+	auto pixels = reinterpret_cast<uint32*>(m_pixels);
+
+	//Axis aligned lines are clipped once and filled directly
+	if(dy == 0)
+	{
+		int left = std::max(std::min(x1, x2), 0);
+		int right = std::min(std::max(x1, x2), static_cast<int>(m_width) - 1);
+		auto row = pixels + (y1 * m_width);
+		std::fill(row + left, row + right + 1, convertedColor);
+		return;
+	}
+
+	if(dx == 0)
+	{
+		int top = std::max(std::min(y1, y2), 0);
+		int bottom = std::min(std::max(y1, y2), static_cast<int>(m_height) - 1);
+		for(int y = top; y <= bottom; y++)
+		{
+			pixels[x1 + (y * m_width)] = convertedColor;
+		}
+		return;
+	}
+
 	float error = 0;
 
 	if(abs(dy) < abs(dx))
@@ -331,15 +416,15 @@ void CBitmap::DrawLine(int x1, int y1, int x2, int y2, const CColor& color)
 			std::swap(y1, y2);
 			dy = -dy;
 		}
+		//Nothing can be drawn once we're past the right edge or moving away from the bitmap vertically
+		int endX = std::min(x2, static_cast<int>(m_width) - 1);
 		int y = y1;
-		for(int x = x1; x <= x2; x++)
+		for(int x = x1; x <= endX; x++)
 		{
-			if(
-				(x >= 0) && (x < static_cast<int>(m_width)) &&
-				(y >= 0) && (y < static_cast<int>(m_height))
-				)
+			if((dy >= 0) ? (y >= static_cast<int>(m_height)) : (y < 0)) break;
+			if((x >= 0) && (y >= 0) && (y < static_cast<int>(m_height)))
 			{
-				reinterpret_cast<uint32*>(m_pixels)[x + (y * m_width)] = convertedColor;
+				pixels[x + (y * m_width)] = convertedColor;
 			}
 			error = error + deltaErr;
 			if(error >= 0.5)
@@ -358,15 +443,14 @@ void CBitmap::DrawLine(int x1, int y1, int x2, int y2, const CColor& color)
 			std::swap(y1, y2);
 			dx = -dx;
 		}
+		int endY = std::min(y2, static_cast<int>(m_height) - 1);
 		int x = x1;
-		for(int y = y1; y <= y2; y++)
+		for(int y = y1; y <= endY; y++)
 		{
-			if(
-				(x >= 0) && (x < static_cast<int>(m_width)) &&
-				(y >= 0) && (y < static_cast<int>(m_height))
-				)
+			if((dx >= 0) ? (x >= static_cast<int>(m_width)) : (x < 0)) break;
+			if((y >= 0) && (x >= 0) && (x < static_cast<int>(m_width)))
 			{
-				reinterpret_cast<uint32*>(m_pixels)[x + (y * m_width)] = convertedColor;
+				pixels[x + (y * m_width)] = convertedColor;
 			}
 			error = error + deltaErr;
 			if(error >= 0.5)
@@ -380,9 +464,15 @@ void CBitmap::DrawLine(int x1, int y1, int x2, int y2, const CColor& color)
 
 void CBitmap::CopyFrom(const CBitmap& src)
 {
-	if(src.GetPixelsSize() != GetPixelsSize())
+	//Current buffer is reused if it's large enough and comes from the same allocator
+	if((src.GetPixelsSize() > m_capacity) || (src.m_allocator != m_allocator) || src.IsEmpty())
 	{
-		m_pixels = reinterpret_cast<uint8*>(realloc(m_pixels, src.GetPixelsSize()));
+		ReleaseBuffer();
+		m_allocator = src.m_allocator;
+		if(!src.IsEmpty())
+		{
+			AllocateBuffer(src.GetPixelsSize());
+		}
 	}
 
 	m_width		= src.GetWidth();
@@ -397,8 +487,40 @@ void CBitmap::CopyFrom(const CBitmap& src)
 
 void CBitmap::MoveFrom(CBitmap&& src)
 {
-	std::swap(src.m_pixels, m_pixels);
-	std::swap(src.m_width,  m_width);
-	std::swap(src.m_height, m_height);
-	std::swap(src.m_bpp,    m_bpp);
+	std::swap(src.m_pixels,    m_pixels);
+	std::swap(src.m_width,     m_width);
+	std::swap(src.m_height,    m_height);
+	std::swap(src.m_bpp,       m_bpp);
+	std::swap(src.m_capacity,  m_capacity);
+	std::swap(src.m_allocator, m_allocator);
+}
+
+void CBitmap::AllocateBuffer(size_t size)
+{
+	assert(m_pixels == nullptr);
+	if(m_allocator)
+	{
+		m_pixels = m_allocator->Allocate(size);
+	}
+	else
+	{
+		m_pixels = reinterpret_cast<uint8*>(Memory::CAllocationTracker::GetInstance().Allocate(
+			Memory::CAllocationTracker::SUBSYSTEM_BITMAP, FRAMEWORK_ALLOCATION_SITE, size));
+	}
+	m_capacity = size;
+}
+
+void CBitmap::ReleaseBuffer()
+{
+	if(m_pixels == nullptr) return;
+	if(m_allocator)
+	{
+		m_allocator->Release(m_pixels, m_capacity);
+	}
+	else
+	{
+		Memory::CAllocationTracker::GetInstance().Free(m_pixels);
+	}
+	m_pixels = nullptr;
+	m_capacity = 0;
 }
@@ -0,0 +1,242 @@
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include "bitmap/BitmapBlitter.h"
+#include "ParallelFor.h"
+#include "SimdDefs.h"
+
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+#include <emmintrin.h>
+#elif defined(FRAMEWORK_SIMD_USE_NEON)
+#include <arm_neon.h>
+#endif
+
+using namespace Framework;
+
+namespace
+{
+	//Exact rounded division by 255 for values up to 255 * 255
+	uint32 Div255(uint32 value)
+	{
+		value += 0x80;
+		return (value + (value >> 8)) >> 8;
+	}
+
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+	__m128i Div255(__m128i value)
+	{
+		value = _mm_add_epi16(value, _mm_set1_epi16(0x80));
+		return _mm_srli_epi16(_mm_add_epi16(value, _mm_srli_epi16(value, 8)), 8);
+	}
+
+	//Replicates the alpha of both 16-bit pixels in all their lanes
+	__m128i BroadcastAlpha(__m128i pixels)
+	{
+		return _mm_shufflehi_epi16(_mm_shufflelo_epi16(pixels, 0xFF), 0xFF);
+	}
+#elif defined(FRAMEWORK_SIMD_USE_NEON)
+	uint8x8_t Div255(uint16x8_t value)
+	{
+		value = vaddq_u16(value, vdupq_n_u16(0x80));
+		return vshrn_n_u16(vsraq_n_u16(value, value, 8), 8);
+	}
+#endif
+}
+
+void CBitmapBlitter::Blit(const CBitmapView& dst, const OperationArray& operations, CThreadPool* threadPool)
+{
+	if(dst.IsEmpty()) return;
+
+	unsigned int bpp = dst.GetBitsPerPixel();
+	if((bpp % 8) != 0)
+	{
+		throw std::runtime_error("Unsupported bit depth.");
+	}
+
+	//Clip everything against the destination once, bands only need to clip vertically
+	std::vector<CLIPPEDOPERATION> clippedOperations;
+	clippedOperations.reserve(operations.size());
+	for(const auto& operation : operations)
+	{
+		const auto& src = operation.source;
+		if(src.IsEmpty()) continue;
+		if(src.GetBitsPerPixel() != bpp)
+		{
+			throw std::runtime_error("Bit depths don't match.");
+		}
+		if((operation.blendMode != BLEND_MODE_COPY) && (bpp != 32))
+		{
+			throw std::runtime_error("Alpha blending requires 32 bits per pixel bitmaps.");
+		}
+
+		int64 left = std::max<int64>(operation.x, 0);
+		int64 top = std::max<int64>(operation.y, 0);
+		int64 right = std::min<int64>(static_cast<int64>(operation.x) + src.GetWidth(), dst.GetWidth());
+		int64 bottom = std::min<int64>(static_cast<int64>(operation.y) + src.GetHeight(), dst.GetHeight());
+		if((left >= right) || (top >= bottom)) continue;
+
+		CLIPPEDOPERATION clippedOperation;
+		clippedOperation.operation = &operation;
+		clippedOperation.srcX = static_cast<unsigned int>(left - operation.x);
+		clippedOperation.srcY = static_cast<unsigned int>(top - operation.y);
+		clippedOperation.dstX = static_cast<unsigned int>(left);
+		clippedOperation.dstY = static_cast<unsigned int>(top);
+		clippedOperation.width = static_cast<unsigned int>(right - left);
+		clippedOperation.height = static_cast<unsigned int>(bottom - top);
+		clippedOperations.push_back(clippedOperation);
+	}
+
+	if(clippedOperations.empty()) return;
+
+	unsigned int pixelSize = dst.GetPixelSize();
+	unsigned int dstHeight = dst.GetHeight();
+
+	ParallelFor(threadPool, 0, dstHeight,
+		[&] (size_t bandBegin, size_t bandEnd)
+		{
+			unsigned int y = static_cast<unsigned int>(bandBegin);
+			unsigned int endY = static_cast<unsigned int>(bandEnd);
+			for(const auto& clippedOperation : clippedOperations)
+			{
+				unsigned int firstRow = std::max(clippedOperation.dstY, y);
+				unsigned int lastRow = std::min(clippedOperation.dstY + clippedOperation.height, endY);
+				if(firstRow >= lastRow) continue;
+
+				const auto& src = clippedOperation.operation->source;
+				auto blendMode = clippedOperation.operation->blendMode;
+				size_t srcOffset = static_cast<size_t>(clippedOperation.srcX) * pixelSize;
+				size_t dstOffset = static_cast<size_t>(clippedOperation.dstX) * pixelSize;
+				unsigned int width = clippedOperation.width;
+				for(unsigned int row = firstRow; row < lastRow; row++)
+				{
+					uint8* dstRow = dst.GetRow(row) + dstOffset;
+					const uint8* srcRow = src.GetRow(row - clippedOperation.dstY + clippedOperation.srcY) + srcOffset;
+					switch(blendMode)
+					{
+					case BLEND_MODE_COPY:
+						memcpy(dstRow, srcRow, width * pixelSize);
+						break;
+					case BLEND_MODE_ALPHA:
+						BlendRowAlpha(dstRow, srcRow, width);
+						break;
+					case BLEND_MODE_PREMULTIPLIED_ALPHA:
+						BlendRowPremultipliedAlpha(dstRow, srcRow, width);
+						break;
+					}
+				}
+			}
+		},
+		ROWS_PER_TASK);
+}
+
+//dst = (src * srcAlpha + dst * (255 - srcAlpha)) / 255, alpha = srcAlpha + dstAlpha * (255 - srcAlpha) / 255
+void CBitmapBlitter::BlendRowAlpha(uint8* dst, const uint8* src, unsigned int count)
+{
+	unsigned int i = 0;
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i alphaMask = _mm_set1_epi32(0xFF000000);
+	const __m128i alphaLanes = _mm_set_epi16(0xFF, 0, 0, 0, 0xFF, 0, 0, 0);
+	const __m128i full = _mm_set1_epi16(0xFF);
+	for(; (i + 4) <= count; i += 4)
+	{
+		__m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 4));
+		__m128i alpha = _mm_and_si128(s, alphaMask);
+		if(_mm_movemask_epi8(_mm_cmpeq_epi8(alpha, alphaMask)) == 0xFFFF)
+		{
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4), s);
+			continue;
+		}
+		if(_mm_movemask_epi8(_mm_cmpeq_epi8(alpha, zero)) == 0xFFFF)
+		{
+			continue;
+		}
+		__m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i * 4));
+		__m128i sLo = _mm_unpacklo_epi8(s, zero);
+		__m128i sHi = _mm_unpackhi_epi8(s, zero);
+		__m128i dLo = _mm_unpacklo_epi8(d, zero);
+		__m128i dHi = _mm_unpackhi_epi8(d, zero);
+		__m128i aLo = BroadcastAlpha(sLo);
+		__m128i aHi = BroadcastAlpha(sHi);
+		//Source alpha is kept as is by weighting it with 255
+		__m128i resultLo = _mm_add_epi16(_mm_mullo_epi16(sLo, _mm_or_si128(aLo, alphaLanes)), _mm_mullo_epi16(dLo, _mm_sub_epi16(full, aLo)));
+		__m128i resultHi = _mm_add_epi16(_mm_mullo_epi16(sHi, _mm_or_si128(aHi, alphaLanes)), _mm_mullo_epi16(dHi, _mm_sub_epi16(full, aHi)));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4), _mm_packus_epi16(Div255(resultLo), Div255(resultHi)));
+	}
+#elif defined(FRAMEWORK_SIMD_USE_NEON)
+	for(; (i + 8) <= count; i += 8)
+	{
+		uint8x8x4_t s = vld4_u8(src + i * 4);
+		uint8x8x4_t d = vld4_u8(dst + i * 4);
+		uint8x8_t alpha = s.val[3];
+		uint8x8_t invAlpha = vmvn_u8(alpha);
+		uint8x8x4_t result;
+		for(unsigned int c = 0; c < 3; c++)
+		{
+			result.val[c] = Div255(vmlal_u8(vmull_u8(s.val[c], alpha), d.val[c], invAlpha));
+		}
+		result.val[3] = vadd_u8(alpha, Div255(vmull_u8(d.val[3], invAlpha)));
+		vst4_u8(dst + i * 4, result);
+	}
+#endif
+	for(; i < count; i++)
+	{
+		const uint8* s = src + i * 4;
+		uint8* d = dst + i * 4;
+		uint32 alpha = s[3];
+		uint32 invAlpha = 0xFF - alpha;
+		d[0] = static_cast<uint8>(Div255(s[0] * alpha + d[0] * invAlpha));
+		d[1] = static_cast<uint8>(Div255(s[1] * alpha + d[1] * invAlpha));
+		d[2] = static_cast<uint8>(Div255(s[2] * alpha + d[2] * invAlpha));
+		d[3] = static_cast<uint8>(alpha + Div255(d[3] * invAlpha));
+	}
+}
+
+//dst = src + dst * (255 - srcAlpha) / 255, saturated in case the source isn't properly premultiplied
+void CBitmapBlitter::BlendRowPremultipliedAlpha(uint8* dst, const uint8* src, unsigned int count)
+{
+	unsigned int i = 0;
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i alphaMask = _mm_set1_epi32(0xFF000000);
+	const __m128i full = _mm_set1_epi16(0xFF);
+	for(; (i + 4) <= count; i += 4)
+	{
+		__m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 4));
+		if(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(s, alphaMask), alphaMask)) == 0xFFFF)
+		{
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4), s);
+			continue;
+		}
+		__m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i * 4));
+		__m128i invAlphaLo = _mm_sub_epi16(full, BroadcastAlpha(_mm_unpacklo_epi8(s, zero)));
+		__m128i invAlphaHi = _mm_sub_epi16(full, BroadcastAlpha(_mm_unpackhi_epi8(s, zero)));
+		__m128i dLo = Div255(_mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), invAlphaLo));
+		__m128i dHi = Div255(_mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), invAlphaHi));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4), _mm_adds_epu8(s, _mm_packus_epi16(dLo, dHi)));
+	}
+#elif defined(FRAMEWORK_SIMD_USE_NEON)
+	for(; (i + 8) <= count; i += 8)
+	{
+		uint8x8x4_t s = vld4_u8(src + i * 4);
+		uint8x8x4_t d = vld4_u8(dst + i * 4);
+		uint8x8_t invAlpha = vmvn_u8(s.val[3]);
+		uint8x8x4_t result;
+		for(unsigned int c = 0; c < 4; c++)
+		{
+			result.val[c] = vqadd_u8(s.val[c], Div255(vmull_u8(d.val[c], invAlpha)));
+		}
+		vst4_u8(dst + i * 4, result);
+	}
+#endif
+	for(; i < count; i++)
+	{
+		const uint8* s = src + i * 4;
+		uint8* d = dst + i * 4;
+		uint32 invAlpha = 0xFF - s[3];
+		for(unsigned int c = 0; c < 4; c++)
+		{
+			d[c] = static_cast<uint8>(std::min<uint32>(s[c] + Div255(d[c] * invAlpha), 0xFF));
+		}
+	}
+}
@@ -0,0 +1,63 @@
+#include "bitmap/BitmapPool.h"
+#include "memory/AllocationTracker.h"
+
+using namespace Framework;
+
+CBitmapPool::CBitmapPool(size_t maxCachedSize)
+: m_maxCachedSize(maxCachedSize)
+{
+
+}
+
+CBitmapPool::~CBitmapPool()
+{
+	Clear();
+}
+
+uint8* CBitmapPool::Allocate(size_t size)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto bufferIterator = m_buffers.find(size);
+		if(bufferIterator != std::end(m_buffers))
+		{
+			uint8* buffer = bufferIterator->second;
+			m_buffers.erase(bufferIterator);
+			m_cachedSize -= size;
+			return buffer;
+		}
+	}
+	return reinterpret_cast<uint8*>(Memory::CAllocationTracker::GetInstance().Allocate(
+		Memory::CAllocationTracker::SUBSYSTEM_BITMAP, FRAMEWORK_ALLOCATION_SITE, size));
+}
+
+void CBitmapPool::Release(uint8* buffer, size_t size)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if((m_cachedSize + size) <= m_maxCachedSize)
+		{
+			m_buffers.insert(std::make_pair(size, buffer));
+			m_cachedSize += size;
+			return;
+		}
+	}
+	Memory::CAllocationTracker::GetInstance().Free(buffer);
+}
+
+size_t CBitmapPool::GetCachedSize() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_cachedSize;
+}
+
+void CBitmapPool::Clear()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for(const auto& bufferPair : m_buffers)
+	{
+		Memory::CAllocationTracker::GetInstance().Free(bufferPair.second);
+	}
+	m_buffers.clear();
+	m_cachedSize = 0;
+}
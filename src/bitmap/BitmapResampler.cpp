@@ -0,0 +1,357 @@
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+#include "bitmap/BitmapResampler.h"
+#include "TaskGroup.h"
+#include "SimdDefs.h"
+
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+#include <emmintrin.h>
+#elif defined(FRAMEWORK_SIMD_USE_NEON)
+#include <arm_neon.h>
+#endif
+
+using namespace Framework;
+
+namespace
+{
+	const double g_pi = 3.14159265358979323846;
+
+	double Sinc(double x)
+	{
+		if(x == 0.0) return 1.0;
+		x *= g_pi;
+		return sin(x) / x;
+	}
+
+	double BilinearFilter(double x)
+	{
+		x = fabs(x);
+		return (x < 1.0) ? (1.0 - x) : 0.0;
+	}
+
+	//Keys' cubic convolution with a = -0.5
+	double BicubicFilter(double x)
+	{
+		const double a = -0.5;
+		x = fabs(x);
+		if(x < 1.0) return ((a + 2.0) * x - (a + 3.0)) * x * x + 1.0;
+		if(x < 2.0) return (((x - 5.0) * x + 8.0) * x - 4.0) * a;
+		return 0.0;
+	}
+
+	double LanczosFilter(double x)
+	{
+		return ((x > -3.0) && (x < 3.0)) ? (Sinc(x) * Sinc(x / 3.0)) : 0.0;
+	}
+
+	//Modified Bessel function of the first kind, order 0
+	double BesselI0(double x)
+	{
+		double sum = 1.0;
+		double term = 1.0;
+		for(unsigned int k = 1; k < 32; k++)
+		{
+			term *= (x * x) / (4.0 * k * k);
+			sum += term;
+			if(term < (sum * 1e-12)) break;
+		}
+		return sum;
+	}
+
+	//Sinc with a Kaiser window (beta = 4) over 3 lobes
+	double KaiserFilter(double x)
+	{
+		const double width = 3.0;
+		const double beta = 4.0;
+		if((x <= -width) || (x >= width)) return 0.0;
+		double ratio = x / width;
+		return Sinc(x) * BesselI0(beta * sqrt(1.0 - ratio * ratio)) / BesselI0(beta);
+	}
+
+	uint8 ClampSample(int32 value)
+	{
+		return static_cast<uint8>(std::min<int32>(std::max<int32>(value, 0), 255));
+	}
+
+	//Packs two coefficients for multiply-add instructions
+	int32 MakeCoefPair(int16 coef0, int16 coef1)
+	{
+		return static_cast<int32>(static_cast<uint16>(coef0) | (static_cast<uint32>(static_cast<uint16>(coef1)) << 16));
+	}
+}
+
+void CBitmapResampler::Resample(const CBitmap& src, CBitmap& dst, CBitmap::RESIZE_FILTER filter, CThreadPool* threadPool)
+{
+	if((src.GetBitsPerPixel() % 8) != 0)
+	{
+		throw std::runtime_error("Unsupported bit depth.");
+	}
+	if(src.GetBitsPerPixel() != dst.GetBitsPerPixel())
+	{
+		throw std::runtime_error("Bit depths don't match.");
+	}
+	if(src.IsEmpty() || dst.IsEmpty())
+	{
+		return;
+	}
+
+	unsigned int pixelSize = src.GetPixelSize();
+	unsigned int srcHeight = src.GetHeight();
+	unsigned int dstWidth = dst.GetWidth();
+	unsigned int dstHeight = dst.GetHeight();
+
+	auto horizontalCoefs = ComputeCoefs(src.GetWidth(), dstWidth, filter);
+	auto verticalCoefs = ComputeCoefs(srcHeight, dstHeight, filter);
+
+	CTaskGroup taskGroup(threadPool);
+
+	//Only the source rows used by the vertical pass need to be filtered horizontally
+	unsigned int firstSrcRow = verticalCoefs.bounds[0];
+	unsigned int lastSrcRow = verticalCoefs.bounds[(dstHeight - 1) * 2] + verticalCoefs.bounds[(dstHeight - 1) * 2 + 1];
+	unsigned int intermediatePitch = dstWidth * pixelSize;
+	std::vector<uint8> intermediate(static_cast<size_t>(intermediatePitch) * srcHeight);
+	for(unsigned int y = firstSrcRow; y < lastSrcRow; y += ROWS_PER_TASK)
+	{
+		unsigned int endY = std::min<unsigned int>(y + ROWS_PER_TASK, lastSrcRow);
+		taskGroup.Run(
+			[&, y, endY] ()
+			{
+				for(unsigned int row = y; row < endY; row++)
+				{
+					ResampleRowHorizontal(intermediate.data() + row * intermediatePitch,
+						src.GetPixels() + row * src.GetPitch(), dstWidth, pixelSize, horizontalCoefs);
+				}
+			});
+	}
+	taskGroup.Wait();
+
+	for(unsigned int y = 0; y < dstHeight; y += ROWS_PER_TASK)
+	{
+		unsigned int endY = std::min<unsigned int>(y + ROWS_PER_TASK, dstHeight);
+		taskGroup.Run(
+			[&, y, endY] ()
+			{
+				std::vector<const uint8*> rows(verticalCoefs.coefCount);
+				for(unsigned int row = y; row < endY; row++)
+				{
+					unsigned int first = verticalCoefs.bounds[row * 2 + 0];
+					unsigned int count = verticalCoefs.bounds[row * 2 + 1];
+					for(unsigned int i = 0; i < count; i++)
+					{
+						rows[i] = intermediate.data() + (first + i) * intermediatePitch;
+					}
+					ResampleRowVertical(dst.GetPixels() + row * dst.GetPitch(), rows.data(), count,
+						intermediatePitch, verticalCoefs.coefs.data() + row * verticalCoefs.coefCount);
+				}
+			});
+	}
+	taskGroup.Wait();
+}
+
+CBitmapResampler::FILTERCOEFS CBitmapResampler::ComputeCoefs(unsigned int srcSize, unsigned int dstSize, CBitmap::RESIZE_FILTER filter)
+{
+	double (*filterFunction)(double) = nullptr;
+	double support = 0;
+	switch(filter)
+	{
+	case CBitmap::RESIZE_FILTER_BILINEAR:
+		filterFunction = &BilinearFilter;
+		support = 1.0;
+		break;
+	case CBitmap::RESIZE_FILTER_BICUBIC:
+		filterFunction = &BicubicFilter;
+		support = 2.0;
+		break;
+	case CBitmap::RESIZE_FILTER_LANCZOS:
+		filterFunction = &LanczosFilter;
+		support = 3.0;
+		break;
+	case CBitmap::RESIZE_FILTER_KAISER:
+		filterFunction = &KaiserFilter;
+		support = 3.0;
+		break;
+	default:
+		throw std::runtime_error("Unsupported resize filter.");
+		break;
+	}
+
+	//Filter is stretched when downscaling to cover all source samples
+	double scale = static_cast<double>(srcSize) / static_cast<double>(dstSize);
+	double filterScale = std::max(scale, 1.0);
+	support *= filterScale;
+
+	FILTERCOEFS result;
+	result.coefCount = std::min<unsigned int>(static_cast<unsigned int>(ceil(support)) * 2 + 1, srcSize);
+	result.bounds.resize(dstSize * 2);
+	result.coefs.resize(dstSize * result.coefCount);
+
+	std::vector<double> weights(result.coefCount);
+	for(unsigned int i = 0; i < dstSize; i++)
+	{
+		double center = (i + 0.5) * scale;
+		int first = std::max(static_cast<int>(floor(center - support + 0.5)), 0);
+		int last = std::min(static_cast<int>(floor(center + support + 0.5)), static_cast<int>(srcSize));
+		last = std::min(last, first + static_cast<int>(result.coefCount));
+		unsigned int count = std::max(last - first, 1);
+
+		double sum = 0;
+		for(unsigned int j = 0; j < count; j++)
+		{
+			double weight = filterFunction((first + j - center + 0.5) / filterScale);
+			weights[j] = weight;
+			sum += weight;
+		}
+
+		int16* coefs = result.coefs.data() + i * result.coefCount;
+		for(unsigned int j = 0; j < count; j++)
+		{
+			double weight = (sum != 0) ? (weights[j] / sum) : ((j == 0) ? 1.0 : 0.0);
+			coefs[j] = static_cast<int16>(lround(weight * (1 << COEF_BITS)));
+		}
+
+		result.bounds[i * 2 + 0] = first;
+		result.bounds[i * 2 + 1] = count;
+	}
+
+	return result;
+}
+
+void CBitmapResampler::ResampleRowHorizontal(uint8* dst, const uint8* src, unsigned int dstWidth, unsigned int pixelSize, const FILTERCOEFS& filterCoefs)
+{
+	const int32 rounding = 1 << (COEF_BITS - 1);
+#if !defined(FRAMEWORK_SIMD_USE_SCALAR)
+	if(pixelSize == 4)
+	{
+		for(unsigned int x = 0; x < dstWidth; x++)
+		{
+			const uint8* samples = src + filterCoefs.bounds[x * 2 + 0] * 4;
+			unsigned int count = filterCoefs.bounds[x * 2 + 1];
+			const int16* coefs = filterCoefs.coefs.data() + x * filterCoefs.coefCount;
+			unsigned int i = 0;
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+			const __m128i zero = _mm_setzero_si128();
+			__m128i sum = _mm_set1_epi32(rounding);
+			for(; (i + 2) <= count; i += 2)
+			{
+				//Interleave the channels of both pixels to multiply-add them in one go
+				__m128i pixels = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(samples + i * 4));
+				pixels = _mm_unpacklo_epi8(_mm_unpacklo_epi8(pixels, _mm_srli_si128(pixels, 4)), zero);
+				sum = _mm_add_epi32(sum, _mm_madd_epi16(pixels, _mm_set1_epi32(MakeCoefPair(coefs[i], coefs[i + 1]))));
+			}
+			if(i < count)
+			{
+				int32 pixel = 0;
+				memcpy(&pixel, samples + i * 4, 4);
+				__m128i pixels = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(pixel), zero), zero);
+				sum = _mm_add_epi32(sum, _mm_madd_epi16(pixels, _mm_set1_epi32(MakeCoefPair(coefs[i], 0))));
+			}
+			sum = _mm_srai_epi32(sum, COEF_BITS);
+			sum = _mm_packs_epi32(sum, sum);
+			int32 result = _mm_cvtsi128_si32(_mm_packus_epi16(sum, sum));
+			memcpy(dst + x * 4, &result, 4);
+#elif defined(FRAMEWORK_SIMD_USE_NEON)
+			int32x4_t sum = vdupq_n_s32(0);
+			for(; (i + 2) <= count; i += 2)
+			{
+				int16x8_t pixels = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(samples + i * 4)));
+				sum = vmlal_n_s16(sum, vget_low_s16(pixels), coefs[i]);
+				sum = vmlal_n_s16(sum, vget_high_s16(pixels), coefs[i + 1]);
+			}
+			if(i < count)
+			{
+				uint32 pixel = 0;
+				memcpy(&pixel, samples + i * 4, 4);
+				int16x8_t pixels = vreinterpretq_s16_u16(vmovl_u8(vreinterpret_u8_u32(vdup_n_u32(pixel))));
+				sum = vmlal_n_s16(sum, vget_low_s16(pixels), coefs[i]);
+			}
+			uint16x4_t result16 = vqrshrun_n_s32(sum, COEF_BITS);
+			uint8x8_t result8 = vqmovn_u16(vcombine_u16(result16, result16));
+			vst1_lane_u32(reinterpret_cast<uint32*>(dst + x * 4), vreinterpret_u32_u8(result8), 0);
+#endif
+		}
+		return;
+	}
+#endif
+	for(unsigned int x = 0; x < dstWidth; x++)
+	{
+		const uint8* samples = src + filterCoefs.bounds[x * 2 + 0] * pixelSize;
+		unsigned int count = filterCoefs.bounds[x * 2 + 1];
+		const int16* coefs = filterCoefs.coefs.data() + x * filterCoefs.coefCount;
+		for(unsigned int c = 0; c < pixelSize; c++)
+		{
+			int32 sum = rounding;
+			for(unsigned int i = 0; i < count; i++)
+			{
+				sum += samples[i * pixelSize + c] * coefs[i];
+			}
+			dst[x * pixelSize + c] = ClampSample(sum >> COEF_BITS);
+		}
+	}
+}
+
+void CBitmapResampler::ResampleRowVertical(uint8* dst, const uint8* const* rows, unsigned int count, unsigned int size, const int16* coefs)
+{
+	const int32 rounding = 1 << (COEF_BITS - 1);
+	unsigned int x = 0;
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+	const __m128i zero = _mm_setzero_si128();
+	for(; (x + 16) <= size; x += 16)
+	{
+		__m128i sums[4];
+		for(auto& sum : sums) sum = _mm_set1_epi32(rounding);
+		unsigned int i = 0;
+		for(; i < count; i += 2)
+		{
+			//Samples from two rows are interleaved, the second one has a weight of 0 for odd counts
+			__m128i row0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[i] + x));
+			__m128i row1 = zero;
+			int16 coef1 = 0;
+			if((i + 1) < count)
+			{
+				row1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[i + 1] + x));
+				coef1 = coefs[i + 1];
+			}
+			__m128i coefPairs = _mm_set1_epi32(MakeCoefPair(coefs[i], coef1));
+			__m128i lo = _mm_unpacklo_epi8(row0, row1);
+			__m128i hi = _mm_unpackhi_epi8(row0, row1);
+			sums[0] = _mm_add_epi32(sums[0], _mm_madd_epi16(_mm_unpacklo_epi8(lo, zero), coefPairs));
+			sums[1] = _mm_add_epi32(sums[1], _mm_madd_epi16(_mm_unpackhi_epi8(lo, zero), coefPairs));
+			sums[2] = _mm_add_epi32(sums[2], _mm_madd_epi16(_mm_unpacklo_epi8(hi, zero), coefPairs));
+			sums[3] = _mm_add_epi32(sums[3], _mm_madd_epi16(_mm_unpackhi_epi8(hi, zero), coefPairs));
+		}
+		for(auto& sum : sums) sum = _mm_srai_epi32(sum, COEF_BITS);
+		__m128i result = _mm_packus_epi16(_mm_packs_epi32(sums[0], sums[1]), _mm_packs_epi32(sums[2], sums[3]));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x), result);
+	}
+#elif defined(FRAMEWORK_SIMD_USE_NEON)
+	for(; (x + 16) <= size; x += 16)
+	{
+		int32x4_t sums[4];
+		for(auto& sum : sums) sum = vdupq_n_s32(0);
+		for(unsigned int i = 0; i < count; i++)
+		{
+			uint8x16_t row = vld1q_u8(rows[i] + x);
+			int16x8_t lo = vreinterpretq_s16_u16(vmovl_u8(vget_low_u8(row)));
+			int16x8_t hi = vreinterpretq_s16_u16(vmovl_u8(vget_high_u8(row)));
+			sums[0] = vmlal_n_s16(sums[0], vget_low_s16(lo), coefs[i]);
+			sums[1] = vmlal_n_s16(sums[1], vget_high_s16(lo), coefs[i]);
+			sums[2] = vmlal_n_s16(sums[2], vget_low_s16(hi), coefs[i]);
+			sums[3] = vmlal_n_s16(sums[3], vget_high_s16(hi), coefs[i]);
+		}
+		uint16x8_t lo = vcombine_u16(vqrshrun_n_s32(sums[0], COEF_BITS), vqrshrun_n_s32(sums[1], COEF_BITS));
+		uint16x8_t hi = vcombine_u16(vqrshrun_n_s32(sums[2], COEF_BITS), vqrshrun_n_s32(sums[3], COEF_BITS));
+		vst1q_u8(dst + x, vcombine_u8(vqmovn_u16(lo), vqmovn_u16(hi)));
+	}
+#endif
+	for(; x < size; x++)
+	{
+		int32 sum = rounding;
+		for(unsigned int i = 0; i < count; i++)
+		{
+			sum += rows[i][x] * coefs[i];
+		}
+		dst[x] = ClampSample(sum >> COEF_BITS);
+	}
+}
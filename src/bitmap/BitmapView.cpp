@@ -0,0 +1,156 @@
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+#include "bitmap/BitmapView.h"
+
+using namespace Framework;
+
+CBitmapView::CBitmapView(uint8* pixels, unsigned int width, unsigned int height, unsigned int bpp, ptrdiff_t pitch)
+: m_pixels(pixels)
+, m_width(width)
+, m_height(height)
+, m_bpp(bpp)
+, m_pitch(pitch)
+{
+
+}
+
+CBitmapView::CBitmapView(const CBitmap& bitmap)
+{
+	if(bitmap.IsEmpty()) return;
+	m_pixels = bitmap.GetPixels();
+	m_width = bitmap.GetWidth();
+	m_height = bitmap.GetHeight();
+	m_bpp = bitmap.GetBitsPerPixel();
+	m_pitch = bitmap.GetPitch();
+}
+
+bool CBitmapView::IsEmpty() const
+{
+	return m_pixels == nullptr;
+}
+
+unsigned int CBitmapView::GetWidth() const
+{
+	return m_width;
+}
+
+unsigned int CBitmapView::GetHeight() const
+{
+	return m_height;
+}
+
+unsigned int CBitmapView::GetBitsPerPixel() const
+{
+	return m_bpp;
+}
+
+unsigned int CBitmapView::GetPixelSize() const
+{
+	return (m_bpp + 7) / 8;
+}
+
+ptrdiff_t CBitmapView::GetPitch() const
+{
+	return m_pitch;
+}
+
+uint8* CBitmapView::GetPixels() const
+{
+	return m_pixels;
+}
+
+uint8* CBitmapView::GetRow(unsigned int y) const
+{
+	assert(y < m_height);
+	return m_pixels + (m_pitch * static_cast<ptrdiff_t>(y));
+}
+
+CColor CBitmapView::GetPixel(unsigned int x, unsigned int y) const
+{
+	if(m_pixels == nullptr) return CColor(0, 0, 0, 0);
+	if(x >= m_width) return CColor(0, 0, 0, 0);
+	if(y >= m_height) return CColor(0, 0, 0, 0);
+
+	const uint8* pixelPtr = GetRow(y) + (GetPixelSize() * x);
+	switch(m_bpp)
+	{
+	case 8:
+		return CColor(pixelPtr[0], 0, 0, 0);
+		break;
+	case 24:
+		return CColor(pixelPtr[0], pixelPtr[1], pixelPtr[2], 0);
+		break;
+	case 32:
+		return CColor(pixelPtr[0], pixelPtr[1], pixelPtr[2], pixelPtr[3]);
+		break;
+	default:
+		throw std::runtime_error("Unknown bit depth.");
+		break;
+	}
+}
+
+void CBitmapView::SetPixel(unsigned int x, unsigned int y, const CColor& color) const
+{
+	if(m_pixels == nullptr) return;
+	if(x >= m_width) return;
+	if(y >= m_height) return;
+
+	uint8* pixelPtr = GetRow(y) + (GetPixelSize() * x);
+	switch(m_bpp)
+	{
+	case 8:
+		pixelPtr[0] = color.r;
+		break;
+	case 24:
+		pixelPtr[0] = color.r;
+		pixelPtr[1] = color.g;
+		pixelPtr[2] = color.b;
+		break;
+	case 32:
+		pixelPtr[0] = color.r;
+		pixelPtr[1] = color.g;
+		pixelPtr[2] = color.b;
+		pixelPtr[3] = color.a;
+		break;
+	default:
+		throw std::runtime_error("Unknown bit depth.");
+		break;
+	}
+}
+
+CBitmapView CBitmapView::Crop(unsigned int x, unsigned int y, unsigned int width, unsigned int height) const
+{
+	if((m_bpp % 8) != 0)
+	{
+		throw std::runtime_error("Unsupported bit depth.");
+	}
+	if((x > m_width) || (width > (m_width - x)) || (y > m_height) || (height > (m_height - y)))
+	{
+		throw std::runtime_error("Crop rectangle is out of bounds.");
+	}
+	if((width == 0) || (height == 0))
+	{
+		return CBitmapView();
+	}
+	return CBitmapView(GetRow(y) + (GetPixelSize() * x), width, height, m_bpp, m_pitch);
+}
+
+CBitmapView CBitmapView::FlipVertical() const
+{
+	if(IsEmpty()) return CBitmapView();
+	return CBitmapView(GetRow(m_height - 1), m_width, m_height, m_bpp, -m_pitch);
+}
+
+CBitmap CBitmapView::ToBitmap(CBitmapAllocator* allocator) const
+{
+	if(IsEmpty()) return CBitmap();
+
+	CBitmap result(m_width, m_height, m_bpp, allocator);
+	size_t rowSize = result.GetPitch();
+	for(unsigned int y = 0; y < m_height; y++)
+	{
+		memcpy(result.GetPixels() + (y * rowSize), GetRow(y), rowSize);
+	}
+	return result;
+}
@@ -0,0 +1,33 @@
+#include <cstring>
+#include <stdexcept>
+#include "bitmap/ImageProbe.h"
+#include "bitmap/BMP.h"
+#include "bitmap/JPEG.h"
+#include "bitmap/PNG.h"
+#include "bitmap/TGA.h"
+
+using namespace Framework;
+
+CImageProbe::INFO CImageProbe::ProbeImage(CStream& stream)
+{
+	uint64 position = stream.Tell();
+	uint8 signature[4] = {};
+	stream.Read(signature, sizeof(signature));
+	stream.Seek(position, STREAM_SEEK_SET);
+
+	static const uint8 pngSignature[4] = { 0x89, 'P', 'N', 'G' };
+	if(!memcmp(signature, pngSignature, sizeof(pngSignature)))
+	{
+		return CPNG::ReadInfo(stream);
+	}
+	if((signature[0] == 0xFF) && (signature[1] == 0xD8))
+	{
+		return CJPEG::ReadInfo(stream);
+	}
+	if((signature[0] == 'B') && (signature[1] == 'M'))
+	{
+		return CBMP::ReadInfo(stream);
+	}
+	//TGA files have no signature, the header needs to be validated
+	return CTGA::ReadInfo(stream);
+}
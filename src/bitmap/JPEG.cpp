@@ -2,17 +2,32 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <algorithm>
+#include <stdexcept>
 #include "bitmap/JPEG.h"
 #include "idct/TrivialC.h"
 #include "idct/IEEE1180.h"
+#include "idct/FixedPoint.h"
+#include "idct/Reduced.h"
 #include "StreamBitStream.h"
+#include "PtrStream.h"
+#include "TaskGroup.h"
 #include "PtrMacro.h"
+#include "SimdDefs.h"
+#include "Trace.h"
 #include "maybe_unused.h"
 
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+#include <emmintrin.h>
+#elif defined(FRAMEWORK_SIMD_USE_NEON)
+#include <arm_neon.h>
+#endif
+
 using namespace Framework;
 
 //IDCT::CInterface*	CJPEG::m_pIDCT = IDCT::CTrivialC::GetInstance();
-IDCT::CInterface*	CJPEG::m_pIDCT = IDCT::CIEEE1180::GetInstance();
+//IDCT::CInterface*	CJPEG::m_pIDCT = IDCT::CIEEE1180::GetInstance();
+IDCT::CInterface*	CJPEG::m_pIDCT = IDCT::CFixedPoint::GetInstance();
 
 unsigned char		CJPEG::m_nZigZag[64] =
 {
@@ -26,7 +41,178 @@ unsigned char		CJPEG::m_nZigZag[64] =
 	53, 60, 61, 54, 47, 55, 62, 63
 };
 
-CJPEG::CJPEG(CStream& pStream)
+namespace
+{
+	//YCbCr to RGB coefficients (JFIF), scaled by 2^COLOR_BITS
+	//R = Y                    + 1.402  *(Cr-128)
+	//G = Y - 0.34414*(Cb-128) - 0.71414*(Cr-128)
+	//B = Y + 1.772  *(Cb-128)
+	enum
+	{
+		COLOR_BITS = 14,
+		COLOR_CR_R = 22970,
+		COLOR_CB_G = -5638,
+		COLOR_CR_G = -11700,
+		COLOR_CB_B = 29032,
+	};
+
+	uint8 ClampSample(int32 value)
+	{
+		return static_cast<uint8>(std::min<int32>(std::max<int32>(value, 0), 255));
+	}
+
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+
+	//Converts IDCT output to unsigned samples (level shift and clamp)
+	void StoreSamples8(const int16* input, uint8* output)
+	{
+		__m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input));
+		values = _mm_packs_epi16(values, values);
+		values = _mm_xor_si128(values, _mm_set1_epi8(static_cast<char>(0x80)));
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(output), values);
+	}
+
+	__m128i LoadChroma8(const uint8* input, unsigned int shiftX)
+	{
+		if(shiftX == 0)
+		{
+			return _mm_loadl_epi64(reinterpret_cast<const __m128i*>(input));
+		}
+		int32 values = 0;
+		memcpy(&values, input, 4);
+		__m128i result = _mm_cvtsi32_si128(values);
+		return _mm_unpacklo_epi8(result, result);
+	}
+
+	__m128i ComputeChannel(__m128i y, __m128i cbcrLo, __m128i cbcrHi, int16 cbCoef, int16 crCoef)
+	{
+		const __m128i coefs = _mm_set_epi16(crCoef, cbCoef, crCoef, cbCoef, crCoef, cbCoef, crCoef, cbCoef);
+		const __m128i rounding = _mm_set1_epi32(1 << (COLOR_BITS - 1));
+		__m128i lo = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(cbcrLo, coefs), rounding), COLOR_BITS);
+		__m128i hi = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(cbcrHi, coefs), rounding), COLOR_BITS);
+		__m128i result = _mm_add_epi16(y, _mm_packs_epi32(lo, hi));
+		return _mm_packus_epi16(result, result);
+	}
+
+	void ConvertPixels8(uint32* output, const uint8* y, const uint8* cb, const uint8* cr, unsigned int shiftX)
+	{
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i bias = _mm_set1_epi16(128);
+		__m128i y16 = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(y)), zero);
+		__m128i cb16 = _mm_sub_epi16(_mm_unpacklo_epi8(LoadChroma8(cb, shiftX), zero), bias);
+		__m128i cr16 = _mm_sub_epi16(_mm_unpacklo_epi8(LoadChroma8(cr, shiftX), zero), bias);
+		__m128i cbcrLo = _mm_unpacklo_epi16(cb16, cr16);
+		__m128i cbcrHi = _mm_unpackhi_epi16(cb16, cr16);
+
+		__m128i r = ComputeChannel(y16, cbcrLo, cbcrHi, 0, COLOR_CR_R);
+		__m128i g = ComputeChannel(y16, cbcrLo, cbcrHi, COLOR_CB_G, COLOR_CR_G);
+		__m128i b = ComputeChannel(y16, cbcrLo, cbcrHi, COLOR_CB_B, 0);
+
+		__m128i rg = _mm_unpacklo_epi8(r, g);
+		__m128i ba = _mm_unpacklo_epi8(b, _mm_set1_epi8(static_cast<char>(0xFF)));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(output + 0), _mm_unpacklo_epi16(rg, ba));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(output + 4), _mm_unpackhi_epi16(rg, ba));
+	}
+
+#elif defined(FRAMEWORK_SIMD_USE_NEON)
+
+	void StoreSamples8(const int16* input, uint8* output)
+	{
+		int8x8_t values = vqmovn_s16(vld1q_s16(input));
+		vst1_u8(output, veor_u8(vreinterpret_u8_s8(values), vdup_n_u8(0x80)));
+	}
+
+	uint8x8_t LoadChroma8(const uint8* input, unsigned int shiftX)
+	{
+		if(shiftX == 0)
+		{
+			return vld1_u8(input);
+		}
+		uint32 values = 0;
+		memcpy(&values, input, 4);
+		uint8x8_t result = vreinterpret_u8_u32(vdup_n_u32(values));
+		return vzip_u8(result, result).val[0];
+	}
+
+	uint8x8_t ComputeChannel(int16x8_t y, int16x8_t cb, int16x8_t cr, int16 cbCoef, int16 crCoef)
+	{
+		int32x4_t lo = vmull_n_s16(vget_low_s16(cb), cbCoef);
+		int32x4_t hi = vmull_n_s16(vget_high_s16(cb), cbCoef);
+		lo = vmlal_n_s16(lo, vget_low_s16(cr), crCoef);
+		hi = vmlal_n_s16(hi, vget_high_s16(cr), crCoef);
+		int16x8_t delta = vcombine_s16(vrshrn_n_s32(lo, COLOR_BITS), vrshrn_n_s32(hi, COLOR_BITS));
+		return vqmovun_s16(vaddq_s16(y, delta));
+	}
+
+	void ConvertPixels8(uint32* output, const uint8* y, const uint8* cb, const uint8* cr, unsigned int shiftX)
+	{
+		const int16x8_t bias = vdupq_n_s16(128);
+		int16x8_t y16 = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(y)));
+		int16x8_t cb16 = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(LoadChroma8(cb, shiftX))), bias);
+		int16x8_t cr16 = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(LoadChroma8(cr, shiftX))), bias);
+
+		uint8x8x4_t rgba;
+		rgba.val[0] = ComputeChannel(y16, cb16, cr16, 0, COLOR_CR_R);
+		rgba.val[1] = ComputeChannel(y16, cb16, cr16, COLOR_CB_G, COLOR_CR_G);
+		rgba.val[2] = ComputeChannel(y16, cb16, cr16, COLOR_CB_B, 0);
+		rgba.val[3] = vdup_n_u8(0xFF);
+		vst4_u8(reinterpret_cast<uint8*>(output), rgba);
+	}
+
+#else
+
+	void StoreSamples8(const int16* input, uint8* output)
+	{
+		for(unsigned int i = 0; i < 8; i++)
+		{
+			output[i] = ClampSample(input[i] + 128);
+		}
+	}
+
+	//Same arithmetic as the SIMD versions, results are bit exact
+	void ConvertPixels8(uint32* output, const uint8* y, const uint8* cb, const uint8* cr, unsigned int shiftX)
+	{
+		const int32 rounding = 1 << (COLOR_BITS - 1);
+		for(unsigned int i = 0; i < 8; i++)
+		{
+			int32 nY = y[i];
+			int32 nCb = cb[i >> shiftX] - 128;
+			int32 nCr = cr[i >> shiftX] - 128;
+			uint32 nR = ClampSample(nY + ((COLOR_CR_R * nCr + rounding) >> COLOR_BITS));
+			uint32 nG = ClampSample(nY + ((COLOR_CB_G * nCb + COLOR_CR_G * nCr + rounding) >> COLOR_BITS));
+			uint32 nB = ClampSample(nY + ((COLOR_CB_B * nCb + rounding) >> COLOR_BITS));
+			output[i] = 0xFF000000 | (nB << 16) | (nG << 8) | (nR);
+		}
+	}
+
+#endif
+
+	void StoreSamples(const int16* input, uint8* output, unsigned int count)
+	{
+		if(count == 8)
+		{
+			StoreSamples8(input, output);
+			return;
+		}
+		for(unsigned int i = 0; i < count; i++)
+		{
+			output[i] = ClampSample(input[i] + 128);
+		}
+	}
+
+	//Converts a row of pixels, chroma is upsampled horizontally by replication if shiftX is 1
+	void ConvertRow(uint32* output, const uint8* y, const uint8* cb, const uint8* cr, unsigned int count, unsigned int shiftX)
+	{
+		for(unsigned int i = 0; i < count; i += 8)
+		{
+			ConvertPixels8(output + i, y + i, cb + (i >> shiftX), cr + (i >> shiftX), shiftX);
+		}
+	}
+}
+
+CJPEG::CJPEG(CStream& pStream, CThreadPool* threadPool, unsigned int scaleDenominator)
+: m_nScaleDenominator(scaleDenominator)
+, m_threadPool(threadPool)
 {
 	m_stream = new CStreamBitStream(pStream);
 
@@ -95,62 +281,273 @@ CJPEG::~CJPEG()
 
 CBitmap CJPEG::ReadBitmap(CStream& stream)
 {
-	CJPEG JPEG(stream);
+	CJPEG JPEG(stream, nullptr);
 	return JPEG.Process();
 }
 
-/////////////////////////////////////////////////////
-//Huffman -----------------------------------------//
-/////////////////////////////////////////////////////
+CBitmap CJPEG::ReadBitmap(CStream& stream, CThreadPool& threadPool)
+{
+	CJPEG JPEG(stream, &threadPool);
+	return JPEG.Process();
+}
+
+CBitmap CJPEG::ReadBitmap(CStream& stream, unsigned int scaleDenominator)
+{
+	switch(scaleDenominator)
+	{
+	case 1:
+	case 2:
+	case 4:
+	case 8:
+		break;
+	default:
+		throw std::runtime_error("Unsupported JPEG scale denominator.");
+	}
+	CJPEG JPEG(stream, nullptr, scaleDenominator);
+	return JPEG.Process();
+}
 
-uint8 CJPEG::HuffGetBit()
+void CJPEG::ReadBitmap(CStream& stream, CBitmapSink& sink)
 {
-	if(m_stream->IsOnByteBoundary())
+	CJPEG JPEG(stream, nullptr);
+	JPEG.m_sink = &sink;
+	JPEG.Process();
+}
+
+void CJPEG::ReadBitmap(CStream& stream, CBitmapSink& sink, CThreadPool& threadPool)
+{
+	CJPEG JPEG(stream, &threadPool);
+	JPEG.m_sink = &sink;
+	JPEG.Process();
+}
+
+//Returns the next marker that has a segment (or EOI), 0 if the end of the stream is reached
+static uint8 ReadSegmentMarker(CStream& stream)
+{
+	while(!stream.IsEOF())
 	{
-		if(m_nHuffSkipNext)
+		if(stream.Read8() != 0xFF) continue;
+
+		//Markers can be preceded by any number of fill bytes
+		uint8 nMarker = 0xFF;
+		while((nMarker == 0xFF) && !stream.IsEOF())
 		{
-			FRAMEWORK_MAYBE_UNUSED uint8 markerEscape = m_stream->GetBits_MSBF(8);
-			assert(markerEscape == 0x00);
-			m_nHuffSkipNext = false;
+			nMarker = stream.Read8();
 		}
-		if(m_stream->PeekBits_MSBF(8) == 0xFF)
+
+		//Standalone markers (TEM, RSTn) and stuffed bytes
+		if((nMarker == 0x00) || (nMarker == 0x01) || ((nMarker >= 0xD0) && (nMarker <= 0xD7))) continue;
+
+		return nMarker;
+	}
+	return 0;
+}
+
+//Finds the JPEG stream described by the second IFD (IFD1) of an EXIF segment. Offsets are relative
+//to the TIFF header that follows the identifier and everything is checked against the segment size.
+static bool FindExifThumbnail(const uint8* pData, size_t nSize, size_t& nThumbnailOffset, size_t& nThumbnailSize)
+{
+	static const uint8 exifId[6] = {'E', 'x', 'i', 'f', 0, 0};
+	if((nSize < sizeof(exifId) + 8) || memcmp(pData, exifId, sizeof(exifId))) return false;
+
+	const uint8* pTiff = pData + sizeof(exifId);
+	size_t nTiffSize = nSize - sizeof(exifId);
+	bool isBigEndian = false;
+	if((pTiff[0] == 'M') && (pTiff[1] == 'M'))
+	{
+		isBigEndian = true;
+	}
+	else if((pTiff[0] != 'I') || (pTiff[1] != 'I'))
+	{
+		return false;
+	}
+
+	auto read16 = [&](size_t nOffset) -> uint32 {
+		return isBigEndian ? ((pTiff[nOffset] << 8) | pTiff[nOffset + 1]) : (pTiff[nOffset] | (pTiff[nOffset + 1] << 8));
+	};
+	auto read32 = [&](size_t nOffset) -> uint32 {
+		return isBigEndian ? ((read16(nOffset) << 16) | read16(nOffset + 2)) : (read16(nOffset) | (read16(nOffset + 2) << 16));
+	};
+
+	if(read16(2) != 42) return false;
+
+	//IFD0 describes the main image, its link leads to IFD1
+	size_t nIfdOffset = read32(4);
+	if(nIfdOffset > nTiffSize - 2) return false;
+	size_t nLinkOffset = nIfdOffset + 2 + (read16(nIfdOffset) * 12);
+	if(nLinkOffset > nTiffSize - 4) return false;
+	nIfdOffset = read32(nLinkOffset);
+	if((nIfdOffset == 0) || (nIfdOffset > nTiffSize - 2)) return false;
+	unsigned int nEntryCount = read16(nIfdOffset);
+	if(nIfdOffset + 2 + (nEntryCount * 12) > nTiffSize) return false;
+
+	size_t nJpegOffset = 0;
+	size_t nJpegSize = 0;
+	for(unsigned int i = 0; i < nEntryCount; i++)
+	{
+		size_t nEntry = nIfdOffset + 2 + (i * 12);
+		uint32 nTag = read16(nEntry);
+		//Values are either SHORT (3) or LONG (4) and are stored in the entry itself
+		uint32 nValue = (read16(nEntry + 2) == 3) ? read16(nEntry + 8) : read32(nEntry + 8);
+		switch(nTag)
 		{
-			//Trap if we want to...
-			FRAMEWORK_MAYBE_UNUSED uint16 fullMarker = m_stream->PeekBits_MSBF(16);
-			assert(fullMarker == 0xFF00);
-			m_nHuffSkipNext = true;
+		case 0x0201:
+			//JPEGInterchangeFormat
+			nJpegOffset = nValue;
+			break;
+		case 0x0202:
+			//JPEGInterchangeFormatLength
+			nJpegSize = nValue;
+			break;
 		}
 	}
 
-	return (uint8)m_stream->GetBits_MSBF(1);
+	if((nJpegSize == 0) || (nJpegOffset > nTiffSize) || (nJpegSize > nTiffSize - nJpegOffset)) return false;
+	nThumbnailOffset = sizeof(exifId) + nJpegOffset;
+	nThumbnailSize = nJpegSize;
+	return true;
 }
 
-uint8 CJPEG::HuffDecode(HUFFMANTABLE* t)
+CImageProbe::INFO CJPEG::ReadInfo(CStream& stream)
 {
-	int i = 0;
-	int16 nCode = HuffGetBit();
+	if(stream.Read16_MSBF() != 0xFFD8)
+	{
+		throw std::runtime_error("Invalid JPEG file.");
+	}
+
+	while(uint8 nMarker = ReadSegmentMarker(stream))
+	{
+
+		if((nMarker == 0xD9) || (nMarker == 0xDA))
+		{
+			break;
+		}
+
+		uint16 nLength = stream.Read16_MSBF();
+		if(nLength < 2)
+		{
+			break;
+		}
+
+		//SOFn, except DHT, JPG and DAC which share the range
+		bool isFrameHeader = (nMarker >= 0xC0) && (nMarker <= 0xCF) && (nMarker != 0xC4) && (nMarker != 0xC8) && (nMarker != 0xCC);
+		if(isFrameHeader)
+		{
+			uint8 nPrecision = stream.Read8();
+			CImageProbe::INFO info;
+			info.format = CImageProbe::FORMAT_JPEG;
+			info.height = stream.Read16_MSBF();
+			info.width = stream.Read16_MSBF();
+			info.bitsPerPixel = nPrecision * stream.Read8();
+			return info;
+		}
+
+		stream.Seek(nLength - 2, STREAM_SEEK_CUR);
+	}
+
+	throw std::runtime_error("JPEG frame header not found.");
+}
 
-	while(nCode > t->nMax[i])
+CBitmap CJPEG::ExtractThumbnail(CStream& stream)
+{
+	if(stream.Read16_MSBF() != 0xFFD8)
+	{
+		throw std::runtime_error("Invalid JPEG file.");
+	}
+
+	//EXIF data comes first, no need to go past the frame header
+	while(uint8 nMarker = ReadSegmentMarker(stream))
 	{
-		nCode <<= 1;
-		nCode |= HuffGetBit();
-		i++;
+		if((nMarker == 0xD9) || (nMarker == 0xDA) || ((nMarker >= 0xC0) && (nMarker <= 0xCF) && (nMarker != 0xC4)))
+		{
+			break;
+		}
+
+		uint16 nLength = stream.Read16_MSBF();
+		if(nLength < 2)
+		{
+			break;
+		}
+
+		if(nMarker != 0xE1)
+		{
+			stream.Seek(nLength - 2, STREAM_SEEK_CUR);
+			continue;
+		}
+
+		//APP1 also holds XMP data, only the EXIF one has the thumbnail
+		std::vector<uint8> segment(nLength - 2);
+		if(stream.Read(segment.data(), segment.size()) != segment.size())
+		{
+			break;
+		}
+		if((segment.size() < 4) || memcmp(segment.data(), "Exif", 4))
+		{
+			continue;
+		}
+
+		size_t nThumbnailOffset = 0;
+		size_t nThumbnailSize = 0;
+		if(!FindExifThumbnail(segment.data(), segment.size(), nThumbnailOffset, nThumbnailSize))
+		{
+			break;
+		}
+		CPtrStream thumbnailStream(segment.data() + nThumbnailOffset, nThumbnailSize);
+		return ReadBitmap(thumbnailStream);
 	}
 
-	int j = nCode - t->nMin[i];
-	return t->pV[i][j];
+	return CBitmap();
 }
 
-uint32 CJPEG::HuffReceive(unsigned int nBits)
+/////////////////////////////////////////////////////
+//Huffman -----------------------------------------//
+/////////////////////////////////////////////////////
+
+uint8 CJPEG::HuffDecodeValue(CStreamBitStream& stream, const HUFFMANTABLE* t, int32& nValue)
 {
-	uint32 nTemp = 0;
-	for(unsigned int i = 0; i < nBits; i++)
+	//Byte stuffing was already removed from segments and they are padded, so
+	//enough bits for the longest code and its extra bits are always available
+	uint32 nBits = 0;
+	if(!stream.TryPeekBitsInline_MSBF(32, nBits))
 	{
-		nTemp <<= 1;
-		nTemp |= HuffGetBit();
+		throw CBitStream::CBitStreamException();
 	}
 
-	return nTemp;
+	unsigned int nLength = 0;
+	uint8 nSymbol = 0;
+	uint16 nLookup = t->nLookup[nBits >> (32 - HUFF_LOOKAHEAD_BITS)];
+	if(nLookup != 0)
+	{
+		nLength = nLookup >> 8;
+		nSymbol = nLookup & 0xFF;
+	}
+	else
+	{
+		//Code is longer than the lookahead
+		nLength = HUFF_LOOKAHEAD_BITS + 1;
+		int32 nCode = nBits >> (32 - nLength);
+		while(nCode > t->nMax[nLength - 1])
+		{
+			nLength++;
+			if(nLength > 16)
+			{
+				throw std::runtime_error("Invalid Huffman code.");
+			}
+			nCode = nBits >> (32 - nLength);
+		}
+		nSymbol = t->pV[nLength - 1][nCode - t->nMin[nLength - 1]];
+	}
+
+	//Low 4 bits of the symbol is the size of the value that follows
+	unsigned int nSize = nSymbol & 0x0F;
+	nValue = 0;
+	if(nSize != 0)
+	{
+		uint32 nExtraBits = (nBits << nLength) >> (32 - nSize);
+		nValue = static_cast<int32>(HuffExtend(nExtraBits, nSize));
+	}
+	stream.AdvanceInline(nLength + nSize);
+	return nSymbol;
 }
 
 uint32 CJPEG::HuffExtend(uint32 nV, unsigned int nBits)
@@ -225,8 +622,8 @@ uint16* CJPEG::HuffGenerateCodeTable(uint8* pS)
 
 void CJPEG::HuffGenerateMinMaxTables(HUFFMANTABLE* t)
 {
-	memset(t->nMin, 0xFF, 16 * 2); 
-	memset(t->nMax, 0xFF, 16 * 2);
+	memset(t->nMin, 0xFF, sizeof(t->nMin));
+	memset(t->nMax, 0xFF, sizeof(t->nMax));
 
 	int j = 0;
 	for(int i = 0; i < 16; i++)
@@ -255,156 +652,167 @@ void CJPEG::HuffGenerateSubTables(HUFFMANTABLE* t)
 
 	t->nCodeTable = HuffGenerateCodeTable(pDCS);
 	HuffGenerateMinMaxTables(t);
+	HuffGenerateLookupTable(t, pDCS);
 	free(pDCS);
 }
 
-unsigned int CJPEG::DecodeMCU(int nComponent, uint8* pData, int* nDC)
+void CJPEG::HuffGenerateLookupTable(HUFFMANTABLE* t, const uint8* pS)
 {
-	int16 nBlock[64], nTempBlock[64];
-	unsigned int i, t, s, r, z;
-	int nDiff;
+	memset(t->nLookup, 0, sizeof(t->nLookup));
 
-	i = 0;
-	while(m_Frame.pCompoment[nComponent].nC != m_Scan.pComponent[i].nCs)
+	unsigned int k = 0;
+	for(unsigned int i = 0; i < 16; i++)
 	{
-		i++;
+		unsigned int nLength = i + 1;
+		for(unsigned int j = 0; j < t->nL[i]; j++, k++)
+		{
+			assert(pS[k] == nLength);
+			if(nLength > HUFF_LOOKAHEAD_BITS) continue;
+			unsigned int nShift = HUFF_LOOKAHEAD_BITS - nLength;
+			unsigned int nFirst = t->nCodeTable[k] << nShift;
+			uint16 nEntry = static_cast<uint16>((nLength << 8) | t->pV[i][j]);
+			for(unsigned int n = 0; n < (1U << nShift); n++)
+			{
+				t->nLookup[nFirst + n] = nEntry;
+			}
+		}
 	}
+}
 
-	QUANTIZATIONTABLE* pQt	= &m_Qt[m_Frame.pCompoment[nComponent].nTq];
-	HUFFMANTABLE* pACHt		= &m_ACHt[m_Scan.pComponent[i].nTdTa & 0x0F];
-	HUFFMANTABLE* pDCHt		= &m_DCHt[(m_Scan.pComponent[i].nTdTa & 0xF0) >> 4];
-
-	memset(nBlock, 0, sizeof(int16) * 64);
+void CJPEG::DecodeMCU(CStreamBitStream& stream, const BLOCKDECODER& decoder, int16* pBlock, int* nDC)
+{
+	memset(pBlock, 0, sizeof(int16) * 64);
 
-	i = HuffDecode(pDCHt);
-	nDiff = HuffReceive(i);
-	nDiff = HuffExtend(nDiff, i);
+	int32 nDiff = 0;
+	HuffDecodeValue(stream, decoder.pDCHt, nDiff);
 
 	*nDC += nDiff;
-	nBlock[0] = *nDC;
+	pBlock[0] = static_cast<int16>(*nDC * decoder.pQ[0]);
 
-	for(i = 1; i < 64; i++)
+	for(unsigned int i = 1; i < 64; i++)
 	{
-		t = HuffDecode(pACHt);
-		s = t % 16;
-		r = t >> 4;
+		int32 nValue = 0;
+		uint8 t = HuffDecodeValue(stream, decoder.pACHt, nValue);
+		unsigned int s = t % 16;
+		unsigned int r = t >> 4;
 		if(s == 0)
 		{
 			if(r == 15)
 			{
 				i += 16 - 1;
+				continue;
 			}
 			else
 			{
 				break;
 			}
 		}
-		else
-		{
-			i += r;
-		}
-		z = HuffReceive(s);
-		z = HuffExtend(z, s);
+		i += r;
 		if(i < 0x40)
 		{
-			nBlock[i] = (signed)z;
+			//Dequantize and un-ZigZag
+			pBlock[m_nZigZag[i]] = static_cast<int16>(nValue * decoder.pQ[i]);
 		}
 		else
 		{
 			assert(0);
-			//nBlock[i] = 0;
 		}
 	}
+}
 
-	//Dequantize
-	for(i = 0; i < 64; i++)
-	{
-		nBlock[i] *= ((int8*)pQt->pQ)[i];
-	}
-
-	//Un-ZigZag
-	for(i = 0; i < 64; i++)
-	{
-		nTempBlock[m_nZigZag[i]] = nBlock[i];
-	}
-	memcpy(nBlock, nTempBlock, sizeof(short) * 64);
-	
-	m_pIDCT->Transform(nBlock, nTempBlock);
-
-	for(i = 0; i < 64; i++)
+void CJPEG::ReconstructMCUs(unsigned int nFirstMCU, unsigned int nMCUCount)
+{
+	int16 nSpatial[6 * 64];
+	uint8 nLuma[LUMA_PLANE_STRIDE * 16] = {};
+	uint8 nChroma[2 * 64] = {};
+	uint32 nPixels[16];
+	assert(m_nBlocksPerMCU <= 6);
+
+	unsigned int nWidth = m_output.GetWidth();
+	unsigned int nHeight = m_output.GetHeight();
+	unsigned int nBlockSize = m_nBlockSize;
+	unsigned int nBlockCoefs = nBlockSize * nBlockSize;
+	unsigned int nChromaCoefs = m_nChromaWidth * m_nChromaHeight;
+	unsigned int nLumaBlocks = m_nSampX * m_nSampY;
+	unsigned int nMCUWidth = nBlockSize * m_nSampX;
+	unsigned int nMCUHeight = nBlockSize * m_nSampY;
+	//Conversion works on groups of 8 pixels, planes are large enough to hold the excess
+	unsigned int nConvertWidth = (nMCUWidth + 7) & ~7;
+	//Chroma is never subsampled more than 2x in either direction
+	unsigned int nShiftX = (m_nChromaWidth == nMCUWidth) ? 0 : 1;
+	unsigned int nShiftY = (m_nChromaHeight == nMCUHeight) ? 0 : 1;
+
+	for(unsigned int nMCU = nFirstMCU; nMCU < (nFirstMCU + nMCUCount); nMCU++)
 	{
-		if(nTempBlock[i] > 127)
+		const int16* pCoefs = m_coefficients.data() + (nMCU * m_nMCUCoefs);
+		if(nBlockSize == 8)
 		{
-			nTempBlock[i] = 127;
+			m_pIDCT->TransformBlocks(pCoefs, nSpatial, m_nBlocksPerMCU);
 		}
-		if(nTempBlock[i] < -128)
+		else
 		{
-			nTempBlock[i] = -128;
+			for(unsigned int i = 0; i < nLumaBlocks; i++)
+			{
+				IDCT::CReduced::Transform(pCoefs + (i * nBlockCoefs), nSpatial + (i * nBlockCoefs), nBlockSize, nBlockSize);
+			}
+			for(unsigned int i = 0; i < 2; i++)
+			{
+				unsigned int nOffset = (nLumaBlocks * nBlockCoefs) + (i * nChromaCoefs);
+				if(nChromaCoefs == 64)
+				{
+					m_pIDCT->Transform(pCoefs + nOffset, nSpatial + nOffset);
+				}
+				else
+				{
+					IDCT::CReduced::Transform(pCoefs + nOffset, nSpatial + nOffset, m_nChromaWidth, m_nChromaHeight);
+				}
+			}
 		}
-		pData[i] = ((uint8)nTempBlock[i]) - 128;
-	}
-
-	return 1;
-}
-
-uint8 CJPEG::FixRange(double nNumber)
-{
-	if(nNumber < 0)
-	{
-		return 0x00;
-	}
-
-	if(nNumber > 255)
-	{
-		return 0xFF;
-	}
-
-	return (uint8)nNumber;
-}
-
-void CJPEG::Draw8x8Block(unsigned int nX, unsigned int nY, uint8 *pReMap, uint8* pY, uint8* pCr, uint8* pCb)
-{
-	uint32* pImage = reinterpret_cast<uint32*>(m_bitmap.GetPixels());
 
-	for(unsigned int y = 0; y < 8; y++)
-	{
-		for(unsigned int x = 0; x < 8; x++)
+		//Assemble luma blocks in a single plane
+		for(unsigned int i = 0; i < nLumaBlocks; i++)
 		{
-			double nYT  = pY[(y * 8) + x];
-			double nCrT = pCr[pReMap[(y * 8) + x]];
-			double nCbT = pCb[pReMap[(y * 8) + x]];
-			
-			//R = Y                    + 1.402  *(Cr-128)
-			//G = Y - 0.34414*(Cb-128) - 0.71414*(Cr-128)
-			//B = Y + 1.772  *(Cb-128)
-			
-			uint8 nR = FixRange(nYT +                           1.402   * (nCrT - 128));
-			uint8 nG = FixRange(nYT - 0.344114 * (nCbT - 128) - 0.71414 * (nCrT - 128));
-			uint8 nB = FixRange(nYT + 1.772    * (nCbT - 128));
-
-			unsigned int xofs = (nX + x);
-			unsigned int yofs = (nY + y);
-			if(xofs >= m_Frame.nCX) continue;
-			if(yofs >= m_Frame.nCY) continue;
+			uint8* pLuma = nLuma + ((i / m_nSampX) * nBlockSize * LUMA_PLANE_STRIDE) + ((i % m_nSampX) * nBlockSize);
+			for(unsigned int y = 0; y < nBlockSize; y++)
+			{
+				StoreSamples(nSpatial + (i * nBlockCoefs) + (y * nBlockSize), pLuma + (y * LUMA_PLANE_STRIDE), nBlockSize);
+			}
+		}
+		for(unsigned int i = 0; i < 2; i++)
+		{
+			const int16* pSpatial = nSpatial + (nLumaBlocks * nBlockCoefs) + (i * nChromaCoefs);
+			for(unsigned int y = 0; y < m_nChromaHeight; y++)
+			{
+				StoreSamples(pSpatial + (y * m_nChromaWidth), nChroma + (i * 64) + (y * 8), m_nChromaWidth);
+			}
+		}
 
-			pImage[(yofs * m_Frame.nCX) + xofs] = 0xFF000000 | (nB << 16) | (nG << 8) | (nR);
+		unsigned int nX = (nMCU % m_nMCUsPerLine) * nMCUWidth;
+		unsigned int nY = (nMCU / m_nMCUsPerLine) * nMCUHeight;
+		unsigned int nVisibleX = std::min<unsigned int>(nMCUWidth, nWidth - nX);
+		unsigned int nVisibleY = std::min<unsigned int>(nMCUHeight, nHeight - nY);
+		for(unsigned int y = 0; y < nVisibleY; y++)
+		{
+			const uint8* pY = nLuma + (y * LUMA_PLANE_STRIDE);
+			const uint8* pCb = nChroma + ((y >> nShiftY) * 8);
+			const uint8* pCr = pCb + 64;
+			uint32* pOutput = reinterpret_cast<uint32*>(m_output.GetRow(nY + y)) + nX;
+			if(nVisibleX == nConvertWidth)
+			{
+				ConvertRow(pOutput, pY, pCb, pCr, nConvertWidth, nShiftX);
+			}
+			else
+			{
+				ConvertRow(nPixels, pY, pCb, pCr, nConvertWidth, nShiftX);
+				memcpy(pOutput, nPixels, nVisibleX * sizeof(uint32));
+			}
 		}
 	}
 }
 
 unsigned int CJPEG::Decode()
 {
-	uint8 nY[256], nCb[64], nCr[64];
-	uint8 nReMap[256];
-	uint8 nTab1[64], nTab2[64], nTab3[64], nTab4[64];
-	uint8 nSampX, nBX;
-	uint8 nSampY, nBY;
-	unsigned int i, j;
-	unsigned int nCX, nCY;
-	int nYDC, nCrDC, nCbDC;
-
-	m_nHuffSkipNext = false;
-
+	FRAMEWORK_TRACE_SCOPE("JPEG::Decode");
 	//Validate some stuff
 	if(m_Frame.nType != 0xFFC0)
 	{
@@ -416,102 +824,196 @@ unsigned int CJPEG::Decode()
 	}
 	
 	//Y is always 0?
-	nSampX = m_Frame.pCompoment[0].nHV & 0x0F;
-	nSampY = m_Frame.pCompoment[0].nHV >> 4;
-	if(nSampX == 1 && nSampY == 2)
+	//Supports 4:4:4, 4:2:2, 4:4:0 and 4:2:0 (chroma components must not be scaled)
+	m_nSampX = m_Frame.pCompoment[0].nHV >> 4;
+	m_nSampY = m_Frame.pCompoment[0].nHV & 0x0F;
+	if(m_nSampX != 1 && m_nSampX != 2)
+	{
+		return JERROR_UNSUPPORTED_YSCALING;
+	}
+	if(m_nSampY != 1 && m_nSampY != 2)
 	{
 		return JERROR_UNSUPPORTED_YSCALING;
 	}
-	if(nSampX == 2 && nSampY == 1)
+	if(m_Frame.pCompoment[1].nHV != 0x11 || m_Frame.pCompoment[2].nHV != 0x11)
 	{
 		return JERROR_UNSUPPORTED_YSCALING;
 	}
 
-	m_bitmap = CBitmap(m_Frame.nCX, m_Frame.nCY, 32);
+	//Scaled output is rounded up like the MCU grid
+	unsigned int nScale = m_nScaleDenominator;
+	unsigned int nWidth = (m_Frame.nCX + nScale - 1) / nScale;
+	unsigned int nHeight = (m_Frame.nCY + nScale - 1) / nScale;
+	if(m_sink)
+	{
+		m_output = m_sink->BeginImage(nWidth, nHeight, 32);
+		if((m_output.GetWidth() != nWidth) || (m_output.GetHeight() != nHeight) || (m_output.GetBitsPerPixel() != 32))
+		{
+			throw std::runtime_error("Bitmap sink doesn't match image.");
+		}
+	}
+	else
+	{
+		m_bitmap = CBitmap(nWidth, nHeight, 32);
+		m_output = CBitmapView(m_bitmap);
+	}
+
+	m_nMCUsPerLine = (m_Frame.nCX + (8 * m_nSampX) - 1) / (8 * m_nSampX);
+	unsigned int nMCULines = (m_Frame.nCY + (8 * m_nSampY) - 1) / (8 * m_nSampY);
+	m_nMCUCount = m_nMCUsPerLine * nMCULines;
+	m_nBlocksPerMCU = (m_nSampX * m_nSampY) + 2;
+
+	//When downscaling, chroma is reconstructed at the output resolution using more of its
+	//coefficients instead of being upsampled
+	m_nBlockSize = 8 / m_nScaleDenominator;
+	m_nChromaWidth = (m_nBlockSize == 8) ? 8 : m_nBlockSize * m_nSampX;
+	m_nChromaHeight = (m_nBlockSize == 8) ? 8 : m_nBlockSize * m_nSampY;
+	m_nMCUCoefs = (m_nSampX * m_nSampY * m_nBlockSize * m_nBlockSize) + (2 * m_nChromaWidth * m_nChromaHeight);
 
-	//Allocate some space for the components
-	nCX = ((m_Frame.nCX + 15) / 16) * 16;
-	nCY = ((m_Frame.nCY + 15) / 16) * 16;
+	m_coefficients.clear();
+	m_coefficients.resize(m_nMCUCount * m_nMCUCoefs);
 
-	nBX = nCX / (8 * nSampX);
-	nBY = nCY / (8 * nSampY);
+	auto segments = ReadScanSegments();
+	unsigned int nSegmentMCUs = (m_restartInterval != 0) ? m_restartInterval : m_nMCUCount;
 
-	//TODO: Figure that out...
-	for(i = 0; i < 16; i++)
+	CTaskGroup tasks(m_threadPool);
+	if(segments.size() == 1)
 	{
-		for(j = 0; j < 16; j++)
+		//Entropy decoding is serial, reconstruct MCU lines as soon as they're available
+		unsigned int nLineEnd = m_nMCUsPerLine;
+		DecodeSegment(segments[0], 0, m_nMCUCount,
+			[&] (unsigned int nDecodedMCUs)
+			{
+				if(nDecodedMCUs < nLineEnd && nDecodedMCUs != m_nMCUCount) return;
+				unsigned int nLineStart = nLineEnd - m_nMCUsPerLine;
+				unsigned int nLineMCUs = std::min(nDecodedMCUs, nLineEnd) - nLineStart;
+				tasks.Run([this, nLineStart, nLineMCUs] () { ReconstructMCUs(nLineStart, nLineMCUs); });
+				nLineEnd += m_nMCUsPerLine;
+			}
+		);
+	}
+	else
+	{
+		//Restart intervals are independent, decode and reconstruct them in parallel
+		for(unsigned int i = 0; i < segments.size(); i++)
 		{
-			nReMap[(i * 16) + j] = ((i / 2) * 8) + j / 2;
+			unsigned int nFirstMCU = i * nSegmentMCUs;
+			if(nFirstMCU >= m_nMCUCount) break;
+			unsigned int nMCUCount = std::min(nSegmentMCUs, m_nMCUCount - nFirstMCU);
+			const auto& segment = segments[i];
+			tasks.Run(
+				[this, &segment, nFirstMCU, nMCUCount] ()
+				{
+					DecodeSegment(segment, nFirstMCU, nMCUCount, std::function<void (unsigned int)>());
+					ReconstructMCUs(nFirstMCU, nMCUCount);
+				}
+			);
 		}
 	}
+	tasks.Wait();
+
+	return 0;
+}
 
-	for(i = 0; i < 8; i++)
+CJPEG::SegmentArray CJPEG::ReadScanSegments()
+{
+	//Reads the entropy coded data up to the next marker, removing byte stuffing
+	//and splitting it on restart markers
+	SegmentArray segments;
+	Segment segment;
+	while(1)
 	{
-		for(j = 0; j < 8; j++)
+		uint8 nByte = (uint8)m_stream->GetBitsInline_MSBF(8);
+		if(nByte != 0xFF)
 		{
-			nTab1[(i * 8) + j] = nReMap[(i * 16) + j];
+			segment.push_back(nByte);
+			continue;
 		}
-		for(j = 8; j < 16; j++)
+		uint8 nMarker = (uint8)m_stream->GetBitsInline_MSBF(8);
+		while(nMarker == 0xFF)
 		{
-			nTab2[(i * 8) + (j - 8)] = nReMap[(i * 16) + j];
+			nMarker = (uint8)m_stream->GetBitsInline_MSBF(8);
 		}
-	}
-	for(i = 8; i < 16; i++)
-	{
-		for(j = 0; j < 8; j++)
+		if(nMarker == 0x00)
 		{
-			nTab3[((i - 8) * 8) + j] = nReMap[(i * 16) + j];
+			segment.push_back(0xFF);
 		}
-		for(j = 8; j < 16; j++)
+		else if(nMarker >= 0xD0 && nMarker <= 0xD7)
 		{
-			nTab4[((i - 8) * 8) + (j - 8)] = nReMap[(i * 16) + j];
+			//RSTn
+			segments.push_back(std::move(segment));
+			segment = Segment();
 		}
+		else
+		{
+			m_pendingMarker = 0xFF00 | nMarker;
+			break;
+		}
+	}
+	segments.push_back(std::move(segment));
+	for(auto& currentSegment : segments)
+	{
+		//Padding allows the Huffman decoder to always look ahead
+		currentSegment.resize(currentSegment.size() + SEGMENT_PADDING, 0);
 	}
+	return segments;
+}
 
-	nYDC = 0;
-	nCrDC = 0;
-	nCbDC = 0;
+void CJPEG::DecodeSegment(const Segment& segment, unsigned int nFirstMCU, unsigned int nMCUCount, const std::function<void (unsigned int)>& progressHandler)
+{
+	CPtrStream segmentStream(segment.data(), segment.size());
+	CStreamBitStream stream(segmentStream);
+	int nYDC = 0, nCbDC = 0, nCrDC = 0;
+	unsigned int nLumaBlocks = m_nSampX * m_nSampY;
 
-	if(nSampX == 1 && nSampY == 1)
+	BLOCKDECODER decoders[3];
+	for(unsigned int nComponent = 0; nComponent < 3; nComponent++)
 	{
-		for(j = 0; j < nBY; j++)
+		unsigned int i = 0;
+		while(m_Frame.pCompoment[nComponent].nC != m_Scan.pComponent[i].nCs)
 		{
-			for(i = 0; i < nBX; i++)
-			{
-				DecodeMCU(0,	nY,		&nYDC);
-				DecodeMCU(1,	nCb,	&nCbDC);
-				DecodeMCU(2,	nCr,	&nCrDC);
-
-				Draw8x8Block((i * 8), (j * 8), nTab1, nY, nCr, nCb);
-			}
+			i++;
 		}
+		decoders[nComponent].pQ		= m_Qt[m_Frame.pCompoment[nComponent].nTq].pQ;
+		decoders[nComponent].pACHt	= &m_ACHt[m_Scan.pComponent[i].nTdTa & 0x0F];
+		decoders[nComponent].pDCHt	= &m_DCHt[(m_Scan.pComponent[i].nTdTa & 0xF0) >> 4];
 	}
 
-	if(nSampX == 2 && nSampY == 2)
-	{
-		for(j = 0; j < nBY; j++)
+	int16 nBlock[64];
+	unsigned int nBlockSize = m_nBlockSize;
+	unsigned int nBlockCoefs = nBlockSize * nBlockSize;
+	unsigned int nChromaCoefs = m_nChromaWidth * m_nChromaHeight;
+	//When downscaling, only the low frequencies of each block are kept
+	auto decodeBlock =
+		[&] (const BLOCKDECODER& decoder, int16* pOutput, int* nDC, unsigned int nWidth, unsigned int nHeight)
 		{
-			for(i = 0; i < nBX; i++)
+			if(nWidth == 8 && nHeight == 8)
 			{
-				DecodeMCU(0,	nY + 0x0000,	&nYDC);
-				DecodeMCU(0,	nY + 0x0040,	&nYDC);
-				DecodeMCU(0,	nY + 0x0080,	&nYDC);
-				DecodeMCU(0,	nY + 0x00C0,	&nYDC);
-
-				DecodeMCU(1,	nCb,			&nCbDC);
-			
-				DecodeMCU(2,	nCr,			&nCrDC);
-
-				Draw8x8Block((i * 16) + 0, (j * 16) + 0, nTab1, nY + 0x0000, nCr, nCb);
-				Draw8x8Block((i * 16) + 8, (j * 16) + 0, nTab2, nY + 0x0040, nCr, nCb);
-				Draw8x8Block((i * 16) + 0, (j * 16) + 8, nTab3, nY + 0x0080, nCr, nCb);
-				Draw8x8Block((i * 16) + 8, (j * 16) + 8, nTab4, nY + 0x00C0, nCr, nCb);
-
+				DecodeMCU(stream, decoder, pOutput, nDC);
+				return;
 			}
+			DecodeMCU(stream, decoder, nBlock, nDC);
+			for(unsigned int y = 0; y < nHeight; y++)
+			{
+				memcpy(pOutput + (y * nWidth), nBlock + (y * 8), nWidth * sizeof(int16));
+			}
+		};
+
+	for(unsigned int nMCU = nFirstMCU; nMCU < (nFirstMCU + nMCUCount); nMCU++)
+	{
+		int16* pBlocks = m_coefficients.data() + (nMCU * m_nMCUCoefs);
+		for(unsigned int i = 0; i < nLumaBlocks; i++)
+		{
+			decodeBlock(decoders[0], pBlocks + (i * nBlockCoefs), &nYDC, nBlockSize, nBlockSize);
+		}
+		int16* pChroma = pBlocks + (nLumaBlocks * nBlockCoefs);
+		decodeBlock(decoders[1], pChroma, &nCbDC, m_nChromaWidth, m_nChromaHeight);
+		decodeBlock(decoders[2], pChroma + nChromaCoefs, &nCrDC, m_nChromaWidth, m_nChromaHeight);
+		if(progressHandler)
+		{
+			progressHandler(nMCU + 1);
 		}
 	}
-
-	return 0;
 }
 
 CBitmap CJPEG::Process()
@@ -521,8 +1023,16 @@ CBitmap CJPEG::Process()
 
 	while(nMarker != 0xFFD9 && nError == 0)
 	{
-		m_stream->SeekToByteAlign();
-		nMarker = (uint16)m_stream->GetBits_MSBF(16);
+		if(m_pendingMarker != 0)
+		{
+			nMarker = m_pendingMarker;
+			m_pendingMarker = 0;
+		}
+		else
+		{
+			m_stream->SeekToByteAlign();
+			nMarker = (uint16)m_stream->GetBits_MSBF(16);
+		}
 		
 		switch(nMarker)
 		{
@@ -549,9 +1059,26 @@ CBitmap CJPEG::Process()
 			//DQT - Define Quantization Table
 			nError = ProcessDQT();
 			break;
+		case 0xFFDD:
+			//DRI - Define Restart Interval
+			ProcessDRI();
+			break;
 		case 0xFFE0:
+		case 0xFFE1:
+		case 0xFFE2:
+		case 0xFFE3:
+		case 0xFFE4:
+		case 0xFFE5:
+		case 0xFFE6:
+		case 0xFFE7:
+		case 0xFFE8:
+		case 0xFFE9:
+		case 0xFFEA:
+		case 0xFFEB:
 		case 0xFFEC:
+		case 0xFFED:
 		case 0xFFEE:
+		case 0xFFEF:
 			//APPx - Application defined x
 			ProcessAPPx();
 			break;
@@ -565,6 +1092,11 @@ CBitmap CJPEG::Process()
 		}
 	}
 
+	if(m_sink && (nError == 0) && !m_output.IsEmpty())
+	{
+		m_sink->EndImage();
+	}
+
 	return m_bitmap;
 }
 
@@ -711,6 +1243,12 @@ unsigned int CJPEG::ProcessDQT()
 	return 0;
 }
 
+void CJPEG::ProcessDRI()
+{
+	FRAMEWORK_MAYBE_UNUSED uint16 nLength = (uint16)m_stream->GetBits_MSBF(16);
+	m_restartInterval = (uint16)m_stream->GetBits_MSBF(16);
+}
+
 void CJPEG::ProcessAPPx()
 {
 	uint16 nLength = (uint16)m_stream->GetBits_MSBF(16);
@@ -746,3 +1284,382 @@ void CJPEG::ProcessCOM()
 	free(pCom);
 */
 }
+
+namespace
+{
+	//ITU T.81 Annex K tables (quantization tables in natural order)
+	const uint8 g_lumaQuantTable[64] =
+	{
+		16,  11,  10,  16,  24,  40,  51,  61,
+		12,  12,  14,  19,  26,  58,  60,  55,
+		14,  13,  16,  24,  40,  57,  69,  56,
+		14,  17,  22,  29,  51,  87,  80,  62,
+		18,  22,  37,  56,  68, 109, 103,  77,
+		24,  35,  55,  64,  81, 104, 113,  92,
+		49,  64,  78,  87, 103, 121, 120, 101,
+		72,  92,  95,  98, 112, 100, 103,  99
+	};
+
+	const uint8 g_chromaQuantTable[64] =
+	{
+		17,  18,  24,  47,  99,  99,  99,  99,
+		18,  21,  26,  66,  99,  99,  99,  99,
+		24,  26,  56,  99,  99,  99,  99,  99,
+		47,  66,  99,  99,  99,  99,  99,  99,
+		99,  99,  99,  99,  99,  99,  99,  99,
+		99,  99,  99,  99,  99,  99,  99,  99,
+		99,  99,  99,  99,  99,  99,  99,  99,
+		99,  99,  99,  99,  99,  99,  99,  99
+	};
+
+	const uint8 g_dcLumaBits[16] = { 0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0 };
+	const uint8 g_dcChromaBits[16] = { 0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0 };
+	const uint8 g_dcValues[12] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 };
+
+	const uint8 g_acLumaBits[16] = { 0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7D };
+	const uint8 g_acLumaValues[162] =
+	{
+		0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07,
+		0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xA1, 0x08, 0x23, 0x42, 0xB1, 0xC1, 0x15, 0x52, 0xD1, 0xF0,
+		0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0A, 0x16, 0x17, 0x18, 0x19, 0x1A, 0x25, 0x26, 0x27, 0x28,
+		0x29, 0x2A, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
+		0x4A, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5A, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+		0x6A, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7A, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+		0x8A, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9A, 0xA2, 0xA3, 0xA4, 0xA5, 0xA6, 0xA7,
+		0xA8, 0xA9, 0xAA, 0xB2, 0xB3, 0xB4, 0xB5, 0xB6, 0xB7, 0xB8, 0xB9, 0xBA, 0xC2, 0xC3, 0xC4, 0xC5,
+		0xC6, 0xC7, 0xC8, 0xC9, 0xCA, 0xD2, 0xD3, 0xD4, 0xD5, 0xD6, 0xD7, 0xD8, 0xD9, 0xDA, 0xE1, 0xE2,
+		0xE3, 0xE4, 0xE5, 0xE6, 0xE7, 0xE8, 0xE9, 0xEA, 0xF1, 0xF2, 0xF3, 0xF4, 0xF5, 0xF6, 0xF7, 0xF8,
+		0xF9, 0xFA
+	};
+
+	const uint8 g_acChromaBits[16] = { 0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 0x77 };
+	const uint8 g_acChromaValues[162] =
+	{
+		0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71,
+		0x13, 0x22, 0x32, 0x81, 0x08, 0x14, 0x42, 0x91, 0xA1, 0xB1, 0xC1, 0x09, 0x23, 0x33, 0x52, 0xF0,
+		0x15, 0x62, 0x72, 0xD1, 0x0A, 0x16, 0x24, 0x34, 0xE1, 0x25, 0xF1, 0x17, 0x18, 0x19, 0x1A, 0x26,
+		0x27, 0x28, 0x29, 0x2A, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48,
+		0x49, 0x4A, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5A, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68,
+		0x69, 0x6A, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7A, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87,
+		0x88, 0x89, 0x8A, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9A, 0xA2, 0xA3, 0xA4, 0xA5,
+		0xA6, 0xA7, 0xA8, 0xA9, 0xAA, 0xB2, 0xB3, 0xB4, 0xB5, 0xB6, 0xB7, 0xB8, 0xB9, 0xBA, 0xC2, 0xC3,
+		0xC4, 0xC5, 0xC6, 0xC7, 0xC8, 0xC9, 0xCA, 0xD2, 0xD3, 0xD4, 0xD5, 0xD6, 0xD7, 0xD8, 0xD9, 0xDA,
+		0xE2, 0xE3, 0xE4, 0xE5, 0xE6, 0xE7, 0xE8, 0xE9, 0xEA, 0xF2, 0xF3, 0xF4, 0xF5, 0xF6, 0xF7, 0xF8,
+		0xF9, 0xFA
+	};
+
+	//RGB to YCbCr coefficients (JFIF), scaled by 2^ENCODE_COLOR_BITS
+	enum
+	{
+		ENCODE_COLOR_BITS = 16,
+		ENCODE_MCU_SIZE = 16,
+	};
+
+	struct HUFFMANENCODER
+	{
+		uint16		codes[256];
+		uint8		sizes[256];
+	};
+
+	HUFFMANENCODER MakeHuffmanEncoder(const uint8* bits, const uint8* values)
+	{
+		HUFFMANENCODER encoder = {};
+		uint32 code = 0;
+		unsigned int valueIndex = 0;
+		for(unsigned int size = 1; size <= 16; size++)
+		{
+			for(unsigned int i = 0; i < bits[size - 1]; i++)
+			{
+				uint8 value = values[valueIndex++];
+				encoder.codes[value] = static_cast<uint16>(code++);
+				encoder.sizes[value] = static_cast<uint8>(size);
+			}
+			code <<= 1;
+		}
+		return encoder;
+	}
+
+	class CJpegBitWriter
+	{
+	public:
+		CJpegBitWriter(std::vector<uint8>& output)
+			: m_output(output)
+		{
+
+		}
+
+		void PutBits(uint32 value, unsigned int size)
+		{
+			m_buffer = (m_buffer << size) | (value & ((1 << size) - 1));
+			m_bitCount += size;
+			while(m_bitCount >= 8)
+			{
+				m_bitCount -= 8;
+				uint8 byte = static_cast<uint8>(m_buffer >> m_bitCount);
+				m_output.push_back(byte);
+				if(byte == 0xFF)
+				{
+					//Byte stuffing
+					m_output.push_back(0x00);
+				}
+			}
+		}
+
+		//Pads the last byte with 1s
+		void Flush()
+		{
+			if(m_bitCount != 0)
+			{
+				PutBits(0x7F, 8 - m_bitCount);
+			}
+		}
+
+	private:
+		std::vector<uint8>&	m_output;
+		uint32				m_buffer = 0;
+		unsigned int		m_bitCount = 0;
+	};
+
+	struct BLOCKENCODER
+	{
+		const HUFFMANENCODER*	dcEncoder;
+		const HUFFMANENCODER*	acEncoder;
+		const uint8*			quantTable;
+		int32					prevDC;
+	};
+
+	unsigned int GetMagnitudeSize(int32 value)
+	{
+		uint32 magnitude = std::abs(value);
+		unsigned int size = 0;
+		while(magnitude != 0)
+		{
+			size++;
+			magnitude >>= 1;
+		}
+		return size;
+	}
+
+	void PutSymbol(CJpegBitWriter& writer, const HUFFMANENCODER& encoder, unsigned int run, int32 value)
+	{
+		unsigned int size = GetMagnitudeSize(value);
+		unsigned int symbol = (run << 4) | size;
+		writer.PutBits(encoder.codes[symbol], encoder.sizes[symbol]);
+		if(size != 0)
+		{
+			writer.PutBits(value < 0 ? value - 1 : value, size);
+		}
+	}
+
+	int32 Quantize(int32 value, int32 divisor, int32 limit)
+	{
+		int32 result = (std::abs(value) + (divisor / 2)) / divisor;
+		result = std::min(result, limit);
+		return (value < 0) ? -result : result;
+	}
+
+	void EncodeBlock(CJpegBitWriter& writer, BLOCKENCODER& blockEncoder, const int16* samples, const unsigned char* zigZag)
+	{
+		int16 coefs[64];
+		IDCT::CFixedPoint::ForwardTransform(samples, coefs);
+
+		int32 dc = Quantize(coefs[0], blockEncoder.quantTable[0], 2047);
+		PutSymbol(writer, *blockEncoder.dcEncoder, 0, dc - blockEncoder.prevDC);
+		blockEncoder.prevDC = dc;
+
+		unsigned int run = 0;
+		for(unsigned int i = 1; i < 64; i++)
+		{
+			unsigned int index = zigZag[i];
+			int32 value = Quantize(coefs[index], blockEncoder.quantTable[index], 1023);
+			if(value == 0)
+			{
+				run++;
+				continue;
+			}
+			while(run >= 16)
+			{
+				//ZRL
+				PutSymbol(writer, *blockEncoder.acEncoder, 15, 0);
+				run -= 16;
+			}
+			PutSymbol(writer, *blockEncoder.acEncoder, run, value);
+			run = 0;
+		}
+		if(run != 0)
+		{
+			//EOB
+			PutSymbol(writer, *blockEncoder.acEncoder, 0, 0);
+		}
+	}
+
+	void ScaleQuantTable(uint8* output, const uint8* input, unsigned int quality)
+	{
+		quality = std::min<unsigned int>(std::max<unsigned int>(quality, 1), 100);
+		unsigned int scale = (quality < 50) ? (5000 / quality) : (200 - quality * 2);
+		for(unsigned int i = 0; i < 64; i++)
+		{
+			unsigned int value = (input[i] * scale + 50) / 100;
+			output[i] = static_cast<uint8>(std::min<unsigned int>(std::max<unsigned int>(value, 1), 255));
+		}
+	}
+
+	void PutMarker(std::vector<uint8>& output, uint8 marker, uint16 length)
+	{
+		output.push_back(0xFF);
+		output.push_back(marker);
+		if(length != 0)
+		{
+			output.push_back(static_cast<uint8>(length >> 8));
+			output.push_back(static_cast<uint8>(length));
+		}
+	}
+
+	void PutHuffmanTable(std::vector<uint8>& output, uint8 tcTh, const uint8* bits, const uint8* values)
+	{
+		unsigned int valueCount = 0;
+		for(unsigned int i = 0; i < 16; i++)
+		{
+			valueCount += bits[i];
+		}
+		output.push_back(tcTh);
+		output.insert(output.end(), bits, bits + 16);
+		output.insert(output.end(), values, values + valueCount);
+	}
+
+	//Converts a 16x16 block of pixels to 4 luma blocks and 2 downsampled chroma blocks (level shifted)
+	void ConvertMCU(const CBitmap& bitmap, unsigned int mcuX, unsigned int mcuY, int16* luma, int16* cb, int16* cr)
+	{
+		const int32 rounding = 1 << (ENCODE_COLOR_BITS - 1);
+		const int32 chromaBias = 128 << ENCODE_COLOR_BITS;
+		unsigned int width = bitmap.GetWidth();
+		unsigned int height = bitmap.GetHeight();
+		unsigned int pixelSize = bitmap.GetPixelSize();
+		unsigned int pitch = bitmap.GetPitch();
+		const uint8* pixels = bitmap.GetPixels();
+
+		int32 chromaSums[2][64] = {};
+		for(unsigned int y = 0; y < ENCODE_MCU_SIZE; y++)
+		{
+			unsigned int srcY = std::min(mcuY + y, height - 1);
+			const uint8* row = pixels + srcY * pitch;
+			for(unsigned int x = 0; x < ENCODE_MCU_SIZE; x++)
+			{
+				unsigned int srcX = std::min(mcuX + x, width - 1);
+				const uint8* pixel = row + srcX * pixelSize;
+				int32 r = pixel[0];
+				int32 g = pixel[1];
+				int32 b = pixel[2];
+				int32 yValue = (19595 * r + 38470 * g + 7471 * b + rounding) >> ENCODE_COLOR_BITS;
+				int32 cbValue = (-11059 * r - 21709 * g + 32768 * b + chromaBias) >> ENCODE_COLOR_BITS;
+				int32 crValue = (32768 * r - 27439 * g - 5329 * b + chromaBias) >> ENCODE_COLOR_BITS;
+
+				unsigned int block = (y / 8) * 2 + (x / 8);
+				luma[block * 64 + (y % 8) * 8 + (x % 8)] = static_cast<int16>(yValue - 128);
+				unsigned int chromaIndex = (y / 2) * 8 + (x / 2);
+				chromaSums[0][chromaIndex] += cbValue;
+				chromaSums[1][chromaIndex] += crValue;
+			}
+		}
+		for(unsigned int i = 0; i < 64; i++)
+		{
+			cb[i] = static_cast<int16>(((chromaSums[0][i] + 2) >> 2) - 128);
+			cr[i] = static_cast<int16>(((chromaSums[1][i] + 2) >> 2) - 128);
+		}
+	}
+}
+
+void CJPEG::WriteBitmap(const CBitmap& bitmap, CStream& stream, unsigned int quality)
+{
+	if((bitmap.GetBitsPerPixel() != 24) && (bitmap.GetBitsPerPixel() != 32))
+	{
+		throw std::runtime_error("Unsupported bit depth.");
+	}
+	unsigned int width = bitmap.GetWidth();
+	unsigned int height = bitmap.GetHeight();
+	if((width == 0) || (height == 0) || (width > 0xFFFF) || (height > 0xFFFF))
+	{
+		throw std::runtime_error("Invalid image dimensions.");
+	}
+
+	uint8 quantTables[2][64];
+	ScaleQuantTable(quantTables[0], g_lumaQuantTable, quality);
+	ScaleQuantTable(quantTables[1], g_chromaQuantTable, quality);
+
+	std::vector<uint8> output;
+	output.reserve(width * height / 2 + 0x400);
+
+	PutMarker(output, 0xD8, 0);
+
+	//JFIF header
+	static const uint8 jfifHeader[14] = { 'J', 'F', 'I', 'F', 0, 1, 1, 0, 0, 1, 0, 1, 0, 0 };
+	PutMarker(output, 0xE0, 2 + sizeof(jfifHeader));
+	output.insert(output.end(), jfifHeader, jfifHeader + sizeof(jfifHeader));
+
+	PutMarker(output, 0xDB, 2 + 2 * 65);
+	for(unsigned int i = 0; i < 2; i++)
+	{
+		output.push_back(static_cast<uint8>(i));
+		for(unsigned int j = 0; j < 64; j++)
+		{
+			output.push_back(quantTables[i][m_nZigZag[j]]);
+		}
+	}
+
+	//4:2:0 sampling
+	static const uint8 frameHeader[15] =
+	{
+		8, 0, 0, 0, 0, 3,
+		1, 0x22, 0,
+		2, 0x11, 1,
+		3, 0x11, 1
+	};
+	PutMarker(output, 0xC0, 2 + sizeof(frameHeader));
+	output.insert(output.end(), frameHeader, frameHeader + sizeof(frameHeader));
+	size_t frameSizeOffset = output.size() - sizeof(frameHeader) + 1;
+	output[frameSizeOffset + 0] = static_cast<uint8>(height >> 8);
+	output[frameSizeOffset + 1] = static_cast<uint8>(height);
+	output[frameSizeOffset + 2] = static_cast<uint8>(width >> 8);
+	output[frameSizeOffset + 3] = static_cast<uint8>(width);
+
+	PutMarker(output, 0xC4, 2 + 4 * 17 + 2 * 12 + 2 * 162);
+	PutHuffmanTable(output, 0x00, g_dcLumaBits, g_dcValues);
+	PutHuffmanTable(output, 0x10, g_acLumaBits, g_acLumaValues);
+	PutHuffmanTable(output, 0x01, g_dcChromaBits, g_dcValues);
+	PutHuffmanTable(output, 0x11, g_acChromaBits, g_acChromaValues);
+
+	static const uint8 scanHeader[10] = { 3, 1, 0x00, 2, 0x11, 3, 0x11, 0, 63, 0 };
+	PutMarker(output, 0xDA, 2 + sizeof(scanHeader));
+	output.insert(output.end(), scanHeader, scanHeader + sizeof(scanHeader));
+
+	HUFFMANENCODER dcLuma = MakeHuffmanEncoder(g_dcLumaBits, g_dcValues);
+	HUFFMANENCODER acLuma = MakeHuffmanEncoder(g_acLumaBits, g_acLumaValues);
+	HUFFMANENCODER dcChroma = MakeHuffmanEncoder(g_dcChromaBits, g_dcValues);
+	HUFFMANENCODER acChroma = MakeHuffmanEncoder(g_acChromaBits, g_acChromaValues);
+
+	BLOCKENCODER lumaEncoder = { &dcLuma, &acLuma, quantTables[0], 0 };
+	BLOCKENCODER cbEncoder = { &dcChroma, &acChroma, quantTables[1], 0 };
+	BLOCKENCODER crEncoder = { &dcChroma, &acChroma, quantTables[1], 0 };
+
+	CJpegBitWriter writer(output);
+	int16 luma[4 * 64];
+	int16 cb[64];
+	int16 cr[64];
+	for(unsigned int mcuY = 0; mcuY < height; mcuY += ENCODE_MCU_SIZE)
+	{
+		for(unsigned int mcuX = 0; mcuX < width; mcuX += ENCODE_MCU_SIZE)
+		{
+			ConvertMCU(bitmap, mcuX, mcuY, luma, cb, cr);
+			for(unsigned int i = 0; i < 4; i++)
+			{
+				EncodeBlock(writer, lumaEncoder, luma + i * 64, m_nZigZag);
+			}
+			EncodeBlock(writer, cbEncoder, cb, m_nZigZag);
+			EncodeBlock(writer, crEncoder, cr, m_nZigZag);
+		}
+	}
+	writer.Flush();
+
+	PutMarker(output, 0xD9, 0);
+	stream.Write(output.data(), output.size());
+}
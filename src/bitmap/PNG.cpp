@@ -2,28 +2,333 @@
 #include <string.h>
 #include <assert.h>
 #include <math.h>
-#include <zstd_zlibwrapper.h>
+#include <algorithm>
+#include <stdexcept>
 #include "bitmap/PNG.h"
+#include "bitmap/PixelConvert.h"
 #include "EndianUtils.h"
 #include "PtrStream.h"
+#include "SpanStream.h"
 #include "PtrMacro.h"
-#include "StreamBitStream.h"
+#include "TaskGroup.h"
+#include "SimdDefs.h"
+#include "Trace.h"
+
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+#include <emmintrin.h>
+#elif defined(FRAMEWORK_SIMD_USE_NEON)
+#include <arm_neon.h>
+#endif
 
 using namespace Framework;
 
+namespace
+{
+#if !defined(FRAMEWORK_SIMD_USE_SCALAR)
+
+	//Pixels are at most 8 bytes long, each one is handled in a single register.
+	//Filters that depend on the left pixel can't be vectorized across pixels.
+	template <unsigned int pixelSize>
+	uint64 LoadPixel(const uint8* pixel)
+	{
+		uint64 result = 0;
+		memcpy(&result, pixel, pixelSize);
+		return result;
+	}
+
+	template <unsigned int pixelSize>
+	void StorePixel(uint8* pixel, uint64 value)
+	{
+		memcpy(pixel, &value, pixelSize);
+	}
+
+#endif
+
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+
+	template <unsigned int pixelSize>
+	__m128i LoadPixelSimd(const uint8* pixel)
+	{
+		uint64 value = LoadPixel<pixelSize>(pixel);
+		return _mm_loadl_epi64(reinterpret_cast<const __m128i*>(&value));
+	}
+
+	template <unsigned int pixelSize>
+	void StorePixelSimd(uint8* pixel, __m128i value)
+	{
+		uint64 result = 0;
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(&result), value);
+		StorePixel<pixelSize>(pixel, result);
+	}
+
+	__m128i Select(__m128i mask, __m128i valueTrue, __m128i valueFalse)
+	{
+		return _mm_or_si128(_mm_and_si128(mask, valueTrue), _mm_andnot_si128(mask, valueFalse));
+	}
+
+	__m128i Abs16(__m128i value)
+	{
+		return _mm_max_epi16(value, _mm_sub_epi16(_mm_setzero_si128(), value));
+	}
+
+	void UpFilterSimd(uint8* row, const uint8* previousRow, unsigned int size)
+	{
+		unsigned int i = 0;
+		for(; (i + 16) <= size; i += 16)
+		{
+			__m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+			__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(previousRow + i));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(row + i), _mm_add_epi8(x, b));
+		}
+		for(; i < size; i++)
+		{
+			row[i] += previousRow[i];
+		}
+	}
+
+	template <unsigned int pixelSize>
+	void SubFilterSimd(uint8* row, unsigned int size)
+	{
+		__m128i a = _mm_setzero_si128();
+		for(unsigned int i = 0; i < size; i += pixelSize)
+		{
+			a = _mm_add_epi8(a, LoadPixelSimd<pixelSize>(row + i));
+			StorePixelSimd<pixelSize>(row + i, a);
+		}
+	}
+
+	template <unsigned int pixelSize>
+	void AverageFilterSimd(uint8* row, const uint8* previousRow, unsigned int size)
+	{
+		const __m128i one = _mm_set1_epi8(1);
+		__m128i a = _mm_setzero_si128();
+		for(unsigned int i = 0; i < size; i += pixelSize)
+		{
+			__m128i b = LoadPixelSimd<pixelSize>(previousRow + i);
+			__m128i x = LoadPixelSimd<pixelSize>(row + i);
+			//avg_epu8 rounds up, PNG's average rounds down
+			__m128i average = _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), one));
+			a = _mm_add_epi8(x, average);
+			StorePixelSimd<pixelSize>(row + i, a);
+		}
+	}
+
+	template <unsigned int pixelSize>
+	void PaethFilterSimd(uint8* row, const uint8* previousRow, unsigned int size)
+	{
+		const __m128i zero = _mm_setzero_si128();
+		__m128i a = zero;
+		__m128i c = zero;
+		for(unsigned int i = 0; i < size; i += pixelSize)
+		{
+			__m128i b = _mm_unpacklo_epi8(LoadPixelSimd<pixelSize>(previousRow + i), zero);
+			__m128i x = LoadPixelSimd<pixelSize>(row + i);
+
+			//p = a + b - c, pa = |p - a| = |b - c|, pb = |p - b| = |a - c|, pc = |p - c|
+			__m128i pa = _mm_sub_epi16(b, c);
+			__m128i pb = _mm_sub_epi16(a, c);
+			__m128i pc = Abs16(_mm_add_epi16(pa, pb));
+			pa = Abs16(pa);
+			pb = Abs16(pb);
+
+			__m128i smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+			__m128i nearest = Select(_mm_cmpeq_epi16(pa, smallest), a, Select(_mm_cmpeq_epi16(pb, smallest), b, c));
+
+			__m128i d = _mm_add_epi8(x, _mm_packus_epi16(nearest, nearest));
+			StorePixelSimd<pixelSize>(row + i, d);
+
+			a = _mm_unpacklo_epi8(d, zero);
+			c = b;
+		}
+	}
+
+#elif defined(FRAMEWORK_SIMD_USE_NEON)
+
+	template <unsigned int pixelSize>
+	uint8x8_t LoadPixelSimd(const uint8* pixel)
+	{
+		return vcreate_u8(LoadPixel<pixelSize>(pixel));
+	}
+
+	template <unsigned int pixelSize>
+	void StorePixelSimd(uint8* pixel, uint8x8_t value)
+	{
+		StorePixel<pixelSize>(pixel, vget_lane_u64(vreinterpret_u64_u8(value), 0));
+	}
+
+	void UpFilterSimd(uint8* row, const uint8* previousRow, unsigned int size)
+	{
+		unsigned int i = 0;
+		for(; (i + 16) <= size; i += 16)
+		{
+			vst1q_u8(row + i, vaddq_u8(vld1q_u8(row + i), vld1q_u8(previousRow + i)));
+		}
+		for(; i < size; i++)
+		{
+			row[i] += previousRow[i];
+		}
+	}
+
+	template <unsigned int pixelSize>
+	void SubFilterSimd(uint8* row, unsigned int size)
+	{
+		uint8x8_t a = vdup_n_u8(0);
+		for(unsigned int i = 0; i < size; i += pixelSize)
+		{
+			a = vadd_u8(a, LoadPixelSimd<pixelSize>(row + i));
+			StorePixelSimd<pixelSize>(row + i, a);
+		}
+	}
+
+	template <unsigned int pixelSize>
+	void AverageFilterSimd(uint8* row, const uint8* previousRow, unsigned int size)
+	{
+		uint8x8_t a = vdup_n_u8(0);
+		for(unsigned int i = 0; i < size; i += pixelSize)
+		{
+			uint8x8_t b = LoadPixelSimd<pixelSize>(previousRow + i);
+			uint8x8_t x = LoadPixelSimd<pixelSize>(row + i);
+			a = vadd_u8(x, vhadd_u8(a, b));
+			StorePixelSimd<pixelSize>(row + i, a);
+		}
+	}
+
+	template <unsigned int pixelSize>
+	void PaethFilterSimd(uint8* row, const uint8* previousRow, unsigned int size)
+	{
+		uint8x8_t a = vdup_n_u8(0);
+		uint8x8_t c = vdup_n_u8(0);
+		for(unsigned int i = 0; i < size; i += pixelSize)
+		{
+			uint8x8_t b = LoadPixelSimd<pixelSize>(previousRow + i);
+			uint8x8_t x = LoadPixelSimd<pixelSize>(row + i);
+
+			//p = a + b - c, pa = |p - a| = |b - c|, pb = |p - b| = |a - c|, pc = |p - c|
+			uint16x8_t pa = vabdl_u8(b, c);
+			uint16x8_t pb = vabdl_u8(a, c);
+			uint16x8_t pc = vabdq_u16(vaddl_u8(a, b), vaddl_u8(c, c));
+
+			uint8x8_t useA = vmovn_u16(vandq_u16(vcleq_u16(pa, pb), vcleq_u16(pa, pc)));
+			uint8x8_t useB = vmovn_u16(vcleq_u16(pb, pc));
+			uint8x8_t nearest = vbsl_u8(useA, a, vbsl_u8(useB, b, c));
+
+			a = vadd_u8(x, nearest);
+			StorePixelSimd<pixelSize>(row + i, a);
+			c = b;
+		}
+	}
+
+#endif
+
+#if !defined(FRAMEWORK_SIMD_USE_SCALAR)
+
+	template <template <unsigned int> class Filter, typename... Args>
+	bool DispatchFilter(unsigned int pixelSize, Args... args)
+	{
+		switch(pixelSize)
+		{
+		case 1:
+			Filter<1>::Run(args...);
+			return true;
+		case 2:
+			Filter<2>::Run(args...);
+			return true;
+		case 3:
+			Filter<3>::Run(args...);
+			return true;
+		case 4:
+			Filter<4>::Run(args...);
+			return true;
+		case 6:
+			Filter<6>::Run(args...);
+			return true;
+		case 8:
+			Filter<8>::Run(args...);
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	template <unsigned int pixelSize>
+	struct SubFilterRunner
+	{
+		static void Run(uint8* row, unsigned int size) { SubFilterSimd<pixelSize>(row, size); }
+	};
+
+	template <unsigned int pixelSize>
+	struct AverageFilterRunner
+	{
+		static void Run(uint8* row, const uint8* previousRow, unsigned int size) { AverageFilterSimd<pixelSize>(row, previousRow, size); }
+	};
+
+	template <unsigned int pixelSize>
+	struct PaethFilterRunner
+	{
+		static void Run(uint8* row, const uint8* previousRow, unsigned int size) { PaethFilterSimd<pixelSize>(row, previousRow, size); }
+	};
+
+#endif
+}
+
 CBitmap CPNG::ReadBitmap(CStream& stream)
 {
-	return CPNG().DoRead(stream);
+	return CPNG().DoRead(stream, nullptr);
+}
+
+void CPNG::ReadBitmap(CStream& stream, CBitmapSink& sink)
+{
+	CPNG().DoRead(stream, &sink);
+}
+
+CImageProbe::INFO CPNG::ReadInfo(CStream& stream)
+{
+	static const uint8 signature[8] = { 0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A };
+	uint8 header[8];
+	if((stream.Read(header, 8) != 8) || memcmp(header, signature, 8))
+	{
+		throw std::runtime_error("Invalid PNG file.");
+	}
+
+	//IHDR must be the first chunk, its size is fixed
+	stream.Read32();
+	uint32 nChunkType = CEndian::FromMSBF32(stream.Read32());
+	if(nChunkType != 0x49484452)
+	{
+		throw std::runtime_error("Invalid PNG file.");
+	}
+
+	CIHDR IHDR;
+	IHDR.Unserialize(stream);
+
+	CImageProbe::INFO info;
+	info.format = CImageProbe::FORMAT_PNG;
+	info.width = IHDR.m_nWidth;
+	info.height = IHDR.m_nHeight;
+	info.bitsPerPixel = IHDR.GetBitsPerPixel();
+	return info;
+}
+
+CPNG::CPNG()
+{
+	memset(m_nPalette, 0, sizeof(m_nPalette));
+	memset(m_nPalette32, 0, sizeof(m_nPalette32));
+	memset(&m_zStream, 0, sizeof(m_zStream));
 }
 
 CPNG::~CPNG()
 {
-	FREEPTR(m_pIDAT);
+	if(m_zStreamInitialized)
+	{
+		inflateEnd(&m_zStream);
+	}
 }
 
-CBitmap CPNG::DoRead(CStream& stream)
+CBitmap CPNG::DoRead(CStream& stream, CBitmapSink* sink)
 {
+	FRAMEWORK_TRACE_SCOPE("PNG::DoRead");
 	CBitmap result;
+	m_sink = sink;
 
 	stream.Seek(0, STREAM_SEEK_END);
 	uint64 nLength = stream.Tell();
@@ -37,9 +342,6 @@ CBitmap CPNG::DoRead(CStream& stream)
 		throw std::runtime_error("Invalid PNG file.");
 	}
 
-	m_nIDATSize = 0;
-	m_pIDAT = NULL;
-
 	bool nDone = false;
 	while(!nDone)
 	{
@@ -52,29 +354,42 @@ CBitmap CPNG::DoRead(CStream& stream)
 		{
 		case 0x49484452:
 			//IHDR
-			{
-				m_IHDR.Unserialize(stream);
-				unsigned int nBufferSize = m_IHDR.CalculateNeededBufferSize();
-				m_pBuffer = reinterpret_cast<uint8*>(malloc(nBufferSize));
-			}
+			m_IHDR.Unserialize(stream);
+			BeginImage();
 			break;
 		case 0x49444154:
 			//IDAT
+			if(!m_zStreamInitialized)
 			{
-				unsigned int nIDATPos = m_nIDATSize;
-				m_nIDATSize += nChunkSize;
-				m_pIDAT = (uint8*)realloc(m_pIDAT, m_nIDATSize);
-				stream.Read(m_pIDAT + nIDATPos, nChunkSize);
+				throw std::runtime_error("Invalid PNG file.");
 			}
+			ProcessIDAT(stream, nChunkSize);
 			break;
 		case 0x49454E44:
 			//IEND
-			UncompressIDAT();
-			result = CreateBitmap();
+			if(m_nScanlineIndex != m_IHDR.m_nHeight)
+			{
+				throw std::runtime_error("Couldn't uncompress IDAT stream.");
+			}
+			if(m_sink)
+			{
+				m_sink->EndImage();
+			}
+			result = std::move(m_bitmap);
+			nDone = true;
 			break;
 		case 0x504C5445:
 			//PLTE
-			stream.Read(m_nPalette, nChunkSize);
+			stream.Read(m_nPalette, std::min<uint32>(nChunkSize, sizeof(m_nPalette)));
+			if(nChunkSize > sizeof(m_nPalette))
+			{
+				stream.Seek(nChunkSize - sizeof(m_nPalette), STREAM_SEEK_CUR);
+			}
+			for(unsigned int i = 0; i < 0x100; i++)
+			{
+				const uint8* color = m_nPalette + (i * 3);
+				m_nPalette32[i] = color[0] | (color[1] << 8) | (color[2] << 16);
+			}
 			break;
 		default:
 			stream.Seek(nChunkSize, STREAM_SEEK_CUR);
@@ -88,80 +403,175 @@ CBitmap CPNG::DoRead(CStream& stream)
 	return result;
 }
 
-void CPNG::UncompressIDAT()
+void CPNG::BeginImage()
 {
-	uLongf dstLength = m_IHDR.CalculateNeededBufferSize();
-	int result = uncompress(m_pBuffer, &dstLength, m_pIDAT, m_nIDATSize);
-	if(result != Z_OK)
+	if(m_zStreamInitialized)
 	{
-		throw std::runtime_error("Couldn't uncompress IDAT stream.");
+		throw std::runtime_error("Invalid PNG file.");
+	}
+	if(m_IHDR.m_nInterlace != 0)
+	{
+		throw std::runtime_error("Interlaced PNG files are not supported.");
 	}
-}
-
-void CPNG::SubFilter(uint8* pRaw, int nPitch, unsigned int nScanline, unsigned int nBPP)
-{
-	int nDist = (nBPP / 8);
 
-	for(int i = 0; i < nPitch; i++)
+	//Palette entries are expanded to 32-bits as scanlines are decoded
+	unsigned int nBPP = (m_IHDR.m_nColorType == 3) ? 32 : m_IHDR.GetBitsPerPixel();
+	if(m_sink)
 	{
-		uint8 nPredictor = 0;
-		if((i - nDist) < 0)
-		{
-			nPredictor = 0;
-		}
-		else
+		m_output = m_sink->BeginImage(m_IHDR.m_nWidth, m_IHDR.m_nHeight, nBPP);
+		if((m_output.GetWidth() != m_IHDR.m_nWidth) || (m_output.GetHeight() != m_IHDR.m_nHeight) || (m_output.GetBitsPerPixel() != nBPP))
 		{
-			nPredictor = pRaw[i - nDist];
+			throw std::runtime_error("Bitmap sink doesn't match image.");
 		}
-		pRaw[i] += nPredictor;
 	}
+	else
+	{
+		m_bitmap = CBitmap(m_IHDR.m_nWidth, m_IHDR.m_nHeight, nBPP);
+		m_output = CBitmapView(m_bitmap);
+	}
+
+	unsigned int nScanlineSize = m_IHDR.GetScanlineSize();
+	m_currentScanline.assign(nScanlineSize + 1, 0);
+	m_previousScanline.assign(nScanlineSize + 1, 0);
+	m_inputBuffer.resize(INPUT_BUFFER_SIZE);
+	m_nScanlinePosition = 0;
+	m_nScanlineIndex = 0;
+
+	if(inflateInit(&m_zStream) != Z_OK)
+	{
+		throw std::runtime_error("zlib stream initialization error.");
+	}
+	m_zStreamInitialized = true;
 }
 
-void CPNG::UpFilter(uint8* pRaw, int nPitch, unsigned int nScanline, unsigned int nBPP)
+void CPNG::ProcessIDAT(CStream& stream, uint32 nChunkSize)
 {
-	for(int i = 0; i < nPitch; i++)
+	if(auto spanStream = dynamic_cast<const CSpanStream*>(&stream))
 	{
-		uint8 nPredictor = 0;
-		if(nScanline == 0)
-		{
-			nPredictor = 0;
-		}
-		else
+		//Chunk is inflated in place, without going through the input buffer
+		InflateIDAT(spanStream->GetSpan(stream.Tell(), nChunkSize), nChunkSize);
+		stream.Seek(nChunkSize, STREAM_SEEK_CUR);
+		return;
+	}
+	while(nChunkSize != 0)
+	{
+		uint32 nReadSize = std::min<uint32>(nChunkSize, INPUT_BUFFER_SIZE);
+		if(stream.Read(m_inputBuffer.data(), nReadSize) != nReadSize)
 		{
-			nPredictor = pRaw[i - nPitch];
+			throw std::runtime_error("Couldn't uncompress IDAT stream.");
 		}
-		pRaw[i] += nPredictor;
+		nChunkSize -= nReadSize;
+		InflateIDAT(m_inputBuffer.data(), nReadSize);
 	}
 }
 
-void CPNG::AverageFilter(uint8* pRaw, int nPitch, unsigned int nScanline, unsigned int nBPP)
+void CPNG::InflateIDAT(const uint8* data, uint32 size)
 {
-	int nDist = (nBPP / 8);
-
-	for(int i = 0; i < nPitch; i++)
+	m_zStream.next_in = const_cast<Bytef*>(data);
+	m_zStream.avail_in = size;
+	while((m_zStream.avail_in != 0) && (m_nScanlineIndex < m_IHDR.m_nHeight))
 	{
-		unsigned int nAbove = 0;
-		if(nScanline == 0)
-		{
-			nAbove = 0;
-		}
-		else
+		unsigned int nScanlineSize = static_cast<unsigned int>(m_currentScanline.size());
+		m_zStream.next_out = m_currentScanline.data() + m_nScanlinePosition;
+		m_zStream.avail_out = nScanlineSize - m_nScanlinePosition;
+
+		int result = inflate(&m_zStream, Z_NO_FLUSH);
+		if((result != Z_OK) && (result != Z_STREAM_END))
 		{
-			nAbove = pRaw[i - nPitch];
+			throw std::runtime_error("Couldn't uncompress IDAT stream.");
 		}
 
-		unsigned int nLeft = 0;
-		if((i - nDist) < 0)
+		m_nScanlinePosition = nScanlineSize - m_zStream.avail_out;
+		if(m_nScanlinePosition == nScanlineSize)
 		{
-			nLeft = 0;
+			ProcessScanline();
+			m_nScanlinePosition = 0;
 		}
-		else
+		if(result == Z_STREAM_END)
 		{
-			nLeft = pRaw[i - nDist];
+			break;
 		}
+	}
+}
+
+void CPNG::ProcessScanline()
+{
+	uint8* pRow = m_currentScanline.data() + 1;
+	const uint8* pPreviousRow = m_previousScanline.data() + 1;
+	unsigned int nSize = static_cast<unsigned int>(m_currentScanline.size() - 1);
+	//Filters work on bytes for bit depths lower than 8
+	unsigned int nPixelSize = std::max<unsigned int>(1, m_IHDR.GetBitsPerPixel() / 8);
 
-		uint8 nPredictor = (uint8)((nLeft + nAbove) / 2);
-		pRaw[i] += nPredictor;
+	switch(m_currentScanline[0])
+	{
+	case 0x00:
+		break;
+	case 0x01:
+		SubFilter(pRow, nSize, nPixelSize);
+		break;
+	case 0x02:
+		UpFilter(pRow, pPreviousRow, nSize);
+		break;
+	case 0x03:
+		AverageFilter(pRow, pPreviousRow, nSize, nPixelSize);
+		break;
+	case 0x04:
+		PaethFilter(pRow, pPreviousRow, nSize, nPixelSize);
+		break;
+	default:
+		throw std::runtime_error("Invalid PNG filter type.");
+		break;
+	}
+
+	uint8* pDst = m_output.GetRow(m_nScanlineIndex);
+	if(m_IHDR.m_nColorType == 3)
+	{
+		ExpandPalette(pRow, pDst);
+	}
+	else
+	{
+		unsigned int nRowSize = ((m_output.GetWidth() * m_output.GetBitsPerPixel()) + 7) / 8;
+		memcpy(pDst, pRow, std::min<unsigned int>(nSize, nRowSize));
+	}
+
+	//Decoded scanline is the reference for the next one
+	std::swap(m_currentScanline, m_previousScanline);
+	m_nScanlineIndex++;
+}
+
+void CPNG::SubFilter(uint8* pRow, unsigned int nSize, unsigned int nPixelSize)
+{
+#if !defined(FRAMEWORK_SIMD_USE_SCALAR)
+	if(DispatchFilter<SubFilterRunner>(nPixelSize, pRow, nSize)) return;
+#endif
+	for(unsigned int i = nPixelSize; i < nSize; i++)
+	{
+		pRow[i] += pRow[i - nPixelSize];
+	}
+}
+
+void CPNG::UpFilter(uint8* pRow, const uint8* pPreviousRow, unsigned int nSize)
+{
+#if !defined(FRAMEWORK_SIMD_USE_SCALAR)
+	UpFilterSimd(pRow, pPreviousRow, nSize);
+#else
+	for(unsigned int i = 0; i < nSize; i++)
+	{
+		pRow[i] += pPreviousRow[i];
+	}
+#endif
+}
+
+void CPNG::AverageFilter(uint8* pRow, const uint8* pPreviousRow, unsigned int nSize, unsigned int nPixelSize)
+{
+#if !defined(FRAMEWORK_SIMD_USE_SCALAR)
+	if(DispatchFilter<AverageFilterRunner>(nPixelSize, pRow, pPreviousRow, nSize)) return;
+#endif
+	for(unsigned int i = 0; i < nSize; i++)
+	{
+		unsigned int nLeft = (i >= nPixelSize) ? pRow[i - nPixelSize] : 0;
+		unsigned int nAbove = pPreviousRow[i];
+		pRow[i] += (uint8)((nLeft + nAbove) / 2);
 	}
 }
 
@@ -177,112 +587,41 @@ uint8 CPNG::PaethPredictor(uint8 a, uint8 b, uint8 c)
 	return c;
 }
 
-void CPNG::PaethFilter(uint8* pRaw, int nPitch, unsigned int nScanline, unsigned int nBPP)
+void CPNG::PaethFilter(uint8* pRow, const uint8* pPreviousRow, unsigned int nSize, unsigned int nPixelSize)
 {
-	int nDist = (nBPP / 8);
-
-	for(int i = 0; i < static_cast<int>(nPitch); i++)
+#if !defined(FRAMEWORK_SIMD_USE_SCALAR)
+	if(DispatchFilter<PaethFilterRunner>(nPixelSize, pRow, pPreviousRow, nSize)) return;
+#endif
+	for(unsigned int i = 0; i < nSize; i++)
 	{
-		uint8 nLeft = 0;
-		uint8 nUpperLeft = 0;
-		if((i - nDist) < 0)
-		{
-			nLeft = 0;
-			nUpperLeft = 0;
-		}
-		else
-		{
-			nLeft = pRaw[i - nDist];
-			if(nScanline == 0)
-			{
-				nUpperLeft = 0;
-			}
-			else
-			{
-				nUpperLeft = pRaw[(i - nDist) - nPitch];
-			}
-		}
-
-		uint8 nAbove = 0;
-		if(nScanline == 0)
-		{
-			nAbove = 0;
-		}
-		else
-		{
-			nAbove = pRaw[i - nPitch];
-		}
-		uint8 nPredictor = PaethPredictor(nLeft, nAbove, nUpperLeft);
-		pRaw[i] += nPredictor;
+		uint8 nLeft = (i >= nPixelSize) ? pRow[i - nPixelSize] : 0;
+		uint8 nUpperLeft = (i >= nPixelSize) ? pPreviousRow[i - nPixelSize] : 0;
+		uint8 nAbove = pPreviousRow[i];
+		pRow[i] += PaethPredictor(nLeft, nAbove, nUpperLeft);
 	}
 }
 
-CBitmap CPNG::CreateBitmap()
+void CPNG::ExpandPalette(const uint8* pSrc, uint8* pDst) const
 {
-	unsigned int nBPP = m_IHDR.GetSamplesPerPixel() * m_IHDR.m_nDepth;
-
-	CBitmap bitmap = CBitmap(m_IHDR.m_nWidth, m_IHDR.m_nHeight, nBPP);
-
-	uint8* pSrc = m_pBuffer;
-	uint8* pDst = bitmap.GetPixels();
+	unsigned int nDepth = m_IHDR.m_nDepth;
+	unsigned int nMask = (1 << nDepth) - 1;
 
-	unsigned int nScanBits = nBPP * m_IHDR.m_nWidth;
-	unsigned int nScanSize = (nScanBits + 7) / 8;
-
-	for(unsigned int i = 0; i < m_IHDR.m_nHeight; i++)
-	{
-		memcpy(pDst, pSrc + 1, nScanSize);
-		switch(pSrc[0])
-		{
-		case 0x00:
-			break;
-		case 0x01:
-			SubFilter(pDst, nScanSize, i, nBPP);
-			break;
-		case 0x02:
-			UpFilter(pDst, nScanSize, i, nBPP);
-			break;
-		case 0x03:
-			AverageFilter(pDst, nScanSize, i, nBPP);
-			break;
-		case 0x04:
-			PaethFilter(pDst, nScanSize, i, nBPP);
-			break;
-		default:
-			assert(0);
-			break;
-		}
-
-		pSrc += nScanSize + 1;
-		pDst += nScanSize;
-	}
-
-	if(m_IHDR.m_nColorType == 3)
+	if(nDepth == 8)
 	{
-		bitmap = ConvertTo32(bitmap);
+		PixelConvert::ExpandPalette8(pDst, pSrc, m_IHDR.m_nWidth, m_nPalette32);
+		return;
 	}
 
-	return bitmap;
-}
-
-CBitmap CPNG::ConvertTo32(const CBitmap& srcBitmap) const
-{
-	CBitmap dstBitmap = CBitmap(srcBitmap.GetWidth(), srcBitmap.GetHeight(), 32);
-	unsigned int nPixels = srcBitmap.GetWidth() * srcBitmap.GetHeight();
-
-	uint8* pDst = dstBitmap.GetPixels();
-	uint8* pSrc = srcBitmap.GetPixels();
-	
-	for(unsigned int i = 0, j = 0; i < nPixels; i++, j += 4)
+	for(unsigned int i = 0, j = 0; i < m_IHDR.m_nWidth; i++, j += 4)
 	{
-		unsigned int nColor = pSrc[i] * 3;
+		unsigned int nBit = i * nDepth;
+		unsigned int nIndex = (pSrc[nBit / 8] >> (8 - nDepth - (nBit % 8))) & nMask;
+		unsigned int nColor = nIndex * 3;
 		pDst[j + 0] = m_nPalette[nColor + 0];
 		pDst[j + 1] = m_nPalette[nColor + 1];
 		pDst[j + 2] = m_nPalette[nColor + 2];
 		pDst[j + 3] = 0;
 	}
-
-	return dstBitmap;
 }
 
 void CPNG::CIHDR::Unserialize(CStream& pStream)
@@ -314,15 +653,386 @@ unsigned int CPNG::CIHDR::GetSamplesPerPixel()
 		return 4;
 		break;
 	}
-	assert(0);
-	return 0;
+	throw std::runtime_error("Invalid PNG color type.");
 }
 
-unsigned int CPNG::CIHDR::CalculateNeededBufferSize()
+unsigned int CPNG::CIHDR::GetBitsPerPixel()
 {
-	unsigned int nBitsPerPixel = (GetSamplesPerPixel() * m_nDepth);
-	unsigned int nScanline = (nBitsPerPixel * m_nWidth) / 8;
-	if((nBitsPerPixel * m_nWidth) % 8) nScanline++;
-	nScanline++;
-	return (nScanline * m_nHeight);
+	return GetSamplesPerPixel() * m_nDepth;
+}
+
+unsigned int CPNG::CIHDR::GetScanlineSize()
+{
+	return ((GetBitsPerPixel() * m_nWidth) + 7) / 8;
+}
+
+namespace
+{
+	enum
+	{
+		FILTER_COUNT = 5,
+	};
+
+	uint8 PredictPaeth(uint8 a, uint8 b, uint8 c)
+	{
+		int p = a + b - c;
+		int pa = abs(p - a);
+		int pb = abs(p - b);
+		int pc = abs(p - c);
+
+		if((pa <= pb) && (pa <= pc)) return a;
+		if((pb <= pc)) return b;
+		return c;
+	}
+
+	//Forward filters only depend on unfiltered data. Rows are preceded by pixelSize bytes
+	//of zero padding, which allows left neighbours to be loaded without special cases.
+	void ForwardFiltersScalar(uint8* const* outputs, const uint8* row, const uint8* previousRow, unsigned int start, unsigned int size, unsigned int pixelSize)
+	{
+		const uint8* left = row - pixelSize;
+		const uint8* upperLeft = previousRow - pixelSize;
+		for(unsigned int i = start; i < size; i++)
+		{
+			uint8 x = row[i];
+			uint8 a = left[i];
+			uint8 b = previousRow[i];
+			uint8 c = upperLeft[i];
+			outputs[0][i] = x;
+			outputs[1][i] = x - a;
+			outputs[2][i] = x - b;
+			outputs[3][i] = x - static_cast<uint8>((a + b) / 2);
+			outputs[4][i] = x - PredictPaeth(a, b, c);
+		}
+	}
+
+	uint64 SumAbsScalar(const uint8* values, unsigned int start, unsigned int size)
+	{
+		uint64 result = 0;
+		for(unsigned int i = start; i < size; i++)
+		{
+			result += abs(static_cast<int8>(values[i]));
+		}
+		return result;
+	}
+
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+
+	__m128i PaethPredictSimd(__m128i a, __m128i b, __m128i c)
+	{
+		__m128i pa = _mm_sub_epi16(b, c);
+		__m128i pb = _mm_sub_epi16(a, c);
+		__m128i pc = Abs16(_mm_add_epi16(pa, pb));
+		pa = Abs16(pa);
+		pb = Abs16(pb);
+
+		__m128i smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+		return Select(_mm_cmpeq_epi16(pa, smallest), a, Select(_mm_cmpeq_epi16(pb, smallest), b, c));
+	}
+
+	void ForwardFilters(uint8* const* outputs, const uint8* row, const uint8* previousRow, unsigned int size, unsigned int pixelSize)
+	{
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i one = _mm_set1_epi8(1);
+		unsigned int i = 0;
+		for(; (i + 16) <= size; i += 16)
+		{
+			__m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+			__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i - pixelSize));
+			__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(previousRow + i));
+			__m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(previousRow + i - pixelSize));
+
+			__m128i average = _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), one));
+			__m128i paethLo = PaethPredictSimd(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero), _mm_unpacklo_epi8(c, zero));
+			__m128i paethHi = PaethPredictSimd(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero), _mm_unpackhi_epi8(c, zero));
+
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(outputs[0] + i), x);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(outputs[1] + i), _mm_sub_epi8(x, a));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(outputs[2] + i), _mm_sub_epi8(x, b));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(outputs[3] + i), _mm_sub_epi8(x, average));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(outputs[4] + i), _mm_sub_epi8(x, _mm_packus_epi16(paethLo, paethHi)));
+		}
+		ForwardFiltersScalar(outputs, row, previousRow, i, size, pixelSize);
+	}
+
+	uint64 SumAbs(const uint8* values, unsigned int size)
+	{
+		const __m128i zero = _mm_setzero_si128();
+		__m128i sums = zero;
+		unsigned int i = 0;
+		for(; (i + 16) <= size; i += 16)
+		{
+			__m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i));
+			//|value| as a signed byte, -128 maps to 128
+			__m128i absValue = _mm_min_epu8(value, _mm_sub_epi8(zero, value));
+			sums = _mm_add_epi64(sums, _mm_sad_epu8(absValue, zero));
+		}
+		uint64 partialSums[2];
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(partialSums), sums);
+		return partialSums[0] + partialSums[1] + SumAbsScalar(values, i, size);
+	}
+
+#elif defined(FRAMEWORK_SIMD_USE_NEON)
+
+	uint8x8_t PaethPredictSimd(uint8x8_t a, uint8x8_t b, uint8x8_t c)
+	{
+		uint16x8_t pa = vabdl_u8(b, c);
+		uint16x8_t pb = vabdl_u8(a, c);
+		uint16x8_t pc = vabdq_u16(vaddl_u8(a, b), vaddl_u8(c, c));
+
+		uint8x8_t useA = vmovn_u16(vandq_u16(vcleq_u16(pa, pb), vcleq_u16(pa, pc)));
+		uint8x8_t useB = vmovn_u16(vcleq_u16(pb, pc));
+		return vbsl_u8(useA, a, vbsl_u8(useB, b, c));
+	}
+
+	void ForwardFilters(uint8* const* outputs, const uint8* row, const uint8* previousRow, unsigned int size, unsigned int pixelSize)
+	{
+		unsigned int i = 0;
+		for(; (i + 16) <= size; i += 16)
+		{
+			uint8x16_t x = vld1q_u8(row + i);
+			uint8x16_t a = vld1q_u8(row + i - pixelSize);
+			uint8x16_t b = vld1q_u8(previousRow + i);
+			uint8x16_t c = vld1q_u8(previousRow + i - pixelSize);
+
+			uint8x16_t paeth = vcombine_u8(
+				PaethPredictSimd(vget_low_u8(a), vget_low_u8(b), vget_low_u8(c)),
+				PaethPredictSimd(vget_high_u8(a), vget_high_u8(b), vget_high_u8(c)));
+
+			vst1q_u8(outputs[0] + i, x);
+			vst1q_u8(outputs[1] + i, vsubq_u8(x, a));
+			vst1q_u8(outputs[2] + i, vsubq_u8(x, b));
+			vst1q_u8(outputs[3] + i, vsubq_u8(x, vhaddq_u8(a, b)));
+			vst1q_u8(outputs[4] + i, vsubq_u8(x, paeth));
+		}
+		ForwardFiltersScalar(outputs, row, previousRow, i, size, pixelSize);
+	}
+
+	uint64 SumAbs(const uint8* values, unsigned int size)
+	{
+		uint32x4_t sums = vdupq_n_u32(0);
+		unsigned int i = 0;
+		for(; (i + 16) <= size; i += 16)
+		{
+			uint8x16_t absValue = vreinterpretq_u8_s8(vabsq_s8(vreinterpretq_s8_u8(vld1q_u8(values + i))));
+			sums = vpadalq_u16(sums, vpaddlq_u8(absValue));
+		}
+		uint64x2_t totals = vpaddlq_u32(sums);
+		return vgetq_lane_u64(totals, 0) + vgetq_lane_u64(totals, 1) + SumAbsScalar(values, i, size);
+	}
+
+#else
+
+	void ForwardFilters(uint8* const* outputs, const uint8* row, const uint8* previousRow, unsigned int size, unsigned int pixelSize)
+	{
+		ForwardFiltersScalar(outputs, row, previousRow, 0, size, pixelSize);
+	}
+
+	uint64 SumAbs(const uint8* values, unsigned int size)
+	{
+		return SumAbsScalar(values, 0, size);
+	}
+
+#endif
+
+	//Filters rows [firstRow, lastRow) using the minimum sum of absolute differences heuristic
+	void FilterRows(const CBitmap& bitmap, uint8* output, unsigned int firstRow, unsigned int lastRow)
+	{
+		unsigned int pixelSize = bitmap.GetPixelSize();
+		unsigned int rowSize = bitmap.GetWidth() * pixelSize;
+		std::vector<uint8> currentRow(pixelSize + rowSize, 0);
+		std::vector<uint8> previousRow(pixelSize + rowSize, 0);
+		std::vector<uint8> candidates(FILTER_COUNT * rowSize);
+		uint8* outputs[FILTER_COUNT];
+		for(unsigned int i = 0; i < FILTER_COUNT; i++)
+		{
+			outputs[i] = candidates.data() + i * rowSize;
+		}
+
+		if(firstRow != 0)
+		{
+			memcpy(previousRow.data() + pixelSize, bitmap.GetPixels() + (firstRow - 1) * bitmap.GetPitch(), rowSize);
+		}
+
+		for(unsigned int y = firstRow; y < lastRow; y++)
+		{
+			memcpy(currentRow.data() + pixelSize, bitmap.GetPixels() + y * bitmap.GetPitch(), rowSize);
+			ForwardFilters(outputs, currentRow.data() + pixelSize, previousRow.data() + pixelSize, rowSize, pixelSize);
+
+			unsigned int bestFilter = 0;
+			uint64 bestCost = SumAbs(outputs[0], rowSize);
+			for(unsigned int i = 1; i < FILTER_COUNT; i++)
+			{
+				uint64 cost = SumAbs(outputs[i], rowSize);
+				if(cost < bestCost)
+				{
+					bestCost = cost;
+					bestFilter = i;
+				}
+			}
+
+			uint8* outputRow = output + y * (rowSize + 1);
+			outputRow[0] = static_cast<uint8>(bestFilter);
+			memcpy(outputRow + 1, outputs[bestFilter], rowSize);
+
+			std::swap(currentRow, previousRow);
+		}
+	}
+
+	//Compresses a part of the zlib stream as raw deflate data. The preceding window is used as
+	//a dictionary and all chunks but the last end on a byte boundary, thus they can be concatenated.
+	std::vector<uint8> DeflateChunk(const uint8* data, size_t offset, size_t size, size_t windowSize, bool lastChunk)
+	{
+		z_stream zStream;
+		memset(&zStream, 0, sizeof(zStream));
+		if(deflateInit2(&zStream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+		{
+			throw std::runtime_error("zlib stream initialization error.");
+		}
+
+		size_t dictionarySize = std::min(offset, windowSize);
+		if(dictionarySize != 0)
+		{
+			deflateSetDictionary(&zStream, data + offset - dictionarySize, static_cast<uInt>(dictionarySize));
+		}
+
+		std::vector<uint8> output(deflateBound(&zStream, static_cast<uLong>(size)) + 16);
+		zStream.next_in = const_cast<Bytef*>(data + offset);
+		zStream.avail_in = static_cast<uInt>(size);
+		size_t outputSize = 0;
+		while(1)
+		{
+			zStream.next_out = output.data() + outputSize;
+			zStream.avail_out = static_cast<uInt>(output.size() - outputSize);
+			int result = deflate(&zStream, lastChunk ? Z_FINISH : Z_SYNC_FLUSH);
+			outputSize = output.size() - zStream.avail_out;
+			if((result != Z_OK) && (result != Z_STREAM_END) && (result != Z_BUF_ERROR))
+			{
+				deflateEnd(&zStream);
+				throw std::runtime_error("Couldn't compress IDAT stream.");
+			}
+			bool done = lastChunk ? (result == Z_STREAM_END) : ((zStream.avail_in == 0) && (zStream.avail_out != 0));
+			if(done) break;
+			output.resize(output.size() * 2);
+		}
+		deflateEnd(&zStream);
+
+		output.resize(outputSize);
+		return output;
+	}
+
+	void WriteChunk(CStream& stream, uint32 type, const uint8* data, uint32 size)
+	{
+		uint32 typeMSBF = CEndian::ToMSBF32(type);
+		uLong crc = crc32(0, reinterpret_cast<const Bytef*>(&typeMSBF), 4);
+		stream.Write32(CEndian::ToMSBF32(size));
+		stream.Write32(typeMSBF);
+		if(size != 0)
+		{
+			crc = crc32(crc, data, size);
+			stream.Write(data, size);
+		}
+		stream.Write32(CEndian::ToMSBF32(static_cast<uint32>(crc)));
+	}
+}
+
+void CPNG::WriteBitmap(const CBitmap& bitmap, CStream& stream)
+{
+	DoWrite(bitmap, stream, nullptr);
+}
+
+void CPNG::WriteBitmap(const CBitmap& bitmap, CStream& stream, CThreadPool& threadPool)
+{
+	DoWrite(bitmap, stream, &threadPool);
+}
+
+void CPNG::DoWrite(const CBitmap& bitmap, CStream& stream, CThreadPool* threadPool)
+{
+	uint8 colorType = 0;
+	switch(bitmap.GetBitsPerPixel())
+	{
+	case 8:
+		colorType = 0;
+		break;
+	case 24:
+		colorType = 2;
+		break;
+	case 32:
+		colorType = 6;
+		break;
+	default:
+		throw std::runtime_error("Unsupported bit depth.");
+		break;
+	}
+
+	unsigned int width = bitmap.GetWidth();
+	unsigned int height = bitmap.GetHeight();
+	if((width == 0) || (height == 0))
+	{
+		throw std::runtime_error("Invalid image dimensions.");
+	}
+
+	size_t filteredRowSize = (width * bitmap.GetPixelSize()) + 1;
+	std::vector<uint8> filtered(filteredRowSize * height);
+
+	CTaskGroup taskGroup(threadPool);
+	unsigned int rowsPerTask = static_cast<unsigned int>(std::max<size_t>(1, DEFLATE_CHUNK_SIZE / filteredRowSize));
+	for(unsigned int firstRow = 0; firstRow < height; firstRow += rowsPerTask)
+	{
+		unsigned int lastRow = std::min(firstRow + rowsPerTask, height);
+		taskGroup.Run([&bitmap, &filtered, firstRow, lastRow] () { FilterRows(bitmap, filtered.data(), firstRow, lastRow); });
+	}
+	taskGroup.Wait();
+
+	//Chunks are compressed independently, output doesn't depend on the thread pool
+	size_t chunkCount = (filtered.size() + DEFLATE_CHUNK_SIZE - 1) / DEFLATE_CHUNK_SIZE;
+	std::vector<std::vector<uint8>> chunks(chunkCount);
+	std::vector<uLong> checksums(chunkCount);
+	for(size_t i = 0; i < chunkCount; i++)
+	{
+		taskGroup.Run(
+			[&filtered, &chunks, &checksums, i, chunkCount] ()
+			{
+				size_t offset = i * DEFLATE_CHUNK_SIZE;
+				size_t size = std::min<size_t>(DEFLATE_CHUNK_SIZE, filtered.size() - offset);
+				chunks[i] = DeflateChunk(filtered.data(), offset, size, DEFLATE_WINDOW_SIZE, (i + 1) == chunkCount);
+				checksums[i] = adler32(adler32(0, Z_NULL, 0), filtered.data() + offset, static_cast<uInt>(size));
+			});
+	}
+	taskGroup.Wait();
+
+	uLong checksum = checksums[0];
+	for(size_t i = 1; i < chunkCount; i++)
+	{
+		size_t size = std::min<size_t>(DEFLATE_CHUNK_SIZE, filtered.size() - i * DEFLATE_CHUNK_SIZE);
+		checksum = adler32_combine(checksum, checksums[i], static_cast<z_off_t>(size));
+	}
+
+	//zlib header (deflate, 32K window, default compression) and trailer
+	static const uint8 zlibHeader[2] = { 0x78, 0x9C };
+	chunks.front().insert(chunks.front().begin(), zlibHeader, zlibHeader + 2);
+	uint32 checksumMSBF = CEndian::ToMSBF32(static_cast<uint32>(checksum));
+	const uint8* checksumBytes = reinterpret_cast<const uint8*>(&checksumMSBF);
+	chunks.back().insert(chunks.back().end(), checksumBytes, checksumBytes + 4);
+
+	static const uint8 signature[8] = { 0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A };
+	stream.Write(signature, sizeof(signature));
+
+	uint8 header[13];
+	uint32 widthMSBF = CEndian::ToMSBF32(width);
+	uint32 heightMSBF = CEndian::ToMSBF32(height);
+	memcpy(header + 0, &widthMSBF, 4);
+	memcpy(header + 4, &heightMSBF, 4);
+	header[8] = 8;
+	header[9] = colorType;
+	header[10] = 0;
+	header[11] = 0;
+	header[12] = 0;
+	WriteChunk(stream, 0x49484452, header, sizeof(header));
+
+	for(const auto& chunk : chunks)
+	{
+		WriteChunk(stream, 0x49444154, chunk.data(), static_cast<uint32>(chunk.size()));
+	}
+
+	WriteChunk(stream, 0x49454E44, nullptr, 0);
 }
@@ -0,0 +1,377 @@
+#include <cstring>
+#include <algorithm>
+#include "bitmap/PixelConvert.h"
+#include "CpuFeatures.h"
+#include "SimdDefs.h"
+
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+#include <emmintrin.h>
+#if defined(FRAMEWORK_SIMD_HAS_X86_DISPATCH)
+#include <tmmintrin.h>
+#endif
+#elif defined(FRAMEWORK_SIMD_USE_NEON)
+#include <arm_neon.h>
+#endif
+
+using namespace Framework;
+
+namespace
+{
+	typedef void (*ConvertFunction)(uint8*, const uint8*, size_t);
+	typedef void (*AddAlphaFunction)(uint8*, const uint8*, size_t, uint8);
+
+	//(c * a) / 255, rounded
+	uint8 MultiplyAlpha(uint32 color, uint32 alpha)
+	{
+		uint32 value = (color * alpha) + 128;
+		return static_cast<uint8>((value + (value >> 8)) >> 8);
+	}
+
+	//(255 / a) in 16.16 fixed point
+	struct UNPREMULTIPLY_TABLE
+	{
+		UNPREMULTIPLY_TABLE()
+		{
+			values[0] = 0;
+			for(uint32 alpha = 1; alpha < 256; alpha++)
+			{
+				values[alpha] = ((255 << 16) + (alpha / 2)) / alpha;
+			}
+		}
+
+		uint32 values[256];
+	};
+
+	void RGB24ToRGBA32Scalar(uint8* dst, const uint8* src, size_t count, uint8 alpha)
+	{
+		for(size_t i = 0; i < count; i++)
+		{
+			dst[(i * 4) + 0] = src[(i * 3) + 0];
+			dst[(i * 4) + 1] = src[(i * 3) + 1];
+			dst[(i * 4) + 2] = src[(i * 3) + 2];
+			dst[(i * 4) + 3] = alpha;
+		}
+	}
+
+	void RGBA32ToRGB24Scalar(uint8* dst, const uint8* src, size_t count)
+	{
+		for(size_t i = 0; i < count; i++)
+		{
+			dst[(i * 3) + 0] = src[(i * 4) + 0];
+			dst[(i * 3) + 1] = src[(i * 4) + 1];
+			dst[(i * 3) + 2] = src[(i * 4) + 2];
+		}
+	}
+
+	template <unsigned int pixelSize>
+	void SwapRedBlueScalar(uint8* dst, const uint8* src, size_t count)
+	{
+		for(size_t i = 0; i < count; i++)
+		{
+			uint8 red = src[(i * pixelSize) + 0];
+			uint8 blue = src[(i * pixelSize) + 2];
+			dst[(i * pixelSize) + 0] = blue;
+			dst[(i * pixelSize) + 1] = src[(i * pixelSize) + 1];
+			dst[(i * pixelSize) + 2] = red;
+			if(pixelSize == 4)
+			{
+				dst[(i * pixelSize) + 3] = src[(i * pixelSize) + 3];
+			}
+		}
+	}
+
+	void PremultiplyAlphaScalar(uint8* dst, const uint8* src, size_t count)
+	{
+		for(size_t i = 0; i < count; i++)
+		{
+			uint8 alpha = src[(i * 4) + 3];
+			dst[(i * 4) + 0] = MultiplyAlpha(src[(i * 4) + 0], alpha);
+			dst[(i * 4) + 1] = MultiplyAlpha(src[(i * 4) + 1], alpha);
+			dst[(i * 4) + 2] = MultiplyAlpha(src[(i * 4) + 2], alpha);
+			dst[(i * 4) + 3] = alpha;
+		}
+	}
+
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+
+	void SwapRedBlue32Simd(uint8* dst, const uint8* src, size_t count)
+	{
+		const __m128i redBlueMask = _mm_set1_epi32(0x00FF00FF);
+		size_t i = 0;
+		for(; (i + 4) <= count; i += 4)
+		{
+			__m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + (i * 4)));
+			__m128i redBlue = _mm_and_si128(pixels, redBlueMask);
+			__m128i greenAlpha = _mm_andnot_si128(redBlueMask, pixels);
+			redBlue = _mm_or_si128(_mm_slli_epi32(redBlue, 16), _mm_srli_epi32(redBlue, 16));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + (i * 4)), _mm_or_si128(redBlue, greenAlpha));
+		}
+		SwapRedBlueScalar<4>(dst + (i * 4), src + (i * 4), count - i);
+	}
+
+	__m128i PremultiplyPixels(__m128i pixels)
+	{
+		const __m128i rounding = _mm_set1_epi16(128);
+		__m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(pixels, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+		__m128i value = _mm_add_epi16(_mm_mullo_epi16(pixels, alpha), rounding);
+		return _mm_srli_epi16(_mm_add_epi16(value, _mm_srli_epi16(value, 8)), 8);
+	}
+
+	void PremultiplyAlphaSimd(uint8* dst, const uint8* src, size_t count)
+	{
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i alphaMask = _mm_set1_epi32(0xFF000000);
+		size_t i = 0;
+		for(; (i + 4) <= count; i += 4)
+		{
+			__m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + (i * 4)));
+			__m128i lo = PremultiplyPixels(_mm_unpacklo_epi8(pixels, zero));
+			__m128i hi = PremultiplyPixels(_mm_unpackhi_epi8(pixels, zero));
+			__m128i result = _mm_packus_epi16(lo, hi);
+			result = _mm_or_si128(_mm_andnot_si128(alphaMask, result), _mm_and_si128(alphaMask, pixels));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + (i * 4)), result);
+		}
+		PremultiplyAlphaScalar(dst + (i * 4), src + (i * 4), count - i);
+	}
+
+#if defined(FRAMEWORK_SIMD_HAS_X86_DISPATCH)
+
+	FRAMEWORK_SIMD_TARGET_SSSE3 void RGB24ToRGBA32Ssse3(uint8* dst, const uint8* src, size_t count, uint8 alpha)
+	{
+		const __m128i shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+		const __m128i alphaValue = _mm_set1_epi32(static_cast<int32>(static_cast<uint32>(alpha) << 24));
+		size_t i = 0;
+		for(; (i + 16) <= count; i += 16)
+		{
+			const __m128i* input = reinterpret_cast<const __m128i*>(src + (i * 3));
+			__m128i* output = reinterpret_cast<__m128i*>(dst + (i * 4));
+			__m128i in0 = _mm_loadu_si128(input + 0);
+			__m128i in1 = _mm_loadu_si128(input + 1);
+			__m128i in2 = _mm_loadu_si128(input + 2);
+			_mm_storeu_si128(output + 0, _mm_or_si128(_mm_shuffle_epi8(in0, shuffle), alphaValue));
+			_mm_storeu_si128(output + 1, _mm_or_si128(_mm_shuffle_epi8(_mm_alignr_epi8(in1, in0, 12), shuffle), alphaValue));
+			_mm_storeu_si128(output + 2, _mm_or_si128(_mm_shuffle_epi8(_mm_alignr_epi8(in2, in1, 8), shuffle), alphaValue));
+			_mm_storeu_si128(output + 3, _mm_or_si128(_mm_shuffle_epi8(_mm_srli_si128(in2, 4), shuffle), alphaValue));
+		}
+		RGB24ToRGBA32Scalar(dst + (i * 4), src + (i * 3), count - i, alpha);
+	}
+
+	FRAMEWORK_SIMD_TARGET_SSSE3 void RGBA32ToRGB24Ssse3(uint8* dst, const uint8* src, size_t count)
+	{
+		const __m128i shuffle = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+		size_t i = 0;
+		for(; (i + 16) <= count; i += 16)
+		{
+			const __m128i* input = reinterpret_cast<const __m128i*>(src + (i * 4));
+			__m128i* output = reinterpret_cast<__m128i*>(dst + (i * 3));
+			__m128i packed0 = _mm_shuffle_epi8(_mm_loadu_si128(input + 0), shuffle);
+			__m128i packed1 = _mm_shuffle_epi8(_mm_loadu_si128(input + 1), shuffle);
+			__m128i packed2 = _mm_shuffle_epi8(_mm_loadu_si128(input + 2), shuffle);
+			__m128i packed3 = _mm_shuffle_epi8(_mm_loadu_si128(input + 3), shuffle);
+			_mm_storeu_si128(output + 0, _mm_or_si128(packed0, _mm_slli_si128(packed1, 12)));
+			_mm_storeu_si128(output + 1, _mm_or_si128(_mm_srli_si128(packed1, 4), _mm_slli_si128(packed2, 8)));
+			_mm_storeu_si128(output + 2, _mm_or_si128(_mm_srli_si128(packed2, 8), _mm_slli_si128(packed3, 4)));
+		}
+		RGBA32ToRGB24Scalar(dst + (i * 3), src + (i * 4), count - i);
+	}
+
+	FRAMEWORK_SIMD_TARGET_SSSE3 void SwapRedBlue24Ssse3(uint8* dst, const uint8* src, size_t count)
+	{
+		//5 pixels per iteration, last byte is stored unchanged (works in place)
+		const __m128i shuffle = _mm_setr_epi8(2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9, 14, 13, 12, 15);
+		size_t i = 0;
+		for(; ((i + 5) * 3 + 1) <= (count * 3); i += 5)
+		{
+			__m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + (i * 3)));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + (i * 3)), _mm_shuffle_epi8(pixels, shuffle));
+		}
+		SwapRedBlueScalar<3>(dst + (i * 3), src + (i * 3), count - i);
+	}
+
+#endif
+
+#elif defined(FRAMEWORK_SIMD_USE_NEON)
+
+	void RGB24ToRGBA32Simd(uint8* dst, const uint8* src, size_t count, uint8 alpha)
+	{
+		size_t i = 0;
+		for(; (i + 16) <= count; i += 16)
+		{
+			uint8x16x3_t input = vld3q_u8(src + (i * 3));
+			uint8x16x4_t output;
+			output.val[0] = input.val[0];
+			output.val[1] = input.val[1];
+			output.val[2] = input.val[2];
+			output.val[3] = vdupq_n_u8(alpha);
+			vst4q_u8(dst + (i * 4), output);
+		}
+		RGB24ToRGBA32Scalar(dst + (i * 4), src + (i * 3), count - i, alpha);
+	}
+
+	void RGBA32ToRGB24Simd(uint8* dst, const uint8* src, size_t count)
+	{
+		size_t i = 0;
+		for(; (i + 16) <= count; i += 16)
+		{
+			uint8x16x4_t input = vld4q_u8(src + (i * 4));
+			uint8x16x3_t output;
+			output.val[0] = input.val[0];
+			output.val[1] = input.val[1];
+			output.val[2] = input.val[2];
+			vst3q_u8(dst + (i * 3), output);
+		}
+		RGBA32ToRGB24Scalar(dst + (i * 3), src + (i * 4), count - i);
+	}
+
+	void SwapRedBlue24Simd(uint8* dst, const uint8* src, size_t count)
+	{
+		size_t i = 0;
+		for(; (i + 16) <= count; i += 16)
+		{
+			uint8x16x3_t pixels = vld3q_u8(src + (i * 3));
+			std::swap(pixels.val[0], pixels.val[2]);
+			vst3q_u8(dst + (i * 3), pixels);
+		}
+		SwapRedBlueScalar<3>(dst + (i * 3), src + (i * 3), count - i);
+	}
+
+	void SwapRedBlue32Simd(uint8* dst, const uint8* src, size_t count)
+	{
+		size_t i = 0;
+		for(; (i + 16) <= count; i += 16)
+		{
+			uint8x16x4_t pixels = vld4q_u8(src + (i * 4));
+			std::swap(pixels.val[0], pixels.val[2]);
+			vst4q_u8(dst + (i * 4), pixels);
+		}
+		SwapRedBlueScalar<4>(dst + (i * 4), src + (i * 4), count - i);
+	}
+
+	uint8x8_t MultiplyAlphaSimd(uint8x8_t color, uint8x8_t alpha)
+	{
+		uint16x8_t value = vmull_u8(color, alpha);
+		return vraddhn_u16(value, vrshrq_n_u16(value, 8));
+	}
+
+	void PremultiplyAlphaSimd(uint8* dst, const uint8* src, size_t count)
+	{
+		size_t i = 0;
+		for(; (i + 16) <= count; i += 16)
+		{
+			uint8x16x4_t pixels = vld4q_u8(src + (i * 4));
+			uint8x16_t alpha = pixels.val[3];
+			for(unsigned int c = 0; c < 3; c++)
+			{
+				pixels.val[c] = vcombine_u8(
+					MultiplyAlphaSimd(vget_low_u8(pixels.val[c]), vget_low_u8(alpha)),
+					MultiplyAlphaSimd(vget_high_u8(pixels.val[c]), vget_high_u8(alpha)));
+			}
+			vst4q_u8(dst + (i * 4), pixels);
+		}
+		PremultiplyAlphaScalar(dst + (i * 4), src + (i * 4), count - i);
+	}
+
+#endif
+
+#if defined(FRAMEWORK_SIMD_HAS_X86_DISPATCH)
+	template <typename FunctionType>
+	FunctionType SelectKernel(FunctionType fallback, FunctionType ssse3Kernel)
+	{
+		CKernelDispatcher<FunctionType> dispatcher(fallback);
+		dispatcher.Register(CCpuFeatures::FEATURE_SSSE3, ssse3Kernel);
+		return dispatcher.Get();
+	}
+#endif
+}
+
+void PixelConvert::RGB24ToRGBA32(uint8* dst, const uint8* src, size_t count, uint8 alpha)
+{
+#if defined(FRAMEWORK_SIMD_HAS_X86_DISPATCH)
+	static const AddAlphaFunction function = SelectKernel<AddAlphaFunction>(&RGB24ToRGBA32Scalar, &RGB24ToRGBA32Ssse3);
+	function(dst, src, count, alpha);
+#elif defined(FRAMEWORK_SIMD_USE_NEON)
+	RGB24ToRGBA32Simd(dst, src, count, alpha);
+#else
+	RGB24ToRGBA32Scalar(dst, src, count, alpha);
+#endif
+}
+
+void PixelConvert::RGBA32ToRGB24(uint8* dst, const uint8* src, size_t count)
+{
+#if defined(FRAMEWORK_SIMD_HAS_X86_DISPATCH)
+	static const ConvertFunction function = SelectKernel<ConvertFunction>(&RGBA32ToRGB24Scalar, &RGBA32ToRGB24Ssse3);
+	function(dst, src, count);
+#elif defined(FRAMEWORK_SIMD_USE_NEON)
+	RGBA32ToRGB24Simd(dst, src, count);
+#else
+	RGBA32ToRGB24Scalar(dst, src, count);
+#endif
+}
+
+void PixelConvert::SwapRedBlue24(uint8* dst, const uint8* src, size_t count)
+{
+#if defined(FRAMEWORK_SIMD_HAS_X86_DISPATCH)
+	static const ConvertFunction function = SelectKernel<ConvertFunction>(&SwapRedBlueScalar<3>, &SwapRedBlue24Ssse3);
+	function(dst, src, count);
+#elif defined(FRAMEWORK_SIMD_USE_NEON)
+	SwapRedBlue24Simd(dst, src, count);
+#else
+	SwapRedBlueScalar<3>(dst, src, count);
+#endif
+}
+
+void PixelConvert::SwapRedBlue32(uint8* dst, const uint8* src, size_t count)
+{
+#if !defined(FRAMEWORK_SIMD_USE_SCALAR)
+	SwapRedBlue32Simd(dst, src, count);
+#else
+	SwapRedBlueScalar<4>(dst, src, count);
+#endif
+}
+
+void PixelConvert::PremultiplyAlpha(uint8* dst, const uint8* src, size_t count)
+{
+#if !defined(FRAMEWORK_SIMD_USE_SCALAR)
+	PremultiplyAlphaSimd(dst, src, count);
+#else
+	PremultiplyAlphaScalar(dst, src, count);
+#endif
+}
+
+void PixelConvert::UnpremultiplyAlpha(uint8* dst, const uint8* src, size_t count)
+{
+	//Needs a division per pixel, done with a reciprocal table. Opaque pixels are common and skip it.
+	static const UNPREMULTIPLY_TABLE table;
+	for(size_t i = 0; i < count; i++)
+	{
+		uint32 pixel = 0;
+		memcpy(&pixel, src + (i * 4), 4);
+		uint8 alpha = src[(i * 4) + 3];
+		if(alpha != 0xFF)
+		{
+			uint32 factor = table.values[alpha];
+			uint8* output = reinterpret_cast<uint8*>(&pixel);
+			for(unsigned int c = 0; c < 3; c++)
+			{
+				uint32 value = ((src[(i * 4) + c] * factor) + 0x8000) >> 16;
+				output[c] = static_cast<uint8>(std::min<uint32>(value, 0xFF));
+			}
+		}
+		memcpy(dst + (i * 4), &pixel, 4);
+	}
+}
+
+void PixelConvert::ExpandPalette8(uint8* dst, const uint8* src, size_t count, const uint32* palette)
+{
+	//No fast gather on the base instruction sets, unrolled lookups are as good as it gets
+	size_t i = 0;
+	for(; (i + 4) <= count; i += 4)
+	{
+		uint32 colors[4] = { palette[src[i + 0]], palette[src[i + 1]], palette[src[i + 2]], palette[src[i + 3]] };
+		memcpy(dst + (i * 4), colors, sizeof(colors));
+	}
+	for(; i < count; i++)
+	{
+		memcpy(dst + (i * 4), &palette[src[i]], 4);
+	}
+}
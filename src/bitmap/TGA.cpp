@@ -1,53 +1,192 @@
 #include "bitmap/TGA.h"
+#include "bitmap/PixelConvert.h"
+#include <algorithm>
+#include <cstring>
 #include <stdexcept>
-#include <cassert>
-#include "maybe_unused.h"
+#include <vector>
 
 using namespace Framework;
 
 Framework::CBitmap CTGA::ReadBitmap(CStream& stream)
 {
 	TGA_HEADER header;
-	stream.Read(&header, sizeof(TGA_HEADER));
+	if(stream.Read(&header, sizeof(TGA_HEADER)) != sizeof(TGA_HEADER))
+	{
+		throw std::runtime_error("Invalid TGA header.");
+	}
 
-	if(header.imageType != 0x02)
+	unsigned int imageType = header.imageType & ~TGA_IMAGE_RLE;
+	bool isRle = (header.imageType & TGA_IMAGE_RLE) != 0;
+	bool isColorMapped = (imageType == TGA_IMAGE_COLORMAPPED);
+	bool supported = false;
+	switch(imageType)
 	{
-		throw std::runtime_error("Unsupported TGA file.");
+	case TGA_IMAGE_COLORMAPPED:
+		supported = (header.bits == 8) && (header.colorMapType == 1) && ((header.colorMapBits == 24) || (header.colorMapBits == 32));
+		break;
+	case TGA_IMAGE_RGB:
+		supported = (header.bits == 24) || (header.bits == 32);
+		break;
+	case TGA_IMAGE_GRAYSCALE:
+		supported = (header.bits == 8);
+		break;
 	}
-	
-	if(header.bits != 32)
+	if(!supported || (header.width <= 0) || (header.height <= 0) || (header.descriptor & TGA_DESCRIPTOR_RIGHT_ORIGIN))
 	{
 		throw std::runtime_error("Unsupported TGA file.");
 	}
 
-	bool originIsTop = (header.descriptor & 0x20) != 0;
-	FRAMEWORK_MAYBE_UNUSED bool originIsRight = (header.descriptor & 0x10) != 0;
+	stream.Seek(header.idSize, STREAM_SEEK_CUR);
+
+	//Map entries are stored as BGR(A), converted to RGBA for the expansion
+	uint32 palette[256] = {};
+	if(header.colorMapType == 1)
+	{
+		unsigned int entrySize = (header.colorMapBits + 7) / 8;
+		if(!isColorMapped)
+		{
+			stream.Seek(header.colorMapLength * entrySize, STREAM_SEEK_CUR);
+		}
+		else
+		{
+			std::vector<uint8> entries(header.colorMapLength * entrySize);
+			if(stream.Read(entries.data(), entries.size()) != entries.size())
+			{
+				throw std::runtime_error("Unexpected end of file.");
+			}
+			for(int i = 0; i < header.colorMapLength; i++)
+			{
+				int index = header.colorMapStart + i;
+				if((index < 0) || (index >= 256)) continue;
+				const uint8* entry = entries.data() + (i * entrySize);
+				uint8 alpha = (entrySize == 4) ? entry[3] : 0xFF;
+				palette[index] = (entry[2] << 0) | (entry[1] << 8) | (entry[0] << 16) | (alpha << 24);
+			}
+		}
+	}
+
+	unsigned int width = header.width;
+	unsigned int height = header.height;
+	unsigned int pixelSize = header.bits / 8;
+	size_t pixelCount = static_cast<size_t>(width) * height;
 
-	assert(!originIsRight);
+	CBitmap bitmap(width, height, isColorMapped ? 32 : header.bits);
 
-	CBitmap bitmap(header.width, header.height, 32);
+	//Indices are expanded afterwards, everything else is decoded in place
+	std::vector<uint8> indices;
+	uint8* pixels = bitmap.GetPixels();
+	if(isColorMapped)
+	{
+		indices.resize(pixelCount);
+		pixels = indices.data();
+	}
 
-	if(originIsTop)
+	if(isRle)
 	{
-		stream.Read(bitmap.GetPixels(), bitmap.GetPixelsSize());
+		DecodeRle(stream, pixels, pixelCount, pixelSize);
 	}
-	else
+	else if(stream.Read(pixels, pixelCount * pixelSize) != (pixelCount * pixelSize))
 	{
-		for(unsigned int y = 0; y < header.height; y++)
-		{
-			uint8* dstLinePtr = bitmap.GetPixels() + bitmap.GetPitch() * (header.height - y - 1);
-			stream.Read(dstLinePtr, bitmap.GetPitch());
-		}
+		throw std::runtime_error("Unexpected end of file.");
 	}
 
+	if(isColorMapped)
 	{
-		uint8* pixelsPtr = bitmap.GetPixels();
-		for(unsigned int i = 0; i < bitmap.GetPixelsSize() / 4; i++)
-		{
-			std::swap(pixelsPtr[0], pixelsPtr[2]);
-			pixelsPtr += 4;
-		}
+		PixelConvert::ExpandPalette8(bitmap.GetPixels(), indices.data(), pixelCount, palette);
+	}
+	if(!(header.descriptor & TGA_DESCRIPTOR_TOP_ORIGIN))
+	{
+		bitmap.FlipVerticalInPlace();
+	}
+	if(header.bits == 24)
+	{
+		PixelConvert::SwapRedBlue24(bitmap.GetPixels(), bitmap.GetPixels(), pixelCount);
+	}
+	else if((header.bits == 32) && !isColorMapped)
+	{
+		PixelConvert::SwapRedBlue32(bitmap.GetPixels(), bitmap.GetPixels(), pixelCount);
 	}
 
 	return bitmap;
 }
+
+CImageProbe::INFO CTGA::ReadInfo(CStream& stream)
+{
+	TGA_HEADER header;
+	if(stream.Read(&header, sizeof(TGA_HEADER)) != sizeof(TGA_HEADER))
+	{
+		throw std::runtime_error("Invalid TGA header.");
+	}
+
+	//Color mapped, true color and grayscale images, uncompressed or RLE
+	unsigned int imageType = header.imageType & ~0x08;
+	bool validType = (imageType >= 1) && (imageType <= 3);
+	bool validBits = (header.bits == 8) || (header.bits == 15) || (header.bits == 16) || (header.bits == 24) || (header.bits == 32);
+	if(!validType || !validBits || (header.colorMapType > 1) || (header.width == 0) || (header.height == 0))
+	{
+		throw std::runtime_error("Invalid TGA header.");
+	}
+
+	CImageProbe::INFO info;
+	info.format = CImageProbe::FORMAT_TGA;
+	info.width = static_cast<uint16>(header.width);
+	info.height = static_cast<uint16>(header.height);
+	info.bitsPerPixel = header.bits;
+	return info;
+}
+
+//Packets hold either a pixel repeated or a run of pixels, they can go over the end of a row
+void CTGA::DecodeRle(CStream& stream, uint8* pixels, size_t pixelCount, unsigned int pixelSize)
+{
+	uint8 buffer[RLE_READ_SIZE];
+	size_t bufferPosition = 0;
+	size_t bufferSize = 0;
+	auto read =
+		[&] (uint8* dst, size_t size)
+		{
+			while(size != 0)
+			{
+				if(bufferPosition == bufferSize)
+				{
+					bufferSize = static_cast<size_t>(stream.Read(buffer, RLE_READ_SIZE));
+					bufferPosition = 0;
+					if(bufferSize == 0)
+					{
+						throw std::runtime_error("Unexpected end of file.");
+					}
+				}
+				size_t copySize = std::min(size, bufferSize - bufferPosition);
+				memcpy(dst, buffer + bufferPosition, copySize);
+				bufferPosition += copySize;
+				dst += copySize;
+				size -= copySize;
+			}
+		};
+
+	size_t position = 0;
+	while(position != pixelCount)
+	{
+		uint8 packet = 0;
+		read(&packet, 1);
+		size_t count = std::min<size_t>((packet & 0x7F) + 1, pixelCount - position);
+		uint8* dst = pixels + (position * pixelSize);
+		if(packet & 0x80)
+		{
+			//Pixel is copied over what was already filled, doubling each time
+			read(dst, pixelSize);
+			size_t filledSize = pixelSize;
+			size_t runSize = count * pixelSize;
+			while(filledSize != runSize)
+			{
+				size_t copySize = std::min(filledSize, runSize - filledSize);
+				memcpy(dst + filledSize, dst, copySize);
+				filledSize += copySize;
+			}
+		}
+		else
+		{
+			read(dst, count * pixelSize);
+		}
+		position += count;
+	}
+}
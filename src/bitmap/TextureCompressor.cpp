@@ -0,0 +1,907 @@
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+#include "bitmap/TextureCompressor.h"
+#include "TaskGroup.h"
+#include "SimdDefs.h"
+
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+#include <emmintrin.h>
+#elif defined(FRAMEWORK_SIMD_USE_NEON)
+#include <arm_neon.h>
+#endif
+
+using namespace Framework;
+
+namespace
+{
+	//RGBA pixels of a 4x4 block, in raster order
+	typedef uint8 BLOCK[16][4];
+
+	const unsigned int g_bc7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	//Pixel index values 0 to 3 select +small, +large, -small and -large
+	const int g_etcModifiers[8][2] =
+	{
+		{ 2, 8 }, { 5, 17 }, { 9, 29 }, { 13, 42 }, { 18, 60 }, { 24, 80 }, { 33, 106 }, { 47, 183 }
+	};
+
+	const int g_eacModifiers[16][8] =
+	{
+		{ -3, -6, -9, -15, 2, 5, 8, 14 },
+		{ -3, -7, -10, -13, 2, 6, 9, 12 },
+		{ -2, -5, -8, -13, 1, 4, 7, 12 },
+		{ -2, -4, -6, -13, 1, 3, 5, 12 },
+		{ -3, -6, -8, -12, 2, 5, 7, 11 },
+		{ -3, -7, -9, -11, 2, 6, 8, 10 },
+		{ -4, -7, -8, -11, 3, 6, 7, 10 },
+		{ -3, -5, -8, -11, 2, 4, 7, 10 },
+		{ -2, -6, -8, -10, 1, 5, 7, 9 },
+		{ -2, -5, -8, -10, 1, 4, 7, 9 },
+		{ -2, -4, -8, -10, 1, 3, 7, 9 },
+		{ -2, -5, -7, -10, 1, 4, 6, 9 },
+		{ -3, -4, -7, -10, 2, 3, 6, 9 },
+		{ -1, -2, -3, -10, 0, 1, 2, 9 },
+		{ -4, -6, -8, -9, 3, 5, 7, 8 },
+		{ -3, -5, -7, -9, 2, 4, 6, 8 },
+	};
+
+	uint8 ClampSample(int32 value)
+	{
+		return static_cast<uint8>(std::min<int32>(std::max<int32>(value, 0), 255));
+	}
+
+	uint8 QuantizeSample(float value, unsigned int maxValue)
+	{
+		int32 result = static_cast<int32>(lroundf(value * static_cast<float>(maxValue) / 255.f));
+		return static_cast<uint8>(std::min<int32>(std::max<int32>(result, 0), maxValue));
+	}
+
+	void ReadBlock(const CBitmap& bitmap, unsigned int blockX, unsigned int blockY, BLOCK& block)
+	{
+		//Pixels outside of the bitmap repeat the last row/column
+		unsigned int pixelSize = bitmap.GetPixelSize();
+		for(unsigned int y = 0; y < 4; y++)
+		{
+			unsigned int srcY = std::min(blockY * 4 + y, bitmap.GetHeight() - 1);
+			const uint8* row = bitmap.GetPixels() + srcY * bitmap.GetPitch();
+			for(unsigned int x = 0; x < 4; x++)
+			{
+				unsigned int srcX = std::min(blockX * 4 + x, bitmap.GetWidth() - 1);
+				const uint8* pixel = row + srcX * pixelSize;
+				uint8* output = block[y * 4 + x];
+				output[0] = pixel[0];
+				output[1] = pixel[1];
+				output[2] = pixel[2];
+				output[3] = (pixelSize == 4) ? pixel[3] : 0xFF;
+			}
+		}
+	}
+
+	//Finds the closest palette entry to every pixel, returns the total squared error.
+	//Pixel count needs to be a multiple of 4, alpha is ignored if useAlpha isn't set.
+	uint32 SelectIndices(const uint8 (*pixels)[4], unsigned int pixelCount, const uint8 (*palette)[4], unsigned int paletteSize, bool useAlpha, uint8* indices)
+	{
+		assert((pixelCount % 4) == 0);
+		uint32 totalError = 0;
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i channelMask = useAlpha ? _mm_set1_epi32(-1) : _mm_set_epi16(0, -1, -1, -1, 0, -1, -1, -1);
+		for(unsigned int i = 0; i < pixelCount; i += 4)
+		{
+			__m128i group = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels[i]));
+			__m128i groupLo = _mm_unpacklo_epi8(group, zero);
+			__m128i groupHi = _mm_unpackhi_epi8(group, zero);
+			__m128i bestErrors = _mm_set1_epi32(INT32_MAX);
+			__m128i bestIndices = zero;
+			for(unsigned int j = 0; j < paletteSize; j++)
+			{
+				int32 color = 0;
+				memcpy(&color, palette[j], 4);
+				__m128i entry = _mm_unpacklo_epi8(_mm_set1_epi32(color), zero);
+				__m128i diffLo = _mm_and_si128(_mm_sub_epi16(groupLo, entry), channelMask);
+				__m128i diffHi = _mm_and_si128(_mm_sub_epi16(groupHi, entry), channelMask);
+				//Each pixel gives two partial sums (RG and BA), add them together
+				__m128 sumsLo = _mm_castsi128_ps(_mm_madd_epi16(diffLo, diffLo));
+				__m128 sumsHi = _mm_castsi128_ps(_mm_madd_epi16(diffHi, diffHi));
+				__m128i errors = _mm_add_epi32(
+					_mm_castps_si128(_mm_shuffle_ps(sumsLo, sumsHi, _MM_SHUFFLE(2, 0, 2, 0))),
+					_mm_castps_si128(_mm_shuffle_ps(sumsLo, sumsHi, _MM_SHUFFLE(3, 1, 3, 1))));
+				__m128i isBetter = _mm_cmplt_epi32(errors, bestErrors);
+				bestErrors = _mm_or_si128(_mm_and_si128(isBetter, errors), _mm_andnot_si128(isBetter, bestErrors));
+				bestIndices = _mm_or_si128(_mm_and_si128(isBetter, _mm_set1_epi32(j)), _mm_andnot_si128(isBetter, bestIndices));
+			}
+			uint32 errors[4];
+			uint32 groupIndices[4];
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(errors), bestErrors);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(groupIndices), bestIndices);
+			for(unsigned int j = 0; j < 4; j++)
+			{
+				totalError += errors[j];
+				indices[i + j] = static_cast<uint8>(groupIndices[j]);
+			}
+		}
+#elif defined(FRAMEWORK_SIMD_USE_NEON)
+		const uint8x16_t channelMask = useAlpha ? vdupq_n_u8(0xFF) : vreinterpretq_u8_u32(vdupq_n_u32(0x00FFFFFF));
+		for(unsigned int i = 0; i < pixelCount; i += 4)
+		{
+			uint8x16_t group = vld1q_u8(pixels[i]);
+			uint32x4_t bestErrors = vdupq_n_u32(UINT32_MAX);
+			uint32x4_t bestIndices = vdupq_n_u32(0);
+			for(unsigned int j = 0; j < paletteSize; j++)
+			{
+				uint32 color = 0;
+				memcpy(&color, palette[j], 4);
+				uint8x16_t diff = vandq_u8(vabdq_u8(group, vreinterpretq_u8_u32(vdupq_n_u32(color))), channelMask);
+				uint32x4_t sumsLo = vpaddlq_u16(vmull_u8(vget_low_u8(diff), vget_low_u8(diff)));
+				uint32x4_t sumsHi = vpaddlq_u16(vmull_u8(vget_high_u8(diff), vget_high_u8(diff)));
+				uint32x4_t errors = vcombine_u32(
+					vpadd_u32(vget_low_u32(sumsLo), vget_high_u32(sumsLo)),
+					vpadd_u32(vget_low_u32(sumsHi), vget_high_u32(sumsHi)));
+				uint32x4_t isBetter = vcltq_u32(errors, bestErrors);
+				bestErrors = vbslq_u32(isBetter, errors, bestErrors);
+				bestIndices = vbslq_u32(isBetter, vdupq_n_u32(j), bestIndices);
+			}
+			uint32 errors[4];
+			uint32 groupIndices[4];
+			vst1q_u32(errors, bestErrors);
+			vst1q_u32(groupIndices, bestIndices);
+			for(unsigned int j = 0; j < 4; j++)
+			{
+				totalError += errors[j];
+				indices[i + j] = static_cast<uint8>(groupIndices[j]);
+			}
+		}
+#else
+		unsigned int channelCount = useAlpha ? 4 : 3;
+		for(unsigned int i = 0; i < pixelCount; i++)
+		{
+			uint32 bestError = UINT32_MAX;
+			for(unsigned int j = 0; j < paletteSize; j++)
+			{
+				uint32 error = 0;
+				for(unsigned int c = 0; c < channelCount; c++)
+				{
+					int32 diff = static_cast<int32>(pixels[i][c]) - static_cast<int32>(palette[j][c]);
+					error += diff * diff;
+				}
+				if(error < bestError)
+				{
+					bestError = error;
+					indices[i] = static_cast<uint8>(j);
+				}
+			}
+			totalError += bestError;
+		}
+#endif
+		return totalError;
+	}
+
+	//Endpoints at the extremes of the principal axis of the block's colors
+	void FitEndpoints(const BLOCK& block, unsigned int channelCount, float (&endpoints)[2][4])
+	{
+		float mean[4] = {};
+		for(const auto& pixel : block)
+		{
+			for(unsigned int c = 0; c < channelCount; c++) mean[c] += pixel[c];
+		}
+		for(unsigned int c = 0; c < channelCount; c++) mean[c] /= 16.f;
+
+		float covariance[4][4] = {};
+		for(const auto& pixel : block)
+		{
+			for(unsigned int c1 = 0; c1 < channelCount; c1++)
+			{
+				for(unsigned int c2 = 0; c2 < channelCount; c2++)
+				{
+					covariance[c1][c2] += (pixel[c1] - mean[c1]) * (pixel[c2] - mean[c2]);
+				}
+			}
+		}
+
+		//Power iteration, starting from the covariances of the channel with the largest variance
+		unsigned int mainChannel = 0;
+		for(unsigned int c = 1; c < channelCount; c++)
+		{
+			if(covariance[c][c] > covariance[mainChannel][mainChannel]) mainChannel = c;
+		}
+		float axis[4] = {};
+		for(unsigned int c = 0; c < channelCount; c++) axis[c] = covariance[mainChannel][c];
+		for(unsigned int iteration = 0; iteration < 8; iteration++)
+		{
+			float next[4] = {};
+			float length = 0;
+			for(unsigned int c1 = 0; c1 < channelCount; c1++)
+			{
+				for(unsigned int c2 = 0; c2 < channelCount; c2++) next[c1] += covariance[c1][c2] * axis[c2];
+				length = std::max(length, fabsf(next[c1]));
+			}
+			if(length == 0) break;
+			for(unsigned int c = 0; c < channelCount; c++) axis[c] = next[c] / length;
+		}
+
+		float minT = 0;
+		float maxT = 0;
+		float axisLength = 0;
+		for(unsigned int c = 0; c < channelCount; c++) axisLength += axis[c] * axis[c];
+		if(axisLength != 0)
+		{
+			axisLength = sqrtf(axisLength);
+			for(unsigned int c = 0; c < channelCount; c++) axis[c] /= axisLength;
+			minT = FLT_MAX;
+			maxT = -FLT_MAX;
+			for(const auto& pixel : block)
+			{
+				float t = 0;
+				for(unsigned int c = 0; c < channelCount; c++) t += (pixel[c] - mean[c]) * axis[c];
+				minT = std::min(minT, t);
+				maxT = std::max(maxT, t);
+			}
+		}
+
+		for(unsigned int c = 0; c < 4; c++)
+		{
+			endpoints[0][c] = std::min(std::max(mean[c] + axis[c] * minT, 0.f), 255.f);
+			endpoints[1][c] = std::min(std::max(mean[c] + axis[c] * maxT, 0.f), 255.f);
+		}
+	}
+
+	//Least squares endpoints for the given indices, weights are the position of each index between the endpoints
+	bool RefineEndpoints(const BLOCK& block, unsigned int channelCount, const uint8* indices, const float* weights, float (&endpoints)[2][4])
+	{
+		float a = 0, b = 0, c = 0;
+		float rhs0[4] = {};
+		float rhs1[4] = {};
+		for(unsigned int i = 0; i < 16; i++)
+		{
+			float w = weights[indices[i]];
+			a += (1 - w) * (1 - w);
+			b += (1 - w) * w;
+			c += w * w;
+			for(unsigned int ch = 0; ch < channelCount; ch++)
+			{
+				rhs0[ch] += (1 - w) * block[i][ch];
+				rhs1[ch] += w * block[i][ch];
+			}
+		}
+		float det = a * c - b * b;
+		if(fabsf(det) < 1e-6f) return false;
+		for(unsigned int ch = 0; ch < channelCount; ch++)
+		{
+			endpoints[0][ch] = std::min(std::max((c * rhs0[ch] - b * rhs1[ch]) / det, 0.f), 255.f);
+			endpoints[1][ch] = std::min(std::max((a * rhs1[ch] - b * rhs0[ch]) / det, 0.f), 255.f);
+		}
+		return true;
+	}
+
+	uint16 PackColor565(const float* color)
+	{
+		return static_cast<uint16>((QuantizeSample(color[0], 31) << 11) | (QuantizeSample(color[1], 63) << 5) | QuantizeSample(color[2], 31));
+	}
+
+	void UnpackColor565(uint16 color, uint8* output)
+	{
+		uint8 r = (color >> 11) & 0x1F;
+		uint8 g = (color >> 5) & 0x3F;
+		uint8 b = (color >> 0) & 0x1F;
+		output[0] = (r << 3) | (r >> 2);
+		output[1] = (g << 2) | (g >> 4);
+		output[2] = (b << 3) | (b >> 2);
+		output[3] = 0xFF;
+	}
+
+	//Always uses the 4 color mode (color0 > color1) or a single color, BC3 decoders ignore the 3 color mode
+	uint32 EvaluateBC1(const BLOCK& block, uint16& color0, uint16& color1, uint8* indices)
+	{
+		if(color0 < color1) std::swap(color0, color1);
+		uint8 palette[4][4];
+		UnpackColor565(color0, palette[0]);
+		UnpackColor565(color1, palette[1]);
+		if(color0 == color1)
+		{
+			return SelectIndices(block, 16, palette, 1, false, indices);
+		}
+		for(unsigned int c = 0; c < 4; c++)
+		{
+			palette[2][c] = static_cast<uint8>((palette[0][c] * 2 + palette[1][c]) / 3);
+			palette[3][c] = static_cast<uint8>((palette[0][c] + palette[1][c] * 2) / 3);
+		}
+		return SelectIndices(block, 16, palette, 4, false, indices);
+	}
+
+	void EncodeBC1(const BLOCK& block, uint8* output)
+	{
+		static const float weights[4] = { 0.f, 1.f, 1.f / 3.f, 2.f / 3.f };
+
+		float endpoints[2][4];
+		FitEndpoints(block, 3, endpoints);
+		uint16 color0 = PackColor565(endpoints[1]);
+		uint16 color1 = PackColor565(endpoints[0]);
+		uint8 indices[16];
+		uint32 error = EvaluateBC1(block, color0, color1, indices);
+
+		if((error != 0) && RefineEndpoints(block, 3, indices, weights, endpoints))
+		{
+			uint16 refinedColor0 = PackColor565(endpoints[0]);
+			uint16 refinedColor1 = PackColor565(endpoints[1]);
+			uint8 refinedIndices[16];
+			uint32 refinedError = EvaluateBC1(block, refinedColor0, refinedColor1, refinedIndices);
+			if(refinedError < error)
+			{
+				color0 = refinedColor0;
+				color1 = refinedColor1;
+				memcpy(indices, refinedIndices, sizeof(indices));
+			}
+		}
+
+		uint32 packedIndices = 0;
+		for(unsigned int i = 0; i < 16; i++)
+		{
+			packedIndices |= static_cast<uint32>(indices[i]) << (i * 2);
+		}
+		output[0] = static_cast<uint8>(color0);
+		output[1] = static_cast<uint8>(color0 >> 8);
+		output[2] = static_cast<uint8>(color1);
+		output[3] = static_cast<uint8>(color1 >> 8);
+		for(unsigned int i = 0; i < 4; i++)
+		{
+			output[4 + i] = static_cast<uint8>(packedIndices >> (i * 8));
+		}
+	}
+
+	//BC3 alpha block (BC4), uses the 8 value mode
+	void EncodeBC3Alpha(const BLOCK& block, uint8* output)
+	{
+		uint8 minAlpha = 0xFF;
+		uint8 maxAlpha = 0;
+		for(const auto& pixel : block)
+		{
+			minAlpha = std::min(minAlpha, pixel[3]);
+			maxAlpha = std::max(maxAlpha, pixel[3]);
+		}
+
+		uint64 packedIndices = 0;
+		if(minAlpha != maxAlpha)
+		{
+			int32 values[8];
+			values[0] = maxAlpha;
+			values[1] = minAlpha;
+			for(unsigned int i = 1; i < 7; i++)
+			{
+				values[i + 1] = ((7 - i) * maxAlpha + i * minAlpha) / 7;
+			}
+			for(unsigned int i = 0; i < 16; i++)
+			{
+				unsigned int bestIndex = 0;
+				int32 bestError = INT32_MAX;
+				for(unsigned int j = 0; j < 8; j++)
+				{
+					int32 error = abs(values[j] - block[i][3]);
+					if(error < bestError)
+					{
+						bestError = error;
+						bestIndex = j;
+					}
+				}
+				packedIndices |= static_cast<uint64>(bestIndex) << (i * 3);
+			}
+		}
+
+		output[0] = maxAlpha;
+		output[1] = minAlpha;
+		for(unsigned int i = 0; i < 6; i++)
+		{
+			output[2 + i] = static_cast<uint8>(packedIndices >> (i * 8));
+		}
+	}
+
+	//Picks the 7 bit values and p-bit of both endpoints, endpoint samples are (value << 1) | p-bit
+	void QuantizeBC7Endpoints(const float (&endpoints)[2][4], uint8 (&values)[2][4], uint8 (&pBits)[2])
+	{
+		for(unsigned int i = 0; i < 2; i++)
+		{
+			float bestError = FLT_MAX;
+			for(unsigned int pBit = 0; pBit < 2; pBit++)
+			{
+				uint8 candidate[4];
+				float error = 0;
+				for(unsigned int c = 0; c < 4; c++)
+				{
+					int32 value = static_cast<int32>(lroundf((endpoints[i][c] - pBit) / 2.f));
+					candidate[c] = static_cast<uint8>(std::min<int32>(std::max<int32>(value, 0), 127));
+					float diff = static_cast<float>((candidate[c] << 1) | pBit) - endpoints[i][c];
+					error += diff * diff;
+				}
+				if(error < bestError)
+				{
+					bestError = error;
+					memcpy(values[i], candidate, 4);
+					pBits[i] = static_cast<uint8>(pBit);
+				}
+			}
+		}
+	}
+
+	uint32 EvaluateBC7(const BLOCK& block, const uint8 (&values)[2][4], const uint8 (&pBits)[2], uint8* indices)
+	{
+		uint8 palette[16][4];
+		for(unsigned int c = 0; c < 4; c++)
+		{
+			uint32 sample0 = (values[0][c] << 1) | pBits[0];
+			uint32 sample1 = (values[1][c] << 1) | pBits[1];
+			for(unsigned int i = 0; i < 16; i++)
+			{
+				palette[i][c] = static_cast<uint8>(((64 - g_bc7Weights[i]) * sample0 + g_bc7Weights[i] * sample1 + 32) >> 6);
+			}
+		}
+		return SelectIndices(block, 16, palette, 16, true, indices);
+	}
+
+	//Mode 6: single subset with RGBA endpoints, 7 bits per channel with a p-bit per endpoint, 4 bit indices
+	void EncodeBC7(const BLOCK& block, uint8* output)
+	{
+		float weights[16];
+		for(unsigned int i = 0; i < 16; i++) weights[i] = static_cast<float>(g_bc7Weights[i]) / 64.f;
+
+		float endpoints[2][4];
+		FitEndpoints(block, 4, endpoints);
+		uint8 values[2][4];
+		uint8 pBits[2];
+		QuantizeBC7Endpoints(endpoints, values, pBits);
+		uint8 indices[16];
+		uint32 error = EvaluateBC7(block, values, pBits, indices);
+
+		if((error != 0) && RefineEndpoints(block, 4, indices, weights, endpoints))
+		{
+			uint8 refinedValues[2][4];
+			uint8 refinedPBits[2];
+			QuantizeBC7Endpoints(endpoints, refinedValues, refinedPBits);
+			uint8 refinedIndices[16];
+			uint32 refinedError = EvaluateBC7(block, refinedValues, refinedPBits, refinedIndices);
+			if(refinedError < error)
+			{
+				memcpy(values, refinedValues, sizeof(values));
+				memcpy(pBits, refinedPBits, sizeof(pBits));
+				memcpy(indices, refinedIndices, sizeof(indices));
+			}
+		}
+
+		//Most significant bit of the first index is implicitly 0
+		if(indices[0] & 8)
+		{
+			std::swap(values[0], values[1]);
+			std::swap(pBits[0], pBits[1]);
+			for(auto& index : indices) index = 15 - index;
+		}
+
+		uint64 bits[2] = {};
+		unsigned int position = 0;
+		auto writeBits =
+			[&] (uint32 value, unsigned int count)
+			{
+				for(unsigned int i = 0; i < count; i++, position++)
+				{
+					bits[position / 64] |= static_cast<uint64>((value >> i) & 1) << (position % 64);
+				}
+			};
+		writeBits(1 << 6, 7);
+		for(unsigned int c = 0; c < 4; c++)
+		{
+			writeBits(values[0][c], 7);
+			writeBits(values[1][c], 7);
+		}
+		writeBits(pBits[0], 1);
+		writeBits(pBits[1], 1);
+		writeBits(indices[0], 3);
+		for(unsigned int i = 1; i < 16; i++)
+		{
+			writeBits(indices[i], 4);
+		}
+		assert(position == 128);
+
+		for(unsigned int i = 0; i < 16; i++)
+		{
+			output[i] = static_cast<uint8>(bits[i / 8] >> ((i % 8) * 8));
+		}
+	}
+
+	void WriteBigEndian64(uint8* output, uint64 value)
+	{
+		for(unsigned int i = 0; i < 8; i++)
+		{
+			output[i] = static_cast<uint8>(value >> ((7 - i) * 8));
+		}
+	}
+
+	//Best modifier table for a subblock, its pixels are in ETC order (column major)
+	uint32 EvaluateEtcSubblock(const uint8 (*pixels)[4], const uint8* baseColor, unsigned int& table, uint8* indices)
+	{
+		uint32 bestError = UINT32_MAX;
+		for(unsigned int t = 0; t < 8; t++)
+		{
+			uint8 palette[4][4] = {};
+			for(unsigned int c = 0; c < 3; c++)
+			{
+				palette[0][c] = ClampSample(baseColor[c] + g_etcModifiers[t][0]);
+				palette[1][c] = ClampSample(baseColor[c] + g_etcModifiers[t][1]);
+				palette[2][c] = ClampSample(baseColor[c] - g_etcModifiers[t][0]);
+				palette[3][c] = ClampSample(baseColor[c] - g_etcModifiers[t][1]);
+			}
+			uint8 tableIndices[8];
+			uint32 error = SelectIndices(pixels, 8, palette, 4, false, tableIndices);
+			if(error < bestError)
+			{
+				bestError = error;
+				table = t;
+				memcpy(indices, tableIndices, 8);
+			}
+		}
+		return bestError;
+	}
+
+	//ETC1 compatible block (individual or differential mode), these decode the same way with ETC2
+	void EncodeEtc2Color(const BLOCK& block, uint8* output)
+	{
+		uint32 bestError = UINT32_MAX;
+		uint64 bestBits = 0;
+		for(unsigned int flip = 0; flip < 2; flip++)
+		{
+			//Subblocks are 2x4 side by side, or 4x2 on top of each other when flipped
+			uint8 subblockPixels[2][8][4];
+			unsigned int pixelIndices[2][8];
+			float averages[2][3] = {};
+			for(unsigned int s = 0; s < 2; s++)
+			{
+				for(unsigned int i = 0; i < 8; i++)
+				{
+					unsigned int x = flip ? (i / 2) : (s * 2 + i / 4);
+					unsigned int y = flip ? (s * 2 + i % 2) : (i % 4);
+					memcpy(subblockPixels[s][i], block[y * 4 + x], 4);
+					pixelIndices[s][i] = x * 4 + y;
+					for(unsigned int c = 0; c < 3; c++) averages[s][c] += subblockPixels[s][i][c] / 8.f;
+				}
+			}
+
+			for(unsigned int differential = 0; differential < 2; differential++)
+			{
+				uint8 quantized[2][3];
+				uint8 baseColors[2][4] = {};
+				bool isValid = true;
+				for(unsigned int c = 0; c < 3; c++)
+				{
+					if(differential)
+					{
+						quantized[0][c] = QuantizeSample(averages[0][c], 31);
+						quantized[1][c] = QuantizeSample(averages[1][c], 31);
+						int32 delta = quantized[1][c] - quantized[0][c];
+						isValid &= (delta >= -4) && (delta <= 3);
+						for(unsigned int s = 0; s < 2; s++) baseColors[s][c] = (quantized[s][c] << 3) | (quantized[s][c] >> 2);
+					}
+					else
+					{
+						quantized[0][c] = QuantizeSample(averages[0][c], 15);
+						quantized[1][c] = QuantizeSample(averages[1][c], 15);
+						for(unsigned int s = 0; s < 2; s++) baseColors[s][c] = quantized[s][c] * 0x11;
+					}
+				}
+				if(!isValid) continue;
+
+				unsigned int tables[2] = {};
+				uint8 subblockIndices[2][8];
+				uint32 error = EvaluateEtcSubblock(subblockPixels[0], baseColors[0], tables[0], subblockIndices[0]);
+				if(error >= bestError) continue;
+				error += EvaluateEtcSubblock(subblockPixels[1], baseColors[1], tables[1], subblockIndices[1]);
+				if(error >= bestError) continue;
+
+				uint64 bits = 0;
+				for(unsigned int c = 0; c < 3; c++)
+				{
+					unsigned int shift = 56 - c * 8;
+					if(differential)
+					{
+						uint32 delta = (quantized[1][c] - quantized[0][c]) & 7;
+						bits |= static_cast<uint64>((quantized[0][c] << 3) | delta) << shift;
+					}
+					else
+					{
+						bits |= static_cast<uint64>((quantized[0][c] << 4) | quantized[1][c]) << shift;
+					}
+				}
+				bits |= static_cast<uint64>(tables[0]) << 37;
+				bits |= static_cast<uint64>(tables[1]) << 34;
+				bits |= static_cast<uint64>(differential) << 33;
+				bits |= static_cast<uint64>(flip) << 32;
+				for(unsigned int s = 0; s < 2; s++)
+				{
+					for(unsigned int i = 0; i < 8; i++)
+					{
+						unsigned int index = subblockIndices[s][i];
+						unsigned int pixelIndex = pixelIndices[s][i];
+						bits |= static_cast<uint64>(index >> 1) << (pixelIndex + 16);
+						bits |= static_cast<uint64>(index & 1) << pixelIndex;
+					}
+				}
+
+				bestError = error;
+				bestBits = bits;
+			}
+		}
+		WriteBigEndian64(output, bestBits);
+	}
+
+	void EncodeEtc2Alpha(const BLOCK& block, uint8* output)
+	{
+		int32 minAlpha = 0xFF;
+		int32 maxAlpha = 0;
+		for(const auto& pixel : block)
+		{
+			minAlpha = std::min<int32>(minAlpha, pixel[3]);
+			maxAlpha = std::max<int32>(maxAlpha, pixel[3]);
+		}
+
+		uint32 bestError = UINT32_MAX;
+		uint64 bestBits = 0;
+		for(unsigned int table = 0; table < 16; table++)
+		{
+			const int* modifiers = g_eacModifiers[table];
+			int32 range = modifiers[7] - modifiers[3];
+			int32 multiplier = std::max<int32>((maxAlpha - minAlpha + range / 2) / range, 1);
+			for(int32 m = std::max<int32>(multiplier - 1, 1); m <= std::min<int32>(multiplier + 1, 15); m++)
+			{
+				//Base centers the table's range over the block's range
+				int32 base = ClampSample((minAlpha + maxAlpha - (modifiers[3] + modifiers[7]) * m + 1) / 2);
+				uint32 error = 0;
+				uint64 bits = 0;
+				for(unsigned int i = 0; (i < 16) && (error < bestError); i++)
+				{
+					//Indices are in column major order
+					int32 alpha = block[(i % 4) * 4 + (i / 4)][3];
+					uint32 bestPixelError = UINT32_MAX;
+					unsigned int bestIndex = 0;
+					for(unsigned int j = 0; j < 8; j++)
+					{
+						int32 diff = ClampSample(base + modifiers[j] * m) - alpha;
+						uint32 pixelError = diff * diff;
+						if(pixelError < bestPixelError)
+						{
+							bestPixelError = pixelError;
+							bestIndex = j;
+						}
+					}
+					error += bestPixelError;
+					bits |= static_cast<uint64>(bestIndex) << (45 - i * 3);
+				}
+				if(error < bestError)
+				{
+					bestError = error;
+					bestBits = bits | (static_cast<uint64>(base) << 56) | (static_cast<uint64>(m) << 52) | (static_cast<uint64>(table) << 48);
+				}
+			}
+		}
+		WriteBigEndian64(output, bestBits);
+	}
+}
+
+unsigned int CTextureCompressor::GetBlockSize(FORMAT format)
+{
+	switch(format)
+	{
+	case FORMAT_BC1:
+	case FORMAT_ETC2_RGB8:
+		return 8;
+	case FORMAT_BC3:
+	case FORMAT_BC7:
+	case FORMAT_ETC2_RGBA8:
+		return 16;
+	default:
+		throw std::runtime_error("Unknown texture format.");
+		break;
+	}
+}
+
+size_t CTextureCompressor::GetLevelSize(FORMAT format, unsigned int width, unsigned int height)
+{
+	return static_cast<size_t>((width + 3) / 4) * static_cast<size_t>((height + 3) / 4) * GetBlockSize(format);
+}
+
+CTextureCompressor::LEVEL CTextureCompressor::Compress(const CBitmap& bitmap, FORMAT format, CThreadPool* threadPool)
+{
+	if((bitmap.GetBitsPerPixel() != 24) && (bitmap.GetBitsPerPixel() != 32))
+	{
+		throw std::runtime_error("Unsupported bit depth.");
+	}
+
+	LEVEL result;
+	result.width = bitmap.GetWidth();
+	result.height = bitmap.GetHeight();
+	result.data.resize(GetLevelSize(format, result.width, result.height));
+	if(bitmap.IsEmpty())
+	{
+		return result;
+	}
+
+	unsigned int blockRowCount = (result.height + 3) / 4;
+	size_t blockRowSize = static_cast<size_t>((result.width + 3) / 4) * GetBlockSize(format);
+
+	CTaskGroup taskGroup(threadPool);
+	for(unsigned int blockY = 0; blockY < blockRowCount; blockY += BLOCK_ROWS_PER_TASK)
+	{
+		unsigned int endBlockY = std::min<unsigned int>(blockY + BLOCK_ROWS_PER_TASK, blockRowCount);
+		taskGroup.Run(
+			[&, blockY, endBlockY] ()
+			{
+				for(unsigned int row = blockY; row < endBlockY; row++)
+				{
+					CompressBlockRow(bitmap, format, row, result.data.data() + row * blockRowSize);
+				}
+			});
+	}
+	taskGroup.Wait();
+
+	return result;
+}
+
+CTextureCompressor::LevelArray CTextureCompressor::CompressMipChain(const CBitmap& bitmap, FORMAT format, MIP_FILTER filter, CThreadPool* threadPool)
+{
+	LevelArray result;
+	if(bitmap.IsEmpty())
+	{
+		return result;
+	}
+
+	CBitmap mip;
+	const CBitmap* level = &bitmap;
+	while(true)
+	{
+		result.push_back(Compress(*level, format, threadPool));
+		if((level->GetWidth() == 1) && (level->GetHeight() == 1)) break;
+		mip = GenerateMip(*level, filter, threadPool);
+		level = &mip;
+	}
+	return result;
+}
+
+CBitmap CTextureCompressor::GenerateMip(const CBitmap& bitmap, MIP_FILTER filter, CThreadPool* threadPool)
+{
+	if((bitmap.GetBitsPerPixel() % 8) != 0)
+	{
+		throw std::runtime_error("Unsupported bit depth.");
+	}
+	if(bitmap.IsEmpty())
+	{
+		return CBitmap();
+	}
+
+	unsigned int srcWidth = bitmap.GetWidth();
+	unsigned int srcHeight = bitmap.GetHeight();
+	unsigned int dstWidth = std::max<unsigned int>(srcWidth / 2, 1);
+	unsigned int dstHeight = std::max<unsigned int>(srcHeight / 2, 1);
+
+	switch(filter)
+	{
+	case MIP_FILTER_BOX:
+		break;
+	case MIP_FILTER_KAISER:
+		return bitmap.Resize(dstWidth, dstHeight, CBitmap::RESIZE_FILTER_KAISER, threadPool);
+	default:
+		throw std::runtime_error("Unknown mip filter.");
+		break;
+	}
+
+	CBitmap result(dstWidth, dstHeight, bitmap.GetBitsPerPixel(), bitmap.GetAllocator());
+	unsigned int pixelSize = bitmap.GetPixelSize();
+
+	CTaskGroup taskGroup(threadPool);
+	for(unsigned int y = 0; y < dstHeight; y += ROWS_PER_TASK)
+	{
+		unsigned int endY = std::min<unsigned int>(y + ROWS_PER_TASK, dstHeight);
+		taskGroup.Run(
+			[&, y, endY] ()
+			{
+				for(unsigned int row = y; row < endY; row++)
+				{
+					//Single row/column images are averaged with themselves on that axis
+					const uint8* srcRow0 = bitmap.GetPixels() + std::min(row * 2 + 0, srcHeight - 1) * bitmap.GetPitch();
+					const uint8* srcRow1 = bitmap.GetPixels() + std::min(row * 2 + 1, srcHeight - 1) * bitmap.GetPitch();
+					uint8* dstRow = result.GetPixels() + row * result.GetPitch();
+					if(srcWidth == 1)
+					{
+						for(unsigned int c = 0; c < pixelSize; c++)
+						{
+							dstRow[c] = static_cast<uint8>((srcRow0[c] + srcRow1[c] + 1) / 2);
+						}
+					}
+					else
+					{
+						BoxFilterRow(dstRow, srcRow0, srcRow1, dstWidth, pixelSize);
+					}
+				}
+			});
+	}
+	taskGroup.Wait();
+
+	return result;
+}
+
+void CTextureCompressor::CompressBlockRow(const CBitmap& bitmap, FORMAT format, unsigned int blockY, uint8* output)
+{
+	unsigned int blockSize = GetBlockSize(format);
+	unsigned int blockCount = (bitmap.GetWidth() + 3) / 4;
+	for(unsigned int blockX = 0; blockX < blockCount; blockX++)
+	{
+		BLOCK block;
+		ReadBlock(bitmap, blockX, blockY, block);
+		uint8* blockOutput = output + blockX * blockSize;
+		switch(format)
+		{
+		case FORMAT_BC1:
+			EncodeBC1(block, blockOutput);
+			break;
+		case FORMAT_BC3:
+			EncodeBC3Alpha(block, blockOutput);
+			EncodeBC1(block, blockOutput + 8);
+			break;
+		case FORMAT_BC7:
+			EncodeBC7(block, blockOutput);
+			break;
+		case FORMAT_ETC2_RGB8:
+			EncodeEtc2Color(block, blockOutput);
+			break;
+		case FORMAT_ETC2_RGBA8:
+			EncodeEtc2Alpha(block, blockOutput);
+			EncodeEtc2Color(block, blockOutput + 8);
+			break;
+		}
+	}
+}
+
+void CTextureCompressor::BoxFilterRow(uint8* dst, const uint8* srcRow0, const uint8* srcRow1, unsigned int dstWidth, unsigned int pixelSize)
+{
+	unsigned int x = 0;
+	if(pixelSize == 4)
+	{
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i rounding = _mm_set1_epi16(2);
+		for(; (x + 2) <= dstWidth; x += 2)
+		{
+			__m128i row0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(srcRow0 + x * 8));
+			__m128i row1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(srcRow1 + x * 8));
+			//Vertical sums of source pixels 0-1 and 2-3, then horizontal sums in the low halves
+			__m128i sumLo = _mm_add_epi16(_mm_unpacklo_epi8(row0, zero), _mm_unpacklo_epi8(row1, zero));
+			__m128i sumHi = _mm_add_epi16(_mm_unpackhi_epi8(row0, zero), _mm_unpackhi_epi8(row1, zero));
+			sumLo = _mm_add_epi16(sumLo, _mm_srli_si128(sumLo, 8));
+			sumHi = _mm_add_epi16(sumHi, _mm_srli_si128(sumHi, 8));
+			__m128i sum = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(sumLo, sumHi), rounding), 2);
+			_mm_storel_epi64(reinterpret_cast<__m128i*>(dst + x * 4), _mm_packus_epi16(sum, sum));
+		}
+#elif defined(FRAMEWORK_SIMD_USE_NEON)
+		for(; (x + 4) <= dstWidth; x += 4)
+		{
+			//Splits even and odd source pixels
+			uint32x4x2_t row0 = vld2q_u32(reinterpret_cast<const uint32*>(srcRow0 + x * 8));
+			uint32x4x2_t row1 = vld2q_u32(reinterpret_cast<const uint32*>(srcRow1 + x * 8));
+			uint8x16_t even0 = vreinterpretq_u8_u32(row0.val[0]);
+			uint8x16_t odd0 = vreinterpretq_u8_u32(row0.val[1]);
+			uint8x16_t even1 = vreinterpretq_u8_u32(row1.val[0]);
+			uint8x16_t odd1 = vreinterpretq_u8_u32(row1.val[1]);
+			uint16x8_t sumLo = vaddq_u16(vaddl_u8(vget_low_u8(even0), vget_low_u8(odd0)), vaddl_u8(vget_low_u8(even1), vget_low_u8(odd1)));
+			uint16x8_t sumHi = vaddq_u16(vaddl_u8(vget_high_u8(even0), vget_high_u8(odd0)), vaddl_u8(vget_high_u8(even1), vget_high_u8(odd1)));
+			vst1q_u8(dst + x * 4, vcombine_u8(vrshrn_n_u16(sumLo, 2), vrshrn_n_u16(sumHi, 2)));
+		}
+#endif
+	}
+	for(; x < dstWidth; x++)
+	{
+		const uint8* src0 = srcRow0 + x * 2 * pixelSize;
+		const uint8* src1 = srcRow1 + x * 2 * pixelSize;
+		for(unsigned int c = 0; c < pixelSize; c++)
+		{
+			dst[x * pixelSize + c] = static_cast<uint8>((src0[c] + src0[c + pixelSize] + src1[c] + src1[c + pixelSize] + 2) / 4);
+		}
+	}
+}
@@ -5,12 +5,28 @@ using namespace Framework::DirectInput;
 CDevice::CDevice(const DirectInputDevicePtr& device)
 : m_device(device)
 {
-
+	//Notifications can only be set while the device isn't acquired, which is the case until it's first read
+	m_event = CreateEvent(NULL, FALSE, FALSE, NULL);
+	if(m_event && FAILED(m_device->SetEventNotification(m_event)))
+	{
+		CloseHandle(m_event);
+		m_event = NULL;
+	}
 }
 
 CDevice::~CDevice()
 {
+	if(m_event)
+	{
+		m_device->Unacquire();
+		m_device->SetEventNotification(NULL);
+		CloseHandle(m_event);
+	}
+}
 
+HANDLE CDevice::GetEventHandle() const
+{
+	return m_event;
 }
 
 bool CDevice::GetInfo(DIDEVICEINSTANCE* deviceInfo)
@@ -25,6 +41,29 @@ bool CDevice::GetObjectInfo(uint32 id, DIDEVICEOBJECTINSTANCE* objectInfo)
 	return !FAILED(m_device->GetObjectInfo(objectInfo, id, DIPH_BYOFFSET));
 }
 
+bool CDevice::ReadDeviceData(const GUID& deviceId, const InputEventHandler& eventHandler)
+{
+	//Drain the device's buffer, an event is only signaled once for everything that came in since the last read
+	while(1)
+	{
+		DIDEVICEOBJECTDATA deviceData[DEVICE_BUFFER_SIZE];
+		DWORD elementCount = DEVICE_BUFFER_SIZE;
+		HRESULT result = m_device->GetDeviceData(sizeof(DIDEVICEOBJECTDATA), deviceData, &elementCount, 0);
+		if(FAILED(result))
+		{
+			return SUCCEEDED(m_device->Acquire());
+		}
+		for(DWORD i = 0; i < elementCount; i++)
+		{
+			eventHandler(deviceId, deviceData[i].dwOfs, deviceData[i].dwData);
+		}
+		if(elementCount < DEVICE_BUFFER_SIZE)
+		{
+			return true;
+		}
+	}
+}
+
 void CDevice::SetFocusWindow(HWND focusWindow)
 {
 	//Unacquire device just to be sure
@@ -2,8 +2,6 @@
 #include <stdexcept>
 #include <assert.h>
 
-#define DIBUFFERSIZE	(0x80)
-
 using namespace Framework::DirectInput;
 
 CJoystick::CJoystick(const DirectInputDevicePtr& device)
@@ -25,7 +23,7 @@ CJoystick::CJoystick(const DirectInputDevicePtr& device)
 		p.diph.dwHeaderSize = sizeof(DIPROPHEADER);
 		p.diph.dwHow		= DIPH_DEVICE;
 		p.diph.dwObj		= 0;
-		p.dwData			= DIBUFFERSIZE;
+		p.dwData			= DEVICE_BUFFER_SIZE;
 
 		result = m_device->SetProperty(DIPROP_BUFFERSIZE, &p.diph);
 		assert(SUCCEEDED(result));
@@ -97,20 +95,9 @@ void CJoystick::SetVibration(uint8_t largeMotor, uint8_t smallMotor)
 	}
 }
 
-void CJoystick::ProcessEvents(const InputEventHandler& eventHandler)
+bool CJoystick::ProcessEvents(const InputEventHandler& eventHandler)
 {
-	DIDEVICEOBJECTDATA deviceData[DIBUFFERSIZE];
-	DWORD elementCount = DIBUFFERSIZE;
-	HRESULT result = m_device->GetDeviceData(sizeof(DIDEVICEOBJECTDATA), deviceData, &elementCount, 0);
-	if(FAILED(result))
-	{
-		m_device->Acquire();
-		return;
-	}
-	for(DWORD i = 0; i < elementCount; i++)
-	{
-		eventHandler(m_deviceGuid, deviceData[i].dwOfs, deviceData[i].dwData);
-	}
+	return ReadDeviceData(m_deviceGuid, eventHandler);
 }
 
 int CJoystick::GetButtonCount() const
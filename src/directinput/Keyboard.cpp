@@ -1,8 +1,6 @@
 #include "directinput/Keyboard.h"
 #include <assert.h>
 
-#define DIBUFFERSIZE	(0x80)
-
 using namespace Framework::DirectInput;
 
 CKeyboard::CKeyboard(const DirectInputDevicePtr& device)
@@ -20,7 +18,7 @@ CKeyboard::CKeyboard(const DirectInputDevicePtr& device)
 		p.diph.dwHeaderSize = sizeof(DIPROPHEADER);
 		p.diph.dwHow		= DIPH_DEVICE;
 		p.diph.dwObj		= 0;
-		p.dwData			= DIBUFFERSIZE;
+		p.dwData			= DEVICE_BUFFER_SIZE;
 
 		result = m_device->SetProperty(DIPROP_BUFFERSIZE, &p.diph);
 		assert(SUCCEEDED(result));
@@ -32,18 +30,7 @@ CKeyboard::~CKeyboard()
 
 }
 
-void CKeyboard::ProcessEvents(const InputEventHandler& eventHandler)
+bool CKeyboard::ProcessEvents(const InputEventHandler& eventHandler)
 {
-	DIDEVICEOBJECTDATA deviceData[DIBUFFERSIZE];
-	DWORD elementCount = DIBUFFERSIZE;
-	HRESULT result = m_device->GetDeviceData(sizeof(DIDEVICEOBJECTDATA), deviceData, &elementCount, 0);
-	if(FAILED(result))
-	{
-		m_device->Acquire();
-		return;
-	}
-	for(DWORD i = 0; i < elementCount; i++)
-	{
-		eventHandler(GUID_SysKeyboard, deviceData[i].dwOfs, deviceData[i].dwData);
-	}
+	return ReadDeviceData(GUID_SysKeyboard, eventHandler);
 }
@@ -10,6 +10,7 @@ CManager::CManager(bool filterXInput)
 : m_updateThreadHandle(NULL)
 , m_updateThreadOver(false)
 , m_nextInputEventHandlerId(1)
+, m_inputEventQueue(INPUT_EVENT_QUEUE_SIZE)
 , m_filterXInput(filterXInput)
 {
 	if(FAILED(DirectInput8Create(GetModuleHandle(NULL), DIRECTINPUT_VERSION, IID_IDirectInput8, reinterpret_cast<void**>(&m_directInput), NULL)))
@@ -20,6 +21,8 @@ CManager::CManager(bool filterXInput)
 	{
 		DWORD threadId = 0;
 		InitializeCriticalSection(&m_updateMutex);
+		InitializeCriticalSection(&m_inputEventHandlersMutex);
+		m_updateWakeEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
 		m_updateThreadHandle = CreateThread(NULL, NULL, &CManager::UpdateThreadProcStub, this, NULL, &threadId);
 	}
 }
@@ -27,7 +30,11 @@ CManager::CManager(bool filterXInput)
 CManager::~CManager()
 {
 	m_updateThreadOver = true;
+	SignalUpdateThread();
 	WaitForSingleObject(m_updateThreadHandle, INFINITE);
+	CloseHandle(m_updateThreadHandle);
+	CloseHandle(m_updateWakeEvent);
+	DeleteCriticalSection(&m_inputEventHandlersMutex);
 	DeleteCriticalSection(&m_updateMutex);
 }
 
@@ -41,28 +48,36 @@ void CManager::SetFocusWindow(HWND focusWindow)
 		}
 	}
 	LeaveCriticalSection(&m_updateMutex);
+	//Devices need to be acquired again
+	SignalUpdateThread();
 }
 
 uint32 CManager::RegisterInputEventHandler(const InputEventHandler& inputEventHandler)
 {
-	uint32 eventHandlerId = m_nextInputEventHandlerId++;
-	EnterCriticalSection(&m_updateMutex);
+	uint32 eventHandlerId = 0;
+	EnterCriticalSection(&m_inputEventHandlersMutex);
 	{
+		eventHandlerId = m_nextInputEventHandlerId++;
 		m_inputEventHandlers[eventHandlerId] = inputEventHandler;
 	}
-	LeaveCriticalSection(&m_updateMutex);
+	LeaveCriticalSection(&m_inputEventHandlersMutex);
 	return eventHandlerId;
 }
 
 void CManager::UnregisterInputEventHandler(uint32 eventHandlerId)
 {
-	EnterCriticalSection(&m_updateMutex);
+	EnterCriticalSection(&m_inputEventHandlersMutex);
 	{
 		auto inputEventHandlerIterator = m_inputEventHandlers.find(eventHandlerId);
 		assert(inputEventHandlerIterator != std::end(m_inputEventHandlers));
 		m_inputEventHandlers.erase(inputEventHandlerIterator);
 	}
-	LeaveCriticalSection(&m_updateMutex);
+	LeaveCriticalSection(&m_inputEventHandlersMutex);
+}
+
+bool CManager::TryPopInputEvent(INPUT_EVENT& inputEvent)
+{
+	return m_inputEventQueue.TryPop(inputEvent);
 }
 
 void CManager::CreateKeyboard()
@@ -77,6 +92,7 @@ void CManager::CreateKeyboard()
 		m_devices[GUID_SysKeyboard] = std::make_shared<CKeyboard>(device);
 	}
 	LeaveCriticalSection(&m_updateMutex);
+	SignalUpdateThread();
 }
 
 void CManager::CreateJoysticks()
@@ -94,6 +110,7 @@ void CManager::CreateJoysticks()
 		}
 		LeaveCriticalSection(&m_updateMutex);
 	}
+	SignalUpdateThread();
 }
 
 std::list<GUID> CManager::GetJoystickIds()
@@ -262,29 +279,78 @@ BOOL CManager::EnumDevicesCallbackImpl(LPCDIDEVICEINSTANCE lpddi)
 	return DIENUM_CONTINUE;
 }
 
-DWORD CManager::UpdateThreadProc()
+void CManager::SignalUpdateThread()
+{
+	SetEvent(m_updateWakeEvent);
+}
+
+void CManager::DispatchInputEvents(const InputEventArray& inputEvents)
 {
-	auto inputEventHandler = 
-		[this] (const GUID& device, uint32 id, uint32 value)
+	if(inputEvents.empty()) return;
+	for(const auto& inputEvent : inputEvents)
+	{
+		m_inputEventQueue.TryPush(inputEvent);
+	}
+	EnterCriticalSection(&m_inputEventHandlersMutex);
+	{
+		for(const auto& inputEvent : inputEvents)
 		{
 			for(const auto& inputEventHandler : m_inputEventHandlers)
 			{
-				inputEventHandler.second(device, id, value);
+				inputEventHandler.second(inputEvent.deviceId, inputEvent.id, inputEvent.value);
 			}
+		}
+	}
+	LeaveCriticalSection(&m_inputEventHandlersMutex);
+}
+
+DWORD CManager::UpdateThreadProc()
+{
+	//Devices waited on are kept alive until the wait is over, even if they're replaced in the meantime
+	std::vector<DevicePtr> waitDevices;
+	std::vector<HANDLE> waitHandles;
+	InputEventArray inputEvents;
+	int64 timestamp = 0;
+	auto inputEventHandler =
+		[&] (const GUID& deviceId, uint32 id, uint32 value)
+		{
+			inputEvents.push_back(INPUT_EVENT{deviceId, id, value, timestamp});
 		};
 
 	while(!m_updateThreadOver)
 	{
+		LARGE_INTEGER counter = {};
+		QueryPerformanceCounter(&counter);
+		timestamp = counter.QuadPart;
+
+		//Every device is read on each wake up, auto reset events of devices that had nothing new stay signaled
+		//and only cause an extra empty read
+		bool needsPolling = false;
+		inputEvents.clear();
+		waitDevices.clear();
+		waitHandles.assign(1, m_updateWakeEvent);
 		EnterCriticalSection(&m_updateMutex);
 		{
 			for(const auto& devicePair : m_devices)
 			{
 				auto& device = devicePair.second;
-				device->ProcessEvents(inputEventHandler);
+				HANDLE eventHandle = device->GetEventHandle();
+				if(!device->ProcessEvents(inputEventHandler) || !eventHandle || (waitHandles.size() == MAXIMUM_WAIT_OBJECTS))
+				{
+					needsPolling = true;
+				}
+				else
+				{
+					waitDevices.push_back(device);
+					waitHandles.push_back(eventHandle);
+				}
 			}
 		}
 		LeaveCriticalSection(&m_updateMutex);
-		Sleep(16);
+
+		DispatchInputEvents(inputEvents);
+
+		WaitForMultipleObjects(static_cast<DWORD>(waitHandles.size()), waitHandles.data(), FALSE, needsPolling ? DEVICE_POLL_INTERVAL : INFINITE);
 	}
 	return 0;
 }
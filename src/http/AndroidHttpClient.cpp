@@ -1,9 +1,14 @@
 #include "http/AndroidHttpClient.h"
+#include <algorithm>
 #include <cassert>
+#include <memory>
 #include "http/java_net_URL.h"
 #include "http/java_net_HttpURLConnection.h"
 #include "http/java_io_InputStream.h"
 #include "http/java_io_OutputStream.h"
+#include "http/java_nio_Buffer.h"
+#include "http/java_nio_channels_Channels.h"
+#include "http/java_nio_channels_ReadableByteChannel.h"
 #include "android/JavaVM.h"
 
 using namespace Framework;
@@ -27,6 +32,17 @@ private:
 	java::net::HttpURLConnection& m_connection;
 };
 
+void CAndroidHttpClient::PrepareClassCache()
+{
+	java::net::URL_ClassInfo::GetInstance().PrepareClassInfo();
+	java::net::HttpURLConnection_ClassInfo::GetInstance().PrepareClassInfo();
+	java::io::InputStream_ClassInfo::GetInstance().PrepareClassInfo();
+	java::io::OutputStream_ClassInfo::GetInstance().PrepareClassInfo();
+	java::nio::Buffer_ClassInfo::GetInstance().PrepareClassInfo();
+	java::nio::channels::Channels_ClassInfo::GetInstance().PrepareClassInfo();
+	java::nio::channels::ReadableByteChannel_ClassInfo::GetInstance().PrepareClassInfo();
+}
+
 RequestResult CAndroidHttpClient::SendRequest()
 {
 	auto env = CJavaVM::GetEnv();
@@ -55,19 +71,37 @@ RequestResult CAndroidHttpClient::SendRequest()
 		}
 		connection.setRequestMethod(env->NewStringUTF(verbString));
 
-		for(const auto& header : m_headers)
+		for(const auto& header : GetRequestHeaders(m_headers, IsRequestBodyCompressed()))
 		{
-			jstring headerKey = env->NewStringUTF(header.first.c_str());
-			jstring headerValue = env->NewStringUTF(header.second.c_str());
+			jstring headerKey = env->NewStringUTF(header.name.data());
+			jstring headerValue = env->NewStringUTF(header.value.data());
 			connection.setRequestProperty(headerKey, headerValue);
 			env->DeleteLocalRef(headerKey);
 			env->DeleteLocalRef(headerValue);
 		}
 		
+		static const int bufferSize = 0x10000;
+		std::vector<jbyte> buffer;
+		buffer.resize(bufferSize);
+
 		if(m_verb == HTTP_VERB::POST)
 		{
+			//Without a fixed length, HttpURLConnection keeps the whole body in memory
+			uint64 remainingSize = GetRequestBodySize();
+			connection.setFixedLengthStreamingMode(static_cast<jlong>(remainingSize));
+			std::unique_ptr<Framework::CPtrStream> bodyMemoryStream;
+			auto& bodyStream = GetRequestBodyStream(bodyMemoryStream);
 			auto outputStream = CJavaObject::CastTo<java::io::OutputStream>(connection.getOutputStream());
-			outputStream.write(reinterpret_cast<const jbyte*>(m_requestBody.data()), m_requestBody.size());
+			while(remainingSize != 0)
+			{
+				auto chunkSize = bodyStream.Read(buffer.data(), std::min<uint64>(remainingSize, bufferSize));
+				if(chunkSize == 0)
+				{
+					throw std::runtime_error("Failed to read request body.");
+				}
+				outputStream.write(buffer.data(), chunkSize);
+				remainingSize -= chunkSize;
+			}
 			outputStream.close();
 		}
 		
@@ -81,7 +115,7 @@ RequestResult CAndroidHttpClient::SendRequest()
 			if(!headerKey || !headerValue) break;
 			const char* headerKeyChars = env->GetStringUTFChars(headerKey, 0);
 			const char* headerValueChars = env->GetStringUTFChars(headerValue, 0);
-			result.headers.insert(std::make_pair(headerKeyChars, headerValueChars));
+			result.headers.Add(headerKeyChars, headerValueChars);
 			env->ReleaseStringUTFChars(headerKey, headerKeyChars);
 			env->ReleaseStringUTFChars(headerValue, headerValueChars);
 		}
@@ -100,21 +134,38 @@ RequestResult CAndroidHttpClient::SendRequest()
 				}
 			}();
 
-		static const int bufferSize = 0x10000;
-		std::vector<jbyte> buffer;
-		buffer.resize(bufferSize);
+		//Channel writes straight into our buffer through a direct ByteBuffer, no byte[] to copy back
+		auto channel = CJavaObject::CastTo<java::nio::channels::ReadableByteChannel>(java::nio::channels::Channels::newChannel(inputStream));
+		auto byteBuffer = CJavaObject::CastTo<java::nio::Buffer>(env->NewDirectByteBuffer(buffer.data(), bufferSize));
 
+		CResponseBodyWriter responseWriter(result, m_responseSink, IsContentDecodingEnabled());
+		responseWriter.SetContentEncoding(GetHeaderValue(result.headers, "Content-Encoding"));
 		while(1)
 		{
-			auto readResult = inputStream.read(buffer);
+			byteBuffer.clear();
+			auto readResult = channel.read(byteBuffer);
 			if(readResult == -1)
 			{
 				break;
 			}
-			result.data.Write(buffer.data(), readResult);
+			responseWriter.Write(buffer.data(), readResult);
 		}
+		channel.close();
+		responseWriter.Finish();
 		result.data.Seek(0, Framework::STREAM_SEEK_SET);
 		
 		return result;
 	}
 }
+
+//HttpURLConnection has no asynchronous API, batches run on threads that need to be known to the VM
+void CAndroidHttpClient::OnRequestThreadStart()
+{
+	JNIEnv* env = nullptr;
+	CJavaVM::AttachCurrentThread(&env, "HttpClient Request");
+}
+
+void CAndroidHttpClient::OnRequestThreadEnd()
+{
+	CJavaVM::DetachCurrentThread();
+}
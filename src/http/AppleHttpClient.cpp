@@ -1,18 +1,122 @@
 #import <Foundation/Foundation.h>
+#include <algorithm>
+#include <cassert>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
 #include "http/AppleHttpClient.h"
 
 using namespace Framework;
 using namespace Framework::Http;
 
-RequestResult CAppleHttpClient::SendRequest()
+//Connections are kept alive per session, all requests share one
+static NSURLSession* GetSharedSession()
 {
-	NSURLSessionConfiguration* sessionConfig = [NSURLSessionConfiguration defaultSessionConfiguration];
-	NSURLSession* session = [NSURLSession sessionWithConfiguration: sessionConfig];
-	
-	NSURL* url = [NSURL URLWithString: [NSString stringWithUTF8String: m_url.c_str()]];
+	static NSURLSession* session = nil;
+	static dispatch_once_t onceToken;
+	dispatch_once(&onceToken,
+		^{
+			NSURLSessionConfiguration* sessionConfig = [NSURLSessionConfiguration defaultSessionConfiguration];
+			session = [[NSURLSession sessionWithConfiguration: sessionConfig] retain];
+		});
+	return session;
+}
+
+//Request being sent with a response sink, data is handed to it by the session delegate as it arrives
+struct STREAMING_TASK
+{
+	RequestResult* result = nullptr;
+	const ResponseSink* responseSink = nullptr;
+	std::exception_ptr sinkException;
+	NSError* error = nil;
+	dispatch_semaphore_t doneSema = nullptr;
+};
+
+@interface FrameworkStreamingSessionDelegate : NSObject<NSURLSessionDataDelegate>
+{
+@public
+	std::mutex tasksMutex;
+	std::map<NSUInteger, STREAMING_TASK*> tasks;
+}
+@end
+
+@implementation FrameworkStreamingSessionDelegate
+
+-(STREAMING_TASK*)findTask: (NSURLSessionTask*)task
+{
+	std::lock_guard<std::mutex> lock(tasksMutex);
+	auto taskIterator = tasks.find([task taskIdentifier]);
+	return (taskIterator != std::end(tasks)) ? taskIterator->second : nullptr;
+}
+
+-(void)URLSession: (NSURLSession*)session dataTask: (NSURLSessionDataTask*)dataTask didReceiveResponse: (NSURLResponse*)response completionHandler: (void (^)(NSURLSessionResponseDisposition))completionHandler
+{
+	if(auto streamingTask = [self findTask: dataTask])
+	{
+		ReadResponseHeaders(*streamingTask->result, response);
+	}
+	completionHandler(NSURLSessionResponseAllow);
+}
+
+-(void)URLSession: (NSURLSession*)session dataTask: (NSURLSessionDataTask*)dataTask didReceiveData: (NSData*)data
+{
+	auto streamingTask = [self findTask: dataTask];
+	if(!streamingTask || streamingTask->sinkException) return;
+	[data enumerateByteRangesUsingBlock:
+		^(const void* bytes, NSRange byteRange, BOOL* stop)
+		{
+			try
+			{
+				(*streamingTask->responseSink)(bytes, byteRange.length);
+			}
+			catch(...)
+			{
+				streamingTask->sinkException = std::current_exception();
+				*stop = YES;
+			}
+		}];
+	if(streamingTask->sinkException)
+	{
+		[dataTask cancel];
+	}
+}
+
+-(void)URLSession: (NSURLSession*)session task: (NSURLSessionTask*)task didCompleteWithError: (NSError*)error
+{
+	if(auto streamingTask = [self findTask: task])
+	{
+		streamingTask->error = [error retain];
+		dispatch_semaphore_signal(streamingTask->doneSema);
+	}
+}
+
+@end
+
+//Getting data as it arrives needs a session delegate, streaming requests go through their own session
+static NSURLSession* GetStreamingSession(FrameworkStreamingSessionDelegate** sessionDelegate)
+{
+	static NSURLSession* session = nil;
+	static FrameworkStreamingSessionDelegate* delegate = nil;
+	static dispatch_once_t onceToken;
+	dispatch_once(&onceToken,
+		^{
+			NSURLSessionConfiguration* sessionConfig = [NSURLSessionConfiguration defaultSessionConfiguration];
+			delegate = [[FrameworkStreamingSessionDelegate alloc] init];
+			session = [[NSURLSession sessionWithConfiguration: sessionConfig delegate: delegate delegateQueue: nil] retain];
+		});
+	(*sessionDelegate) = delegate;
+	return session;
+}
+
+static NSMutableURLRequest* CreateUrlRequest(const std::string& urlString, HTTP_VERB verb, const HeaderMap& headers, const ByteArray& body)
+{
+	NSURL* url = [NSURL URLWithString: [NSString stringWithUTF8String: urlString.c_str()]];
 	NSMutableURLRequest* request = [NSMutableURLRequest requestWithURL: url];
 	
-	switch(m_verb)
+	switch(verb)
 	{
 	default:
 		assert(false);
@@ -30,19 +134,51 @@ RequestResult CAppleHttpClient::SendRequest()
 		break;
 	}
 	
-	for(const auto& header : m_headers)
+	for(const auto& header : headers)
 	{
-		NSString* key = [NSString stringWithUTF8String: header.first.c_str()];
-		NSString* value = [NSString stringWithUTF8String: header.second.c_str()];
+		NSString* key = [NSString stringWithUTF8String: header.name.data()];
+		NSString* value = [NSString stringWithUTF8String: header.value.data()];
 		[request setValue: value forHTTPHeaderField: key];
 	}
 	
-	if(!m_requestBody.empty())
+	if(!body.empty())
 	{
-		NSData* bodyData = [NSData dataWithBytes: m_requestBody.data() length: m_requestBody.size()];
+		NSData* bodyData = [NSData dataWithBytes: body.data() length: body.size()];
 		[request setHTTPBody: bodyData];
 	}
 	
+	return request;
+}
+
+static void ReadResponseHeaders(RequestResult& result, NSURLResponse* response)
+{
+	NSHTTPURLResponse* httpResponse = (NSHTTPURLResponse*)response;
+	result.statusCode = static_cast<HTTP_STATUS_CODE>([httpResponse statusCode]);
+	
+	for(NSString* key in httpResponse.allHeaderFields)
+	{
+		NSString* value = [httpResponse.allHeaderFields valueForKey: key];
+		result.headers.Add([key UTF8String], [value UTF8String]);
+	}
+}
+
+static void ReadResponse(RequestResult& result, NSData* data, NSURLResponse* response)
+{
+	ReadResponseHeaders(result, response);
+	result.data.Write([data bytes], [data length]);
+	result.data.Seek(0, Framework::STREAM_SEEK_SET);
+}
+
+RequestResult CAppleHttpClient::SendRequest()
+{
+	if(m_requestBodyStream || m_responseSink)
+	{
+		return SendStreamingRequest();
+	}
+	
+	NSURLSession* session = GetSharedSession();
+	NSMutableURLRequest* request = CreateUrlRequest(m_url, m_verb, GetRequestHeaders(m_headers, IsRequestBodyCompressed()), GetEncodedRequestBody());
+	
 	auto waitSema = dispatch_semaphore_create(0);
 	__block RequestResult result;
 	__block NSError* requestError = nil;
@@ -53,17 +189,7 @@ RequestResult CAppleHttpClient::SendRequest()
 			requestError = [error retain];
 			if(!error)
 			{
-				NSHTTPURLResponse* httpResponse = (NSHTTPURLResponse*)response;
-				result.statusCode = static_cast<HTTP_STATUS_CODE>([httpResponse statusCode]);
-				
-				for(NSString* key in httpResponse.allHeaderFields)
-				{
-					NSString* value = [httpResponse.allHeaderFields valueForKey: key];
-					result.headers.insert(std::make_pair([key UTF8String], [value UTF8String]));
-				}
-				
-				result.data.Write([data bytes], [data length]);
-				result.data.Seek(0, Framework::STREAM_SEEK_SET);
+				ReadResponse(result, data, response);
 			}
 			dispatch_semaphore_signal(waitSema);
 		};
@@ -81,3 +207,184 @@ RequestResult CAppleHttpClient::SendRequest()
 	
 	return result;
 }
+
+RequestResult CAppleHttpClient::SendStreamingRequest()
+{
+	FrameworkStreamingSessionDelegate* sessionDelegate = nil;
+	NSURLSession* session = GetStreamingSession(&sessionDelegate);
+	auto headers = GetRequestHeaders(m_headers, IsRequestBodyCompressed());
+	NSMutableURLRequest* request = CreateUrlRequest(m_url, m_verb, headers, m_requestBodyStream ? ByteArray() : GetEncodedRequestBody());
+	
+	//Body is copied from our stream to the one read by the session through a bound pair, a chunk at a time
+	std::thread bodyWriterThread;
+	if(m_requestBodyStream)
+	{
+		static const NSUInteger bufferSize = 0x10000;
+		NSInputStream* bodyInputStream = nil;
+		NSOutputStream* bodyOutputStream = nil;
+		[NSStream getBoundStreamsWithBufferSize: bufferSize inputStream: &bodyInputStream outputStream: &bodyOutputStream];
+		[request setHTTPBodyStream: bodyInputStream];
+		[request setValue: [NSString stringWithFormat: @"%llu", static_cast<unsigned long long>(m_requestBodyStreamLength)] forHTTPHeaderField: @"Content-Length"];
+		[bodyOutputStream retain];
+		bodyWriterThread = std::thread(
+			[bodyOutputStream, bodyStream = m_requestBodyStream, remainingSize = m_requestBodyStreamLength] () mutable
+			{
+				std::vector<uint8> buffer(bufferSize);
+				[bodyOutputStream open];
+				while(remainingSize != 0)
+				{
+					auto chunkSize = bodyStream->Read(buffer.data(), std::min<uint64>(remainingSize, bufferSize));
+					if(chunkSize == 0) break;
+					remainingSize -= chunkSize;
+					//Blocks until the session has read enough, fails once the task is over
+					for(uint64 written = 0; written != chunkSize;)
+					{
+						auto writeResult = [bodyOutputStream write: buffer.data() + written maxLength: static_cast<NSUInteger>(chunkSize - written)];
+						if(writeResult <= 0)
+						{
+							remainingSize = 0;
+							break;
+						}
+						written += writeResult;
+					}
+				}
+				[bodyOutputStream close];
+				[bodyOutputStream release];
+			});
+	}
+	
+	RequestResult result;
+	STREAMING_TASK streamingTask;
+	streamingTask.result = &result;
+	streamingTask.responseSink = &m_responseSink;
+	streamingTask.doneSema = dispatch_semaphore_create(0);
+	
+	//Tasks without a sink still go through here when only the body is streamed
+	ResponseSink dataSink;
+	if(!m_responseSink)
+	{
+		dataSink = [&result](const void* data, size_t size) { result.data.Write(data, size); };
+		streamingTask.responseSink = &dataSink;
+	}
+	
+	NSURLSessionDataTask* dataTask = [session dataTaskWithRequest: request];
+	{
+		std::lock_guard<std::mutex> lock(sessionDelegate->tasksMutex);
+		sessionDelegate->tasks[[dataTask taskIdentifier]] = &streamingTask;
+	}
+	[dataTask resume];
+	
+	dispatch_semaphore_wait(streamingTask.doneSema, DISPATCH_TIME_FOREVER);
+	dispatch_release(streamingTask.doneSema);
+	{
+		std::lock_guard<std::mutex> lock(sessionDelegate->tasksMutex);
+		sessionDelegate->tasks.erase([dataTask taskIdentifier]);
+	}
+	if(bodyWriterThread.joinable())
+	{
+		bodyWriterThread.join();
+	}
+	
+	if(streamingTask.sinkException)
+	{
+		[streamingTask.error release];
+		std::rethrow_exception(streamingTask.sinkException);
+	}
+	if(streamingTask.error)
+	{
+		[streamingTask.error release];
+		throw std::runtime_error("Failed to execute request");
+	}
+	
+	result.data.Seek(0, Framework::STREAM_SEEK_SET);
+	return result;
+}
+
+//NSURLSession sends its own Accept-Encoding and decodes responses before we get them
+bool CAppleHttpClient::HasNativeContentDecoding() const
+{
+	return true;
+}
+
+//Data tasks run concurrently on the shared session, which multiplexes them over HTTP/2 when the server allows it
+void CAppleHttpClient::SendRequests(const RequestArray& requests, const RequestCallback& callback, unsigned int maxRequestsPerHost)
+{
+	struct COMPLETION
+	{
+		size_t index = 0;
+		RequestResult result;
+		std::exception_ptr exception;
+	};
+	
+	NSURLSession* session = GetSharedSession();
+	auto completionSema = dispatch_semaphore_create(0);
+	auto completionMutex = std::make_shared<std::mutex>();
+	auto completions = std::make_shared<std::deque<COMPLETION>>();
+	
+	CRequestScheduler scheduler(requests, maxRequestsPerHost);
+	size_t activeCount = 0;
+	std::exception_ptr callbackException;
+	while(!scheduler.IsDone())
+	{
+		size_t index = 0;
+		while(!callbackException && scheduler.StartNext(index))
+		{
+			const auto& request = requests[index];
+			bool isBodyCompressed = m_requestBodyCompressionEnabled && !request.body.empty();
+			auto headers = GetRequestHeaders(request.headers, isBodyCompressed);
+			NSMutableURLRequest* urlRequest = CreateUrlRequest(request.url, request.verb, headers, isBodyCompressed ? EncodeRequestBody(request.body) : request.body);
+			auto completionHandler =
+				^(NSData* data, NSURLResponse* response, NSError* error)
+				{
+					COMPLETION completion;
+					completion.index = index;
+					if(error)
+					{
+						completion.exception = std::make_exception_ptr(std::runtime_error("Failed to execute request"));
+					}
+					else
+					{
+						ReadResponse(completion.result, data, response);
+					}
+					{
+						std::lock_guard<std::mutex> lock(*completionMutex);
+						completions->push_back(std::move(completion));
+					}
+					dispatch_semaphore_signal(completionSema);
+				};
+			NSURLSessionDataTask* dataTask = [session dataTaskWithRequest: urlRequest completionHandler: completionHandler];
+			[dataTask resume];
+			activeCount++;
+		}
+		
+		//Don't return while tasks are running, their handlers use our state
+		if(activeCount == 0) break;
+		
+		dispatch_semaphore_wait(completionSema, DISPATCH_TIME_FOREVER);
+		COMPLETION completion;
+		{
+			std::lock_guard<std::mutex> lock(*completionMutex);
+			assert(!completions->empty());
+			completion = std::move(completions->front());
+			completions->pop_front();
+		}
+		activeCount--;
+		scheduler.Complete(completion.index);
+		if(callbackException) continue;
+		try
+		{
+			callback(completion.index, completion.result, completion.exception);
+		}
+		catch(...)
+		{
+			//Let tasks in flight finish, but don't start new ones
+			callbackException = std::current_exception();
+		}
+	}
+	dispatch_release(completionSema);
+	
+	if(callbackException)
+	{
+		std::rethrow_exception(callbackException);
+	}
+}
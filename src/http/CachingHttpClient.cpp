@@ -0,0 +1,114 @@
+#include "http/CachingHttpClient.h"
+#include <cassert>
+#include "http/HttpClientFactory.h"
+
+using namespace Framework::Http;
+
+CCachingHttpClient::CCachingHttpClient(std::unique_ptr<CHttpClient> client, std::shared_ptr<CHttpResponseCache> cache)
+    : m_client(std::move(client))
+    , m_cache(std::move(cache))
+{
+	assert(m_client && m_cache);
+}
+
+RequestResult CCachingHttpClient::SendRequest()
+{
+	if(!IsCacheable())
+	{
+		SetupInnerClient(m_headers);
+		return m_client->SendRequest();
+	}
+
+	auto entry = m_cache->Find(m_url);
+	bool isRevalidationRequired = CHttpResponseCache::HasCacheDirective(m_headers, "no-cache");
+	if(entry && !isRevalidationRequired && CHttpResponseCache::IsFresh(*entry, CHttpResponseCache::GetCurrentTime()))
+	{
+		return MakeCachedResult(*entry);
+	}
+
+	auto headers = m_headers;
+	if(entry && !CHttpResponseCache::AddValidators(*entry, headers))
+	{
+		entry.reset();
+	}
+	SetupInnerClient(std::move(headers));
+
+	//Body given to the sink is kept on the side to be cached
+	ByteArray sinkBody;
+	if(m_responseSink)
+	{
+		m_client->SetResponseSink(
+		    [this, &sinkBody](const void* data, size_t size) {
+			    m_responseSink(data, size);
+			    auto bytes = reinterpret_cast<const uint8*>(data);
+			    sinkBody.insert(sinkBody.end(), bytes, bytes + size);
+		    });
+	}
+	auto result = m_client->SendRequest();
+	auto responseTime = CHttpResponseCache::GetCurrentTime();
+
+	if(entry && (result.statusCode == HTTP_STATUS_CODE::NOT_MODIFIED))
+	{
+		entry = m_cache->Refresh(m_url, entry, result.headers, responseTime);
+		return MakeCachedResult(*entry);
+	}
+	if(m_responseSink)
+	{
+		RequestResult storedResult;
+		storedResult.statusCode = result.statusCode;
+		storedResult.headers = result.headers;
+		storedResult.data = Framework::CMemStream(std::move(sinkBody));
+		m_cache->Store(m_url, storedResult, responseTime);
+	}
+	else
+	{
+		m_cache->Store(m_url, result, responseTime);
+	}
+	return result;
+}
+
+std::unique_ptr<CHttpClient> CCachingHttpClient::CreateRequestClient() const
+{
+	return std::make_unique<CCachingHttpClient>(CreateHttpClient(), m_cache);
+}
+
+bool CCachingHttpClient::IsCacheable() const
+{
+	return (m_verb == HTTP_VERB::GET) && m_requestBody.empty() && !m_requestBodyStream &&
+	       !m_headers.Has("Range") && !CHttpResponseCache::HasCacheDirective(m_headers, "no-store");
+}
+
+void CCachingHttpClient::SetupInnerClient(HeaderMap headers)
+{
+	m_client->SetUrl(m_url);
+	m_client->SetVerb(m_verb);
+	m_client->SetHeaders(std::move(headers));
+	if(m_requestBodyStream)
+	{
+		m_client->SetRequestBodyStream(*m_requestBodyStream, m_requestBodyStreamLength);
+	}
+	else
+	{
+		m_client->SetRequestBody(m_requestBody);
+	}
+	m_client->SetResponseSink(m_responseSink);
+	m_client->SetContentDecodingEnabled(m_contentDecodingEnabled);
+	m_client->SetRequestBodyCompressionEnabled(m_requestBodyCompressionEnabled);
+}
+
+RequestResult CCachingHttpClient::MakeCachedResult(const CHttpResponseCache::ENTRY& entry) const
+{
+	RequestResult result;
+	result.statusCode = HTTP_STATUS_CODE::OK;
+	result.headers = entry.headers;
+	if(m_responseSink)
+	{
+		m_responseSink(entry.body.data(), entry.body.size());
+	}
+	else
+	{
+		result.data.Write(entry.body.data(), entry.body.size());
+		result.data.Seek(0, Framework::STREAM_SEEK_SET);
+	}
+	return result;
+}
@@ -1,47 +1,131 @@
 #include <cassert>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <stdexcept>
+#include <vector>
 #include <curl/curl.h>
 #include "http/CurlHttpClient.h"
 #include "string_format.h"
+#include "stricmp.h"
 #include "PtrStream.h"
+#include "StringUtils.h"
 
 using namespace Framework;
 using namespace Framework::Http;
 
-static size_t readCallback(char* buffer, size_t size, size_t nmemb, void* userdata)
+//Shared by every client of the process: DNS cache, TLS sessions and connections are shared through a
+//share handle and easy handles are reused, keeping their own connection caches alive between requests.
+class CCurlConnectionPool
 {
-	auto totalSize = size * nmemb;
-	auto inputStream = reinterpret_cast<Framework::CPtrStream*>(userdata);
-	return inputStream->Read(buffer, totalSize);
-}
+public:
+	enum
+	{
+		MAX_IDLE_HANDLES = 16,
+	};
 
-static size_t writeCallback(char* ptr, size_t size, size_t nmemb, void* userdata)
-{
-	auto totalSize = size * nmemb;
-	auto outputStream = reinterpret_cast<decltype(Framework::Http::RequestResult::data)*>(userdata);
-	outputStream->Write(ptr, totalSize);
-	return totalSize;
-}
+	static CCurlConnectionPool& GetInstance()
+	{
+		static CCurlConnectionPool instance;
+		return instance;
+	}
 
-static size_t headerCallback(char* buffer, size_t size, size_t nitems, void* userdata)
-{
-	auto totalSize = size * nitems;
-	auto outputStream = reinterpret_cast<Framework::CMemStream*>(userdata);
-	outputStream->Write(buffer, totalSize);
-	return totalSize;
-}
+	CURL* AcquireHandle()
+	{
+		CURL* handle = nullptr;
+		{
+			std::unique_lock<std::mutex> lock(m_idleHandlesMutex);
+			if(!m_idleHandles.empty())
+			{
+				handle = m_idleHandles.back();
+				m_idleHandles.pop_back();
+			}
+		}
+		if(handle)
+		{
+			curl_easy_reset(handle);
+		}
+		else
+		{
+			handle = curl_easy_init();
+			if(!handle)
+			{
+				throw std::runtime_error("Failed to create curl handle.");
+			}
+		}
+		curl_easy_setopt(handle, CURLOPT_SHARE, m_share);
+		curl_easy_setopt(handle, CURLOPT_TCP_KEEPALIVE, 1L);
+		return handle;
+	}
+
+	void ReleaseHandle(CURL* handle)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_idleHandlesMutex);
+			if(m_idleHandles.size() < MAX_IDLE_HANDLES)
+			{
+				m_idleHandles.push_back(handle);
+				return;
+			}
+		}
+		curl_easy_cleanup(handle);
+	}
+
+private:
+	CCurlConnectionPool()
+	{
+		curl_global_init(CURL_GLOBAL_DEFAULT);
+		m_share = curl_share_init();
+		curl_share_setopt(m_share, CURLSHOPT_LOCKFUNC, &LockShare);
+		curl_share_setopt(m_share, CURLSHOPT_UNLOCKFUNC, &UnlockShare);
+		curl_share_setopt(m_share, CURLSHOPT_USERDATA, this);
+		curl_share_setopt(m_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+		curl_share_setopt(m_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+#if LIBCURL_VERSION_NUM >= 0x073900
+		//Sharing the connection cache needs curl 7.57.0
+		curl_share_setopt(m_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+#endif
+	}
+
+	~CCurlConnectionPool()
+	{
+		for(auto handle : m_idleHandles)
+		{
+			curl_easy_cleanup(handle);
+		}
+		curl_share_cleanup(m_share);
+	}
+
+	static void LockShare(CURL*, curl_lock_data data, curl_lock_access, void* userPtr)
+	{
+		auto pool = reinterpret_cast<CCurlConnectionPool*>(userPtr);
+		pool->m_shareMutexes[data % CURL_LOCK_DATA_LAST].lock();
+	}
+
+	static void UnlockShare(CURL*, curl_lock_data data, void* userPtr)
+	{
+		auto pool = reinterpret_cast<CCurlConnectionPool*>(userPtr);
+		pool->m_shareMutexes[data % CURL_LOCK_DATA_LAST].unlock();
+	}
+
+	CURLSH* m_share = nullptr;
+	std::mutex m_shareMutexes[CURL_LOCK_DATA_LAST];
+	std::mutex m_idleHandlesMutex;
+	std::vector<CURL*> m_idleHandles;
+};
 
 class CCurlRequest
 {
 public:
 	CCurlRequest()
 	{
-		m_curl = curl_easy_init();
+		m_curl = CCurlConnectionPool::GetInstance().AcquireHandle();
 	}
 
 	~CCurlRequest()
 	{
-		curl_easy_cleanup(m_curl);
+		CCurlConnectionPool::GetInstance().ReleaseHandle(m_curl);
 	}
 
 	operator CURL*() const
@@ -56,83 +140,294 @@ private:
 	CURL* m_curl = nullptr;
 };
 
-RequestResult CCurlHttpClient::SendRequest()
+//State of a request while it's being sent
+struct CCurlHttpClient::TRANSFER
 {
-	RequestResult result;
-	CCurlRequest curl;
-	assert(curl != nullptr);
+	~TRANSFER()
 	{
-		Framework::CPtrStream bodyInputStream(m_requestBody.data(), m_requestBody.size());
-		Framework::CMemStream responseHeadersStream;
-
-		curl_easy_setopt(curl, CURLOPT_URL, m_url.c_str());
-		curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
-		curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, &writeCallback);
-		curl_easy_setopt(curl, CURLOPT_WRITEDATA, &result.data);
-		curl_easy_setopt(curl, CURLOPT_READFUNCTION, &readCallback);
-		curl_easy_setopt(curl, CURLOPT_READDATA, &bodyInputStream);
-		curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, &headerCallback);
-		curl_easy_setopt(curl, CURLOPT_HEADERDATA, &responseHeadersStream);
+		if(headerList)
+		{
+			curl_slist_free_all(headerList);
+		}
+	}
 
-		auto caBundlePath = m_globalSettings[GLOBAL_SETTING::CERTIFICATE_AUTHORITY_BUNDLE];
-		if(!caBundlePath.empty())
+	//Exceptions can't go through curl, they're kept and thrown once the transfer is aborted
+	static size_t ReadCallback(char* buffer, size_t size, size_t nmemb, void* userdata)
+	{
+		auto transfer = reinterpret_cast<TRANSFER*>(userdata);
+		try
 		{
-			curl_easy_setopt(curl, CURLOPT_CAINFO, caBundlePath.c_str());
+			return static_cast<size_t>(transfer->bodyStream->Read(buffer, size * nmemb));
 		}
+		catch(...)
+		{
+			transfer->callbackException = std::current_exception();
+			return CURL_READFUNC_ABORT;
+		}
+	}
 
-		switch(m_verb)
+	//Needed to send the body again when a reused connection turns out to be closed
+	static int SeekCallback(void* userdata, curl_off_t offset, int origin)
+	{
+		auto transfer = reinterpret_cast<TRANSFER*>(userdata);
+		if(origin != SEEK_SET) return CURL_SEEKFUNC_CANTSEEK;
+		try
 		{
-		case HTTP_VERB::DELETE:
-			curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "DELETE");
-			break;
-		case HTTP_VERB::HEAD:
-			curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "HEAD");
-			break;
-		case HTTP_VERB::GET:
-			break;
-		case HTTP_VERB::PUT:
-			curl_easy_setopt(curl, CURLOPT_UPLOAD, 1L);
-			curl_easy_setopt(curl, CURLOPT_INFILESIZE, m_requestBody.size());
-			break;
-		default:
-			throw std::runtime_error("Unsupported HTTP verb.");
+			transfer->bodyStream->Seek(offset, Framework::STREAM_SEEK_SET);
+			return CURL_SEEKFUNC_OK;
 		}
+		catch(...)
+		{
+			return CURL_SEEKFUNC_CANTSEEK;
+		}
+	}
 
-		curl_slist* headerList = nullptr;
-		if(!m_headers.empty())
+	static size_t WriteCallback(char* ptr, size_t size, size_t nmemb, void* userdata)
+	{
+		auto transfer = reinterpret_cast<TRANSFER*>(userdata);
+		auto totalSize = size * nmemb;
+		try
 		{
-			for(const auto& headerPair : m_headers)
+			if(!transfer->isBodyStarted)
 			{
-				auto headerString = headerPair.first + ": " + headerPair.second;
-				headerList = curl_slist_append(headerList, headerString.c_str());
+				transfer->responseWriter->SetContentEncoding(transfer->contentEncoding);
+				transfer->isBodyStarted = true;
 			}
-			curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headerList);
+			transfer->responseWriter->Write(ptr, totalSize);
+			return totalSize;
 		}
+		catch(...)
+		{
+			transfer->callbackException = std::current_exception();
+			return 0;
+		}
+	}
 
-		auto performResult = curl_easy_perform(curl);
-
-		if(headerList)
+	//Headers of every response are kept (redirects included), but the body is the one of the last
+	static size_t HeaderCallback(char* buffer, size_t size, size_t nitems, void* userdata)
+	{
+		auto transfer = reinterpret_cast<TRANSFER*>(userdata);
+		auto totalSize = size * nitems;
+		transfer->responseHeadersStream.Write(buffer, totalSize);
+		static const char contentEncodingName[] = "Content-Encoding:";
+		static const size_t contentEncodingNameLength = sizeof(contentEncodingName) - 1;
+		if((totalSize >= 5) && !strncmp(buffer, "HTTP/", 5))
 		{
-			curl_slist_free_all(headerList);
-			headerList = nullptr;
+			transfer->contentEncoding.clear();
 		}
+		else if((totalSize > contentEncodingNameLength) && !strnicmp(buffer, contentEncodingName, contentEncodingNameLength))
+		{
+			transfer->contentEncoding = StringUtils::Trim(std::string(buffer + contentEncodingNameLength, totalSize - contentEncodingNameLength));
+		}
+		return totalSize;
+	}
+
+	CCurlRequest curl;
+	std::unique_ptr<Framework::CPtrStream> bodyMemoryStream;
+	ByteArray encodedBody;
+	Framework::CStream* bodyStream = nullptr;
+	uint64 bodySize = 0;
+	ResponseSink responseSink;
+	std::unique_ptr<CResponseBodyWriter> responseWriter;
+	std::string contentEncoding;
+	bool isBodyStarted = false;
+	Framework::CMemStream responseHeadersStream;
+	curl_slist* headerList = nullptr;
+	HTTP_VERB verb = HTTP_VERB::GET;
+	size_t index = 0;
+	RequestResult result;
+	std::exception_ptr callbackException;
+};
 
-		if(!(
-		    (performResult == CURLE_OK) ||
-		    ((performResult == CURLE_PARTIAL_FILE) && (m_verb == Framework::Http::HTTP_VERB::HEAD))
-		))
+RequestResult CCurlHttpClient::SendRequest()
+{
+	TRANSFER transfer;
+	transfer.bodyStream = &GetRequestBodyStream(transfer.bodyMemoryStream);
+	transfer.bodySize = GetRequestBodySize();
+	transfer.responseSink = m_responseSink;
+	transfer.responseWriter = std::make_unique<CResponseBodyWriter>(transfer.result, transfer.responseSink, IsContentDecodingEnabled());
+	SetupTransfer(transfer, m_url, m_verb, GetRequestHeaders(m_headers, IsRequestBodyCompressed()));
+	auto performResult = curl_easy_perform(transfer.curl);
+	CompleteTransfer(transfer, performResult);
+	return std::move(transfer.result);
+}
+
+//Transfers run on a multi handle, HTTP/2 requests to the same host are multiplexed on one connection
+void CCurlHttpClient::SendRequests(const RequestArray& requests, const RequestCallback& callback, unsigned int maxRequestsPerHost)
+{
+	CURLM* multi = curl_multi_init();
+	if(!multi)
+	{
+		throw std::runtime_error("Failed to create curl multi handle.");
+	}
+	curl_multi_setopt(multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+
+	std::map<CURL*, std::unique_ptr<TRANSFER>> transfers;
+	auto cleanup =
+	    [&]() {
+		    for(const auto& transferPair : transfers)
+		    {
+			    curl_multi_remove_handle(multi, transferPair.first);
+		    }
+		    transfers.clear();
+		    curl_multi_cleanup(multi);
+	    };
+
+	try
+	{
+		CRequestScheduler scheduler(requests, maxRequestsPerHost);
+		while(!scheduler.IsDone())
 		{
-			auto errorMessage = string_format("Failed to execute request: %s.", curl_easy_strerror(performResult));
-			throw std::runtime_error(errorMessage);
+			size_t index = 0;
+			while(scheduler.StartNext(index))
+			{
+				const auto& request = requests[index];
+				auto transfer = std::make_unique<TRANSFER>();
+				transfer->index = index;
+				bool isBodyCompressed = m_requestBodyCompressionEnabled && !request.body.empty();
+				if(isBodyCompressed)
+				{
+					transfer->encodedBody = EncodeRequestBody(request.body);
+				}
+				const auto& body = isBodyCompressed ? transfer->encodedBody : request.body;
+				transfer->bodyMemoryStream = std::make_unique<Framework::CPtrStream>(body.data(), body.size());
+				transfer->bodyStream = transfer->bodyMemoryStream.get();
+				transfer->bodySize = body.size();
+				transfer->responseWriter = std::make_unique<CResponseBodyWriter>(transfer->result, transfer->responseSink, IsContentDecodingEnabled());
+				SetupTransfer(*transfer, request.url, request.verb, GetRequestHeaders(request.headers, isBodyCompressed));
+				//Wait for a connection that can multiplex instead of opening a new one
+				curl_easy_setopt(transfer->curl, CURLOPT_PIPEWAIT, 1L);
+				CURL* curl = transfer->curl;
+				transfers.emplace(curl, std::move(transfer));
+				curl_multi_add_handle(multi, curl);
+			}
+
+			int runningCount = 0;
+			auto multiResult = curl_multi_perform(multi, &runningCount);
+			if(multiResult != CURLM_OK)
+			{
+				throw std::runtime_error(string_format("Failed to execute requests: %s.", curl_multi_strerror(multiResult)));
+			}
+
+			bool hasCompleted = false;
+			int messageCount = 0;
+			while(auto message = curl_multi_info_read(multi, &messageCount))
+			{
+				if(message->msg != CURLMSG_DONE) continue;
+				auto transferIterator = transfers.find(message->easy_handle);
+				assert(transferIterator != std::end(transfers));
+				auto transfer = std::move(transferIterator->second);
+				transfers.erase(transferIterator);
+				curl_multi_remove_handle(multi, message->easy_handle);
+
+				std::exception_ptr exception;
+				try
+				{
+					CompleteTransfer(*transfer, message->data.result);
+				}
+				catch(...)
+				{
+					exception = std::current_exception();
+				}
+				scheduler.Complete(transfer->index);
+				hasCompleted = true;
+				callback(transfer->index, transfer->result, exception);
+			}
+
+			if(!hasCompleted && (runningCount != 0))
+			{
+				curl_multi_wait(multi, nullptr, 0, 1000, nullptr);
+			}
 		}
+	}
+	catch(...)
+	{
+		cleanup();
+		throw;
+	}
+	cleanup();
+}
+
+void CCurlHttpClient::SetupTransfer(TRANSFER& transfer, const std::string& url, HTTP_VERB verb, const HeaderMap& headers)
+{
+	CURL* curl = transfer.curl;
+	transfer.verb = verb;
 
-		long responseCode = 0;
-		curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &responseCode);
-		result.statusCode = static_cast<Framework::Http::HTTP_STATUS_CODE>(responseCode);
-		result.data.Seek(0, Framework::STREAM_SEEK_SET);
+	curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+	curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+	curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);
+	curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, &TRANSFER::WriteCallback);
+	curl_easy_setopt(curl, CURLOPT_WRITEDATA, &transfer);
+	curl_easy_setopt(curl, CURLOPT_READFUNCTION, &TRANSFER::ReadCallback);
+	curl_easy_setopt(curl, CURLOPT_READDATA, &transfer);
+	curl_easy_setopt(curl, CURLOPT_SEEKFUNCTION, &TRANSFER::SeekCallback);
+	curl_easy_setopt(curl, CURLOPT_SEEKDATA, &transfer);
+	curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, &TRANSFER::HeaderCallback);
+	curl_easy_setopt(curl, CURLOPT_HEADERDATA, &transfer);
 
-		responseHeadersStream.Seek(0, Framework::STREAM_SEEK_SET);
-		result.headers = ReadHeaderMap(responseHeadersStream);
+	auto caBundlePath = m_globalSettings[GLOBAL_SETTING::CERTIFICATE_AUTHORITY_BUNDLE];
+	if(!caBundlePath.empty())
+	{
+		curl_easy_setopt(curl, CURLOPT_CAINFO, caBundlePath.c_str());
+	}
+
+	switch(verb)
+	{
+	case HTTP_VERB::DELETE:
+		curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "DELETE");
+		break;
+	case HTTP_VERB::HEAD:
+		//Otherwise curl waits for a body on connections that are kept alive
+		curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);
+		break;
+	case HTTP_VERB::GET:
+		break;
+	case HTTP_VERB::POST:
+		curl_easy_setopt(curl, CURLOPT_POST, 1L);
+		curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE_LARGE, static_cast<curl_off_t>(transfer.bodySize));
+		break;
+	case HTTP_VERB::PUT:
+		curl_easy_setopt(curl, CURLOPT_UPLOAD, 1L);
+		curl_easy_setopt(curl, CURLOPT_INFILESIZE_LARGE, static_cast<curl_off_t>(transfer.bodySize));
+		break;
+	default:
+		throw std::runtime_error("Unsupported HTTP verb.");
 	}
-	return result;
+
+	if(!headers.IsEmpty())
+	{
+		for(const auto& header : headers)
+		{
+			auto headerString = std::string(header.name) + ": " + std::string(header.value);
+			transfer.headerList = curl_slist_append(transfer.headerList, headerString.c_str());
+		}
+		curl_easy_setopt(curl, CURLOPT_HTTPHEADER, transfer.headerList);
+	}
+}
+
+void CCurlHttpClient::CompleteTransfer(TRANSFER& transfer, int result)
+{
+	auto performResult = static_cast<CURLcode>(result);
+	if(transfer.callbackException)
+	{
+		std::rethrow_exception(transfer.callbackException);
+	}
+	if(!(
+	    (performResult == CURLE_OK) ||
+	    ((performResult == CURLE_PARTIAL_FILE) && (transfer.verb == Framework::Http::HTTP_VERB::HEAD))
+	))
+	{
+		auto errorMessage = string_format("Failed to execute request: %s.", curl_easy_strerror(performResult));
+		throw std::runtime_error(errorMessage);
+	}
+
+	transfer.responseWriter->Finish();
+
+	long responseCode = 0;
+	curl_easy_getinfo(transfer.curl, CURLINFO_RESPONSE_CODE, &responseCode);
+	transfer.result.statusCode = static_cast<Framework::Http::HTTP_STATUS_CODE>(responseCode);
+	transfer.result.data.Seek(0, Framework::STREAM_SEEK_SET);
+
+	transfer.responseHeadersStream.Seek(0, Framework::STREAM_SEEK_SET);
+	transfer.result.headers = ReadHeaderMap(transfer.responseHeadersStream);
 }
@@ -0,0 +1,225 @@
+#include "http/HeaderMap.h"
+#include <algorithm>
+#include <cassert>
+
+using namespace Framework::Http;
+
+static char ToLower(char value)
+{
+	return ((value >= 'A') && (value <= 'Z')) ? static_cast<char>(value - 'A' + 'a') : value;
+}
+
+static bool IsEqualNoCase(std::string_view lhs, std::string_view rhs)
+{
+	if(lhs.size() != rhs.size()) return false;
+	for(size_t i = 0; i < lhs.size(); i++)
+	{
+		if(ToLower(lhs[i]) != ToLower(rhs[i])) return false;
+	}
+	return true;
+}
+
+size_t CHeaderMap::GetCount() const
+{
+	return m_heapEntries.empty() ? m_inlineCount : m_heapEntries.size();
+}
+
+bool CHeaderMap::IsEmpty() const
+{
+	return GetCount() == 0;
+}
+
+CHeaderMap::HEADER CHeaderMap::GetHeader(size_t index) const
+{
+	assert(index < GetCount());
+	const auto& entry = GetEntries()[index];
+	HEADER header;
+	header.name = GetText(entry.nameOffset, entry.nameSize);
+	header.value = GetText(entry.valueOffset, entry.valueSize);
+	return header;
+}
+
+CHeaderMap::CIterator CHeaderMap::begin() const
+{
+	return CIterator(*this, 0);
+}
+
+CHeaderMap::CIterator CHeaderMap::end() const
+{
+	return CIterator(*this, GetCount());
+}
+
+std::string_view CHeaderMap::Get(std::string_view name) const
+{
+	size_t index = FindEntry(name, ComputeHash(name));
+	if(index == GetCount()) return std::string_view();
+	const auto& entry = GetEntries()[index];
+	return GetText(entry.valueOffset, entry.valueSize);
+}
+
+bool CHeaderMap::Has(std::string_view name) const
+{
+	return FindEntry(name, ComputeHash(name)) != GetCount();
+}
+
+void CHeaderMap::Set(std::string_view name, std::string_view value)
+{
+	uint32 hash = ComputeHash(name);
+	size_t index = FindEntry(name, hash);
+	if(index == GetCount())
+	{
+		Add(name, value);
+		return;
+	}
+	while(1)
+	{
+		size_t otherIndex = FindEntry(name, hash, index + 1);
+		if(otherIndex == GetCount()) break;
+		RemoveEntry(otherIndex);
+	}
+	auto& entry = GetEntries()[index];
+	if(value.size() <= entry.valueSize)
+	{
+		//Fits where the previous one was
+		m_text.replace(entry.valueOffset, value.size(), value.data(), value.size());
+		m_text[entry.valueOffset + value.size()] = 0;
+		m_unusedTextSize += entry.valueSize - value.size();
+		entry.valueSize = static_cast<uint32>(value.size());
+	}
+	else
+	{
+		CompactText();
+		entry.valueOffset = StoreText(value);
+		m_unusedTextSize += entry.valueSize + 1;
+		entry.valueSize = static_cast<uint32>(value.size());
+	}
+}
+
+void CHeaderMap::Add(std::string_view name, std::string_view value)
+{
+	CompactText();
+	ENTRY entry;
+	entry.hash = ComputeHash(name);
+	entry.nameSize = static_cast<uint32>(name.size());
+	entry.nameOffset = StoreText(name);
+	entry.valueSize = static_cast<uint32>(value.size());
+	entry.valueOffset = StoreText(value);
+	if(m_heapEntries.empty() && (m_inlineCount < INLINE_COUNT))
+	{
+		m_inlineEntries[m_inlineCount++] = entry;
+		return;
+	}
+	if(m_heapEntries.empty())
+	{
+		m_heapEntries.reserve(INLINE_COUNT * 2);
+		m_heapEntries.assign(m_inlineEntries.begin(), m_inlineEntries.begin() + m_inlineCount);
+		m_inlineCount = 0;
+	}
+	m_heapEntries.push_back(entry);
+}
+
+size_t CHeaderMap::Remove(std::string_view name)
+{
+	uint32 hash = ComputeHash(name);
+	size_t removedCount = 0;
+	for(size_t index = FindEntry(name, hash); index != GetCount(); index = FindEntry(name, hash, index))
+	{
+		RemoveEntry(index);
+		removedCount++;
+	}
+	CompactText();
+	return removedCount;
+}
+
+void CHeaderMap::Clear()
+{
+	m_inlineCount = 0;
+	m_heapEntries.clear();
+	m_text.clear();
+	m_unusedTextSize = 0;
+}
+
+uint32 CHeaderMap::ComputeHash(std::string_view name)
+{
+	//FNV-1a over the lower case name
+	uint32 hash = 0x811C9DC5;
+	for(char value : name)
+	{
+		hash ^= static_cast<uint8>(ToLower(value));
+		hash *= 0x01000193;
+	}
+	return hash;
+}
+
+const CHeaderMap::ENTRY* CHeaderMap::GetEntries() const
+{
+	return m_heapEntries.empty() ? m_inlineEntries.data() : m_heapEntries.data();
+}
+
+CHeaderMap::ENTRY* CHeaderMap::GetEntries()
+{
+	return m_heapEntries.empty() ? m_inlineEntries.data() : m_heapEntries.data();
+}
+
+size_t CHeaderMap::FindEntry(std::string_view name, uint32 hash, size_t startIndex) const
+{
+	auto entries = GetEntries();
+	size_t count = GetCount();
+	for(size_t index = startIndex; index < count; index++)
+	{
+		const auto& entry = entries[index];
+		if((entry.hash == hash) && IsEqualNoCase(GetText(entry.nameOffset, entry.nameSize), name))
+		{
+			return index;
+		}
+	}
+	return count;
+}
+
+void CHeaderMap::RemoveEntry(size_t index)
+{
+	auto entries = GetEntries();
+	m_unusedTextSize += entries[index].nameSize + entries[index].valueSize + 2;
+	if(m_heapEntries.empty())
+	{
+		std::copy(m_inlineEntries.begin() + index + 1, m_inlineEntries.begin() + m_inlineCount, m_inlineEntries.begin() + index);
+		m_inlineCount--;
+	}
+	else
+	{
+		m_heapEntries.erase(m_heapEntries.begin() + index);
+	}
+}
+
+uint32 CHeaderMap::StoreText(std::string_view text)
+{
+	auto offset = static_cast<uint32>(m_text.size());
+	m_text.append(text.data(), text.size());
+	m_text.push_back(0);
+	return offset;
+}
+
+std::string_view CHeaderMap::GetText(uint32 offset, uint32 size) const
+{
+	return std::string_view(m_text.data() + offset, size);
+}
+
+void CHeaderMap::CompactText()
+{
+	if((m_unusedTextSize == 0) || ((m_unusedTextSize * 2) < m_text.size())) return;
+	std::string text;
+	text.reserve(m_text.size() - m_unusedTextSize);
+	auto entries = GetEntries();
+	for(size_t index = 0; index < GetCount(); index++)
+	{
+		auto& entry = entries[index];
+		auto nameOffset = static_cast<uint32>(text.size());
+		text.append(m_text, entry.nameOffset, entry.nameSize + 1);
+		auto valueOffset = static_cast<uint32>(text.size());
+		text.append(m_text, entry.valueOffset, entry.valueSize + 1);
+		entry.nameOffset = nameOffset;
+		entry.valueOffset = valueOffset;
+	}
+	m_text = std::move(text);
+	m_unusedTextSize = 0;
+}
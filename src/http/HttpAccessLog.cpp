@@ -0,0 +1,167 @@
+#include "http/HttpAccessLog.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include "StdStreamUtils.h"
+
+using namespace Framework;
+
+static int64 GetCurrentTimeUs()
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+CHttpAccessLog::CHttpAccessLog(const fs::path& path, unsigned int capacity)
+    : m_stream(path.native().c_str(), GetAppendStdStreamMode<fs::path::string_type>())
+    , m_records(capacity)
+{
+	m_writerThread = std::thread([this]() { WriterThreadProc(); });
+}
+
+CHttpAccessLog::~CHttpAccessLog()
+{
+	{
+		std::unique_lock<std::mutex> lock(m_writerMutex);
+		m_stop = true;
+	}
+	m_writerCondition.notify_one();
+	m_writerThread.join();
+}
+
+void CHttpAccessLog::WriteRequest(const std::string_view& method, const std::string_view& url, unsigned int statusCode, uint64 size, uint64 latencyUs)
+{
+	RECORD record;
+	record.type = RECORD_TYPE_REQUEST;
+	record.timeUs = GetCurrentTimeUs();
+	record.statusCode = statusCode;
+	record.size = size;
+	record.latencyUs = latencyUs;
+	record.methodLength = static_cast<uint8>(std::min<size_t>(method.size(), MAX_METHOD_SIZE));
+	memcpy(record.method, method.data(), record.methodLength);
+	record.textLength = static_cast<uint16>(std::min<size_t>(url.size(), MAX_TEXT_SIZE));
+	memcpy(record.text, url.data(), record.textLength);
+	Push(record);
+}
+
+void CHttpAccessLog::WriteMessage(const char* format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	WriteMessageV(format, args);
+	va_end(args);
+}
+
+void CHttpAccessLog::WriteMessageV(const char* format, va_list args)
+{
+	RECORD record;
+	record.type = RECORD_TYPE_MESSAGE;
+	record.timeUs = GetCurrentTimeUs();
+	int length = vsnprintf(record.text, MAX_TEXT_SIZE, format, args);
+	if(length < 0) return;
+	length = std::min<int>(length, MAX_TEXT_SIZE - 1);
+	//Line endings are added when writing
+	while((length != 0) && ((record.text[length - 1] == '\r') || (record.text[length - 1] == '\n')))
+	{
+		length--;
+	}
+	record.textLength = static_cast<uint16>(length);
+	Push(record);
+}
+
+uint64 CHttpAccessLog::GetDroppedCount() const
+{
+	return m_droppedCount.load(std::memory_order_relaxed);
+}
+
+void CHttpAccessLog::Push(const RECORD& record)
+{
+	if(!m_records.TryPush(record))
+	{
+		m_droppedCount.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+	//The writer also wakes up periodically, a notification lost to a race only delays the write
+	if(m_isWriterWaiting.load())
+	{
+		m_isWriterWaiting = false;
+		m_writerCondition.notify_one();
+	}
+}
+
+void CHttpAccessLog::WriterThreadProc()
+{
+	RECORD records[BATCH_SIZE];
+	std::string buffer;
+	uint64 reportedDroppedCount = 0;
+	while(1)
+	{
+		bool stopping = m_stop;
+		size_t recordCount = m_records.TryPopBatch(records, BATCH_SIZE);
+		for(size_t i = 0; i < recordCount; i++)
+		{
+			FormatRecord(buffer, records[i]);
+		}
+		if(recordCount == BATCH_SIZE) continue;
+
+		auto droppedCount = GetDroppedCount();
+		if(droppedCount != reportedDroppedCount)
+		{
+			RECORD record;
+			record.timeUs = GetCurrentTimeUs();
+			record.textLength = static_cast<uint16>(snprintf(record.text, MAX_TEXT_SIZE, "dropped=%llu",
+			                                                 static_cast<unsigned long long>(droppedCount - reportedDroppedCount)));
+			FormatRecord(buffer, record);
+			reportedDroppedCount = droppedCount;
+		}
+		if(!buffer.empty())
+		{
+			m_stream.Write(buffer.data(), buffer.size());
+			m_stream.Flush();
+			buffer.clear();
+		}
+		//Everything pushed before the stop request has been written
+		if(stopping) break;
+
+		std::unique_lock<std::mutex> lock(m_writerMutex);
+		m_isWriterWaiting = true;
+		if(!m_stop)
+		{
+			m_writerCondition.wait_for(lock, std::chrono::milliseconds(IDLE_WAIT_MS));
+		}
+		m_isWriterWaiting = false;
+	}
+}
+
+void CHttpAccessLog::FormatRecord(std::string& output, const RECORD& record)
+{
+	time_t seconds = static_cast<time_t>(record.timeUs / 1000000);
+	tm timeParts = {};
+#ifdef _WIN32
+	gmtime_s(&timeParts, &seconds);
+#else
+	gmtime_r(&seconds, &timeParts);
+#endif
+	char line[128];
+	snprintf(line, sizeof(line), "time=%04d-%02d-%02dT%02d:%02d:%02d.%03dZ ", timeParts.tm_year + 1900, timeParts.tm_mon + 1, timeParts.tm_mday,
+	         timeParts.tm_hour, timeParts.tm_min, timeParts.tm_sec, static_cast<int>((record.timeUs / 1000) % 1000));
+	output += line;
+	if(record.type == RECORD_TYPE_REQUEST)
+	{
+		output += "method=";
+		output.append(record.method, record.methodLength);
+		output += " url=";
+		output.append(record.text, record.textLength);
+		snprintf(line, sizeof(line), " status=%u bytes=%llu latency_us=%llu\r\n", record.statusCode,
+		         static_cast<unsigned long long>(record.size), static_cast<unsigned long long>(record.latencyUs));
+		output += line;
+	}
+	else
+	{
+		output += "message=\"";
+		output.append(record.text, record.textLength);
+		output += "\"\r\n";
+	}
+}
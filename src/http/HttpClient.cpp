@@ -1,7 +1,21 @@
 #include "http/HttpClient.h"
+#include <algorithm>
+#include <cassert>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include "http/HttpClientFactory.h"
+#include "http/HttpContentEncoding.h"
+#include "StringUtils.h"
+#include "Url.h"
 
 using namespace Framework::Http;
 
+//Used by the default SendRequests implementation, backends that can't multiplex requests on their own
+static const unsigned int g_maxRequestThreadCount = 16;
+
 GlobalSettingMap CHttpClient::m_globalSettings;
 
 void CHttpClient::SetGlobalSetting(GLOBAL_SETTING setting, std::string value)
@@ -18,9 +32,9 @@ HeaderMap CHttpClient::ReadHeaderMap(Framework::CStream& stream)
 		auto colonPos = line.find(':');
 		if(colonPos != std::string::npos)
 		{
-			auto key = std::string(line.substr(0, colonPos));
-			auto value = std::string(line.substr(colonPos + 2, line.length()));
-			result.insert(std::make_pair(key, value));
+			auto key = std::string_view(line).substr(0, colonPos);
+			auto value = std::string_view(line).substr(colonPos + 2);
+			result.Add(key, value);
 		}
 		line = stream.ReadLine();
 	}
@@ -45,9 +59,351 @@ void CHttpClient::SetHeaders(HeaderMap headers)
 void CHttpClient::SetRequestBody(ByteArray requestBody)
 {
 	m_requestBody = std::move(requestBody);
+	m_requestBodyStream = nullptr;
+	m_requestBodyStreamLength = 0;
+	m_isEncodedRequestBodyValid = false;
 }
 
 void CHttpClient::SetRequestBody(std::string requestBody)
 {
 	SetRequestBody(ByteArray(requestBody.c_str(), requestBody.c_str() + requestBody.length()));
 }
+
+void CHttpClient::SetRequestBodyStream(Framework::CStream& stream, uint64 length)
+{
+	m_requestBody.clear();
+	m_isEncodedRequestBodyValid = false;
+	m_requestBodyStream = &stream;
+	m_requestBodyStreamLength = length;
+}
+
+void CHttpClient::SetResponseSink(ResponseSink responseSink)
+{
+	m_responseSink = std::move(responseSink);
+}
+
+void CHttpClient::SetResponseStream(Framework::CStream& stream)
+{
+	m_responseSink =
+	    [&stream](const void* data, size_t size) {
+		    if(stream.Write(data, size) != size)
+		    {
+			    throw std::runtime_error("Failed to write response data.");
+		    }
+	    };
+}
+
+void CHttpClient::SetContentDecodingEnabled(bool enabled)
+{
+	m_contentDecodingEnabled = enabled;
+}
+
+void CHttpClient::SetRequestBodyCompressionEnabled(bool enabled)
+{
+	m_requestBodyCompressionEnabled = enabled;
+	m_isEncodedRequestBodyValid = false;
+}
+
+void CHttpClient::SendRequests(const RequestArray& requests, const RequestCallback& callback, unsigned int maxRequestsPerHost)
+{
+	//Requests run on threads with a client each, completions are handed back to the calling thread
+	struct COMPLETION
+	{
+		size_t index = 0;
+		RequestResult result;
+		std::exception_ptr exception;
+	};
+
+	std::mutex mutex;
+	std::condition_variable condition;
+	CRequestScheduler scheduler(requests, maxRequestsPerHost);
+	std::deque<COMPLETION> completions;
+	bool stop = false;
+
+	auto threadProc =
+	    [&](CHttpClient* client) {
+		    OnRequestThreadStart();
+		    client->SetContentDecodingEnabled(m_contentDecodingEnabled);
+		    client->SetRequestBodyCompressionEnabled(m_requestBodyCompressionEnabled);
+		    std::unique_lock<std::mutex> lock(mutex);
+		    while(1)
+		    {
+			    size_t index = 0;
+			    condition.wait(lock, [&]() { return stop || scheduler.IsDone() || scheduler.StartNext(index); });
+			    if(stop || scheduler.IsDone()) break;
+			    lock.unlock();
+			    COMPLETION completion;
+			    completion.index = index;
+			    try
+			    {
+				    const auto& request = requests[index];
+				    client->SetUrl(request.url);
+				    client->SetVerb(request.verb);
+				    client->SetHeaders(request.headers);
+				    client->SetRequestBody(request.body);
+				    completion.result = client->SendRequest();
+			    }
+			    catch(...)
+			    {
+				    completion.exception = std::current_exception();
+			    }
+			    lock.lock();
+			    completions.push_back(std::move(completion));
+			    condition.notify_all();
+		    }
+		    lock.unlock();
+		    OnRequestThreadEnd();
+	    };
+
+	std::vector<std::unique_ptr<CHttpClient>> clients;
+	auto threadCount = std::min<size_t>(requests.size(), g_maxRequestThreadCount);
+	for(size_t i = 0; i < threadCount; i++)
+	{
+		clients.push_back(CreateRequestClient());
+	}
+
+	std::vector<std::thread> threads;
+	for(const auto& client : clients)
+	{
+		threads.emplace_back(threadProc, client.get());
+	}
+
+	std::exception_ptr callbackException;
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		size_t completedCount = 0;
+		while(completedCount != requests.size())
+		{
+			condition.wait(lock, [&]() { return !completions.empty(); });
+			auto completion = std::move(completions.front());
+			completions.pop_front();
+			scheduler.Complete(completion.index);
+			condition.notify_all();
+			completedCount++;
+			lock.unlock();
+			try
+			{
+				callback(completion.index, completion.result, completion.exception);
+			}
+			catch(...)
+			{
+				callbackException = std::current_exception();
+			}
+			lock.lock();
+			if(callbackException)
+			{
+				//Let requests in flight finish, but don't start new ones
+				stop = true;
+				condition.notify_all();
+				break;
+			}
+		}
+	}
+	for(auto& thread : threads)
+	{
+		thread.join();
+	}
+	if(callbackException)
+	{
+		std::rethrow_exception(callbackException);
+	}
+}
+
+void CHttpClient::OnRequestThreadStart()
+{
+}
+
+void CHttpClient::OnRequestThreadEnd()
+{
+}
+
+std::string CHttpClient::GetHeaderValue(const HeaderMap& headers, const std::string& name)
+{
+	return std::string(headers.Get(name));
+}
+
+HeaderMap CHttpClient::GetRequestHeaders(const HeaderMap& headers, bool isBodyCompressed) const
+{
+	auto result = headers;
+	if(m_contentDecodingEnabled && !HasNativeContentDecoding() && !headers.Has("Accept-Encoding"))
+	{
+		result.Set("Accept-Encoding", "gzip, deflate, zstd");
+	}
+	if(isBodyCompressed)
+	{
+		result.Set("Content-Encoding", "gzip");
+	}
+	return result;
+}
+
+ByteArray CHttpClient::EncodeRequestBody(const ByteArray& body) const
+{
+	assert(m_requestBodyCompressionEnabled);
+	return GzipCompress(body.data(), body.size());
+}
+
+bool CHttpClient::IsRequestBodyCompressed() const
+{
+	return m_requestBodyCompressionEnabled && !m_requestBodyStream && !m_requestBody.empty();
+}
+
+uint64 CHttpClient::GetRequestBodySize()
+{
+	return m_requestBodyStream ? m_requestBodyStreamLength : GetEncodedRequestBody().size();
+}
+
+Framework::CStream& CHttpClient::GetRequestBodyStream(std::unique_ptr<Framework::CPtrStream>& memoryStream)
+{
+	if(m_requestBodyStream)
+	{
+		return *m_requestBodyStream;
+	}
+	const auto& body = GetEncodedRequestBody();
+	memoryStream = std::make_unique<Framework::CPtrStream>(body.data(), body.size());
+	return *memoryStream;
+}
+
+const ByteArray& CHttpClient::GetEncodedRequestBody()
+{
+	if(!IsRequestBodyCompressed())
+	{
+		return m_requestBody;
+	}
+	//Kept in case the same request is sent again
+	if(!m_isEncodedRequestBodyValid)
+	{
+		m_encodedRequestBody = EncodeRequestBody(m_requestBody);
+		m_isEncodedRequestBodyValid = true;
+	}
+	return m_encodedRequestBody;
+}
+
+bool CHttpClient::IsContentDecodingEnabled() const
+{
+	return m_contentDecodingEnabled && !HasNativeContentDecoding();
+}
+
+bool CHttpClient::HasNativeContentDecoding() const
+{
+	return false;
+}
+
+std::unique_ptr<CHttpClient> CHttpClient::CreateRequestClient() const
+{
+	return CreateHttpClient();
+}
+
+std::string CHttpClient::GetUrlHost(const std::string& url)
+{
+	auto components = ParseUrl(url);
+	auto host = std::string(components.host);
+	if(!components.port.empty())
+	{
+		host += ':';
+		host += components.port;
+	}
+	return host;
+}
+
+CHttpClient::CRequestScheduler::CRequestScheduler(const RequestArray& requests, unsigned int maxRequestsPerHost)
+    : m_remainingCount(requests.size())
+    , m_maxRequestsPerHost(std::max(maxRequestsPerHost, 1U))
+{
+	m_requestHosts.reserve(requests.size());
+	for(size_t i = 0; i < requests.size(); i++)
+	{
+		m_requestHosts.push_back(GetUrlHost(requests[i].url));
+		auto& host = m_hosts[m_requestHosts.back()];
+		if(host.activeCount < m_maxRequestsPerHost)
+		{
+			host.activeCount++;
+			m_readyRequests.push_back(i);
+		}
+		else
+		{
+			host.waitingRequests.push_back(i);
+		}
+	}
+}
+
+bool CHttpClient::CRequestScheduler::StartNext(size_t& index)
+{
+	if(m_readyRequests.empty()) return false;
+	index = m_readyRequests.front();
+	m_readyRequests.pop_front();
+	return true;
+}
+
+void CHttpClient::CRequestScheduler::Complete(size_t index)
+{
+	assert(m_remainingCount != 0);
+	m_remainingCount--;
+	auto& host = m_hosts[m_requestHosts[index]];
+	if(host.waitingRequests.empty())
+	{
+		assert(host.activeCount != 0);
+		host.activeCount--;
+		return;
+	}
+	//Slot goes to the next request for the same host
+	m_readyRequests.push_back(host.waitingRequests.front());
+	host.waitingRequests.pop_front();
+}
+
+bool CHttpClient::CRequestScheduler::IsDone() const
+{
+	return m_remainingCount == 0;
+}
+
+CHttpClient::CResponseBodyWriter::CResponseBodyWriter(RequestResult& result, const ResponseSink& responseSink, bool isDecodingEnabled)
+    : m_result(result)
+    , m_responseSink(responseSink)
+    , m_isDecodingEnabled(isDecodingEnabled)
+    , m_allocationRecord(Memory::CAllocationTracker::SUBSYSTEM_HTTP, FRAMEWORK_ALLOCATION_SITE)
+{
+}
+
+CHttpClient::CResponseBodyWriter::~CResponseBodyWriter() = default;
+
+void CHttpClient::CResponseBodyWriter::SetContentEncoding(const std::string& contentEncoding)
+{
+	if(!m_isDecodingEnabled) return;
+	std::string encoding(StringUtils::TrimView(contentEncoding));
+	StringUtils::ToLowerInPlace(encoding);
+	if(!CHttpContentDecoder::IsEncodingSupported(encoding)) return;
+	m_decoder = std::make_unique<CHttpContentDecoder>(encoding,
+	                                                  [this](const void* data, size_t size) { WriteDecoded(data, size); });
+}
+
+void CHttpClient::CResponseBodyWriter::Write(const void* data, size_t size)
+{
+	if(m_decoder)
+	{
+		m_decoder->Write(data, size);
+	}
+	else
+	{
+		WriteDecoded(data, size);
+	}
+}
+
+void CHttpClient::CResponseBodyWriter::Finish()
+{
+	if(m_decoder)
+	{
+		m_decoder->Finish();
+	}
+}
+
+void CHttpClient::CResponseBodyWriter::WriteDecoded(const void* data, size_t size)
+{
+	if(m_responseSink)
+	{
+		m_responseSink(data, size);
+	}
+	else
+	{
+		m_result.data.Write(data, size);
+		m_allocationRecord.SetSize(static_cast<size_t>(m_result.data.GetSize()));
+	}
+}
@@ -1,5 +1,6 @@
 #include "http/HttpClientFactory.h"
 #include <stdexcept>
+#include "http/CachingHttpClient.h"
 
 #ifdef _WIN32
 #include "http/Win32HttpClient.h"
@@ -27,3 +28,8 @@ std::unique_ptr<CHttpClient> Framework::Http::CreateHttpClient()
 	throw std::runtime_error("Platform not supported");
 #endif
 }
+
+std::unique_ptr<CHttpClient> Framework::Http::CreateHttpClient(std::shared_ptr<CHttpResponseCache> cache)
+{
+	return std::make_unique<CCachingHttpClient>(CreateHttpClient(), std::move(cache));
+}
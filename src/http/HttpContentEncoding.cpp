@@ -0,0 +1,166 @@
+#include "http/HttpContentEncoding.h"
+#include <cassert>
+#include <stdexcept>
+#include <zstd.h>
+
+using namespace Framework;
+using namespace Framework::Http;
+
+CHttpContentDecoder::CHttpContentDecoder(const std::string& encoding, ResponseSink sink)
+    : m_sink(std::move(sink))
+    , m_outputBuffer(BUFFER_SIZE)
+{
+	if(encoding == "zstd")
+	{
+		m_encoding = ENCODING_ZSTD;
+		m_zstdContext = ZSTD_createDCtx();
+		if(!m_zstdContext)
+		{
+			throw std::runtime_error("Failed to create zstd decoder.");
+		}
+	}
+	else if((encoding == "gzip") || (encoding == "x-gzip") || (encoding == "deflate"))
+	{
+		m_encoding = ENCODING_ZLIB;
+		//Some servers send raw deflate data instead of the zlib format the spec asks for
+		m_isRawDeflateAllowed = (encoding == "deflate");
+		//Detects gzip and zlib headers by itself
+		if(inflateInit2(&m_zStream, MAX_WBITS + 32) != Z_OK)
+		{
+			throw std::runtime_error("zlib stream initialization error.");
+		}
+	}
+	else
+	{
+		throw std::runtime_error("Unsupported content encoding.");
+	}
+}
+
+CHttpContentDecoder::~CHttpContentDecoder()
+{
+	if(m_encoding == ENCODING_ZSTD)
+	{
+		ZSTD_freeDCtx(m_zstdContext);
+	}
+	else
+	{
+		inflateEnd(&m_zStream);
+	}
+}
+
+bool CHttpContentDecoder::IsEncodingSupported(const std::string& encoding)
+{
+	return (encoding == "gzip") || (encoding == "x-gzip") || (encoding == "deflate") || (encoding == "zstd");
+}
+
+void CHttpContentDecoder::Write(const void* data, size_t size)
+{
+	if(size == 0) return;
+	auto bytes = reinterpret_cast<const uint8*>(data);
+	bool isFirstWrite = !m_hasInput;
+	m_hasInput = true;
+	if(m_encoding == ENCODING_ZSTD)
+	{
+		WriteZstd(bytes, size);
+		return;
+	}
+	try
+	{
+		WriteZlib(bytes, size);
+	}
+	catch(const std::exception&)
+	{
+		if(!isFirstWrite || !m_isRawDeflateAllowed || (m_zStream.total_out != 0)) throw;
+		m_isRawDeflateAllowed = false;
+		inflateEnd(&m_zStream);
+		m_zStream = z_stream();
+		if(inflateInit2(&m_zStream, -MAX_WBITS) != Z_OK)
+		{
+			throw std::runtime_error("zlib stream initialization error.");
+		}
+		WriteZlib(bytes, size);
+	}
+}
+
+void CHttpContentDecoder::Finish()
+{
+	if(m_hasInput && !m_isStreamEnd)
+	{
+		throw std::runtime_error("Unexpected end of encoded content.");
+	}
+}
+
+void CHttpContentDecoder::WriteZlib(const uint8* data, size_t size)
+{
+	m_zStream.next_in = const_cast<Bytef*>(data);
+	m_zStream.avail_in = static_cast<uInt>(size);
+	while(1)
+	{
+		if(m_isStreamEnd)
+		{
+			if(m_zStream.avail_in == 0) break;
+			//Another gzip member follows
+			inflateReset(&m_zStream);
+			m_isStreamEnd = false;
+		}
+		m_zStream.next_out = m_outputBuffer.data();
+		m_zStream.avail_out = BUFFER_SIZE;
+		int ret = inflate(&m_zStream, Z_NO_FLUSH);
+		if((ret != Z_OK) && (ret != Z_STREAM_END) && (ret != Z_BUF_ERROR))
+		{
+			throw std::runtime_error("Error occured while decoding content.");
+		}
+		size_t outputSize = BUFFER_SIZE - m_zStream.avail_out;
+		if(outputSize != 0)
+		{
+			m_sink(m_outputBuffer.data(), outputSize);
+		}
+		m_isStreamEnd = (ret == Z_STREAM_END);
+		//Output buffer not filled means everything available was decoded
+		if(!m_isStreamEnd && (m_zStream.avail_out != 0)) break;
+	}
+	assert(m_zStream.avail_in == 0);
+}
+
+void CHttpContentDecoder::WriteZstd(const uint8* data, size_t size)
+{
+	ZSTD_inBuffer input = {data, size, 0};
+	while(1)
+	{
+		ZSTD_outBuffer output = {m_outputBuffer.data(), m_outputBuffer.size(), 0};
+		size_t result = ZSTD_decompressStream(m_zstdContext, &output, &input);
+		if(ZSTD_isError(result))
+		{
+			throw std::runtime_error("Error occured while decoding content.");
+		}
+		if(output.pos != 0)
+		{
+			m_sink(m_outputBuffer.data(), output.pos);
+		}
+		m_isStreamEnd = (result == 0);
+		//Decoder can still have buffered output once all input is consumed
+		if((input.pos == input.size) && (output.pos != output.size)) break;
+	}
+}
+
+ByteArray Framework::Http::GzipCompress(const void* data, size_t size, int level)
+{
+	z_stream zStream = {};
+	if(deflateInit2(&zStream, level, Z_DEFLATED, MAX_WBITS + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+	{
+		throw std::runtime_error("Error initializing deflate stream.");
+	}
+	ByteArray result(deflateBound(&zStream, static_cast<uLong>(size)));
+	zStream.next_in = const_cast<Bytef*>(reinterpret_cast<const Bytef*>(data));
+	zStream.avail_in = static_cast<uInt>(size);
+	zStream.next_out = reinterpret_cast<Bytef*>(result.data());
+	zStream.avail_out = static_cast<uInt>(result.size());
+	int ret = deflate(&zStream, Z_FINISH);
+	result.resize(zStream.total_out);
+	deflateEnd(&zStream);
+	if(ret != Z_STREAM_END)
+	{
+		throw std::runtime_error("Error occured while compressing.");
+	}
+	return result;
+}
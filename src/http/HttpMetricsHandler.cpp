@@ -0,0 +1,40 @@
+#include "http/HttpMetricsHandler.h"
+#include "Metrics.h"
+
+using namespace Framework;
+
+CHttpMetricsHandler::CHttpMetricsHandler(std::string path)
+    : m_path(std::move(path))
+{
+}
+
+bool CHttpMetricsHandler::Serve(const CHttpServer::Request& request, CHttpServer::Response& response)
+{
+	if((request.method != "GET") && (request.method != "HEAD")) return false;
+
+	auto queryPosition = request.url.find('?');
+	if(request.url.substr(0, queryPosition) != m_path) return false;
+	auto query = (queryPosition != std::string_view::npos) ? request.url.substr(queryPosition + 1) : std::string_view();
+
+	bool json = (query.find("format=json") != std::string_view::npos);
+	if(!json)
+	{
+		auto accept = request.GetHeader("Accept");
+		json = (accept.find("application/json") != std::string_view::npos) && (accept.find("text/plain") == std::string_view::npos);
+	}
+
+	auto& registry = Metrics::CRegistry::GetInstance();
+	response = CHttpServer::Response();
+	if(json)
+	{
+		response.headers.emplace_back("Content-Type", "application/json");
+		response.body = registry.ExportJson();
+	}
+	else
+	{
+		response.headers.emplace_back("Content-Type", "text/plain; version=0.0.4; charset=utf-8");
+		response.body = registry.ExportPrometheus();
+	}
+	response.headers.emplace_back("Cache-Control", "no-store");
+	return true;
+}
@@ -0,0 +1,344 @@
+#include "http/HttpResponseCache.h"
+#include <chrono>
+#include <cstring>
+#include "StringUtils.h"
+
+using namespace Framework;
+using namespace Framework::Http;
+
+namespace
+{
+	enum : uint32
+	{
+		ENTRY_MAGIC = 0x48435245, //'ERCH'
+		ENTRY_VERSION = 1,
+	};
+
+	CACHE_SETTINGS MakeMemoryCacheSettings(uint64 capacity)
+	{
+		CACHE_SETTINGS settings;
+		settings.capacity = capacity;
+		settings.shardCount = 4;
+		return settings;
+	}
+
+	std::string MakeDiskKeyString(const std::string& url)
+	{
+		return "HttpResponseCache:" + url;
+	}
+
+	bool IsEqualNoCase(std::string_view lhs, std::string_view rhs)
+	{
+		if(lhs.size() != rhs.size()) return false;
+		for(size_t i = 0; i < lhs.size(); i++)
+		{
+			if(tolower(static_cast<unsigned char>(lhs[i])) != tolower(static_cast<unsigned char>(rhs[i]))) return false;
+		}
+		return true;
+	}
+
+	bool ParseSeconds(std::string_view text, int64& result)
+	{
+		text = StringUtils::TrimView(text);
+		if(text.empty()) return false;
+		result = 0;
+		for(auto digit : text)
+		{
+			if((digit < '0') || (digit > '9')) return false;
+			//Values that don't fit are as good as infinite
+			result = std::min<int64>((result * 10) + (digit - '0'), 0x7FFFFFFF);
+		}
+		return true;
+	}
+
+	//Days since the Unix epoch of a date in the proleptic Gregorian calendar
+	int64 GetDaysFromCivil(int64 year, unsigned int month, unsigned int day)
+	{
+		year -= (month <= 2) ? 1 : 0;
+		int64 era = ((year >= 0) ? year : (year - 399)) / 400;
+		auto yearOfEra = static_cast<unsigned int>(year - (era * 400));
+		unsigned int dayOfYear = ((153 * ((month > 2) ? (month - 3) : (month + 9))) + 2) / 5 + day - 1;
+		unsigned int dayOfEra = (yearOfEra * 365) + (yearOfEra / 4) - (yearOfEra / 100) + dayOfYear;
+		return (era * 146097) + static_cast<int64>(dayOfEra) - 719468;
+	}
+
+	void WriteValue(std::vector<uint8>& output, uint64 value)
+	{
+		for(unsigned int i = 0; i < 8; i++)
+		{
+			output.push_back(static_cast<uint8>(value >> (i * 8)));
+		}
+	}
+
+	void WriteString(std::vector<uint8>& output, std::string_view value)
+	{
+		WriteValue(output, value.size());
+		output.insert(output.end(), value.begin(), value.end());
+	}
+
+	bool ReadValue(const uint8*& input, const uint8* inputEnd, uint64& value)
+	{
+		if((inputEnd - input) < 8) return false;
+		value = 0;
+		for(unsigned int i = 0; i < 8; i++)
+		{
+			value |= static_cast<uint64>(input[i]) << (i * 8);
+		}
+		input += 8;
+		return true;
+	}
+
+	bool ReadString(const uint8*& input, const uint8* inputEnd, std::string_view& value)
+	{
+		uint64 size = 0;
+		if(!ReadValue(input, inputEnd, size)) return false;
+		if(static_cast<uint64>(inputEnd - input) < size) return false;
+		value = std::string_view(reinterpret_cast<const char*>(input), size);
+		input += size;
+		return true;
+	}
+}
+
+CHttpResponseCache::CHttpResponseCache(uint64 memoryCapacity, std::shared_ptr<CDiskCache> diskCache)
+    : m_memoryCache(MakeMemoryCacheSettings(memoryCapacity), [](const std::string&, const ENTRY& entry) { return entry.body.size() + 1; })
+    , m_diskCache(std::move(diskCache))
+{
+}
+
+int64 CHttpResponseCache::GetCurrentTime()
+{
+	return std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+CHttpResponseCache::EntryPtr CHttpResponseCache::Find(const std::string& url)
+{
+	if(auto entry = m_memoryCache.Find(url))
+	{
+		return entry;
+	}
+	if(!m_diskCache) return EntryPtr();
+	auto key = CDiskCache::MakeKey(MakeDiskKeyString(url));
+	auto stream = m_diskCache->Find(key);
+	if(!stream) return EntryPtr();
+	auto entry = std::make_shared<ENTRY>();
+	if(!DeserializeEntry(stream->GetData(), stream->GetLength(), *entry))
+	{
+		stream.reset();
+		m_diskCache->Remove(key);
+		return EntryPtr();
+	}
+	return m_memoryCache.Insert(url, EntryPtr(std::move(entry)));
+}
+
+bool CHttpResponseCache::Store(const std::string& url, const RequestResult& result, int64 responseTime)
+{
+	if(!IsStorable(result))
+	{
+		//A newer response replaces what was there, even if it can't be kept itself
+		Remove(url);
+		return false;
+	}
+	auto entry = std::make_shared<ENTRY>();
+	entry->headers = result.headers;
+	entry->body = ByteArray(result.data.GetBuffer(), result.data.GetBuffer() + result.data.GetSize());
+	entry->responseTime = responseTime;
+	ParseSeconds(result.headers.Get("Age"), entry->initialAge);
+	StoreEntry(url, entry);
+	return true;
+}
+
+CHttpResponseCache::EntryPtr CHttpResponseCache::Refresh(const std::string& url, const EntryPtr& entry, const HeaderMap& notModifiedHeaders, int64 responseTime)
+{
+	//Fields of the 304 response replace the stored ones (RFC 9111, section 3.2)
+	auto refreshedEntry = std::make_shared<ENTRY>(*entry);
+	for(const auto& header : notModifiedHeaders)
+	{
+		if(IsEqualNoCase(header.name, "Content-Length")) continue;
+		refreshedEntry->headers.Set(header.name, header.value);
+	}
+	refreshedEntry->responseTime = responseTime;
+	refreshedEntry->initialAge = 0;
+	ParseSeconds(notModifiedHeaders.Get("Age"), refreshedEntry->initialAge);
+	StoreEntry(url, refreshedEntry);
+	return refreshedEntry;
+}
+
+void CHttpResponseCache::Remove(const std::string& url)
+{
+	m_memoryCache.Remove(url);
+	if(m_diskCache)
+	{
+		m_diskCache->Remove(CDiskCache::MakeKey(MakeDiskKeyString(url)));
+	}
+}
+
+bool CHttpResponseCache::IsFresh(const ENTRY& entry, int64 currentTime)
+{
+	if(HasCacheDirective(entry.headers, "no-cache")) return false;
+	int64 age = entry.initialAge + std::max<int64>(currentTime - entry.responseTime, 0);
+	return age < GetFreshnessLifetime(entry);
+}
+
+bool CHttpResponseCache::AddValidators(const ENTRY& entry, HeaderMap& headers)
+{
+	auto etag = entry.headers.Get("ETag");
+	auto lastModified = entry.headers.Get("Last-Modified");
+	if(!etag.empty() && !headers.Has("If-None-Match"))
+	{
+		headers.Set("If-None-Match", etag);
+	}
+	if(!lastModified.empty() && !headers.Has("If-Modified-Since"))
+	{
+		headers.Set("If-Modified-Since", lastModified);
+	}
+	return !etag.empty() || !lastModified.empty();
+}
+
+bool CHttpResponseCache::HasCacheDirective(const HeaderMap& headers, std::string_view name, std::string_view* value)
+{
+	for(const auto& header : headers)
+	{
+		if(!IsEqualNoCase(header.name, "Cache-Control")) continue;
+		for(auto directive : StringUtils::SplitView(header.value, ','))
+		{
+			directive = StringUtils::TrimView(directive);
+			auto equalPos = directive.find('=');
+			if(!IsEqualNoCase(StringUtils::TrimView(directive.substr(0, equalPos)), name)) continue;
+			if(value)
+			{
+				*value = (equalPos == std::string_view::npos) ? std::string_view() : StringUtils::TrimView(directive.substr(equalPos + 1));
+				if((value->size() >= 2) && (value->front() == '"') && (value->back() == '"'))
+				{
+					*value = value->substr(1, value->size() - 2);
+				}
+			}
+			return true;
+		}
+	}
+	return false;
+}
+
+bool CHttpResponseCache::ParseHttpDate(std::string_view text, int64& result)
+{
+	static const char* g_monthNames[] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+
+	//"Sun, 06 Nov 1994 08:49:37 GMT"
+	text = StringUtils::TrimView(text);
+	if((text.size() != 29) || (text[3] != ',') || (text.substr(25) != " GMT")) return false;
+	auto parseNumber = [&text](size_t offset, size_t size, unsigned int& number) {
+		number = 0;
+		for(size_t i = offset; i < (offset + size); i++)
+		{
+			if((text[i] < '0') || (text[i] > '9')) return false;
+			number = (number * 10) + (text[i] - '0');
+		}
+		return true;
+	};
+	unsigned int day = 0, year = 0, hours = 0, minutes = 0, seconds = 0;
+	if(!parseNumber(5, 2, day) || !parseNumber(12, 4, year) ||
+	   !parseNumber(17, 2, hours) || !parseNumber(20, 2, minutes) || !parseNumber(23, 2, seconds))
+	{
+		return false;
+	}
+	if((text[19] != ':') || (text[22] != ':')) return false;
+	unsigned int month = 0;
+	while((month < 12) && (text.substr(8, 3) != g_monthNames[month])) month++;
+	if((month == 12) || (day < 1) || (day > 31) || (hours > 23) || (minutes > 59) || (seconds > 60)) return false;
+	int64 days = GetDaysFromCivil(year, month + 1, day);
+	result = (days * 86400) + (hours * 3600) + (minutes * 60) + seconds;
+	return true;
+}
+
+bool CHttpResponseCache::IsStorable(const RequestResult& result)
+{
+	if(result.statusCode != HTTP_STATUS_CODE::OK) return false;
+	const auto& headers = result.headers;
+	if(HasCacheDirective(headers, "no-store")) return false;
+	//Responses that depend on other request fields would need them in the key
+	for(auto varyField : StringUtils::SplitView(headers.Get("Vary"), ','))
+	{
+		varyField = StringUtils::TrimView(varyField);
+		if(!varyField.empty() && !IsEqualNoCase(varyField, "Accept-Encoding")) return false;
+	}
+	//Useless without a way to tell if it's fresh or to revalidate it
+	return headers.Has("ETag") || headers.Has("Last-Modified") ||
+	       HasCacheDirective(headers, "max-age") || headers.Has("Expires");
+}
+
+int64 CHttpResponseCache::GetFreshnessLifetime(const ENTRY& entry)
+{
+	const auto& headers = entry.headers;
+	std::string_view maxAge;
+	if(HasCacheDirective(headers, "max-age", &maxAge))
+	{
+		int64 lifetime = 0;
+		return ParseSeconds(maxAge, lifetime) ? lifetime : 0;
+	}
+	int64 date = entry.responseTime;
+	ParseHttpDate(headers.Get("Date"), date);
+	auto expires = headers.Get("Expires");
+	if(!expires.empty())
+	{
+		//Invalid dates (ie.: 0) mean it has already expired
+		int64 expiryTime = 0;
+		if(!ParseHttpDate(expires, expiryTime)) return 0;
+		return std::max<int64>(expiryTime - date, 0);
+	}
+	int64 lastModified = 0;
+	if(ParseHttpDate(headers.Get("Last-Modified"), lastModified))
+	{
+		//Heuristic freshness (RFC 9111, section 4.2.2)
+		return std::max<int64>(date - lastModified, 0) / 10;
+	}
+	return 0;
+}
+
+std::vector<uint8> CHttpResponseCache::SerializeEntry(const ENTRY& entry)
+{
+	std::vector<uint8> result;
+	result.reserve(entry.body.size() + 0x400);
+	WriteValue(result, ENTRY_MAGIC);
+	WriteValue(result, ENTRY_VERSION);
+	WriteValue(result, static_cast<uint64>(entry.responseTime));
+	WriteValue(result, static_cast<uint64>(entry.initialAge));
+	WriteValue(result, entry.headers.GetCount());
+	for(const auto& header : entry.headers)
+	{
+		WriteString(result, header.name);
+		WriteString(result, header.value);
+	}
+	WriteString(result, std::string_view(reinterpret_cast<const char*>(entry.body.data()), entry.body.size()));
+	return result;
+}
+
+bool CHttpResponseCache::DeserializeEntry(const uint8* data, size_t size, ENTRY& entry)
+{
+	const uint8* dataEnd = data + size;
+	uint64 magic = 0, version = 0, responseTime = 0, initialAge = 0, headerCount = 0;
+	if(!ReadValue(data, dataEnd, magic) || (magic != ENTRY_MAGIC)) return false;
+	if(!ReadValue(data, dataEnd, version) || (version != ENTRY_VERSION)) return false;
+	if(!ReadValue(data, dataEnd, responseTime) || !ReadValue(data, dataEnd, initialAge)) return false;
+	if(!ReadValue(data, dataEnd, headerCount)) return false;
+	for(uint64 i = 0; i < headerCount; i++)
+	{
+		std::string_view name, value;
+		if(!ReadString(data, dataEnd, name) || !ReadString(data, dataEnd, value)) return false;
+		entry.headers.Add(name, value);
+	}
+	std::string_view body;
+	if(!ReadString(data, dataEnd, body)) return false;
+	entry.body.assign(body.begin(), body.end());
+	entry.responseTime = static_cast<int64>(responseTime);
+	entry.initialAge = static_cast<int64>(initialAge);
+	return true;
+}
+
+void CHttpResponseCache::StoreEntry(const std::string& url, const EntryPtr& entry)
+{
+	m_memoryCache.Insert(url, entry);
+	if(m_diskCache)
+	{
+		auto data = SerializeEntry(*entry);
+		m_diskCache->Insert(CDiskCache::MakeKey(MakeDiskKeyString(url)), data.data(), data.size());
+	}
+}
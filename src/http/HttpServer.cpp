@@ -1,161 +1,1659 @@
+#ifdef _WIN32
+//Must be set before winsock is included, used by the select based poller
+#define FD_SETSIZE 1024
+#endif
+
 #include "http/HttpServer.h"
+#include <algorithm>
 #include <cassert>
+#include <cstring>
 #include <stdexcept>
 #include <cstdarg>
-#include "StringUtils.h"
+#include <deque>
+#include <set>
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include "MemStream.h"
 #include "SocketStream.h"
 #include "StdStreamUtils.h"
+#include "string_format.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+
+#if defined(__linux__)
+#include <sys/epoll.h>
+#include <sys/sendfile.h>
+#define HTTPSERVER_USE_EPOLL
+#elif defined(__APPLE__) || defined(__FreeBSD__) || defined(__OpenBSD__) || defined(__NetBSD__)
+#include <sys/event.h>
+#define HTTPSERVER_USE_KQUEUE
+#endif
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/select.h>
+#endif
+
+#if defined(__APPLE__)
+#include <sys/types.h>
+#include <sys/uio.h>
+#endif
 
 using namespace Framework;
 
-CHttpServer::CHttpServer(uint16 port, const RequestHandler& requestHandler, const fs::path& logPath)
-    : m_requestHandler(requestHandler)
+#if defined(__linux__)
+static const int g_sendFlags = MSG_NOSIGNAL;
+#else
+static const int g_sendFlags = 0;
+#endif
+
+static void CloseSocket(SOCKET socket)
 {
-	if(!logPath.empty())
+#ifdef _WIN32
+	closesocket(socket);
+#else
+	close(socket);
+#endif
+}
+
+static bool SetNonBlocking(SOCKET socket)
+{
+#ifdef _WIN32
+	u_long nonBlocking = 1;
+	return ioctlsocket(socket, FIONBIO, &nonBlocking) == 0;
+#else
+	int flags = fcntl(socket, F_GETFL, 0);
+	return (flags != -1) && (fcntl(socket, F_SETFL, flags | O_NONBLOCK) == 0);
+#endif
+}
+
+static bool IsWouldBlockError()
+{
+#ifdef _WIN32
+	return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+	return (errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR);
+#endif
+}
+
+//Waits for the socket to become readable, false on timeout
+static bool WaitReadable(SOCKET socket, int timeoutMs)
+{
+#ifdef _WIN32
+	fd_set readSet;
+	FD_ZERO(&readSet);
+	FD_SET(socket, &readSet);
+	timeval timeout = {timeoutMs / 1000, (timeoutMs % 1000) * 1000};
+	return select(0, &readSet, nullptr, nullptr, &timeout) > 0;
+#else
+	pollfd pollDesc = {};
+	pollDesc.fd = socket;
+	pollDesc.events = POLLIN;
+	int result = 0;
+	do
 	{
-		try
-		{
-			m_logStream = std::make_unique<CStdStream>(logPath.native().c_str(), GetAppendStdStreamMode<fs::path::string_type>());
-		}
-		catch(...)
-		{
-		}
-	}
-	InitializeSocketSupport();
-	Start(port);
+		result = poll(&pollDesc, 1, timeoutMs);
+	} while((result < 0) && (errno == EINTR));
+	return result > 0;
+#endif
 }
 
-CHttpServer::~CHttpServer()
+//Sends a part of a file without blocking. Returns the amount sent, 0 if the socket would block or -1 on failure.
+static int64 SendFileRange(SOCKET socket, CStdStream& file, uint64 offset, uint64 size)
 {
-	if(m_serverSock != INVALID_SOCKET)
+	size = std::min<uint64>(size, 0x40000000);
+#if defined(__linux__)
+	off_t fileOffset = offset;
+	auto result = sendfile(socket, fileno(file), &fileOffset, size);
+	if(result > 0) return result;
+	//Nothing sent without error means the file got shorter
+	return ((result < 0) && IsWouldBlockError()) ? 0 : -1;
+#elif defined(__APPLE__)
+	off_t sent = size;
+	auto result = sendfile(fileno(file), socket, offset, &sent, nullptr, 0);
+	if(sent > 0) return sent;
+	return ((result < 0) && IsWouldBlockError()) ? 0 : -1;
+#else
+	char buffer[0x4000];
+	auto readSize = file.ReadAt(offset, buffer, std::min<uint64>(size, sizeof(buffer)));
+	if(readSize == 0) return -1;
+	auto result = send(socket, buffer, static_cast<int>(readSize), g_sendFlags);
+	if(result > 0) return result;
+	return ((result < 0) && IsWouldBlockError()) ? 0 : -1;
+#endif
+}
+
+//Sends the segments of a stream from an offset without blocking. Returns the amount sent, 0 if the socket would block or -1 on failure.
+static int64 SendChainedRange(SOCKET socket, const CChainedBufferStream& stream, uint64 offset, uint64 size)
+{
+	enum
 	{
+		MAX_VEC_COUNT = 64,
+	};
+	STREAM_CONST_IOVEC vecs[MAX_VEC_COUNT];
+	size_t vecCount = stream.GetIoVecs(offset, vecs, MAX_VEC_COUNT);
+	//Range can end before the stream does
+	uint64 remainingSize = std::min<uint64>(size, 0x40000000);
+	if(vecCount == 0) return -1;
 #ifdef _WIN32
-		closesocket(m_serverSock);
+	//Winsock 1 has no gather send, segments go one at a time
+	auto result = send(socket, reinterpret_cast<const char*>(vecs[0].buffer), static_cast<int>(std::min<uint64>(vecs[0].size, remainingSize)), g_sendFlags);
+	if(result > 0) return result;
+	return ((result < 0) && IsWouldBlockError()) ? 0 : -1;
 #else
-		close(m_serverSock);
+	iovec buffers[MAX_VEC_COUNT];
+	size_t bufferCount = 0;
+	for(; (bufferCount < vecCount) && (remainingSize != 0); bufferCount++)
+	{
+		auto vecSize = std::min<uint64>(vecs[bufferCount].size, remainingSize);
+		remainingSize -= vecSize;
+		buffers[bufferCount].iov_base = const_cast<void*>(vecs[bufferCount].buffer);
+		buffers[bufferCount].iov_len = static_cast<size_t>(vecSize);
+	}
+	msghdr message = {};
+	message.msg_iov = buffers;
+	message.msg_iovlen = bufferCount;
+	auto result = sendmsg(socket, &message, g_sendFlags);
+	if(result > 0) return result;
+	return ((result < 0) && IsWouldBlockError()) ? 0 : -1;
 #endif
+}
+
+//These never have a body
+static bool IsBodyAllowed(unsigned int statusCode)
+{
+	return (statusCode >= 200) && (statusCode != 204) && (statusCode != 304);
+}
+
+static const char* GetStatusText(unsigned int statusCode)
+{
+	switch(statusCode)
+	{
+	case 101:
+		return "Switching Protocols";
+	case 200:
+		return "OK";
+	case 204:
+		return "No Content";
+	case 206:
+		return "Partial Content";
+	case 301:
+		return "Moved Permanently";
+	case 304:
+		return "Not Modified";
+	case 307:
+		return "Temporary Redirect";
+	case 400:
+		return "Bad Request";
+	case 401:
+		return "Unauthorized";
+	case 403:
+		return "Forbidden";
+	case 404:
+		return "Not Found";
+	case 405:
+		return "Method Not Allowed";
+	case 416:
+		return "Range Not Satisfiable";
+	case 500:
+		return "Internal Server Error";
+	case 501:
+		return "Not Implemented";
+	case 503:
+		return "Service Unavailable";
+	default:
+		return "Unknown";
 	}
-	m_serverThread.join();
 }
 
-void CHttpServer::Start(uint16 port)
+static bool IsEqualNoCase(const std::string_view& a, const std::string_view& b)
 {
-	assert(m_serverSock == INVALID_SOCKET);
-	m_serverSock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
-	assert(m_serverSock != INVALID_SOCKET);
-	if(m_serverSock == INVALID_SOCKET)
+	return (a.size() == b.size()) &&
+	       std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) { return tolower(x) == tolower(y); });
+}
+
+static std::string_view TrimWhitespace(std::string_view value)
+{
+	static const char whitespace[] = " \t";
+	auto start = value.find_first_not_of(whitespace);
+	if(start == std::string_view::npos) return std::string_view();
+	auto end = value.find_last_not_of(whitespace);
+	return value.substr(start, end - start + 1);
+}
+
+//Reads the body of a request, first from what was received with the headers, then from the socket.
+//Reads block the calling thread, the server doesn't read from the connection while its handler runs.
+class CHttpServer::CBodyStream : public CStream
+{
+public:
+	CBodyStream(SOCKET socket, const uint8* bufferedData, size_t bufferedSize, uint64 size)
+	    : m_socket(socket)
+	    , m_bufferedData(bufferedData)
+	    , m_bufferedSize(bufferedSize)
+	    , m_size(size)
 	{
-		Log("Failed to create socket (error: %d).\r\n", errno);
+		assert(bufferedSize <= size);
 	}
 
-	sockaddr_in sa = {};
-	sa.sin_addr.s_addr = htonl(INADDR_ANY);
-	sa.sin_family = AF_INET;
-	sa.sin_port = htons(port);
-	int result = bind(m_serverSock, reinterpret_cast<sockaddr*>(&sa), sizeof(sockaddr_in));
-	assert(result == 0);
-	if(result != 0)
+	void Seek(int64, STREAM_SEEK_DIRECTION) override
 	{
-		Log("Failed to bind socket to port %d (error: %d).\r\n", port, errno);
+		throw std::runtime_error("Operation not supported.");
 	}
 
-	result = listen(m_serverSock, SOMAXCONN);
-	assert(result == 0);
-	if(result != 0)
+	uint64 Tell() override
 	{
-		Log("Failed to listen (error: %d).\r\n", errno);
+		return m_position;
 	}
-	else
+
+	uint64 Read(void* buffer, uint64 size) override
 	{
-		Log("Server ready and listening on port %d.\r\n", port);
+		size = std::min<uint64>(size, m_size - m_position);
+		if(size == 0) return 0;
+		if(m_position < m_bufferedSize)
+		{
+			size = std::min<uint64>(size, m_bufferedSize - m_position);
+			memcpy(buffer, m_bufferedData + m_position, size);
+			m_position += size;
+			return size;
+		}
+		while(1)
+		{
+			auto result = recv(m_socket, reinterpret_cast<char*>(buffer), static_cast<int>(std::min<uint64>(size, READ_SIZE)), 0);
+			if(result > 0)
+			{
+				m_position += result;
+				return result;
+			}
+			if(result == 0)
+			{
+				throw std::runtime_error("Connection closed while reading request body.");
+			}
+			if(!IsWouldBlockError())
+			{
+				throw std::runtime_error("Failed to read request body.");
+			}
+			if(!WaitReadable(m_socket, BODY_READ_TIMEOUT_MS))
+			{
+				throw std::runtime_error("Timed out while reading request body.");
+			}
+		}
 	}
 
-	m_serverThread = std::thread([this]() { ServerThreadProc(); });
-}
+	uint64 Write(const void*, uint64) override
+	{
+		throw std::runtime_error("Operation not supported.");
+	}
 
-void CHttpServer::ServerThreadProc()
+	bool IsEOF() override
+	{
+		return m_position == m_size;
+	}
+
+	uint64 GetLength() override
+	{
+		return m_size;
+	}
+
+	uint64 GetRemainingLength() override
+	{
+		return m_size - m_position;
+	}
+
+	//Body bytes still in the socket, they need to be skipped before the next request
+	uint64 GetUnreceivedSize() const
+	{
+		return m_size - std::max<uint64>(m_position, m_bufferedSize);
+	}
+
+private:
+	SOCKET m_socket = INVALID_SOCKET;
+	const uint8* m_bufferedData = nullptr;
+	size_t m_bufferedSize = 0;
+	uint64 m_size = 0;
+	uint64 m_position = 0;
+};
+
+//Body written by a handler's body writer on the thread pool. Chunks are taken by the server's
+//thread once the connection's output is sent.
+struct CHttpServer::STREAMED_BODY
 {
-	while(1)
+	std::mutex mutex;
+	std::condition_variable condition;
+	std::deque<std::string> chunks;
+	bool isDone = false;
+	bool succeeded = false;
+	//Client went away or the server is stopping, writes fail from then on
+	bool isAborted = false;
+};
+
+//Given to body writers, buffers writes into chunks and waits while too many are waiting to be sent
+class CHttpServer::CStreamedBodyStream : public CStream
+{
+public:
+	CStreamedBodyStream(CHttpServer& server, SOCKET socket, std::shared_ptr<STREAMED_BODY> body)
+	    : m_server(server)
+	    , m_socket(socket)
+	    , m_body(std::move(body))
 	{
-		sockaddr_in sa = {};
-		socklen_t addrLength = sizeof(sockaddr_in);
-		SOCKET clientSocket = accept(m_serverSock, reinterpret_cast<sockaddr*>(&sa), &addrLength);
-		if(clientSocket == INVALID_SOCKET)
+	}
+
+	void Seek(int64, STREAM_SEEK_DIRECTION) override
+	{
+		throw std::runtime_error("Operation not supported.");
+	}
+
+	uint64 Tell() override
+	{
+		return m_position;
+	}
+
+	uint64 Read(void*, uint64) override
+	{
+		throw std::runtime_error("Operation not supported.");
+	}
+
+	uint64 Write(const void* buffer, uint64 size) override
+	{
+		auto data = reinterpret_cast<const char*>(buffer);
+		uint64 written = 0;
+		while(written != size)
 		{
-			Log("Failed to accept (error: %d). Terminating server.\r\n", errno);
-			break;
+			auto copySize = std::min<uint64>(size - written, STREAMED_BODY_CHUNK_SIZE - m_chunk.size());
+			m_chunk.append(data + written, static_cast<size_t>(copySize));
+			written += copySize;
+			if(m_chunk.size() == STREAMED_BODY_CHUNK_SIZE)
+			{
+				PushChunk();
+			}
+		}
+		m_position += size;
+		return size;
+	}
+
+	bool IsEOF() override
+	{
+		return false;
+	}
+
+	void Flush() override
+	{
+		if(!m_chunk.empty())
+		{
+			PushChunk();
+		}
+	}
+
+	//The server can go away as soon as the body is done, nothing can be used afterwards
+	void Finish(bool succeeded)
+	{
+		std::unique_lock<std::mutex> lock(m_server.m_completionsMutex);
+		{
+			std::unique_lock<std::mutex> bodyLock(m_body->mutex);
+			m_body->isDone = true;
+			m_body->succeeded = succeeded;
+		}
+		m_server.m_streamedBodyOutputs.push_back(m_socket);
+		m_server.Wake();
+	}
+
+private:
+	void PushChunk()
+	{
+		std::unique_lock<std::mutex> lock(m_body->mutex);
+		m_body->condition.wait(lock, [this]() { return m_body->isAborted || (m_body->chunks.size() < MAX_STREAMED_BODY_CHUNKS); });
+		if(m_body->isAborted)
+		{
+			throw std::runtime_error("Connection closed while writing response body.");
+		}
+		//Server only needs waking when it ran out of chunks
+		bool wasEmpty = m_body->chunks.empty();
+		m_body->chunks.push_back(std::move(m_chunk));
+		m_chunk = std::string();
+		lock.unlock();
+		if(wasEmpty)
+		{
+			std::unique_lock<std::mutex> completionsLock(m_server.m_completionsMutex);
+			m_server.m_streamedBodyOutputs.push_back(m_socket);
+			m_server.Wake();
 		}
-		ProcessRequest(clientSocket);
 	}
+
+	CHttpServer& m_server;
+	SOCKET m_socket = INVALID_SOCKET;
+	std::shared_ptr<STREAMED_BODY> m_body;
+	std::string m_chunk;
+	uint64 m_position = 0;
+};
+
+//Part of the output of a connection, either bytes, a chained buffer or a range of a file
+struct CHttpServer::OUTPUT_SEGMENT
+{
+	std::string data;
+	std::shared_ptr<const std::vector<uint8>> sharedData;
+	std::shared_ptr<const CChainedBufferStream> chainedData;
+	std::shared_ptr<CStdStream> file;
+	uint64 position = 0;
+	uint64 end = 0;
+};
+
+struct CHttpServer::COMPLETION
+{
+	SOCKET socket = INVALID_SOCKET;
+	bool succeeded = false;
+	Response response;
+	//Body writer started once the response was queued
+	std::shared_ptr<STREAMED_BODY> streamedBody;
+};
+
+struct CHttpServer::CONNECTION
+{
+	SOCKET socket = INVALID_SOCKET;
+	std::vector<uint8> input;
+	//Part of the input already searched for the end of the headers
+	size_t scannedSize = 0;
+	//Input used by the request being handled
+	size_t requestSize = 0;
+	//Body bytes left unread by the last handler, dropped as they're received
+	uint64 skipSize = 0;
+	std::unique_ptr<CBodyStream> bodyStream;
+	std::deque<OUTPUT_SEGMENT> output;
+	bool isHandlerPending = false;
+	bool isHeadRequest = false;
+	bool isHttp10 = false;
+	bool keepAlive = true;
+	//Body of the last response still being written, the connection waits for it as for a handler
+	std::shared_ptr<STREAMED_BODY> streamedBody;
+	//Refer to the input, valid while the request is being handled
+	std::string_view method;
+	std::string_view url;
+	std::string_view webSocketKey;
+	std::string_view webSocketExtensions;
+	std::chrono::steady_clock::time_point requestStartTime;
+	bool isPeerClosed = false;
+	//Nothing more can be sent, the peer might only have stopped sending otherwise
+	bool isSendFailed = false;
+	bool closeAfterWrite = false;
+	bool isWatchingRead = true;
+	bool isWatchingWrite = false;
+	//Set once upgraded, the input only has frames afterwards
+	WebSocketPtr webSocket;
+	std::unique_ptr<WebSocket::CFrameReader> webSocketReader;
+	bool isWebSocketDeflateEnabled = false;
+};
+
+std::string_view CHttpServer::Request::GetHeader(const std::string_view& name) const
+{
+	for(const auto& header : headers)
+	{
+		if(IsEqualNoCase(header.name, name)) return header.value;
+	}
+	return std::string_view();
 }
 
-void CHttpServer::ProcessRequest(int clientSocket)
+bool CHttpServer::Request::IsWebSocketUpgrade() const
 {
-	try
+	return (method == "GET") && IsEqualNoCase(GetHeader("upgrade"), "websocket") &&
+	       !GetHeader("sec-websocket-key").empty() && (GetHeader("sec-websocket-version") == "13");
+}
+
+//Readiness notifications for sockets, level triggered
+class CHttpServer::CPoller
+{
+public:
+	struct EVENT
 	{
-		auto clientStream = CSocketStream(clientSocket);
-		auto line = clientStream.ReadLine();
-		auto parts = StringUtils::Split(line);
+		SOCKET socket = INVALID_SOCKET;
+		bool readable = false;
+		bool writable = false;
+	};
+	typedef std::vector<EVENT> EventArray;
 
-		if(parts.size() != 3)
+#if defined(HTTPSERVER_USE_EPOLL)
+	CPoller()
+	{
+		m_fd = epoll_create1(EPOLL_CLOEXEC);
+		if(m_fd == -1)
 		{
-			throw std::runtime_error("Bad request.");
+			throw std::runtime_error("Failed to create epoll instance.");
 		}
+	}
 
-		Request request;
+	~CPoller()
+	{
+		close(m_fd);
+	}
 
-		//Read headers
-		while(1)
+	void Add(SOCKET socket)
+	{
+		Control(EPOLL_CTL_ADD, socket, true, false);
+	}
+
+	void Modify(SOCKET socket, bool watchRead, bool watchWrite)
+	{
+		//Errors and hang ups are always reported, sockets not watched at all are left out instead
+		bool isDetached = m_detachedSockets.count(socket) != 0;
+		if(!watchRead && !watchWrite)
 		{
-			auto line = clientStream.ReadLine();
-			if(line.empty()) break;
-			auto delimit = line.find(':');
-			if(delimit == std::string::npos)
+			if(!isDetached)
 			{
-				//Invalid header
-				continue;
+				epoll_ctl(m_fd, EPOLL_CTL_DEL, socket, nullptr);
+				m_detachedSockets.insert(socket);
 			}
-			auto headerName = StringUtils::TrimEnd(std::string(line.begin(), line.begin() + delimit));
-			auto headerValue = StringUtils::TrimStart(std::string(line.begin() + delimit + 1, line.end()));
-			request.headers.insert(std::make_pair(headerName, headerValue));
+			return;
+		}
+		if(isDetached)
+		{
+			m_detachedSockets.erase(socket);
+		}
+		Control(isDetached ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, socket, watchRead, watchWrite);
+	}
+
+	void Remove(SOCKET socket)
+	{
+		if(m_detachedSockets.erase(socket) != 0) return;
+		epoll_ctl(m_fd, EPOLL_CTL_DEL, socket, nullptr);
+	}
+
+	void Wait(EventArray& events)
+	{
+		epoll_event nativeEvents[MAX_EVENTS];
+		int eventCount = epoll_wait(m_fd, nativeEvents, MAX_EVENTS, -1);
+		for(int i = 0; i < eventCount; i++)
+		{
+			const auto& nativeEvent = nativeEvents[i];
+			EVENT event;
+			event.socket = nativeEvent.data.fd;
+			//Errors and hang ups are reported when reading
+			event.readable = (nativeEvent.events & (EPOLLIN | EPOLLERR | EPOLLHUP)) != 0;
+			event.writable = (nativeEvent.events & EPOLLOUT) != 0;
+			events.push_back(event);
+		}
+	}
+
+private:
+	void Control(int operation, SOCKET socket, bool watchRead, bool watchWrite)
+	{
+		epoll_event event = {};
+		event.events = (watchRead ? static_cast<uint32_t>(EPOLLIN) : 0u) | (watchWrite ? static_cast<uint32_t>(EPOLLOUT) : 0u);
+		event.data.fd = socket;
+		epoll_ctl(m_fd, operation, socket, &event);
+	}
+
+	int m_fd = -1;
+	std::set<SOCKET> m_detachedSockets;
+#elif defined(HTTPSERVER_USE_KQUEUE)
+	CPoller()
+	{
+		m_fd = kqueue();
+		if(m_fd == -1)
+		{
+			throw std::runtime_error("Failed to create kqueue instance.");
+		}
+	}
+
+	~CPoller()
+	{
+		close(m_fd);
+	}
+
+	void Add(SOCKET socket)
+	{
+		struct kevent changes[2];
+		EV_SET(&changes[0], socket, EVFILT_READ, EV_ADD, 0, 0, nullptr);
+		EV_SET(&changes[1], socket, EVFILT_WRITE, EV_ADD | EV_DISABLE, 0, 0, nullptr);
+		kevent(m_fd, changes, 2, nullptr, 0, nullptr);
+	}
+
+	void Modify(SOCKET socket, bool watchRead, bool watchWrite)
+	{
+		struct kevent changes[2];
+		EV_SET(&changes[0], socket, EVFILT_READ, watchRead ? EV_ENABLE : EV_DISABLE, 0, 0, nullptr);
+		EV_SET(&changes[1], socket, EVFILT_WRITE, watchWrite ? EV_ENABLE : EV_DISABLE, 0, 0, nullptr);
+		kevent(m_fd, changes, 2, nullptr, 0, nullptr);
+	}
+
+	void Remove(SOCKET socket)
+	{
+		struct kevent changes[2];
+		EV_SET(&changes[0], socket, EVFILT_READ, EV_DELETE, 0, 0, nullptr);
+		EV_SET(&changes[1], socket, EVFILT_WRITE, EV_DELETE, 0, 0, nullptr);
+		kevent(m_fd, changes, 2, nullptr, 0, nullptr);
+	}
+
+	void Wait(EventArray& events)
+	{
+		struct kevent nativeEvents[MAX_EVENTS];
+		int eventCount = kevent(m_fd, nullptr, 0, nativeEvents, MAX_EVENTS, nullptr);
+		for(int i = 0; i < eventCount; i++)
+		{
+			const auto& nativeEvent = nativeEvents[i];
+			EVENT event;
+			event.socket = static_cast<SOCKET>(nativeEvent.ident);
+			event.readable = (nativeEvent.filter == EVFILT_READ);
+			event.writable = (nativeEvent.filter == EVFILT_WRITE);
+			events.push_back(event);
 		}
+	}
+
+private:
+	int m_fd = -1;
+#else
+	//Fallback for Windows (IOCP's completion model doesn't fit this loop) and other platforms
+	void Add(SOCKET socket)
+	{
+		m_sockets[socket] = WATCH{true, false};
+	}
+
+	void Modify(SOCKET socket, bool watchRead, bool watchWrite)
+	{
+		m_sockets[socket] = WATCH{watchRead, watchWrite};
+	}
+
+	void Remove(SOCKET socket)
+	{
+		m_sockets.erase(socket);
+	}
 
-		auto contentLenghtHeaderIterator = request.headers.find("Content-Length");
-		if(contentLenghtHeaderIterator != std::end(request.headers))
+	void Wait(EventArray& events)
+	{
+		fd_set readSet, writeSet;
+		FD_ZERO(&readSet);
+		FD_ZERO(&writeSet);
+		int maxSocket = 0;
+		unsigned int socketCount = 0;
+		for(const auto& socketPair : m_sockets)
+		{
+			if(socketCount++ == FD_SETSIZE) break;
+			if(socketPair.second.read)
+			{
+				FD_SET(socketPair.first, &readSet);
+			}
+			if(socketPair.second.write)
+			{
+				FD_SET(socketPair.first, &writeSet);
+			}
+			maxSocket = std::max(maxSocket, static_cast<int>(socketPair.first));
+		}
+		if(select(maxSocket + 1, &readSet, &writeSet, nullptr, nullptr) <= 0) return;
+		for(const auto& socketPair : m_sockets)
 		{
-			uint64 contentLength = atoll(contentLenghtHeaderIterator->second.c_str());
-			request.body.resize(contentLength);
-			while(contentLength != 0)
+			EVENT event;
+			event.socket = socketPair.first;
+			event.readable = FD_ISSET(socketPair.first, &readSet) != 0;
+			event.writable = FD_ISSET(socketPair.first, &writeSet) != 0;
+			if(event.readable || event.writable)
 			{
-				uint64 readAmount = clientStream.Read(request.body.data(), contentLength);
-				contentLength -= readAmount;
+				events.push_back(event);
 			}
 		}
+	}
 
-		request.url = parts[1];
-		Log("Processing request %s '%s'.\r\n", parts[0].c_str(), request.url.c_str());
+private:
+	struct WATCH
+	{
+		bool read = false;
+		bool write = false;
+	};
 
-		m_requestHandler(request);
+	std::map<SOCKET, WATCH> m_sockets;
+#endif
 
-		std::string response;
-		response += "HTTP/1.1 200 OK\r\n";
-		//TODO: Append some body here
-		response += "\r\n";
+	enum
+	{
+		MAX_EVENTS = 256,
+	};
+};
 
-		clientStream.Write(response.c_str(), response.size());
+CHttpServer::CHttpServer(uint16 port, const RequestHandler& requestHandler, const fs::path& logPath, CThreadPool* threadPool)
+    : m_requestHandler(requestHandler)
+    , m_threadPool(threadPool)
+    , m_stop(false)
+    , m_requestCountMetric(Metrics::CRegistry::GetInstance().GetCounter("framework_http_server_requests_total", "", "Requests completed by the HTTP server."))
+    , m_errorCountMetric(Metrics::CRegistry::GetInstance().GetCounter("framework_http_server_errors_total", "", "Requests completed with a 5xx status."))
+    , m_responseSizeMetric(Metrics::CRegistry::GetInstance().GetCounter("framework_http_server_response_bytes_total", "", "Response body bytes sent by the HTTP server."))
+    , m_requestDurationMetric(Metrics::CRegistry::GetInstance().GetHistogram("framework_http_server_request_duration_microseconds", "", "Time between receiving a request and queuing its response."))
+    , m_connectionCountMetric(Metrics::CRegistry::GetInstance().GetGauge("framework_http_server_connections", "", "Open connections."))
+{
+	if(!logPath.empty())
+	{
+		try
+		{
+			m_accessLog = std::make_unique<CHttpAccessLog>(logPath);
+		}
+		catch(...)
+		{
+		}
 	}
-	catch(...)
+	InitializeSocketSupport();
+	Start(port);
+}
+
+CHttpServer::~CHttpServer()
+{
+	m_stop = true;
+	Wake();
+	m_serverThread.join();
+	for(auto& connectionPair : m_connections)
+	{
+		if(auto webSocket = std::move(connectionPair.second->webSocket))
+		{
+			webSocket->Detach();
+		}
+	}
+	//Last handler might still be waking us up
+	std::unique_lock<std::mutex> lock(m_completionsMutex);
+	for(auto& connectionPair : m_connections)
+	{
+		CloseSocket(connectionPair.first);
+	}
+	m_connectionCountMetric.Add(-static_cast<int64>(m_connections.size()));
+	if(m_serverSock != INVALID_SOCKET)
+	{
+		CloseSocket(m_serverSock);
+	}
+	if(m_wakeSock != INVALID_SOCKET)
+	{
+		CloseSocket(m_wakeSock);
+	}
+}
+
+void CHttpServer::Start(uint16 port)
+{
+	assert(m_serverSock == INVALID_SOCKET);
+	m_serverSock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	assert(m_serverSock != INVALID_SOCKET);
+	if(m_serverSock == INVALID_SOCKET)
+	{
+		Log("Failed to create socket (error: %d).\r\n", errno);
+	}
+
+	//Allows restarting the server while connections from a previous run are in TIME_WAIT
+	int reuseAddress = 1;
+	setsockopt(m_serverSock, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuseAddress), sizeof(reuseAddress));
+
+	sockaddr_in sa = {};
+	sa.sin_addr.s_addr = htonl(INADDR_ANY);
+	sa.sin_family = AF_INET;
+	sa.sin_port = htons(port);
+	int result = bind(m_serverSock, reinterpret_cast<sockaddr*>(&sa), sizeof(sockaddr_in));
+	assert(result == 0);
+	if(result != 0)
+	{
+		Log("Failed to bind socket to port %d (error: %d).\r\n", port, errno);
+	}
+
+	result = listen(m_serverSock, SOMAXCONN);
+	assert(result == 0);
+	if(result != 0)
+	{
+		Log("Failed to listen (error: %d).\r\n", errno);
+	}
+	else
+	{
+		Log("Server ready and listening on port %d.\r\n", port);
+	}
+	SetNonBlocking(m_serverSock);
+
+	//Datagram socket connected to itself, used to wake the server thread up
+	m_wakeSock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	sockaddr_in wakeAddress = {};
+	wakeAddress.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	wakeAddress.sin_family = AF_INET;
+	socklen_t wakeAddressLength = sizeof(sockaddr_in);
+	if((m_wakeSock == INVALID_SOCKET) ||
+	   (bind(m_wakeSock, reinterpret_cast<sockaddr*>(&wakeAddress), sizeof(sockaddr_in)) != 0) ||
+	   (getsockname(m_wakeSock, reinterpret_cast<sockaddr*>(&wakeAddress), &wakeAddressLength) != 0) ||
+	   (connect(m_wakeSock, reinterpret_cast<sockaddr*>(&wakeAddress), sizeof(sockaddr_in)) != 0))
+	{
+		Log("Failed to create wake up socket (error: %d).\r\n", errno);
+	}
+	SetNonBlocking(m_wakeSock);
+
+	m_poller = std::make_unique<CPoller>();
+	m_poller->Add(m_serverSock);
+	m_poller->Add(m_wakeSock);
+
+	m_serverThread = std::thread([this]() { ServerThreadProc(); });
+}
+
+void CHttpServer::ServerThreadProc()
+{
+	CPoller::EventArray events;
+	//Handlers still running on the thread pool refer to the server, wait for them before leaving
+	while(!m_stop || (m_pendingHandlerCount != 0))
+	{
+		events.clear();
+		m_poller->Wait(events);
+		for(const auto& event : events)
+		{
+			if(event.socket == m_serverSock)
+			{
+				if(!m_stop) AcceptConnections();
+				continue;
+			}
+			if(event.socket == m_wakeSock)
+			{
+				DrainWakeSocket();
+				continue;
+			}
+			auto connectionIterator = m_connections.find(event.socket);
+			if(connectionIterator == std::end(m_connections)) continue;
+			auto& connection = *connectionIterator->second;
+			if(event.readable)
+			{
+				ReadConnection(connection);
+			}
+			if(event.writable)
+			{
+				WriteConnection(connection);
+			}
+			UpdateConnection(connection);
+		}
+		ProcessCompletions();
+		ProcessStreamedBodyOutput();
+		ProcessWebSocketOutput();
+		if(m_stop)
+		{
+			AbortStreamedBodies();
+		}
+	}
+}
+
+void CHttpServer::AcceptConnections()
+{
+	while(1)
+	{
+		sockaddr_in sa = {};
+		socklen_t addrLength = sizeof(sockaddr_in);
+		SOCKET clientSocket = accept(m_serverSock, reinterpret_cast<sockaddr*>(&sa), &addrLength);
+		if(clientSocket == INVALID_SOCKET)
+		{
+			if(!IsWouldBlockError())
+			{
+				Log("Failed to accept (error: %d).\r\n", errno);
+			}
+			break;
+		}
+		SetNonBlocking(clientSocket);
+#if defined(SO_NOSIGPIPE)
+		int noSigPipe = 1;
+		setsockopt(clientSocket, SOL_SOCKET, SO_NOSIGPIPE, &noSigPipe, sizeof(noSigPipe));
+#endif
+		auto connection = std::make_unique<CONNECTION>();
+		connection->socket = clientSocket;
+		m_poller->Add(clientSocket);
+		m_connections.insert(std::make_pair(clientSocket, std::move(connection)));
+		m_connectionCountMetric.Add(1);
+	}
+}
+
+void CHttpServer::ReadConnection(CONNECTION& connection)
+{
+	uint8 buffer[READ_SIZE];
+	//Requests are processed as input comes in, reading stops while a handler runs since it
+	//might be receiving its body from the socket and the request refers to the input buffer
+	while(!connection.isPeerClosed && !connection.isHandlerPending && !connection.closeAfterWrite)
+	{
+		auto result = recv(connection.socket, reinterpret_cast<char*>(buffer), READ_SIZE, 0);
+		if(result > 0)
+		{
+			connection.input.insert(connection.input.end(), buffer, buffer + result);
+			ProcessRequests(connection);
+			continue;
+		}
+		if((result < 0) && IsWouldBlockError()) break;
+		connection.isPeerClosed = true;
+	}
+	ProcessRequests(connection);
+}
+
+void CHttpServer::WriteConnection(CONNECTION& connection)
+{
+	while(!connection.output.empty())
+	{
+		auto& segment = connection.output.front();
+		if(segment.position == segment.end)
+		{
+			connection.output.pop_front();
+			continue;
+		}
+		int64 result = 0;
+		if(segment.file)
+		{
+			result = SendFileRange(connection.socket, *segment.file, segment.position, segment.end - segment.position);
+		}
+		else if(segment.chainedData)
+		{
+			result = SendChainedRange(connection.socket, *segment.chainedData, segment.position, segment.end - segment.position);
+		}
+		else
+		{
+			auto data = segment.sharedData ? reinterpret_cast<const char*>(segment.sharedData->data()) : segment.data.data();
+			auto sendSize = static_cast<int>(std::min<uint64>(segment.end - segment.position, 0x40000000));
+			result = send(connection.socket, data + segment.position, sendSize, g_sendFlags);
+			if((result < 0) && IsWouldBlockError()) result = 0;
+		}
+		if(result > 0)
+		{
+			segment.position += result;
+			continue;
+		}
+		if(result == 0) return;
+		//Client went away, drop what's left
+		connection.isPeerClosed = true;
+		connection.isSendFailed = true;
+		connection.closeAfterWrite = true;
+		connection.output.clear();
+		break;
+	}
+}
+
+void CHttpServer::AppendOutput(CONNECTION& connection, std::string data)
+{
+	auto& output = connection.output;
+	//Small responses to pipelined requests go out together
+	if(!output.empty() && !output.back().file && !output.back().sharedData && !output.back().chainedData)
+	{
+		auto& segment = output.back();
+		segment.data += data;
+		segment.end = segment.data.size();
+		return;
+	}
+	OUTPUT_SEGMENT segment;
+	segment.data = std::move(data);
+	segment.end = segment.data.size();
+	output.push_back(std::move(segment));
+}
+
+//Flushes output and closes or updates the events watched for the connection as needed
+void CHttpServer::UpdateConnection(CONNECTION& connection)
+{
+	WriteConnection(connection);
+	if(connection.streamedBody)
+	{
+		FlushStreamedBody(connection);
+		WriteConnection(connection);
+	}
+	bool hasOutput = !connection.output.empty();
+	if(!connection.isHandlerPending && !hasOutput && (connection.closeAfterWrite || connection.isPeerClosed))
+	{
+		CloseConnection(connection);
+		return;
+	}
+	bool watchRead = !connection.isHandlerPending && !connection.closeAfterWrite && !connection.isPeerClosed;
+	if((watchRead != connection.isWatchingRead) || (hasOutput != connection.isWatchingWrite))
+	{
+		connection.isWatchingRead = watchRead;
+		connection.isWatchingWrite = hasOutput;
+		m_poller->Modify(connection.socket, watchRead, hasOutput);
+	}
+}
+
+void CHttpServer::CloseConnection(CONNECTION& connection)
+{
+	auto socket = connection.socket;
+	auto webSocket = std::move(connection.webSocket);
+	m_poller->Remove(socket);
+	CloseSocket(socket);
+	m_connections.erase(socket);
+	m_connectionCountMetric.Add(-1);
+	if(webSocket)
+	{
+		webSocket->Detach();
+	}
+}
+
+void CHttpServer::SkipUnreadBody(CONNECTION& connection)
+{
+	auto& input = connection.input;
+	auto skipSize = static_cast<size_t>(std::min<uint64>(connection.skipSize, input.size()));
+	input.erase(input.begin(), input.begin() + skipSize);
+	connection.skipSize -= skipSize;
+}
+
+//Handles complete requests in the connection's input, one at a time to keep responses in order
+void CHttpServer::ProcessRequests(CONNECTION& connection)
+{
+	FRAMEWORK_TRACE_SCOPE("HttpServer::ProcessRequests");
+	while(!connection.isHandlerPending && !connection.closeAfterWrite)
+	{
+		if(connection.webSocket)
+		{
+			ProcessWebSocketFrames(connection);
+			break;
+		}
+		SkipUnreadBody(connection);
+		Request request;
+		auto result = (connection.skipSize != 0) ? PARSE_RESULT_INCOMPLETE : ParseRequest(connection, request);
+		if(result == PARSE_RESULT_INCOMPLETE)
+		{
+			if(connection.isPeerClosed)
+			{
+				connection.input.clear();
+				connection.scannedSize = 0;
+			}
+			break;
+		}
+		if(result == PARSE_RESULT_INVALID)
+		{
+			if(m_accessLog)
+			{
+				m_accessLog->WriteRequest("-", "-", 400, 0, 0);
+			}
+			AppendOutput(connection, "HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+			connection.closeAfterWrite = true;
+			connection.input.clear();
+			break;
+		}
+
+		if(m_threadPool)
+		{
+			connection.isHandlerPending = true;
+			m_pendingHandlerCount++;
+			auto socket = connection.socket;
+			m_threadPool->Enqueue(
+			    [this, socket, request = std::move(request)]() {
+				    FRAMEWORK_TRACE_SCOPE("HttpServer::HandleRequest");
+				    COMPLETION completion;
+				    completion.socket = socket;
+				    try
+				    {
+					    m_requestHandler(request, completion.response);
+					    completion.succeeded = true;
+				    }
+				    catch(...)
+				    {
+				    }
+				    auto& response = completion.response;
+				    BodyWriter bodyWriter;
+				    if(completion.succeeded && !response.webSocket && IsBodyAllowed(response.statusCode) && (request.method != "HEAD"))
+				    {
+					    bodyWriter = std::move(response.bodyWriter);
+				    }
+				    if(bodyWriter)
+				    {
+					    completion.streamedBody = std::make_shared<STREAMED_BODY>();
+				    }
+				    auto streamedBody = completion.streamedBody;
+				    {
+					    //The server can go away as soon as the lock is released, unless a body is still to be written
+					    std::unique_lock<std::mutex> lock(m_completionsMutex);
+					    m_completions.push_back(std::move(completion));
+					    Wake();
+				    }
+				    if(!bodyWriter) return;
+				    FRAMEWORK_TRACE_SCOPE("HttpServer::WriteBody");
+				    CStreamedBodyStream bodyStream(*this, socket, std::move(streamedBody));
+				    bool succeeded = false;
+				    try
+				    {
+					    bodyWriter(bodyStream);
+					    bodyStream.Flush();
+					    succeeded = true;
+				    }
+				    catch(...)
+				    {
+				    }
+				    bodyStream.Finish(succeeded);
+			    });
+		}
+		else
+		{
+			Response response;
+			bool succeeded = false;
+			try
+			{
+				m_requestHandler(request, response);
+				if(response.bodyWriter)
+				{
+					CMemStream bodyStream;
+					response.bodyWriter(bodyStream);
+					response.body.assign(reinterpret_cast<const char*>(bodyStream.GetBuffer()), static_cast<size_t>(bodyStream.GetSize()));
+					response.bodyWriter = BodyWriter();
+				}
+				succeeded = true;
+			}
+			catch(...)
+			{
+			}
+			CompleteRequest(connection, succeeded, response);
+		}
+	}
+}
+
+//Parses the request line and headers in place, in the manner of picohttpparser. Only input
+//received since the last call is searched for the end of the headers.
+CHttpServer::PARSE_RESULT CHttpServer::ParseRequest(CONNECTION& connection, Request& request)
+{
+	static const std::string_view headerTerminator("\r\n\r\n");
+	auto& input = connection.input;
+	if(connection.scannedSize == 0)
+	{
+		//Empty lines before a request are allowed
+		auto requestStart = std::find_if(input.begin(), input.end(), [](uint8 value) { return (value != '\r') && (value != '\n'); });
+		input.erase(input.begin(), requestStart);
+	}
+
+	std::string_view data(reinterpret_cast<const char*>(input.data()), input.size());
+	size_t searchStart = (connection.scannedSize > (headerTerminator.size() - 1)) ? (connection.scannedSize - (headerTerminator.size() - 1)) : 0;
+	auto headerEnd = data.find(headerTerminator, searchStart);
+	if(headerEnd == std::string_view::npos)
+	{
+		connection.scannedSize = input.size();
+		return (input.size() > MAX_HEADER_SIZE) ? PARSE_RESULT_INVALID : PARSE_RESULT_INCOMPLETE;
+	}
+	if(headerEnd > MAX_HEADER_SIZE)
+	{
+		return PARSE_RESULT_INVALID;
+	}
+	size_t headerSize = headerEnd + headerTerminator.size();
+	connection.scannedSize = headerSize;
+
+	//Request line
+	auto lines = data.substr(0, headerEnd + 2);
+	auto lineEnd = lines.find("\r\n");
+	auto requestLine = lines.substr(0, lineEnd);
+	lines.remove_prefix(lineEnd + 2);
+	auto methodEnd = requestLine.find(' ');
+	auto urlEnd = (methodEnd == std::string_view::npos) ? std::string_view::npos : requestLine.find(' ', methodEnd + 1);
+	if((methodEnd == 0) || (urlEnd == std::string_view::npos) || (urlEnd == methodEnd + 1))
+	{
+		return PARSE_RESULT_INVALID;
+	}
+	auto version = requestLine.substr(urlEnd + 1);
+	if((version.find(' ') != std::string_view::npos) || (version.compare(0, 5, "HTTP/") != 0))
+	{
+		return PARSE_RESULT_INVALID;
+	}
+	request.method = requestLine.substr(0, methodEnd);
+	request.url = requestLine.substr(methodEnd + 1, urlEnd - methodEnd - 1);
+
+	//Header fields
+	request.headers.clear();
+	while(!lines.empty())
+	{
+		lineEnd = lines.find("\r\n");
+		auto line = lines.substr(0, lineEnd);
+		lines.remove_prefix(lineEnd + 2);
+		auto delimit = line.find(':');
+		if(delimit == std::string_view::npos)
+		{
+			//Invalid header
+			continue;
+		}
+		HEADER header;
+		header.name = TrimWhitespace(line.substr(0, delimit));
+		header.value = TrimWhitespace(line.substr(delimit + 1));
+		request.headers.push_back(header);
+	}
+
+	uint64 contentLength = 0;
+	bool keepAlive = (version != "HTTP/1.0");
+	for(const auto& header : request.headers)
+	{
+		if(IsEqualNoCase(header.name, "content-length"))
+		{
+			const auto& value = header.value;
+			if(value.empty() || (value.size() > 18) || (value.find_first_not_of("0123456789") != std::string_view::npos))
+			{
+				return PARSE_RESULT_INVALID;
+			}
+			contentLength = std::stoull(std::string(value));
+		}
+		else if(IsEqualNoCase(header.name, "connection"))
+		{
+			if(IsEqualNoCase(header.value, "keep-alive"))
+			{
+				keepAlive = true;
+			}
+			else if(IsEqualNoCase(header.value, "close"))
+			{
+				keepAlive = false;
+			}
+		}
+		else if(IsEqualNoCase(header.name, "transfer-encoding"))
+		{
+			//Chunked bodies are not supported
+			return PARSE_RESULT_INVALID;
+		}
+	}
+
+	//Small bodies are waited for, larger ones are streamed to the handler
+	size_t bufferedBodySize = static_cast<size_t>(std::min<uint64>(input.size() - headerSize, contentLength));
+	if((bufferedBodySize != contentLength) && (contentLength <= MAX_BUFFERED_BODY_SIZE))
+	{
+		return PARSE_RESULT_INCOMPLETE;
+	}
+
+	const uint8* bodyData = input.data() + headerSize;
+	if(bufferedBodySize == contentLength)
+	{
+		request.body = std::string_view(reinterpret_cast<const char*>(bodyData), bufferedBodySize);
+	}
+	request.contentLength = contentLength;
+	connection.bodyStream = std::make_unique<CBodyStream>(connection.socket, bodyData, bufferedBodySize, contentLength);
+	request.bodyStream = connection.bodyStream.get();
+	connection.requestSize = headerSize + bufferedBodySize;
+	connection.keepAlive = keepAlive;
+	connection.isHeadRequest = (request.method == "HEAD");
+	connection.isHttp10 = (version == "HTTP/1.0");
+	connection.method = request.method;
+	connection.url = request.url;
+	connection.webSocketKey = request.IsWebSocketUpgrade() ? request.GetHeader("sec-websocket-key") : std::string_view();
+	connection.webSocketExtensions = request.GetHeader("sec-websocket-extensions");
+	connection.requestStartTime = std::chrono::steady_clock::now();
+	return PARSE_RESULT_COMPLETE;
+}
+
+void CHttpServer::CompleteRequest(CONNECTION& connection, bool succeeded, Response& response)
+{
+	//Connection waits for a streamed body as it did for the handler
+	connection.isHandlerPending = (connection.streamedBody != nullptr);
+	connection.skipSize = connection.bodyStream->GetUnreceivedSize();
+	connection.bodyStream.reset();
+	//Handlers can't upgrade requests that didn't ask for it
+	bool isUpgrade = succeeded && response.webSocket;
+	succeeded = succeeded && (!isUpgrade || !connection.webSocketKey.empty());
+	unsigned int statusCode = succeeded ? (isUpgrade ? 101 : response.statusCode) : 500;
+	uint64 bodySize = (succeeded && !isUpgrade) ? GetBodySize(response) : 0;
+	if(succeeded)
+	{
+		if(isUpgrade)
+		{
+			AppendUpgradeResponse(connection, response);
+		}
+		else
+		{
+			AppendResponse(connection, response);
+		}
+	}
+	else
+	{
+		AppendOutput(connection, "HTTP/1.1 500 Internal Server Error\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+		connection.closeAfterWrite = true;
+	}
+
+	auto latency = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - connection.requestStartTime).count();
+	m_requestCountMetric.Add();
+	m_responseSizeMetric.Add(bodySize);
+	m_requestDurationMetric.Record(latency);
+	if(statusCode >= 500)
+	{
+		m_errorCountMetric.Add();
+	}
+	if(m_accessLog)
+	{
+		m_accessLog->WriteRequest(connection.method, connection.url, statusCode, bodySize, latency);
+	}
+
+	//Request refers to the input, it can go away now
+	connection.input.erase(connection.input.begin(), connection.input.begin() + connection.requestSize);
+	connection.requestSize = 0;
+	connection.scannedSize = 0;
+	connection.method = std::string_view();
+	connection.url = std::string_view();
+	connection.webSocketKey = std::string_view();
+	connection.webSocketExtensions = std::string_view();
+}
+
+uint64 CHttpServer::GetBodySize(const Response& response)
+{
+	if(response.file) return response.fileSize;
+	if(response.sharedBody) return response.sharedBody->size();
+	if(response.chainedBody) return response.chainedBody->GetSize();
+	return response.body.size();
+}
+
+void CHttpServer::AppendResponse(CONNECTION& connection, Response& response)
+{
+
+	OUTPUT_SEGMENT body;
+	//Writer isn't run for HEAD requests, headers are the same still
+	bool isStreamed = (connection.streamedBody != nullptr) || response.bodyWriter;
+	if(response.file)
+	{
+		body.file = std::move(response.file);
+		body.position = response.fileOffset;
+		body.end = response.fileOffset + response.fileSize;
+	}
+	else if(response.sharedBody)
+	{
+		body.sharedData = std::move(response.sharedBody);
+		body.end = body.sharedData->size();
+	}
+	else if(response.chainedBody)
+	{
+		body.chainedData = std::move(response.chainedBody);
+		body.end = body.chainedData->GetSize();
+	}
+	else
+	{
+		body.data = std::move(response.body);
+		body.end = body.data.size();
+	}
+
+	auto statusCode = response.statusCode;
+	std::string header = string_format(FORMAT_STRING("HTTP/1.1 {} {}\r\n"), statusCode, GetStatusText(statusCode));
+	for(const auto& headerField : response.headers)
+	{
+		header += headerField.first;
+		header += ": ";
+		header += headerField.second;
+		header += "\r\n";
+	}
+	bool hasBody = IsBodyAllowed(statusCode);
+	if(hasBody && isStreamed)
+	{
+		//HTTP/1.0 clients find the end of the body when the connection closes
+		if(connection.isHttp10)
+		{
+			connection.keepAlive = false;
+		}
+		else
+		{
+			header += "Transfer-Encoding: chunked\r\n";
+		}
+	}
+	else if(hasBody)
+	{
+		string_format_to(header, FORMAT_STRING("Content-Length: {}\r\n"), body.end - body.position);
+	}
+	if(!connection.keepAlive)
+	{
+		header += "Connection: close\r\n";
+		connection.closeAfterWrite = true;
+	}
+	header += "\r\n";
+
+	if(hasBody && !connection.isHeadRequest && !body.file && !body.sharedData && !body.chainedData)
+	{
+		header += body.data;
+		body.end = 0;
+	}
+	AppendOutput(connection, std::move(header));
+	if(hasBody && !connection.isHeadRequest && (body.position != body.end))
+	{
+		connection.output.push_back(std::move(body));
+	}
+}
+
+void CHttpServer::AppendUpgradeResponse(CONNECTION& connection, Response& response)
+{
+	auto deflateResponse = WebSocket::NegotiateDeflate(connection.webSocketExtensions);
+	std::string header = "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n";
+	header += "Sec-WebSocket-Accept: ";
+	header += WebSocket::ComputeAcceptKey(connection.webSocketKey);
+	header += "\r\n";
+	if(!deflateResponse.empty())
+	{
+		header += "Sec-WebSocket-Extensions: ";
+		header += deflateResponse;
+		header += "\r\n";
+	}
+	for(const auto& headerField : response.headers)
+	{
+		header += headerField.first;
+		header += ": ";
+		header += headerField.second;
+		header += "\r\n";
+	}
+	header += "\r\n";
+	AppendOutput(connection, std::move(header));
+
+	connection.isWebSocketDeflateEnabled = !deflateResponse.empty();
+	connection.webSocketReader = std::make_unique<WebSocket::CFrameReader>(connection.isWebSocketDeflateEnabled, MAX_WEBSOCKET_MESSAGE_SIZE);
+	connection.webSocket = std::move(response.webSocket);
+	connection.webSocket->Attach(this, connection.socket, connection.isWebSocketDeflateEnabled);
+}
+
+void CHttpServer::ProcessCompletions()
+{
+	std::vector<COMPLETION> completions;
+	{
+		std::unique_lock<std::mutex> lock(m_completionsMutex);
+		std::swap(completions, m_completions);
+	}
+	for(auto& completion : completions)
+	{
+		//Handler is still pending until its body is written
+		if(!completion.streamedBody)
+		{
+			m_pendingHandlerCount--;
+		}
+		//Connections aren't closed while a handler is pending
+		auto connectionIterator = m_connections.find(completion.socket);
+		assert(connectionIterator != std::end(m_connections));
+		auto& connection = *connectionIterator->second;
+		connection.streamedBody = std::move(completion.streamedBody);
+		CompleteRequest(connection, completion.succeeded, completion.response);
+		ProcessRequests(connection);
+		UpdateConnection(connection);
+	}
+}
+
+//Moves chunks of the streamed body to the output once what was queued before is sent, which keeps the
+//body writer waiting while the client is slow. Dropped once sending failed.
+void CHttpServer::FlushStreamedBody(CONNECTION& connection)
+{
+	auto& body = *connection.streamedBody;
+	std::deque<std::string> chunks;
+	bool isDone = false;
+	bool succeeded = false;
+	{
+		std::unique_lock<std::mutex> lock(body.mutex);
+		if(connection.isSendFailed)
+		{
+			body.isAborted = true;
+			body.chunks.clear();
+			body.condition.notify_all();
+		}
+		if(!connection.output.empty() && !body.isDone) return;
+		std::swap(chunks, body.chunks);
+		isDone = body.isDone;
+		succeeded = body.succeeded;
+		body.condition.notify_all();
+	}
+	for(auto& chunk : chunks)
+	{
+		m_responseSizeMetric.Add(chunk.size());
+		if(connection.isHttp10)
+		{
+			AppendOutput(connection, std::move(chunk));
+			continue;
+		}
+		auto data = string_format(FORMAT_STRING("{:x}\r\n"), chunk.size());
+		data += chunk;
+		data += "\r\n";
+		AppendOutput(connection, std::move(data));
+	}
+	if(!isDone) return;
+
+	m_pendingHandlerCount--;
+	connection.streamedBody.reset();
+	connection.isHandlerPending = false;
+	if(!succeeded || connection.isHttp10)
+	{
+		//Client can only tell that a body was cut short when the connection closes before its end
+		connection.closeAfterWrite = true;
+	}
+	else
+	{
+		AppendOutput(connection, "0\r\n\r\n");
+	}
+	ProcessRequests(connection);
+}
+
+void CHttpServer::ProcessStreamedBodyOutput()
+{
+	std::vector<SOCKET> sockets;
+	{
+		std::unique_lock<std::mutex> lock(m_completionsMutex);
+		std::swap(sockets, m_streamedBodyOutputs);
+	}
+	for(auto socket : sockets)
+	{
+		//Connection might be done with the body already, or gone along with it
+		auto connectionIterator = m_connections.find(socket);
+		if(connectionIterator == std::end(m_connections)) continue;
+		UpdateConnection(*connectionIterator->second);
+	}
+}
+
+//Body writers are waited for when stopping, they're made to fail instead of waiting for slow clients
+void CHttpServer::AbortStreamedBodies()
+{
+	for(auto& connectionPair : m_connections)
+	{
+		const auto& body = connectionPair.second->streamedBody;
+		if(!body) continue;
+		std::unique_lock<std::mutex> lock(body->mutex);
+		body->isAborted = true;
+		body->condition.notify_all();
+	}
+}
+
+//Handles the frames in the input of an upgraded connection. Messages are given to the socket's
+//handler right away, pings are answered and close frames are echoed.
+void CHttpServer::ProcessWebSocketFrames(CONNECTION& connection)
+{
+	FRAMEWORK_TRACE_SCOPE("HttpServer::ProcessWebSocketFrames");
+	auto& input = connection.input;
+	size_t readSize = 0;
+	while(!connection.closeAfterWrite)
+	{
+		WebSocket::CFrameReader::MESSAGE message;
+		size_t consumedSize = 0;
+		auto result = connection.webSocketReader->Read(input.data() + readSize, input.size() - readSize, consumedSize, message);
+		readSize += consumedSize;
+		if(result == WebSocket::CFrameReader::RESULT_INCOMPLETE) break;
+		if(result == WebSocket::CFrameReader::RESULT_ERROR)
+		{
+			CloseWebSocket(connection, connection.webSocketReader->GetErrorCode());
+			break;
+		}
+		switch(message.opcode)
+		{
+		case WebSocket::OPCODE_PING:
+		{
+			//Goes out before messages not yet taken from the socket, they're never fragmented
+			CWebSocketMessage pong(WebSocket::OPCODE_PONG, message.data.data(), message.data.size());
+			OUTPUT_SEGMENT segment;
+			segment.sharedData = pong.GetFrame(false);
+			segment.end = segment.sharedData->size();
+			connection.output.push_back(std::move(segment));
+		}
+		break;
+		case WebSocket::OPCODE_PONG:
+			break;
+		case WebSocket::OPCODE_CLOSE:
+		{
+			uint16 code = WebSocket::CLOSE_NORMAL;
+			if(message.data.size() >= 2)
+			{
+				code = static_cast<uint16>((static_cast<uint8>(message.data[0]) << 8) | static_cast<uint8>(message.data[1]));
+			}
+			CloseWebSocket(connection, code);
+		}
+		break;
+		default:
+			try
+			{
+				connection.webSocket->HandleMessage(message.data, message.opcode == WebSocket::OPCODE_BINARY);
+			}
+			catch(...)
+			{
+				CloseWebSocket(connection, WebSocket::CLOSE_INTERNAL_ERROR);
+			}
+			break;
+		}
+	}
+	input.erase(input.begin(), input.begin() + readSize);
+	if(connection.closeAfterWrite)
+	{
+		input.clear();
+	}
+}
+
+void CHttpServer::CloseWebSocket(CONNECTION& connection, uint16 code)
+{
+	connection.webSocket->Close(code);
+	FlushWebSocket(connection);
+}
+
+//Moves the messages sent through the socket to the connection's output. Frames are shared with
+//every other connection the messages were sent to.
+void CHttpServer::FlushWebSocket(CONNECTION& connection)
+{
+	CWebSocket::MessageArray messages;
+	connection.webSocket->TakeMessages(messages);
+	for(const auto& message : messages)
+	{
+		if(connection.closeAfterWrite) break;
+		OUTPUT_SEGMENT segment;
+		segment.sharedData = message->GetFrame(connection.isWebSocketDeflateEnabled);
+		segment.end = segment.sharedData->size();
+		connection.output.push_back(std::move(segment));
+		if(message->GetOpcode() == WebSocket::OPCODE_CLOSE)
+		{
+			connection.closeAfterWrite = true;
+		}
+	}
+	if(connection.output.size() > MAX_WEBSOCKET_QUEUED_FRAMES)
+	{
+		connection.output.clear();
+		connection.isPeerClosed = true;
+		connection.closeAfterWrite = true;
+	}
+}
+
+void CHttpServer::QueueWebSocketOutput(WebSocketPtr webSocket)
+{
+	std::unique_lock<std::mutex> lock(m_completionsMutex);
+	m_webSocketOutputs.push_back(std::move(webSocket));
+	Wake();
+}
+
+void CHttpServer::ProcessWebSocketOutput()
+{
+	std::vector<WebSocketPtr> webSockets;
+	{
+		std::unique_lock<std::mutex> lock(m_completionsMutex);
+		std::swap(webSockets, m_webSocketOutputs);
+	}
+	for(const auto& webSocket : webSockets)
+	{
+		//Socket is only changed by the server's thread when attaching. Connection might be gone,
+		//with its socket reused by another one.
+		auto connectionIterator = m_connections.find(webSocket->m_socket);
+		if(connectionIterator == std::end(m_connections)) continue;
+		auto& connection = *connectionIterator->second;
+		if(connection.webSocket != webSocket) continue;
+		FlushWebSocket(connection);
+		UpdateConnection(connection);
+	}
+}
+
+void CHttpServer::Wake()
+{
+	char value = 0;
+	send(m_wakeSock, &value, 1, 0);
+}
+
+void CHttpServer::DrainWakeSocket()
+{
+	char buffer[64];
+	while(recv(m_wakeSock, buffer, sizeof(buffer), 0) > 0)
 	{
-		Log("Failed to process request from client.\r\n");
 	}
 }
 
 void CHttpServer::Log(const char* format, ...)
 {
-	if(!m_logStream) return;
+	if(!m_accessLog) return;
 	va_list args;
 	va_start(args, format);
-	vfprintf(*m_logStream, format, args);
+	m_accessLog->WriteMessageV(format, args);
 	va_end(args);
-	m_logStream->Flush();
 }
@@ -0,0 +1,410 @@
+#include "http/HttpStaticFileHandler.h"
+#include <algorithm>
+#include <cassert>
+#include <cctype>
+#include <ctime>
+#include <stdexcept>
+#include <sys/stat.h>
+#include "StdStreamUtils.h"
+#include "memory/AllocationTracker.h"
+#include "string_format.h"
+
+using namespace Framework;
+
+static const struct
+{
+	const char* extension;
+	const char* contentType;
+} g_contentTypes[] =
+{
+	{".html", "text/html; charset=utf-8"},
+	{".htm", "text/html; charset=utf-8"},
+	{".css", "text/css; charset=utf-8"},
+	{".js", "text/javascript; charset=utf-8"},
+	{".mjs", "text/javascript; charset=utf-8"},
+	{".json", "application/json"},
+	{".map", "application/json"},
+	{".txt", "text/plain; charset=utf-8"},
+	{".xml", "application/xml"},
+	{".svg", "image/svg+xml"},
+	{".png", "image/png"},
+	{".jpg", "image/jpeg"},
+	{".jpeg", "image/jpeg"},
+	{".gif", "image/gif"},
+	{".webp", "image/webp"},
+	{".ico", "image/x-icon"},
+	{".wasm", "application/wasm"},
+	{".woff", "font/woff"},
+	{".woff2", "font/woff2"},
+	{".zip", "application/zip"},
+	{".pdf", "application/pdf"},
+};
+
+//Precompressed variants, in order of preference
+static const struct
+{
+	const char* encoding;
+	const char* extension;
+} g_encodings[] =
+{
+	{"zstd", ".zst"},
+	{"gzip", ".gz"},
+};
+
+static bool IsEqualNoCase(const std::string_view& a, const std::string_view& b)
+{
+	return (a.size() == b.size()) &&
+	       std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) { return tolower(x) == tolower(y); });
+}
+
+static std::string_view TrimWhitespace(std::string_view value)
+{
+	static const char whitespace[] = " \t";
+	auto start = value.find_first_not_of(whitespace);
+	if(start == std::string_view::npos) return std::string_view();
+	auto end = value.find_last_not_of(whitespace);
+	return value.substr(start, end - start + 1);
+}
+
+//Calls the function for every element of a comma separated list, stops if it returns true
+template <typename FunctionType>
+static bool FindListElement(std::string_view list, const FunctionType& function)
+{
+	while(!list.empty())
+	{
+		auto separator = list.find(',');
+		auto element = TrimWhitespace(list.substr(0, separator));
+		if(!element.empty() && function(element)) return true;
+		if(separator == std::string_view::npos) break;
+		list.remove_prefix(separator + 1);
+	}
+	return false;
+}
+
+static bool DecodeUrlPath(const std::string_view& url, std::string& path)
+{
+	path.clear();
+	for(size_t i = 0; i < url.size(); i++)
+	{
+		char value = url[i];
+		if(value == '%')
+		{
+			if(((i + 2) >= url.size()) || !isxdigit(static_cast<uint8>(url[i + 1])) || !isxdigit(static_cast<uint8>(url[i + 2])))
+			{
+				return false;
+			}
+			value = static_cast<char>(std::stoi(std::string(url.substr(i + 1, 2)), nullptr, 16));
+			i += 2;
+		}
+		//Paths are relative to the root and can't go outside of it
+		if((value == '\0') || (value == '\\') || (value == ':'))
+		{
+			return false;
+		}
+		path += value;
+	}
+	size_t segmentStart = 0;
+	while(segmentStart <= path.size())
+	{
+		auto segmentEnd = std::min(path.find('/', segmentStart), path.size());
+		if(path.compare(segmentStart, segmentEnd - segmentStart, "..") == 0)
+		{
+			return false;
+		}
+		segmentStart = segmentEnd + 1;
+	}
+	return true;
+}
+
+static std::string FormatHttpDate(int64 time)
+{
+	static const char* dayNames[] = {"Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"};
+	static const char* monthNames[] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+	time_t timeValue = static_cast<time_t>(time);
+	tm timeParts = {};
+#ifdef _WIN32
+	gmtime_s(&timeParts, &timeValue);
+#else
+	gmtime_r(&timeValue, &timeParts);
+#endif
+	return string_format("%s, %02d %s %04d %02d:%02d:%02d GMT", dayNames[timeParts.tm_wday], timeParts.tm_mday,
+	                     monthNames[timeParts.tm_mon], timeParts.tm_year + 1900, timeParts.tm_hour, timeParts.tm_min, timeParts.tm_sec);
+}
+
+static const char* GetContentType(const fs::path& path)
+{
+	auto extension = path.extension().string();
+	for(const auto& contentType : g_contentTypes)
+	{
+		if(IsEqualNoCase(extension, contentType.extension)) return contentType.contentType;
+	}
+	return "application/octet-stream";
+}
+
+//Parses a single range ("bytes=first-last", "bytes=first-" or "bytes=-suffixLength"). Returns false if
+//the header should be ignored and the whole file sent. An empty range means it can't be satisfied.
+static bool ParseRange(std::string_view range, uint64 size, uint64& first, uint64& last)
+{
+	static const std::string_view unitPrefix("bytes=");
+	if(!IsEqualNoCase(range.substr(0, unitPrefix.size()), unitPrefix)) return false;
+	range.remove_prefix(unitPrefix.size());
+	//Sending many parts (multipart/byteranges) is not supported
+	if(range.find(',') != std::string_view::npos) return false;
+
+	auto separator = range.find('-');
+	if(separator == std::string_view::npos) return false;
+	auto firstText = TrimWhitespace(range.substr(0, separator));
+	auto lastText = TrimWhitespace(range.substr(separator + 1));
+	auto isNumber = [](const std::string_view& text) {
+		return !text.empty() && (text.size() <= 18) && (text.find_first_not_of("0123456789") == std::string_view::npos);
+	};
+	if(!(firstText.empty() || isNumber(firstText)) || !(lastText.empty() || isNumber(lastText))) return false;
+	if(firstText.empty() && lastText.empty()) return false;
+
+	if(firstText.empty())
+	{
+		uint64 suffixLength = std::stoull(std::string(lastText));
+		first = size - std::min(suffixLength, size);
+		last = size;
+		return true;
+	}
+	first = std::stoull(std::string(firstText));
+	last = size;
+	if(!lastText.empty())
+	{
+		uint64 lastPosition = std::stoull(std::string(lastText));
+		if(lastPosition < first) return false;
+		last = std::min(lastPosition + 1, size);
+	}
+	if(first >= size)
+	{
+		first = last = 0;
+	}
+	return true;
+}
+
+CHttpStaticFileHandler::CHttpStaticFileHandler(const fs::path& root, std::string urlPrefix, size_t cacheSize, size_t maxCachedFileSize)
+    : m_root(root)
+    , m_urlPrefix(std::move(urlPrefix))
+    , m_cacheSize(cacheSize)
+    , m_maxCachedFileSize(std::min(maxCachedFileSize, cacheSize))
+{
+}
+
+bool CHttpStaticFileHandler::Serve(const CHttpServer::Request& request, CHttpServer::Response& response)
+{
+	if((request.method != "GET") && (request.method != "HEAD")) return false;
+
+	auto url = request.url.substr(0, request.url.find_first_of("?#"));
+	if(url.compare(0, m_urlPrefix.size(), m_urlPrefix) != 0) return false;
+	url.remove_prefix(m_urlPrefix.size());
+
+	response = CHttpServer::Response();
+	std::string relativePath;
+	if(!DecodeUrlPath(url, relativePath))
+	{
+		response.statusCode = 400;
+		return true;
+	}
+	relativePath.erase(0, relativePath.find_first_not_of('/'));
+	if(relativePath.empty() || (relativePath.back() == '/'))
+	{
+		relativePath += "index.html";
+	}
+
+	auto path = m_root / fs::u8path(relativePath);
+	FILE_INFO info;
+	if(!GetFileInfo(path, info))
+	{
+		response.statusCode = 404;
+		return true;
+	}
+	auto lastModified = FormatHttpDate(info.modifiedTime);
+	auto contentType = GetContentType(path);
+
+	//Use a precompressed variant if there's one the client accepts
+	const char* contentEncoding = nullptr;
+	auto acceptEncoding = request.GetHeader("accept-encoding");
+	for(const auto& encoding : g_encodings)
+	{
+		if(!IsEncodingAccepted(acceptEncoding, encoding.encoding)) continue;
+		auto encodedPath = path;
+		encodedPath += encoding.extension;
+		FILE_INFO encodedInfo;
+		if(!GetFileInfo(encodedPath, encodedInfo)) continue;
+		path = std::move(encodedPath);
+		info = encodedInfo;
+		contentEncoding = encoding.encoding;
+		break;
+	}
+	auto etag = string_format("\"%llx-%llx%s%s\"", static_cast<unsigned long long>(info.size), static_cast<unsigned long long>(info.modifiedTime),
+	                          contentEncoding ? "-" : "", contentEncoding ? contentEncoding : "");
+
+	auto& headers = response.headers;
+	headers.emplace_back("ETag", etag);
+	headers.emplace_back("Last-Modified", lastModified);
+	headers.emplace_back("Vary", "Accept-Encoding");
+
+	//If-Modified-Since is only checked for an exact match with the date we sent
+	bool isNotModified = false;
+	auto ifNoneMatch = request.GetHeader("if-none-match");
+	if(!ifNoneMatch.empty())
+	{
+		isNotModified = FindListElement(ifNoneMatch, [&](std::string_view element) {
+			if(element.substr(0, 2) == "W/") element.remove_prefix(2);
+			return (element == "*") || (element == etag);
+		});
+	}
+	else
+	{
+		isNotModified = (request.GetHeader("if-modified-since") == lastModified);
+	}
+	if(isNotModified)
+	{
+		response.statusCode = 304;
+		return true;
+	}
+
+	headers.emplace_back("Content-Type", contentType);
+	headers.emplace_back("Accept-Ranges", "bytes");
+	if(contentEncoding)
+	{
+		headers.emplace_back("Content-Encoding", contentEncoding);
+	}
+
+	uint64 first = 0;
+	uint64 last = info.size;
+	auto range = request.GetHeader("range");
+	auto ifRange = request.GetHeader("if-range");
+	bool useRange = !range.empty() && (ifRange.empty() || (ifRange == etag) || (ifRange == lastModified)) &&
+	                ParseRange(range, info.size, first, last);
+	if(useRange)
+	{
+		if(first == last)
+		{
+			response.statusCode = 416;
+			headers.emplace_back("Content-Range", string_format("bytes */%llu", static_cast<unsigned long long>(info.size)));
+			return true;
+		}
+		response.statusCode = 206;
+		headers.emplace_back("Content-Range", string_format("bytes %llu-%llu/%llu", static_cast<unsigned long long>(first),
+		                                                   static_cast<unsigned long long>(last - 1), static_cast<unsigned long long>(info.size)));
+	}
+
+	try
+	{
+		if(info.size <= m_maxCachedFileSize)
+		{
+			auto content = GetCachedContent(path, info);
+			if(useRange)
+			{
+				response.body.assign(content->begin() + first, content->begin() + last);
+			}
+			else
+			{
+				response.sharedBody = std::move(content);
+			}
+		}
+		else
+		{
+			response.file = std::make_shared<CStdStream>(path.native().c_str(), GetInputStdStreamMode<fs::path::string_type>());
+			response.fileOffset = first;
+			response.fileSize = last - first;
+		}
+	}
+	catch(...)
+	{
+		//File went away or changed since we looked at it
+		response = CHttpServer::Response();
+		response.statusCode = 404;
+	}
+	return true;
+}
+
+bool CHttpStaticFileHandler::GetFileInfo(const fs::path& path, FILE_INFO& info)
+{
+#ifdef _WIN32
+	struct _stat64 status = {};
+	if(_wstat64(path.native().c_str(), &status) != 0) return false;
+	if((status.st_mode & _S_IFREG) == 0) return false;
+#else
+	struct stat status = {};
+	if(stat(path.native().c_str(), &status) != 0) return false;
+	if(!S_ISREG(status.st_mode)) return false;
+#endif
+	info.size = status.st_size;
+	info.modifiedTime = status.st_mtime;
+	return true;
+}
+
+bool CHttpStaticFileHandler::IsEncodingAccepted(const std::string_view& acceptEncoding, const std::string_view& encoding)
+{
+	return FindListElement(acceptEncoding, [&](const std::string_view& element) {
+		auto parameters = element.find(';');
+		if(!IsEqualNoCase(TrimWhitespace(element.substr(0, parameters)), encoding)) return false;
+		if(parameters == std::string_view::npos) return true;
+		//Explicitly refused with "q=0"
+		auto quality = TrimWhitespace(element.substr(parameters + 1));
+		return (quality.substr(0, 2) != "q=") || (quality.find_first_not_of("0.", 2) != std::string_view::npos);
+	});
+}
+
+//Returns the file's content, read from disk if it isn't cached or if it changed
+std::shared_ptr<const std::vector<uint8>> CHttpStaticFileHandler::GetCachedContent(const fs::path& path, const FILE_INFO& info)
+{
+	const auto& key = path.native();
+	{
+		std::unique_lock<std::mutex> lock(m_cacheMutex);
+		auto entryIterator = m_cache.find(key);
+		if(entryIterator != std::end(m_cache))
+		{
+			auto& entry = entryIterator->second;
+			if((entry.info.size == info.size) && (entry.info.modifiedTime == info.modifiedTime))
+			{
+				m_lru.splice(m_lru.begin(), m_lru, entry.lruIterator);
+				return entry.content;
+			}
+		}
+	}
+
+	//Read outside of the lock, another thread might be doing the same but that's harmless
+	struct TRACKED_CONTENT
+	{
+		std::vector<uint8> data;
+		Memory::CAllocationRecord allocationRecord;
+	};
+	auto trackedContent = std::make_shared<TRACKED_CONTENT>();
+	trackedContent->data.resize(static_cast<size_t>(info.size));
+	trackedContent->allocationRecord = Memory::CAllocationRecord(Memory::CAllocationTracker::SUBSYSTEM_HTTP, FRAMEWORK_ALLOCATION_SITE, trackedContent->data.size());
+	//Shares ownership of the record, counted until the last response using the content is done
+	auto content = std::shared_ptr<std::vector<uint8>>(trackedContent, &trackedContent->data);
+	auto stream = CreateInputStdStream(path.native());
+	if(stream.Read(content->data(), content->size()) != content->size())
+	{
+		throw std::runtime_error("Failed to read file.");
+	}
+
+	std::unique_lock<std::mutex> lock(m_cacheMutex);
+	auto entryIterator = m_cache.find(key);
+	if(entryIterator != std::end(m_cache))
+	{
+		m_cachedSize -= entryIterator->second.content->size();
+		m_lru.erase(entryIterator->second.lruIterator);
+		m_cache.erase(entryIterator);
+	}
+	while(!m_lru.empty() && ((m_cachedSize + content->size()) > m_cacheSize))
+	{
+		auto evictedIterator = m_cache.find(m_lru.back());
+		assert(evictedIterator != std::end(m_cache));
+		m_cachedSize -= evictedIterator->second.content->size();
+		m_cache.erase(evictedIterator);
+		m_lru.pop_back();
+	}
+	CACHE_ENTRY entry;
+	entry.info = info;
+	entry.content = content;
+	entry.lruIterator = m_lru.insert(m_lru.begin(), key);
+	m_cache.emplace(key, std::move(entry));
+	m_cachedSize += content->size();
+	return content;
+}
@@ -0,0 +1,578 @@
+#include "http/WebSocket.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+#include <zstd_zlibwrapper.h>
+#include "http/HttpServer.h"
+#include "Base64.h"
+#include "HashUtils.h"
+#include "Utf8.h"
+
+using namespace Framework;
+using namespace Framework::WebSocket;
+
+namespace
+{
+	enum
+	{
+		MAX_HEADER_SIZE = 10,
+		INFLATE_CHUNK_SIZE = 0x4000,
+	};
+
+	//Ends every deflated message when flushed, removed from messages and added back before inflating
+	const uint8 g_deflateTail[4] = {0x00, 0x00, 0xFF, 0xFF};
+
+	std::string_view TrimWhitespace(std::string_view value)
+	{
+		static const char whitespace[] = " \t";
+		auto start = value.find_first_not_of(whitespace);
+		if(start == std::string_view::npos) return std::string_view();
+		auto end = value.find_last_not_of(whitespace);
+		return value.substr(start, end - start + 1);
+	}
+
+	bool IsControlOpcode(OPCODE opcode)
+	{
+		return (opcode & 0x08) != 0;
+	}
+
+	//Server frames are never masked
+	size_t WriteFrameHeader(uint8* output, OPCODE opcode, bool isCompressed, size_t payloadSize)
+	{
+		output[0] = 0x80 | (isCompressed ? 0x40 : 0x00) | opcode;
+		if(payloadSize < 126)
+		{
+			output[1] = static_cast<uint8>(payloadSize);
+			return 2;
+		}
+		if(payloadSize <= 0xFFFF)
+		{
+			output[1] = 126;
+			output[2] = static_cast<uint8>(payloadSize >> 8);
+			output[3] = static_cast<uint8>(payloadSize);
+			return 4;
+		}
+		output[1] = 127;
+		for(unsigned int i = 0; i < 8; i++)
+		{
+			output[2 + i] = static_cast<uint8>(static_cast<uint64>(payloadSize) >> ((7 - i) * 8));
+		}
+		return 10;
+	}
+
+	//Masks are applied 8 bytes at a time, offsets stay aligned on the 4 bytes mask
+	void Unmask(uint8* data, size_t size, const uint8* mask)
+	{
+		uint8 wideMask[8];
+		for(unsigned int i = 0; i < 8; i++)
+		{
+			wideMask[i] = mask[i & 3];
+		}
+		uint64 wideMaskValue = 0;
+		memcpy(&wideMaskValue, wideMask, sizeof(wideMaskValue));
+		size_t i = 0;
+		for(; (i + 8) <= size; i += 8)
+		{
+			uint64 value = 0;
+			memcpy(&value, data + i, sizeof(value));
+			value ^= wideMaskValue;
+			memcpy(data + i, &value, sizeof(value));
+		}
+		for(; i < size; i++)
+		{
+			data[i] ^= mask[i & 3];
+		}
+	}
+
+	//Deflate stream kept by each thread compressing messages, reset between messages since we
+	//don't use context takeover
+	class CMessageDeflater
+	{
+	public:
+		CMessageDeflater()
+		{
+			m_isValid = (deflateInit2(&m_stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) == Z_OK);
+		}
+
+		~CMessageDeflater()
+		{
+			if(m_isValid)
+			{
+				deflateEnd(&m_stream);
+			}
+		}
+
+		//Appends the compressed data to the output, without the flush marker. False if it failed.
+		bool Deflate(const uint8* data, size_t size, std::vector<uint8>& output)
+		{
+			if(!m_isValid) return false;
+			size_t outputStart = output.size();
+			//Bound is for a finished stream, leaves room for the flush marker
+			size_t boundSize = deflateBound(&m_stream, static_cast<uLong>(size)) + 16;
+			output.resize(outputStart + boundSize);
+			m_stream.next_in = const_cast<Bytef*>(data);
+			m_stream.avail_in = static_cast<uInt>(size);
+			m_stream.next_out = output.data() + outputStart;
+			m_stream.avail_out = static_cast<uInt>(boundSize);
+			int ret = deflate(&m_stream, Z_SYNC_FLUSH);
+			size_t deflatedSize = boundSize - m_stream.avail_out;
+			deflateReset(&m_stream);
+			if((ret != Z_OK) || (m_stream.avail_in != 0) || (deflatedSize < sizeof(g_deflateTail)) ||
+			   (memcmp(output.data() + outputStart + deflatedSize - sizeof(g_deflateTail), g_deflateTail, sizeof(g_deflateTail)) != 0))
+			{
+				output.resize(outputStart);
+				return false;
+			}
+			output.resize(outputStart + deflatedSize - sizeof(g_deflateTail));
+			return true;
+		}
+
+	private:
+		z_stream m_stream = {};
+		bool m_isValid = false;
+	};
+}
+
+std::string WebSocket::ComputeAcceptKey(std::string_view key)
+{
+	static const char guid[] = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+	std::string input(TrimWhitespace(key));
+	input += guid;
+	auto hash = HashUtils::ComputeSha1(input.data(), input.size());
+	return ToBase64(hash.data(), hash.size());
+}
+
+std::string_view WebSocket::NegotiateDeflate(std::string_view extensions)
+{
+	while(!extensions.empty())
+	{
+		auto offerEnd = extensions.find(',');
+		auto offer = extensions.substr(0, offerEnd);
+		extensions = (offerEnd == std::string_view::npos) ? std::string_view() : extensions.substr(offerEnd + 1);
+
+		auto nameEnd = offer.find(';');
+		if(TrimWhitespace(offer.substr(0, nameEnd)) != "permessage-deflate") continue;
+		offer = (nameEnd == std::string_view::npos) ? std::string_view() : offer.substr(nameEnd + 1);
+
+		//Window sizes asked by the client are fine as long as ours isn't limited
+		bool isAcceptable = true;
+		while(!offer.empty() && isAcceptable)
+		{
+			auto parameterEnd = offer.find(';');
+			auto parameter = TrimWhitespace(offer.substr(0, parameterEnd));
+			offer = (parameterEnd == std::string_view::npos) ? std::string_view() : offer.substr(parameterEnd + 1);
+
+			auto valueStart = parameter.find('=');
+			auto name = TrimWhitespace(parameter.substr(0, valueStart));
+			auto value = (valueStart == std::string_view::npos) ? std::string_view() : TrimWhitespace(parameter.substr(valueStart + 1));
+			if((value.size() >= 2) && (value.front() == '"') && (value.back() == '"'))
+			{
+				value = value.substr(1, value.size() - 2);
+			}
+			if(name == "server_max_window_bits")
+			{
+				isAcceptable = (value == "15");
+			}
+			else
+			{
+				isAcceptable = (name == "server_no_context_takeover") || (name == "client_no_context_takeover") ||
+				               (name == "client_max_window_bits");
+			}
+		}
+		if(isAcceptable)
+		{
+			return "permessage-deflate; server_no_context_takeover";
+		}
+	}
+	return std::string_view();
+}
+
+WebSocket::CFrameReader::CFrameReader(bool isDeflateEnabled, size_t maxMessageSize)
+    : m_maxMessageSize(maxMessageSize)
+    , m_isDeflateEnabled(isDeflateEnabled)
+{
+	if(m_isDeflateEnabled)
+	{
+		//Clients can keep their context between messages, so do we
+		m_inflateStream = std::make_unique<z_stream>();
+		if(inflateInit2(m_inflateStream.get(), -MAX_WBITS) != Z_OK)
+		{
+			throw std::runtime_error("zlib stream initialization error.");
+		}
+	}
+}
+
+WebSocket::CFrameReader::~CFrameReader()
+{
+	if(m_inflateStream)
+	{
+		inflateEnd(m_inflateStream.get());
+	}
+}
+
+WebSocket::CFrameReader::RESULT WebSocket::CFrameReader::Read(uint8* input, size_t inputSize, size_t& consumedSize, MESSAGE& message)
+{
+	consumedSize = 0;
+	while(1)
+	{
+		uint8* frame = input + consumedSize;
+		size_t availableSize = inputSize - consumedSize;
+		if(availableSize < 2) return RESULT_INCOMPLETE;
+
+		bool isFinal = (frame[0] & 0x80) != 0;
+		bool isCompressed = (frame[0] & 0x40) != 0;
+		auto opcode = static_cast<OPCODE>(frame[0] & 0x0F);
+		//Other reserved bits aren't used by any extension we negotiate, clients must mask their frames
+		if(((frame[0] & 0x30) != 0) || ((frame[1] & 0x80) == 0))
+		{
+			return Fail(CLOSE_PROTOCOL_ERROR);
+		}
+
+		uint64 payloadSize = frame[1] & 0x7F;
+		size_t headerSize = 2;
+		if(payloadSize == 126)
+		{
+			if(availableSize < 4) return RESULT_INCOMPLETE;
+			payloadSize = (static_cast<uint64>(frame[2]) << 8) | frame[3];
+			headerSize = 4;
+		}
+		else if(payloadSize == 127)
+		{
+			if(availableSize < 10) return RESULT_INCOMPLETE;
+			payloadSize = 0;
+			for(unsigned int i = 0; i < 8; i++)
+			{
+				payloadSize = (payloadSize << 8) | frame[2 + i];
+			}
+			headerSize = 10;
+		}
+		const uint8* mask = frame + headerSize;
+		headerSize += 4;
+
+		if(IsControlOpcode(opcode))
+		{
+			bool isKnown = (opcode == OPCODE_CLOSE) || (opcode == OPCODE_PING) || (opcode == OPCODE_PONG);
+			if(!isKnown || !isFinal || isCompressed || (payloadSize > 125))
+			{
+				return Fail(CLOSE_PROTOCOL_ERROR);
+			}
+		}
+		else if(opcode == OPCODE_CONTINUATION)
+		{
+			if(!m_isMessageStarted || isCompressed)
+			{
+				return Fail(CLOSE_PROTOCOL_ERROR);
+			}
+		}
+		else if((opcode != OPCODE_TEXT) && (opcode != OPCODE_BINARY))
+		{
+			return Fail(CLOSE_PROTOCOL_ERROR);
+		}
+		else if(m_isMessageStarted || (isCompressed && !m_isDeflateEnabled))
+		{
+			return Fail(CLOSE_PROTOCOL_ERROR);
+		}
+
+		uint64 messageSize = (m_isMessageStarted ? m_messageBuffer.size() : 0) + payloadSize;
+		if(messageSize > m_maxMessageSize)
+		{
+			return Fail(CLOSE_MESSAGE_TOO_BIG);
+		}
+		if(availableSize < (headerSize + payloadSize)) return RESULT_INCOMPLETE;
+
+		uint8* payload = frame + headerSize;
+		size_t size = static_cast<size_t>(payloadSize);
+		Unmask(payload, size, mask);
+		consumedSize += headerSize + size;
+
+		if(IsControlOpcode(opcode))
+		{
+			message.opcode = opcode;
+			message.data = std::string_view(reinterpret_cast<const char*>(payload), size);
+			return RESULT_MESSAGE;
+		}
+
+		if(opcode != OPCODE_CONTINUATION)
+		{
+			m_isMessageStarted = true;
+			m_isMessageCompressed = isCompressed;
+			m_messageOpcode = opcode;
+			m_messageBuffer.clear();
+		}
+		if(!isFinal)
+		{
+			m_messageBuffer.insert(m_messageBuffer.end(), payload, payload + size);
+			continue;
+		}
+		m_isMessageStarted = false;
+
+		//Unfragmented messages are used from the input
+		const uint8* data = payload;
+		if(opcode == OPCODE_CONTINUATION)
+		{
+			m_messageBuffer.insert(m_messageBuffer.end(), payload, payload + size);
+			data = m_messageBuffer.data();
+			size = m_messageBuffer.size();
+		}
+		if(m_isMessageCompressed)
+		{
+			if(!Inflate(data, size))
+			{
+				return RESULT_ERROR;
+			}
+			data = m_inflateBuffer.data();
+			size = m_inflateBuffer.size();
+		}
+		auto text = reinterpret_cast<const char*>(data);
+		if((m_messageOpcode == OPCODE_TEXT) && !Utf8::IsValid(text, size))
+		{
+			return Fail(CLOSE_INVALID_DATA);
+		}
+		message.opcode = m_messageOpcode;
+		message.data = std::string_view(text, size);
+		return RESULT_MESSAGE;
+	}
+}
+
+CLOSE_CODE WebSocket::CFrameReader::GetErrorCode() const
+{
+	return m_errorCode;
+}
+
+WebSocket::CFrameReader::RESULT WebSocket::CFrameReader::Fail(CLOSE_CODE errorCode)
+{
+	m_errorCode = errorCode;
+	return RESULT_ERROR;
+}
+
+bool WebSocket::CFrameReader::Inflate(const uint8* data, size_t size)
+{
+	auto stream = m_inflateStream.get();
+	m_inflateBuffer.clear();
+	std::pair<const uint8*, size_t> parts[2] = {{data, size}, {g_deflateTail, sizeof(g_deflateTail)}};
+	for(const auto& part : parts)
+	{
+		stream->next_in = const_cast<Bytef*>(part.first);
+		stream->avail_in = static_cast<uInt>(part.second);
+		do
+		{
+			if(m_inflateBuffer.size() > m_maxMessageSize)
+			{
+				Fail(CLOSE_MESSAGE_TOO_BIG);
+				return false;
+			}
+			size_t outputStart = m_inflateBuffer.size();
+			m_inflateBuffer.resize(outputStart + INFLATE_CHUNK_SIZE);
+			stream->next_out = m_inflateBuffer.data() + outputStart;
+			stream->avail_out = INFLATE_CHUNK_SIZE;
+			int ret = inflate(stream, Z_SYNC_FLUSH);
+			m_inflateBuffer.resize(outputStart + INFLATE_CHUNK_SIZE - stream->avail_out);
+			if(ret == Z_STREAM_END)
+			{
+				//Client ended its stream with a final block, the next message starts a new one
+				inflateReset(stream);
+			}
+			else if((ret != Z_OK) && ((ret != Z_BUF_ERROR) || (stream->avail_in != 0)))
+			{
+				Fail(CLOSE_INVALID_DATA);
+				return false;
+			}
+		} while((stream->avail_in != 0) || (stream->avail_out == 0));
+	}
+	if(m_inflateBuffer.size() > m_maxMessageSize)
+	{
+		Fail(CLOSE_MESSAGE_TOO_BIG);
+		return false;
+	}
+	return true;
+}
+
+CWebSocketMessage::CWebSocketMessage(OPCODE opcode, const void* data, size_t size)
+    : m_opcode(opcode)
+{
+	assert(!IsControlOpcode(opcode) || (size <= 125));
+	auto frame = std::make_shared<std::vector<uint8>>(MAX_HEADER_SIZE + size);
+	m_headerSize = WriteFrameHeader(frame->data(), opcode, false, size);
+	if(size != 0)
+	{
+		memcpy(frame->data() + m_headerSize, data, size);
+	}
+	frame->resize(m_headerSize + size);
+	m_frame = std::move(frame);
+}
+
+OPCODE CWebSocketMessage::GetOpcode() const
+{
+	return m_opcode;
+}
+
+const CWebSocketMessage::FramePtr& CWebSocketMessage::GetFrame(bool deflate) const
+{
+	size_t payloadSize = m_frame->size() - m_headerSize;
+	if(!deflate || IsControlOpcode(m_opcode) || (payloadSize < MIN_DEFLATE_SIZE))
+	{
+		return m_frame;
+	}
+	std::call_once(m_deflateOnce, [&]() {
+		static thread_local CMessageDeflater deflater;
+		auto frame = std::make_shared<std::vector<uint8>>(MAX_HEADER_SIZE);
+		bool succeeded = deflater.Deflate(m_frame->data() + m_headerSize, payloadSize, *frame);
+		size_t deflatedSize = frame->size() - MAX_HEADER_SIZE;
+		//Incompressible messages are sent as they are
+		if(!succeeded || (deflatedSize >= payloadSize))
+		{
+			m_deflatedFrame = m_frame;
+			return;
+		}
+		//Header is written right before the payload
+		uint8 header[MAX_HEADER_SIZE];
+		size_t headerSize = WriteFrameHeader(header, m_opcode, true, deflatedSize);
+		frame->erase(frame->begin(), frame->begin() + (MAX_HEADER_SIZE - headerSize));
+		memcpy(frame->data(), header, headerSize);
+		m_deflatedFrame = std::move(frame);
+	});
+	return m_deflatedFrame;
+}
+
+CWebSocket::CWebSocket(MessageHandler messageHandler, CloseHandler closeHandler)
+    : m_messageHandler(std::move(messageHandler))
+    , m_closeHandler(std::move(closeHandler))
+{
+}
+
+bool CWebSocket::SendText(std::string_view text)
+{
+	return Send(std::make_shared<CWebSocketMessage>(OPCODE_TEXT, text.data(), text.size()));
+}
+
+bool CWebSocket::SendBinary(const void* data, size_t size)
+{
+	return Send(std::make_shared<CWebSocketMessage>(OPCODE_BINARY, data, size));
+}
+
+bool CWebSocket::Send(const WebSocketMessagePtr& message)
+{
+	//Compressed by the sending thread rather than the server's, once for all sockets it's sent to
+	if(IsDeflateEnabled())
+	{
+		message->GetFrame(true);
+	}
+	std::unique_lock<std::mutex> lock(m_mutex);
+	if(m_isClosing || m_isClosed) return false;
+	m_messages.push_back(message);
+	if(m_server && !m_isOutputQueued)
+	{
+		m_isOutputQueued = true;
+		m_server->QueueWebSocketOutput(shared_from_this());
+	}
+	return true;
+}
+
+void CWebSocket::Close(uint16 code)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	if(m_isClosing || m_isClosed) return;
+	m_isClosing = true;
+	uint8 payload[2] = {static_cast<uint8>(code >> 8), static_cast<uint8>(code)};
+	m_messages.push_back(std::make_shared<CWebSocketMessage>(OPCODE_CLOSE, payload, sizeof(payload)));
+	if(m_server && !m_isOutputQueued)
+	{
+		m_isOutputQueued = true;
+		m_server->QueueWebSocketOutput(shared_from_this());
+	}
+}
+
+bool CWebSocket::IsClosed() const
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	return m_isClosing || m_isClosed;
+}
+
+bool CWebSocket::IsDeflateEnabled() const
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	return m_isDeflateEnabled;
+}
+
+void CWebSocket::Attach(CHttpServer* server, SOCKET socket, bool isDeflateEnabled)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	assert(!m_server);
+	m_server = server;
+	m_socket = socket;
+	m_isDeflateEnabled = isDeflateEnabled;
+	if(!m_messages.empty() && !m_isOutputQueued)
+	{
+		m_isOutputQueued = true;
+		m_server->QueueWebSocketOutput(shared_from_this());
+	}
+}
+
+bool CWebSocket::Detach()
+{
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		if(m_isClosed) return false;
+		m_isClosed = true;
+		m_server = nullptr;
+		m_messages.clear();
+	}
+	if(m_closeHandler)
+	{
+		m_closeHandler(*this);
+	}
+	return true;
+}
+
+void CWebSocket::TakeMessages(MessageArray& messages)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_isOutputQueued = false;
+	std::swap(messages, m_messages);
+}
+
+void CWebSocket::HandleMessage(std::string_view data, bool isBinary)
+{
+	if(m_messageHandler)
+	{
+		m_messageHandler(*this, data, isBinary);
+	}
+}
+
+void CWebSocketGroup::Add(const WebSocketPtr& socket)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_sockets.push_back(socket);
+}
+
+void CWebSocketGroup::Remove(const WebSocketPtr& socket)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_sockets.erase(std::remove(m_sockets.begin(), m_sockets.end(), socket), m_sockets.end());
+}
+
+size_t CWebSocketGroup::GetCount() const
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	return m_sockets.size();
+}
+
+size_t CWebSocketGroup::Broadcast(const WebSocketMessagePtr& message)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	auto socketEnd = std::remove_if(m_sockets.begin(), m_sockets.end(),
+	                                [&](const WebSocketPtr& socket) { return !socket->Send(message); });
+	m_sockets.erase(socketEnd, m_sockets.end());
+	return m_sockets.size();
+}
+
+size_t CWebSocketGroup::BroadcastText(std::string_view text)
+{
+	return Broadcast(std::make_shared<CWebSocketMessage>(OPCODE_TEXT, text.data(), text.size()));
+}
+
+size_t CWebSocketGroup::BroadcastBinary(const void* data, size_t size)
+{
+	return Broadcast(std::make_shared<CWebSocketMessage>(OPCODE_BINARY, data, size));
+}
@@ -1,4 +1,7 @@
+#include <algorithm>
 #include <cassert>
+#include <limits>
+#include <memory>
 #include <vector>
 #include "http/Win32HttpClient.h"
 #include "win32/InternetHandle.h"
@@ -40,10 +43,17 @@ static SAFE_URL_COMPONENTS SafeInternetCrackUrl(const std::tstring& url)
 	return safeComponents;
 }
 
+//WinINet keeps connections alive (and TLS sessions cached) per session handle, all requests share one
+static HINTERNET GetInternetSession()
+{
+	static Framework::Win32::CInternetHandle session(InternetOpen(NULL, INTERNET_OPEN_TYPE_DIRECT, NULL, NULL, 0));
+	return session;
+}
+
 RequestResult CWin32HttpClient::SendRequest()
 {
-	auto inet = Framework::Win32::CInternetHandle(InternetOpen(NULL, INTERNET_OPEN_TYPE_DIRECT, NULL, NULL, 0));
-	if(inet.IsEmpty())
+	auto inet = GetInternetSession();
+	if(inet == NULL)
 	{
 		throw std::runtime_error("Failed to open internet.");
 	}
@@ -75,16 +85,20 @@ RequestResult CWin32HttpClient::SendRequest()
 		break;
 	}
 
-	DWORD openRequestFlags = (components.scheme == INTERNET_SCHEME_HTTPS) ? INTERNET_FLAG_SECURE : 0;
+	DWORD openRequestFlags = INTERNET_FLAG_KEEP_CONNECTION;
+	if(components.scheme == INTERNET_SCHEME_HTTPS)
+	{
+		openRequestFlags |= INTERNET_FLAG_SECURE;
+	}
 	auto request = Framework::Win32::CInternetHandle(HttpOpenRequest(connect, verbString, components.urlPath.c_str(), nullptr, nullptr, nullptr, openRequestFlags, 0));
 	assert(!request.IsEmpty());
 
 	//Add custom request headers
 	{
 		std::tstring headers;
-		for(auto headerPair : m_headers)
+		for(const auto& header : GetRequestHeaders(m_headers, IsRequestBodyCompressed()))
 		{
-			headers += string_cast<std::tstring>(headerPair.first) + _T(": ") + string_cast<std::tstring>(headerPair.second);
+			headers += string_cast<std::tstring>(std::string(header.name)) + _T(": ") + string_cast<std::tstring>(std::string(header.value));
 			headers += _T("\r\n");
 		}
 
@@ -95,12 +109,50 @@ RequestResult CWin32HttpClient::SendRequest()
 		}
 	}
 
-	auto optionalData = reinterpret_cast<LPVOID>(m_requestBody.data());
-	BOOL sendRequestResult = HttpSendRequest(request, nullptr, 0, optionalData, m_requestBody.size());
-	if(sendRequestResult == FALSE)
+	//Body is written in chunks, only a small buffer is needed whatever its size
 	{
-		DWORD lastError = GetLastError();
-		throw std::runtime_error(string_format("Failed to send request, error %d.", lastError));
+		std::unique_ptr<Framework::CPtrStream> bodyMemoryStream;
+		auto& bodyStream = GetRequestBodyStream(bodyMemoryStream);
+		uint64 bodySize = GetRequestBodySize();
+		if(bodySize > (std::numeric_limits<DWORD>::max)())
+		{
+			throw std::runtime_error("Request body is too large.");
+		}
+
+		INTERNET_BUFFERS buffers = {};
+		buffers.dwStructSize = sizeof(INTERNET_BUFFERS);
+		buffers.dwBufferTotal = static_cast<DWORD>(bodySize);
+		BOOL sendRequestResult = HttpSendRequestEx(request, &buffers, nullptr, 0, 0);
+		if(sendRequestResult == FALSE)
+		{
+			DWORD lastError = GetLastError();
+			throw std::runtime_error(string_format("Failed to send request, error %d.", lastError));
+		}
+
+		uint64 remainingSize = bodySize;
+		while(remainingSize != 0)
+		{
+			uint8 buff[0x10000];
+			auto chunkSize = static_cast<DWORD>(bodyStream.Read(buff, (std::min<uint64>)(remainingSize, sizeof(buff))));
+			if(chunkSize == 0)
+			{
+				throw std::runtime_error("Failed to read request body.");
+			}
+			DWORD written = 0;
+			BOOL writeResult = InternetWriteFile(request, buff, chunkSize, &written);
+			if((writeResult == FALSE) || (written != chunkSize))
+			{
+				throw std::runtime_error("Failed to write request body.");
+			}
+			remainingSize -= chunkSize;
+		}
+
+		BOOL endRequestResult = HttpEndRequest(request, nullptr, 0, 0);
+		if(endRequestResult == FALSE)
+		{
+			DWORD lastError = GetLastError();
+			throw std::runtime_error(string_format("Failed to send request, error %d.", lastError));
+		}
 	}
 
 	//Get HTTP status code
@@ -130,6 +182,8 @@ RequestResult CWin32HttpClient::SendRequest()
 		}
 	}
 
+	CResponseBodyWriter responseWriter(result, m_responseSink, IsContentDecodingEnabled());
+	responseWriter.SetContentEncoding(GetHeaderValue(result.headers, "Content-Encoding"));
 	while(1)
 	{
 		uint8 buff[0x10000];
@@ -143,8 +197,9 @@ RequestResult CWin32HttpClient::SendRequest()
 		{
 			break;
 		}
-		result.data.Write(buff, read);
+		responseWriter.Write(buff, read);
 	}
+	responseWriter.Finish();
 	result.data.Seek(0, Framework::STREAM_SEEK_SET);
 	return result;
 }
@@ -69,6 +69,14 @@ jint HttpURLConnection::getResponseCode()
 	return result;
 }
 
+void HttpURLConnection::setFixedLengthStreamingMode(jlong contentLength)
+{
+	auto env = Framework::CJavaVM::GetEnv();
+	const auto& classInfo = ClassInfo::GetInstance();
+	env->CallVoidMethod(m_this, classInfo.setFixedLengthStreamingMode, contentLength);
+	Framework::CJavaVM::CheckException(env);
+}
+
 void HttpURLConnection::setRequestMethod(jstring method)
 {
 	auto env = Framework::CJavaVM::GetEnv();
@@ -123,6 +131,10 @@ void HttpURLConnection_ClassInfo::PrepareClassInfo()
 	Framework::CJavaVM::CheckException(env);
 	assert(getResponseCode != NULL);
 	
+	setFixedLengthStreamingMode = env->GetMethodID(clazz, "setFixedLengthStreamingMode", "(J)V");
+	Framework::CJavaVM::CheckException(env);
+	assert(setFixedLengthStreamingMode != NULL);
+	
 	setRequestMethod = env->GetMethodID(clazz, "setRequestMethod", "(Ljava/lang/String;)V");
 	Framework::CJavaVM::CheckException(env);
 	assert(setRequestMethod != NULL);
@@ -0,0 +1,29 @@
+#include <cassert>
+#include "http/java_nio_Buffer.h"
+#include "android/JavaVM.h"
+
+using namespace java::nio;
+
+void Buffer::clear()
+{
+	auto env = Framework::CJavaVM::GetEnv();
+	const auto& classInfo = ClassInfo::GetInstance();
+	jobject result = env->CallObjectMethod(m_this, classInfo.clear);
+	Framework::CJavaVM::CheckException(env);
+	env->DeleteLocalRef(result);
+}
+
+void Buffer_ClassInfo::PrepareClassInfo()
+{
+	auto env = Framework::CJavaVM::GetEnv();
+	
+	jclass tmpClazz = env->FindClass("java/nio/Buffer");
+	Framework::CJavaVM::CheckException(env);
+	assert(tmpClazz != NULL);
+	clazz = reinterpret_cast<jclass>(env->NewGlobalRef(tmpClazz));
+	assert(clazz != NULL);
+	
+	clear = env->GetMethodID(clazz, "clear", "()Ljava/nio/Buffer;");
+	Framework::CJavaVM::CheckException(env);
+	assert(clear != NULL);
+}
@@ -0,0 +1,30 @@
+#include <cassert>
+#include "http/java_nio_channels_Channels.h"
+#include "android/JavaVM.h"
+
+using namespace java::nio::channels;
+
+jobject Channels::newChannel(jobject in)
+{
+	auto env = Framework::CJavaVM::GetEnv();
+	const auto& classInfo = ClassInfo::GetInstance();
+	jobject result = env->CallStaticObjectMethod(classInfo.clazz, classInfo.newChannel, in);
+	Framework::CJavaVM::CheckException(env);
+	assert(result != NULL);
+	return result;
+}
+
+void Channels_ClassInfo::PrepareClassInfo()
+{
+	auto env = Framework::CJavaVM::GetEnv();
+	
+	jclass tmpClazz = env->FindClass("java/nio/channels/Channels");
+	Framework::CJavaVM::CheckException(env);
+	assert(tmpClazz != NULL);
+	clazz = reinterpret_cast<jclass>(env->NewGlobalRef(tmpClazz));
+	assert(clazz != NULL);
+	
+	newChannel = env->GetStaticMethodID(clazz, "newChannel", "(Ljava/io/InputStream;)Ljava/nio/channels/ReadableByteChannel;");
+	Framework::CJavaVM::CheckException(env);
+	assert(newChannel != NULL);
+}
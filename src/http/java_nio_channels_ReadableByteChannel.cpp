@@ -0,0 +1,41 @@
+#include <cassert>
+#include "http/java_nio_channels_ReadableByteChannel.h"
+#include "android/JavaVM.h"
+
+using namespace java::nio::channels;
+
+jint ReadableByteChannel::read(jobject dst)
+{
+	auto env = Framework::CJavaVM::GetEnv();
+	const auto& classInfo = ClassInfo::GetInstance();
+	jint result = env->CallIntMethod(m_this, classInfo.read, dst);
+	Framework::CJavaVM::CheckException(env);
+	return result;
+}
+
+void ReadableByteChannel::close()
+{
+	auto env = Framework::CJavaVM::GetEnv();
+	const auto& classInfo = ClassInfo::GetInstance();
+	env->CallVoidMethod(m_this, classInfo.close);
+	Framework::CJavaVM::CheckException(env);
+}
+
+void ReadableByteChannel_ClassInfo::PrepareClassInfo()
+{
+	auto env = Framework::CJavaVM::GetEnv();
+	
+	jclass tmpClazz = env->FindClass("java/nio/channels/ReadableByteChannel");
+	Framework::CJavaVM::CheckException(env);
+	assert(tmpClazz != NULL);
+	clazz = reinterpret_cast<jclass>(env->NewGlobalRef(tmpClazz));
+	assert(clazz != NULL);
+	
+	read = env->GetMethodID(clazz, "read", "(Ljava/nio/ByteBuffer;)I");
+	Framework::CJavaVM::CheckException(env);
+	assert(read != NULL);
+	
+	close = env->GetMethodID(clazz, "close", "()V");
+	Framework::CJavaVM::CheckException(env);
+	assert(close != NULL);
+}
@@ -0,0 +1,551 @@
+#include <algorithm>
+#include <cstdint>
+#include "idct/FixedPoint.h"
+#include "SimdDefs.h"
+#include "CpuFeatures.h"
+
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+#include <emmintrin.h>
+#if defined(FRAMEWORK_SIMD_HAS_X86_DISPATCH)
+#include <immintrin.h>
+#endif
+#elif defined(FRAMEWORK_SIMD_USE_NEON)
+#include <arm_neon.h>
+#endif
+
+using namespace IDCT;
+
+//g_coefs[x][u] = round(c(u) * cos((2 * x + 1) * u * PI / 16) * 2^COEF_BITS)
+//with c(0) = sqrt(1 / 8) and c(u) = 1 / 2 otherwise
+const int16 CFixedPoint::g_coefs[8][8] =
+{
+	{ 5793,  8035,  7568,  6811,  5793,  4551,  3135,  1598 },
+	{ 5793,  6811,  3135, -1598, -5793, -8035, -7568, -4551 },
+	{ 5793,  4551, -3135, -8035, -5793,  1598,  7568,  6811 },
+	{ 5793,  1598, -7568, -4551,  5793,  6811, -3135, -8035 },
+	{ 5793, -1598, -7568,  4551,  5793, -6811, -3135,  8035 },
+	{ 5793, -4551, -3135,  8035, -5793, -1598,  7568, -6811 },
+	{ 5793, -6811,  3135,  1598, -5793,  8035, -7568,  4551 },
+	{ 5793, -8035,  7568, -6811,  5793, -4551,  3135, -1598 },
+};
+
+namespace
+{
+	int16 Saturate16(int32 value)
+	{
+		return static_cast<int16>(std::min<int32>(std::max<int32>(value, INT16_MIN), INT16_MAX));
+	}
+
+	//Gives the same result as the full transform when all AC coefficients are 0
+	void TransformDcOnly(int16 dc, int16* output)
+	{
+		const int32 coef = CFixedPoint::g_coefs[0][0];
+		const int pass1Shift = CFixedPoint::COEF_BITS - CFixedPoint::PASS1_BITS;
+		const int pass2Shift = CFixedPoint::COEF_BITS + CFixedPoint::PASS1_BITS;
+		int32 temp = Saturate16(((coef * dc) + (1 << (pass1Shift - 1))) >> pass1Shift);
+		int16 value = Saturate16(((coef * temp) + (1 << (pass2Shift - 1))) >> pass2Shift);
+		std::fill(output, output + 64, value);
+	}
+
+	void TransformBlock(const int16*, int16*);
+	void ForwardTransformBlock(const int16*, int16*);
+
+	void TransformBlocksGeneric(const int16* input, int16* output, size_t count)
+	{
+		for(size_t i = 0; i < count; i++)
+		{
+			TransformBlock(input + (i * 64), output + (i * 64));
+		}
+	}
+
+#if defined(FRAMEWORK_SIMD_HAS_X86_DISPATCH)
+	void TransformBlocksAvx2(const int16*, int16*, size_t);
+#endif
+}
+
+CFixedPoint::CFixedPoint()
+{
+	Framework::CKernelDispatcher<TransformBlocksFunction> dispatcher(&TransformBlocksGeneric);
+#if defined(FRAMEWORK_SIMD_HAS_X86_DISPATCH)
+	dispatcher.Register(Framework::CCpuFeatures::FEATURE_AVX2, &TransformBlocksAvx2);
+#endif
+	m_transformBlocks = dispatcher.Get();
+}
+
+CInterface* CFixedPoint::GetInstance()
+{
+	static CFixedPoint instance;
+	return &instance;
+}
+
+void CFixedPoint::Transform(const int16* input, int16* output)
+{
+	TransformBlock(input, output);
+}
+
+void CFixedPoint::TransformBlocks(const int16* input, int16* output, size_t count)
+{
+	m_transformBlocks(input, output, count);
+}
+
+void CFixedPoint::ForwardTransform(const int16* input, int16* output)
+{
+	ForwardTransformBlock(input, output);
+}
+
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+
+namespace
+{
+	struct COEFPAIRS
+	{
+		//pairs[x][k] holds (g_coefs[x][2 * k], g_coefs[x][2 * k + 1]) replicated 4 times
+		//(coefficients are transposed for the forward transform)
+		__m128i pairs[8][4];
+
+		COEFPAIRS(bool forward)
+		{
+			for(unsigned int x = 0; x < 8; x++)
+			{
+				for(unsigned int k = 0; k < 4; k++)
+				{
+					int16 coef0 = forward ? CFixedPoint::g_coefs[2 * k][x] : CFixedPoint::g_coefs[x][2 * k];
+					int16 coef1 = forward ? CFixedPoint::g_coefs[2 * k + 1][x] : CFixedPoint::g_coefs[x][2 * k + 1];
+					uint32 pair = static_cast<uint16>(coef0) | (static_cast<uint32>(static_cast<uint16>(coef1)) << 16);
+					pairs[x][k] = _mm_set1_epi32(pair);
+				}
+			}
+		}
+	};
+
+	const COEFPAIRS g_coefPairs(false);
+	const COEFPAIRS g_forwardCoefPairs(true);
+
+	bool IsZero(__m128i value)
+	{
+		return _mm_movemask_epi8(_mm_cmpeq_epi8(value, _mm_setzero_si128())) == 0xFFFF;
+	}
+
+	void Transpose(__m128i* rows)
+	{
+		__m128i a0 = _mm_unpacklo_epi16(rows[0], rows[1]);
+		__m128i a1 = _mm_unpackhi_epi16(rows[0], rows[1]);
+		__m128i a2 = _mm_unpacklo_epi16(rows[2], rows[3]);
+		__m128i a3 = _mm_unpackhi_epi16(rows[2], rows[3]);
+		__m128i a4 = _mm_unpacklo_epi16(rows[4], rows[5]);
+		__m128i a5 = _mm_unpackhi_epi16(rows[4], rows[5]);
+		__m128i a6 = _mm_unpacklo_epi16(rows[6], rows[7]);
+		__m128i a7 = _mm_unpackhi_epi16(rows[6], rows[7]);
+
+		__m128i b0 = _mm_unpacklo_epi32(a0, a2);
+		__m128i b1 = _mm_unpackhi_epi32(a0, a2);
+		__m128i b2 = _mm_unpacklo_epi32(a1, a3);
+		__m128i b3 = _mm_unpackhi_epi32(a1, a3);
+		__m128i b4 = _mm_unpacklo_epi32(a4, a6);
+		__m128i b5 = _mm_unpackhi_epi32(a4, a6);
+		__m128i b6 = _mm_unpacklo_epi32(a5, a7);
+		__m128i b7 = _mm_unpackhi_epi32(a5, a7);
+
+		rows[0] = _mm_unpacklo_epi64(b0, b4);
+		rows[1] = _mm_unpackhi_epi64(b0, b4);
+		rows[2] = _mm_unpacklo_epi64(b1, b5);
+		rows[3] = _mm_unpackhi_epi64(b1, b5);
+		rows[4] = _mm_unpacklo_epi64(b2, b6);
+		rows[5] = _mm_unpackhi_epi64(b2, b6);
+		rows[6] = _mm_unpacklo_epi64(b3, b7);
+		rows[7] = _mm_unpackhi_epi64(b3, b7);
+	}
+
+	//1D IDCT of 8 columns at once, row u of 'rows' holds frequency u of every column.
+	//Only the first 'pairCount * 2' frequencies are considered, others must be 0.
+	template <int shift, unsigned int pairCount>
+	void TransformColumns(__m128i* rows, const COEFPAIRS& coefPairs = g_coefPairs)
+	{
+		const __m128i rounding = _mm_set1_epi32(1 << (shift - 1));
+		__m128i lo[pairCount], hi[pairCount];
+		for(unsigned int k = 0; k < pairCount; k++)
+		{
+			lo[k] = _mm_unpacklo_epi16(rows[2 * k], rows[2 * k + 1]);
+			hi[k] = _mm_unpackhi_epi16(rows[2 * k], rows[2 * k + 1]);
+		}
+		for(unsigned int x = 0; x < 8; x++)
+		{
+			const auto& pairs = coefPairs.pairs[x];
+			__m128i sumLo = rounding;
+			__m128i sumHi = rounding;
+			for(unsigned int k = 0; k < pairCount; k++)
+			{
+				sumLo = _mm_add_epi32(sumLo, _mm_madd_epi16(lo[k], pairs[k]));
+				sumHi = _mm_add_epi32(sumHi, _mm_madd_epi16(hi[k], pairs[k]));
+			}
+			sumLo = _mm_srai_epi32(sumLo, shift);
+			sumHi = _mm_srai_epi32(sumHi, shift);
+			rows[x] = _mm_packs_epi32(sumLo, sumHi);
+		}
+	}
+
+	void TransformBlock(const int16* input, int16* output)
+	{
+		__m128i rows[8];
+		for(unsigned int i = 0; i < 8; i++)
+		{
+			rows[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + (i * 8)));
+		}
+
+		__m128i lowRows = _mm_or_si128(_mm_or_si128(rows[0], rows[1]), _mm_or_si128(rows[2], rows[3]));
+		__m128i highRows = _mm_or_si128(_mm_or_si128(rows[4], rows[5]), _mm_or_si128(rows[6], rows[7]));
+		if(IsZero(highRows) && IsZero(_mm_srli_si128(lowRows, 8)))
+		{
+			__m128i acRows = _mm_or_si128(_mm_srli_si128(rows[0], 2), _mm_or_si128(rows[1], _mm_or_si128(rows[2], rows[3])));
+			if(IsZero(acRows))
+			{
+				TransformDcOnly(input[0], output);
+				return;
+			}
+			//Only the top-left 4x4 coefficients are used, which also leaves the
+			//bottom half of the intermediate result empty
+			Transpose(rows);
+			TransformColumns<CFixedPoint::COEF_BITS - CFixedPoint::PASS1_BITS, 2>(rows);
+			Transpose(rows);
+			TransformColumns<CFixedPoint::COEF_BITS + CFixedPoint::PASS1_BITS, 2>(rows);
+		}
+		else
+		{
+			//Horizontal pass, then vertical pass
+			Transpose(rows);
+			TransformColumns<CFixedPoint::COEF_BITS - CFixedPoint::PASS1_BITS, 4>(rows);
+			Transpose(rows);
+			TransformColumns<CFixedPoint::COEF_BITS + CFixedPoint::PASS1_BITS, 4>(rows);
+		}
+
+		for(unsigned int i = 0; i < 8; i++)
+		{
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(output + (i * 8)), rows[i]);
+		}
+	}
+
+	void ForwardTransformBlock(const int16* input, int16* output)
+	{
+		__m128i rows[8];
+		for(unsigned int i = 0; i < 8; i++)
+		{
+			rows[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + (i * 8)));
+		}
+
+		Transpose(rows);
+		TransformColumns<CFixedPoint::COEF_BITS - CFixedPoint::PASS1_BITS, 4>(rows, g_forwardCoefPairs);
+		Transpose(rows);
+		TransformColumns<CFixedPoint::COEF_BITS + CFixedPoint::PASS1_BITS, 4>(rows, g_forwardCoefPairs);
+
+		for(unsigned int i = 0; i < 8; i++)
+		{
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(output + (i * 8)), rows[i]);
+		}
+	}
+
+#if defined(FRAMEWORK_SIMD_HAS_X86_DISPATCH)
+
+	//AVX2 versions work on 2 blocks at once, one in each 128-bit lane
+	FRAMEWORK_SIMD_TARGET_AVX2 void Transpose(__m256i* rows)
+	{
+		__m256i a0 = _mm256_unpacklo_epi16(rows[0], rows[1]);
+		__m256i a1 = _mm256_unpackhi_epi16(rows[0], rows[1]);
+		__m256i a2 = _mm256_unpacklo_epi16(rows[2], rows[3]);
+		__m256i a3 = _mm256_unpackhi_epi16(rows[2], rows[3]);
+		__m256i a4 = _mm256_unpacklo_epi16(rows[4], rows[5]);
+		__m256i a5 = _mm256_unpackhi_epi16(rows[4], rows[5]);
+		__m256i a6 = _mm256_unpacklo_epi16(rows[6], rows[7]);
+		__m256i a7 = _mm256_unpackhi_epi16(rows[6], rows[7]);
+
+		__m256i b0 = _mm256_unpacklo_epi32(a0, a2);
+		__m256i b1 = _mm256_unpackhi_epi32(a0, a2);
+		__m256i b2 = _mm256_unpacklo_epi32(a1, a3);
+		__m256i b3 = _mm256_unpackhi_epi32(a1, a3);
+		__m256i b4 = _mm256_unpacklo_epi32(a4, a6);
+		__m256i b5 = _mm256_unpackhi_epi32(a4, a6);
+		__m256i b6 = _mm256_unpacklo_epi32(a5, a7);
+		__m256i b7 = _mm256_unpackhi_epi32(a5, a7);
+
+		rows[0] = _mm256_unpacklo_epi64(b0, b4);
+		rows[1] = _mm256_unpackhi_epi64(b0, b4);
+		rows[2] = _mm256_unpacklo_epi64(b1, b5);
+		rows[3] = _mm256_unpackhi_epi64(b1, b5);
+		rows[4] = _mm256_unpacklo_epi64(b2, b6);
+		rows[5] = _mm256_unpackhi_epi64(b2, b6);
+		rows[6] = _mm256_unpacklo_epi64(b3, b7);
+		rows[7] = _mm256_unpackhi_epi64(b3, b7);
+	}
+
+	template <int shift>
+	FRAMEWORK_SIMD_TARGET_AVX2 void TransformColumns(__m256i* rows)
+	{
+		const __m256i rounding = _mm256_set1_epi32(1 << (shift - 1));
+		__m256i lo[4], hi[4];
+		for(unsigned int k = 0; k < 4; k++)
+		{
+			lo[k] = _mm256_unpacklo_epi16(rows[2 * k], rows[2 * k + 1]);
+			hi[k] = _mm256_unpackhi_epi16(rows[2 * k], rows[2 * k + 1]);
+		}
+		for(unsigned int x = 0; x < 8; x++)
+		{
+			__m256i sumLo = rounding;
+			__m256i sumHi = rounding;
+			for(unsigned int k = 0; k < 4; k++)
+			{
+				__m256i pairs = _mm256_broadcastsi128_si256(g_coefPairs.pairs[x][k]);
+				sumLo = _mm256_add_epi32(sumLo, _mm256_madd_epi16(lo[k], pairs));
+				sumHi = _mm256_add_epi32(sumHi, _mm256_madd_epi16(hi[k], pairs));
+			}
+			sumLo = _mm256_srai_epi32(sumLo, shift);
+			sumHi = _mm256_srai_epi32(sumHi, shift);
+			rows[x] = _mm256_packs_epi32(sumLo, sumHi);
+		}
+	}
+
+	bool IsSparseBlock(const int16* input)
+	{
+		__m128i rows = _mm_setzero_si128();
+		for(unsigned int i = 0; i < 8; i++)
+		{
+			__m128i row = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + (i * 8)));
+			rows = _mm_or_si128(rows, (i < 4) ? _mm_srli_si128(row, 8) : row);
+		}
+		return IsZero(rows);
+	}
+
+	FRAMEWORK_SIMD_TARGET_AVX2 void TransformBlocksAvx2(const int16* input, int16* output, size_t count)
+	{
+		size_t i = 0;
+		for(; (i + 2) <= count; i += 2)
+		{
+			const int16* input0 = input + (i * 64);
+			const int16* input1 = input0 + 64;
+			int16* output0 = output + (i * 64);
+			int16* output1 = output0 + 64;
+			//Sparse blocks are faster to handle one at a time
+			if(IsSparseBlock(input0) || IsSparseBlock(input1))
+			{
+				TransformBlock(input0, output0);
+				TransformBlock(input1, output1);
+				continue;
+			}
+			__m256i rows[8];
+			for(unsigned int j = 0; j < 8; j++)
+			{
+				__m128i row0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input0 + (j * 8)));
+				__m128i row1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input1 + (j * 8)));
+				rows[j] = _mm256_inserti128_si256(_mm256_castsi128_si256(row0), row1, 1);
+			}
+			Transpose(rows);
+			TransformColumns<CFixedPoint::COEF_BITS - CFixedPoint::PASS1_BITS>(rows);
+			Transpose(rows);
+			TransformColumns<CFixedPoint::COEF_BITS + CFixedPoint::PASS1_BITS>(rows);
+			for(unsigned int j = 0; j < 8; j++)
+			{
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(output0 + (j * 8)), _mm256_castsi256_si128(rows[j]));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(output1 + (j * 8)), _mm256_extracti128_si256(rows[j], 1));
+			}
+		}
+		for(; i < count; i++)
+		{
+			TransformBlock(input + (i * 64), output + (i * 64));
+		}
+	}
+
+#endif
+}
+
+#elif defined(FRAMEWORK_SIMD_USE_NEON)
+
+namespace
+{
+	bool IsZero(int16x8_t value)
+	{
+		uint64x2_t bits = vreinterpretq_u64_s16(value);
+		return (vgetq_lane_u64(bits, 0) | vgetq_lane_u64(bits, 1)) == 0;
+	}
+
+	void Transpose(int16x8_t* rows)
+	{
+		int16x8x2_t t01 = vtrnq_s16(rows[0], rows[1]);
+		int16x8x2_t t23 = vtrnq_s16(rows[2], rows[3]);
+		int16x8x2_t t45 = vtrnq_s16(rows[4], rows[5]);
+		int16x8x2_t t67 = vtrnq_s16(rows[6], rows[7]);
+
+		int32x4x2_t x02 = vtrnq_s32(vreinterpretq_s32_s16(t01.val[0]), vreinterpretq_s32_s16(t23.val[0]));
+		int32x4x2_t x13 = vtrnq_s32(vreinterpretq_s32_s16(t01.val[1]), vreinterpretq_s32_s16(t23.val[1]));
+		int32x4x2_t x46 = vtrnq_s32(vreinterpretq_s32_s16(t45.val[0]), vreinterpretq_s32_s16(t67.val[0]));
+		int32x4x2_t x57 = vtrnq_s32(vreinterpretq_s32_s16(t45.val[1]), vreinterpretq_s32_s16(t67.val[1]));
+
+		rows[0] = vreinterpretq_s16_s32(vcombine_s32(vget_low_s32(x02.val[0]), vget_low_s32(x46.val[0])));
+		rows[1] = vreinterpretq_s16_s32(vcombine_s32(vget_low_s32(x13.val[0]), vget_low_s32(x57.val[0])));
+		rows[2] = vreinterpretq_s16_s32(vcombine_s32(vget_low_s32(x02.val[1]), vget_low_s32(x46.val[1])));
+		rows[3] = vreinterpretq_s16_s32(vcombine_s32(vget_low_s32(x13.val[1]), vget_low_s32(x57.val[1])));
+		rows[4] = vreinterpretq_s16_s32(vcombine_s32(vget_high_s32(x02.val[0]), vget_high_s32(x46.val[0])));
+		rows[5] = vreinterpretq_s16_s32(vcombine_s32(vget_high_s32(x13.val[0]), vget_high_s32(x57.val[0])));
+		rows[6] = vreinterpretq_s16_s32(vcombine_s32(vget_high_s32(x02.val[1]), vget_high_s32(x46.val[1])));
+		rows[7] = vreinterpretq_s16_s32(vcombine_s32(vget_high_s32(x13.val[1]), vget_high_s32(x57.val[1])));
+	}
+
+	//1D IDCT of 8 columns at once, row u of 'rows' holds frequency u of every column.
+	//Only the first 'freqCount' frequencies are considered, others must be 0.
+	//Forward transform uses the transposed coefficients.
+	template <int shift, unsigned int freqCount, bool forward = false>
+	void TransformColumns(int16x8_t* rows)
+	{
+		int16x8_t src[freqCount];
+		for(unsigned int u = 0; u < freqCount; u++)
+		{
+			src[u] = rows[u];
+		}
+		for(unsigned int x = 0; x < 8; x++)
+		{
+			auto coef = [x] (unsigned int u) { return forward ? CFixedPoint::g_coefs[u][x] : CFixedPoint::g_coefs[x][u]; };
+			int32x4_t sumLo = vmull_n_s16(vget_low_s16(src[0]), coef(0));
+			int32x4_t sumHi = vmull_n_s16(vget_high_s16(src[0]), coef(0));
+			for(unsigned int u = 1; u < freqCount; u++)
+			{
+				sumLo = vmlal_n_s16(sumLo, vget_low_s16(src[u]), coef(u));
+				sumHi = vmlal_n_s16(sumHi, vget_high_s16(src[u]), coef(u));
+			}
+			rows[x] = vcombine_s16(vqmovn_s32(vrshrq_n_s32(sumLo, shift)), vqmovn_s32(vrshrq_n_s32(sumHi, shift)));
+		}
+	}
+
+	void TransformBlock(const int16* input, int16* output)
+	{
+		int16x8_t rows[8];
+		for(unsigned int i = 0; i < 8; i++)
+		{
+			rows[i] = vld1q_s16(input + (i * 8));
+		}
+
+		int16x8_t lowRows = vorrq_s16(vorrq_s16(rows[0], rows[1]), vorrq_s16(rows[2], rows[3]));
+		int16x8_t highRows = vorrq_s16(vorrq_s16(rows[4], rows[5]), vorrq_s16(rows[6], rows[7]));
+		if(IsZero(highRows) && IsZero(vcombine_s16(vget_high_s16(lowRows), vdup_n_s16(0))))
+		{
+			int16x8_t acRows = vorrq_s16(vsetq_lane_s16(0, rows[0], 0), vorrq_s16(rows[1], vorrq_s16(rows[2], rows[3])));
+			if(IsZero(acRows))
+			{
+				TransformDcOnly(input[0], output);
+				return;
+			}
+			//Only the top-left 4x4 coefficients are used, which also leaves the
+			//bottom half of the intermediate result empty
+			Transpose(rows);
+			TransformColumns<CFixedPoint::COEF_BITS - CFixedPoint::PASS1_BITS, 4>(rows);
+			Transpose(rows);
+			TransformColumns<CFixedPoint::COEF_BITS + CFixedPoint::PASS1_BITS, 4>(rows);
+		}
+		else
+		{
+			//Horizontal pass, then vertical pass
+			Transpose(rows);
+			TransformColumns<CFixedPoint::COEF_BITS - CFixedPoint::PASS1_BITS, 8>(rows);
+			Transpose(rows);
+			TransformColumns<CFixedPoint::COEF_BITS + CFixedPoint::PASS1_BITS, 8>(rows);
+		}
+
+		for(unsigned int i = 0; i < 8; i++)
+		{
+			vst1q_s16(output + (i * 8), rows[i]);
+		}
+	}
+
+	void ForwardTransformBlock(const int16* input, int16* output)
+	{
+		int16x8_t rows[8];
+		for(unsigned int i = 0; i < 8; i++)
+		{
+			rows[i] = vld1q_s16(input + (i * 8));
+		}
+
+		Transpose(rows);
+		TransformColumns<CFixedPoint::COEF_BITS - CFixedPoint::PASS1_BITS, 8, true>(rows);
+		Transpose(rows);
+		TransformColumns<CFixedPoint::COEF_BITS + CFixedPoint::PASS1_BITS, 8, true>(rows);
+
+		for(unsigned int i = 0; i < 8; i++)
+		{
+			vst1q_s16(output + (i * 8), rows[i]);
+		}
+	}
+}
+
+#else
+
+namespace
+{
+	//Same arithmetic as the SIMD versions, results are bit exact
+	template <int shift, bool forward = false>
+	int16 TransformValue(const int16* input, unsigned int stride, unsigned int freqCount, unsigned int x)
+	{
+		int32 sum = 1 << (shift - 1);
+		for(unsigned int u = 0; u < freqCount; u++)
+		{
+			int16 coef = forward ? CFixedPoint::g_coefs[u][x] : CFixedPoint::g_coefs[x][u];
+			sum += static_cast<int32>(coef) * input[u * stride];
+		}
+		return Saturate16(sum >> shift);
+	}
+
+	void ForwardTransformBlock(const int16* input, int16* output)
+	{
+		int16 temp[64];
+		for(unsigned int y = 0; y < 8; y++)
+		{
+			for(unsigned int u = 0; u < 8; u++)
+			{
+				temp[(y * 8) + u] = TransformValue<CFixedPoint::COEF_BITS - CFixedPoint::PASS1_BITS, true>(input + (y * 8), 1, 8, u);
+			}
+		}
+		for(unsigned int u = 0; u < 8; u++)
+		{
+			for(unsigned int v = 0; v < 8; v++)
+			{
+				output[(v * 8) + u] = TransformValue<CFixedPoint::COEF_BITS + CFixedPoint::PASS1_BITS, true>(temp + u, 8, 8, v);
+			}
+		}
+	}
+
+	void TransformBlock(const int16* input, int16* output)
+	{
+		bool isDcOnly = true;
+		bool isLowFrequency = true;
+		for(unsigned int i = 1; i < 64; i++)
+		{
+			if(input[i] == 0) continue;
+			isDcOnly = false;
+			if(((i % 8) >= 4) || (i >= 32))
+			{
+				isLowFrequency = false;
+				break;
+			}
+		}
+		if(isDcOnly)
+		{
+			TransformDcOnly(input[0], output);
+			return;
+		}
+
+		//Horizontal pass, then vertical pass
+		unsigned int freqCount = isLowFrequency ? 4 : 8;
+		int16 temp[64] = {};
+		for(unsigned int y = 0; y < freqCount; y++)
+		{
+			for(unsigned int x = 0; x < 8; x++)
+			{
+				temp[(y * 8) + x] = TransformValue<CFixedPoint::COEF_BITS - CFixedPoint::PASS1_BITS>(input + (y * 8), 1, freqCount, x);
+			}
+		}
+		for(unsigned int x = 0; x < 8; x++)
+		{
+			for(unsigned int y = 0; y < 8; y++)
+			{
+				output[(y * 8) + x] = TransformValue<CFixedPoint::COEF_BITS + CFixedPoint::PASS1_BITS>(temp + x, 8, freqCount, y);
+			}
+		}
+	}
+}
+
+#endif
@@ -2,6 +2,8 @@
 /* Copyright (C) 1996, MPEG Software Simulation Group. All Rights Reserved. */
 
 #include <math.h>
+#include <stdlib.h>
+#include <algorithm>
 #include "PtrMacro.h"
 #include "idct/IEEE1180.h"
 
@@ -52,6 +54,103 @@ void CIEEE1180::PrepareTable()
 	}
 }
 
+void CIEEE1180::ForwardTransform(const int16* pXY, int16* pUV)
+{
+	double tmp[64];
+
+	for(unsigned int i = 0; i < 8; i++)
+	{
+		for(unsigned int j = 0; j < 8; j++)
+		{
+			double partial_product = 0.0;
+			for(unsigned int k = 0; k < 8; k++)
+			{
+				partial_product += m_nC[j][k] * pXY[8 * i + k];
+			}
+			tmp[8 * i + j] = partial_product;
+		}
+	}
+
+	for(unsigned int j = 0; j < 8; j++)
+	{
+		for(unsigned int i = 0; i < 8; i++)
+		{
+			double partial_product = 0.0;
+			for(unsigned int k = 0; k < 8; k++)
+			{
+				partial_product += m_nC[i][k] * tmp[8 * k + j];
+			}
+			int v = (int)floor(partial_product + 0.5);
+			pUV[8 * i + j] = (v < -2048) ? -2048 : ((v > 2047) ? 2047 : v);
+		}
+	}
+}
+
+bool CIEEE1180::ACCURACY_STATS::IsCompliant() const
+{
+	return
+		(peakError <= 1) &&
+		(peakMse <= 0.06) &&
+		(overallMse <= 0.02) &&
+		(peakMeanError <= 0.015) &&
+		(fabs(overallMeanError) <= 0.0015);
+}
+
+CIEEE1180::ACCURACY_STATS CIEEE1180::MeasureAccuracy(CInterface* idct, int lowerBound, int upperBound, bool negate, unsigned int blockCount)
+{
+	//Random number generator from the IEEE-1180 specification (assumes a 32-bit long)
+	uint32 randx = 1;
+	auto ieeeRand =
+		[&randx] (long L, long H)
+		{
+			static const double z = (double)0x7fffffff;
+			randx = (randx * 1103515245) + 12345;
+			long i = static_cast<long>(randx & 0x7ffffffe);
+			double x = ((double)i) / z;
+			x *= (L + H + 1);
+			long j = (long)x;
+			return j - L;
+		};
+
+	auto clampPixel = [] (int value) { return (value < -256) ? -256 : ((value > 255) ? 255 : value); };
+
+	auto reference = static_cast<CIEEE1180*>(GetInstance());
+	double errorSum[64] = {};
+	double squaredErrorSum[64] = {};
+	ACCURACY_STATS stats;
+
+	for(unsigned int n = 0; n < blockCount; n++)
+	{
+		int16 block[64], coefs[64], refResult[64], testResult[64];
+		for(unsigned int i = 0; i < 64; i++)
+		{
+			long value = ieeeRand(lowerBound, upperBound);
+			block[i] = static_cast<int16>(negate ? -value : value);
+		}
+		reference->ForwardTransform(block, coefs);
+		reference->Transform(coefs, refResult);
+		idct->Transform(coefs, testResult);
+		for(unsigned int i = 0; i < 64; i++)
+		{
+			int error = clampPixel(testResult[i]) - clampPixel(refResult[i]);
+			stats.peakError = std::max(stats.peakError, abs(error));
+			errorSum[i] += error;
+			squaredErrorSum[i] += error * error;
+		}
+	}
+
+	for(unsigned int i = 0; i < 64; i++)
+	{
+		stats.peakMse = std::max(stats.peakMse, squaredErrorSum[i] / blockCount);
+		stats.peakMeanError = std::max(stats.peakMeanError, fabs(errorSum[i]) / blockCount);
+		stats.overallMse += squaredErrorSum[i];
+		stats.overallMeanError += errorSum[i];
+	}
+	stats.overallMse /= (64.0 * blockCount);
+	stats.overallMeanError /= (64.0 * blockCount);
+	return stats;
+}
+
 void CIEEE1180::Transform(const int16* pUV, int16* pXY)
 {
 	int i, j, k, v;
@@ -0,0 +1,144 @@
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include "idct/Reduced.h"
+#include "idct/FixedPoint.h"
+
+using namespace IDCT;
+
+//g_coefsN[x][u] = round(c(u) * cos((2 * x + 1) * u * PI / (2 * N)) * 2^COEF_BITS)
+//with c(0) = sqrt(1 / 8) and c(u) = 1 / 2 otherwise (same scaling as the 8x8 transform)
+const int16 CReduced::g_coefs1[1][1] =
+{
+	{ 5793 },
+};
+
+const int16 CReduced::g_coefs2[2][2] =
+{
+	{ 5793,  5793 },
+	{ 5793, -5793 },
+};
+
+const int16 CReduced::g_coefs4[4][4] =
+{
+	{ 5793,  7568,  5793,  3135 },
+	{ 5793,  3135, -5793, -7568 },
+	{ 5793, -3135, -5793,  7568 },
+	{ 5793, -7568,  5793, -3135 },
+};
+
+static_assert(static_cast<int>(CReduced::COEF_BITS) == static_cast<int>(CFixedPoint::COEF_BITS), "Coefficient tables must have the same scale");
+
+namespace
+{
+	int16 Saturate16(int32 value)
+	{
+		return static_cast<int16>(std::min<int32>(std::max<int32>(value, INT16_MIN), INT16_MAX));
+	}
+
+	//Coefficient table for a transform of the given size, rows are 'size' entries long
+	const int16* GetCoefs(unsigned int size)
+	{
+		switch(size)
+		{
+		case 1:
+			return &CReduced::g_coefs1[0][0];
+		case 2:
+			return &CReduced::g_coefs2[0][0];
+		case 4:
+			return &CReduced::g_coefs4[0][0];
+		default:
+			assert(size == 8);
+			return &CFixedPoint::g_coefs[0][0];
+		}
+	}
+
+	template <unsigned int width, unsigned int height>
+	void TransformReduced(const int16* input, int16* output)
+	{
+		const int pass1Shift = CReduced::COEF_BITS - CReduced::PASS1_BITS;
+		const int pass2Shift = CReduced::COEF_BITS + CReduced::PASS1_BITS;
+		const int16* colCoefs = GetCoefs(height);
+		const int16* rowCoefs = GetCoefs(width);
+		int16 temp[width * height];
+
+		//Columns
+		for(unsigned int u = 0; u < width; u++)
+		{
+			for(unsigned int y = 0; y < height; y++)
+			{
+				int32 sum = 0;
+				for(unsigned int v = 0; v < height; v++)
+				{
+					sum += colCoefs[(y * height) + v] * input[(v * width) + u];
+				}
+				temp[(y * width) + u] = Saturate16((sum + (1 << (pass1Shift - 1))) >> pass1Shift);
+			}
+		}
+
+		//Rows
+		for(unsigned int y = 0; y < height; y++)
+		{
+			for(unsigned int x = 0; x < width; x++)
+			{
+				int32 sum = 0;
+				for(unsigned int u = 0; u < width; u++)
+				{
+					sum += rowCoefs[(x * width) + u] * temp[(y * width) + u];
+				}
+				output[(y * width) + x] = Saturate16((sum + (1 << (pass2Shift - 1))) >> pass2Shift);
+			}
+		}
+	}
+
+	template <unsigned int width>
+	void TransformReduced(const int16* input, int16* output, unsigned int height)
+	{
+		switch(height)
+		{
+		case 1:
+			TransformReduced<width, 1>(input, output);
+			break;
+		case 2:
+			TransformReduced<width, 2>(input, output);
+			break;
+		case 4:
+			TransformReduced<width, 4>(input, output);
+			break;
+		case 8:
+			TransformReduced<width, 8>(input, output);
+			break;
+		default:
+			assert(false);
+			break;
+		}
+	}
+}
+
+void CReduced::Transform(const int16* input, int16* output, unsigned int width, unsigned int height)
+{
+	switch(width)
+	{
+	case 1:
+		if(height == 1)
+		{
+			//DC only, c(0)^2 = 1 / 8
+			output[0] = static_cast<int16>((input[0] + ((input[0] >= 0) ? 4 : -4)) / 8);
+			break;
+		}
+		TransformReduced<1>(input, output, height);
+		break;
+	case 2:
+		TransformReduced<2>(input, output, height);
+		break;
+	case 4:
+		TransformReduced<4>(input, output, height);
+		break;
+	case 8:
+		TransformReduced<8>(input, output, height);
+		break;
+	default:
+		assert(false);
+		break;
+	}
+}
@@ -0,0 +1,332 @@
+#include <algorithm>
+#include <cassert>
+#include "layout/CompiledLayout.h"
+#include "layout/HorizontalLayout.h"
+#include "layout/VerticalLayout.h"
+#include "layout/GridLayout.h"
+
+using namespace Framework;
+
+CCompiledLayout::CCompiledLayout(const LayoutObjectPtr& root)
+: m_root(root)
+{
+	CompileNode(root);
+	Measure();
+}
+
+unsigned int CCompiledLayout::GetPreferredWidth() const
+{
+	return m_nodes[0].preferredWidth;
+}
+
+unsigned int CCompiledLayout::GetPreferredHeight() const
+{
+	return m_nodes[0].preferredHeight;
+}
+
+unsigned int CCompiledLayout::CompileNode(const LayoutObjectPtr& object)
+{
+	unsigned int nodeIndex = static_cast<unsigned int>(m_nodes.size());
+	m_nodes.emplace_back();
+	m_nodes[nodeIndex].object = object.get();
+
+	//Child slots are reserved before recursing, they need to be contiguous
+	if(auto flatLayout = dynamic_cast<CFlatLayout*>(object.get()))
+	{
+		const auto& objects = flatLayout->GetObjects();
+		unsigned int firstChild = static_cast<unsigned int>(m_children.size());
+		m_children.resize(m_children.size() + objects.size());
+		unsigned int childIndex = firstChild;
+		for(const auto& childObject : objects)
+		{
+			unsigned int childNodeIndex = CompileNode(childObject);
+			m_children[childIndex++] = childNodeIndex;
+		}
+
+		auto& node = m_nodes[nodeIndex];
+		node.type = dynamic_cast<CHorizontalLayout*>(flatLayout) ? NODE_TYPE_HORIZONTAL : NODE_TYPE_VERTICAL;
+		node.firstChild = firstChild;
+		node.childCount = static_cast<unsigned int>(objects.size());
+		node.spacing = flatLayout->GetSpacing();
+	}
+	else if(auto gridLayout = dynamic_cast<CGridLayout*>(object.get()))
+	{
+		unsigned int cols = gridLayout->GetColumnCount();
+		unsigned int rows = gridLayout->GetRowCount();
+		unsigned int firstChild = static_cast<unsigned int>(m_children.size());
+		m_children.resize(m_children.size() + (cols * rows), EMPTY_CELL);
+		for(unsigned int col = 0; col < cols; col++)
+		{
+			for(unsigned int row = 0; row < rows; row++)
+			{
+				auto childObject = gridLayout->GetCellObject(col, row);
+				if(!childObject) continue;
+				unsigned int childNodeIndex = CompileNode(childObject);
+				m_children[firstChild + (col * rows) + row] = childNodeIndex;
+			}
+		}
+
+		auto& node = m_nodes[nodeIndex];
+		node.type = NODE_TYPE_GRID;
+		node.firstChild = firstChild;
+		node.childCount = cols * rows;
+		node.cols = cols;
+		node.rows = rows;
+		node.spacing = gridLayout->GetSpacing();
+	}
+
+	return nodeIndex;
+}
+
+void CCompiledLayout::Measure()
+{
+	//Children always come after their parent
+	for(auto nodeIterator = m_nodes.rbegin(); nodeIterator != m_nodes.rend(); nodeIterator++)
+	{
+		auto& node = *nodeIterator;
+		node.horizontalStretch = node.object->GetHorizontalStretch();
+		node.verticalStretch = node.object->GetVerticalStretch();
+		switch(node.type)
+		{
+		case NODE_TYPE_LEAF:
+			node.preferredWidth = node.object->GetCachedPreferredWidth();
+			node.preferredHeight = node.object->GetCachedPreferredHeight();
+			break;
+		case NODE_TYPE_HORIZONTAL:
+		case NODE_TYPE_VERTICAL:
+			MeasureFlat(node);
+			break;
+		case NODE_TYPE_GRID:
+			MeasureGrid(node);
+			break;
+		}
+	}
+}
+
+void CCompiledLayout::MeasureFlat(NODE& node)
+{
+	bool horizontal = (node.type == NODE_TYPE_HORIZONTAL);
+	unsigned int mainSize = 0;
+	unsigned int crossSize = 0;
+	for(unsigned int i = 0; i < node.childCount; i++)
+	{
+		const auto& child = m_nodes[m_children[node.firstChild + i]];
+		mainSize += horizontal ? child.preferredWidth : child.preferredHeight;
+		crossSize = std::max(horizontal ? child.preferredHeight : child.preferredWidth, crossSize);
+	}
+	if(node.childCount > 1)
+	{
+		mainSize += node.spacing * (node.childCount - 1);
+	}
+	node.preferredWidth = horizontal ? mainSize : crossSize;
+	node.preferredHeight = horizontal ? crossSize : mainSize;
+}
+
+void CCompiledLayout::MeasureGrid(NODE& node)
+{
+	unsigned int width = 0;
+	for(unsigned int col = 0; col < node.cols; col++)
+	{
+		unsigned int colWidth = 0;
+		for(unsigned int row = 0; row < node.rows; row++)
+		{
+			unsigned int childIndex = m_children[node.firstChild + (col * node.rows) + row];
+			if(childIndex == EMPTY_CELL) continue;
+			colWidth = std::max(m_nodes[childIndex].preferredWidth, colWidth);
+		}
+		width += colWidth;
+	}
+	unsigned int height = 0;
+	for(unsigned int row = 0; row < node.rows; row++)
+	{
+		unsigned int rowHeight = 0;
+		for(unsigned int col = 0; col < node.cols; col++)
+		{
+			unsigned int childIndex = m_children[node.firstChild + (col * node.rows) + row];
+			if(childIndex == EMPTY_CELL) continue;
+			rowHeight = std::max(m_nodes[childIndex].preferredHeight, rowHeight);
+		}
+		height += rowHeight;
+	}
+	if(node.cols > 1)
+	{
+		width += node.spacing * (node.cols - 1);
+	}
+	if(node.rows > 1)
+	{
+		height += node.spacing * (node.rows - 1);
+	}
+	node.preferredWidth = width;
+	node.preferredHeight = height;
+}
+
+void CCompiledLayout::Arrange(unsigned int left, unsigned int top, unsigned int right, unsigned int bottom)
+{
+	{
+		auto& root = m_nodes[0];
+		root.left = left;
+		root.top = top;
+		root.right = right;
+		root.bottom = bottom;
+	}
+
+	//Parents always come before their children
+	for(const auto& node : m_nodes)
+	{
+		switch(node.type)
+		{
+		case NODE_TYPE_HORIZONTAL:
+		case NODE_TYPE_VERTICAL:
+			ArrangeFlat(node);
+			break;
+		case NODE_TYPE_GRID:
+			ArrangeGrid(node);
+			break;
+		default:
+			break;
+		}
+	}
+
+	//Containers are already laid out, only leaves need to refresh themselves
+	for(const auto& node : m_nodes)
+	{
+		node.object->SetRect(node.left, node.top, node.right, node.bottom);
+		if(node.type == NODE_TYPE_LEAF)
+		{
+			node.object->UpdateGeometry();
+		}
+	}
+}
+
+void CCompiledLayout::ArrangeFlat(const NODE& node)
+{
+	bool horizontal = (node.type == NODE_TYPE_HORIZONTAL);
+
+	ClearItems();
+	for(unsigned int i = 0; i < node.childCount; i++)
+	{
+		const auto& child = m_nodes[m_children[node.firstChild + i]];
+		if((i != 0) && (node.spacing != 0))
+		{
+			AddItem(node.spacing, 0);
+		}
+		AddItem(horizontal ? child.preferredWidth : child.preferredHeight,
+			horizontal ? child.horizontalStretch : child.verticalStretch);
+	}
+	ComputeItemRanges(horizontal ? (node.right - node.left) : (node.bottom - node.top));
+
+	unsigned int itemIndex = 0;
+	for(unsigned int i = 0; i < node.childCount; i++)
+	{
+		if((i != 0) && (node.spacing != 0))
+		{
+			itemIndex++;
+		}
+		const auto& range = m_itemRanges[itemIndex++];
+		auto& child = m_nodes[m_children[node.firstChild + i]];
+		if(horizontal)
+		{
+			child.left = node.left + range.start;
+			child.right = node.left + range.end;
+			child.top = node.top;
+			child.bottom = node.bottom;
+		}
+		else
+		{
+			child.left = node.left;
+			child.right = node.right;
+			child.top = node.top + range.start;
+			child.bottom = node.top + range.end;
+		}
+	}
+}
+
+void CCompiledLayout::ArrangeGrid(const NODE& node)
+{
+	//Columns
+	ClearItems();
+	for(unsigned int col = 0; col < node.cols; col++)
+	{
+		unsigned int colWidth = 0;
+		unsigned int colStretch = 0;
+		for(unsigned int row = 0; row < node.rows; row++)
+		{
+			unsigned int childIndex = m_children[node.firstChild + (col * node.rows) + row];
+			if(childIndex == EMPTY_CELL) continue;
+			colWidth = std::max(m_nodes[childIndex].preferredWidth, colWidth);
+			colStretch = std::max(m_nodes[childIndex].horizontalStretch, colStretch);
+		}
+		if((col != 0) && (node.spacing != 0))
+		{
+			AddItem(node.spacing, 0);
+		}
+		AddItem(colWidth, colStretch);
+	}
+	ComputeItemRanges(node.right - node.left);
+	m_colRanges.clear();
+	for(unsigned int col = 0; col < node.cols; col++)
+	{
+		unsigned int itemIndex = ((node.spacing != 0) ? 2 : 1) * col;
+		m_colRanges.push_back(m_itemRanges[itemIndex]);
+	}
+
+	//Rows
+	ClearItems();
+	for(unsigned int row = 0; row < node.rows; row++)
+	{
+		unsigned int rowHeight = 0;
+		unsigned int rowStretch = 0;
+		for(unsigned int col = 0; col < node.cols; col++)
+		{
+			unsigned int childIndex = m_children[node.firstChild + (col * node.rows) + row];
+			if(childIndex == EMPTY_CELL) continue;
+			rowHeight = std::max(m_nodes[childIndex].preferredHeight, rowHeight);
+			rowStretch = std::max(m_nodes[childIndex].verticalStretch, rowStretch);
+		}
+		if((row != 0) && (node.spacing != 0))
+		{
+			AddItem(node.spacing, 0);
+		}
+		AddItem(rowHeight, rowStretch);
+	}
+	ComputeItemRanges(node.bottom - node.top);
+	m_rowRanges.clear();
+	for(unsigned int row = 0; row < node.rows; row++)
+	{
+		unsigned int itemIndex = ((node.spacing != 0) ? 2 : 1) * row;
+		m_rowRanges.push_back(m_itemRanges[itemIndex]);
+	}
+
+	for(unsigned int col = 0; col < node.cols; col++)
+	{
+		for(unsigned int row = 0; row < node.rows; row++)
+		{
+			unsigned int childIndex = m_children[node.firstChild + (col * node.rows) + row];
+			if(childIndex == EMPTY_CELL) continue;
+			auto& child = m_nodes[childIndex];
+			child.left = node.left + m_colRanges[col].start;
+			child.right = node.left + m_colRanges[col].end;
+			child.top = node.top + m_rowRanges[row].start;
+			child.bottom = node.top + m_rowRanges[row].end;
+		}
+	}
+}
+
+void CCompiledLayout::ClearItems()
+{
+	m_itemSizes.clear();
+	m_itemStretches.clear();
+}
+
+void CCompiledLayout::AddItem(unsigned int preferredSize, unsigned int stretch)
+{
+	m_itemSizes.push_back(preferredSize);
+	m_itemStretches.push_back(stretch);
+}
+
+void CCompiledLayout::ComputeItemRanges(unsigned int size)
+{
+	//Same as a freshly built CLayoutBase
+	m_itemRanges.assign(m_itemSizes.size(), RANGE());
+	CLayoutBase::ComputeRanges(m_itemSizes.data(), m_itemStretches.data(), m_itemRanges.data(), m_itemSizes.size(), size);
+}
@@ -11,35 +11,69 @@ CFlatLayout::CFlatLayout(unsigned int stretchX, unsigned int stretchY, unsigned
 
 CFlatLayout::~CFlatLayout()
 {
-
-}
-
-void CFlatLayout::InsertObject(const LayoutObjectPtr& object)
-{
-	if(m_objects.size() != 0)
+	for(const auto& object : m_objects)
 	{
-		if(m_spacing != 0)
+		if(object->GetParent() == this)
 		{
-			m_layoutBase.InsertItem(CLayoutBaseItem(m_spacing, 0));
+			object->SetParent(nullptr);
 		}
 	}
+}
+
+void CFlatLayout::InsertObject(const LayoutObjectPtr& object)
+{
 	m_objects.push_back(object);
-	m_layoutBase.InsertItem(CreateLayoutBaseItem(object));
+	object->SetParent(this);
+	Invalidate();
+}
+
+const CFlatLayout::ObjectList& CFlatLayout::GetObjects() const
+{
+	return m_objects;
+}
+
+unsigned int CFlatLayout::GetSpacing() const
+{
+	return m_spacing;
 }
 
-unsigned int CFlatLayout::GetPreferredSize() const
+unsigned int CFlatLayout::GetPreferredSize()
 {
-	return m_layoutBase.GetPreferredSize();
+	unsigned int size = 0;
+	for(const auto& object : m_objects)
+	{
+		size += GetObjectPreferredSize(object);
+	}
+	if(m_objects.size() > 1)
+	{
+		size += m_spacing * static_cast<unsigned int>(m_objects.size() - 1);
+	}
+	return size;
 }
 
 void CFlatLayout::RefreshGeometry()
 {
+	RebuildLayoutBase();
 	m_layoutBase.ComputeRanges(GetLayoutSize());
 	for(const auto& item : m_layoutBase.GetItems())
 	{
 		const auto& object = item.GetObject();
 		if(!object) continue;
 		SetObjectRange(object, item.GetRangeStart(), item.GetRangeEnd());
-		object->RefreshGeometry();
+		object->UpdateGeometry();
+	}
+}
+
+void CFlatLayout::RebuildLayoutBase()
+{
+	//Items only hold preferred sizes, which are cached by the objects
+	m_layoutBase.Clear();
+	for(const auto& object : m_objects)
+	{
+		if((m_spacing != 0) && !m_layoutBase.GetItems().empty())
+		{
+			m_layoutBase.InsertItem(CLayoutBaseItem(m_spacing, 0));
+		}
+		m_layoutBase.InsertItem(CreateLayoutBaseItem(object));
 	}
 }
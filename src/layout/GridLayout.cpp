@@ -20,7 +20,16 @@ CGridLayout::CGridLayout(unsigned int cols, unsigned int rows, unsigned int spac
 
 CGridLayout::~CGridLayout()
 {
-
+	for(const auto& col : m_objects)
+	{
+		for(const auto& object : col)
+		{
+			if(object && (object->GetParent() == this))
+			{
+				object->SetParent(nullptr);
+			}
+		}
+	}
 }
 
 GridLayoutPtr CGridLayout::Create(unsigned int cols, unsigned int rows, unsigned int spacing)
@@ -30,11 +39,13 @@ GridLayoutPtr CGridLayout::Create(unsigned int cols, unsigned int rows, unsigned
 
 unsigned int CGridLayout::GetPreferredWidth()
 {
+	RebuildLayouts();
 	return m_horzLayout.GetPreferredSize();
 }
 
 unsigned int CGridLayout::GetPreferredHeight()
 {
+	RebuildLayouts();
 	return m_vertLayout.GetPreferredSize();
 }
 
@@ -45,7 +56,31 @@ void CGridLayout::SetObject(unsigned int col, unsigned int row, const LayoutObje
 	assert(!m_objects[col][row]);
 
 	m_objects[col][row] = object;
-	RebuildLayouts();
+	object->SetParent(this);
+	//Layouts are rebuilt lazily, filling a grid doesn't query every object on each insertion
+	Invalidate();
+}
+
+LayoutObjectPtr CGridLayout::GetCellObject(unsigned int col, unsigned int row) const
+{
+	assert(col < m_cols);
+	assert(row < m_rows);
+	return m_objects[col][row];
+}
+
+unsigned int CGridLayout::GetColumnCount() const
+{
+	return m_cols;
+}
+
+unsigned int CGridLayout::GetRowCount() const
+{
+	return m_rows;
+}
+
+unsigned int CGridLayout::GetSpacing() const
+{
+	return m_spacing;
 }
 
 void CGridLayout::RebuildLayouts()
@@ -86,7 +121,7 @@ CLayoutBaseItem CGridLayout::CreateColLayoutBaseItem(unsigned int col) const
 	{
 		const auto& object = m_objects[col][i];
 		if(!object) continue;
-		maxWidth = std::max(object->GetPreferredWidth(), maxWidth);
+		maxWidth = std::max(object->GetCachedPreferredWidth(), maxWidth);
 		maxStretch = std::max(object->GetHorizontalStretch(), maxStretch);
 	}
 
@@ -102,7 +137,7 @@ CLayoutBaseItem CGridLayout::CreateRowLayoutBaseItem(unsigned int row) const
 	{
 		const LayoutObjectPtr& object = m_objects[i][row];
 		if(!object) continue;
-		maxHeight = std::max(object->GetPreferredHeight(), maxHeight);
+		maxHeight = std::max(object->GetCachedPreferredHeight(), maxHeight);
 		maxStretch = std::max(object->GetVerticalStretch(), maxStretch);
 	}
 
@@ -114,6 +149,7 @@ void CGridLayout::RefreshGeometry()
 	unsigned int width = GetRight() - GetLeft();
 	unsigned int height = GetBottom() - GetTop();
 
+	RebuildLayouts();
 	m_horzLayout.ComputeRanges(width);
 	m_vertLayout.ComputeRanges(height);
 
@@ -151,7 +187,7 @@ void CGridLayout::RefreshGeometry()
 		{
 			const auto& object = m_objects[i][j];
 			if(!object) continue;
-			object->RefreshGeometry();
+			object->UpdateGeometry();
 		}
 	}
 }
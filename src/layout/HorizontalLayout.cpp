@@ -24,7 +24,7 @@ unsigned int CHorizontalLayout::GetPreferredHeight()
 	unsigned int height = 0;
 	for(const auto& object : m_objects)
 	{
-		height = std::max(object->GetPreferredHeight(), height);
+		height = std::max(object->GetCachedPreferredHeight(), height);
 	}
 	return height;
 }
@@ -44,7 +44,7 @@ void CHorizontalLayout::SetObjectRange(const LayoutObjectPtr& object, unsigned i
 
 unsigned int CHorizontalLayout::GetObjectPreferredSize(const LayoutObjectPtr& object)
 {
-	return object->GetPreferredWidth();
+	return object->GetCachedPreferredWidth();
 }
 
 unsigned int CHorizontalLayout::GetLayoutSize()
@@ -34,46 +34,55 @@ unsigned int CLayoutBase::GetPreferredSize() const
 	return size;
 }
 
-unsigned int CLayoutBase::GetTotalStretchUnits() const
+void CLayoutBase::ComputeRanges(unsigned int size)
 {
-	unsigned int units = 0;
-
+	std::vector<unsigned int> preferredSizes;
+	std::vector<unsigned int> stretches;
+	std::vector<RANGE> ranges;
+	preferredSizes.reserve(m_items.size());
+	stretches.reserve(m_items.size());
+	ranges.reserve(m_items.size());
 	for(const auto& item : m_items)
 	{
-		units += item.GetStretch();
+		preferredSizes.push_back(item.GetPreferredSize());
+		stretches.push_back(item.GetStretch());
+		RANGE range;
+		range.start = item.GetRangeStart();
+		range.end = item.GetRangeEnd();
+		ranges.push_back(range);
 	}
 
-	return units;
-}
+	ComputeRanges(preferredSizes.data(), stretches.data(), ranges.data(), m_items.size(), size);
 
-bool CLayoutBase::HasOnlyNonStretchable() const
-{
-	for(const auto& item : m_items)
+	for(size_t i = 0; i < m_items.size(); i++)
 	{
-		if(item.GetStretch() != 0) return false;
+		m_items[i].SetRange(ranges[i].start, ranges[i].end);
 	}
-
-	return true;
 }
 
-void CLayoutBase::ComputeRanges(unsigned int size)
+void CLayoutBase::ComputeRanges(const unsigned int* preferredSizes, const unsigned int* stretches, RANGE* ranges, size_t count, unsigned int size)
 {
-	unsigned int sizeTotal = GetPreferredSize();
+	unsigned int sizeTotal = 0;
+	unsigned int stretchUnits = 0;
+	for(size_t i = 0; i < count; i++)
+	{
+		sizeTotal += preferredSizes[i];
+		stretchUnits += stretches[i];
+	}
 	int rest = static_cast<int>(size) - static_cast<int>(sizeTotal);
 
-	if(HasOnlyNonStretchable())
+	if(stretchUnits == 0)
 	{
-		unsigned int dim0 = 0, dim1 = 0, i = 0;
-		for(auto itemIterator(m_items.begin());
-			m_items.end() != itemIterator; itemIterator++, i++)
+		unsigned int dim0 = 0, dim1 = 0;
+		for(size_t i = 0; i < count; i++)
 		{
-			auto& item(*itemIterator);
-			dim1 = dim0 + item.GetPreferredSize() + ((int)rest / static_cast<int>(m_items.size()));
-			if(i == (m_items.size() - 1))
+			dim1 = dim0 + preferredSizes[i] + ((int)rest / static_cast<int>(count));
+			if(i == (count - 1))
 			{
 				dim1 = size;
 			}
-			item.SetRange(dim0, dim1);
+			ranges[i].start = dim0;
+			ranges[i].end = dim1;
 			dim0 = dim1;
 		}
 	}
@@ -81,45 +90,42 @@ void CLayoutBase::ComputeRanges(unsigned int size)
 	{
 		if(size >= sizeTotal)
 		{
-			unsigned int stretchUnits = GetTotalStretchUnits();
-			unsigned int dim0 = 0, dim1 = 0, i = 0;
-			for(auto itemIterator(m_items.begin());
-				m_items.end() != itemIterator; itemIterator++, i++)
+			unsigned int dim0 = 0, dim1 = 0;
+			for(size_t i = 0; i < count; i++)
 			{
-				auto& item(*itemIterator);
-				if(item.GetStretch())
+				if(stretches[i])
 				{
-					dim1 = dim0 + ((item.GetStretch() * rest) / (stretchUnits)) + item.GetPreferredSize();
+					dim1 = dim0 + ((stretches[i] * rest) / (stretchUnits)) + preferredSizes[i];
 				}
 				else 
 				{
-					dim1 = dim0 + item.GetPreferredSize();
+					dim1 = dim0 + preferredSizes[i];
 				}
-				if(i == (m_items.size() - 1))
+				if(i == (count - 1))
 				{
 					dim1 = size;
 				}
-				item.SetRange(dim0, dim1);
+				ranges[i].start = dim0;
+				ranges[i].end = dim1;
 				dim0 = dim1;
 			}
 		}
 		else
 		{
-			unsigned int dim0 = 0, dim1 = 0, i = 0;
-			for(auto itemIterator(m_items.begin());
-				m_items.end() != itemIterator; itemIterator++, i++)
+			unsigned int dim0 = 0, dim1 = 0;
+			for(size_t i = 0; i < count; i++)
 			{
-				auto& item(*itemIterator);
-				if(item.GetPreferredSize() != 0)
+				if(preferredSizes[i] != 0)
 				{
-					int availableSize = (((int)rest * (int)item.GetPreferredSize()) / (int)sizeTotal);
+					int availableSize = (((int)rest * (int)preferredSizes[i]) / (int)sizeTotal);
 					//assert(availableSize >= 0);
-					dim1 = dim0 + item.GetPreferredSize() + availableSize;
-					if(i == (m_items.size() - 1))
+					dim1 = dim0 + preferredSizes[i] + availableSize;
+					if(i == (count - 1))
 					{
 						dim1 = size;
 					}
-					item.SetRange(dim0, dim1);
+					ranges[i].start = dim0;
+					ranges[i].end = dim1;
 				}
 				else
 				{
@@ -15,14 +15,66 @@ CLayoutObject::~CLayoutObject()
 	
 }
 
+unsigned int CLayoutObject::GetCachedPreferredWidth()
+{
+	if(!m_preferredWidthValid)
+	{
+		m_cachedPreferredWidth = GetPreferredWidth();
+		m_preferredWidthValid = true;
+	}
+	return m_cachedPreferredWidth;
+}
+
+unsigned int CLayoutObject::GetCachedPreferredHeight()
+{
+	if(!m_preferredHeightValid)
+	{
+		m_cachedPreferredHeight = GetPreferredHeight();
+		m_preferredHeightValid = true;
+	}
+	return m_cachedPreferredHeight;
+}
+
+void CLayoutObject::Invalidate()
+{
+	for(auto object = this; object; object = object->m_parent)
+	{
+		object->m_preferredWidthValid = false;
+		object->m_preferredHeightValid = false;
+		object->m_geometryDirty = true;
+	}
+}
+
+void CLayoutObject::UpdateGeometry()
+{
+	if(!m_geometryDirty) return;
+	m_geometryDirty = false;
+	RefreshGeometry();
+}
+
+void CLayoutObject::SetParent(CLayoutObject* parent)
+{
+	m_parent = parent;
+}
+
+CLayoutObject* CLayoutObject::GetParent() const
+{
+	return m_parent;
+}
+
 void CLayoutObject::SetHorizontalStretch(unsigned int stretch)
 {
+	if(m_horizontalStretch == stretch) return;
 	m_horizontalStretch = stretch;
+	//Changes how the container distributes its space
+	Invalidate();
 }
 
 void CLayoutObject::SetVerticalStretch(unsigned int stretch)
 {
+	if(m_verticalStretch == stretch) return;
 	m_verticalStretch = stretch;
+	Invalidate();
 }
 
 unsigned int CLayoutObject::GetHorizontalStretch() const
@@ -37,30 +89,38 @@ unsigned int CLayoutObject::GetVerticalStretch() const
 
 void CLayoutObject::SetLeft(unsigned int left)
 {
+	if(m_left == left) return;
 	m_left = left;
+	m_geometryDirty = true;
 }
 
 void CLayoutObject::SetRight(unsigned int right)
 {
+	if(m_right == right) return;
 	m_right = right;
+	m_geometryDirty = true;
 }
 
 void CLayoutObject::SetTop(unsigned int top)
 {
+	if(m_top == top) return;
 	m_top = top;
+	m_geometryDirty = true;
 }
 
 void CLayoutObject::SetBottom(unsigned int bottom)
 {
+	if(m_bottom == bottom) return;
 	m_bottom = bottom;
+	m_geometryDirty = true;
 }
 
 void CLayoutObject::SetRect(unsigned int left, unsigned int top, unsigned int right, unsigned int bottom)
 {
-	m_left = left;
-	m_top = top;
-	m_right = right;
-	m_bottom = bottom;
+	SetLeft(left);
+	SetTop(top);
+	SetRight(right);
+	SetBottom(bottom);
 }
 
 unsigned int CLayoutObject::GetLeft() const
@@ -85,10 +145,10 @@ unsigned int CLayoutObject::GetBottom() const
 
 CLayoutBaseItem CLayoutObject::CreateHorizontalBaseLayoutItem()
 {
-	return CLayoutBaseItem(GetPreferredWidth(), GetHorizontalStretch(), shared_from_this());
+	return CLayoutBaseItem(GetCachedPreferredWidth(), GetHorizontalStretch(), shared_from_this());
 }
 
 CLayoutBaseItem CLayoutObject::CreateVerticalBaseLayoutItem()
 {
-	return CLayoutBaseItem(GetPreferredHeight(), GetVerticalStretch(), shared_from_this());
+	return CLayoutBaseItem(GetCachedPreferredHeight(), GetVerticalStretch(), shared_from_this());
 }
@@ -19,7 +19,7 @@ unsigned int CVerticalLayout::GetPreferredWidth()
 	unsigned int width = 0;
 	for(const auto& object : m_objects)
 	{
-		width = std::max(object->GetPreferredWidth(), width);
+		width = std::max(object->GetCachedPreferredWidth(), width);
 	}
 	return width;
 }
@@ -44,7 +44,7 @@ void CVerticalLayout::SetObjectRange(const LayoutObjectPtr& object, unsigned int
 
 unsigned int CVerticalLayout::GetObjectPreferredSize(const LayoutObjectPtr& object)
 {
-	return object->GetPreferredHeight();
+	return object->GetCachedPreferredHeight();
 }
 
 unsigned int CVerticalLayout::GetLayoutSize()
@@ -0,0 +1,1326 @@
+#include "math/BatchMath.h"
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include "CpuFeatures.h"
+#include "ParallelFor.h"
+#include "math/MathSimd.h"
+
+#if defined(FRAMEWORK_SIMD_HAS_X86_DISPATCH)
+#include <immintrin.h>
+#endif
+
+#if defined(FRAMEWORK_SIMD_USE_SSE) || defined(FRAMEWORK_MATHSIMD_USE_NEON)
+#define BATCHMATH_HAS_SIMD
+#endif
+
+using namespace Framework;
+
+/////////////////////////////////////////////////////////
+// CVector3Array
+/////////////////////////////////////////////////////////
+
+CVector3Array::CVector3Array(size_t size)
+{
+	Resize(size);
+}
+
+size_t CVector3Array::GetSize() const
+{
+	return m_x.size();
+}
+
+void CVector3Array::Resize(size_t size)
+{
+	m_x.resize(size);
+	m_y.resize(size);
+	m_z.resize(size);
+}
+
+CVector3 CVector3Array::Get(size_t index) const
+{
+	return CVector3(m_x[index], m_y[index], m_z[index]);
+}
+
+void CVector3Array::Set(size_t index, const CVector3& value)
+{
+	m_x[index] = value.x;
+	m_y[index] = value.y;
+	m_z[index] = value.z;
+}
+
+float* CVector3Array::GetX()
+{
+	return m_x.data();
+}
+
+float* CVector3Array::GetY()
+{
+	return m_y.data();
+}
+
+float* CVector3Array::GetZ()
+{
+	return m_z.data();
+}
+
+const float* CVector3Array::GetX() const
+{
+	return m_x.data();
+}
+
+const float* CVector3Array::GetY() const
+{
+	return m_y.data();
+}
+
+const float* CVector3Array::GetZ() const
+{
+	return m_z.data();
+}
+
+/////////////////////////////////////////////////////////
+// CVector4Array
+/////////////////////////////////////////////////////////
+
+CVector4Array::CVector4Array(size_t size)
+{
+	Resize(size);
+}
+
+size_t CVector4Array::GetSize() const
+{
+	return m_x.size();
+}
+
+void CVector4Array::Resize(size_t size)
+{
+	m_x.resize(size);
+	m_y.resize(size);
+	m_z.resize(size);
+	m_w.resize(size);
+}
+
+CVector4 CVector4Array::Get(size_t index) const
+{
+	return CVector4(m_x[index], m_y[index], m_z[index], m_w[index]);
+}
+
+void CVector4Array::Set(size_t index, const CVector4& value)
+{
+	m_x[index] = value.x;
+	m_y[index] = value.y;
+	m_z[index] = value.z;
+	m_w[index] = value.w;
+}
+
+float* CVector4Array::GetX()
+{
+	return m_x.data();
+}
+
+float* CVector4Array::GetY()
+{
+	return m_y.data();
+}
+
+float* CVector4Array::GetZ()
+{
+	return m_z.data();
+}
+
+float* CVector4Array::GetW()
+{
+	return m_w.data();
+}
+
+const float* CVector4Array::GetX() const
+{
+	return m_x.data();
+}
+
+const float* CVector4Array::GetY() const
+{
+	return m_y.data();
+}
+
+const float* CVector4Array::GetZ() const
+{
+	return m_z.data();
+}
+
+const float* CVector4Array::GetW() const
+{
+	return m_w.data();
+}
+
+/////////////////////////////////////////////////////////
+// CSphereArray
+/////////////////////////////////////////////////////////
+
+CSphereArray::CSphereArray(size_t size)
+{
+	Resize(size);
+}
+
+size_t CSphereArray::GetSize() const
+{
+	return m_radii.size();
+}
+
+void CSphereArray::Resize(size_t size)
+{
+	m_positions.Resize(size);
+	m_radii.resize(size);
+}
+
+CSphere CSphereArray::Get(size_t index) const
+{
+	CSphere sphere;
+	sphere.position = m_positions.Get(index);
+	sphere.radius = m_radii[index];
+	return sphere;
+}
+
+void CSphereArray::Set(size_t index, const CSphere& sphere)
+{
+	m_positions.Set(index, sphere.position);
+	m_radii[index] = sphere.radius;
+}
+
+CVector3Array& CSphereArray::GetPositions()
+{
+	return m_positions;
+}
+
+const CVector3Array& CSphereArray::GetPositions() const
+{
+	return m_positions;
+}
+
+float* CSphereArray::GetRadii()
+{
+	return m_radii.data();
+}
+
+const float* CSphereArray::GetRadii() const
+{
+	return m_radii.data();
+}
+
+/////////////////////////////////////////////////////////
+// CPlaneArray
+/////////////////////////////////////////////////////////
+
+CPlaneArray::CPlaneArray(size_t size)
+{
+	Resize(size);
+}
+
+size_t CPlaneArray::GetSize() const
+{
+	return m_a.size();
+}
+
+void CPlaneArray::Resize(size_t size)
+{
+	m_a.resize(size);
+	m_b.resize(size);
+	m_c.resize(size);
+	m_d.resize(size);
+}
+
+CPlane CPlaneArray::Get(size_t index) const
+{
+	return CPlane(m_a[index], m_b[index], m_c[index], m_d[index]);
+}
+
+void CPlaneArray::Set(size_t index, const CPlane& plane)
+{
+	m_a[index] = plane.a;
+	m_b[index] = plane.b;
+	m_c[index] = plane.c;
+	m_d[index] = plane.d;
+}
+
+float* CPlaneArray::GetA()
+{
+	return m_a.data();
+}
+
+float* CPlaneArray::GetB()
+{
+	return m_b.data();
+}
+
+float* CPlaneArray::GetC()
+{
+	return m_c.data();
+}
+
+float* CPlaneArray::GetD()
+{
+	return m_d.data();
+}
+
+const float* CPlaneArray::GetA() const
+{
+	return m_a.data();
+}
+
+const float* CPlaneArray::GetB() const
+{
+	return m_b.data();
+}
+
+const float* CPlaneArray::GetC() const
+{
+	return m_c.data();
+}
+
+const float* CPlaneArray::GetD() const
+{
+	return m_d.data();
+}
+
+/////////////////////////////////////////////////////////
+// CRayArray
+/////////////////////////////////////////////////////////
+
+CRayArray::CRayArray(size_t size)
+{
+	Resize(size);
+}
+
+size_t CRayArray::GetSize() const
+{
+	return m_positions.GetSize();
+}
+
+void CRayArray::Resize(size_t size)
+{
+	m_positions.Resize(size);
+	m_directions.Resize(size);
+}
+
+CRay CRayArray::Get(size_t index) const
+{
+	return CRay(m_positions.Get(index), m_directions.Get(index));
+}
+
+void CRayArray::Set(size_t index, const CRay& ray)
+{
+	m_positions.Set(index, ray.position);
+	m_directions.Set(index, ray.direction);
+}
+
+CVector3Array& CRayArray::GetPositions()
+{
+	return m_positions;
+}
+
+const CVector3Array& CRayArray::GetPositions() const
+{
+	return m_positions;
+}
+
+CVector3Array& CRayArray::GetDirections()
+{
+	return m_directions;
+}
+
+const CVector3Array& CRayArray::GetDirections() const
+{
+	return m_directions;
+}
+
+/////////////////////////////////////////////////////////
+// CQuaternionArray
+/////////////////////////////////////////////////////////
+
+CQuaternionArray::CQuaternionArray(size_t size)
+{
+	Resize(size);
+}
+
+size_t CQuaternionArray::GetSize() const
+{
+	return m_x.size();
+}
+
+void CQuaternionArray::Resize(size_t size)
+{
+	m_x.resize(size);
+	m_y.resize(size);
+	m_z.resize(size);
+	m_w.resize(size);
+}
+
+CQuaternion CQuaternionArray::Get(size_t index) const
+{
+	return CQuaternion(m_x[index], m_y[index], m_z[index], m_w[index]);
+}
+
+void CQuaternionArray::Set(size_t index, const CQuaternion& value)
+{
+	m_x[index] = value.x;
+	m_y[index] = value.y;
+	m_z[index] = value.z;
+	m_w[index] = value.w;
+}
+
+float* CQuaternionArray::GetX()
+{
+	return m_x.data();
+}
+
+float* CQuaternionArray::GetY()
+{
+	return m_y.data();
+}
+
+float* CQuaternionArray::GetZ()
+{
+	return m_z.data();
+}
+
+float* CQuaternionArray::GetW()
+{
+	return m_w.data();
+}
+
+const float* CQuaternionArray::GetX() const
+{
+	return m_x.data();
+}
+
+const float* CQuaternionArray::GetY() const
+{
+	return m_y.data();
+}
+
+const float* CQuaternionArray::GetZ() const
+{
+	return m_z.data();
+}
+
+const float* CQuaternionArray::GetW() const
+{
+	return m_w.data();
+}
+
+/////////////////////////////////////////////////////////
+// Kernels
+/////////////////////////////////////////////////////////
+
+namespace
+{
+	enum
+	{
+		//Below this, the cost of scheduling tasks outweighs the work
+		PARALLEL_THRESHOLD = 16384,
+		//Widest SIMD width (AVX2), chunks are kept a multiple of this so that only the last one has a scalar tail
+		MAX_LANE_COUNT = 8,
+	};
+
+	struct TRANSFORM_PARAMS
+	{
+		const CMatrix4* matrix;
+		//input[3] is null for 3 component inputs, inputW is used instead
+		const float* input[4];
+		float inputW;
+		//output[3] is null for 3 component outputs
+		float* output[4];
+	};
+
+	struct VECTOR3_STREAMS
+	{
+		const float* x;
+		const float* y;
+		const float* z;
+	};
+
+	struct SPHERE_STREAMS
+	{
+		const float* x;
+		const float* y;
+		const float* z;
+		const float* radius;
+	};
+
+	//Either a stream of values or a single value used for every element
+	struct STREAM
+	{
+		const float* values;
+		float value;
+	};
+
+	struct RAY_PARAMS
+	{
+		STREAM position[3];
+		STREAM direction[3];
+		//Sphere (center and radius) or plane (a, b, c and d)
+		STREAM target[4];
+		float* output;
+	};
+
+	struct SLERP_PARAMS
+	{
+		const float* lhs[4];
+		const float* rhs[4];
+		float alpha;
+		float* output[4];
+	};
+
+	struct TO_MATRICES_PARAMS
+	{
+		const float* input[4];
+		CMatrix4* output;
+	};
+
+	typedef void (*TransformFunction)(const TRANSFORM_PARAMS&, size_t, size_t);
+	typedef void (*NormalizeFunction)(const VECTOR3_STREAMS&, float**, size_t, size_t);
+	typedef void (*DotFunction)(const VECTOR3_STREAMS&, const VECTOR3_STREAMS&, float*, size_t, size_t);
+	typedef size_t (*CullFunction)(const CPlane*, size_t, const SPHERE_STREAMS&, uint8*, size_t, size_t);
+	typedef size_t (*IntersectFunction)(const RAY_PARAMS&, size_t, size_t);
+	typedef void (*SlerpFunction)(const SLERP_PARAMS&, size_t, size_t);
+	typedef void (*ToMatricesFunction)(const TO_MATRICES_PARAMS&, size_t, size_t);
+
+	struct KERNELS
+	{
+		TransformFunction transform;
+		NormalizeFunction normalize;
+		DotFunction dot;
+		CullFunction cull;
+		IntersectFunction intersectSphere;
+		IntersectFunction intersectPlane;
+		SlerpFunction slerp;
+		ToMatricesFunction toMatrices;
+	};
+
+	//Scalar kernels use the same operation order as the per element operations and
+	//the SIMD kernels, they also handle what's left after the last full SIMD vector
+
+	void TransformScalar(const TRANSFORM_PARAMS& params, size_t begin, size_t end)
+	{
+		const auto& coeff = params.matrix->coeff;
+		for(size_t i = begin; i < end; i++)
+		{
+			float x = params.input[0][i];
+			float y = params.input[1][i];
+			float z = params.input[2][i];
+			float w = params.input[3] ? params.input[3][i] : params.inputW;
+			//Compute everything before storing in case the output is the input
+			float results[4];
+			for(unsigned int j = 0; j < 4; j++)
+			{
+				results[j] = (x * coeff[j]) + (y * coeff[4 + j]) + (z * coeff[8 + j]) + (w * coeff[12 + j]);
+			}
+			for(unsigned int j = 0; j < 4; j++)
+			{
+				if(params.output[j]) params.output[j][i] = results[j];
+			}
+		}
+	}
+
+	void NormalizeScalar(const VECTOR3_STREAMS& input, float** output, size_t begin, size_t end)
+	{
+		for(size_t i = begin; i < end; i++)
+		{
+			float x = input.x[i];
+			float y = input.y[i];
+			float z = input.z[i];
+			float length = sqrt((x * x) + (y * y) + (z * z));
+			output[0][i] = x / length;
+			output[1][i] = y / length;
+			output[2][i] = z / length;
+		}
+	}
+
+	void DotScalar(const VECTOR3_STREAMS& lhs, const VECTOR3_STREAMS& rhs, float* output, size_t begin, size_t end)
+	{
+		for(size_t i = begin; i < end; i++)
+		{
+			output[i] = (lhs.x[i] * rhs.x[i]) + (lhs.y[i] * rhs.y[i]) + (lhs.z[i] * rhs.z[i]);
+		}
+	}
+
+	size_t CullScalar(const CPlane* planes, size_t planeCount, const SPHERE_STREAMS& spheres, uint8* visibility, size_t begin, size_t end)
+	{
+		size_t visibleCount = 0;
+		for(size_t i = begin; i < end; i++)
+		{
+			//Smallest signed distance to a plane, offset by the radius
+			float minDistance = std::numeric_limits<float>::max();
+			for(size_t j = 0; j < planeCount; j++)
+			{
+				const auto& plane = planes[j];
+				float distance = (spheres.x[i] * plane.a) + (spheres.y[i] * plane.b) + (spheres.z[i] * plane.c) - plane.d + spheres.radius[i];
+				minDistance = std::min(minDistance, distance);
+			}
+			bool visible = (minDistance >= 0);
+			visibility[i] = visible ? 1 : 0;
+			visibleCount += visible ? 1 : 0;
+		}
+		return visibleCount;
+	}
+
+	float GetValue(const STREAM& stream, size_t index)
+	{
+		return stream.values ? stream.values[index] : stream.value;
+	}
+
+	size_t IntersectSphereScalar(const RAY_PARAMS& params, size_t begin, size_t end)
+	{
+		size_t hitCount = 0;
+		for(size_t i = begin; i < end; i++)
+		{
+			float dx = GetValue(params.direction[0], i);
+			float dy = GetValue(params.direction[1], i);
+			float dz = GetValue(params.direction[2], i);
+			float radius = GetValue(params.target[3], i);
+			//vpc = Position of the sphere relative to the ray's origin
+			float vx = GetValue(params.target[0], i) - GetValue(params.position[0], i);
+			float vy = GetValue(params.target[1], i) - GetValue(params.position[1], i);
+			float vz = GetValue(params.target[2], i) - GetValue(params.position[2], i);
+			//Length of vpc projected on the ray's direction (which is unit length)
+			float tc = (vx * dx) + (vy * dy) + (vz * dz);
+			//opc = Remainder of the position vector
+			float ox = (tc * dx) - vx;
+			float oy = (tc * dy) - vy;
+			float oz = (tc * dz) - vz;
+			float opcLengthSquared = (ox * ox) + (oy * oy) + (oz * oz);
+			float vpcLengthSquared = (vx * vx) + (vy * vy) + (vz * vz);
+			float radiusSquared = radius * radius;
+			float distance = std::numeric_limits<float>::infinity();
+			if((tc >= 0) && (opcLengthSquared <= radiusSquared))
+			{
+				float dist = sqrt(radiusSquared - opcLengthSquared);
+				//Far intersection when the origin is inside the sphere
+				distance = (vpcLengthSquared > radiusSquared) ? (tc - dist) : (tc + dist);
+				hitCount++;
+			}
+			params.output[i] = distance;
+		}
+		return hitCount;
+	}
+
+	size_t IntersectPlaneScalar(const RAY_PARAMS& params, size_t begin, size_t end)
+	{
+		size_t hitCount = 0;
+		for(size_t i = begin; i < end; i++)
+		{
+			float a = GetValue(params.target[0], i);
+			float b = GetValue(params.target[1], i);
+			float c = GetValue(params.target[2], i);
+			float dirDot = (a * GetValue(params.direction[0], i)) + (b * GetValue(params.direction[1], i)) + (c * GetValue(params.direction[2], i));
+			float posDot = (GetValue(params.position[0], i) * a) + (GetValue(params.position[1], i) * b) + (GetValue(params.position[2], i) * c);
+			float distance = std::numeric_limits<float>::infinity();
+			if(dirDot != 0)
+			{
+				distance = (GetValue(params.target[3], i) - posDot) / dirDot;
+				hitCount++;
+			}
+			params.output[i] = distance;
+		}
+		return hitCount;
+	}
+
+	void SlerpScalar(const SLERP_PARAMS& params, size_t begin, size_t end)
+	{
+		for(size_t i = begin; i < end; i++)
+		{
+			CQuaternion lhs(params.lhs[0][i], params.lhs[1][i], params.lhs[2][i], params.lhs[3][i]);
+			CQuaternion rhs(params.rhs[0][i], params.rhs[1][i], params.rhs[2][i], params.rhs[3][i]);
+			auto result = ::Slerp(lhs, rhs, params.alpha);
+			params.output[0][i] = result.x;
+			params.output[1][i] = result.y;
+			params.output[2][i] = result.z;
+			params.output[3][i] = result.w;
+		}
+	}
+
+	void ToMatricesScalar(const TO_MATRICES_PARAMS& params, size_t begin, size_t end)
+	{
+		for(size_t i = begin; i < end; i++)
+		{
+			CQuaternion quaternion(params.input[0][i], params.input[1][i], params.input[2][i], params.input[3][i]);
+			params.output[i] = quaternion.ToMatrix();
+		}
+	}
+
+#if defined(BATCHMATH_HAS_SIMD)
+	void TransformSimd(const TRANSFORM_PARAMS& params, size_t begin, size_t end)
+	{
+		using namespace MathSimd;
+		Float4 coeffs[16];
+		for(unsigned int j = 0; j < 16; j++)
+		{
+			coeffs[j] = Replicate(params.matrix->coeff[j]);
+		}
+		size_t i = begin;
+		for(; (i + 4) <= end; i += 4)
+		{
+			auto x = LoadUnaligned(params.input[0] + i);
+			auto y = LoadUnaligned(params.input[1] + i);
+			auto z = LoadUnaligned(params.input[2] + i);
+			auto w = params.input[3] ? LoadUnaligned(params.input[3] + i) : Replicate(params.inputW);
+			Float4 results[4];
+			for(unsigned int j = 0; j < 4; j++)
+			{
+				results[j] = Add(Add(Add(Mul(x, coeffs[j]), Mul(y, coeffs[4 + j])), Mul(z, coeffs[8 + j])), Mul(w, coeffs[12 + j]));
+			}
+			for(unsigned int j = 0; j < 4; j++)
+			{
+				if(params.output[j]) StoreUnaligned(params.output[j] + i, results[j]);
+			}
+		}
+		TransformScalar(params, i, end);
+	}
+
+	void NormalizeSimd(const VECTOR3_STREAMS& input, float** output, size_t begin, size_t end)
+	{
+		using namespace MathSimd;
+		size_t i = begin;
+		for(; (i + 4) <= end; i += 4)
+		{
+			auto x = LoadUnaligned(input.x + i);
+			auto y = LoadUnaligned(input.y + i);
+			auto z = LoadUnaligned(input.z + i);
+			auto length = Sqrt(Add(Add(Mul(x, x), Mul(y, y)), Mul(z, z)));
+			StoreUnaligned(output[0] + i, Div(x, length));
+			StoreUnaligned(output[1] + i, Div(y, length));
+			StoreUnaligned(output[2] + i, Div(z, length));
+		}
+		NormalizeScalar(input, output, i, end);
+	}
+
+	void DotSimd(const VECTOR3_STREAMS& lhs, const VECTOR3_STREAMS& rhs, float* output, size_t begin, size_t end)
+	{
+		using namespace MathSimd;
+		size_t i = begin;
+		for(; (i + 4) <= end; i += 4)
+		{
+			auto x = Mul(LoadUnaligned(lhs.x + i), LoadUnaligned(rhs.x + i));
+			auto y = Mul(LoadUnaligned(lhs.y + i), LoadUnaligned(rhs.y + i));
+			auto z = Mul(LoadUnaligned(lhs.z + i), LoadUnaligned(rhs.z + i));
+			StoreUnaligned(output + i, Add(Add(x, y), z));
+		}
+		DotScalar(lhs, rhs, output, i, end);
+	}
+
+	size_t CullSimd(const CPlane* planes, size_t planeCount, const SPHERE_STREAMS& spheres, uint8* visibility, size_t begin, size_t end)
+	{
+		using namespace MathSimd;
+		size_t visibleCount = 0;
+		size_t i = begin;
+		for(; (i + 4) <= end; i += 4)
+		{
+			auto x = LoadUnaligned(spheres.x + i);
+			auto y = LoadUnaligned(spheres.y + i);
+			auto z = LoadUnaligned(spheres.z + i);
+			auto radius = LoadUnaligned(spheres.radius + i);
+			auto minDistance = Replicate(std::numeric_limits<float>::max());
+			for(size_t j = 0; j < planeCount; j++)
+			{
+				const auto& plane = planes[j];
+				auto distance = Add(Add(Mul(x, Replicate(plane.a)), Mul(y, Replicate(plane.b))), Mul(z, Replicate(plane.c)));
+				distance = Add(Sub(distance, Replicate(plane.d)), radius);
+				minDistance = Min(minDistance, distance);
+			}
+			alignas(16) float distances[4];
+			Store(distances, minDistance);
+			for(unsigned int lane = 0; lane < 4; lane++)
+			{
+				bool visible = (distances[lane] >= 0);
+				visibility[i + lane] = visible ? 1 : 0;
+				visibleCount += visible ? 1 : 0;
+			}
+		}
+		return visibleCount + CullScalar(planes, planeCount, spheres, visibility, i, end);
+	}
+
+	size_t CountHits(const float* distances, size_t begin, size_t end)
+	{
+		size_t hitCount = 0;
+		for(size_t i = begin; i < end; i++)
+		{
+			hitCount += (distances[i] != std::numeric_limits<float>::infinity()) ? 1 : 0;
+		}
+		return hitCount;
+	}
+
+	MathSimd::Float4 LoadStream(const STREAM& stream, size_t index)
+	{
+		return stream.values ? MathSimd::LoadUnaligned(stream.values + index) : MathSimd::Replicate(stream.value);
+	}
+
+	size_t IntersectSphereSimd(const RAY_PARAMS& params, size_t begin, size_t end)
+	{
+		using namespace MathSimd;
+		auto zero = Replicate(0.0f);
+		auto infinity = Replicate(std::numeric_limits<float>::infinity());
+		size_t i = begin;
+		for(; (i + 4) <= end; i += 4)
+		{
+			auto dx = LoadStream(params.direction[0], i);
+			auto dy = LoadStream(params.direction[1], i);
+			auto dz = LoadStream(params.direction[2], i);
+			auto radius = LoadStream(params.target[3], i);
+			auto vx = Sub(LoadStream(params.target[0], i), LoadStream(params.position[0], i));
+			auto vy = Sub(LoadStream(params.target[1], i), LoadStream(params.position[1], i));
+			auto vz = Sub(LoadStream(params.target[2], i), LoadStream(params.position[2], i));
+			auto tc = Add(Add(Mul(vx, dx), Mul(vy, dy)), Mul(vz, dz));
+			auto ox = Sub(Mul(tc, dx), vx);
+			auto oy = Sub(Mul(tc, dy), vy);
+			auto oz = Sub(Mul(tc, dz), vz);
+			auto opcLengthSquared = Add(Add(Mul(ox, ox), Mul(oy, oy)), Mul(oz, oz));
+			auto vpcLengthSquared = Add(Add(Mul(vx, vx), Mul(vy, vy)), Mul(vz, vz));
+			auto radiusSquared = Mul(radius, radius);
+			auto dist = Sqrt(Sub(radiusSquared, opcLengthSquared));
+			auto distance = Select(CompareLess(radiusSquared, vpcLengthSquared), Sub(tc, dist), Add(tc, dist));
+			distance = Select(CompareLess(tc, zero), infinity, distance);
+			distance = Select(CompareLess(radiusSquared, opcLengthSquared), infinity, distance);
+			StoreUnaligned(params.output + i, distance);
+		}
+		return CountHits(params.output, begin, i) + IntersectSphereScalar(params, i, end);
+	}
+
+	size_t IntersectPlaneSimd(const RAY_PARAMS& params, size_t begin, size_t end)
+	{
+		using namespace MathSimd;
+		auto zero = Replicate(0.0f);
+		auto infinity = Replicate(std::numeric_limits<float>::infinity());
+		size_t i = begin;
+		for(; (i + 4) <= end; i += 4)
+		{
+			auto a = LoadStream(params.target[0], i);
+			auto b = LoadStream(params.target[1], i);
+			auto c = LoadStream(params.target[2], i);
+			auto dirDot = Add(Add(Mul(a, LoadStream(params.direction[0], i)), Mul(b, LoadStream(params.direction[1], i))), Mul(c, LoadStream(params.direction[2], i)));
+			auto posDot = Add(Add(Mul(LoadStream(params.position[0], i), a), Mul(LoadStream(params.position[1], i), b)), Mul(LoadStream(params.position[2], i), c));
+			auto distance = Div(Sub(LoadStream(params.target[3], i), posDot), dirDot);
+			distance = Select(CompareEqual(dirDot, zero), infinity, distance);
+			StoreUnaligned(params.output + i, distance);
+		}
+		return CountHits(params.output, begin, i) + IntersectPlaneScalar(params, i, end);
+	}
+
+	//acos for x in [0, 1], using Cephes' asinf polynomial
+	MathSimd::Float4 AcosSimd(MathSimd::Float4 x)
+	{
+		using namespace MathSimd;
+		auto half = Replicate(0.5f);
+		//Above 0.5, acos(x) = 2 * asin(sqrt((1 - x) / 2)), below, acos(x) = pi / 2 - asin(x)
+		auto large = CompareLess(half, x);
+		auto z = Select(large, Mul(half, Sub(Replicate(1.0f), x)), Mul(x, x));
+		auto v = Select(large, Sqrt(z), x);
+		auto p = Replicate(4.2163199048e-2f);
+		p = MulAdd(p, z, Replicate(2.4181311049e-2f));
+		p = MulAdd(p, z, Replicate(4.5470025998e-2f));
+		p = MulAdd(p, z, Replicate(7.4953002686e-2f));
+		p = MulAdd(p, z, Replicate(1.6666752422e-1f));
+		auto asin = MulAdd(Mul(v, z), p, v);
+		return Select(large, Add(asin, asin), Sub(Replicate(1.57079632679f), asin));
+	}
+
+	//sin for x in [0, pi], using the Taylor series up to x^11 on [0, pi / 2]
+	MathSimd::Float4 SinSimd(MathSimd::Float4 x)
+	{
+		using namespace MathSimd;
+		//sin(x) = sin(pi - x)
+		x = Min(x, Sub(Replicate(3.14159265359f), x));
+		auto x2 = Mul(x, x);
+		auto p = Replicate(-1.0f / 39916800.0f);
+		p = MulAdd(p, x2, Replicate(1.0f / 362880.0f));
+		p = MulAdd(p, x2, Replicate(-1.0f / 5040.0f));
+		p = MulAdd(p, x2, Replicate(1.0f / 120.0f));
+		p = MulAdd(p, x2, Replicate(-1.0f / 6.0f));
+		return MulAdd(Mul(x, x2), p, x);
+	}
+
+	//Same steps as Slerp, one quaternion per lane
+	void SlerpSimdStep(const MathSimd::Float4* lhs, const MathSimd::Float4* rhs, MathSimd::Float4 alpha, MathSimd::Float4* result)
+	{
+		using namespace MathSimd;
+		auto one = Replicate(1.0f);
+		auto angle = Add(Add(Add(Mul(lhs[0], rhs[0]), Mul(lhs[1], rhs[1])), Mul(lhs[2], rhs[2])), Mul(lhs[3], rhs[3]));
+		//Negating lhs is folded in its scale
+		auto sign = Select(CompareLess(angle, Replicate(0.0f)), Replicate(-1.0f), one);
+		angle = Mul(angle, sign);
+		auto oneMinusAlpha = Sub(one, alpha);
+		auto theta = AcosSimd(angle);
+		auto invSinTheta = Div(one, SinSimd(theta));
+		//Linear interpolation when the quaternions are too close
+		auto linear = CompareLess(Sub(one, angle), Replicate(0.05f));
+		auto scale = Select(linear, oneMinusAlpha, Mul(SinSimd(Mul(theta, oneMinusAlpha)), invSinTheta));
+		auto invScale = Select(linear, alpha, Mul(SinSimd(Mul(theta, alpha)), invSinTheta));
+		scale = Mul(scale, sign);
+		for(unsigned int j = 0; j < 4; j++)
+		{
+			result[j] = Add(Mul(lhs[j], scale), Mul(rhs[j], invScale));
+		}
+	}
+
+	void SlerpSimd(const SLERP_PARAMS& params, size_t begin, size_t end)
+	{
+		using namespace MathSimd;
+		auto alpha = Replicate(params.alpha);
+		Float4 lhs[4];
+		Float4 rhs[4];
+		Float4 result[4];
+		size_t i = begin;
+		for(; (i + 4) <= end; i += 4)
+		{
+			for(unsigned int j = 0; j < 4; j++)
+			{
+				lhs[j] = LoadUnaligned(params.lhs[j] + i);
+				rhs[j] = LoadUnaligned(params.rhs[j] + i);
+			}
+			SlerpSimdStep(lhs, rhs, alpha, result);
+			for(unsigned int j = 0; j < 4; j++)
+			{
+				StoreUnaligned(params.output[j] + i, result[j]);
+			}
+		}
+		if(i != end)
+		{
+			//The remaining elements also go through the approximations, padded with zeros,
+			//so that results don't depend on the element's position in the batch
+			size_t remaining = end - i;
+			alignas(16) float lhsValues[4][4] = {};
+			alignas(16) float rhsValues[4][4] = {};
+			for(unsigned int j = 0; j < 4; j++)
+			{
+				std::copy(params.lhs[j] + i, params.lhs[j] + end, lhsValues[j]);
+				std::copy(params.rhs[j] + i, params.rhs[j] + end, rhsValues[j]);
+				lhs[j] = Load(lhsValues[j]);
+				rhs[j] = Load(rhsValues[j]);
+			}
+			SlerpSimdStep(lhs, rhs, alpha, result);
+			for(unsigned int j = 0; j < 4; j++)
+			{
+				Store(lhsValues[j], result[j]);
+				std::copy(lhsValues[j], lhsValues[j] + remaining, params.output[j] + i);
+			}
+		}
+	}
+
+	void ToMatricesSimd(const TO_MATRICES_PARAMS& params, size_t begin, size_t end)
+	{
+		using namespace MathSimd;
+		auto zero = Replicate(0.0f);
+		auto one = Replicate(1.0f);
+		auto two = Replicate(2.0f);
+		auto lastRow = Set(0, 0, 0, 1);
+		size_t i = begin;
+		for(; (i + 4) <= end; i += 4)
+		{
+			auto x = LoadUnaligned(params.input[0] + i);
+			auto y = LoadUnaligned(params.input[1] + i);
+			auto z = LoadUnaligned(params.input[2] + i);
+			auto w = LoadUnaligned(params.input[3] + i);
+			auto x2 = Mul(two, x);
+			auto y2 = Mul(two, y);
+			auto z2 = Mul(two, z);
+			//Same terms as CQuaternion::ToMatrix, each lane holds a different matrix
+			Float4 rows[3][4] =
+			{
+				{Sub(Sub(one, Mul(y2, y)), Mul(z2, z)), Sub(Mul(x2, y), Mul(z2, w)), Add(Mul(x2, z), Mul(y2, w)), zero},
+				{Add(Mul(x2, y), Mul(z2, w)), Sub(Sub(one, Mul(x2, x)), Mul(z2, z)), Sub(Mul(y2, z), Mul(x2, w)), zero},
+				{Sub(Mul(x2, z), Mul(y2, w)), Add(Mul(y2, z), Mul(x2, w)), Sub(Sub(one, Mul(x2, x)), Mul(y2, y)), zero},
+			};
+			for(unsigned int row = 0; row < 3; row++)
+			{
+				//Gives the row of each matrix
+				Transpose(rows[row][0], rows[row][1], rows[row][2], rows[row][3]);
+				for(unsigned int j = 0; j < 4; j++)
+				{
+					Store(params.output[i + j].coeff + (row * 4), rows[row][j]);
+				}
+			}
+			for(unsigned int j = 0; j < 4; j++)
+			{
+				Store(params.output[i + j].coeff + 12, lastRow);
+			}
+		}
+		ToMatricesScalar(params, i, end);
+	}
+#endif
+
+#if defined(FRAMEWORK_SIMD_HAS_X86_DISPATCH)
+	FRAMEWORK_SIMD_TARGET_AVX2 void TransformAvx2(const TRANSFORM_PARAMS& params, size_t begin, size_t end)
+	{
+		__m256 coeffs[16];
+		for(unsigned int j = 0; j < 16; j++)
+		{
+			coeffs[j] = _mm256_set1_ps(params.matrix->coeff[j]);
+		}
+		size_t i = begin;
+		for(; (i + 8) <= end; i += 8)
+		{
+			__m256 x = _mm256_loadu_ps(params.input[0] + i);
+			__m256 y = _mm256_loadu_ps(params.input[1] + i);
+			__m256 z = _mm256_loadu_ps(params.input[2] + i);
+			__m256 w = params.input[3] ? _mm256_loadu_ps(params.input[3] + i) : _mm256_set1_ps(params.inputW);
+			__m256 results[4];
+			for(unsigned int j = 0; j < 4; j++)
+			{
+				__m256 result = _mm256_add_ps(_mm256_mul_ps(x, coeffs[j]), _mm256_mul_ps(y, coeffs[4 + j]));
+				result = _mm256_add_ps(result, _mm256_mul_ps(z, coeffs[8 + j]));
+				results[j] = _mm256_add_ps(result, _mm256_mul_ps(w, coeffs[12 + j]));
+			}
+			for(unsigned int j = 0; j < 4; j++)
+			{
+				if(params.output[j]) _mm256_storeu_ps(params.output[j] + i, results[j]);
+			}
+		}
+		TransformScalar(params, i, end);
+	}
+
+	FRAMEWORK_SIMD_TARGET_AVX2 void NormalizeAvx2(const VECTOR3_STREAMS& input, float** output, size_t begin, size_t end)
+	{
+		size_t i = begin;
+		for(; (i + 8) <= end; i += 8)
+		{
+			__m256 x = _mm256_loadu_ps(input.x + i);
+			__m256 y = _mm256_loadu_ps(input.y + i);
+			__m256 z = _mm256_loadu_ps(input.z + i);
+			__m256 lengthSquared = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y)), _mm256_mul_ps(z, z));
+			__m256 length = _mm256_sqrt_ps(lengthSquared);
+			_mm256_storeu_ps(output[0] + i, _mm256_div_ps(x, length));
+			_mm256_storeu_ps(output[1] + i, _mm256_div_ps(y, length));
+			_mm256_storeu_ps(output[2] + i, _mm256_div_ps(z, length));
+		}
+		NormalizeScalar(input, output, i, end);
+	}
+
+	FRAMEWORK_SIMD_TARGET_AVX2 void DotAvx2(const VECTOR3_STREAMS& lhs, const VECTOR3_STREAMS& rhs, float* output, size_t begin, size_t end)
+	{
+		size_t i = begin;
+		for(; (i + 8) <= end; i += 8)
+		{
+			__m256 x = _mm256_mul_ps(_mm256_loadu_ps(lhs.x + i), _mm256_loadu_ps(rhs.x + i));
+			__m256 y = _mm256_mul_ps(_mm256_loadu_ps(lhs.y + i), _mm256_loadu_ps(rhs.y + i));
+			__m256 z = _mm256_mul_ps(_mm256_loadu_ps(lhs.z + i), _mm256_loadu_ps(rhs.z + i));
+			_mm256_storeu_ps(output + i, _mm256_add_ps(_mm256_add_ps(x, y), z));
+		}
+		DotScalar(lhs, rhs, output, i, end);
+	}
+
+	FRAMEWORK_SIMD_TARGET_AVX2 size_t CullAvx2(const CPlane* planes, size_t planeCount, const SPHERE_STREAMS& spheres, uint8* visibility, size_t begin, size_t end)
+	{
+		size_t visibleCount = 0;
+		size_t i = begin;
+		for(; (i + 8) <= end; i += 8)
+		{
+			__m256 x = _mm256_loadu_ps(spheres.x + i);
+			__m256 y = _mm256_loadu_ps(spheres.y + i);
+			__m256 z = _mm256_loadu_ps(spheres.z + i);
+			__m256 radius = _mm256_loadu_ps(spheres.radius + i);
+			__m256 minDistance = _mm256_set1_ps(std::numeric_limits<float>::max());
+			for(size_t j = 0; j < planeCount; j++)
+			{
+				const auto& plane = planes[j];
+				__m256 distance = _mm256_add_ps(_mm256_mul_ps(x, _mm256_set1_ps(plane.a)), _mm256_mul_ps(y, _mm256_set1_ps(plane.b)));
+				distance = _mm256_add_ps(distance, _mm256_mul_ps(z, _mm256_set1_ps(plane.c)));
+				distance = _mm256_add_ps(_mm256_sub_ps(distance, _mm256_set1_ps(plane.d)), radius);
+				minDistance = _mm256_min_ps(minDistance, distance);
+			}
+			//One bit per sphere, set when visible
+			unsigned int visibleMask = _mm256_movemask_ps(_mm256_cmp_ps(minDistance, _mm256_setzero_ps(), _CMP_GE_OQ));
+			for(unsigned int lane = 0; lane < 8; lane++)
+			{
+				unsigned int visible = (visibleMask >> lane) & 1;
+				visibility[i + lane] = static_cast<uint8>(visible);
+				visibleCount += visible;
+			}
+		}
+		return visibleCount + CullScalar(planes, planeCount, spheres, visibility, i, end);
+	}
+
+	FRAMEWORK_SIMD_TARGET_AVX2 __m256 LoadStreamAvx2(const STREAM& stream, size_t index)
+	{
+		return stream.values ? _mm256_loadu_ps(stream.values + index) : _mm256_set1_ps(stream.value);
+	}
+
+	FRAMEWORK_SIMD_TARGET_AVX2 size_t IntersectSphereAvx2(const RAY_PARAMS& params, size_t begin, size_t end)
+	{
+		__m256 zero = _mm256_setzero_ps();
+		__m256 infinity = _mm256_set1_ps(std::numeric_limits<float>::infinity());
+		size_t i = begin;
+		for(; (i + 8) <= end; i += 8)
+		{
+			__m256 dx = LoadStreamAvx2(params.direction[0], i);
+			__m256 dy = LoadStreamAvx2(params.direction[1], i);
+			__m256 dz = LoadStreamAvx2(params.direction[2], i);
+			__m256 radius = LoadStreamAvx2(params.target[3], i);
+			__m256 vx = _mm256_sub_ps(LoadStreamAvx2(params.target[0], i), LoadStreamAvx2(params.position[0], i));
+			__m256 vy = _mm256_sub_ps(LoadStreamAvx2(params.target[1], i), LoadStreamAvx2(params.position[1], i));
+			__m256 vz = _mm256_sub_ps(LoadStreamAvx2(params.target[2], i), LoadStreamAvx2(params.position[2], i));
+			__m256 tc = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(vx, dx), _mm256_mul_ps(vy, dy)), _mm256_mul_ps(vz, dz));
+			__m256 ox = _mm256_sub_ps(_mm256_mul_ps(tc, dx), vx);
+			__m256 oy = _mm256_sub_ps(_mm256_mul_ps(tc, dy), vy);
+			__m256 oz = _mm256_sub_ps(_mm256_mul_ps(tc, dz), vz);
+			__m256 opcLengthSquared = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ox, ox), _mm256_mul_ps(oy, oy)), _mm256_mul_ps(oz, oz));
+			__m256 vpcLengthSquared = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(vx, vx), _mm256_mul_ps(vy, vy)), _mm256_mul_ps(vz, vz));
+			__m256 radiusSquared = _mm256_mul_ps(radius, radius);
+			__m256 dist = _mm256_sqrt_ps(_mm256_sub_ps(radiusSquared, opcLengthSquared));
+			__m256 outside = _mm256_cmp_ps(radiusSquared, vpcLengthSquared, _CMP_LT_OQ);
+			__m256 distance = _mm256_blendv_ps(_mm256_add_ps(tc, dist), _mm256_sub_ps(tc, dist), outside);
+			__m256 miss = _mm256_or_ps(_mm256_cmp_ps(tc, zero, _CMP_LT_OQ), _mm256_cmp_ps(radiusSquared, opcLengthSquared, _CMP_LT_OQ));
+			_mm256_storeu_ps(params.output + i, _mm256_blendv_ps(distance, infinity, miss));
+		}
+		return CountHits(params.output, begin, i) + IntersectSphereScalar(params, i, end);
+	}
+
+	FRAMEWORK_SIMD_TARGET_AVX2 size_t IntersectPlaneAvx2(const RAY_PARAMS& params, size_t begin, size_t end)
+	{
+		__m256 zero = _mm256_setzero_ps();
+		__m256 infinity = _mm256_set1_ps(std::numeric_limits<float>::infinity());
+		size_t i = begin;
+		for(; (i + 8) <= end; i += 8)
+		{
+			__m256 a = LoadStreamAvx2(params.target[0], i);
+			__m256 b = LoadStreamAvx2(params.target[1], i);
+			__m256 c = LoadStreamAvx2(params.target[2], i);
+			__m256 dirDot = _mm256_add_ps(_mm256_mul_ps(a, LoadStreamAvx2(params.direction[0], i)), _mm256_mul_ps(b, LoadStreamAvx2(params.direction[1], i)));
+			dirDot = _mm256_add_ps(dirDot, _mm256_mul_ps(c, LoadStreamAvx2(params.direction[2], i)));
+			__m256 posDot = _mm256_add_ps(_mm256_mul_ps(LoadStreamAvx2(params.position[0], i), a), _mm256_mul_ps(LoadStreamAvx2(params.position[1], i), b));
+			posDot = _mm256_add_ps(posDot, _mm256_mul_ps(LoadStreamAvx2(params.position[2], i), c));
+			__m256 distance = _mm256_div_ps(_mm256_sub_ps(LoadStreamAvx2(params.target[3], i), posDot), dirDot);
+			_mm256_storeu_ps(params.output + i, _mm256_blendv_ps(distance, infinity, _mm256_cmp_ps(dirDot, zero, _CMP_EQ_OQ)));
+		}
+		return CountHits(params.output, begin, i) + IntersectPlaneScalar(params, i, end);
+	}
+#endif
+
+	const KERNELS& GetKernels()
+	{
+		static const KERNELS kernels = []() {
+			CKernelDispatcher<KERNELS> dispatcher({&TransformScalar, &NormalizeScalar, &DotScalar, &CullScalar,
+			                                             &IntersectSphereScalar, &IntersectPlaneScalar, &SlerpScalar, &ToMatricesScalar});
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+			dispatcher.Register(CCpuFeatures::FEATURE_SSE2, {&TransformSimd, &NormalizeSimd, &DotSimd, &CullSimd,
+			                                                  &IntersectSphereSimd, &IntersectPlaneSimd, &SlerpSimd, &ToMatricesSimd});
+#if defined(FRAMEWORK_SIMD_HAS_X86_DISPATCH)
+			//Slerp and ToMatrices have no 8 wide versions
+			dispatcher.Register(CCpuFeatures::FEATURE_AVX2, {&TransformAvx2, &NormalizeAvx2, &DotAvx2, &CullAvx2,
+			                                                  &IntersectSphereAvx2, &IntersectPlaneAvx2, &SlerpSimd, &ToMatricesSimd});
+#endif
+#elif defined(BATCHMATH_HAS_SIMD)
+			dispatcher.Register(CCpuFeatures::FEATURE_NEON, {&TransformSimd, &NormalizeSimd, &DotSimd, &CullSimd,
+			                                                  &IntersectSphereSimd, &IntersectPlaneSimd, &SlerpSimd, &ToMatricesSimd});
+#endif
+			return dispatcher.Get();
+		}();
+		return kernels;
+	}
+
+	size_t GetGrainSize(CThreadPool* threadPool, size_t count)
+	{
+		size_t grainSize = GetParallelGrainSize(threadPool, count);
+		return (grainSize + MAX_LANE_COUNT - 1) & ~static_cast<size_t>(MAX_LANE_COUNT - 1);
+	}
+
+	template <typename FunctionType>
+	void Run(CThreadPool* threadPool, size_t count, const FunctionType& function)
+	{
+		if(!threadPool || (count < PARALLEL_THRESHOLD))
+		{
+			function(0, count);
+			return;
+		}
+		ParallelFor(threadPool, 0, count, function, GetGrainSize(threadPool, count));
+	}
+
+	//Same as Run, for kernels returning a count
+	template <typename FunctionType>
+	size_t RunCount(CThreadPool* threadPool, size_t count, const FunctionType& function)
+	{
+		if(!threadPool || (count < PARALLEL_THRESHOLD))
+		{
+			return function(0, count);
+		}
+		return ParallelReduce<size_t>(threadPool, 0, count, 0, function, std::plus<size_t>(), GetGrainSize(threadPool, count));
+	}
+
+	void TransformRange(CThreadPool* threadPool, size_t count, const TRANSFORM_PARAMS& params)
+	{
+		auto transform = GetKernels().transform;
+		Run(threadPool, count, [&](size_t begin, size_t end) { transform(params, begin, end); });
+	}
+
+	VECTOR3_STREAMS GetStreams(const CVector3Array& vectors)
+	{
+		return VECTOR3_STREAMS{vectors.GetX(), vectors.GetY(), vectors.GetZ()};
+	}
+
+	void SetStreams(STREAM* streams, const CVector3& vector)
+	{
+		streams[0] = STREAM{nullptr, vector.x};
+		streams[1] = STREAM{nullptr, vector.y};
+		streams[2] = STREAM{nullptr, vector.z};
+	}
+
+	void SetStreams(STREAM* streams, const CVector3Array& vectors)
+	{
+		streams[0] = STREAM{vectors.GetX(), 0};
+		streams[1] = STREAM{vectors.GetY(), 0};
+		streams[2] = STREAM{vectors.GetZ(), 0};
+	}
+
+	void SetRayStreams(RAY_PARAMS& params, const CRay& ray)
+	{
+		SetStreams(params.position, ray.position);
+		SetStreams(params.direction, ray.direction);
+	}
+
+	void SetRayStreams(RAY_PARAMS& params, const CRayArray& rays)
+	{
+		SetStreams(params.position, rays.GetPositions());
+		SetStreams(params.direction, rays.GetDirections());
+	}
+
+	void SetTargetStreams(RAY_PARAMS& params, const CSphere& sphere)
+	{
+		SetStreams(params.target, sphere.position);
+		params.target[3] = STREAM{nullptr, sphere.radius};
+	}
+
+	void SetTargetStreams(RAY_PARAMS& params, const CSphereArray& spheres)
+	{
+		SetStreams(params.target, spheres.GetPositions());
+		params.target[3] = STREAM{spheres.GetRadii(), 0};
+	}
+
+	void SetTargetStreams(RAY_PARAMS& params, const CPlane& plane)
+	{
+		params.target[0] = STREAM{nullptr, plane.a};
+		params.target[1] = STREAM{nullptr, plane.b};
+		params.target[2] = STREAM{nullptr, plane.c};
+		params.target[3] = STREAM{nullptr, plane.d};
+	}
+
+	void SetTargetStreams(RAY_PARAMS& params, const CPlaneArray& planes)
+	{
+		params.target[0] = STREAM{planes.GetA(), 0};
+		params.target[1] = STREAM{planes.GetB(), 0};
+		params.target[2] = STREAM{planes.GetC(), 0};
+		params.target[3] = STREAM{planes.GetD(), 0};
+	}
+
+	//Either the rays or the targets are single objects, the other one gives the element count
+	template <typename RayType, typename TargetType>
+	size_t Intersect(IntersectFunction intersect, const RayType& rays, const TargetType& targets, size_t count, std::vector<float>& distances, CThreadPool* threadPool)
+	{
+		distances.resize(count);
+		RAY_PARAMS params = {};
+		SetRayStreams(params, rays);
+		SetTargetStreams(params, targets);
+		params.output = distances.data();
+		return RunCount(threadPool, count, [&](size_t begin, size_t end) { return intersect(params, begin, end); });
+	}
+}
+
+void BatchMath::TransformPoints(const CMatrix4& matrix, const CVector3Array& input, CVector3Array& output, CThreadPool* threadPool)
+{
+	output.Resize(input.GetSize());
+	TRANSFORM_PARAMS params = {&matrix, {input.GetX(), input.GetY(), input.GetZ(), nullptr}, 1.0f, {output.GetX(), output.GetY(), output.GetZ(), nullptr}};
+	TransformRange(threadPool, input.GetSize(), params);
+}
+
+void BatchMath::TransformVectors(const CMatrix4& matrix, const CVector3Array& input, CVector3Array& output, CThreadPool* threadPool)
+{
+	output.Resize(input.GetSize());
+	TRANSFORM_PARAMS params = {&matrix, {input.GetX(), input.GetY(), input.GetZ(), nullptr}, 0.0f, {output.GetX(), output.GetY(), output.GetZ(), nullptr}};
+	TransformRange(threadPool, input.GetSize(), params);
+}
+
+void BatchMath::Transform(const CMatrix4& matrix, const CVector4Array& input, CVector4Array& output, CThreadPool* threadPool)
+{
+	output.Resize(input.GetSize());
+	TRANSFORM_PARAMS params = {&matrix, {input.GetX(), input.GetY(), input.GetZ(), input.GetW()}, 0.0f, {output.GetX(), output.GetY(), output.GetZ(), output.GetW()}};
+	TransformRange(threadPool, input.GetSize(), params);
+}
+
+void BatchMath::Normalize(const CVector3Array& input, CVector3Array& output, CThreadPool* threadPool)
+{
+	output.Resize(input.GetSize());
+	auto inputStreams = GetStreams(input);
+	float* outputStreams[3] = {output.GetX(), output.GetY(), output.GetZ()};
+	auto normalize = GetKernels().normalize;
+	Run(threadPool, input.GetSize(), [&](size_t begin, size_t end) { normalize(inputStreams, outputStreams, begin, end); });
+}
+
+void BatchMath::Dot(const CVector3Array& lhs, const CVector3Array& rhs, std::vector<float>& output, CThreadPool* threadPool)
+{
+	size_t count = std::min(lhs.GetSize(), rhs.GetSize());
+	output.resize(count);
+	auto lhsStreams = GetStreams(lhs);
+	auto rhsStreams = GetStreams(rhs);
+	float* outputStream = output.data();
+	auto dot = GetKernels().dot;
+	Run(threadPool, count, [&](size_t begin, size_t end) { dot(lhsStreams, rhsStreams, outputStream, begin, end); });
+}
+
+size_t BatchMath::CullSpheres(const CPlane* planes, size_t planeCount, const CSphereArray& spheres, std::vector<uint8>& visibility, CThreadPool* threadPool)
+{
+	size_t count = spheres.GetSize();
+	visibility.resize(count);
+	const auto& positions = spheres.GetPositions();
+	SPHERE_STREAMS sphereStreams = {positions.GetX(), positions.GetY(), positions.GetZ(), spheres.GetRadii()};
+	uint8* visibilityStream = visibility.data();
+	auto cull = GetKernels().cull;
+	return RunCount(threadPool, count, [&](size_t begin, size_t end) { return cull(planes, planeCount, sphereStreams, visibilityStream, begin, end); });
+}
+
+void BatchMath::PlaneDistances(const CPlane& plane, const CVector3Array& points, std::vector<float>& distances, CThreadPool* threadPool)
+{
+	//Transform by a matrix with the plane as its first column, keeping only the first component
+	CMatrix4 matrix;
+	matrix(0, 0) = plane.a;
+	matrix(1, 0) = plane.b;
+	matrix(2, 0) = plane.c;
+	matrix(3, 0) = -plane.d;
+	distances.resize(points.GetSize());
+	TRANSFORM_PARAMS params = {&matrix, {points.GetX(), points.GetY(), points.GetZ(), nullptr}, 1.0f, {distances.data(), nullptr, nullptr, nullptr}};
+	TransformRange(threadPool, points.GetSize(), params);
+}
+
+size_t BatchMath::IntersectSpheres(const CRay& ray, const CSphereArray& spheres, std::vector<float>& distances, CThreadPool* threadPool)
+{
+	return Intersect(GetKernels().intersectSphere, ray, spheres, spheres.GetSize(), distances, threadPool);
+}
+
+size_t BatchMath::IntersectPlanes(const CRay& ray, const CPlaneArray& planes, std::vector<float>& distances, CThreadPool* threadPool)
+{
+	return Intersect(GetKernels().intersectPlane, ray, planes, planes.GetSize(), distances, threadPool);
+}
+
+size_t BatchMath::IntersectSphere(const CRayArray& rays, const CSphere& sphere, std::vector<float>& distances, CThreadPool* threadPool)
+{
+	return Intersect(GetKernels().intersectSphere, rays, sphere, rays.GetSize(), distances, threadPool);
+}
+
+size_t BatchMath::IntersectPlane(const CRayArray& rays, const CPlane& plane, std::vector<float>& distances, CThreadPool* threadPool)
+{
+	return Intersect(GetKernels().intersectPlane, rays, plane, rays.GetSize(), distances, threadPool);
+}
+
+void BatchMath::Slerp(const CQuaternionArray& lhs, const CQuaternionArray& rhs, float alpha, CQuaternionArray& output, CThreadPool* threadPool)
+{
+	size_t count = std::min(lhs.GetSize(), rhs.GetSize());
+	output.Resize(count);
+	SLERP_PARAMS params = {{lhs.GetX(), lhs.GetY(), lhs.GetZ(), lhs.GetW()}, {rhs.GetX(), rhs.GetY(), rhs.GetZ(), rhs.GetW()}, alpha, {output.GetX(), output.GetY(), output.GetZ(), output.GetW()}};
+	auto slerp = GetKernels().slerp;
+	Run(threadPool, count, [&](size_t begin, size_t end) { slerp(params, begin, end); });
+}
+
+void BatchMath::ToMatrices(const CQuaternionArray& quaternions, std::vector<CMatrix4>& matrices, CThreadPool* threadPool)
+{
+	matrices.resize(quaternions.GetSize());
+	TO_MATRICES_PARAMS params = {{quaternions.GetX(), quaternions.GetY(), quaternions.GetZ(), quaternions.GetW()}, matrices.data()};
+	auto toMatrices = GetKernels().toMatrices;
+	Run(threadPool, quaternions.GetSize(), [&](size_t begin, size_t end) { toMatrices(params, begin, end); });
+}
@@ -1,42 +1,99 @@
-#include "string_format.h"
 #include "math/MathStringUtils.h"
-#include <vector>
-#include <sstream>
-#include <algorithm>
+#include <charconv>
 #include "StringUtils.h"
 
-float MathStringUtils::ParseFloat(const std::string& valueString)
+#if !defined(__cpp_lib_to_chars)
+//Floating point support for to_chars/from_chars is missing from some standard libraries (libc++
+//before LLVM 20, for Android and older Apple targets), fall back on streams using the classic locale
+#include <sstream>
+#endif
+
+bool MathStringUtils::TryParseFloat(std::string_view text, float& value)
 {
+	text = StringUtils::TrimStartView(text);
+	if(!text.empty() && (text[0] == '+'))
+	{
+		text.remove_prefix(1);
+	}
+#if defined(__cpp_lib_to_chars)
+	auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+	return result.ec == std::errc();
+#else
+	std::istringstream stream{std::string(text)};
+	stream.imbue(std::locale::classic());
 	float result = 0;
-	std::stringstream ss;
-	ss.imbue(std::locale::classic());
-	ss << valueString;
-	ss >> result;
+	stream >> result;
+	if(stream.fail()) return false;
+	value = result;
+	return true;
+#endif
+}
+
+float MathStringUtils::ParseFloat(std::string_view text)
+{
+	float result = 0;
+	TryParseFloat(text, result);
 	return result;
 }
 
-CVector2 MathStringUtils::ParseVector2(const std::string& vectorString)
+CVector2 MathStringUtils::ParseVector2(std::string_view vectorString)
 {
-	std::vector<std::string> components = StringUtils::Split(vectorString, ',', true);
 	CVector2 result(0, 0);
-	if(components.size() != 2) return result;
-	result.x = ParseFloat(components[0]);
-	result.y = ParseFloat(components[1]);
+	float components[2] = {};
+	unsigned int componentCount = 0;
+	for(const auto& component : StringUtils::SplitView(vectorString, ','))
+	{
+		if(componentCount == 2) return result;
+		components[componentCount++] = ParseFloat(component);
+	}
+	if(componentCount != 2) return result;
+	result.x = components[0];
+	result.y = components[1];
 	return result;
 }
 
-CVector3 MathStringUtils::ParseVector3(const std::string& vectorString)
+CVector3 MathStringUtils::ParseVector3(std::string_view vectorString)
 {
-	std::vector<std::string> components = StringUtils::Split(vectorString, ',', true);
 	CVector3 result(0, 0, 0);
-	if(components.size() != 3) return result;
-	result.x = ParseFloat(components[0]);
-	result.y = ParseFloat(components[1]);
-	result.z = ParseFloat(components[2]);
+	float components[3] = {};
+	unsigned int componentCount = 0;
+	for(const auto& component : StringUtils::SplitView(vectorString, ','))
+	{
+		if(componentCount == 3) return result;
+		components[componentCount++] = ParseFloat(component);
+	}
+	if(componentCount != 3) return result;
+	result.x = components[0];
+	result.y = components[1];
+	result.z = components[2];
+	return result;
+}
+
+std::string MathStringUtils::ToString(float value)
+{
+#if defined(__cpp_lib_to_chars)
+	//Longest shortest representation is 15 characters ("-1.17549435e-38")
+	char buffer[32];
+	auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+	return std::string(buffer, result.ptr);
+#else
+	//Increase the precision until the text round trips, 9 digits are always enough for a float
+	std::string result;
+	for(int precision = 1; precision <= 9; precision++)
+	{
+		std::ostringstream stream;
+		stream.imbue(std::locale::classic());
+		stream.precision(precision);
+		stream << value;
+		result = stream.str();
+		float parsedValue = 0;
+		if(TryParseFloat(result, parsedValue) && (parsedValue == value)) break;
+	}
 	return result;
+#endif
 }
 
 std::string MathStringUtils::ToString(const CVector3& vector)
 {
-	return string_format("%f, %f, %f", vector.x, vector.y, vector.z);
+	return ToString(vector.x) + ", " + ToString(vector.y) + ", " + ToString(vector.z);
 }
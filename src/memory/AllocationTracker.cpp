@@ -0,0 +1,325 @@
+#include "memory/AllocationTracker.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <new>
+#include "AlignedAlloc.h"
+#include "string_format.h"
+
+using namespace Framework;
+using namespace Framework::Memory;
+
+namespace
+{
+	//Stored right before the memory returned by CAllocationTracker::Allocate
+	struct ALLOCATION_HEADER
+	{
+		const char*	site;
+		size_t		size;
+		//Distance between the start of the underlying allocation and the returned pointer
+		size_t		offset;
+		uint32		generation;
+		uint16		subsystem;
+		uint16		tracked;
+	};
+
+	const char* g_unknownSite = "unknown";
+
+	ALLOCATION_HEADER* GetHeader(void* ptr)
+	{
+		return reinterpret_cast<ALLOCATION_HEADER*>(reinterpret_cast<uint8*>(ptr) - sizeof(ALLOCATION_HEADER));
+	}
+}
+
+CAllocationTracker::CAllocationTracker()
+: m_enabled(false)
+, m_generation(0)
+{
+	Reset();
+}
+
+void CAllocationTracker::SetEnabled(bool enabled)
+{
+	m_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool CAllocationTracker::IsEnabled() const
+{
+	return m_enabled.load(std::memory_order_relaxed);
+}
+
+void CAllocationTracker::RecordAllocation(SUBSYSTEM subsystem, const char* site, size_t size)
+{
+	assert(subsystem < SUBSYSTEM_COUNT);
+	if(!site) site = g_unknownSite;
+
+	auto& counters = m_counters[subsystem];
+	uint64 liveBytes = counters.liveBytes.fetch_add(size, std::memory_order_relaxed) + size;
+	counters.allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+	counters.allocationCount.fetch_add(1, std::memory_order_relaxed);
+	uint64 peakBytes = counters.peakBytes.load(std::memory_order_relaxed);
+	while((liveBytes > peakBytes) && !counters.peakBytes.compare_exchange_weak(peakBytes, liveBytes, std::memory_order_relaxed))
+	{
+	}
+
+	std::lock_guard<std::mutex> lock(m_sitesMutex);
+	auto& siteInfo = m_sites[site];
+	siteInfo.subsystem = subsystem;
+	siteInfo.liveBytes += size;
+	siteInfo.allocatedBytes += size;
+	siteInfo.allocationCount++;
+}
+
+void CAllocationTracker::RecordFree(SUBSYSTEM subsystem, const char* site, size_t size)
+{
+	assert(subsystem < SUBSYSTEM_COUNT);
+	if(!site) site = g_unknownSite;
+
+	auto& counters = m_counters[subsystem];
+	counters.liveBytes.fetch_sub(size, std::memory_order_relaxed);
+	counters.freeCount.fetch_add(1, std::memory_order_relaxed);
+
+	std::lock_guard<std::mutex> lock(m_sitesMutex);
+	auto siteIterator = m_sites.find(site);
+	if(siteIterator != std::end(m_sites))
+	{
+		assert(siteIterator->second.liveBytes >= size);
+		siteIterator->second.liveBytes -= size;
+	}
+}
+
+void* CAllocationTracker::Allocate(SUBSYSTEM subsystem, const char* site, size_t size, size_t alignment)
+{
+	alignment = std::max(alignment, alignof(ALLOCATION_HEADER));
+	size_t offset = ((sizeof(ALLOCATION_HEADER) + alignment - 1) / alignment) * alignment;
+	auto base = reinterpret_cast<uint8*>(framework_aligned_alloc(offset + size, alignment));
+	if(!base)
+	{
+		throw std::bad_alloc();
+	}
+
+	void* result = base + offset;
+	auto header = GetHeader(result);
+	header->site = site;
+	header->size = size;
+	header->offset = offset;
+	header->subsystem = static_cast<uint16>(subsystem);
+	header->tracked = IsEnabled();
+	header->generation = m_generation.load(std::memory_order_relaxed);
+	if(header->tracked)
+	{
+		RecordAllocation(subsystem, site, size);
+	}
+	return result;
+}
+
+void* CAllocationTracker::Reallocate(void* ptr, size_t size, size_t alignment)
+{
+	assert(ptr);
+	auto header = GetHeader(ptr);
+	auto result = Allocate(static_cast<SUBSYSTEM>(header->subsystem), header->site, size, alignment);
+	memcpy(result, ptr, std::min(size, header->size));
+	Free(ptr);
+	return result;
+}
+
+void CAllocationTracker::Free(void* ptr)
+{
+	if(!ptr) return;
+	auto header = GetHeader(ptr);
+	if(header->tracked && (header->generation == m_generation.load(std::memory_order_relaxed)))
+	{
+		RecordFree(static_cast<SUBSYSTEM>(header->subsystem), header->site, header->size);
+	}
+	framework_aligned_free(reinterpret_cast<uint8*>(ptr) - header->offset);
+}
+
+CAllocationTracker::SNAPSHOT CAllocationTracker::GetSnapshot(size_t topSiteCount)
+{
+	SNAPSHOT snapshot;
+
+	std::lock_guard<std::mutex> snapshotLock(m_snapshotMutex);
+	auto currentTime = std::chrono::steady_clock::now();
+	double elapsedSeconds = std::chrono::duration<double>(currentTime - m_lastSnapshotTime).count();
+	for(unsigned int i = 0; i < SUBSYSTEM_COUNT; i++)
+	{
+		const auto& counters = m_counters[i];
+		auto& stats = snapshot.subsystems[i];
+		stats.liveBytes = counters.liveBytes.load(std::memory_order_relaxed);
+		stats.peakBytes = counters.peakBytes.load(std::memory_order_relaxed);
+		stats.allocatedBytes = counters.allocatedBytes.load(std::memory_order_relaxed);
+		stats.allocationCount = counters.allocationCount.load(std::memory_order_relaxed);
+		stats.freeCount = counters.freeCount.load(std::memory_order_relaxed);
+		if(elapsedSeconds > 0)
+		{
+			stats.allocationRate = static_cast<double>(stats.allocatedBytes - m_lastAllocatedBytes[i]) / elapsedSeconds;
+		}
+		m_lastAllocatedBytes[i] = stats.allocatedBytes;
+	}
+	m_lastSnapshotTime = currentTime;
+
+	{
+		std::lock_guard<std::mutex> sitesLock(m_sitesMutex);
+		snapshot.topSites.reserve(m_sites.size());
+		for(const auto& sitePair : m_sites)
+		{
+			SITE_STATS siteStats;
+			siteStats.site = sitePair.first;
+			siteStats.subsystem = sitePair.second.subsystem;
+			siteStats.liveBytes = sitePair.second.liveBytes;
+			siteStats.allocatedBytes = sitePair.second.allocatedBytes;
+			siteStats.allocationCount = sitePair.second.allocationCount;
+			snapshot.topSites.push_back(siteStats);
+		}
+	}
+	auto compareSites =
+		[](const SITE_STATS& site1, const SITE_STATS& site2) {
+			if(site1.liveBytes != site2.liveBytes) return site1.liveBytes > site2.liveBytes;
+			return site1.allocatedBytes > site2.allocatedBytes;
+		};
+	topSiteCount = std::min(topSiteCount, snapshot.topSites.size());
+	std::partial_sort(snapshot.topSites.begin(), snapshot.topSites.begin() + topSiteCount, snapshot.topSites.end(), compareSites);
+	snapshot.topSites.resize(topSiteCount);
+
+	return snapshot;
+}
+
+uint32 CAllocationTracker::GetGeneration() const
+{
+	return m_generation.load(std::memory_order_relaxed);
+}
+
+void CAllocationTracker::Reset()
+{
+	std::lock_guard<std::mutex> snapshotLock(m_snapshotMutex);
+	std::lock_guard<std::mutex> sitesLock(m_sitesMutex);
+	m_generation.fetch_add(1, std::memory_order_relaxed);
+	for(auto& counters : m_counters)
+	{
+		counters.liveBytes = 0;
+		counters.peakBytes = 0;
+		counters.allocatedBytes = 0;
+		counters.allocationCount = 0;
+		counters.freeCount = 0;
+	}
+	m_sites.clear();
+	m_lastSnapshotTime = std::chrono::steady_clock::now();
+	m_lastAllocatedBytes.fill(0);
+}
+
+std::string CAllocationTracker::DumpJson(size_t topSiteCount)
+{
+	auto snapshot = GetSnapshot(topSiteCount);
+	std::string result = "{\"subsystems\":{";
+	for(unsigned int i = 0; i < SUBSYSTEM_COUNT; i++)
+	{
+		const auto& stats = snapshot.subsystems[i];
+		if(i != 0) result += ",";
+		string_format_to(result, FORMAT_STRING("\"{}\":{{\"liveBytes\":{},\"peakBytes\":{},\"allocatedBytes\":{},\"allocationCount\":{},\"freeCount\":{},\"allocationRate\":{}}}"),
+		                 GetSubsystemName(static_cast<SUBSYSTEM>(i)), stats.liveBytes, stats.peakBytes, stats.allocatedBytes,
+		                 stats.allocationCount, stats.freeCount, static_cast<uint64>(stats.allocationRate));
+	}
+	result += "},\"topSites\":[";
+	for(size_t i = 0; i < snapshot.topSites.size(); i++)
+	{
+		const auto& site = snapshot.topSites[i];
+		if(i != 0) result += ",";
+		//Sites are file paths and line numbers, only escape what would break the output
+		std::string name;
+		for(auto nameChar : std::string(site.site))
+		{
+			if((nameChar == '\"') || (nameChar == '\\')) name += '\\';
+			name += nameChar;
+		}
+		string_format_to(result, FORMAT_STRING("{{\"site\":\"{}\",\"subsystem\":\"{}\",\"liveBytes\":{},\"allocatedBytes\":{},\"allocationCount\":{}}}"),
+		                 name, GetSubsystemName(site.subsystem), site.liveBytes, site.allocatedBytes, site.allocationCount);
+	}
+	result += "]}";
+	return result;
+}
+
+const char* CAllocationTracker::GetSubsystemName(SUBSYSTEM subsystem)
+{
+	switch(subsystem)
+	{
+	case SUBSYSTEM_OTHER:
+		return "other";
+	case SUBSYSTEM_XML:
+		return "xml";
+	case SUBSYSTEM_BITMAP:
+		return "bitmap";
+	case SUBSYSTEM_ZIP:
+		return "zip";
+	case SUBSYSTEM_HTTP:
+		return "http";
+	case SUBSYSTEM_VULKAN:
+		return "vulkan";
+	default:
+		assert(false);
+		return "";
+	}
+}
+
+CAllocationRecord::CAllocationRecord(CAllocationTracker::SUBSYSTEM subsystem, const char* site, size_t size)
+: m_subsystem(subsystem)
+, m_site(site)
+{
+	auto& tracker = CAllocationTracker::GetInstance();
+	m_tracked = tracker.IsEnabled();
+	if(m_tracked)
+	{
+		m_generation = tracker.GetGeneration();
+		m_size = size;
+		tracker.RecordAllocation(m_subsystem, m_site, m_size);
+	}
+}
+
+CAllocationRecord::CAllocationRecord(CAllocationRecord&& src)
+{
+	*this = std::move(src);
+}
+
+CAllocationRecord::~CAllocationRecord()
+{
+	Release();
+}
+
+CAllocationRecord& CAllocationRecord::operator =(CAllocationRecord&& src)
+{
+	Release();
+	m_subsystem = src.m_subsystem;
+	m_site = src.m_site;
+	m_size = src.m_size;
+	m_generation = src.m_generation;
+	m_tracked = src.m_tracked;
+	src.m_tracked = false;
+	src.m_size = 0;
+	return *this;
+}
+
+void CAllocationRecord::SetSize(size_t size)
+{
+	if(!m_tracked || (size == m_size)) return;
+	auto& tracker = CAllocationTracker::GetInstance();
+	if(m_generation != tracker.GetGeneration())
+	{
+		//Counters were reset, start over from here
+		m_generation = tracker.GetGeneration();
+		m_size = 0;
+	}
+	//Recorded as a new allocation replacing the previous one, like a container growing
+	tracker.RecordFree(m_subsystem, m_site, m_size);
+	tracker.RecordAllocation(m_subsystem, m_site, size);
+	m_size = size;
+}
+
+void CAllocationRecord::Release()
+{
+	if(!m_tracked) return;
+	auto& tracker = CAllocationTracker::GetInstance();
+	if(m_generation == tracker.GetGeneration())
+	{
+		tracker.RecordFree(m_subsystem, m_site, m_size);
+	}
+	m_tracked = false;
+}
@@ -0,0 +1,134 @@
+#include "memory/Arena.h"
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include "AlignedAlloc.h"
+
+using namespace Framework::Memory;
+
+static const size_t g_chunkHeaderSize = 64;
+
+CArena::CArena(size_t chunkSize)
+: m_chunkSize(chunkSize)
+{
+	assert(m_chunkSize != 0);
+}
+
+CArena::CArena(void* region, size_t regionSize, size_t chunkSize)
+: m_chunkSize(chunkSize)
+, m_region(reinterpret_cast<uint8*>(region))
+, m_regionSize(regionSize)
+{
+	assert(m_chunkSize != 0);
+	m_current = m_region;
+	m_end = m_region + m_regionSize;
+}
+
+CArena::~CArena()
+{
+	FreeChunks(m_chunks);
+	FreeChunks(m_spareChunk);
+}
+
+void* CArena::Allocate(size_t size, size_t alignment)
+{
+	assert((alignment != 0) && ((alignment & (alignment - 1)) == 0));
+	auto alignedCurrent = reinterpret_cast<uint8*>((reinterpret_cast<uintptr_t>(m_current) + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1));
+	if(!m_current || (alignedCurrent > m_end) || (size > static_cast<size_t>(m_end - alignedCurrent)))
+	{
+		AllocateChunk(size, alignment);
+		alignedCurrent = reinterpret_cast<uint8*>((reinterpret_cast<uintptr_t>(m_current) + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1));
+		assert(size <= static_cast<size_t>(m_end - alignedCurrent));
+	}
+	m_current = alignedCurrent + size;
+	m_usedSize += size;
+	return alignedCurrent;
+}
+
+void CArena::Reset()
+{
+	//Keeps the largest chunk, the arena will likely need as much memory next time
+	CHUNK* keptChunk = m_spareChunk;
+	m_spareChunk = nullptr;
+	for(auto chunk = m_chunks; chunk != nullptr;)
+	{
+		auto next = chunk->next;
+		if(!keptChunk || (chunk->size > keptChunk->size))
+		{
+			std::swap(chunk, keptChunk);
+		}
+		if(chunk)
+		{
+			framework_aligned_free(chunk);
+		}
+		chunk = next;
+	}
+	m_chunks = nullptr;
+	m_usedSize = 0;
+
+	if(m_region)
+	{
+		m_current = m_region;
+		m_end = m_region + m_regionSize;
+		if(keptChunk)
+		{
+			keptChunk->next = nullptr;
+			m_spareChunk = keptChunk;
+		}
+	}
+	else if(keptChunk)
+	{
+		UseChunk(keptChunk);
+	}
+	else
+	{
+		m_current = nullptr;
+		m_end = nullptr;
+	}
+}
+
+size_t CArena::GetUsedSize() const
+{
+	return m_usedSize;
+}
+
+void CArena::UseChunk(CHUNK* chunk)
+{
+	chunk->next = m_chunks;
+	m_chunks = chunk;
+	m_current = reinterpret_cast<uint8*>(chunk) + g_chunkHeaderSize;
+	m_end = reinterpret_cast<uint8*>(chunk) + chunk->size;
+}
+
+void CArena::AllocateChunk(size_t size, size_t alignment)
+{
+	//Room for the worst case alignment of the allocation that needs the chunk
+	size_t neededSize = g_chunkHeaderSize + size + alignment;
+	if(m_spareChunk && (m_spareChunk->size >= neededSize))
+	{
+		auto chunk = m_spareChunk;
+		m_spareChunk = nullptr;
+		UseChunk(chunk);
+		return;
+	}
+
+	size_t chunkSize = std::max(m_chunkSize, neededSize);
+	auto chunk = reinterpret_cast<CHUNK*>(framework_aligned_alloc(chunkSize, g_chunkHeaderSize));
+	if(!chunk)
+	{
+		throw std::bad_alloc();
+	}
+	new(chunk) CHUNK();
+	chunk->size = chunkSize;
+	UseChunk(chunk);
+}
+
+void CArena::FreeChunks(CHUNK* chunk)
+{
+	while(chunk)
+	{
+		auto next = chunk->next;
+		framework_aligned_free(chunk);
+		chunk = next;
+	}
+}
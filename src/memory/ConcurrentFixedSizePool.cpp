@@ -0,0 +1,157 @@
+#include "memory/ConcurrentFixedSizePool.h"
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <new>
+#include <utility>
+#include "AlignedAlloc.h"
+
+using namespace Framework::Memory;
+
+namespace
+{
+	struct THREAD_CACHE_ENTRY
+	{
+		uint64	poolId;
+		void*	cache;
+	};
+
+	//Pools are found by id, a pool created at the address of a destroyed one won't pick up its caches
+	std::atomic<uint64> g_nextPoolId(1);
+	thread_local std::vector<THREAD_CACHE_ENTRY> g_threadCacheEntries;
+}
+
+CConcurrentFixedSizePool::CConcurrentFixedSizePool(size_t blockSize, size_t blockAlignment, size_t blocksPerSlab, size_t threadCacheSize)
+: m_id(g_nextPoolId++)
+, m_blockAlignment(std::max(blockAlignment, alignof(FREE_BLOCK)))
+, m_blocksPerSlab(blocksPerSlab)
+, m_threadCacheSize(std::max<size_t>(threadCacheSize, 1))
+{
+	assert((m_blockAlignment & (m_blockAlignment - 1)) == 0);
+	assert(m_blocksPerSlab != 0);
+	m_blockSize = std::max(blockSize, sizeof(FREE_BLOCK));
+	m_blockSize = (m_blockSize + m_blockAlignment - 1) & ~(m_blockAlignment - 1);
+}
+
+CConcurrentFixedSizePool::~CConcurrentFixedSizePool()
+{
+	for(auto slab : m_slabs)
+	{
+		framework_aligned_free(slab);
+	}
+	//Entries of other threads stay behind, their id will never match again
+	auto& entries = g_threadCacheEntries;
+	entries.erase(std::remove_if(entries.begin(), entries.end(),
+		[this](const THREAD_CACHE_ENTRY& entry) { return entry.poolId == m_id; }), entries.end());
+}
+
+void* CConcurrentFixedSizePool::Allocate()
+{
+	auto& cache = GetThreadCache();
+	if(!cache.blocks)
+	{
+		Refill(cache);
+	}
+	auto block = cache.blocks;
+	cache.blocks = block->next;
+	cache.count--;
+	return block;
+}
+
+void CConcurrentFixedSizePool::Free(void* block)
+{
+	if(!block) return;
+	auto& cache = GetThreadCache();
+	auto freeBlock = reinterpret_cast<FREE_BLOCK*>(block);
+	freeBlock->next = cache.blocks;
+	cache.blocks = freeBlock;
+	cache.count++;
+	if(cache.count > m_threadCacheSize)
+	{
+		Drain(cache);
+	}
+}
+
+size_t CConcurrentFixedSizePool::GetBlockSize() const
+{
+	return m_blockSize;
+}
+
+size_t CConcurrentFixedSizePool::GetBlockAlignment() const
+{
+	return m_blockAlignment;
+}
+
+CConcurrentFixedSizePool::THREAD_CACHE& CConcurrentFixedSizePool::GetThreadCache()
+{
+	auto& entries = g_threadCacheEntries;
+	for(const auto& entry : entries)
+	{
+		if(entry.poolId == m_id)
+		{
+			return *reinterpret_cast<THREAD_CACHE*>(entry.cache);
+		}
+	}
+
+	THREAD_CACHE* cache = nullptr;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_threadCaches.push_back(std::make_unique<THREAD_CACHE>());
+		cache = m_threadCaches.back().get();
+	}
+	THREAD_CACHE_ENTRY entry;
+	entry.poolId = m_id;
+	entry.cache = cache;
+	entries.push_back(entry);
+	return *cache;
+}
+
+void CConcurrentFixedSizePool::Refill(THREAD_CACHE& cache)
+{
+	//Takes half a cache worth of blocks
+	size_t refillCount = std::max<size_t>(m_threadCacheSize / 2, 1);
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for(size_t i = 0; i < refillCount; i++)
+	{
+		if(!m_freeBlocks)
+		{
+			AllocateSlab();
+		}
+		auto block = m_freeBlocks;
+		m_freeBlocks = block->next;
+		block->next = cache.blocks;
+		cache.blocks = block;
+		cache.count++;
+	}
+}
+
+void CConcurrentFixedSizePool::Drain(THREAD_CACHE& cache)
+{
+	//Gives back half of the cache
+	size_t drainCount = cache.count / 2;
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for(size_t i = 0; i < drainCount; i++)
+	{
+		auto block = cache.blocks;
+		cache.blocks = block->next;
+		cache.count--;
+		block->next = m_freeBlocks;
+		m_freeBlocks = block;
+	}
+}
+
+void CConcurrentFixedSizePool::AllocateSlab()
+{
+	auto slab = reinterpret_cast<uint8*>(framework_aligned_alloc(m_blockSize * m_blocksPerSlab, m_blockAlignment));
+	if(!slab)
+	{
+		throw std::bad_alloc();
+	}
+	m_slabs.push_back(slab);
+	for(size_t i = m_blocksPerSlab; i != 0; i--)
+	{
+		auto block = reinterpret_cast<FREE_BLOCK*>(slab + ((i - 1) * m_blockSize));
+		block->next = m_freeBlocks;
+		m_freeBlocks = block;
+	}
+}
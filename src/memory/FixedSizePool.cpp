@@ -0,0 +1,71 @@
+#include "memory/FixedSizePool.h"
+#include <algorithm>
+#include <cassert>
+#include "AlignedAlloc.h"
+
+using namespace Framework::Memory;
+
+CFixedSizePool::CFixedSizePool(size_t blockSize, size_t blockAlignment, size_t blocksPerSlab)
+: m_blockAlignment(std::max(blockAlignment, alignof(FREE_BLOCK)))
+, m_blocksPerSlab(blocksPerSlab)
+{
+	assert((m_blockAlignment & (m_blockAlignment - 1)) == 0);
+	assert(m_blocksPerSlab != 0);
+	//Free blocks hold the free list link
+	m_blockSize = std::max(blockSize, sizeof(FREE_BLOCK));
+	m_blockSize = (m_blockSize + m_blockAlignment - 1) & ~(m_blockAlignment - 1);
+}
+
+CFixedSizePool::~CFixedSizePool()
+{
+	for(auto slab : m_slabs)
+	{
+		framework_aligned_free(slab);
+	}
+}
+
+void* CFixedSizePool::Allocate()
+{
+	if(!m_freeBlocks)
+	{
+		AllocateSlab();
+	}
+	auto block = m_freeBlocks;
+	m_freeBlocks = block->next;
+	return block;
+}
+
+void CFixedSizePool::Free(void* block)
+{
+	if(!block) return;
+	auto freeBlock = reinterpret_cast<FREE_BLOCK*>(block);
+	freeBlock->next = m_freeBlocks;
+	m_freeBlocks = freeBlock;
+}
+
+size_t CFixedSizePool::GetBlockSize() const
+{
+	return m_blockSize;
+}
+
+size_t CFixedSizePool::GetBlockAlignment() const
+{
+	return m_blockAlignment;
+}
+
+void CFixedSizePool::AllocateSlab()
+{
+	auto slab = reinterpret_cast<uint8*>(framework_aligned_alloc(m_blockSize * m_blocksPerSlab, m_blockAlignment));
+	if(!slab)
+	{
+		throw std::bad_alloc();
+	}
+	m_slabs.push_back(slab);
+	//Linked in address order, blocks are handed out sequentially
+	for(size_t i = m_blocksPerSlab; i != 0; i--)
+	{
+		auto block = reinterpret_cast<FREE_BLOCK*>(slab + ((i - 1) * m_blockSize));
+		block->next = m_freeBlocks;
+		m_freeBlocks = block;
+	}
+}
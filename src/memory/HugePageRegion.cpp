@@ -0,0 +1,91 @@
+#include "memory/HugePageRegion.h"
+#include <new>
+#include "AlignedAlloc.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+using namespace Framework::Memory;
+
+static size_t RoundUp(size_t size, size_t granularity)
+{
+	return ((size + granularity - 1) / granularity) * granularity;
+}
+
+CHugePageRegion::CHugePageRegion(size_t size)
+{
+#if defined(_WIN32)
+	size_t largePageSize = GetLargePageMinimum();
+	if(largePageSize != 0)
+	{
+		//Needs SeLockMemoryPrivilege, fails without it
+		size_t largeSize = RoundUp(size, largePageSize);
+		m_data = VirtualAlloc(NULL, largeSize, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+		if(m_data)
+		{
+			m_size = largeSize;
+			m_usesHugePages = true;
+			return;
+		}
+	}
+	m_size = RoundUp(size, framework_getpagesize());
+	m_data = VirtualAlloc(NULL, m_size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+	if(!m_data)
+	{
+		throw std::bad_alloc();
+	}
+#else
+#if defined(MAP_HUGETLB)
+	{
+		static const size_t hugePageSize = 2 * 1024 * 1024;
+		size_t hugeSize = RoundUp(size, hugePageSize);
+		void* data = mmap(nullptr, hugeSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if(data != MAP_FAILED)
+		{
+			m_data = data;
+			m_size = hugeSize;
+			m_usesHugePages = true;
+			return;
+		}
+	}
+#endif
+	m_size = RoundUp(size, framework_getpagesize());
+	void* data = mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if(data == MAP_FAILED)
+	{
+		throw std::bad_alloc();
+	}
+	m_data = data;
+#if defined(MADV_HUGEPAGE)
+	//Transparent huge pages, only a hint
+	madvise(m_data, m_size, MADV_HUGEPAGE);
+#endif
+#endif
+}
+
+CHugePageRegion::~CHugePageRegion()
+{
+#if defined(_WIN32)
+	VirtualFree(m_data, 0, MEM_RELEASE);
+#else
+	munmap(m_data, m_size);
+#endif
+}
+
+void* CHugePageRegion::GetData() const
+{
+	return m_data;
+}
+
+size_t CHugePageRegion::GetSize() const
+{
+	return m_size;
+}
+
+bool CHugePageRegion::UsesHugePages() const
+{
+	return m_usesHugePages;
+}
@@ -0,0 +1,900 @@
+#include "mpeg2/Decoder.h"
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include "BitManip.h"
+#include "PtrStream.h"
+#include "StreamBitStream.h"
+#include "TaskGroup.h"
+#include "idct/FixedPoint.h"
+#include "mpeg2/CodedBlockPatternTable.h"
+#include "mpeg2/DcSizeChrominanceTable.h"
+#include "mpeg2/DcSizeLuminanceTable.h"
+#include "mpeg2/DctCoefficientTable0.h"
+#include "mpeg2/DctCoefficientTable1.h"
+#include "mpeg2/InverseScanTable.h"
+#include "mpeg2/MacroblockAddressIncrementTable.h"
+#include "mpeg2/MacroblockTypeBTable.h"
+#include "mpeg2/MacroblockTypeITable.h"
+#include "mpeg2/MacroblockTypePTable.h"
+#include "mpeg2/MotionCompensation.h"
+#include "mpeg2/MotionCodeTable.h"
+#include "mpeg2/QuantiserScaleTable.h"
+
+using namespace MPEG2;
+using namespace Framework;
+
+enum START_CODE
+{
+	START_CODE_PICTURE = 0x00,
+	START_CODE_SLICE_FIRST = 0x01,
+	START_CODE_SLICE_LAST = 0xAF,
+	START_CODE_SEQUENCE_HEADER = 0xB3,
+	START_CODE_EXTENSION = 0xB5,
+	START_CODE_SEQUENCE_END = 0xB7,
+	START_CODE_GROUP = 0xB8,
+};
+
+enum EXTENSION_ID
+{
+	EXTENSION_ID_SEQUENCE = 1,
+	EXTENSION_ID_QUANT_MATRIX = 3,
+	EXTENSION_ID_PICTURE_CODING = 8,
+};
+
+enum MACROBLOCK_FLAGS
+{
+	MACROBLOCK_INTRA = 0x01,
+	MACROBLOCK_PATTERN = 0x02,
+	MACROBLOCK_MOTION_BACKWARD = 0x04,
+	MACROBLOCK_MOTION_FORWARD = 0x08,
+	MACROBLOCK_QUANT = 0x10,
+};
+
+enum
+{
+	MACROBLOCK_ADDRESS_STUFFING = 0x22,
+	MACROBLOCK_ADDRESS_ESCAPE = 0x23,
+	PICTURE_STRUCTURE_FRAME = 3,
+	FRAME_MOTION_TYPE_FRAME = 2,
+	CHROMA_FORMAT_420 = 1,
+};
+
+static const uint8 g_defaultIntraMatrix[64] =
+{
+	8,  16, 19, 22, 26, 27, 29, 34,
+	16, 16, 22, 24, 27, 29, 34, 37,
+	19, 22, 26, 27, 29, 34, 34, 38,
+	22, 22, 26, 27, 29, 34, 37, 40,
+	22, 26, 27, 29, 32, 35, 40, 48,
+	26, 27, 29, 32, 35, 40, 48, 58,
+	26, 27, 29, 34, 38, 46, 56, 69,
+	27, 29, 35, 38, 46, 56, 69, 83,
+};
+
+struct CDecoder::MACROBLOCK
+{
+	unsigned int	address = 0;
+	//MACROBLOCK_* flags, skipped and "no motion compensation" macroblocks get their implied motion flags
+	uint32			flags = 0;
+	bool			fieldDct = false;
+	uint32			codedBlockPattern = 0;
+	//[forward/backward][horizontal/vertical], in half samples
+	int32			vectors[2][2] = {};
+	//Index of the first coded block in the slice's coefficients
+	uint32			firstBlock = 0;
+};
+
+//Predicts a size x size block at (x, y) of a plane with half sample interpolation,
+//positions outside of the plane are clamped to its edges
+static void PredictBlock(uint8* output, const uint8* plane, unsigned int stride, unsigned int width, unsigned int height,
+                         int32 x, int32 y, unsigned int halfSample, unsigned int size)
+{
+	if((x >= 0) && (y >= 0) && ((x + size + 1) <= width) && ((y + size + 1) <= height))
+	{
+		MotionCompensation::Predict(output, size, plane + (y * stride) + x, stride, size, size, halfSample);
+		return;
+	}
+	uint8 window[17 * 17];
+	for(unsigned int row = 0; row <= size; row++)
+	{
+		int32 sourceY = std::min<int32>(std::max<int32>(y + row, 0), height - 1);
+		for(unsigned int column = 0; column <= size; column++)
+		{
+			int32 sourceX = std::min<int32>(std::max<int32>(x + column, 0), width - 1);
+			window[(row * 17) + column] = plane[(sourceY * stride) + sourceX];
+		}
+	}
+	MotionCompensation::Predict(output, size, window, 17, size, size, halfSample);
+}
+
+static unsigned int GetHalfSample(int32 vectorX, int32 vectorY)
+{
+	return ((vectorX & 1) ? MotionCompensation::HALF_SAMPLE_X : 0) | ((vectorY & 1) ? MotionCompensation::HALF_SAMPLE_Y : 0);
+}
+
+CDecoder::CDecoder(FrameHandler frameHandler, CThreadPool* threadPool, IDCT::CInterface* idct)
+    : m_frameHandler(std::move(frameHandler))
+    , m_threadPool(threadPool)
+    , m_idct(idct ? idct : IDCT::CFixedPoint::GetInstance())
+{
+	//Tables are created lazily, get them now before slices use them from several threads
+	m_macroblockAddressIncrementTable = CMacroblockAddressIncrementTable::GetInstance();
+	m_macroblockTypeTables[0] = CMacroblockTypeITable::GetInstance();
+	m_macroblockTypeTables[1] = CMacroblockTypePTable::GetInstance();
+	m_macroblockTypeTables[2] = CMacroblockTypeBTable::GetInstance();
+	m_codedBlockPatternTable = CCodedBlockPatternTable::GetInstance();
+	m_motionCodeTable = CMotionCodeTable::GetInstance();
+	m_dcSizeTables[0] = CDcSizeLuminanceTable::GetInstance();
+	m_dcSizeTables[1] = CDcSizeChrominanceTable::GetInstance();
+	m_dctCoefficientTables[0] = &CDctCoefficientTable0::GetInstance();
+	m_dctCoefficientTables[1] = &CDctCoefficientTable1::GetInstance();
+
+	for(unsigned int i = 0; i < 64; i++)
+	{
+		m_scanOrders[0][CInverseScanTable::m_nTable0[i]] = static_cast<uint8>(i);
+		m_scanOrders[1][CInverseScanTable::m_nTable1[i]] = static_cast<uint8>(i);
+	}
+}
+
+void CDecoder::Decode(const void* data, size_t size)
+{
+	auto bytes = reinterpret_cast<const uint8*>(data);
+	m_buffer.insert(m_buffer.end(), bytes, bytes + size);
+	ProcessBuffer();
+}
+
+void CDecoder::Flush()
+{
+	static const uint8 sequenceEnd[4] = {0x00, 0x00, 0x01, START_CODE_SEQUENCE_END};
+	Decode(sequenceEnd, sizeof(sequenceEnd));
+}
+
+uint32 CDecoder::GetCorruptSliceCount() const
+{
+	return m_corruptSliceCount;
+}
+
+void CDecoder::ProcessBuffer()
+{
+	//Units go from one start code to the next, so a unit is processed once the following start code comes in
+	while(true)
+	{
+		size_t startCode = ~size_t(0);
+		const uint8* buffer = m_buffer.data();
+		size_t position = std::max<size_t>(m_searchPosition, 2);
+		while(position < m_buffer.size())
+		{
+			auto marker = reinterpret_cast<const uint8*>(memchr(buffer + position, 0x01, m_buffer.size() - position));
+			if(!marker) break;
+			position = marker - buffer;
+			if((buffer[position - 1] == 0) && (buffer[position - 2] == 0) && ((position + 1) < m_buffer.size()))
+			{
+				startCode = position - 2;
+				break;
+			}
+			if((position + 1) == m_buffer.size())
+			{
+				//Start code value isn't there yet
+				break;
+			}
+			position++;
+		}
+		if(startCode == ~size_t(0))
+		{
+			//Last byte could be the end of a prefix whose value isn't there yet
+			m_searchPosition = std::max(m_searchPosition, m_buffer.size() - std::min<size_t>(m_buffer.size(), 1));
+			break;
+		}
+		if(m_unitStart != ~size_t(0))
+		{
+			ProcessUnit(m_unitStart, startCode);
+		}
+		m_unitStart = startCode;
+		m_searchPosition = startCode + 4;
+		ProcessUnit(startCode, ~size_t(0));
+	}
+
+	//Keep the current unit and the slices of the pending picture, or the bytes that could begin a start code
+	size_t keepStart = (m_unitStart != ~size_t(0)) ? m_unitStart : (m_searchPosition - std::min<size_t>(m_searchPosition, 2));
+	if(!m_slices.empty())
+	{
+		keepStart = std::min(keepStart, m_slices.front().offset - 4);
+	}
+	if(keepStart != 0)
+	{
+		m_buffer.erase(m_buffer.begin(), m_buffer.begin() + keepStart);
+		m_searchPosition -= keepStart;
+		if(m_unitStart != ~size_t(0)) m_unitStart -= keepStart;
+		for(auto& slice : m_slices)
+		{
+			slice.offset -= keepStart;
+		}
+	}
+}
+
+//Called twice per unit: when its start code is found (end is ~0) and once its data is complete.
+//Only the end of the previous picture needs to be known before a unit's data is available.
+void CDecoder::ProcessUnit(size_t start, size_t end)
+{
+	uint8 code = m_buffer[start + 3];
+	bool isSlice = (code >= START_CODE_SLICE_FIRST) && (code <= START_CODE_SLICE_LAST);
+	if(end == ~size_t(0))
+	{
+		if(!isSlice && (code != START_CODE_EXTENSION))
+		{
+			FinishPicture();
+		}
+		if(code == START_CODE_SEQUENCE_END)
+		{
+			EndSequence();
+		}
+		return;
+	}
+
+	size_t offset = start + 4;
+	if(isSlice)
+	{
+		if(!m_hasPendingPicture) return;
+		SLICE slice;
+		slice.offset = offset;
+		//Next start code prefix is included, its zeros mark the end of the macroblocks
+		slice.size = (end + 3) - offset;
+		slice.verticalPosition = code;
+		m_slices.push_back(slice);
+		return;
+	}
+
+	CPtrStream stream(m_buffer.data() + offset, end - offset);
+	CStreamBitStream bitStream(stream);
+	switch(code)
+	{
+	case START_CODE_SEQUENCE_HEADER:
+		ParseSequenceHeader(bitStream);
+		break;
+	case START_CODE_EXTENSION:
+		ParseExtension(bitStream);
+		break;
+	case START_CODE_PICTURE:
+		ParsePictureHeader(bitStream);
+		break;
+	default:
+		//Group of pictures, user data, ...
+		break;
+	}
+}
+
+void CDecoder::ParseSequenceHeader(CBitStream& stream)
+{
+	unsigned int width = stream.GetBits_MSBF(12);
+	unsigned int height = stream.GetBits_MSBF(12);
+	//Aspect ratio, frame rate, bit rate, marker, VBV buffer size and constrained parameters flag
+	stream.GetBits_MSBF(4);
+	stream.GetBits_MSBF(4);
+	stream.GetBits_MSBF(18);
+	stream.GetBits_MSBF(1);
+	stream.GetBits_MSBF(10);
+	stream.GetBits_MSBF(1);
+
+	//Matrices are transmitted in zigzag order
+	if(stream.GetBits_MSBF(1))
+	{
+		for(unsigned int i = 0; i < 64; i++)
+		{
+			m_sequence.intraMatrix[m_scanOrders[0][i]] = static_cast<uint8>(stream.GetBits_MSBF(8));
+		}
+	}
+	else
+	{
+		memcpy(m_sequence.intraMatrix, g_defaultIntraMatrix, 64);
+	}
+	if(stream.GetBits_MSBF(1))
+	{
+		for(unsigned int i = 0; i < 64; i++)
+		{
+			m_sequence.nonIntraMatrix[m_scanOrders[0][i]] = static_cast<uint8>(stream.GetBits_MSBF(8));
+		}
+	}
+	else
+	{
+		memset(m_sequence.nonIntraMatrix, 16, 64);
+	}
+
+	if((width == 0) || (height == 0))
+	{
+		throw std::runtime_error("Invalid MPEG-2 sequence size.");
+	}
+	if((width != m_sequence.width) || (height != m_sequence.height))
+	{
+		m_forwardReference.reset();
+		m_backwardReference.reset();
+		m_picturePool.clear();
+	}
+	m_sequence.isValid = true;
+	m_sequence.width = width;
+	m_sequence.height = height;
+	m_sequence.isProgressive = true;
+	m_sequence.mbWidth = (width + 15) / 16;
+	m_sequence.mbHeight = (height + 15) / 16;
+}
+
+void CDecoder::ParseExtension(CBitStream& stream)
+{
+	switch(stream.GetBits_MSBF(4))
+	{
+	case EXTENSION_ID_SEQUENCE:
+		{
+			//Profile and level
+			stream.GetBits_MSBF(8);
+			bool isProgressive = stream.GetBits_MSBF(1) != 0;
+			if(stream.GetBits_MSBF(2) != CHROMA_FORMAT_420)
+			{
+				throw std::runtime_error("Only 4:2:0 MPEG-2 streams are supported.");
+			}
+			if(stream.GetBits_MSBF(2) || stream.GetBits_MSBF(2))
+			{
+				throw std::runtime_error("MPEG-2 sequence size extensions aren't supported.");
+			}
+			//Frame pictures of interlaced sequences are made of pairs of field macroblock rows
+			unsigned int mbHeight = isProgressive ? (m_sequence.height + 15) / 16 : 2 * ((m_sequence.height + 31) / 32);
+			if(mbHeight != m_sequence.mbHeight)
+			{
+				m_forwardReference.reset();
+				m_backwardReference.reset();
+				m_picturePool.clear();
+			}
+			m_sequence.isProgressive = isProgressive;
+			m_sequence.mbHeight = mbHeight;
+		}
+		break;
+	case EXTENSION_ID_QUANT_MATRIX:
+		if(stream.GetBits_MSBF(1))
+		{
+			for(unsigned int i = 0; i < 64; i++)
+			{
+				m_sequence.intraMatrix[m_scanOrders[0][i]] = static_cast<uint8>(stream.GetBits_MSBF(8));
+			}
+		}
+		if(stream.GetBits_MSBF(1))
+		{
+			for(unsigned int i = 0; i < 64; i++)
+			{
+				m_sequence.nonIntraMatrix[m_scanOrders[0][i]] = static_cast<uint8>(stream.GetBits_MSBF(8));
+			}
+		}
+		//Chroma matrices are only used by 4:2:2 and 4:4:4 streams
+		break;
+	case EXTENSION_ID_PICTURE_CODING:
+		m_picture.fCodes[0][0] = stream.GetBits_MSBF(4);
+		m_picture.fCodes[0][1] = stream.GetBits_MSBF(4);
+		m_picture.fCodes[1][0] = stream.GetBits_MSBF(4);
+		m_picture.fCodes[1][1] = stream.GetBits_MSBF(4);
+		m_picture.intraDcPrecision = stream.GetBits_MSBF(2);
+		m_picture.pictureStructure = stream.GetBits_MSBF(2);
+		//Top field first
+		stream.GetBits_MSBF(1);
+		m_picture.framePredFrameDct = stream.GetBits_MSBF(1) != 0;
+		m_picture.concealmentMotionVectors = stream.GetBits_MSBF(1) != 0;
+		m_picture.qScaleType = stream.GetBits_MSBF(1) != 0;
+		m_picture.intraVlcFormat = stream.GetBits_MSBF(1) != 0;
+		m_picture.alternateScan = stream.GetBits_MSBF(1) != 0;
+		m_picture.hasCodingExtension = true;
+		break;
+	default:
+		break;
+	}
+}
+
+void CDecoder::ParsePictureHeader(CBitStream& stream)
+{
+	if(!m_sequence.isValid) return;
+	m_picture = PICTURE();
+	m_picture.temporalReference = stream.GetBits_MSBF(10);
+	unsigned int type = stream.GetBits_MSBF(3);
+	if((type < PICTURE_TYPE_I) || (type > PICTURE_TYPE_B))
+	{
+		//D pictures and reserved values
+		return;
+	}
+	m_picture.type = static_cast<PICTURE_TYPE>(type);
+	//Remaining fields are only meaningful to MPEG-1, the picture coding extension takes over
+	m_hasPendingPicture = true;
+}
+
+void CDecoder::FinishPicture()
+{
+	if(!m_hasPendingPicture) return;
+	m_hasPendingPicture = false;
+	SliceArray slices;
+	std::swap(slices, m_slices);
+
+	if(!m_picture.hasCodingExtension)
+	{
+		throw std::runtime_error("MPEG-1 video streams aren't supported.");
+	}
+	if(m_picture.pictureStructure != PICTURE_STRUCTURE_FRAME)
+	{
+		throw std::runtime_error("MPEG-2 field pictures aren't supported.");
+	}
+
+	//Pictures following a GOP that isn't closed can reference pictures that we don't have
+	switch(m_picture.type)
+	{
+	case PICTURE_TYPE_P:
+		if(!m_backwardReference) return;
+		m_predictionReferences[0] = m_backwardReference.get();
+		m_predictionReferences[1] = nullptr;
+		break;
+	case PICTURE_TYPE_B:
+		if(!m_forwardReference || !m_backwardReference) return;
+		m_predictionReferences[0] = m_forwardReference.get();
+		m_predictionReferences[1] = m_backwardReference.get();
+		break;
+	default:
+		m_predictionReferences[0] = nullptr;
+		m_predictionReferences[1] = nullptr;
+		break;
+	}
+
+	auto picture = AllocatePicture();
+	picture->type = m_picture.type;
+	picture->temporalReference = m_picture.temporalReference;
+	{
+		CTaskGroup taskGroup(m_threadPool);
+		for(const auto& slice : slices)
+		{
+			taskGroup.Run(
+			    [this, &slice, &picture]() {
+				    DecodeSlice(slice, *picture);
+			    });
+		}
+		taskGroup.Wait();
+	}
+
+	//B pictures are displayed right away, I and P pictures once the next reference picture is decoded
+	if(m_picture.type == PICTURE_TYPE_B)
+	{
+		OutputPicture(*picture);
+	}
+	else
+	{
+		if(m_backwardReference)
+		{
+			OutputPicture(*m_backwardReference);
+		}
+		m_forwardReference = std::move(m_backwardReference);
+		m_backwardReference = std::move(picture);
+	}
+}
+
+void CDecoder::EndSequence()
+{
+	if(m_backwardReference)
+	{
+		OutputPicture(*m_backwardReference);
+	}
+	m_forwardReference.reset();
+	m_backwardReference.reset();
+}
+
+CDecoder::PictureBufferPtr CDecoder::AllocatePicture()
+{
+	for(const auto& picture : m_picturePool)
+	{
+		if(picture.use_count() == 1)
+		{
+			return picture;
+		}
+	}
+	auto picture = std::make_shared<PICTURE_BUFFER>();
+	unsigned int width = m_sequence.mbWidth * 16;
+	unsigned int height = m_sequence.mbHeight * 16;
+	picture->strides[0] = width;
+	picture->strides[1] = width / 2;
+	picture->strides[2] = width / 2;
+	picture->planes[0].resize(width * height);
+	picture->planes[1].resize((width / 2) * (height / 2), 0x80);
+	picture->planes[2].resize((width / 2) * (height / 2), 0x80);
+	m_picturePool.push_back(picture);
+	return picture;
+}
+
+void CDecoder::OutputPicture(const PICTURE_BUFFER& picture)
+{
+	FRAME frame;
+	frame.width = m_sequence.width;
+	frame.height = m_sequence.height;
+	frame.pictureType = picture.type;
+	frame.temporalReference = picture.temporalReference;
+	for(unsigned int i = 0; i < 3; i++)
+	{
+		frame.planes[i] = picture.planes[i].data();
+		frame.strides[i] = picture.strides[i];
+	}
+	m_frameHandler(frame);
+}
+
+void CDecoder::DecodeSlice(const SLICE& slice, PICTURE_BUFFER& picture)
+{
+	MacroblockArray macroblocks;
+	CoefficientArray coefficients;
+	try
+	{
+		ParseSlice(slice, macroblocks, coefficients);
+	}
+	catch(const std::exception&)
+	{
+		//Macroblocks parsed before the error are still reconstructed
+		m_corruptSliceCount++;
+		coefficients.resize(macroblocks.empty() ? 0 : (macroblocks.back().firstBlock + PopCount(macroblocks.back().codedBlockPattern)) * 64);
+	}
+
+	CoefficientArray samples(coefficients.size());
+	m_idct->TransformBlocks(coefficients.data(), samples.data(), coefficients.size() / 64);
+	for(const auto& macroblock : macroblocks)
+	{
+		ReconstructMacroblock(macroblock, samples.data() + (macroblock.firstBlock * 64), picture);
+	}
+}
+
+void CDecoder::ParseSlice(const SLICE& slice, MacroblockArray& macroblocks, CoefficientArray& coefficients)
+{
+	CPtrStream stream(m_buffer.data() + slice.offset, slice.size);
+	CStreamBitStream bitStream(stream);
+
+	unsigned int mbCount = m_sequence.mbWidth * m_sequence.mbHeight;
+	unsigned int quantiserScaleCode = bitStream.GetBits_MSBF(5);
+	if(bitStream.PeekBits_MSBF(1))
+	{
+		//Intra slice flag, intra slice and reserved bits
+		bitStream.GetBits_MSBF(9);
+	}
+	while(bitStream.GetBits_MSBF(1))
+	{
+		//Extra information
+		bitStream.GetBits_MSBF(8);
+	}
+
+	int32 dcResetValue = 1 << (7 + m_picture.intraDcPrecision);
+	int32 dcPredictors[3] = {dcResetValue, dcResetValue, dcResetValue};
+	//[first/second][forward/backward][horizontal/vertical]
+	int32 motionPredictors[2][2][2] = {};
+	CVLCTable* macroblockTypeTable = m_macroblockTypeTables[m_picture.type - PICTURE_TYPE_I];
+
+	int32 address = ((slice.verticalPosition - 1) * m_sequence.mbWidth) - 1;
+	bool isFirst = true;
+	while(true)
+	{
+		uint32 nextBits = 0;
+		if(!bitStream.TryPeekBits_MSBF(23, nextBits) || (nextBits == 0))
+		{
+			break;
+		}
+
+		unsigned int increment = 0;
+		while(true)
+		{
+			uint32 value = m_macroblockAddressIncrementTable->GetSymbol(&bitStream);
+			if(value == MACROBLOCK_ADDRESS_STUFFING) continue;
+			if(value == MACROBLOCK_ADDRESS_ESCAPE)
+			{
+				increment += 33;
+				continue;
+			}
+			increment += value;
+			break;
+		}
+
+		if(!isFirst && (increment > 1))
+		{
+			//Skipped macroblocks
+			if(m_picture.type == PICTURE_TYPE_I)
+			{
+				throw std::runtime_error("Skipped macroblock in intra picture.");
+			}
+			MACROBLOCK skipped;
+			if(m_picture.type == PICTURE_TYPE_P)
+			{
+				//Forward prediction with a null vector
+				skipped.flags = MACROBLOCK_MOTION_FORWARD;
+				memset(motionPredictors, 0, sizeof(motionPredictors));
+			}
+			else
+			{
+				//Same prediction as the previous macroblock
+				const auto& previous = macroblocks.back();
+				if(previous.flags & MACROBLOCK_INTRA)
+				{
+					throw std::runtime_error("Skipped macroblock following an intra macroblock.");
+				}
+				skipped.flags = previous.flags & (MACROBLOCK_MOTION_FORWARD | MACROBLOCK_MOTION_BACKWARD);
+				memcpy(skipped.vectors, previous.vectors, sizeof(skipped.vectors));
+			}
+			skipped.firstBlock = static_cast<uint32>(coefficients.size() / 64);
+			dcPredictors[0] = dcPredictors[1] = dcPredictors[2] = dcResetValue;
+			for(unsigned int i = 1; i < increment; i++)
+			{
+				skipped.address = address + i;
+				if(skipped.address >= mbCount)
+				{
+					throw std::runtime_error("Macroblock address out of range.");
+				}
+				macroblocks.push_back(skipped);
+			}
+		}
+		isFirst = false;
+		address += increment;
+		if(static_cast<uint32>(address) >= mbCount)
+		{
+			throw std::runtime_error("Macroblock address out of range.");
+		}
+
+		MACROBLOCK macroblock;
+		macroblock.address = address;
+		macroblock.flags = macroblockTypeTable->GetSymbol(&bitStream);
+		bool isIntra = (macroblock.flags & MACROBLOCK_INTRA) != 0;
+		bool hasMotion = (macroblock.flags & (MACROBLOCK_MOTION_FORWARD | MACROBLOCK_MOTION_BACKWARD)) != 0;
+		if(hasMotion && !m_picture.framePredFrameDct)
+		{
+			if(bitStream.GetBits_MSBF(2) != FRAME_MOTION_TYPE_FRAME)
+			{
+				throw std::runtime_error("Only frame motion compensation is supported.");
+			}
+		}
+		if(!m_picture.framePredFrameDct && (macroblock.flags & (MACROBLOCK_INTRA | MACROBLOCK_PATTERN)))
+		{
+			macroblock.fieldDct = bitStream.GetBits_MSBF(1) != 0;
+		}
+		if(macroblock.flags & MACROBLOCK_QUANT)
+		{
+			quantiserScaleCode = bitStream.GetBits_MSBF(5);
+		}
+		if((macroblock.flags & MACROBLOCK_MOTION_FORWARD) || (isIntra && m_picture.concealmentMotionVectors))
+		{
+			ParseMotionVector(bitStream, 0, motionPredictors, macroblock.vectors[0]);
+		}
+		if(macroblock.flags & MACROBLOCK_MOTION_BACKWARD)
+		{
+			ParseMotionVector(bitStream, 1, motionPredictors, macroblock.vectors[1]);
+		}
+		if(isIntra && m_picture.concealmentMotionVectors)
+		{
+			//Marker bit
+			bitStream.GetBits_MSBF(1);
+		}
+		if(macroblock.flags & MACROBLOCK_PATTERN)
+		{
+			macroblock.codedBlockPattern = m_codedBlockPatternTable->GetSymbol(&bitStream);
+		}
+		else if(isIntra)
+		{
+			macroblock.codedBlockPattern = 0x3F;
+		}
+
+		if(isIntra)
+		{
+			if(!m_picture.concealmentMotionVectors)
+			{
+				memset(motionPredictors, 0, sizeof(motionPredictors));
+			}
+		}
+		else
+		{
+			dcPredictors[0] = dcPredictors[1] = dcPredictors[2] = dcResetValue;
+			if((m_picture.type == PICTURE_TYPE_P) && !(macroblock.flags & MACROBLOCK_MOTION_FORWARD))
+			{
+				//"No motion compensation" macroblocks are predicted with a null forward vector
+				macroblock.flags |= MACROBLOCK_MOTION_FORWARD;
+				memset(motionPredictors, 0, sizeof(motionPredictors));
+			}
+		}
+
+		unsigned int quantiserScale = m_picture.qScaleType ? CQuantiserScaleTable::m_nTable1[quantiserScaleCode] : CQuantiserScaleTable::m_nTable0[quantiserScaleCode];
+		macroblock.firstBlock = static_cast<uint32>(coefficients.size() / 64);
+		size_t blockCount = PopCount(macroblock.codedBlockPattern);
+		coefficients.resize(coefficients.size() + (blockCount * 64));
+		int16* block = coefficients.data() + (macroblock.firstBlock * 64);
+		for(unsigned int i = 0; i < 6; i++)
+		{
+			if(!(macroblock.codedBlockPattern & (0x20 >> i))) continue;
+			ParseBlock(bitStream, i, isIntra, quantiserScale, dcPredictors, block);
+			block += 64;
+		}
+		macroblocks.push_back(macroblock);
+	}
+}
+
+void CDecoder::ParseMotionVector(CBitStream& stream, unsigned int direction, int32 (&predictors)[2][2][2], int32* vector)
+{
+	for(unsigned int component = 0; component < 2; component++)
+	{
+		unsigned int fCode = m_picture.fCodes[direction][component];
+		if((fCode == 0) || (fCode > 9))
+		{
+			throw std::runtime_error("Invalid motion vector f_code.");
+		}
+		unsigned int rSize = fCode - 1;
+		int32 motionCode = static_cast<int16>(m_motionCodeTable->GetSymbol(&stream));
+		int32 delta = motionCode;
+		if((rSize != 0) && (motionCode != 0))
+		{
+			int32 residual = stream.GetBits_MSBF(static_cast<uint8>(rSize));
+			delta = ((std::abs(motionCode) - 1) << rSize) + residual + 1;
+			if(motionCode < 0) delta = -delta;
+		}
+		int32 low = -(16 << rSize);
+		int32 high = (16 << rSize) - 1;
+		int32 range = 32 << rSize;
+		int32 value = predictors[0][direction][component] + delta;
+		if(value < low) value += range;
+		if(value > high) value -= range;
+		predictors[0][direction][component] = value;
+		predictors[1][direction][component] = value;
+		vector[component] = value;
+	}
+}
+
+void CDecoder::ParseBlock(CBitStream& stream, unsigned int blockIndex, bool isIntra, unsigned int quantiserScale, int32* dcPredictors, int16* block)
+{
+	const uint8* scanOrder = m_scanOrders[m_picture.alternateScan ? 1 : 0];
+	const uint8* matrix = isIntra ? m_sequence.intraMatrix : m_sequence.nonIntraMatrix;
+	int32 sum = 0;
+	unsigned int index = 0;
+	CDctCoefficientTable* coefficientTable = m_dctCoefficientTables[0];
+	//First coefficient of non-intra blocks has a shorter code for run 0, level 1
+	bool isFirstCoefficient = !isIntra;
+
+	if(isIntra)
+	{
+		unsigned int component = (blockIndex < 4) ? 0 : (blockIndex - 3);
+		unsigned int dcSize = m_dcSizeTables[(component == 0) ? 0 : 1]->GetSymbol(&stream);
+		int32 differential = 0;
+		if(dcSize != 0)
+		{
+			differential = stream.GetBits_MSBF(static_cast<uint8>(dcSize));
+			if(!(differential & (1 << (dcSize - 1))))
+			{
+				differential = differential + 1 - (1 << dcSize);
+			}
+		}
+		dcPredictors[component] += differential;
+		int32 value = dcPredictors[component] * (8 >> m_picture.intraDcPrecision);
+		block[0] = static_cast<int16>(value);
+		sum += value;
+		index = 1;
+		coefficientTable = m_dctCoefficientTables[m_picture.intraVlcFormat ? 1 : 0];
+	}
+
+	while(true)
+	{
+		RUNLEVELPAIR pair;
+		if(isFirstCoefficient)
+		{
+			coefficientTable->GetRunLevelPairDc(&stream, &pair, true);
+			isFirstCoefficient = false;
+		}
+		else
+		{
+			if(coefficientTable->IsEndOfBlock(&stream))
+			{
+				coefficientTable->SkipEndOfBlock(&stream);
+				break;
+			}
+			coefficientTable->GetRunLevelPair(&stream, &pair, true);
+		}
+		index += pair.run;
+		if(index >= 64)
+		{
+			throw std::runtime_error("DCT coefficient index out of range.");
+		}
+		int32 level = static_cast<int32>(pair.level);
+		unsigned int position = scanOrder[index];
+		int32 value = isIntra ? (level * 2 * matrix[position] * static_cast<int32>(quantiserScale)) / 32
+		                      : ((2 * level + ((level > 0) ? 1 : -1)) * matrix[position] * static_cast<int32>(quantiserScale)) / 32;
+		value = std::min<int32>(std::max<int32>(value, -2048), 2047);
+		block[position] = static_cast<int16>(value);
+		sum += value;
+		index++;
+	}
+
+	//Mismatch control
+	if(!(sum & 1))
+	{
+		block[63] ^= 1;
+	}
+}
+
+void CDecoder::ReconstructMacroblock(const MACROBLOCK& macroblock, const int16* samples, PICTURE_BUFFER& picture)
+{
+	unsigned int mbX = macroblock.address % m_sequence.mbWidth;
+	unsigned int mbY = macroblock.address / m_sequence.mbWidth;
+	unsigned int lumaStride = picture.strides[0];
+	unsigned int chromaStride = picture.strides[1];
+	uint8* planes[3] =
+	{
+		picture.planes[0].data() + (mbY * 16 * lumaStride) + (mbX * 16),
+		picture.planes[1].data() + (mbY * 8 * chromaStride) + (mbX * 8),
+		picture.planes[2].data() + (mbY * 8 * chromaStride) + (mbX * 8),
+	};
+
+	//Luma blocks of field DCT macroblocks are made of every other line
+	unsigned int lumaBlockStride = macroblock.fieldDct ? (lumaStride * 2) : lumaStride;
+	unsigned int lumaBlockOffsets[4] =
+	{
+		0,
+		8,
+		macroblock.fieldDct ? lumaStride : (lumaStride * 8),
+		(macroblock.fieldDct ? lumaStride : (lumaStride * 8)) + 8,
+	};
+	unsigned int predictionBlockStride = macroblock.fieldDct ? 32 : 16;
+	unsigned int predictionBlockOffsets[4] =
+	{
+		0,
+		8,
+		macroblock.fieldDct ? 16U : 128U,
+		(macroblock.fieldDct ? 16U : 128U) + 8,
+	};
+
+	if(macroblock.flags & MACROBLOCK_INTRA)
+	{
+		for(unsigned int i = 0; i < 4; i++)
+		{
+			MotionCompensation::StoreSamples(planes[0] + lumaBlockOffsets[i], lumaBlockStride, samples + (i * 64));
+		}
+		MotionCompensation::StoreSamples(planes[1], chromaStride, samples + (4 * 64));
+		MotionCompensation::StoreSamples(planes[2], chromaStride, samples + (5 * 64));
+		return;
+	}
+
+	//[Y/Cb/Cr], chroma predictions are 8x8
+	uint8 predictions[2][3][256];
+	unsigned int predictionCount = 0;
+	unsigned int lumaWidth = m_sequence.mbWidth * 16;
+	unsigned int lumaHeight = m_sequence.mbHeight * 16;
+	for(unsigned int direction = 0; direction < 2; direction++)
+	{
+		uint32 motionFlag = (direction == 0) ? MACROBLOCK_MOTION_FORWARD : MACROBLOCK_MOTION_BACKWARD;
+		if(!(macroblock.flags & motionFlag)) continue;
+		const PICTURE_BUFFER* reference = m_predictionReferences[direction];
+		assert(reference);
+		auto& prediction = predictions[predictionCount++];
+		int32 vectorX = macroblock.vectors[direction][0];
+		int32 vectorY = macroblock.vectors[direction][1];
+		PredictBlock(prediction[0], reference->planes[0].data(), lumaStride, lumaWidth, lumaHeight,
+		             (mbX * 16) + (vectorX >> 1), (mbY * 16) + (vectorY >> 1), GetHalfSample(vectorX, vectorY), 16);
+		//Chroma vectors are halved, rounding towards zero
+		int32 chromaX = vectorX / 2;
+		int32 chromaY = vectorY / 2;
+		for(unsigned int plane = 1; plane < 3; plane++)
+		{
+			PredictBlock(prediction[plane], reference->planes[plane].data(), chromaStride, lumaWidth / 2, lumaHeight / 2,
+			             (mbX * 8) + (chromaX >> 1), (mbY * 8) + (chromaY >> 1), GetHalfSample(chromaX, chromaY), 8);
+		}
+	}
+	if(predictionCount == 2)
+	{
+		MotionCompensation::Average(predictions[0][0], 16, predictions[1][0], 16, 16, 16);
+		MotionCompensation::Average(predictions[0][1], 8, predictions[1][1], 8, 8, 8);
+		MotionCompensation::Average(predictions[0][2], 8, predictions[1][2], 8, 8, 8);
+	}
+
+	const int16* blockSamples = samples;
+	for(unsigned int i = 0; i < 6; i++)
+	{
+		uint8* output = (i < 4) ? (planes[0] + lumaBlockOffsets[i]) : planes[i - 3];
+		unsigned int outputStride = (i < 4) ? lumaBlockStride : chromaStride;
+		const uint8* prediction = (i < 4) ? (predictions[0][0] + predictionBlockOffsets[i]) : predictions[0][i - 3];
+		unsigned int predictionStride = (i < 4) ? predictionBlockStride : 8;
+		if(macroblock.codedBlockPattern & (0x20 >> i))
+		{
+			MotionCompensation::AddResidual(output, outputStride, prediction, predictionStride, blockSamples);
+			blockSamples += 64;
+		}
+		else
+		{
+			MotionCompensation::Predict(output, outputStride, prediction, predictionStride, 8, 8, MotionCompensation::HALF_SAMPLE_NONE);
+		}
+	}
+}
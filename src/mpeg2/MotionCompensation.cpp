@@ -0,0 +1,358 @@
+#include "mpeg2/MotionCompensation.h"
+#include <algorithm>
+#include <cassert>
+#include "SimdDefs.h"
+
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+#include <emmintrin.h>
+#elif defined(FRAMEWORK_SIMD_USE_NEON)
+#include <arm_neon.h>
+#endif
+
+using namespace MPEG2;
+
+namespace
+{
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+
+	//Lines are 16 samples, or 8 samples in the low half
+	template <unsigned int Width>
+	__m128i LoadLine(const uint8* input)
+	{
+		if(Width == 16) return _mm_loadu_si128(reinterpret_cast<const __m128i*>(input));
+		return _mm_loadl_epi64(reinterpret_cast<const __m128i*>(input));
+	}
+
+	template <unsigned int Width>
+	void StoreLine(uint8* output, __m128i value)
+	{
+		if(Width == 16)
+		{
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(output), value);
+		}
+		else
+		{
+			_mm_storel_epi64(reinterpret_cast<__m128i*>(output), value);
+		}
+	}
+
+	//(a + b + c + d + 2) >> 2, pavgb can't be chained without rounding errors
+	__m128i Average4(__m128i a, __m128i b, __m128i c, __m128i d)
+	{
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i two = _mm_set1_epi16(2);
+		__m128i sumLo = _mm_add_epi16(_mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero)),
+		                              _mm_add_epi16(_mm_unpacklo_epi8(c, zero), _mm_unpacklo_epi8(d, zero)));
+		__m128i sumHi = _mm_add_epi16(_mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero)),
+		                              _mm_add_epi16(_mm_unpackhi_epi8(c, zero), _mm_unpackhi_epi8(d, zero)));
+		sumLo = _mm_srli_epi16(_mm_add_epi16(sumLo, two), 2);
+		sumHi = _mm_srli_epi16(_mm_add_epi16(sumHi, two), 2);
+		return _mm_packus_epi16(sumLo, sumHi);
+	}
+
+	template <unsigned int Width>
+	void PredictBlock(uint8* output, unsigned int outputStride, const uint8* source, unsigned int sourceStride,
+	                  unsigned int height, unsigned int halfSample)
+	{
+		switch(halfSample)
+		{
+		case MotionCompensation::HALF_SAMPLE_NONE:
+			for(unsigned int y = 0; y < height; y++)
+			{
+				StoreLine<Width>(output + (y * outputStride), LoadLine<Width>(source + (y * sourceStride)));
+			}
+			break;
+		case MotionCompensation::HALF_SAMPLE_X:
+			for(unsigned int y = 0; y < height; y++)
+			{
+				const uint8* line = source + (y * sourceStride);
+				StoreLine<Width>(output + (y * outputStride), _mm_avg_epu8(LoadLine<Width>(line), LoadLine<Width>(line + 1)));
+			}
+			break;
+		case MotionCompensation::HALF_SAMPLE_Y:
+			{
+				__m128i line0 = LoadLine<Width>(source);
+				for(unsigned int y = 0; y < height; y++)
+				{
+					__m128i line1 = LoadLine<Width>(source + ((y + 1) * sourceStride));
+					StoreLine<Width>(output + (y * outputStride), _mm_avg_epu8(line0, line1));
+					line0 = line1;
+				}
+			}
+			break;
+		case MotionCompensation::HALF_SAMPLE_XY:
+			{
+				__m128i line0 = LoadLine<Width>(source);
+				__m128i line0Next = LoadLine<Width>(source + 1);
+				for(unsigned int y = 0; y < height; y++)
+				{
+					const uint8* line = source + ((y + 1) * sourceStride);
+					__m128i line1 = LoadLine<Width>(line);
+					__m128i line1Next = LoadLine<Width>(line + 1);
+					StoreLine<Width>(output + (y * outputStride), Average4(line0, line0Next, line1, line1Next));
+					line0 = line1;
+					line0Next = line1Next;
+				}
+			}
+			break;
+		default:
+			assert(false);
+			break;
+		}
+	}
+
+	template <unsigned int Width>
+	void AverageBlock(uint8* output, unsigned int outputStride, const uint8* input, unsigned int inputStride, unsigned int height)
+	{
+		for(unsigned int y = 0; y < height; y++)
+		{
+			uint8* outputLine = output + (y * outputStride);
+			StoreLine<Width>(outputLine, _mm_avg_epu8(LoadLine<Width>(outputLine), LoadLine<Width>(input + (y * inputStride))));
+		}
+	}
+
+	void AddResidualBlock(uint8* output, unsigned int outputStride, const uint8* prediction, unsigned int predictionStride, const int16* residual)
+	{
+		const __m128i zero = _mm_setzero_si128();
+		for(unsigned int y = 0; y < 8; y++)
+		{
+			__m128i samples = _mm_unpacklo_epi8(LoadLine<8>(prediction + (y * predictionStride)), zero);
+			samples = _mm_adds_epi16(samples, _mm_loadu_si128(reinterpret_cast<const __m128i*>(residual + (y * 8))));
+			StoreLine<8>(output + (y * outputStride), _mm_packus_epi16(samples, samples));
+		}
+	}
+
+	void StoreSamplesBlock(uint8* output, unsigned int outputStride, const int16* samples)
+	{
+		for(unsigned int y = 0; y < 8; y += 2)
+		{
+			__m128i line0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(samples + (y * 8)));
+			__m128i line1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(samples + ((y + 1) * 8)));
+			__m128i packed = _mm_packus_epi16(line0, line1);
+			StoreLine<8>(output + (y * outputStride), packed);
+			StoreLine<8>(output + ((y + 1) * outputStride), _mm_srli_si128(packed, 8));
+		}
+	}
+
+#elif defined(FRAMEWORK_SIMD_USE_NEON)
+
+	template <unsigned int Width>
+	uint8x16_t LoadLine(const uint8* input)
+	{
+		if(Width == 16) return vld1q_u8(input);
+		return vcombine_u8(vld1_u8(input), vdup_n_u8(0));
+	}
+
+	template <unsigned int Width>
+	void StoreLine(uint8* output, uint8x16_t value)
+	{
+		if(Width == 16)
+		{
+			vst1q_u8(output, value);
+		}
+		else
+		{
+			vst1_u8(output, vget_low_u8(value));
+		}
+	}
+
+	//(a + b + c + d + 2) >> 2
+	uint8x16_t Average4(uint8x16_t a, uint8x16_t b, uint8x16_t c, uint8x16_t d)
+	{
+		uint16x8_t sumLo = vaddq_u16(vaddl_u8(vget_low_u8(a), vget_low_u8(b)), vaddl_u8(vget_low_u8(c), vget_low_u8(d)));
+		uint16x8_t sumHi = vaddq_u16(vaddl_u8(vget_high_u8(a), vget_high_u8(b)), vaddl_u8(vget_high_u8(c), vget_high_u8(d)));
+		return vcombine_u8(vrshrn_n_u16(sumLo, 2), vrshrn_n_u16(sumHi, 2));
+	}
+
+	template <unsigned int Width>
+	void PredictBlock(uint8* output, unsigned int outputStride, const uint8* source, unsigned int sourceStride,
+	                  unsigned int height, unsigned int halfSample)
+	{
+		switch(halfSample)
+		{
+		case MotionCompensation::HALF_SAMPLE_NONE:
+			for(unsigned int y = 0; y < height; y++)
+			{
+				StoreLine<Width>(output + (y * outputStride), LoadLine<Width>(source + (y * sourceStride)));
+			}
+			break;
+		case MotionCompensation::HALF_SAMPLE_X:
+			for(unsigned int y = 0; y < height; y++)
+			{
+				const uint8* line = source + (y * sourceStride);
+				StoreLine<Width>(output + (y * outputStride), vrhaddq_u8(LoadLine<Width>(line), LoadLine<Width>(line + 1)));
+			}
+			break;
+		case MotionCompensation::HALF_SAMPLE_Y:
+			{
+				uint8x16_t line0 = LoadLine<Width>(source);
+				for(unsigned int y = 0; y < height; y++)
+				{
+					uint8x16_t line1 = LoadLine<Width>(source + ((y + 1) * sourceStride));
+					StoreLine<Width>(output + (y * outputStride), vrhaddq_u8(line0, line1));
+					line0 = line1;
+				}
+			}
+			break;
+		case MotionCompensation::HALF_SAMPLE_XY:
+			{
+				uint8x16_t line0 = LoadLine<Width>(source);
+				uint8x16_t line0Next = LoadLine<Width>(source + 1);
+				for(unsigned int y = 0; y < height; y++)
+				{
+					const uint8* line = source + ((y + 1) * sourceStride);
+					uint8x16_t line1 = LoadLine<Width>(line);
+					uint8x16_t line1Next = LoadLine<Width>(line + 1);
+					StoreLine<Width>(output + (y * outputStride), Average4(line0, line0Next, line1, line1Next));
+					line0 = line1;
+					line0Next = line1Next;
+				}
+			}
+			break;
+		default:
+			assert(false);
+			break;
+		}
+	}
+
+	template <unsigned int Width>
+	void AverageBlock(uint8* output, unsigned int outputStride, const uint8* input, unsigned int inputStride, unsigned int height)
+	{
+		for(unsigned int y = 0; y < height; y++)
+		{
+			uint8* outputLine = output + (y * outputStride);
+			StoreLine<Width>(outputLine, vrhaddq_u8(LoadLine<Width>(outputLine), LoadLine<Width>(input + (y * inputStride))));
+		}
+	}
+
+	void AddResidualBlock(uint8* output, unsigned int outputStride, const uint8* prediction, unsigned int predictionStride, const int16* residual)
+	{
+		for(unsigned int y = 0; y < 8; y++)
+		{
+			int16x8_t samples = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(prediction + (y * predictionStride))));
+			samples = vqaddq_s16(samples, vld1q_s16(residual + (y * 8)));
+			vst1_u8(output + (y * outputStride), vqmovun_s16(samples));
+		}
+	}
+
+	void StoreSamplesBlock(uint8* output, unsigned int outputStride, const int16* samples)
+	{
+		for(unsigned int y = 0; y < 8; y++)
+		{
+			vst1_u8(output + (y * outputStride), vqmovun_s16(vld1q_s16(samples + (y * 8))));
+		}
+	}
+
+#else
+
+	uint8 ClampSample(int32 value)
+	{
+		return static_cast<uint8>(std::min<int32>(std::max<int32>(value, 0), 255));
+	}
+
+	template <unsigned int Width>
+	void PredictBlock(uint8* output, unsigned int outputStride, const uint8* source, unsigned int sourceStride,
+	                  unsigned int height, unsigned int halfSample)
+	{
+		for(unsigned int y = 0; y < height; y++)
+		{
+			const uint8* line0 = source + (y * sourceStride);
+			const uint8* line1 = line0 + sourceStride;
+			uint8* outputLine = output + (y * outputStride);
+			for(unsigned int x = 0; x < Width; x++)
+			{
+				switch(halfSample)
+				{
+				case MotionCompensation::HALF_SAMPLE_X:
+					outputLine[x] = static_cast<uint8>((line0[x] + line0[x + 1] + 1) >> 1);
+					break;
+				case MotionCompensation::HALF_SAMPLE_Y:
+					outputLine[x] = static_cast<uint8>((line0[x] + line1[x] + 1) >> 1);
+					break;
+				case MotionCompensation::HALF_SAMPLE_XY:
+					outputLine[x] = static_cast<uint8>((line0[x] + line0[x + 1] + line1[x] + line1[x + 1] + 2) >> 2);
+					break;
+				default:
+					outputLine[x] = line0[x];
+					break;
+				}
+			}
+		}
+	}
+
+	template <unsigned int Width>
+	void AverageBlock(uint8* output, unsigned int outputStride, const uint8* input, unsigned int inputStride, unsigned int height)
+	{
+		for(unsigned int y = 0; y < height; y++)
+		{
+			uint8* outputLine = output + (y * outputStride);
+			const uint8* inputLine = input + (y * inputStride);
+			for(unsigned int x = 0; x < Width; x++)
+			{
+				outputLine[x] = static_cast<uint8>((outputLine[x] + inputLine[x] + 1) >> 1);
+			}
+		}
+	}
+
+	void AddResidualBlock(uint8* output, unsigned int outputStride, const uint8* prediction, unsigned int predictionStride, const int16* residual)
+	{
+		for(unsigned int y = 0; y < 8; y++)
+		{
+			for(unsigned int x = 0; x < 8; x++)
+			{
+				output[(y * outputStride) + x] = ClampSample(prediction[(y * predictionStride) + x] + residual[(y * 8) + x]);
+			}
+		}
+	}
+
+	void StoreSamplesBlock(uint8* output, unsigned int outputStride, const int16* samples)
+	{
+		for(unsigned int y = 0; y < 8; y++)
+		{
+			for(unsigned int x = 0; x < 8; x++)
+			{
+				output[(y * outputStride) + x] = ClampSample(samples[(y * 8) + x]);
+			}
+		}
+	}
+
+#endif
+}
+
+void MotionCompensation::Predict(uint8* output, unsigned int outputStride, const uint8* source, unsigned int sourceStride,
+                                 unsigned int width, unsigned int height, unsigned int halfSample)
+{
+	assert((width == 8) || (width == 16));
+	if(width == 16)
+	{
+		PredictBlock<16>(output, outputStride, source, sourceStride, height, halfSample);
+	}
+	else
+	{
+		PredictBlock<8>(output, outputStride, source, sourceStride, height, halfSample);
+	}
+}
+
+void MotionCompensation::Average(uint8* output, unsigned int outputStride, const uint8* input, unsigned int inputStride,
+                                 unsigned int width, unsigned int height)
+{
+	assert((width == 8) || (width == 16));
+	if(width == 16)
+	{
+		AverageBlock<16>(output, outputStride, input, inputStride, height);
+	}
+	else
+	{
+		AverageBlock<8>(output, outputStride, input, inputStride, height);
+	}
+}
+
+void MotionCompensation::AddResidual(uint8* output, unsigned int outputStride, const uint8* prediction, unsigned int predictionStride, const int16* residual)
+{
+	AddResidualBlock(output, outputStride, prediction, predictionStride, residual);
+}
+
+void MotionCompensation::StoreSamples(uint8* output, unsigned int outputStride, const int16* samples)
+{
+	StoreSamplesBlock(output, outputStride, samples);
+}
@@ -1,4 +1,5 @@
 #include <assert.h>
+#include <algorithm>
 #include "mpeg2/VLCTable.h"
 
 using namespace MPEG2;
@@ -10,7 +11,7 @@ CVLCTable::CVLCTable(unsigned int maxBits, VLCTABLEENTRY* tableEntry, unsigned i
 , m_entryCount(entryCount)
 , m_indexTable(indexTable)
 {
-
+	BuildLookupTable();
 }
 
 CVLCTable::~CVLCTable()
@@ -19,6 +20,37 @@ CVLCTable::~CVLCTable()
 }
 
 CVLCTable::DECODE_STATUS CVLCTable::TryPeekSymbol(CBitStream* stream, const VLCTABLEENTRY*& result)
+{
+	uint32 value = 0;
+	if(!stream->TryPeekBits_MSBF(m_primaryBits, value))
+	{
+		//Not enough data for a full lookup, a shorter symbol might still match
+		return TryPeekSymbolSlow(stream, result);
+	}
+
+	auto lookupEntry = &m_lookupTable[value];
+	if(lookupEntry->type == LOOKUP_TYPE_SUBTABLE)
+	{
+		unsigned int totalBits = m_primaryBits + lookupEntry->bits;
+		if(!stream->TryPeekBits_MSBF(totalBits, value))
+		{
+			return TryPeekSymbolSlow(stream, result);
+		}
+		value &= (1 << lookupEntry->bits) - 1;
+		lookupEntry = &m_lookupTable[lookupEntry->index + value];
+	}
+
+	if(lookupEntry->type != LOOKUP_TYPE_SYMBOL)
+	{
+		result = NULL;
+		return DECODE_STATUS_SYMBOLNOTFOUND;
+	}
+
+	result = &m_tableEntry[lookupEntry->index];
+	return DECODE_STATUS_SUCCESS;
+}
+
+CVLCTable::DECODE_STATUS CVLCTable::TryPeekSymbolSlow(CBitStream* stream, const VLCTABLEENTRY*& result)
 {
 	result = NULL;
 
@@ -79,6 +111,87 @@ uint32 CVLCTable::GetSymbol(CBitStream* stream)
 	return tableEntry->value;
 }
 
+unsigned int CVLCTable::GetEntryCount() const
+{
+	return m_entryCount;
+}
+
+const VLCTABLEENTRY& CVLCTable::GetEntry(unsigned int index) const
+{
+	assert(index < m_entryCount);
+	return m_tableEntry[index];
+}
+
+void CVLCTable::BuildLookupTable()
+{
+	//Symbols are visited in the same order as a linear search would, so
+	//that the first matching symbol is the one that ends up in the table.
+	m_primaryBits = std::min<unsigned int>(m_maxBits, PRIMARY_BITS);
+	m_lookupTable.resize(1 << m_primaryBits, LOOKUPENTRY{LOOKUP_TYPE_EMPTY, 0, 0});
+
+	//First pass: find out the size of every subtable
+	for(unsigned int i = m_primaryBits; i < m_maxBits; i++)
+	{
+		unsigned int codeLength = i + 1;
+		for(unsigned int j = m_indexTable[i]; j < m_entryCount; j++)
+		{
+			const auto& entry = m_tableEntry[j];
+			if(entry.codeLength != codeLength) break;
+			auto& lookupEntry = m_lookupTable[entry.code >> (codeLength - m_primaryBits)];
+			lookupEntry.bits = std::max<uint16>(lookupEntry.bits, codeLength - m_primaryBits);
+		}
+	}
+
+	for(unsigned int i = 0; i < m_maxBits; i++)
+	{
+		unsigned int codeLength = i + 1;
+		for(unsigned int j = m_indexTable[i]; j < m_entryCount; j++)
+		{
+			const auto& entry = m_tableEntry[j];
+			if(entry.codeLength != codeLength) break;
+			uint32 tableIndex = 0;
+			unsigned int tableBits = 0;
+			unsigned int subCodeLength = codeLength;
+			uint32 code = entry.code;
+			if(codeLength <= m_primaryBits)
+			{
+				tableBits = m_primaryBits;
+			}
+			else
+			{
+				uint32 primaryIndex = entry.code >> (codeLength - m_primaryBits);
+				if(m_lookupTable[primaryIndex].type == LOOKUP_TYPE_SYMBOL)
+				{
+					//Shadowed by a shorter symbol
+					continue;
+				}
+				if(m_lookupTable[primaryIndex].type == LOOKUP_TYPE_EMPTY)
+				{
+					uint32 subTableIndex = static_cast<uint32>(m_lookupTable.size());
+					uint16 subTableBits = m_lookupTable[primaryIndex].bits;
+					m_lookupTable.resize(m_lookupTable.size() + (1 << subTableBits), LOOKUPENTRY{LOOKUP_TYPE_EMPTY, 0, 0});
+					m_lookupTable[primaryIndex].type = LOOKUP_TYPE_SUBTABLE;
+					m_lookupTable[primaryIndex].index = subTableIndex;
+				}
+				const auto& subTableEntry = m_lookupTable[primaryIndex];
+				tableIndex = subTableEntry.index;
+				tableBits = subTableEntry.bits;
+				subCodeLength -= m_primaryBits;
+				code &= (1 << subCodeLength) - 1;
+			}
+			uint32 fillCount = 1 << (tableBits - subCodeLength);
+			uint32 fillBase = tableIndex + (code << (tableBits - subCodeLength));
+			for(uint32 k = 0; k < fillCount; k++)
+			{
+				auto& lookupEntry = m_lookupTable[fillBase + k];
+				if(lookupEntry.type != LOOKUP_TYPE_EMPTY) continue;
+				lookupEntry.type = LOOKUP_TYPE_SYMBOL;
+				lookupEntry.index = j;
+			}
+		}
+	}
+}
+
 void CVLCTable::ThrowError(DECODE_STATUS errorCode)
 {
 	assert(errorCode != DECODE_STATUS_SUCCESS);
@@ -0,0 +1,271 @@
+#include "mysql/AsyncQueryRunner.h"
+
+#ifdef FRAMEWORK_MYSQL_HAS_NONBLOCKING_API
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <poll.h>
+#endif
+
+using namespace Framework::MySql;
+
+CAsyncQueryRunner::CAsyncQueryRunner(const CAccessInfo& accessInfo, unsigned int connectionCount)
+{
+	connectionCount = std::max<unsigned int>(connectionCount, 1);
+	m_connections.reserve(connectionCount);
+	for(unsigned int i = 0; i < connectionCount; i++)
+	{
+		CONNECTION connection;
+		connection.client = CClient(accessInfo, CClient::OPTION_NONBLOCKING);
+		m_connections.push_back(std::move(connection));
+	}
+}
+
+void CAsyncQueryRunner::Enqueue(std::string query, CompletionCallback completionCallback, ErrorCallback errorCallback)
+{
+	m_queuedQueries.push_back(QUERY{std::move(query), std::move(completionCallback), std::move(errorCallback)});
+}
+
+size_t CAsyncQueryRunner::GetPendingQueryCount() const
+{
+	return m_queuedQueries.size() + m_inFlightCount;
+}
+
+void CAsyncQueryRunner::Run()
+{
+	while(Update(-1))
+	{
+	}
+}
+
+bool CAsyncQueryRunner::Update(int timeoutMs)
+{
+	StartQueries();
+	if(m_inFlightCount == 0)
+	{
+		return false;
+	}
+
+	//Shorten the wait if the client library needs to be told about a timeout
+	auto now = Clock::now();
+	for(const auto& connection : m_connections)
+	{
+		if(connection.waitStatus & MYSQL_WAIT_TIMEOUT)
+		{
+			auto remainingMs = std::chrono::duration_cast<std::chrono::milliseconds>(connection.timeoutTime - now).count();
+			remainingMs = std::max<decltype(remainingMs)>(remainingMs, 0);
+			if((timeoutMs < 0) || (remainingMs < timeoutMs))
+			{
+				timeoutMs = static_cast<int>(remainingMs);
+			}
+		}
+	}
+
+	std::vector<int> readyStatuses(m_connections.size(), 0);
+
+#ifdef _WIN32
+	fd_set readSet, writeSet, exceptSet;
+	FD_ZERO(&readSet);
+	FD_ZERO(&writeSet);
+	FD_ZERO(&exceptSet);
+	for(const auto& connection : m_connections)
+	{
+		if(connection.waitStatus == 0) continue;
+		auto socket = mysql_get_socket(connection.client);
+		if(connection.waitStatus & MYSQL_WAIT_READ) FD_SET(socket, &readSet);
+		if(connection.waitStatus & MYSQL_WAIT_WRITE) FD_SET(socket, &writeSet);
+		if(connection.waitStatus & MYSQL_WAIT_EXCEPT) FD_SET(socket, &exceptSet);
+	}
+	timeval timeout = {timeoutMs / 1000, (timeoutMs % 1000) * 1000};
+	int result = select(0, &readSet, &writeSet, &exceptSet, (timeoutMs < 0) ? nullptr : &timeout);
+	if(result > 0)
+	{
+		for(size_t i = 0; i < m_connections.size(); i++)
+		{
+			const auto& connection = m_connections[i];
+			if(connection.waitStatus == 0) continue;
+			auto socket = mysql_get_socket(connection.client);
+			if(FD_ISSET(socket, &readSet)) readyStatuses[i] |= MYSQL_WAIT_READ;
+			if(FD_ISSET(socket, &writeSet)) readyStatuses[i] |= MYSQL_WAIT_WRITE;
+			if(FD_ISSET(socket, &exceptSet)) readyStatuses[i] |= MYSQL_WAIT_EXCEPT;
+		}
+	}
+#else
+	std::vector<pollfd> pollDescs;
+	std::vector<size_t> pollConnectionIndices;
+	for(size_t i = 0; i < m_connections.size(); i++)
+	{
+		const auto& connection = m_connections[i];
+		if(connection.waitStatus == 0) continue;
+		pollfd pollDesc = {};
+		pollDesc.fd = mysql_get_socket(connection.client);
+		if(connection.waitStatus & MYSQL_WAIT_READ) pollDesc.events |= POLLIN;
+		if(connection.waitStatus & MYSQL_WAIT_WRITE) pollDesc.events |= POLLOUT;
+		if(connection.waitStatus & MYSQL_WAIT_EXCEPT) pollDesc.events |= POLLPRI;
+		pollDescs.push_back(pollDesc);
+		pollConnectionIndices.push_back(i);
+	}
+	int result = 0;
+	do
+	{
+		result = poll(pollDescs.data(), pollDescs.size(), timeoutMs);
+	} while((result < 0) && (errno == EINTR));
+	if(result > 0)
+	{
+		for(size_t i = 0; i < pollDescs.size(); i++)
+		{
+			const auto& pollDesc = pollDescs[i];
+			size_t connectionIndex = pollConnectionIndices[i];
+			int& readyStatus = readyStatuses[connectionIndex];
+			if(pollDesc.revents & POLLIN) readyStatus |= MYSQL_WAIT_READ;
+			if(pollDesc.revents & POLLOUT) readyStatus |= MYSQL_WAIT_WRITE;
+			if(pollDesc.revents & POLLPRI) readyStatus |= MYSQL_WAIT_EXCEPT;
+			//Let the client library find out about the error
+			if(pollDesc.revents & (POLLERR | POLLHUP)) readyStatus |= m_connections[connectionIndex].waitStatus & (MYSQL_WAIT_READ | MYSQL_WAIT_WRITE);
+		}
+	}
+#endif
+
+	now = Clock::now();
+	for(size_t i = 0; i < m_connections.size(); i++)
+	{
+		auto& connection = m_connections[i];
+		int readyStatus = readyStatuses[i];
+		if((readyStatus == 0) && (connection.waitStatus & MYSQL_WAIT_TIMEOUT) && (now >= connection.timeoutTime))
+		{
+			readyStatus = MYSQL_WAIT_TIMEOUT;
+		}
+		if(readyStatus != 0)
+		{
+			Continue(connection, readyStatus);
+		}
+	}
+
+	StartQueries();
+	return GetPendingQueryCount() != 0;
+}
+
+void CAsyncQueryRunner::StartQueries()
+{
+	for(auto& connection : m_connections)
+	{
+		if(m_queuedQueries.empty()) break;
+		if(connection.state != STATE::IDLE) continue;
+		connection.query = std::move(m_queuedQueries.front());
+		m_queuedQueries.pop_front();
+		connection.state = STATE::QUERYING;
+		m_inFlightCount++;
+		int error = 0;
+		const auto& text = connection.query.text;
+		int status = mysql_real_query_start(&error, connection.client, text.c_str(), static_cast<unsigned long>(text.size()));
+		OnQueryStatus(connection, status, error);
+	}
+}
+
+void CAsyncQueryRunner::Continue(CONNECTION& connection, int readyStatus)
+{
+	connection.waitStatus = 0;
+	switch(connection.state)
+	{
+	case STATE::QUERYING:
+		{
+			int error = 0;
+			int status = mysql_real_query_cont(&error, connection.client, readyStatus);
+			OnQueryStatus(connection, status, error);
+		}
+		break;
+	case STATE::STORING:
+		{
+			MYSQL_RES* result = nullptr;
+			int status = mysql_store_result_cont(&result, connection.client, readyStatus);
+			OnStoreStatus(connection, status, result);
+		}
+		break;
+	default:
+		assert(false);
+		break;
+	}
+}
+
+void CAsyncQueryRunner::OnQueryStatus(CONNECTION& connection, int status, int error)
+{
+	if(status != 0)
+	{
+		Wait(connection, status);
+		return;
+	}
+	if(error != 0)
+	{
+		Fail(connection);
+		return;
+	}
+	connection.state = STATE::STORING;
+	MYSQL_RES* result = nullptr;
+	status = mysql_store_result_start(&result, connection.client);
+	OnStoreStatus(connection, status, result);
+}
+
+void CAsyncQueryRunner::OnStoreStatus(CONNECTION& connection, int status, MYSQL_RES* result)
+{
+	if(status != 0)
+	{
+		Wait(connection, status);
+		return;
+	}
+	if(result)
+	{
+		Complete(connection, CResult(result));
+	}
+	else if(mysql_field_count(connection.client) == 0)
+	{
+		//Query doesn't return rows
+		Complete(connection, CResult());
+	}
+	else
+	{
+		Fail(connection);
+	}
+}
+
+void CAsyncQueryRunner::Wait(CONNECTION& connection, int status)
+{
+	connection.waitStatus = status;
+	if(status & MYSQL_WAIT_TIMEOUT)
+	{
+		connection.timeoutTime = Clock::now() + std::chrono::milliseconds(mysql_get_timeout_value_ms(connection.client));
+	}
+}
+
+void CAsyncQueryRunner::Complete(CONNECTION& connection, CResult result)
+{
+	//Connection is freed before the callback, which might queue other queries
+	auto query = std::move(connection.query);
+	connection.state = STATE::IDLE;
+	m_inFlightCount--;
+	if(query.completionCallback)
+	{
+		query.completionCallback(result);
+	}
+}
+
+void CAsyncQueryRunner::Fail(CONNECTION& connection)
+{
+	auto query = std::move(connection.query);
+	std::string error = mysql_error(connection.client);
+	connection.state = STATE::IDLE;
+	m_inFlightCount--;
+	if(query.errorCallback)
+	{
+		query.errorCallback(error);
+	}
+	else
+	{
+		throw std::runtime_error(error);
+	}
+}
+
+#endif
@@ -0,0 +1,269 @@
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+#include <errmsg.h>
+#include "mysql/BulkLoader.h"
+#include "mysql/Client.h"
+#include "QueryStats.h"
+
+using namespace Framework;
+using namespace Framework::MySql;
+
+static void AppendIdentifier(std::string& result, const std::string& identifier)
+{
+	//Each part of a qualified name (ie.: database.table) is quoted separately
+	result += '`';
+	for(auto character : identifier)
+	{
+		if(character == '.')
+		{
+			result += "`.`";
+		}
+		else
+		{
+			result += character;
+			if(character == '`') result += '`';
+		}
+	}
+	result += '`';
+}
+
+static void AppendCharacterLiteral(std::string& result, char character)
+{
+	result += '\'';
+	switch(character)
+	{
+	case 0:
+		break;
+	case '\t':
+		result += "\\t";
+		break;
+	case '\n':
+		result += "\\n";
+		break;
+	case '\r':
+		result += "\\r";
+		break;
+	case '\\':
+	case '\'':
+		result += '\\';
+		result += character;
+		break;
+	default:
+		result += character;
+		break;
+	}
+	result += '\'';
+}
+
+//Escapes what would be taken as a separator or an escape sequence in the default format
+static void AppendField(std::string& result, std::string_view field)
+{
+	for(auto character : field)
+	{
+		switch(character)
+		{
+		case 0:
+			result += "\\0";
+			break;
+		case '\t':
+			result += "\\t";
+			break;
+		case '\n':
+			result += "\\n";
+			break;
+		case '\r':
+			result += "\\r";
+			break;
+		case '\\':
+			result += "\\\\";
+			break;
+		default:
+			result += character;
+			break;
+		}
+	}
+}
+
+CBulkLoader::CBulkLoader(CClient& client)
+: m_client(client)
+{
+
+}
+
+void CBulkLoader::SetProgressCallback(ProgressCallback progressCallback)
+{
+	m_progressCallback = std::move(progressCallback);
+}
+
+uint64 CBulkLoader::Load(const OPTIONS& options, CStream& stream)
+{
+	DataSource source =
+		[&](char* buffer, size_t size)
+		{
+			return static_cast<size_t>(stream.Read(buffer, size));
+		};
+	return Load(MakeQuery(options, false), source);
+}
+
+uint64 CBulkLoader::Load(const OPTIONS& options, Csv::CReader& reader)
+{
+	//Rows are encoded one at a time, what doesn't fit in the library's buffer is kept for the next read
+	std::string pending;
+	size_t pendingOffset = 0;
+	bool isEnd = false;
+	DataSource source =
+		[&](char* buffer, size_t size)
+		{
+			size_t filledSize = 0;
+			while(filledSize != size)
+			{
+				if(pendingOffset == pending.size())
+				{
+					if(isEnd || !reader.Next())
+					{
+						isEnd = true;
+						break;
+					}
+					pending.clear();
+					pendingOffset = 0;
+					for(size_t i = 0; i < reader.GetFieldCount(); i++)
+					{
+						if(i != 0) pending += '\t';
+						AppendField(pending, reader.GetField(i));
+					}
+					pending += '\n';
+				}
+				size_t copySize = std::min(pending.size() - pendingOffset, size - filledSize);
+				memcpy(buffer + filledSize, pending.data() + pendingOffset, copySize);
+				pendingOffset += copySize;
+				filledSize += copySize;
+			}
+			return filledSize;
+		};
+	return Load(MakeQuery(options, true), source);
+}
+
+uint64 CBulkLoader::Load(const std::string& query, const DataSource& source)
+{
+	MYSQL* connection = m_client;
+	m_source = &source;
+	m_sentSize = 0;
+	m_isCancelled = false;
+	m_exception = std::exception_ptr();
+
+	mysql_set_local_infile_handler(connection, &InfileInit, &InfileRead, &InfileEnd, &InfileError, this);
+	int result = 0;
+	{
+		Framework::CQueryTimer timer(query.c_str());
+		result = mysql_real_query(connection, query.data(), static_cast<unsigned long>(query.size()));
+	}
+	mysql_set_local_infile_default(connection);
+	m_source = nullptr;
+
+	if(result != 0)
+	{
+		//Rows sent before the failure might have been inserted, unless the load was done in a transaction
+		if(m_exception)
+		{
+			auto exception = m_exception;
+			m_exception = std::exception_ptr();
+			std::rethrow_exception(exception);
+		}
+		if(m_isCancelled)
+		{
+			throw std::runtime_error("Bulk load was cancelled.");
+		}
+		throw std::runtime_error(mysql_error(connection));
+	}
+	return mysql_affected_rows(connection);
+}
+
+int CBulkLoader::InfileInit(void** state, const char*, void* userData)
+{
+	*state = userData;
+	return 0;
+}
+
+int CBulkLoader::InfileRead(void* state, char* buffer, unsigned int size)
+{
+	auto loader = reinterpret_cast<CBulkLoader*>(state);
+	assert(loader->m_source);
+	//Exceptions can't go through the client library, they are thrown again once the query returns
+	try
+	{
+		size_t readSize = (*loader->m_source)(buffer, std::min<size_t>(size, DEFAULT_READ_SIZE));
+		loader->m_sentSize += readSize;
+		if(loader->m_progressCallback && !loader->m_progressCallback(loader->m_sentSize))
+		{
+			loader->m_isCancelled = true;
+			return -1;
+		}
+		return static_cast<int>(readSize);
+	}
+	catch(...)
+	{
+		loader->m_exception = std::current_exception();
+		return -1;
+	}
+}
+
+void CBulkLoader::InfileEnd(void*)
+{
+
+}
+
+int CBulkLoader::InfileError(void* state, char* message, unsigned int messageSize)
+{
+	auto loader = reinterpret_cast<CBulkLoader*>(state);
+	const char* text = loader->m_isCancelled ? "Bulk load was cancelled." : "Failed to read bulk load data.";
+	if(messageSize != 0)
+	{
+		strncpy(message, text, messageSize - 1);
+		message[messageSize - 1] = 0;
+	}
+	return CR_UNKNOWN_ERROR;
+}
+
+std::string CBulkLoader::MakeQuery(const OPTIONS& options, bool isDefaultFormat)
+{
+	if(options.tableName.empty())
+	{
+		throw std::runtime_error("Bulk load needs a table name.");
+	}
+	//File name isn't used, the handler sends the source whatever the server asks for
+	std::string query = "LOAD DATA LOCAL INFILE 'stream' ";
+	query += options.replaceDuplicates ? "REPLACE" : "IGNORE";
+	query += " INTO TABLE ";
+	AppendIdentifier(query, options.tableName);
+	if(!isDefaultFormat)
+	{
+		query += " FIELDS TERMINATED BY ";
+		AppendCharacterLiteral(query, options.fieldSeparator);
+		if(options.enclosure != 0)
+		{
+			query += " OPTIONALLY ENCLOSED BY ";
+			AppendCharacterLiteral(query, options.enclosure);
+		}
+		query += " ESCAPED BY ";
+		AppendCharacterLiteral(query, options.escape);
+		query += " LINES TERMINATED BY ";
+		AppendCharacterLiteral(query, options.lineSeparator);
+		if(options.ignoredLineCount != 0)
+		{
+			query += " IGNORE " + std::to_string(options.ignoredLineCount) + " LINES";
+		}
+	}
+	if(!options.columnNames.empty())
+	{
+		query += " (";
+		for(size_t i = 0; i < options.columnNames.size(); i++)
+		{
+			if(i != 0) query += ", ";
+			AppendIdentifier(query, options.columnNames[i]);
+		}
+		query += ")";
+	}
+	return query;
+}
@@ -1,5 +1,7 @@
 #include <stdexcept>
+#include <errmsg.h>
 #include "mysql/Client.h"
+#include "QueryStats.h"
 
 using namespace Framework::MySql;
 
@@ -17,6 +19,17 @@ CClient::CClient(CClient&& src)
 
 CClient::CClient(const char* hostName, const char* userName, const char* password, const char* database)
 : m_connection(nullptr)
+{
+	Connect(hostName, userName, password, database, 0);
+}
+
+CClient::CClient(const CAccessInfo& accessInfo, uint32 options)
+: m_connection(nullptr)
+{
+	Connect(accessInfo.address.c_str(), accessInfo.userName.c_str(), accessInfo.password.c_str(), accessInfo.databaseName.c_str(), options);
+}
+
+void CClient::Connect(const char* hostName, const char* userName, const char* password, const char* database, uint32 options)
 {
 	m_connection = mysql_init(NULL);
 	if(!m_connection)
@@ -24,9 +37,27 @@ CClient::CClient(const char* hostName, const char* userName, const char* passwor
 		throw std::exception();
 	}
 
+	if(options & OPTION_NONBLOCKING)
+	{
+#ifdef FRAMEWORK_MYSQL_HAS_NONBLOCKING_API
+		mysql_options(m_connection, MYSQL_OPT_NONBLOCK, 0);
+#else
+		Reset();
+		throw std::runtime_error("Non-blocking connections are not supported by this client library.");
+#endif
+	}
+
+	if(options & OPTION_LOCAL_INFILE)
+	{
+		unsigned int enabled = 1;
+		mysql_options(m_connection, MYSQL_OPT_LOCAL_INFILE, &enabled);
+	}
+
 	if(mysql_real_connect(m_connection, hostName, userName, password, database, 0, NULL, 0) == NULL)
 	{
-		throw std::runtime_error(mysql_error(m_connection));
+		std::string error = mysql_error(m_connection);
+		Reset();
+		throw std::runtime_error(error);
 	}
 }
 
@@ -63,6 +94,7 @@ void CClient::MoveFrom(CClient&& src)
 
 CResult CClient::Query(const char* query)
 {
+	Framework::CQueryTimer timer(query);
 	if(mysql_query(m_connection, query) != 0)
 	{
 		throw std::runtime_error(mysql_error(m_connection));
@@ -70,3 +102,34 @@ CResult CClient::Query(const char* query)
 	auto result = CResult(mysql_store_result(m_connection));
 	return result;
 }
+
+CResult CClient::QueryStreamed(const char* query)
+{
+	Framework::CQueryTimer timer(query);
+	if(mysql_query(m_connection, query) != 0)
+	{
+		throw std::runtime_error(mysql_error(m_connection));
+	}
+	return CResult(mysql_use_result(m_connection));
+}
+
+CStatement CClient::Prepare(const char* query)
+{
+	return CStatement(m_connection, query);
+}
+
+bool CClient::Ping()
+{
+	return mysql_ping(m_connection) == 0;
+}
+
+bool CClient::IsConnectionLost() const
+{
+	unsigned int error = mysql_errno(m_connection);
+	return (error == CR_SERVER_GONE_ERROR) || (error == CR_SERVER_LOST);
+}
+
+CClient::operator MYSQL*() const
+{
+	return m_connection;
+}
@@ -0,0 +1,176 @@
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+#include "mysql/ConnectionPool.h"
+
+using namespace Framework::MySql;
+
+CConnectionPool::CConnectionPool(CAccessInfo accessInfo, unsigned int maxConnections, std::chrono::seconds idleTimeout)
+: m_accessInfo(std::move(accessInfo))
+, m_maxConnections(std::max<unsigned int>(maxConnections, 1))
+, m_idleTimeout(idleTimeout)
+{
+
+}
+
+CConnectionPool::~CConnectionPool()
+{
+	assert(m_idleConnections.size() == m_connectionCount);
+}
+
+CConnectionLease CConnectionPool::Acquire()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while(true)
+	{
+		if(!m_idleConnections.empty())
+		{
+			auto idleConnection = std::move(m_idleConnections.back());
+			m_idleConnections.pop_back();
+			auto idleTime = Clock::now() - idleConnection.releaseTime;
+			if(idleTime < std::chrono::seconds(HEALTH_CHECK_INTERVAL_SEC))
+			{
+				return CConnectionLease(this, std::move(idleConnection.client));
+			}
+			//Check the connection outside of the lock, the server might take a while to answer
+			lock.unlock();
+			bool alive = idleConnection.client->Ping();
+			if(alive)
+			{
+				return CConnectionLease(this, std::move(idleConnection.client));
+			}
+			idleConnection.client.reset();
+			lock.lock();
+			m_connectionCount--;
+			continue;
+		}
+		if(m_connectionCount < m_maxConnections)
+		{
+			//Reserve the slot before connecting outside of the lock
+			m_connectionCount++;
+			lock.unlock();
+			try
+			{
+				auto client = std::make_unique<CClient>(m_accessInfo);
+				return CConnectionLease(this, std::move(client));
+			}
+			catch(...)
+			{
+				lock.lock();
+				m_connectionCount--;
+				lock.unlock();
+				m_connectionReleasedCondition.notify_one();
+				throw;
+			}
+		}
+		m_connectionReleasedCondition.wait(lock);
+	}
+}
+
+void CConnectionPool::ReleaseConnection(std::unique_ptr<CClient> client)
+{
+	assert(client);
+	bool connectionLost = client->IsConnectionLost();
+	if(connectionLost)
+	{
+		client.reset();
+	}
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto now = Clock::now();
+		if(connectionLost)
+		{
+			m_connectionCount--;
+		}
+		else
+		{
+			m_idleConnections.push_back(IDLE_CONNECTION{std::move(client), now});
+		}
+		ReapIdleConnectionsLocked(now);
+	}
+	m_connectionReleasedCondition.notify_one();
+}
+
+void CConnectionPool::ReapIdleConnections()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	ReapIdleConnectionsLocked(Clock::now());
+}
+
+void CConnectionPool::ReapIdleConnectionsLocked(Clock::time_point now)
+{
+	//Least recently released connections are at the front
+	auto reapEnd = std::find_if(m_idleConnections.begin(), m_idleConnections.end(),
+		[&](const IDLE_CONNECTION& idleConnection) { return (now - idleConnection.releaseTime) < m_idleTimeout; });
+	m_connectionCount -= static_cast<unsigned int>(reapEnd - m_idleConnections.begin());
+	m_idleConnections.erase(m_idleConnections.begin(), reapEnd);
+}
+
+unsigned int CConnectionPool::GetMaxConnections() const
+{
+	return m_maxConnections;
+}
+
+unsigned int CConnectionPool::GetConnectionCount()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_connectionCount;
+}
+
+unsigned int CConnectionPool::GetIdleConnectionCount()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return static_cast<unsigned int>(m_idleConnections.size());
+}
+
+CConnectionLease::CConnectionLease(CConnectionPool* pool, std::unique_ptr<CClient> client)
+: m_pool(pool)
+, m_client(std::move(client))
+{
+
+}
+
+CConnectionLease::CConnectionLease(CConnectionLease&& src)
+{
+	std::swap(m_pool, src.m_pool);
+	std::swap(m_client, src.m_client);
+}
+
+CConnectionLease::~CConnectionLease()
+{
+	Release();
+}
+
+CConnectionLease& CConnectionLease::operator =(CConnectionLease&& rhs)
+{
+	Release();
+	std::swap(m_pool, rhs.m_pool);
+	std::swap(m_client, rhs.m_client);
+	return (*this);
+}
+
+void CConnectionLease::Release()
+{
+	if(m_pool)
+	{
+		m_pool->ReleaseConnection(std::move(m_client));
+		m_pool = nullptr;
+	}
+}
+
+bool CConnectionLease::IsEmpty() const
+{
+	return !m_pool;
+}
+
+CClient& CConnectionLease::operator *() const
+{
+	assert(m_client);
+	return *m_client;
+}
+
+CClient* CConnectionLease::operator ->() const
+{
+	assert(m_client);
+	return m_client.get();
+}
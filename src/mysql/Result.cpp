@@ -1,11 +1,23 @@
 #include <exception>
 #include <algorithm>
+#include <cassert>
+#include <cstdlib>
 #include "mysql/Result.h"
 
 using namespace Framework::MySql;
 
+CResult::CResult()
+: m_result(nullptr)
+, m_row(nullptr)
+, m_rowLengths(nullptr)
+{
+
+}
+
 CResult::CResult(MYSQL_RES* result)
 : m_result(nullptr)
+, m_row(nullptr)
+, m_rowLengths(nullptr)
 {
 	if(result == nullptr)
 	{
@@ -16,6 +28,8 @@ CResult::CResult(MYSQL_RES* result)
 
 CResult::CResult(CResult&& src)
 : m_result(nullptr)
+, m_row(nullptr)
+, m_rowLengths(nullptr)
 {
 	MoveFrom(std::move(src));
 }
@@ -29,9 +43,18 @@ void CResult::Reset()
 {
 	if(m_result)
 	{
+		//Also discards the rows of a streamed result that weren't fetched
 		mysql_free_result(m_result);
 		m_result = nullptr;
 	}
+	m_row = nullptr;
+	m_rowLengths = nullptr;
+	m_fieldIndices.clear();
+}
+
+bool CResult::IsEmpty() const
+{
+	return (m_result == nullptr);
 }
 
 CResult& CResult::operator =(CResult&& rhs)
@@ -44,11 +67,21 @@ CResult& CResult::operator =(CResult&& rhs)
 void CResult::MoveFrom(CResult&& src)
 {
 	std::swap(m_result, src.m_result);
+	std::swap(m_row, src.m_row);
+	std::swap(m_rowLengths, src.m_rowLengths);
+	std::swap(m_fieldIndices, src.m_fieldIndices);
 }
 
 MYSQL_ROW CResult::FetchRow()
 {
-	return mysql_fetch_row(m_result);
+	m_row = mysql_fetch_row(m_result);
+	m_rowLengths = m_row ? mysql_fetch_lengths(m_result) : nullptr;
+	return m_row;
+}
+
+bool CResult::NextRow()
+{
+	return FetchRow() != nullptr;
 }
 
 unsigned int CResult::GetRowCount()
@@ -61,14 +94,59 @@ unsigned int CResult::GetFieldCount()
 	return mysql_num_fields(m_result);
 }
 
-CResult::FieldIndexMap CResult::GetFieldIndices()
+const CResult::FieldIndexMap& CResult::GetFieldIndices()
 {
-	FieldIndexMap result;
-	unsigned int fieldCount = mysql_num_fields(m_result);
-	MYSQL_FIELD* fields = mysql_fetch_fields(m_result);
-	for(unsigned int i = 0; i < fieldCount; i++)
+	if(m_fieldIndices.empty())
 	{
-		result.insert(std::make_pair(fields[i].name, i));
+		unsigned int fieldCount = mysql_num_fields(m_result);
+		MYSQL_FIELD* fields = mysql_fetch_fields(m_result);
+		for(unsigned int i = 0; i < fieldCount; i++)
+		{
+			m_fieldIndices.insert(std::make_pair(fields[i].name, i));
+		}
 	}
-	return result;
+	return m_fieldIndices;
+}
+
+int CResult::GetFieldIndex(const char* name)
+{
+	const auto& fieldIndices = GetFieldIndices();
+	auto fieldIndexIterator = fieldIndices.find(name);
+	return (fieldIndexIterator != std::end(fieldIndices)) ? fieldIndexIterator->second : -1;
+}
+
+bool CResult::IsNull(unsigned int index) const
+{
+	assert(m_row);
+	return (m_row[index] == nullptr);
+}
+
+std::string_view CResult::GetString(unsigned int index) const
+{
+	assert(m_row);
+	if(!m_row[index]) return std::string_view();
+	return std::string_view(m_row[index], m_rowLengths[index]);
+}
+
+//Values of the text protocol are null terminated
+
+int64 CResult::GetInt64(unsigned int index) const
+{
+	assert(m_row);
+	if(!m_row[index]) return 0;
+	return strtoll(m_row[index], nullptr, 10);
+}
+
+uint64 CResult::GetUInt64(unsigned int index) const
+{
+	assert(m_row);
+	if(!m_row[index]) return 0;
+	return strtoull(m_row[index], nullptr, 10);
+}
+
+double CResult::GetDouble(unsigned int index) const
+{
+	assert(m_row);
+	if(!m_row[index]) return 0;
+	return strtod(m_row[index], nullptr);
 }
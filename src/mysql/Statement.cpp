@@ -0,0 +1,384 @@
+#include <stdexcept>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include "mysql/Statement.h"
+#include "QueryStats.h"
+
+using namespace Framework::MySql;
+
+CStatement::CStatement()
+: m_statement(nullptr)
+{
+
+}
+
+CStatement::CStatement(MYSQL* connection, const char* query)
+: m_statement(nullptr)
+, m_query(query)
+{
+	m_statement = mysql_stmt_init(connection);
+	if(!m_statement)
+	{
+		throw std::runtime_error(mysql_error(connection));
+	}
+
+	if(mysql_stmt_prepare(m_statement, query, static_cast<unsigned long>(strlen(query))) != 0)
+	{
+		std::string error = mysql_stmt_error(m_statement);
+		Reset();
+		throw std::runtime_error(error);
+	}
+
+	//Parameters stay null until they are bound
+	unsigned int paramCount = mysql_stmt_param_count(m_statement);
+	m_params.resize(paramCount);
+	m_paramValues.resize(paramCount);
+	memset(m_params.data(), 0, sizeof(MYSQL_BIND) * paramCount);
+	for(unsigned int i = 0; i < paramCount; i++)
+	{
+		m_params[i].buffer_type = MYSQL_TYPE_NULL;
+	}
+
+	MYSQL_RES* metadata = mysql_stmt_result_metadata(m_statement);
+	if(!metadata)
+	{
+		//Statement doesn't produce a result set
+		return;
+	}
+
+	unsigned int fieldCount = mysql_num_fields(metadata);
+	MYSQL_FIELD* fields = mysql_fetch_fields(metadata);
+	m_columns.resize(fieldCount);
+	m_columnValues.resize(fieldCount);
+	memset(m_columns.data(), 0, sizeof(MYSQL_BIND) * fieldCount);
+	for(unsigned int i = 0; i < fieldCount; i++)
+	{
+		const auto& field = fields[i];
+		auto& column = m_columns[i];
+		auto& value = m_columnValues[i];
+		switch(field.type)
+		{
+		case MYSQL_TYPE_TINY:
+		case MYSQL_TYPE_SHORT:
+		case MYSQL_TYPE_INT24:
+		case MYSQL_TYPE_LONG:
+		case MYSQL_TYPE_LONGLONG:
+		case MYSQL_TYPE_YEAR:
+			column.buffer_type = MYSQL_TYPE_LONGLONG;
+			column.buffer = &value.integer;
+			column.is_unsigned = (field.flags & UNSIGNED_FLAG) != 0;
+			break;
+		case MYSQL_TYPE_FLOAT:
+		case MYSQL_TYPE_DOUBLE:
+			column.buffer_type = MYSQL_TYPE_DOUBLE;
+			column.buffer = &value.real;
+			break;
+		default:
+			//Decimals, dates, text and blobs are received as strings
+			value.data.resize(INITIAL_STRING_BUFFER_SIZE);
+			column.buffer_type = MYSQL_TYPE_STRING;
+			column.buffer = value.data.data();
+			column.buffer_length = static_cast<unsigned long>(value.data.size());
+			break;
+		}
+		column.length = &value.length;
+		column.is_null = &value.isNull;
+		column.error = &value.error;
+		m_fieldIndices.insert(std::make_pair(field.name, i));
+	}
+	mysql_free_result(metadata);
+}
+
+CStatement::CStatement(CStatement&& src)
+: m_statement(nullptr)
+{
+	MoveFrom(std::move(src));
+}
+
+CStatement::~CStatement()
+{
+	Reset();
+}
+
+void CStatement::Reset()
+{
+	if(m_statement)
+	{
+		mysql_stmt_close(m_statement);
+		m_statement = nullptr;
+	}
+	m_params.clear();
+	m_paramValues.clear();
+	m_columns.clear();
+	m_columnValues.clear();
+	m_fieldIndices.clear();
+	m_query.clear();
+}
+
+bool CStatement::IsEmpty() const
+{
+	return (m_statement == nullptr);
+}
+
+CStatement& CStatement::operator =(CStatement&& rhs)
+{
+	Reset();
+	MoveFrom(std::move(rhs));
+	return (*this);
+}
+
+void CStatement::MoveFrom(CStatement&& src)
+{
+	//Binds point inside the value vectors' storage, which isn't moved by swapping
+	std::swap(m_statement, src.m_statement);
+	std::swap(m_params, src.m_params);
+	std::swap(m_paramValues, src.m_paramValues);
+	std::swap(m_columns, src.m_columns);
+	std::swap(m_columnValues, src.m_columnValues);
+	std::swap(m_fieldIndices, src.m_fieldIndices);
+	std::swap(m_query, src.m_query);
+}
+
+void CStatement::ThrowError() const
+{
+	throw std::runtime_error(mysql_stmt_error(m_statement));
+}
+
+unsigned int CStatement::GetParamCount() const
+{
+	return static_cast<unsigned int>(m_params.size());
+}
+
+MYSQL_BIND& CStatement::PrepareParam(unsigned int index, enum_field_types type)
+{
+	if(index >= m_params.size())
+	{
+		throw std::out_of_range("Invalid parameter index.");
+	}
+	auto& param = m_params[index];
+	auto& value = m_paramValues[index];
+	memset(&param, 0, sizeof(MYSQL_BIND));
+	param.buffer_type = type;
+	param.length = &value.length;
+	param.is_null = &value.isNull;
+	value.isNull = 0;
+	return param;
+}
+
+void CStatement::BindNull(unsigned int index)
+{
+	PrepareParam(index, MYSQL_TYPE_NULL);
+}
+
+void CStatement::BindInt64(unsigned int index, int64 value)
+{
+	auto& param = PrepareParam(index, MYSQL_TYPE_LONGLONG);
+	auto& paramValue = m_paramValues[index];
+	paramValue.integer = value;
+	param.buffer = &paramValue.integer;
+}
+
+void CStatement::BindUInt64(unsigned int index, uint64 value)
+{
+	auto& param = PrepareParam(index, MYSQL_TYPE_LONGLONG);
+	auto& paramValue = m_paramValues[index];
+	paramValue.integer = static_cast<int64>(value);
+	param.buffer = &paramValue.integer;
+	param.is_unsigned = 1;
+}
+
+void CStatement::BindDouble(unsigned int index, double value)
+{
+	auto& param = PrepareParam(index, MYSQL_TYPE_DOUBLE);
+	auto& paramValue = m_paramValues[index];
+	paramValue.real = value;
+	param.buffer = &paramValue.real;
+}
+
+void CStatement::BindString(unsigned int index, std::string_view value)
+{
+	auto& param = PrepareParam(index, MYSQL_TYPE_STRING);
+	auto& paramValue = m_paramValues[index];
+	paramValue.data.assign(value.begin(), value.end());
+	paramValue.length = static_cast<unsigned long>(paramValue.data.size());
+	param.buffer = paramValue.data.data();
+	param.buffer_length = paramValue.length;
+}
+
+void CStatement::BindBlob(unsigned int index, const void* data, size_t size)
+{
+	auto& param = PrepareParam(index, MYSQL_TYPE_BLOB);
+	auto& paramValue = m_paramValues[index];
+	auto bytes = reinterpret_cast<const char*>(data);
+	paramValue.data.assign(bytes, bytes + size);
+	paramValue.length = static_cast<unsigned long>(paramValue.data.size());
+	param.buffer = paramValue.data.data();
+	param.buffer_length = paramValue.length;
+}
+
+void CStatement::Execute()
+{
+	Framework::CQueryTimer timer(m_query.c_str());
+	if(!m_params.empty() && (mysql_stmt_bind_param(m_statement, m_params.data()) != 0))
+	{
+		ThrowError();
+	}
+	if(mysql_stmt_execute(m_statement) != 0)
+	{
+		ThrowError();
+	}
+	if(!m_columns.empty() && (mysql_stmt_bind_result(m_statement, m_columns.data()) != 0))
+	{
+		ThrowError();
+	}
+}
+
+void CStatement::StoreResult()
+{
+	if(mysql_stmt_store_result(m_statement) != 0)
+	{
+		ThrowError();
+	}
+}
+
+bool CStatement::Fetch()
+{
+	int result = mysql_stmt_fetch(m_statement);
+	switch(result)
+	{
+	case 0:
+		return true;
+	case MYSQL_NO_DATA:
+		return false;
+	case MYSQL_DATA_TRUNCATED:
+		FetchTruncatedColumns();
+		return true;
+	default:
+		ThrowError();
+		return false;
+	}
+}
+
+void CStatement::FetchTruncatedColumns()
+{
+	bool buffersChanged = false;
+	for(unsigned int i = 0; i < m_columns.size(); i++)
+	{
+		auto& column = m_columns[i];
+		auto& value = m_columnValues[i];
+		if(!value.error || (column.buffer_type != MYSQL_TYPE_STRING))
+		{
+			continue;
+		}
+		//Grow the buffer to the actual size and keep it for the following rows
+		value.data.resize(value.length);
+		column.buffer = value.data.data();
+		column.buffer_length = value.length;
+		buffersChanged = true;
+		if(mysql_stmt_fetch_column(m_statement, &column, i, 0) != 0)
+		{
+			ThrowError();
+		}
+	}
+	if(buffersChanged && (mysql_stmt_bind_result(m_statement, m_columns.data()) != 0))
+	{
+		ThrowError();
+	}
+}
+
+uint64 CStatement::GetAffectedRowCount() const
+{
+	return mysql_stmt_affected_rows(m_statement);
+}
+
+uint64 CStatement::GetInsertId() const
+{
+	return mysql_stmt_insert_id(m_statement);
+}
+
+unsigned int CStatement::GetFieldCount() const
+{
+	return static_cast<unsigned int>(m_columns.size());
+}
+
+const CStatement::FieldIndexMap& CStatement::GetFieldIndices() const
+{
+	return m_fieldIndices;
+}
+
+int CStatement::GetFieldIndex(const char* name) const
+{
+	auto fieldIndexIterator = m_fieldIndices.find(name);
+	return (fieldIndexIterator != std::end(m_fieldIndices)) ? fieldIndexIterator->second : -1;
+}
+
+bool CStatement::IsNull(unsigned int index) const
+{
+	assert(index < m_columnValues.size());
+	return m_columnValues[index].isNull != 0;
+}
+
+int64 CStatement::GetInt64(unsigned int index) const
+{
+	assert(index < m_columns.size());
+	const auto& column = m_columns[index];
+	const auto& value = m_columnValues[index];
+	if(value.isNull) return 0;
+	switch(column.buffer_type)
+	{
+	case MYSQL_TYPE_LONGLONG:
+		return value.integer;
+	case MYSQL_TYPE_DOUBLE:
+		return static_cast<int64>(value.real);
+	default:
+		return strtoll(std::string(GetString(index)).c_str(), nullptr, 10);
+	}
+}
+
+uint64 CStatement::GetUInt64(unsigned int index) const
+{
+	assert(index < m_columns.size());
+	const auto& column = m_columns[index];
+	const auto& value = m_columnValues[index];
+	if(value.isNull) return 0;
+	switch(column.buffer_type)
+	{
+	case MYSQL_TYPE_LONGLONG:
+		return static_cast<uint64>(value.integer);
+	case MYSQL_TYPE_DOUBLE:
+		return static_cast<uint64>(value.real);
+	default:
+		return strtoull(std::string(GetString(index)).c_str(), nullptr, 10);
+	}
+}
+
+double CStatement::GetDouble(unsigned int index) const
+{
+	assert(index < m_columns.size());
+	const auto& column = m_columns[index];
+	const auto& value = m_columnValues[index];
+	if(value.isNull) return 0;
+	switch(column.buffer_type)
+	{
+	case MYSQL_TYPE_LONGLONG:
+		return column.is_unsigned ? static_cast<double>(static_cast<uint64>(value.integer)) : static_cast<double>(value.integer);
+	case MYSQL_TYPE_DOUBLE:
+		return value.real;
+	default:
+		return strtod(std::string(GetString(index)).c_str(), nullptr);
+	}
+}
+
+std::string_view CStatement::GetString(unsigned int index) const
+{
+	assert(index < m_columns.size());
+	const auto& column = m_columns[index];
+	const auto& value = m_columnValues[index];
+	if(value.isNull || (column.buffer_type != MYSQL_TYPE_STRING))
+	{
+		//Numbers aren't converted to strings
+		return std::string_view();
+	}
+	return std::string_view(value.data.data(), value.length);
+}
@@ -1,12 +1,16 @@
 #include <string.h>
 #include <exception>
+#include <algorithm>
+#include <cassert>
 #include "odbc/Statement.h"
 #include "string_cast.h"
+#include "QueryStats.h"
 
 using namespace std;
 using namespace Framework::Odbc;
 
 CStatement::CStatement(CConnection* pConnection)
+: m_nBlockRowCount(0)
 {
 	SQLAllocHandle(SQL_HANDLE_STMT, pConnection->GetConnectionHandle(), &m_StmtHandle);
 }
@@ -18,6 +22,17 @@ CStatement::~CStatement()
 
 void CStatement::Execute(const TCHAR* sQuery)
 {
+	string sQueryName;
+	if(Framework::CQueryStatsRegistry::GetInstance().IsEnabled())
+	{
+		sQueryName = string_cast<string>(sQuery);
+	}
+	Framework::CQueryTimer Timer(sQueryName.empty() ? NULL : sQueryName.c_str());
+
+	EndBlockFetch();
+	m_ColumnIndices.clear();
+	//Close the cursor of the previous query, if any
+	SQLFreeStmt(m_StmtHandle, SQL_CLOSE);
 	if(SQLExecDirect(m_StmtHandle, const_cast<TCHAR*>(sQuery), SQL_NTS) == SQL_ERROR)
 	{
 		ThrowErrorException();
@@ -26,28 +41,35 @@ void CStatement::Execute(const TCHAR* sQuery)
 
 unsigned int CStatement::GetColumnIndex(const TCHAR* sName)
 {
-	SQLSMALLINT nCount;
+	if(m_ColumnIndices.empty())
+	{
+		SQLSMALLINT nCount;
 
-	SQLNumResultCols(m_StmtHandle, &nCount);
+		SQLNumResultCols(m_StmtHandle, &nCount);
 
-	for(SQLSMALLINT i = 1; i <= nCount; i++)
-	{
-		SQLSMALLINT nNameLength;
-		TCHAR* sColumnName;
+		for(SQLSMALLINT i = 1; i <= nCount; i++)
+		{
+			SQLSMALLINT nNameLength;
+			TCHAR* sColumnName;
 
-		SQLDescribeCol(m_StmtHandle, i, NULL, 0, &nNameLength, NULL, NULL, NULL, NULL);
-		nNameLength++;
+			SQLDescribeCol(m_StmtHandle, i, NULL, 0, &nNameLength, NULL, NULL, NULL, NULL);
+			nNameLength++;
 
-		sColumnName = reinterpret_cast<TCHAR*>(_alloca(nNameLength * sizeof(TCHAR)));
-		SQLDescribeCol(m_StmtHandle, i, sColumnName, nNameLength, &nNameLength, NULL, NULL, NULL, NULL);
+			sColumnName = reinterpret_cast<TCHAR*>(_alloca(nNameLength * sizeof(TCHAR)));
+			SQLDescribeCol(m_StmtHandle, i, sColumnName, nNameLength, &nNameLength, NULL, NULL, NULL, NULL);
 
-		if(_tcscmp(sColumnName, sName) == 0)
-		{
-			return i;
+			//Keep the first column if names are repeated
+			m_ColumnIndices.insert(ColumnIndexMap::value_type(sColumnName, i));
 		}
 	}
 
-	return 0;
+	ColumnIndexMap::const_iterator itColumn = m_ColumnIndices.find(sName);
+	if(itColumn == m_ColumnIndices.end())
+	{
+		return 0;
+	}
+
+	return itColumn->second;
 }
 
 void CStatement::BindColumn(int nIndex, unsigned int* nValue)
@@ -156,6 +178,157 @@ bool CStatement::FetchRow()
 	return SQLFetch(m_StmtHandle) != SQL_NO_DATA;
 }
 
+void CStatement::BeginBlockFetch(unsigned int nRowArraySize, unsigned int nMaxStringLength)
+{
+	EndBlockFetch();
+
+	nRowArraySize = std::max<unsigned int>(nRowArraySize, 1);
+
+	SQLSMALLINT nCount;
+	SQLNumResultCols(m_StmtHandle, &nCount);
+
+	m_BlockColumns.resize(nCount);
+	for(SQLSMALLINT i = 1; i <= nCount; i++)
+	{
+		SQLSMALLINT nDataType;
+		SQLULEN nColumnSize;
+		SQLDescribeCol(m_StmtHandle, i, NULL, 0, NULL, &nDataType, &nColumnSize, NULL, NULL);
+
+		BLOCKCOLUMN& Column(m_BlockColumns[i - 1]);
+		switch(nDataType)
+		{
+		case SQL_BIT:
+		case SQL_TINYINT:
+		case SQL_SMALLINT:
+		case SQL_INTEGER:
+		case SQL_BIGINT:
+			Column.nCType = SQL_C_SBIGINT;
+			Column.nElementSize = sizeof(int64);
+			break;
+		case SQL_REAL:
+		case SQL_FLOAT:
+		case SQL_DOUBLE:
+			Column.nCType = SQL_C_DOUBLE;
+			Column.nElementSize = sizeof(double);
+			break;
+		default:
+			{
+				//Room for the terminator
+				SQLULEN nLength = std::min<SQLULEN>((nColumnSize == 0) ? nMaxStringLength : nColumnSize, nMaxStringLength);
+				Column.nCType = SQL_C_WCHAR;
+				Column.nElementSize = (nLength + 1) * sizeof(wchar_t);
+			}
+			break;
+		}
+		Column.Buffer.resize(Column.nElementSize * nRowArraySize);
+		Column.Indicators.resize(nRowArraySize);
+	}
+
+	//Column-wise binding, each column's values are contiguous
+	SQLSetStmtAttr(m_StmtHandle, SQL_ATTR_ROW_BIND_TYPE, (SQLPOINTER)SQL_BIND_BY_COLUMN, 0);
+	if(SQLSetStmtAttr(m_StmtHandle, SQL_ATTR_ROW_ARRAY_SIZE, (SQLPOINTER)(SQLULEN)nRowArraySize, 0) == SQL_ERROR)
+	{
+		ThrowErrorException();
+	}
+	SQLSetStmtAttr(m_StmtHandle, SQL_ATTR_ROWS_FETCHED_PTR, &m_nBlockRowCount, 0);
+
+	for(SQLSMALLINT i = 1; i <= nCount; i++)
+	{
+		BLOCKCOLUMN& Column(m_BlockColumns[i - 1]);
+		if(SQLBindCol(m_StmtHandle, i, Column.nCType, &Column.Buffer[0], Column.nElementSize, &Column.Indicators[0]) == SQL_ERROR)
+		{
+			ThrowErrorException();
+		}
+	}
+}
+
+unsigned int CStatement::FetchBlock()
+{
+	assert(!m_BlockColumns.empty());
+	m_nBlockRowCount = 0;
+	//SQL_SUCCESS_WITH_INFO is returned when strings were truncated
+	SQLRETURN nRet = SQLFetch(m_StmtHandle);
+	if(nRet == SQL_NO_DATA)
+	{
+		return 0;
+	}
+	if(nRet == SQL_ERROR)
+	{
+		ThrowErrorException();
+	}
+	return static_cast<unsigned int>(m_nBlockRowCount);
+}
+
+const CStatement::BLOCKCOLUMN& CStatement::GetBlockColumn(unsigned int nColIndex, unsigned int nRow)
+{
+	assert((nColIndex != 0) && (nColIndex <= m_BlockColumns.size()));
+	assert(nRow < m_nBlockRowCount);
+	return m_BlockColumns[nColIndex - 1];
+}
+
+bool CStatement::IsBlockNull(unsigned int nColIndex, unsigned int nRow)
+{
+	return GetBlockColumn(nColIndex, nRow).Indicators[nRow] == SQL_NULL_DATA;
+}
+
+int64 CStatement::GetBlockInt64(unsigned int nColIndex, unsigned int nRow)
+{
+	const BLOCKCOLUMN& Column(GetBlockColumn(nColIndex, nRow));
+	if(Column.Indicators[nRow] == SQL_NULL_DATA)
+	{
+		return 0;
+	}
+	const uint8* pValue = &Column.Buffer[nRow * Column.nElementSize];
+	switch(Column.nCType)
+	{
+	case SQL_C_SBIGINT:
+		return *reinterpret_cast<const int64*>(pValue);
+	case SQL_C_DOUBLE:
+		return static_cast<int64>(*reinterpret_cast<const double*>(pValue));
+	default:
+		return _wcstoi64(reinterpret_cast<const wchar_t*>(pValue), NULL, 10);
+	}
+}
+
+double CStatement::GetBlockDouble(unsigned int nColIndex, unsigned int nRow)
+{
+	const BLOCKCOLUMN& Column(GetBlockColumn(nColIndex, nRow));
+	if(Column.Indicators[nRow] == SQL_NULL_DATA)
+	{
+		return 0;
+	}
+	const uint8* pValue = &Column.Buffer[nRow * Column.nElementSize];
+	switch(Column.nCType)
+	{
+	case SQL_C_SBIGINT:
+		return static_cast<double>(*reinterpret_cast<const int64*>(pValue));
+	case SQL_C_DOUBLE:
+		return *reinterpret_cast<const double*>(pValue);
+	default:
+		return wcstod(reinterpret_cast<const wchar_t*>(pValue), NULL);
+	}
+}
+
+const wchar_t* CStatement::GetBlockWStr(unsigned int nColIndex, unsigned int nRow)
+{
+	const BLOCKCOLUMN& Column(GetBlockColumn(nColIndex, nRow));
+	if((Column.Indicators[nRow] == SQL_NULL_DATA) || (Column.nCType != SQL_C_WCHAR))
+	{
+		return L"";
+	}
+	return reinterpret_cast<const wchar_t*>(&Column.Buffer[nRow * Column.nElementSize]);
+}
+
+void CStatement::EndBlockFetch()
+{
+	if(m_BlockColumns.empty()) return;
+	SQLFreeStmt(m_StmtHandle, SQL_UNBIND);
+	SQLSetStmtAttr(m_StmtHandle, SQL_ATTR_ROW_ARRAY_SIZE, (SQLPOINTER)1, 0);
+	SQLSetStmtAttr(m_StmtHandle, SQL_ATTR_ROWS_FETCHED_PTR, NULL, 0);
+	m_BlockColumns.clear();
+	m_nBlockRowCount = 0;
+}
+
 void CStatement::ThrowErrorException()
 {
 	SQLSMALLINT nBufferSize;
@@ -45,9 +45,23 @@ void CSource::QueueBuffer(ALuint bufferName)
 	alSourceQueueBuffers(m_name, 1, &bufferName);
 }
 
+ALuint CSource::UnqueueBuffer()
+{
+	ALuint bufferName = 0;
+	alSourceUnqueueBuffers(m_name, 1, &bufferName);
+	return bufferName;
+}
+
 int CSource::GetBuffersProcessed() const
 {
 	ALint bufferCount;
 	alGetSourcei(m_name, AL_BUFFERS_PROCESSED, &bufferCount);
 	return bufferCount;
 }
+
+int CSource::GetBuffersQueued() const
+{
+	ALint bufferCount;
+	alGetSourcei(m_name, AL_BUFFERS_QUEUED, &bufferCount);
+	return bufferCount;
+}
@@ -0,0 +1,129 @@
+#include "openal/StreamingSource.h"
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+
+using namespace OpenAl;
+
+CStreamingSource::CStreamingSource(ALenum format, ALsizei sampleRate, unsigned int bufferCount, unsigned int framesPerBuffer, unsigned int queueFrameCount)
+: m_format(format)
+, m_sampleRate(sampleRate)
+, m_framesPerBuffer(framesPerBuffer)
+, m_frames(queueFrameCount)
+{
+	switch(format)
+	{
+	case AL_FORMAT_MONO16:
+		m_channelCount = 1;
+		break;
+	case AL_FORMAT_STEREO16:
+		m_channelCount = 2;
+		break;
+	default:
+		throw std::runtime_error("Unsupported streaming format.");
+		break;
+	}
+	assert(bufferCount != 0);
+	assert(framesPerBuffer != 0);
+
+	m_buffers.reserve(bufferCount);
+	m_freeBuffers.reserve(bufferCount);
+	for(unsigned int i = 0; i < bufferCount; i++)
+	{
+		auto buffer = std::make_unique<CBuffer>();
+		m_freeBuffers.push_back(*buffer);
+		m_buffers.push_back(std::move(buffer));
+	}
+	m_bufferData.resize(framesPerBuffer * m_channelCount);
+}
+
+CStreamingSource::~CStreamingSource()
+{
+	//Buffers can't be deleted while they're queued
+	m_source.Stop();
+	alSourcei(m_source, AL_BUFFER, 0);
+}
+
+CSource& CStreamingSource::GetSource()
+{
+	return m_source;
+}
+
+unsigned int CStreamingSource::Write(const int16_t* samples, unsigned int frameCount)
+{
+	size_t frameSize = m_channelCount * sizeof(int16_t);
+	for(unsigned int i = 0; i < frameCount; i++)
+	{
+		uint32_t frame = 0;
+		memcpy(&frame, samples + (i * m_channelCount), frameSize);
+		if(!m_frames.TryPush(frame))
+		{
+			m_droppedFrameCount += frameCount - i;
+			return i;
+		}
+	}
+	return frameCount;
+}
+
+void CStreamingSource::Update()
+{
+	int processedCount = m_source.GetBuffersProcessed();
+	for(int i = 0; i < processedCount; i++)
+	{
+		m_freeBuffers.push_back(m_source.UnqueueBuffer());
+	}
+
+	while(!m_freeBuffers.empty())
+	{
+		//Queues partially filled buffers instead of waiting for more frames, keeps latency low
+		unsigned int frameCount = ReadFrames();
+		if(frameCount == 0) break;
+		ALuint bufferName = m_freeBuffers.back();
+		m_freeBuffers.pop_back();
+		alBufferData(bufferName, m_format, m_bufferData.data(), frameCount * m_channelCount * sizeof(int16_t), m_sampleRate);
+		m_source.QueueBuffer(bufferName);
+	}
+
+	if(m_source.GetState() != AL_PLAYING)
+	{
+		if(m_playing)
+		{
+			//Source ran out of queued buffers and stopped by itself
+			m_underrunCount++;
+			m_playing = false;
+		}
+		if(m_freeBuffers.empty())
+		{
+			m_source.Play();
+			m_playing = true;
+		}
+	}
+}
+
+float CStreamingSource::GetLatency() const
+{
+	return static_cast<float>(m_buffers.size() * m_framesPerBuffer) / static_cast<float>(m_sampleRate);
+}
+
+unsigned int CStreamingSource::GetUnderrunCount() const
+{
+	return m_underrunCount;
+}
+
+unsigned int CStreamingSource::GetDroppedFrameCount() const
+{
+	return m_droppedFrameCount;
+}
+
+unsigned int CStreamingSource::ReadFrames()
+{
+	size_t frameSize = m_channelCount * sizeof(int16_t);
+	unsigned int frameCount = 0;
+	uint32_t frame = 0;
+	while((frameCount < m_framesPerBuffer) && m_frames.TryPop(frame))
+	{
+		memcpy(m_bufferData.data() + (frameCount * m_channelCount), &frame, frameSize);
+		frameCount++;
+	}
+	return frameCount;
+}
@@ -1,6 +1,8 @@
 #include <cassert>
+#include <string_view>
 #include "alloca_def.h"
 #include "opengl/Program.h"
+#include "StartupProfiler.h"
 
 using namespace Framework::OpenGl;
 
@@ -31,6 +33,7 @@ void CProgram::DetachShader(GLuint nShader)
 
 bool CProgram::Link()
 {
+	FRAMEWORK_STARTUP_PHASE("OpenGl::Program::Link");
 	GLint nStatus = GL_FALSE;
 
 	glLinkProgram(m_nHandle);
@@ -45,6 +48,10 @@ bool CProgram::Link()
 		error[length] = 0;
 		assert(0);
 	}
+	else
+	{
+		CacheUniformLocations();
+	}
 
 	return (nStatus == GL_TRUE);
 }
@@ -69,20 +76,118 @@ bool CProgram::Validate()
 	return (status == GL_TRUE);
 }
 
+bool CProgram::LoadBinary(GLenum format, const void* binary, GLsizei length)
+{
+	GLint status = GL_FALSE;
+
+	glProgramBinary(m_nHandle, format, binary, length);
+	glGetProgramiv(m_nHandle, GL_LINK_STATUS, &status);
+
+	//Failure is expected when the driver was updated, caller falls back to compiling
+	if(status == GL_TRUE)
+	{
+		CacheUniformLocations();
+	}
+
+	return (status == GL_TRUE);
+}
+
+std::vector<uint8> CProgram::GetBinary(GLenum& format) const
+{
+	GLint length = 0;
+	glGetProgramiv(m_nHandle, GL_PROGRAM_BINARY_LENGTH, &length);
+
+	std::vector<uint8> binary(length);
+	if(length != 0)
+	{
+		GLsizei writtenLength = 0;
+		glGetProgramBinary(m_nHandle, length, &writtenLength, &format, binary.data());
+		binary.resize(writtenLength);
+	}
+
+	return binary;
+}
+
+GLint CProgram::GetUniformLocation(const char* name)
+{
+	auto locationIterator = m_uniformLocations.find(std::string_view(name));
+	if(locationIterator != std::end(m_uniformLocations))
+	{
+		return locationIterator->second;
+	}
+	//Unknown names (such as array elements) are cached as well, even if they don't exist
+	GLint location = glGetUniformLocation(m_nHandle, name);
+	m_uniformLocations.emplace(name, location);
+	return location;
+}
+
+void CProgram::SetUniformBlockBinding(const char* name, GLuint binding)
+{
+	GLuint blockIndex = glGetUniformBlockIndex(m_nHandle, name);
+	assert(blockIndex != GL_INVALID_INDEX);
+	glUniformBlockBinding(m_nHandle, blockIndex, binding);
+}
+
 void CProgram::SetUniformf(const char* sName, float nV1, float nV2)
 {
-	GLuint nUniform = glGetUniformLocation(m_nHandle, sName);
-	glUniform2f(nUniform, nV1, nV2);
+	SetUniformf(GetUniformLocation(sName), nV1, nV2);
 }
 
 void CProgram::SetUniformi(const char* sName, int nV1)
 {
-	GLuint nUniform = glGetUniformLocation(m_nHandle, sName);
-	glUniform1i(nUniform, nV1);
+	SetUniformi(GetUniformLocation(sName), nV1);
 }
 
 void CProgram::SetUniformi(const char* sName, int nV1, int nV2)
 {
-	GLuint nUniform = glGetUniformLocation(m_nHandle, sName);
-	glUniform2i(nUniform, nV1, nV2);
+	SetUniformi(GetUniformLocation(sName), nV1, nV2);
+}
+
+void CProgram::SetUniformf(GLint location, float v1, float v2)
+{
+	glUniform2f(location, v1, v2);
+}
+
+void CProgram::SetUniformi(GLint location, int v1)
+{
+	glUniform1i(location, v1);
+}
+
+void CProgram::SetUniformi(GLint location, int v1, int v2)
+{
+	glUniform2i(location, v1, v2);
+}
+
+void CProgram::CacheUniformLocations()
+{
+	m_uniformLocations.clear();
+
+	GLint uniformCount = 0;
+	GLint maxNameLength = 0;
+	glGetProgramiv(m_nHandle, GL_ACTIVE_UNIFORMS, &uniformCount);
+	glGetProgramiv(m_nHandle, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+	std::string name;
+	for(GLint i = 0; i < uniformCount; i++)
+	{
+		name.resize(maxNameLength + 1);
+		GLsizei nameLength = 0;
+		GLint size = 0;
+		GLenum type = GL_NONE;
+		glGetActiveUniform(m_nHandle, i, static_cast<GLsizei>(name.size()), &nameLength, &size, &type, name.data());
+		name.resize(nameLength);
+
+		//Uniforms in blocks have no location
+		GLint location = glGetUniformLocation(m_nHandle, name.c_str());
+		if(location == -1) continue;
+		m_uniformLocations.emplace(name, location);
+
+		//Arrays are reported as "name[0]", they can also be referred to as "name"
+		static const char arraySuffix[] = "[0]";
+		static const size_t arraySuffixLength = sizeof(arraySuffix) - 1;
+		if((name.size() > arraySuffixLength) && (name.compare(name.size() - arraySuffixLength, arraySuffixLength, arraySuffix) == 0))
+		{
+			m_uniformLocations.emplace(name.substr(0, name.size() - arraySuffixLength), location);
+		}
+	}
 }
@@ -0,0 +1,257 @@
+#include <cassert>
+#include <cstdio>
+#include "opengl/ProgramBinaryCache.h"
+#include "opengl/Shader.h"
+#include "HashUtils.h"
+#include "StdStreamUtils.h"
+
+using namespace Framework::OpenGl;
+
+CProgramBinaryCache::CProgramBinaryCache(fs::path directory)
+: m_directory(std::move(directory))
+{
+	for(auto name : { GL_VENDOR, GL_RENDERER, GL_VERSION })
+	{
+		auto value = reinterpret_cast<const char*>(glGetString(name));
+		m_driverString += value ? value : "";
+		m_driverString += '\n';
+	}
+
+	GLint binaryFormatCount = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &binaryFormatCount);
+	m_binariesSupported = (binaryFormatCount != 0);
+
+	if(m_binariesSupported)
+	{
+		std::error_code errorCode;
+		fs::create_directories(m_directory, errorCode);
+	}
+}
+
+CProgramBinaryCache::~CProgramBinaryCache()
+{
+	if(m_backgroundThread.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_queueMutex);
+			m_stopBackgroundThread = true;
+		}
+		m_queueCondition.notify_one();
+		m_backgroundThread.join();
+	}
+}
+
+ProgramPtr CProgramBinaryCache::GetProgram(const ShaderSourceArray& shaderSources)
+{
+	if(!m_binariesSupported)
+	{
+		return CompileProgram(shaderSources);
+	}
+
+	auto key = MakeKey(shaderSources);
+
+	PROGRAM_BINARY binary;
+	bool hasBinary = false;
+	{
+		std::lock_guard<std::mutex> lock(m_binariesMutex);
+		auto binaryIterator = m_binaries.find(key);
+		if(binaryIterator != std::end(m_binaries))
+		{
+			binary = binaryIterator->second;
+			hasBinary = true;
+		}
+	}
+	if(!hasBinary)
+	{
+		hasBinary = LoadBinaryFile(key, binary);
+	}
+
+	if(hasBinary)
+	{
+		auto program = std::make_shared<CProgram>();
+		if(program->LoadBinary(binary.format, binary.data.data(), static_cast<GLsizei>(binary.data.size())))
+		{
+			return program;
+		}
+	}
+
+	auto program = CompileProgram(shaderSources);
+	if(program)
+	{
+		PROGRAM_BINARY newBinary;
+		newBinary.data = program->GetBinary(newBinary.format);
+		if(!newBinary.data.empty())
+		{
+			SaveBinaryFile(key, newBinary);
+			CacheBinary(key, std::move(newBinary));
+		}
+	}
+	return program;
+}
+
+void CProgramBinaryCache::StartBackgroundCompiler(ContextFunction makeCurrent, ContextFunction releaseContext)
+{
+	assert(!m_backgroundThread.joinable());
+	if(!m_binariesSupported)
+	{
+		//Nothing could be handed over to the main context
+		return;
+	}
+	m_backgroundThread = std::thread(&CProgramBinaryCache::BackgroundCompilerProc, this, std::move(makeCurrent), std::move(releaseContext));
+}
+
+void CProgramBinaryCache::PrecompileAsync(ShaderSourceArray shaderSources)
+{
+	if(!m_backgroundThread.joinable())
+	{
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(m_queueMutex);
+		m_queue.push_back(std::move(shaderSources));
+	}
+	m_queueCondition.notify_one();
+}
+
+bool CProgramBinaryCache::IsReady(const ShaderSourceArray& shaderSources)
+{
+	auto key = MakeKey(shaderSources);
+	std::lock_guard<std::mutex> lock(m_binariesMutex);
+	return m_binaries.find(key) != std::end(m_binaries);
+}
+
+std::string CProgramBinaryCache::MakeKey(const ShaderSourceArray& shaderSources) const
+{
+	std::string keySource = m_driverString;
+	for(const auto& shaderSource : shaderSources)
+	{
+		keySource += std::to_string(shaderSource.first);
+		keySource += '\n';
+		keySource += shaderSource.second;
+		//Keeps "a" + "bc" and "ab" + "c" apart
+		keySource += '\0';
+	}
+	auto hash = Framework::HashUtils::ComputeXxh3_128(keySource.data(), keySource.size());
+	char key[33];
+	snprintf(key, sizeof(key), "%016llx%016llx", static_cast<unsigned long long>(hash.high), static_cast<unsigned long long>(hash.low));
+	return key;
+}
+
+fs::path CProgramBinaryCache::GetBinaryPath(const std::string& key) const
+{
+	return m_directory / (key + ".bin");
+}
+
+bool CProgramBinaryCache::LoadBinaryFile(const std::string& key, PROGRAM_BINARY& binary) const
+{
+	try
+	{
+		auto stream = Framework::CreateInputStdStream(GetBinaryPath(key).native());
+		FILE_HEADER header = {};
+		if(stream.Read(&header, sizeof(FILE_HEADER)) != sizeof(FILE_HEADER)) return false;
+		if(header.magic != FILE_HEADER_MAGIC) return false;
+		binary.format = header.format;
+		binary.data.resize(header.dataSize);
+		return stream.Read(binary.data.data(), binary.data.size()) == binary.data.size();
+	}
+	catch(...)
+	{
+		return false;
+	}
+}
+
+void CProgramBinaryCache::SaveBinaryFile(const std::string& key, const PROGRAM_BINARY& binary) const
+{
+	//Failing to save only means the program will be compiled again next time
+	try
+	{
+		auto path = GetBinaryPath(key);
+		auto tempPath = path;
+		tempPath += ".tmp";
+		{
+			auto stream = Framework::CreateOutputStdStream(tempPath.native());
+			FILE_HEADER header = {};
+			header.magic = FILE_HEADER_MAGIC;
+			header.format = binary.format;
+			header.dataSize = binary.data.size();
+			stream.Write(&header, sizeof(FILE_HEADER));
+			stream.Write(binary.data.data(), binary.data.size());
+		}
+		fs::rename(tempPath, path);
+	}
+	catch(...)
+	{
+	}
+}
+
+ProgramPtr CProgramBinaryCache::CompileProgram(const ShaderSourceArray& shaderSources) const
+{
+	std::vector<CShader> shaders;
+	shaders.reserve(shaderSources.size());
+	for(const auto& shaderSource : shaderSources)
+	{
+		CShader shader(shaderSource.first);
+		shader.SetSource(shaderSource.second.c_str());
+		if(!shader.Compile())
+		{
+			return ProgramPtr();
+		}
+		shaders.push_back(std::move(shader));
+	}
+
+	auto program = std::make_shared<CProgram>();
+	for(const auto& shader : shaders)
+	{
+		program->AttachShader(shader);
+	}
+	if(m_binariesSupported)
+	{
+		glProgramParameteri(*program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
+	bool linked = program->Link();
+	for(const auto& shader : shaders)
+	{
+		program->DetachShader(shader);
+	}
+
+	return linked ? program : ProgramPtr();
+}
+
+void CProgramBinaryCache::CacheBinary(const std::string& key, PROGRAM_BINARY binary)
+{
+	std::lock_guard<std::mutex> lock(m_binariesMutex);
+	m_binaries[key] = std::move(binary);
+}
+
+void CProgramBinaryCache::BackgroundCompilerProc(ContextFunction makeCurrent, ContextFunction releaseContext)
+{
+	makeCurrent();
+	while(true)
+	{
+		ShaderSourceArray shaderSources;
+		{
+			std::unique_lock<std::mutex> lock(m_queueMutex);
+			m_queueCondition.wait(lock, [this]() { return m_stopBackgroundThread || !m_queue.empty(); });
+			if(m_stopBackgroundThread) break;
+			shaderSources = std::move(m_queue.front());
+			m_queue.pop_front();
+		}
+
+		auto key = MakeKey(shaderSources);
+		PROGRAM_BINARY binary;
+		if(LoadBinaryFile(key, binary))
+		{
+			//Validated on the main thread when the program is created
+			CacheBinary(key, std::move(binary));
+			continue;
+		}
+
+		auto program = CompileProgram(shaderSources);
+		if(!program) continue;
+		binary.data = program->GetBinary(binary.format);
+		if(binary.data.empty()) continue;
+		SaveBinaryFile(key, binary);
+		CacheBinary(key, std::move(binary));
+	}
+	releaseContext();
+}
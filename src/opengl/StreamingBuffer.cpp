@@ -0,0 +1,186 @@
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+#include "opengl/StreamingBuffer.h"
+
+using namespace Framework::OpenGl;
+
+namespace
+{
+	bool HasBufferStorage()
+	{
+#if !defined(GL_MAP_PERSISTENT_BIT)
+		return false;
+#elif defined(USE_GLEW) || defined(_WIN32)
+		return GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage;
+#else
+		GLint majorVersion = 0;
+		GLint minorVersion = 0;
+		glGetIntegerv(GL_MAJOR_VERSION, &majorVersion);
+		glGetIntegerv(GL_MINOR_VERSION, &minorVersion);
+		return (majorVersion > 4) || ((majorVersion == 4) && (minorVersion >= 4));
+#endif
+	}
+}
+
+CStreamingBuffer::CStreamingBuffer(GLenum target, GLsizeiptr frameSize, GLintptr alignment)
+: m_buffer(CBuffer::Create())
+, m_target(target)
+, m_frameSize(frameSize)
+, m_alignment(alignment)
+{
+	if(m_target == GL_UNIFORM_BUFFER)
+	{
+		GLint uniformAlignment = 0;
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformAlignment);
+		if(uniformAlignment > m_alignment)
+		{
+			m_alignment = uniformAlignment;
+		}
+	}
+
+	GLsizeiptr bufferSize = m_frameSize * FRAME_COUNT;
+	glBindBuffer(m_target, m_buffer);
+
+#if defined(GL_MAP_PERSISTENT_BIT)
+	if(HasBufferStorage())
+	{
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(m_target, bufferSize, nullptr, flags);
+		m_persistentData = reinterpret_cast<uint8*>(glMapBufferRange(m_target, 0, bufferSize, flags));
+		assert(m_persistentData);
+		m_persistent = true;
+	}
+#endif
+
+	if(!m_persistent)
+	{
+		glBufferData(m_target, bufferSize, nullptr, GL_STREAM_DRAW);
+	}
+	CHECKGLERROR();
+}
+
+CStreamingBuffer::~CStreamingBuffer()
+{
+	//Deleting the buffer also unmaps it
+	for(auto fence : m_fences)
+	{
+		if(fence)
+		{
+			glDeleteSync(fence);
+		}
+	}
+}
+
+CStreamingBuffer::operator GLuint() const
+{
+	return m_buffer;
+}
+
+bool CStreamingBuffer::IsPersistent() const
+{
+	return m_persistent;
+}
+
+void* CStreamingBuffer::Map(GLsizeiptr size, GLintptr& offset)
+{
+	assert(!m_mapped);
+	GLintptr alignedHead = ((m_head + m_alignment - 1) / m_alignment) * m_alignment;
+
+	if(m_persistent)
+	{
+		if((alignedHead + size) > m_frameSize)
+		{
+			throw std::runtime_error("Streaming buffer is too small for a frame.");
+		}
+		offset = (m_frameIndex * m_frameSize) + alignedHead;
+		m_head = alignedHead + size;
+		m_mapped = true;
+		return m_persistentData + offset;
+	}
+
+	GLsizeiptr bufferSize = m_frameSize * FRAME_COUNT;
+	if(size > bufferSize)
+	{
+		throw std::runtime_error("Data doesn't fit in streaming buffer.");
+	}
+
+	glBindBuffer(m_target, m_buffer);
+	if((alignedHead + size) > bufferSize)
+	{
+		//Orphan the storage, commands still using it keep the old one
+		glBufferData(m_target, bufferSize, nullptr, GL_STREAM_DRAW);
+		alignedHead = 0;
+	}
+
+	//Region was never written since the buffer was last orphaned, no need for the driver to synchronize
+	void* bufferPtr = glMapBufferRange(m_target, alignedHead, size,
+		GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+	assert(bufferPtr);
+	CHECKGLERROR();
+
+	offset = alignedHead;
+	m_head = alignedHead + size;
+	m_mapped = true;
+	return bufferPtr;
+}
+
+void CStreamingBuffer::Unmap()
+{
+	assert(m_mapped);
+	m_mapped = false;
+	if(m_persistent)
+	{
+		//Mapping is coherent, writes are seen by commands issued after this
+		return;
+	}
+	glBindBuffer(m_target, m_buffer);
+	glUnmapBuffer(m_target);
+	CHECKGLERROR();
+}
+
+GLintptr CStreamingBuffer::Push(const void* data, GLsizeiptr size)
+{
+	GLintptr offset = 0;
+	void* bufferPtr = Map(size, offset);
+	memcpy(bufferPtr, data, size);
+	Unmap();
+	return offset;
+}
+
+void CStreamingBuffer::EndFrame()
+{
+	assert(!m_mapped);
+	if(!m_persistent)
+	{
+		//Orphaning already keeps the driver from waiting
+		return;
+	}
+
+	assert(m_fences[m_frameIndex] == nullptr);
+	m_fences[m_frameIndex] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+	m_frameIndex = (m_frameIndex + 1) % FRAME_COUNT;
+	m_head = 0;
+
+	if(m_fences[m_frameIndex])
+	{
+		WaitFence(m_fences[m_frameIndex]);
+		glDeleteSync(m_fences[m_frameIndex]);
+		m_fences[m_frameIndex] = nullptr;
+	}
+}
+
+void CStreamingBuffer::WaitFence(GLsync fence)
+{
+	while(true)
+	{
+		auto result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+		if((result == GL_ALREADY_SIGNALED) || (result == GL_CONDITION_SATISFIED)) break;
+		if(result == GL_WAIT_FAILED)
+		{
+			assert(false);
+			break;
+		}
+	}
+}
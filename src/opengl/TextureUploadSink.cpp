@@ -0,0 +1,97 @@
+#include <stdexcept>
+#include "opengl/TextureUploadSink.h"
+
+using namespace Framework::OpenGl;
+
+CTextureUploadSink::CTextureUploadSink()
+: m_buffer(CBuffer::Create())
+{
+
+}
+
+CTextureUploadSink::~CTextureUploadSink()
+{
+	if(m_mapped)
+	{
+		//Decoder failed, image is dropped
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_buffer);
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	}
+}
+
+void CTextureUploadSink::SetTexture(GLuint texture)
+{
+	m_texture = texture;
+}
+
+Framework::CBitmapView CTextureUploadSink::BeginImage(unsigned int width, unsigned int height, unsigned int bpp)
+{
+	assert(!m_mapped);
+	if((bpp != 8) && (bpp != 24) && (bpp != 32))
+	{
+		throw std::runtime_error("Unsupported bitmap format for texture upload.");
+	}
+
+	m_width = width;
+	m_height = height;
+	m_bpp = bpp;
+
+	unsigned int pitch = width * (bpp / 8);
+	GLsizeiptr size = static_cast<GLsizeiptr>(pitch) * height;
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_buffer);
+	if(size > m_bufferSize)
+	{
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+		m_bufferSize = size;
+	}
+	//Invalidating lets the driver hand out new storage if the previous upload is still in flight
+	auto bufferPtr = reinterpret_cast<uint8*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size,
+		GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	CHECKGLERROR();
+	if(!bufferPtr)
+	{
+		throw std::runtime_error("Couldn't map pixel unpack buffer.");
+	}
+	m_mapped = true;
+
+	return CBitmapView(bufferPtr, width, height, bpp, pitch);
+}
+
+void CTextureUploadSink::EndImage()
+{
+	assert(m_mapped);
+	assert(m_texture != 0);
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_buffer);
+	glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+	m_mapped = false;
+
+	GLint internalFormat = GL_RGBA8;
+	GLenum format = GL_RGBA;
+	switch(m_bpp)
+	{
+	case 8:
+		internalFormat = GL_R8;
+		format = GL_RED;
+		break;
+	case 24:
+		internalFormat = GL_RGB8;
+		format = GL_RGB;
+		break;
+	}
+
+	//Rows are tightly packed
+	GLint unpackAlignment = 4;
+	glGetIntegerv(GL_UNPACK_ALIGNMENT, &unpackAlignment);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	glBindTexture(GL_TEXTURE_2D, m_texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, m_width, m_height, 0, format, GL_UNSIGNED_BYTE, nullptr);
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, unpackAlignment);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	CHECKGLERROR();
+}
@@ -0,0 +1,155 @@
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+#include "opengl/UniformBufferRing.h"
+
+using namespace Framework::OpenGl;
+
+CUniformBufferRing::CUniformBufferRing(GLsizeiptr size)
+: m_buffer(CBuffer::Create())
+, m_size(size)
+{
+	GLint alignment = 0;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	if(alignment > 0)
+	{
+		m_alignment = alignment;
+	}
+
+	glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+	glBufferData(GL_UNIFORM_BUFFER, m_size, nullptr, GL_STREAM_DRAW);
+	CHECKGLERROR();
+}
+
+CUniformBufferRing::~CUniformBufferRing()
+{
+	for(const auto& fence : m_fences)
+	{
+		glDeleteSync(fence.sync);
+	}
+}
+
+CUniformBufferRing::operator GLuint() const
+{
+	return m_buffer;
+}
+
+GLintptr CUniformBufferRing::Push(const void* data, GLsizeiptr size)
+{
+	if(size > m_size)
+	{
+		throw std::runtime_error("Uniform data doesn't fit in ring.");
+	}
+
+	GLsizeiptr usedBefore = m_used;
+	GLintptr offset = 0;
+	while(!TryAllocate(size, offset))
+	{
+		if(m_fences.empty())
+		{
+			//Everything in the ring was pushed during the current frame
+			throw std::runtime_error("Uniform buffer ring is too small for a frame.");
+		}
+		WaitOldestFence();
+		usedBefore = m_used;
+	}
+	m_frameUsed += m_used - usedBefore;
+
+	glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+	//Region isn't used by any pending command, no need for the driver to synchronize
+	void* bufferPtr = glMapBufferRange(GL_UNIFORM_BUFFER, offset, size,
+		GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+	assert(bufferPtr);
+	memcpy(bufferPtr, data, size);
+	glUnmapBuffer(GL_UNIFORM_BUFFER);
+	CHECKGLERROR();
+
+	return offset;
+}
+
+void CUniformBufferRing::BindRange(GLuint binding, GLintptr offset, GLsizeiptr size)
+{
+	glBindBufferRange(GL_UNIFORM_BUFFER, binding, m_buffer, offset, size);
+}
+
+void CUniformBufferRing::EndFrame()
+{
+	if(m_frameUsed == 0)
+	{
+		return;
+	}
+
+	FENCE fence;
+	fence.sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	fence.ringEnd = m_head;
+	fence.ringUsed = m_frameUsed;
+	m_fences.push_back(fence);
+	m_frameUsed = 0;
+}
+
+bool CUniformBufferRing::TryAllocate(GLsizeiptr size, GLintptr& offset)
+{
+	if(m_used == 0)
+	{
+		m_head = 0;
+		m_tail = 0;
+	}
+	else if(m_used == m_size)
+	{
+		return false;
+	}
+
+	GLintptr alignedHead = ((m_head + m_alignment - 1) / m_alignment) * m_alignment;
+	if((m_used == 0) || (m_head > m_tail))
+	{
+		//Free space is after the head, then before the tail once wrapped around
+		if((alignedHead + size) <= m_size)
+		{
+			offset = alignedHead;
+			m_used += (alignedHead + size) - m_head;
+			m_head = alignedHead + size;
+			return true;
+		}
+		if(size <= m_tail)
+		{
+			offset = 0;
+			m_used += (m_size - m_head) + size;
+			m_head = size;
+			return true;
+		}
+		return false;
+	}
+	else
+	{
+		//Head wrapped around, free space is between the head and the tail
+		if((alignedHead + size) <= m_tail)
+		{
+			offset = alignedHead;
+			m_used += (alignedHead + size) - m_head;
+			m_head = alignedHead + size;
+			return true;
+		}
+		return false;
+	}
+}
+
+void CUniformBufferRing::WaitOldestFence()
+{
+	auto& fence = m_fences.front();
+	while(true)
+	{
+		auto result = glClientWaitSync(fence.sync, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+		if((result == GL_ALREADY_SIGNALED) || (result == GL_CONDITION_SATISFIED)) break;
+		if(result == GL_WAIT_FAILED)
+		{
+			assert(false);
+			break;
+		}
+	}
+	glDeleteSync(fence.sync);
+
+	assert(fence.ringUsed <= m_used);
+	m_used -= fence.ringUsed;
+	m_tail = fence.ringEnd;
+	m_fences.pop_front();
+}
@@ -1,4 +1,8 @@
 #include <sqlite3.h>
+#include <algorithm>
+#include <cstring>
+#include <sys/mman.h>
+#include <unistd.h>
 #include "sqlite/SqliteAndroidAssetsVfs.h"
 #include "android/AssetStream.h"
 
@@ -6,19 +10,73 @@ struct AndroidAssetsVfsFile
 {
 	sqlite3_file base;
 	Framework::Android::CAssetStream stream;
+	//Mapping of the asset's file, only available for uncompressed assets
+	void* mapBase;
+	size_t mapSize;
+	//Asset's data inside the mapping
+	const uint8* mappedData;
+	int64 mappedLength;
 };
 
+static void android_assets_vfs_mapFile(AndroidAssetsVfsFile* vfsFile)
+{
+	int64 start = 0;
+	int64 length = 0;
+	int fd = vfsFile->stream.OpenFileDescriptor(start, length);
+	if(fd < 0)
+	{
+		return;
+	}
+	//Offset of the mapping needs to be page aligned
+	int64 pageSize = sysconf(_SC_PAGESIZE);
+	int64 alignedStart = start - (start % pageSize);
+	size_t mapSize = static_cast<size_t>(length + (start - alignedStart));
+	void* mapBase = (length != 0) ? mmap(nullptr, mapSize, PROT_READ, MAP_PRIVATE, fd, alignedStart) : MAP_FAILED;
+	//The mapping stays valid after the descriptor is closed
+	close(fd);
+	if(mapBase == MAP_FAILED)
+	{
+		return;
+	}
+	vfsFile->mapBase = mapBase;
+	vfsFile->mapSize = mapSize;
+	vfsFile->mappedData = reinterpret_cast<const uint8*>(mapBase) + (start - alignedStart);
+	vfsFile->mappedLength = length;
+}
+
+static int android_assets_vfs_io_close(sqlite3_file* file)
+{
+	auto vfsFile = reinterpret_cast<AndroidAssetsVfsFile*>(file);
+	if(vfsFile->mapBase)
+	{
+		munmap(vfsFile->mapBase, vfsFile->mapSize);
+	}
+	vfsFile->stream.~CAssetStream();
+	return SQLITE_OK;
+}
+
 static int android_assets_vfs_io_read(sqlite3_file* file, void* outputBuffer, int amount, sqlite_int64 offset) 
 {
 	auto vfsFile = reinterpret_cast<AndroidAssetsVfsFile*>(file);
-	vfsFile->stream.Seek(offset, Framework::STREAM_SEEK_SET);
-	auto readAmount = vfsFile->stream.Read(outputBuffer, amount);
+	int64 readAmount = 0;
+	if(vfsFile->mappedData)
+	{
+		readAmount = std::max<int64>(std::min<int64>(amount, vfsFile->mappedLength - offset), 0);
+		memcpy(outputBuffer, vfsFile->mappedData + offset, readAmount);
+	}
+	else
+	{
+		vfsFile->stream.Seek(offset, Framework::STREAM_SEEK_SET);
+		readAmount = vfsFile->stream.Read(outputBuffer, amount);
+	}
 	if(readAmount == amount)
 	{
 		return SQLITE_OK;
 	}
 	else
 	{
+		//SQLite expects the rest of the buffer to be zeroed
+		memset(reinterpret_cast<uint8*>(outputBuffer) + readAmount, 0, amount - readAmount);
 		return SQLITE_IOERR_SHORT_READ;
 	}
 }
@@ -48,18 +106,40 @@ static int android_assets_vfs_io_reservedLock(sqlite3_file* file, int* result)
 
 static int android_assets_vfs_io_fileControl(sqlite3_file* file, int, void*)
 {
-	return SQLITE_OK;
+	//Not handling a control makes SQLite use its default behavior (returning SQLITE_OK
+	//for SQLITE_FCNTL_PRAGMA would make SQLite ignore all pragmas, including mmap_size)
+	return SQLITE_NOTFOUND;
 }
 
 static int android_assets_vfs_io_deviceCharacteristics(sqlite3_file* file)
 {
-	return 0;
+	//Assets never change, this lets SQLite skip change detection
+	return SQLITE_IOCAP_IMMUTABLE;
+}
+
+static int android_assets_vfs_io_fetch(sqlite3_file* file, sqlite3_int64 offset, int amount, void** result)
+{
+	auto vfsFile = reinterpret_cast<AndroidAssetsVfsFile*>(file);
+	(*result) = nullptr;
+	if(vfsFile->mappedData && ((offset + amount) <= vfsFile->mappedLength))
+	{
+		//SQLite never writes through pages obtained this way on read only databases
+		(*result) = const_cast<uint8*>(vfsFile->mappedData + offset);
+	}
+	//A null result makes SQLite fall back to xRead
+	return SQLITE_OK;
+}
+
+static int android_assets_vfs_io_unfetch(sqlite3_file*, sqlite3_int64, void*)
+{
+	//The mapping is kept until the file is closed
+	return SQLITE_OK;
 }
 
 static const sqlite3_io_methods g_androidAssetsVfsIoMethods =
 {
-	1,
-	nullptr,
+	3,
+	android_assets_vfs_io_close,
 	android_assets_vfs_io_read,
 	nullptr,
 	nullptr,
@@ -70,7 +150,13 @@ static const sqlite3_io_methods g_androidAssetsVfsIoMethods =
 	android_assets_vfs_io_reservedLock,
 	android_assets_vfs_io_fileControl,
 	nullptr,
-	android_assets_vfs_io_deviceCharacteristics
+	android_assets_vfs_io_deviceCharacteristics,
+	nullptr,
+	nullptr,
+	nullptr,
+	nullptr,
+	android_assets_vfs_io_fetch,
+	android_assets_vfs_io_unfetch
 };
 
 static int android_assets_vfs_open(sqlite3_vfs*, const char* path, sqlite3_file* file, int flags, int*)
@@ -80,6 +166,8 @@ static int android_assets_vfs_open(sqlite3_vfs*, const char* path, sqlite3_file*
 		return SQLITE_CANTOPEN;
 	}
 
+	//xClose is only called if pMethods is set
+	file->pMethods = nullptr;
 	auto vfsFile = reinterpret_cast<AndroidAssetsVfsFile*>(file);
 	try
 	{
@@ -89,6 +177,11 @@ static int android_assets_vfs_open(sqlite3_vfs*, const char* path, sqlite3_file*
 	{
 		return SQLITE_CANTOPEN;
 	}
+	vfsFile->mapBase = nullptr;
+	vfsFile->mapSize = 0;
+	vfsFile->mappedData = nullptr;
+	vfsFile->mappedLength = 0;
+	android_assets_vfs_mapFile(vfsFile);
 	file->pMethods = &g_androidAssetsVfsIoMethods;
 	return SQLITE_OK;
 }
@@ -0,0 +1,348 @@
+#include <sqlite3.h>
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+#include "sqlite/SqliteStreamVfs.h"
+#include "Cache.h"
+#include "SpanStream.h"
+
+using namespace Framework;
+using namespace Framework::Sqlite;
+
+typedef CCache<uint64, std::vector<uint8>> StreamVfsBlockCache;
+
+//Shared by every connection opened on a file
+struct StreamVfsFileData
+{
+	std::shared_ptr<CStream> stream;
+	uint64 offset = 0;
+	uint64 size = 0;
+	//Data of the file when the stream is a span stream
+	const uint8* span = nullptr;
+	//Held while reading streams that don't support positional reads
+	std::mutex streamMutex;
+	std::unique_ptr<StreamVfsBlockCache> cache;
+};
+
+typedef std::shared_ptr<StreamVfsFileData> StreamVfsFileDataPtr;
+
+struct StreamVfsFile
+{
+	sqlite3_file base;
+	StreamVfsFileDataPtr data;
+};
+
+static std::mutex g_streamVfsFilesMutex;
+static std::map<std::string, StreamVfsFileDataPtr> g_streamVfsFiles;
+
+//Reads as much as possible, returns the amount read
+static uint64 stream_vfs_readStream(StreamVfsFileData& data, uint64 position, uint8* buffer, uint64 amount)
+{
+	amount = std::min<uint64>(amount, data.size - position);
+	uint64 readAmount = 0;
+	if(data.stream->CanAccessAt())
+	{
+		while(readAmount != amount)
+		{
+			uint64 result = data.stream->ReadAt(data.offset + position + readAmount, buffer + readAmount, amount - readAmount);
+			if(result == 0) break;
+			readAmount += result;
+		}
+	}
+	else
+	{
+		std::lock_guard<std::mutex> lock(data.streamMutex);
+		data.stream->Seek(data.offset + position, STREAM_SEEK_SET);
+		readAmount = data.stream->Read(buffer, amount);
+	}
+	return readAmount;
+}
+
+static uint64 stream_vfs_readCached(StreamVfsFileData& data, uint64 position, uint8* buffer, uint64 amount)
+{
+	uint64 readAmount = 0;
+	while(readAmount != amount)
+	{
+		uint64 blockIndex = position / STREAM_VFS_CACHE_BLOCK_SIZE;
+		auto block = data.cache->FindOrInsert(blockIndex,
+			[&]()
+			{
+				std::vector<uint8> block(STREAM_VFS_CACHE_BLOCK_SIZE);
+				block.resize(stream_vfs_readStream(data, blockIndex * STREAM_VFS_CACHE_BLOCK_SIZE, block.data(), block.size()));
+				return block;
+			});
+		uint64 blockPosition = position % STREAM_VFS_CACHE_BLOCK_SIZE;
+		if(blockPosition >= block->size())
+		{
+			break;
+		}
+		uint64 copyAmount = std::min<uint64>(block->size() - blockPosition, amount - readAmount);
+		memcpy(buffer + readAmount, block->data() + blockPosition, copyAmount);
+		readAmount += copyAmount;
+		position += copyAmount;
+	}
+	return readAmount;
+}
+
+static int stream_vfs_io_close(sqlite3_file* file)
+{
+	auto vfsFile = reinterpret_cast<StreamVfsFile*>(file);
+	vfsFile->data.~StreamVfsFileDataPtr();
+	return SQLITE_OK;
+}
+
+static int stream_vfs_io_read(sqlite3_file* file, void* outputBuffer, int amount, sqlite_int64 offset)
+{
+	auto vfsFile = reinterpret_cast<StreamVfsFile*>(file);
+	auto& data = *vfsFile->data;
+	auto buffer = reinterpret_cast<uint8*>(outputBuffer);
+	uint64 readAmount = 0;
+	if((offset >= 0) && (static_cast<uint64>(offset) < data.size))
+	{
+		try
+		{
+			if(data.span)
+			{
+				readAmount = std::min<uint64>(amount, data.size - offset);
+				memcpy(buffer, data.span + offset, readAmount);
+			}
+			else if(data.cache)
+			{
+				readAmount = stream_vfs_readCached(data, offset, buffer, amount);
+			}
+			else
+			{
+				readAmount = stream_vfs_readStream(data, offset, buffer, amount);
+			}
+		}
+		catch(...)
+		{
+			return SQLITE_IOERR_READ;
+		}
+	}
+	if(readAmount == static_cast<uint64>(amount))
+	{
+		return SQLITE_OK;
+	}
+	else
+	{
+		//SQLite expects the rest of the buffer to be zeroed
+		memset(buffer + readAmount, 0, amount - readAmount);
+		return SQLITE_IOERR_SHORT_READ;
+	}
+}
+
+static int stream_vfs_io_fileSize(sqlite3_file* file, sqlite_int64* result)
+{
+	auto vfsFile = reinterpret_cast<StreamVfsFile*>(file);
+	(*result) = vfsFile->data->size;
+	return SQLITE_OK;
+}
+
+static int stream_vfs_io_lock(sqlite3_file*, int)
+{
+	return SQLITE_OK;
+}
+
+static int stream_vfs_io_unlock(sqlite3_file*, int)
+{
+	return SQLITE_OK;
+}
+
+static int stream_vfs_io_reservedLock(sqlite3_file*, int* result)
+{
+	(*result) = 0;
+	return SQLITE_OK;
+}
+
+static int stream_vfs_io_fileControl(sqlite3_file*, int, void*)
+{
+	//Lets SQLite handle pragmas and other controls with its default behavior
+	return SQLITE_NOTFOUND;
+}
+
+static int stream_vfs_io_deviceCharacteristics(sqlite3_file*)
+{
+	//Files never change while they're opened, this lets SQLite skip change detection
+	return SQLITE_IOCAP_IMMUTABLE;
+}
+
+static int stream_vfs_io_fetch(sqlite3_file* file, sqlite3_int64 offset, int amount, void** result)
+{
+	auto vfsFile = reinterpret_cast<StreamVfsFile*>(file);
+	const auto& data = *vfsFile->data;
+	(*result) = nullptr;
+	if(data.span && ((offset + amount) <= static_cast<int64>(data.size)))
+	{
+		//SQLite never writes through pages obtained this way on read only databases
+		(*result) = const_cast<uint8*>(data.span + offset);
+	}
+	//A null result makes SQLite fall back to xRead
+	return SQLITE_OK;
+}
+
+static int stream_vfs_io_unfetch(sqlite3_file*, sqlite3_int64, void*)
+{
+	//Span stays valid as long as the stream
+	return SQLITE_OK;
+}
+
+static const sqlite3_io_methods g_streamVfsIoMethods =
+{
+	3,
+	stream_vfs_io_close,
+	stream_vfs_io_read,
+	nullptr,
+	nullptr,
+	nullptr,
+	stream_vfs_io_fileSize,
+	stream_vfs_io_lock,
+	stream_vfs_io_unlock,
+	stream_vfs_io_reservedLock,
+	stream_vfs_io_fileControl,
+	nullptr,
+	stream_vfs_io_deviceCharacteristics,
+	nullptr,
+	nullptr,
+	nullptr,
+	nullptr,
+	stream_vfs_io_fetch,
+	stream_vfs_io_unfetch
+};
+
+static int stream_vfs_open(sqlite3_vfs*, const char* path, sqlite3_file* file, int flags, int*)
+{
+	//xClose is only called if pMethods is set
+	file->pMethods = nullptr;
+	if(((flags & SQLITE_OPEN_READONLY) == 0) || !path)
+	{
+		return SQLITE_CANTOPEN;
+	}
+
+	StreamVfsFileDataPtr data;
+	{
+		std::lock_guard<std::mutex> lock(g_streamVfsFilesMutex);
+		auto fileIterator = g_streamVfsFiles.find(path);
+		if(fileIterator == std::end(g_streamVfsFiles))
+		{
+			return SQLITE_CANTOPEN;
+		}
+		data = fileIterator->second;
+	}
+
+	auto vfsFile = reinterpret_cast<StreamVfsFile*>(file);
+	new (&vfsFile->data) StreamVfsFileDataPtr(std::move(data));
+	file->pMethods = &g_streamVfsIoMethods;
+	return SQLITE_OK;
+}
+
+static int stream_vfs_access(sqlite3_vfs*, const char* path, int, int* result)
+{
+	//Only tells about added files, journals and other temporary files never exist
+	std::lock_guard<std::mutex> lock(g_streamVfsFilesMutex);
+	(*result) = (g_streamVfsFiles.find(path) != std::end(g_streamVfsFiles)) ? 1 : 0;
+	return SQLITE_OK;
+}
+
+static int stream_vfs_fullPathname(sqlite3_vfs*, const char* inputPath, int outputPathSize, char* outputPath)
+{
+	strncpy(outputPath, inputPath, outputPathSize);
+	outputPath[outputPathSize - 1] = 0;
+	return SQLITE_OK;
+}
+
+//The rest isn't related to files, it's forwarded to the default VFS (date functions need the current time)
+static int stream_vfs_randomness(sqlite3_vfs*, int size, char* output)
+{
+	auto defaultVfs = sqlite3_vfs_find(nullptr);
+	return defaultVfs->xRandomness(defaultVfs, size, output);
+}
+
+static int stream_vfs_sleep(sqlite3_vfs*, int microseconds)
+{
+	auto defaultVfs = sqlite3_vfs_find(nullptr);
+	return defaultVfs->xSleep(defaultVfs, microseconds);
+}
+
+static int stream_vfs_currentTime(sqlite3_vfs*, double* result)
+{
+	auto defaultVfs = sqlite3_vfs_find(nullptr);
+	return defaultVfs->xCurrentTime(defaultVfs, result);
+}
+
+static sqlite3_vfs g_streamVfs =
+{
+	1,
+	sizeof(StreamVfsFile),
+	512,
+	nullptr,
+	STREAM_VFS_NAME,
+	0,
+	stream_vfs_open,
+	nullptr,
+	stream_vfs_access,
+	stream_vfs_fullPathname,
+	nullptr,
+	nullptr,
+	nullptr,
+	nullptr,
+	stream_vfs_randomness,
+	stream_vfs_sleep,
+	stream_vfs_currentTime,
+	//Only used by later versions of the structure
+	nullptr,
+	nullptr,
+	nullptr,
+	nullptr,
+	nullptr,
+};
+
+void Framework::Sqlite::registerStreamVfs()
+{
+	sqlite3_vfs_register(&g_streamVfs, 0);
+}
+
+void Framework::Sqlite::addStreamVfsFile(const std::string& name, std::shared_ptr<CStream> stream, uint64 offset, uint64 size, uint64 cacheSize)
+{
+	if(!stream)
+	{
+		throw std::runtime_error("Invalid stream.");
+	}
+	auto data = std::make_shared<StreamVfsFileData>();
+	data->offset = offset;
+	data->size = size;
+	if(auto spanStream = dynamic_cast<const CSpanStream*>(stream.get()))
+	{
+		data->span = spanStream->GetSpan(offset, size);
+	}
+	else if(cacheSize != 0)
+	{
+		CACHE_SETTINGS settings;
+		settings.capacity = std::max<uint64>(cacheSize / STREAM_VFS_CACHE_BLOCK_SIZE, 1);
+		//SQLite reads a page at a time, a few shards are enough to avoid contention
+		settings.shardCount = 4;
+		data->cache = std::make_unique<StreamVfsBlockCache>(settings);
+	}
+	data->stream = std::move(stream);
+	std::lock_guard<std::mutex> lock(g_streamVfsFilesMutex);
+	g_streamVfsFiles[name] = std::move(data);
+}
+
+void Framework::Sqlite::addStreamVfsFile(const std::string& name, std::shared_ptr<CStream> stream, uint64 cacheSize)
+{
+	if(!stream)
+	{
+		throw std::runtime_error("Invalid stream.");
+	}
+	uint64 size = stream->GetLength();
+	addStreamVfsFile(name, std::move(stream), 0, size, cacheSize);
+}
+
+void Framework::Sqlite::removeStreamVfsFile(const std::string& name)
+{
+	std::lock_guard<std::mutex> lock(g_streamVfsFilesMutex);
+	g_streamVfsFiles.erase(name);
+}
@@ -1,50 +1,53 @@
 #include "string_cast_win1252.h"
-#include "alloca_def.h"
-#ifdef _WIN32
-#include <windows.h>
-#elif defined(__APPLE__)
-#include <CoreFoundation/CoreFoundation.h>
-#elif defined(HAS_ICU)
-#include <unicode/ucnv.h>
-#endif
+#include "Types.h"
+#include "Utf8.h"
 
-std::wstring string_cast_win1252(const std::string& input)
+//Windows code page 1252 is ISO-8859-1 except for 0x80 to 0x9F. The 5 positions it leaves undefined
+//map to the matching C1 control characters, as Windows does.
+static constexpr uint16 g_win1252Controls[0x20] =
+{
+	0x20AC, 0x0081, 0x201A, 0x0192, 0x201E, 0x2026, 0x2020, 0x2021, 0x02C6, 0x2030, 0x0160, 0x2039, 0x0152, 0x008D, 0x017D, 0x008F,
+	0x0090, 0x2018, 0x2019, 0x201C, 0x201D, 0x2022, 0x2013, 0x2014, 0x02DC, 0x2122, 0x0161, 0x203A, 0x0153, 0x009D, 0x017E, 0x0178,
+};
+
+struct WIN1252_TABLE
 {
-#ifdef _WIN32
-	UINT codePage = 1252;
-	int reqLength = MultiByteToWideChar(codePage, 0, input.c_str(), input.length(), NULL, 0);
-	wchar_t* output = reinterpret_cast<wchar_t*>(alloca((reqLength + 1) * sizeof(wchar_t)));
-	MultiByteToWideChar(codePage, 0, input.c_str(), input.length(), output, reqLength);
-	output[reqLength] = 0;
-	return std::wstring(output);
-#elif defined(__APPLE__)
-	assert(sizeof(wchar_t) == 4);
-	CFStringEncoding srcEncoding = kCFStringEncodingWindowsLatin1;
-	CFStringEncoding dstEncoding = kCFStringEncodingUTF32;
-	CFStringRef stringRef = CFStringCreateWithBytes(NULL, reinterpret_cast<const UInt8*>(input.c_str()), input.length(), srcEncoding, false);
-	if(stringRef == NULL)
+	uint16 values[0x100];
+};
+
+static constexpr WIN1252_TABLE MakeWin1252Table()
+{
+	WIN1252_TABLE table = {};
+	for(unsigned int i = 0; i < 0x100; i++)
 	{
-		return std::wstring(L"(cast failed)");
+		table.values[i] = ((i >= 0x80) && (i < 0xA0)) ? g_win1252Controls[i - 0x80] : static_cast<uint16>(i);
 	}
-	CFIndex length = CFStringGetLength(stringRef);
-	CFIndex bufferSize = length * sizeof(wchar_t);
-	wchar_t* output = reinterpret_cast<wchar_t*>(alloca((length + 1) * sizeof(wchar_t)));
-	CFRange getRange = { 0, length };
-	CFStringGetBytes(stringRef, getRange, dstEncoding, '?', false, reinterpret_cast<UInt8*>(output), bufferSize, NULL);
-	output[length] = 0;
-	CFRelease(stringRef);
-	return std::wstring(output);
-#elif defined(HAS_ICU)
-	int32_t length = static_cast<int32_t>(input.length());
-	UErrorCode nStatus = U_ZERO_ERROR;
-	UChar* output = reinterpret_cast<UChar*>(alloca(length * sizeof(UChar)));
+	return table;
+}
 
-	UConverter* pConverter = ucnv_open("cp1252", &nStatus);
-	ucnv_toUChars(pConverter, output, length, input.c_str(), length, &nStatus);
-	ucnv_close(pConverter);
+static constexpr WIN1252_TABLE g_win1252Table = MakeWin1252Table();
 
-	return std::wstring(output, output + length);
-#else
-	return std::wstring(L"???");
-#endif
+size_t string_cast_win1252(const char* source, size_t size, wchar_t* output)
+{
+	auto input = reinterpret_cast<const uint8*>(source);
+	size_t position = 0;
+	while(position != size)
+	{
+		if(input[position] < 0x80)
+		{
+			position += Framework::Utf8::WidenAsciiPrefix(source + position, size - position, output + position);
+			continue;
+		}
+		output[position] = g_win1252Table.values[input[position]];
+		position++;
+	}
+	return size;
+}
+
+std::wstring string_cast_win1252(const std::string& input)
+{
+	std::wstring result;
+	result.resize(input.size());
+	string_cast_win1252(input.data(), input.size(), &result[0]);
+	return result;
 }
@@ -0,0 +1,70 @@
+#include "string_format_compiled.h"
+
+#if !defined(__cpp_lib_to_chars)
+//Floating point support for to_chars is missing from some standard libraries (libc++
+//before LLVM 20, for Android and older Apple targets), fall back on streams using the classic locale
+#include <limits>
+#include <sstream>
+#endif
+
+using namespace StringFormatCompiled;
+
+template <typename FloatType>
+static size_t FormatFloatImpl(char* buffer, FloatType value, char type, int precision)
+{
+#if defined(__cpp_lib_to_chars)
+	std::to_chars_result result;
+	if((type == 0) && (precision < 0))
+	{
+		result = std::to_chars(buffer, buffer + FLOAT_BUFFER_SIZE, value);
+	}
+	else
+	{
+		auto format = (type == 'f') ? std::chars_format::fixed : (type == 'e') ? std::chars_format::scientific : std::chars_format::general;
+		result = std::to_chars(buffer, buffer + FLOAT_BUFFER_SIZE, value, format, (precision < 0) ? 6 : precision);
+	}
+	return result.ptr - buffer;
+#else
+	std::string result;
+	if((type == 0) && (precision < 0))
+	{
+		//Increase the precision until the text round trips
+		for(int digits = 1; digits <= std::numeric_limits<FloatType>::max_digits10; digits++)
+		{
+			std::ostringstream stream;
+			stream.imbue(std::locale::classic());
+			stream.precision(digits);
+			stream << value;
+			result = stream.str();
+			std::istringstream parseStream(result);
+			parseStream.imbue(std::locale::classic());
+			FloatType parsedValue = 0;
+			parseStream >> parsedValue;
+			if(!parseStream.fail() && (parsedValue == value)) break;
+		}
+	}
+	else
+	{
+		std::ostringstream stream;
+		stream.imbue(std::locale::classic());
+		if(type == 'f') stream << std::fixed;
+		if(type == 'e') stream << std::scientific;
+		stream.precision((precision < 0) ? 6 : precision);
+		stream << value;
+		result = stream.str();
+	}
+	size_t size = std::min<size_t>(result.size(), FLOAT_BUFFER_SIZE);
+	memcpy(buffer, result.data(), size);
+	return size;
+#endif
+}
+
+size_t StringFormatCompiled::FormatFloat(char* buffer, float value, char type, int precision)
+{
+	return FormatFloatImpl(buffer, value, type, precision);
+}
+
+size_t StringFormatCompiled::FormatFloat(char* buffer, double value, char type, int precision)
+{
+	return FormatFloatImpl(buffer, value, type, precision);
+}
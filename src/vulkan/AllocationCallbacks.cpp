@@ -0,0 +1,92 @@
+#include "vulkan/AllocationCallbacks.h"
+#include "memory/AllocationTracker.h"
+
+using namespace Framework::Memory;
+
+static const char* g_allocationSites[] =
+{
+	"vulkan:command",
+	"vulkan:object",
+	"vulkan:cache",
+	"vulkan:device",
+	"vulkan:instance",
+};
+
+static const char* g_internalAllocationSite = "vulkan:internal";
+
+static const char* GetAllocationSite(VkSystemAllocationScope allocationScope)
+{
+	if(static_cast<size_t>(allocationScope) < (sizeof(g_allocationSites) / sizeof(g_allocationSites[0])))
+	{
+		return g_allocationSites[allocationScope];
+	}
+	return g_allocationSites[VK_SYSTEM_ALLOCATION_SCOPE_OBJECT];
+}
+
+static VKAPI_ATTR void* VKAPI_CALL TrackedAllocation(void*, size_t size, size_t alignment, VkSystemAllocationScope allocationScope)
+{
+	try
+	{
+		return CAllocationTracker::GetInstance().Allocate(CAllocationTracker::SUBSYSTEM_VULKAN, GetAllocationSite(allocationScope), size, alignment);
+	}
+	catch(...)
+	{
+		return nullptr;
+	}
+}
+
+static VKAPI_ATTR void* VKAPI_CALL TrackedReallocation(void* userData, void* original, size_t size, size_t alignment, VkSystemAllocationScope allocationScope)
+{
+	auto& tracker = CAllocationTracker::GetInstance();
+	if(!original)
+	{
+		return TrackedAllocation(userData, size, alignment, allocationScope);
+	}
+	if(size == 0)
+	{
+		tracker.Free(original);
+		return nullptr;
+	}
+	try
+	{
+		return tracker.Reallocate(original, size, alignment);
+	}
+	catch(...)
+	{
+		return nullptr;
+	}
+}
+
+static VKAPI_ATTR void VKAPI_CALL TrackedFree(void*, void* memory)
+{
+	CAllocationTracker::GetInstance().Free(memory);
+}
+
+//Allocations the driver makes on its own (ie.: executable memory), only reported
+static VKAPI_ATTR void VKAPI_CALL InternalAllocationNotification(void*, size_t size, VkInternalAllocationType, VkSystemAllocationScope)
+{
+	CAllocationTracker::GetInstance().RecordAllocation(CAllocationTracker::SUBSYSTEM_VULKAN, g_internalAllocationSite, size);
+}
+
+static VKAPI_ATTR void VKAPI_CALL InternalFreeNotification(void*, size_t size, VkInternalAllocationType, VkSystemAllocationScope)
+{
+	CAllocationTracker::GetInstance().RecordFree(CAllocationTracker::SUBSYSTEM_VULKAN, g_internalAllocationSite, size);
+}
+
+const VkAllocationCallbacks* Framework::Vulkan::GetTrackedAllocationCallbacks()
+{
+	static const VkAllocationCallbacks allocationCallbacks =
+	{
+		nullptr,
+		&TrackedAllocation,
+		&TrackedReallocation,
+		&TrackedFree,
+		&InternalAllocationNotification,
+		&InternalFreeNotification,
+	};
+	if(!CAllocationTracker::GetInstance().IsEnabled())
+	{
+		return nullptr;
+	}
+	return &allocationCallbacks;
+}
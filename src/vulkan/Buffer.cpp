@@ -3,6 +3,7 @@
 #include "vulkan/StructDefs.h"
 #include "vulkan/Utils.h"
 #include "vulkan/CommandBufferPool.h"
+#include "Trace.h"
 
 using namespace Framework::Vulkan;
 
@@ -13,6 +14,23 @@ CBuffer::CBuffer(CDevice& device, const VkPhysicalDeviceMemoryProperties& memory
 	Create(memoryProperties, usage, properties, size);
 }
 
+CBuffer::CBuffer(CMemoryAllocator& allocator, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, uint32 size)
+: m_device(&allocator.GetDevice())
+, m_allocator(&allocator)
+, m_size(size)
+{
+	CreateHandle(usage, size);
+
+	VkMemoryRequirements memoryRequirements = {};
+	m_device->vkGetBufferMemoryRequirements(*m_device, m_handle, &memoryRequirements);
+
+	m_allocation = m_allocator->Allocate(memoryRequirements, properties, true);
+	m_memory = m_allocation.memory;
+
+	auto result = m_device->vkBindBufferMemory(*m_device, m_handle, m_memory, m_allocation.offset);
+	CHECKVULKANERROR(result);
+}
+
 CBuffer::CBuffer(CBuffer&& rhs)
 {
 	MoveFrom(std::move(rhs));
@@ -40,11 +58,20 @@ void CBuffer::Reset()
 	if(m_memory != VK_NULL_HANDLE)
 	{
 		assert(m_device != nullptr);
-		m_device->vkFreeMemory(*m_device, m_memory, nullptr);
+		if(m_allocator)
+		{
+			m_allocator->Free(m_allocation);
+		}
+		else
+		{
+			m_device->vkFreeMemory(*m_device, m_memory, nullptr);
+		}
 		m_memory = VK_NULL_HANDLE;
 	}
 
 	m_device = nullptr;
+	m_allocator = nullptr;
+	m_allocation = MEMORY_ALLOCATION();
 }
 
 CBuffer& CBuffer::operator =(CBuffer&& rhs)
@@ -64,15 +91,38 @@ VkDeviceMemory CBuffer::GetMemory() const
 	return m_memory;
 }
 
+VkDeviceSize CBuffer::GetMemoryOffset() const
+{
+	return m_allocation.offset;
+}
+
+void* CBuffer::Map()
+{
+	if(m_allocator)
+	{
+		assert(m_allocation.mappedData);
+		return m_allocation.mappedData;
+	}
+	void* bufferPtr = nullptr;
+	auto result = m_device->vkMapMemory(*m_device, m_memory, 0, VK_WHOLE_SIZE, 0, &bufferPtr);
+	CHECKVULKANERROR(result);
+	return bufferPtr;
+}
+
+void CBuffer::Unmap()
+{
+	if(m_allocator)
+	{
+		return;
+	}
+	m_device->vkUnmapMemory(*m_device, m_memory);
+}
+
 void CBuffer::Create(const VkPhysicalDeviceMemoryProperties& memoryProperties, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, uint32 size)
 {
 	auto result = VK_SUCCESS;
 
-	auto bufferCreateInfo = Framework::Vulkan::BufferCreateInfo();
-	bufferCreateInfo.usage = usage;
-	bufferCreateInfo.size  = size;
-	result = m_device->vkCreateBuffer(*m_device, &bufferCreateInfo, nullptr, &m_handle);
-	CHECKVULKANERROR(result);
+	CreateHandle(usage, size);
 	
 	VkMemoryRequirements memoryRequirements = {};
 	m_device->vkGetBufferMemoryRequirements(*m_device, m_handle, &memoryRequirements);
@@ -89,13 +139,23 @@ void CBuffer::Create(const VkPhysicalDeviceMemoryProperties& memoryProperties, V
 	CHECKVULKANERROR(result);
 }
 
+void CBuffer::CreateHandle(VkBufferUsageFlags usage, uint32 size)
+{
+	auto bufferCreateInfo = Framework::Vulkan::BufferCreateInfo();
+	bufferCreateInfo.usage = usage;
+	bufferCreateInfo.size  = size;
+	auto result = m_device->vkCreateBuffer(*m_device, &bufferCreateInfo, nullptr, &m_handle);
+	CHECKVULKANERROR(result);
+}
+
 void CBuffer::Read(VkQueue queue, CCommandBufferPool& commandBufferPool, 
 	const VkPhysicalDeviceMemoryProperties& memoryProperties, void* bufferData)
 {
 	auto result = VK_SUCCESS;
 
-	auto stagingBuffer = CBuffer(*m_device, memoryProperties,
-		VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, m_size);
+	auto stagingBuffer = m_allocator ?
+		CBuffer(*m_allocator, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, m_size) :
+		CBuffer(*m_device, memoryProperties, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, m_size);
 	
 	auto commandBuffer = commandBufferPool.AllocateBuffer();
 	
@@ -122,6 +182,7 @@ void CBuffer::Read(VkQueue queue, CCommandBufferPool& commandBufferPool,
 	
 	//Submit command buffer
 	{
+		FRAMEWORK_TRACE_SCOPE("Vulkan::QueueSubmit");
 		auto submitInfo = Framework::Vulkan::SubmitInfo();
 		submitInfo.commandBufferCount = 1;
 		submitInfo.pCommandBuffers    = &commandBuffer;
@@ -137,13 +198,9 @@ void CBuffer::Read(VkQueue queue, CCommandBufferPool& commandBufferPool,
 	commandBufferPool.FreeBuffer(commandBuffer);
 
 	{
-		void* bufferPtr = nullptr;
-		result = m_device->vkMapMemory(*m_device, stagingBuffer.GetMemory(), 0, VK_WHOLE_SIZE, 0, &bufferPtr);
-		CHECKVULKANERROR(result);
-
+		void* bufferPtr = stagingBuffer.Map();
 		memcpy(bufferData, bufferPtr, m_size);
-
-		m_device->vkUnmapMemory(*m_device, stagingBuffer.GetMemory());
+		stagingBuffer.Unmap();
 	}
 }
 
@@ -152,17 +209,14 @@ void CBuffer::Write(VkQueue queue, CCommandBufferPool& commandBufferPool,
 {
 	auto result = VK_SUCCESS;
 
-	auto stagingBuffer = CBuffer(*m_device, memoryProperties,
-		VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, m_size);
+	auto stagingBuffer = m_allocator ?
+		CBuffer(*m_allocator, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, m_size) :
+		CBuffer(*m_device, memoryProperties, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, m_size);
 	
 	{
-		void* bufferPtr = nullptr;
-		result = m_device->vkMapMemory(*m_device, stagingBuffer.GetMemory(), 0, VK_WHOLE_SIZE, 0, &bufferPtr);
-		CHECKVULKANERROR(result);
-
+		void* bufferPtr = stagingBuffer.Map();
 		memcpy(bufferPtr, bufferData, m_size);
-
-		m_device->vkUnmapMemory(*m_device, stagingBuffer.GetMemory());
+		stagingBuffer.Unmap();
 	}
 
 	auto commandBuffer = commandBufferPool.AllocateBuffer();
@@ -190,6 +244,7 @@ void CBuffer::Write(VkQueue queue, CCommandBufferPool& commandBufferPool,
 	
 	//Submit command buffer
 	{
+		FRAMEWORK_TRACE_SCOPE("Vulkan::QueueSubmit");
 		auto submitInfo = Framework::Vulkan::SubmitInfo();
 		submitInfo.commandBufferCount = 1;
 		submitInfo.pCommandBuffers    = &commandBuffer;
@@ -210,5 +265,7 @@ void CBuffer::MoveFrom(CBuffer&& rhs)
 	std::swap(m_device, rhs.m_device);
 	std::swap(m_handle, rhs.m_handle);
 	std::swap(m_memory, rhs.m_memory);
+	std::swap(m_allocator, rhs.m_allocator);
+	std::swap(m_allocation, rhs.m_allocation);
 	std::swap(m_size, rhs.m_size);
 }
@@ -3,10 +3,16 @@
 
 using namespace Framework::Vulkan;
 
-CCommandBufferPool::CCommandBufferPool(CDevice& device, uint32_t queueFamilyIndex)
+CCommandBufferPool::CCommandBufferPool(CDevice& device, uint32_t queueFamilyIndex, VkCommandPoolCreateFlags flags)
 : m_device(&device)
 {
-	Create(queueFamilyIndex);
+	Create(queueFamilyIndex, flags);
+}
+
+CCommandBufferPool::CCommandBufferPool(CCommandBufferPool&& rhs)
+{
+	std::swap(m_device, rhs.m_device);
+	std::swap(m_handle, rhs.m_handle);
 }
 
 CCommandBufferPool::~CCommandBufferPool()
@@ -62,15 +68,16 @@ void CCommandBufferPool::FreeBuffer(VkCommandBuffer commandBuffer)
 
 void CCommandBufferPool::ResetBuffers()
 {
-	//Not implemented, needs to call vkResetCommandPool
-	assert(false);
+	assert(m_handle != VK_NULL_HANDLE);
+	auto result = m_device->vkResetCommandPool(*m_device, m_handle, 0);
+	CHECKVULKANERROR(result);
 }
 
-void CCommandBufferPool::Create(uint32_t queueFamilyIndex)
+void CCommandBufferPool::Create(uint32_t queueFamilyIndex, VkCommandPoolCreateFlags flags)
 {
 	auto commandPoolCreateInfo = Framework::Vulkan::CommandPoolCreateInfo();
 	commandPoolCreateInfo.queueFamilyIndex = queueFamilyIndex;
-	commandPoolCreateInfo.flags            = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+	commandPoolCreateInfo.flags            = flags;
 
 	auto result = m_device->vkCreateCommandPool(*m_device, &commandPoolCreateInfo, nullptr, &m_handle);
 	CHECKVULKANERROR(result);
@@ -0,0 +1,205 @@
+#include "vulkan/DescriptorAllocator.h"
+#include "vulkan/StructDefs.h"
+#include "HashUtils.h"
+
+using namespace Framework::Vulkan;
+
+CDescriptorAllocator::CDescriptorAllocator(CDevice& device, uint32 maxSetsPerPool, std::vector<VkDescriptorPoolSize> poolSizes)
+: m_device(device)
+, m_maxSetsPerPool(maxSetsPerPool)
+, m_poolSizes(std::move(poolSizes))
+{
+	if(m_poolSizes.empty())
+	{
+		m_poolSizes =
+		{
+			{ VK_DESCRIPTOR_TYPE_SAMPLER,                m_maxSetsPerPool / 2 },
+			{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_maxSetsPerPool * 4 },
+			{ VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,          m_maxSetsPerPool * 4 },
+			{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,          m_maxSetsPerPool },
+			{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,         m_maxSetsPerPool * 2 },
+			{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,         m_maxSetsPerPool * 2 },
+			{ VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT,       m_maxSetsPerPool / 2 },
+		};
+	}
+}
+
+CDescriptorAllocator::~CDescriptorAllocator()
+{
+	if(m_currentPool != VK_NULL_HANDLE)
+	{
+		m_device.vkDestroyDescriptorPool(m_device, m_currentPool, nullptr);
+	}
+	for(auto pool : m_usedPools)
+	{
+		m_device.vkDestroyDescriptorPool(m_device, pool, nullptr);
+	}
+	for(auto pool : m_freePools)
+	{
+		m_device.vkDestroyDescriptorPool(m_device, pool, nullptr);
+	}
+}
+
+VkDescriptorSet CDescriptorAllocator::Allocate(VkDescriptorSetLayout layout)
+{
+	if(m_currentPool == VK_NULL_HANDLE)
+	{
+		m_currentPool = GetNextPool();
+	}
+
+	auto setAllocateInfo = Framework::Vulkan::DescriptorSetAllocateInfo();
+	setAllocateInfo.descriptorPool     = m_currentPool;
+	setAllocateInfo.descriptorSetCount = 1;
+	setAllocateInfo.pSetLayouts        = &layout;
+
+	VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+	auto result = m_device.vkAllocateDescriptorSets(m_device, &setAllocateInfo, &descriptorSet);
+	if((result == VK_ERROR_OUT_OF_POOL_MEMORY) || (result == VK_ERROR_FRAGMENTED_POOL))
+	{
+		//Current pool is full, it stays used until the next reset
+		m_usedPools.push_back(m_currentPool);
+		m_currentPool = GetNextPool();
+
+		setAllocateInfo.descriptorPool = m_currentPool;
+		result = m_device.vkAllocateDescriptorSets(m_device, &setAllocateInfo, &descriptorSet);
+	}
+	CHECKVULKANERROR(result);
+
+	return descriptorSet;
+}
+
+VkDescriptorSet CDescriptorAllocator::AllocateAndWrite(VkDescriptorSetLayout layout, const DESCRIPTOR_WRITE* writes, uint32 writeCount)
+{
+	MakeCacheKey(layout, writes, writeCount);
+	auto keyHash = Framework::HashUtils::ComputeXxh3_64(m_keyScratch.data(), m_keyScratch.size() * sizeof(uint64));
+
+	auto& cachedSets = m_cachedSets[keyHash];
+	for(const auto& cachedSet : cachedSets)
+	{
+		if(cachedSet.key == m_keyScratch)
+		{
+			return cachedSet.set;
+		}
+	}
+
+	auto descriptorSet = Allocate(layout);
+
+	m_writeScratch.clear();
+	for(uint32 i = 0; i < writeCount; i++)
+	{
+		const auto& write = writes[i];
+		auto writeSet = Framework::Vulkan::WriteDescriptorSet();
+		writeSet.dstSet          = descriptorSet;
+		writeSet.dstBinding      = write.binding;
+		writeSet.descriptorCount = 1;
+		writeSet.descriptorType  = write.type;
+		if(IsImageDescriptor(write.type))
+		{
+			writeSet.pImageInfo = &write.imageInfo;
+		}
+		else
+		{
+			writeSet.pBufferInfo = &write.bufferInfo;
+		}
+		m_writeScratch.push_back(writeSet);
+	}
+	m_device.vkUpdateDescriptorSets(m_device, static_cast<uint32>(m_writeScratch.size()), m_writeScratch.data(), 0, nullptr);
+
+	CACHED_SET cachedSet;
+	cachedSet.key = m_keyScratch;
+	cachedSet.set = descriptorSet;
+	cachedSets.push_back(std::move(cachedSet));
+
+	return descriptorSet;
+}
+
+void CDescriptorAllocator::Reset()
+{
+	if(m_currentPool != VK_NULL_HANDLE)
+	{
+		m_usedPools.push_back(m_currentPool);
+		m_currentPool = VK_NULL_HANDLE;
+	}
+	for(auto pool : m_usedPools)
+	{
+		auto result = m_device.vkResetDescriptorPool(m_device, pool, 0);
+		CHECKVULKANERROR(result);
+		m_freePools.push_back(pool);
+	}
+	m_usedPools.clear();
+	m_cachedSets.clear();
+}
+
+uint32 CDescriptorAllocator::GetPoolCount() const
+{
+	uint32 poolCount = static_cast<uint32>(m_usedPools.size() + m_freePools.size());
+	if(m_currentPool != VK_NULL_HANDLE)
+	{
+		poolCount++;
+	}
+	return poolCount;
+}
+
+VkDescriptorPool CDescriptorAllocator::CreatePool()
+{
+	auto poolCreateInfo = Framework::Vulkan::DescriptorPoolCreateInfo();
+	poolCreateInfo.maxSets       = m_maxSetsPerPool;
+	poolCreateInfo.poolSizeCount = static_cast<uint32>(m_poolSizes.size());
+	poolCreateInfo.pPoolSizes    = m_poolSizes.data();
+
+	VkDescriptorPool pool = VK_NULL_HANDLE;
+	auto result = m_device.vkCreateDescriptorPool(m_device, &poolCreateInfo, nullptr, &pool);
+	CHECKVULKANERROR(result);
+
+	return pool;
+}
+
+VkDescriptorPool CDescriptorAllocator::GetNextPool()
+{
+	if(!m_freePools.empty())
+	{
+		auto pool = m_freePools.back();
+		m_freePools.pop_back();
+		return pool;
+	}
+	return CreatePool();
+}
+
+void CDescriptorAllocator::MakeCacheKey(VkDescriptorSetLayout layout, const DESCRIPTOR_WRITE* writes, uint32 writeCount)
+{
+	//Fields are copied one by one, structures could have uninitialized padding
+	m_keyScratch.clear();
+	m_keyScratch.push_back(reinterpret_cast<uint64>(layout));
+	for(uint32 i = 0; i < writeCount; i++)
+	{
+		const auto& write = writes[i];
+		m_keyScratch.push_back((static_cast<uint64>(write.binding) << 32) | static_cast<uint32>(write.type));
+		if(IsImageDescriptor(write.type))
+		{
+			m_keyScratch.push_back(reinterpret_cast<uint64>(write.imageInfo.sampler));
+			m_keyScratch.push_back(reinterpret_cast<uint64>(write.imageInfo.imageView));
+			m_keyScratch.push_back(write.imageInfo.imageLayout);
+		}
+		else
+		{
+			m_keyScratch.push_back(reinterpret_cast<uint64>(write.bufferInfo.buffer));
+			m_keyScratch.push_back(write.bufferInfo.offset);
+			m_keyScratch.push_back(write.bufferInfo.range);
+		}
+	}
+}
+
+bool CDescriptorAllocator::IsImageDescriptor(VkDescriptorType type)
+{
+	switch(type)
+	{
+	case VK_DESCRIPTOR_TYPE_SAMPLER:
+	case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+	case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+	case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+	case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:
+		return true;
+	default:
+		return false;
+	}
+}
@@ -1,14 +1,16 @@
 #include "vulkan/VulkanDef.h"
 #include "vulkan/Device.h"
+#include "vulkan/AllocationCallbacks.h"
+#include "StartupProfiler.h"
 
-#define SET_PROC_ADDR(functionName) this->functionName = reinterpret_cast<PFN_##functionName>(m_instance->vkGetDeviceProcAddr(m_handle, #functionName));
+#define SET_PROC_ADDR(functionName) this->functionName.Bind(*m_procResolver, loading);
 
 using namespace Framework::Vulkan;
 
-CDevice::CDevice(const CInstance& instance, VkPhysicalDevice physicalDevice, const VkDeviceCreateInfo& deviceCreateInfo)
+CDevice::CDevice(const CInstance& instance, VkPhysicalDevice physicalDevice, const VkDeviceCreateInfo& deviceCreateInfo, PROC_LOADING loading)
 : m_instance(&instance)
 {
-	Create(physicalDevice, deviceCreateInfo);
+	Create(physicalDevice, deviceCreateInfo, loading);
 }
 
 CDevice::~CDevice()
@@ -26,9 +28,10 @@ void CDevice::Reset()
 	if(m_handle != VK_NULL_HANDLE)
 	{
 		assert(m_instance != nullptr);
-		m_instance->vkDestroyDevice(m_handle, nullptr);
+		m_instance->vkDestroyDevice(m_handle, m_allocationCallbacks);
 		m_instance = nullptr;
 		m_handle = VK_NULL_HANDLE;
+		m_allocationCallbacks = nullptr;
 	}
 	
 	vkResetCommandPool = nullptr;
@@ -50,10 +53,12 @@ void CDevice::Reset()
 	vkCmdNextSubpass = nullptr;
 	vkCmdPipelineBarrier = nullptr;
 	vkCmdPushConstants = nullptr;
+	vkCmdResetQueryPool = nullptr;
 	vkCmdSetBlendConstants = nullptr;
 	vkCmdSetScissor = nullptr;
 	vkCmdSetViewport = nullptr;
 	vkCmdUpdateBuffer = nullptr;
+	vkCmdWriteTimestamp = nullptr;
 	
 	vkGetDeviceQueue = nullptr;
 	
@@ -113,6 +118,12 @@ void CDevice::Reset()
 	
 	vkCreatePipelineCache = nullptr;
 	vkDestroyPipelineCache = nullptr;
+	vkGetPipelineCacheData = nullptr;
+	vkMergePipelineCaches = nullptr;
+	
+	vkCreateQueryPool = nullptr;
+	vkDestroyQueryPool = nullptr;
+	vkGetQueryPoolResults = nullptr;
 	
 	vkCreatePipelineLayout = nullptr;
 	vkDestroyPipelineLayout = nullptr;
@@ -125,6 +136,8 @@ void CDevice::Reset()
 	
 	vkCreateSemaphore = nullptr;
 	vkDestroySemaphore = nullptr;
+	vkGetSemaphoreCounterValue = nullptr;
+	vkWaitSemaphores = nullptr;
 	
 	vkCreateShaderModule = nullptr;
 	vkDestroyShaderModule = nullptr;
@@ -134,6 +147,8 @@ void CDevice::Reset()
 	vkDestroySwapchainKHR = nullptr;
 	vkGetSwapchainImagesKHR = nullptr;
 	vkQueuePresentKHR = nullptr;
+	
+	m_procResolver.reset();
 }
 
 CDevice& CDevice::operator =(CDevice&& rhs)
@@ -142,6 +157,8 @@ CDevice& CDevice::operator =(CDevice&& rhs)
 	
 	std::swap(m_handle, rhs.m_handle);
 	std::swap(m_instance, rhs.m_instance);
+	std::swap(m_allocationCallbacks, rhs.m_allocationCallbacks);
+	std::swap(m_procResolver, rhs.m_procResolver);
 	
 	std::swap(vkResetCommandPool, rhs.vkResetCommandPool);
 	std::swap(vkBeginCommandBuffer, rhs.vkBeginCommandBuffer);
@@ -163,9 +180,11 @@ CDevice& CDevice::operator =(CDevice&& rhs)
 	std::swap(vkCmdPipelineBarrier, rhs.vkCmdPipelineBarrier);
 	std::swap(vkCmdSetBlendConstants, rhs.vkCmdSetBlendConstants);
 	std::swap(vkCmdPushConstants, rhs.vkCmdPushConstants);
+	std::swap(vkCmdResetQueryPool, rhs.vkCmdResetQueryPool);
 	std::swap(vkCmdSetScissor, rhs.vkCmdSetScissor);
 	std::swap(vkCmdSetViewport, rhs.vkCmdSetViewport);
 	std::swap(vkCmdUpdateBuffer, rhs.vkCmdUpdateBuffer);
+	std::swap(vkCmdWriteTimestamp, rhs.vkCmdWriteTimestamp);
 	
 	std::swap(vkGetDeviceQueue, rhs.vkGetDeviceQueue);
 	
@@ -225,6 +244,12 @@ CDevice& CDevice::operator =(CDevice&& rhs)
 	
 	std::swap(vkCreatePipelineCache, rhs.vkCreatePipelineCache);
 	std::swap(vkDestroyPipelineCache, rhs.vkDestroyPipelineCache);
+	std::swap(vkGetPipelineCacheData, rhs.vkGetPipelineCacheData);
+	std::swap(vkMergePipelineCaches, rhs.vkMergePipelineCaches);
+	
+	std::swap(vkCreateQueryPool, rhs.vkCreateQueryPool);
+	std::swap(vkDestroyQueryPool, rhs.vkDestroyQueryPool);
+	std::swap(vkGetQueryPoolResults, rhs.vkGetQueryPoolResults);
 	
 	std::swap(vkCreatePipelineLayout, rhs.vkCreatePipelineLayout);
 	std::swap(vkDestroyPipelineLayout, rhs.vkDestroyPipelineLayout);
@@ -237,6 +262,8 @@ CDevice& CDevice::operator =(CDevice&& rhs)
 	
 	std::swap(vkCreateSemaphore, rhs.vkCreateSemaphore);
 	std::swap(vkDestroySemaphore, rhs.vkDestroySemaphore);
+	std::swap(vkGetSemaphoreCounterValue, rhs.vkGetSemaphoreCounterValue);
+	std::swap(vkWaitSemaphores, rhs.vkWaitSemaphores);
 	
 	std::swap(vkCreateShaderModule, rhs.vkCreateShaderModule);
 	std::swap(vkDestroyShaderModule, rhs.vkDestroyShaderModule);
@@ -255,13 +282,38 @@ CDevice::operator VkDevice() const
 	return m_handle;
 }
 
-void CDevice::Create(VkPhysicalDevice physicalDevice, const VkDeviceCreateInfo& deviceCreateInfo)
+void CDevice::ResolveProcAddrs()
 {
+	FRAMEWORK_STARTUP_PHASE("Vulkan::Device::ResolveProcAddrs");
+	assert(m_procResolver);
+	BindProcAddrs(PROC_LOADING_EAGER);
+}
+
+void CDevice::Create(VkPhysicalDevice physicalDevice, const VkDeviceCreateInfo& deviceCreateInfo, PROC_LOADING loading)
+{
+	FRAMEWORK_STARTUP_PHASE("Vulkan::Device::Create");
 	assert(m_handle == VK_NULL_HANDLE);
 	
-	auto result = m_instance->vkCreateDevice(physicalDevice, &deviceCreateInfo, nullptr, &m_handle);
+	m_allocationCallbacks = GetTrackedAllocationCallbacks();
+	auto result = m_instance->vkCreateDevice(physicalDevice, &deviceCreateInfo, m_allocationCallbacks, &m_handle);
 	CHECKVULKANERROR(result);
 	
+	m_procResolver = std::make_unique<ProcResolver>(
+	    [getDeviceProcAddr = m_instance->vkGetDeviceProcAddr.Get(), device = m_handle](const char* name) {
+		    return getDeviceProcAddr(device, name);
+	    });
+	BindProcAddrs(loading);
+	
+	//Core names aren't available on Vulkan 1.1 devices exposing the extension
+	if(!vkGetSemaphoreCounterValue)
+	{
+		vkGetSemaphoreCounterValue = reinterpret_cast<PFN_vkGetSemaphoreCounterValue>(m_instance->vkGetDeviceProcAddr(m_handle, "vkGetSemaphoreCounterValueKHR"));
+		vkWaitSemaphores = reinterpret_cast<PFN_vkWaitSemaphores>(m_instance->vkGetDeviceProcAddr(m_handle, "vkWaitSemaphoresKHR"));
+	}
+}
+
+void CDevice::BindProcAddrs(PROC_LOADING loading)
+{
 	SET_PROC_ADDR(vkResetCommandPool);
 	SET_PROC_ADDR(vkBeginCommandBuffer);
 	SET_PROC_ADDR(vkEndCommandBuffer);
@@ -281,10 +333,12 @@ void CDevice::Create(VkPhysicalDevice physicalDevice, const VkDeviceCreateInfo&
 	SET_PROC_ADDR(vkCmdNextSubpass);
 	SET_PROC_ADDR(vkCmdPipelineBarrier);
 	SET_PROC_ADDR(vkCmdPushConstants);
+	SET_PROC_ADDR(vkCmdResetQueryPool);
 	SET_PROC_ADDR(vkCmdSetBlendConstants);
 	SET_PROC_ADDR(vkCmdSetScissor);
 	SET_PROC_ADDR(vkCmdSetViewport);
 	SET_PROC_ADDR(vkCmdUpdateBuffer);
+	SET_PROC_ADDR(vkCmdWriteTimestamp);
 	
 	SET_PROC_ADDR(vkGetDeviceQueue);
 	
@@ -344,6 +398,12 @@ void CDevice::Create(VkPhysicalDevice physicalDevice, const VkDeviceCreateInfo&
 	
 	SET_PROC_ADDR(vkCreatePipelineCache);
 	SET_PROC_ADDR(vkDestroyPipelineCache);
+	SET_PROC_ADDR(vkGetPipelineCacheData);
+	SET_PROC_ADDR(vkMergePipelineCaches);
+	
+	SET_PROC_ADDR(vkCreateQueryPool);
+	SET_PROC_ADDR(vkDestroyQueryPool);
+	SET_PROC_ADDR(vkGetQueryPoolResults);
 	
 	SET_PROC_ADDR(vkCreatePipelineLayout);
 	SET_PROC_ADDR(vkDestroyPipelineLayout);
@@ -356,6 +416,8 @@ void CDevice::Create(VkPhysicalDevice physicalDevice, const VkDeviceCreateInfo&
 	
 	SET_PROC_ADDR(vkCreateSemaphore);
 	SET_PROC_ADDR(vkDestroySemaphore);
+	SET_PROC_ADDR(vkGetSemaphoreCounterValue);
+	SET_PROC_ADDR(vkWaitSemaphores);
 	
 	SET_PROC_ADDR(vkCreateShaderModule);
 	SET_PROC_ADDR(vkDestroyShaderModule);
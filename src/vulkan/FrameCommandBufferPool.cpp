@@ -0,0 +1,68 @@
+#include "vulkan/FrameCommandBufferPool.h"
+
+using namespace Framework::Vulkan;
+
+CFrameCommandBufferPool::CFrameCommandBufferPool(CDevice& device, uint32 queueFamilyIndex, uint32 frameCount)
+: m_device(device)
+, m_queueFamilyIndex(queueFamilyIndex)
+, m_frames(frameCount)
+{
+	assert(frameCount != 0);
+}
+
+void CFrameCommandBufferPool::BeginFrame(VkFence fence)
+{
+	m_frameIndex = (m_frameIndex + 1) % m_frames.size();
+	auto& frame = m_frames[m_frameIndex];
+
+	if(frame.fence != VK_NULL_HANDLE)
+	{
+		auto result = m_device.vkWaitForFences(m_device, 1, &frame.fence, VK_TRUE, UINT64_MAX);
+		CHECKVULKANERROR(result);
+	}
+	frame.fence = fence;
+
+	//Command buffers come back in the initial state and can be begun again
+	for(auto& threadPoolPair : frame.threadPools)
+	{
+		auto& threadPool = *threadPoolPair.second;
+		if(threadPool.usedCount != 0)
+		{
+			threadPool.pool.ResetBuffers();
+			threadPool.usedCount = 0;
+		}
+	}
+}
+
+VkCommandBuffer CFrameCommandBufferPool::AllocateBuffer()
+{
+	auto& threadPool = GetThreadPool();
+	if(threadPool.usedCount == threadPool.commandBuffers.size())
+	{
+		threadPool.commandBuffers.push_back(threadPool.pool.AllocateBuffer());
+	}
+	return threadPool.commandBuffers[threadPool.usedCount++];
+}
+
+uint32 CFrameCommandBufferPool::GetFrameIndex() const
+{
+	return m_frameIndex;
+}
+
+uint32 CFrameCommandBufferPool::GetFrameCount() const
+{
+	return static_cast<uint32>(m_frames.size());
+}
+
+CFrameCommandBufferPool::THREAD_POOL& CFrameCommandBufferPool::GetThreadPool()
+{
+	//Only the lookup is locked, a thread pool is only ever used by its own thread
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto& threadPool = m_frames[m_frameIndex].threadPools[std::this_thread::get_id()];
+	if(!threadPool)
+	{
+		threadPool = std::make_unique<THREAD_POOL>();
+		threadPool->pool = CCommandBufferPool(m_device, m_queueFamilyIndex, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+	}
+	return *threadPool;
+}
@@ -0,0 +1,149 @@
+#include "vulkan/GpuProfiler.h"
+#include "vulkan/StructDefs.h"
+
+using namespace Framework::Vulkan;
+
+CGpuProfiler::CGpuProfiler(CDevice& device, float timestampPeriod, uint32 timestampValidBits, uint32 frameCount, uint32 maxScopesPerFrame)
+: m_device(device)
+, m_timestampPeriod(timestampPeriod)
+, m_timestampMask((timestampValidBits >= 64) ? ~0ULL : ((1ULL << timestampValidBits) - 1))
+, m_maxScopesPerFrame(maxScopesPerFrame)
+, m_frames(frameCount)
+{
+	assert(frameCount != 0);
+	assert(timestampValidBits != 0);
+
+	//Two queries per scope, for its beginning and its end
+	auto queryPoolCreateInfo = Framework::Vulkan::QueryPoolCreateInfo();
+	queryPoolCreateInfo.queryType  = VK_QUERY_TYPE_TIMESTAMP;
+	queryPoolCreateInfo.queryCount = frameCount * maxScopesPerFrame * 2;
+
+	auto result = m_device.vkCreateQueryPool(m_device, &queryPoolCreateInfo, nullptr, &m_queryPool);
+	CHECKVULKANERROR(result);
+
+	for(auto& frame : m_frames)
+	{
+		frame.scopes.reserve(maxScopesPerFrame);
+	}
+	m_queryResults.resize(maxScopesPerFrame * 2);
+}
+
+CGpuProfiler::~CGpuProfiler()
+{
+	m_device.vkDestroyQueryPool(m_device, m_queryPool, nullptr);
+}
+
+void CGpuProfiler::BeginFrame(VkCommandBuffer commandBuffer)
+{
+	assert(m_depth == 0);
+	if(m_frameBegun)
+	{
+		m_frameIndex = (m_frameIndex + 1) % m_frames.size();
+	}
+	m_frameBegun = true;
+
+	auto& frame = m_frames[m_frameIndex];
+	if(frame.pending)
+	{
+		ReadBackFrame(m_frameIndex);
+	}
+	frame.scopes.clear();
+	frame.pending = true;
+
+	//Queries need to be reset before being written again
+	m_device.vkCmdResetQueryPool(commandBuffer, m_queryPool, m_frameIndex * m_maxScopesPerFrame * 2, m_maxScopesPerFrame * 2);
+}
+
+uint32 CGpuProfiler::BeginScope(VkCommandBuffer commandBuffer, const char* name)
+{
+	assert(m_frameBegun);
+	auto& frame = m_frames[m_frameIndex];
+	if(frame.scopes.size() == m_maxScopesPerFrame)
+	{
+		return INVALID_SCOPE;
+	}
+
+	uint32 scopeIndex = static_cast<uint32>(frame.scopes.size());
+	uint32 queryIndex = ((m_frameIndex * m_maxScopesPerFrame) + scopeIndex) * 2;
+	m_device.vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_queryPool, queryIndex);
+
+	SCOPE scope;
+	scope.name = name;
+	scope.depth = m_depth++;
+	scope.cpuBeginTime = std::chrono::steady_clock::now();
+	frame.scopes.push_back(scope);
+
+	return scopeIndex;
+}
+
+void CGpuProfiler::EndScope(VkCommandBuffer commandBuffer, uint32 scopeIndex)
+{
+	if(scopeIndex == INVALID_SCOPE)
+	{
+		return;
+	}
+
+	auto& frame = m_frames[m_frameIndex];
+	assert(scopeIndex < frame.scopes.size());
+	auto& scope = frame.scopes[scopeIndex];
+	assert(!scope.ended);
+
+	uint32 queryIndex = ((m_frameIndex * m_maxScopesPerFrame) + scopeIndex) * 2 + 1;
+	m_device.vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_queryPool, queryIndex);
+
+	scope.cpuEndTime = std::chrono::steady_clock::now();
+	scope.ended = true;
+	assert(m_depth != 0);
+	m_depth--;
+}
+
+const CGpuProfiler::ScopeTimingArray& CGpuProfiler::GetLastFrameTimings() const
+{
+	return m_lastFrameTimings;
+}
+
+uint32 CGpuProfiler::GetDroppedFrameCount() const
+{
+	return m_droppedFrameCount;
+}
+
+void CGpuProfiler::ReadBackFrame(uint32 frameIndex)
+{
+	auto& frame = m_frames[frameIndex];
+	frame.pending = false;
+	if(frame.scopes.empty())
+	{
+		return;
+	}
+
+	uint32 queryCount = static_cast<uint32>(frame.scopes.size() * 2);
+	size_t resultsSize = queryCount * sizeof(uint64);
+	//No wait flag, results that aren't available yet give VK_NOT_READY
+	auto result = m_device.vkGetQueryPoolResults(m_device, m_queryPool, frameIndex * m_maxScopesPerFrame * 2, queryCount,
+		resultsSize, m_queryResults.data(), sizeof(uint64), VK_QUERY_RESULT_64_BIT);
+	if(result == VK_NOT_READY)
+	{
+		m_droppedFrameCount++;
+		return;
+	}
+	CHECKVULKANERROR(result);
+
+	m_lastFrameTimings.clear();
+	for(uint32 scopeIndex = 0; scopeIndex < frame.scopes.size(); scopeIndex++)
+	{
+		const auto& scope = frame.scopes[scopeIndex];
+		//Scope that wasn't ended has no end timestamp
+		if(!scope.ended) continue;
+		uint64 beginTicks = m_queryResults[scopeIndex * 2 + 0];
+		uint64 endTicks = m_queryResults[scopeIndex * 2 + 1];
+		uint64 elapsedTicks = (endTicks - beginTicks) & m_timestampMask;
+
+		SCOPE_TIMING timing;
+		timing.name = scope.name;
+		timing.depth = scope.depth;
+		//Timestamp period is in nanoseconds per tick
+		timing.gpuMilliseconds = static_cast<double>(elapsedTicks) * m_timestampPeriod / 1000000.0;
+		timing.cpuMilliseconds = std::chrono::duration<double, std::milli>(scope.cpuEndTime - scope.cpuBeginTime).count();
+		m_lastFrameTimings.push_back(timing);
+	}
+}
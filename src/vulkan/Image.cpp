@@ -1,22 +1,73 @@
+#include <algorithm>
 #include <cstring>
 #include "vulkan/Image.h"
 #include "vulkan/StructDefs.h"
 #include "vulkan/Utils.h"
 #include "vulkan/CommandBufferPool.h"
+#include "Trace.h"
 
 using namespace Framework::Vulkan;
 
+namespace
+{
+	//Formats stored as 4x4 blocks, partial blocks on the edges take a whole block
+	bool IsBlockCompressedFormat(VkFormat format)
+	{
+		switch(format)
+		{
+		case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+		case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+		case VK_FORMAT_BC3_UNORM_BLOCK:
+		case VK_FORMAT_BC7_UNORM_BLOCK:
+		case VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK:
+		case VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	uint32 GetBlockCount(uint32 width, uint32 height)
+	{
+		return ((width + 3) / 4) * ((height + 3) / 4);
+	}
+}
+
 CImage::CImage(CDevice& device, const VkPhysicalDeviceMemoryProperties& memoryProperties,
-	VkImageUsageFlags usage, VkFormat format, uint32 width, uint32 height, VkMemoryPropertyFlags properties)
+	VkImageUsageFlags usage, VkFormat format, uint32 width, uint32 height, VkMemoryPropertyFlags properties, uint32 mipLevelCount)
 : m_device(&device)
 , m_properties(properties)
 , m_format(format)
 , m_width(width)
 , m_height(height)
+, m_mipLevelCount(mipLevelCount)
 {
 	Create(memoryProperties, usage, format, width, height);
 }
 
+CImage::CImage(CMemoryAllocator& allocator, VkImageUsageFlags usage, VkFormat format, uint32 width, uint32 height,
+	VkMemoryPropertyFlags properties, uint32 mipLevelCount)
+: m_device(&allocator.GetDevice())
+, m_properties(properties)
+, m_allocator(&allocator)
+, m_format(format)
+, m_width(width)
+, m_height(height)
+, m_mipLevelCount(mipLevelCount)
+{
+	CreateHandle(usage, format, width, height);
+
+	VkMemoryRequirements memoryRequirements = {};
+	m_device->vkGetImageMemoryRequirements(*m_device, m_handle, &memoryRequirements);
+
+	//Images are created with optimal tiling
+	m_allocation = m_allocator->Allocate(memoryRequirements, m_properties, false);
+	m_memory = m_allocation.memory;
+
+	auto result = m_device->vkBindImageMemory(*m_device, m_handle, m_memory, m_allocation.offset);
+	CHECKVULKANERROR(result);
+}
+
 CImage::CImage(CImage&& rhs)
 {
 	MoveFrom(std::move(rhs));
@@ -44,11 +95,20 @@ void CImage::Reset()
 	if(m_memory != VK_NULL_HANDLE)
 	{
 		assert(m_device != nullptr);
-		m_device->vkFreeMemory(*m_device, m_memory, nullptr);
+		if(m_allocator)
+		{
+			m_allocator->Free(m_allocation);
+		}
+		else
+		{
+			m_device->vkFreeMemory(*m_device, m_memory, nullptr);
+		}
 		m_memory = VK_NULL_HANDLE;
 	}
 
 	m_device = nullptr;
+	m_allocator = nullptr;
+	m_allocation = MEMORY_ALLOCATION();
 }
 
 CImage& CImage::operator =(CImage&& rhs)
@@ -63,6 +123,31 @@ CImage::operator VkImage() const
 	return m_handle;
 }
 
+uint32 CImage::GetWidth() const
+{
+	return m_width;
+}
+
+uint32 CImage::GetHeight() const
+{
+	return m_height;
+}
+
+uint32 CImage::GetMipLevelCount() const
+{
+	return m_mipLevelCount;
+}
+
+uint32 CImage::GetFullMipLevelCount(uint32 width, uint32 height)
+{
+	uint32 levelCount = 1;
+	for(uint32 size = std::max(width, height); size > 1; size >>= 1)
+	{
+		levelCount++;
+	}
+	return levelCount;
+}
+
 uint32 CImage::GetLinearSize() const
 {
 	switch(m_format)
@@ -79,10 +164,15 @@ uint32 CImage::GetLinearSize() const
 	case VK_FORMAT_A1R5G5B5_UNORM_PACK16:
 		return m_width * m_height * sizeof(uint16);
 	case VK_FORMAT_R8_UNORM:
-	case VK_FORMAT_BC3_UNORM_BLOCK:
 		return m_width * m_height;
 	case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
-		return m_width * m_height / 2;
+	case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+	case VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK:
+		return GetBlockCount(m_width, m_height) * 8;
+	case VK_FORMAT_BC3_UNORM_BLOCK:
+	case VK_FORMAT_BC7_UNORM_BLOCK:
+	case VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK:
+		return GetBlockCount(m_width, m_height) * 16;
 	default:
 		assert(false);
 		return 0;
@@ -100,7 +190,7 @@ VkImageView CImage::CreateImageView()
 		VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_G, 
 		VK_COMPONENT_SWIZZLE_B, VK_COMPONENT_SWIZZLE_A 
 	};
-	imageViewCreateInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+	imageViewCreateInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, m_mipLevelCount, 0, 1 };
 
 	VkImageView imageView = VK_NULL_HANDLE;
 	auto result = m_device->vkCreateImageView(*m_device, &imageViewCreateInfo, nullptr, &imageView);
@@ -133,7 +223,7 @@ void CImage::SetLayout(VkQueue queue, CCommandBufferPool& commandBufferPool,
 		imageMemoryBarrier.dstAccessMask       = accessFlags;
 		imageMemoryBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
 		imageMemoryBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-		imageMemoryBarrier.subresourceRange    = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+		imageMemoryBarrier.subresourceRange    = { VK_IMAGE_ASPECT_COLOR_BIT, 0, m_mipLevelCount, 0, 1 };
 		
 		m_device->vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
 			0, 0, nullptr, 0, nullptr, 1, &imageMemoryBarrier);
@@ -145,6 +235,7 @@ void CImage::SetLayout(VkQueue queue, CCommandBufferPool& commandBufferPool,
 	
 	//Submit command buffer
 	{
+		FRAMEWORK_TRACE_SCOPE("Vulkan::QueueSubmit");
 		auto submitInfo = Framework::Vulkan::SubmitInfo();
 		submitInfo.commandBufferCount = 1;
 		submitInfo.pCommandBuffers    = &commandBuffer;
@@ -162,23 +253,25 @@ void CImage::SetLayout(VkQueue queue, CCommandBufferPool& commandBufferPool,
 CBuffer CImage::CreateFillStagingBuffer(const VkPhysicalDeviceMemoryProperties& memoryProperties, const void* imageData) const
 {
 	auto imageSize = GetLinearSize();
-	auto stagingBuffer = CBuffer(*m_device, memoryProperties,
-		VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, imageSize);
+	auto stagingBuffer = m_allocator ?
+		CBuffer(*m_allocator, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, imageSize) :
+		CBuffer(*m_device, memoryProperties, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, imageSize);
 
 	{
-		void* bufferPtr = nullptr;
-		auto result = m_device->vkMapMemory(*m_device, stagingBuffer.GetMemory(), 0, VK_WHOLE_SIZE, 0, &bufferPtr);
-		CHECKVULKANERROR(result);
-
+		void* bufferPtr = stagingBuffer.Map();
 		memcpy(bufferPtr, imageData, imageSize);
-
-		m_device->vkUnmapMemory(*m_device, stagingBuffer.GetMemory());
+		stagingBuffer.Unmap();
 	}
 
 	return stagingBuffer;
 }
 
 void CImage::RecordFill(VkCommandBuffer commandBuffer, const CBuffer& stagingBuffer)
+{
+	RecordCopyFromBuffer(commandBuffer, stagingBuffer, 0);
+}
+
+void CImage::RecordCopyFromBuffer(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize bufferOffset)
 {
 	//Transition image from whatever state to TRANSFER_DST_OPTIMAL
 	{
@@ -190,7 +283,7 @@ void CImage::RecordFill(VkCommandBuffer commandBuffer, const CBuffer& stagingBuf
 		imageMemoryBarrier.dstAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT;
 		imageMemoryBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
 		imageMemoryBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-		imageMemoryBarrier.subresourceRange    = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+		imageMemoryBarrier.subresourceRange    = { VK_IMAGE_ASPECT_COLOR_BIT, 0, m_mipLevelCount, 0, 1 };
 		
 		m_device->vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
 			0, 0, nullptr, 0, nullptr, 1, &imageMemoryBarrier);
@@ -199,17 +292,83 @@ void CImage::RecordFill(VkCommandBuffer commandBuffer, const CBuffer& stagingBuf
 	//CopyBufferToImage
 	{
 		VkBufferImageCopy bufferImageCopy = {};
-		bufferImageCopy.bufferRowLength    = m_width;
+		bufferImageCopy.bufferOffset       = bufferOffset;
+		//Row length needs to be a multiple of the block width for compressed formats
+		bufferImageCopy.bufferRowLength    = IsBlockCompressedFormat(m_format) ? ((m_width + 3) & ~3) : m_width;
 		bufferImageCopy.imageSubresource   = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
 		bufferImageCopy.imageExtent.width  = m_width;
 		bufferImageCopy.imageExtent.height = m_height;
 		bufferImageCopy.imageExtent.depth  = 1;
 		
-		m_device->vkCmdCopyBufferToImage(commandBuffer, stagingBuffer, m_handle, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		m_device->vkCmdCopyBufferToImage(commandBuffer, buffer, m_handle, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
 			1, &bufferImageCopy);
 	}
 }
 
+void CImage::RecordGenerateMipmaps(VkCommandBuffer commandBuffer, VkImageLayout layout, VkAccessFlags accessFlags, VkPipelineStageFlags stageFlags)
+{
+	//Compressed formats can't be blitted to
+	assert(!IsBlockCompressedFormat(m_format));
+
+	auto imageMemoryBarrier = Framework::Vulkan::ImageMemoryBarrier();
+	imageMemoryBarrier.image               = m_handle;
+	imageMemoryBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	imageMemoryBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+
+	for(uint32 level = 1; level < m_mipLevelCount; level++)
+	{
+		//Previous level was written by the copy or the last blit
+		imageMemoryBarrier.oldLayout        = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		imageMemoryBarrier.newLayout        = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		imageMemoryBarrier.srcAccessMask    = VK_ACCESS_TRANSFER_WRITE_BIT;
+		imageMemoryBarrier.dstAccessMask    = VK_ACCESS_TRANSFER_READ_BIT;
+		imageMemoryBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, level - 1, 1, 0, 1 };
+
+		m_device->vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+			0, 0, nullptr, 0, nullptr, 1, &imageMemoryBarrier);
+
+		VkImageBlit imageBlit = {};
+		imageBlit.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level - 1, 0, 1 };
+		imageBlit.srcOffsets[1]  = { static_cast<int32>(std::max(m_width >> (level - 1), 1U)), static_cast<int32>(std::max(m_height >> (level - 1), 1U)), 1 };
+		imageBlit.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1 };
+		imageBlit.dstOffsets[1]  = { static_cast<int32>(std::max(m_width >> level, 1U)), static_cast<int32>(std::max(m_height >> level, 1U)), 1 };
+
+		m_device->vkCmdBlitImage(commandBuffer, m_handle, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, m_handle, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			1, &imageBlit, VK_FILTER_LINEAR);
+
+		//Previous level is done with
+		imageMemoryBarrier.oldLayout        = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		imageMemoryBarrier.newLayout        = layout;
+		imageMemoryBarrier.srcAccessMask    = VK_ACCESS_TRANSFER_READ_BIT;
+		imageMemoryBarrier.dstAccessMask    = accessFlags;
+
+		m_device->vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, stageFlags,
+			0, 0, nullptr, 0, nullptr, 1, &imageMemoryBarrier);
+	}
+
+	//Last level was only written to
+	imageMemoryBarrier.oldLayout        = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	imageMemoryBarrier.newLayout        = layout;
+	imageMemoryBarrier.srcAccessMask    = VK_ACCESS_TRANSFER_WRITE_BIT;
+	imageMemoryBarrier.dstAccessMask    = accessFlags;
+	imageMemoryBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, m_mipLevelCount - 1, 1, 0, 1 };
+
+	m_device->vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, stageFlags,
+		0, 0, nullptr, 0, nullptr, 1, &imageMemoryBarrier);
+}
+
+void CImage::RecordBlit(VkCommandBuffer commandBuffer, CImage& dstImage, VkFilter filter) const
+{
+	VkImageBlit imageBlit = {};
+	imageBlit.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+	imageBlit.srcOffsets[1]  = { static_cast<int32>(m_width), static_cast<int32>(m_height), 1 };
+	imageBlit.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+	imageBlit.dstOffsets[1]  = { static_cast<int32>(dstImage.m_width), static_cast<int32>(dstImage.m_height), 1 };
+
+	m_device->vkCmdBlitImage(commandBuffer, m_handle, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		1, &imageBlit, filter);
+}
+
 void CImage::Clear(VkQueue queue, CCommandBufferPool& commandBufferPool,
                    const VkClearColorValue& clearColor)
 {
@@ -235,13 +394,13 @@ void CImage::Clear(VkQueue queue, CCommandBufferPool& commandBufferPool,
 		imageMemoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
 		imageMemoryBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
 		imageMemoryBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-		imageMemoryBarrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+		imageMemoryBarrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, m_mipLevelCount, 0, 1};
 
 		m_device->vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
 		                               0, 0, nullptr, 0, nullptr, 1, &imageMemoryBarrier);
 	}
 
-	VkImageSubresourceRange range = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+	VkImageSubresourceRange range = {VK_IMAGE_ASPECT_COLOR_BIT, 0, m_mipLevelCount, 0, 1};
 	m_device->vkCmdClearColorImage(commandBuffer, m_handle, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
 	                               &clearColor, 1, &range);
 
@@ -251,6 +410,7 @@ void CImage::Clear(VkQueue queue, CCommandBufferPool& commandBufferPool,
 
 	//Submit command buffer
 	{
+		FRAMEWORK_TRACE_SCOPE("Vulkan::QueueSubmit");
 		auto submitInfo = Framework::Vulkan::SubmitInfo();
 		submitInfo.commandBufferCount = 1;
 		submitInfo.pCommandBuffers = &commandBuffer;
@@ -291,6 +451,7 @@ void CImage::Fill(VkQueue queue, CCommandBufferPool& commandBufferPool,
 	
 	//Submit command buffer
 	{
+		FRAMEWORK_TRACE_SCOPE("Vulkan::QueueSubmit");
 		auto submitInfo = Framework::Vulkan::SubmitInfo();
 		submitInfo.commandBufferCount = 1;
 		submitInfo.pCommandBuffers    = &commandBuffer;
@@ -309,24 +470,7 @@ void CImage::Fill(VkQueue queue, CCommandBufferPool& commandBufferPool,
 void CImage::Create(const VkPhysicalDeviceMemoryProperties& memoryProperties,
 	VkImageUsageFlags usage, VkFormat format, uint32 width, uint32 height)
 {
-	{
-		auto imageCreateInfo = Framework::Vulkan::ImageCreateInfo();
-		imageCreateInfo.imageType     = VK_IMAGE_TYPE_2D;
-		imageCreateInfo.format        = format;
-		imageCreateInfo.extent.width  = width;
-		imageCreateInfo.extent.height = height;
-		imageCreateInfo.extent.depth  = 1;
-		imageCreateInfo.mipLevels     = 1;
-		imageCreateInfo.arrayLayers   = 1;
-		imageCreateInfo.samples       = VK_SAMPLE_COUNT_1_BIT;
-		imageCreateInfo.sharingMode   = VK_SHARING_MODE_EXCLUSIVE;
-		imageCreateInfo.tiling        = VK_IMAGE_TILING_OPTIMAL;
-		imageCreateInfo.usage         = usage;
-		imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-
-		auto result = m_device->vkCreateImage(*m_device, &imageCreateInfo, nullptr, &m_handle);
-		CHECKVULKANERROR(result);
-	}
+	CreateHandle(usage, format, width, height);
 
 	{
 		VkMemoryRequirements memoryRequirements = {};
@@ -345,12 +489,36 @@ void CImage::Create(const VkPhysicalDeviceMemoryProperties& memoryProperties,
 	m_device->vkBindImageMemory(*m_device, m_handle, m_memory, 0);
 }
 
+void CImage::CreateHandle(VkImageUsageFlags usage, VkFormat format, uint32 width, uint32 height)
+{
+	auto imageCreateInfo = Framework::Vulkan::ImageCreateInfo();
+	imageCreateInfo.imageType     = VK_IMAGE_TYPE_2D;
+	imageCreateInfo.format        = format;
+	imageCreateInfo.extent.width  = width;
+	imageCreateInfo.extent.height = height;
+	imageCreateInfo.extent.depth  = 1;
+	imageCreateInfo.mipLevels     = m_mipLevelCount;
+	imageCreateInfo.arrayLayers   = 1;
+	imageCreateInfo.samples       = VK_SAMPLE_COUNT_1_BIT;
+	imageCreateInfo.sharingMode   = VK_SHARING_MODE_EXCLUSIVE;
+	imageCreateInfo.tiling        = VK_IMAGE_TILING_OPTIMAL;
+	imageCreateInfo.usage         = usage;
+	imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	auto result = m_device->vkCreateImage(*m_device, &imageCreateInfo, nullptr, &m_handle);
+	CHECKVULKANERROR(result);
+}
+
 void CImage::MoveFrom(CImage&& rhs)
 {
 	std::swap(m_device, rhs.m_device);
 	std::swap(m_handle, rhs.m_handle);
 	std::swap(m_memory, rhs.m_memory);
+	std::swap(m_properties, rhs.m_properties);
+	std::swap(m_allocator, rhs.m_allocator);
+	std::swap(m_allocation, rhs.m_allocation);
 	std::swap(m_format, rhs.m_format);
 	std::swap(m_width, rhs.m_width);
 	std::swap(m_height, rhs.m_height);
+	std::swap(m_mipLevelCount, rhs.m_mipLevelCount);
 }
@@ -0,0 +1,46 @@
+#include <stdexcept>
+#include "vulkan/ImageUploadSink.h"
+
+using namespace Framework::Vulkan;
+
+CImageUploadSink::CImageUploadSink(CStagingUploader& uploader, CImage& image, VkImageLayout layout, VkAccessFlags accessFlags)
+: m_uploader(uploader)
+, m_image(image)
+, m_layout(layout)
+, m_accessFlags(accessFlags)
+{
+
+}
+
+CImageUploadSink::~CImageUploadSink()
+{
+	if(m_staged)
+	{
+		m_uploader.CancelStagedImage();
+	}
+}
+
+Framework::CBitmapView CImageUploadSink::BeginImage(unsigned int width, unsigned int height, unsigned int bpp)
+{
+	assert(!m_staged);
+	unsigned int pitch = ((width * bpp) + 7) / 8;
+	if((width != m_image.GetWidth()) || (height != m_image.GetHeight()) || ((pitch * height) != m_image.GetLinearSize()))
+	{
+		throw std::runtime_error("Image doesn't match decoded bitmap.");
+	}
+	auto stagingData = m_uploader.StageImage(m_image);
+	m_staged = true;
+	return CBitmapView(stagingData, width, height, bpp, pitch);
+}
+
+void CImageUploadSink::EndImage()
+{
+	assert(m_staged);
+	m_staged = false;
+	m_ticket = m_uploader.UploadStagedImage(m_image, m_layout, m_accessFlags);
+}
+
+CStagingUploader::UploadTicket CImageUploadSink::GetTicket() const
+{
+	return m_ticket;
+}
@@ -1,23 +1,25 @@
 #include "vulkan/VulkanDef.h"
 #include <stdexcept>
 #include "vulkan/Instance.h"
+#include "vulkan/AllocationCallbacks.h"
 #include "vulkan/Loader.h"
+#include "StartupProfiler.h"
 
-#define SET_PROC_ADDR(functionName) this->functionName = reinterpret_cast<PFN_##functionName>(CLoader::GetInstance().vkGetInstanceProcAddr(m_handle, #functionName));
+#define SET_PROC_ADDR(functionName) this->functionName.Bind(*m_procResolver, loading);
 
 using namespace Framework::Vulkan;
 
-CInstance::CInstance(VkInstance handle)
+CInstance::CInstance(VkInstance handle, PROC_LOADING loading)
 	: m_handle(handle)
 {
-	GetProcAddrs();
+	GetProcAddrs(loading);
 }
 
-CInstance::CInstance(const VkInstanceCreateInfo& instanceCreateInfo)
+CInstance::CInstance(const VkInstanceCreateInfo& instanceCreateInfo, PROC_LOADING loading)
 	: m_ownsHandle(true)
 {
 	Create(instanceCreateInfo);
-	GetProcAddrs();
+	GetProcAddrs(loading);
 }
 
 CInstance::~CInstance()
@@ -34,11 +36,12 @@ void CInstance::Reset()
 {
 	if(m_ownsHandle && m_handle != VK_NULL_HANDLE)
 	{
-		this->vkDestroyInstance(m_handle, nullptr);
+		this->vkDestroyInstance(m_handle, m_allocationCallbacks);
 		m_handle = VK_NULL_HANDLE;
+		m_allocationCallbacks = nullptr;
 	}
 	
-	vkDestroyDevice = nullptr;
+	vkDestroyInstance = nullptr;
 	
 	vkCreateDevice = nullptr;
 	vkDestroyDevice = nullptr;
@@ -77,6 +80,8 @@ void CInstance::Reset()
 #if defined(VK_USE_PLATFORM_IOS_MVK)
 	vkCreateIOSSurfaceMVK = nullptr;
 #endif
+	
+	m_procResolver.reset();
 }
 
 CInstance& CInstance::operator =(CInstance&& rhs)
@@ -85,6 +90,8 @@ CInstance& CInstance::operator =(CInstance&& rhs)
 	
 	std::swap(m_handle, rhs.m_handle);
 	std::swap(m_ownsHandle, rhs.m_ownsHandle);
+	std::swap(m_allocationCallbacks, rhs.m_allocationCallbacks);
+	std::swap(m_procResolver, rhs.m_procResolver);
 	
 	std::swap(vkDestroyInstance, rhs.vkDestroyInstance);
 	
@@ -134,19 +141,36 @@ CInstance::operator VkInstance() const
 	return m_handle;
 }
 
+void CInstance::ResolveProcAddrs()
+{
+	FRAMEWORK_STARTUP_PHASE("Vulkan::Instance::ResolveProcAddrs");
+	assert(m_procResolver);
+	GetProcAddrs(PROC_LOADING_EAGER);
+}
+
 void CInstance::Create(const VkInstanceCreateInfo& instanceCreateInfo)
 {
+	FRAMEWORK_STARTUP_PHASE("Vulkan::Instance::Create");
 	assert(m_handle == VK_NULL_HANDLE);
 	
-	auto result = CLoader::GetInstance().vkCreateInstance(&instanceCreateInfo, nullptr, &m_handle);
+	m_allocationCallbacks = GetTrackedAllocationCallbacks();
+	auto result = CLoader::GetInstance().vkCreateInstance(&instanceCreateInfo, m_allocationCallbacks, &m_handle);
 	if(result != VK_SUCCESS)
 	{
 		throw std::runtime_error("Failed to create Vulkan instance.");
 	}
 }
 
-void CInstance::GetProcAddrs()
+void CInstance::GetProcAddrs(PROC_LOADING loading)
 {
+	if(!m_procResolver)
+	{
+		m_procResolver = std::make_unique<ProcResolver>(
+		    [getInstanceProcAddr = CLoader::GetInstance().vkGetInstanceProcAddr, instance = m_handle](const char* name) {
+			    return getInstanceProcAddr(instance, name);
+		    });
+	}
+	
 	SET_PROC_ADDR(vkDestroyInstance);
 	
 	SET_PROC_ADDR(vkCreateDevice);
@@ -11,6 +11,7 @@
 #include <algorithm>
 #include "vulkan/Loader.h"
 #include "string_format.h"
+#include "StartupProfiler.h"
 
 using namespace Framework::Vulkan;
 
@@ -19,6 +20,11 @@ CLoader::CLoader()
 	LoadLibrary();
 }
 
+std::future<void> CLoader::LoadInBackground()
+{
+	return std::async(std::launch::async, [] () { GetInstance(); });
+}
+
 void* CLoader::GetLibraryProcAddr(const char* procName)
 {
 #ifdef _WIN32
@@ -60,6 +66,7 @@ bool CLoader::IsInstanceExtensionPresent(const char* extensionName)
 
 void CLoader::LoadLibrary()
 {
+	FRAMEWORK_STARTUP_PHASE("Vulkan::Loader::LoadLibrary");
 #ifdef _WIN32
 	assert(m_vulkanModule == NULL);
 
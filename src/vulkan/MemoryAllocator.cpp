@@ -0,0 +1,355 @@
+#include <algorithm>
+#include <cassert>
+#include <set>
+#include <unordered_map>
+#include "vulkan/MemoryAllocator.h"
+#include "maybe_unused.h"
+#include "vulkan/StructDefs.h"
+#include "vulkan/Utils.h"
+
+using namespace Framework::Vulkan;
+
+namespace
+{
+	class CRangeAllocator
+	{
+	public:
+		virtual ~CRangeAllocator() = default;
+
+		//Returns false if there is no room for the range, alignment needs to be a power of two
+		virtual bool Allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset, VkDeviceSize& allocatedSize) = 0;
+		virtual void Free(VkDeviceSize offset) = 0;
+	};
+
+	class CBuddyRangeAllocator : public CRangeAllocator
+	{
+	public:
+		enum : VkDeviceSize
+		{
+			MIN_NODE_SIZE = 256,
+		};
+
+		CBuddyRangeAllocator(VkDeviceSize size)
+		    : m_size(size)
+		{
+			assert((size & (size - 1)) == 0);
+			assert(size >= MIN_NODE_SIZE);
+			uint32 levelCount = 1;
+			for(VkDeviceSize nodeSize = size; nodeSize > MIN_NODE_SIZE; nodeSize >>= 1)
+			{
+				levelCount++;
+			}
+			//Level 0 is the whole range, each level below has nodes half as big
+			m_freeNodes.resize(levelCount);
+			m_freeNodes[0].insert(0);
+		}
+
+		bool Allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset, VkDeviceSize& allocatedSize) override
+		{
+			//Nodes are aligned on their size
+			VkDeviceSize nodeSize = std::max<VkDeviceSize>(std::max(size, alignment), MIN_NODE_SIZE);
+			if(nodeSize > m_size) return false;
+			uint32 level = static_cast<uint32>(m_freeNodes.size() - 1);
+			VkDeviceSize levelNodeSize = MIN_NODE_SIZE;
+			while(levelNodeSize < nodeSize)
+			{
+				levelNodeSize <<= 1;
+				level--;
+			}
+
+			//Find the smallest free node that is big enough and split it down to the needed size
+			int32 freeLevel = static_cast<int32>(level);
+			while((freeLevel >= 0) && m_freeNodes[freeLevel].empty())
+			{
+				freeLevel--;
+			}
+			if(freeLevel < 0) return false;
+
+			auto freeNodeIterator = m_freeNodes[freeLevel].begin();
+			VkDeviceSize nodeOffset = *freeNodeIterator;
+			m_freeNodes[freeLevel].erase(freeNodeIterator);
+			for(uint32 splitLevel = freeLevel + 1; splitLevel <= level; splitLevel++)
+			{
+				//Keep the first half, the second half becomes free
+				m_freeNodes[splitLevel].insert(nodeOffset + GetNodeSize(splitLevel));
+			}
+
+			m_allocatedNodes.insert(std::make_pair(nodeOffset, level));
+			offset = nodeOffset;
+			allocatedSize = levelNodeSize;
+			return true;
+		}
+
+		void Free(VkDeviceSize offset) override
+		{
+			auto allocatedNodeIterator = m_allocatedNodes.find(offset);
+			assert(allocatedNodeIterator != std::end(m_allocatedNodes));
+			uint32 level = allocatedNodeIterator->second;
+			m_allocatedNodes.erase(allocatedNodeIterator);
+
+			//Merge with the buddy as long as it's free
+			while(level != 0)
+			{
+				VkDeviceSize buddyOffset = offset ^ GetNodeSize(level);
+				auto& levelFreeNodes = m_freeNodes[level];
+				auto buddyIterator = levelFreeNodes.find(buddyOffset);
+				if(buddyIterator == std::end(levelFreeNodes)) break;
+				levelFreeNodes.erase(buddyIterator);
+				offset = std::min(offset, buddyOffset);
+				level--;
+			}
+			m_freeNodes[level].insert(offset);
+		}
+
+	private:
+		VkDeviceSize GetNodeSize(uint32 level) const
+		{
+			return m_size >> level;
+		}
+
+		VkDeviceSize m_size = 0;
+		//Ordered to hand out the lowest offsets first and keep the end of the range free
+		std::vector<std::set<VkDeviceSize>> m_freeNodes;
+		std::unordered_map<VkDeviceSize, uint32> m_allocatedNodes;
+	};
+
+	class CLinearRangeAllocator : public CRangeAllocator
+	{
+	public:
+		CLinearRangeAllocator(VkDeviceSize size)
+		    : m_size(size)
+		{
+		}
+
+		bool Allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset, VkDeviceSize& allocatedSize) override
+		{
+			VkDeviceSize alignedOffset = (m_offset + alignment - 1) & ~(alignment - 1);
+			if((alignedOffset + size) > m_size) return false;
+			offset = alignedOffset;
+			//Padding is accounted to the allocation
+			allocatedSize = (alignedOffset + size) - m_offset;
+			m_offset = alignedOffset + size;
+			m_allocationCount++;
+			return true;
+		}
+
+		void Free(VkDeviceSize) override
+		{
+			assert(m_allocationCount != 0);
+			m_allocationCount--;
+			if(m_allocationCount == 0)
+			{
+				m_offset = 0;
+			}
+		}
+
+	private:
+		VkDeviceSize m_size = 0;
+		VkDeviceSize m_offset = 0;
+		uint32 m_allocationCount = 0;
+	};
+}
+
+struct CMemoryAllocator::BLOCK
+{
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	VkDeviceSize size = 0;
+	void* mappedData = nullptr;
+	std::unique_ptr<CRangeAllocator> ranges;
+	uint32 allocationCount = 0;
+	VkDeviceSize allocatedSize = 0;
+	//Sizes are needed to update the stats when allocations are freed
+	std::unordered_map<VkDeviceSize, VkDeviceSize> allocationSizes;
+};
+
+CMemoryAllocator::CMemoryAllocator(CDevice& device, const VkPhysicalDeviceMemoryProperties& memoryProperties, STRATEGY strategy, VkDeviceSize blockSize)
+: m_device(device)
+, m_memoryProperties(memoryProperties)
+, m_strategy(strategy)
+{
+	//Buddy allocator needs a power of two
+	m_blockSize = CBuddyRangeAllocator::MIN_NODE_SIZE;
+	while(m_blockSize < blockSize)
+	{
+		m_blockSize <<= 1;
+	}
+	m_blocks.resize(m_memoryProperties.memoryTypeCount * 2);
+}
+
+CMemoryAllocator::~CMemoryAllocator()
+{
+	assert(m_dedicatedAllocationCount == 0);
+	for(auto& blocks : m_blocks)
+	{
+		for(auto& block : blocks)
+		{
+			assert(block->allocationCount == 0);
+			FreeDeviceMemory(block->memory);
+		}
+	}
+}
+
+MEMORY_ALLOCATION CMemoryAllocator::Allocate(const VkMemoryRequirements& memoryRequirements, VkMemoryPropertyFlags properties, bool linearResource)
+{
+	uint32 memoryTypeIndex = GetMemoryTypeIndex(m_memoryProperties, memoryRequirements.memoryTypeBits, properties);
+	assert(memoryTypeIndex != VULKAN_MEMORY_TYPE_INVALID);
+
+	MEMORY_ALLOCATION allocation;
+	allocation.size = memoryRequirements.size;
+
+	if(memoryRequirements.size > (m_blockSize / 2))
+	{
+		allocation.memory = AllocateDeviceMemory(memoryTypeIndex, memoryRequirements.size, &allocation.mappedData);
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_dedicatedAllocationCount++;
+		m_dedicatedAllocationSize += memoryRequirements.size;
+		return allocation;
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto& blocks = GetBlocks(memoryTypeIndex, linearResource);
+	VkDeviceSize alignment = std::max<VkDeviceSize>(memoryRequirements.alignment, 1);
+	VkDeviceSize allocatedSize = 0;
+	BLOCK* allocationBlock = nullptr;
+	for(auto& block : blocks)
+	{
+		if(block->ranges->Allocate(memoryRequirements.size, alignment, allocation.offset, allocatedSize))
+		{
+			allocationBlock = block.get();
+			break;
+		}
+	}
+
+	if(!allocationBlock)
+	{
+		auto block = std::make_unique<BLOCK>();
+		block->size = m_blockSize;
+		block->memory = AllocateDeviceMemory(memoryTypeIndex, m_blockSize, &block->mappedData);
+		switch(m_strategy)
+		{
+		case STRATEGY::BUDDY:
+			block->ranges = std::make_unique<CBuddyRangeAllocator>(m_blockSize);
+			break;
+		case STRATEGY::LINEAR:
+			block->ranges = std::make_unique<CLinearRangeAllocator>(m_blockSize);
+			break;
+		}
+		FRAMEWORK_MAYBE_UNUSED bool allocated = block->ranges->Allocate(memoryRequirements.size, alignment, allocation.offset, allocatedSize);
+		assert(allocated);
+		allocationBlock = block.get();
+		blocks.push_back(std::move(block));
+	}
+
+	allocationBlock->allocationCount++;
+	allocationBlock->allocatedSize += allocatedSize;
+	allocationBlock->allocationSizes[allocation.offset] = allocatedSize;
+
+	allocation.memory = allocationBlock->memory;
+	allocation.block = allocationBlock;
+	if(allocationBlock->mappedData)
+	{
+		allocation.mappedData = reinterpret_cast<uint8*>(allocationBlock->mappedData) + allocation.offset;
+	}
+	return allocation;
+}
+
+void CMemoryAllocator::Free(const MEMORY_ALLOCATION& allocation)
+{
+	if(!allocation.block)
+	{
+		FreeDeviceMemory(allocation.memory);
+		std::lock_guard<std::mutex> lock(m_mutex);
+		assert(m_dedicatedAllocationCount != 0);
+		m_dedicatedAllocationCount--;
+		m_dedicatedAllocationSize -= allocation.size;
+		return;
+	}
+
+	//Empty blocks are kept to be reused, Trim releases them
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto block = reinterpret_cast<BLOCK*>(allocation.block);
+	auto allocationSizeIterator = block->allocationSizes.find(allocation.offset);
+	assert(allocationSizeIterator != std::end(block->allocationSizes));
+	block->ranges->Free(allocation.offset);
+	block->allocatedSize -= allocationSizeIterator->second;
+	block->allocationSizes.erase(allocationSizeIterator);
+	assert(block->allocationCount != 0);
+	block->allocationCount--;
+}
+
+void CMemoryAllocator::Trim()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for(auto& blocks : m_blocks)
+	{
+		auto emptyBlocksBegin = std::stable_partition(blocks.begin(), blocks.end(),
+			[](const BlockPtr& block) { return block->allocationCount != 0; });
+		for(auto blockIterator = emptyBlocksBegin; blockIterator != blocks.end(); blockIterator++)
+		{
+			FreeDeviceMemory((*blockIterator)->memory);
+		}
+		blocks.erase(emptyBlocksBegin, blocks.end());
+	}
+}
+
+CMemoryAllocator::STATS CMemoryAllocator::GetStats()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	STATS stats;
+	stats.dedicatedAllocationCount = m_dedicatedAllocationCount;
+	stats.allocationCount = m_dedicatedAllocationCount;
+	stats.reservedSize = m_dedicatedAllocationSize;
+	stats.allocatedSize = m_dedicatedAllocationSize;
+	for(const auto& blocks : m_blocks)
+	{
+		for(const auto& block : blocks)
+		{
+			stats.blockCount++;
+			stats.allocationCount += block->allocationCount;
+			stats.reservedSize += block->size;
+			stats.allocatedSize += block->allocatedSize;
+		}
+	}
+	return stats;
+}
+
+CDevice& CMemoryAllocator::GetDevice() const
+{
+	return m_device;
+}
+
+const VkPhysicalDeviceMemoryProperties& CMemoryAllocator::GetMemoryProperties() const
+{
+	return m_memoryProperties;
+}
+
+CMemoryAllocator::BlockArray& CMemoryAllocator::GetBlocks(uint32 memoryTypeIndex, bool linearResource)
+{
+	return m_blocks[(memoryTypeIndex * 2) + (linearResource ? 1 : 0)];
+}
+
+VkDeviceMemory CMemoryAllocator::AllocateDeviceMemory(uint32 memoryTypeIndex, VkDeviceSize size, void** mappedData)
+{
+	auto memoryAllocateInfo = Framework::Vulkan::MemoryAllocateInfo();
+	memoryAllocateInfo.allocationSize = size;
+	memoryAllocateInfo.memoryTypeIndex = memoryTypeIndex;
+
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	auto result = m_device.vkAllocateMemory(m_device, &memoryAllocateInfo, nullptr, &memory);
+	CHECKVULKANERROR(result);
+
+	(*mappedData) = nullptr;
+	if(m_memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+	{
+		result = m_device.vkMapMemory(m_device, memory, 0, VK_WHOLE_SIZE, 0, mappedData);
+		CHECKVULKANERROR(result);
+	}
+
+	return memory;
+}
+
+void CMemoryAllocator::FreeDeviceMemory(VkDeviceMemory memory)
+{
+	//Memory is implicitly unmapped when freed
+	m_device.vkFreeMemory(m_device, memory, nullptr);
+}
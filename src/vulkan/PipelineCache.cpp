@@ -0,0 +1,180 @@
+#include <cstring>
+#include "vulkan/PipelineCache.h"
+#include "vulkan/StructDefs.h"
+#include "HashUtils.h"
+#include "StdStreamUtils.h"
+#include "ThreadPool.h"
+
+using namespace Framework::Vulkan;
+
+CPipelineCache::CPipelineCache(CDevice& device, const VkPhysicalDeviceProperties& physicalDeviceProperties)
+: m_device(device)
+, m_physicalDeviceProperties(physicalDeviceProperties)
+{
+	m_handle = CreateCache(nullptr, 0);
+}
+
+CPipelineCache::~CPipelineCache()
+{
+	DestroyThreadCaches();
+	m_device.vkDestroyPipelineCache(m_device, m_handle, nullptr);
+}
+
+bool CPipelineCache::Load(const fs::path& path)
+{
+	std::vector<uint8> data;
+	try
+	{
+		auto stream = Framework::CreateInputStdStream(path.native());
+		HEADER header = {};
+		if(stream.Read(&header, sizeof(HEADER)) != sizeof(HEADER))
+		{
+			return false;
+		}
+		auto expectedHeader = MakeHeader();
+		bool headerMatches =
+			(header.magic == expectedHeader.magic) &&
+			(header.version == expectedHeader.version) &&
+			(header.vendorId == expectedHeader.vendorId) &&
+			(header.deviceId == expectedHeader.deviceId) &&
+			(header.driverVersion == expectedHeader.driverVersion) &&
+			!memcmp(header.pipelineCacheUuid, expectedHeader.pipelineCacheUuid, VK_UUID_SIZE);
+		if(!headerMatches)
+		{
+			return false;
+		}
+		data.resize(header.dataSize);
+		if(stream.Read(data.data(), data.size()) != data.size())
+		{
+			return false;
+		}
+		//Drivers don't all validate the blob, a corrupted one could crash them
+		if(Framework::HashUtils::ComputeXxh3_64(data.data(), data.size()) != header.dataHash)
+		{
+			return false;
+		}
+	}
+	catch(...)
+	{
+		return false;
+	}
+
+	DestroyThreadCaches();
+	m_device.vkDestroyPipelineCache(m_device, m_handle, nullptr);
+	m_handle = CreateCache(data.data(), data.size());
+	return true;
+}
+
+void CPipelineCache::Save(const fs::path& path)
+{
+	MergeThreadCaches();
+
+	auto result = VK_SUCCESS;
+	size_t dataSize = 0;
+	result = m_device.vkGetPipelineCacheData(m_device, m_handle, &dataSize, nullptr);
+	CHECKVULKANERROR(result);
+
+	std::vector<uint8> data(dataSize);
+	result = m_device.vkGetPipelineCacheData(m_device, m_handle, &dataSize, data.data());
+	CHECKVULKANERROR(result);
+	data.resize(dataSize);
+
+	auto header = MakeHeader();
+	header.dataSize = data.size();
+	header.dataHash = Framework::HashUtils::ComputeXxh3_64(data.data(), data.size());
+
+	auto tempPath = path;
+	tempPath += ".tmp";
+	{
+		auto stream = Framework::CreateOutputStdStream(tempPath.native());
+		stream.Write(&header, sizeof(HEADER));
+		stream.Write(data.data(), data.size());
+	}
+	fs::rename(tempPath, path);
+}
+
+VkPipelineCache CPipelineCache::GetThreadCache()
+{
+	std::lock_guard<std::mutex> lock(m_threadCachesMutex);
+	auto& threadCache = m_threadCaches[std::this_thread::get_id()];
+	if(threadCache == VK_NULL_HANDLE)
+	{
+		threadCache = CreateCache(nullptr, 0);
+	}
+	return threadCache;
+}
+
+void CPipelineCache::MergeThreadCaches()
+{
+	std::vector<VkPipelineCache> threadCaches;
+	{
+		std::lock_guard<std::mutex> lock(m_threadCachesMutex);
+		threadCaches.reserve(m_threadCaches.size());
+		for(const auto& threadCachePair : m_threadCaches)
+		{
+			threadCaches.push_back(threadCachePair.second);
+		}
+	}
+	if(threadCaches.empty())
+	{
+		return;
+	}
+
+	//Source caches can still be used by their threads while being merged
+	auto result = m_device.vkMergePipelineCaches(m_device, m_handle, static_cast<uint32>(threadCaches.size()), threadCaches.data());
+	CHECKVULKANERROR(result);
+}
+
+CPipelineCache::PipelineFuture CPipelineCache::CompileAsync(CThreadPool& threadPool, PipelineBuilder builder)
+{
+	return threadPool.Submit(
+		[this, builder = std::move(builder)] ()
+		{
+			return builder(GetThreadCache());
+		}).share();
+}
+
+bool CPipelineCache::IsReady(const PipelineFuture& future)
+{
+	return future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+CPipelineCache::operator VkPipelineCache() const
+{
+	return m_handle;
+}
+
+VkPipelineCache CPipelineCache::CreateCache(const void* initialData, size_t initialDataSize)
+{
+	auto pipelineCacheCreateInfo = Framework::Vulkan::PipelineCacheCreateInfo();
+	pipelineCacheCreateInfo.initialDataSize = initialDataSize;
+	pipelineCacheCreateInfo.pInitialData    = initialData;
+
+	VkPipelineCache pipelineCache = VK_NULL_HANDLE;
+	auto result = m_device.vkCreatePipelineCache(m_device, &pipelineCacheCreateInfo, nullptr, &pipelineCache);
+	CHECKVULKANERROR(result);
+
+	return pipelineCache;
+}
+
+CPipelineCache::HEADER CPipelineCache::MakeHeader() const
+{
+	HEADER header = {};
+	header.magic         = HEADER_MAGIC;
+	header.version       = HEADER_VERSION;
+	header.vendorId      = m_physicalDeviceProperties.vendorID;
+	header.deviceId      = m_physicalDeviceProperties.deviceID;
+	header.driverVersion = m_physicalDeviceProperties.driverVersion;
+	memcpy(header.pipelineCacheUuid, m_physicalDeviceProperties.pipelineCacheUUID, VK_UUID_SIZE);
+	return header;
+}
+
+void CPipelineCache::DestroyThreadCaches()
+{
+	std::lock_guard<std::mutex> lock(m_threadCachesMutex);
+	for(const auto& threadCachePair : m_threadCaches)
+	{
+		m_device.vkDestroyPipelineCache(m_device, threadCachePair.second, nullptr);
+	}
+	m_threadCaches.clear();
+}
@@ -0,0 +1,308 @@
+#include <cassert>
+#include "vulkan/QueueManager.h"
+#include "vulkan/StructDefs.h"
+#include "Trace.h"
+
+using namespace Framework::Vulkan;
+
+CQueueManager::QUEUE_FAMILIES CQueueManager::FindQueueFamilies(const CInstance& instance, VkPhysicalDevice physicalDevice)
+{
+	uint32 familyCount = 0;
+	instance.vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, nullptr);
+
+	std::vector<VkQueueFamilyProperties> familiesProperties(familyCount);
+	instance.vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, familiesProperties.data());
+
+	static const uint32 invalidFamily = ~0U;
+	uint32 graphicsFamily = invalidFamily;
+	uint32 computeFamily = invalidFamily;
+	uint32 transferFamily = invalidFamily;
+
+	for(uint32 familyIndex = 0; familyIndex < familyCount; familyIndex++)
+	{
+		const auto& properties = familiesProperties[familyIndex];
+		if(properties.queueCount == 0) continue;
+		bool hasGraphics = (properties.queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0;
+		bool hasCompute = (properties.queueFlags & VK_QUEUE_COMPUTE_BIT) != 0;
+		//Graphics and compute queues can always do transfers, even if they don't report it
+		bool hasTransfer = hasGraphics || hasCompute || ((properties.queueFlags & VK_QUEUE_TRANSFER_BIT) != 0);
+		if(hasGraphics && (graphicsFamily == invalidFamily))
+		{
+			graphicsFamily = familyIndex;
+		}
+		if(hasCompute && !hasGraphics && (computeFamily == invalidFamily))
+		{
+			computeFamily = familyIndex;
+		}
+		if(hasTransfer && !hasGraphics && !hasCompute && (transferFamily == invalidFamily))
+		{
+			transferFamily = familyIndex;
+		}
+	}
+
+	assert(graphicsFamily != invalidFamily);
+
+	QUEUE_FAMILIES families;
+	families.familyIndices[QUEUE_TYPE_GRAPHICS] = graphicsFamily;
+	families.familyIndices[QUEUE_TYPE_COMPUTE] = (computeFamily != invalidFamily) ? computeFamily : graphicsFamily;
+	//Async compute queues still let transfers overlap with graphics
+	families.familyIndices[QUEUE_TYPE_TRANSFER] = (transferFamily != invalidFamily) ? transferFamily : families.familyIndices[QUEUE_TYPE_COMPUTE];
+	return families;
+}
+
+std::vector<VkDeviceQueueCreateInfo> CQueueManager::GetQueueCreateInfos(const QUEUE_FAMILIES& families)
+{
+	static const float queuePriority = 1.0f;
+
+	std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
+	for(uint32 queueType = 0; queueType < QUEUE_TYPE_COUNT; queueType++)
+	{
+		uint32 familyIndex = families.familyIndices[queueType];
+		bool found = false;
+		for(const auto& queueCreateInfo : queueCreateInfos)
+		{
+			found |= (queueCreateInfo.queueFamilyIndex == familyIndex);
+		}
+		if(found) continue;
+
+		auto queueCreateInfo = Framework::Vulkan::DeviceQueueCreateInfo();
+		queueCreateInfo.queueFamilyIndex = familyIndex;
+		queueCreateInfo.queueCount       = 1;
+		queueCreateInfo.pQueuePriorities = &queuePriority;
+		queueCreateInfos.push_back(queueCreateInfo);
+	}
+	return queueCreateInfos;
+}
+
+CQueueManager::CQueueManager(CDevice& device, const QUEUE_FAMILIES& families)
+: m_device(device)
+{
+	assert(m_device.vkGetSemaphoreCounterValue && m_device.vkWaitSemaphores);
+
+	for(uint32 queueType = 0; queueType < QUEUE_TYPE_COUNT; queueType++)
+	{
+		uint32 familyIndex = families.familyIndices[queueType];
+		uint32 queueIndex = 0;
+		for(; queueIndex < m_queues.size(); queueIndex++)
+		{
+			if(m_queues[queueIndex].familyIndex == familyIndex) break;
+		}
+		if(queueIndex == m_queues.size())
+		{
+			QUEUE queue;
+			queue.familyIndex = familyIndex;
+			m_device.vkGetDeviceQueue(m_device, familyIndex, 0, &queue.queue);
+
+			auto semaphoreTypeCreateInfo = Framework::Vulkan::SemaphoreTypeCreateInfo();
+			semaphoreTypeCreateInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+			semaphoreTypeCreateInfo.initialValue  = 0;
+
+			auto semaphoreCreateInfo = Framework::Vulkan::SemaphoreCreateInfo();
+			semaphoreCreateInfo.pNext = &semaphoreTypeCreateInfo;
+
+			auto result = m_device.vkCreateSemaphore(m_device, &semaphoreCreateInfo, nullptr, &queue.timeline);
+			CHECKVULKANERROR(result);
+
+			m_queues.push_back(std::move(queue));
+		}
+		m_typeQueueIndices[queueType] = queueIndex;
+	}
+}
+
+CQueueManager::~CQueueManager()
+{
+	WaitIdle();
+	for(const auto& queue : m_queues)
+	{
+		m_device.vkDestroySemaphore(m_device, queue.timeline, nullptr);
+	}
+}
+
+CQueueManager::SUBMIT_POINT CQueueManager::Enqueue(QUEUE_TYPE queueType, SUBMISSION submission)
+{
+	assert(submission.waitSemaphores.size() == submission.waitSemaphoreStageMasks.size());
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto& queue = GetTypeQueue(queueType);
+	queue.pendingSubmissions.push_back(std::move(submission));
+
+	SUBMIT_POINT point;
+	point.queueType = queueType;
+	point.value     = ++queue.lastValue;
+	return point;
+}
+
+void CQueueManager::Flush(VkFence fence)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for(auto& queue : m_queues)
+	{
+		bool isGraphicsQueue = (&queue == &GetTypeQueue(QUEUE_TYPE_GRAPHICS));
+		FlushQueue(queue, isGraphicsQueue ? fence : VK_NULL_HANDLE);
+	}
+}
+
+bool CQueueManager::IsComplete(const SUBMIT_POINT& point) const
+{
+	const auto& queue = GetTypeQueue(point.queueType);
+	uint64_t value = 0;
+	auto result = m_device.vkGetSemaphoreCounterValue(m_device, queue.timeline, &value);
+	CHECKVULKANERROR(result);
+	return (value >= point.value);
+}
+
+void CQueueManager::Wait(const SUBMIT_POINT& point)
+{
+	VkSemaphore timeline = VK_NULL_HANDLE;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto& queue = GetTypeQueue(point.queueType);
+		assert(point.value <= queue.lastValue);
+		if(point.value > queue.flushedValue)
+		{
+			//Waits of the submission can be on other queues, everything needs to go
+			for(auto& flushQueue : m_queues)
+			{
+				FlushQueue(flushQueue, VK_NULL_HANDLE);
+			}
+		}
+		timeline = queue.timeline;
+	}
+
+	uint64_t value = point.value;
+	auto semaphoreWaitInfo = Framework::Vulkan::SemaphoreWaitInfo();
+	semaphoreWaitInfo.semaphoreCount = 1;
+	semaphoreWaitInfo.pSemaphores    = &timeline;
+	semaphoreWaitInfo.pValues        = &value;
+
+	auto result = m_device.vkWaitSemaphores(m_device, &semaphoreWaitInfo, UINT64_MAX);
+	CHECKVULKANERROR(result);
+}
+
+void CQueueManager::WaitIdle()
+{
+	std::vector<VkSemaphore> timelines;
+	std::vector<uint64_t> values;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for(auto& queue : m_queues)
+		{
+			FlushQueue(queue, VK_NULL_HANDLE);
+			timelines.push_back(queue.timeline);
+			values.push_back(queue.lastValue);
+		}
+	}
+
+	auto semaphoreWaitInfo = Framework::Vulkan::SemaphoreWaitInfo();
+	semaphoreWaitInfo.semaphoreCount = static_cast<uint32>(timelines.size());
+	semaphoreWaitInfo.pSemaphores    = timelines.data();
+	semaphoreWaitInfo.pValues        = values.data();
+
+	auto result = m_device.vkWaitSemaphores(m_device, &semaphoreWaitInfo, UINT64_MAX);
+	CHECKVULKANERROR(result);
+}
+
+VkQueue CQueueManager::GetQueue(QUEUE_TYPE queueType) const
+{
+	return GetTypeQueue(queueType).queue;
+}
+
+uint32 CQueueManager::GetQueueFamilyIndex(QUEUE_TYPE queueType) const
+{
+	return GetTypeQueue(queueType).familyIndex;
+}
+
+bool CQueueManager::IsDedicated(QUEUE_TYPE queueType) const
+{
+	return (queueType == QUEUE_TYPE_GRAPHICS) || (m_typeQueueIndices[queueType] != m_typeQueueIndices[QUEUE_TYPE_GRAPHICS]);
+}
+
+CQueueManager::QUEUE& CQueueManager::GetTypeQueue(QUEUE_TYPE queueType)
+{
+	assert(queueType < QUEUE_TYPE_COUNT);
+	return m_queues[m_typeQueueIndices[queueType]];
+}
+
+const CQueueManager::QUEUE& CQueueManager::GetTypeQueue(QUEUE_TYPE queueType) const
+{
+	assert(queueType < QUEUE_TYPE_COUNT);
+	return m_queues[m_typeQueueIndices[queueType]];
+}
+
+void CQueueManager::FlushQueue(QUEUE& queue, VkFence fence)
+{
+	if(queue.pendingSubmissions.empty() && (fence == VK_NULL_HANDLE)) return;
+
+	//Arrays referenced by the submit infos, sized up front so that they don't move
+	struct SUBMIT_ARRAYS
+	{
+		std::vector<VkSemaphore> waitSemaphores;
+		std::vector<uint64_t> waitValues;
+		std::vector<VkPipelineStageFlags> waitStageMasks;
+		std::vector<VkSemaphore> signalSemaphores;
+		std::vector<uint64_t> signalValues;
+	};
+
+	size_t submissionCount = queue.pendingSubmissions.size();
+	std::vector<SUBMIT_ARRAYS> submitArrays(submissionCount);
+	std::vector<VkTimelineSemaphoreSubmitInfo> timelineSubmitInfos(submissionCount);
+	std::vector<VkSubmitInfo> submitInfos(submissionCount);
+
+	//Values are given in the order submissions were enqueued
+	uint64 value = queue.flushedValue;
+	for(size_t submissionIndex = 0; submissionIndex < submissionCount; submissionIndex++)
+	{
+		const auto& submission = queue.pendingSubmissions[submissionIndex];
+		auto& arrays = submitArrays[submissionIndex];
+
+		for(const auto& wait : submission.waits)
+		{
+			arrays.waitSemaphores.push_back(GetTypeQueue(wait.point.queueType).timeline);
+			arrays.waitValues.push_back(wait.point.value);
+			arrays.waitStageMasks.push_back(wait.stageMask);
+		}
+		for(size_t semaphoreIndex = 0; semaphoreIndex < submission.waitSemaphores.size(); semaphoreIndex++)
+		{
+			//Values of binary semaphores are ignored
+			arrays.waitSemaphores.push_back(submission.waitSemaphores[semaphoreIndex]);
+			arrays.waitValues.push_back(0);
+			arrays.waitStageMasks.push_back(submission.waitSemaphoreStageMasks[semaphoreIndex]);
+		}
+
+		arrays.signalSemaphores.push_back(queue.timeline);
+		arrays.signalValues.push_back(++value);
+		for(auto signalSemaphore : submission.signalSemaphores)
+		{
+			arrays.signalSemaphores.push_back(signalSemaphore);
+			arrays.signalValues.push_back(0);
+		}
+
+		auto& timelineSubmitInfo = timelineSubmitInfos[submissionIndex];
+		timelineSubmitInfo = Framework::Vulkan::TimelineSemaphoreSubmitInfo();
+		timelineSubmitInfo.waitSemaphoreValueCount   = static_cast<uint32>(arrays.waitValues.size());
+		timelineSubmitInfo.pWaitSemaphoreValues      = arrays.waitValues.data();
+		timelineSubmitInfo.signalSemaphoreValueCount = static_cast<uint32>(arrays.signalValues.size());
+		timelineSubmitInfo.pSignalSemaphoreValues    = arrays.signalValues.data();
+
+		auto& submitInfo = submitInfos[submissionIndex];
+		submitInfo = Framework::Vulkan::SubmitInfo();
+		submitInfo.pNext                = &timelineSubmitInfo;
+		submitInfo.waitSemaphoreCount   = static_cast<uint32>(arrays.waitSemaphores.size());
+		submitInfo.pWaitSemaphores      = arrays.waitSemaphores.data();
+		submitInfo.pWaitDstStageMask    = arrays.waitStageMasks.data();
+		submitInfo.commandBufferCount   = static_cast<uint32>(submission.commandBuffers.size());
+		submitInfo.pCommandBuffers      = submission.commandBuffers.data();
+		submitInfo.signalSemaphoreCount = static_cast<uint32>(arrays.signalSemaphores.size());
+		submitInfo.pSignalSemaphores    = arrays.signalSemaphores.data();
+	}
+	assert(value == queue.lastValue);
+
+	{
+		FRAMEWORK_TRACE_SCOPE("Vulkan::QueueSubmit");
+		auto result = m_device.vkQueueSubmit(queue.queue, static_cast<uint32>(submitInfos.size()), submitInfos.data(), fence);
+		CHECKVULKANERROR(result);
+	}
+
+	queue.flushedValue = value;
+	queue.pendingSubmissions.clear();
+}
@@ -0,0 +1,578 @@
+#include <algorithm>
+#include <cassert>
+#include "vulkan/RenderGraph.h"
+#include "vulkan/StructDefs.h"
+#include "vulkan/Utils.h"
+#include "TaskGroup.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+
+using namespace Framework::Vulkan;
+
+namespace
+{
+	VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	bool RangesOverlap(uint32 start0, uint32 end0, uint32 start1, uint32 end1)
+	{
+		return (start0 <= end1) && (start1 <= end0);
+	}
+}
+
+CRenderGraph::CRenderGraph(CMemoryAllocator& allocator)
+: m_allocator(allocator)
+, m_device(allocator.GetDevice())
+{
+}
+
+CRenderGraph::~CRenderGraph()
+{
+	DestroyTransients();
+}
+
+CRenderGraph::ResourceHandle CRenderGraph::ImportImage(VkImage image, VkImageAspectFlags aspectMask, uint32 mipLevelCount, const RESOURCE_STATE& state)
+{
+	RESOURCE resource;
+	resource.type          = RESOURCE_TYPE_IMAGE;
+	resource.image         = image;
+	resource.aspectMask    = aspectMask;
+	resource.mipLevelCount = mipLevelCount;
+	resource.initialState  = state;
+	m_resources.push_back(std::move(resource));
+	m_compiled = false;
+	return static_cast<ResourceHandle>(m_resources.size() - 1);
+}
+
+CRenderGraph::ResourceHandle CRenderGraph::ImportBuffer(VkBuffer buffer)
+{
+	RESOURCE resource;
+	resource.type   = RESOURCE_TYPE_BUFFER;
+	resource.buffer = buffer;
+	m_resources.push_back(std::move(resource));
+	m_compiled = false;
+	return static_cast<ResourceHandle>(m_resources.size() - 1);
+}
+
+CRenderGraph::ResourceHandle CRenderGraph::CreateTransientImage(const TRANSIENT_IMAGE_DESC& desc)
+{
+	assert(desc.width != 0 && desc.height != 0 && desc.mipLevelCount != 0);
+	RESOURCE resource;
+	resource.type          = RESOURCE_TYPE_IMAGE;
+	resource.transient     = true;
+	resource.aspectMask    = desc.aspectMask;
+	resource.mipLevelCount = desc.mipLevelCount;
+	resource.desc          = desc;
+	m_resources.push_back(std::move(resource));
+	m_compiled = false;
+	return static_cast<ResourceHandle>(m_resources.size() - 1);
+}
+
+CRenderGraph::PassHandle CRenderGraph::AddPass(const char* name, PassCallback callback)
+{
+	PASS pass;
+	pass.name     = name;
+	pass.callback = std::move(callback);
+	m_passes.push_back(std::move(pass));
+	m_compiled = false;
+	return static_cast<PassHandle>(m_passes.size() - 1);
+}
+
+void CRenderGraph::ReadImage(PassHandle pass, ResourceHandle resource, VkImageLayout layout, VkAccessFlags accessMask, VkPipelineStageFlags stageMask)
+{
+	AddAccess(pass, resource, RESOURCE_TYPE_IMAGE, false, layout, accessMask, stageMask);
+}
+
+void CRenderGraph::WriteImage(PassHandle pass, ResourceHandle resource, VkImageLayout layout, VkAccessFlags accessMask, VkPipelineStageFlags stageMask)
+{
+	AddAccess(pass, resource, RESOURCE_TYPE_IMAGE, true, layout, accessMask, stageMask);
+}
+
+void CRenderGraph::ReadBuffer(PassHandle pass, ResourceHandle resource, VkAccessFlags accessMask, VkPipelineStageFlags stageMask)
+{
+	AddAccess(pass, resource, RESOURCE_TYPE_BUFFER, false, VK_IMAGE_LAYOUT_UNDEFINED, accessMask, stageMask);
+}
+
+void CRenderGraph::WriteBuffer(PassHandle pass, ResourceHandle resource, VkAccessFlags accessMask, VkPipelineStageFlags stageMask)
+{
+	AddAccess(pass, resource, RESOURCE_TYPE_BUFFER, true, VK_IMAGE_LAYOUT_UNDEFINED, accessMask, stageMask);
+}
+
+void CRenderGraph::Compile()
+{
+	FRAMEWORK_TRACE_SCOPE("Vulkan::RenderGraph::Compile");
+
+	DestroyTransients();
+
+	for(auto& resource : m_resources)
+	{
+		resource.firstPass = ~0U;
+		resource.lastPass = 0;
+		resource.aliasedResources.clear();
+	}
+
+	for(uint32 passIndex = 0; passIndex < m_passes.size(); passIndex++)
+	{
+		for(const auto& access : m_passes[passIndex].accesses)
+		{
+			auto& resource = m_resources[access.resource];
+			resource.firstPass = std::min(resource.firstPass, passIndex);
+			resource.lastPass = std::max(resource.lastPass, passIndex);
+		}
+	}
+
+	AllocateTransients();
+	ComputeBarriers();
+	m_compiled = true;
+}
+
+void CRenderGraph::SetImportedImage(ResourceHandle handle, VkImage image, const RESOURCE_STATE& state)
+{
+	auto& resource = m_resources[handle];
+	assert(resource.type == RESOURCE_TYPE_IMAGE && !resource.transient);
+	resource.image = image;
+	resource.initialState = state;
+	if(m_compiled)
+	{
+		ComputeBarriers();
+	}
+}
+
+VkImage CRenderGraph::GetImage(ResourceHandle handle) const
+{
+	return m_resources[handle].image;
+}
+
+VkImageView CRenderGraph::GetImageView(ResourceHandle handle) const
+{
+	assert(m_resources[handle].transient);
+	return m_resources[handle].imageView;
+}
+
+CRenderGraph::RESOURCE_STATE CRenderGraph::GetFinalState(ResourceHandle handle) const
+{
+	assert(m_compiled);
+	return m_finalStates[handle];
+}
+
+std::vector<VkCommandBuffer> CRenderGraph::Record(CFrameCommandBufferPool& commandBufferPool, CThreadPool* threadPool)
+{
+	FRAMEWORK_TRACE_SCOPE("Vulkan::RenderGraph::Record");
+	assert(m_compiled);
+
+	uint32 passCount = static_cast<uint32>(m_passes.size());
+	uint32 threadCount = threadPool ? std::max<uint32>(threadPool->GetThreadCount(), 1) : 1;
+	uint32 groupCount = std::max<uint32>(std::min(passCount, threadCount), 1);
+
+	std::vector<VkCommandBuffer> commandBuffers(groupCount, VK_NULL_HANDLE);
+
+	//Contiguous pass ranges keep the command buffers in pass order when submitted one after the other
+	CTaskGroup taskGroup((groupCount > 1) ? threadPool : nullptr);
+	for(uint32 groupIndex = 0; groupIndex < groupCount; groupIndex++)
+	{
+		uint32 firstPass = passCount * groupIndex / groupCount;
+		uint32 endPass = passCount * (groupIndex + 1) / groupCount;
+		taskGroup.Run(
+		    [&, groupIndex, firstPass, endPass]() {
+			    //Pools are per thread, the command buffer needs to be allocated by the thread recording it
+			    auto commandBuffer = commandBufferPool.AllocateBuffer();
+
+			    auto commandBufferBeginInfo = Framework::Vulkan::CommandBufferBeginInfo();
+			    commandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+			    auto result = m_device.vkBeginCommandBuffer(commandBuffer, &commandBufferBeginInfo);
+			    CHECKVULKANERROR(result);
+
+			    RecordPasses(commandBuffer, firstPass, endPass - firstPass);
+
+			    result = m_device.vkEndCommandBuffer(commandBuffer);
+			    CHECKVULKANERROR(result);
+
+			    commandBuffers[groupIndex] = commandBuffer;
+		    });
+	}
+	taskGroup.Wait();
+
+	return commandBuffers;
+}
+
+void CRenderGraph::Execute(VkQueue queue, CFrameCommandBufferPool& commandBufferPool, VkFence fence, CThreadPool* threadPool, const VkSubmitInfo* baseSubmitInfo)
+{
+	auto commandBuffers = Record(commandBufferPool, threadPool);
+
+	FRAMEWORK_TRACE_SCOPE("Vulkan::QueueSubmit");
+	auto submitInfo = baseSubmitInfo ? *baseSubmitInfo : Framework::Vulkan::SubmitInfo();
+	submitInfo.commandBufferCount = static_cast<uint32>(commandBuffers.size());
+	submitInfo.pCommandBuffers    = commandBuffers.data();
+
+	auto result = m_device.vkQueueSubmit(queue, 1, &submitInfo, fence);
+	CHECKVULKANERROR(result);
+}
+
+void CRenderGraph::AddAccess(PassHandle passHandle, ResourceHandle resourceHandle, RESOURCE_TYPE type, bool write,
+	VkImageLayout layout, VkAccessFlags accessMask, VkPipelineStageFlags stageMask)
+{
+	assert(m_resources[resourceHandle].type == type);
+	assert((type == RESOURCE_TYPE_BUFFER) || (layout != VK_IMAGE_LAYOUT_UNDEFINED));
+	assert(stageMask != 0);
+
+	//Accesses of a pass to the same resource are merged, they need to agree on the layout
+	auto& pass = m_passes[passHandle];
+	for(auto& access : pass.accesses)
+	{
+		if(access.resource == resourceHandle)
+		{
+			assert(access.layout == layout);
+			access.write |= write;
+			access.accessMask |= accessMask;
+			access.stageMask |= stageMask;
+			return;
+		}
+	}
+
+	ACCESS access;
+	access.resource   = resourceHandle;
+	access.write      = write;
+	access.layout     = layout;
+	access.accessMask = accessMask;
+	access.stageMask  = stageMask;
+	pass.accesses.push_back(access);
+	m_compiled = false;
+}
+
+void CRenderGraph::DestroyTransients()
+{
+	for(auto& resource : m_resources)
+	{
+		if(!resource.transient) continue;
+		if(resource.imageView != VK_NULL_HANDLE)
+		{
+			m_device.vkDestroyImageView(m_device, resource.imageView, nullptr);
+			resource.imageView = VK_NULL_HANDLE;
+		}
+		if(resource.image != VK_NULL_HANDLE)
+		{
+			m_device.vkDestroyImage(m_device, resource.image, nullptr);
+			resource.image = VK_NULL_HANDLE;
+		}
+	}
+
+	for(const auto& allocation : m_allocations)
+	{
+		m_allocator.Free(allocation);
+	}
+	m_allocations.clear();
+}
+
+void CRenderGraph::AllocateTransients()
+{
+	struct PLACEMENT
+	{
+		ResourceHandle resource = 0;
+		VkMemoryRequirements memoryRequirements = {};
+		VkDeviceSize offset = 0;
+	};
+
+	std::vector<PLACEMENT> placements;
+	for(uint32 resourceIndex = 0; resourceIndex < m_resources.size(); resourceIndex++)
+	{
+		auto& resource = m_resources[resourceIndex];
+		//Images that no pass uses are never created
+		if(!resource.transient || (resource.firstPass == ~0U)) continue;
+
+		const auto& desc = resource.desc;
+		auto imageCreateInfo = Framework::Vulkan::ImageCreateInfo();
+		imageCreateInfo.imageType     = VK_IMAGE_TYPE_2D;
+		imageCreateInfo.format        = desc.format;
+		imageCreateInfo.extent.width  = desc.width;
+		imageCreateInfo.extent.height = desc.height;
+		imageCreateInfo.extent.depth  = 1;
+		imageCreateInfo.mipLevels     = desc.mipLevelCount;
+		imageCreateInfo.arrayLayers   = 1;
+		imageCreateInfo.samples       = VK_SAMPLE_COUNT_1_BIT;
+		imageCreateInfo.sharingMode   = VK_SHARING_MODE_EXCLUSIVE;
+		imageCreateInfo.tiling        = VK_IMAGE_TILING_OPTIMAL;
+		imageCreateInfo.usage         = desc.usage;
+		imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+		auto result = m_device.vkCreateImage(m_device, &imageCreateInfo, nullptr, &resource.image);
+		CHECKVULKANERROR(result);
+
+		PLACEMENT placement;
+		placement.resource = resourceIndex;
+		m_device.vkGetImageMemoryRequirements(m_device, resource.image, &placement.memoryRequirements);
+		placements.push_back(placement);
+	}
+
+	//Biggest images are placed first, every image goes at the lowest offset that doesn't overlap with
+	//an image of the same memory heap whose lifetime overlaps with its own
+	std::stable_sort(placements.begin(), placements.end(),
+	    [](const PLACEMENT& lhs, const PLACEMENT& rhs) {
+		    if(lhs.memoryRequirements.memoryTypeBits != rhs.memoryRequirements.memoryTypeBits)
+		    {
+			    return lhs.memoryRequirements.memoryTypeBits < rhs.memoryRequirements.memoryTypeBits;
+		    }
+		    return lhs.memoryRequirements.size > rhs.memoryRequirements.size;
+	    });
+
+	for(size_t groupStart = 0; groupStart < placements.size();)
+	{
+		auto memoryTypeBits = placements[groupStart].memoryRequirements.memoryTypeBits;
+		size_t groupEnd = groupStart;
+		while((groupEnd < placements.size()) && (placements[groupEnd].memoryRequirements.memoryTypeBits == memoryTypeBits))
+		{
+			groupEnd++;
+		}
+
+		VkMemoryRequirements groupRequirements = {};
+		groupRequirements.memoryTypeBits = memoryTypeBits;
+		groupRequirements.alignment = 1;
+
+		for(size_t placementIndex = groupStart; placementIndex < groupEnd; placementIndex++)
+		{
+			auto& placement = placements[placementIndex];
+			const auto& resource = m_resources[placement.resource];
+			auto alignment = placement.memoryRequirements.alignment;
+			auto size = placement.memoryRequirements.size;
+
+			//Candidates are the start of the heap and the end of every live image already placed
+			std::vector<VkDeviceSize> candidates = {0};
+			for(size_t otherIndex = groupStart; otherIndex < placementIndex; otherIndex++)
+			{
+				const auto& other = placements[otherIndex];
+				const auto& otherResource = m_resources[other.resource];
+				if(!RangesOverlap(resource.firstPass, resource.lastPass, otherResource.firstPass, otherResource.lastPass)) continue;
+				candidates.push_back(AlignUp(other.offset + other.memoryRequirements.size, alignment));
+			}
+			std::sort(candidates.begin(), candidates.end());
+
+			for(auto candidate : candidates)
+			{
+				bool fits = true;
+				for(size_t otherIndex = groupStart; otherIndex < placementIndex; otherIndex++)
+				{
+					const auto& other = placements[otherIndex];
+					const auto& otherResource = m_resources[other.resource];
+					if(!RangesOverlap(resource.firstPass, resource.lastPass, otherResource.firstPass, otherResource.lastPass)) continue;
+					if((candidate < other.offset + other.memoryRequirements.size) && (other.offset < candidate + size))
+					{
+						fits = false;
+						break;
+					}
+				}
+				if(fits)
+				{
+					placement.offset = candidate;
+					break;
+				}
+			}
+
+			groupRequirements.size = std::max(groupRequirements.size, placement.offset + size);
+			groupRequirements.alignment = std::max(groupRequirements.alignment, alignment);
+		}
+
+		//Images living before this one in the same memory need to be done with it before it's used
+		for(size_t placementIndex = groupStart; placementIndex < groupEnd; placementIndex++)
+		{
+			const auto& placement = placements[placementIndex];
+			auto& resource = m_resources[placement.resource];
+			for(size_t otherIndex = groupStart; otherIndex < groupEnd; otherIndex++)
+			{
+				const auto& other = placements[otherIndex];
+				const auto& otherResource = m_resources[other.resource];
+				if(otherResource.lastPass >= resource.firstPass) continue;
+				if((placement.offset < other.offset + other.memoryRequirements.size) && (other.offset < placement.offset + placement.memoryRequirements.size))
+				{
+					resource.aliasedResources.push_back(other.resource);
+				}
+			}
+		}
+
+		auto allocation = m_allocator.Allocate(groupRequirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, false);
+		m_allocations.push_back(allocation);
+
+		for(size_t placementIndex = groupStart; placementIndex < groupEnd; placementIndex++)
+		{
+			const auto& placement = placements[placementIndex];
+			auto& resource = m_resources[placement.resource];
+
+			auto result = m_device.vkBindImageMemory(m_device, resource.image, allocation.memory, allocation.offset + placement.offset);
+			CHECKVULKANERROR(result);
+
+			auto imageViewCreateInfo = Framework::Vulkan::ImageViewCreateInfo();
+			imageViewCreateInfo.image    = resource.image;
+			imageViewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+			imageViewCreateInfo.format   = resource.desc.format;
+			imageViewCreateInfo.components =
+			{
+				VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_G,
+				VK_COMPONENT_SWIZZLE_B, VK_COMPONENT_SWIZZLE_A
+			};
+			imageViewCreateInfo.subresourceRange = { resource.aspectMask, 0, resource.mipLevelCount, 0, 1 };
+
+			result = m_device.vkCreateImageView(m_device, &imageViewCreateInfo, nullptr, &resource.imageView);
+			CHECKVULKANERROR(result);
+		}
+
+		groupStart = groupEnd;
+	}
+}
+
+void CRenderGraph::ComputeBarriers()
+{
+	std::vector<TRACKED_STATE> states(m_resources.size());
+	for(uint32 resourceIndex = 0; resourceIndex < m_resources.size(); resourceIndex++)
+	{
+		const auto& resource = m_resources[resourceIndex];
+		if(resource.transient) continue;
+		//Whatever was done before the graph executes is handled like a write
+		auto& state = states[resourceIndex];
+		state.layout      = resource.initialState.layout;
+		state.writeAccess = resource.initialState.accessMask;
+		state.writeStages = resource.initialState.stageMask;
+	}
+
+	m_barriers.clear();
+	m_barriers.resize(m_passes.size());
+
+	for(uint32 passIndex = 0; passIndex < m_passes.size(); passIndex++)
+	{
+		auto& batch = m_barriers[passIndex];
+		batch.memoryBarrier = Framework::Vulkan::MemoryBarrier();
+
+		for(const auto& access : m_passes[passIndex].accesses)
+		{
+			const auto& resource = m_resources[access.resource];
+			auto& state = states[access.resource];
+
+			//Transient images start undefined, after all use of the memory by previous images
+			if(resource.transient && (resource.firstPass == passIndex))
+			{
+				state = TRACKED_STATE();
+				for(auto aliasedResource : resource.aliasedResources)
+				{
+					const auto& aliasedState = states[aliasedResource];
+					state.writeAccess |= aliasedState.writeAccess;
+					state.writeStages |= aliasedState.writeStages | aliasedState.readStages;
+				}
+			}
+
+			bool isImage = (resource.type == RESOURCE_TYPE_IMAGE);
+			bool layoutChange = isImage && (state.layout != access.layout);
+
+			VkPipelineStageFlags srcStages = 0;
+			VkAccessFlags srcAccess = 0;
+			bool needsBarrier = false;
+
+			if(access.write || layoutChange)
+			{
+				//Writes wait on every previous access, layout transitions count as writes
+				srcStages = state.writeStages | state.readStages;
+				srcAccess = state.writeAccess;
+				needsBarrier = (srcStages != 0) || layoutChange;
+			}
+			else if((state.writeAccess != 0) || (state.writeStages != 0))
+			{
+				//Reads only wait on the last write, once per stage and access it's made visible to
+				needsBarrier = ((access.stageMask & ~state.visibleStages) != 0) || ((access.accessMask & ~state.visibleAccess) != 0);
+				srcStages = state.writeStages;
+				srcAccess = state.writeAccess;
+			}
+
+			if(needsBarrier)
+			{
+				batch.srcStages |= srcStages;
+				batch.dstStages |= access.stageMask;
+
+				if(isImage)
+				{
+					//Write after read in the same layout only needs the execution dependency
+					if(layoutChange || (srcAccess != 0))
+					{
+						auto imageMemoryBarrier = Framework::Vulkan::ImageMemoryBarrier();
+						imageMemoryBarrier.image               = resource.image;
+						imageMemoryBarrier.oldLayout           = state.layout;
+						imageMemoryBarrier.newLayout           = access.layout;
+						imageMemoryBarrier.srcAccessMask       = srcAccess;
+						imageMemoryBarrier.dstAccessMask       = access.accessMask;
+						imageMemoryBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+						imageMemoryBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+						imageMemoryBarrier.subresourceRange    = { resource.aspectMask, 0, resource.mipLevelCount, 0, 1 };
+						batch.imageBarriers.push_back(imageMemoryBarrier);
+					}
+				}
+				else if(srcAccess != 0)
+				{
+					batch.memoryBarrier.srcAccessMask |= srcAccess;
+					batch.memoryBarrier.dstAccessMask |= access.accessMask;
+				}
+			}
+
+			if(access.write)
+			{
+				state.writeAccess   = access.accessMask;
+				state.writeStages   = access.stageMask;
+				state.readStages    = 0;
+				state.visibleAccess = 0;
+				state.visibleStages = 0;
+			}
+			else if(layoutChange)
+			{
+				//Transition is done before the stages of this access, later reads need to wait on them
+				state.writeAccess   = 0;
+				state.writeStages   = access.stageMask;
+				state.readStages    = access.stageMask;
+				state.visibleAccess = access.accessMask;
+				state.visibleStages = access.stageMask;
+			}
+			else
+			{
+				state.readStages |= access.stageMask;
+				if(needsBarrier)
+				{
+					state.visibleAccess |= access.accessMask;
+					state.visibleStages |= access.stageMask;
+				}
+			}
+			state.layout = access.layout;
+		}
+	}
+
+	m_finalStates.resize(m_resources.size());
+	for(uint32 resourceIndex = 0; resourceIndex < m_resources.size(); resourceIndex++)
+	{
+		const auto& state = states[resourceIndex];
+		auto& finalState = m_finalStates[resourceIndex];
+		finalState.layout     = state.layout;
+		finalState.accessMask = state.writeAccess;
+		finalState.stageMask  = state.writeStages | state.readStages;
+	}
+}
+
+void CRenderGraph::RecordPasses(VkCommandBuffer commandBuffer, uint32 firstPass, uint32 passCount)
+{
+	for(uint32 passIndex = firstPass; passIndex < firstPass + passCount; passIndex++)
+	{
+		const auto& batch = m_barriers[passIndex];
+		if(batch.dstStages != 0)
+		{
+			VkPipelineStageFlags srcStages = batch.srcStages;
+			if(srcStages == 0)
+			{
+				srcStages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+			}
+			uint32 memoryBarrierCount = (batch.memoryBarrier.srcAccessMask != 0) ? 1 : 0;
+			m_device.vkCmdPipelineBarrier(commandBuffer, srcStages, batch.dstStages, 0,
+				memoryBarrierCount, &batch.memoryBarrier, 0, nullptr,
+				static_cast<uint32>(batch.imageBarriers.size()), batch.imageBarriers.data());
+		}
+
+		const auto& pass = m_passes[passIndex];
+		if(pass.callback)
+		{
+			pass.callback(commandBuffer);
+		}
+	}
+}
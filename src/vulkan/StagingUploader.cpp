@@ -0,0 +1,419 @@
+#include <cstring>
+#include "vulkan/StagingUploader.h"
+#include "vulkan/Image.h"
+#include "vulkan/StructDefs.h"
+#include "Trace.h"
+
+using namespace Framework::Vulkan;
+
+CStagingUploader::CStagingUploader(CMemoryAllocator& allocator, VkQueue queue, uint32 queueFamilyIndex,
+	uint32 dstQueueFamilyIndex, VkDeviceSize ringSize)
+: m_device(allocator.GetDevice())
+, m_allocator(allocator)
+, m_queue(queue)
+, m_queueFamilyIndex(queueFamilyIndex)
+, m_dstQueueFamilyIndex(dstQueueFamilyIndex)
+, m_commandBufferPool(allocator.GetDevice(), queueFamilyIndex)
+, m_ringSize(ringSize)
+{
+	//Coherent memory doesn't need flushing after writing to it
+	m_ringBuffer = CBuffer(m_allocator, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, static_cast<uint32>(m_ringSize));
+	m_ringData = reinterpret_cast<uint8*>(m_ringBuffer.Map());
+}
+
+CStagingUploader::~CStagingUploader()
+{
+	WaitIdle();
+	for(const auto& batch : m_freeBatches)
+	{
+		m_device.vkDestroyFence(m_device, batch.fence, nullptr);
+		m_commandBufferPool.FreeBuffer(batch.commandBuffer);
+	}
+	m_ringBuffer.Unmap();
+}
+
+CStagingUploader::UploadTicket CStagingUploader::UploadBuffer(CBuffer& buffer, VkDeviceSize dstOffset, const void* data, VkDeviceSize size)
+{
+	VkBuffer stagingBuffer = VK_NULL_HANDLE;
+	VkDeviceSize stagingOffset = 0;
+	Stage(data, size, stagingBuffer, stagingOffset);
+
+	auto& batch = GetCurrentBatch();
+
+	{
+		VkBufferCopy bufferCopy = {};
+		bufferCopy.srcOffset = stagingOffset;
+		bufferCopy.dstOffset = dstOffset;
+		bufferCopy.size      = size;
+
+		m_device.vkCmdCopyBuffer(batch.commandBuffer, stagingBuffer, buffer, 1, &bufferCopy);
+	}
+
+	if(IsOwnershipTransferNeeded())
+	{
+		auto bufferMemoryBarrier = Framework::Vulkan::BufferMemoryBarrier();
+		bufferMemoryBarrier.srcAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT;
+		bufferMemoryBarrier.dstAccessMask       = 0;
+		bufferMemoryBarrier.srcQueueFamilyIndex = m_queueFamilyIndex;
+		bufferMemoryBarrier.dstQueueFamilyIndex = m_dstQueueFamilyIndex;
+		bufferMemoryBarrier.buffer              = buffer;
+		bufferMemoryBarrier.offset              = dstOffset;
+		bufferMemoryBarrier.size                = size;
+
+		m_device.vkCmdPipelineBarrier(batch.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+			0, 0, nullptr, 1, &bufferMemoryBarrier, 0, nullptr);
+
+		//Usage on the destination queue is unknown
+		bufferMemoryBarrier.srcAccessMask = 0;
+		bufferMemoryBarrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+		batch.bufferAcquireBarriers.push_back(bufferMemoryBarrier);
+	}
+
+	return batch.ticket;
+}
+
+CStagingUploader::UploadTicket CStagingUploader::UploadImage(CImage& image, const void* data, VkImageLayout layout, VkAccessFlags accessFlags)
+{
+	memcpy(StageImage(image), data, image.GetLinearSize());
+	return UploadStagedImage(image, layout, accessFlags);
+}
+
+uint8* CStagingUploader::StageImage(CImage& image)
+{
+	assert(!m_stagedImage);
+	auto stagingData = AllocateStaging(image.GetLinearSize(), m_stagedImageBuffer, m_stagedImageOffset);
+	m_stagedImage = &image;
+	return stagingData;
+}
+
+CStagingUploader::UploadTicket CStagingUploader::UploadStagedImage(CImage& image, VkImageLayout layout, VkAccessFlags accessFlags)
+{
+	assert(m_stagedImage == &image);
+	m_stagedImage = nullptr;
+
+	auto& batch = GetCurrentBatch();
+
+	image.RecordCopyFromBuffer(batch.commandBuffer, m_stagedImageBuffer, m_stagedImageOffset);
+
+	if(image.GetMipLevelCount() > 1)
+	{
+		//Blits can't run on a transfer queue, mipmaps are generated in the batch and leave the levels in the final layout
+		assert(!IsOwnershipTransferNeeded());
+		image.RecordGenerateMipmaps(batch.commandBuffer, layout, accessFlags, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+		return batch.ticket;
+	}
+
+	{
+		auto imageMemoryBarrier = Framework::Vulkan::ImageMemoryBarrier();
+		imageMemoryBarrier.image               = image;
+		imageMemoryBarrier.oldLayout           = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		imageMemoryBarrier.newLayout           = layout;
+		imageMemoryBarrier.srcAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT;
+		imageMemoryBarrier.dstAccessMask       = accessFlags;
+		imageMemoryBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		imageMemoryBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		imageMemoryBarrier.subresourceRange    = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+		if(IsOwnershipTransferNeeded())
+		{
+			//Layout transition happens as part of the release and acquire pair
+			imageMemoryBarrier.dstAccessMask       = 0;
+			imageMemoryBarrier.srcQueueFamilyIndex = m_queueFamilyIndex;
+			imageMemoryBarrier.dstQueueFamilyIndex = m_dstQueueFamilyIndex;
+
+			m_device.vkCmdPipelineBarrier(batch.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+				0, 0, nullptr, 0, nullptr, 1, &imageMemoryBarrier);
+
+			imageMemoryBarrier.srcAccessMask = 0;
+			imageMemoryBarrier.dstAccessMask = accessFlags;
+			batch.imageAcquireBarriers.push_back(imageMemoryBarrier);
+		}
+		else
+		{
+			m_device.vkCmdPipelineBarrier(batch.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+				0, 0, nullptr, 0, nullptr, 1, &imageMemoryBarrier);
+		}
+	}
+
+	return batch.ticket;
+}
+
+void CStagingUploader::CancelStagedImage()
+{
+	assert(m_stagedImage);
+	m_stagedImage = nullptr;
+}
+
+CStagingUploader::UploadTicket CStagingUploader::Flush()
+{
+	//Staging memory of the image would be given back before its copy is recorded
+	assert(!m_stagedImage);
+	if(!m_currentBatchOpen)
+	{
+		//Last ticket handed out, might already be complete
+		return m_nextTicket - 1;
+	}
+
+	auto result = VK_SUCCESS;
+	auto& batch = m_currentBatch;
+
+	if(!IsOwnershipTransferNeeded())
+	{
+		//Makes buffer writes visible to commands submitted after this batch on the same queue
+		auto memoryBarrier = Framework::Vulkan::MemoryBarrier();
+		memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		memoryBarrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+
+		m_device.vkCmdPipelineBarrier(batch.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+			0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+	}
+
+	result = m_device.vkEndCommandBuffer(batch.commandBuffer);
+	CHECKVULKANERROR(result);
+
+	{
+		FRAMEWORK_TRACE_SCOPE("Vulkan::QueueSubmit");
+		auto submitInfo = Framework::Vulkan::SubmitInfo();
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers    = &batch.commandBuffer;
+
+		result = m_device.vkQueueSubmit(m_queue, 1, &submitInfo, batch.fence);
+		CHECKVULKANERROR(result);
+	}
+
+	auto ticket = batch.ticket;
+	m_submittedBatches.push_back(std::move(batch));
+	m_currentBatch = BATCH();
+	m_currentBatchOpen = false;
+	return ticket;
+}
+
+bool CStagingUploader::IsComplete(UploadTicket ticket)
+{
+	RetireCompletedBatches();
+	return ticket <= m_completedTicket;
+}
+
+void CStagingUploader::Wait(UploadTicket ticket)
+{
+	if(m_currentBatchOpen && (ticket >= m_currentBatch.ticket))
+	{
+		Flush();
+	}
+	while(ticket > m_completedTicket)
+	{
+		assert(!m_submittedBatches.empty());
+		WaitOldestBatch();
+	}
+}
+
+void CStagingUploader::WaitIdle()
+{
+	Flush();
+	while(!m_submittedBatches.empty())
+	{
+		WaitOldestBatch();
+	}
+}
+
+void CStagingUploader::RecordAcquireBarriers(VkCommandBuffer commandBuffer)
+{
+	RetireCompletedBatches();
+	if(m_pendingBufferAcquireBarriers.empty() && m_pendingImageAcquireBarriers.empty())
+	{
+		return;
+	}
+
+	//Fence of the releasing batch was already waited on, no semaphore needed
+	m_device.vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0,
+		0, nullptr,
+		static_cast<uint32>(m_pendingBufferAcquireBarriers.size()), m_pendingBufferAcquireBarriers.data(),
+		static_cast<uint32>(m_pendingImageAcquireBarriers.size()), m_pendingImageAcquireBarriers.data());
+
+	m_pendingBufferAcquireBarriers.clear();
+	m_pendingImageAcquireBarriers.clear();
+}
+
+bool CStagingUploader::IsOwnershipTransferNeeded() const
+{
+	return (m_dstQueueFamilyIndex != VK_QUEUE_FAMILY_IGNORED) && (m_dstQueueFamilyIndex != m_queueFamilyIndex);
+}
+
+CStagingUploader::BATCH& CStagingUploader::GetCurrentBatch()
+{
+	if(m_currentBatchOpen)
+	{
+		return m_currentBatch;
+	}
+
+	auto result = VK_SUCCESS;
+
+	if(!m_freeBatches.empty())
+	{
+		m_currentBatch = std::move(m_freeBatches.back());
+		m_freeBatches.pop_back();
+	}
+	else
+	{
+		m_currentBatch = BATCH();
+		m_currentBatch.commandBuffer = m_commandBufferPool.AllocateBuffer();
+
+		auto fenceCreateInfo = Framework::Vulkan::FenceCreateInfo();
+		result = m_device.vkCreateFence(m_device, &fenceCreateInfo, nullptr, &m_currentBatch.fence);
+		CHECKVULKANERROR(result);
+	}
+
+	m_currentBatch.ticket = m_nextTicket++;
+
+	{
+		//Pool allows command buffers to be reset individually, begin resets it implicitly
+		auto commandBufferBeginInfo = Framework::Vulkan::CommandBufferBeginInfo();
+		commandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+		result = m_device.vkBeginCommandBuffer(m_currentBatch.commandBuffer, &commandBufferBeginInfo);
+		CHECKVULKANERROR(result);
+	}
+
+	m_currentBatchOpen = true;
+	return m_currentBatch;
+}
+
+void CStagingUploader::Stage(const void* data, VkDeviceSize size, VkBuffer& stagingBuffer, VkDeviceSize& stagingOffset)
+{
+	memcpy(AllocateStaging(size, stagingBuffer, stagingOffset), data, size);
+}
+
+uint8* CStagingUploader::AllocateStaging(VkDeviceSize size, VkBuffer& stagingBuffer, VkDeviceSize& stagingOffset)
+{
+	if(size > m_ringSize)
+	{
+		//Memory comes from the allocator, stays mapped until the buffer is destroyed
+		auto oversizedStagingBuffer = CBuffer(m_allocator, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, static_cast<uint32>(size));
+		auto stagingData = reinterpret_cast<uint8*>(oversizedStagingBuffer.Map());
+
+		stagingBuffer = oversizedStagingBuffer;
+		stagingOffset = 0;
+		GetCurrentBatch().oversizedStagingBuffers.push_back(std::move(oversizedStagingBuffer));
+		return stagingData;
+	}
+
+	VkDeviceSize ringUsedBefore = m_ringUsed;
+	while(!TryAllocateRing(size, stagingOffset))
+	{
+		//Ring is full, its space is only given back once the GPU is done with older batches
+		if(m_submittedBatches.empty())
+		{
+			Flush();
+		}
+		assert(!m_submittedBatches.empty());
+		WaitOldestBatch();
+		ringUsedBefore = m_ringUsed;
+	}
+
+	stagingBuffer = m_ringBuffer;
+
+	auto& batch = GetCurrentBatch();
+	batch.ringUsed += m_ringUsed - ringUsedBefore;
+	batch.ringEnd = m_ringHead;
+
+	return m_ringData + stagingOffset;
+}
+
+bool CStagingUploader::TryAllocateRing(VkDeviceSize size, VkDeviceSize& offset)
+{
+	if(m_ringUsed == 0)
+	{
+		m_ringHead = 0;
+		m_ringTail = 0;
+	}
+	else if(m_ringUsed == m_ringSize)
+	{
+		return false;
+	}
+
+	VkDeviceSize alignedHead = (m_ringHead + STAGING_ALIGNMENT - 1) & ~(STAGING_ALIGNMENT - 1);
+	if((m_ringUsed == 0) || (m_ringHead > m_ringTail))
+	{
+		//Free space is after the head, then before the tail once wrapped around
+		if((alignedHead + size) <= m_ringSize)
+		{
+			offset = alignedHead;
+			m_ringUsed += (alignedHead + size) - m_ringHead;
+			m_ringHead = alignedHead + size;
+			return true;
+		}
+		if(size <= m_ringTail)
+		{
+			offset = 0;
+			m_ringUsed += (m_ringSize - m_ringHead) + size;
+			m_ringHead = size;
+			return true;
+		}
+		return false;
+	}
+	else
+	{
+		//Head wrapped around, free space is between the head and the tail
+		if((alignedHead + size) <= m_ringTail)
+		{
+			offset = alignedHead;
+			m_ringUsed += (alignedHead + size) - m_ringHead;
+			m_ringHead = alignedHead + size;
+			return true;
+		}
+		return false;
+	}
+}
+
+void CStagingUploader::WaitOldestBatch()
+{
+	auto& batch = m_submittedBatches.front();
+	auto result = m_device.vkWaitForFences(m_device, 1, &batch.fence, VK_TRUE, UINT64_MAX);
+	CHECKVULKANERROR(result);
+	RetireBatch(batch);
+	m_freeBatches.push_back(std::move(batch));
+	m_submittedBatches.pop_front();
+}
+
+void CStagingUploader::RetireCompletedBatches()
+{
+	while(!m_submittedBatches.empty())
+	{
+		auto& batch = m_submittedBatches.front();
+		if(m_device.vkGetFenceStatus(m_device, batch.fence) != VK_SUCCESS)
+		{
+			break;
+		}
+		RetireBatch(batch);
+		m_freeBatches.push_back(std::move(batch));
+		m_submittedBatches.pop_front();
+	}
+}
+
+void CStagingUploader::RetireBatch(BATCH& batch)
+{
+	auto result = m_device.vkResetFences(m_device, 1, &batch.fence);
+	CHECKVULKANERROR(result);
+
+	if(batch.ringUsed != 0)
+	{
+		assert(batch.ringUsed <= m_ringUsed);
+		m_ringUsed -= batch.ringUsed;
+		m_ringTail = batch.ringEnd;
+	}
+
+	m_pendingBufferAcquireBarriers.insert(m_pendingBufferAcquireBarriers.end(),
+		batch.bufferAcquireBarriers.begin(), batch.bufferAcquireBarriers.end());
+	m_pendingImageAcquireBarriers.insert(m_pendingImageAcquireBarriers.end(),
+		batch.imageAcquireBarriers.begin(), batch.imageAcquireBarriers.end());
+
+	m_completedTicket = batch.ticket;
+
+	batch.ringEnd = 0;
+	batch.ringUsed = 0;
+	batch.oversizedStagingBuffers.clear();
+	batch.bufferAcquireBarriers.clear();
+	batch.imageAcquireBarriers.clear();
+}
@@ -76,6 +76,9 @@ LRESULT CColumnTreeView::OnNotify(WPARAM nId, NMHDR* pHdr)
 	{
 		if(pHdr->hwndFrom == m_pTreeView->m_hWnd)
 		{
+			//Tree view is our child, virtual mode notifications can't be forwarded by our parent
+			GetTreeView()->ProcessNotify(nId, pHdr);
+
 			if(pHdr->code == NM_CUSTOMDRAW)
 			{
 				NMTVCUSTOMDRAW* pCustomDraw;
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include "win32/ListView.h"
 
 using namespace Framework::Win32;
@@ -22,6 +23,12 @@ CListView& CListView::operator =(CListView&& rhs)
 {
 	CWindow::Reset();
 	CWindow::MoveFrom(std::move(rhs));
+	m_itemTextProvider = std::move(rhs.m_itemTextProvider);
+	m_itemTextCache = std::move(rhs.m_itemTextCache);
+	m_cacheFirstRow = rhs.m_cacheFirstRow;
+	m_cacheRowCount = rhs.m_cacheRowCount;
+	m_cacheColumnCount = rhs.m_cacheColumnCount;
+	rhs.m_cacheRowCount = 0;
 	return (*this);
 }
 
@@ -169,3 +176,102 @@ HWND CListView::GetHeader()
 {
 	return ListView_GetHeader(m_hWnd);
 }
+
+void CListView::SetItemTextProvider(ItemTextProvider itemTextProvider)
+{
+	m_itemTextProvider = std::move(itemTextProvider);
+	InvalidateItemTextCache();
+}
+
+void CListView::SetVirtualItemCount(unsigned int count)
+{
+	InvalidateItemTextCache();
+	ListView_SetItemCountEx(m_hWnd, count, LVSICF_NOSCROLL);
+}
+
+void CListView::InvalidateItemTextCache()
+{
+	m_cacheRowCount = 0;
+}
+
+void CListView::ProcessNotify(WPARAM wparam, NMHDR* hdr)
+{
+	if(hdr->hwndFrom != m_hWnd) return;
+	if(!m_itemTextProvider) return;
+
+	switch(hdr->code)
+	{
+	case LVN_ODCACHEHINT:
+		{
+			auto cacheHint = reinterpret_cast<NMLVCACHEHINT*>(hdr);
+			if(cacheHint->iFrom < 0 || cacheHint->iTo < cacheHint->iFrom) return;
+			FillItemTextCache(cacheHint->iFrom, cacheHint->iTo - cacheHint->iFrom + 1);
+		}
+		break;
+	case LVN_GETDISPINFO:
+		GetOwnerDataItemText(reinterpret_cast<NMLVDISPINFO*>(hdr));
+		break;
+	}
+}
+
+void CListView::FillItemTextCache(unsigned int firstRow, unsigned int rowCount)
+{
+	rowCount = std::min<unsigned int>(rowCount, MAX_CACHE_ROWS);
+	unsigned int columnCount = std::max(Header_GetItemCount(GetHeader()), 1);
+	if(
+		(columnCount == m_cacheColumnCount) &&
+		(firstRow >= m_cacheFirstRow) &&
+		((firstRow + rowCount) <= (m_cacheFirstRow + m_cacheRowCount))
+		)
+	{
+		return;
+	}
+
+	//Only grows, strings already there keep their storage
+	if(m_itemTextCache.size() < (rowCount * columnCount))
+	{
+		m_itemTextCache.resize(rowCount * columnCount);
+	}
+	for(unsigned int row = 0; row < rowCount; row++)
+	{
+		for(unsigned int column = 0; column < columnCount; column++)
+		{
+			auto& text = m_itemTextCache[(row * columnCount) + column];
+			text.clear();
+			m_itemTextProvider(firstRow + row, column, text);
+		}
+	}
+	m_cacheFirstRow = firstRow;
+	m_cacheRowCount = rowCount;
+	m_cacheColumnCount = columnCount;
+}
+
+void CListView::GetOwnerDataItemText(NMLVDISPINFO* dispInfo)
+{
+	auto& item = dispInfo->item;
+	if(!(item.mask & LVIF_TEXT)) return;
+	if(!item.pszText || item.cchTextMax <= 0) return;
+
+	unsigned int row = item.iItem;
+	unsigned int column = item.iSubItem;
+	const std::tstring* text = nullptr;
+	if(
+		(row >= m_cacheFirstRow) &&
+		(row < (m_cacheFirstRow + m_cacheRowCount)) &&
+		(column < m_cacheColumnCount)
+		)
+	{
+		text = &m_itemTextCache[((row - m_cacheFirstRow) * m_cacheColumnCount) + column];
+	}
+	else
+	{
+		//Row wasn't hinted (ie.: tooltips, keyboard search)
+		m_itemText.clear();
+		m_itemTextProvider(row, column, m_itemText);
+		text = &m_itemText;
+	}
+
+	size_t length = std::min<size_t>(text->size(), item.cchTextMax - 1);
+	memcpy(item.pszText, text->c_str(), length * sizeof(TCHAR));
+	item.pszText[length] = 0;
+}
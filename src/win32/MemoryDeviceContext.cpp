@@ -11,5 +11,78 @@ CDeviceContext(CreateCompatibleDC(dc))
 
 CMemoryDeviceContext::~CMemoryDeviceContext()
 {
+	//Bitmap is deleted after the DC, it can't be selected in it anymore then
+	if(m_oldBitmap != NULL)
+	{
+		::SelectObject(m_dc, m_oldBitmap);
+	}
 	DeleteDC(m_dc);
 }
+
+bool CMemoryDeviceContext::EnsureBitmap(HDC compatibleDc, unsigned int width, unsigned int height)
+{
+	if(m_bitmap.IsValid() && !m_isDibSection && (m_width == width) && (m_height == height))
+	{
+		return false;
+	}
+	SelectBitmap(CreateCompatibleBitmap(compatibleDc, width, height), nullptr, width, height);
+	m_isDibSection = false;
+	return true;
+}
+
+bool CMemoryDeviceContext::EnsureDibSection(unsigned int width, unsigned int height)
+{
+	if(m_bitmap.IsValid() && m_isDibSection && (m_width == width) && (m_height == height))
+	{
+		return false;
+	}
+
+	BITMAPINFO bitmapInfo = {};
+	bitmapInfo.bmiHeader.biSize			= sizeof(BITMAPINFOHEADER);
+	bitmapInfo.bmiHeader.biWidth		= width;
+	//Negative height makes the DIB top-down
+	bitmapInfo.bmiHeader.biHeight		= -static_cast<LONG>(height);
+	bitmapInfo.bmiHeader.biPlanes		= 1;
+	bitmapInfo.bmiHeader.biBitCount		= 32;
+	bitmapInfo.bmiHeader.biCompression	= BI_RGB;
+
+	void* bits = nullptr;
+	HBITMAP bitmap = CreateDIBSection(m_dc, &bitmapInfo, DIB_RGB_COLORS, &bits, NULL, 0);
+	SelectBitmap(bitmap, bits, width, height);
+	m_isDibSection = true;
+	return true;
+}
+
+unsigned int CMemoryDeviceContext::GetWidth() const
+{
+	return m_width;
+}
+
+unsigned int CMemoryDeviceContext::GetHeight() const
+{
+	return m_height;
+}
+
+void* CMemoryDeviceContext::GetBits() const
+{
+	return m_bits;
+}
+
+unsigned int CMemoryDeviceContext::GetPitch() const
+{
+	return m_width * 4;
+}
+
+void CMemoryDeviceContext::SelectBitmap(CBitmap bitmap, void* bits, unsigned int width, unsigned int height)
+{
+	HGDIOBJ previousBitmap = ::SelectObject(m_dc, bitmap);
+	if(m_oldBitmap == NULL)
+	{
+		m_oldBitmap = previousBitmap;
+	}
+	//Previous bitmap was deselected above, it can be deleted
+	m_bitmap = std::move(bitmap);
+	m_bits = bits;
+	m_width = width;
+	m_height = height;
+}
@@ -1,4 +1,5 @@
 #include <assert.h>
+#include <algorithm>
 #include "win32/TreeView.h"
 
 using namespace Framework;
@@ -150,13 +151,16 @@ bool CTreeView::Expand(HTREEITEM hItem, unsigned int nFlags)
 void CTreeView::DeleteChildren(HTREEITEM hItem)
 {
 	HTREEITEM hChild(TreeView_GetChild(m_hWnd, hItem));
+	if(hChild == NULL) return;
 
+	BeginUpdate();
 	while(hChild != NULL)
 	{
 		HTREEITEM hNext(TreeView_GetNextSibling(m_hWnd, hChild));
 		TreeView_DeleteItem(m_hWnd, hChild);
 		hChild = hNext;
 	}
+	EndUpdate();
 }
 
 bool CTreeView::DeleteAllItems()
@@ -168,3 +172,122 @@ void CTreeView::SortChildren(HTREEITEM item, bool recurse)
 {
 	TreeView_SortChildren(m_hWnd, item, recurse);
 }
+
+void CTreeView::BeginUpdate()
+{
+	if(m_updateCount++ == 0)
+	{
+		SendMessage(m_hWnd, WM_SETREDRAW, FALSE, 0);
+	}
+}
+
+void CTreeView::EndUpdate()
+{
+	assert(m_updateCount != 0);
+	if(--m_updateCount == 0)
+	{
+		SendMessage(m_hWnd, WM_SETREDRAW, TRUE, 0);
+		InvalidateRect(m_hWnd, NULL, FALSE);
+	}
+}
+
+void CTreeView::InsertItems(const TVINSERTSTRUCT* items, size_t count, HTREEITEM* handles)
+{
+	BeginUpdate();
+	for(size_t i = 0; i < count; i++)
+	{
+		HTREEITEM item = TreeView_InsertItem(m_hWnd, &items[i]);
+		if(handles)
+		{
+			handles[i] = item;
+		}
+	}
+	EndUpdate();
+}
+
+void CTreeView::EnableVirtualMode(ChildrenProvider childrenProvider, HasChildrenProvider hasChildrenProvider, ItemTextProvider itemTextProvider)
+{
+	m_childrenProvider = std::move(childrenProvider);
+	m_hasChildrenProvider = std::move(hasChildrenProvider);
+	m_itemTextProvider = std::move(itemTextProvider);
+	ResetVirtualItems();
+}
+
+void CTreeView::ResetVirtualItems()
+{
+	assert(m_childrenProvider);
+	BeginUpdate();
+	TreeView_DeleteAllItems(m_hWnd);
+	InsertVirtualChildren(TVI_ROOT, 0);
+	EndUpdate();
+}
+
+void CTreeView::ProcessNotify(WPARAM wparam, NMHDR* hdr)
+{
+	if(hdr->hwndFrom != m_hWnd) return;
+	if(!m_childrenProvider) return;
+
+	switch(hdr->code)
+	{
+	case TVN_GETDISPINFO:
+		{
+			auto& item = reinterpret_cast<NMTVDISPINFO*>(hdr)->item;
+			if((item.mask & TVIF_TEXT) && item.pszText && (item.cchTextMax > 0))
+			{
+				m_itemText.clear();
+				m_itemTextProvider(item.lParam, m_itemText);
+				size_t length = std::min<size_t>(m_itemText.size(), item.cchTextMax - 1);
+				memcpy(item.pszText, m_itemText.c_str(), length * sizeof(TCHAR));
+				item.pszText[length] = 0;
+			}
+			if(item.mask & TVIF_CHILDREN)
+			{
+				item.cChildren = m_hasChildrenProvider(item.lParam) ? 1 : 0;
+			}
+		}
+		break;
+	case TVN_ITEMEXPANDING:
+		{
+			auto treeView = reinterpret_cast<NMTREEVIEW*>(hdr);
+			if(treeView->action & TVE_EXPAND)
+			{
+				HTREEITEM item = treeView->itemNew.hItem;
+				if(TreeView_GetChild(m_hWnd, item) == NULL)
+				{
+					InsertVirtualChildren(item, treeView->itemNew.lParam);
+				}
+			}
+		}
+		break;
+	case TVN_ITEMEXPANDED:
+		{
+			auto treeView = reinterpret_cast<NMTREEVIEW*>(hdr);
+			if(treeView->action & TVE_COLLAPSE)
+			{
+				//Frees the collapsed subtree, children will be asked for again on the next expansion
+				TreeView_Expand(m_hWnd, treeView->itemNew.hItem, TVE_COLLAPSE | TVE_COLLAPSERESET);
+			}
+		}
+		break;
+	}
+}
+
+void CTreeView::InsertVirtualChildren(HTREEITEM parent, LPARAM parentParam)
+{
+	m_childParams.clear();
+	m_childrenProvider(parentParam, m_childParams);
+
+	BeginUpdate();
+	for(const auto& childParam : m_childParams)
+	{
+		TVINSERTSTRUCT insertStruct = {};
+		insertStruct.hParent			= parent;
+		insertStruct.hInsertAfter		= TVI_LAST;
+		insertStruct.item.mask			= TVIF_TEXT | TVIF_CHILDREN | TVIF_PARAM;
+		insertStruct.item.pszText		= LPSTR_TEXTCALLBACK;
+		insertStruct.item.cChildren		= I_CHILDRENCALLBACK;
+		insertStruct.item.lParam		= childParam;
+		TreeView_InsertItem(m_hWnd, &insertStruct);
+	}
+	EndUpdate();
+}
@@ -1,7 +1,12 @@
 #include "pch.h"
 #include "winrt/StorageFileStream.h"
-#include <ppltasks.h>
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
 #include <concrt.h>
+#include <robuffer.h>
+#include <wrl/client.h>
 
 using namespace Framework;
 using namespace Framework::WinRt;
@@ -23,18 +28,28 @@ ResultType WaitForSyncOp(IAsyncOperation<ResultType>^ asyncOp)
 	return asyncOp->GetResults();
 }
 
-template <typename ResultType, typename ProgressType>
-ResultType WaitForSyncOp(IAsyncOperationWithProgress<ResultType, ProgressType>^ asyncOp)
+template <typename ResultType>
+ResultType WaitForTask(Concurrency::task<ResultType> task)
 {
+	//get would throw on a thread that can't block (STA), wait on an event like WaitForSyncOp does
 	Concurrency::event sync;
-	Concurrency::task<ResultType>(asyncOp).then(
-		[&] (ResultType result)
+	task.then(
+		[&] (Concurrency::task<ResultType>)
 		{
 			sync.set();
-		}, 
+		},
 		Concurrency::task_continuation_context::use_arbitrary());
 	sync.wait();
-	return asyncOp->GetResults();
+	return task.get();
+}
+
+static const uint8* GetBufferBytes(IBuffer^ buffer)
+{
+	Microsoft::WRL::ComPtr<IBufferByteAccess> bufferByteAccess;
+	reinterpret_cast<IInspectable*>(buffer)->QueryInterface(IID_PPV_ARGS(&bufferByteAccess));
+	byte* bytes = nullptr;
+	bufferByteAccess->Buffer(&bytes);
+	return bytes;
 }
 
 CStorageFileStream::CStorageFileStream()
@@ -44,36 +59,73 @@ CStorageFileStream::CStorageFileStream()
 }
 
 CStorageFileStream::CStorageFileStream(Windows::Storage::StorageFile^ storageFile)
-: m_stream(WaitForSyncOp(storageFile->OpenAsync(FileAccessMode::Read)))
 {
-	auto myPath = storageFile->Path;
+	Open(storageFile);
 }
 
-CStorageFileStream::~CStorageFileStream()
+CStorageFileStream::CStorageFileStream(Windows::Storage::StorageFile^ storageFile, uint32 blockSize, uint32 blockCount)
+: m_blockSize(blockSize)
+, m_blockCount(blockCount)
 {
+	assert(m_blockSize != 0);
+	assert(m_blockCount != 0);
+	Open(storageFile);
+}
 
+CStorageFileStream::~CStorageFileStream()
+{
+	//Buffers of pending reads are owned by their tasks, nothing to wait for
 }
 
-void CStorageFileStream::Seek(int64, STREAM_SEEK_DIRECTION)
+void CStorageFileStream::Open(Windows::Storage::StorageFile^ storageFile)
 {
+	m_stream = WaitForSyncOp(storageFile->OpenAsync(FileAccessMode::Read));
+	m_size = m_stream->Size;
+}
 
+void CStorageFileStream::Seek(int64 position, STREAM_SEEK_DIRECTION direction)
+{
+	int64 newPosition = 0;
+	switch(direction)
+	{
+	case STREAM_SEEK_SET:
+		newPosition = position;
+		break;
+	case STREAM_SEEK_CUR:
+		newPosition = static_cast<int64>(m_position) + position;
+		break;
+	case STREAM_SEEK_END:
+		newPosition = static_cast<int64>(m_size) + position;
+		break;
+	}
+	if(newPosition < 0)
+	{
+		throw std::runtime_error("Invalid position.");
+	}
+	m_position = newPosition;
+	m_isEof = false;
 }
 
 uint64 CStorageFileStream::Tell()
 {
-	return 0;
+	return m_position;
 }
 
 uint64 CStorageFileStream::Read(void* buffer, uint64 size)
 {
-	auto tempBuffer = ref new Buffer(size);
-	WaitForSyncOp(m_stream->ReadAsync(tempBuffer, size, InputStreamOptions::None));
-	auto dataReader = DataReader::FromBuffer(tempBuffer);
-	dataReader->ReadBytes(Platform::ArrayReference<uint8>(reinterpret_cast<uint8*>(buffer), size));
-	return size;
+	if(m_blockCount != 0)
+	{
+		return ReadAhead(buffer, size);
+	}
+	uint64 readSize = ReadAt(m_position, buffer, size);
+	m_position += readSize;
+	if(readSize < size)
+	{
+		m_isEof = true;
+	}
+	return readSize;
 }
 
-
 uint64 CStorageFileStream::Write(const void*, uint64)
 {
 	return 0;
@@ -81,5 +133,108 @@ uint64 CStorageFileStream::Write(const void*, uint64)
 
 bool CStorageFileStream::IsEOF()
 {
-	return false;
+	return m_isEof;
+}
+
+uint64 CStorageFileStream::GetLength()
+{
+	return m_size;
+}
+
+bool CStorageFileStream::CanAccessAt() const
+{
+	return true;
+}
+
+uint64 CStorageFileStream::ReadAt(uint64 offset, void* buffer, uint64 size)
+{
+	return WaitForTask(ReadAtAsync(offset, buffer, size));
+}
+
+Concurrency::task<uint64> CStorageFileStream::ReadAtAsync(uint64 offset, void* buffer, uint64 size)
+{
+	if(offset >= m_size)
+	{
+		return Concurrency::task_from_result<uint64>(0);
+	}
+	size = std::min(size, m_size - offset);
+	return ReadBlockAsync(offset, static_cast<uint32>(size)).then(
+		[buffer] (IBuffer^ readBuffer)
+		{
+			uint64 readSize = readBuffer->Length;
+			memcpy(buffer, GetBufferBytes(readBuffer), static_cast<size_t>(readSize));
+			return readSize;
+		},
+		Concurrency::task_continuation_context::use_arbitrary());
+}
+
+Concurrency::task<IBuffer^> CStorageFileStream::ReadBlockAsync(uint64 offset, uint32 size)
+{
+	//Each read gets its own input stream, reads at different offsets don't share a position
+	auto inputStream = m_stream->GetInputStreamAt(offset);
+	auto buffer = ref new Buffer(size);
+	return Concurrency::create_task(inputStream->ReadAsync(buffer, size, InputStreamOptions::None));
+}
+
+uint64 CStorageFileStream::ReadAhead(void* buffer, uint64 size)
+{
+	auto output = reinterpret_cast<uint8*>(buffer);
+	uint64 totalRead = 0;
+	while(totalRead != size)
+	{
+		if(m_position >= m_size)
+		{
+			m_isEof = true;
+			break;
+		}
+
+		FillReadAhead();
+		assert(!m_blocks.empty());
+		auto& block = m_blocks.front();
+		assert((m_position >= block.offset) && (m_position < (block.offset + m_blockSize)));
+
+		IBuffer^ blockBuffer = WaitForTask(block.task);
+		uint64 blockPosition = m_position - block.offset;
+		uint64 blockLength = blockBuffer->Length;
+		if(blockPosition >= blockLength)
+		{
+			//File was shorter than expected
+			m_isEof = true;
+			break;
+		}
+
+		uint64 copySize = std::min(size - totalRead, blockLength - blockPosition);
+		memcpy(output + totalRead, GetBufferBytes(blockBuffer) + blockPosition, static_cast<size_t>(copySize));
+		totalRead += copySize;
+		m_position += copySize;
+
+		if((m_position - block.offset) >= blockLength)
+		{
+			m_blocks.pop_front();
+		}
+	}
+	return totalRead;
+}
+
+void CStorageFileStream::FillReadAhead()
+{
+	//Blocks before the position are dropped, everything is dropped after a seek outside of them
+	while(!m_blocks.empty())
+	{
+		const auto& block = m_blocks.front();
+		if((m_position >= block.offset) && (m_position < (block.offset + m_blockSize))) break;
+		m_blocks.pop_front();
+	}
+
+	uint64 nextOffset = m_blocks.empty() ?
+		(m_position - (m_position % m_blockSize)) :
+		(m_blocks.back().offset + m_blockSize);
+	while((m_blocks.size() < m_blockCount) && (nextOffset < m_size))
+	{
+		BLOCK block;
+		block.offset = nextOffset;
+		block.task = ReadBlockAsync(nextOffset, static_cast<uint32>(std::min<uint64>(m_blockSize, m_size - nextOffset)));
+		m_blocks.push_back(std::move(block));
+		nextOffset += m_blockSize;
+	}
 }
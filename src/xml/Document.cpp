@@ -0,0 +1,691 @@
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include "xml/Document.h"
+#include "xml/Scanner.h"
+#include "xml/Utils.h"
+#include "stricmp.h"
+#include "TaskGroup.h"
+#include "ThreadPool.h"
+
+using namespace Framework;
+using namespace Framework::Xml;
+
+namespace
+{
+	bool IsWhitespace(char value)
+	{
+		return (value == ' ') || (value == '\t') || (value == '\r') || (value == '\n');
+	}
+
+	char* SkipWhitespace(char* position, char* end)
+	{
+		while((position != end) && IsWhitespace(*position)) position++;
+		return position;
+	}
+
+	char* SkipName(char* position, char* end)
+	{
+		return const_cast<char*>(Scanner::FindNameEnd(position, end));
+	}
+
+	bool StartsWith(const char* position, const char* end, const char* prefix)
+	{
+		size_t size = strlen(prefix);
+		return (static_cast<size_t>(end - position) >= size) && !memcmp(position, prefix, size);
+	}
+
+	//Returns a pointer to the first occurence of the sequence
+	char* FindSequence(char* position, char* end, const char* sequence)
+	{
+		size_t size = strlen(sequence);
+		while(1)
+		{
+			auto found = reinterpret_cast<char*>(memchr(position, sequence[0], end - position));
+			if((found == nullptr) || (static_cast<size_t>(end - found) < size))
+			{
+				throw std::runtime_error("Unexpected end of document.");
+			}
+			if(!memcmp(found, sequence, size))
+			{
+				return found;
+			}
+			position = found + 1;
+		}
+	}
+
+	void ExpectChar(const char* position, const char* end, char value)
+	{
+		if((position == end) || (*position != value))
+		{
+			throw std::runtime_error(std::string("Expected '") + value + "'.");
+		}
+	}
+
+	//Goes through the markup only, keeping track of the depth, to find children of the top element
+	//starting at least 'chunkSize' bytes apart. Last split is where the top element is closed.
+	//Returns false if the document doesn't have enough of them to be worth splitting.
+	bool FindSplits(char* position, char* end, size_t chunkSize, std::vector<char*>& splits)
+	{
+		unsigned int depth = 0;
+		char* nextSplit = position + chunkSize;
+		while(1)
+		{
+			auto tagStart = reinterpret_cast<char*>(memchr(position, '<', end - position));
+			if(tagStart == nullptr) return false;
+			position = tagStart + 1;
+			if(StartsWith(position, end, "!--"))
+			{
+				position = FindSequence(position + 3, end, "-->") + 3;
+			}
+			else if(StartsWith(position, end, "![CDATA["))
+			{
+				position = FindSequence(position + 8, end, "]]>") + 3;
+			}
+			else if(StartsWith(position, end, "?"))
+			{
+				position = FindSequence(position, end, "?>") + 2;
+			}
+			else if(StartsWith(position, end, "!"))
+			{
+				position = FindSequence(position, end, ">") + 1;
+			}
+			else if(StartsWith(position, end, "/"))
+			{
+				position = FindSequence(position, end, ">") + 1;
+				if(depth == 0) return false;
+				depth--;
+				if(depth == 0)
+				{
+					splits.push_back(tagStart);
+					return (splits.size() > 1);
+				}
+			}
+			else
+			{
+				if((depth == 1) && (tagStart >= nextSplit))
+				{
+					splits.push_back(tagStart);
+					nextSplit = tagStart + chunkSize;
+				}
+				//Attribute values can have '>' in them
+				while(1)
+				{
+					position = const_cast<char*>(Scanner::FindTagEnd(position, end));
+					if(position == end)
+					{
+						throw std::runtime_error("Unexpected end of document.");
+					}
+					if(*position == '>') break;
+					auto valueEnd = reinterpret_cast<char*>(memchr(position + 1, *position, end - position - 1));
+					if(valueEnd == nullptr)
+					{
+						throw std::runtime_error("Unexpected end of document.");
+					}
+					position = valueEnd + 1;
+				}
+				bool isEmptyElement = (position[-1] == '/');
+				position++;
+				if(!isEmptyElement)
+				{
+					depth++;
+				}
+			}
+		}
+	}
+}
+
+CDocumentNode::CDocumentNode(const CDocument* document, uint32 index)
+: m_document(document)
+, m_index(index)
+{
+
+}
+
+bool CDocumentNode::IsValid() const
+{
+	return (m_document != nullptr) && (m_index != CDocument::INVALID_INDEX);
+}
+
+CDocumentNode::operator bool() const
+{
+	return IsValid();
+}
+
+bool CDocumentNode::operator ==(const CDocumentNode& rhs) const
+{
+	return (m_document == rhs.m_document) && (m_index == rhs.m_index);
+}
+
+bool CDocumentNode::operator !=(const CDocumentNode& rhs) const
+{
+	return !(*this == rhs);
+}
+
+const char* CDocumentNode::GetText() const
+{
+	return m_document->m_nodes[m_index].text.data();
+}
+
+std::string_view CDocumentNode::GetTextView() const
+{
+	return m_document->m_nodes[m_index].text;
+}
+
+const char* CDocumentNode::GetInnerText() const
+{
+	const auto& node = m_document->m_nodes[m_index];
+	if(node.childCount != 1) return nullptr;
+	return m_document->m_nodes[node.firstChild].text.data();
+}
+
+bool CDocumentNode::IsTag() const
+{
+	return m_document->m_nodes[m_index].isTag;
+}
+
+CDocumentNode CDocumentNode::GetParent() const
+{
+	return CDocumentNode(m_document, m_document->m_nodes[m_index].parent);
+}
+
+CDocumentNode CDocumentNode::GetFirstChild() const
+{
+	return CDocumentNode(m_document, m_document->m_nodes[m_index].firstChild);
+}
+
+CDocumentNode CDocumentNode::GetNextSibling() const
+{
+	return CDocumentNode(m_document, m_document->m_nodes[m_index].nextSibling);
+}
+
+unsigned int CDocumentNode::GetChildCount() const
+{
+	return m_document->m_nodes[m_index].childCount;
+}
+
+const char* CDocumentNode::GetAttribute(const char* name) const
+{
+	const auto& node = m_document->m_nodes[m_index];
+	for(uint32 i = 0; i < node.attributeCount; i++)
+	{
+		const auto& attribute = m_document->m_attributes[node.firstAttribute + i];
+		if(attribute.name == name)
+		{
+			return attribute.value.data();
+		}
+	}
+	return nullptr;
+}
+
+unsigned int CDocumentNode::GetAttributeCount() const
+{
+	return m_document->m_nodes[m_index].attributeCount;
+}
+
+const char* CDocumentNode::GetAttributeName(unsigned int index) const
+{
+	const auto& node = m_document->m_nodes[m_index];
+	return m_document->m_attributes.at(node.firstAttribute + index).name.data();
+}
+
+const char* CDocumentNode::GetAttributeValue(unsigned int index) const
+{
+	const auto& node = m_document->m_nodes[m_index];
+	return m_document->m_attributes.at(node.firstAttribute + index).value.data();
+}
+
+CDocumentNode CDocumentNode::Search(const char* name) const
+{
+	return SearchImpl(name);
+}
+
+CDocumentNode CDocumentNode::Select(const char* path) const
+{
+	auto nodes(SelectNodesImpl<true>(path));
+	if(nodes.empty()) return CDocumentNode();
+	return nodes[0];
+}
+
+CDocumentNode::NodeList CDocumentNode::SelectNodes(const char* path) const
+{
+	return SelectNodesImpl<false>(path);
+}
+
+template <bool isSingle>
+CDocumentNode::NodeList CDocumentNode::SelectNodesImpl(const char* path) const
+{
+	CDocumentNode node(*this);
+	std::string_view currentPath(path);
+
+	//Walk down to the last element of the path
+	while(1)
+	{
+		auto position = currentPath.find('/');
+		if(position == std::string_view::npos) break;
+		node = node.SearchImpl(currentPath.substr(0, position));
+		if(!node)
+		{
+			return NodeList();
+		}
+		currentPath.remove_prefix(position + 1);
+	}
+
+	NodeList result;
+	for(auto child = node.GetFirstChild(); child; child = child.GetNextSibling())
+	{
+		if(!child.HasName(currentPath)) continue;
+		result.push_back(child);
+		if(isSingle) break;
+	}
+	return result;
+}
+
+CDocumentNode CDocumentNode::SearchImpl(std::string_view name) const
+{
+	for(auto child = GetFirstChild(); child; child = child.GetNextSibling())
+	{
+		if(child.HasName(name))
+		{
+			return child;
+		}
+	}
+	return CDocumentNode();
+}
+
+bool CDocumentNode::HasName(std::string_view name) const
+{
+	const auto& node = m_document->m_nodes[m_index];
+	return node.isTag && (node.text.size() == name.size()) && !strnicmp(node.text.data(), name.data(), name.size());
+}
+
+CDocument::CDocument(std::vector<char> buffer)
+: m_buffer(std::move(buffer))
+{
+
+}
+
+CDocument::DocumentPtr CDocument::ParseDocument(CStream& stream)
+{
+	return CreateDocument(ReadStream(stream), nullptr);
+}
+
+CDocument::DocumentPtr CDocument::ParseDocument(std::vector<char> buffer)
+{
+	return CreateDocument(std::move(buffer), nullptr);
+}
+
+CDocument::DocumentPtr CDocument::ParseDocument(CStream& stream, CThreadPool& threadPool)
+{
+	return CreateDocument(ReadStream(stream), &threadPool);
+}
+
+CDocument::DocumentPtr CDocument::ParseDocument(std::vector<char> buffer, CThreadPool& threadPool)
+{
+	return CreateDocument(std::move(buffer), &threadPool);
+}
+
+std::vector<char> CDocument::ReadStream(CStream& stream)
+{
+	std::vector<char> buffer;
+	static const size_t chunkSize = 0x10000;
+	while(1)
+	{
+		size_t size = buffer.size();
+		buffer.resize(size + chunkSize);
+		size_t amount = static_cast<size_t>(stream.Read(buffer.data() + size, chunkSize));
+		buffer.resize(size + amount);
+		if((amount == 0) || stream.IsEOF()) break;
+	}
+	return buffer;
+}
+
+CDocument::DocumentPtr CDocument::CreateDocument(std::vector<char> buffer, CThreadPool* threadPool)
+{
+	auto document = DocumentPtr(new CDocument(std::move(buffer)));
+	//Keeps a spot to terminate strings that end with the document
+	document->m_buffer.push_back(0);
+	if(threadPool)
+	{
+		document->ParseParallel(*threadPool);
+	}
+	else
+	{
+		document->Parse();
+	}
+	size_t storageSize = document->m_buffer.capacity() + (document->m_nodes.capacity() * sizeof(NODE)) +
+		(document->m_attributes.capacity() * sizeof(ATTRIBUTE));
+	document->m_allocationRecord = Memory::CAllocationRecord(Memory::CAllocationTracker::SUBSYSTEM_XML, FRAMEWORK_ALLOCATION_SITE, storageSize);
+	return document;
+}
+
+CDocumentNode CDocument::GetRoot() const
+{
+	return CDocumentNode(this, 0);
+}
+
+size_t CDocument::GetNodeCount() const
+{
+	return m_nodes.size();
+}
+
+void CDocument::Parse()
+{
+	char* position = m_buffer.data();
+	char* end = position + m_buffer.size() - 1;
+
+	//Unnamed root node that holds the top level nodes
+	m_nodes.emplace_back();
+	m_nodes[0].text = std::string_view(end, 0);
+
+	if(ParseRange(position, end, 0, m_nodes, m_attributes) != 0)
+	{
+		throw std::runtime_error("Unexpected end of document.");
+	}
+
+	TerminateStrings();
+}
+
+//Chunks are parsed while the calling thread parses what comes before the first one, then they're
+//copied after it. Parsing ends with what comes after the top element.
+void CDocument::ParseParallel(CThreadPool& threadPool)
+{
+	char* position = m_buffer.data();
+	char* end = position + m_buffer.size() - 1;
+	size_t chunkSize = std::max<size_t>(MIN_PARALLEL_CHUNK_SIZE, (end - position) / (threadPool.GetMaxThreadCount() * 4));
+	std::vector<char*> splits;
+	if((static_cast<size_t>(end - position) < (MIN_PARALLEL_CHUNK_SIZE * 2)) || !FindSplits(position, end, chunkSize, splits))
+	{
+		Parse();
+		return;
+	}
+
+	m_nodes.emplace_back();
+	m_nodes[0].text = std::string_view(end, 0);
+
+	std::vector<CHUNK> chunks(splits.size() - 1);
+	uint32 top = 0;
+	{
+		CTaskGroup taskGroup(&threadPool);
+		for(size_t i = 0; i < chunks.size(); i++)
+		{
+			taskGroup.Run(
+				[&chunk = chunks[i], chunkBegin = splits[i], chunkEnd = splits[i + 1]] ()
+				{
+					chunk.nodes.emplace_back();
+					if(ParseRange(chunkBegin, chunkEnd, 0, chunk.nodes, chunk.attributes) != 0)
+					{
+						throw std::runtime_error("Unexpected end of document.");
+					}
+				});
+		}
+		//Group waits for the chunks if this throws
+		top = ParseRange(position, splits[0], 0, m_nodes, m_attributes);
+		taskGroup.Wait();
+	}
+	//The scan found the first chunk inside of the top element
+	if((top == 0) || (m_nodes[top].parent != 0))
+	{
+		throw std::runtime_error("Unexpected end of document.");
+	}
+
+	{
+		size_t nodeCount = m_nodes.size();
+		size_t attributeCount = m_attributes.size();
+		std::vector<std::pair<uint32, uint32>> bases;
+		for(const auto& chunk : chunks)
+		{
+			bases.emplace_back(static_cast<uint32>(nodeCount), static_cast<uint32>(attributeCount));
+			nodeCount += chunk.nodes.size() - 1;
+			attributeCount += chunk.attributes.size();
+		}
+		if(nodeCount >= INVALID_INDEX)
+		{
+			throw std::runtime_error("Too many nodes in document.");
+		}
+		m_nodes.resize(nodeCount);
+		m_attributes.resize(attributeCount);
+
+		CTaskGroup taskGroup(&threadPool);
+		for(size_t i = 0; i < chunks.size(); i++)
+		{
+			taskGroup.Run(
+				[this, top, &chunk = chunks[i], base = bases[i]] ()
+				{
+					AppendChunk(top, chunk, base.first, base.second);
+				});
+		}
+		taskGroup.Wait();
+
+		//Children of each chunk follow those of the previous one
+		auto& topNode = m_nodes[top];
+		for(size_t i = 0; i < chunks.size(); i++)
+		{
+			const auto& chunkTop = chunks[i].nodes[0];
+			uint32 firstChild = bases[i].first + chunkTop.firstChild - 1;
+			if(topNode.lastChild == INVALID_INDEX)
+			{
+				topNode.firstChild = firstChild;
+			}
+			else
+			{
+				m_nodes[topNode.lastChild].nextSibling = firstChild;
+			}
+			topNode.lastChild = bases[i].first + chunkTop.lastChild - 1;
+			topNode.childCount += chunkTop.childCount;
+		}
+	}
+	chunks.clear();
+
+	if(ParseRange(splits.back(), end, top, m_nodes, m_attributes) != 0)
+	{
+		throw std::runtime_error("Unexpected end of document.");
+	}
+
+	TerminateStrings();
+}
+
+//Nodes of the chunk but its first one go at 'nodeBase', which takes the place of the top element
+void CDocument::AppendChunk(uint32 top, const CHUNK& chunk, uint32 nodeBase, uint32 attributeBase)
+{
+	auto translate =
+		[&] (uint32 index)
+		{
+			if(index == INVALID_INDEX) return index;
+			return (index == 0) ? top : (nodeBase + index - 1);
+		};
+	for(size_t i = 1; i < chunk.nodes.size(); i++)
+	{
+		auto node = chunk.nodes[i];
+		node.parent = translate(node.parent);
+		node.firstChild = translate(node.firstChild);
+		node.lastChild = translate(node.lastChild);
+		node.nextSibling = translate(node.nextSibling);
+		node.firstAttribute += attributeBase;
+		m_nodes[nodeBase + i - 1] = node;
+	}
+	std::copy(std::begin(chunk.attributes), std::end(chunk.attributes), std::begin(m_attributes) + attributeBase);
+}
+
+//Parses the nodes between 'position' and 'end' as children of 'current', returns the node left open
+uint32 CDocument::ParseRange(char* position, char* end, uint32 current, std::vector<NODE>& nodes, std::vector<ATTRIBUTE>& attributes)
+{
+	while(1)
+	{
+		//Text without escape sequences is found in a single pass
+		char* textEnd = const_cast<char*>(Scanner::FindTextEnd(position, end));
+		if((textEnd != end) && (*textEnd == '&'))
+		{
+			auto tagStart = reinterpret_cast<char*>(memchr(textEnd, '<', end - textEnd));
+			textEnd = tagStart ? tagStart : end;
+		}
+		if(textEnd != position)
+		{
+			AddNode(nodes, current, UnescapeInPlace(position, textEnd), false);
+		}
+		if(textEnd == end) break;
+
+		position = textEnd + 1;
+		if(StartsWith(position, end, "!--"))
+		{
+			position = FindSequence(position + 3, end, "-->") + 3;
+		}
+		else if(StartsWith(position, end, "![CDATA["))
+		{
+			char* cdataBegin = position + 8;
+			char* cdataEnd = FindSequence(cdataBegin, end, "]]>");
+			if(cdataEnd != cdataBegin)
+			{
+				AddNode(nodes, current, std::string_view(cdataBegin, cdataEnd - cdataBegin), false);
+			}
+			position = cdataEnd + 3;
+		}
+		else if(StartsWith(position, end, "?"))
+		{
+			position = FindSequence(position, end, "?>") + 2;
+		}
+		else if(StartsWith(position, end, "!"))
+		{
+			position = FindSequence(position, end, ">") + 1;
+		}
+		else if(StartsWith(position, end, "/"))
+		{
+			char* nameBegin = position + 1;
+			char* nameEnd = SkipName(nameBegin, end);
+			std::string_view name(nameBegin, nameEnd - nameBegin);
+			const auto& currentName = nodes[current].text;
+			if((current == 0) || (currentName.size() != name.size()) || strnicmp(currentName.data(), name.data(), name.size()))
+			{
+				throw std::runtime_error("Closing tag doesn't match opening tag.");
+			}
+			position = SkipWhitespace(nameEnd, end);
+			ExpectChar(position, end, '>');
+			position++;
+			current = nodes[current].parent;
+		}
+		else
+		{
+			char* nameEnd = SkipName(position, end);
+			if(nameEnd == position)
+			{
+				throw std::runtime_error("Expected a name.");
+			}
+			uint32 nodeIndex = AddNode(nodes, current, std::string_view(position, nameEnd - position), true);
+			uint32 firstAttribute = static_cast<uint32>(attributes.size());
+			bool isEmptyElement = false;
+			position = nameEnd;
+			while(1)
+			{
+				position = SkipWhitespace(position, end);
+				if(position == end)
+				{
+					throw std::runtime_error("Unexpected end of document.");
+				}
+				if(*position == '>')
+				{
+					position++;
+					break;
+				}
+				if(*position == '/')
+				{
+					ExpectChar(position + 1, end, '>');
+					position += 2;
+					isEmptyElement = true;
+					break;
+				}
+
+				char* attributeNameEnd = SkipName(position, end);
+				if(attributeNameEnd == position)
+				{
+					throw std::runtime_error("Expected attribute name.");
+				}
+				ATTRIBUTE attribute;
+				attribute.name = std::string_view(position, attributeNameEnd - position);
+				position = SkipWhitespace(attributeNameEnd, end);
+				ExpectChar(position, end, '=');
+				position = SkipWhitespace(position + 1, end);
+				if((position == end) || ((*position != '\"') && (*position != '\'')))
+				{
+					throw std::runtime_error("Expected quoted attribute value.");
+				}
+				char quote = *position++;
+				auto valueEnd = reinterpret_cast<char*>(memchr(position, quote, end - position));
+				if(valueEnd == nullptr)
+				{
+					throw std::runtime_error("Unexpected end of document.");
+				}
+				attribute.value = UnescapeInPlace(position, valueEnd);
+				attributes.push_back(attribute);
+				position = valueEnd + 1;
+			}
+			auto& node = nodes[nodeIndex];
+			node.firstAttribute = firstAttribute;
+			node.attributeCount = static_cast<uint32>(attributes.size()) - firstAttribute;
+			if(!isEmptyElement)
+			{
+				current = nodeIndex;
+			}
+		}
+	}
+
+	return current;
+}
+
+uint32 CDocument::AddNode(std::vector<NODE>& nodes, uint32 parentIndex, std::string_view text, bool isTag)
+{
+	uint32 index = static_cast<uint32>(nodes.size());
+	NODE node;
+	node.text = text;
+	node.parent = parentIndex;
+	node.isTag = isTag;
+	nodes.push_back(node);
+
+	auto& parent = nodes[parentIndex];
+	if(parent.lastChild == INVALID_INDEX)
+	{
+		parent.firstChild = index;
+	}
+	else
+	{
+		nodes[parent.lastChild].nextSibling = index;
+	}
+	parent.lastChild = index;
+	parent.childCount++;
+	return index;
+}
+
+//Unescaped text is never longer than its source, so it can be written over it
+std::string_view CDocument::UnescapeInPlace(char* begin, char* end)
+{
+	size_t size = end - begin;
+	if(memchr(begin, '&', size) == nullptr)
+	{
+		return std::string_view(begin, size);
+	}
+	std::string result;
+	if(!UnescapeText(begin, size, result))
+	{
+		throw std::runtime_error("Invalid escape sequence.");
+	}
+	memcpy(begin, result.data(), result.size());
+	return std::string_view(begin, result.size());
+}
+
+//Character following every string is markup that isn't needed anymore
+void CDocument::TerminateStrings()
+{
+	auto terminate =
+		[] (const std::string_view& text)
+		{
+			const_cast<char*>(text.data())[text.size()] = 0;
+		};
+	for(const auto& node : m_nodes)
+	{
+		terminate(node.text);
+	}
+	for(const auto& attribute : m_attributes)
+	{
+		terminate(attribute.name);
+		terminate(attribute.value);
+	}
+}
@@ -8,10 +8,16 @@ using namespace Framework;
 using namespace Framework::Xml;
 
 CNode::CNode(std::string text, bool isTag)
-: m_text(std::move(text))
-, m_isTag(isTag)
+: m_isTag(isTag)
 {
-
+	if(isTag)
+	{
+		m_name = CInternedString(text);
+	}
+	else
+	{
+		m_text = std::move(text);
+	}
 }
 
 CNode* CNode::InsertNode(OwningNodePtr node)
@@ -42,7 +48,12 @@ void CNode::InsertNodeAt(OwningNodePtr node, OwningNodeIterator itPosition)
 
 const char* CNode::GetText() const
 {
-	return m_text.c_str();
+	return m_isTag ? m_name.c_str() : m_text.c_str();
+}
+
+CInternedString CNode::GetName() const
+{
+	return m_name;
 }
 
 const char* CNode::GetInnerText() const
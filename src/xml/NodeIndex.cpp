@@ -0,0 +1,72 @@
+#include <algorithm>
+#include <cctype>
+#include "xml/NodeIndex.h"
+
+using namespace Framework::Xml;
+
+CNodeIndex::CNodeIndex(CNode* root)
+{
+	IndexNode(root);
+}
+
+const CNodeIndex::NodeArray& CNodeIndex::GetChildren(const CNode* parent, const char* name) const
+{
+	return GetChildren(parent, MakeKey(name));
+}
+
+const CNodeIndex::NodeArray& CNodeIndex::GetChildren(const CNode* parent, const std::string& key) const
+{
+	CHILDKEY childKey;
+	childKey.parent = parent;
+	childKey.name = key;
+	auto childrenIterator = m_children.find(childKey);
+	return (childrenIterator == m_children.end()) ? m_empty : childrenIterator->second;
+}
+
+const CNodeIndex::NodeArray& CNodeIndex::GetNodes(const char* name) const
+{
+	auto nodesIterator = m_nodes.find(MakeKey(name));
+	return (nodesIterator == m_nodes.end()) ? m_empty : nodesIterator->second;
+}
+
+std::string CNodeIndex::MakeKey(const char* name)
+{
+	std::string key(name);
+	std::transform(key.begin(), key.end(), key.begin(), [] (unsigned char value) { return static_cast<char>(tolower(value)); });
+	return key;
+}
+
+void CNodeIndex::IndexNode(CNode* node)
+{
+	//Explicit stack, trees coming from large documents can be very deep
+	std::vector<CNode*> pendingNodes;
+	pendingNodes.push_back(node);
+	while(!pendingNodes.empty())
+	{
+		auto parent = pendingNodes.back();
+		pendingNodes.pop_back();
+		if(parent != node)
+		{
+			m_nodes[MakeKey(parent->GetText())].push_back(parent);
+		}
+
+		const auto& children = parent->GetChildren();
+		for(const auto& child : children)
+		{
+			if(!child->IsTag()) continue;
+			CHILDKEY childKey;
+			childKey.parent = parent;
+			childKey.name = MakeKey(child->GetText());
+			m_children[std::move(childKey)].push_back(child.get());
+		}
+
+		//Children need to come out of the stack in document order
+		for(auto childIterator = children.rbegin(); childIterator != children.rend(); childIterator++)
+		{
+			if((*childIterator)->IsTag())
+			{
+				pendingNodes.push_back(childIterator->get());
+			}
+		}
+	}
+}
@@ -1,8 +1,11 @@
+#include <cstring>
+#include <vector>
 #include "xml/Parser.h"
 #include "xml/Utils.h"
 #include "Types.h"
 #include "stricmp.h"
 #include "IosIStream.h"
+#include "SpanStream.h"
 #include <sstream>
 
 using namespace Framework;
@@ -20,11 +23,56 @@ CParser::CParser(CStream& stream, CNode* root)
 
 bool CParser::Parse()
 {
-	char nValue = 0;
-	m_stream.Read(&nValue, 1);
+	if(auto spanStream = dynamic_cast<const CSpanStream*>(&m_stream))
+	{
+		//Whole document is parsed in place, without going through a buffer
+		auto size = static_cast<size_t>(m_stream.GetRemainingLength());
+		auto data = reinterpret_cast<const char*>(spanStream->GetSpan(m_stream.Tell(), size));
+		m_stream.Seek(size, STREAM_SEEK_CUR);
+		return ParseBlock(data, data + size);
+	}
+	std::vector<char> buffer(BUFFER_SIZE);
+	while(1)
+	{
+		auto size = static_cast<size_t>(m_stream.Read(buffer.data(), buffer.size()));
+		if(size == 0) break;
+
+		if(!ParseBlock(buffer.data(), buffer.data() + size))
+		{
+			return false;
+		}
 
-	while(!m_stream.IsEOF())
+		//Some streams don't allow reading again once the end was reached
+		if(m_stream.IsEOF()) break;
+	}
+	return true;
+}
+
+bool CParser::ParseBlock(const char* position, const char* end)
+{
+	while(position != end)
 	{
+		//Characters that don't change the state are appended in runs
+		const char* stateChar = nullptr;
+		switch(m_state)
+		{
+		case STATE_TEXT:
+			stateChar = FindChar(position, end, '<', m_text);
+			break;
+		case STATE_ATTRIBUTE_VALUE:
+			stateChar = FindChar(position, end, '"', m_attributeValue);
+			break;
+		case STATE_COMMENT:
+			stateChar = FindChar(position, end, '>', m_text);
+			break;
+		default:
+			stateChar = position;
+			break;
+		}
+		if(stateChar == end) break;
+		position = stateChar + 1;
+
+		char nValue = *stateChar;
 		bool nRet = false;
 		switch(m_state)
 		{
@@ -48,11 +96,21 @@ bool CParser::Parse()
 		{
 			return false;
 		}
-		m_stream.Read(&nValue, 1);
 	}
 	return true;
 }
 
+const char* CParser::FindChar(const char* position, const char* end, char value, std::string& output)
+{
+	auto found = reinterpret_cast<const char*>(memchr(position, value, end - position));
+	if(found == nullptr)
+	{
+		found = end;
+	}
+	output.append(position, found);
+	return found;
+}
+
 bool CParser::ProcessChar_Text(char nChar)
 {
 	if(nChar == '<')
@@ -0,0 +1,225 @@
+#include "xml/Scanner.h"
+#include "BitManip.h"
+#include "CpuFeatures.h"
+#include "SimdDefs.h"
+
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+#include <emmintrin.h>
+#if defined(FRAMEWORK_SIMD_HAS_X86_DISPATCH)
+#include <immintrin.h>
+#endif
+#elif defined(FRAMEWORK_SIMD_USE_NEON)
+#include <arm_neon.h>
+#endif
+
+using namespace Framework;
+using namespace Framework::Xml;
+
+namespace
+{
+	typedef const char* (*FindFunction)(const char*, const char*);
+
+	struct TEXTEND
+	{
+		static bool Match(char value)
+		{
+			return (value == '<') || (value == '&');
+		}
+
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+		static __m128i Match(__m128i values)
+		{
+			return _mm_or_si128(_mm_cmpeq_epi8(values, _mm_set1_epi8('<')), _mm_cmpeq_epi8(values, _mm_set1_epi8('&')));
+		}
+#if defined(FRAMEWORK_SIMD_HAS_X86_DISPATCH)
+		FRAMEWORK_SIMD_TARGET_AVX2 static __m256i Match(__m256i values)
+		{
+			return _mm256_or_si256(_mm256_cmpeq_epi8(values, _mm256_set1_epi8('<')), _mm256_cmpeq_epi8(values, _mm256_set1_epi8('&')));
+		}
+#endif
+#elif defined(FRAMEWORK_SIMD_USE_NEON)
+		static uint8x16_t Match(uint8x16_t values)
+		{
+			return vorrq_u8(vceqq_u8(values, vdupq_n_u8('<')), vceqq_u8(values, vdupq_n_u8('&')));
+		}
+#endif
+	};
+
+	struct NAMEEND
+	{
+		static bool Match(char value)
+		{
+			return (value == ' ') || (value == '\t') || (value == '\r') || (value == '\n') ||
+				(value == '/') || (value == '>') || (value == '=');
+		}
+
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+		static __m128i Match(__m128i values)
+		{
+			__m128i result = _mm_cmpeq_epi8(values, _mm_set1_epi8(' '));
+			result = _mm_or_si128(result, _mm_cmpeq_epi8(values, _mm_set1_epi8('\t')));
+			result = _mm_or_si128(result, _mm_cmpeq_epi8(values, _mm_set1_epi8('\n')));
+			result = _mm_or_si128(result, _mm_cmpeq_epi8(values, _mm_set1_epi8('\r')));
+			result = _mm_or_si128(result, _mm_cmpeq_epi8(values, _mm_set1_epi8('/')));
+			result = _mm_or_si128(result, _mm_cmpeq_epi8(values, _mm_set1_epi8('>')));
+			result = _mm_or_si128(result, _mm_cmpeq_epi8(values, _mm_set1_epi8('=')));
+			return result;
+		}
+#if defined(FRAMEWORK_SIMD_HAS_X86_DISPATCH)
+		FRAMEWORK_SIMD_TARGET_AVX2 static __m256i Match(__m256i values)
+		{
+			__m256i result = _mm256_cmpeq_epi8(values, _mm256_set1_epi8(' '));
+			result = _mm256_or_si256(result, _mm256_cmpeq_epi8(values, _mm256_set1_epi8('\t')));
+			result = _mm256_or_si256(result, _mm256_cmpeq_epi8(values, _mm256_set1_epi8('\n')));
+			result = _mm256_or_si256(result, _mm256_cmpeq_epi8(values, _mm256_set1_epi8('\r')));
+			result = _mm256_or_si256(result, _mm256_cmpeq_epi8(values, _mm256_set1_epi8('/')));
+			result = _mm256_or_si256(result, _mm256_cmpeq_epi8(values, _mm256_set1_epi8('>')));
+			result = _mm256_or_si256(result, _mm256_cmpeq_epi8(values, _mm256_set1_epi8('=')));
+			return result;
+		}
+#endif
+#elif defined(FRAMEWORK_SIMD_USE_NEON)
+		static uint8x16_t Match(uint8x16_t values)
+		{
+			uint8x16_t result = vceqq_u8(values, vdupq_n_u8(' '));
+			result = vorrq_u8(result, vceqq_u8(values, vdupq_n_u8('\t')));
+			result = vorrq_u8(result, vceqq_u8(values, vdupq_n_u8('\n')));
+			result = vorrq_u8(result, vceqq_u8(values, vdupq_n_u8('\r')));
+			result = vorrq_u8(result, vceqq_u8(values, vdupq_n_u8('/')));
+			result = vorrq_u8(result, vceqq_u8(values, vdupq_n_u8('>')));
+			result = vorrq_u8(result, vceqq_u8(values, vdupq_n_u8('=')));
+			return result;
+		}
+#endif
+	};
+
+	struct TAGEND
+	{
+		static bool Match(char value)
+		{
+			return (value == '>') || (value == '\"') || (value == '\'');
+		}
+
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+		static __m128i Match(__m128i values)
+		{
+			__m128i result = _mm_cmpeq_epi8(values, _mm_set1_epi8('>'));
+			result = _mm_or_si128(result, _mm_cmpeq_epi8(values, _mm_set1_epi8('\"')));
+			result = _mm_or_si128(result, _mm_cmpeq_epi8(values, _mm_set1_epi8('\'')));
+			return result;
+		}
+#if defined(FRAMEWORK_SIMD_HAS_X86_DISPATCH)
+		FRAMEWORK_SIMD_TARGET_AVX2 static __m256i Match(__m256i values)
+		{
+			__m256i result = _mm256_cmpeq_epi8(values, _mm256_set1_epi8('>'));
+			result = _mm256_or_si256(result, _mm256_cmpeq_epi8(values, _mm256_set1_epi8('\"')));
+			result = _mm256_or_si256(result, _mm256_cmpeq_epi8(values, _mm256_set1_epi8('\'')));
+			return result;
+		}
+#endif
+#elif defined(FRAMEWORK_SIMD_USE_NEON)
+		static uint8x16_t Match(uint8x16_t values)
+		{
+			uint8x16_t result = vceqq_u8(values, vdupq_n_u8('>'));
+			result = vorrq_u8(result, vceqq_u8(values, vdupq_n_u8('\"')));
+			result = vorrq_u8(result, vceqq_u8(values, vdupq_n_u8('\'')));
+			return result;
+		}
+#endif
+	};
+
+	template <typename MatcherType>
+	const char* FindScalar(const char* begin, const char* end)
+	{
+		while((begin != end) && !MatcherType::Match(*begin))
+		{
+			begin++;
+		}
+		return begin;
+	}
+
+#if defined(FRAMEWORK_SIMD_USE_SSE)
+	template <typename MatcherType>
+	const char* FindSimd(const char* begin, const char* end)
+	{
+		while((end - begin) >= 16)
+		{
+			__m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+			uint32 mask = _mm_movemask_epi8(MatcherType::Match(values));
+			if(mask != 0)
+			{
+				return begin + __builtin_ctz(mask);
+			}
+			begin += 16;
+		}
+		return FindScalar<MatcherType>(begin, end);
+	}
+#if defined(FRAMEWORK_SIMD_HAS_X86_DISPATCH)
+	template <typename MatcherType>
+	FRAMEWORK_SIMD_TARGET_AVX2 const char* FindAvx2(const char* begin, const char* end)
+	{
+		while((end - begin) >= 32)
+		{
+			__m256i values = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin));
+			uint32 mask = _mm256_movemask_epi8(MatcherType::Match(values));
+			if(mask != 0)
+			{
+				return begin + __builtin_ctz(mask);
+			}
+			begin += 32;
+		}
+		return FindSimd<MatcherType>(begin, end);
+	}
+#endif
+#elif defined(FRAMEWORK_SIMD_USE_NEON)
+	template <typename MatcherType>
+	const char* FindSimd(const char* begin, const char* end)
+	{
+		while((end - begin) >= 16)
+		{
+			uint8x16_t values = vld1q_u8(reinterpret_cast<const uint8*>(begin));
+			//Narrow the comparison result to 4 bits per byte to get a scalar mask
+			uint8x8_t narrowed = vshrn_n_u16(vreinterpretq_u16_u8(MatcherType::Match(values)), 4);
+			uint64 mask = vget_lane_u64(vreinterpret_u64_u8(narrowed), 0);
+			if(mask != 0)
+			{
+				return begin + (__builtin_ctzll(mask) / 4);
+			}
+			begin += 16;
+		}
+		return FindScalar<MatcherType>(begin, end);
+	}
+#endif
+
+	template <typename MatcherType>
+	FindFunction SelectKernel()
+	{
+#if defined(FRAMEWORK_SIMD_HAS_X86_DISPATCH)
+		CKernelDispatcher<FindFunction> dispatcher(&FindSimd<MatcherType>);
+		dispatcher.Register(CCpuFeatures::FEATURE_AVX2, &FindAvx2<MatcherType>);
+		return dispatcher.Get();
+#elif !defined(FRAMEWORK_SIMD_USE_SCALAR)
+		return &FindSimd<MatcherType>;
+#else
+		return &FindScalar<MatcherType>;
+#endif
+	}
+}
+
+const char* Scanner::FindTextEnd(const char* begin, const char* end)
+{
+	static const FindFunction function = SelectKernel<TEXTEND>();
+	return function(begin, end);
+}
+
+const char* Scanner::FindNameEnd(const char* begin, const char* end)
+{
+	static const FindFunction function = SelectKernel<NAMEEND>();
+	return function(begin, end);
+}
+
+const char* Scanner::FindTagEnd(const char* begin, const char* end)
+{
+	static const FindFunction function = SelectKernel<TAGEND>();
+	return function(begin, end);
+}
@@ -0,0 +1,71 @@
+#include "xml/Selector.h"
+#include "xml/NodeIndex.h"
+#include "xml/FilteringNodeIterator.h"
+
+using namespace Framework::Xml;
+
+CSelector::CSelector(const char* path)
+{
+	std::string currentPath(path);
+	while(1)
+	{
+		auto position = currentPath.find('/');
+		m_segments.push_back(currentPath.substr(0, position));
+		m_keys.push_back(CNodeIndex::MakeKey(m_segments.back().c_str()));
+		if(position == std::string::npos) break;
+		currentPath.erase(0, position + 1);
+	}
+}
+
+CNode* CSelector::Select(CNode* node, const CNodeIndex* index) const
+{
+	auto nodes(SelectNodesImpl<true>(node, index));
+	if(nodes.empty()) return nullptr;
+	return *nodes.begin();
+}
+
+CNode::NodeList CSelector::SelectNodes(CNode* node, const CNodeIndex* index) const
+{
+	return SelectNodesImpl<false>(node, index);
+}
+
+template <bool isSingle>
+CNode::NodeList CSelector::SelectNodesImpl(CNode* node, const CNodeIndex* index) const
+{
+	size_t lastSegment = m_segments.size() - 1;
+	if(index)
+	{
+		for(size_t i = 0; i < lastSegment; i++)
+		{
+			const auto& children = index->GetChildren(node, m_keys[i]);
+			if(children.empty())
+			{
+				return CNode::NodeList();
+			}
+			node = children[0];
+		}
+		const auto& children = index->GetChildren(node, m_keys[lastSegment]);
+		if(isSingle && !children.empty())
+		{
+			return CNode::NodeList(1, children[0]);
+		}
+		return CNode::NodeList(children.begin(), children.end());
+	}
+
+	for(size_t i = 0; i < lastSegment; i++)
+	{
+		node = node->Search(m_segments[i].c_str());
+		if(node == nullptr)
+		{
+			return CNode::NodeList();
+		}
+	}
+
+	CNode::NodeList result;
+	for(CFilteringNodeIterator itNode(node, m_segments[lastSegment].c_str()); !itNode.IsEnd(); itNode++)
+	{
+		result.push_back(*itNode);
+		if(isSingle) break;
+	}
+	return result;
+}
@@ -0,0 +1,394 @@
+#include <cstring>
+#include <stdexcept>
+#include "xml/StreamParser.h"
+#include "xml/Scanner.h"
+#include "xml/Utils.h"
+
+using namespace Framework;
+using namespace Framework::Xml;
+
+namespace
+{
+	bool IsWhitespace(char value)
+	{
+		return (value == ' ') || (value == '\t') || (value == '\r') || (value == '\n');
+	}
+}
+
+CStreamParser::CStreamParser(CStream& stream)
+	: m_stream(stream)
+{
+
+}
+
+CStreamParser::EVENT CStreamParser::Next()
+{
+	if(m_isEmptyElement)
+	{
+		//Start event of an empty element was reported, report its end
+		m_isEmptyElement = false;
+		m_name = std::move(m_elements.back());
+		m_elements.pop_back();
+		m_attributes.clear();
+		m_event = EVENT_END_ELEMENT;
+		return m_event;
+	}
+
+	while(1)
+	{
+		char value = 0;
+		if(!PeekChar(value))
+		{
+			if(!m_elements.empty())
+			{
+				throw std::runtime_error("Unexpected end of document.");
+			}
+			m_event = EVENT_END_DOCUMENT;
+			return m_event;
+		}
+
+		if(value != '<')
+		{
+			ReadText();
+			if(!UnescapeText(m_rawText.data(), m_rawText.size(), m_text))
+			{
+				throw std::runtime_error("Invalid escape sequence in text.");
+			}
+			m_event = EVENT_TEXT;
+			return m_event;
+		}
+
+		if(StartsWith("<![CDATA[", 9))
+		{
+			m_stream.Consume(9);
+			m_text.clear();
+			ReadUntil("]]>", 3, &m_text);
+			m_event = EVENT_TEXT;
+			return m_event;
+		}
+
+		if(SkipMarkup())
+		{
+			continue;
+		}
+
+		if(StartsWith("</", 2))
+		{
+			ParseEndTag();
+			m_event = EVENT_END_ELEMENT;
+		}
+		else
+		{
+			ParseStartTag();
+			m_event = EVENT_START_ELEMENT;
+		}
+		return m_event;
+	}
+}
+
+void CStreamParser::SkipSubtree()
+{
+	if(m_event != EVENT_START_ELEMENT)
+	{
+		throw std::runtime_error("SkipSubtree must be called after a start element event.");
+	}
+	m_event = EVENT_END_ELEMENT;
+	m_attributes.clear();
+	if(m_isEmptyElement)
+	{
+		m_isEmptyElement = false;
+		m_elements.pop_back();
+		return;
+	}
+
+	//Nothing in the subtree is kept, only keep track of nesting
+	unsigned int depth = 1;
+	while(1)
+	{
+		ReadText();
+		if(StartsWith("<![CDATA[", 9))
+		{
+			m_stream.Consume(9);
+			ReadUntil("]]>", 3, nullptr);
+			continue;
+		}
+		if(SkipMarkup())
+		{
+			continue;
+		}
+		if(StartsWith("</", 2))
+		{
+			ReadUntil(">", 1, nullptr);
+			if(--depth == 0) break;
+			continue;
+		}
+
+		//Start tag, need to go over attribute values to find the end of the tag
+		ReadChar();
+		char quote = 0;
+		char prevValue = 0;
+		while(1)
+		{
+			char value = ReadChar();
+			if(quote != 0)
+			{
+				if(value == quote) quote = 0;
+			}
+			else if((value == '\"') || (value == '\''))
+			{
+				quote = value;
+			}
+			else if(value == '>')
+			{
+				break;
+			}
+			prevValue = value;
+		}
+		if(prevValue != '/')
+		{
+			depth++;
+		}
+	}
+
+	m_name = std::move(m_elements.back());
+	m_elements.pop_back();
+}
+
+const std::string& CStreamParser::GetName() const
+{
+	return m_name;
+}
+
+const std::string& CStreamParser::GetText() const
+{
+	return m_text;
+}
+
+const CStreamParser::AttributeList& CStreamParser::GetAttributes() const
+{
+	return m_attributes;
+}
+
+const char* CStreamParser::GetAttribute(const char* name) const
+{
+	for(const auto& attribute : m_attributes)
+	{
+		if(attribute.first == name)
+		{
+			return attribute.second.c_str();
+		}
+	}
+	return nullptr;
+}
+
+unsigned int CStreamParser::GetDepth() const
+{
+	return static_cast<unsigned int>(m_elements.size());
+}
+
+bool CStreamParser::PeekChar(char& value)
+{
+	const uint8* data = nullptr;
+	if(m_stream.Peek(data, 1) == 0)
+	{
+		return false;
+	}
+	value = static_cast<char>(data[0]);
+	return true;
+}
+
+char CStreamParser::ReadChar()
+{
+	char value = 0;
+	if(!PeekChar(value))
+	{
+		throw std::runtime_error("Unexpected end of document.");
+	}
+	m_stream.Consume(1);
+	return value;
+}
+
+void CStreamParser::SkipWhitespace()
+{
+	char value = 0;
+	while(PeekChar(value) && IsWhitespace(value))
+	{
+		m_stream.Consume(1);
+	}
+}
+
+bool CStreamParser::StartsWith(const char* prefix, size_t size)
+{
+	const uint8* data = nullptr;
+	size_t available = m_stream.Peek(data, size);
+	return (available >= size) && !memcmp(data, prefix, size);
+}
+
+//Consumes everything up to and including the terminator, what comes before it is appended to the output
+void CStreamParser::ReadUntil(const char* terminator, size_t terminatorSize, std::string* output)
+{
+	while(1)
+	{
+		const uint8* data = nullptr;
+		size_t available = m_stream.Peek(data, terminatorSize);
+		if(available < terminatorSize)
+		{
+			throw std::runtime_error("Unexpected end of document.");
+		}
+		auto begin = reinterpret_cast<const char*>(data);
+		auto found = reinterpret_cast<const char*>(memchr(begin, terminator[0], available));
+		if(found == nullptr)
+		{
+			if(output) output->append(begin, available);
+			m_stream.Consume(available);
+			continue;
+		}
+		size_t offset = found - begin;
+		if(output) output->append(begin, offset);
+		m_stream.Consume(offset);
+		if(StartsWith(terminator, terminatorSize))
+		{
+			m_stream.Consume(terminatorSize);
+			return;
+		}
+		if(output) (*output) += terminator[0];
+		m_stream.Consume(1);
+	}
+}
+
+void CStreamParser::ReadName(std::string& name)
+{
+	name.clear();
+	while(1)
+	{
+		const uint8* data = nullptr;
+		size_t available = m_stream.Peek(data, 1);
+		if(available == 0) break;
+		auto begin = reinterpret_cast<const char*>(data);
+		auto nameEnd = Scanner::FindNameEnd(begin, begin + available);
+		name.append(begin, nameEnd);
+		m_stream.Consume(nameEnd - begin);
+		if(nameEnd != (begin + available)) break;
+	}
+	if(name.empty())
+	{
+		throw std::runtime_error("Expected a name.");
+	}
+}
+
+//Reads raw text up to the next markup, returns false if the end of the document was reached
+bool CStreamParser::ReadText()
+{
+	m_rawText.clear();
+	m_text.clear();
+	while(1)
+	{
+		const uint8* data = nullptr;
+		size_t available = m_stream.Peek(data, 1);
+		if(available == 0)
+		{
+			return false;
+		}
+		auto begin = reinterpret_cast<const char*>(data);
+		auto found = reinterpret_cast<const char*>(memchr(begin, '<', available));
+		size_t size = found ? (found - begin) : available;
+		m_rawText.append(begin, size);
+		m_stream.Consume(size);
+		if(found)
+		{
+			return true;
+		}
+	}
+}
+
+//Skips comments, processing instructions and declarations
+bool CStreamParser::SkipMarkup()
+{
+	if(StartsWith("<!--", 4))
+	{
+		m_stream.Consume(4);
+		ReadUntil("-->", 3, nullptr);
+		return true;
+	}
+	if(StartsWith("<?", 2))
+	{
+		ReadUntil("?>", 2, nullptr);
+		return true;
+	}
+	if(StartsWith("<!", 2))
+	{
+		ReadUntil(">", 1, nullptr);
+		return true;
+	}
+	return false;
+}
+
+void CStreamParser::ParseStartTag()
+{
+	m_stream.Consume(1);
+	m_attributes.clear();
+	ReadName(m_name);
+	while(1)
+	{
+		SkipWhitespace();
+		char value = 0;
+		if(!PeekChar(value))
+		{
+			throw std::runtime_error("Unexpected end of document.");
+		}
+		if(value == '>')
+		{
+			m_stream.Consume(1);
+			break;
+		}
+		if(value == '/')
+		{
+			m_stream.Consume(1);
+			if(ReadChar() != '>')
+			{
+				throw std::runtime_error("Expected '>' after '/'.");
+			}
+			m_isEmptyElement = true;
+			break;
+		}
+
+		AttributeType attribute;
+		ReadName(attribute.first);
+		SkipWhitespace();
+		if(ReadChar() != '=')
+		{
+			throw std::runtime_error("Expected '=' after attribute name.");
+		}
+		SkipWhitespace();
+		char quote = ReadChar();
+		if((quote != '\"') && (quote != '\''))
+		{
+			throw std::runtime_error("Expected quoted attribute value.");
+		}
+		m_rawText.clear();
+		ReadUntil(&quote, 1, &m_rawText);
+		if(!UnescapeText(m_rawText.data(), m_rawText.size(), attribute.second))
+		{
+			throw std::runtime_error("Invalid escape sequence in attribute value.");
+		}
+		m_attributes.push_back(std::move(attribute));
+	}
+	m_elements.push_back(m_name);
+}
+
+void CStreamParser::ParseEndTag()
+{
+	m_stream.Consume(2);
+	m_attributes.clear();
+	ReadName(m_name);
+	SkipWhitespace();
+	if(ReadChar() != '>')
+	{
+		throw std::runtime_error("Expected '>' at end of closing tag.");
+	}
+	if(m_elements.empty() || (m_elements.back() != m_name))
+	{
+		throw std::runtime_error("Closing tag doesn't match opening tag.");
+	}
+	m_elements.pop_back();
+}
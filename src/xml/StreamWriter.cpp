@@ -0,0 +1,171 @@
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include "xml/StreamWriter.h"
+#include "xml/Utils.h"
+
+using namespace Framework;
+using namespace Framework::Xml;
+
+CStreamWriter::CStreamWriter(CStream& stream, size_t bufferSize)
+: m_stream(stream)
+, m_buffer(std::max<size_t>(bufferSize, 1))
+{
+
+}
+
+CStreamWriter::~CStreamWriter()
+{
+	Flush();
+}
+
+void CStreamWriter::BeginElement(const char* name)
+{
+	if(!m_elements.empty())
+	{
+		if(m_isStartTagOpen)
+		{
+			WriteRaw(">\r\n");
+			m_isStartTagOpen = false;
+		}
+		else if(m_isLineOpen)
+		{
+			WriteRaw("\r\n");
+		}
+		m_elements.back().hasChildren = true;
+	}
+	m_isLineOpen = false;
+
+	WriteTabs(static_cast<unsigned int>(m_elements.size()));
+	WriteRaw("<");
+	WriteRaw(name);
+
+	ELEMENT element;
+	element.name = name;
+	m_elements.push_back(std::move(element));
+	m_isStartTagOpen = true;
+}
+
+void CStreamWriter::Attribute(const char* name, const char* value)
+{
+	if(!m_isStartTagOpen)
+	{
+		throw std::runtime_error("Attributes must be written before the element's content.");
+	}
+	WriteRaw(" ");
+	WriteRaw(name);
+	WriteRaw("=\"");
+	WriteEscaped(value, strlen(value));
+	WriteRaw("\"");
+}
+
+void CStreamWriter::Text(const char* text)
+{
+	Text(text, strlen(text));
+}
+
+void CStreamWriter::Text(const char* text, size_t size)
+{
+	CloseStartTag();
+	WriteEscaped(text, size);
+	m_isLineOpen = true;
+}
+
+void CStreamWriter::EndElement()
+{
+	if(m_elements.empty())
+	{
+		throw std::runtime_error("No element to end.");
+	}
+	const auto& element = m_elements.back();
+	if(m_isStartTagOpen)
+	{
+		WriteRaw(" />\r\n");
+		m_isStartTagOpen = false;
+	}
+	else
+	{
+		if(element.hasChildren)
+		{
+			if(m_isLineOpen)
+			{
+				WriteRaw("\r\n");
+			}
+			WriteTabs(static_cast<unsigned int>(m_elements.size() - 1));
+		}
+		WriteRaw("</");
+		WriteRaw(element.name.c_str(), element.name.size());
+		WriteRaw(">\r\n");
+	}
+	m_isLineOpen = false;
+	m_elements.pop_back();
+}
+
+void CStreamWriter::Flush()
+{
+	if(m_bufferSize != 0)
+	{
+		m_stream.Write(m_buffer.data(), m_bufferSize);
+		m_bufferSize = 0;
+	}
+}
+
+void CStreamWriter::CloseStartTag()
+{
+	if(m_isStartTagOpen)
+	{
+		WriteRaw(">");
+		m_isStartTagOpen = false;
+	}
+}
+
+void CStreamWriter::WriteRaw(const char* text)
+{
+	WriteRaw(text, strlen(text));
+}
+
+void CStreamWriter::WriteRaw(const char* data, size_t size)
+{
+	if(size > (m_buffer.size() - m_bufferSize))
+	{
+		Flush();
+		if(size >= m_buffer.size())
+		{
+			m_stream.Write(data, size);
+			return;
+		}
+	}
+	memcpy(m_buffer.data() + m_bufferSize, data, size);
+	m_bufferSize += size;
+}
+
+void CStreamWriter::WriteEscaped(const char* text, size_t size)
+{
+	const char* textEnd = text + size;
+	while(text != textEnd)
+	{
+		//Characters that don't need to be escaped are copied in runs
+		const char* runEnd = text;
+		const char* escapeSequence = nullptr;
+		while((runEnd != textEnd) && ((escapeSequence = GetEscapeSequence(*runEnd)) == nullptr))
+		{
+			runEnd++;
+		}
+		WriteRaw(text, runEnd - text);
+		if(runEnd == textEnd) break;
+		WriteRaw(escapeSequence);
+		text = runEnd + 1;
+	}
+}
+
+void CStreamWriter::WriteTabs(unsigned int count)
+{
+	static const char tabs[] = "\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t";
+	static const unsigned int maxTabs = sizeof(tabs) - 1;
+	while(count != 0)
+	{
+		unsigned int amount = std::min(count, maxTabs);
+		WriteRaw(tabs, amount);
+		count -= amount;
+	}
+}
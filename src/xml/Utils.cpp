@@ -3,6 +3,7 @@
 #include <string.h>
 #include <stdexcept>
 #include "xml/Utils.h"
+#include "math/MathStringUtils.h"
 #include "string_format.h"
 
 using namespace Framework;
@@ -174,7 +175,7 @@ bool Xml::GetAttributeFloatValue(Xml::CNode* node, const char* name, float* valu
 		return false;
 	}
 
-	(*value) = static_cast<float>(atof(text));
+	(*value) = MathStringUtils::ParseFloat(text);
 	return true;
 }
 
@@ -290,8 +291,7 @@ Xml::AttributeType Xml::CreateAttributeInt64Value(const char* sName, int64 nValu
 
 Xml::AttributeType Xml::CreateAttributeFloatValue(const char* sName, float nValue)
 {
-	auto sValue = string_format("%f", nValue);
-	return AttributeType(sName, sValue);
+	return AttributeType(sName, MathStringUtils::ToString(nValue));
 }
 
 Xml::AttributeType Xml::CreateAttributeBoolValue(const char* sName, bool nValue)
@@ -305,37 +305,41 @@ std::string Xml::EscapeText(const std::string& text)
 	for(auto charIterator(text.begin());
 		charIterator != text.end(); charIterator++)
 	{
-		switch(*charIterator)
+		if(auto escapeSequence = GetEscapeSequence(*charIterator))
+		{
+			result += escapeSequence;
+		}
+		else
 		{
-		case '&':
-			result += "&amp;";
-			break;
-		case '<':
-			result += "&lt;";
-			break;
-		case '>':
-			result += "&gt;";
-			break;
-		case '\'':
-			result += "&apos;";
-			break;
-		case '\"':
-			result += "&quot;";
-			break;
-		case '\n':
-			result += "&#x0A;";
-			break;
-		case '\r':
-			result += "&#x0D;";
-			break;
-		default:
 			result += *charIterator;
-			break;
 		}
 	}
 	return result;
 }
 
+const char* Xml::GetEscapeSequence(char value)
+{
+	switch(value)
+	{
+	case '&':
+		return "&amp;";
+	case '<':
+		return "&lt;";
+	case '>':
+		return "&gt;";
+	case '\'':
+		return "&apos;";
+	case '\"':
+		return "&quot;";
+	case '\n':
+		return "&#x0A;";
+	case '\r':
+		return "&#x0D;";
+	default:
+		return nullptr;
+	}
+}
+
 std::string Xml::UnescapeText(const std::string& text)
 {
 	auto ampPos = text.find('&');
@@ -344,42 +348,51 @@ std::string Xml::UnescapeText(const std::string& text)
 		return text;
 	}
 	std::string result;
-	for(auto charIterator(text.begin());
-		charIterator != text.end(); charIterator++)
+	if(!UnescapeText(text.data(), text.size(), result))
 	{
-		if(*charIterator == '&')
+		return "";
+	}
+	return result;
+}
+
+bool Xml::UnescapeText(const char* text, size_t size, std::string& result)
+{
+	const char* textEnd = text + size;
+	while(text != textEnd)
+	{
+		//Copy everything up to the next escape sequence in one go
+		auto ampPos = reinterpret_cast<const char*>(memchr(text, '&', textEnd - text));
+		if(ampPos == nullptr)
 		{
-			std::string::size_type currentPos = charIterator - text.begin();
-			std::string::size_type endPos = text.find(';', currentPos);
-			if(endPos == -1)
-			{
-				return "";
-			}
-			std::string escapeName(text.substr(currentPos + 1, endPos - currentPos - 1));
-					if(!strcmp(escapeName.c_str(), "amp"))	result += '&';
-			else	if(!strcmp(escapeName.c_str(), "lt"))	result += '<';
-			else	if(!strcmp(escapeName.c_str(), "gt"))	result += '>';
-			else	if(!strcmp(escapeName.c_str(), "apos"))	result += '\'';
-			else	if(!strcmp(escapeName.c_str(), "quot"))	result += '\"';
-			else	if(escapeName.find("#x") == 0)
-			{
-				//TODO: Handle this better (ie.: handle encoding and such)
-				char value = static_cast<char>(strtol(escapeName.c_str() + 2, nullptr, 16));
-				if(value != 0)
-				{
-					result += value;
-				}
-			}
-			else
+			result.append(text, textEnd);
+			break;
+		}
+		result.append(text, ampPos);
+		auto endPos = reinterpret_cast<const char*>(memchr(ampPos, ';', textEnd - ampPos));
+		if(endPos == nullptr)
+		{
+			return false;
+		}
+		std::string escapeName(ampPos + 1, endPos);
+				if(!strcmp(escapeName.c_str(), "amp"))	result += '&';
+		else	if(!strcmp(escapeName.c_str(), "lt"))	result += '<';
+		else	if(!strcmp(escapeName.c_str(), "gt"))	result += '>';
+		else	if(!strcmp(escapeName.c_str(), "apos"))	result += '\'';
+		else	if(!strcmp(escapeName.c_str(), "quot"))	result += '\"';
+		else	if(escapeName.find("#x") == 0)
+		{
+			//TODO: Handle this better (ie.: handle encoding and such)
+			char value = static_cast<char>(strtol(escapeName.c_str() + 2, nullptr, 16));
+			if(value != 0)
 			{
-				return "";
+				result += value;
 			}
-			charIterator = text.begin() + endPos;
 		}
 		else
 		{
-			result += *charIterator;
+			return false;
 		}
+		text = endPos + 1;
 	}
-	return result;
+	return true;
 }
@@ -1,12 +1,11 @@
 #include <string.h>
 #include "xml/Writer.h"
-#include "xml/Utils.h"
 
 using namespace Framework;
 using namespace Framework::Xml;
 
 CWriter::CWriter(CStream& stream)
-: m_stream(stream)
+: m_writer(stream)
 {
 
 }
@@ -15,6 +14,7 @@ void CWriter::WriteDocument(CStream& stream, CNode* node)
 {
 	CWriter writer(stream);
 	writer.WriteNode(node, 0);
+	writer.m_writer.Flush();
 }
 
 void CWriter::WriteNode(CNode* currentNode, unsigned int level)
@@ -52,7 +52,8 @@ void CWriter::WriteNode(CNode* currentNode, unsigned int level)
 			DumpAttributes(currentNode);
 			DumpString(">");
 
-			DumpString(EscapeText(currentNode->GetInnerText()).c_str());
+			auto innerText = currentNode->GetInnerText();
+			m_writer.WriteEscaped(innerText, strlen(innerText));
 
 			DumpString("</");
 			DumpString(currentNode->GetText());
@@ -81,16 +82,12 @@ void CWriter::WriteNode(CNode* currentNode, unsigned int level)
 
 void CWriter::DumpString(const char* sString)
 {
-	m_stream.Write(sString, (unsigned int)strlen(sString));
+	m_writer.WriteRaw(sString);
 }
 
 void CWriter::DumpTabs(unsigned int nCount)
 {
-	unsigned int i;
-	for(i = 0; i < nCount; i++)
-	{
-		m_stream.Write8('\t');
-	}
+	m_writer.WriteTabs(nCount);
 }
 
 void CWriter::DumpAttributes(CNode* node)
@@ -100,7 +97,7 @@ void CWriter::DumpAttributes(CNode* node)
 		DumpString(" ");
 		DumpString(attribute.first.c_str());
 		DumpString("=\"");
-		DumpString(EscapeText(attribute.second).c_str());
+		m_writer.WriteEscaped(attribute.second.c_str(), attribute.second.size());
 		DumpString("\"");
 	}
 }
@@ -3,23 +3,95 @@
 #include <functional>
 #include <stdexcept>
 #include <regex>
+#include <cstdint>
+#include <cstring>
 #include "zip/ZipArchiveReader.h"
 #include "zip/ZipInflateStream.h"
 #include "zip/ZipStoreStream.h"
+#include "zip/ZipZstdDecompressStream.h"
+#include "HashUtils.h"
+#include "SpanStream.h"
+#include "TaskGroup.h"
 #include "alloca_def.h"
 
 using namespace Framework;
 using namespace Zip;
 
+namespace
+{
+	//Reads from a shared stream with positional reads, keeping its own position
+	class CPositionalStream : public CStream
+	{
+	public:
+		CPositionalStream(CStream& stream, uint64 position)
+		    : m_stream(stream)
+		    , m_position(position)
+		{
+		}
+
+		void Seek(int64 position, STREAM_SEEK_DIRECTION direction) override
+		{
+			switch(direction)
+			{
+			case STREAM_SEEK_SET:
+				m_position = position;
+				break;
+			case STREAM_SEEK_CUR:
+				m_position += position;
+				break;
+			default:
+				throw std::runtime_error("Unsupported operation.");
+			}
+		}
+
+		uint64 Tell() override
+		{
+			return m_position;
+		}
+
+		uint64 Read(void* buffer, uint64 size) override
+		{
+			uint64 amountRead = m_stream.ReadAt(m_position, buffer, size);
+			m_position += amountRead;
+			m_isEof = (amountRead != size);
+			return amountRead;
+		}
+
+		uint64 Write(const void*, uint64) override
+		{
+			throw std::runtime_error("Unsupported operation.");
+		}
+
+		bool IsEOF() override
+		{
+			return m_isEof;
+		}
+
+	private:
+		CStream& m_stream;
+		uint64 m_position = 0;
+		bool m_isEof = false;
+	};
+}
+
 CZipArchiveReader::CZipArchiveReader(CStream& stream) :
 m_stream(stream),
 m_readingLock(false)
 {
+	m_spanStream = dynamic_cast<const CSpanStream*>(&m_stream);
 	Read(m_stream);
 }
 
 const CZipArchiveReader::FileHeaderList& CZipArchiveReader::GetFileHeaders() const
 {
+	std::call_once(m_filesInitFlag,
+		[this] ()
+		{
+			for(const auto& entry : m_entries)
+			{
+				m_files.emplace_hint(std::end(m_files), std::string(entry.name), entry.header);
+			}
+		});
 	return m_files;
 }
 
@@ -30,45 +102,34 @@ CZipArchiveReader::StreamPtr CZipArchiveReader::BeginReadFile(const char* fileNa
 		throw std::runtime_error("Stream already locked.");
 	}
 
-	const ZIPDIRFILEHEADER* dirFileHeader = GetFileHeader(fileName);
-	if(dirFileHeader == NULL)
+	auto entry = FindEntry(fileName);
+	if(entry == NULL)
 	{
 		throw std::runtime_error("File not found.");
 	}
 
-	uint32 offset = dirFileHeader->fileStartOffset;
-	m_stream.Seek(offset, STREAM_SEEK_SET);
-
-	ZIPFILEHEADER fileHeader;
-	m_stream.Read(&fileHeader, sizeof(ZIPFILEHEADER));
-	if(fileHeader.signature != FILEHEADER_SIG)
-	{
-		throw std::runtime_error("Error in zip archive.");
-	}
-	m_stream.Seek(fileHeader.fileNameLength, STREAM_SEEK_CUR);
-	m_stream.Seek(fileHeader.extraFieldLength, STREAM_SEEK_CUR);
+	m_stream.Seek(entry->info.fileStartOffset, STREAM_SEEK_SET);
+	auto fileHeader = ReadFileHeader(m_stream);
+	uint64 compressedSize = entry->info.compressedSize;
 
 	StreamPtr resultStream;
-	if(fileHeader.compressionMethod == COMPRESSION_METHOD::DEFLATE || fileHeader.compressionMethod == COMPRESSION_METHOD::ZSTD)
+	if(fileHeader.compressionMethod == COMPRESSION_METHOD::DEFLATE)
 	{
 		//Deflate
-		uint32 compressedSize = fileHeader.compressedSize;
-		if(compressedSize == 0)
-		{
-			compressedSize = dirFileHeader->compressedSize;
-		}
 		resultStream = StreamPtr(
-			new CZipInflateStream(m_stream, compressedSize),
+			CreateInflateStream(m_stream, compressedSize).release(),
+			std::bind(&CZipArchiveReader::EndReadFile, this, std::placeholders::_1));
+	}
+	else if(fileHeader.compressionMethod == COMPRESSION_METHOD::ZSTD)
+	{
+		//Zstandard
+		resultStream = StreamPtr(
+			new CZipZstdDecompressStream(m_stream, compressedSize),
 			std::bind(&CZipArchiveReader::EndReadFile, this, std::placeholders::_1));
 	}
 	else if(fileHeader.compressionMethod == COMPRESSION_METHOD::STORE)
 	{
 		//Store
-		uint32 compressedSize = fileHeader.compressedSize;
-		if(compressedSize == 0)
-		{
-			compressedSize = dirFileHeader->compressedSize;
-		}
 		resultStream = StreamPtr(
 			new CZipStoreStream(m_stream, compressedSize),
 			std::bind(&CZipArchiveReader::EndReadFile, this, std::placeholders::_1));
@@ -81,6 +142,159 @@ CZipArchiveReader::StreamPtr CZipArchiveReader::BeginReadFile(const char* fileNa
 	return resultStream;
 }
 
+uint64 CZipArchiveReader::GetStoredFileDataOffset(std::string_view fileName) const
+{
+	auto entry = FindEntry(fileName);
+	if(entry == NULL)
+	{
+		throw std::runtime_error("File not found.");
+	}
+
+	ZIPFILEHEADER fileHeader;
+	if(m_stream.CanAccessAt())
+	{
+		CPositionalStream stream(m_stream, entry->info.fileStartOffset);
+		fileHeader = ReadFileHeader(stream);
+	}
+	else
+	{
+		if(m_readingLock)
+		{
+			throw std::runtime_error("Stream already locked.");
+		}
+		m_stream.Seek(entry->info.fileStartOffset, STREAM_SEEK_SET);
+		fileHeader = ReadFileHeader(m_stream);
+	}
+	if(fileHeader.compressionMethod != COMPRESSION_METHOD::STORE)
+	{
+		throw std::runtime_error("Zip entry isn't stored.");
+	}
+	return entry->info.fileStartOffset + sizeof(ZIPFILEHEADER) + fileHeader.fileNameLength + fileHeader.extraFieldLength;
+}
+
+void CZipArchiveReader::ExtractMany(const FileNameList& fileNames, const ExtractSink& sink, bool verifyCrc, CThreadPool* threadPool)
+{
+	//Look everything up first to fail before doing any work
+	std::vector<std::pair<const std::string*, const DIRECTORYENTRY*>> entries;
+	entries.reserve(fileNames.size());
+	for(const auto& fileName : fileNames)
+	{
+		auto entry = FindEntry(fileName);
+		if(entry == NULL)
+		{
+			throw std::runtime_error("File not found.");
+		}
+		entries.push_back(std::make_pair(&fileName, entry));
+	}
+
+	if(!m_stream.CanAccessAt())
+	{
+		//Sequential reads would interfere with a stream returned by BeginReadFile
+		if(m_readingLock)
+		{
+			throw std::runtime_error("Stream already locked.");
+		}
+		for(const auto& entry : entries)
+		{
+			m_stream.Seek(entry.second->info.fileStartOffset, STREAM_SEEK_SET);
+			auto data = ReadFileData(m_stream, *entry.second, verifyCrc);
+			sink(*entry.first, data.data(), data.size());
+		}
+		return;
+	}
+
+	CTaskGroup taskGroup(threadPool);
+	for(const auto& entry : entries)
+	{
+		taskGroup.Run(
+			[&, entry] ()
+			{
+				CPositionalStream stream(m_stream, entry.second->info.fileStartOffset);
+				auto data = ReadFileData(stream, *entry.second, verifyCrc);
+				sink(*entry.first, data.data(), data.size());
+			});
+	}
+	taskGroup.Wait();
+}
+
+void CZipArchiveReader::ExtractAll(const ExtractSink& sink, bool verifyCrc, CThreadPool* threadPool)
+{
+	FileNameList fileNames;
+	for(const auto& entry : m_entries)
+	{
+		fileNames.push_back(std::string(entry.name));
+	}
+	ExtractMany(fileNames, sink, verifyCrc, threadPool);
+}
+
+//Reads the local header at the current position of the stream and leaves the stream at the start of the data.
+//Sizes are taken from the directory, they're not in the local header when a data descriptor is used.
+ZIPFILEHEADER CZipArchiveReader::ReadFileHeader(CStream& stream)
+{
+	ZIPFILEHEADER fileHeader;
+	if((stream.Read(&fileHeader, sizeof(ZIPFILEHEADER)) != sizeof(ZIPFILEHEADER)) || (fileHeader.signature != FILEHEADER_SIG))
+	{
+		throw std::runtime_error("Error in zip archive.");
+	}
+	stream.Seek(fileHeader.fileNameLength, STREAM_SEEK_CUR);
+	stream.Seek(fileHeader.extraFieldLength, STREAM_SEEK_CUR);
+	return fileHeader;
+}
+
+std::unique_ptr<CZipInflateStream> CZipArchiveReader::CreateInflateStream(CStream& stream, uint64 compressedSize) const
+{
+	if(m_spanStream)
+	{
+		//Stream is either the archive or reading it positionally, it's at the start of the data in both cases
+		auto data = m_spanStream->GetSpan(stream.Tell(), compressedSize);
+		return std::make_unique<CZipInflateStream>(data, compressedSize);
+	}
+	return std::make_unique<CZipInflateStream>(stream, compressedSize);
+}
+
+std::vector<uint8> CZipArchiveReader::ReadFileData(CStream& stream, const DIRECTORYENTRY& entry, bool verifyCrc) const
+{
+	auto fileHeader = ReadFileHeader(stream);
+	const auto& info = entry.info;
+
+	if(info.uncompressedSize > SIZE_MAX)
+	{
+		throw std::runtime_error("Zip entry too large to be extracted in memory.");
+	}
+	std::vector<uint8> result(static_cast<size_t>(info.uncompressedSize));
+	uint64 amountRead = 0;
+	if(fileHeader.compressionMethod == COMPRESSION_METHOD::DEFLATE)
+	{
+		//Size is known from the directory, everything is inflated with a single call
+		CreateInflateStream(stream, info.compressedSize)->DecompressTo(result.data(), result.size());
+		amountRead = result.size();
+	}
+	else if(fileHeader.compressionMethod == COMPRESSION_METHOD::ZSTD)
+	{
+		CZipZstdDecompressStream zstdStream(stream, info.compressedSize);
+		amountRead = zstdStream.Read(result.data(), result.size());
+	}
+	else if(fileHeader.compressionMethod == COMPRESSION_METHOD::STORE)
+	{
+		CZipStoreStream storeStream(stream, info.compressedSize);
+		amountRead = storeStream.Read(result.data(), result.size());
+	}
+	else
+	{
+		throw std::runtime_error("Unsupported compression method.");
+	}
+
+	if(amountRead != result.size())
+	{
+		throw std::runtime_error("Error in zip archive.");
+	}
+	if(verifyCrc && (HashUtils::ComputeCrc32(result.data(), result.size()) != entry.header.crc))
+	{
+		throw std::runtime_error("CRC mismatch in zip archive.");
+	}
+	return result;
+}
+
 void CZipArchiveReader::EndReadFile(CStream* stream)
 {
 	if(!m_readingLock)
@@ -93,75 +307,250 @@ void CZipArchiveReader::EndReadFile(CStream* stream)
 
 const ZIPDIRFILEHEADER* CZipArchiveReader::GetFileHeader(const char* fileName) const
 {
-	auto fileIterator(m_files.find(fileName));
-	if(fileIterator == std::end(m_files))
+	return GetFileHeader(std::string_view(fileName));
+}
+
+const ZIPDIRFILEHEADER* CZipArchiveReader::GetFileHeader(std::string_view fileName) const
+{
+	auto entry = FindEntry(fileName);
+	return entry ? &entry->header : NULL;
+}
+
+const CZipArchiveReader::FILEINFO* CZipArchiveReader::GetFileInfo(std::string_view fileName) const
+{
+	auto entry = FindEntry(fileName);
+	return entry ? &entry->info : NULL;
+}
+
+const CZipArchiveReader::DIRECTORYENTRY* CZipArchiveReader::FindEntry(std::string_view fileName) const
+{
+	auto entryIterator = std::lower_bound(std::begin(m_entries), std::end(m_entries), fileName,
+		[] (const DIRECTORYENTRY& entry, std::string_view name) { return entry.name < name; });
+	if((entryIterator == std::end(m_entries)) || (entryIterator->name != fileName))
 	{
 		return NULL;
 	}
-	return &fileIterator->second;
+	return &(*entryIterator);
+}
+
+//Fields of the header set to their maximum are in the ZIP64 field, in this order
+CZipArchiveReader::FILEINFO CZipArchiveReader::GetEntryInfo(const ZIPDIRFILEHEADER& header, const uint8* extraFields)
+{
+	FILEINFO info;
+	info.compressedSize = header.compressedSize;
+	info.uncompressedSize = header.uncompressedSize;
+	info.fileStartOffset = header.fileStartOffset;
+	if((header.compressedSize != ZIP64_MARKER32) && (header.uncompressedSize != ZIP64_MARKER32) && (header.fileStartOffset != ZIP64_MARKER32))
+	{
+		return info;
+	}
+
+	size_t position = 0;
+	while((position + sizeof(ZIPEXTRAFIELDHEADER)) <= header.extraFieldLength)
+	{
+		ZIPEXTRAFIELDHEADER fieldHeader;
+		memcpy(&fieldHeader, extraFields + position, sizeof(ZIPEXTRAFIELDHEADER));
+		position += sizeof(ZIPEXTRAFIELDHEADER);
+		if((position + fieldHeader.size) > header.extraFieldLength) break;
+		if(fieldHeader.id == EXTRAFIELD_ID_ZIP64)
+		{
+			const uint8* field = extraFields + position;
+			size_t fieldPosition = 0;
+			auto readValue =
+				[&] (uint64& value)
+				{
+					if((fieldPosition + sizeof(uint64)) > fieldHeader.size)
+					{
+						throw std::runtime_error("Error while reading directory entry.");
+					}
+					memcpy(&value, field + fieldPosition, sizeof(uint64));
+					fieldPosition += sizeof(uint64);
+				};
+			if(header.uncompressedSize == ZIP64_MARKER32) readValue(info.uncompressedSize);
+			if(header.compressedSize == ZIP64_MARKER32) readValue(info.compressedSize);
+			if(header.fileStartOffset == ZIP64_MARKER32) readValue(info.fileStartOffset);
+			return info;
+		}
+		position += fieldHeader.size;
+	}
+	throw std::runtime_error("Error while reading directory entry.");
 }
 
 CZipArchiveReader::FileNameList CZipArchiveReader::GetFileNameList(const char* regexString)
 {
 	FileNameList result;
 	std::regex expression(regexString);
-	for(auto fileIterator(std::begin(m_files)); fileIterator != std::end(m_files); fileIterator++)
+	for(const auto& entry : m_entries)
 	{
-		const std::string& fileName(fileIterator->first);
-		std::cmatch match;
-		if(std::regex_match(fileName.c_str(), match, expression))
+		std::match_results<std::string_view::const_iterator> match;
+		if(std::regex_match(std::begin(entry.name), std::end(entry.name), match, expression))
 		{
-			result.push_back(fileName);
+			result.push_back(std::string(entry.name));
 		}
 	}
 	return result;
 }
 
+CZipArchiveReader::FileNameViewList CZipArchiveReader::GetFileNamesWithPrefix(std::string_view prefix) const
+{
+	//Names with the prefix are contiguous in the sorted index
+	auto entryIterator = std::lower_bound(std::begin(m_entries), std::end(m_entries), prefix,
+		[] (const DIRECTORYENTRY& entry, std::string_view name) { return entry.name < name; });
+	FileNameViewList result;
+	for(; entryIterator != std::end(m_entries); entryIterator++)
+	{
+		if(entryIterator->name.compare(0, prefix.size(), prefix) != 0) break;
+		result.push_back(entryIterator->name);
+	}
+	return result;
+}
+
 void CZipArchiveReader::Read(Framework::CStream& stream)
 {
 	//Search for dir header
 	bool found = false;
-	stream.Seek(0, STREAM_SEEK_END);
-	stream.Seek(-4, STREAM_SEEK_CUR);
-	while(stream.Tell() != 0)
+	auto spanStream = dynamic_cast<CSpanStream*>(&stream);
+	if(spanStream)
 	{
-		uint32 signature = stream.Read32();
+		//Scan mapped pages directly instead of seeking back one byte at a time
+		uint64 length = spanStream->GetLength();
+		const uint8* data = spanStream->GetData();
+		for(uint64 offset = (length >= 4) ? (length - 4) : 0; offset != 0; offset--)
+		{
+			uint32 signature = 0;
+			memcpy(&signature, data + offset, sizeof(uint32));
+			if(signature == DIRENDHEADER_SIG)
+			{
+				stream.Seek(offset, STREAM_SEEK_SET);
+				found = true;
+				break;
+			}
+		}
+	}
+	else
+	{
+		stream.Seek(0, STREAM_SEEK_END);
 		stream.Seek(-4, STREAM_SEEK_CUR);
-		if(signature == DIRENDHEADER_SIG)
+		while(stream.Tell() != 0)
 		{
-			found = true;
-			break;
+			uint32 signature = stream.Read32();
+			stream.Seek(-4, STREAM_SEEK_CUR);
+			if(signature == DIRENDHEADER_SIG)
+			{
+				found = true;
+				break;
+			}
+			stream.Seek(-1, STREAM_SEEK_CUR);
 		}
-		stream.Seek(-1, STREAM_SEEK_CUR);
 	}
 	if(!found)
 	{
 		throw std::runtime_error("No directory header found in stream.");
 	}
+	uint64 dirEndOffset = stream.Tell();
 	ZIPDIRENDHEADER dirHeader;
-	stream.Read(&dirHeader, sizeof(ZIPDIRENDHEADER));
-	if(dirHeader.dirStartOffset == ~0U)
+	if(stream.Read(&dirHeader, sizeof(ZIPDIRENDHEADER)) != sizeof(ZIPDIRENDHEADER))
+	{
+		throw std::runtime_error("Error while reading directory header.");
+	}
+	uint64 dirEntryCount = dirHeader.dirEntryCount;
+	uint64 dirSize = dirHeader.dirSize;
+	uint64 dirStartOffset = dirHeader.dirStartOffset;
+
+	//ZIP64 archives have a locator for the ZIP64 directory header right before the usual one
+	if(dirEndOffset >= (sizeof(ZIPDIRENDHEADER64) + sizeof(ZIPDIRENDLOCATOR64)))
+	{
+		ZIPDIRENDLOCATOR64 locator;
+		stream.Seek(dirEndOffset - sizeof(ZIPDIRENDLOCATOR64), STREAM_SEEK_SET);
+		if((stream.Read(&locator, sizeof(ZIPDIRENDLOCATOR64)) == sizeof(ZIPDIRENDLOCATOR64)) && (locator.signature == DIRENDLOCATOR64_SIG))
+		{
+			ZIPDIRENDHEADER64 dirHeader64;
+			if(locator.dirEndOffset > (dirEndOffset - sizeof(ZIPDIRENDLOCATOR64) - sizeof(ZIPDIRENDHEADER64)))
+			{
+				throw std::runtime_error("Error while reading directory header.");
+			}
+			stream.Seek(locator.dirEndOffset, STREAM_SEEK_SET);
+			if((stream.Read(&dirHeader64, sizeof(ZIPDIRENDHEADER64)) != sizeof(ZIPDIRENDHEADER64)) || (dirHeader64.signature != DIRENDHEADER64_SIG))
+			{
+				throw std::runtime_error("Error while reading directory header.");
+			}
+			dirEntryCount = dirHeader64.dirEntryCount;
+			dirSize = dirHeader64.dirSize;
+			dirStartOffset = dirHeader64.dirStartOffset;
+			dirEndOffset = locator.dirEndOffset;
+		}
+	}
+
+	//Directory comes before its end headers
+	if((dirStartOffset > dirEndOffset) || (dirSize > (dirEndOffset - dirStartOffset)))
 	{
-		throw std::runtime_error("ZIP64 archive not supported.");
+		throw std::runtime_error("Error while reading directory entry.");
 	}
 
-	stream.Seek(dirHeader.dirStartOffset, STREAM_SEEK_SET);
-	for(unsigned int i = 0; i < dirHeader.dirEntryCount; i++)
+	//Index the directory in place, names aren't copied
+	const uint8* directory = nullptr;
+	if(spanStream)
 	{
-		ZIPDIRFILEHEADER fileDirHeader;
-		stream.Read(&fileDirHeader, sizeof(ZIPDIRFILEHEADER));
-		if(fileDirHeader.signature != DIRFILEHEADER_SIG)
+		directory = spanStream->GetData() + dirStartOffset;
+	}
+	else
+	{
+		m_directoryData.resize(static_cast<size_t>(dirSize));
+		stream.Seek(dirStartOffset, STREAM_SEEK_SET);
+		if(stream.Read(m_directoryData.data(), dirSize) != dirSize)
 		{
 			throw std::runtime_error("Error while reading directory entry.");
 		}
-		auto fileName = stream.ReadString(fileDirHeader.fileNameLength);
-		if(!fileName.empty())
+		directory = m_directoryData.data();
+	}
+
+	//Count can't be trusted before entries are read
+	m_entries.reserve(static_cast<size_t>(std::min<uint64>(dirEntryCount, dirSize / sizeof(ZIPDIRFILEHEADER))));
+	size_t position = 0;
+	for(uint64 i = 0; i < dirEntryCount; i++)
+	{
+		DIRECTORYENTRY entry;
+		if((position + sizeof(ZIPDIRFILEHEADER)) > dirSize)
 		{
-			m_files[fileName] = fileDirHeader;
+			throw std::runtime_error("Error while reading directory entry.");
 		}
-		if(fileDirHeader.extraFieldLength != 0)
+		memcpy(&entry.header, directory + position, sizeof(ZIPDIRFILEHEADER));
+		if(entry.header.signature != DIRFILEHEADER_SIG)
 		{
-			stream.Seek(fileDirHeader.extraFieldLength, Framework::STREAM_SEEK_CUR);
+			throw std::runtime_error("Error while reading directory entry.");
+		}
+		position += sizeof(ZIPDIRFILEHEADER);
+		size_t variableSize = entry.header.fileNameLength + entry.header.extraFieldLength + entry.header.fileCommentLength;
+		if((position + variableSize) > dirSize)
+		{
+			throw std::runtime_error("Error while reading directory entry.");
+		}
+		entry.name = std::string_view(reinterpret_cast<const char*>(directory + position), entry.header.fileNameLength);
+		entry.info = GetEntryInfo(entry.header, directory + position + entry.header.fileNameLength);
+		position += variableSize;
+		if(!entry.name.empty())
+		{
+			m_entries.push_back(entry);
+		}
+	}
+
+	//When names are repeated, the last entry is the one that's kept
+	std::stable_sort(std::begin(m_entries), std::end(m_entries),
+		[] (const DIRECTORYENTRY& entry1, const DIRECTORYENTRY& entry2) { return entry1.name < entry2.name; });
+	size_t uniqueCount = 0;
+	for(size_t i = 0; i < m_entries.size(); i++)
+	{
+		if((uniqueCount != 0) && (m_entries[uniqueCount - 1].name == m_entries[i].name))
+		{
+			m_entries[uniqueCount - 1] = m_entries[i];
+		}
+		else
+		{
+			m_entries[uniqueCount++] = m_entries[i];
 		}
 	}
+	m_entries.resize(uniqueCount);
+
+	size_t directorySize = m_directoryData.capacity() + (m_entries.capacity() * sizeof(DIRECTORYENTRY));
+	m_allocationRecord = Memory::CAllocationRecord(Memory::CAllocationTracker::SUBSYSTEM_ZIP, FRAMEWORK_ALLOCATION_SITE, directorySize);
 }
@@ -1,101 +1,618 @@
 #include <string.h>
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <string_view>
+#include "zip/ZipArchiveReader.h"
 #include "zip/ZipArchiveWriter.h"
 #include "zip/ZipDeflateStream.h"
 #include "zip/ZipDefs.h"
+#include "zip/ZipStoreStream.h"
+#include "zip/ZipZstdCompressStream.h"
+#include "MemStream.h"
+#include "ThreadPool.h"
 #include <zstd_zlibwrapper.h>
 
 using namespace Framework;
 using namespace Framework::Zip;
 
+namespace
+{
+	struct FILESIGNATURE
+	{
+		const char* bytes;
+		size_t size;
+	};
+
+	//Formats that are already compressed
+	const FILESIGNATURE g_incompressibleSignatures[] =
+	{
+		{ "\x89PNG", 4 },
+		{ "\xFF\xD8\xFF", 3 },
+		{ "GIF8", 4 },
+		{ "PK\x03\x04", 4 },
+		{ "\x1F\x8B", 2 },
+		{ "\x28\xB5\x2F\xFD", 4 },
+		{ "\xFD" "7zXZ", 5 },
+		{ "BZh", 3 },
+		{ "7z\xBC\xAF", 4 },
+		{ "OggS", 4 },
+	};
+
+	//Forwards writes to a stream that can't seek or tell its position (ie.: a socket), keeping count of them
+	class CCountingStream : public CStream
+	{
+	public:
+		CCountingStream(CStream& stream)
+		    : m_stream(stream)
+		{
+		}
+
+		void Seek(int64, STREAM_SEEK_DIRECTION) override
+		{
+			throw std::runtime_error("Unsupported operation.");
+		}
+
+		uint64 Tell() override
+		{
+			return m_position;
+		}
+
+		uint64 Read(void*, uint64) override
+		{
+			throw std::runtime_error("Unsupported operation.");
+		}
+
+		uint64 Write(const void* buffer, uint64 size) override
+		{
+			uint64 result = m_stream.Write(buffer, size);
+			m_position += result;
+			if(result != size)
+			{
+				throw std::runtime_error("Failed to write zip archive.");
+			}
+			return result;
+		}
+
+		bool IsEOF() override
+		{
+			return false;
+		}
+
+		void Flush() override
+		{
+			m_stream.Flush();
+		}
+
+	private:
+		CStream& m_stream;
+		uint64 m_position = 0;
+	};
+}
+
 void CZipArchiveWriter::Write(CStream& stream)
 {
-	typedef std::pair<std::string, ZIPDIRFILEHEADER> DirectoryEntry;
-	typedef std::list<DirectoryEntry> DirectoryEntryList;
+	DirectoryEntryList directoryEntries;
+	WriteEntries(stream, directoryEntries);
+	WriteDirectory(stream, directoryEntries);
+}
 
+void CZipArchiveWriter::Write(CStream& stream, CThreadPool& threadPool, uint64 memoryCap)
+{
 	DirectoryEntryList directoryEntries;
+	WriteEntries(stream, threadPool, memoryCap, directoryEntries);
+	WriteDirectory(stream, directoryEntries);
+}
 
+void CZipArchiveWriter::WriteStreamed(CStream& stream)
+{
+	CCountingStream output(stream);
+	DirectoryEntryList directoryEntries;
 	for(const auto& file : m_files)
 	{
-		std::string fileName(file->GetName());
-		uint32 relativePosition = static_cast<uint32>(stream.Tell());
+		DIRECTORYENTRY entry;
+		entry.fileName = file->GetName();
+		entry.fileStartOffset = output.Tell();
 
-		//Build an incomplete file header
-		ZIPFILEHEADER fileHeader = {};
-		fileHeader.signature = FILEHEADER_SIG;
-		fileHeader.versionNeeded = 0x14;
-		fileHeader.compressedSize = 0;
-		fileHeader.uncompressedSize = 0;
-		fileHeader.compressionMethod = ZWRAP_isUsingZSTDcompression() ? COMPRESSION_METHOD::ZSTD : COMPRESSION_METHOD::DEFLATE;
-		fileHeader.fileNameLength = static_cast<uint16>(fileName.length());
-		fileHeader.crc = 0;
+		//Sizes and CRC follow the data
+		entry.compressedFile = CompressFile(*file, output,
+			[&] (uint16 method)
+			{
+				COMPRESSEDFILE headerFile;
+				headerFile.method = method;
+				headerFile.flags = FLAG_DATA_DESCRIPTOR;
+				WriteFileHeader(output, entry.fileName, headerFile);
+			});
+		entry.compressedFile.flags = FLAG_DATA_DESCRIPTOR;
+		WriteDataDescriptor(output, entry.compressedFile);
 
-		//Write file header
-		stream.Write(&fileHeader, sizeof(ZIPFILEHEADER));
+		directoryEntries.push_back(std::move(entry));
+	}
 
-		//Write file name
-		stream.Write(fileName.c_str(), fileName.length());
+	WriteDirectory(output, directoryEntries);
+	output.Flush();
+}
 
-		//Write body
-		CZipDeflateStream proxyStream(stream);
-		file->Write(proxyStream);
-		proxyStream.Flush();
+void CZipArchiveWriter::Append(CStream& stream)
+{
+	auto directoryEntries = ReadKeptEntries(stream);
+	stream.Seek(0, STREAM_SEEK_END);
+	WriteEntries(stream, directoryEntries);
+	WriteDirectory(stream, directoryEntries);
+}
 
-		//Update header with info
-		fileHeader.crc = proxyStream.GetCrc();
-		fileHeader.compressedSize = static_cast<uint32>(proxyStream.GetCompressedLength());
-		fileHeader.uncompressedSize = static_cast<uint32>(proxyStream.GetUncompressedLength());
+void CZipArchiveWriter::Append(CStream& stream, CThreadPool& threadPool, uint64 memoryCap)
+{
+	auto directoryEntries = ReadKeptEntries(stream);
+	stream.Seek(0, STREAM_SEEK_END);
+	WriteEntries(stream, threadPool, memoryCap, directoryEntries);
+	WriteDirectory(stream, directoryEntries);
+}
+
+void CZipArchiveWriter::Compact(CStream& input, CStream& output)
+{
+	DirectoryEntryList directoryEntries;
+	{
+		CZipArchiveReader reader(input);
+		for(const auto& fileName : reader.GetFileNamesWithPrefix(""))
+		{
+			directoryEntries.push_back(MakeExistingEntry(fileName, *reader.GetFileHeader(fileName), *reader.GetFileInfo(fileName)));
+		}
+	}
+
+	//Input is read in order
+	std::sort(std::begin(directoryEntries), std::end(directoryEntries),
+		[] (const DIRECTORYENTRY& entry1, const DIRECTORYENTRY& entry2) { return entry1.fileStartOffset < entry2.fileStartOffset; });
+
+	std::vector<uint8> buffer(COPY_BUFFER_SIZE);
+	for(auto& entry : directoryEntries)
+	{
+		ZIPFILEHEADER fileHeader;
+		input.Seek(entry.fileStartOffset, STREAM_SEEK_SET);
+		if((input.Read(&fileHeader, sizeof(ZIPFILEHEADER)) != sizeof(ZIPFILEHEADER)) || (fileHeader.signature != FILEHEADER_SIG))
+		{
+			throw std::runtime_error("Error in zip archive.");
+		}
+		input.Seek(fileHeader.fileNameLength + fileHeader.extraFieldLength, STREAM_SEEK_CUR);
+
+		//Local header is written again, sizes are known so there's no data descriptor after the data
+		entry.compressedFile.flags &= ~FLAG_DATA_DESCRIPTOR;
+		entry.fileStartOffset = output.Tell();
+		WriteFileHeader(output, entry.fileName, entry.compressedFile);
+
+		uint64 remainingSize = entry.compressedFile.compressedSize;
+		while(remainingSize != 0)
+		{
+			uint64 chunkSize = std::min<uint64>(remainingSize, buffer.size());
+			if(input.Read(buffer.data(), chunkSize) != chunkSize)
+			{
+				throw std::runtime_error("Error in zip archive.");
+			}
+			output.Write(buffer.data(), chunkSize);
+			remainingSize -= chunkSize;
+		}
+	}
+
+	WriteDirectory(output, directoryEntries);
+}
+
+void CZipArchiveWriter::InsertFile(ZipFilePtr file)
+{
+	m_files.emplace_back(std::move(file));
+}
+
+//Entries of an existing archive that aren't replaced by inserted files, in name order
+CZipArchiveWriter::DirectoryEntryList CZipArchiveWriter::ReadKeptEntries(CStream& stream) const
+{
+	std::set<std::string_view> insertedNames;
+	for(const auto& file : m_files)
+	{
+		insertedNames.insert(file->GetName());
+	}
+
+	DirectoryEntryList directoryEntries;
+	CZipArchiveReader reader(stream);
+	for(const auto& fileName : reader.GetFileNamesWithPrefix(""))
+	{
+		if(insertedNames.count(fileName) != 0) continue;
+		directoryEntries.push_back(MakeExistingEntry(fileName, *reader.GetFileHeader(fileName), *reader.GetFileInfo(fileName)));
+	}
+	return directoryEntries;
+}
+
+CZipArchiveWriter::DIRECTORYENTRY CZipArchiveWriter::MakeExistingEntry(std::string_view fileName, const ZIPDIRFILEHEADER& dirFileHeader, const CZipArchiveReader::FILEINFO& info)
+{
+	DIRECTORYENTRY entry;
+	entry.fileName = fileName;
+	entry.compressedFile.method = dirFileHeader.compressionMethod;
+	entry.compressedFile.flags = dirFileHeader.flags;
+	entry.compressedFile.crc = dirFileHeader.crc;
+	entry.compressedFile.compressedSize = info.compressedSize;
+	entry.compressedFile.uncompressedSize = info.uncompressedSize;
+	entry.fileStartOffset = info.fileStartOffset;
+	return entry;
+}
+
+void CZipArchiveWriter::WriteEntries(CStream& stream, DirectoryEntryList& directoryEntries)
+{
+	for(const auto& file : m_files)
+	{
+		DIRECTORYENTRY entry;
+		entry.fileName = file->GetName();
+		entry.fileStartOffset = stream.Tell();
+
+		//Write an incomplete file header
+		WriteFileHeader(stream, entry.fileName, COMPRESSEDFILE());
+
+		//Write body and update header with info
+		entry.compressedFile = CompressFile(*file, stream);
 
 		//Write back old header
-		stream.Seek(relativePosition, STREAM_SEEK_SET);
-		stream.Write(&fileHeader, sizeof(ZIPFILEHEADER));
+		stream.Seek(entry.fileStartOffset, STREAM_SEEK_SET);
+		WriteFileHeader(stream, entry.fileName, entry.compressedFile);
 		stream.Seek(0, STREAM_SEEK_END);
 
-		//Create directory entry for this file
-		ZIPDIRFILEHEADER dirFileHeader;
-		memset(&dirFileHeader, 0, sizeof(ZIPDIRFILEHEADER));
-		dirFileHeader.signature = DIRFILEHEADER_SIG;
-		dirFileHeader.versionMadeBy = 0x14;
-		dirFileHeader.versionNeeded = 0x14;
-		dirFileHeader.crc = fileHeader.crc;
-		dirFileHeader.fileStartOffset = relativePosition;
-		dirFileHeader.compressedSize = fileHeader.compressedSize;
-		dirFileHeader.uncompressedSize = fileHeader.uncompressedSize;
-		dirFileHeader.fileNameLength = fileHeader.fileNameLength;
-		dirFileHeader.compressionMethod = fileHeader.compressionMethod;
+		directoryEntries.push_back(std::move(entry));
+	}
 
-		directoryEntries.push_back(DirectoryEntry(fileName, dirFileHeader));
+}
+
+void CZipArchiveWriter::WriteEntries(CStream& stream, CThreadPool& threadPool, uint64 memoryCap, DirectoryEntryList& directoryEntries)
+{
+	struct PENDINGENTRY
+	{
+		CMemStream data;
+		COMPRESSEDFILE compressedFile;
+		bool done = false;
+		std::exception_ptr exception;
+	};
+
+	std::vector<CZipFile*> files;
+	for(const auto& file : m_files)
+	{
+		files.push_back(file.get());
 	}
 
+	std::vector<PENDINGENTRY> entries(files.size());
+	std::mutex mutex;
+	std::condition_variable condition;
+	uint64 bufferedSize = 0;
+	unsigned int runningCount = 0;
+	size_t nextEntry = 0;
+
+	//Keep a few entries queued per thread so that workers don't wait on the writer
+	size_t maxPendingCount = std::max<size_t>(threadPool.GetThreadCount(), 1) * 2;
+
+	auto compressEntry =
+		[&] (size_t index)
+		{
+			auto& entry = entries[index];
+			try
+			{
+				entry.compressedFile = CompressFile(*files[index], entry.data);
+			}
+			catch(...)
+			{
+				entry.exception = std::current_exception();
+			}
+			std::unique_lock<std::mutex> lock(mutex);
+			entry.done = true;
+			bufferedSize += entry.data.GetSize();
+			runningCount--;
+			condition.notify_all();
+		};
+
+	std::exception_ptr exception;
+
+	std::unique_lock<std::mutex> lock(mutex);
+	for(size_t writtenEntry = 0; writtenEntry < entries.size(); writtenEntry++)
+	{
+		auto& entry = entries[writtenEntry];
+		while(!entry.done)
+		{
+			//The entry to write next is always started, other entries wait for memory to be available
+			while((nextEntry < entries.size()) &&
+				((nextEntry == writtenEntry) || (((nextEntry - writtenEntry) < maxPendingCount) && (bufferedSize < memoryCap))))
+			{
+				size_t index = nextEntry++;
+				runningCount++;
+				threadPool.Enqueue([&compressEntry, index] () { compressEntry(index); });
+			}
+			condition.wait(lock);
+		}
+
+		if(entry.exception)
+		{
+			exception = entry.exception;
+			break;
+		}
+
+		lock.unlock();
+
+		DIRECTORYENTRY directoryEntry;
+		directoryEntry.fileName = files[writtenEntry]->GetName();
+		directoryEntry.compressedFile = entry.compressedFile;
+		directoryEntry.fileStartOffset = stream.Tell();
+
+		WriteFileHeader(stream, directoryEntry.fileName, entry.compressedFile);
+		stream.Write(entry.data.GetBuffer(), entry.data.GetSize());
+
+		directoryEntries.push_back(std::move(directoryEntry));
+
+		lock.lock();
+		bufferedSize -= entry.data.GetSize();
+		entry.data = CMemStream();
+	}
+
+	if(exception)
+	{
+		//Tasks still reference the entries
+		condition.wait(lock, [&] () { return runningCount == 0; });
+		std::rethrow_exception(exception);
+	}
+}
+
+//Writes the file's data to the output with its compression method, the data starts right after the call to beginData
+CZipArchiveWriter::COMPRESSEDFILE CZipArchiveWriter::CompressFile(CZipFile& file, CStream& output, const BeginDataFunction& beginData)
+{
+	auto method = file.GetCompressionMethod();
+	int level = file.GetCompressionLevel();
+
+	//Entry needs to be complete before we can decide what to do with it
+	CMemStream rawData;
+	bool isBuffered = file.GetStoreIncompressible();
+	if(isBuffered)
+	{
+		file.Write(rawData);
+		size_t probeSize = static_cast<size_t>(std::min<uint64>(rawData.GetSize(), INCOMPRESSIBLE_PROBE_SIZE));
+		if(IsIncompressible(rawData.GetBuffer(), probeSize))
+		{
+			method = CZipFile::COMPRESSION_METHOD_STORE;
+		}
+	}
+
+	auto writeData =
+		[&] (CStream& stream)
+		{
+			if(isBuffered)
+			{
+				stream.Write(rawData.GetBuffer(), rawData.GetSize());
+			}
+			else
+			{
+				file.Write(stream);
+			}
+		};
+
+	COMPRESSEDFILE result;
+	switch(method)
+	{
+	case CZipFile::COMPRESSION_METHOD_STORE:
+		{
+			result.method = COMPRESSION_METHOD::STORE;
+			if(beginData) beginData(result.method);
+			CZipStoreStream proxyStream(output);
+			writeData(proxyStream);
+			result.crc = proxyStream.GetCrc();
+			result.compressedSize = proxyStream.GetCompressedLength();
+			result.uncompressedSize = proxyStream.GetUncompressedLength();
+		}
+		break;
+	case CZipFile::COMPRESSION_METHOD_ZSTD:
+		{
+			result.method = COMPRESSION_METHOD::ZSTD;
+			if(beginData) beginData(result.method);
+			CZipZstdCompressStream proxyStream(output, (level == CZipFile::COMPRESSION_LEVEL_DEFAULT) ? CZipZstdCompressStream::DEFAULT_LEVEL : level);
+			writeData(proxyStream);
+			proxyStream.Flush();
+			result.crc = proxyStream.GetCrc();
+			result.compressedSize = proxyStream.GetCompressedLength();
+			result.uncompressedSize = proxyStream.GetUncompressedLength();
+		}
+		break;
+	default:
+		{
+			result.method = ZWRAP_isUsingZSTDcompression() ? COMPRESSION_METHOD::ZSTD : COMPRESSION_METHOD::DEFLATE;
+			if(beginData) beginData(result.method);
+			CZipDeflateStream proxyStream(output, level);
+			writeData(proxyStream);
+			proxyStream.Flush();
+			result.crc = proxyStream.GetCrc();
+			result.compressedSize = proxyStream.GetCompressedLength();
+			result.uncompressedSize = proxyStream.GetUncompressedLength();
+		}
+		break;
+	}
+	return result;
+}
+
+bool CZipArchiveWriter::IsIncompressible(const uint8* data, size_t size)
+{
+	for(const auto& signature : g_incompressibleSignatures)
+	{
+		if((size >= signature.size) && !memcmp(data, signature.bytes, signature.size))
+		{
+			return true;
+		}
+	}
+
+	//Small entries don't give a meaningful estimate
+	if(size < 0x400)
+	{
+		return false;
+	}
+
+	//Order-0 entropy close to 8 bits per byte means general purpose compression won't get anything out of it
+	unsigned int histogram[0x100] = {};
+	for(size_t i = 0; i < size; i++)
+	{
+		histogram[data[i]]++;
+	}
+	double entropy = 0;
+	for(auto count : histogram)
+	{
+		if(count == 0) continue;
+		double probability = static_cast<double>(count) / static_cast<double>(size);
+		entropy -= probability * std::log2(probability);
+	}
+	return entropy > 7.8;
+}
+
+uint16 CZipArchiveWriter::GetVersionNeeded(const COMPRESSEDFILE& compressedFile, bool isZip64)
+{
+	if(compressedFile.method == COMPRESSION_METHOD::ZSTD) return VERSION_ZSTD;
+	return isZip64 ? VERSION_ZIP64 : VERSION_DEFAULT;
+}
+
+void CZipArchiveWriter::WriteFileHeader(CStream& stream, const std::string& fileName, const COMPRESSEDFILE& compressedFile)
+{
+	bool isZip64 = (compressedFile.compressedSize >= ZIP64_MARKER32) || (compressedFile.uncompressedSize >= ZIP64_MARKER32);
+
+	ZIPFILEHEADER fileHeader = {};
+	fileHeader.signature = FILEHEADER_SIG;
+	fileHeader.versionNeeded = GetVersionNeeded(compressedFile, isZip64);
+	fileHeader.compressedSize = isZip64 ? ZIP64_MARKER32 : static_cast<uint32>(compressedFile.compressedSize);
+	fileHeader.uncompressedSize = isZip64 ? ZIP64_MARKER32 : static_cast<uint32>(compressedFile.uncompressedSize);
+	fileHeader.flags = compressedFile.flags;
+	fileHeader.compressionMethod = compressedFile.method;
+	fileHeader.fileNameLength = static_cast<uint16>(fileName.length());
+	fileHeader.extraFieldLength = sizeof(ZIPLOCALZIP64FIELD);
+	fileHeader.crc = compressedFile.crc;
+
+	ZIPLOCALZIP64FIELD extraField = {};
+	extraField.header.id = isZip64 ? EXTRAFIELD_ID_ZIP64 : EXTRAFIELD_ID_PLACEHOLDER;
+	extraField.header.size = sizeof(ZIPLOCALZIP64FIELD) - sizeof(ZIPEXTRAFIELDHEADER);
+	if(isZip64)
+	{
+		extraField.uncompressedSize = compressedFile.uncompressedSize;
+		extraField.compressedSize = compressedFile.compressedSize;
+	}
+
+	stream.Write(&fileHeader, sizeof(ZIPFILEHEADER));
+	stream.Write(fileName.c_str(), fileName.length());
+	stream.Write(&extraField, sizeof(ZIPLOCALZIP64FIELD));
+}
+
+//Sizes are only 64 bits wide when they need to be, readers know from the directory's ZIP64 field
+void CZipArchiveWriter::WriteDataDescriptor(CStream& stream, const COMPRESSEDFILE& compressedFile)
+{
+	bool isZip64 = (compressedFile.compressedSize >= ZIP64_MARKER32) || (compressedFile.uncompressedSize >= ZIP64_MARKER32);
+	if(isZip64)
+	{
+		ZIPDATADESCRIPTOR64 descriptor = {};
+		descriptor.signature = DATADESCRIPTOR_SIG;
+		descriptor.crc = compressedFile.crc;
+		descriptor.compressedSize = compressedFile.compressedSize;
+		descriptor.uncompressedSize = compressedFile.uncompressedSize;
+		stream.Write(&descriptor, sizeof(ZIPDATADESCRIPTOR64));
+	}
+	else
+	{
+		ZIPDATADESCRIPTOR descriptor = {};
+		descriptor.signature = DATADESCRIPTOR_SIG;
+		descriptor.crc = compressedFile.crc;
+		descriptor.compressedSize = static_cast<uint32>(compressedFile.compressedSize);
+		descriptor.uncompressedSize = static_cast<uint32>(compressedFile.uncompressedSize);
+		stream.Write(&descriptor, sizeof(ZIPDATADESCRIPTOR));
+	}
+}
+
+void CZipArchiveWriter::WriteDirectory(CStream& stream, const DirectoryEntryList& directoryEntries)
+{
 	//Write directory
 	uint64 dirStart = stream.Tell();
 
 	for(const auto& entry : directoryEntries)
 	{
+		const auto& compressedFile = entry.compressedFile;
+
+		//Values that don't fit in the header go in a ZIP64 field, in this order
+		uint64 zip64Values[3] = {};
+		unsigned int zip64ValueCount = 0;
+		auto fitValue =
+			[&] (uint64 value)
+			{
+				if(value < ZIP64_MARKER32) return static_cast<uint32>(value);
+				zip64Values[zip64ValueCount++] = value;
+				return static_cast<uint32>(ZIP64_MARKER32);
+			};
+
+		ZIPDIRFILEHEADER dirFileHeader;
+		memset(&dirFileHeader, 0, sizeof(ZIPDIRFILEHEADER));
+		dirFileHeader.signature = DIRFILEHEADER_SIG;
+		dirFileHeader.versionMadeBy = VERSION_DEFAULT;
+		dirFileHeader.flags = compressedFile.flags;
+		dirFileHeader.crc = compressedFile.crc;
+		dirFileHeader.uncompressedSize = fitValue(compressedFile.uncompressedSize);
+		dirFileHeader.compressedSize = fitValue(compressedFile.compressedSize);
+		dirFileHeader.fileStartOffset = fitValue(entry.fileStartOffset);
+		dirFileHeader.versionNeeded = GetVersionNeeded(compressedFile, zip64ValueCount != 0);
+		dirFileHeader.fileNameLength = static_cast<uint16>(entry.fileName.length());
+		dirFileHeader.compressionMethod = compressedFile.method;
+
+		ZIPEXTRAFIELDHEADER extraFieldHeader = {};
+		if(zip64ValueCount != 0)
+		{
+			extraFieldHeader.id = EXTRAFIELD_ID_ZIP64;
+			extraFieldHeader.size = static_cast<uint16>(zip64ValueCount * sizeof(uint64));
+			dirFileHeader.extraFieldLength = sizeof(ZIPEXTRAFIELDHEADER) + extraFieldHeader.size;
+		}
+
 		//Write file header
-		stream.Write(&entry.second, sizeof(ZIPDIRFILEHEADER));
+		stream.Write(&dirFileHeader, sizeof(ZIPDIRFILEHEADER));
 
 		//Write file name
-		stream.Write(entry.first.c_str(), entry.first.length());
+		stream.Write(entry.fileName.c_str(), entry.fileName.length());
+
+		if(zip64ValueCount != 0)
+		{
+			stream.Write(&extraFieldHeader, sizeof(ZIPEXTRAFIELDHEADER));
+			stream.Write(zip64Values, extraFieldHeader.size);
+		}
 	}
 
 	uint64 dirEnd = stream.Tell();
+	uint64 entryCount = directoryEntries.size();
+
+	//Counts and offsets that don't fit are in ZIP64 records found through a locator
+	bool isZip64 = (entryCount >= ZIP64_MARKER16) || ((dirEnd - dirStart) >= ZIP64_MARKER32) || (dirStart >= ZIP64_MARKER32);
+	if(isZip64)
+	{
+		ZIPDIRENDHEADER64 dirHeader64;
+		memset(&dirHeader64, 0, sizeof(ZIPDIRENDHEADER64));
+		dirHeader64.signature = DIRENDHEADER64_SIG;
+		dirHeader64.size = sizeof(ZIPDIRENDHEADER64) - sizeof(dirHeader64.signature) - sizeof(dirHeader64.size);
+		dirHeader64.versionMadeBy = VERSION_ZIP64;
+		dirHeader64.versionNeeded = VERSION_ZIP64;
+		dirHeader64.dirEntryCount = entryCount;
+		dirHeader64.totalDirEntryCount = entryCount;
+		dirHeader64.dirSize = dirEnd - dirStart;
+		dirHeader64.dirStartOffset = dirStart;
+		stream.Write(&dirHeader64, sizeof(ZIPDIRENDHEADER64));
+
+		ZIPDIRENDLOCATOR64 locator;
+		memset(&locator, 0, sizeof(ZIPDIRENDLOCATOR64));
+		locator.signature = DIRENDLOCATOR64_SIG;
+		locator.dirEndOffset = dirEnd;
+		locator.diskCount = 1;
+		stream.Write(&locator, sizeof(ZIPDIRENDLOCATOR64));
+	}
 
 	//Write directory header
 	{
 		ZIPDIRENDHEADER dirHeader;
 		memset(&dirHeader, 0, sizeof(ZIPDIRENDHEADER));
 		dirHeader.signature = DIRENDHEADER_SIG;
-		dirHeader.dirEntryCount = static_cast<uint16>(directoryEntries.size());
-		dirHeader.totalDirEntryCount = static_cast<uint16>(directoryEntries.size());
-		dirHeader.dirSize = static_cast<uint32>(dirEnd - dirStart);
-		dirHeader.dirStartOffset = static_cast<uint32>(dirStart);
+		dirHeader.dirEntryCount = static_cast<uint16>(std::min<uint64>(entryCount, ZIP64_MARKER16));
+		dirHeader.totalDirEntryCount = dirHeader.dirEntryCount;
+		dirHeader.dirSize = static_cast<uint32>(std::min<uint64>(dirEnd - dirStart, ZIP64_MARKER32));
+		dirHeader.dirStartOffset = static_cast<uint32>(std::min<uint64>(dirStart, ZIP64_MARKER32));
 
 		//Write file header
 		stream.Write(&dirHeader, sizeof(ZIPDIRENDHEADER));
 	}
 }
-
-void CZipArchiveWriter::InsertFile(ZipFilePtr file)
-{
-	m_files.emplace_back(std::move(file));
-}
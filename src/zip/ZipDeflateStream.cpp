@@ -1,26 +1,19 @@
 #include "zip/ZipDeflateStream.h"
+#include "HashUtils.h"
 #include <stdexcept>
-#include <cassert>
-#include "maybe_unused.h"
 
 using namespace Framework;
 
-CZipDeflateStream::CZipDeflateStream(CStream& baseStream)
+CZipDeflateStream::CZipDeflateStream(CStream& baseStream, int level)
 : m_baseStream(baseStream)
+, m_compressor(Deflate::CreateCompressor(level))
 {
-    m_zStream.zalloc = Z_NULL;
-    m_zStream.zfree = Z_NULL;
-    m_zStream.opaque = Z_NULL;
-    if(deflateInit2(&m_zStream, Z_DEFAULT_COMPRESSION, 
-        Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK)
-    {
-        throw std::runtime_error("Error initializing deflate stream.");
-    }
+
 }
 
 CZipDeflateStream::~CZipDeflateStream()
 {
-    deflateEnd(&m_zStream);
+
 }
 
 uint32 CZipDeflateStream::GetCrc() const
@@ -56,27 +49,8 @@ uint64 CZipDeflateStream::Read(void*, uint64)
 uint64 CZipDeflateStream::Write(const void* buffer, uint64 size)
 {
     m_uncompressedLength += size;
-    m_crc = crc32(m_crc, reinterpret_cast<const Bytef*>(buffer), static_cast<uInt>(size));
-
-    m_zStream.avail_in = static_cast<uInt>(size);
-    m_zStream.next_in = const_cast<Bytef*>(reinterpret_cast<const Bytef*>(buffer));
-
-    do
-    {
-        Bytef outBuffer[BUFFERSIZE];
-        m_zStream.avail_out = BUFFERSIZE;
-        m_zStream.next_out = outBuffer;
-
-        FRAMEWORK_MAYBE_UNUSED int ret = deflate(&m_zStream, Z_NO_FLUSH);
-        assert(ret != Z_STREAM_ERROR);
-
-        uint64 have = BUFFERSIZE - m_zStream.avail_out;
-        m_compressedLength += have;
-        m_baseStream.Write(outBuffer, have);
-    } 
-    while(m_zStream.avail_out == 0);
-    assert(m_zStream.avail_in == 0);
-
+    m_crc = HashUtils::ComputeCrc32(buffer, static_cast<size_t>(size), m_crc);
+    Compress(reinterpret_cast<const uint8*>(buffer), static_cast<size_t>(size), false);
     return size;
 }
 
@@ -87,19 +61,26 @@ bool CZipDeflateStream::IsEOF()
 
 void CZipDeflateStream::Flush()
 {
-    do 
-    {
-        Bytef outBuffer[BUFFERSIZE];
-        m_zStream.avail_out = BUFFERSIZE;
-        m_zStream.next_out = outBuffer;
+    Compress(nullptr, 0, true);
+}
 
-        FRAMEWORK_MAYBE_UNUSED int ret = deflate(&m_zStream, Z_FINISH);
-        assert(ret != Z_STREAM_ERROR);
+void CZipDeflateStream::Compress(const uint8* input, size_t inputSize, bool finish)
+{
+    while(true)
+    {
+        uint8 outBuffer[BUFFERSIZE];
+        uint8* output = outBuffer;
+        size_t outputSize = BUFFERSIZE;
+        bool isEnd = m_compressor->Compress(input, inputSize, output, outputSize, finish);
 
-        uint64 have = BUFFERSIZE - m_zStream.avail_out;
+        uint64 have = BUFFERSIZE - outputSize;
         m_compressedLength += have;
         m_baseStream.Write(outBuffer, have);
-    } 
-    while(m_zStream.avail_out == 0);
-    assert(m_zStream.avail_in == 0);     /* all input will be used */   
+
+        //Without finishing, everything is consumed once output stops filling the buffer
+        if(finish ? isEnd : ((inputSize == 0) && (outputSize != 0)))
+        {
+            break;
+        }
+    }
 }
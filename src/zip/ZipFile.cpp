@@ -17,3 +17,33 @@ const char* CZipFile::GetName() const
 {
     return m_name.c_str();
 }
+
+int CZipFile::GetCompressionLevel() const
+{
+    return m_compressionLevel;
+}
+
+void CZipFile::SetCompressionLevel(int compressionLevel)
+{
+    m_compressionLevel = compressionLevel;
+}
+
+CZipFile::COMPRESSION_METHOD CZipFile::GetCompressionMethod() const
+{
+    return m_compressionMethod;
+}
+
+void CZipFile::SetCompressionMethod(COMPRESSION_METHOD compressionMethod)
+{
+    m_compressionMethod = compressionMethod;
+}
+
+bool CZipFile::GetStoreIncompressible() const
+{
+    return m_storeIncompressible;
+}
+
+void CZipFile::SetStoreIncompressible(bool storeIncompressible)
+{
+    m_storeIncompressible = storeIncompressible;
+}
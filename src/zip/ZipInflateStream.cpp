@@ -3,27 +3,30 @@
 #include <algorithm>
 #include <string.h>
 #include <assert.h>
+#include "Trace.h"
 
 using namespace Framework;
 
-CZipInflateStream::CZipInflateStream(CStream& baseStream, unsigned int compressedLength) :
-m_baseStream(baseStream),
-m_compressedLength(compressedLength)
+CZipInflateStream::CZipInflateStream(CStream& baseStream, uint64 compressedLength) :
+m_baseStream(&baseStream),
+m_compressedLength(compressedLength),
+m_decompressor(Deflate::CreateDecompressor()),
+m_inputBuffer(BUFFERSIZE)
 {
-    m_zStream.zalloc = Z_NULL;
-    m_zStream.zfree = Z_NULL;
-    m_zStream.opaque = Z_NULL;
-    m_zStream.avail_in = 0;
-    m_zStream.next_in = Z_NULL;
-    if(inflateInit2(&m_zStream, -MAX_WBITS) != Z_OK)
-    {
-		throw std::runtime_error("zlib stream initialization error.");
-    }
+
+}
+
+CZipInflateStream::CZipInflateStream(const void* data, uint64 compressedLength) :
+m_inputData(reinterpret_cast<const uint8*>(data)),
+m_compressedLength(compressedLength),
+m_decompressor(Deflate::CreateDecompressor())
+{
+
 }
 
 CZipInflateStream::~CZipInflateStream()
 {
-    inflateEnd(&m_zStream);
+
 }
 
 void CZipInflateStream::Seek(int64, STREAM_SEEK_DIRECTION)
@@ -38,46 +41,58 @@ uint64 CZipInflateStream::Tell()
 
 uint64 CZipInflateStream::Read(void* buffer, uint64 length)
 {
-    Bytef outBuffer[BUFFERSIZE];
+    FRAMEWORK_TRACE_SCOPE("ZipInflateStream::Read");
+    //Output goes straight to the caller's buffer
     uint8* destBuffer = reinterpret_cast<uint8*>(buffer);
-    uint64 sizeCounter = length;
-    do
+    size_t sizeCounter = static_cast<size_t>(length);
+    while((sizeCounter != 0) && !m_isEof)
     {
-        if(m_zStream.avail_in == 0)
+        if((m_inputSize == 0) && (m_compressedLength != 0))
         {
-            if(m_compressedLength == 0)
-            {
-                //EOF
-                break;
-            }
             FeedBuffer();
         }
 
-		int bufferSize = std::min<int>(BUFFERSIZE, static_cast<int>(sizeCounter));
-        m_zStream.avail_out = bufferSize;
-        m_zStream.next_out = outBuffer;
+        size_t previousSize = sizeCounter;
+        bool isEnd = m_decompressor->Decompress(m_input, m_inputSize, destBuffer, sizeCounter);
 
-        int ret = inflate(&m_zStream, Z_NO_FLUSH);
-        switch (ret) {
-        case Z_NEED_DICT:
-        case Z_DATA_ERROR:
-        case Z_MEM_ERROR:
-			throw std::runtime_error("Error occured while inflating.");
-            break;
+        //Decompressor can still have pending output after consuming all of its input
+        bool inputExhausted = (m_inputSize == 0) && (m_compressedLength == 0);
+        if(isEnd || (inputExhausted && (sizeCounter == previousSize)))
+        {
+            m_isEof = true;
         }
+    }
+    return length - sizeCounter;
+}
 
-        int have = bufferSize - m_zStream.avail_out;
-        memcpy(destBuffer, outBuffer, have);
-        destBuffer += have;
-        sizeCounter -= have;
-        if(ret == Z_STREAM_END)
+void CZipInflateStream::DecompressTo(void* buffer, size_t size)
+{
+    FRAMEWORK_TRACE_SCOPE("ZipInflateStream::DecompressTo");
+    uint8* destBuffer = reinterpret_cast<uint8*>(buffer);
+    size_t sizeCounter = size;
+    bool isEnd = false;
+    while(!isEnd)
+    {
+        if((m_inputSize == 0) && (m_compressedLength != 0))
+        {
+            FeedBuffer();
+        }
+        size_t previousInputSize = m_inputSize;
+        size_t previousSize = sizeCounter;
+        isEnd = m_decompressor->Decompress(m_input, m_inputSize, destBuffer, sizeCounter);
+        //Ran out of input or output space before the end of the stream
+        bool canFeed = (m_inputSize == 0) && (m_compressedLength != 0);
+        bool madeProgress = (m_inputSize != previousInputSize) || (sizeCounter != previousSize);
+        if(!isEnd && !madeProgress && !canFeed)
         {
-            assert(IsEOF());
             break;
         }
-    } 
-    while (sizeCounter != 0);
-    return length - sizeCounter;
+    }
+    m_isEof = true;
+    if(!isEnd || (sizeCounter != 0))
+    {
+        throw std::runtime_error("Entry size doesn't match its compressed data.");
+    }
 }
 
 uint64 CZipInflateStream::Write(const void* buffer, uint64 size)
@@ -87,14 +102,28 @@ uint64 CZipInflateStream::Write(const void* buffer, uint64 size)
 
 bool CZipInflateStream::IsEOF()
 {
-    return (m_compressedLength == 0) && (m_zStream.avail_in == 0);
+    return m_isEof;
 }
 
 void CZipInflateStream::FeedBuffer()
 {
-    assert(m_zStream.avail_in == 0);
-	unsigned int toRead = std::min<unsigned int>(BUFFERSIZE, m_compressedLength);
-    m_zStream.avail_in = static_cast<uInt>(m_baseStream.Read(m_inputBuffer, toRead));
-    m_zStream.next_in = m_inputBuffer;
-    m_compressedLength -= m_zStream.avail_in;
+    assert(m_inputSize == 0);
+    if(m_inputData)
+    {
+        //Data in memory is given as is
+        m_input = m_inputData;
+        m_inputSize = static_cast<size_t>(m_compressedLength);
+        m_inputData += m_inputSize;
+        m_compressedLength = 0;
+        return;
+    }
+    assert(m_baseStream);
+    size_t toRead = static_cast<size_t>(std::min<uint64>(BUFFERSIZE, m_compressedLength));
+    m_inputSize = static_cast<size_t>(m_baseStream->Read(m_inputBuffer.data(), toRead));
+    m_input = m_inputBuffer.data();
+    if(m_inputSize == 0)
+    {
+        throw std::runtime_error("Unexpected end of deflate stream.");
+    }
+    m_compressedLength -= m_inputSize;
 }
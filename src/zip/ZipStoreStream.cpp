@@ -1,11 +1,11 @@
 #include "zip/ZipStoreStream.h"
-#include <zstd_zlibwrapper.h>
+#include "HashUtils.h"
 #include <stdexcept>
 #include <algorithm>
 
 using namespace Framework;
 
-CZipStoreStream::CZipStoreStream(CStream& baseStream, unsigned int length)
+CZipStoreStream::CZipStoreStream(CStream& baseStream, uint64 length)
 : m_baseStream(baseStream)
 , m_length(length)
 {
@@ -26,13 +26,31 @@ uint64 CZipStoreStream::Read(void* buffer, uint64 size)
 {
 	uint64 readSize = std::min<uint64>(size, m_length);
 	uint64 resultSize = m_baseStream.Read(buffer, readSize);
-	m_length -= static_cast<uint32>(resultSize);
+	m_length -= resultSize;
 	return resultSize;
 }
 
 uint64 CZipStoreStream::Write(const void* buffer, uint64 size)
 {
-	throw std::runtime_error("Unsupported operation.");
+	m_crc = HashUtils::ComputeCrc32(buffer, static_cast<size_t>(size), m_crc);
+	uint64 resultSize = m_baseStream.Write(buffer, size);
+	m_writtenLength += resultSize;
+	return resultSize;
+}
+
+uint32 CZipStoreStream::GetCrc() const
+{
+	return m_crc;
+}
+
+uint64 CZipStoreStream::GetCompressedLength() const
+{
+	return m_writtenLength;
+}
+
+uint64 CZipStoreStream::GetUncompressedLength() const
+{
+	return m_writtenLength;
 }
 
 bool CZipStoreStream::IsEOF()
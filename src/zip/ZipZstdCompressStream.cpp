@@ -0,0 +1,97 @@
+#include <stdexcept>
+#include <zstd.h>
+#include "zip/ZipZstdCompressStream.h"
+#include "HashUtils.h"
+
+using namespace Framework;
+
+CZipZstdCompressStream::CZipZstdCompressStream(CStream& baseStream, int level)
+: m_baseStream(baseStream)
+, m_outputBuffer(ZSTD_CStreamOutSize())
+{
+	m_context = ZSTD_createCCtx();
+	if(!m_context)
+	{
+		throw std::runtime_error("Error initializing zstd stream.");
+	}
+	ZSTD_CCtx_setParameter(m_context, ZSTD_c_compressionLevel, level);
+}
+
+CZipZstdCompressStream::~CZipZstdCompressStream()
+{
+	ZSTD_freeCCtx(m_context);
+}
+
+uint32 CZipZstdCompressStream::GetCrc() const
+{
+	return m_crc;
+}
+
+uint64 CZipZstdCompressStream::GetCompressedLength() const
+{
+	return m_compressedLength;
+}
+
+uint64 CZipZstdCompressStream::GetUncompressedLength() const
+{
+	return m_uncompressedLength;
+}
+
+void CZipZstdCompressStream::Seek(int64, STREAM_SEEK_DIRECTION)
+{
+	throw std::runtime_error("Unsupported operation.");
+}
+
+uint64 CZipZstdCompressStream::Tell()
+{
+	return m_baseStream.Tell();
+}
+
+uint64 CZipZstdCompressStream::Read(void*, uint64)
+{
+	throw std::runtime_error("Unsupported operation.");
+}
+
+uint64 CZipZstdCompressStream::Write(const void* buffer, uint64 size)
+{
+	m_uncompressedLength += size;
+	m_crc = HashUtils::ComputeCrc32(buffer, static_cast<size_t>(size), m_crc);
+
+	ZSTD_inBuffer input = { buffer, static_cast<size_t>(size), 0 };
+	while(input.pos != input.size)
+	{
+		ZSTD_outBuffer output = { m_outputBuffer.data(), m_outputBuffer.size(), 0 };
+		size_t result = ZSTD_compressStream2(m_context, &output, &input, ZSTD_e_continue);
+		if(ZSTD_isError(result))
+		{
+			throw std::runtime_error("Error occured while compressing.");
+		}
+		m_compressedLength += output.pos;
+		m_baseStream.Write(m_outputBuffer.data(), output.pos);
+	}
+
+	return size;
+}
+
+bool CZipZstdCompressStream::IsEOF()
+{
+	return m_baseStream.IsEOF();
+}
+
+void CZipZstdCompressStream::Flush()
+{
+	ZSTD_inBuffer input = { nullptr, 0, 0 };
+	size_t remaining = 0;
+	do
+	{
+		ZSTD_outBuffer output = { m_outputBuffer.data(), m_outputBuffer.size(), 0 };
+		remaining = ZSTD_compressStream2(m_context, &output, &input, ZSTD_e_end);
+		if(ZSTD_isError(remaining))
+		{
+			throw std::runtime_error("Error occured while compressing.");
+		}
+		m_compressedLength += output.pos;
+		m_baseStream.Write(m_outputBuffer.data(), output.pos);
+	}
+	while(remaining != 0);
+}
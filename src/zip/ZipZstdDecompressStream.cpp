@@ -0,0 +1,90 @@
+#include <algorithm>
+#include <stdexcept>
+#include <zstd.h>
+#include "zip/ZipZstdDecompressStream.h"
+
+using namespace Framework;
+
+CZipZstdDecompressStream::CZipZstdDecompressStream(CStream& baseStream, uint64 compressedLength)
+: m_baseStream(baseStream)
+, m_compressedLength(compressedLength)
+, m_inputBuffer(ZSTD_DStreamInSize())
+{
+	m_context = ZSTD_createDCtx();
+	if(!m_context)
+	{
+		throw std::runtime_error("Error initializing zstd stream.");
+	}
+}
+
+CZipZstdDecompressStream::~CZipZstdDecompressStream()
+{
+	ZSTD_freeDCtx(m_context);
+}
+
+void CZipZstdDecompressStream::Seek(int64, STREAM_SEEK_DIRECTION)
+{
+	throw std::runtime_error("Unsupported operation.");
+}
+
+uint64 CZipZstdDecompressStream::Tell()
+{
+	throw std::runtime_error("Unsupported operation.");
+}
+
+uint64 CZipZstdDecompressStream::Read(void* buffer, uint64 length)
+{
+	//Decompresses straight into the caller's buffer
+	ZSTD_outBuffer output = { buffer, static_cast<size_t>(length), 0 };
+	while(output.pos != output.size)
+	{
+		if((m_inputPosition == m_inputSize) && (m_compressedLength != 0))
+		{
+			FeedBuffer();
+		}
+
+		//Decoder can still have buffered output once all input is consumed
+		size_t previousPosition = output.pos;
+		ZSTD_inBuffer input = { m_inputBuffer.data(), m_inputSize, m_inputPosition };
+		size_t result = ZSTD_decompressStream(m_context, &output, &input);
+		if(ZSTD_isError(result))
+		{
+			throw std::runtime_error("Error occured while decompressing.");
+		}
+		m_inputPosition = input.pos;
+		m_isFrameEnd = (result == 0);
+		bool isInputExhausted = (m_compressedLength == 0) && (m_inputPosition == m_inputSize);
+		if(isInputExhausted && (m_isFrameEnd || (m_inputSize == 0)))
+		{
+			break;
+		}
+		if(isInputExhausted && (output.pos == previousPosition))
+		{
+			throw std::runtime_error("Unexpected end of zstd stream.");
+		}
+	}
+	return output.pos;
+}
+
+uint64 CZipZstdDecompressStream::Write(const void*, uint64)
+{
+	throw std::runtime_error("Unsupported operation.");
+}
+
+bool CZipZstdDecompressStream::IsEOF()
+{
+	//Frame is only done once the decoder flushed everything it had
+	return (m_compressedLength == 0) && (m_inputPosition == m_inputSize) && (m_isFrameEnd || (m_inputSize == 0));
+}
+
+void CZipZstdDecompressStream::FeedBuffer()
+{
+	size_t toRead = static_cast<size_t>(std::min<uint64>(m_inputBuffer.size(), m_compressedLength));
+	m_inputSize = static_cast<size_t>(m_baseStream.Read(m_inputBuffer.data(), toRead));
+	m_inputPosition = 0;
+	if(m_inputSize == 0)
+	{
+		throw std::runtime_error("Unexpected end of zstd stream.");
+	}
+	m_compressedLength -= m_inputSize;
+}
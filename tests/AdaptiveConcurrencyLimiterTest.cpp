@@ -0,0 +1,112 @@
+#include "AdaptiveConcurrencyLimiterTest.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "AdaptiveConcurrencyLimiter.h"
+#include "TestDefs.h"
+
+using namespace Framework;
+
+static void TestAdditiveIncrease()
+{
+	CAdaptiveConcurrencyLimiter limiter(2, 1, 4);
+	TEST_VERIFY(limiter.GetLimit() == 2);
+	//Goes up by about one every round of limit operations
+	for(unsigned int i = 0; i < 3; i++)
+	{
+		limiter.Release(limiter.Acquire(), CAdaptiveConcurrencyLimiter::OUTCOME_SUCCESS);
+	}
+	TEST_VERIFY(limiter.GetLimit() == 3);
+	for(unsigned int i = 0; i < 100; i++)
+	{
+		limiter.Release(limiter.Acquire(), CAdaptiveConcurrencyLimiter::OUTCOME_SUCCESS);
+	}
+	TEST_VERIFY(limiter.GetLimit() == 4);
+	limiter.Release(limiter.Acquire(), CAdaptiveConcurrencyLimiter::OUTCOME_IGNORED);
+	TEST_VERIFY(limiter.GetLimit() == 4);
+	TEST_VERIFY(limiter.GetActiveCount() == 0);
+}
+
+static void TestMultiplicativeDecrease()
+{
+	CAdaptiveConcurrencyLimiter limiter(16, 2, 32);
+	std::vector<CAdaptiveConcurrencyLimiter::TICKET> tickets;
+	for(unsigned int i = 0; i < 16; i++)
+	{
+		tickets.push_back(limiter.Acquire());
+	}
+	CAdaptiveConcurrencyLimiter::TICKET ticket;
+	TEST_VERIFY(!limiter.TryAcquire(ticket));
+
+	//Only the first overload of the round cuts the limit
+	for(const auto& ticket : tickets)
+	{
+		limiter.Release(ticket, CAdaptiveConcurrencyLimiter::OUTCOME_OVERLOAD);
+	}
+	TEST_VERIFY(limiter.GetLimit() == 8);
+	TEST_VERIFY(limiter.GetActiveCount() == 0);
+
+	for(unsigned int i = 0; i < 4; i++)
+	{
+		limiter.Release(limiter.Acquire(), CAdaptiveConcurrencyLimiter::OUTCOME_OVERLOAD);
+	}
+	TEST_VERIFY(limiter.GetLimit() == 2);
+	TEST_VERIFY(limiter.TryAcquire(ticket));
+	limiter.Release(ticket, CAdaptiveConcurrencyLimiter::OUTCOME_SUCCESS);
+}
+
+static void TestWait()
+{
+	CAdaptiveConcurrencyLimiter limiter(1, 1, 1);
+	auto ticket = limiter.Acquire();
+	std::atomic<bool> acquired(false);
+	std::thread thread(
+	    [&]() {
+		    auto otherTicket = limiter.Acquire();
+		    acquired = true;
+		    limiter.Release(otherTicket, CAdaptiveConcurrencyLimiter::OUTCOME_SUCCESS);
+	    });
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	TEST_VERIFY(!acquired);
+	limiter.Release(ticket, CAdaptiveConcurrencyLimiter::OUTCOME_SUCCESS);
+	thread.join();
+	TEST_VERIFY(acquired);
+}
+
+static void TestConcurrentUse()
+{
+	CAdaptiveConcurrencyLimiter limiter(4, 1, 8);
+	std::atomic<unsigned int> activeCount(0);
+	std::atomic<bool> exceeded(false);
+	std::vector<std::thread> threads;
+	for(unsigned int i = 0; i < 8; i++)
+	{
+		threads.emplace_back(
+		    [&, i]() {
+			    for(unsigned int j = 0; j < 200; j++)
+			    {
+				    auto ticket = limiter.Acquire();
+				    if(++activeCount > 8) exceeded = true;
+				    activeCount--;
+				    bool isOverload = ((i + j) % 17) == 0;
+				    limiter.Release(ticket, isOverload ? CAdaptiveConcurrencyLimiter::OUTCOME_OVERLOAD : CAdaptiveConcurrencyLimiter::OUTCOME_SUCCESS);
+			    }
+		    });
+	}
+	for(auto& thread : threads)
+	{
+		thread.join();
+	}
+	TEST_VERIFY(!exceeded);
+	TEST_VERIFY(limiter.GetActiveCount() == 0);
+	TEST_VERIFY((limiter.GetLimit() >= 1) && (limiter.GetLimit() <= 8));
+}
+
+void AdaptiveConcurrencyLimiterTest_Execute()
+{
+	TestAdditiveIncrease();
+	TestMultiplicativeDecrease();
+	TestWait();
+	TestConcurrentUse();
+}
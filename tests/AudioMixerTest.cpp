@@ -0,0 +1,203 @@
+#include "AudioMixerTest.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "audio/Mixer.h"
+#include "audio/PolyphaseResampler.h"
+#include "audio/SampleConvert.h"
+#include "TestDefs.h"
+
+using namespace Framework::Audio;
+
+static const double g_pi = 3.14159265358979323846;
+
+static void ConvertTest()
+{
+	//Odd count to cover the non-vectorized tail
+	std::vector<int16> source = {0, 1, -1, 16384, -16384, 32767, -32768, 1234, -4321, 100, -100};
+	std::vector<float> floats(source.size());
+	ConvertS16ToF32(floats.data(), source.data(), source.size());
+	TEST_VERIFY(floats[0] == 0.0f);
+	TEST_VERIFY(floats[3] == 0.5f);
+	TEST_VERIFY(floats[4] == -0.5f);
+	TEST_VERIFY(floats[6] == -1.0f);
+
+	std::vector<int16> roundTrip(source.size());
+	ConvertF32ToS16(roundTrip.data(), floats.data(), floats.size());
+	TEST_VERIFY(roundTrip == source);
+
+	//Out of range samples saturate
+	std::vector<float> loud = {2.0f, -2.0f, 1.0f, -1.0f, 0.25f, 100.0f, -100.0f};
+	std::vector<int16> clamped(loud.size());
+	ConvertF32ToS16(clamped.data(), loud.data(), loud.size());
+	TEST_VERIFY(clamped[0] == 32767);
+	TEST_VERIFY(clamped[1] == -32768);
+	TEST_VERIFY(clamped[2] == 32767);
+	TEST_VERIFY(clamped[3] == -32768);
+	TEST_VERIFY(clamped[4] == 8192);
+	TEST_VERIFY(clamped[5] == 32767);
+	TEST_VERIFY(clamped[6] == -32768);
+}
+
+static void MixTest()
+{
+	const unsigned int frameCount = 13;
+	CMixer mixer(48000, 48000, frameCount);
+
+	std::vector<float> mono(frameCount, 0.5f);
+	std::vector<int16> stereo(frameCount * 2);
+	for(unsigned int i = 0; i < frameCount; i++)
+	{
+		stereo[(i * 2) + 0] = 8192;
+		stereo[(i * 2) + 1] = -8192;
+	}
+
+	mixer.BeginBlock(frameCount);
+	//Fully left
+	mixer.MixMono(mono.data(), 1.0f, -1.0f);
+	//Balanced to the right, left is halved
+	mixer.MixStereo(stereo.data(), 1.0f, 0.5f);
+	mixer.EndBlock();
+
+	TEST_VERIFY(mixer.GetAvailableChunkCount() == 1);
+	std::vector<int16> chunk(frameCount * 2);
+	TEST_VERIFY(mixer.ReadChunk(chunk.data()));
+	for(unsigned int i = 0; i < frameCount; i++)
+	{
+		//0.5 + 0.125 on the left, -0.25 on the right
+		TEST_VERIFY(chunk[(i * 2) + 0] == 20480);
+		TEST_VERIFY(chunk[(i * 2) + 1] == -8192);
+	}
+	TEST_VERIFY(mixer.GetAvailableChunkCount() == 0);
+	TEST_VERIFY(!mixer.ReadChunk(chunk.data()));
+
+	//Centered mono voice has the same power on both sides
+	std::vector<int16> monoS16(frameCount, 16384);
+	mixer.BeginBlock(frameCount);
+	mixer.MixMono(monoS16.data(), 1.0f, 0.0f);
+	mixer.EndBlock();
+	TEST_VERIFY(mixer.ReadChunk(chunk.data()));
+	for(unsigned int i = 0; i < frameCount; i++)
+	{
+		TEST_VERIFY(std::abs(chunk[(i * 2) + 0] - 11585) <= 1);
+		TEST_VERIFY(chunk[(i * 2) + 0] == chunk[(i * 2) + 1]);
+	}
+}
+
+static void ChunkTest()
+{
+	//Blocks don't need to line up with chunks
+	const unsigned int chunkFrameCount = 64;
+	const unsigned int blockFrameCount = 40;
+	CMixer mixer(44100, 44100, chunkFrameCount);
+	std::vector<float> voice(blockFrameCount);
+	std::vector<int16> chunk(chunkFrameCount * 2);
+	unsigned int readCount = 0;
+	unsigned int frameIndex = 0;
+	for(unsigned int block = 0; block < 16; block++)
+	{
+		for(unsigned int i = 0; i < blockFrameCount; i++)
+		{
+			voice[i] = static_cast<float>(frameIndex++ % 100) / 128.0f;
+		}
+		mixer.BeginBlock(blockFrameCount);
+		mixer.MixMono(voice.data(), 1.0f, -1.0f);
+		mixer.EndBlock();
+		while(mixer.ReadChunk(chunk.data()))
+		{
+			for(unsigned int i = 0; i < chunkFrameCount; i++)
+			{
+				unsigned int expected = (((readCount * chunkFrameCount) + i) % 100) * 256;
+				TEST_VERIFY(chunk[i * 2] == static_cast<int16>(expected));
+				TEST_VERIFY(chunk[(i * 2) + 1] == 0);
+			}
+			readCount++;
+		}
+	}
+	TEST_VERIFY(readCount == (16 * blockFrameCount) / chunkFrameCount);
+}
+
+static void ResampleTest(unsigned int inputRate, unsigned int outputRate)
+{
+	const unsigned int inputFrameCount = inputRate / 10;
+	const double frequency = 1000.0;
+	std::vector<float> input(inputFrameCount * 2);
+	for(unsigned int i = 0; i < inputFrameCount; i++)
+	{
+		double time = static_cast<double>(i) / inputRate;
+		input[(i * 2) + 0] = static_cast<float>(0.5 * std::sin(2 * g_pi * frequency * time));
+		//DC on the second channel
+		input[(i * 2) + 1] = 0.25f;
+	}
+
+	//Given in uneven pieces to check continuity
+	CPolyphaseResampler resampler(inputRate, outputRate, 2);
+	std::vector<float> output;
+	unsigned int position = 0;
+	unsigned int pieceSize = 1;
+	while(position < inputFrameCount)
+	{
+		unsigned int frameCount = std::min(pieceSize, inputFrameCount - position);
+		std::vector<float> piece(resampler.GetMaxOutputFrameCount(frameCount) * 2);
+		size_t outputFrameCount = resampler.Process(input.data() + (position * 2), frameCount, piece.data());
+		output.insert(output.end(), piece.begin(), piece.begin() + (outputFrameCount * 2));
+		position += frameCount;
+		pieceSize = (pieceSize * 7 + 3) % 517 + 1;
+	}
+
+	size_t outputFrameCount = output.size() / 2;
+	size_t expectedFrameCount = (static_cast<size_t>(inputFrameCount) * outputRate) / inputRate;
+	TEST_VERIFY(outputFrameCount + CPolyphaseResampler::DEFAULT_TAP_COUNT >= expectedFrameCount);
+	TEST_VERIFY(outputFrameCount <= expectedFrameCount);
+
+	//Edges see the zero history, only the middle is checked
+	double maxError = 0;
+	for(size_t i = 100; i < outputFrameCount - 100; i++)
+	{
+		double time = static_cast<double>(i) / outputRate;
+		double expected = 0.5 * std::sin(2 * g_pi * frequency * time);
+		maxError = std::max(maxError, std::abs(output[(i * 2) + 0] - expected));
+		maxError = std::max(maxError, std::abs(output[(i * 2) + 1] - 0.25));
+	}
+	TEST_VERIFY(maxError < 1e-3);
+}
+
+static void ResampledMixTest()
+{
+	//Mix at 44.1kHz, output at 48kHz
+	const unsigned int chunkFrameCount = 480;
+	CMixer mixer(44100, 48000, chunkFrameCount);
+	std::vector<float> voice(441, 0.5f);
+	std::vector<int16> chunk(chunkFrameCount * 2);
+	unsigned int readCount = 0;
+	for(unsigned int block = 0; block < 100; block++)
+	{
+		mixer.BeginBlock(static_cast<unsigned int>(voice.size()));
+		mixer.MixMono(voice.data(), 1.0f, 1.0f);
+		mixer.EndBlock();
+		while(mixer.ReadChunk(chunk.data()))
+		{
+			if(readCount != 0)
+			{
+				for(unsigned int i = 0; i < chunkFrameCount; i++)
+				{
+					TEST_VERIFY(chunk[(i * 2) + 0] == 0);
+					TEST_VERIFY(std::abs(chunk[(i * 2) + 1] - 16384) <= 4);
+				}
+			}
+			readCount++;
+		}
+	}
+	//One second in, one second out, minus what the filter holds back
+	TEST_VERIFY(readCount == 99);
+}
+
+void AudioMixerTest_Execute()
+{
+	ConvertTest();
+	MixTest();
+	ChunkTest();
+	ResampleTest(44100, 48000);
+	ResampleTest(48000, 44100);
+	ResampledMixTest();
+}
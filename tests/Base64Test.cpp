@@ -0,0 +1,109 @@
+#include "Base64Test.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "Base64.h"
+#include "Base64Stream.h"
+#include "MemStream.h"
+#include "TestDefs.h"
+
+static bool IsDecodeRejected(const char* source)
+{
+	try
+	{
+		Framework::FromBase64(source);
+	}
+	catch(const std::exception&)
+	{
+		return true;
+	}
+	return false;
+}
+
+void Base64Test_Execute()
+{
+	//RFC 4648 test vectors
+	TEST_VERIFY(Framework::ToBase64("") == "");
+	TEST_VERIFY(Framework::ToBase64("f") == "Zg==");
+	TEST_VERIFY(Framework::ToBase64("fo") == "Zm8=");
+	TEST_VERIFY(Framework::ToBase64("foo") == "Zm9v");
+	TEST_VERIFY(Framework::ToBase64("foob") == "Zm9vYg==");
+	TEST_VERIFY(Framework::ToBase64("fooba") == "Zm9vYmE=");
+	TEST_VERIFY(Framework::ToBase64("foobar") == "Zm9vYmFy");
+	{
+		auto result = Framework::FromBase64("Zm9vYmE=");
+		TEST_VERIFY(std::string(result.begin(), result.end()) == "fooba");
+	}
+	{
+		//Padding is optional
+		auto result = Framework::FromBase64("Zm9vYmE");
+		TEST_VERIFY(std::string(result.begin(), result.end()) == "fooba");
+	}
+	TEST_VERIFY(Framework::GetBase64DecodedSize("Zm9vYg==", 8) == 4);
+	TEST_VERIFY(IsDecodeRejected("Zm9vY"));
+	TEST_VERIFY(IsDecodeRejected("Zm9=Yg=="));
+	TEST_VERIFY(IsDecodeRejected("Zm9v\nYmFy"));
+	{
+		//Large enough to go through the vectorized paths, with every byte value
+		std::vector<uint8> input(1000);
+		for(size_t i = 0; i < input.size(); i++)
+		{
+			input[i] = static_cast<uint8>((i * 97) ^ (i >> 8));
+		}
+		for(size_t size = 0; size < input.size(); size += 7)
+		{
+			std::string encoded(Framework::GetBase64EncodedSize(size), '\0');
+			Framework::ToBase64(input.data(), size, &encoded[0]);
+			TEST_VERIFY(encoded == Framework::ToBase64(input.data(), size));
+			auto decoded = Framework::FromBase64(encoded.c_str(), encoded.size());
+			TEST_VERIFY((decoded.size() == size) && std::equal(decoded.begin(), decoded.end(), input.begin()));
+			if(size > 100)
+			{
+				//Invalid characters are found anywhere in the input
+				encoded[size / 2] = '*';
+				TEST_VERIFY(IsDecodeRejected(encoded.c_str()));
+			}
+		}
+	}
+	{
+		std::vector<uint8> input(100000);
+		for(size_t i = 0; i < input.size(); i++)
+		{
+			input[i] = static_cast<uint8>(i * 13);
+		}
+		Framework::CMemStream encodedStream;
+		{
+			//Parts of different sizes to go through the partial group handling
+			Framework::CBase64EncodeStream encodeStream(encodedStream);
+			size_t offset = 0;
+			size_t partSize = 1;
+			while(offset != input.size())
+			{
+				size_t size = std::min(partSize, input.size() - offset);
+				encodeStream.Write(input.data() + offset, size);
+				offset += size;
+				partSize = (partSize * 3) + 1;
+			}
+			encodeStream.Flush();
+		}
+		auto encoded = Framework::ToBase64(input.data(), input.size());
+		TEST_VERIFY(encodedStream.GetSize() == encoded.size());
+		TEST_VERIFY(memcmp(encodedStream.GetBuffer(), encoded.data(), encoded.size()) == 0);
+
+		encodedStream.Seek(0, Framework::STREAM_SEEK_SET);
+		Framework::CBase64DecodeStream decodeStream(encodedStream);
+		std::vector<uint8> decoded(input.size() + 1);
+		size_t decodedSize = 0;
+		size_t partSize = 1;
+		while(!decodeStream.IsEOF())
+		{
+			size_t size = std::min(partSize, decoded.size() - decodedSize);
+			decodedSize += static_cast<size_t>(decodeStream.Read(decoded.data() + decodedSize, size));
+			partSize = (partSize * 3) + 1;
+		}
+		TEST_VERIFY(decodedSize == input.size());
+		TEST_VERIFY(memcmp(decoded.data(), input.data(), input.size()) == 0);
+	}
+}
@@ -0,0 +1,544 @@
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+#include "BitmapTest.h"
+#include "TestDefs.h"
+#include "MemStream.h"
+#include "ThreadPool.h"
+#include "bitmap/Bitmap.h"
+#include "bitmap/BitmapBlitter.h"
+#include "bitmap/BitmapPool.h"
+#include "bitmap/BitmapView.h"
+#include "bitmap/BMP.h"
+#include "bitmap/ImageProbe.h"
+#include "bitmap/JPEG.h"
+#include "bitmap/PNG.h"
+#include "bitmap/TGA.h"
+#include "bitmap/PixelConvert.h"
+
+static const Framework::CBitmap::RESIZE_FILTER g_filters[] =
+{
+	Framework::CBitmap::RESIZE_FILTER_BILINEAR,
+	Framework::CBitmap::RESIZE_FILTER_BICUBIC,
+	Framework::CBitmap::RESIZE_FILTER_LANCZOS,
+	Framework::CBitmap::RESIZE_FILTER_KAISER,
+};
+
+static Framework::CBitmap MakeGradient(unsigned int width, unsigned int height, unsigned int bpp)
+{
+	Framework::CBitmap bitmap(width, height, bpp);
+	for(unsigned int y = 0; y < height; y++)
+	{
+		for(unsigned int x = 0; x < width; x++)
+		{
+			bitmap.SetPixel(x, y, Framework::CColor(x * 255 / (width - 1), y * 255 / (height - 1), 0x80, 0xFF));
+		}
+	}
+	return bitmap;
+}
+
+static bool AreBitmapsEqual(const Framework::CBitmap& bitmap1, const Framework::CBitmap& bitmap2)
+{
+	if(bitmap1.GetWidth() != bitmap2.GetWidth()) return false;
+	if(bitmap1.GetHeight() != bitmap2.GetHeight()) return false;
+	if(bitmap1.GetBitsPerPixel() != bitmap2.GetBitsPerPixel()) return false;
+	return memcmp(bitmap1.GetPixels(), bitmap2.GetPixels(), bitmap1.GetPixelsSize()) == 0;
+}
+
+static void ViewTest()
+{
+	auto bitmap = MakeGradient(20, 10, 24);
+	Framework::CBitmapView view(bitmap);
+
+	auto cropped = view.Crop(5, 2, 10, 6);
+	TEST_VERIFY(cropped.GetWidth() == 10);
+	TEST_VERIFY(cropped.GetHeight() == 6);
+	auto flipped = cropped.FlipVertical();
+	for(unsigned int y = 0; y < 6; y++)
+	{
+		for(unsigned int x = 0; x < 10; x++)
+		{
+			auto expected = bitmap.GetPixel(x + 5, y + 2);
+			auto actual = cropped.GetPixel(x, y);
+			auto actualFlipped = flipped.GetPixel(x, 5 - y);
+			TEST_VERIFY((expected.r == actual.r) && (expected.g == actual.g));
+			TEST_VERIFY((expected.r == actualFlipped.r) && (expected.g == actualFlipped.g));
+		}
+	}
+
+	//Writes go through to the bitmap
+	flipped.SetPixel(0, 0, Framework::CColor(1, 2, 3, 0));
+	TEST_VERIFY(bitmap.GetPixel(5, 7).b == 3);
+
+	TEST_VERIFY(AreBitmapsEqual(view.FlipVertical().ToBitmap(), bitmap.FlipVertical()));
+	TEST_VERIFY(AreBitmapsEqual(view.Crop(0, 0, 20, 10).ToBitmap(), bitmap));
+}
+
+static void InPlaceTest()
+{
+	{
+		auto bitmap = MakeGradient(13, 7, 32);
+		auto expected = bitmap.FlipVertical();
+		bitmap.FlipVerticalInPlace();
+		TEST_VERIFY(AreBitmapsEqual(bitmap, expected));
+	}
+
+	{
+		auto bitmap = MakeGradient(13, 7, 24);
+		auto expected = bitmap.AddAlphaChannel(0x40);
+		bitmap.AddAlphaChannelInPlace(0x40);
+		TEST_VERIFY(AreBitmapsEqual(bitmap, expected));
+	}
+
+	{
+		//Shrink then grow back, the buffer is large enough for both
+		auto bitmap = MakeGradient(13, 7, 24);
+		auto original = bitmap;
+		bitmap.ResizeCanvasInPlace(6, 4);
+		TEST_VERIFY(AreBitmapsEqual(bitmap, original.ResizeCanvas(6, 4)));
+		const uint8* pixels = bitmap.GetPixels();
+		bitmap.ResizeCanvasInPlace(8, 5);
+		TEST_VERIFY(bitmap.GetPixels() == pixels);
+		auto expected = Framework::CBitmapView(original).Crop(0, 0, 6, 4);
+		bool matches = true;
+		for(unsigned int y = 0; y < 5; y++)
+		{
+			for(unsigned int x = 0; x < 8; x++)
+			{
+				auto color = bitmap.GetPixel(x, y);
+				auto expectedColor = expected.GetPixel(x, y);
+				matches &= (color.r == expectedColor.r) && (color.g == expectedColor.g) && (color.b == expectedColor.b);
+			}
+		}
+		TEST_VERIFY(matches);
+		bitmap.ResizeCanvasInPlace(30, 20);
+		TEST_VERIFY(bitmap.GetWidth() == 30);
+		TEST_VERIFY(bitmap.GetHeight() == 20);
+	}
+}
+
+static void PoolTest()
+{
+	Framework::CBitmapPool pool;
+	const uint8* pixels = nullptr;
+	{
+		Framework::CBitmap bitmap(64, 32, 32, &pool);
+		pixels = bitmap.GetPixels();
+	}
+	TEST_VERIFY(pool.GetCachedSize() == (64 * 32 * 4));
+	{
+		Framework::CBitmap bitmap(32, 64, 32, &pool);
+		TEST_VERIFY(bitmap.GetPixels() == pixels);
+		TEST_VERIFY(pool.GetCachedSize() == 0);
+
+		//Derived bitmaps use the same allocator
+		auto flipped = bitmap.FlipVertical();
+		TEST_VERIFY(flipped.GetAllocator() == &pool);
+		Framework::CBitmap copy;
+		copy = flipped;
+		TEST_VERIFY(copy.GetAllocator() == &pool);
+	}
+	TEST_VERIFY(pool.GetCachedSize() == (3 * 64 * 32 * 4));
+	pool.Clear();
+	TEST_VERIFY(pool.GetCachedSize() == 0);
+}
+
+static void PixelConvertTest()
+{
+	//Sizes around the SIMD loop widths to exercise the remainders
+	for(unsigned int count = 0; count < 40; count++)
+	{
+		std::vector<uint8> rgb(count * 3);
+		for(unsigned int i = 0; i < rgb.size(); i++)
+		{
+			rgb[i] = static_cast<uint8>((i * 37) + 11);
+		}
+
+		std::vector<uint8> rgba(count * 4);
+		Framework::PixelConvert::RGB24ToRGBA32(rgba.data(), rgb.data(), count, 0x33);
+		bool matches = true;
+		for(unsigned int i = 0; i < count; i++)
+		{
+			matches &= (memcmp(rgba.data() + (i * 4), rgb.data() + (i * 3), 3) == 0);
+			matches &= (rgba[(i * 4) + 3] == 0x33);
+		}
+		TEST_VERIFY(matches);
+
+		std::vector<uint8> result(count * 3);
+		Framework::PixelConvert::RGBA32ToRGB24(result.data(), rgba.data(), count);
+		TEST_VERIFY(result == rgb);
+
+		Framework::PixelConvert::SwapRedBlue24(result.data(), result.data(), count);
+		for(unsigned int i = 0; i < count; i++)
+		{
+			matches &= (result[(i * 3) + 0] == rgb[(i * 3) + 2]) && (result[(i * 3) + 2] == rgb[(i * 3) + 0]);
+		}
+		TEST_VERIFY(matches);
+		Framework::PixelConvert::SwapRedBlue24(result.data(), result.data(), count);
+		TEST_VERIFY(result == rgb);
+
+		std::vector<uint8> swapped(count * 4);
+		Framework::PixelConvert::SwapRedBlue32(swapped.data(), rgba.data(), count);
+		Framework::PixelConvert::SwapRedBlue32(swapped.data(), swapped.data(), count);
+		TEST_VERIFY(swapped == rgba);
+	}
+
+	{
+		static const uint8 pixels[] =
+		{
+			0xFF, 0x80, 0x00, 0xFF,
+			0xFF, 0x80, 0x00, 0x80,
+			0xFF, 0x80, 0x00, 0x00,
+			0x10, 0x20, 0x30, 0x40,
+			0xFF, 0xFF, 0xFF, 0xFF,
+		};
+		static const uint8 expected[] =
+		{
+			0xFF, 0x80, 0x00, 0xFF,
+			0x80, 0x40, 0x00, 0x80,
+			0x00, 0x00, 0x00, 0x00,
+			0x04, 0x08, 0x0C, 0x40,
+			0xFF, 0xFF, 0xFF, 0xFF,
+		};
+		uint8 result[sizeof(pixels)];
+		Framework::PixelConvert::PremultiplyAlpha(result, pixels, 5);
+		TEST_VERIFY(memcmp(result, expected, sizeof(expected)) == 0);
+
+		Framework::PixelConvert::UnpremultiplyAlpha(result, result, 5);
+		TEST_VERIFY(memcmp(result, pixels, 4) == 0);
+		TEST_VERIFY((result[4] == 0xFF) && (result[5] == 0x80) && (result[7] == 0x80));
+		TEST_VERIFY((result[8] == 0) && (result[11] == 0));
+	}
+
+	{
+		uint32 palette[0x100];
+		for(unsigned int i = 0; i < 0x100; i++)
+		{
+			palette[i] = i * 0x01010101;
+		}
+		static const uint8 indices[] = { 0, 1, 2, 0xFF, 0x80 };
+		uint8 result[sizeof(indices) * 4];
+		Framework::PixelConvert::ExpandPalette8(result, indices, sizeof(indices), palette);
+		bool matches = true;
+		for(unsigned int i = 0; i < sizeof(result); i++)
+		{
+			matches &= (result[i] == indices[i / 4]);
+		}
+		TEST_VERIFY(matches);
+	}
+}
+
+static uint8 BlendReference(uint8 src, uint8 dst, uint8 srcAlpha, bool isAlphaChannel, bool isPremultiplied)
+{
+	unsigned int invAlpha = 0xFF - srcAlpha;
+	if(isPremultiplied || isAlphaChannel)
+	{
+		unsigned int result = src + ((dst * invAlpha + 127) / 255);
+		return static_cast<uint8>(std::min<unsigned int>(result, 0xFF));
+	}
+	return static_cast<uint8>((src * srcAlpha + dst * invAlpha + 127) / 255);
+}
+
+static void BlitterTest()
+{
+	typedef Framework::CBitmapBlitter Blitter;
+
+	//Sprites with every alpha value, partly outside the destination
+	Framework::CBitmap sprite(37, 29, 32);
+	for(unsigned int i = 0; i < sprite.GetPixelsSize(); i++)
+	{
+		sprite.GetPixels()[i] = static_cast<uint8>((i * 71) ^ (i >> 3));
+	}
+	auto background = MakeGradient(200, 150, 32);
+
+	Blitter::OperationArray operations;
+	{
+		Blitter::OPERATION operation;
+		operation.source = Framework::CBitmapView(sprite).Crop(2, 3, 30, 20);
+		operation.x = -5;
+		operation.y = 40;
+		operations.push_back(operation);
+	}
+	{
+		Blitter::OPERATION operation;
+		operation.source = sprite;
+		operation.x = 10;
+		operation.y = 50;
+		operation.blendMode = Blitter::BLEND_MODE_ALPHA;
+		operations.push_back(operation);
+	}
+	{
+		Blitter::OPERATION operation;
+		operation.source = sprite;
+		operation.x = 180;
+		operation.y = 130;
+		operation.blendMode = Blitter::BLEND_MODE_PREMULTIPLIED_ALPHA;
+		operations.push_back(operation);
+	}
+	{
+		//Completely clipped
+		Blitter::OPERATION operation;
+		operation.source = sprite;
+		operation.x = -100;
+		operation.y = 0;
+		operations.push_back(operation);
+	}
+
+	auto expected = background;
+	for(const auto& operation : operations)
+	{
+		const auto& src = operation.source;
+		for(unsigned int y = 0; y < src.GetHeight(); y++)
+		{
+			for(unsigned int x = 0; x < src.GetWidth(); x++)
+			{
+				int dstX = operation.x + static_cast<int>(x);
+				int dstY = operation.y + static_cast<int>(y);
+				if((dstX < 0) || (dstY < 0) || (dstX >= 200) || (dstY >= 150)) continue;
+				auto s = src.GetPixel(x, y);
+				auto d = expected.GetPixel(dstX, dstY);
+				if(operation.blendMode != Blitter::BLEND_MODE_COPY)
+				{
+					bool isPremultiplied = (operation.blendMode == Blitter::BLEND_MODE_PREMULTIPLIED_ALPHA);
+					s.r = BlendReference(s.r, d.r, s.a, false, isPremultiplied);
+					s.g = BlendReference(s.g, d.g, s.a, false, isPremultiplied);
+					s.b = BlendReference(s.b, d.b, s.a, false, isPremultiplied);
+					s.a = BlendReference(s.a, d.a, s.a, true, isPremultiplied);
+				}
+				expected.SetPixel(dstX, dstY, s);
+			}
+		}
+	}
+
+	Framework::CThreadPool threadPool(2);
+	auto result = background;
+	Blitter::Blit(result, operations);
+	TEST_VERIFY(AreBitmapsEqual(result, expected));
+	auto poolResult = background;
+	Blitter::Blit(poolResult, operations, &threadPool);
+	TEST_VERIFY(AreBitmapsEqual(poolResult, expected));
+}
+
+static void DrawLineTest()
+{
+	const Framework::CColor color(0x10, 0x20, 0x30, 0xFF);
+	Framework::CBitmap bitmap(64, 48, 32);
+	//Pixels aren't initialized on allocation
+	memset(bitmap.GetPixels(), 0, bitmap.GetPixelsSize());
+	bitmap.DrawLine(-10, 5, 100, 5, color);
+	bitmap.DrawLine(7, 100, 7, -3, color);
+	bitmap.DrawLine(-20, -20, 200, 200, color);
+	bool matches = true;
+	for(unsigned int y = 0; y < bitmap.GetHeight(); y++)
+	{
+		for(unsigned int x = 0; x < bitmap.GetWidth(); x++)
+		{
+			bool onLine = (y == 5) || (x == 7) || (x == y);
+			matches &= ((bitmap.GetPixel(x, y).a == 0xFF) == onLine);
+		}
+	}
+	TEST_VERIFY(matches);
+}
+
+static void CheckProbe(Framework::CStream& stream, Framework::CImageProbe::FORMAT format, unsigned int width, unsigned int height, unsigned int bitsPerPixel)
+{
+	stream.Seek(0, Framework::STREAM_SEEK_SET);
+	auto info = Framework::CImageProbe::ProbeImage(stream);
+	TEST_VERIFY(info.format == format);
+	TEST_VERIFY(info.width == width);
+	TEST_VERIFY(info.height == height);
+	TEST_VERIFY(info.bitsPerPixel == bitsPerPixel);
+}
+
+static void ProbeTest()
+{
+	auto bitmap = MakeGradient(37, 23, 24);
+	{
+		Framework::CMemStream stream;
+		Framework::CPNG::WriteBitmap(bitmap, stream);
+		CheckProbe(stream, Framework::CImageProbe::FORMAT_PNG, 37, 23, 24);
+	}
+	{
+		Framework::CMemStream stream;
+		Framework::CJPEG::WriteBitmap(bitmap, stream);
+		CheckProbe(stream, Framework::CImageProbe::FORMAT_JPEG, 37, 23, 24);
+	}
+	{
+		Framework::CMemStream stream;
+		Framework::CBMP::WriteBitmap(bitmap, stream);
+		CheckProbe(stream, Framework::CImageProbe::FORMAT_BMP, 37, 23, 24);
+	}
+	{
+		static const uint8 header[0x12] = { 0, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x00, 0x01, 0x40, 0x00, 32, 0x20 };
+		Framework::CMemStream stream;
+		stream.Write(header, sizeof(header));
+		CheckProbe(stream, Framework::CImageProbe::FORMAT_TGA, 256, 64, 32);
+	}
+	{
+		static const uint8 garbage[0x20] = { 0x12, 0x34, 0x56 };
+		Framework::CMemStream stream;
+		stream.Write(garbage, sizeof(garbage));
+		stream.Seek(0, Framework::STREAM_SEEK_SET);
+		bool failed = false;
+		try
+		{
+			Framework::CImageProbe::ProbeImage(stream);
+		}
+		catch(const std::exception&)
+		{
+			failed = true;
+		}
+		TEST_VERIFY(failed);
+	}
+}
+
+static void ResizeNearestTest()
+{
+	Framework::CBitmap bitmap(2, 2, 32);
+	bitmap.SetPixel(0, 0, Framework::CColor(1, 2, 3, 4));
+	bitmap.SetPixel(1, 0, Framework::CColor(5, 6, 7, 8));
+	bitmap.SetPixel(0, 1, Framework::CColor(9, 10, 11, 12));
+	bitmap.SetPixel(1, 1, Framework::CColor(13, 14, 15, 16));
+
+	auto result = bitmap.Resize(4, 4);
+	TEST_VERIFY(result.GetWidth() == 4);
+	TEST_VERIFY(result.GetHeight() == 4);
+	for(unsigned int y = 0; y < 4; y++)
+	{
+		for(unsigned int x = 0; x < 4; x++)
+		{
+			auto expected = bitmap.GetPixel(x / 2, y / 2);
+			auto actual = result.GetPixel(x, y);
+			TEST_VERIFY((expected.r == actual.r) && (expected.a == actual.a));
+		}
+	}
+}
+
+static void ResizeFilteredTest()
+{
+	Framework::CThreadPool threadPool(2);
+	for(auto filter : g_filters)
+	{
+		for(unsigned int bpp = 8; bpp <= 32; bpp += 8)
+		{
+			if(bpp == 16) continue;
+
+			//Constant images must stay constant
+			{
+				Framework::CBitmap bitmap(37, 23, bpp);
+				memset(bitmap.GetPixels(), 0x5A, bitmap.GetPixelsSize());
+				auto result = bitmap.Resize(81, 11, filter);
+				bool matches = true;
+				for(unsigned int i = 0; i < result.GetPixelsSize(); i++)
+				{
+					matches &= (result.GetPixels()[i] == 0x5A);
+				}
+				TEST_VERIFY(matches);
+			}
+
+			//Gradients are preserved and output doesn't depend on the thread pool
+			{
+				auto bitmap = MakeGradient(300, 200, bpp);
+				auto result = bitmap.Resize(150, 100, filter);
+				auto poolResult = bitmap.Resize(150, 100, filter, &threadPool);
+				TEST_VERIFY(memcmp(result.GetPixels(), poolResult.GetPixels(), result.GetPixelsSize()) == 0);
+				for(unsigned int y = 10; y < 90; y += 7)
+				{
+					for(unsigned int x = 10; x < 140; x += 7)
+					{
+						auto expected = bitmap.GetPixel(x * 2, y * 2);
+						auto actual = result.GetPixel(x, y);
+						TEST_VERIFY(abs(expected.r - actual.r) <= 2);
+					}
+				}
+			}
+		}
+	}
+}
+
+static Framework::CBitmap ReadTga(uint8 imageType, uint8 bits, uint8 descriptor, int16 width, int16 height, const std::vector<uint8>& data,
+	uint8 colorMapBits = 0, uint8 idSize = 0)
+{
+	uint8 colorMapType = (colorMapBits != 0) ? 1 : 0;
+	int16 colorMapLength = (colorMapBits != 0) ? 2 : 0;
+	Framework::CMemStream stream;
+	stream.Write8(idSize);
+	stream.Write8(colorMapType);
+	stream.Write8(imageType);
+	stream.Write16(0);
+	stream.Write16(colorMapLength);
+	stream.Write8(colorMapBits);
+	stream.Write32(0);
+	stream.Write16(width);
+	stream.Write16(height);
+	stream.Write8(bits);
+	stream.Write8(descriptor);
+	for(unsigned int i = 0; i < idSize; i++)
+	{
+		stream.Write8(0xEE);
+	}
+	stream.Write(data.data(), data.size());
+	stream.Seek(0, Framework::STREAM_SEEK_SET);
+	return Framework::CTGA::ReadBitmap(stream);
+}
+
+static void TgaTest()
+{
+	auto hasPixels =
+		[] (const Framework::CBitmap& bitmap, const std::vector<uint8>& pixels)
+		{
+			return (bitmap.GetPixelsSize() == pixels.size()) && !memcmp(bitmap.GetPixels(), pixels.data(), pixels.size());
+		};
+	{
+		//Bottom-up BGR
+		auto bitmap = ReadTga(2, 24, 0, 2, 2, { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12 });
+		TEST_VERIFY(bitmap.GetBitsPerPixel() == 24);
+		TEST_VERIFY(hasPixels(bitmap, { 9, 8, 7, 12, 11, 10, 3, 2, 1, 6, 5, 4 }));
+	}
+	{
+		//RLE with a repeat packet going over the end of a row and a raw packet
+		auto bitmap = ReadTga(10, 32, 0x20, 3, 2, { 0x83, 1, 2, 3, 4, 0x01, 5, 6, 7, 8, 9, 10, 11, 12 });
+		TEST_VERIFY(bitmap.GetBitsPerPixel() == 32);
+		TEST_VERIFY(hasPixels(bitmap, { 3, 2, 1, 4, 3, 2, 1, 4, 3, 2, 1, 4, 3, 2, 1, 4, 7, 6, 5, 8, 11, 10, 9, 12 }));
+	}
+	{
+		//Color mapped RLE with an image id, expanded to RGBA
+		auto bitmap = ReadTga(9, 8, 0x20, 3, 1, { 10, 20, 30, 40, 50, 60, 0x81, 1, 0x00, 0 }, 24, 3);
+		TEST_VERIFY(bitmap.GetBitsPerPixel() == 32);
+		TEST_VERIFY(hasPixels(bitmap, { 60, 50, 40, 0xFF, 60, 50, 40, 0xFF, 30, 20, 10, 0xFF }));
+	}
+	{
+		//Grayscale
+		auto bitmap = ReadTga(3, 8, 0, 2, 2, { 1, 2, 3, 4 });
+		TEST_VERIFY(bitmap.GetBitsPerPixel() == 8);
+		TEST_VERIFY(hasPixels(bitmap, { 3, 4, 1, 2 }));
+	}
+	{
+		//Truncated RLE data
+		bool hasThrown = false;
+		try
+		{
+			ReadTga(10, 24, 0, 4, 4, { 0x83, 1, 2, 3 });
+		}
+		catch(const std::exception&)
+		{
+			hasThrown = true;
+		}
+		TEST_VERIFY(hasThrown);
+	}
+}
+
+void BitmapTest_Execute()
+{
+	ViewTest();
+	InPlaceTest();
+	PoolTest();
+	PixelConvertTest();
+	BlitterTest();
+	DrawLineTest();
+	ProbeTest();
+	TgaTest();
+	ResizeNearestTest();
+	ResizeFilteredTest();
+}
@@ -1,5 +1,9 @@
+#include <cstring>
+#include <vector>
 #include "bitmap/BMP.h"
+#include "MemStream.h"
 #include "StdStream.h"
+#include "TestDefs.h"
 
 void FillBitmap(Framework::CBitmap& bitmap)
 {
@@ -14,6 +18,41 @@ void FillBitmap(Framework::CBitmap& bitmap)
 	}
 }
 
+static Framework::CBitmap ReadBack(const Framework::CBitmap& bitmap)
+{
+	Framework::CMemStream stream;
+	Framework::CBMP::WriteBitmap(bitmap, stream);
+	stream.Seek(0, Framework::STREAM_SEEK_SET);
+	return Framework::CBMP::ReadBitmap(stream);
+}
+
+static bool HasPixels(const Framework::CBitmap& bitmap, const std::vector<uint8>& pixels)
+{
+	return (bitmap.GetPixelsSize() == pixels.size()) && !memcmp(bitmap.GetPixels(), pixels.data(), pixels.size());
+}
+
+//Headers without a palette, which isn't used by the reader
+static void WriteTestBitmap(Framework::CStream& stream, uint32 width, int32 height, uint16 bpp, uint32 compression, const std::vector<uint8>& data)
+{
+	stream.Write16(0x4D42);
+	stream.Write32(54 + data.size());
+	stream.Write32(0);
+	stream.Write32(54);
+	stream.Write32(40);
+	stream.Write32(width);
+	stream.Write32(height);
+	stream.Write16(1);
+	stream.Write16(bpp);
+	stream.Write32(compression);
+	stream.Write32(data.size());
+	for(unsigned int i = 0; i < 4; i++)
+	{
+		stream.Write32(0);
+	}
+	stream.Write(data.data(), data.size());
+	stream.Seek(0, Framework::STREAM_SEEK_SET);
+}
+
 void BmpTest_Execute()
 {
 	//Write 32-bpp BMP
@@ -42,4 +81,69 @@ void BmpTest_Execute()
 		Framework::CStdStream inputStream("test8.bmp", "rb");
 		auto bitmap = Framework::CBMP::ReadBitmap(inputStream);
 	}
+	//Padded (24 and 8 bits) and unpadded (32 bits) rows
+	for(unsigned int bpp : { 8, 24, 32 })
+	{
+		auto bitmap = Framework::CBitmap(223, 257, bpp);
+		FillBitmap(bitmap);
+		auto readBitmap = ReadBack(bitmap);
+		TEST_VERIFY(readBitmap.GetBitsPerPixel() == bpp);
+		TEST_VERIFY(readBitmap.GetWidth() == 223);
+		TEST_VERIFY(readBitmap.GetHeight() == 257);
+		TEST_VERIFY(!memcmp(readBitmap.GetPixels(), bitmap.GetPixels(), bitmap.GetPixelsSize()));
+	}
+	//Top-down image
+	{
+		auto bitmap = Framework::CBitmap(16, 9, 32);
+		FillBitmap(bitmap);
+		Framework::CMemStream stream;
+		Framework::CBMP::WriteBitmap(bitmap, stream);
+		auto data = stream.GetBuffer();
+		int32 height = -9;
+		memcpy(data + 22, &height, 4);
+		for(unsigned int y = 0; y < (9 / 2); y++)
+		{
+			std::vector<uint8> row(data + 54 + (y * 64), data + 54 + ((y + 1) * 64));
+			memcpy(data + 54 + (y * 64), data + 54 + ((8 - y) * 64), 64);
+			memcpy(data + 54 + ((8 - y) * 64), row.data(), 64);
+		}
+		stream.Seek(0, Framework::STREAM_SEEK_SET);
+		auto readBitmap = Framework::CBMP::ReadBitmap(stream);
+		TEST_VERIFY(!memcmp(readBitmap.GetPixels(), bitmap.GetPixels(), bitmap.GetPixelsSize()));
+	}
+	//RLE8 with an absolute run, a jump over a row and clipping
+	{
+		std::vector<uint8> data =
+		{
+			0x02, 0x07, 0x00, 0x03, 0x01, 0x02, 0x03, 0x00, 0x00, 0x00,
+			0x00, 0x02, 0x02, 0x01,
+			0x04, 0x09, 0x00, 0x01,
+		};
+		Framework::CMemStream stream;
+		WriteTestBitmap(stream, 5, 3, 8, 1, data);
+		auto bitmap = Framework::CBMP::ReadBitmap(stream);
+		TEST_VERIFY(bitmap.GetBitsPerPixel() == 8);
+		TEST_VERIFY(HasPixels(bitmap, { 0, 0, 9, 9, 9, 0, 0, 0, 0, 0, 7, 7, 1, 2, 3 }));
+	}
+	//RLE4, missing end of bitmap marker
+	{
+		std::vector<uint8> data =
+		{
+			0x05, 0x12, 0x00, 0x00,
+			0x00, 0x03, 0x34, 0x50, 0x02, 0x66,
+		};
+		Framework::CMemStream stream;
+		WriteTestBitmap(stream, 5, 2, 4, 2, data);
+		auto bitmap = Framework::CBMP::ReadBitmap(stream);
+		TEST_VERIFY(bitmap.GetBitsPerPixel() == 8);
+		TEST_VERIFY(HasPixels(bitmap, { 3, 4, 5, 6, 6, 1, 2, 1, 2, 1 }));
+	}
+	//Uncompressed 4 bits
+	{
+		std::vector<uint8> data = { 0x12, 0x30, 0x00, 0x00, 0x45, 0x60, 0x00, 0x00 };
+		Framework::CMemStream stream;
+		WriteTestBitmap(stream, 3, 2, 4, 0, data);
+		auto bitmap = Framework::CBMP::ReadBitmap(stream);
+		TEST_VERIFY(HasPixels(bitmap, { 4, 5, 6, 1, 2, 3 }));
+	}
 }
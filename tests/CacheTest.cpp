@@ -0,0 +1,218 @@
+#include "CacheTest.h"
+#include <string>
+#include <thread>
+#include <vector>
+#include "Cache.h"
+#include "TestDefs.h"
+
+using namespace Framework;
+
+static CACHE_SETTINGS MakeSettings(CACHE_POLICY policy, uint64 capacity)
+{
+	CACHE_SETTINGS settings;
+	settings.policy = policy;
+	settings.capacity = capacity;
+	settings.shardCount = 1;
+	return settings;
+}
+
+static void LruTest()
+{
+	CCache<int, std::string> cache(MakeSettings(CACHE_POLICY_LRU, 3));
+	cache.Insert(1, "one");
+	cache.Insert(2, "two");
+	cache.Insert(3, "three");
+
+	//Using 1 makes 2 the oldest entry
+	TEST_VERIFY(*cache.Find(1) == "one");
+	cache.Insert(4, "four");
+	TEST_VERIFY(!cache.Find(2));
+	TEST_VERIFY(cache.Find(1));
+	TEST_VERIFY(cache.Find(3));
+	TEST_VERIFY(cache.Find(4));
+
+	//Replacing keeps a single entry
+	cache.Insert(4, "FOUR");
+	TEST_VERIFY(*cache.Find(4) == "FOUR");
+
+	auto stats = cache.GetStats();
+	TEST_VERIFY(stats.entryCount == 3);
+	TEST_VERIFY(stats.evictionCount == 1);
+	TEST_VERIFY(stats.missCount == 1);
+	TEST_VERIFY(stats.hitCount == 5);
+
+	TEST_VERIFY(cache.Remove(1));
+	TEST_VERIFY(!cache.Remove(1));
+	cache.Clear();
+	TEST_VERIFY(cache.GetStats().entryCount == 0);
+}
+
+static void WeightTest()
+{
+	CCache<int, std::string> cache(MakeSettings(CACHE_POLICY_LRU, 10),
+	                               [](const int&, const std::string& value) { return value.size(); });
+	cache.Insert(1, "aaaa");
+	cache.Insert(2, "bbbb");
+	TEST_VERIFY(cache.GetStats().weight == 8);
+
+	//Needs both older entries out of the way
+	cache.Insert(3, "cccccccc");
+	TEST_VERIFY(!cache.Find(1));
+	TEST_VERIFY(!cache.Find(2));
+	TEST_VERIFY(cache.Find(3));
+	TEST_VERIFY(cache.GetStats().weight == 8);
+
+	//Too heavy to be cached, but still handed back
+	auto value = cache.Insert(4, std::string(11, 'd'));
+	TEST_VERIFY(value && (value->size() == 11));
+	TEST_VERIFY(!cache.Find(4));
+	TEST_VERIFY(cache.Find(3));
+}
+
+static void ArcScanTest()
+{
+	//Entries used repeatedly survive a scan over many keys used once, which would flush an LRU cache
+	static const int hotCount = 8;
+	for(auto policy : {CACHE_POLICY_LRU, CACHE_POLICY_ARC})
+	{
+		CCache<int, int> cache(MakeSettings(policy, 16));
+		for(int pass = 0; pass < 2; pass++)
+		{
+			for(int i = 0; i < hotCount; i++)
+			{
+				cache.FindOrInsert(i, [i]() { return i; });
+			}
+		}
+		for(int i = 1000; i < 1100; i++)
+		{
+			cache.Insert(i, i);
+		}
+		int hotHitCount = 0;
+		for(int i = 0; i < hotCount; i++)
+		{
+			if(auto value = cache.Find(i))
+			{
+				TEST_VERIFY(*value == i);
+				hotHitCount++;
+			}
+		}
+		TEST_VERIFY(hotHitCount == ((policy == CACHE_POLICY_ARC) ? hotCount : 0));
+		TEST_VERIFY(cache.GetStats().entryCount == 16);
+	}
+}
+
+static void ArcAdaptTest()
+{
+	CCache<int, int> cache(MakeSettings(CACHE_POLICY_ARC, 4));
+	//0 and 1 are used twice, 2 and 3 once
+	for(int i = 0; i < 4; i++)
+	{
+		cache.FindOrInsert(i, [i]() { return i; });
+	}
+	cache.Find(0);
+	cache.Find(1);
+
+	//Evicts 2, which is remembered
+	cache.Insert(4, 4);
+	TEST_VERIFY(!cache.Find(2));
+
+	//2 coming back soon after its eviction counts as a second use, evicts 3 instead
+	cache.Insert(2, 2);
+	TEST_VERIFY(!cache.Find(3));
+
+	//Scan only pushes out the least recently used of the frequent entries
+	for(int i = 100; i < 110; i++)
+	{
+		cache.Insert(i, i);
+	}
+	TEST_VERIFY(!cache.Find(0));
+	TEST_VERIFY(cache.Find(1));
+	TEST_VERIFY(cache.Find(2));
+	TEST_VERIFY(cache.GetStats().entryCount == 4);
+}
+
+static void TimeToLiveTest()
+{
+	auto settings = MakeSettings(CACHE_POLICY_LRU, 4);
+	settings.timeToLive = std::chrono::milliseconds(20);
+	CCache<int, int> cache(settings);
+	cache.Insert(1, 1);
+	TEST_VERIFY(cache.Find(1));
+	std::this_thread::sleep_for(std::chrono::milliseconds(40));
+	TEST_VERIFY(!cache.Find(1));
+	auto stats = cache.GetStats();
+	TEST_VERIFY(stats.expirationCount == 1);
+	TEST_VERIFY(stats.entryCount == 0);
+}
+
+static void MetricsTest()
+{
+	auto settings = MakeSettings(CACHE_POLICY_LRU, 1);
+	settings.metricsName = "cache_test";
+	auto& registry = Metrics::CRegistry::GetInstance();
+	auto& hits = registry.GetCounter("framework_cache_hits_total", "cache=\"cache_test\"");
+	auto& misses = registry.GetCounter("framework_cache_misses_total", "cache=\"cache_test\"");
+	auto& weight = registry.GetGauge("framework_cache_weight", "cache=\"cache_test\"");
+	auto baseHits = hits.GetValue();
+	auto baseMisses = misses.GetValue();
+	{
+		CCache<int, int> cache(settings);
+		cache.Find(1);
+		cache.Insert(1, 1);
+		cache.Find(1);
+		cache.Insert(2, 2);
+		TEST_VERIFY(hits.GetValue() == baseHits + 1);
+		TEST_VERIFY(misses.GetValue() == baseMisses + 1);
+		TEST_VERIFY(weight.GetValue() == 1);
+	}
+	//Entries are gone with the cache
+	TEST_VERIFY(weight.GetValue() == 0);
+}
+
+static void ConcurrencyTest()
+{
+	static const unsigned int threadCount = 4;
+	static const int keyCount = 512;
+
+	for(auto policy : {CACHE_POLICY_LRU, CACHE_POLICY_ARC})
+	{
+		CACHE_SETTINGS settings;
+		settings.policy = policy;
+		settings.capacity = 256;
+		settings.shardCount = 8;
+		CCache<int, int> cache(settings);
+		std::vector<std::thread> threads;
+		for(unsigned int t = 0; t < threadCount; t++)
+		{
+			threads.emplace_back(
+			    [&, t]() {
+				    for(int i = 0; i < 20000; i++)
+				    {
+					    int key = (i * 7 + t * 13) % keyCount;
+					    auto value = cache.FindOrInsert(key, [key]() { return key * 2; });
+					    TEST_VERIFY(*value == key * 2);
+					    if((i % 97) == 0) cache.Remove(key);
+				    }
+			    });
+		}
+		for(auto& thread : threads)
+		{
+			thread.join();
+		}
+		auto stats = cache.GetStats();
+		TEST_VERIFY(stats.weight <= 256);
+		TEST_VERIFY(stats.weight == stats.entryCount);
+		TEST_VERIFY(stats.hitCount + stats.missCount == threadCount * 20000);
+	}
+}
+
+void CacheTest_Execute()
+{
+	LruTest();
+	WeightTest();
+	ArcScanTest();
+	ArcAdaptTest();
+	TimeToLiveTest();
+	MetricsTest();
+	ConcurrencyTest();
+}
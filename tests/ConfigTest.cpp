@@ -0,0 +1,90 @@
+#include "ConfigTest.h"
+#include <cstring>
+#include "Config.h"
+#include "StdStream.h"
+#include "TestDefs.h"
+
+static const char* g_configPath = "config.xml";
+
+static void VerifyPreferences(Framework::CConfig& config)
+{
+	TEST_VERIFY(config.GetPreferenceInteger("test.integer") == -1234);
+	TEST_VERIFY(config.GetPreferenceBoolean("test.boolean") == true);
+	TEST_VERIFY(config.GetPreferenceFloat("test.float") == 0.5f);
+	TEST_VERIFY(!strcmp(config.GetPreferenceString("test.string"), "Bacon & Eggs"));
+	TEST_VERIFY(config.GetPreferencePath("test.path") == fs::path("some/path.bin"));
+}
+
+void ConfigTest_Execute()
+{
+	fs::remove(g_configPath);
+	fs::remove(std::string(g_configPath) + ".cache");
+
+	{
+		Framework::CConfig config(g_configPath, false, true);
+		config.RegisterPreferenceInteger("test.integer", -1234);
+		config.RegisterPreferenceBoolean("test.boolean", true);
+		config.RegisterPreferenceFloat("test.float", 0.5f);
+		config.RegisterPreferenceString("test.string", "Bacon & Eggs");
+		config.RegisterPreferencePath("test.path", "some/path.bin");
+		config.Save();
+		TEST_VERIFY(fs::exists(config.GetCachePath()));
+	}
+
+	//Loaded from cache
+	{
+		Framework::CConfig config(g_configPath, true, true);
+		VerifyPreferences(config);
+	}
+
+	//Cache is ignored if not enabled
+	{
+		Framework::CConfig config(g_configPath, true);
+		VerifyPreferences(config);
+	}
+
+	//Changing the XML makes the cache stale
+	{
+		static const char* configXml =
+			"<Config>"
+			"<Preference Name=\"test.integer\" Type=\"integer\" Value=\"42\" />"
+			"</Config>";
+		Framework::CStdStream output(g_configPath, "wb");
+		output.Write(configXml, strlen(configXml));
+	}
+	{
+		Framework::CConfig config(g_configPath, false, true);
+		TEST_VERIFY(config.GetPreferenceInteger("test.integer") == 42);
+		TEST_VERIFY(!strcmp(config.GetPreferenceString("test.string"), ""));
+	}
+	{
+		Framework::CConfig config(g_configPath, true, true);
+		TEST_VERIFY(config.GetPreferenceInteger("test.integer") == 42);
+	}
+
+	//Handles
+	{
+		Framework::CConfig config(g_configPath, false);
+		auto intHandle = config.RegisterPreferenceInteger("test.integer", 0);
+		auto floatHandle = config.RegisterPreferenceFloat("test.float", 0.25f);
+		auto boolHandle = config.RegisterPreferenceBoolean("test.integer", false);
+		TEST_VERIFY(intHandle.IsValid());
+		TEST_VERIFY(intHandle.Get() == 42);
+		TEST_VERIFY(floatHandle.Get() == 0.25f);
+		TEST_VERIFY(!boolHandle);
+		TEST_VERIFY(config.RegisterPreferenceInteger("test.integer", 0).Get() == 42);
+
+		int changedValue = 0;
+		unsigned int changeCount = 0;
+		auto connection = intHandle.ValueChanged().Connect(
+		    [&](int value) {
+			    changedValue = value;
+			    changeCount++;
+		    });
+		config.SetPreferenceInteger("test.integer", 7);
+		config.SetPreferenceInteger("test.integer", 7);
+		TEST_VERIFY(intHandle.Get() == 7);
+		TEST_VERIFY(changedValue == 7);
+		TEST_VERIFY(changeCount == 1);
+	}
+}
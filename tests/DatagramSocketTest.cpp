@@ -0,0 +1,122 @@
+#include "DatagramSocketTest.h"
+#include <vector>
+#include "DatagramSocket.h"
+#include "TestDefs.h"
+
+using namespace Framework;
+
+static sockaddr_in MakeLoopbackAddress(uint16 port)
+{
+	sockaddr_in address = {};
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	address.sin_port = htons(port);
+	return address;
+}
+
+static uint8 GetPacketByte(uint32 packetIndex, size_t byteIndex)
+{
+	return static_cast<uint8>((packetIndex * 31) + byteIndex);
+}
+
+static size_t ReceiveAll(CDatagramSocket& socket, std::vector<std::vector<uint8>>& packets, size_t expectedCount, uint16 sourcePort)
+{
+	while(packets.size() < expectedCount)
+	{
+		if(!socket.WaitForPackets(1000)) break;
+		size_t count = socket.Receive();
+		for(size_t i = 0; i < count; i++)
+		{
+			const auto& packet = socket.GetReceivedPacket(i);
+			TEST_VERIFY(ntohs(packet.address.sin_port) == sourcePort);
+			packets.emplace_back(packet.data, packet.data + packet.size);
+		}
+	}
+	return packets.size();
+}
+
+static void TransferTest(bool receiveCoalescing)
+{
+	const uint32 batchSize = 32;
+	CDatagramSocket receiver(MakeLoopbackAddress(0), batchSize);
+	CDatagramSocket sender(MakeLoopbackAddress(0), batchSize);
+	if(receiveCoalescing && !receiver.EnableReceiveCoalescing())
+	{
+		return;
+	}
+	auto receiverAddress = MakeLoopbackAddress(ntohs(receiver.GetLocalAddress().sin_port));
+	uint16 senderPort = ntohs(sender.GetLocalAddress().sin_port);
+
+	//Runs of packets with the same size can go through segmentation, with a shorter one ending some of them
+	std::vector<size_t> sizes;
+	for(uint32 i = 0; i < 256; i++)
+	{
+		size_t run = i / 16;
+		size_t size = 100 + (run * 80);
+		if((i % 16) == 15 && (run % 2) == 0) size /= 2;
+		if((run % 5) == 4) size = 1 + (i * 7) % sender.GetMaxPacketSize();
+		sizes.push_back(size);
+	}
+
+	std::vector<std::vector<uint8>> packets;
+	for(uint32 batch = 0; batch < sizes.size(); batch += batchSize)
+	{
+		for(uint32 i = batch; i < batch + batchSize; i++)
+		{
+			auto data = sender.BeginPacket();
+			for(size_t j = 0; j < sizes[i]; j++)
+			{
+				data[j] = GetPacketByte(i, j);
+			}
+			sender.EndPacket(sizes[i], receiverAddress);
+		}
+		TEST_VERIFY(sender.Flush() == batchSize);
+		//Keeps the receive buffer from overflowing
+		TEST_VERIFY(ReceiveAll(receiver, packets, batch + batchSize, senderPort) == batch + batchSize);
+	}
+
+	//Loopback keeps packets in order
+	for(uint32 i = 0; i < sizes.size(); i++)
+	{
+		TEST_VERIFY(packets[i].size() == sizes[i]);
+		for(size_t j = 0; j < sizes[i]; j++)
+		{
+			TEST_VERIFY(packets[i][j] == GetPacketByte(i, j));
+		}
+	}
+}
+
+static void OversizedPacketTest()
+{
+	CDatagramSocket receiver(MakeLoopbackAddress(0), 8, 100);
+	CDatagramSocket sender(MakeLoopbackAddress(0));
+	auto receiverAddress = MakeLoopbackAddress(ntohs(receiver.GetLocalAddress().sin_port));
+
+	std::vector<uint8> data(200, 0x5A);
+	sender.Send(data.data(), 200, receiverAddress);
+	sender.Send(data.data(), 100, receiverAddress);
+	sender.Send(data.data(), 101, receiverAddress);
+	sender.Send(data.data(), 50, receiverAddress);
+	TEST_VERIFY(sender.Flush() == 4);
+
+	std::vector<size_t> sizes;
+	while(sizes.size() < 2 && receiver.WaitForPackets(1000))
+	{
+		size_t count = receiver.Receive();
+		for(size_t i = 0; i < count; i++)
+		{
+			sizes.push_back(receiver.GetReceivedPacket(i).size);
+		}
+	}
+	TEST_VERIFY(sizes.size() == 2);
+	TEST_VERIFY(sizes[0] == 100);
+	TEST_VERIFY(sizes[1] == 50);
+	TEST_VERIFY(receiver.Receive() == 0);
+}
+
+void DatagramSocketTest_Execute()
+{
+	TransferTest(false);
+	TransferTest(true);
+	OversizedPacketTest();
+}
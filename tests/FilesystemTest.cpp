@@ -0,0 +1,216 @@
+#include "FilesystemTest.h"
+#include <algorithm>
+#include <set>
+#include <stdexcept>
+#include "DirectoryWalker.h"
+#include "DiskCache.h"
+#include "StdStreamUtils.h"
+#include "TestDefs.h"
+#include "ThreadPool.h"
+
+using namespace Framework;
+
+static const fs::path g_walkRoot = "walk_test";
+
+static void CreateWalkTree()
+{
+	std::error_code errorCode;
+	fs::remove_all(g_walkRoot, errorCode);
+	//Enough directories for several workers to be busy at once
+	for(unsigned int i = 0; i < 16; i++)
+	{
+		auto directory = g_walkRoot / ("dir" + std::to_string(i)) / "nested";
+		fs::create_directories(directory);
+		for(unsigned int j = 0; j < 8; j++)
+		{
+			auto stream = CreateOutputStdStream((directory / ("file" + std::to_string(j) + ".bin")).native());
+			//First file stays empty, opening it is enough to create it
+			std::vector<uint8> contents(i * 8 + j, 0xAA);
+			if(!contents.empty())
+			{
+				stream.Write(contents.data(), contents.size());
+			}
+		}
+	}
+	fs::create_directories(g_walkRoot / "empty");
+}
+
+static std::set<fs::path> GetExpectedPaths()
+{
+	std::set<fs::path> paths;
+	for(const auto& entry : fs::recursive_directory_iterator(g_walkRoot))
+	{
+		paths.insert(fs::relative(entry.path(), g_walkRoot));
+	}
+	return paths;
+}
+
+static void DirectoryWalkerTest_Walk()
+{
+	auto expectedPaths = GetExpectedPaths();
+	CThreadPool threadPool(4);
+	for(auto pool : {static_cast<CThreadPool*>(nullptr), &threadPool})
+	{
+		auto listing = CDirectoryWalker::Walk(g_walkRoot, CDirectoryWalker::WALK_FLAG_NONE, pool);
+		TEST_VERIFY(listing.GetEntryCount() == expectedPaths.size());
+		TEST_VERIFY(listing.GetErrorCount() == 0);
+
+		std::set<fs::path> paths;
+		for(const auto& entry : listing)
+		{
+			TEST_VERIFY(entry.path[entry.pathLength] == 0);
+			fs::path path(entry.path);
+			paths.insert(path);
+			bool isDirectory = fs::is_directory(g_walkRoot / path);
+			TEST_VERIFY(entry.type == (isDirectory ? CDirectoryWalker::ENTRY_TYPE_DIRECTORY : CDirectoryWalker::ENTRY_TYPE_FILE));
+		}
+		TEST_VERIFY(paths == expectedPaths);
+	}
+}
+
+static void DirectoryWalkerTest_Metadata()
+{
+	//Trailing separator on the root doesn't change relative paths
+	auto root = g_walkRoot / "";
+	auto listing = CDirectoryWalker::Walk(root, CDirectoryWalker::WALK_FLAG_METADATA);
+	for(const auto& entry : listing)
+	{
+		TEST_VERIFY(entry.hasMetadata);
+		TEST_VERIFY(entry.path[0] != fs::path::preferred_separator);
+		if(entry.type == CDirectoryWalker::ENTRY_TYPE_FILE)
+		{
+			TEST_VERIFY(entry.size == fs::file_size(g_walkRoot / entry.path));
+			TEST_VERIFY(entry.modificationTime != 0);
+		}
+	}
+}
+
+static void DirectoryWalkerTest_Move()
+{
+	auto listing = CDirectoryWalker::Walk(g_walkRoot);
+	size_t entryCount = listing.GetEntryCount();
+	auto movedListing = std::move(listing);
+	TEST_VERIFY(movedListing.GetEntryCount() == entryCount);
+	TEST_VERIFY(listing.GetEntryCount() == 0);
+	TEST_VERIFY(listing.begin() == listing.end());
+	TEST_VERIFY(fs::exists(g_walkRoot / movedListing[0].path));
+}
+
+static void DirectoryWalkerTest_InvalidRoot()
+{
+	bool hasThrown = false;
+	try
+	{
+		CDirectoryWalker::Walk(g_walkRoot / "missing");
+	}
+	catch(const std::exception&)
+	{
+		hasThrown = true;
+	}
+	TEST_VERIFY(hasThrown);
+}
+
+static const fs::path g_cacheDirectory = "disk_cache_test";
+
+static std::string ReadEntry(const CDiskCache::EntryStreamPtr& stream)
+{
+	std::string result(static_cast<size_t>(stream->GetLength()), 0);
+	stream->Read(&result[0], result.size());
+	return result;
+}
+
+static void DiskCacheTest_InsertFind()
+{
+	CDiskCache cache(g_cacheDirectory, 0x1000);
+	auto key = CDiskCache::MakeKey("source.png");
+	TEST_VERIFY(!cache.Find(key));
+
+	std::string value = "decoded pixels";
+	TEST_VERIFY(cache.Insert(key, value.data(), value.size()));
+	auto stream = cache.Find(key);
+	TEST_VERIFY(stream);
+	TEST_VERIFY(ReadEntry(stream) == value);
+	TEST_VERIFY(cache.GetTotalSize() == value.size());
+
+	//Too big to ever fit
+	std::vector<uint8> bigValue(0x1001);
+	TEST_VERIFY(!cache.Insert(CDiskCache::MakeKey("big"), bigValue.data(), bigValue.size()));
+
+	unsigned int produceCount = 0;
+	auto produce = [&]() { produceCount++; return std::vector<uint8>(10, 0x55); };
+	auto producedKey = CDiskCache::MakeKey("produced");
+	TEST_VERIFY(cache.FindOrInsert(producedKey, produce)->GetLength() == 10);
+	TEST_VERIFY(cache.FindOrInsert(producedKey, produce)->GetLength() == 10);
+	TEST_VERIFY(produceCount == 1);
+	cache.Clear();
+	TEST_VERIFY(cache.GetEntryCount() == 0);
+	TEST_VERIFY(cache.GetTotalSize() == 0);
+}
+
+static void DiskCacheTest_Eviction()
+{
+	std::vector<uint8> value(0x400, 0xAA);
+	CDiskCache cache(g_cacheDirectory, 0x1000);
+	for(unsigned int i = 0; i < 4; i++)
+	{
+		TEST_VERIFY(cache.Insert(CDiskCache::MakeKey(std::to_string(i)), value.data(), value.size()));
+	}
+	//Makes entry 0 the most recently used, 1 becomes the oldest
+	TEST_VERIFY(cache.Find(CDiskCache::MakeKey("0")));
+	TEST_VERIFY(cache.Insert(CDiskCache::MakeKey("4"), value.data(), value.size()));
+	TEST_VERIFY(cache.GetEntryCount() == 4);
+	TEST_VERIFY(cache.GetTotalSize() == 0x1000);
+	TEST_VERIFY(cache.Find(CDiskCache::MakeKey("0")));
+	TEST_VERIFY(!cache.Find(CDiskCache::MakeKey("1")));
+	TEST_VERIFY(!fs::exists(g_cacheDirectory / "index"));
+	cache.Flush();
+	TEST_VERIFY(fs::exists(g_cacheDirectory / "index"));
+}
+
+static void DiskCacheTest_Persistence()
+{
+	std::string value = "compiled shader";
+	auto key = CDiskCache::MakeKey("shader source");
+	{
+		CDiskCache cache(g_cacheDirectory, 0x10000);
+		cache.Clear();
+		TEST_VERIFY(cache.Insert(key, value.data(), value.size()));
+	}
+	{
+		//Loaded from the index
+		CDiskCache cache(g_cacheDirectory, 0x10000);
+		TEST_VERIFY(cache.GetEntryCount() == 1);
+		TEST_VERIFY(ReadEntry(cache.Find(key)) == value);
+	}
+	{
+		//Index is gone after a crash, entries are found again and leftovers are removed
+		fs::remove(g_cacheDirectory / "index");
+		CreateOutputStdStream((g_cacheDirectory / "leftover.tmp0").native());
+		CDiskCache cache(g_cacheDirectory, 0x10000);
+		TEST_VERIFY(cache.GetEntryCount() == 1);
+		TEST_VERIFY(cache.GetTotalSize() == value.size());
+		TEST_VERIFY(ReadEntry(cache.Find(key)) == value);
+		TEST_VERIFY(!fs::exists(g_cacheDirectory / "leftover.tmp0"));
+	}
+	{
+		//Lower limit evicts on load
+		CDiskCache cache(g_cacheDirectory, 4);
+		TEST_VERIFY(cache.GetEntryCount() == 0);
+	}
+}
+
+void FilesystemTest_Execute()
+{
+	CreateWalkTree();
+	DirectoryWalkerTest_Walk();
+	DirectoryWalkerTest_Metadata();
+	DirectoryWalkerTest_Move();
+	DirectoryWalkerTest_InvalidRoot();
+	fs::remove_all(g_walkRoot);
+
+	fs::remove_all(g_cacheDirectory);
+	DiskCacheTest_InsertFind();
+	DiskCacheTest_Eviction();
+	DiskCacheTest_Persistence();
+	fs::remove_all(g_cacheDirectory);
+}
@@ -0,0 +1,212 @@
+#include "HashUtilsTest.h"
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "HashUtils.h"
+#include "StdStream.h"
+#include "ThreadPool.h"
+#include "TestDefs.h"
+
+template <size_t Size>
+static std::string HashToString(const std::array<uint8, Size>& hash)
+{
+	static const char* digits = "0123456789abcdef";
+	std::string result;
+	for(auto value : hash)
+	{
+		result += digits[value >> 4];
+		result += digits[value & 0x0F];
+	}
+	return result;
+}
+
+void HashUtilsTest_Execute()
+{
+	TEST_VERIFY(HashToString(Framework::HashUtils::ComputeSha1("", 0)) == "da39a3ee5e6b4b0d3255bfef95601890afd80709");
+	TEST_VERIFY(HashToString(Framework::HashUtils::ComputeSha1("abc", 3)) == "a9993e364706816aba3e25717850c26c9cd0d89d");
+	{
+		static const char* input = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+		TEST_VERIFY(HashToString(Framework::HashUtils::ComputeSha1(input, strlen(input))) == "84983e441c3bd26ebaae4aa1f95129e5e54670f1");
+	}
+	{
+		std::vector<uint8> input(1000000, 'a');
+		TEST_VERIFY(HashToString(Framework::HashUtils::ComputeSha1(input.data(), input.size())) == "34aa973cd4c4daa4f61eeb2bdbad27316534016f");
+	}
+	TEST_VERIFY(HashToString(Framework::HashUtils::ComputeSha256("", 0)) == "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+	TEST_VERIFY(HashToString(Framework::HashUtils::ComputeSha256("abc", 3)) == "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+	{
+		static const char* input = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+		TEST_VERIFY(HashToString(Framework::HashUtils::ComputeSha256(input, strlen(input))) == "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+	}
+	{
+		//Parts of different sizes to go through the partial block handling
+		std::vector<uint8> input(1000000, 'a');
+		Framework::HashUtils::CSha256Hasher hasher;
+		size_t offset = 0;
+		size_t partSize = 1;
+		while(offset != input.size())
+		{
+			size_t size = std::min(partSize, input.size() - offset);
+			hasher.Update(input.data() + offset, size);
+			offset += size;
+			partSize = (partSize * 3) + 1;
+		}
+		TEST_VERIFY(HashToString(hasher.Finalize()) == "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+	}
+	{
+		std::vector<uint8> input(200);
+		for(size_t i = 0; i < input.size(); i++)
+		{
+			input[i] = static_cast<uint8>(i * 7);
+		}
+		//Sizes around the padding boundaries
+		for(size_t size = 0; size < input.size(); size++)
+		{
+			Framework::HashUtils::CSha256Hasher hasher;
+			size_t split = size / 3;
+			hasher.Update(input.data(), split);
+			hasher.Update(input.data() + split, size - split);
+			TEST_VERIFY(hasher.Finalize() == Framework::HashUtils::ComputeSha256(input.data(), size));
+		}
+	}
+	TEST_VERIFY(Framework::HashUtils::ComputeCrc32("123456789", 9) == 0xCBF43926);
+	TEST_VERIFY(Framework::HashUtils::ComputeCrc32c("123456789", 9) == 0xE3069283);
+	{
+		//Large enough to go through the folding and interleaved paths
+		std::vector<uint8> input(20000);
+		for(size_t i = 0; i < input.size(); i++)
+		{
+			input[i] = static_cast<uint8>(i * 7);
+		}
+		for(size_t size : {0, 1, 15, 63, 64, 65, 200, 6143, 6144, 6145, 20000})
+		{
+			size_t split = size / 3;
+			uint32 crc32 = Framework::HashUtils::ComputeCrc32(input.data(), split);
+			crc32 = Framework::HashUtils::ComputeCrc32(input.data() + split, size - split, crc32);
+			TEST_VERIFY(crc32 == Framework::HashUtils::ComputeCrc32(input.data(), size));
+			uint32 crc32c = Framework::HashUtils::ComputeCrc32c(input.data(), split);
+			crc32c = Framework::HashUtils::ComputeCrc32c(input.data() + split, size - split, crc32c);
+			TEST_VERIFY(crc32c == Framework::HashUtils::ComputeCrc32c(input.data(), size));
+		}
+		TEST_VERIFY(Framework::HashUtils::ComputeCrc32(input.data(), input.size()) == 0x5917D438);
+		TEST_VERIFY(Framework::HashUtils::ComputeCrc32c(input.data(), input.size()) == 0x949049EA);
+	}
+	TEST_VERIFY(Framework::HashUtils::ComputeXxh3_64("", 0) == 0x2D06800538D394C2ULL);
+	{
+		struct XXH3_VECTOR
+		{
+			size_t size;
+			uint64 seed;
+			uint64 hash64;
+			uint64 hash128Low;
+			uint64 hash128High;
+		};
+
+		//Values from the xxHash reference implementation, for each of the size classes
+		static const XXH3_VECTOR vectors[] =
+		{
+			{3, 0, 0xC3489259E968AD9EULL, 0xC3489259E968AD9EULL, 0x656E81C56E41FE02ULL},
+			{3, 0x1234, 0x539DE761FD2A69C3ULL, 0x539DE761FD2A69C3ULL, 0x0BAE3AB208073DC0ULL},
+			{12, 0, 0x305C5BAE3681D0E0ULL, 0x279145497900C103ULL, 0xE24B58C4560565D9ULL},
+			{12, 0x1234, 0xCC42AC148D03770CULL, 0x181FDFF61E26D841ULL, 0x4C774C4E2E152C97ULL},
+			{100, 0, 0x6DBB812CF19D012EULL, 0x3DC31A0BA04530CDULL, 0x858BE3B5082C7EB7ULL},
+			{100, 0x1234, 0x35216162ABECDFE7ULL, 0x336EFBF409F8B7B9ULL, 0xCE33E0EC00EDF8E5ULL},
+			{200, 0, 0x7C64F3B17285E96AULL, 0x0497BDB3D145CCD6ULL, 0xDBFFF5E13C798AB9ULL},
+			{200, 0x1234, 0x0CBD4B7BF3C30EEDULL, 0x908E76A099D3E9F0ULL, 0x2D48254A45414643ULL},
+			{1000, 0, 0x10AD30264426C830ULL, 0x10AD30264426C830ULL, 0xABEE229CDADAD76DULL},
+			{1000, 0x1234, 0x19001D85CCC9FABCULL, 0x19001D85CCC9FABCULL, 0xC08F4348044D79EDULL},
+			{5000, 0, 0x6ABE8BE5ABCB2760ULL, 0x6ABE8BE5ABCB2760ULL, 0xA4BA2A60FB07E016ULL},
+			{5000, 0x1234, 0x7CCFA2BA0906CFFFULL, 0x7CCFA2BA0906CFFFULL, 0xD7E53233E84CD6A0ULL},
+		};
+
+		std::vector<uint8> input(5000);
+		for(size_t i = 0; i < input.size(); i++)
+		{
+			input[i] = static_cast<uint8>(i * 7);
+		}
+		for(const auto& testVector : vectors)
+		{
+			Framework::HashUtils::HASH128 hash128;
+			hash128.low = testVector.hash128Low;
+			hash128.high = testVector.hash128High;
+			TEST_VERIFY(Framework::HashUtils::ComputeXxh3_64(input.data(), testVector.size, testVector.seed) == testVector.hash64);
+			TEST_VERIFY(Framework::HashUtils::ComputeXxh3_128(input.data(), testVector.size, testVector.seed) == hash128);
+
+			//Parts of different sizes to go through the buffering
+			Framework::HashUtils::CXxh3Hasher hasher(testVector.seed);
+			size_t offset = 0;
+			size_t partSize = 1;
+			while(offset != testVector.size)
+			{
+				size_t size = std::min(partSize, testVector.size - offset);
+				hasher.Update(input.data() + offset, size);
+				offset += size;
+				partSize = (partSize * 3) + 1;
+			}
+			TEST_VERIFY(hasher.GetHash64() == testVector.hash64);
+			TEST_VERIFY(hasher.GetHash128() == hash128);
+		}
+	}
+	TEST_VERIFY(HashToString(Framework::HashUtils::ComputeBlake3("", 0)) == "af1349b9f5f9a1a6a0404dea36dcc9499bcb25c9adc112b7cc9a93cae41f3262");
+	TEST_VERIFY(HashToString(Framework::HashUtils::ComputeBlake3("abc", 3)) == "6437b3ac38465133ffb63b75273a8db548c558465d79db03fd359c6cd5bd9d85");
+	{
+		struct BLAKE3_VECTOR
+		{
+			size_t size;
+			const char* hash;
+		};
+
+		//Values from the BLAKE3 test vectors, input bytes repeat from 0 to 250
+		static const BLAKE3_VECTOR vectors[] =
+		{
+			{1, "2d3adedff11b61f14c886e35afa036736dcd87a74d27b5c1510225d0f592e213"},
+			{1023, "10108970eeda3eb932baac1428c7a2163b0e924c9a9e25b35bba72b28f70bd11"},
+			{1024, "42214739f095a406f3fc83deb889744ac00df831c10daa55189b5d121c855af7"},
+			{1025, "d00278ae47eb27b34faecf67b4fe263f82d5412916c1ffd97c8cb7fb814b8444"},
+			{2049, "5f4d72f40d7a5f82b15ca2b2e44b1de3c2ef86c426c95c1af0b6879522563030"},
+			{3072, "b98cb0ff3623be03326b373de6b9095218513e64f1ee2edd2525c7ad1e5cffd2"},
+			{31744, "62b6960e1a44bcc1eb1a611a8d6235b6b4b78f32e7abc4fb4c6cdcce94895c47"},
+			{102400, "bc3e3d41a1146b069abffad3c0d44860cf664390afce4d9661f7902e7943e085"},
+		};
+
+		std::vector<uint8> input(0x300001);
+		for(size_t i = 0; i < input.size(); i++)
+		{
+			input[i] = static_cast<uint8>(i % 251);
+		}
+		for(const auto& testVector : vectors)
+		{
+			TEST_VERIFY(HashToString(Framework::HashUtils::ComputeBlake3(input.data(), testVector.size)) == testVector.hash);
+
+			Framework::HashUtils::CBlake3Hasher hasher;
+			size_t offset = 0;
+			size_t partSize = 1;
+			while(offset != testVector.size)
+			{
+				size_t size = std::min(partSize, testVector.size - offset);
+				hasher.Update(input.data() + offset, size);
+				offset += size;
+				partSize = (partSize * 3) + 1;
+			}
+			TEST_VERIFY(HashToString(hasher.GetHash()) == testVector.hash);
+		}
+
+		//Large enough to be split in subtrees hashed by different threads
+		Framework::CThreadPool threadPool(4);
+		for(size_t size : {0x100000, 0x100001, 0x200000, 0x300001})
+		{
+			auto hash = Framework::HashUtils::ComputeBlake3(input.data(), size);
+			TEST_VERIFY(Framework::HashUtils::ComputeBlake3(input.data(), size, &threadPool) == hash);
+			Framework::HashUtils::CBlake3Hasher hasher;
+			hasher.Update(input.data(), size);
+			TEST_VERIFY(hasher.GetHash() == hash);
+		}
+
+		{
+			Framework::CStdStream output("blake3.bin", "wb");
+			output.Write(input.data(), input.size());
+		}
+		TEST_VERIFY(Framework::HashUtils::ComputeBlake3File("blake3.bin", &threadPool) == Framework::HashUtils::ComputeBlake3(input.data(), input.size()));
+	}
+}
@@ -0,0 +1,60 @@
+#include <vector>
+#include "IdctTest.h"
+#include "TestDefs.h"
+#include "idct/IEEE1180.h"
+#include "idct/FixedPoint.h"
+
+void IdctTest_Execute()
+{
+	auto idct = IDCT::CFixedPoint::GetInstance();
+
+	//IEEE-1180 accuracy
+	{
+		static const int ranges[3][2] = {{256, 255}, {5, 5}, {300, 300}};
+		for(const auto& range : ranges)
+		{
+			TEST_VERIFY(IDCT::CIEEE1180::MeasureAccuracy(idct, range[0], range[1], false).IsCompliant());
+			TEST_VERIFY(IDCT::CIEEE1180::MeasureAccuracy(idct, range[0], range[1], true).IsCompliant());
+		}
+	}
+
+	//All zero input must give all zero output
+	{
+		int16 input[64] = {};
+		int16 output[64];
+		idct->Transform(input, output);
+		for(unsigned int i = 0; i < 64; i++)
+		{
+			TEST_VERIFY(output[i] == 0);
+		}
+	}
+
+	//Batched transform (with sparse blocks) must match single block transform
+	{
+		static const unsigned int blockCount = 33;
+		std::vector<int16> input(blockCount * 64);
+		uint32 seed = 1;
+		for(unsigned int i = 0; i < input.size(); i++)
+		{
+			seed = (seed * 1103515245) + 12345;
+			unsigned int block = i / 64;
+			unsigned int u = (i % 64) % 8;
+			unsigned int v = (i % 64) / 8;
+			bool keep = ((block % 3) == 0) ||
+			            (((block % 3) == 1) && (u == 0) && (v == 0)) ||
+			            (((block % 3) == 2) && (u < 4) && (v < 4));
+			input[i] = keep ? static_cast<int16>(((seed >> 16) % 4096) - 2048) : 0;
+		}
+		std::vector<int16> batchOutput(input.size());
+		idct->TransformBlocks(input.data(), batchOutput.data(), blockCount);
+		for(unsigned int block = 0; block < blockCount; block++)
+		{
+			int16 output[64];
+			idct->Transform(input.data() + (block * 64), output);
+			for(unsigned int i = 0; i < 64; i++)
+			{
+				TEST_VERIFY(output[i] == batchOutput[(block * 64) + i]);
+			}
+		}
+	}
+}
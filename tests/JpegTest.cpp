@@ -0,0 +1,469 @@
+#include <algorithm>
+#include <cstring>
+#include <vector>
+#include "JpegTest.h"
+#include "TestDefs.h"
+#include "PtrStream.h"
+#include "MemStream.h"
+#include "ThreadPool.h"
+#include "bitmap/JPEG.h"
+
+//40x24 gradient, 4:2:0
+static const uint8 g_gradientImage[] =
+{
+	0xFF, 0xD8, 0xFF, 0xE0, 0x00, 0x10, 0x4A, 0x46, 0x49, 0x46, 0x00, 0x01, 0x01, 0x00, 0x00, 0x01,
+	0x00, 0x01, 0x00, 0x00, 0xFF, 0xDB, 0x00, 0x43, 0x00, 0x08, 0x06, 0x06, 0x07, 0x06, 0x05, 0x08,
+	0x07, 0x07, 0x07, 0x09, 0x09, 0x08, 0x0A, 0x0C, 0x14, 0x0D, 0x0C, 0x0B, 0x0B, 0x0C, 0x19, 0x12,
+	0x13, 0x0F, 0x14, 0x1D, 0x1A, 0x1F, 0x1E, 0x1D, 0x1A, 0x1C, 0x1C, 0x20, 0x24, 0x2E, 0x27, 0x20,
+	0x22, 0x2C, 0x23, 0x1C, 0x1C, 0x28, 0x37, 0x29, 0x2C, 0x30, 0x31, 0x34, 0x34, 0x34, 0x1F, 0x27,
+	0x39, 0x3D, 0x38, 0x32, 0x3C, 0x2E, 0x33, 0x34, 0x32, 0xFF, 0xDB, 0x00, 0x43, 0x01, 0x09, 0x09,
+	0x09, 0x0C, 0x0B, 0x0C, 0x18, 0x0D, 0x0D, 0x18, 0x32, 0x21, 0x1C, 0x21, 0x32, 0x32, 0x32, 0x32,
+	0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32,
+	0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32,
+	0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0xFF, 0xC0,
+	0x00, 0x11, 0x08, 0x00, 0x18, 0x00, 0x28, 0x03, 0x01, 0x22, 0x00, 0x02, 0x11, 0x01, 0x03, 0x11,
+	0x01, 0xFF, 0xC4, 0x00, 0x1F, 0x00, 0x00, 0x01, 0x05, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09,
+	0x0A, 0x0B, 0xFF, 0xC4, 0x00, 0xB5, 0x10, 0x00, 0x02, 0x01, 0x03, 0x03, 0x02, 0x04, 0x03, 0x05,
+	0x05, 0x04, 0x04, 0x00, 0x00, 0x01, 0x7D, 0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21,
+	0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07, 0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xA1, 0x08, 0x23,
+	0x42, 0xB1, 0xC1, 0x15, 0x52, 0xD1, 0xF0, 0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0A, 0x16, 0x17,
+	0x18, 0x19, 0x1A, 0x25, 0x26, 0x27, 0x28, 0x29, 0x2A, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A,
+	0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4A, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5A,
+	0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6A, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7A,
+	0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89, 0x8A, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99,
+	0x9A, 0xA2, 0xA3, 0xA4, 0xA5, 0xA6, 0xA7, 0xA8, 0xA9, 0xAA, 0xB2, 0xB3, 0xB4, 0xB5, 0xB6, 0xB7,
+	0xB8, 0xB9, 0xBA, 0xC2, 0xC3, 0xC4, 0xC5, 0xC6, 0xC7, 0xC8, 0xC9, 0xCA, 0xD2, 0xD3, 0xD4, 0xD5,
+	0xD6, 0xD7, 0xD8, 0xD9, 0xDA, 0xE1, 0xE2, 0xE3, 0xE4, 0xE5, 0xE6, 0xE7, 0xE8, 0xE9, 0xEA, 0xF1,
+	0xF2, 0xF3, 0xF4, 0xF5, 0xF6, 0xF7, 0xF8, 0xF9, 0xFA, 0xFF, 0xC4, 0x00, 0x1F, 0x01, 0x00, 0x03,
+	0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01,
+	0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0xFF, 0xC4, 0x00, 0xB5, 0x11, 0x00,
+	0x02, 0x01, 0x02, 0x04, 0x04, 0x03, 0x04, 0x07, 0x05, 0x04, 0x04, 0x00, 0x01, 0x02, 0x77, 0x00,
+	0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71, 0x13,
+	0x22, 0x32, 0x81, 0x08, 0x14, 0x42, 0x91, 0xA1, 0xB1, 0xC1, 0x09, 0x23, 0x33, 0x52, 0xF0, 0x15,
+	0x62, 0x72, 0xD1, 0x0A, 0x16, 0x24, 0x34, 0xE1, 0x25, 0xF1, 0x17, 0x18, 0x19, 0x1A, 0x26, 0x27,
+	0x28, 0x29, 0x2A, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
+	0x4A, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5A, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+	0x6A, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7A, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88,
+	0x89, 0x8A, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9A, 0xA2, 0xA3, 0xA4, 0xA5, 0xA6,
+	0xA7, 0xA8, 0xA9, 0xAA, 0xB2, 0xB3, 0xB4, 0xB5, 0xB6, 0xB7, 0xB8, 0xB9, 0xBA, 0xC2, 0xC3, 0xC4,
+	0xC5, 0xC6, 0xC7, 0xC8, 0xC9, 0xCA, 0xD2, 0xD3, 0xD4, 0xD5, 0xD6, 0xD7, 0xD8, 0xD9, 0xDA, 0xE2,
+	0xE3, 0xE4, 0xE5, 0xE6, 0xE7, 0xE8, 0xE9, 0xEA, 0xF2, 0xF3, 0xF4, 0xF5, 0xF6, 0xF7, 0xF8, 0xF9,
+	0xFA, 0xFF, 0xDA, 0x00, 0x0C, 0x03, 0x01, 0x00, 0x02, 0x11, 0x03, 0x11, 0x00, 0x3F, 0x00, 0xF2,
+	0x28, 0x74, 0xCE, 0x99, 0x15, 0xA5, 0x6F, 0xA5, 0xF5, 0x1B, 0x78, 0xC5, 0x74, 0x70, 0xE9, 0x44,
+	0x1C, 0xED, 0xEE, 0x6B, 0x46, 0x1D, 0x2F, 0x19, 0xF9, 0x7A, 0x7A, 0x57, 0x14, 0x71, 0x07, 0x06,
+	0x13, 0x33, 0xF3, 0x39, 0xD8, 0x34, 0xCE, 0x06, 0x17, 0xAD, 0x69, 0x43, 0xA5, 0xFF, 0x00, 0xB3,
+	0x5D, 0x1C, 0x1A, 0x57, 0x20, 0xE3, 0xAF, 0xF8, 0xD6, 0x8D, 0xBE, 0x97, 0x90, 0x3E, 0x5E, 0xF5,
+	0xB4, 0x71, 0x07, 0xD5, 0x60, 0xF3, 0x3F, 0x33, 0x9E, 0x83, 0x4A, 0x24, 0x8C, 0x8F, 0xAD, 0x15,
+	0xD9, 0xDB, 0xE9, 0x60, 0x11, 0xC5, 0x15, 0xAF, 0xD6, 0x0F, 0xA4, 0xA5, 0x9A, 0x7B, 0xA6, 0x5D,
+	0xAE, 0x9E, 0x93, 0x34, 0x52, 0x44, 0x55, 0xE3, 0x75, 0x0C, 0x8C, 0xA7, 0x21, 0x81, 0xEE, 0x0F,
+	0xA5, 0x5A, 0x86, 0x0B, 0x55, 0x8D, 0x41, 0xB8, 0x83, 0x2C, 0xE5, 0x46, 0x5C, 0x72, 0x43, 0x04,
+	0x20, 0x7B, 0x86, 0x21, 0x7E, 0xA4, 0x0E, 0xB4, 0x51, 0x5E, 0x15, 0x25, 0x79, 0x5B, 0xFA, 0xEA,
+	0x7F, 0x3F, 0xE0, 0xE7, 0x27, 0x37, 0x1B, 0xF5, 0x7F, 0xD7, 0xE0, 0x6D, 0xC3, 0xA5, 0xFE, 0xF1,
+	0xB2, 0x3F, 0x84, 0x8A, 0xB9, 0x6F, 0x69, 0x01, 0xB6, 0x82, 0x71, 0x24, 0x7E, 0x4C, 0x85, 0x76,
+	0x49, 0xB8, 0x61, 0xB7, 0x10, 0x17, 0x07, 0xBE, 0x49, 0x00, 0x7A, 0xE6, 0x8A, 0x2A, 0xE9, 0xB6,
+	0xED, 0xF2, 0x3E, 0x9B, 0x03, 0x56, 0x72, 0x7A, 0xBE, 0xBF, 0xA9, 0xA7, 0x0D, 0xA4, 0x26, 0xE9,
+	0xED, 0x7C, 0xD8, 0xC5, 0xC6, 0xDF, 0x33, 0xCA, 0xDC, 0x37, 0xED, 0xCE, 0x37, 0x63, 0xAE, 0x33,
+	0xC6, 0x68, 0xA2, 0x8A, 0xDA, 0x52, 0x71, 0xB5, 0x8F, 0xA2, 0xF6, 0xB3, 0x8C, 0x63, 0xAE, 0xE8,
+	0xFF, 0xD9,
+};
+
+//Same image with a restart interval of 2 MCUs
+static const uint8 g_gradientRestartImage[] =
+{
+	0xFF, 0xD8, 0xFF, 0xE0, 0x00, 0x10, 0x4A, 0x46, 0x49, 0x46, 0x00, 0x01, 0x01, 0x00, 0x00, 0x01,
+	0x00, 0x01, 0x00, 0x00, 0xFF, 0xDB, 0x00, 0x43, 0x00, 0x08, 0x06, 0x06, 0x07, 0x06, 0x05, 0x08,
+	0x07, 0x07, 0x07, 0x09, 0x09, 0x08, 0x0A, 0x0C, 0x14, 0x0D, 0x0C, 0x0B, 0x0B, 0x0C, 0x19, 0x12,
+	0x13, 0x0F, 0x14, 0x1D, 0x1A, 0x1F, 0x1E, 0x1D, 0x1A, 0x1C, 0x1C, 0x20, 0x24, 0x2E, 0x27, 0x20,
+	0x22, 0x2C, 0x23, 0x1C, 0x1C, 0x28, 0x37, 0x29, 0x2C, 0x30, 0x31, 0x34, 0x34, 0x34, 0x1F, 0x27,
+	0x39, 0x3D, 0x38, 0x32, 0x3C, 0x2E, 0x33, 0x34, 0x32, 0xFF, 0xDB, 0x00, 0x43, 0x01, 0x09, 0x09,
+	0x09, 0x0C, 0x0B, 0x0C, 0x18, 0x0D, 0x0D, 0x18, 0x32, 0x21, 0x1C, 0x21, 0x32, 0x32, 0x32, 0x32,
+	0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32,
+	0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32,
+	0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0xFF, 0xC0,
+	0x00, 0x11, 0x08, 0x00, 0x18, 0x00, 0x28, 0x03, 0x01, 0x22, 0x00, 0x02, 0x11, 0x01, 0x03, 0x11,
+	0x01, 0xFF, 0xC4, 0x00, 0x1F, 0x00, 0x00, 0x01, 0x05, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09,
+	0x0A, 0x0B, 0xFF, 0xC4, 0x00, 0xB5, 0x10, 0x00, 0x02, 0x01, 0x03, 0x03, 0x02, 0x04, 0x03, 0x05,
+	0x05, 0x04, 0x04, 0x00, 0x00, 0x01, 0x7D, 0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21,
+	0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07, 0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xA1, 0x08, 0x23,
+	0x42, 0xB1, 0xC1, 0x15, 0x52, 0xD1, 0xF0, 0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0A, 0x16, 0x17,
+	0x18, 0x19, 0x1A, 0x25, 0x26, 0x27, 0x28, 0x29, 0x2A, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A,
+	0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4A, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5A,
+	0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6A, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7A,
+	0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89, 0x8A, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99,
+	0x9A, 0xA2, 0xA3, 0xA4, 0xA5, 0xA6, 0xA7, 0xA8, 0xA9, 0xAA, 0xB2, 0xB3, 0xB4, 0xB5, 0xB6, 0xB7,
+	0xB8, 0xB9, 0xBA, 0xC2, 0xC3, 0xC4, 0xC5, 0xC6, 0xC7, 0xC8, 0xC9, 0xCA, 0xD2, 0xD3, 0xD4, 0xD5,
+	0xD6, 0xD7, 0xD8, 0xD9, 0xDA, 0xE1, 0xE2, 0xE3, 0xE4, 0xE5, 0xE6, 0xE7, 0xE8, 0xE9, 0xEA, 0xF1,
+	0xF2, 0xF3, 0xF4, 0xF5, 0xF6, 0xF7, 0xF8, 0xF9, 0xFA, 0xFF, 0xC4, 0x00, 0x1F, 0x01, 0x00, 0x03,
+	0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01,
+	0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0xFF, 0xC4, 0x00, 0xB5, 0x11, 0x00,
+	0x02, 0x01, 0x02, 0x04, 0x04, 0x03, 0x04, 0x07, 0x05, 0x04, 0x04, 0x00, 0x01, 0x02, 0x77, 0x00,
+	0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71, 0x13,
+	0x22, 0x32, 0x81, 0x08, 0x14, 0x42, 0x91, 0xA1, 0xB1, 0xC1, 0x09, 0x23, 0x33, 0x52, 0xF0, 0x15,
+	0x62, 0x72, 0xD1, 0x0A, 0x16, 0x24, 0x34, 0xE1, 0x25, 0xF1, 0x17, 0x18, 0x19, 0x1A, 0x26, 0x27,
+	0x28, 0x29, 0x2A, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
+	0x4A, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5A, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+	0x6A, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7A, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88,
+	0x89, 0x8A, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9A, 0xA2, 0xA3, 0xA4, 0xA5, 0xA6,
+	0xA7, 0xA8, 0xA9, 0xAA, 0xB2, 0xB3, 0xB4, 0xB5, 0xB6, 0xB7, 0xB8, 0xB9, 0xBA, 0xC2, 0xC3, 0xC4,
+	0xC5, 0xC6, 0xC7, 0xC8, 0xC9, 0xCA, 0xD2, 0xD3, 0xD4, 0xD5, 0xD6, 0xD7, 0xD8, 0xD9, 0xDA, 0xE2,
+	0xE3, 0xE4, 0xE5, 0xE6, 0xE7, 0xE8, 0xE9, 0xEA, 0xF2, 0xF3, 0xF4, 0xF5, 0xF6, 0xF7, 0xF8, 0xF9,
+	0xFA, 0xFF, 0xDD, 0x00, 0x04, 0x00, 0x02, 0xFF, 0xDA, 0x00, 0x0C, 0x03, 0x01, 0x00, 0x02, 0x11,
+	0x03, 0x11, 0x00, 0x3F, 0x00, 0xF2, 0x28, 0x74, 0xCE, 0x99, 0x15, 0xA5, 0x6F, 0xA5, 0xF5, 0x1B,
+	0x78, 0xC5, 0x74, 0x70, 0xE9, 0x44, 0x1C, 0xED, 0xEE, 0x6B, 0x46, 0x1D, 0x2F, 0x19, 0xF9, 0x7A,
+	0x7A, 0x57, 0x14, 0x71, 0x07, 0x06, 0x13, 0x33, 0xF3, 0x39, 0xD8, 0x34, 0xCE, 0x06, 0x17, 0xAD,
+	0x69, 0x43, 0xA5, 0xFF, 0x00, 0xB3, 0x5D, 0x1C, 0x1A, 0x57, 0x20, 0xE3, 0xAF, 0xF8, 0xD6, 0x8D,
+	0xBE, 0x97, 0x90, 0x3E, 0x5E, 0xF5, 0xB4, 0x71, 0x07, 0xD5, 0x60, 0xF3, 0x3F, 0x33, 0xFF, 0xD0,
+	0xCB, 0x83, 0x4A, 0x24, 0x8C, 0x8F, 0xAD, 0x15, 0xD9, 0xDB, 0xE9, 0x60, 0x11, 0xC5, 0x15, 0x3F,
+	0x58, 0x3E, 0xFE, 0x96, 0x69, 0xEE, 0x99, 0x76, 0xBA, 0x7A, 0x4C, 0xD1, 0x49, 0x11, 0x57, 0x8D,
+	0xD4, 0x32, 0x32, 0x9C, 0x86, 0x07, 0xB8, 0x3E, 0x95, 0x6A, 0x18, 0x2D, 0x56, 0x35, 0x06, 0xE2,
+	0x0C, 0xB3, 0x95, 0x19, 0x71, 0xC9, 0x0C, 0x10, 0x81, 0xEE, 0x18, 0x85, 0xFA, 0x90, 0x3A, 0xD1,
+	0x45, 0x78, 0x54, 0x95, 0xE5, 0x6F, 0xEB, 0xA9, 0xFC, 0xFF, 0x00, 0x83, 0x9C, 0x9C, 0xDC, 0x6F,
+	0xD5, 0xFF, 0x00, 0x5F, 0x81, 0xFF, 0xD1, 0xEC, 0x21, 0xD2, 0xFF, 0x00, 0x78, 0xD9, 0x1F, 0xC2,
+	0x45, 0x5C, 0xB7, 0xB4, 0x80, 0xDB, 0x41, 0x38, 0x92, 0x3F, 0x26, 0x42, 0xBB, 0x24, 0xDC, 0x30,
+	0xDB, 0x88, 0x0B, 0x83, 0xDF, 0x24, 0x80, 0x3D, 0x73, 0x45, 0x15, 0xE1, 0xD3, 0x6D, 0xDB, 0xE4,
+	0x78, 0x98, 0x1A, 0xB3, 0x93, 0xD5, 0xF5, 0xFD, 0x4D, 0x38, 0x6D, 0x21, 0x37, 0x4F, 0x6B, 0xE6,
+	0xC6, 0x2E, 0x36, 0xF9, 0x9E, 0x56, 0xE1, 0xBF, 0x6E, 0x71, 0xBB, 0x1D, 0x71, 0x9E, 0x33, 0x45,
+	0x14, 0x56, 0xD2, 0x93, 0x8D, 0xAC, 0x7D, 0x17, 0xB5, 0x9C, 0x63, 0x1D, 0x77, 0x47, 0xFF, 0xD9,
+};
+
+//32x32 image with red, green, blue and white quadrants, 4:4:4
+static const uint8 g_quadrantImage[] =
+{
+	0xFF, 0xD8, 0xFF, 0xE0, 0x00, 0x10, 0x4A, 0x46, 0x49, 0x46, 0x00, 0x01, 0x01, 0x00, 0x00, 0x01,
+	0x00, 0x01, 0x00, 0x00, 0xFF, 0xDB, 0x00, 0x43, 0x00, 0x03, 0x02, 0x02, 0x03, 0x02, 0x02, 0x03,
+	0x03, 0x03, 0x03, 0x04, 0x03, 0x03, 0x04, 0x05, 0x08, 0x05, 0x05, 0x04, 0x04, 0x05, 0x0A, 0x07,
+	0x07, 0x06, 0x08, 0x0C, 0x0A, 0x0C, 0x0C, 0x0B, 0x0A, 0x0B, 0x0B, 0x0D, 0x0E, 0x12, 0x10, 0x0D,
+	0x0E, 0x11, 0x0E, 0x0B, 0x0B, 0x10, 0x16, 0x10, 0x11, 0x13, 0x14, 0x15, 0x15, 0x15, 0x0C, 0x0F,
+	0x17, 0x18, 0x16, 0x14, 0x18, 0x12, 0x14, 0x15, 0x14, 0xFF, 0xDB, 0x00, 0x43, 0x01, 0x03, 0x04,
+	0x04, 0x05, 0x04, 0x05, 0x09, 0x05, 0x05, 0x09, 0x14, 0x0D, 0x0B, 0x0D, 0x14, 0x14, 0x14, 0x14,
+	0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14,
+	0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14,
+	0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0xFF, 0xC0,
+	0x00, 0x11, 0x08, 0x00, 0x20, 0x00, 0x20, 0x03, 0x01, 0x11, 0x00, 0x02, 0x11, 0x01, 0x03, 0x11,
+	0x01, 0xFF, 0xC4, 0x00, 0x17, 0x00, 0x01, 0x01, 0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x08, 0x0A, 0x09, 0xFF, 0xC4, 0x00, 0x14, 0x10, 0x01,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0xFF, 0xC4, 0x00, 0x19, 0x01, 0x01, 0x00, 0x03, 0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x07, 0x09, 0x0A, 0x06, 0x08, 0xFF, 0xC4, 0x00, 0x14, 0x11,
+	0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0xFF, 0xDA, 0x00, 0x0C, 0x03, 0x01, 0x00, 0x02, 0x11, 0x03, 0x11, 0x00, 0x3F, 0x00, 0x9D,
+	0x10, 0x62, 0xD4, 0xC0, 0x58, 0xC8, 0x49, 0x98, 0xF0, 0x11, 0xCA, 0x6D, 0x69, 0xC0, 0x05, 0x8C,
+	0x84, 0x99, 0x8F, 0x01, 0xCB, 0xC6, 0x8C, 0xDE, 0xE5, 0x01, 0xA5, 0xB5, 0x56, 0x3B, 0x80, 0x19,
+	0xA4, 0x5A, 0x9B, 0x87, 0x01, 0xA5, 0xB5, 0x56, 0x3B, 0x80, 0x1F, 0xFF, 0xD9,
+};
+
+//Same image, 4:2:0 with a restart interval of 1 MCU
+static const uint8 g_quadrantRestartImage[] =
+{
+	0xFF, 0xD8, 0xFF, 0xE0, 0x00, 0x10, 0x4A, 0x46, 0x49, 0x46, 0x00, 0x01, 0x01, 0x00, 0x00, 0x01,
+	0x00, 0x01, 0x00, 0x00, 0xFF, 0xDB, 0x00, 0x43, 0x00, 0x03, 0x02, 0x02, 0x03, 0x02, 0x02, 0x03,
+	0x03, 0x03, 0x03, 0x04, 0x03, 0x03, 0x04, 0x05, 0x08, 0x05, 0x05, 0x04, 0x04, 0x05, 0x0A, 0x07,
+	0x07, 0x06, 0x08, 0x0C, 0x0A, 0x0C, 0x0C, 0x0B, 0x0A, 0x0B, 0x0B, 0x0D, 0x0E, 0x12, 0x10, 0x0D,
+	0x0E, 0x11, 0x0E, 0x0B, 0x0B, 0x10, 0x16, 0x10, 0x11, 0x13, 0x14, 0x15, 0x15, 0x15, 0x0C, 0x0F,
+	0x17, 0x18, 0x16, 0x14, 0x18, 0x12, 0x14, 0x15, 0x14, 0xFF, 0xDB, 0x00, 0x43, 0x01, 0x03, 0x04,
+	0x04, 0x05, 0x04, 0x05, 0x09, 0x05, 0x05, 0x09, 0x14, 0x0D, 0x0B, 0x0D, 0x14, 0x14, 0x14, 0x14,
+	0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14,
+	0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14,
+	0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0xFF, 0xC0,
+	0x00, 0x11, 0x08, 0x00, 0x20, 0x00, 0x20, 0x03, 0x01, 0x22, 0x00, 0x02, 0x11, 0x01, 0x03, 0x11,
+	0x01, 0xFF, 0xC4, 0x00, 0x17, 0x00, 0x01, 0x01, 0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x09, 0x06, 0x08, 0xFF, 0xC4, 0x00, 0x14, 0x10, 0x01,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0xFF, 0xC4, 0x00, 0x18, 0x01, 0x00, 0x02, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x09, 0x06, 0x07, 0x08, 0xFF, 0xC4, 0x00, 0x14, 0x11, 0x01,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0xFF, 0xDD, 0x00, 0x04, 0x00, 0x01, 0xFF, 0xDA, 0x00, 0x0C, 0x03, 0x01, 0x00, 0x02, 0x11, 0x03,
+	0x11, 0x00, 0x3F, 0x00, 0xE7, 0x40, 0x14, 0x61, 0xA9, 0xBF, 0xFF, 0xD0, 0xDD, 0x80, 0xC3, 0xE5,
+	0xC4, 0xFF, 0xD1, 0x9E, 0xE0, 0x1A, 0x9A, 0x0E, 0xFF, 0xD2, 0xAA, 0x60, 0x00, 0xFF, 0xD9,
+};
+
+//Same image, 4:2:2
+static const uint8 g_quadrant422Image[] =
+{
+	0xFF, 0xD8, 0xFF, 0xE0, 0x00, 0x10, 0x4A, 0x46, 0x49, 0x46, 0x00, 0x01, 0x01, 0x00, 0x00, 0x01,
+	0x00, 0x01, 0x00, 0x00, 0xFF, 0xDB, 0x00, 0x43, 0x00, 0x08, 0x06, 0x06, 0x07, 0x06, 0x05, 0x08,
+	0x07, 0x07, 0x07, 0x09, 0x09, 0x08, 0x0A, 0x0C, 0x14, 0x0D, 0x0C, 0x0B, 0x0B, 0x0C, 0x19, 0x12,
+	0x13, 0x0F, 0x14, 0x1D, 0x1A, 0x1F, 0x1E, 0x1D, 0x1A, 0x1C, 0x1C, 0x20, 0x24, 0x2E, 0x27, 0x20,
+	0x22, 0x2C, 0x23, 0x1C, 0x1C, 0x28, 0x37, 0x29, 0x2C, 0x30, 0x31, 0x34, 0x34, 0x34, 0x1F, 0x27,
+	0x39, 0x3D, 0x38, 0x32, 0x3C, 0x2E, 0x33, 0x34, 0x32, 0xFF, 0xDB, 0x00, 0x43, 0x01, 0x09, 0x09,
+	0x09, 0x0C, 0x0B, 0x0C, 0x18, 0x0D, 0x0D, 0x18, 0x32, 0x21, 0x1C, 0x21, 0x32, 0x32, 0x32, 0x32,
+	0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32,
+	0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32,
+	0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0x32, 0xFF, 0xC0,
+	0x00, 0x11, 0x08, 0x00, 0x20, 0x00, 0x20, 0x03, 0x01, 0x21, 0x00, 0x02, 0x11, 0x01, 0x03, 0x11,
+	0x01, 0xFF, 0xC4, 0x00, 0x1F, 0x00, 0x00, 0x01, 0x05, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09,
+	0x0A, 0x0B, 0xFF, 0xC4, 0x00, 0xB5, 0x10, 0x00, 0x02, 0x01, 0x03, 0x03, 0x02, 0x04, 0x03, 0x05,
+	0x05, 0x04, 0x04, 0x00, 0x00, 0x01, 0x7D, 0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21,
+	0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07, 0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xA1, 0x08, 0x23,
+	0x42, 0xB1, 0xC1, 0x15, 0x52, 0xD1, 0xF0, 0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0A, 0x16, 0x17,
+	0x18, 0x19, 0x1A, 0x25, 0x26, 0x27, 0x28, 0x29, 0x2A, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A,
+	0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4A, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5A,
+	0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6A, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7A,
+	0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89, 0x8A, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99,
+	0x9A, 0xA2, 0xA3, 0xA4, 0xA5, 0xA6, 0xA7, 0xA8, 0xA9, 0xAA, 0xB2, 0xB3, 0xB4, 0xB5, 0xB6, 0xB7,
+	0xB8, 0xB9, 0xBA, 0xC2, 0xC3, 0xC4, 0xC5, 0xC6, 0xC7, 0xC8, 0xC9, 0xCA, 0xD2, 0xD3, 0xD4, 0xD5,
+	0xD6, 0xD7, 0xD8, 0xD9, 0xDA, 0xE1, 0xE2, 0xE3, 0xE4, 0xE5, 0xE6, 0xE7, 0xE8, 0xE9, 0xEA, 0xF1,
+	0xF2, 0xF3, 0xF4, 0xF5, 0xF6, 0xF7, 0xF8, 0xF9, 0xFA, 0xFF, 0xC4, 0x00, 0x1F, 0x01, 0x00, 0x03,
+	0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01,
+	0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0xFF, 0xC4, 0x00, 0xB5, 0x11, 0x00,
+	0x02, 0x01, 0x02, 0x04, 0x04, 0x03, 0x04, 0x07, 0x05, 0x04, 0x04, 0x00, 0x01, 0x02, 0x77, 0x00,
+	0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71, 0x13,
+	0x22, 0x32, 0x81, 0x08, 0x14, 0x42, 0x91, 0xA1, 0xB1, 0xC1, 0x09, 0x23, 0x33, 0x52, 0xF0, 0x15,
+	0x62, 0x72, 0xD1, 0x0A, 0x16, 0x24, 0x34, 0xE1, 0x25, 0xF1, 0x17, 0x18, 0x19, 0x1A, 0x26, 0x27,
+	0x28, 0x29, 0x2A, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
+	0x4A, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5A, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+	0x6A, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7A, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88,
+	0x89, 0x8A, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9A, 0xA2, 0xA3, 0xA4, 0xA5, 0xA6,
+	0xA7, 0xA8, 0xA9, 0xAA, 0xB2, 0xB3, 0xB4, 0xB5, 0xB6, 0xB7, 0xB8, 0xB9, 0xBA, 0xC2, 0xC3, 0xC4,
+	0xC5, 0xC6, 0xC7, 0xC8, 0xC9, 0xCA, 0xD2, 0xD3, 0xD4, 0xD5, 0xD6, 0xD7, 0xD8, 0xD9, 0xDA, 0xE2,
+	0xE3, 0xE4, 0xE5, 0xE6, 0xE7, 0xE8, 0xE9, 0xEA, 0xF2, 0xF3, 0xF4, 0xF5, 0xF6, 0xF7, 0xF8, 0xF9,
+	0xFA, 0xFF, 0xDA, 0x00, 0x0C, 0x03, 0x01, 0x00, 0x02, 0x11, 0x03, 0x11, 0x00, 0x3F, 0x00, 0xE2,
+	0xE8, 0xAF, 0x99, 0x3F, 0x71, 0x3D, 0x2A, 0x8A, 0xF9, 0xA3, 0xF8, 0xBC, 0xF3, 0x5A, 0x2B, 0xE9,
+	0x4F, 0xED, 0x03, 0xD2, 0xA8, 0xAF, 0x9A, 0x3F, 0x8B, 0xCF, 0x06, 0xA2, 0xBF, 0xAF, 0x0F, 0xD3,
+	0x0F, 0xB8, 0xA8, 0xAF, 0xC3, 0x8F, 0x4C, 0xF8, 0x76, 0x8A, 0xFD, 0xC4, 0xF3, 0x0F, 0xB8, 0xA8,
+	0xAF, 0xC3, 0x8F, 0x4C, 0xFF, 0xD9,
+};
+
+static Framework::CBitmap DecodeImage(const uint8* data, size_t size, Framework::CThreadPool* threadPool = nullptr)
+{
+	Framework::CPtrStream stream(data, size);
+	return threadPool ? Framework::CJPEG::ReadBitmap(stream, *threadPool) : Framework::CJPEG::ReadBitmap(stream);
+}
+
+static Framework::CBitmap DecodeScaledImage(const uint8* data, size_t size, unsigned int scaleDenominator)
+{
+	Framework::CPtrStream stream(data, size);
+	return Framework::CJPEG::ReadBitmap(stream, scaleDenominator);
+}
+
+//Rows are padded like they would be in a locked texture
+class CPaddedBitmapSink : public Framework::CBitmapSink
+{
+public:
+	Framework::CBitmapView BeginImage(unsigned int width, unsigned int height, unsigned int bpp) override
+	{
+		m_pitch = (((width * bpp) + 7) / 8) + 13;
+		m_pixels.assign(m_pitch * height, 0xCD);
+		m_view = Framework::CBitmapView(m_pixels.data(), width, height, bpp, m_pitch);
+		return m_view;
+	}
+
+	void EndImage() override
+	{
+		m_ended = true;
+	}
+
+	bool Matches(const Framework::CBitmap& bitmap) const
+	{
+		if(!m_ended) return false;
+		if(m_view.GetWidth() != bitmap.GetWidth()) return false;
+		if(m_view.GetHeight() != bitmap.GetHeight()) return false;
+		for(unsigned int y = 0; y < bitmap.GetHeight(); y++)
+		{
+			if(memcmp(m_view.GetRow(y), bitmap.GetPixels() + (y * bitmap.GetPitch()), bitmap.GetPitch())) return false;
+		}
+		return true;
+	}
+
+private:
+	std::vector<uint8> m_pixels;
+	Framework::CBitmapView m_view;
+	unsigned int m_pitch = 0;
+	bool m_ended = false;
+};
+
+static bool AreBitmapsEqual(const Framework::CBitmap& bitmap1, const Framework::CBitmap& bitmap2)
+{
+	if(bitmap1.GetWidth() != bitmap2.GetWidth()) return false;
+	if(bitmap1.GetHeight() != bitmap2.GetHeight()) return false;
+	if(bitmap1.GetPixelsSize() != bitmap2.GetPixelsSize()) return false;
+	return memcmp(bitmap1.GetPixels(), bitmap2.GetPixels(), bitmap1.GetPixelsSize()) == 0;
+}
+
+static void CheckQuadrants(const Framework::CBitmap& bitmap, unsigned int scaleDenominator = 1)
+{
+	static const uint8 colors[4][3] = {{0xFF, 0, 0}, {0, 0xFF, 0}, {0, 0, 0xFF}, {0xFF, 0xFF, 0xFF}};
+	unsigned int size = 32 / scaleDenominator;
+	TEST_VERIFY(bitmap.GetWidth() == size);
+	TEST_VERIFY(bitmap.GetHeight() == size);
+	for(unsigned int i = 0; i < 4; i++)
+	{
+		auto color = bitmap.GetPixel(((i % 2) * size / 2) + (size / 4), ((i / 2) * size / 2) + (size / 4));
+		TEST_VERIFY(abs(color.r - colors[i][0]) <= 4);
+		TEST_VERIFY(abs(color.g - colors[i][1]) <= 4);
+		TEST_VERIFY(abs(color.b - colors[i][2]) <= 4);
+	}
+}
+
+static Framework::CBitmap EncodeQuadrants(unsigned int bpp, unsigned int quality)
+{
+	static const Framework::CColor colors[4] = {{0xFF, 0, 0, 0xFF}, {0, 0xFF, 0, 0xFF}, {0, 0, 0xFF, 0xFF}, {0xFF, 0xFF, 0xFF, 0xFF}};
+	Framework::CBitmap bitmap(32, 32, bpp);
+	for(unsigned int y = 0; y < 32; y++)
+	{
+		for(unsigned int x = 0; x < 32; x++)
+		{
+			bitmap.SetPixel(x, y, colors[(x / 16) + ((y / 16) * 2)]);
+		}
+	}
+	Framework::CMemStream stream;
+	Framework::CJPEG::WriteBitmap(bitmap, stream, quality);
+	return DecodeImage(stream.GetBuffer(), stream.GetSize());
+}
+
+//Puts an EXIF segment (IFD0 without entries, IFD1 pointing to the thumbnail) after the SOI marker
+static std::vector<uint8> AddExifThumbnail(const uint8* data, size_t size, const std::vector<uint8>& thumbnail, bool isBigEndian)
+{
+	std::vector<uint8> tiff;
+	auto write16 = [&](uint32 value) {
+		tiff.push_back(static_cast<uint8>(isBigEndian ? (value >> 8) : value));
+		tiff.push_back(static_cast<uint8>(isBigEndian ? value : (value >> 8)));
+	};
+	auto write32 = [&](uint32 value) {
+		write16(isBigEndian ? (value >> 16) : (value & 0xFFFF));
+		write16(isBigEndian ? (value & 0xFFFF) : (value >> 16));
+	};
+	auto writeEntry = [&](uint32 tag, uint32 value) {
+		write16(tag);
+		write16(4);
+		write32(1);
+		write32(value);
+	};
+	tiff.push_back(isBigEndian ? 'M' : 'I');
+	tiff.push_back(isBigEndian ? 'M' : 'I');
+	write16(42);
+	write32(8);
+	//IFD0
+	write16(0);
+	write32(14);
+	//IFD1
+	write16(3);
+	writeEntry(0x0103, 6);
+	writeEntry(0x0201, 14 + 2 + (3 * 12) + 4);
+	writeEntry(0x0202, static_cast<uint32>(thumbnail.size()));
+	write32(0);
+	tiff.insert(std::end(tiff), std::begin(thumbnail), std::end(thumbnail));
+
+	static const uint8 exifId[6] = {'E', 'x', 'i', 'f', 0, 0};
+	size_t segmentSize = 2 + sizeof(exifId) + tiff.size();
+	std::vector<uint8> result = {0xFF, 0xD8, 0xFF, 0xE1, static_cast<uint8>(segmentSize >> 8), static_cast<uint8>(segmentSize)};
+	result.insert(std::end(result), std::begin(exifId), std::end(exifId));
+	result.insert(std::end(result), std::begin(tiff), std::end(tiff));
+	result.insert(std::end(result), data + 2, data + size);
+	return result;
+}
+
+void JpegTest_Execute()
+{
+	Framework::CThreadPool threadPool(2);
+
+	{
+		auto bitmap = DecodeImage(g_gradientImage, sizeof(g_gradientImage));
+		TEST_VERIFY(bitmap.GetWidth() == 40);
+		TEST_VERIFY(bitmap.GetHeight() == 24);
+		TEST_VERIFY(AreBitmapsEqual(bitmap, DecodeImage(g_gradientImage, sizeof(g_gradientImage), &threadPool)));
+		TEST_VERIFY(AreBitmapsEqual(bitmap, DecodeImage(g_gradientRestartImage, sizeof(g_gradientRestartImage))));
+		TEST_VERIFY(AreBitmapsEqual(bitmap, DecodeImage(g_gradientRestartImage, sizeof(g_gradientRestartImage), &threadPool)));
+	}
+
+	{
+		auto bitmap = DecodeImage(g_gradientImage, sizeof(g_gradientImage));
+		{
+			CPaddedBitmapSink sink;
+			Framework::CPtrStream stream(g_gradientImage, sizeof(g_gradientImage));
+			Framework::CJPEG::ReadBitmap(stream, sink);
+			TEST_VERIFY(sink.Matches(bitmap));
+		}
+		{
+			CPaddedBitmapSink sink;
+			Framework::CPtrStream stream(g_gradientRestartImage, sizeof(g_gradientRestartImage));
+			Framework::CJPEG::ReadBitmap(stream, sink, threadPool);
+			TEST_VERIFY(sink.Matches(bitmap));
+		}
+	}
+
+	CheckQuadrants(DecodeImage(g_quadrantImage, sizeof(g_quadrantImage)));
+	CheckQuadrants(DecodeImage(g_quadrantRestartImage, sizeof(g_quadrantRestartImage), &threadPool));
+	CheckQuadrants(DecodeImage(g_quadrant422Image, sizeof(g_quadrant422Image)));
+
+	for(unsigned int scaleDenominator = 2; scaleDenominator <= 8; scaleDenominator *= 2)
+	{
+		CheckQuadrants(DecodeScaledImage(g_quadrantImage, sizeof(g_quadrantImage), scaleDenominator), scaleDenominator);
+		CheckQuadrants(DecodeScaledImage(g_quadrantRestartImage, sizeof(g_quadrantRestartImage), scaleDenominator), scaleDenominator);
+		CheckQuadrants(DecodeScaledImage(g_quadrant422Image, sizeof(g_quadrant422Image), scaleDenominator), scaleDenominator);
+
+		auto bitmap = DecodeScaledImage(g_gradientImage, sizeof(g_gradientImage), scaleDenominator);
+		TEST_VERIFY(bitmap.GetWidth() == (40 + scaleDenominator - 1) / scaleDenominator);
+		TEST_VERIFY(bitmap.GetHeight() == (24 + scaleDenominator - 1) / scaleDenominator);
+	}
+
+	CheckQuadrants(EncodeQuadrants(24, Framework::CJPEG::DEFAULT_WRITE_QUALITY));
+	CheckQuadrants(EncodeQuadrants(32, 75));
+
+	{
+		//Re-encoding a decoded image with odd dimensions shouldn't drift much
+		auto bitmap = DecodeImage(g_gradientImage, sizeof(g_gradientImage)).ResizeCanvas(37, 23);
+		Framework::CMemStream stream;
+		Framework::CJPEG::WriteBitmap(bitmap, stream, 95);
+		auto result = DecodeImage(stream.GetBuffer(), stream.GetSize());
+		TEST_VERIFY(result.GetWidth() == 37);
+		TEST_VERIFY(result.GetHeight() == 23);
+		int maxError = 0;
+		for(unsigned int y = 0; y < 23; y++)
+		{
+			for(unsigned int x = 0; x < 37; x++)
+			{
+				auto expected = bitmap.GetPixel(x, y);
+				auto actual = result.GetPixel(x, y);
+				maxError = std::max(maxError, abs(expected.r - actual.r));
+				maxError = std::max(maxError, abs(expected.g - actual.g));
+				maxError = std::max(maxError, abs(expected.b - actual.b));
+			}
+		}
+		TEST_VERIFY(maxError <= 24);
+	}
+
+	{
+		Framework::CBitmap bitmap(32, 32, 24);
+		for(unsigned int y = 0; y < 32; y++)
+		{
+			for(unsigned int x = 0; x < 32; x++)
+			{
+				static const Framework::CColor colors[4] = {{0xFF, 0, 0, 0xFF}, {0, 0xFF, 0, 0xFF}, {0, 0, 0xFF, 0xFF}, {0xFF, 0xFF, 0xFF, 0xFF}};
+				bitmap.SetPixel(x, y, colors[(x / 16) + ((y / 16) * 2)]);
+			}
+		}
+		Framework::CMemStream thumbnailStream;
+		Framework::CJPEG::WriteBitmap(bitmap, thumbnailStream);
+		std::vector<uint8> thumbnail(thumbnailStream.GetBuffer(), thumbnailStream.GetBuffer() + thumbnailStream.GetSize());
+
+		auto image = DecodeImage(g_gradientImage, sizeof(g_gradientImage));
+		for(bool isBigEndian : {false, true})
+		{
+			auto data = AddExifThumbnail(g_gradientImage, sizeof(g_gradientImage), thumbnail, isBigEndian);
+			{
+				Framework::CPtrStream stream(data.data(), data.size());
+				CheckQuadrants(Framework::CJPEG::ExtractThumbnail(stream));
+			}
+			//Main image is still decoded with the EXIF segment in front
+			TEST_VERIFY(AreBitmapsEqual(image, DecodeImage(data.data(), data.size())));
+		}
+
+		{
+			Framework::CPtrStream stream(g_gradientImage, sizeof(g_gradientImage));
+			TEST_VERIFY(Framework::CJPEG::ExtractThumbnail(stream).IsEmpty());
+		}
+
+		{
+			//Thumbnail going past the end of the segment
+			auto data = AddExifThumbnail(g_gradientImage, sizeof(g_gradientImage), thumbnail, false);
+			data[6 + 6 + 14 + 2 + 24 + 8] = 0xFF;
+			data[6 + 6 + 14 + 2 + 24 + 9] = 0xFF;
+			Framework::CPtrStream stream(data.data(), data.size());
+			TEST_VERIFY(Framework::CJPEG::ExtractThumbnail(stream).IsEmpty());
+		}
+	}
+}
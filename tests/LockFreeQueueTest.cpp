@@ -0,0 +1,164 @@
+#include "LockFreeQueueTest.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "LockFreeQueue.h"
+#include "TestDefs.h"
+#include "Types.h"
+
+static void SpscTest()
+{
+	CLockFreeQueue<unsigned int> queue(3);
+	TEST_VERIFY(queue.GetCapacity() == 4);
+	for(unsigned int i = 0; i < 4; i++)
+	{
+		TEST_VERIFY(queue.TryPush(i));
+	}
+	TEST_VERIFY(!queue.TryPush(4));
+
+	static const unsigned int itemCount = 100000;
+	std::thread producer(
+	    [&]() {
+		    for(unsigned int i = 4; i < itemCount; i++)
+		    {
+			    while(!queue.TryPush(i))
+			    {
+				    std::this_thread::yield();
+			    }
+		    }
+	    });
+	bool ordered = true;
+	for(unsigned int i = 0; i < itemCount; i++)
+	{
+		unsigned int item = 0;
+		while(!queue.TryPop(item))
+		{
+			std::this_thread::yield();
+		}
+		ordered &= (item == i);
+	}
+	producer.join();
+	TEST_VERIFY(ordered);
+	unsigned int item = 0;
+	TEST_VERIFY(!queue.TryPop(item));
+}
+
+static void MpmcBatchTest()
+{
+	CLockFreeMpmcQueue<unsigned int> queue(8);
+	unsigned int items[10] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+	TEST_VERIFY(queue.TryPushBatch(items, 5) == 5);
+	//Only 3 cells are left
+	TEST_VERIFY(queue.TryPushBatch(items + 5, 5) == 3);
+	TEST_VERIFY(!queue.TryPush(8));
+	TEST_VERIFY(queue.TryPushBatch(items, 0) == 0);
+
+	unsigned int popped[10] = {};
+	TEST_VERIFY(queue.TryPopBatch(popped, 0) == 0);
+	TEST_VERIFY(queue.TryPopBatch(popped, 2) == 2);
+	TEST_VERIFY(queue.TryPopBatch(popped + 2, 10) == 6);
+	bool ordered = true;
+	for(unsigned int i = 0; i < 8; i++)
+	{
+		ordered &= (popped[i] == i);
+	}
+	TEST_VERIFY(ordered);
+	TEST_VERIFY(!queue.TryPop(popped[0]));
+}
+
+static void CapacityTest()
+{
+	TEST_VERIFY(LockFreeQueue::GetCapacity<uint8>(0) == 1);
+	TEST_VERIFY(LockFreeQueue::GetCapacity<uint8>(100) == 128);
+	TEST_VERIFY(LockFreeQueue::GetCapacity<uint8>(128) == 128);
+	{
+		bool hasThrown = false;
+		try
+		{
+			LockFreeQueue::GetCapacity<uint8>(129);
+		}
+		catch(...)
+		{
+			hasThrown = true;
+		}
+		TEST_VERIFY(hasThrown);
+	}
+	{
+		bool hasThrown = false;
+		try
+		{
+			CLockFreeQueue<unsigned int> queue(~0U);
+		}
+		catch(...)
+		{
+			hasThrown = true;
+		}
+		TEST_VERIFY(hasThrown);
+	}
+}
+
+static void MpmcThreadsTest()
+{
+	static const unsigned int threadCount = 4;
+	static const unsigned int itemCount = 20000;
+
+	CLockFreeMpmcQueue<uint32> queue(64);
+	std::atomic<uint64> sum(0);
+	std::atomic<unsigned int> poppedCount(0);
+	std::vector<std::thread> threads;
+	for(unsigned int t = 0; t < threadCount; t++)
+	{
+		threads.emplace_back(
+		    [&, t]() {
+			    uint32 batch[4];
+			    for(uint32 i = 0; i < itemCount; i += 4)
+			    {
+				    for(uint32 j = 0; j < 4; j++)
+				    {
+					    batch[j] = (t * itemCount) + i + j;
+				    }
+				    size_t pushed = 0;
+				    while(pushed != 4)
+				    {
+					    auto count = queue.TryPushBatch(batch + pushed, 4 - pushed);
+					    if(count == 0)
+					    {
+						    std::this_thread::yield();
+					    }
+					    pushed += count;
+				    }
+			    }
+		    });
+		threads.emplace_back(
+		    [&]() {
+			    uint32 batch[3];
+			    while(poppedCount < threadCount * itemCount)
+			    {
+				    auto popped = queue.TryPopBatch(batch, 3);
+				    if(popped == 0)
+				    {
+					    std::this_thread::yield();
+				    }
+				    for(size_t i = 0; i < popped; i++)
+				    {
+					    sum += batch[i];
+				    }
+				    poppedCount += static_cast<unsigned int>(popped);
+			    }
+		    });
+	}
+	for(auto& thread : threads)
+	{
+		thread.join();
+	}
+	uint64 total = static_cast<uint64>(threadCount) * itemCount;
+	TEST_VERIFY(sum == (total * (total - 1)) / 2);
+}
+
+void LockFreeQueueTest_Execute()
+{
+	SpscTest();
+	MpmcBatchTest();
+	CapacityTest();
+	MpmcThreadsTest();
+}
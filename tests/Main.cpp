@@ -1,19 +1,73 @@
+#include "AdaptiveConcurrencyLimiterTest.h"
+#include "AudioMixerTest.h"
+#include "Base64Test.h"
 #include "BitManipTest.h"
+#include "BitmapTest.h"
 #include "BmpTest.h"
+#include "CacheTest.h"
+#include "ConfigTest.h"
+#include "DatagramSocketTest.h"
+#include "FilesystemTest.h"
+#include "HashUtilsTest.h"
+#include "IdctTest.h"
+#include "JpegTest.h"
+#include "LockFreeQueueTest.h"
+#include "MemoryTest.h"
+#include "MetricsTest.h"
+#include "Mpeg2DecoderTest.h"
+#include "PngTest.h"
+#include "SerializationTest.h"
 #include "SignalTest.h"
+#include "StreamTest.h"
 #include "StringCastTest.h"
+#include "StringFormatTest.h"
+#include "StringInternerTest.h"
 #include "StringUtilsTest.h"
+#include "TextureCompressorTest.h"
+#include "ThreadPoolTest.h"
+#include "TimerTest.h"
+#include "UrlTest.h"
+#include "Utf8Test.h"
 #include "MathStringUtilsTest.h"
+#include "MathTest.h"
 #include "XmlTest.h"
+#include "ZipTest.h"
 
 int main(int argc, char** argv)
 {
+	AdaptiveConcurrencyLimiterTest_Execute();
+	AudioMixerTest_Execute();
+	Base64Test_Execute();
 	BitManipTest_Execute();
+	BitmapTest_Execute();
 	BmpTest_Execute();
+	CacheTest_Execute();
+	ConfigTest_Execute();
+	DatagramSocketTest_Execute();
+	FilesystemTest_Execute();
+	HashUtilsTest_Execute();
+	IdctTest_Execute();
+	JpegTest_Execute();
+	LockFreeQueueTest_Execute();
+	MemoryTest_Execute();
+	MetricsTest_Execute();
+	Mpeg2DecoderTest_Execute();
+	PngTest_Execute();
+	SerializationTest_Execute();
 	SignalTest_Execute();
+	StreamTest_Execute();
 	StringCastTest_Execute();
+	StringFormatTest_Execute();
+	StringInternerTest_Execute();
 	StringUtilsTest_Execute();
+	TextureCompressorTest_Execute();
+	ThreadPoolTest_Execute();
+	TimerTest_Execute();
+	UrlTest_Execute();
+	Utf8Test_Execute();
 	MathStringUtilsTest_Execute();
+	MathTest_Execute();
 	XmlTest_Execute();
+	ZipTest_Execute();
 	return 0;
 }
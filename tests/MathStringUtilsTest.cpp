@@ -9,4 +9,28 @@ void MathStringUtilsTest_Execute()
 	TEST_VERIFY(MathStringUtils::ParseFloat("0.25") == 0.25);
 	TEST_VERIFY(MathStringUtils::ParseVector2("0.25, 0.5") == CVector2(0.25, 0.5));
 	TEST_VERIFY(MathStringUtils::ParseVector3("0.25, 0.5, 0.125") == CVector3(0.25, 0.5, 0.125));
+
+	TEST_VERIFY(MathStringUtils::ParseFloat(" +1.5e2 units") == 150.0f);
+	TEST_VERIFY(MathStringUtils::ParseFloat("-.5") == -0.5f);
+	TEST_VERIFY(MathStringUtils::ParseFloat("garbage") == 0);
+	{
+		float value = 1;
+		TEST_VERIFY(!MathStringUtils::TryParseFloat("", value));
+		TEST_VERIFY(value == 1);
+	}
+	TEST_VERIFY(MathStringUtils::ParseVector2("1, 2, 3") == CVector2(0, 0));
+	TEST_VERIFY(MathStringUtils::ParseVector3("1, 2") == CVector3(0, 0, 0));
+
+	//Shortest text that round trips
+	TEST_VERIFY(MathStringUtils::ToString(0.1f) == "0.1");
+	TEST_VERIFY(MathStringUtils::ToString(1.5f) == "1.5");
+	TEST_VERIFY(MathStringUtils::ToString(-2.0f) == "-2");
+	TEST_VERIFY(MathStringUtils::ToString(CVector3(0.25, -1, 3)) == "0.25, -1, 3");
+	{
+		const float values[] = { FLT_MIN, FLT_MAX, FLT_EPSILON, -FLT_TRUE_MIN, 1.0f / 3.0f, 16777217.0f, 3.4e-20f, 123456.789f };
+		for(float value : values)
+		{
+			TEST_VERIFY(MathStringUtils::ParseFloat(MathStringUtils::ToString(value)) == value);
+		}
+	}
 }
@@ -0,0 +1,425 @@
+#include "MathTest.h"
+#include <cmath>
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include "math/BatchMath.h"
+#include "math/MathOps.h"
+#include "ThreadPool.h"
+#include "TestDefs.h"
+
+static bool IsNear(float lhs, float rhs, float tolerance = 0.0001f)
+{
+	return fabs(lhs - rhs) <= tolerance;
+}
+
+static bool IsNear(const CMatrix4& lhs, const CMatrix4& rhs, float tolerance = 0.0001f)
+{
+	for(unsigned int i = 0; i < 16; i++)
+	{
+		if(!IsNear(lhs.coeff[i], rhs.coeff[i], tolerance)) return false;
+	}
+	return true;
+}
+
+static CMatrix4 MakeTestMatrix()
+{
+	//Arbitrary non singular matrix with distinct coefficients
+	static const float coeffs[16] =
+	{
+		2, 1, 0, 3,
+		-1, 4, 2, 0,
+		0, 5, 3, 1,
+		1, 0, -2, 6,
+	};
+	CMatrix4 result;
+	for(unsigned int i = 0; i < 16; i++)
+	{
+		result.coeff[i] = coeffs[i];
+	}
+	return result;
+}
+
+static CMatrix4 MultiplyReference(const CMatrix4& lhs, const CMatrix4& rhs)
+{
+	CMatrix4 result;
+	for(unsigned int i = 0; i < 4; i++)
+	{
+		for(unsigned int j = 0; j < 4; j++)
+		{
+			float sum = 0;
+			for(unsigned int k = 0; k < 4; k++)
+			{
+				sum += lhs(i, k) * rhs(k, j);
+			}
+			result(i, j) = sum;
+		}
+	}
+	return result;
+}
+
+static bool IsNearRelative(float lhs, float rhs)
+{
+	//Per element and batch operations may differ by a rounding where the compiler fuses multiply-adds
+	return fabs(lhs - rhs) <= 0.00001f * std::max<float>(1.0f, fabs(rhs));
+}
+
+static void MathTest_Batch(Framework::CThreadPool* threadPool, size_t count)
+{
+	auto matrix = CMatrix4::MakeAxisYRotation(0.3f) * CMatrix4::MakeScale(2, 3, 4) * CMatrix4::MakeTranslation(1, -2, 3);
+
+	CVector3Array points(count);
+	CVector3Array others(count);
+	CVector4Array vectors(count);
+	for(size_t i = 0; i < count; i++)
+	{
+		float value = static_cast<float>(i);
+		points.Set(i, CVector3(value * 0.5f, 10.0f - value, (i % 7) + 1.0f));
+		others.Set(i, CVector3(1.0f, value * 0.25f, -2.0f));
+		vectors.Set(i, CVector4(value, 1.0f, -value, (i % 2) ? 1.0f : 0.0f));
+	}
+
+	{
+		CVector3Array result;
+		BatchMath::TransformPoints(matrix, points, result, threadPool);
+		TEST_VERIFY(result.GetSize() == count);
+		for(size_t i = 0; i < count; i++)
+		{
+			auto expected = matrix * CVector4(points.Get(i), 1);
+			auto actual = result.Get(i);
+			TEST_VERIFY(IsNearRelative(actual.x, expected.x) && IsNearRelative(actual.y, expected.y) && IsNearRelative(actual.z, expected.z));
+		}
+	}
+
+	{
+		CVector3Array result;
+		BatchMath::TransformVectors(matrix, points, result, threadPool);
+		for(size_t i = 0; i < count; i++)
+		{
+			auto expected = matrix * CVector4(points.Get(i), 0);
+			auto actual = result.Get(i);
+			TEST_VERIFY(IsNearRelative(actual.x, expected.x) && IsNearRelative(actual.y, expected.y) && IsNearRelative(actual.z, expected.z));
+		}
+	}
+
+	{
+		//In place
+		CVector4Array result(0);
+		BatchMath::Transform(matrix, vectors, result, threadPool);
+		BatchMath::Transform(matrix, vectors, vectors, threadPool);
+		for(size_t i = 0; i < count; i++)
+		{
+			auto expected = result.Get(i);
+			auto actual = vectors.Get(i);
+			TEST_VERIFY((actual.x == expected.x) && (actual.y == expected.y) && (actual.z == expected.z) && (actual.w == expected.w));
+		}
+	}
+
+	{
+		CVector3Array result;
+		BatchMath::Normalize(points, result, threadPool);
+		std::vector<float> dots;
+		BatchMath::Dot(points, others, dots, threadPool);
+		TEST_VERIFY(dots.size() == count);
+		for(size_t i = 0; i < count; i++)
+		{
+			auto expected = points.Get(i).Normalize();
+			auto actual = result.Get(i);
+			TEST_VERIFY(IsNearRelative(actual.x, expected.x) && IsNearRelative(actual.y, expected.y) && IsNearRelative(actual.z, expected.z));
+			TEST_VERIFY(IsNearRelative(dots[i], points.Get(i).Dot(others.Get(i))));
+		}
+	}
+
+	{
+		//Box between -10 and 10 on every axis, normals pointing inside
+		const CPlane planes[6] =
+		{
+			CPlane(1, 0, 0, -10),
+			CPlane(-1, 0, 0, -10),
+			CPlane(0, 1, 0, -10),
+			CPlane(0, -1, 0, -10),
+			CPlane(0, 0, 1, -10),
+			CPlane(0, 0, -1, -10),
+		};
+		CSphereArray spheres(count);
+		size_t expectedCount = 0;
+		for(size_t i = 0; i < count; i++)
+		{
+			CSphere sphere;
+			sphere.position = CVector3(static_cast<float>(i % 40) - 20.0f, 0, 0);
+			sphere.radius = (i % 3) ? 1.0f : 0.0f;
+			spheres.Set(i, sphere);
+			if(fabs(sphere.position.x) <= (10.0f + sphere.radius)) expectedCount++;
+		}
+		std::vector<uint8> visibility;
+		size_t visibleCount = BatchMath::CullSpheres(planes, 6, spheres, visibility, threadPool);
+		TEST_VERIFY(visibleCount == expectedCount);
+		TEST_VERIFY(visibility.size() == count);
+		for(size_t i = 0; i < count; i++)
+		{
+			auto sphere = spheres.Get(i);
+			bool expected = fabs(sphere.position.x) <= (10.0f + sphere.radius);
+			TEST_VERIFY(visibility[i] == (expected ? 1 : 0));
+		}
+		//No planes means everything is visible
+		TEST_VERIFY(BatchMath::CullSpheres(planes, 0, spheres, visibility, threadPool) == count);
+	}
+}
+
+static bool IsNearRelative(const CVector3& lhs, const CVector3& rhs)
+{
+	return IsNearRelative(lhs.x, rhs.x) && IsNearRelative(lhs.y, rhs.y) && IsNearRelative(lhs.z, rhs.z);
+}
+
+static void MathTest_BatchIntersect(Framework::CThreadPool* threadPool, size_t count)
+{
+	CRayArray rays(count);
+	CSphereArray spheres(count);
+	CPlaneArray planes(count);
+	for(size_t i = 0; i < count; i++)
+	{
+		auto position = CVector3(static_cast<float>(i % 13) - 6.0f, static_cast<float>(i % 5) - 2.0f, 0);
+		auto direction = (i % 2) ? CVector3(0.6f, 0, 0.8f) : CVector3(0, 0, 1);
+		rays.Set(i, CRay(position, direction));
+
+		CSphere sphere;
+		sphere.position = CVector3(static_cast<float>(i % 50) - 25.0f, static_cast<float>(i % 7) - 3.0f, (i % 5) ? 10.0f : -10.0f);
+		sphere.radius = static_cast<float>(i % 4) * 0.5f + 0.25f;
+		if((i % 11) == 0)
+		{
+			//Contains the ray's origin
+			sphere.position = CVector3(0, 0, 1);
+			sphere.radius = 2;
+		}
+		spheres.Set(i, sphere);
+
+		//Every third plane is parallel to the ray
+		auto normal = (i % 3) ? CVector3(0, 0.6f, 0.8f) : CVector3(1, 0, 0);
+		planes.Set(i, CPlane(normal, static_cast<float>(i % 20) - 10.0f));
+	}
+
+	std::vector<float> distances;
+
+	//One ray, many spheres
+	{
+		CRay ray(CVector3(0, 0, 0), CVector3(0, 0, 1));
+		size_t hitCount = BatchMath::IntersectSpheres(ray, spheres, distances, threadPool);
+		TEST_VERIFY(distances.size() == count);
+		size_t expectedHitCount = 0;
+		for(size_t i = 0; i < count; i++)
+		{
+			auto expected = Intersects(spheres.Get(i), ray);
+			TEST_VERIFY(expected.first == (distances[i] != std::numeric_limits<float>::infinity()));
+			if(!expected.first) continue;
+			expectedHitCount++;
+			TEST_VERIFY(IsNearRelative(ray.position + ray.direction * distances[i], expected.second));
+		}
+		TEST_VERIFY(hitCount == expectedHitCount);
+		TEST_VERIFY((count < 11) || (expectedHitCount != 0));
+	}
+
+	//One ray, many planes
+	{
+		CRay ray(CVector3(1, 2, 3), CVector3(0, 0, 1));
+		size_t hitCount = BatchMath::IntersectPlanes(ray, planes, distances, threadPool);
+		TEST_VERIFY(distances.size() == count);
+		size_t expectedHitCount = 0;
+		for(size_t i = 0; i < count; i++)
+		{
+			auto expected = Intersects(planes.Get(i), ray);
+			TEST_VERIFY(expected.first == (distances[i] != std::numeric_limits<float>::infinity()));
+			if(!expected.first) continue;
+			expectedHitCount++;
+			TEST_VERIFY(IsNearRelative(ray.position + ray.direction * distances[i], expected.second));
+		}
+		TEST_VERIFY(hitCount == expectedHitCount);
+	}
+
+	//Ray packets
+	{
+		CSphere sphere;
+		sphere.position = CVector3(0, 0, 10);
+		sphere.radius = 2.5f;
+		size_t hitCount = BatchMath::IntersectSphere(rays, sphere, distances, threadPool);
+		TEST_VERIFY(distances.size() == count);
+		size_t expectedHitCount = 0;
+		for(size_t i = 0; i < count; i++)
+		{
+			auto ray = rays.Get(i);
+			auto expected = Intersects(sphere, ray);
+			TEST_VERIFY(expected.first == (distances[i] != std::numeric_limits<float>::infinity()));
+			if(!expected.first) continue;
+			expectedHitCount++;
+			TEST_VERIFY(IsNearRelative(ray.position + ray.direction * distances[i], expected.second));
+		}
+		TEST_VERIFY(hitCount == expectedHitCount);
+	}
+
+	{
+		CPlane plane(CVector3(0, 0.6f, 0.8f), 4);
+		size_t hitCount = BatchMath::IntersectPlane(rays, plane, distances, threadPool);
+		TEST_VERIFY(hitCount == count);
+		for(size_t i = 0; i < count; i++)
+		{
+			auto ray = rays.Get(i);
+			auto expected = Intersects(plane, ray);
+			TEST_VERIFY(expected.first);
+			TEST_VERIFY(IsNearRelative(ray.position + ray.direction * distances[i], expected.second));
+		}
+	}
+
+	//Plane against point cloud
+	{
+		CPlane plane(CVector3(0, 0.6f, -0.8f), 1.5f);
+		const auto& points = spheres.GetPositions();
+		BatchMath::PlaneDistances(plane, points, distances, threadPool);
+		TEST_VERIFY(distances.size() == count);
+		for(size_t i = 0; i < count; i++)
+		{
+			auto expected = CVector3(plane.a, plane.b, plane.c).Dot(points.Get(i)) - plane.d;
+			TEST_VERIFY(IsNearRelative(distances[i], expected));
+		}
+	}
+}
+
+static void MathTest_BatchQuaternion(Framework::CThreadPool* threadPool, size_t count)
+{
+	static const float alpha = 0.3f;
+
+	CQuaternionArray lhs(count);
+	CQuaternionArray rhs(count);
+	for(size_t i = 0; i < count; i++)
+	{
+		auto lhsAxis = CVector3(1, static_cast<float>(i % 5) - 2.0f, static_cast<float>(i % 3)).Normalize();
+		auto rhsAxis = CVector3(static_cast<float>(i % 4) - 1.5f, 1, 0.5f).Normalize();
+		CQuaternion lhsValue(lhsAxis, static_cast<float>(i % 17) * 0.37f);
+		CQuaternion rhsValue(rhsAxis, static_cast<float>(i % 13) * 0.5f - 3.0f);
+		if((i % 9) == 0)
+		{
+			//Close enough for linear interpolation
+			rhsValue = (lhsValue * CQuaternion(lhsAxis, 0.01f));
+		}
+		if((i % 10) == 0)
+		{
+			//Same rotation, opposite sign
+			rhsValue = lhsValue * -1.0f;
+		}
+		lhs.Set(i, lhsValue);
+		rhs.Set(i, rhsValue);
+	}
+
+	{
+		CQuaternionArray result;
+		BatchMath::Slerp(lhs, rhs, alpha, result, threadPool);
+		TEST_VERIFY(result.GetSize() == count);
+		for(size_t i = 0; i < count; i++)
+		{
+			auto expected = Slerp(lhs.Get(i), rhs.Get(i), alpha);
+			auto actual = result.Get(i);
+			TEST_VERIFY(IsNear(actual.x, expected.x, 0.00001f) && IsNear(actual.y, expected.y, 0.00001f) &&
+			            IsNear(actual.z, expected.z, 0.00001f) && IsNear(actual.w, expected.w, 0.00001f));
+		}
+
+		//In place
+		auto inPlace = lhs;
+		BatchMath::Slerp(inPlace, rhs, alpha, inPlace, threadPool);
+		for(size_t i = 0; i < count; i++)
+		{
+			auto expected = result.Get(i);
+			auto actual = inPlace.Get(i);
+			TEST_VERIFY((actual.x == expected.x) && (actual.y == expected.y) && (actual.z == expected.z) && (actual.w == expected.w));
+		}
+	}
+
+	{
+		std::vector<CMatrix4> matrices;
+		BatchMath::ToMatrices(lhs, matrices, threadPool);
+		TEST_VERIFY(matrices.size() == count);
+		for(size_t i = 0; i < count; i++)
+		{
+			TEST_VERIFY(IsNear(matrices[i], lhs.Get(i).ToMatrix(), 0.00001f));
+		}
+	}
+}
+
+void MathTest_Execute()
+{
+	static_assert(alignof(CMatrix4) == 16, "CMatrix4 needs to be 16 bytes aligned.");
+	static_assert(alignof(CVector4) == 16, "CVector4 needs to be 16 bytes aligned.");
+	static_assert(sizeof(CVector4) == 16, "CVector4 needs to be tightly packed.");
+
+	auto matrix = MakeTestMatrix();
+	auto rotation = CMatrix4::MakeAxisZRotation(0.5f) * CMatrix4::MakeTranslation(1, 2, 3);
+
+	//Multiply
+	TEST_VERIFY(IsNear(matrix * rotation, MultiplyReference(matrix, rotation)));
+	TEST_VERIFY(IsNear(matrix * CMatrix4::MakeIdentity(), matrix, 0));
+
+	//Transpose
+	{
+		auto transpose = matrix.Transpose();
+		for(unsigned int i = 0; i < 4; i++)
+		{
+			for(unsigned int j = 0; j < 4; j++)
+			{
+				TEST_VERIFY(transpose(i, j) == matrix(j, i));
+			}
+		}
+	}
+
+	//Inverse
+	TEST_VERIFY(IsNear(matrix * matrix.Inverse(), CMatrix4::MakeIdentity()));
+	TEST_VERIFY(IsNear(rotation.Inverse() * rotation, CMatrix4::MakeIdentity()));
+	{
+		auto inverse = CMatrix4::MakeTranslation(1, 2, 3).Inverse();
+		TEST_VERIFY(IsNear(inverse, CMatrix4::MakeTranslation(-1, -2, -3)));
+	}
+	{
+		//Singular matrices produce the identity
+		auto singular = matrix;
+		for(unsigned int i = 0; i < 4; i++)
+		{
+			singular(3, i) = singular(0, i) * 2;
+		}
+		TEST_VERIFY(IsNear(singular.Inverse(), CMatrix4::MakeIdentity(), 0));
+	}
+
+	//Vector transforms
+	{
+		CVector4 vector(1, -2, 3, 1);
+		auto rowResult = vector * matrix;
+		TEST_VERIFY(IsNear(rowResult.x, matrix(0, 0) - 2 * matrix(0, 1) + 3 * matrix(0, 2) + matrix(0, 3)));
+		TEST_VERIFY(IsNear(rowResult.w, matrix(3, 0) - 2 * matrix(3, 1) + 3 * matrix(3, 2) + matrix(3, 3)));
+		auto columnResult = matrix * vector;
+		TEST_VERIFY(IsNear(columnResult.x, matrix(0, 0) - 2 * matrix(1, 0) + 3 * matrix(2, 0) + matrix(3, 0)));
+		TEST_VERIFY(IsNear(columnResult.w, matrix(0, 3) - 2 * matrix(1, 3) + 3 * matrix(2, 3) + matrix(3, 3)));
+		auto translated = CMatrix4::MakeTranslation(1, 2, 3) * vector;
+		TEST_VERIFY(IsNear(translated.x, 2) && IsNear(translated.y, 0) && IsNear(translated.z, 6) && IsNear(translated.w, 1));
+		auto vector3Result = CVector3(1, -2, 3) * matrix;
+		TEST_VERIFY(IsNear(vector3Result.y, matrix(1, 0) - 2 * matrix(1, 1) + 3 * matrix(1, 2)));
+	}
+
+	//Containers keep the alignment
+	{
+		std::vector<CMatrix4> matrices(3, matrix);
+		std::vector<CVector4> vectors(3, CVector4(1, 2, 3, 4));
+		TEST_VERIFY((reinterpret_cast<uintptr_t>(matrices.data() + 1) % 16) == 0);
+		TEST_VERIFY((reinterpret_cast<uintptr_t>(vectors.data() + 1) % 16) == 0);
+		TEST_VERIFY(IsNear(matrices[2] * matrices[1].Inverse(), CMatrix4::MakeIdentity()));
+	}
+
+	//Sizes that leave scalar tails after the SIMD loops
+	MathTest_Batch(nullptr, 0);
+	MathTest_Batch(nullptr, 1003);
+	MathTest_BatchIntersect(nullptr, 0);
+	MathTest_BatchIntersect(nullptr, 1003);
+	MathTest_BatchQuaternion(nullptr, 0);
+	MathTest_BatchQuaternion(nullptr, 1003);
+	{
+		Framework::CThreadPool threadPool(4);
+		MathTest_Batch(&threadPool, 100003);
+		MathTest_BatchIntersect(&threadPool, 100003);
+		MathTest_BatchQuaternion(&threadPool, 100003);
+	}
+}
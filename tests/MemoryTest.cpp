@@ -0,0 +1,265 @@
+#include "MemoryTest.h"
+#include <atomic>
+#include <cstdint>
+#include <set>
+#include <thread>
+#include <vector>
+#include "memory/AllocationTracker.h"
+#include "memory/Arena.h"
+#include "memory/ConcurrentFixedSizePool.h"
+#include "memory/FixedSizePool.h"
+#include "memory/HugePageRegion.h"
+#include "memory/MemoryResource.h"
+#include "TestDefs.h"
+
+using namespace Framework::Memory;
+
+static bool IsAligned(const void* ptr, size_t alignment)
+{
+	return (reinterpret_cast<uintptr_t>(ptr) % alignment) == 0;
+}
+
+static void ArenaTest()
+{
+	CArena arena(0x100);
+	auto first = reinterpret_cast<uint8*>(arena.Allocate(3, 1));
+	auto second = reinterpret_cast<uint8*>(arena.Allocate(16, 16));
+	TEST_VERIFY(IsAligned(second, 16));
+	TEST_VERIFY(second >= first + 3);
+
+	//Larger than a chunk
+	auto large = reinterpret_cast<uint32*>(arena.Allocate(0x1000, 64));
+	TEST_VERIFY(IsAligned(large, 64));
+	for(unsigned int i = 0; i < 0x400; i++)
+	{
+		large[i] = i;
+	}
+
+	auto values = arena.NewArray<uint32>(10);
+	bool zeroed = true;
+	for(unsigned int i = 0; i < 10; i++)
+	{
+		zeroed &= (values[i] == 0);
+	}
+	TEST_VERIFY(zeroed);
+	TEST_VERIFY(*arena.New<uint64>(0x1234) == 0x1234);
+	TEST_VERIFY(arena.GetUsedSize() >= 0x1000 + 3 + 16 + 40 + 8);
+
+	arena.Reset();
+	TEST_VERIFY(arena.GetUsedSize() == 0);
+	TEST_VERIFY(IsAligned(arena.Allocate(8, 32), 32));
+}
+
+static void ArenaRegionTest()
+{
+	CHugePageRegion region(0x10000);
+	TEST_VERIFY(region.GetData() != nullptr);
+	TEST_VERIFY(region.GetSize() >= 0x10000);
+
+	auto regionBegin = reinterpret_cast<uint8*>(region.GetData());
+	auto regionEnd = regionBegin + region.GetSize();
+	CArena arena(region.GetData(), region.GetSize());
+	auto ptr = reinterpret_cast<uint8*>(arena.Allocate(0x100));
+	TEST_VERIFY((ptr >= regionBegin) && (ptr < regionEnd));
+	//Doesn't fit in the region anymore, comes from the heap
+	auto overflow = reinterpret_cast<uint8*>(arena.Allocate(region.GetSize()));
+	TEST_VERIFY((overflow < regionBegin) || (overflow >= regionEnd));
+
+	arena.Reset();
+	TEST_VERIFY(arena.Allocate(0x100) == ptr);
+}
+
+static void FixedSizePoolTest()
+{
+	CFixedSizePool pool(24, 8, 4);
+	TEST_VERIFY(pool.GetBlockSize() >= 24);
+	std::set<void*> blocks;
+	for(unsigned int i = 0; i < 10; i++)
+	{
+		auto block = pool.Allocate();
+		TEST_VERIFY(IsAligned(block, 8));
+		blocks.insert(block);
+	}
+	TEST_VERIFY(blocks.size() == 10);
+
+	//Freed block is reused first
+	auto block = *blocks.begin();
+	pool.Free(block);
+	TEST_VERIFY(pool.Allocate() == block);
+
+	for(auto usedBlock : blocks)
+	{
+		pool.Free(usedBlock);
+	}
+
+	struct OBJECT
+	{
+		OBJECT(int& counter)
+		: counter(counter)
+		{
+			counter++;
+		}
+		~OBJECT()
+		{
+			counter--;
+		}
+		int& counter;
+	};
+
+	int counter = 0;
+	CObjectPool<OBJECT> objectPool;
+	auto object0 = objectPool.New(counter);
+	auto object1 = objectPool.New(counter);
+	TEST_VERIFY(counter == 2);
+	objectPool.Delete(object0);
+	objectPool.Delete(object1);
+	TEST_VERIFY(counter == 0);
+}
+
+static void ConcurrentFixedSizePoolTest()
+{
+	static const unsigned int threadCount = 4;
+	static const unsigned int iterationCount = 2000;
+
+	CConcurrentFixedSizePool pool(sizeof(uint64), alignof(uint64), 16, 8);
+	std::atomic<bool> valid(true);
+	std::vector<std::thread> threads;
+	//Blocks allocated by a thread are handed over and freed by the next one
+	std::vector<std::vector<void*>> handedOver(threadCount);
+	for(unsigned int t = 0; t < threadCount; t++)
+	{
+		threads.emplace_back(
+		    [&, t]() {
+			    std::vector<uint64*> blocks;
+			    for(unsigned int i = 0; i < iterationCount; i++)
+			    {
+				    auto block = reinterpret_cast<uint64*>(pool.Allocate());
+				    *block = (static_cast<uint64>(t) << 32) | i;
+				    blocks.push_back(block);
+				    if(blocks.size() == 32)
+				    {
+					    for(auto usedBlock : blocks)
+					    {
+						    if((*usedBlock >> 32) != t) valid = false;
+						    pool.Free(usedBlock);
+					    }
+					    blocks.clear();
+				    }
+			    }
+			    for(auto usedBlock : blocks)
+			    {
+				    handedOver[t].push_back(usedBlock);
+			    }
+		    });
+	}
+	for(auto& thread : threads)
+	{
+		thread.join();
+	}
+	TEST_VERIFY(valid);
+
+	threads.clear();
+	for(unsigned int t = 0; t < threadCount; t++)
+	{
+		threads.emplace_back(
+		    [&, t]() {
+			    for(auto block : handedOver[(t + 1) % threadCount])
+			    {
+				    pool.Free(block);
+			    }
+		    });
+	}
+	for(auto& thread : threads)
+	{
+		thread.join();
+	}
+}
+
+static void MemoryResourceTest()
+{
+#if defined(FRAMEWORK_HAS_MEMORY_RESOURCE)
+	{
+		CArena arena;
+		CArenaResource resource(arena);
+		std::pmr::vector<uint32> values(&resource);
+		for(uint32 i = 0; i < 1000; i++)
+		{
+			values.push_back(i);
+		}
+		TEST_VERIFY(values[999] == 999);
+		TEST_VERIFY(arena.GetUsedSize() >= 1000 * sizeof(uint32));
+	}
+
+	{
+		CConcurrentFixedSizePool pool(32);
+		CPoolResource resource(pool);
+		void* small = resource.allocate(16);
+		void* large = resource.allocate(256);
+		resource.deallocate(small, 16);
+		resource.deallocate(large, 256);
+		//Came back through the pool
+		TEST_VERIFY(resource.allocate(32) == small);
+	}
+#endif
+}
+
+static void AllocationTrackerTest()
+{
+	auto& tracker = CAllocationTracker::GetInstance();
+	tracker.Reset();
+
+	//Not counted, even once it's freed
+	void* untracked = tracker.Allocate(CAllocationTracker::SUBSYSTEM_XML, FRAMEWORK_ALLOCATION_SITE, 100);
+	tracker.SetEnabled(true);
+	tracker.Free(untracked);
+	TEST_VERIFY(tracker.GetSnapshot().subsystems[CAllocationTracker::SUBSYSTEM_XML].freeCount == 0);
+
+	static const char* bigSite = "big";
+	static const char* smallSite = "small";
+	void* big = tracker.Allocate(CAllocationTracker::SUBSYSTEM_ZIP, bigSite, 0x1000, 64);
+	TEST_VERIFY(IsAligned(big, 64));
+	void* small = tracker.Allocate(CAllocationTracker::SUBSYSTEM_ZIP, smallSite, 0x10);
+	{
+		CAllocationRecord record(CAllocationTracker::SUBSYSTEM_HTTP, smallSite, 0x20);
+		record.SetSize(0x30);
+		auto snapshot = tracker.GetSnapshot();
+		TEST_VERIFY(snapshot.subsystems[CAllocationTracker::SUBSYSTEM_HTTP].liveBytes == 0x30);
+		TEST_VERIFY(snapshot.subsystems[CAllocationTracker::SUBSYSTEM_HTTP].peakBytes == 0x30);
+	}
+	tracker.Free(small);
+	big = tracker.Reallocate(big, 0x2000);
+
+	auto snapshot = tracker.GetSnapshot(1);
+	const auto& zipStats = snapshot.subsystems[CAllocationTracker::SUBSYSTEM_ZIP];
+	TEST_VERIFY(zipStats.liveBytes == 0x2000);
+	TEST_VERIFY(zipStats.peakBytes == 0x3000);
+	TEST_VERIFY(zipStats.allocationCount == 3);
+	TEST_VERIFY(zipStats.freeCount == 2);
+	TEST_VERIFY(snapshot.subsystems[CAllocationTracker::SUBSYSTEM_HTTP].liveBytes == 0);
+	TEST_VERIFY(snapshot.topSites.size() == 1);
+	TEST_VERIFY(snapshot.topSites[0].site == bigSite);
+	TEST_VERIFY(snapshot.topSites[0].liveBytes == 0x2000);
+
+	{
+		std::vector<uint32, CTrackingAllocator<uint32, CAllocationTracker::SUBSYSTEM_BITMAP>> values(FRAMEWORK_ALLOCATION_SITE);
+		values.resize(100);
+		TEST_VERIFY(tracker.GetSnapshot().subsystems[CAllocationTracker::SUBSYSTEM_BITMAP].liveBytes == 100 * sizeof(uint32));
+	}
+	TEST_VERIFY(tracker.GetSnapshot().subsystems[CAllocationTracker::SUBSYSTEM_BITMAP].liveBytes == 0);
+
+	//Allocation made before the reset isn't counted when freed
+	tracker.Reset();
+	tracker.Free(big);
+	TEST_VERIFY(tracker.GetSnapshot().subsystems[CAllocationTracker::SUBSYSTEM_ZIP].liveBytes == 0);
+	tracker.SetEnabled(false);
+}
+
+void MemoryTest_Execute()
+{
+	ArenaTest();
+	ArenaRegionTest();
+	FixedSizePoolTest();
+	ConcurrentFixedSizePoolTest();
+	MemoryResourceTest();
+	AllocationTrackerTest();
+}
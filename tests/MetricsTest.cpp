@@ -0,0 +1,149 @@
+#include "MetricsTest.h"
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "Metrics.h"
+#include "StartupProfiler.h"
+#include "TestDefs.h"
+
+using namespace Framework;
+using namespace Framework::Metrics;
+
+static void CounterTest()
+{
+	static const unsigned int threadCount = 4;
+	static const unsigned int incrementCount = 10000;
+
+	CCounter counter;
+	std::vector<std::thread> threads;
+	for(unsigned int t = 0; t < threadCount; t++)
+	{
+		threads.emplace_back(
+		    [&]() {
+			    for(unsigned int i = 0; i < incrementCount; i++)
+			    {
+				    counter.Add();
+			    }
+		    });
+	}
+	for(auto& thread : threads)
+	{
+		thread.join();
+	}
+	TEST_VERIFY(counter.GetValue() == threadCount * incrementCount);
+}
+
+static void HistogramTest()
+{
+	//Bucket bounds cover the whole range without gaps
+	bool contiguous = true;
+	for(unsigned int i = 1; i < CHistogram::BUCKET_COUNT; i++)
+	{
+		contiguous &= (CHistogram::GetBucketIndex(CHistogram::GetBucketUpperBound(i - 1) + 1) == i);
+		contiguous &= (CHistogram::GetBucketIndex(CHistogram::GetBucketUpperBound(i)) == i);
+	}
+	TEST_VERIFY(contiguous);
+	TEST_VERIFY(CHistogram::GetBucketUpperBound(CHistogram::BUCKET_COUNT - 1) == ~0ULL);
+
+	CHistogram histogram;
+	for(uint64 i = 1; i <= 1000; i++)
+	{
+		histogram.Record(i);
+	}
+	TEST_VERIFY(histogram.GetCount() == 1000);
+	TEST_VERIFY(histogram.GetSum() == 500500);
+	//Within the bucket precision
+	auto median = histogram.GetQuantile(0.5);
+	TEST_VERIFY((median >= 500) && (median <= 500 + 500 / CHistogram::SUB_BUCKET_COUNT));
+	auto p99 = histogram.GetQuantile(0.99);
+	TEST_VERIFY((p99 >= 990) && (p99 <= 990 + 990 / CHistogram::SUB_BUCKET_COUNT));
+	TEST_VERIFY(histogram.GetCountBelow(15) == 15);
+	TEST_VERIFY(histogram.GetCountBelow(1023) == 1000);
+}
+
+static void RegistryTest()
+{
+	auto& registry = CRegistry::GetInstance();
+	auto& counter = registry.GetCounter("metricstest_requests_total", "method=\"GET\"", "Requests.");
+	counter.Add(3);
+	TEST_VERIFY(&registry.GetCounter("metricstest_requests_total", "method=\"GET\"") == &counter);
+	registry.GetCounter("metricstest_requests_total", "method=\"POST\"").Add(1);
+	registry.GetGauge("metricstest_queue_depth").Set(-2);
+	registry.GetHistogram("metricstest_latency_microseconds").Record(10);
+	registry.SetGaugeFunction("metricstest_ratio", "", "", []() { return 0.5; });
+
+	bool typeMismatchThrown = false;
+	try
+	{
+		registry.GetGauge("metricstest_requests_total");
+	}
+	catch(const std::exception&)
+	{
+		typeMismatchThrown = true;
+	}
+	TEST_VERIFY(typeMismatchThrown);
+
+	auto text = registry.ExportPrometheus();
+	TEST_VERIFY(text.find("# HELP metricstest_requests_total Requests.\n# TYPE metricstest_requests_total counter\n"
+	                      "metricstest_requests_total{method=\"GET\"} 3\nmetricstest_requests_total{method=\"POST\"} 1\n") != std::string::npos);
+	TEST_VERIFY(text.find("metricstest_queue_depth -2\n") != std::string::npos);
+	TEST_VERIFY(text.find("metricstest_latency_microseconds_bucket{le=\"3\"} 0\n") != std::string::npos);
+	TEST_VERIFY(text.find("metricstest_latency_microseconds_bucket{le=\"15\"} 1\n") != std::string::npos);
+	TEST_VERIFY(text.find("metricstest_latency_microseconds_count 1\n") != std::string::npos);
+	TEST_VERIFY(text.find("metricstest_ratio 0.5\n") != std::string::npos);
+
+	auto json = registry.ExportJson();
+	TEST_VERIFY(json.find("{\"name\":\"metricstest_requests_total\",\"labels\":\"method=\\\"GET\\\"\",\"type\":\"counter\",\"value\":3}") != std::string::npos);
+}
+
+static void StartupProfilerTest()
+{
+	auto& profiler = CStartupProfiler::GetInstance();
+	{
+		FRAMEWORK_STARTUP_PHASE("MetricsTest::Outer");
+		{
+			FRAMEWORK_STARTUP_PHASE("MetricsTest::Inner");
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		std::thread([]() { FRAMEWORK_STARTUP_PHASE("MetricsTest::Worker"); }).join();
+	}
+	profiler.Finish();
+	{
+		FRAMEWORK_STARTUP_PHASE("MetricsTest::AfterFinish");
+	}
+
+	//Other tests might have recorded phases before
+	std::vector<CStartupProfiler::PHASE> phases;
+	for(const auto& phase : profiler.GetPhases())
+	{
+		if(phase.name.find("MetricsTest::") == 0)
+		{
+			phases.push_back(phase);
+		}
+	}
+	TEST_VERIFY(phases.size() == 3);
+	TEST_VERIFY(phases[0].name == "MetricsTest::Outer");
+	TEST_VERIFY(phases[0].depth == 0);
+	TEST_VERIFY(phases[1].name == "MetricsTest::Inner");
+	TEST_VERIFY(phases[1].depth == 1);
+	TEST_VERIFY(phases[1].threadIndex == phases[0].threadIndex);
+	TEST_VERIFY((phases[1].endTime - phases[1].beginTime) >= 1000000);
+	TEST_VERIFY(phases[1].endTime <= phases[0].endTime);
+	TEST_VERIFY(phases[2].name == "MetricsTest::Worker");
+	TEST_VERIFY(phases[2].depth == 0);
+	TEST_VERIFY(phases[2].threadIndex != phases[0].threadIndex);
+	TEST_VERIFY(profiler.GetFinishTime() >= phases[0].endTime);
+
+	auto timeline = profiler.FormatTimeline();
+	TEST_VERIFY(timeline.find("]   MetricsTest::Inner\n") != std::string::npos);
+	TEST_VERIFY(timeline.find(" ms finished\n") != std::string::npos);
+}
+
+void MetricsTest_Execute()
+{
+	CounterTest();
+	HistogramTest();
+	RegistryTest();
+	StartupProfilerTest();
+}
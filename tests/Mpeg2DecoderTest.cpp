@@ -0,0 +1,709 @@
+#include "Mpeg2DecoderTest.h"
+#include <algorithm>
+#include <cstdint>
+#include <initializer_list>
+#include <iterator>
+#include <stdexcept>
+#include <vector>
+#include "TestDefs.h"
+#include "ThreadPool.h"
+#include "idct/FixedPoint.h"
+#include "mpeg2/Decoder.h"
+#include "mpeg2/InverseScanTable.h"
+#include "mpeg2/MotionCompensation.h"
+
+using namespace MPEG2;
+
+enum
+{
+	WIDTH = 48,
+	HEIGHT = 32,
+	MB_WIDTH = 3,
+	MB_HEIGHT = 2,
+	PICTURE_STRUCTURE_FRAME = 3,
+	PICTURE_STRUCTURE_TOP_FIELD = 1,
+};
+
+class CBitWriter
+{
+public:
+	void Write(uint32 value, unsigned int bitCount)
+	{
+		for(unsigned int i = bitCount; i != 0; i--)
+		{
+			if((m_bitCount & 7) == 0) m_data.push_back(0);
+			if((value >> (i - 1)) & 1)
+			{
+				m_data.back() |= static_cast<uint8>(0x80 >> (m_bitCount & 7));
+			}
+			m_bitCount++;
+		}
+	}
+
+	void WriteStartCode(uint8 code)
+	{
+		m_bitCount = (m_bitCount + 7) & ~7;
+		Write(0x000001, 24);
+		Write(code, 8);
+	}
+
+	const std::vector<uint8>& GetData() const
+	{
+		return m_data;
+	}
+
+private:
+	std::vector<uint8> m_data;
+	unsigned int m_bitCount = 0;
+};
+
+struct DECODED_FRAME
+{
+	CDecoder::PICTURE_TYPE type = CDecoder::PICTURE_TYPE_I;
+	unsigned int temporalReference = 0;
+	std::vector<uint8> planes[3];
+	unsigned int widths[3] = {WIDTH, WIDTH / 2, WIDTH / 2};
+	unsigned int heights[3] = {HEIGHT, HEIGHT / 2, HEIGHT / 2};
+
+	bool operator==(const DECODED_FRAME& rhs) const
+	{
+		return (type == rhs.type) && (temporalReference == rhs.temporalReference) &&
+		       (planes[0] == rhs.planes[0]) && (planes[1] == rhs.planes[1]) && (planes[2] == rhs.planes[2]);
+	}
+};
+
+typedef std::vector<DECODED_FRAME> FrameArray;
+
+struct PREDICTION
+{
+	const DECODED_FRAME* reference;
+	int32 vectorX;
+	int32 vectorY;
+};
+
+static unsigned int GetIntraMatrixValue(unsigned int scanIndex)
+{
+	return 16 + scanIndex;
+}
+
+static unsigned int GetRasterPosition(unsigned int scanIndex)
+{
+	for(unsigned int i = 0; i < 64; i++)
+	{
+		if(CInverseScanTable::m_nTable0[i] == scanIndex) return i;
+	}
+	return 0;
+}
+
+static int32 GetLumaLevel(unsigned int mb, unsigned int block)
+{
+	return 40 + (23 * mb) + (11 * block);
+}
+
+static int32 GetChromaLevel(unsigned int mb, unsigned int plane)
+{
+	return 100 + (7 * mb) + (5 * plane);
+}
+
+static uint8 ClampSample(int32 value)
+{
+	return static_cast<uint8>(std::min(std::max(value, 0), 255));
+}
+
+//Mismatch control and IDCT of dequantized coefficients
+static void InverseTransform(int16 (&coefficients)[64], int16* output)
+{
+	int32 sum = 0;
+	for(auto coefficient : coefficients) sum += coefficient;
+	if(!(sum & 1)) coefficients[63] ^= 1;
+	IDCT::CFixedPoint::GetInstance()->Transform(coefficients, output);
+}
+
+//Intra macroblock 4 has an AC coefficient (run 2, level -7) in its second block
+static void GetExpectedIntraBlock(unsigned int mb, unsigned int block, unsigned int quantiserScale, int16* output)
+{
+	int16 coefficients[64] = {};
+	int32 level = (block < 4) ? GetLumaLevel(mb, block) : GetChromaLevel(mb, block - 4);
+	coefficients[0] = static_cast<int16>(level * 8);
+	if((mb == 4) && (block == 1))
+	{
+		coefficients[GetRasterPosition(3)] = static_cast<int16>((-7 * 2 * static_cast<int32>(GetIntraMatrixValue(3) * quantiserScale)) / 32);
+	}
+	InverseTransform(coefficients, output);
+}
+
+static void GetExpectedResidual(int32 level, unsigned int quantiserScale, int16* output)
+{
+	int16 coefficients[64] = {};
+	coefficients[0] = static_cast<int16>(((2 * level + ((level > 0) ? 1 : -1)) * 16 * static_cast<int32>(quantiserScale)) / 32);
+	InverseTransform(coefficients, output);
+}
+
+static void WriteSequenceHeader(CBitWriter& writer)
+{
+	writer.WriteStartCode(0xB3);
+	writer.Write(WIDTH, 12);
+	writer.Write(HEIGHT, 12);
+	writer.Write(1, 4);
+	writer.Write(3, 4);
+	writer.Write(1000, 18);
+	writer.Write(1, 1);
+	writer.Write(112, 10);
+	writer.Write(0, 1);
+	//Intra matrix in zigzag order, default non-intra matrix
+	writer.Write(1, 1);
+	for(unsigned int i = 0; i < 64; i++) writer.Write(GetIntraMatrixValue(i), 8);
+	writer.Write(0, 1);
+
+	//Sequence extension: main profile at main level, progressive, 4:2:0
+	writer.WriteStartCode(0xB5);
+	writer.Write(1, 4);
+	writer.Write(0x48, 8);
+	writer.Write(1, 1);
+	writer.Write(1, 2);
+	writer.Write(0, 2);
+	writer.Write(0, 2);
+	writer.Write(0, 12);
+	writer.Write(1, 1);
+	writer.Write(0, 8);
+	writer.Write(0, 1);
+	writer.Write(0, 2);
+	writer.Write(0, 5);
+
+	//Closed group of pictures
+	writer.WriteStartCode(0xB8);
+	writer.Write(0, 25);
+	writer.Write(1, 1);
+	writer.Write(0, 1);
+}
+
+static void WritePictureHeader(CBitWriter& writer, CDecoder::PICTURE_TYPE type, unsigned int temporalReference, unsigned int pictureStructure = PICTURE_STRUCTURE_FRAME)
+{
+	writer.WriteStartCode(0x00);
+	writer.Write(temporalReference, 10);
+	writer.Write(type, 3);
+	writer.Write(0xFFFF, 16);
+	if(type != CDecoder::PICTURE_TYPE_I)
+	{
+		writer.Write(0, 1);
+		writer.Write(7, 3);
+	}
+	if(type == CDecoder::PICTURE_TYPE_B)
+	{
+		writer.Write(0, 1);
+		writer.Write(7, 3);
+	}
+	writer.Write(0, 1);
+
+	//Picture coding extension
+	writer.WriteStartCode(0xB5);
+	writer.Write(8, 4);
+	writer.Write((type != CDecoder::PICTURE_TYPE_I) ? 1 : 15, 4);
+	writer.Write((type != CDecoder::PICTURE_TYPE_I) ? 1 : 15, 4);
+	writer.Write((type == CDecoder::PICTURE_TYPE_B) ? 1 : 15, 4);
+	writer.Write((type == CDecoder::PICTURE_TYPE_B) ? 1 : 15, 4);
+	writer.Write(0, 2);
+	writer.Write(pictureStructure, 2);
+	writer.Write(0, 1);
+	//Frame prediction and frame DCT only
+	writer.Write(1, 1);
+	writer.Write(0, 1);
+	writer.Write(0, 1);
+	writer.Write(0, 1);
+	writer.Write(0, 1);
+	writer.Write(0, 1);
+	writer.Write(1, 1);
+	writer.Write(1, 1);
+	writer.Write(0, 1);
+}
+
+static void WriteSliceHeader(CBitWriter& writer, unsigned int row, unsigned int quantiserScaleCode)
+{
+	writer.WriteStartCode(static_cast<uint8>(row + 1));
+	writer.Write(quantiserScaleCode, 5);
+	writer.Write(0, 1);
+}
+
+static void WriteAddressIncrement(CBitWriter& writer, unsigned int increment)
+{
+	static const uint32 codes[3][2] = {{1, 1}, {3, 3}, {2, 3}};
+	writer.Write(codes[increment - 1][0], codes[increment - 1][1]);
+}
+
+static void WriteMotionCode(CBitWriter& writer, int32 motionCode)
+{
+	//Codes for 0, 1, 2 and 3, negative values have the last bit set
+	static const uint32 codes[4][2] = {{1, 1}, {2, 3}, {2, 4}, {2, 5}};
+	unsigned int magnitude = std::abs(motionCode);
+	writer.Write(codes[magnitude][0] | ((motionCode < 0) ? 1 : 0), codes[magnitude][1]);
+}
+
+static void WriteDcDifferential(CBitWriter& writer, bool isChroma, int32 differential)
+{
+	static const uint32 lumaCodes[9][2] = {{4, 3}, {0, 2}, {1, 2}, {5, 3}, {6, 3}, {0xE, 4}, {0x1E, 5}, {0x3E, 6}, {0x7E, 7}};
+	static const uint32 chromaCodes[9][2] = {{0, 2}, {1, 2}, {2, 2}, {6, 3}, {0xE, 4}, {0x1E, 5}, {0x3E, 6}, {0x7E, 7}, {0xFE, 8}};
+	unsigned int size = 0;
+	while((1 << size) <= std::abs(differential)) size++;
+	const auto& code = isChroma ? chromaCodes[size] : lumaCodes[size];
+	writer.Write(code[0], code[1]);
+	if(size != 0)
+	{
+		writer.Write((differential > 0) ? differential : (differential + (1 << size) - 1), size);
+	}
+}
+
+static void WriteEscape(CBitWriter& writer, unsigned int run, int32 level)
+{
+	writer.Write(1, 6);
+	writer.Write(run, 6);
+	writer.Write(level & 0xFFF, 12);
+}
+
+static void WriteEndOfBlock(CBitWriter& writer)
+{
+	writer.Write(2, 2);
+}
+
+static void WriteIntraBlocks(CBitWriter& writer, unsigned int mb, int32 (&dcPredictors)[3])
+{
+	for(unsigned int block = 0; block < 6; block++)
+	{
+		unsigned int component = (block < 4) ? 0 : (block - 3);
+		int32 level = (block < 4) ? GetLumaLevel(mb, block) : GetChromaLevel(mb, block - 4);
+		WriteDcDifferential(writer, component != 0, level - dcPredictors[component]);
+		dcPredictors[component] = level;
+		if((mb == 4) && (block == 1))
+		{
+			WriteEscape(writer, 2, -7);
+		}
+		WriteEndOfBlock(writer);
+	}
+}
+
+static void WriteIntraPicture(CBitWriter& writer, unsigned int temporalReference)
+{
+	static const unsigned int quantiserScaleCodes[MB_HEIGHT] = {4, 10};
+	WritePictureHeader(writer, CDecoder::PICTURE_TYPE_I, temporalReference);
+	for(unsigned int row = 0; row < MB_HEIGHT; row++)
+	{
+		WriteSliceHeader(writer, row, quantiserScaleCodes[row]);
+		int32 dcPredictors[3] = {128, 128, 128};
+		for(unsigned int column = 0; column < MB_WIDTH; column++)
+		{
+			WriteAddressIncrement(writer, 1);
+			//Intra
+			writer.Write(1, 1);
+			WriteIntraBlocks(writer, (row * MB_WIDTH) + column, dcPredictors);
+		}
+	}
+}
+
+static void WritePredictedPicture(CBitWriter& writer, unsigned int temporalReference)
+{
+	WritePictureHeader(writer, CDecoder::PICTURE_TYPE_P, temporalReference);
+
+	WriteSliceHeader(writer, 0, 8);
+	//MB 0: motion compensated, not coded, vector (3, -1)
+	WriteAddressIncrement(writer, 1);
+	writer.Write(1, 3);
+	WriteMotionCode(writer, 3);
+	WriteMotionCode(writer, -1);
+	//MB 1: skipped, MB 2: motion compensated, coded, vector (-2, 0)
+	WriteAddressIncrement(writer, 2);
+	writer.Write(1, 1);
+	WriteMotionCode(writer, -2);
+	WriteMotionCode(writer, 0);
+	writer.Write(0xA, 4);
+	writer.Write(2, 2);
+	WriteEndOfBlock(writer);
+
+	WriteSliceHeader(writer, 1, 8);
+	//MB 3: coded without motion compensation
+	WriteAddressIncrement(writer, 1);
+	writer.Write(1, 2);
+	writer.Write(0xA, 4);
+	WriteEscape(writer, 0, 5);
+	WriteEndOfBlock(writer);
+	//MB 4: intra
+	WriteAddressIncrement(writer, 1);
+	writer.Write(3, 5);
+	int32 dcPredictors[3] = {128, 128, 128};
+	WriteIntraBlocks(writer, 4, dcPredictors);
+	//MB 5: motion compensated, not coded, vector (1, 2)
+	WriteAddressIncrement(writer, 1);
+	writer.Write(1, 3);
+	WriteMotionCode(writer, 1);
+	WriteMotionCode(writer, 2);
+}
+
+static void WriteBidirectionalPicture(CBitWriter& writer, unsigned int temporalReference)
+{
+	WritePictureHeader(writer, CDecoder::PICTURE_TYPE_B, temporalReference);
+
+	WriteSliceHeader(writer, 0, 8);
+	//MB 0: interpolated, forward (1, 0), backward (-1, 1)
+	WriteAddressIncrement(writer, 1);
+	writer.Write(2, 2);
+	WriteMotionCode(writer, 1);
+	WriteMotionCode(writer, 0);
+	WriteMotionCode(writer, -1);
+	WriteMotionCode(writer, 1);
+	//MB 1: skipped, MB 2: forward (0, 2)
+	WriteAddressIncrement(writer, 2);
+	writer.Write(2, 4);
+	WriteMotionCode(writer, -1);
+	WriteMotionCode(writer, 2);
+
+	WriteSliceHeader(writer, 1, 8);
+	//MB 3: backward (-3, 2)
+	WriteAddressIncrement(writer, 1);
+	writer.Write(2, 3);
+	WriteMotionCode(writer, -3);
+	WriteMotionCode(writer, 2);
+	//MB 4: skipped, MB 5: interpolated and coded, forward (2, -2), backward (-3, 2)
+	WriteAddressIncrement(writer, 2);
+	writer.Write(3, 2);
+	WriteMotionCode(writer, 2);
+	WriteMotionCode(writer, -2);
+	WriteMotionCode(writer, 0);
+	WriteMotionCode(writer, 0);
+	writer.Write(0xD, 4);
+	writer.Write(3, 2);
+	WriteEndOfBlock(writer);
+}
+
+static std::vector<uint8> BuildStream()
+{
+	CBitWriter writer;
+	WriteSequenceHeader(writer);
+	WriteIntraPicture(writer, 0);
+	WritePredictedPicture(writer, 2);
+	WriteBidirectionalPicture(writer, 1);
+	return writer.GetData();
+}
+
+static CDecoder::FrameHandler MakeFrameHandler(FrameArray& frames)
+{
+	return [&frames](const CDecoder::FRAME& frame) {
+		TEST_VERIFY(frame.width == WIDTH);
+		TEST_VERIFY(frame.height == HEIGHT);
+		DECODED_FRAME decodedFrame;
+		decodedFrame.type = frame.pictureType;
+		decodedFrame.temporalReference = frame.temporalReference;
+		for(unsigned int plane = 0; plane < 3; plane++)
+		{
+			for(unsigned int y = 0; y < decodedFrame.heights[plane]; y++)
+			{
+				const uint8* line = frame.planes[plane] + (y * frame.strides[plane]);
+				decodedFrame.planes[plane].insert(decodedFrame.planes[plane].end(), line, line + decodedFrame.widths[plane]);
+			}
+		}
+		frames.push_back(std::move(decodedFrame));
+	};
+}
+
+static uint8 GetSample(const DECODED_FRAME& frame, unsigned int plane, int32 x, int32 y)
+{
+	x = std::min(std::max(x, 0), static_cast<int32>(frame.widths[plane]) - 1);
+	y = std::min(std::max(y, 0), static_cast<int32>(frame.heights[plane]) - 1);
+	return frame.planes[plane][(y * frame.widths[plane]) + x];
+}
+
+//Position in half samples
+static uint8 GetHalfSample(const DECODED_FRAME& frame, unsigned int plane, int32 x2, int32 y2)
+{
+	int32 x = x2 >> 1;
+	int32 y = y2 >> 1;
+	int32 a = GetSample(frame, plane, x, y);
+	int32 b = GetSample(frame, plane, x + 1, y);
+	int32 c = GetSample(frame, plane, x, y + 1);
+	int32 d = GetSample(frame, plane, x + 1, y + 1);
+	if((x2 & 1) && (y2 & 1)) return static_cast<uint8>((a + b + c + d + 2) >> 2);
+	if(x2 & 1) return static_cast<uint8>((a + b + 1) >> 1);
+	if(y2 & 1) return static_cast<uint8>((a + c + 1) >> 1);
+	return static_cast<uint8>(a);
+}
+
+static unsigned int GetBlockIndex(unsigned int plane, unsigned int x, unsigned int y)
+{
+	return (plane == 0) ? (((y / 8) * 2) + (x / 8)) : (plane + 3);
+}
+
+static void VerifyIntraMacroblock(const DECODED_FRAME& frame, unsigned int mb, unsigned int quantiserScale)
+{
+	int16 blocks[6][64];
+	for(unsigned int block = 0; block < 6; block++)
+	{
+		GetExpectedIntraBlock(mb, block, quantiserScale, blocks[block]);
+	}
+	for(unsigned int plane = 0; plane < 3; plane++)
+	{
+		unsigned int size = (plane == 0) ? 16 : 8;
+		for(unsigned int y = 0; y < size; y++)
+		{
+			for(unsigned int x = 0; x < size; x++)
+			{
+				uint8 expected = ClampSample(blocks[GetBlockIndex(plane, x, y)][((y % 8) * 8) + (x % 8)]);
+				TEST_VERIFY(GetSample(frame, plane, ((mb % MB_WIDTH) * size) + x, ((mb / MB_WIDTH) * size) + y) == expected);
+			}
+		}
+	}
+}
+
+static void VerifyPredictedMacroblock(const DECODED_FRAME& frame, unsigned int mb, std::initializer_list<PREDICTION> predictions,
+                                      unsigned int residualBlock = ~0U, const int16* residual = nullptr)
+{
+	for(unsigned int plane = 0; plane < 3; plane++)
+	{
+		unsigned int size = (plane == 0) ? 16 : 8;
+		for(unsigned int y = 0; y < size; y++)
+		{
+			for(unsigned int x = 0; x < size; x++)
+			{
+				int32 positionX = ((mb % MB_WIDTH) * size) + x;
+				int32 positionY = ((mb / MB_WIDTH) * size) + y;
+				int32 samples[2] = {};
+				unsigned int sampleCount = 0;
+				for(const auto& prediction : predictions)
+				{
+					//Chroma vectors are halved, rounding towards zero
+					int32 vectorX = (plane == 0) ? prediction.vectorX : (prediction.vectorX / 2);
+					int32 vectorY = (plane == 0) ? prediction.vectorY : (prediction.vectorY / 2);
+					samples[sampleCount++] = GetHalfSample(*prediction.reference, plane, (positionX * 2) + vectorX, (positionY * 2) + vectorY);
+				}
+				int32 expected = (sampleCount == 2) ? ((samples[0] + samples[1] + 1) >> 1) : samples[0];
+				if(GetBlockIndex(plane, x, y) == residualBlock)
+				{
+					expected = ClampSample(expected + residual[((y % 8) * 8) + (x % 8)]);
+				}
+				TEST_VERIFY(GetSample(frame, plane, positionX, positionY) == expected);
+			}
+		}
+	}
+}
+
+static FrameArray DecodeStream(const std::vector<uint8>& stream, size_t chunkSize, Framework::CThreadPool* threadPool)
+{
+	FrameArray frames;
+	CDecoder decoder(MakeFrameHandler(frames), threadPool);
+	for(size_t offset = 0; offset < stream.size(); offset += chunkSize)
+	{
+		decoder.Decode(stream.data() + offset, std::min(chunkSize, stream.size() - offset));
+	}
+	decoder.Flush();
+	TEST_VERIFY(decoder.GetCorruptSliceCount() == 0);
+	return frames;
+}
+
+static void IntraTest()
+{
+	CBitWriter writer;
+	WriteSequenceHeader(writer);
+	WriteIntraPicture(writer, 0);
+	auto frames = DecodeStream(writer.GetData(), writer.GetData().size(), nullptr);
+
+	TEST_VERIFY(frames.size() == 1);
+	TEST_VERIFY(frames[0].type == CDecoder::PICTURE_TYPE_I);
+	for(unsigned int mb = 0; mb < (MB_WIDTH * MB_HEIGHT); mb++)
+	{
+		VerifyIntraMacroblock(frames[0], mb, (mb < MB_WIDTH) ? 8 : 20);
+	}
+}
+
+static void MotionTest()
+{
+	auto stream = BuildStream();
+	auto frames = DecodeStream(stream, stream.size(), nullptr);
+
+	//Display order
+	TEST_VERIFY(frames.size() == 3);
+	TEST_VERIFY(frames[0].type == CDecoder::PICTURE_TYPE_I);
+	TEST_VERIFY(frames[1].type == CDecoder::PICTURE_TYPE_B);
+	TEST_VERIFY(frames[2].type == CDecoder::PICTURE_TYPE_P);
+	for(unsigned int i = 0; i < 3; i++)
+	{
+		TEST_VERIFY(frames[i].temporalReference == i);
+	}
+
+	const auto& intraFrame = frames[0];
+	const auto& bidirectionalFrame = frames[1];
+	const auto& predictedFrame = frames[2];
+
+	int16 residual[64];
+	VerifyPredictedMacroblock(predictedFrame, 0, {{&intraFrame, 3, -1}});
+	VerifyPredictedMacroblock(predictedFrame, 1, {{&intraFrame, 0, 0}});
+	GetExpectedResidual(1, 16, residual);
+	VerifyPredictedMacroblock(predictedFrame, 2, {{&intraFrame, -2, 0}}, 0, residual);
+	GetExpectedResidual(5, 16, residual);
+	VerifyPredictedMacroblock(predictedFrame, 3, {{&intraFrame, 0, 0}}, 0, residual);
+	VerifyIntraMacroblock(predictedFrame, 4, 16);
+	VerifyPredictedMacroblock(predictedFrame, 5, {{&intraFrame, 1, 2}});
+
+	VerifyPredictedMacroblock(bidirectionalFrame, 0, {{&intraFrame, 1, 0}, {&predictedFrame, -1, 1}});
+	VerifyPredictedMacroblock(bidirectionalFrame, 1, {{&intraFrame, 1, 0}, {&predictedFrame, -1, 1}});
+	VerifyPredictedMacroblock(bidirectionalFrame, 2, {{&intraFrame, 0, 2}});
+	VerifyPredictedMacroblock(bidirectionalFrame, 3, {{&predictedFrame, -3, 2}});
+	VerifyPredictedMacroblock(bidirectionalFrame, 4, {{&predictedFrame, -3, 2}});
+	GetExpectedResidual(-1, 16, residual);
+	VerifyPredictedMacroblock(bidirectionalFrame, 5, {{&intraFrame, 2, -2}, {&predictedFrame, -3, 2}}, 3, residual);
+}
+
+static void StreamingTest()
+{
+	auto stream = BuildStream();
+	auto referenceFrames = DecodeStream(stream, stream.size(), nullptr);
+
+	//Start codes split across chunks and slices decoded on several threads give the same pictures
+	Framework::CThreadPool threadPool(4);
+	for(size_t chunkSize : {size_t(1), size_t(3), size_t(7), size_t(64)})
+	{
+		auto frames = DecodeStream(stream, chunkSize, &threadPool);
+		TEST_VERIFY(frames == referenceFrames);
+	}
+}
+
+static void ErrorTest()
+{
+	//Invalid macroblock type in the first slice, the second one is still decoded
+	{
+		CBitWriter writer;
+		WriteSequenceHeader(writer);
+		WritePictureHeader(writer, CDecoder::PICTURE_TYPE_I, 0);
+		WriteSliceHeader(writer, 0, 4);
+		WriteAddressIncrement(writer, 1);
+		writer.Write(0, 8);
+		WriteSliceHeader(writer, 1, 10);
+		int32 dcPredictors[3] = {128, 128, 128};
+		for(unsigned int column = 0; column < MB_WIDTH; column++)
+		{
+			WriteAddressIncrement(writer, 1);
+			writer.Write(1, 1);
+			WriteIntraBlocks(writer, MB_WIDTH + column, dcPredictors);
+		}
+
+		FrameArray frames;
+		CDecoder decoder(MakeFrameHandler(frames));
+		decoder.Decode(writer.GetData().data(), writer.GetData().size());
+		decoder.Flush();
+		TEST_VERIFY(decoder.GetCorruptSliceCount() == 1);
+		TEST_VERIFY(frames.size() == 1);
+		for(unsigned int column = 0; column < MB_WIDTH; column++)
+		{
+			VerifyIntraMacroblock(frames[0], MB_WIDTH + column, 20);
+		}
+	}
+
+	//Field pictures aren't supported
+	{
+		CBitWriter writer;
+		WriteSequenceHeader(writer);
+		WritePictureHeader(writer, CDecoder::PICTURE_TYPE_I, 0, PICTURE_STRUCTURE_TOP_FIELD);
+		WriteSliceHeader(writer, 0, 4);
+
+		FrameArray frames;
+		CDecoder decoder(MakeFrameHandler(frames));
+		bool failed = false;
+		try
+		{
+			decoder.Decode(writer.GetData().data(), writer.GetData().size());
+			decoder.Flush();
+		}
+		catch(const std::runtime_error&)
+		{
+			failed = true;
+		}
+		TEST_VERIFY(failed);
+		TEST_VERIFY(frames.empty());
+	}
+}
+
+static void MotionCompensationTest()
+{
+	//Kernels against a plain implementation, samples near 0 and 255 check rounding and saturation
+	uint32 seed = 1;
+	auto random = [&seed]() {
+		seed = (seed * 1103515245) + 12345;
+		return (seed >> 16) & 0x7FFF;
+	};
+	uint8 source[17 * 24];
+	for(auto& sample : source)
+	{
+		uint32 value = random();
+		sample = static_cast<uint8>((value & 0x100) ? ((value & 1) ? 255 : 0) : value);
+	}
+
+	for(unsigned int width : {8U, 16U})
+	{
+		for(unsigned int height : {8U, 16U})
+		{
+			for(unsigned int halfSample = 0; halfSample < 4; halfSample++)
+			{
+				uint8 output[16 * 16];
+				MotionCompensation::Predict(output, 16, source, 24, width, height, halfSample);
+				for(unsigned int y = 0; y < height; y++)
+				{
+					for(unsigned int x = 0; x < width; x++)
+					{
+						const uint8* line0 = source + (y * 24) + x;
+						const uint8* line1 = line0 + 24;
+						uint32 expected = line0[0];
+						switch(halfSample)
+						{
+						case MotionCompensation::HALF_SAMPLE_X:
+							expected = (line0[0] + line0[1] + 1) >> 1;
+							break;
+						case MotionCompensation::HALF_SAMPLE_Y:
+							expected = (line0[0] + line1[0] + 1) >> 1;
+							break;
+						case MotionCompensation::HALF_SAMPLE_XY:
+							expected = (line0[0] + line0[1] + line1[0] + line1[1] + 2) >> 2;
+							break;
+						}
+						TEST_VERIFY(output[(y * 16) + x] == expected);
+					}
+				}
+
+				uint8 averaged[16 * 16];
+				std::copy(std::begin(output), std::end(output), std::begin(averaged));
+				MotionCompensation::Average(averaged, 16, source + 1, 24, width, height);
+				for(unsigned int y = 0; y < height; y++)
+				{
+					for(unsigned int x = 0; x < width; x++)
+					{
+						TEST_VERIFY(averaged[(y * 16) + x] == ((output[(y * 16) + x] + source[(y * 24) + x + 1] + 1) >> 1));
+					}
+				}
+			}
+		}
+	}
+
+	int16 residual[64];
+	for(auto& value : residual)
+	{
+		value = static_cast<int16>(static_cast<int32>(random() % 1024) - 512);
+	}
+	residual[0] = INT16_MAX;
+	residual[1] = INT16_MIN;
+	uint8 output[8 * 12];
+	MotionCompensation::AddResidual(output, 12, source, 24, residual);
+	for(unsigned int i = 0; i < 64; i++)
+	{
+		unsigned int x = i % 8;
+		unsigned int y = i / 8;
+		TEST_VERIFY(output[(y * 12) + x] == ClampSample(source[(y * 24) + x] + residual[i]));
+	}
+	MotionCompensation::StoreSamples(output, 12, residual);
+	for(unsigned int i = 0; i < 64; i++)
+	{
+		TEST_VERIFY(output[((i / 8) * 12) + (i % 8)] == ClampSample(residual[i]));
+	}
+}
+
+void Mpeg2DecoderTest_Execute()
+{
+	MotionCompensationTest();
+	IntraTest();
+	MotionTest();
+	StreamingTest();
+	ErrorTest();
+}
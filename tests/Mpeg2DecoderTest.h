@@ -0,0 +1,3 @@
+#pragma once
+
+void Mpeg2DecoderTest_Execute();
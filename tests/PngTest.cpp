@@ -0,0 +1,234 @@
+#include "PngTest.h"
+#include "TestDefs.h"
+#include <cstring>
+#include <vector>
+#include "PtrStream.h"
+#include "MemStream.h"
+#include "StdStream.h"
+#include "MappedFileStream.h"
+#include "ThreadPool.h"
+#include "bitmap/PNG.h"
+
+//19x10 RGB, each scanline uses a different filter type
+static const uint8 g_rgbImage[] =
+{
+	0x89, 0x50, 0x4E, 0x47, 0x0D, 0x0A, 0x1A, 0x0A, 0x00, 0x00, 0x00, 0x0D, 0x49, 0x48, 0x44, 0x52,
+	0x00, 0x00, 0x00, 0x13, 0x00, 0x00, 0x00, 0x0A, 0x08, 0x02, 0x00, 0x00, 0x00, 0xD9, 0xEB, 0xF2,
+	0xC8, 0x00, 0x00, 0x01, 0x1C, 0x49, 0x44, 0x41, 0x54, 0x78, 0xDA, 0x63, 0x60, 0x70, 0xEF, 0x93,
+	0x4F, 0x5B, 0x6B, 0xD7, 0x7A, 0x26, 0x76, 0xC9, 0xEB, 0x9A, 0xC3, 0x5C, 0xB3, 0x1F, 0x69, 0xEE,
+	0x62, 0xF4, 0xB8, 0xA9, 0x90, 0xFE, 0xC3, 0xBE, 0x4D, 0x3C, 0x6E, 0xA9, 0x59, 0xED, 0x91, 0xD0,
+	0x39, 0x8F, 0x4B, 0x76, 0x33, 0x4D, 0xBE, 0xA5, 0xB8, 0xE9, 0xA7, 0xC3, 0x45, 0x89, 0xF8, 0x0F,
+	0xE6, 0x75, 0xFC, 0x61, 0x73, 0xF5, 0x4A, 0xF7, 0x30, 0x0A, 0x46, 0xCC, 0x57, 0x20, 0x0B, 0x30,
+	0x09, 0x0A, 0x0A, 0x0A, 0x09, 0x09, 0x09, 0x0B, 0x0B, 0x8B, 0x88, 0x88, 0x88, 0x8A, 0x8A, 0x8A,
+	0x89, 0x89, 0x89, 0x8B, 0x8B, 0x4B, 0x48, 0x48, 0x48, 0x4A, 0x4A, 0x4A, 0x49, 0x49, 0x49, 0x4B,
+	0x4B, 0xCB, 0xC8, 0xC8, 0xC8, 0xCA, 0xCA, 0xCA, 0xC9, 0xC9, 0xC9, 0xCB, 0xCB, 0x03, 0x35, 0x28,
+	0x2A, 0x2A, 0x2A, 0x29, 0x29, 0x29, 0x2B, 0x2B, 0x33, 0x2B, 0xB9, 0x65, 0x42, 0x54, 0x40, 0x14,
+	0x41, 0xD4, 0xCD, 0x05, 0x2B, 0x85, 0xA8, 0x86, 0x68, 0x80, 0xE8, 0x81, 0x68, 0x83, 0xE8, 0x64,
+	0xC1, 0x6A, 0xA7, 0x32, 0xC2, 0x4E, 0x65, 0x90, 0x59, 0xCA, 0x20, 0x83, 0x94, 0x11, 0x76, 0x02,
+	0x35, 0x2A, 0x33, 0x00, 0x03, 0xA0, 0xF2, 0x00, 0xFB, 0xDC, 0x27, 0xDA, 0x07, 0x39, 0xFC, 0x9F,
+	0xEA, 0x14, 0x73, 0x06, 0x4C, 0xD7, 0x2D, 0xD9, 0x1D, 0x38, 0xE3, 0x7E, 0xE9, 0x1E, 0xE6, 0x99,
+	0x0F, 0xD4, 0xF7, 0xB2, 0x78, 0x3F, 0xD4, 0xC8, 0x67, 0xF5, 0x99, 0xAC, 0x59, 0xB0, 0xDD, 0x77,
+	0xCA, 0xED, 0xC2, 0x1D, 0xFF, 0xA7, 0xDE, 0x51, 0xDE, 0xC9, 0xE0, 0x7E, 0x57, 0x25, 0x9B, 0x31,
+	0x6D, 0xED, 0x17, 0x55, 0xB2, 0x00, 0x05, 0x21, 0xE4, 0x5B, 0x20, 0x22, 0x0B, 0x0E, 0x13, 0xA0,
+	0xDC, 0x3C, 0xBC, 0x41, 0x02, 0x04, 0x2A, 0x60, 0x00, 0xB1, 0x13, 0x16, 0x42, 0x1A, 0x20, 0x3B,
+	0x35, 0x30, 0xEC, 0xD4, 0x40, 0xD8, 0xA9, 0x01, 0x32, 0x51, 0x03, 0x64, 0x9C, 0x06, 0xD8, 0x20,
+	0x00, 0xCF, 0x01, 0x6F, 0x9A, 0xDD, 0xE6, 0x6C, 0xB9, 0x00, 0x00, 0x00, 0x00, 0x49, 0x45, 0x4E,
+	0x44, 0xAE, 0x42, 0x60, 0x82,
+};
+
+//13x10 RGBA, image data split in several IDAT chunks
+static const uint8 g_rgbaImage[] =
+{
+	0x89, 0x50, 0x4E, 0x47, 0x0D, 0x0A, 0x1A, 0x0A, 0x00, 0x00, 0x00, 0x0D, 0x49, 0x48, 0x44, 0x52,
+	0x00, 0x00, 0x00, 0x0D, 0x00, 0x00, 0x00, 0x0A, 0x08, 0x06, 0x00, 0x00, 0x00, 0x6F, 0xEE, 0xD4,
+	0xC4, 0x00, 0x00, 0x00, 0x3D, 0x49, 0x44, 0x41, 0x54, 0x78, 0xDA, 0x63, 0x60, 0x70, 0xEF, 0xBB,
+	0x2A, 0x9F, 0xB6, 0xF6, 0x8B, 0x5D, 0xEB, 0x19, 0xE1, 0xD8, 0x25, 0xAF, 0x8D, 0x6A, 0x0E, 0x73,
+	0x05, 0xCE, 0x7E, 0xA4, 0x59, 0xB0, 0x8B, 0xD1, 0xA3, 0xFF, 0xA6, 0x42, 0xFA, 0xBA, 0x1F, 0xF6,
+	0x6D, 0x67, 0xC5, 0xE3, 0x96, 0xBE, 0x31, 0xAB, 0x3D, 0xC2, 0x1D, 0x3A, 0xE7, 0xB1, 0x56, 0xC9,
+	0x6E, 0x26, 0x4F, 0x46, 0xC1, 0x88, 0x52, 0x44, 0x30, 0xD7, 0x00, 0x00, 0x00, 0x3D, 0x49, 0x44,
+	0x41, 0x54, 0xF9, 0xCF, 0x14, 0x48, 0x04, 0x4C, 0x82, 0x40, 0x20, 0x04, 0x04, 0xC2, 0x40, 0x20,
+	0x02, 0x04, 0xA2, 0x40, 0x20, 0x06, 0x04, 0xE2, 0x40, 0x20, 0x01, 0x04, 0x92, 0x40, 0x20, 0x05,
+	0x04, 0xD2, 0x40, 0x20, 0x03, 0x04, 0xB2, 0x40, 0xC0, 0xAC, 0xE4, 0x96, 0xD9, 0x0B, 0x13, 0x84,
+	0x49, 0xC0, 0x24, 0xE7, 0x02, 0xB1, 0x1C, 0x14, 0xC8, 0x43, 0x01, 0xC8, 0x26, 0x16, 0x7C, 0xE1,
+	0x1B, 0x83, 0x45, 0x00, 0x00, 0x00, 0x3D, 0x49, 0x44, 0x41, 0x54, 0x36, 0x29, 0x43, 0x6C, 0x52,
+	0x86, 0x18, 0xAA, 0x0C, 0xB1, 0x49, 0x59, 0x56, 0x96, 0x01, 0xE4, 0xB9, 0xCA, 0x03, 0xEC, 0x7E,
+	0x73, 0x9F, 0x68, 0x17, 0x1D, 0xE4, 0xF0, 0x9F, 0xF6, 0x54, 0xA7, 0x78, 0x17, 0x67, 0xC0, 0xF4,
+	0x7B, 0xBA, 0x40, 0x1F, 0x07, 0xCE, 0xB8, 0xAF, 0x56, 0xBA, 0x87, 0xD9, 0x6B, 0xE6, 0x03, 0xF5,
+	0xBC, 0xBD, 0x2C, 0xDE, 0x93, 0x1E, 0x6A, 0xE4, 0xE5, 0xE5, 0x6D, 0xCA, 0x00, 0x00, 0x00, 0x3B,
+	0x49, 0x44, 0x41, 0x54, 0x6F, 0x63, 0xF5, 0x99, 0x7C, 0x8B, 0x11, 0x18, 0x70, 0xD6, 0xAA, 0x24,
+	0x02, 0xF2, 0x02, 0xC2, 0xB7, 0x40, 0xC4, 0x5C, 0x16, 0xEA, 0x6B, 0x90, 0x87, 0xE7, 0x41, 0x3C,
+	0x3D, 0x1F, 0xE6, 0x69, 0x10, 0x50, 0x84, 0x02, 0x25, 0x28, 0x40, 0x04, 0x84, 0x06, 0xC4, 0x26,
+	0x0D, 0x88, 0x4D, 0x1A, 0xE8, 0x36, 0x69, 0x20, 0xD9, 0x04, 0x00, 0x47, 0x8D, 0x64, 0x3D, 0x3A,
+	0x96, 0x49, 0xE4, 0x00, 0x00, 0x00, 0x00, 0x49, 0x45, 0x4E, 0x44, 0xAE, 0x42, 0x60, 0x82,
+};
+
+//11x6 palette image
+static const uint8 g_paletteImage[] =
+{
+	0x89, 0x50, 0x4E, 0x47, 0x0D, 0x0A, 0x1A, 0x0A, 0x00, 0x00, 0x00, 0x0D, 0x49, 0x48, 0x44, 0x52,
+	0x00, 0x00, 0x00, 0x0B, 0x00, 0x00, 0x00, 0x06, 0x08, 0x03, 0x00, 0x00, 0x00, 0x22, 0xEC, 0x94,
+	0xCA, 0x00, 0x00, 0x00, 0xC0, 0x50, 0x4C, 0x54, 0x45, 0x00, 0xFF, 0x00, 0x04, 0xFB, 0x0C, 0x08,
+	0xF7, 0x18, 0x0C, 0xF3, 0x24, 0x10, 0xEF, 0x30, 0x14, 0xEB, 0x3C, 0x18, 0xE7, 0x48, 0x1C, 0xE3,
+	0x54, 0x20, 0xDF, 0x60, 0x24, 0xDB, 0x6C, 0x28, 0xD7, 0x78, 0x2C, 0xD3, 0x84, 0x30, 0xCF, 0x90,
+	0x34, 0xCB, 0x9C, 0x38, 0xC7, 0xA8, 0x3C, 0xC3, 0xB4, 0x40, 0xBF, 0xC0, 0x44, 0xBB, 0xCC, 0x48,
+	0xB7, 0xD8, 0x4C, 0xB3, 0xE4, 0x50, 0xAF, 0xF0, 0x54, 0xAB, 0xFC, 0x58, 0xA7, 0x08, 0x5C, 0xA3,
+	0x14, 0x60, 0x9F, 0x20, 0x64, 0x9B, 0x2C, 0x68, 0x97, 0x38, 0x6C, 0x93, 0x44, 0x70, 0x8F, 0x50,
+	0x74, 0x8B, 0x5C, 0x78, 0x87, 0x68, 0x7C, 0x83, 0x74, 0x80, 0x7F, 0x80, 0x84, 0x7B, 0x8C, 0x88,
+	0x77, 0x98, 0x8C, 0x73, 0xA4, 0x90, 0x6F, 0xB0, 0x94, 0x6B, 0xBC, 0x98, 0x67, 0xC8, 0x9C, 0x63,
+	0xD4, 0xA0, 0x5F, 0xE0, 0xA4, 0x5B, 0xEC, 0xA8, 0x57, 0xF8, 0xAC, 0x53, 0x04, 0xB0, 0x4F, 0x10,
+	0xB4, 0x4B, 0x1C, 0xB8, 0x47, 0x28, 0xBC, 0x43, 0x34, 0xC0, 0x3F, 0x40, 0xC4, 0x3B, 0x4C, 0xC8,
+	0x37, 0x58, 0xCC, 0x33, 0x64, 0xD0, 0x2F, 0x70, 0xD4, 0x2B, 0x7C, 0xD8, 0x27, 0x88, 0xDC, 0x23,
+	0x94, 0xE0, 0x1F, 0xA0, 0xE4, 0x1B, 0xAC, 0xE8, 0x17, 0xB8, 0xEC, 0x13, 0xC4, 0xF0, 0x0F, 0xD0,
+	0xF4, 0x0B, 0xDC, 0xF8, 0x07, 0xE8, 0xFC, 0x03, 0xF4, 0xA8, 0x04, 0x81, 0x4F, 0x00, 0x00, 0x00,
+	0x26, 0x49, 0x44, 0x41, 0x54, 0x78, 0xDA, 0x63, 0x60, 0x90, 0xB7, 0x93, 0xB5, 0x91, 0xB6, 0x92,
+	0xB4, 0x10, 0x37, 0x63, 0x14, 0x54, 0x78, 0x00, 0x83, 0x4C, 0x82, 0x97, 0x84, 0xAF, 0x88, 0x5E,
+	0x13, 0xBF, 0x21, 0x79, 0x4B, 0x9A, 0x59, 0xE9, 0x97, 0xF4, 0x6F, 0x11, 0x6F, 0x0C, 0xAA, 0x00,
+	0x00, 0x00, 0x25, 0x49, 0x44, 0x41, 0x54, 0x99, 0x3F, 0xB2, 0x7F, 0xEF, 0xC9, 0xDD, 0x67, 0xB9,
+	0xA8, 0x7C, 0x59, 0xF9, 0xAA, 0xF2, 0x75, 0xE5, 0xDF, 0x52, 0x7F, 0x19, 0x44, 0x2D, 0x65, 0x19,
+	0x55, 0x39, 0x75, 0x05, 0x4D, 0x25, 0x6D, 0x01, 0x6A, 0xE5, 0x19, 0x07, 0x05, 0x5C, 0x0D, 0x76,
+	0x00, 0x00, 0x00, 0x00, 0x49, 0x45, 0x4E, 0x44, 0xAE, 0x42, 0x60, 0x82,
+};
+
+static uint8 GetSample(unsigned int x, unsigned int y, unsigned int channel)
+{
+	return static_cast<uint8>((x * 31) + (y * 17) + (channel * 71) + (x * y));
+}
+
+static Framework::CBitmap DecodeImage(const uint8* data, size_t size)
+{
+	Framework::CPtrStream stream(data, size);
+	return Framework::CPNG::ReadBitmap(stream);
+}
+
+//Rows are padded like they would be in a locked texture
+class CPaddedBitmapSink : public Framework::CBitmapSink
+{
+public:
+	Framework::CBitmapView BeginImage(unsigned int width, unsigned int height, unsigned int bpp) override
+	{
+		m_pitch = (((width * bpp) + 7) / 8) + 13;
+		m_pixels.assign(m_pitch * height, 0xCD);
+		m_view = Framework::CBitmapView(m_pixels.data(), width, height, bpp, m_pitch);
+		return m_view;
+	}
+
+	void EndImage() override
+	{
+		m_ended = true;
+	}
+
+	bool Matches(const Framework::CBitmap& bitmap) const
+	{
+		if(!m_ended) return false;
+		if(m_view.GetWidth() != bitmap.GetWidth()) return false;
+		if(m_view.GetHeight() != bitmap.GetHeight()) return false;
+		for(unsigned int y = 0; y < bitmap.GetHeight(); y++)
+		{
+			if(memcmp(m_view.GetRow(y), bitmap.GetPixels() + (y * bitmap.GetPitch()), bitmap.GetPitch())) return false;
+		}
+		return true;
+	}
+
+private:
+	std::vector<uint8> m_pixels;
+	Framework::CBitmapView m_view;
+	unsigned int m_pitch = 0;
+	bool m_ended = false;
+};
+
+static void CheckImage(const Framework::CBitmap& bitmap, unsigned int width, unsigned int height, unsigned int channels)
+{
+	TEST_VERIFY(bitmap.GetWidth() == width);
+	TEST_VERIFY(bitmap.GetHeight() == height);
+	TEST_VERIFY(bitmap.GetBitsPerPixel() == (channels * 8));
+	const uint8* pixels = bitmap.GetPixels();
+	bool matches = true;
+	for(unsigned int y = 0; y < height; y++)
+	{
+		for(unsigned int x = 0; x < width; x++)
+		{
+			for(unsigned int c = 0; c < channels; c++)
+			{
+				matches &= (pixels[(y * bitmap.GetPitch()) + (x * channels) + c] == GetSample(x, y, c));
+			}
+		}
+	}
+	TEST_VERIFY(matches);
+}
+
+static void CheckRoundTrip(unsigned int width, unsigned int height, unsigned int channels, Framework::CThreadPool& threadPool)
+{
+	Framework::CBitmap bitmap(width, height, channels * 8);
+	for(unsigned int y = 0; y < height; y++)
+	{
+		for(unsigned int x = 0; x < width; x++)
+		{
+			for(unsigned int c = 0; c < channels; c++)
+			{
+				bitmap.GetPixels()[(y * bitmap.GetPitch()) + (x * channels) + c] = GetSample(x, y, c);
+			}
+		}
+	}
+
+	Framework::CMemStream stream;
+	Framework::CPNG::WriteBitmap(bitmap, stream);
+	CheckImage(DecodeImage(stream.GetBuffer(), stream.GetSize()), width, height, channels);
+
+	//Output must not depend on the thread pool
+	Framework::CMemStream poolStream;
+	Framework::CPNG::WriteBitmap(bitmap, poolStream, threadPool);
+	TEST_VERIFY(poolStream.GetSize() == stream.GetSize());
+	TEST_VERIFY(memcmp(poolStream.GetBuffer(), stream.GetBuffer(), stream.GetSize()) == 0);
+}
+
+void PngTest_Execute()
+{
+	CheckImage(DecodeImage(g_rgbImage, sizeof(g_rgbImage)), 19, 10, 3);
+	CheckImage(DecodeImage(g_rgbaImage, sizeof(g_rgbaImage)), 13, 10, 4);
+
+	{
+		auto bitmap = DecodeImage(g_paletteImage, sizeof(g_paletteImage));
+		TEST_VERIFY(bitmap.GetWidth() == 11);
+		TEST_VERIFY(bitmap.GetHeight() == 6);
+		TEST_VERIFY(bitmap.GetBitsPerPixel() == 32);
+		bool matches = true;
+		for(unsigned int y = 0; y < 6; y++)
+		{
+			for(unsigned int x = 0; x < 11; x++)
+			{
+				unsigned int index = GetSample(x, y, 0) & 0x3F;
+				auto color = bitmap.GetPixel(x, y);
+				matches &= (color.r == static_cast<uint8>(index * 4));
+				matches &= (color.g == static_cast<uint8>(255 - (index * 4)));
+				matches &= (color.b == static_cast<uint8>(index * 12));
+			}
+		}
+		TEST_VERIFY(matches);
+	}
+
+	for(const auto& image : { std::make_pair(g_rgbImage, sizeof(g_rgbImage)), std::make_pair(g_paletteImage, sizeof(g_paletteImage)) })
+	{
+		CPaddedBitmapSink sink;
+		Framework::CPtrStream stream(image.first, image.second);
+		Framework::CPNG::ReadBitmap(stream, sink);
+		TEST_VERIFY(sink.Matches(DecodeImage(image.first, image.second)));
+	}
+
+	{
+		//Chunks are inflated straight from the mapping
+		{
+			Framework::CStdStream output("test.png", "wb");
+			output.Write(g_rgbImage, sizeof(g_rgbImage));
+		}
+		Framework::CMappedFileStream stream("test.png");
+		CheckImage(Framework::CPNG::ReadBitmap(stream), 19, 10, 3);
+	}
+
+	{
+		Framework::CThreadPool threadPool(2);
+		CheckRoundTrip(1, 1, 3, threadPool);
+		CheckRoundTrip(37, 29, 1, threadPool);
+		CheckRoundTrip(53, 17, 3, threadPool);
+		CheckRoundTrip(300, 250, 4, threadPool);
+	}
+}
@@ -0,0 +1,3 @@
+#pragma once
+
+void PngTest_Execute();
@@ -0,0 +1,304 @@
+#include "SerializationTest.h"
+#include <cstring>
+#include <stdexcept>
+#include "EndianUtils.h"
+#include "MemStream.h"
+#include "PtrStream.h"
+#include "Serialization.h"
+#include "TestDefs.h"
+
+using namespace Framework;
+using namespace Framework::Serialization;
+
+enum class COLOR : uint16
+{
+	RED = 1,
+	BLUE = 0x0203,
+};
+
+struct RAW_HEADER
+{
+	char signature[4];
+	MSBFU32 length;
+};
+
+namespace Framework
+{
+	namespace Serialization
+	{
+		template <>
+		struct IsRawBytes<RAW_HEADER> : std::true_type
+		{
+		};
+	}
+}
+
+struct POINT
+{
+	int32 x = 0;
+	int32 y = 0;
+
+	template <typename ArchiveType>
+	void Serialize(ArchiveType& archive, uint32)
+	{
+		archive & x & y;
+	}
+
+	bool operator==(const POINT& rhs) const
+	{
+		return (x == rhs.x) && (y == rhs.y);
+	}
+};
+
+struct STATE
+{
+	RAW_HEADER header = {};
+	uint8 flag8 = 0;
+	uint16 value16 = 0;
+	uint32 value32 = 0;
+	uint64 value64 = 0;
+	float valueFloat = 0;
+	double valueDouble = 0;
+	bool enabled = false;
+	COLOR color = COLOR::RED;
+	uint32 registers[5] = {};
+	std::array<uint16, 3> palette = {};
+	std::vector<uint32> memory;
+	std::vector<bool> bits;
+	std::vector<POINT> points;
+	std::pair<std::string, int16> label;
+	POINT origin;
+
+	template <typename ArchiveType>
+	void Serialize(ArchiveType& archive, uint32)
+	{
+		archive & header & flag8 & value16 & value32 & value64 & valueFloat & valueDouble & enabled & color;
+		archive & registers & palette & memory & bits & points & label & origin;
+	}
+};
+
+static STATE MakeState()
+{
+	STATE state;
+	memcpy(state.header.signature, "TEST", 4);
+	state.header.length = 0x11223344;
+	state.flag8 = 0xAB;
+	state.value16 = 0x1234;
+	state.value32 = 0x12345678;
+	state.value64 = 0x0123456789ABCDEFULL;
+	state.valueFloat = 1.5f;
+	state.valueDouble = -2.25;
+	state.enabled = true;
+	state.color = COLOR::BLUE;
+	for(uint32 i = 0; i < 5; i++) state.registers[i] = 0x01020304 * (i + 1);
+	state.palette = {{0xF00, 0x0F0, 0x00F}};
+	//Big enough to go around the archive's buffer
+	state.memory.resize(100003);
+	for(uint32 i = 0; i < state.memory.size(); i++) state.memory[i] = i * 0x9E3779B9;
+	state.bits = {true, false, true, true};
+	state.points = {{1, 2}, {-3, 4}};
+	state.label = std::make_pair(std::string("label"), static_cast<int16>(-5));
+	state.origin = {7, -8};
+	return state;
+}
+
+static void VerifyState(const STATE& state, const STATE& reference)
+{
+	TEST_VERIFY(!memcmp(&state.header, &reference.header, sizeof(RAW_HEADER)));
+	TEST_VERIFY(state.flag8 == reference.flag8);
+	TEST_VERIFY(state.value16 == reference.value16);
+	TEST_VERIFY(state.value32 == reference.value32);
+	TEST_VERIFY(state.value64 == reference.value64);
+	TEST_VERIFY(state.valueFloat == reference.valueFloat);
+	TEST_VERIFY(state.valueDouble == reference.valueDouble);
+	TEST_VERIFY(state.enabled == reference.enabled);
+	TEST_VERIFY(state.color == reference.color);
+	TEST_VERIFY(!memcmp(state.registers, reference.registers, sizeof(state.registers)));
+	TEST_VERIFY(state.palette == reference.palette);
+	TEST_VERIFY(state.memory == reference.memory);
+	TEST_VERIFY(state.bits == reference.bits);
+	TEST_VERIFY(state.points == reference.points);
+	TEST_VERIFY(state.label == reference.label);
+	TEST_VERIFY(state.origin == reference.origin);
+}
+
+static void SwapArrayTest()
+{
+	//Odd sizes exercise both the vector kernels and the scalar tail
+	uint8 input[200];
+	for(unsigned int i = 0; i < sizeof(input); i++) input[i] = static_cast<uint8>(i);
+	for(unsigned int count = 0; count < 25; count++)
+	{
+		uint8 output[200] = {};
+		CEndian::SwapArray64(output, input, count);
+		for(unsigned int i = 0; i < count * 8; i++) TEST_VERIFY(output[i] == input[(i & ~7) + 7 - (i & 7)]);
+		CEndian::SwapArray32(output, input, count * 2);
+		for(unsigned int i = 0; i < count * 8; i++) TEST_VERIFY(output[i] == input[(i & ~3) + 3 - (i & 3)]);
+		CEndian::SwapArray16(output, input, count * 4);
+		for(unsigned int i = 0; i < count * 8; i++) TEST_VERIFY(output[i] == input[(i & ~1) + 1 - (i & 1)]);
+	}
+	//In place
+	uint16 values[33];
+	for(unsigned int i = 0; i < 33; i++) values[i] = static_cast<uint16>(0x0100 * i + i + 1);
+	CEndian::SwapArray16(values, values, 33);
+	for(unsigned int i = 0; i < 33; i++) TEST_VERIFY(values[i] == static_cast<uint16>(((i + 1) << 8) | i));
+}
+
+static void RoundTripTest(ENDIANNESS endianness)
+{
+	auto reference = MakeState();
+	CMemStream stream;
+	{
+		COutputArchive archive(stream, endianness);
+		archive & reference;
+		archive.Flush();
+	}
+	//Trailing data isn't consumed
+	stream.Write32(0xCAFEBABE);
+
+	stream.Seek(0, STREAM_SEEK_SET);
+	STATE state;
+	{
+		CInputArchive archive(stream, endianness);
+		archive & state;
+	}
+	VerifyState(state, reference);
+	TEST_VERIFY(stream.Read32() == 0xCAFEBABE);
+}
+
+static void ByteOrderTest()
+{
+	CMemStream stream;
+	{
+		COutputArchive archive(stream, ENDIANNESS_BIG);
+		archive & static_cast<uint16>(0x1234) & static_cast<uint32>(0x56789ABC);
+		archive & std::string("ab");
+	}
+	static const uint8 expected[] = {0x12, 0x34, 0x56, 0x78, 0x9A, 0xBC, 0, 0, 0, 0, 0, 0, 0, 2, 'a', 'b'};
+	TEST_VERIFY(stream.GetSize() == sizeof(expected));
+	TEST_VERIFY(!memcmp(stream.GetBuffer(), expected, sizeof(expected)));
+}
+
+struct SETTINGS_V1
+{
+	static const uint32 SERIALIZE_VERSION = 1;
+
+	uint32 width = 0;
+
+	template <typename ArchiveType>
+	void Serialize(ArchiveType& archive, uint32)
+	{
+		archive & width;
+	}
+};
+
+struct SETTINGS_V2
+{
+	static const uint32 SERIALIZE_VERSION = 2;
+
+	uint32 width = 0;
+	std::string title = "default";
+
+	template <typename ArchiveType>
+	void Serialize(ArchiveType& archive, uint32 version)
+	{
+		archive & width;
+		if(version >= 2) archive & title;
+	}
+};
+
+static void VersionTest()
+{
+	CMemStream oldStream;
+	{
+		SETTINGS_V1 settings;
+		settings.width = 640;
+		COutputArchive archive(oldStream);
+		archive & settings;
+	}
+
+	//Newer code reads older data
+	{
+		oldStream.Seek(0, STREAM_SEEK_SET);
+		SETTINGS_V2 settings;
+		CInputArchive archive(oldStream);
+		archive & settings;
+		TEST_VERIFY(settings.width == 640);
+		TEST_VERIFY(settings.title == "default");
+	}
+
+	//Older code refuses newer data
+	CMemStream newStream;
+	{
+		SETTINGS_V2 settings;
+		settings.title = "new";
+		COutputArchive archive(newStream);
+		archive & settings;
+	}
+	{
+		newStream.Seek(0, STREAM_SEEK_SET);
+		SETTINGS_V1 settings;
+		CInputArchive archive(newStream);
+		bool failed = false;
+		try
+		{
+			archive & settings;
+		}
+		catch(const std::exception&)
+		{
+			failed = true;
+		}
+		TEST_VERIFY(failed);
+	}
+}
+
+static void TruncatedTest()
+{
+	CMemStream stream;
+	{
+		COutputArchive archive(stream);
+		archive & MakeState();
+	}
+	for(uint64 size : {uint64(0), uint64(20), stream.GetSize() / 2, stream.GetSize() - 1})
+	{
+		CPtrStream inputStream(stream.GetBuffer(), size);
+		CInputArchive archive(inputStream);
+		STATE state;
+		bool failed = false;
+		try
+		{
+			archive & state;
+		}
+		catch(const std::exception&)
+		{
+			failed = true;
+		}
+		TEST_VERIFY(failed);
+	}
+
+	//Huge size is caught by the end of the stream rather than by the allocator
+	uint64 hugeSize = 0x0FFFFFFFFFFFFFFFULL;
+	CPtrStream inputStream(&hugeSize, sizeof(hugeSize));
+	CInputArchive archive(inputStream);
+	std::vector<uint64> values;
+	bool failed = false;
+	try
+	{
+		archive & values;
+	}
+	catch(const std::exception&)
+	{
+		failed = true;
+	}
+	TEST_VERIFY(failed);
+}
+
+void SerializationTest_Execute()
+{
+	SwapArrayTest();
+	RoundTripTest(ENDIANNESS_LITTLE);
+	RoundTripTest(ENDIANNESS_BIG);
+	ByteOrderTest();
+	VersionTest();
+	TruncatedTest();
+}
@@ -1,9 +1,189 @@
 #include "SignalTest.h"
+#include <atomic>
+#include <future>
+#include <string>
+#include <type_traits>
+#include <thread>
 #include "signal/Signal.h"
+#include "TaskQueue.h"
+#include "ThreadPool.h"
 #include "TestDefs.h"
 
+static void SignalTest_Override()
+{
+	int value = 0;
+	Framework::CSignal<void (int)> sig;
+	auto conn = sig.Connect([&] (int input) { value += input; });
+	auto overrideConn = sig.ConnectOverride([&] (int input) { value -= input; });
+	sig(2);
+	TEST_VERIFY(value == -2);
+	overrideConn.reset();
+	sig(3);
+	TEST_VERIFY(value == 1);
+}
+
+static void SignalTest_ReentrantUpdates()
+{
+	//Slots can connect and disconnect while the signal is emitted
+	int value = 0;
+	Framework::CSignal<void ()> sig;
+	Framework::CSignal<void ()>::Connection innerConn;
+	Framework::CSignal<void ()>::Connection selfConn;
+	selfConn = sig.Connect(
+		[&] ()
+		{
+			value++;
+			innerConn = sig.Connect([&] () { value += 10; });
+			selfConn.reset();
+		});
+	sig();
+	TEST_VERIFY(value == 1);
+	sig();
+	TEST_VERIFY(value == 11);
+}
+
+static void SignalTest_ConcurrentEmit()
+{
+	std::atomic<unsigned int> count(0);
+	Framework::CSignal<void ()> sig;
+	auto conn = sig.Connect([&] () { count++; });
+	std::atomic<bool> done(false);
+	std::thread updateThread(
+		[&] ()
+		{
+			for(unsigned int i = 0; i < 1000; i++)
+			{
+				auto tempConn = sig.Connect([] () {});
+				std::this_thread::yield();
+			}
+			done = true;
+		});
+	unsigned int emitCount = 0;
+	while(!done)
+	{
+		sig();
+		emitCount++;
+	}
+	updateThread.join();
+	TEST_VERIFY(count == emitCount);
+}
+
+static void SignalTest_Queued()
+{
+	std::string text;
+	Framework::CTaskQueue taskQueue;
+	Framework::CSignal<void (const std::string&)> sig;
+	auto conn = sig.ConnectQueued([&] (const std::string& input) { text += input; }, taskQueue.GetExecutor());
+	auto coalescedConn = sig.ConnectQueued([&] (const std::string& input) { text += "[" + input + "]"; }, taskQueue.GetExecutor(), true);
+	{
+		//Arguments are copied
+		std::string input = "a";
+		sig(input);
+		input = "b";
+		sig(input);
+	}
+	TEST_VERIFY(text.empty());
+	TEST_VERIFY(taskQueue.RunPending() == 3);
+	TEST_VERIFY(text == "a[b]b");
+
+	//Calls pending when the connection goes away are dropped
+	sig("c");
+	conn.reset();
+	taskQueue.RunPending();
+	TEST_VERIFY(text == "a[b]b[c]");
+	TEST_VERIFY(taskQueue.IsEmpty());
+
+	std::atomic<unsigned int> count(0);
+	{
+		Framework::CThreadPool threadPool(2);
+		Framework::CSignal<void (unsigned int)> poolSig;
+		auto poolConn = poolSig.ConnectQueued([&] (unsigned int value) { count += value; }, threadPool.GetExecutor());
+		for(unsigned int i = 0; i < 100; i++)
+		{
+			poolSig(2);
+		}
+		while(count != 200)
+		{
+			std::this_thread::yield();
+		}
+	}
+	TEST_VERIFY(count == 200);
+}
+
+namespace
+{
+	class CCounter
+	{
+	public:
+		void Add(int value)
+		{
+			m_value += value;
+		}
+
+		int GetValue() const
+		{
+			return m_value;
+		}
+
+	private:
+		int m_value = 0;
+	};
+
+	int Twice(int value)
+	{
+		return value * 2;
+	}
+}
+
+static void SignalTest_Delegate()
+{
+	typedef Framework::CSignal<void (int)> SignalType;
+	static_assert(std::is_trivially_copyable_v<SignalType::SlotDelegate>);
+
+	CCounter counter;
+	SignalType sig;
+	auto memberConn = sig.Connect(SignalType::SlotDelegate::FromMember<&CCounter::Add>(&counter));
+	int lambdaValue = 0;
+	auto lambdaConn = sig.Connect(SignalType::SlotDelegate([&lambdaValue] (int input) { lambdaValue -= input; }));
+	auto onceConn = sig.ConnectOnce(SignalType::SlotDelegate::FromMember<&CCounter::Add>(&counter));
+	sig(2);
+	sig(3);
+	TEST_VERIFY(counter.GetValue() == 7);
+	TEST_VERIFY(lambdaValue == -5);
+	memberConn.reset();
+	sig(4);
+	TEST_VERIFY(counter.GetValue() == 7);
+	TEST_VERIFY(lambdaValue == -9);
+
+	//Results and const members
+	auto twice = Framework::CDelegate<int (int)>::FromFunction<&Twice>();
+	TEST_VERIFY(twice(5) == 10);
+	const CCounter& constCounter = counter;
+	auto getValue = Framework::CDelegate<int ()>::FromMember<&CCounter::GetValue>(&constCounter);
+	auto getValueCopy = getValue;
+	TEST_VERIFY(getValueCopy() == 7);
+
+	//Fits in a thread pool task without allocating
+	std::promise<void> added;
+	Framework::CDelegate<void ()> addDelegate([&counter, &added] () { counter.Add(1); added.set_value(); });
+	Framework::CTask task(addDelegate);
+	TEST_VERIFY(task.IsStoredInline());
+	{
+		Framework::CThreadPool threadPool(1);
+		threadPool.Enqueue(std::move(task));
+		added.get_future().get();
+	}
+	TEST_VERIFY(counter.GetValue() == 8);
+}
+
 void SignalTest_Execute()
 {
+	SignalTest_Delegate();
+	SignalTest_Queued();
+	SignalTest_Override();
+	SignalTest_ReentrantUpdates();
+	SignalTest_ConcurrentEmit();
+
 	int value = 0;
 	auto setFct = [&] (int input) { value = input; };
 	auto incFct = [&] () { value++; };
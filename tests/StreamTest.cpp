@@ -0,0 +1,985 @@
+#include "StreamTest.h"
+#include <cstring>
+#include "AsyncBufferedStream.h"
+#include "AsyncFileReader.h"
+#include "BufferedStream.h"
+#include "ChainedBufferStream.h"
+#include "ColumnarTable.h"
+#include "Csv.h"
+#include "IndexedInflateStream.h"
+#include "InstrumentedStream.h"
+#include "LzAri.h"
+#include "MappedFileStream.h"
+#include "MemStream.h"
+#include "ParallelGZipStream.h"
+#include "PtrStream.h"
+#include "SharedMemoryStream.h"
+#include "StdStream.h"
+#include "StreamBitStream.h"
+#include "StreamReader.h"
+#include "StreamWriter.h"
+#include "TestDefs.h"
+#include "ThreadPool.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+using namespace Framework;
+
+static void BufferedStreamTest_Read()
+{
+	static const char text[] = "first line\r\nsecond line\nlast";
+	CPtrStream source(text, strlen(text));
+	//Use a tiny buffer to exercise refills
+	CBufferedStream stream(source, 4);
+	TEST_VERIFY(stream.ReadLine() == "first line");
+	TEST_VERIFY(stream.Read8() == 's');
+	TEST_VERIFY(stream.Tell() == 13);
+	TEST_VERIFY(stream.ReadLine(false) == "econd line");
+	TEST_VERIFY(!stream.IsEOF());
+	TEST_VERIFY(stream.ReadLine() == "last");
+	TEST_VERIFY(stream.IsEOF());
+
+	stream.Seek(6, STREAM_SEEK_SET);
+	TEST_VERIFY(!stream.IsEOF());
+	TEST_VERIFY(stream.Read32() == 0x656E696C);
+	stream.Seek(-3, STREAM_SEEK_CUR);
+	TEST_VERIFY(stream.Read16_MSBF() == 0x696E);
+
+	char part0[3] = {};
+	char part1[5] = {};
+	STREAM_IOVEC vectors[2] = { { part0, sizeof(part0) }, { part1, sizeof(part1) } };
+	stream.Seek(0, STREAM_SEEK_SET);
+	TEST_VERIFY(stream.ReadV(vectors, 2) == 8);
+	TEST_VERIFY(!memcmp(part0, "fir", 3));
+	TEST_VERIFY(!memcmp(part1, "st li", 5));
+}
+
+static void BufferedStreamTest_Write()
+{
+	CMemStream target;
+	{
+		CBufferedStream stream(target, 8);
+		stream.Write32(0x11223344);
+		stream.Write("abcdefghijkl", 12);
+		TEST_VERIFY(stream.Tell() == 16);
+		stream.Seek(0, STREAM_SEEK_SET);
+		TEST_VERIFY(stream.Read32() == 0x11223344);
+		stream.Write8('X');
+	}
+	TEST_VERIFY(target.GetSize() == 16);
+	TEST_VERIFY(!memcmp(target.GetBuffer() + 4, "Xbcdefghijkl", 12));
+}
+
+static void MemStreamTest()
+{
+	CMemStream stream;
+	for(uint32 i = 0; i < 0x10000; i++)
+	{
+		stream.Write32(i);
+	}
+	TEST_VERIFY(stream.GetSize() == 0x40000);
+	stream.Seek(8, STREAM_SEEK_SET);
+	stream.Write16(0xFFFF);
+	stream.Seek(8, STREAM_SEEK_SET);
+	TEST_VERIFY(stream.Read32() == 0xFFFF);
+	TEST_VERIFY(stream.Read32() == 3);
+
+	auto buffer = stream.ReleaseBuffer();
+	TEST_VERIFY(buffer.size() == 0x40000);
+	TEST_VERIFY(stream.GetSize() == 0);
+
+	CMemStream adopted(std::move(buffer));
+	adopted.Seek(0x3FFFC, STREAM_SEEK_SET);
+	TEST_VERIFY(adopted.Read32() == 0xFFFF);
+	adopted.Seek(0x3FFF8, STREAM_SEEK_SET);
+	adopted.Truncate();
+	TEST_VERIFY(adopted.GetSize() == 8);
+	TEST_VERIFY(adopted.Read32() == 0xFFFE);
+}
+
+static void ChainedBufferStreamTest()
+{
+	//Small segments to go across many of them
+	auto pool = std::make_shared<CChainedBufferStream::CSegmentPool>(100, 4);
+	CChainedBufferStream stream(pool);
+	for(uint32 i = 0; i < 1000; i++)
+	{
+		stream.Write32(i);
+	}
+	TEST_VERIFY(stream.GetSize() == 4000);
+	stream.Seek(98, STREAM_SEEK_SET);
+	stream.Write32(0xFFFFFFFF);
+	stream.Seek(96, STREAM_SEEK_SET);
+	TEST_VERIFY(stream.Read32() == 0xFFFF0018);
+	TEST_VERIFY(stream.Read32() == 0x0000FFFF);
+	stream.Seek(-4, STREAM_SEEK_END);
+	TEST_VERIFY(stream.Read32() == 999);
+	TEST_VERIFY(stream.Read8() == 0);
+	TEST_VERIFY(stream.IsEOF());
+
+	uint32 value = 0;
+	TEST_VERIFY((stream.ReadAt(3996, &value, 8) == 4) && (value == 999));
+	TEST_VERIFY(stream.ReadAt(4000, &value, 4) == 0);
+
+	//Vectors start from the offset and cover the rest of the data
+	STREAM_CONST_IOVEC vecs[64];
+	size_t vecCount = stream.GetIoVecs(152, vecs, 64);
+	TEST_VERIFY((vecCount == 39) && (vecs[0].size == 48) && (vecs[38].size == 100));
+	TEST_VERIFY(!memcmp(vecs[0].buffer, "\x26\x00\x00\x00", 4) && (stream.GetIoVecs(152, vecs, 2) == 2));
+
+	//Spliced segments are used as they are, even if the last one isn't full
+	CChainedBufferStream other(pool);
+	other.Write("abc", 3);
+	stream.Splice(other);
+	TEST_VERIFY((stream.GetSize() == 4003) && (other.GetSize() == 0));
+	stream.Splice(other);
+	stream.Seek(0, STREAM_SEEK_END);
+	stream.Write("defghijkl", 9);
+	TEST_VERIFY(stream.GetSize() == 4012);
+	stream.Seek(-12, STREAM_SEEK_END);
+	TEST_VERIFY(stream.ReadString(12) == "abcdefghijkl");
+
+	//Different pools are copied
+	CChainedBufferStream copied;
+	copied.Write("xyz", 3);
+	copied.Splice(stream);
+	TEST_VERIFY((copied.GetSize() == 4015) && (stream.GetSize() == 0));
+	auto buffer = copied.ToBuffer();
+	TEST_VERIFY(buffer.size() == 4015);
+	TEST_VERIFY(!memcmp(buffer.data() + 4003, "abcdefghijkl", 12));
+
+	CChainedBufferStream moved(std::move(copied));
+	TEST_VERIFY((moved.GetSize() == 4015) && (copied.GetSize() == 0));
+	moved.Clear();
+	TEST_VERIFY(moved.GetSize() == 0);
+}
+
+static void AsyncBufferedStreamTest()
+{
+	CThreadPool threadPool(2);
+	CMemStream target;
+	{
+		CAsyncBufferedStream stream(target, threadPool, 0x100, 2);
+		for(uint32 i = 0; i < 0x1000; i++)
+		{
+			stream.Write32(i);
+		}
+		TEST_VERIFY(stream.Tell() == 0x4000);
+		TEST_VERIFY(stream.GetLength() == 0x4000);
+
+		stream.Seek(0x10, STREAM_SEEK_SET);
+		TEST_VERIFY(stream.Read32() == 4);
+		stream.Seek(0x3FF8, STREAM_SEEK_SET);
+		TEST_VERIFY(stream.Read32() == 0xFFE);
+		stream.Write32(0xCAFE);
+		stream.Seek(0, STREAM_SEEK_SET);
+		uint32 sum = 0;
+		for(uint32 i = 0; i < 0x1000; i++)
+		{
+			sum += stream.Read32();
+		}
+		TEST_VERIFY(!stream.IsEOF());
+		TEST_VERIFY(sum == ((0xFFF * 0x1000 / 2) - 0xFFF + 0xCAFE));
+		stream.Read8();
+		TEST_VERIFY(stream.IsEOF());
+	}
+	TEST_VERIFY(target.GetSize() == 0x4000);
+}
+
+template <typename StreamType>
+static void StreamReaderTest_Read(StreamType& stream)
+{
+	stream.Seek(2, STREAM_SEEK_SET);
+	{
+		CStreamReader<StreamType> reader(stream);
+		TEST_VERIFY(reader.Tell() == 2);
+		TEST_VERIFY(reader.Read16() == 0x0302);
+		TEST_VERIFY(reader.Read32_MSBF() == 0x04050607);
+		TEST_VERIFY(reader.Read8() == 0x08);
+		reader.Seek(14, STREAM_SEEK_SET);
+		TEST_VERIFY(reader.Read32() == 0x00000F0E);
+		TEST_VERIFY(!reader.IsEOF());
+		TEST_VERIFY(reader.Read8() == 0);
+		TEST_VERIFY(reader.IsEOF());
+		reader.Seek(12, STREAM_SEEK_SET);
+		TEST_VERIFY(!reader.IsEOF());
+	}
+	//Position is brought back to the stream when the reader is destroyed
+	TEST_VERIFY(stream.Tell() == 12);
+	TEST_VERIFY(stream.Read8() == 0x0C);
+}
+
+static void SharedMemoryStreamTest()
+{
+	static const uint32 valueCount = 0x40000;
+	static const uint32 frameSize = 0x1234;
+	static const uint32 frameCount = 64;
+	CSharedMemoryStream producer("FrameworkShmStreamTest", 0x2000, CSharedMemoryStream::ROLE_PRODUCER);
+	TEST_VERIFY((producer.GetCapacity() >= 0x2000) && (producer.GetAvailableSize() == producer.GetCapacity()));
+#ifdef _WIN32
+	CSharedMemoryStream consumer("FrameworkShmStreamTest", CSharedMemoryStream::ROLE_CONSUMER);
+#else
+	//Also the only way to open it on Android
+	CSharedMemoryStream consumer(producer.GetFileDescriptor(), CSharedMemoryStream::ROLE_CONSUMER);
+#endif
+	TEST_VERIFY(consumer.GetCapacity() == producer.GetCapacity());
+
+	std::thread producerThread(
+	    [&]() {
+		    for(uint32 i = 0; i < valueCount; i++)
+		    {
+			    producer.Write32(i);
+		    }
+		    //Frames don't divide the ring evenly, some of them wrap around
+		    for(uint32 i = 0; i < frameCount; i++)
+		    {
+			    auto frame = producer.Reserve(frameSize);
+			    memset(frame, static_cast<int>(i), frameSize);
+			    producer.Commit(frameSize);
+		    }
+		    producer.Write8(0xAA);
+		    producer.Close();
+	    });
+
+	bool isValid = true;
+	for(uint32 i = 0; i < valueCount; i++)
+	{
+		isValid &= (consumer.Read32() == i);
+	}
+	for(uint32 i = 0; i < frameCount; i++)
+	{
+		auto frame = consumer.Acquire(frameSize);
+		isValid &= (frame != nullptr) && (frame[0] == static_cast<uint8>(i)) && (frame[frameSize - 1] == static_cast<uint8>(i));
+		consumer.Release(frameSize);
+	}
+	producerThread.join();
+	TEST_VERIFY(isValid);
+	TEST_VERIFY(consumer.Tell() == ((valueCount * 4) + (frameSize * frameCount)));
+
+	//Producer is closed, what's left can still be read
+	TEST_VERIFY(consumer.Acquire(2) == nullptr);
+	TEST_VERIFY(consumer.GetAvailableSize() == 1);
+	TEST_VERIFY(consumer.Read8() == 0xAA);
+	TEST_VERIFY(!consumer.IsEOF());
+	consumer.Read8();
+	TEST_VERIFY(consumer.IsEOF());
+}
+
+static void StreamReaderTest()
+{
+	uint8 data[16];
+	for(uint32 i = 0; i < 16; i++)
+	{
+		data[i] = static_cast<uint8>(i);
+	}
+	static_assert(CStreamReader<CPtrStream>::IS_MEMORY_BACKED);
+	static_assert(CStreamReader<CMemStream>::IS_MEMORY_BACKED);
+	static_assert(!CStreamReader<CStream>::IS_MEMORY_BACKED);
+
+	CPtrStream ptrStream(data, sizeof(data));
+	StreamReaderTest_Read(ptrStream);
+
+	CMemStream memStream;
+	memStream.Write(data, sizeof(data));
+	StreamReaderTest_Read(memStream);
+
+	//Goes through the stream's virtual functions
+	CStream& stream = memStream;
+	StreamReaderTest_Read(stream);
+}
+
+static void StreamWriterTest()
+{
+	CMemStream stream;
+	{
+		CStreamWriter<CMemStream, 0x10> writer(stream);
+		writer.Write32(0x03020100);
+		writer.Write16_MSBF(0x0405);
+		writer.Write8(0x06);
+		TEST_VERIFY(stream.GetSize() == 0);
+		TEST_VERIFY(writer.Tell() == 7);
+		//Doesn't fit in what's left of the buffer
+		uint8 block[0x20];
+		for(uint32 i = 0; i < sizeof(block); i++)
+		{
+			block[i] = static_cast<uint8>(i + 7);
+		}
+		writer.Write(block, sizeof(block));
+		TEST_VERIFY(stream.GetSize() == 0x27);
+		writer.Write64(0x2E2D2C2B2A292827);
+	}
+	TEST_VERIFY(stream.GetSize() == 0x2F);
+	bool isSequence = true;
+	for(uint32 i = 0; i < stream.GetSize(); i++)
+	{
+		isSequence &= (stream.GetBuffer()[i] == i);
+	}
+	TEST_VERIFY(isSequence);
+}
+
+static void CsvTest_Parse()
+{
+	static const char text[] = "a,\"b,\"\"c\"\"\"\r\n1,2\n";
+	CPtrStream stream(text, strlen(text));
+	auto contents = Csv::Parse(stream);
+	TEST_VERIFY(contents.size() == 3);
+	TEST_VERIFY(contents[0].size() == 2);
+	TEST_VERIFY(contents[0][1] == "b,\"c\"");
+	TEST_VERIFY(contents[1][0] == "1");
+	TEST_VERIFY(contents[1][1] == "2");
+	TEST_VERIFY(stream.Tell() == strlen(text));
+
+	//Streams that aren't memory backed are read through a buffer
+	CMemStream memStream;
+	memStream.Write(text, strlen(text));
+	memStream.Seek(0, STREAM_SEEK_SET);
+	CBufferedStream bufferedStream(memStream);
+	TEST_VERIFY(Csv::Parse(bufferedStream) == contents);
+}
+
+static void CsvTest_Reader()
+{
+	static const char text[] = "name,value,ratio\r\n\"a,\"\"b\"\"\",-42,0.25\r\n\"multi\nline\",7,1e3\n,,\nlast,1,2";
+	//Small buffer to get rows split across reads
+	CPtrStream stream(text, strlen(text));
+	Csv::CReader reader(stream, ',', 5);
+	TEST_VERIFY(reader.Next());
+	TEST_VERIFY(reader.GetFieldCount() == 3);
+	TEST_VERIFY(reader.GetField(2) == "ratio");
+	TEST_VERIFY(reader.Next());
+	TEST_VERIFY(reader.GetField(0) == "a,\"b\"");
+	TEST_VERIFY(reader.GetInt(1) == -42);
+	TEST_VERIFY(reader.GetDouble(2) == 0.25);
+	TEST_VERIFY(reader.Next());
+	TEST_VERIFY(reader.GetField(0) == "multi\nline");
+	TEST_VERIFY(reader.GetInt(1) == 7);
+	TEST_VERIFY(reader.GetDouble(2) == 1000.0);
+	TEST_VERIFY(reader.Next());
+	TEST_VERIFY(reader.GetFieldCount() == 3);
+	TEST_VERIFY(reader.GetField(1).empty());
+	TEST_VERIFY(reader.Next());
+	TEST_VERIFY(reader.GetField(0) == "last");
+	TEST_VERIFY(reader.GetInt(2) == 2);
+	TEST_VERIFY(!reader.Next());
+
+	bool hasThrown = false;
+	try
+	{
+		CPtrStream intStream(text, strlen(text));
+		Csv::CReader intReader(intStream);
+		intReader.Next();
+		intReader.GetInt(0);
+	}
+	catch(const std::exception&)
+	{
+		hasThrown = true;
+	}
+	TEST_VERIFY(hasThrown);
+}
+
+static void CsvTest_Parallel()
+{
+	Csv::Contents rows;
+	for(unsigned int i = 0; i < 500; i++)
+	{
+		Csv::Line line;
+		line.push_back(std::to_string(i));
+		line.push_back((i % 3) ? "plain" : "quoted, \"with\"\nnew line");
+		line.push_back("");
+		rows.push_back(line);
+	}
+	{
+		CStdStream output("parallel.csv", "wb");
+		Csv::CWriter writer(output, ',', 64);
+		for(const auto& line : rows)
+		{
+			writer.WriteRow(line);
+		}
+	}
+
+	CThreadPool threadPool(4);
+	for(auto pool : {static_cast<CThreadPool*>(nullptr), &threadPool})
+	{
+		CMappedFileStream stream("parallel.csv");
+		Csv::Contents parsedRows;
+		unsigned int batchCount = 0;
+		Csv::ParseParallel(
+		    stream, [&](Csv::Contents& batch) {
+			    batchCount++;
+			    for(auto& line : batch)
+			    {
+				    parsedRows.push_back(std::move(line));
+			    }
+		    },
+		    pool, ',', 100);
+		TEST_VERIFY(batchCount > 1);
+		TEST_VERIFY(parsedRows == rows);
+	}
+}
+
+static void CsvTest_Columnar()
+{
+	static const char* categories[3] = {"red", "green", "blue"};
+	{
+		CStdStream output("columnar.csv", "wb");
+		Csv::CWriter writer(output);
+		writer.WriteRow({"id", "price", "category", "comment", "sparse"});
+		for(unsigned int i = 0; i < 50; i++)
+		{
+			Csv::Line line;
+			line.push_back(std::to_string(static_cast<int>(i) - 10));
+			line.push_back((i % 2) ? std::to_string(i) : (std::to_string(i) + ".5"));
+			line.push_back(categories[i % 3]);
+			line.push_back("comment, \"" + std::to_string(i) + "\"");
+			//Last column is missing from most rows
+			if((i % 10) == 0)
+			{
+				line.push_back("x");
+			}
+			writer.WriteRow(line);
+		}
+	}
+
+	for(bool compress : {false, true})
+	{
+		ColumnarTable::CONVERT_OPTIONS options;
+		options.compress = compress;
+		options.rowGroupSize = 7;
+		options.maxDictionarySize = 4;
+		{
+			CStdStream input("columnar.csv", "rb");
+			CStdStream output("columnar.bin", "wb");
+			ColumnarTable::ConvertCsv(input, output, options);
+		}
+
+		CMappedFileStream stream("columnar.bin");
+		ColumnarTable::CReader reader(stream);
+		TEST_VERIFY(reader.GetRowCount() == 50);
+		TEST_VERIFY(reader.GetColumnCount() == 5);
+		TEST_VERIFY(reader.GetColumnName(1) == "price");
+		TEST_VERIFY(reader.GetColumnType(0) == ColumnarTable::COLUMN_TYPE_INT);
+		TEST_VERIFY(reader.GetColumnType(1) == ColumnarTable::COLUMN_TYPE_DOUBLE);
+		TEST_VERIFY(reader.GetColumnType(2) == ColumnarTable::COLUMN_TYPE_DICTIONARY);
+		TEST_VERIFY(reader.GetColumnType(3) == ColumnarTable::COLUMN_TYPE_STRING);
+		TEST_VERIFY(reader.GetColumnType(4) == ColumnarTable::COLUMN_TYPE_DICTIONARY);
+
+		auto ids = reader.GetColumn(reader.GetColumnIndex("id"));
+		auto prices = reader.GetColumn(1);
+		auto categoryColumn = reader.GetColumn(2);
+		auto comments = reader.GetColumn(3);
+		auto sparse = reader.GetColumn(4);
+		TEST_VERIFY(ids.GetChunkCount() == 8);
+		TEST_VERIFY(ids.GetChunkRowCount(7) == 1);
+		TEST_VERIFY(categoryColumn.GetDictionary().size() == 3);
+		int64 idSum = 0;
+		for(size_t chunk = 0; chunk < ids.GetChunkCount(); chunk++)
+		{
+			auto values = ids.GetChunkInts(chunk);
+			for(size_t i = 0; i < ids.GetChunkRowCount(chunk); i++)
+			{
+				idSum += values[i];
+			}
+		}
+		TEST_VERIFY(idSum == ((49 * 50 / 2) - 500));
+		bool isValid = true;
+		for(unsigned int i = 0; i < 50; i++)
+		{
+			isValid &= (ids.GetInt(i) == static_cast<int>(i) - 10);
+			isValid &= (prices.GetDouble(i) == ((i % 2) ? i : (i + 0.5)));
+			isValid &= (categoryColumn.GetString(i) == categories[i % 3]);
+			isValid &= (comments.GetString(i) == "comment, \"" + std::to_string(i) + "\"");
+			isValid &= (sparse.GetString(i) == (((i % 10) == 0) ? "x" : ""));
+		}
+		TEST_VERIFY(isValid);
+
+		bool hasThrown = false;
+		try
+		{
+			comments.GetInt(0);
+		}
+		catch(const std::exception&)
+		{
+			hasThrown = true;
+		}
+		TEST_VERIFY(hasThrown);
+	}
+
+	{
+		//No header, columns are named by their index
+		static const char text[] = "1,a\n2,b\n";
+		CPtrStream input(text, strlen(text));
+		CMemStream output;
+		ColumnarTable::CONVERT_OPTIONS options;
+		options.hasHeader = false;
+		ColumnarTable::ConvertCsv(input, output, options);
+		{
+			CStdStream file("columnar.bin", "wb");
+			file.Write(output.GetBuffer(), output.GetSize());
+		}
+		CMappedFileStream stream("columnar.bin");
+		ColumnarTable::CReader reader(stream);
+		TEST_VERIFY(reader.GetRowCount() == 2);
+		TEST_VERIFY(reader.GetColumnName(1) == "1");
+		TEST_VERIFY(reader.GetColumn(1).GetString(1) == "b");
+		TEST_VERIFY(reader.GetColumn(0).GetInt(1) == 2);
+	}
+}
+
+static void MappedFileStreamTest()
+{
+	static const char text[] = "mapped file contents";
+	{
+		CStdStream output("mapped.bin", "wb");
+		output.Write(text, strlen(text));
+	}
+	CMappedFileStream stream("mapped.bin");
+	TEST_VERIFY(stream.GetLength() == strlen(text));
+	TEST_VERIFY(!memcmp(stream.GetSpan(7, 4), "file", 4));
+	stream.Seek(-8, STREAM_SEEK_END);
+	TEST_VERIFY(stream.ReadString(8) == "contents");
+	TEST_VERIFY(!stream.IsEOF());
+	stream.Read8();
+	TEST_VERIFY(stream.IsEOF());
+}
+
+static void PositionalAccessTest()
+{
+	{
+		//Positional reads see data still held in the stdio buffer
+		CStdStream stream("positional.bin", "w+b");
+		stream.Write32(0x12345678);
+		uint32 value = 0;
+		TEST_VERIFY(stream.ReadAt(0, &value, 4) == 4);
+		TEST_VERIFY(value == 0x12345678);
+	}
+#ifndef _WIN32
+	{
+		int fds[2] = {};
+		TEST_VERIFY(pipe(fds) == 0);
+		close(fds[1]);
+		CStdStream stream(fdopen(fds[0], "rb"));
+		TEST_VERIFY(!stream.CanAccessAt());
+	}
+#endif
+	{
+		CStdStream output("positional.bin", "wb");
+		for(uint32 i = 0; i < 0x4000; i++)
+		{
+			output.Write32(i);
+		}
+		output.Flush();
+		output.WriteAt(0, "ABCD", 4);
+	}
+	CStdStream stream("positional.bin", "rb");
+	TEST_VERIFY(stream.CanAccessAt());
+	stream.Seek(0x10, STREAM_SEEK_SET);
+	std::vector<std::thread> threads;
+	bool results[4] = {};
+	for(uint32 t = 0; t < 4; t++)
+	{
+		threads.emplace_back(
+			[&stream, &results, t] ()
+			{
+				bool success = true;
+				for(uint32 i = t + 1; i < 0x4000; i += 4)
+				{
+					uint32 value = 0;
+					success &= (stream.ReadAt(i * 4, &value, 4) == 4) && (value == i);
+				}
+				results[t] = success;
+			});
+	}
+	for(auto& thread : threads)
+	{
+		thread.join();
+	}
+	for(bool result : results)
+	{
+		TEST_VERIFY(result);
+	}
+	char header[4] = {};
+	TEST_VERIFY(stream.ReadAt(0, header, 4) == 4);
+	TEST_VERIFY(!memcmp(header, "ABCD", 4));
+	TEST_VERIFY(stream.ReadAt(0xFFFE, header, 4) == 2);
+	TEST_VERIFY(stream.Tell() == 0x10);
+	TEST_VERIFY(stream.Read32() == 4);
+}
+
+static void AsyncFileReaderTest()
+{
+	{
+		CStdStream output("asyncread.bin", "wb");
+		for(uint32 i = 0; i < 0x10000; i++)
+		{
+			output.Write32(i);
+		}
+	}
+	static const char text[] = "pointer stream";
+	CThreadPool threadPool(2);
+	CStdStream fileStream("asyncread.bin", "rb");
+	CPtrStream ptrStream(text, strlen(text));
+	std::vector<uint32> values(0x100);
+	char textBuffer[6] = {};
+	uint8 tailBuffer[4] = {};
+	std::atomic<uint32> completed(0);
+	std::atomic<bool> success(true);
+	{
+		CAsyncFileReader reader(threadPool, 16);
+		CAsyncFileReader::RequestArray requests;
+		for(uint32 i = 0; i < values.size(); i++)
+		{
+			CAsyncFileReader::READ_REQUEST request;
+			request.stream = &fileStream;
+			request.offset = i * 0x400;
+			request.buffer = &values[i];
+			request.size = 4;
+			request.callback =
+				[&] (uint64 result, std::exception_ptr error)
+				{
+					success = success && (result == 4) && !error;
+					completed++;
+				};
+			requests.push_back(std::move(request));
+		}
+		reader.Submit(std::move(requests));
+		auto ptrResult = reader.Read(ptrStream, 8, textBuffer, sizeof(textBuffer));
+		auto eofResult = reader.Read(fileStream, 0x3FFFE, tailBuffer, 4);
+		TEST_VERIFY(ptrResult.get() == 6);
+		TEST_VERIFY(eofResult.get() == 2);
+		while(completed != values.size())
+		{
+			std::this_thread::yield();
+		}
+	}
+	TEST_VERIFY(success);
+	TEST_VERIFY(!memcmp(textBuffer, "stream", 6));
+	TEST_VERIFY((tailBuffer[0] == 0) && (tailBuffer[1] == 0));
+	for(uint32 i = 0; i < values.size(); i++)
+	{
+		TEST_VERIFY(values[i] == (i * 0x100));
+	}
+	{
+		//Reads see data still held in the stdio buffer
+		CStdStream stream("asyncread.bin", "w+b");
+		stream.Write32(0x12345678);
+		CAsyncFileReader reader(threadPool);
+		uint32 value = 0;
+		TEST_VERIFY(reader.Read(stream, 0, &value, 4).get() == 4);
+		TEST_VERIFY(value == 0x12345678);
+	}
+}
+
+static void InstrumentedStreamTest()
+{
+	static const char text[] = "instrumented";
+	CPtrStream source(text, strlen(text));
+	{
+		CInstrumentedStream stream(source, "test");
+		stream.Read32();
+		stream.Read32();
+		stream.Seek(0, STREAM_SEEK_SET);
+		const auto& readStats = stream.GetStats().GetOperationStats(CStreamStats::OPERATION_READ);
+		TEST_VERIFY(readStats.calls == 2);
+		TEST_VERIFY(readStats.bytes == 8);
+	}
+	{
+		//Same name, same stats
+		CInstrumentedStream stream(source, "test");
+		stream.Read8();
+		TEST_VERIFY(stream.GetStats().GetOperationStats(CStreamStats::OPERATION_READ).calls == 3);
+		TEST_VERIFY(stream.GetStats().GetOperationStats(CStreamStats::OPERATION_SEEK).calls == 1);
+	}
+	auto json = CStreamStatsRegistry::GetInstance().DumpJson();
+	TEST_VERIFY(json.find("\"test\":{\"read\":{\"calls\":3,\"bytes\":9,") != std::string::npos);
+	auto csv = CStreamStatsRegistry::GetInstance().DumpCsv();
+	TEST_VERIFY(csv.find("\ntest,seek,1,0,") != std::string::npos);
+	CStreamStatsRegistry::GetInstance().Reset();
+	TEST_VERIFY(CStreamStatsRegistry::GetInstance().GetStats("test")->GetOperationStats(CStreamStats::OPERATION_READ).calls == 0);
+}
+
+static std::vector<uint8> DeflateData(const std::vector<uint8>& data, int windowBits)
+{
+	z_stream zStream = {};
+	deflateInit2(&zStream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, windowBits, 8, Z_DEFAULT_STRATEGY);
+	std::vector<uint8> result(deflateBound(&zStream, static_cast<uLong>(data.size())));
+	zStream.next_in = const_cast<Bytef*>(data.data());
+	zStream.avail_in = static_cast<uInt>(data.size());
+	zStream.next_out = result.data();
+	zStream.avail_out = static_cast<uInt>(result.size());
+	deflate(&zStream, Z_FINISH);
+	result.resize(zStream.total_out);
+	deflateEnd(&zStream);
+	return result;
+}
+
+static void IndexedInflateStreamTest()
+{
+	std::vector<uint8> data(0x300000);
+	uint32 seed = 1;
+	for(size_t i = 0; i < data.size(); i++)
+	{
+		seed = (seed * 1103515245) + 12345;
+		data[i] = ((seed >> 24) < 0x20) ? static_cast<uint8>(seed >> 16) : static_cast<uint8>(i >> 10);
+	}
+
+	for(auto format : { CInflateIndex::FORMAT_RAW, CInflateIndex::FORMAT_GZIP })
+	{
+		auto compressed = DeflateData(data, (format == CInflateIndex::FORMAT_GZIP) ? (MAX_WBITS + 16) : -MAX_WBITS);
+		//Compressed data doesn't start at the beginning of the stream
+		compressed.insert(compressed.begin(), 5, 0xAA);
+		CPtrStream source(compressed.data(), compressed.size());
+		source.Seek(5, STREAM_SEEK_SET);
+		auto builtIndex = CInflateIndex::Build(source, format, 0x40000);
+		TEST_VERIFY(builtIndex.GetUncompressedLength() == data.size());
+		TEST_VERIFY(builtIndex.GetPoints().size() > 4);
+
+		//Goes through a sidecar file
+		CMemStream indexFile;
+		builtIndex.Save(indexFile);
+		indexFile.Seek(0, STREAM_SEEK_SET);
+		auto index = CInflateIndex::Load(indexFile);
+		TEST_VERIFY(index.GetPoints().size() == builtIndex.GetPoints().size());
+
+		source.Seek(5, STREAM_SEEK_SET);
+		CIndexedInflateStream stream(source, index);
+		TEST_VERIFY(stream.GetLength() == data.size());
+		bool success = true;
+		for(unsigned int i = 0; i < 64; i++)
+		{
+			seed = (seed * 1103515245) + 12345;
+			uint64 position = seed % data.size();
+			uint8 buffer[1000];
+			stream.Seek(position, STREAM_SEEK_SET);
+			uint64 amountRead = stream.Read(buffer, sizeof(buffer));
+			uint64 expectedSize = std::min<uint64>(sizeof(buffer), data.size() - position);
+			success &= (amountRead == expectedSize) && !memcmp(buffer, data.data() + position, expectedSize);
+			//Sequential reads continue where the last one stopped
+			success &= (stream.Read(buffer, 10) == std::min<uint64>(10, data.size() - position - amountRead));
+		}
+		TEST_VERIFY(success);
+
+		stream.Seek(-4, STREAM_SEEK_END);
+		uint8 tail[8] = {};
+		TEST_VERIFY(stream.Read(tail, sizeof(tail)) == 4);
+		TEST_VERIFY(!memcmp(tail, data.data() + data.size() - 4, 4));
+		TEST_VERIFY(stream.IsEOF());
+	}
+}
+
+static void ParallelGZipStreamTest()
+{
+	std::vector<uint8> data(0x123456);
+	for(size_t i = 0; i < data.size(); i++)
+	{
+		data[i] = static_cast<uint8>((i * 7) ^ (i >> 9));
+	}
+
+	CThreadPool threadPool(4);
+	std::vector<uint8> compressed;
+	for(auto threadPoolPtr : { static_cast<CThreadPool*>(nullptr), &threadPool })
+	{
+		CMemStream output;
+		{
+			CParallelGZipWriteStream stream(output, threadPoolPtr);
+			//Odd sized writes that straddle blocks
+			for(size_t offset = 0; offset < data.size(); offset += 0x3001)
+			{
+				stream.Write(data.data() + offset, std::min<size_t>(0x3001, data.size() - offset));
+			}
+			TEST_VERIFY(stream.Tell() == data.size());
+		}
+		std::vector<uint8> result(output.GetBuffer(), output.GetBuffer() + output.GetSize());
+		//Blocks are independent, output doesn't depend on threading
+		TEST_VERIFY(compressed.empty() || (compressed == result));
+		compressed = std::move(result);
+	}
+
+	//Any gzip decoder can read the concatenated members
+	{
+		std::vector<uint8> result(data.size() + 1);
+		z_stream zStream = {};
+		inflateInit2(&zStream, MAX_WBITS + 16);
+		zStream.next_in = compressed.data();
+		zStream.avail_in = static_cast<uInt>(compressed.size());
+		zStream.next_out = result.data();
+		zStream.avail_out = static_cast<uInt>(result.size());
+		while(zStream.avail_in != 0)
+		{
+			if(inflate(&zStream, Z_NO_FLUSH) != Z_STREAM_END) break;
+			inflateReset(&zStream);
+		}
+		inflateEnd(&zStream);
+		TEST_VERIFY(zStream.avail_in == 0);
+		result.resize(result.size() - zStream.avail_out);
+		TEST_VERIFY(result == data);
+	}
+
+	//Block-parallel and sequential reads
+	auto gzipData = DeflateData(data, MAX_WBITS + 16);
+	for(auto input : { &compressed, &gzipData })
+	{
+		for(auto threadPoolPtr : { static_cast<CThreadPool*>(nullptr), &threadPool })
+		{
+			CPtrStream source(input->data(), input->size());
+			CParallelGZipReadStream stream(source, threadPoolPtr);
+			TEST_VERIFY(stream.IsBlockParallel() == (input == &compressed));
+			std::vector<uint8> result;
+			while(!stream.IsEOF())
+			{
+				uint8 buffer[0x7777];
+				auto amountRead = stream.Read(buffer, sizeof(buffer));
+				result.insert(result.end(), buffer, buffer + amountRead);
+			}
+			TEST_VERIFY(result == data);
+			TEST_VERIFY(stream.Tell() == data.size());
+		}
+	}
+}
+
+static void LzAriTest()
+{
+	//Produced by the original binary tree encoder
+	static const uint8 legacyData[] =
+	{
+		0x31, 0x00, 0x00, 0x00, 0xB0, 0xA8, 0xBA, 0x46, 0xB7, 0xED, 0xF0, 0x1F, 0x10, 0xCA, 0x8D, 0x3B,
+		0x6A, 0x02, 0xFE, 0x1A, 0x06
+	};
+	static const char legacyText[] = "abracadabra abracadabra abracadabra, abracadabra!";
+	std::vector<uint8> result;
+	TEST_VERIFY(CLzAri::Decompress(legacyData, sizeof(legacyData), result) == sizeof(legacyData));
+	TEST_VERIFY((result.size() == strlen(legacyText)) && !memcmp(result.data(), legacyText, result.size()));
+
+	std::vector<uint8> data(0x20000);
+	uint32 seed = 1;
+	for(size_t i = 0; i < data.size(); i++)
+	{
+		seed = (seed * 1103515245) + 12345;
+		data[i] = ((seed >> 24) < 0x40) ? static_cast<uint8>(seed >> 16) : legacyText[i % strlen(legacyText)];
+	}
+	std::vector<uint8> compressed;
+	CLzAri::Compress(data.data(), data.size(), compressed);
+	TEST_VERIFY(compressed.size() < data.size());
+
+	//Stream interface only consumes what the decoder looked at, like the original bit by bit reader
+	CMemStream source;
+	source.Write(compressed.data(), compressed.size());
+	source.Write32(0xCAFEBABE);
+	source.Seek(0, STREAM_SEEK_SET);
+	CMemStream output;
+	CLzAri::Decompress(output, source);
+	TEST_VERIFY((output.GetSize() == data.size()) && !memcmp(output.GetBuffer(), data.data(), data.size()));
+	TEST_VERIFY((source.Tell() >= compressed.size()) && (source.Tell() < (compressed.size() + 4)));
+
+	CLzAri::Compress(nullptr, 0, compressed);
+	TEST_VERIFY(CLzAri::Decompress(compressed.data(), compressed.size(), result) == 4);
+	TEST_VERIFY(result.empty());
+}
+
+static void StreamBitStreamTest_MSBF()
+{
+	std::vector<uint8> data(0x3000);
+	for(uint32 i = 0; i < data.size(); i++)
+	{
+		data[i] = static_cast<uint8>((i * 0x9E3779B1) >> 13);
+	}
+	CPtrStream source(data.data(), data.size());
+	CStreamBitStream stream(source);
+	uint64 bitPosition = 0;
+	uint32 step = 0;
+	while(1)
+	{
+		uint8 size = static_cast<uint8>((step++ * 7) % 33);
+		uint32 value = 0;
+		if(!stream.TryPeekBits_MSBF(size, value))
+		{
+			TEST_VERIFY((bitPosition + size) > (data.size() * 8));
+			break;
+		}
+		uint32 expected = 0;
+		for(uint32 i = 0; i < size; i++)
+		{
+			uint64 bit = bitPosition + i;
+			expected = (expected << 1) | ((data[bit / 8] >> (7 - (bit % 8))) & 1);
+		}
+		TEST_VERIFY(value == expected);
+		stream.Advance(size);
+		bitPosition += size;
+		TEST_VERIFY(stream.GetBitIndex() == (bitPosition & 7));
+	}
+	stream.SeekToByteAlign();
+	TEST_VERIFY(stream.IsOnByteBoundary());
+}
+
+static void StreamBitStreamTest_LSBF()
+{
+	std::vector<uint8> data(0x3000);
+	for(uint32 i = 0; i < data.size(); i++)
+	{
+		data[i] = static_cast<uint8>((i * 0x9E3779B1) >> 13);
+	}
+	CPtrStream source(data.data(), data.size());
+	CStreamBitStream stream(source);
+	uint64 bitPosition = 0;
+	uint32 step = 0;
+	while(1)
+	{
+		uint8 size = static_cast<uint8>((step++ * 7) % 33);
+		uint32 value = 0;
+		if(!stream.TryPeekBits_LSBF(size, value))
+		{
+			TEST_VERIFY((bitPosition + size) > (data.size() * 8));
+			break;
+		}
+		uint32 expected = 0;
+		for(uint32 i = 0; i < size; i++)
+		{
+			uint64 bit = bitPosition + i;
+			expected |= ((data[bit / 8] >> (bit % 8)) & 1) << i;
+		}
+		TEST_VERIFY(value == expected);
+		stream.Advance(size);
+		bitPosition += size;
+		TEST_VERIFY(stream.GetBitIndex() == (bitPosition & 7));
+	}
+
+	//Mixing bit orders on byte boundaries
+	{
+		static const uint8 mixedData[] = {0xA5, 0x3C, 0x12, 0x34, 0x56};
+		CPtrStream mixedSource(mixedData, sizeof(mixedData));
+		CStreamBitStream mixedStream(mixedSource);
+		TEST_VERIFY(mixedStream.GetBitsInline_LSBF(4) == 0x5);
+		TEST_VERIFY(mixedStream.GetBitsInline_LSBF(4) == 0xA);
+		TEST_VERIFY(mixedStream.GetBitsInline_MSBF(8) == 0x3C);
+		TEST_VERIFY(mixedStream.GetBitsInline_LSBF(16) == 0x3412);
+		TEST_VERIFY(mixedStream.GetBitsInline_MSBF(8) == 0x56);
+	}
+}
+
+void StreamTest_Execute()
+{
+	BufferedStreamTest_Read();
+	BufferedStreamTest_Write();
+	MemStreamTest();
+	ChainedBufferStreamTest();
+	AsyncBufferedStreamTest();
+	SharedMemoryStreamTest();
+	StreamReaderTest();
+	StreamWriterTest();
+	CsvTest_Parse();
+	CsvTest_Reader();
+	CsvTest_Parallel();
+	CsvTest_Columnar();
+	MappedFileStreamTest();
+	PositionalAccessTest();
+	AsyncFileReaderTest();
+	InstrumentedStreamTest();
+	IndexedInflateStreamTest();
+	ParallelGZipStreamTest();
+	LzAriTest();
+	StreamBitStreamTest_MSBF();
+	StreamBitStreamTest_LSBF();
+}
@@ -1,6 +1,8 @@
 #include "StringCastTest.h"
 #include <string>
 #include "string_cast.h"
+#include "string_cast_sjis.h"
+#include "string_cast_win1252.h"
 #include "TestDefs.h"
 
 #define TEST_STRING_ANSI "Hello World!"
@@ -18,4 +20,26 @@ void StringCastTest_Execute()
 		auto outputString = string_cast<std::string>(inputString);
 		TEST_VERIFY(!outputString.compare(TEST_STRING_ANSI));
 	}
+	{
+		//Hiragana, kanji, half width katakana, NEC row 13, IBM extensions and user defined area
+		TEST_VERIFY(string_cast_sjis("\x82\xA0\x93\xFA\x96\x7B\xB1\x87\x40\xFA\x40\xF0\x40\xF9\xFC") == L"あ日本ｱ①ⅰ\uE000\uE757");
+		TEST_VERIFY(string_cast_sjis("a\\~\x80\xA0\xFD") == L"a\\~\u0080\uF8F0\uF8F1");
+		//Truncated and invalid double byte characters, the byte after an invalid lead byte is kept
+		TEST_VERIFY(string_cast_sjis("a\x82") == L"a?");
+		TEST_VERIFY(string_cast_sjis("\x82 a\x85\x40") == L"? a?@");
+	}
+	{
+		TEST_VERIFY(string_cast_win1252("caf\xE9 \x80\x81\x9F") == L"café €\u0081Ÿ");
+	}
+	{
+		//Long enough to go through the ASCII fast path, with a double byte character at every position
+		for(size_t position = 0; position < 40; position++)
+		{
+			std::string input(40, 'x');
+			input.insert(position, "\x93\xFA");
+			std::wstring expected(40, L'x');
+			expected.insert(position, 1, L'日');
+			TEST_VERIFY(string_cast_sjis(input) == expected);
+		}
+	}
 }
@@ -0,0 +1,67 @@
+#include "StringFormatTest.h"
+#include <cstring>
+#include <string>
+#include "string_format.h"
+#include "TestDefs.h"
+
+enum TEST_ENUM
+{
+	TEST_ENUM_VALUE = 3,
+};
+
+void StringFormatTest_Execute()
+{
+	//Literals
+	TEST_VERIFY(string_format(FORMAT_STRING("")) == "");
+	TEST_VERIFY(string_format(FORMAT_STRING("text")) == "text");
+	TEST_VERIFY(string_format(FORMAT_STRING("{{}} {{{}}}"), 1) == "{} {1}");
+
+	//Integers
+	TEST_VERIFY(string_format(FORMAT_STRING("{} {} {}"), 0, -42, 18446744073709551615ULL) == "0 -42 18446744073709551615");
+	TEST_VERIFY(string_format(FORMAT_STRING("{:x} {:X} {:o} {:b}"), 255, 255, 8, 5) == "ff FF 10 101");
+	TEST_VERIFY(string_format(FORMAT_STRING("{:08X}"), 0xBEEF) == "0000BEEF");
+	TEST_VERIFY(string_format(FORMAT_STRING("{:05}"), -12) == "-0012");
+	TEST_VERIFY(string_format(FORMAT_STRING("{:5}|{:<5}|{:^5}|{:*>5}"), 1, 2, 3, 4) == "    1|2    |  3  |****4");
+	TEST_VERIFY(string_format(FORMAT_STRING("{}"), static_cast<unsigned char>(200)) == "200");
+	TEST_VERIFY(string_format(FORMAT_STRING("{}"), TEST_ENUM_VALUE) == "3");
+
+	//Chars and bools
+	TEST_VERIFY(string_format(FORMAT_STRING("{}{:c}{:d}{:3}|"), 'a', 'b', 'A', 'c') == "ab65c  |");
+	TEST_VERIFY(string_format(FORMAT_STRING("{} {:>6}"), true, false) == "true  false");
+
+	//Strings
+	TEST_VERIFY(string_format(FORMAT_STRING("{} {} {}"), "a", std::string("b"), std::string_view("c")) == "a b c");
+	TEST_VERIFY(string_format(FORMAT_STRING("{:.3}|{:>4}|{:-^7s}"), "abcdef", "ab", "ab") == "abc|  ab|--ab---");
+
+	//Floating point numbers
+	TEST_VERIFY(string_format(FORMAT_STRING("{} {} {}"), 1.5f, 0.1, 0.1f) == "1.5 0.1 0.1");
+	TEST_VERIFY(string_format(FORMAT_STRING("{:.3f} {:.2e} {:g}"), 3.14159, 1500.0, 0.0001) == "3.142 1.50e+03 0.0001");
+	TEST_VERIFY(string_format(FORMAT_STRING("{:08.2f}"), -1.5) == "-0001.50");
+	TEST_VERIFY(string_format(FORMAT_STRING("{:.0f}"), 1e20) == "100000000000000000000");
+
+	//Pointers
+	TEST_VERIFY(string_format(FORMAT_STRING("{}"), reinterpret_cast<void*>(0x1234)) == "0x1234");
+
+	//Appending to strings
+	{
+		std::string output = "a";
+		string_format_to(output, FORMAT_STRING("%{:02X}"), static_cast<unsigned char>(0xE9));
+		string_format_to(output, FORMAT_STRING("-{}"), 7);
+		TEST_VERIFY(output == "a%E9-7");
+	}
+
+	//Format buffers only use the heap past their size
+	{
+		Framework::CFormatBuffer<8> buffer;
+		string_format_to(buffer, FORMAT_STRING("{}-{}"), 12, 34);
+		TEST_VERIFY(!buffer.IsOnHeap());
+		TEST_VERIFY(buffer.GetView() == "12-34");
+		string_format_to(buffer, FORMAT_STRING("{}"), "abcdefgh");
+		TEST_VERIFY(buffer.IsOnHeap());
+		TEST_VERIFY(!strcmp(buffer.GetCString(), "12-34abcdefgh"));
+		buffer.Clear();
+		string_format_to(buffer, FORMAT_STRING("{:>300}"), 1);
+		TEST_VERIFY(buffer.GetSize() == 300);
+		TEST_VERIFY(buffer.ToString() == std::string(299, ' ') + "1");
+	}
+}
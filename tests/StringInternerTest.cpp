@@ -0,0 +1,92 @@
+#include "StringInternerTest.h"
+#include <cstring>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+#include "StringInterner.h"
+#include "TestDefs.h"
+#include "xml/Node.h"
+
+using namespace Framework;
+
+static void StringInternerTest_Basic()
+{
+	CInternedString empty;
+	TEST_VERIFY(empty.empty());
+	TEST_VERIFY(!strcmp(empty.c_str(), ""));
+	TEST_VERIFY(CInternedString("") == empty);
+
+	std::string text = "Content-Type";
+	CInternedString first(text);
+	CInternedString second("Content-Type");
+	TEST_VERIFY(first == second);
+	TEST_VERIFY(first.c_str() == second.c_str());
+	TEST_VERIFY(first.GetView() == "Content-Type");
+	TEST_VERIFY(first != CInternedString("content-type"));
+
+	//Doesn't depend on the source's lifetime
+	text = "Something else";
+	TEST_VERIFY(!strcmp(first.c_str(), "Content-Type"));
+
+	//Strings larger than a block
+	std::string largeText(0x20000, 'a');
+	CInternedString large(largeText);
+	TEST_VERIFY(large.GetView() == largeText);
+	TEST_VERIFY(large == CInternedString(largeText));
+
+	std::unordered_set<CInternedString> strings = { first, second, large };
+	TEST_VERIFY(strings.size() == 2);
+}
+
+static void StringInternerTest_Concurrent()
+{
+	//Threads interning the same strings get the same handles
+	const unsigned int threadCount = 4;
+	const unsigned int stringCount = 1000;
+	std::vector<std::vector<CInternedString>> results(threadCount);
+	std::vector<std::thread> threads;
+	for(unsigned int i = 0; i < threadCount; i++)
+	{
+		threads.emplace_back(
+			[&results, i] ()
+			{
+				for(unsigned int j = 0; j < stringCount; j++)
+				{
+					results[i].push_back(CInternedString("concurrent" + std::to_string(j)));
+				}
+			});
+	}
+	for(auto& thread : threads)
+	{
+		thread.join();
+	}
+	for(unsigned int j = 0; j < stringCount; j++)
+	{
+		TEST_VERIFY(results[0][j].GetView() == ("concurrent" + std::to_string(j)));
+		for(unsigned int i = 1; i < threadCount; i++)
+		{
+			TEST_VERIFY(results[i][j] == results[0][j]);
+		}
+	}
+}
+
+static void StringInternerTest_XmlNames()
+{
+	Xml::CNode root("root", true);
+	auto first = root.InsertTagNode("item");
+	auto second = root.InsertTagNode("item");
+	auto text = first->InsertTextNode("item");
+	TEST_VERIFY(first->GetName() == second->GetName());
+	TEST_VERIFY(first->GetText() == second->GetText());
+	TEST_VERIFY(!strcmp(first->GetText(), "item"));
+	TEST_VERIFY(text->GetName().empty());
+	TEST_VERIFY(!strcmp(text->GetText(), "item"));
+}
+
+void StringInternerTest_Execute()
+{
+	StringInternerTest_Basic();
+	StringInternerTest_Concurrent();
+	StringInternerTest_XmlNames();
+}
@@ -1,5 +1,6 @@
 #include "StringUtilsTest.h"
 #include <string>
+#include <vector>
 #include "StringUtils.h"
 #include "TestDefs.h"
 
@@ -8,6 +9,9 @@ void StringUtilsTest_Execute()
 	TEST_VERIFY(StringUtils::ReplaceAll("123", "2", "3") == "133");
 	TEST_VERIFY(StringUtils::ReplaceAll("123", "23", "1") == "11");
 	TEST_VERIFY(StringUtils::ReplaceAll("123232323", "23", "4") == "14444");
+	TEST_VERIFY(StringUtils::ReplaceAll("aaa", "a", "aa") == "aaaaaa");
+	TEST_VERIFY(StringUtils::ReplaceAll("abc", "", "x") == "abc");
+	TEST_VERIFY(StringUtils::EraseAll("a-b-c-", "-") == "abc");
 
 	TEST_VERIFY(StringUtils::Trim("") == "");
 	TEST_VERIFY(StringUtils::Trim("   ") == "");
@@ -38,4 +42,41 @@ void StringUtilsTest_Execute()
 		TEST_VERIFY(result.size() == 6);
 		TEST_VERIFY(result[5] == "6");
 	}
+
+	{
+		//Same tokens as std::getline would give
+		auto result = StringUtils::Split("a,,b,", ',');
+		TEST_VERIFY(result.size() == 3);
+		TEST_VERIFY(result[1].empty());
+		TEST_VERIFY(StringUtils::Split("", ',').empty());
+		TEST_VERIFY(StringUtils::Split(",", ',').size() == 1);
+	}
+
+	{
+		std::vector<std::string_view> tokens;
+		for(auto token : StringUtils::SplitView(" a : b:c ", ':', true))
+		{
+			tokens.push_back(token);
+		}
+		TEST_VERIFY(tokens.size() == 3);
+		TEST_VERIFY((tokens[0] == "a") && (tokens[1] == "b") && (tokens[2] == "c"));
+	}
+
+	{
+		std::string source = "  test  ";
+		auto view = StringUtils::TrimView(source);
+		TEST_VERIFY(view == "test");
+		TEST_VERIFY(view.data() == source.data() + 2);
+		TEST_VERIFY(StringUtils::TrimStartView(source) == "test  ");
+		TEST_VERIFY(StringUtils::TrimEndView(source) == "  test");
+		TEST_VERIFY(StringUtils::TrimView("   ").empty());
+	}
+
+	{
+		std::string value = "Content-Encoding: GZIP";
+		StringUtils::ToLowerInPlace(value);
+		TEST_VERIFY(value == "content-encoding: gzip");
+		TEST_VERIFY(StringUtils::Join({"a", "b", "c"}, ", ") == "a, b, c");
+		TEST_VERIFY(StringUtils::Join({}, ", ").empty());
+	}
 }
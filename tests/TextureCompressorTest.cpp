@@ -0,0 +1,438 @@
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+#include "TextureCompressorTest.h"
+#include "TestDefs.h"
+#include "ThreadPool.h"
+#include "bitmap/TextureCompressor.h"
+
+typedef Framework::CTextureCompressor CTextureCompressor;
+typedef uint8 DECODED_BLOCK[16][4];
+
+static const CTextureCompressor::FORMAT g_formats[] =
+{
+	CTextureCompressor::FORMAT_BC1,
+	CTextureCompressor::FORMAT_BC3,
+	CTextureCompressor::FORMAT_BC7,
+	CTextureCompressor::FORMAT_ETC2_RGB8,
+	CTextureCompressor::FORMAT_ETC2_RGBA8,
+};
+
+static uint8 ClampSample(int value)
+{
+	return static_cast<uint8>(std::min(std::max(value, 0), 255));
+}
+
+static uint64 ReadBigEndian64(const uint8* data)
+{
+	uint64 result = 0;
+	for(unsigned int i = 0; i < 8; i++)
+	{
+		result = (result << 8) | data[i];
+	}
+	return result;
+}
+
+static void DecodeBC1Color(const uint8* data, DECODED_BLOCK& block, bool alwaysFourColors)
+{
+	uint16 colors[2] = { static_cast<uint16>(data[0] | (data[1] << 8)), static_cast<uint16>(data[2] | (data[3] << 8)) };
+	uint8 palette[4][4] = {};
+	for(unsigned int i = 0; i < 2; i++)
+	{
+		unsigned int r = (colors[i] >> 11) & 0x1F;
+		unsigned int g = (colors[i] >> 5) & 0x3F;
+		unsigned int b = colors[i] & 0x1F;
+		palette[i][0] = static_cast<uint8>((r << 3) | (r >> 2));
+		palette[i][1] = static_cast<uint8>((g << 2) | (g >> 4));
+		palette[i][2] = static_cast<uint8>((b << 3) | (b >> 2));
+	}
+	bool fourColors = alwaysFourColors || (colors[0] > colors[1]);
+	for(unsigned int c = 0; c < 3; c++)
+	{
+		if(fourColors)
+		{
+			palette[2][c] = static_cast<uint8>((palette[0][c] * 2 + palette[1][c]) / 3);
+			palette[3][c] = static_cast<uint8>((palette[0][c] + palette[1][c] * 2) / 3);
+		}
+		else
+		{
+			palette[2][c] = static_cast<uint8>((palette[0][c] + palette[1][c]) / 2);
+		}
+	}
+	uint32 indices = data[4] | (data[5] << 8) | (data[6] << 16) | (static_cast<uint32>(data[7]) << 24);
+	for(unsigned int i = 0; i < 16; i++)
+	{
+		memcpy(block[i], palette[(indices >> (i * 2)) & 3], 3);
+		block[i][3] = 0xFF;
+	}
+}
+
+static void DecodeBC3Alpha(const uint8* data, DECODED_BLOCK& block)
+{
+	int values[8] = { data[0], data[1] };
+	if(data[0] > data[1])
+	{
+		for(int i = 1; i < 7; i++) values[i + 1] = ((7 - i) * data[0] + i * data[1]) / 7;
+	}
+	else
+	{
+		for(int i = 1; i < 5; i++) values[i + 1] = ((5 - i) * data[0] + i * data[1]) / 5;
+		values[6] = 0;
+		values[7] = 255;
+	}
+	uint64 indices = 0;
+	for(unsigned int i = 0; i < 6; i++) indices |= static_cast<uint64>(data[2 + i]) << (i * 8);
+	for(unsigned int i = 0; i < 16; i++)
+	{
+		block[i][3] = static_cast<uint8>(values[(indices >> (i * 3)) & 7]);
+	}
+}
+
+static void DecodeBC7(const uint8* data, DECODED_BLOCK& block)
+{
+	static const unsigned int weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+	unsigned int position = 0;
+	auto readBits =
+		[&] (unsigned int count)
+		{
+			unsigned int value = 0;
+			for(unsigned int i = 0; i < count; i++, position++)
+			{
+				value |= ((data[position / 8] >> (position % 8)) & 1) << i;
+			}
+			return value;
+		};
+	//Only mode 6 is expected
+	TEST_VERIFY(readBits(7) == 0x40);
+	unsigned int endpoints[2][4];
+	for(unsigned int c = 0; c < 4; c++)
+	{
+		endpoints[0][c] = readBits(7);
+		endpoints[1][c] = readBits(7);
+	}
+	for(unsigned int i = 0; i < 2; i++)
+	{
+		unsigned int pBit = readBits(1);
+		for(unsigned int c = 0; c < 4; c++) endpoints[i][c] = (endpoints[i][c] << 1) | pBit;
+	}
+	for(unsigned int i = 0; i < 16; i++)
+	{
+		unsigned int index = readBits((i == 0) ? 3 : 4);
+		for(unsigned int c = 0; c < 4; c++)
+		{
+			block[i][c] = static_cast<uint8>(((64 - weights[index]) * endpoints[0][c] + weights[index] * endpoints[1][c] + 32) >> 6);
+		}
+	}
+	TEST_VERIFY(position == 128);
+}
+
+static void DecodeEtc2Color(const uint8* data, DECODED_BLOCK& block)
+{
+	static const int modifiers[8][2] = { { 2, 8 }, { 5, 17 }, { 9, 29 }, { 13, 42 }, { 18, 60 }, { 24, 80 }, { 33, 106 }, { 47, 183 } };
+	uint64 bits = ReadBigEndian64(data);
+	bool differential = ((bits >> 33) & 1) != 0;
+	bool flip = ((bits >> 32) & 1) != 0;
+	int baseColors[2][3];
+	for(unsigned int c = 0; c < 3; c++)
+	{
+		unsigned int value = (bits >> (56 - c * 8)) & 0xFF;
+		if(differential)
+		{
+			int base = value >> 3;
+			int delta = static_cast<int>(value & 7) - ((value & 4) ? 8 : 0);
+			//Overflows select the other ETC2 modes, which aren't expected
+			TEST_VERIFY(((base + delta) >= 0) && ((base + delta) <= 31));
+			baseColors[0][c] = (base << 3) | (base >> 2);
+			baseColors[1][c] = ((base + delta) << 3) | ((base + delta) >> 2);
+		}
+		else
+		{
+			baseColors[0][c] = (value >> 4) * 0x11;
+			baseColors[1][c] = (value & 0xF) * 0x11;
+		}
+	}
+	unsigned int tables[2] = { static_cast<unsigned int>((bits >> 37) & 7), static_cast<unsigned int>((bits >> 34) & 7) };
+	for(unsigned int y = 0; y < 4; y++)
+	{
+		for(unsigned int x = 0; x < 4; x++)
+		{
+			unsigned int subblock = flip ? (y / 2) : (x / 2);
+			unsigned int pixelIndex = x * 4 + y;
+			unsigned int index = (((bits >> (pixelIndex + 16)) & 1) << 1) | ((bits >> pixelIndex) & 1);
+			int modifier = modifiers[tables[subblock]][index & 1];
+			if(index & 2) modifier = -modifier;
+			for(unsigned int c = 0; c < 3; c++)
+			{
+				block[y * 4 + x][c] = ClampSample(baseColors[subblock][c] + modifier);
+			}
+			block[y * 4 + x][3] = 0xFF;
+		}
+	}
+}
+
+static void DecodeEtc2Alpha(const uint8* data, DECODED_BLOCK& block)
+{
+	static const int modifiers[16][8] =
+	{
+		{ -3, -6, -9, -15, 2, 5, 8, 14 }, { -3, -7, -10, -13, 2, 6, 9, 12 }, { -2, -5, -8, -13, 1, 4, 7, 12 }, { -2, -4, -6, -13, 1, 3, 5, 12 },
+		{ -3, -6, -8, -12, 2, 5, 7, 11 }, { -3, -7, -9, -11, 2, 6, 8, 10 }, { -4, -7, -8, -11, 3, 6, 7, 10 }, { -3, -5, -8, -11, 2, 4, 7, 10 },
+		{ -2, -6, -8, -10, 1, 5, 7, 9 }, { -2, -5, -8, -10, 1, 4, 7, 9 }, { -2, -4, -8, -10, 1, 3, 7, 9 }, { -2, -5, -7, -10, 1, 4, 6, 9 },
+		{ -3, -4, -7, -10, 2, 3, 6, 9 }, { -1, -2, -3, -10, 0, 1, 2, 9 }, { -4, -6, -8, -9, 3, 5, 7, 8 }, { -3, -5, -7, -9, 2, 4, 6, 8 },
+	};
+	uint64 bits = ReadBigEndian64(data);
+	int base = static_cast<int>(bits >> 56);
+	int multiplier = static_cast<int>((bits >> 52) & 0xF);
+	unsigned int table = (bits >> 48) & 0xF;
+	TEST_VERIFY(multiplier != 0);
+	for(unsigned int i = 0; i < 16; i++)
+	{
+		unsigned int index = (bits >> (45 - i * 3)) & 7;
+		block[(i % 4) * 4 + (i / 4)][3] = ClampSample(base + modifiers[table][index] * multiplier);
+	}
+}
+
+static Framework::CBitmap Decode(const CTextureCompressor::LEVEL& level, CTextureCompressor::FORMAT format)
+{
+	Framework::CBitmap result(level.width, level.height, 32);
+	unsigned int blockWidth = (level.width + 3) / 4;
+	unsigned int blockHeight = (level.height + 3) / 4;
+	unsigned int blockSize = CTextureCompressor::GetBlockSize(format);
+	TEST_VERIFY(level.data.size() == (blockWidth * blockHeight * blockSize));
+	for(unsigned int blockY = 0; blockY < blockHeight; blockY++)
+	{
+		for(unsigned int blockX = 0; blockX < blockWidth; blockX++)
+		{
+			const uint8* data = level.data.data() + (blockY * blockWidth + blockX) * blockSize;
+			DECODED_BLOCK block;
+			switch(format)
+			{
+			case CTextureCompressor::FORMAT_BC1:
+				DecodeBC1Color(data, block, false);
+				break;
+			case CTextureCompressor::FORMAT_BC3:
+				DecodeBC1Color(data + 8, block, true);
+				DecodeBC3Alpha(data, block);
+				break;
+			case CTextureCompressor::FORMAT_BC7:
+				DecodeBC7(data, block);
+				break;
+			case CTextureCompressor::FORMAT_ETC2_RGB8:
+				DecodeEtc2Color(data, block);
+				break;
+			case CTextureCompressor::FORMAT_ETC2_RGBA8:
+				DecodeEtc2Color(data + 8, block);
+				DecodeEtc2Alpha(data, block);
+				break;
+			}
+			for(unsigned int y = 0; y < 4; y++)
+			{
+				for(unsigned int x = 0; x < 4; x++)
+				{
+					const uint8* pixel = block[y * 4 + x];
+					result.SetPixel(blockX * 4 + x, blockY * 4 + y, Framework::CColor(pixel[0], pixel[1], pixel[2], pixel[3]));
+				}
+			}
+		}
+	}
+	return result;
+}
+
+static double ComputePsnr(const Framework::CBitmap& bitmap1, const Framework::CBitmap& bitmap2, unsigned int channelCount)
+{
+	double error = 0;
+	for(unsigned int y = 0; y < bitmap1.GetHeight(); y++)
+	{
+		for(unsigned int x = 0; x < bitmap1.GetWidth(); x++)
+		{
+			auto color1 = bitmap1.GetPixel(x, y);
+			auto color2 = bitmap2.GetPixel(x, y);
+			uint8 samples1[4] = { color1.r, color1.g, color1.b, color1.a };
+			uint8 samples2[4] = { color2.r, color2.g, color2.b, color2.a };
+			for(unsigned int c = 0; c < channelCount; c++)
+			{
+				double diff = static_cast<double>(samples1[c]) - static_cast<double>(samples2[c]);
+				error += diff * diff;
+			}
+		}
+	}
+	double mse = error / (bitmap1.GetWidth() * bitmap1.GetHeight() * channelCount);
+	if(mse == 0) return 100.0;
+	return 10.0 * log10(255.0 * 255.0 / mse);
+}
+
+//Smooth gradients with a hard edge in the middle, size isn't a multiple of the block size
+static Framework::CBitmap MakeTestImage(unsigned int width, unsigned int height, unsigned int bpp)
+{
+	Framework::CBitmap bitmap(width, height, bpp);
+	for(unsigned int y = 0; y < height; y++)
+	{
+		for(unsigned int x = 0; x < width; x++)
+		{
+			uint8 r = static_cast<uint8>(x * 255 / (width - 1));
+			uint8 g = static_cast<uint8>(y * 255 / (height - 1));
+			uint8 b = (x < (width / 2)) ? 0x30 : 0xC0;
+			uint8 a = static_cast<uint8>(255 - (x + y) * 255 / (width + height - 2));
+			bitmap.SetPixel(x, y, Framework::CColor(r, g, b, a));
+		}
+	}
+	return bitmap;
+}
+
+static void SolidColorTest()
+{
+	Framework::CBitmap bitmap(8, 8, 32);
+	for(unsigned int y = 0; y < 8; y++)
+	{
+		for(unsigned int x = 0; x < 8; x++)
+		{
+			bitmap.SetPixel(x, y, Framework::CColor(0xFF, 0, 0, 0x80));
+		}
+	}
+
+	{
+		auto level = CTextureCompressor::Compress(bitmap, CTextureCompressor::FORMAT_BC1);
+		static const uint8 expectedBlock[8] = { 0x00, 0xF8, 0x00, 0xF8, 0x00, 0x00, 0x00, 0x00 };
+		TEST_VERIFY(level.data.size() == 32);
+		for(unsigned int i = 0; i < 4; i++)
+		{
+			TEST_VERIFY(memcmp(level.data.data() + i * 8, expectedBlock, 8) == 0);
+		}
+	}
+
+	{
+		auto level = CTextureCompressor::Compress(bitmap, CTextureCompressor::FORMAT_BC3);
+		static const uint8 expectedBlock[16] = { 0x80, 0x80, 0, 0, 0, 0, 0, 0, 0x00, 0xF8, 0x00, 0xF8, 0x00, 0x00, 0x00, 0x00 };
+		TEST_VERIFY(memcmp(level.data.data(), expectedBlock, 16) == 0);
+	}
+
+	//Other formats can't represent every solid color exactly, but can do white
+	memset(bitmap.GetPixels(), 0xFF, bitmap.GetPixelsSize());
+	for(auto format : g_formats)
+	{
+		auto decoded = Decode(CTextureCompressor::Compress(bitmap, format), format);
+		TEST_VERIFY(ComputePsnr(bitmap, decoded, 4) == 100.0);
+	}
+}
+
+static void QualityTest()
+{
+	Framework::CThreadPool threadPool(4);
+	for(unsigned int bpp = 24; bpp <= 32; bpp += 8)
+	{
+		auto bitmap = MakeTestImage(37, 29, bpp);
+		for(auto format : g_formats)
+		{
+			auto level = CTextureCompressor::Compress(bitmap, format);
+			TEST_VERIFY(level.width == 37);
+			TEST_VERIFY(level.height == 29);
+			TEST_VERIFY(level.data.size() == CTextureCompressor::GetLevelSize(format, 37, 29));
+			TEST_VERIFY(level.data.size() == (10 * 8 * CTextureCompressor::GetBlockSize(format)));
+
+			//Output doesn't depend on the thread pool
+			auto poolLevel = CTextureCompressor::Compress(bitmap, format, &threadPool);
+			TEST_VERIFY(level.data == poolLevel.data);
+
+			auto decoded = Decode(level, format);
+			TEST_VERIFY(ComputePsnr(bitmap, decoded, 3) > 32.0);
+
+			bool hasAlpha = (format == CTextureCompressor::FORMAT_BC3) || (format == CTextureCompressor::FORMAT_BC7) || (format == CTextureCompressor::FORMAT_ETC2_RGBA8);
+			if(hasAlpha)
+			{
+				//24 bpp images are opaque
+				auto alphaBitmap = (bpp == 32) ? bitmap : bitmap.AddAlphaChannel(0xFF);
+				TEST_VERIFY(ComputePsnr(alphaBitmap, decoded, 4) > 32.0);
+			}
+		}
+	}
+
+	//Colors on a line only suffer from endpoint and index precision, BC7 has the most of both
+	{
+		Framework::CBitmap bitmap(32, 32, 32);
+		for(unsigned int y = 0; y < 32; y++)
+		{
+			for(unsigned int x = 0; x < 32; x++)
+			{
+				unsigned int t = x * 5 + y * 2;
+				bitmap.SetPixel(x, y, Framework::CColor(t, t / 2 + 20, 230 - t, 255 - t / 2));
+			}
+		}
+		for(auto format : g_formats)
+		{
+			auto decoded = Decode(CTextureCompressor::Compress(bitmap, format), format);
+			double minPsnr = (format == CTextureCompressor::FORMAT_BC7) ? 48.0 : 34.0;
+			TEST_VERIFY(ComputePsnr(bitmap, decoded, 3) > minPsnr);
+		}
+	}
+
+	{
+		Framework::CBitmap bitmap(4, 4, 8);
+		bool threw = false;
+		try
+		{
+			CTextureCompressor::Compress(bitmap, CTextureCompressor::FORMAT_BC1);
+		}
+		catch(const std::exception&)
+		{
+			threw = true;
+		}
+		TEST_VERIFY(threw);
+	}
+}
+
+static void MipChainTest()
+{
+	Framework::CThreadPool threadPool(4);
+
+	//Box filter rounds averages to nearest
+	{
+		Framework::CBitmap bitmap(6, 2, 32);
+		for(unsigned int x = 0; x < 6; x++)
+		{
+			bitmap.SetPixel(x, 0, Framework::CColor(x * 10, 0xFF, 1, 0));
+			bitmap.SetPixel(x, 1, Framework::CColor(x * 20, 0, 2, 1));
+		}
+		auto mip = CTextureCompressor::GenerateMip(bitmap, CTextureCompressor::MIP_FILTER_BOX);
+		TEST_VERIFY(mip.GetWidth() == 3);
+		TEST_VERIFY(mip.GetHeight() == 1);
+		for(unsigned int x = 0; x < 3; x++)
+		{
+			auto color = mip.GetPixel(x, 0);
+			int expectedRed = (x * 2 * 10 + (x * 2 + 1) * 10 + x * 2 * 20 + (x * 2 + 1) * 20 + 2) / 4;
+			TEST_VERIFY(color.r == expectedRed);
+			TEST_VERIFY(color.g == 0x80);
+			TEST_VERIFY(color.b == 2);
+			TEST_VERIFY(color.a == 1);
+		}
+	}
+
+	for(auto filter : { CTextureCompressor::MIP_FILTER_BOX, CTextureCompressor::MIP_FILTER_KAISER })
+	{
+		auto bitmap = MakeTestImage(37, 29, 32);
+		auto levels = CTextureCompressor::CompressMipChain(bitmap, CTextureCompressor::FORMAT_BC3, filter, &threadPool);
+		static const unsigned int expectedSizes[][2] = { { 37, 29 }, { 18, 14 }, { 9, 7 }, { 4, 3 }, { 2, 1 }, { 1, 1 } };
+		TEST_VERIFY(levels.size() == 6);
+		for(unsigned int i = 0; i < levels.size(); i++)
+		{
+			TEST_VERIFY(levels[i].width == expectedSizes[i][0]);
+			TEST_VERIFY(levels[i].height == expectedSizes[i][1]);
+			TEST_VERIFY(levels[i].data.size() == CTextureCompressor::GetLevelSize(CTextureCompressor::FORMAT_BC3, expectedSizes[i][0], expectedSizes[i][1]));
+		}
+
+		//Mips of a smooth image stay close to a plain downscale of it
+		auto mip = CTextureCompressor::GenerateMip(bitmap, filter, &threadPool);
+		TEST_VERIFY(ComputePsnr(mip, bitmap.Resize(18, 14, Framework::CBitmap::RESIZE_FILTER_BILINEAR), 4) > 30.0);
+		TEST_VERIFY(ComputePsnr(mip, Decode(levels[1], CTextureCompressor::FORMAT_BC3), 4) > 27.0);
+
+		//Images that are already 1x1 have a single level
+		Framework::CBitmap pixel(1, 1, 24);
+		TEST_VERIFY(CTextureCompressor::CompressMipChain(pixel, CTextureCompressor::FORMAT_BC1, filter).size() == 1);
+	}
+}
+
+void TextureCompressorTest_Execute()
+{
+	SolidColorTest();
+	QualityTest();
+	MipChainTest();
+}
@@ -0,0 +1,505 @@
+#include "ThreadPoolTest.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include "AsyncStreamUtils.h"
+#include "PtrStream.h"
+#include "ParallelFor.h"
+#include "Task.h"
+#include "TaskGroup.h"
+#include "TestDefs.h"
+#include "ThreadPool.h"
+#include "ThreadUtils.h"
+#include "WorkStealingDeque.h"
+
+static void WorkStealingDequeTest()
+{
+	Framework::CWorkStealingDeque<int> deque(2);
+	int values[10] = {};
+	TEST_VERIFY(deque.IsEmpty());
+	TEST_VERIFY(deque.Take() == nullptr);
+	for(auto& value : values)
+	{
+		deque.Push(&value);
+	}
+	//Thieves take the oldest items, the owner the newest
+	TEST_VERIFY(deque.Steal() == &values[0]);
+	TEST_VERIFY(deque.Take() == &values[9]);
+	TEST_VERIFY(deque.Steal() == &values[1]);
+	for(unsigned int i = 0; i < 7; i++)
+	{
+		TEST_VERIFY(deque.Take() == &values[8 - i]);
+	}
+	TEST_VERIFY(deque.IsEmpty());
+	TEST_VERIFY(deque.Steal() == nullptr);
+}
+
+static void TaskTest()
+{
+	unsigned int count = 0;
+	Framework::CTask task([&count]() { count++; });
+	TEST_VERIFY(task.IsStoredInline());
+	task();
+	TEST_VERIFY(count == 1);
+
+	//Moving keeps the same function
+	Framework::CTask movedTask(std::move(task));
+	TEST_VERIFY(!task);
+	movedTask();
+	TEST_VERIFY(count == 2);
+
+	//Functions too big for the inline buffer go on the heap
+	std::array<uint8, Framework::CTask::INLINE_SIZE> bytes = {};
+	bytes[0] = 3;
+	Framework::CTask bigTask([&count, bytes]() { count += bytes[0]; });
+	TEST_VERIFY(!bigTask.IsStoredInline());
+	movedTask = std::move(bigTask);
+	movedTask();
+	TEST_VERIFY(count == 5);
+
+	//Move only captures are allowed and destroyed with the task
+	auto value = std::make_shared<int>(0);
+	{
+		Framework::CTask ownerTask([value = std::make_unique<std::shared_ptr<int>>(value)]() { (**value)++; });
+		ownerTask();
+		TEST_VERIFY(value.use_count() == 2);
+	}
+	TEST_VERIFY((*value == 1) && (value.use_count() == 1));
+}
+
+static void ThreadPoolTest_Tasks()
+{
+	std::atomic<unsigned int> count(0);
+	{
+		Framework::CThreadPool threadPool(4);
+		for(unsigned int i = 0; i < 10000; i++)
+		{
+			threadPool.Enqueue([&count]() { count++; });
+		}
+	}
+	//Everything is run before the pool goes away
+	TEST_VERIFY(count == 10000);
+}
+
+static void ThreadPoolTest_Placement()
+{
+	const auto& topology = Framework::ThreadUtils::GetCpuTopology();
+	TEST_VERIFY(!topology.processors.empty());
+	bool valid = true;
+	for(const auto& processor : topology.processors)
+	{
+		valid &= (processor.coreIndex < topology.coreCount);
+		valid &= (processor.nodeIndex < topology.nodeCount);
+	}
+	TEST_VERIFY(valid);
+	TEST_VERIFY(!topology.GetCoreProcessors(0).empty());
+
+	for(auto placement : {Framework::CThreadPool::PLACEMENT_CORE, Framework::CThreadPool::PLACEMENT_NODE})
+	{
+		std::atomic<unsigned int> count(0);
+		{
+			Framework::CThreadPool threadPool(4, placement);
+			for(unsigned int i = 0; i < 1000; i++)
+			{
+				threadPool.Enqueue([&count]() { count++; });
+			}
+		}
+		TEST_VERIFY(count == 1000);
+	}
+}
+
+static void ThreadPoolTest_NestedTasks()
+{
+	//Tasks enqueued from workers go in their local deques and have to be stolen by the others
+	std::atomic<unsigned int> count(0);
+	Framework::CThreadPool threadPool(4);
+	Framework::CTaskGroup taskGroup(&threadPool);
+	for(unsigned int i = 0; i < 16; i++)
+	{
+		taskGroup.Run(
+		    [&]() {
+			    for(unsigned int j = 0; j < 500; j++)
+			    {
+				    taskGroup.Run([&count]() { count++; });
+			    }
+		    });
+	}
+	taskGroup.Wait();
+	TEST_VERIFY(count == 16 * 500);
+}
+
+static void ThreadPoolTest_Submit()
+{
+	Framework::CThreadPool threadPool(2);
+	auto result = threadPool.Submit([]() { return 42; });
+	auto failure = threadPool.Submit([]() -> int { throw std::runtime_error("Failure."); });
+	TEST_VERIFY(result.get() == 42);
+	bool hasThrown = false;
+	try
+	{
+		failure.get();
+	}
+	catch(const std::runtime_error&)
+	{
+		hasThrown = true;
+	}
+	TEST_VERIFY(hasThrown);
+}
+
+static void ThreadPoolTest_NestedWait()
+{
+	//Only one worker, waiting on the inner group has to run its tasks
+	std::atomic<unsigned int> count(0);
+	Framework::CThreadPool threadPool(1);
+	auto result = threadPool.Submit(
+	    [&]() {
+		    Framework::CTaskGroup innerGroup(&threadPool);
+		    for(unsigned int i = 0; i < 100; i++)
+		    {
+			    innerGroup.Run([&count]() { count++; });
+		    }
+		    innerGroup.Wait();
+		    return count.load();
+	    });
+	TEST_VERIFY(result.get() == 100);
+}
+
+static void ThreadPoolTest_Priorities()
+{
+	//Single worker held back while tasks are queued
+	Framework::CThreadPool threadPool(1);
+	std::promise<void> release;
+	auto released = release.get_future().share();
+	threadPool.Enqueue([released]() { released.wait(); });
+
+	std::mutex orderMutex;
+	std::vector<Framework::CThreadPool::PRIORITY> order;
+	std::atomic<unsigned int> count(0);
+	for(unsigned int i = 0; i < 10; i++)
+	{
+		for(auto priority : {Framework::CThreadPool::PRIORITY_LOW, Framework::CThreadPool::PRIORITY_NORMAL, Framework::CThreadPool::PRIORITY_HIGH})
+		{
+			threadPool.Enqueue(
+			    [&orderMutex, &order, &count, priority]() {
+				    std::unique_lock<std::mutex> lock(orderMutex);
+				    order.push_back(priority);
+				    count++;
+			    },
+			    priority);
+		}
+	}
+	release.set_value();
+	while(count != 30)
+	{
+		std::this_thread::yield();
+	}
+
+	std::unique_lock<std::mutex> lock(orderMutex);
+	TEST_VERIFY(order.size() == 30);
+	for(unsigned int i = 0; i < 10; i++)
+	{
+		TEST_VERIFY(order[i] == Framework::CThreadPool::PRIORITY_HIGH);
+		TEST_VERIFY(order[i + 10] == Framework::CThreadPool::PRIORITY_NORMAL);
+	}
+}
+
+static void ThreadPoolTest_Starvation()
+{
+	//High priority tasks keep enqueuing more of themselves, the others still get to run
+	std::atomic<bool> lowDone(false);
+	std::atomic<bool> normalDone(false);
+	std::atomic<unsigned int> highCount(0);
+	std::function<void()> highTask;
+	//Goes away first, remaining tasks still use the above
+	Framework::CThreadPool threadPool(1);
+	highTask = [&]() {
+		if((lowDone && normalDone) || (++highCount == 10000)) return;
+		threadPool.Enqueue([&]() { highTask(); }, Framework::CThreadPool::PRIORITY_HIGH);
+	};
+	std::promise<void> release;
+	auto released = release.get_future().share();
+	threadPool.Enqueue([released]() { released.wait(); });
+	threadPool.Enqueue([&]() { highTask(); }, Framework::CThreadPool::PRIORITY_HIGH);
+	threadPool.Enqueue([&]() { lowDone = true; }, Framework::CThreadPool::PRIORITY_LOW);
+	threadPool.Enqueue([&]() { normalDone = true; }, Framework::CThreadPool::PRIORITY_NORMAL);
+	release.set_value();
+	while(!(lowDone && normalDone) && (highCount < 10000))
+	{
+		std::this_thread::yield();
+	}
+	TEST_VERIFY(lowDone && normalDone);
+	TEST_VERIFY(highCount < 100);
+}
+
+static void ThreadPoolTest_Cancellation()
+{
+	Framework::CThreadPool threadPool(1);
+	const Framework::CThreadPool::GroupId thumbnailGroup = 1;
+	std::atomic<unsigned int> count(0);
+
+	std::promise<void> release;
+	auto released = release.get_future().share();
+	threadPool.Enqueue([released]() { released.wait(); });
+	for(unsigned int i = 0; i < 100; i++)
+	{
+		threadPool.Enqueue([&count]() { count++; }, Framework::CThreadPool::PRIORITY_LOW, threadPool.GetGroupToken(thumbnailGroup));
+	}
+	auto dropped = threadPool.Submit([]() { return 1; }, Framework::CThreadPool::PRIORITY_NORMAL, threadPool.GetGroupToken(thumbnailGroup));
+	threadPool.CancelGroup(thumbnailGroup);
+	release.set_value();
+
+	//Dropped tasks break their future
+	bool broken = false;
+	try
+	{
+		dropped.get();
+	}
+	catch(const std::future_error& error)
+	{
+		broken = (error.code() == std::future_errc::broken_promise);
+	}
+	TEST_VERIFY(broken);
+
+	//Group gets a new token once cancelled
+	auto token = threadPool.GetGroupToken(thumbnailGroup);
+	TEST_VERIFY(!token.IsCancelled());
+	auto kept = threadPool.Submit([]() { return Framework::CThreadPool::IsCurrentTaskCancelled(); }, Framework::CThreadPool::PRIORITY_LOW, token);
+	TEST_VERIFY(!kept.get());
+	TEST_VERIFY(count == 0);
+
+	//Running tasks poll the token
+	std::atomic<bool> started(false);
+	auto polling = threadPool.Submit(
+	    [&started]() {
+		    started = true;
+		    while(!Framework::CThreadPool::IsCurrentTaskCancelled())
+		    {
+			    std::this_thread::yield();
+		    }
+		    return true;
+	    },
+	    Framework::CThreadPool::PRIORITY_HIGH, token);
+	while(!started)
+	{
+		std::this_thread::yield();
+	}
+	threadPool.CancelGroup(thumbnailGroup);
+	TEST_VERIFY(polling.get());
+	TEST_VERIFY(!Framework::CThreadPool::IsCurrentTaskCancelled());
+}
+
+static bool WaitForThreadCount(Framework::CThreadPool& threadPool, unsigned int threadCount)
+{
+	for(unsigned int i = 0; i < 1000; i++)
+	{
+		if(threadPool.GetThreadCount() == threadCount) return true;
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+	}
+	return false;
+}
+
+static void ThreadPoolTest_Elastic()
+{
+	//Busy worker, tasks keep coming: another worker is started for them
+	{
+		Framework::CThreadPool threadPool(1, 4, Framework::CThreadPool::PLACEMENT_NONE, 50);
+		TEST_VERIFY(threadPool.GetThreadCount() == 1);
+		TEST_VERIFY(threadPool.GetMaxThreadCount() == 4);
+		std::promise<void> release;
+		auto released = release.get_future().share();
+		threadPool.Enqueue([released]() { released.wait(); });
+		std::atomic<unsigned int> count(0);
+		unsigned int enqueuedCount = 0;
+		for(unsigned int i = 0; (i < 1000) && (count == 0); i++)
+		{
+			threadPool.Enqueue([&count]() { count++; });
+			enqueuedCount++;
+			std::this_thread::sleep_for(std::chrono::milliseconds(5));
+		}
+		TEST_VERIFY(count != 0);
+		TEST_VERIFY(threadPool.GetThreadCount() > 1);
+		release.set_value();
+
+		//Extra workers go away once idle
+		TEST_VERIFY(WaitForThreadCount(threadPool, 1));
+		TEST_VERIFY(count == enqueuedCount);
+	}
+
+	//No workers until there's something to do
+	{
+		Framework::CThreadPool threadPool(0, 2, Framework::CThreadPool::PLACEMENT_NONE, 20);
+		TEST_VERIFY(threadPool.GetThreadCount() == 0);
+		for(unsigned int i = 0; i < 3; i++)
+		{
+			auto result = threadPool.Submit([]() { return 7; });
+			TEST_VERIFY(result.get() == 7);
+			TEST_VERIFY(WaitForThreadCount(threadPool, 0));
+		}
+	}
+
+	//Tasks still queued when the pool goes away are run, even if no worker is left for them
+	{
+		std::atomic<unsigned int> count(0);
+		for(unsigned int i = 0; i < 100; i++)
+		{
+			Framework::CThreadPool threadPool(0, 1, Framework::CThreadPool::PLACEMENT_NONE, 1);
+			for(unsigned int j = 0; j < 10; j++)
+			{
+				threadPool.Enqueue([&count]() { count++; });
+			}
+		}
+		TEST_VERIFY(count == 1000);
+	}
+}
+
+static void ThreadPoolTest_BlockingScope()
+{
+	//First task blocks on the second one, the only worker is compensated by a new one
+	Framework::CThreadPool threadPool(1, 2);
+	std::promise<int> secondResult;
+	auto first = threadPool.Submit(
+	    [&secondResult]() {
+		    Framework::CThreadPool::CBlockingScope blockingScope;
+		    return secondResult.get_future().get();
+	    });
+	auto second = threadPool.Submit([&secondResult]() { secondResult.set_value(5); });
+	TEST_VERIFY(first.wait_for(std::chrono::seconds(10)) == std::future_status::ready);
+	TEST_VERIFY(first.get() == 5);
+	second.get();
+	TEST_VERIFY(threadPool.GetThreadCount() <= 2);
+
+	//Doesn't do anything outside of the pool
+	Framework::CThreadPool::CBlockingScope blockingScope;
+}
+
+static void ParallelForTest()
+{
+	Framework::CThreadPool threadPool(4);
+	for(auto pool : {static_cast<Framework::CThreadPool*>(nullptr), &threadPool})
+	{
+		std::vector<unsigned int> values(1000, 0);
+		Framework::ParallelFor(pool, 10, values.size(),
+		                       [&](size_t begin, size_t end) {
+			                       for(size_t i = begin; i < end; i++)
+			                       {
+				                       values[i]++;
+			                       }
+		                       });
+		bool matches = true;
+		for(size_t i = 0; i < values.size(); i++)
+		{
+			matches &= (values[i] == ((i < 10) ? 0 : 1));
+		}
+		TEST_VERIFY(matches);
+
+		auto sum = Framework::ParallelReduce(
+		    pool, 1, 1001, static_cast<uint64>(0),
+		    [](size_t begin, size_t end) {
+			    uint64 result = 0;
+			    for(size_t i = begin; i < end; i++)
+			    {
+				    result += i;
+			    }
+			    return result;
+		    },
+		    [](uint64 a, uint64 b) { return a + b; }, 7);
+		TEST_VERIFY(sum == 500500);
+
+		//Chunks are combined in order
+		auto text = Framework::ParallelReduce(
+		    pool, 0, 26, std::string(),
+		    [](size_t begin, size_t end) {
+			    std::string result;
+			    for(size_t i = begin; i < end; i++)
+			    {
+				    result += static_cast<char>('a' + i);
+			    }
+			    return result;
+		    },
+		    [](const std::string& a, const std::string& b) { return a + b; }, 3);
+		TEST_VERIFY(text == "abcdefghijklmnopqrstuvwxyz");
+	}
+}
+
+#if defined(FRAMEWORK_HAS_COROUTINES)
+
+static Framework::CAsyncTask<unsigned int> AddAsync(Framework::CThreadPool& threadPool, unsigned int a, unsigned int b)
+{
+	co_await threadPool.Schedule();
+	co_return a + b;
+}
+
+static Framework::CAsyncTask<unsigned int> SumAsync(Framework::CThreadPool& threadPool, unsigned int count)
+{
+	unsigned int sum = 0;
+	for(unsigned int i = 0; i < count; i++)
+	{
+		sum = co_await AddAsync(threadPool, sum, i);
+	}
+	co_return sum;
+}
+
+static Framework::CAsyncTask<> ThrowAsync(Framework::CThreadPool& threadPool)
+{
+	co_await threadPool.Schedule();
+	throw std::runtime_error("Failed");
+}
+
+static Framework::CAsyncTask<std::string> ReadAsync(Framework::CThreadPool& threadPool, Framework::CAsyncFileReader& reader, Framework::CStream& stream)
+{
+	char buffer[5] = {};
+	auto readSize = co_await Framework::AsyncRead(threadPool, stream, buffer, 5);
+	std::string result(buffer, readSize);
+	readSize = co_await Framework::AsyncRead(reader, stream, 6, buffer, 5);
+	result += std::string(buffer, readSize);
+	co_return result;
+}
+
+static void CoroutineTest()
+{
+	Framework::CThreadPool threadPool(4);
+	TEST_VERIFY(Framework::SyncWait(SumAsync(threadPool, 100)) == 4950);
+
+	bool hasThrown = false;
+	try
+	{
+		Framework::SyncWait(ThrowAsync(threadPool));
+	}
+	catch(const std::runtime_error&)
+	{
+		hasThrown = true;
+	}
+	TEST_VERIFY(hasThrown);
+
+	std::string text = "hello world";
+	Framework::CPtrStream stream(text.c_str(), text.size());
+	Framework::CAsyncFileReader reader(threadPool);
+	TEST_VERIFY(Framework::SyncWait(ReadAsync(threadPool, reader, stream)) == "helloworld");
+}
+
+#endif
+
+void ThreadPoolTest_Execute()
+{
+	WorkStealingDequeTest();
+	TaskTest();
+	ThreadPoolTest_Tasks();
+	ThreadPoolTest_Placement();
+	ThreadPoolTest_NestedTasks();
+	ThreadPoolTest_Submit();
+	ThreadPoolTest_NestedWait();
+	ThreadPoolTest_Priorities();
+	ThreadPoolTest_Starvation();
+	ThreadPoolTest_Cancellation();
+	ThreadPoolTest_Elastic();
+	ThreadPoolTest_BlockingScope();
+	ParallelForTest();
+#if defined(FRAMEWORK_HAS_COROUTINES)
+	CoroutineTest();
+#endif
+}
@@ -0,0 +1,149 @@
+#include "TimerTest.h"
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <random>
+#include <vector>
+#include "TestDefs.h"
+#include "ThreadPool.h"
+#include "TimerService.h"
+#include "TimerWheel.h"
+
+using namespace Framework;
+
+static void RunTasks(std::vector<CTask>& tasks)
+{
+	for(auto& task : tasks)
+	{
+		task();
+	}
+	tasks.clear();
+}
+
+static void TimerWheelTest()
+{
+	//Delays spread over all levels, and past the last one
+	CTimerWheel wheel(1000);
+	std::mt19937_64 random(42);
+	const unsigned int timerCount = 20000;
+	std::vector<uint64> expiryTicks(timerCount);
+	std::vector<uint64> firedTicks(timerCount, 0);
+	std::vector<CTimerWheel::TimerId> timerIds(timerCount);
+	uint64 currentTick = 1000;
+	for(unsigned int i = 0; i < timerCount; i++)
+	{
+		unsigned int shift = random() % 40;
+		expiryTicks[i] = currentTick + 1 + (random() & ((1ULL << shift) - 1));
+		timerIds[i] = wheel.Schedule(expiryTicks[i], [&firedTicks, &currentTick, i]() { firedTicks[i] = currentTick; });
+	}
+	TEST_VERIFY(wheel.GetTimerCount() == timerCount);
+
+	//Every third one is cancelled
+	for(unsigned int i = 0; i < timerCount; i += 3)
+	{
+		TEST_VERIFY(wheel.Cancel(timerIds[i]));
+		TEST_VERIFY(!wheel.Cancel(timerIds[i]));
+	}
+
+	//Steps to the next event, ticks in between must not have anything to do
+	std::vector<CTask> expiredTasks;
+	uint64 lastExpiry = *std::max_element(expiryTicks.begin(), expiryTicks.end());
+	while(wheel.GetTimerCount() != 0)
+	{
+		uint64 nextTick = wheel.GetNextEventTick();
+		TEST_VERIFY(nextTick > currentTick);
+		TEST_VERIFY(nextTick <= lastExpiry);
+		if(nextTick > currentTick + 1)
+		{
+			wheel.Advance(nextTick - 1, expiredTasks);
+			TEST_VERIFY(expiredTasks.empty());
+		}
+		currentTick = nextTick;
+		wheel.Advance(currentTick, expiredTasks);
+		RunTasks(expiredTasks);
+	}
+	TEST_VERIFY(wheel.GetNextEventTick() == ~0ULL);
+	for(unsigned int i = 0; i < timerCount; i++)
+	{
+		if((i % 3) == 0)
+		{
+			TEST_VERIFY(firedTicks[i] == 0);
+		}
+		else
+		{
+			TEST_VERIFY(firedTicks[i] == expiryTicks[i]);
+			TEST_VERIFY(!wheel.Cancel(timerIds[i]));
+		}
+	}
+}
+
+static void TimerWheelPeriodicTest()
+{
+	CTimerWheel wheel;
+	std::vector<uint64> firedTicks;
+	uint64 currentTick = 0;
+	auto timerId = wheel.Schedule(10, [&]() { firedTicks.push_back(currentTick); }, 100);
+	//Expired already, runs on the next advance
+	unsigned int lateCount = 0;
+	std::vector<CTask> expiredTasks;
+	wheel.Advance(5, expiredTasks);
+	RunTasks(expiredTasks);
+	wheel.Schedule(2, [&]() { lateCount++; });
+
+	//Large steps go through all expiries in between
+	for(currentTick = 6; currentTick <= 1000; currentTick++)
+	{
+		wheel.Advance(currentTick, expiredTasks);
+		RunTasks(expiredTasks);
+	}
+	TEST_VERIFY(lateCount == 1);
+	TEST_VERIFY(firedTicks.size() == 10);
+	for(unsigned int i = 0; i < firedTicks.size(); i++)
+	{
+		TEST_VERIFY(firedTicks[i] == 10 + (i * 100));
+	}
+	TEST_VERIFY(wheel.GetTimerCount() == 1);
+	TEST_VERIFY(wheel.Cancel(timerId));
+	wheel.Advance(5000, expiredTasks);
+	TEST_VERIFY(expiredTasks.empty());
+	TEST_VERIFY(wheel.GetCurrentTick() == 5000);
+}
+
+static void TimerServiceTest()
+{
+	CThreadPool threadPool(2);
+	CTimerService timerService(threadPool.GetExecutor());
+
+	auto start = std::chrono::steady_clock::now();
+	std::promise<std::chrono::steady_clock::time_point> fired;
+	timerService.Schedule(std::chrono::milliseconds(30), [&fired]() { fired.set_value(std::chrono::steady_clock::now()); });
+	std::atomic<bool> cancelledRan(false);
+	auto cancelledId = timerService.Schedule(std::chrono::milliseconds(20), [&cancelledRan]() { cancelledRan = true; });
+	TEST_VERIFY(timerService.Cancel(cancelledId));
+
+	std::atomic<unsigned int> periodicCount(0);
+	auto periodicId = timerService.SchedulePeriodic(std::chrono::milliseconds(5), [&periodicCount]() { periodicCount++; });
+
+	auto firedTime = fired.get_future().get();
+	TEST_VERIFY((firedTime - start) >= std::chrono::milliseconds(30));
+	while(periodicCount < 3)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	TEST_VERIFY(timerService.Cancel(periodicId));
+	TEST_VERIFY(!timerService.Cancel(periodicId));
+	TEST_VERIFY(!cancelledRan);
+
+	//Runs on the timer thread without an executor
+	CTimerService inlineTimerService;
+	std::promise<void> inlineFired;
+	inlineTimerService.Schedule(std::chrono::milliseconds(0), [&inlineFired]() { inlineFired.set_value(); });
+	inlineFired.get_future().get();
+}
+
+void TimerTest_Execute()
+{
+	TimerWheelTest();
+	TimerWheelPeriodicTest();
+	TimerServiceTest();
+}
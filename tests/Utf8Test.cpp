@@ -0,0 +1,93 @@
+#include "Utf8Test.h"
+#include <cstring>
+#include <string>
+#include "string_cast.h"
+#include "Utf8.h"
+#include "TestDefs.h"
+
+void Utf8Test_Execute()
+{
+	//"aé€😀" covers the 1, 2, 3 and 4 byte sequences
+	static const char* mixedUtf8 = "a\xC3\xA9\xE2\x82\xAC\xF0\x9F\x98\x80";
+	static const char16_t mixedUtf16[] = {u'a', 0x00E9, 0x20AC, 0xD83D, 0xDE00};
+	static const char32_t mixedUtf32[] = {U'a', 0x00E9, 0x20AC, 0x1F600};
+	size_t mixedUtf8Size = strlen(mixedUtf8);
+	{
+		TEST_VERIFY(Framework::Utf8::IsValid(mixedUtf8, mixedUtf8Size));
+		TEST_VERIFY(Framework::Utf8::GetUtf16Length(mixedUtf8, mixedUtf8Size) == 5);
+		TEST_VERIFY(Framework::Utf8::GetUtf32Length(mixedUtf8, mixedUtf8Size) == 4);
+		TEST_VERIFY(Framework::Utf8::GetUtf8Length(mixedUtf16, 5) == mixedUtf8Size);
+		TEST_VERIFY(Framework::Utf8::GetUtf8Length(mixedUtf32, 4) == mixedUtf8Size);
+
+		char16_t utf16[16] = {};
+		TEST_VERIFY(Framework::Utf8::ConvertToUtf16(mixedUtf8, mixedUtf8Size, utf16) == 5);
+		TEST_VERIFY(std::u16string(utf16, 5) == std::u16string(mixedUtf16, 5));
+		char32_t utf32[16] = {};
+		TEST_VERIFY(Framework::Utf8::ConvertToUtf32(mixedUtf8, mixedUtf8Size, utf32) == 4);
+		TEST_VERIFY(std::u32string(utf32, 4) == std::u32string(mixedUtf32, 4));
+
+		char utf8[32] = {};
+		TEST_VERIFY(Framework::Utf8::ConvertFromUtf16(mixedUtf16, 5, utf8) == mixedUtf8Size);
+		TEST_VERIFY(std::string(utf8, mixedUtf8Size) == mixedUtf8);
+		TEST_VERIFY(Framework::Utf8::ConvertFromUtf32(mixedUtf32, 4, utf8) == mixedUtf8Size);
+		TEST_VERIFY(std::string(utf8, mixedUtf8Size) == mixedUtf8);
+	}
+	{
+		//Invalid sequences are replaced, one '?' for each byte that can't start a sequence
+		struct INVALID_VECTOR
+		{
+			const char* input;
+			const char* output;
+		};
+
+		static const INVALID_VECTOR vectors[] =
+		{
+			{"a\x80" "b", "a?b"},
+			{"\xC0\xAF", "??"},
+			{"\xE0\x80\xAF", "???"},
+			{"\xED\xA0\x80", "???"},
+			{"\xF4\x90\x80\x80", "????"},
+			{"\xF5", "?"},
+			{"\xC3", "?"},
+			{"\xE2\x82", "??"},
+			{"\xE2\x82" "a", "??a"},
+		};
+
+		for(const auto& testVector : vectors)
+		{
+			TEST_VERIFY(!Framework::Utf8::IsValid(testVector.input, strlen(testVector.input)));
+			TEST_VERIFY(Framework::Utf8::ConvertFrom(std::string(testVector.input)) == string_cast<std::wstring>(testVector.output));
+		}
+	}
+	{
+		//Unpaired surrogates and values out of range on the UTF-16/UTF-32 side
+		static const char16_t badUtf16[] = {u'a', 0xD800, u'b', 0xDC00, 0xD83D};
+		char utf8[16] = {};
+		TEST_VERIFY(Framework::Utf8::GetUtf8Length(badUtf16, 5) == 5);
+		TEST_VERIFY(Framework::Utf8::ConvertFromUtf16(badUtf16, 5, utf8) == 5);
+		TEST_VERIFY(std::string(utf8, 5) == "a?b??");
+		static const char32_t badUtf32[] = {0xD800, 0x110000, U'c'};
+		TEST_VERIFY(Framework::Utf8::ConvertFromUtf32(badUtf32, 3, utf8) == 3);
+		TEST_VERIFY(std::string(utf8, 3) == "??c");
+	}
+	{
+		//Long enough to go through the ASCII fast paths, with non ASCII characters at every position
+		for(size_t position = 0; position < 70; position++)
+		{
+			std::string input(70, 'x');
+			input.insert(position, "\xF0\x9F\x98\x80");
+			auto wide = Framework::Utf8::ConvertFrom(input);
+			TEST_VERIFY(wide.size() == ((sizeof(wchar_t) == 2) ? 72 : 71));
+			TEST_VERIFY(Framework::Utf8::ConvertTo(wide) == input);
+			TEST_VERIFY(string_cast<std::string>(string_cast<std::wstring>(input)) == input);
+
+			std::u16string utf16(Framework::Utf8::GetUtf16Length(input.data(), input.size()), 0);
+			Framework::Utf8::ConvertToUtf16(input.data(), input.size(), &utf16[0]);
+			TEST_VERIFY((utf16[position] == 0xD83D) && (utf16[position + 1] == 0xDE00));
+			TEST_VERIFY(utf16[0] == ((position == 0) ? 0xD83D : u'x'));
+			std::string utf8(Framework::Utf8::GetUtf8Length(utf16.data(), utf16.size()), 0);
+			Framework::Utf8::ConvertFromUtf16(utf16.data(), utf16.size(), &utf8[0]);
+			TEST_VERIFY(utf8 == input);
+		}
+	}
+}
@@ -0,0 +1,3 @@
+#pragma once
+
+void Utf8Test_Execute();
@@ -2,12 +2,39 @@
 #include <string>
 #include <cstring>
 #include <cstdint>
+#include "MemStream.h"
 #include "PtrStream.h"
+#include "StdStream.h"
+#include "MappedFileStream.h"
+#include "ThreadPool.h"
+#include "xml/Document.h"
+#include "xml/NodeIndex.h"
 #include "xml/Parser.h"
+#include "xml/Scanner.h"
+#include "xml/Selector.h"
+#include "xml/StreamWriter.h"
+#include "xml/Writer.h"
+#include "xml/StreamParser.h"
 #include "xml/Utils.h"
 #include "TestDefs.h"
 
 static const char* g_escapeCharXml = "<root>Bacon &amp; Eggs</root>";
+static const char* g_streamXml =
+	"<?xml version=\"1.0\"?>"
+	"<!-- Comment with <tags> -->"
+	"<root version='2' name=\"A &amp; B\">"
+		"<skipped><child attr=\"/>\"/><child>Text<![CDATA[<raw>]]></child></skipped>"
+		"<item id=\"1\"/>"
+		"<item id=\"2\">Bacon &amp; Eggs<![CDATA[ & <more>]]></item>"
+	"</root>";
+
+static const char* g_mappedXml =
+	"<?xml version=\"1.0\"?>"
+	"<!-- Comment -->"
+	"<root name=\"A &amp; B\">"
+		"<item id=\"1\"/>"
+		"<item id=\"2\">Bacon &amp; Eggs</item>"
+	"</root>";
 
 void XmlTest_Execute()
 {
@@ -17,6 +44,21 @@ void XmlTest_Execute()
 		auto rootNode = node->Select("root");
 		TEST_VERIFY(!strcmp(rootNode->GetInnerText(), "Bacon & Eggs"));
 	}
+	{
+		//Document is parsed straight from the mapping
+		{
+			Framework::CStdStream output("test.xml", "wb");
+			output.Write(g_mappedXml, strlen(g_mappedXml));
+		}
+		Framework::CMappedFileStream input("test.xml");
+		auto node = Framework::Xml::CParser::ParseDocument(input);
+		TEST_VERIFY(node);
+		auto items = node->SelectNodes("root/item");
+		TEST_VERIFY(items.size() == 2);
+		TEST_VERIFY(!strcmp(items.back()->GetAttribute("id"), "2"));
+		TEST_VERIFY(!strcmp(items.back()->GetInnerText(), "Bacon & Eggs"));
+		TEST_VERIFY(input.GetRemainingLength() == 0);
+	}
 	{
 		static const int32 intValue = INT32_MAX;
 		auto node = std::make_unique<Framework::Xml::CNode>("AttribTest", true);
@@ -29,4 +71,267 @@ void XmlTest_Execute()
 		node->InsertAttribute(Framework::Xml::CreateAttributeInt64Value("TestInt64", int64Value));
 		TEST_VERIFY(Framework::Xml::GetAttributeInt64Value(node.get(), "TestInt64") == int64Value);
 	}
+	{
+		using Framework::Xml::CStreamParser;
+		Framework::CPtrStream input(g_streamXml, strlen(g_streamXml));
+		CStreamParser parser(input);
+		TEST_VERIFY(parser.Next() == CStreamParser::EVENT_START_ELEMENT);
+		TEST_VERIFY(parser.GetName() == "root");
+		TEST_VERIFY(parser.GetAttributes().size() == 2);
+		TEST_VERIFY(!strcmp(parser.GetAttribute("version"), "2"));
+		TEST_VERIFY(!strcmp(parser.GetAttribute("name"), "A & B"));
+		TEST_VERIFY(parser.GetAttribute("missing") == nullptr);
+
+		TEST_VERIFY(parser.Next() == CStreamParser::EVENT_START_ELEMENT);
+		TEST_VERIFY(parser.GetName() == "skipped");
+		parser.SkipSubtree();
+		TEST_VERIFY(parser.GetDepth() == 1);
+
+		std::string text;
+		std::string ids;
+		while(1)
+		{
+			auto event = parser.Next();
+			if(event == CStreamParser::EVENT_END_DOCUMENT) break;
+			if(event == CStreamParser::EVENT_START_ELEMENT)
+			{
+				TEST_VERIFY(parser.GetName() == "item");
+				ids += parser.GetAttribute("id");
+			}
+			else if(event == CStreamParser::EVENT_END_ELEMENT)
+			{
+				TEST_VERIFY((parser.GetName() == "item") || (parser.GetName() == "root"));
+			}
+			else if(event == CStreamParser::EVENT_TEXT)
+			{
+				text += parser.GetText();
+			}
+		}
+		TEST_VERIFY(ids == "12");
+		TEST_VERIFY(text == "Bacon & Eggs & <more>");
+		TEST_VERIFY(parser.GetDepth() == 0);
+	}
+	{
+		static const char* xml =
+			"<?xml version=\"1.0\"?>"
+			"<Config><!-- Settings -->"
+				"<Entry Name=\"A &amp; B\" Value=\"1\"/>"
+				"<Entry Name=\"C\" Value=\"\">Bacon &amp; Eggs</Entry>"
+				"<Group><Entry Name=\"D\"><![CDATA[<raw>]]></Entry></Group>"
+			"</Config>";
+		Framework::CPtrStream treeInput(xml, strlen(xml));
+		auto tree = Framework::Xml::CParser::ParseDocument(treeInput);
+		Framework::CPtrStream documentInput(xml, strlen(xml));
+		auto document = Framework::Xml::CDocument::ParseDocument(documentInput);
+		auto root = document->GetRoot();
+
+		auto treeEntries = tree->SelectNodes("Config/Entry");
+		auto documentEntries = root.SelectNodes("config/entry");
+		TEST_VERIFY(treeEntries.size() == 2);
+		TEST_VERIFY(documentEntries.size() == treeEntries.size());
+		auto treeEntry = treeEntries.begin();
+		for(const auto& documentEntry : documentEntries)
+		{
+			TEST_VERIFY(!strcmp(documentEntry.GetAttribute("Name"), (*treeEntry)->GetAttribute("Name")));
+			TEST_VERIFY(!strcmp(documentEntry.GetAttribute("Value"), (*treeEntry)->GetAttribute("Value")));
+			treeEntry++;
+		}
+		TEST_VERIFY(!strcmp(documentEntries[0].GetAttribute("Name"), "A & B"));
+		TEST_VERIFY(documentEntries[0].GetInnerText() == nullptr);
+		TEST_VERIFY(!strcmp(documentEntries[1].GetInnerText(), "Bacon & Eggs"));
+		TEST_VERIFY(documentEntries[1].GetAttribute("Missing") == nullptr);
+
+		auto groupEntry = root.Select("Config/Group/Entry");
+		TEST_VERIFY(groupEntry.IsValid());
+		TEST_VERIFY(!strcmp(groupEntry.GetText(), "Entry"));
+		TEST_VERIFY(!strcmp(groupEntry.GetInnerText(), "<raw>"));
+		TEST_VERIFY(groupEntry.GetParent().GetParent() == root.Select("Config"));
+		TEST_VERIFY(!root.Select("Config/Missing/Entry").IsValid());
+		TEST_VERIFY(root.Select("Config").GetChildCount() == 3);
+	}
+	{
+		static const char* xml =
+			"<Root>"
+				"<Group Id=\"1\"><Item Id=\"1\"/><Item Id=\"2\"/><Other/></Group>"
+				"<group Id=\"2\"><item Id=\"3\"/></group>"
+			"</Root>";
+		Framework::CPtrStream input(xml, strlen(xml));
+		auto document = Framework::Xml::CParser::ParseDocument(input);
+		Framework::Xml::CNodeIndex index(document.get());
+
+		Framework::Xml::CSelector itemSelector("root/GROUP/Item");
+		auto expectedNodes = document->SelectNodes("root/GROUP/Item");
+		TEST_VERIFY(expectedNodes.size() == 2);
+		TEST_VERIFY(itemSelector.SelectNodes(document.get()) == expectedNodes);
+		TEST_VERIFY(itemSelector.SelectNodes(document.get(), &index) == expectedNodes);
+		TEST_VERIFY(itemSelector.Select(document.get(), &index) == document->Select("root/GROUP/Item"));
+
+		Framework::Xml::CSelector groupSelector("Group");
+		auto rootNode = document->Select("Root");
+		TEST_VERIFY(groupSelector.SelectNodes(rootNode, &index) == rootNode->SelectNodes("Group"));
+		TEST_VERIFY(groupSelector.SelectNodes(rootNode, &index).size() == 2);
+		TEST_VERIFY(Framework::Xml::CSelector("Root/Missing/Item").Select(document.get(), &index) == nullptr);
+
+		const auto& items = index.GetNodes("ITEM");
+		TEST_VERIFY(items.size() == 3);
+		TEST_VERIFY(!strcmp(items[0]->GetAttribute("Id"), "1"));
+		TEST_VERIFY(!strcmp(items[2]->GetAttribute("Id"), "3"));
+		TEST_VERIFY(index.GetNodes("Missing").empty());
+	}
+	{
+		static const char* expectedXml =
+			"<Config Version=\"1\">\r\n"
+			"\t<Entry Name=\"A &amp; B\" />\r\n"
+			"\t<Entry Name=\"C\">&lt;Bacon&gt; &amp; Eggs</Entry>\r\n"
+			"\t<Group>\r\n"
+			"\t\t<Item />\r\n"
+			"\t</Group>\r\n"
+			"</Config>\r\n";
+
+		auto configNode = std::make_unique<Framework::Xml::CNode>("Config", true);
+		configNode->InsertAttribute("Version", "1");
+		configNode->InsertNode(std::make_unique<Framework::Xml::CNode>("Entry", true))->InsertAttribute("Name", "A & B");
+		auto entryNode = configNode->InsertNode(std::make_unique<Framework::Xml::CNode>("Entry", true));
+		entryNode->InsertAttribute("Name", "C");
+		entryNode->InsertTextNode("<Bacon> & Eggs");
+		configNode->InsertNode(std::make_unique<Framework::Xml::CNode>("Group", true))->InsertTagNode("Item");
+		Framework::CMemStream treeOutput;
+		Framework::Xml::CWriter::WriteDocument(treeOutput, configNode.get());
+		TEST_VERIFY(std::string(reinterpret_cast<const char*>(treeOutput.GetBuffer()), treeOutput.GetSize()) == expectedXml);
+
+		//Small buffer to go through flushes
+		Framework::CMemStream streamOutput;
+		{
+			Framework::Xml::CStreamWriter writer(streamOutput, 7);
+			writer.BeginElement("Config");
+			writer.Attribute("Version", "1");
+			writer.BeginElement("Entry");
+			writer.Attribute("Name", "A & B");
+			writer.EndElement();
+			writer.BeginElement("Entry");
+			writer.Attribute("Name", "C");
+			writer.Text("<Bacon> & Eggs");
+			writer.EndElement();
+			writer.BeginElement("Group");
+			writer.BeginElement("Item");
+			writer.EndElement();
+			writer.EndElement();
+			writer.EndElement();
+		}
+		TEST_VERIFY(std::string(reinterpret_cast<const char*>(streamOutput.GetBuffer()), streamOutput.GetSize()) == expectedXml);
+	}
+	{
+		//Matches at every offset to go through vector and scalar paths
+		static const char* textEndChars = "<&";
+		static const char* nameEndChars = " \t\r\n/>=";
+		static const char* tagEndChars = ">\"'";
+		for(unsigned int i = 0; i < 80; i++)
+		{
+			std::string text(80, 'a');
+			TEST_VERIFY(Framework::Xml::Scanner::FindTextEnd(text.data(), text.data() + i) == text.data() + i);
+			TEST_VERIFY(Framework::Xml::Scanner::FindNameEnd(text.data(), text.data() + i) == text.data() + i);
+			TEST_VERIFY(Framework::Xml::Scanner::FindTagEnd(text.data(), text.data() + i) == text.data() + i);
+			for(auto textEndChar = textEndChars; *textEndChar; textEndChar++)
+			{
+				text[i] = *textEndChar;
+				TEST_VERIFY(Framework::Xml::Scanner::FindTextEnd(text.data(), text.data() + text.size()) == text.data() + i);
+				TEST_VERIFY(Framework::Xml::Scanner::FindNameEnd(text.data(), text.data() + text.size()) == text.data() + text.size());
+			}
+			for(auto nameEndChar = nameEndChars; *nameEndChar; nameEndChar++)
+			{
+				text[i] = *nameEndChar;
+				TEST_VERIFY(Framework::Xml::Scanner::FindNameEnd(text.data(), text.data() + text.size()) == text.data() + i);
+				TEST_VERIFY(Framework::Xml::Scanner::FindTextEnd(text.data(), text.data() + text.size()) == text.data() + text.size());
+			}
+			for(auto tagEndChar = tagEndChars; *tagEndChar; tagEndChar++)
+			{
+				text[i] = *tagEndChar;
+				TEST_VERIFY(Framework::Xml::Scanner::FindTagEnd(text.data(), text.data() + text.size()) == text.data() + i);
+			}
+		}
+	}
+	{
+		//Large enough to be parsed in several chunks, with markup that could be mistaken for tags
+		std::string xml = "<?xml version=\"1.0\"?><!-- <Export> --><Export Version=\"1\">";
+		for(unsigned int i = 0; i < 40000; i++)
+		{
+			auto id = std::to_string(i);
+			xml += "<Item Id=\"" + id + "\" Note=\"a &gt; b\" Path='x/>y'><!-- <Item> --><Name>Name " + id + " &amp; more</Name>";
+			xml += "<Data><![CDATA[<raw " + id + ">]]></Data><Empty/></Item>\n";
+		}
+		xml += "</Export><!-- End -->";
+
+		Framework::CThreadPool threadPool(4);
+		auto sequential = Framework::Xml::CDocument::ParseDocument(std::vector<char>(xml.begin(), xml.end()));
+		auto parallel = Framework::Xml::CDocument::ParseDocument(std::vector<char>(xml.begin(), xml.end()), threadPool);
+		TEST_VERIFY(parallel->GetNodeCount() == sequential->GetNodeCount());
+		std::vector<std::pair<Framework::Xml::CDocumentNode, Framework::Xml::CDocumentNode>> nodes;
+		nodes.emplace_back(sequential->GetRoot(), parallel->GetRoot());
+		size_t nodeCount = 0;
+		while(!nodes.empty())
+		{
+			auto node = nodes.back();
+			nodes.pop_back();
+			nodeCount++;
+			TEST_VERIFY(node.first.GetTextView() == node.second.GetTextView());
+			TEST_VERIFY(node.first.IsTag() == node.second.IsTag());
+			TEST_VERIFY(node.first.GetChildCount() == node.second.GetChildCount());
+			TEST_VERIFY(node.first.GetAttributeCount() == node.second.GetAttributeCount());
+			for(unsigned int i = 0; i < node.first.GetAttributeCount(); i++)
+			{
+				TEST_VERIFY(!strcmp(node.first.GetAttributeName(i), node.second.GetAttributeName(i)));
+				TEST_VERIFY(!strcmp(node.first.GetAttributeValue(i), node.second.GetAttributeValue(i)));
+			}
+			auto secondChild = node.second.GetFirstChild();
+			for(auto firstChild = node.first.GetFirstChild(); firstChild; firstChild = firstChild.GetNextSibling())
+			{
+				TEST_VERIFY(secondChild.IsValid());
+				TEST_VERIFY(secondChild.GetParent() == node.second);
+				nodes.emplace_back(firstChild, secondChild);
+				secondChild = secondChild.GetNextSibling();
+			}
+			TEST_VERIFY(!secondChild.IsValid());
+		}
+		TEST_VERIFY(nodeCount == parallel->GetNodeCount());
+		//Items and the new lines after them
+		TEST_VERIFY(parallel->GetRoot().Select("Export").GetChildCount() == 80000);
+		auto items = parallel->GetRoot().SelectNodes("Export/Item");
+		TEST_VERIFY(items.size() == 40000);
+		TEST_VERIFY(!strcmp(items[39999].GetAttribute("Path"), "x/>y"));
+		TEST_VERIFY(!strcmp(items[39999].Select("Name").GetInnerText(), "Name 39999 & more"));
+
+		//Error in the middle of the document
+		auto position = xml.find("Name 25000 &amp; more</Name>");
+		xml.replace(xml.find("</Name>", position), 7, "</Nome>");
+		bool hasThrown = false;
+		try
+		{
+			Framework::Xml::CDocument::ParseDocument(std::vector<char>(xml.begin(), xml.end()), threadPool);
+		}
+		catch(const std::exception&)
+		{
+			hasThrown = true;
+		}
+		TEST_VERIFY(hasThrown);
+
+		//Small documents are parsed sequentially
+		auto small = Framework::Xml::CDocument::ParseDocument(std::vector<char>(g_streamXml, g_streamXml + strlen(g_streamXml)), threadPool);
+		TEST_VERIFY(small->GetRoot().SelectNodes("root/item").size() == 2);
+	}
+	{
+		//Mismatched closing tag
+		static const char* xml = "<root><item></root>";
+		Framework::CPtrStream input(xml, strlen(xml));
+		Framework::Xml::CStreamParser parser(input);
+		bool hasThrown = false;
+		try
+		{
+			while(parser.Next() != Framework::Xml::CStreamParser::EVENT_END_DOCUMENT);
+		}
+		catch(const std::exception&)
+		{
+			hasThrown = true;
+		}
+		TEST_VERIFY(hasThrown);
+	}
 }
@@ -0,0 +1,531 @@
+#include <cstddef>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "ZipTest.h"
+#include "TestDefs.h"
+#include "DeflateBackend.h"
+#include "HashUtils.h"
+#include "MappedFileStream.h"
+#include "MemStream.h"
+#include "PtrStream.h"
+#include "StdStream.h"
+#include "ThreadPool.h"
+#include "zip/ZipArchiveReader.h"
+#include "zip/ZipArchiveWriter.h"
+#include "zip/ZipDefs.h"
+
+typedef std::map<std::string, std::vector<uint8>> FileContents;
+
+class CBufferZipFile : public Framework::CZipFile
+{
+public:
+	CBufferZipFile(const char* name, const std::vector<uint8>& contents)
+	    : CZipFile(name)
+	    , m_contents(contents)
+	{
+	}
+
+	void Write(Framework::CStream& stream) override
+	{
+		stream.Write(m_contents.data(), m_contents.size());
+	}
+
+private:
+	std::vector<uint8> m_contents;
+};
+
+//Output that can only be written to front to back, like a socket
+class CSequentialOutputStream : public Framework::CStream
+{
+public:
+	void Seek(int64, Framework::STREAM_SEEK_DIRECTION) override
+	{
+		throw std::runtime_error("Unsupported operation.");
+	}
+
+	uint64 Tell() override
+	{
+		throw std::runtime_error("Unsupported operation.");
+	}
+
+	uint64 Read(void*, uint64) override
+	{
+		throw std::runtime_error("Unsupported operation.");
+	}
+
+	uint64 Write(const void* buffer, uint64 size) override
+	{
+		auto bytes = reinterpret_cast<const uint8*>(buffer);
+		data.insert(data.end(), bytes, bytes + size);
+		return size;
+	}
+
+	bool IsEOF() override
+	{
+		return false;
+	}
+
+	std::vector<uint8> data;
+};
+
+static FileContents MakeFiles()
+{
+	FileContents files;
+	uint32 seed = 1;
+	for(unsigned int i = 0; i < 64; i++)
+	{
+		//Mix of empty, small and compressible entries
+		std::vector<uint8> contents((i * i * 37) % 20000);
+		for(auto& value : contents)
+		{
+			seed = (seed * 1103515245) + 12345;
+			value = static_cast<uint8>((seed >> 16) & 0x0F);
+		}
+		files["file" + std::to_string(i) + ".bin"] = std::move(contents);
+	}
+	return files;
+}
+
+static std::vector<uint8> MakeArchive(const FileContents& files, Framework::CThreadPool* threadPool = nullptr, uint64 memoryCap = Framework::CZipArchiveWriter::DEFAULT_MEMORY_CAP)
+{
+	Framework::CZipArchiveWriter writer;
+	unsigned int index = 0;
+	for(const auto& file : files)
+	{
+		auto zipFile = std::make_unique<CBufferZipFile>(file.first.c_str(), file.second);
+		zipFile->SetCompressionLevel(index++ % 10);
+		writer.InsertFile(std::move(zipFile));
+	}
+	Framework::CMemStream stream;
+	if(threadPool)
+	{
+		writer.Write(stream, *threadPool, memoryCap);
+	}
+	else
+	{
+		writer.Write(stream);
+	}
+	return std::vector<uint8>(stream.GetBuffer(), stream.GetBuffer() + stream.GetSize());
+}
+
+static FileContents Extract(Framework::CStream& stream, bool verifyCrc, Framework::CThreadPool* threadPool)
+{
+	FileContents result;
+	std::mutex resultMutex;
+	Framework::CZipArchiveReader reader(stream);
+	reader.ExtractAll(
+	    [&](const std::string& name, const uint8* data, size_t size) {
+		    std::lock_guard<std::mutex> lock(resultMutex);
+		    result[name] = std::vector<uint8>(data, data + size);
+	    },
+	    verifyCrc, threadPool);
+	return result;
+}
+
+void ZipTest_Execute()
+{
+	auto files = MakeFiles();
+	auto archive = MakeArchive(files);
+
+	Framework::CThreadPool threadPool(4);
+
+	//Parallel writer produces the same archive, whatever the memory cap
+	TEST_VERIFY(MakeArchive(files, &threadPool) == archive);
+	TEST_VERIFY(MakeArchive(files, &threadPool, 1) == archive);
+
+	//Positional reads, with and without a thread pool
+	{
+		Framework::CPtrStream stream(archive.data(), archive.size());
+		TEST_VERIFY(Extract(stream, true, &threadPool) == files);
+		TEST_VERIFY(Extract(stream, true, nullptr) == files);
+	}
+
+	//Sequential reads
+	{
+		auto buffer = archive;
+		Framework::CMemStream stream(std::move(buffer));
+		TEST_VERIFY(Extract(stream, true, &threadPool) == files);
+	}
+
+	//Mapped archive, the directory is indexed in place
+	{
+		{
+			Framework::CStdStream output("test.zip", "wb");
+			output.Write(archive.data(), archive.size());
+		}
+		Framework::CMappedFileStream stream("test.zip");
+		TEST_VERIFY(Extract(stream, true, &threadPool) == files);
+
+		//Entries are inflated from the mapping, read them in small chunks
+		Framework::CZipArchiveReader reader(stream);
+		for(const auto& fileName : { "file0.bin", "file7.bin", "file63.bin" })
+		{
+			std::vector<uint8> contents;
+			auto fileStream = reader.BeginReadFile(fileName);
+			while(!fileStream->IsEOF())
+			{
+				uint8 buffer[333];
+				auto amountRead = fileStream->Read(buffer, sizeof(buffer));
+				contents.insert(contents.end(), buffer, buffer + amountRead);
+			}
+			TEST_VERIFY(contents == files[fileName]);
+		}
+	}
+
+	//Subset of the entries
+	{
+		Framework::CPtrStream stream(archive.data(), archive.size());
+		Framework::CZipArchiveReader reader(stream);
+		auto fileNames = reader.GetFileNameList("file1[0-9]\\.bin");
+		TEST_VERIFY(fileNames.size() == 10);
+		unsigned int extractedCount = 0;
+		std::mutex countMutex;
+		reader.ExtractMany(fileNames,
+		    [&](const std::string& name, const uint8* data, size_t size) {
+			    const auto& expected = files[name];
+			    TEST_VERIFY((size == expected.size()) && (size == 0 || !memcmp(data, expected.data(), size)));
+			    std::lock_guard<std::mutex> lock(countMutex);
+			    extractedCount++;
+		    },
+		    true, &threadPool);
+		TEST_VERIFY(extractedCount == 10);
+	}
+
+	//Directory index lookups
+	{
+		FileContents indexFiles;
+		indexFiles["dir/b.txt"] = { 'b' };
+		indexFiles["dir/a.txt"] = { 'a' };
+		indexFiles["dir/sub/c.txt"] = { 'c' };
+		indexFiles["dirx.txt"] = { 'x' };
+		indexFiles["root.txt"] = { 'r' };
+		auto indexArchive = MakeArchive(indexFiles);
+		Framework::CPtrStream stream(indexArchive.data(), indexArchive.size());
+		Framework::CZipArchiveReader reader(stream);
+
+		auto names = reader.GetFileNamesWithPrefix("dir/");
+		TEST_VERIFY(names.size() == 3);
+		TEST_VERIFY((names[0] == "dir/a.txt") && (names[1] == "dir/b.txt") && (names[2] == "dir/sub/c.txt"));
+		TEST_VERIFY(reader.GetFileNamesWithPrefix("dir").size() == 4);
+		TEST_VERIFY(reader.GetFileNamesWithPrefix("").size() == 5);
+		TEST_VERIFY(reader.GetFileNamesWithPrefix("zzz").empty());
+
+		TEST_VERIFY(reader.GetFileHeader("root.txt") != nullptr);
+		TEST_VERIFY(reader.GetFileHeader("root.tx") == nullptr);
+		TEST_VERIFY(reader.GetFileHeader("dir/sub/c.txt")->uncompressedSize == 1);
+		TEST_VERIFY(reader.GetFileHeaders().size() == 5);
+		TEST_VERIFY(reader.GetFileHeaders().begin()->first == "dir/a.txt");
+	}
+
+	//Compression method selection
+	{
+		FileContents methodFiles;
+		uint32 seed = 7;
+		std::vector<uint8> random(0x20000);
+		for(auto& value : random)
+		{
+			seed = (seed * 1103515245) + 12345;
+			value = static_cast<uint8>(seed >> 16);
+		}
+		std::string text;
+		while(text.size() < 0x20000)
+		{
+			text += "The quick brown fox jumps over the lazy dog. ";
+		}
+		methodFiles["random.bin"] = random;
+		methodFiles["text.txt"] = std::vector<uint8>(text.begin(), text.end());
+		methodFiles["zstd.txt"] = methodFiles["text.txt"];
+		methodFiles["zstd_empty.txt"] = std::vector<uint8>();
+
+		auto makeMethodArchive =
+		    [&](Framework::CThreadPool* threadPool) {
+			    Framework::CZipArchiveWriter writer;
+			    for(const auto& file : methodFiles)
+			    {
+				    auto zipFile = std::make_unique<CBufferZipFile>(file.first.c_str(), file.second);
+				    zipFile->SetStoreIncompressible(true);
+				    if(file.first.compare(0, 4, "zstd") == 0)
+				    {
+					    zipFile->SetCompressionMethod(Framework::CZipFile::COMPRESSION_METHOD_ZSTD);
+				    }
+				    writer.InsertFile(std::move(zipFile));
+			    }
+			    Framework::CMemStream stream;
+			    if(threadPool)
+			    {
+				    writer.Write(stream, *threadPool);
+			    }
+			    else
+			    {
+				    writer.Write(stream);
+			    }
+			    return std::vector<uint8>(stream.GetBuffer(), stream.GetBuffer() + stream.GetSize());
+		    };
+
+		auto methodArchive = makeMethodArchive(nullptr);
+		TEST_VERIFY(makeMethodArchive(&threadPool) == methodArchive);
+
+		Framework::CPtrStream stream(methodArchive.data(), methodArchive.size());
+		TEST_VERIFY(Extract(stream, true, &threadPool) == methodFiles);
+
+		Framework::CZipArchiveReader reader(stream);
+		TEST_VERIFY(reader.GetFileHeader("random.bin")->compressionMethod == Framework::Zip::COMPRESSION_METHOD::STORE);
+		TEST_VERIFY(reader.GetFileHeader("random.bin")->compressedSize == random.size());
+		TEST_VERIFY(reader.GetFileHeader("text.txt")->compressionMethod != Framework::Zip::COMPRESSION_METHOD::STORE);
+		TEST_VERIFY(reader.GetFileHeader("text.txt")->compressedSize < text.size());
+		TEST_VERIFY(reader.GetFileHeader("zstd.txt")->compressionMethod == Framework::Zip::COMPRESSION_METHOD::ZSTD);
+		TEST_VERIFY(reader.GetFileHeader("zstd.txt")->compressedSize < text.size());
+
+		//Streamed zstd reads, in small chunks
+		{
+			std::vector<uint8> contents;
+			auto fileStream = reader.BeginReadFile("zstd.txt");
+			while(!fileStream->IsEOF())
+			{
+				uint8 buffer[1000];
+				auto amountRead = fileStream->Read(buffer, sizeof(buffer));
+				contents.insert(contents.end(), buffer, buffer + amountRead);
+			}
+			TEST_VERIFY(contents == methodFiles["zstd.txt"]);
+		}
+	}
+
+	//Every available deflate backend produces data the others can read
+	{
+		std::string text;
+		while(text.size() < 0x80000)
+		{
+			text += "The quick brown fox jumps over the lazy dog. " + std::to_string(text.size());
+		}
+		std::vector<uint8> input(text.begin(), text.end());
+		for(auto backend : Framework::Deflate::GetBackends())
+		{
+			for(int level : { 0, 1, static_cast<int>(Framework::Deflate::DEFAULT_LEVEL), 9 })
+			{
+				auto compressor = backend->CreateCompressor(level);
+				if(!compressor) continue;
+				std::vector<uint8> compressed(input.size() * 2 + 0x100);
+				const uint8* in = input.data();
+				size_t inSize = input.size();
+				uint8* out = compressed.data();
+				size_t outSize = compressed.size();
+				while(!compressor->Compress(in, inSize, out, outSize, true))
+				{
+				}
+				compressed.resize(compressed.size() - outSize);
+
+				auto decompressor = Framework::Deflate::GetZlibBackend().CreateDecompressor();
+				std::vector<uint8> output(input.size());
+				in = compressed.data();
+				inSize = compressed.size();
+				out = output.data();
+				outSize = output.size();
+				TEST_VERIFY(decompressor->Decompress(in, inSize, out, outSize));
+				TEST_VERIFY((outSize == 0) && (output == input));
+			}
+		}
+		TEST_VERIFY(Framework::Deflate::GetBackends().back() == &Framework::Deflate::GetZlibBackend());
+	}
+
+	//Corrupt the CRC of the last directory entry, only noticed when verification is enabled
+	{
+		auto corrupted = archive;
+		Framework::Zip::ZIPDIRENDHEADER dirEndHeader;
+		memcpy(&dirEndHeader, corrupted.data() + corrupted.size() - sizeof(dirEndHeader), sizeof(dirEndHeader));
+		size_t entryOffset = dirEndHeader.dirStartOffset;
+		for(unsigned int i = 1; i < dirEndHeader.dirEntryCount; i++)
+		{
+			Framework::Zip::ZIPDIRFILEHEADER dirFileHeader;
+			memcpy(&dirFileHeader, corrupted.data() + entryOffset, sizeof(dirFileHeader));
+			entryOffset += sizeof(dirFileHeader) + dirFileHeader.fileNameLength;
+		}
+		corrupted[entryOffset + offsetof(Framework::Zip::ZIPDIRFILEHEADER, crc)] ^= 0xFF;
+
+		Framework::CPtrStream stream(corrupted.data(), corrupted.size());
+		bool failed = false;
+		try
+		{
+			Extract(stream, true, &threadPool);
+		}
+		catch(const std::exception&)
+		{
+			failed = true;
+		}
+		TEST_VERIFY(failed);
+		TEST_VERIFY(Extract(stream, false, &threadPool) == files);
+	}
+
+	//Streamed archive, sizes are in data descriptors
+	{
+		Framework::CZipArchiveWriter writer;
+		for(const auto& file : files)
+		{
+			writer.InsertFile(std::make_unique<CBufferZipFile>(file.first.c_str(), file.second));
+		}
+		CSequentialOutputStream output;
+		writer.WriteStreamed(output);
+
+		Framework::CPtrStream stream(output.data.data(), output.data.size());
+		TEST_VERIFY(Extract(stream, true, &threadPool) == files);
+		Framework::CZipArchiveReader reader(stream);
+		TEST_VERIFY((reader.GetFileHeader("file1.bin")->flags & Framework::Zip::FLAG_DATA_DESCRIPTOR) != 0);
+
+		//Compaction writes the sizes in the local headers instead
+		Framework::CMemStream compacted;
+		Framework::CZipArchiveWriter::Compact(stream, compacted);
+		TEST_VERIFY(compacted.GetSize() == (output.data.size() - (files.size() * sizeof(Framework::Zip::ZIPDATADESCRIPTOR))));
+		compacted.Seek(0, Framework::STREAM_SEEK_SET);
+		TEST_VERIFY(Extract(compacted, true, &threadPool) == files);
+	}
+
+	//Appending replaces and adds entries without touching the others, compaction drops what's left behind
+	{
+		auto expected = files;
+		expected["file3.bin"] = std::vector<uint8>(1000, 3);
+		expected["added.bin"] = std::vector<uint8>(2000, 4);
+
+		auto append =
+		    [&](Framework::CThreadPool* threadPool) {
+			    Framework::CMemStream stream;
+			    stream.Write(archive.data(), archive.size());
+			    Framework::CZipArchiveWriter writer;
+			    writer.InsertFile(std::make_unique<CBufferZipFile>("file3.bin", expected["file3.bin"]));
+			    writer.InsertFile(std::make_unique<CBufferZipFile>("added.bin", expected["added.bin"]));
+			    if(threadPool)
+			    {
+				    writer.Append(stream, *threadPool);
+			    }
+			    else
+			    {
+				    writer.Append(stream);
+			    }
+			    return std::vector<uint8>(stream.GetBuffer(), stream.GetBuffer() + stream.GetSize());
+		    };
+
+		auto appended = append(nullptr);
+		TEST_VERIFY(append(&threadPool) == appended);
+		TEST_VERIFY(memcmp(appended.data(), archive.data(), archive.size()) == 0);
+
+		Framework::CPtrStream stream(appended.data(), appended.size());
+		TEST_VERIFY(Extract(stream, true, &threadPool) == expected);
+
+		Framework::CMemStream compacted;
+		Framework::CZipArchiveWriter::Compact(stream, compacted);
+		TEST_VERIFY(compacted.GetSize() < appended.size());
+		compacted.Seek(0, Framework::STREAM_SEEK_SET);
+		TEST_VERIFY(Extract(compacted, true, &threadPool) == expected);
+	}
+
+	//More entries than the directory header can count, goes through the ZIP64 directory header
+	{
+		const unsigned int entryCount = 0x10010;
+		Framework::CZipArchiveWriter writer;
+		for(unsigned int i = 0; i < entryCount; i++)
+		{
+			auto zipFile = std::make_unique<CBufferZipFile>(std::to_string(i).c_str(), std::vector<uint8>(i % 3, static_cast<uint8>(i)));
+			zipFile->SetCompressionMethod(Framework::CZipFile::COMPRESSION_METHOD_STORE);
+			writer.InsertFile(std::move(zipFile));
+		}
+		Framework::CMemStream stream;
+		writer.Write(stream);
+
+		Framework::Zip::ZIPDIRENDHEADER dirEndHeader;
+		memcpy(&dirEndHeader, stream.GetBuffer() + stream.GetSize() - sizeof(dirEndHeader), sizeof(dirEndHeader));
+		TEST_VERIFY(dirEndHeader.dirEntryCount == 0xFFFF);
+
+		stream.Seek(0, Framework::STREAM_SEEK_SET);
+		Framework::CZipArchiveReader reader(stream);
+		TEST_VERIFY(reader.GetFileNamesWithPrefix("").size() == entryCount);
+		auto data = reader.BeginReadFile("65540");
+		uint8 buffer[4] = {};
+		TEST_VERIFY((data->Read(buffer, sizeof(buffer)) == 2) && (buffer[1] == static_cast<uint8>(65540)));
+	}
+
+	//Sizes and offset in the ZIP64 field of directory entries
+	{
+		const char fileName[] = "big.bin";
+		const char contents[] = "ZIP64 entry";
+		uint32 contentsSize = sizeof(contents) - 1;
+		std::vector<uint8> zip64Archive;
+		auto append =
+		    [&](const void* data, size_t size) {
+			    auto bytes = reinterpret_cast<const uint8*>(data);
+			    zip64Archive.insert(zip64Archive.end(), bytes, bytes + size);
+		    };
+
+		Framework::Zip::ZIPFILEHEADER fileHeader = {};
+		fileHeader.signature = Framework::Zip::FILEHEADER_SIG;
+		fileHeader.versionNeeded = Framework::Zip::VERSION_ZIP64;
+		fileHeader.compressionMethod = Framework::Zip::COMPRESSION_METHOD::STORE;
+		fileHeader.crc = Framework::HashUtils::ComputeCrc32(contents, contentsSize);
+		fileHeader.compressedSize = Framework::Zip::ZIP64_MARKER32;
+		fileHeader.uncompressedSize = Framework::Zip::ZIP64_MARKER32;
+		fileHeader.fileNameLength = sizeof(fileName) - 1;
+		fileHeader.extraFieldLength = sizeof(Framework::Zip::ZIPLOCALZIP64FIELD);
+		Framework::Zip::ZIPLOCALZIP64FIELD localField = {};
+		localField.header.id = Framework::Zip::EXTRAFIELD_ID_ZIP64;
+		localField.header.size = 16;
+		localField.uncompressedSize = contentsSize;
+		localField.compressedSize = contentsSize;
+		append(&fileHeader, sizeof(fileHeader));
+		append(fileName, sizeof(fileName) - 1);
+		append(&localField, sizeof(localField));
+		append(contents, contentsSize);
+
+		uint64 dirStart = zip64Archive.size();
+		Framework::Zip::ZIPDIRFILEHEADER dirFileHeader = {};
+		dirFileHeader.signature = Framework::Zip::DIRFILEHEADER_SIG;
+		dirFileHeader.versionNeeded = Framework::Zip::VERSION_ZIP64;
+		dirFileHeader.compressionMethod = Framework::Zip::COMPRESSION_METHOD::STORE;
+		dirFileHeader.crc = fileHeader.crc;
+		dirFileHeader.compressedSize = Framework::Zip::ZIP64_MARKER32;
+		dirFileHeader.uncompressedSize = Framework::Zip::ZIP64_MARKER32;
+		dirFileHeader.fileStartOffset = Framework::Zip::ZIP64_MARKER32;
+		dirFileHeader.fileNameLength = sizeof(fileName) - 1;
+		//Unknown field before the ZIP64 one is skipped
+		Framework::Zip::ZIPEXTRAFIELDHEADER otherField = {0x7875, 4};
+		Framework::Zip::ZIPEXTRAFIELDHEADER zip64Field = {Framework::Zip::EXTRAFIELD_ID_ZIP64, 24};
+		uint64 zip64Values[3] = {contentsSize, contentsSize, 0};
+		dirFileHeader.extraFieldLength = sizeof(otherField) + 4 + sizeof(zip64Field) + sizeof(zip64Values);
+		append(&dirFileHeader, sizeof(dirFileHeader));
+		append(fileName, sizeof(fileName) - 1);
+		append(&otherField, sizeof(otherField));
+		append("\0\0\0\0", 4);
+		append(&zip64Field, sizeof(zip64Field));
+		append(zip64Values, sizeof(zip64Values));
+		uint64 dirEnd = zip64Archive.size();
+
+		Framework::Zip::ZIPDIRENDHEADER64 dirEndHeader64 = {};
+		dirEndHeader64.signature = Framework::Zip::DIRENDHEADER64_SIG;
+		dirEndHeader64.size = sizeof(dirEndHeader64) - 12;
+		dirEndHeader64.dirEntryCount = 1;
+		dirEndHeader64.totalDirEntryCount = 1;
+		dirEndHeader64.dirSize = dirEnd - dirStart;
+		dirEndHeader64.dirStartOffset = dirStart;
+		append(&dirEndHeader64, sizeof(dirEndHeader64));
+		Framework::Zip::ZIPDIRENDLOCATOR64 locator = {};
+		locator.signature = Framework::Zip::DIRENDLOCATOR64_SIG;
+		locator.dirEndOffset = dirEnd;
+		locator.diskCount = 1;
+		append(&locator, sizeof(locator));
+		Framework::Zip::ZIPDIRENDHEADER dirEndHeader = {};
+		dirEndHeader.signature = Framework::Zip::DIRENDHEADER_SIG;
+		dirEndHeader.dirEntryCount = 0xFFFF;
+		dirEndHeader.totalDirEntryCount = 0xFFFF;
+		dirEndHeader.dirSize = Framework::Zip::ZIP64_MARKER32;
+		dirEndHeader.dirStartOffset = Framework::Zip::ZIP64_MARKER32;
+		append(&dirEndHeader, sizeof(dirEndHeader));
+
+		Framework::CPtrStream stream(zip64Archive.data(), zip64Archive.size());
+		Framework::CZipArchiveReader reader(stream);
+		auto info = reader.GetFileInfo("big.bin");
+		TEST_VERIFY(info && (info->uncompressedSize == contentsSize) && (info->compressedSize == contentsSize) && (info->fileStartOffset == 0));
+		FileContents expected;
+		expected[fileName] = std::vector<uint8>(contents, contents + contentsSize);
+		TEST_VERIFY(Extract(stream, true, &threadPool) == expected);
+	}
+}